@@ -4,15 +4,30 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 
+#include <QHash>
 #include <QMimeDatabase>
 #include <QTest>
 
 #include "../core/annotations.h"
 #include "../core/document.h"
+#include "../core/observer.h"
 #include "../core/page.h"
 #include "../settings_core.h"
 #include "testingutils.h"
 
+// counts the annotation changes of each page
+class AnnotationChangesObserver : public Okular::DocumentObserver
+{
+public:
+    void notifyPageChanged(int page, int flags) override
+    {
+        if (flags & Okular::DocumentObserver::Annotations)
+            ++changes[page];
+    }
+
+    QHash<int, int> changes;
+};
+
 class AddRemoveAnnotationTest : public QObject
 {
     Q_OBJECT
@@ -24,6 +39,7 @@ private slots:
     void testAddAnnotations();
     void testAddAnnotationUndoWithRotate_Bug318091();
     void testRemoveAnnotations();
+    void testAddAnnotationBatch();
 
 private:
     Okular::Document *m_document;
@@ -184,5 +200,42 @@ void AddRemoveAnnotationTest::testRemoveAnnotations()
     QVERIFY(TestingUtils::AnnotationDisposeWatcher::disposedAnnotationName() == annot1Name);
 }
 
+void AddRemoveAnnotationTest::testAddAnnotationBatch()
+{
+    AnnotationChangesObserver observer;
+    m_document->addObserver(&observer);
+
+    QList<Okular::Annotation *> annots;
+    for (int i = 0; i < 100; ++i) {
+        Okular::Annotation *annot = new Okular::TextAnnotation();
+        annot->setBoundingRectangle(Okular::NormalizedRect(i / 200.0, 0.1, i / 200.0 + 0.05, 0.15));
+        annots.append(annot);
+    }
+
+    // all of them at once, one undo step and one notification
+    m_document->addPageAnnotations(0, annots);
+    QCOMPARE(m_document->page(0)->annotations().size(), 100);
+    QCOMPARE(observer.changes.value(0), 1);
+
+    m_document->undo();
+    QCOMPARE(m_document->page(0)->annotations().size(), 0);
+    QCOMPARE(observer.changes.value(0), 2);
+    QVERIFY(!m_document->canUndo());
+
+    m_document->redo();
+    QCOMPARE(m_document->page(0)->annotations().size(), 100);
+    QVERIFY(m_document->page(0)->annotations().contains(annots.last()));
+    QCOMPARE(observer.changes.value(0), 3);
+
+    // removing a few is one step too
+    m_document->removePageAnnotations(0, annots.mid(0, 10));
+    QCOMPARE(m_document->page(0)->annotations().size(), 90);
+    QCOMPARE(observer.changes.value(0), 4);
+    m_document->undo();
+    QCOMPARE(m_document->page(0)->annotations().size(), 100);
+
+    m_document->removeObserver(&observer);
+}
+
 QTEST_MAIN(AddRemoveAnnotationTest)
 #include "addremoveannotationtest.moc"
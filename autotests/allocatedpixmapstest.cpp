@@ -0,0 +1,174 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/allocatedpixmaps_p.h"
+#include "../core/observer.h"
+
+#include <QSet>
+
+class PinningObserver : public Okular::DocumentObserver
+{
+public:
+    bool canUnloadPixmap(int page) const override
+    {
+        return !pinnedPages.contains(page);
+    }
+
+    QSet<int> pinnedPages;
+};
+
+class AllocatedPixmapsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testInsertAndTake();
+    void testFarthest();
+    void testFarthestUnloadableOnly();
+    void testFarthestPerObserver();
+    void testLeastValuable();
+    void testRemoveObserver();
+    void testSharedData();
+};
+
+void AllocatedPixmapsTest::testInsertAndTake()
+{
+    PinningObserver observer;
+    Okular::AllocatedPixmapIndex index;
+
+    index.insert(new AllocatedPixmap(&observer, 3, 10));
+    index.insert(new AllocatedPixmap(&observer, 5, 20));
+    QCOMPARE(index.count(), 2);
+
+    // replacing an entry does not grow the index
+    index.insert(new AllocatedPixmap(&observer, 3, 30));
+    QCOMPARE(index.count(), 2);
+    QCOMPARE(index.value(&observer, 3)->memory, 30ULL);
+
+    AllocatedPixmap *p = index.take(&observer, 5);
+    QVERIFY(p);
+    QCOMPARE(p->memory, 20ULL);
+    delete p;
+    QCOMPARE(index.count(), 1);
+    QVERIFY(!index.take(&observer, 5));
+
+    index.clear();
+    QVERIFY(index.isEmpty());
+}
+
+void AllocatedPixmapsTest::testFarthest()
+{
+    PinningObserver observer;
+    Okular::AllocatedPixmapIndex index;
+    QVERIFY(!index.farthestFrom(0, false));
+
+    for (int page : {2, 10, 11, 12, 30})
+        index.insert(new AllocatedPixmap(&observer, page, 1));
+
+    QCOMPARE(index.farthestFrom(11, false)->page, 30);
+    QCOMPARE(index.farthestFrom(25, false)->page, 2);
+    QCOMPARE(index.farthestFrom(100, false)->page, 2);
+    QCOMPARE(index.farthestFrom(0, false)->page, 30);
+}
+
+void AllocatedPixmapsTest::testFarthestUnloadableOnly()
+{
+    PinningObserver observer;
+    Okular::AllocatedPixmapIndex index;
+    for (int page : {2, 10, 11, 12, 30})
+        index.insert(new AllocatedPixmap(&observer, page, 1));
+
+    observer.pinnedPages = {30, 2};
+    QCOMPARE(index.farthestFrom(11, true)->page, 10);
+
+    observer.pinnedPages = {2, 10, 11, 12, 30};
+    QVERIFY(!index.farthestFrom(11, true));
+    QCOMPARE(index.farthestFrom(11, false)->page, 30);
+}
+
+void AllocatedPixmapsTest::testFarthestPerObserver()
+{
+    PinningObserver view, thumbnails;
+    Okular::AllocatedPixmapIndex index;
+    index.insert(new AllocatedPixmap(&view, 5, 1));
+    index.insert(new AllocatedPixmap(&thumbnails, 50, 1));
+
+    QCOMPARE(index.farthestFrom(0, false)->observer, &thumbnails);
+    QCOMPARE(index.farthestFrom(0, false, &view)->page, 5);
+
+    thumbnails.pinnedPages = {50};
+    QCOMPARE(index.farthestFrom(0, true)->observer, &view);
+}
+
+void AllocatedPixmapsTest::testLeastValuable()
+{
+    PinningObserver observer;
+    Okular::AllocatedPixmapIndex index;
+    QVERIFY(!index.leastValuableFrom(0, false));
+
+    // as cheap as each other, the farthest goes
+    index.insert(new AllocatedPixmap(&observer, 1, 100, 10));
+    index.insert(new AllocatedPixmap(&observer, 20, 100, 10));
+    index.insert(new AllocatedPixmap(&observer, 22, 100, 10));
+    QCOMPARE(index.leastValuableFrom(0, false)->page, 22);
+
+    // a page slow to render is kept over a cheap one about as far
+    index.insert(new AllocatedPixmap(&observer, 22, 100, 1500));
+    QCOMPARE(index.leastValuableFrom(0, false)->page, 20);
+
+    // and a big one goes before a small one
+    index.insert(new AllocatedPixmap(&observer, 1, 100000, 10));
+    QCOMPARE(index.leastValuableFrom(0, false)->page, 1);
+
+    observer.pinnedPages = {1};
+    QCOMPARE(index.leastValuableFrom(0, true)->page, 20);
+    QCOMPARE(index.leastValuableFrom(0, true, &observer)->page, 20);
+
+    QVERIFY(Okular::AllocatedPixmapIndex::evictionScore(10, 100, 10) > Okular::AllocatedPixmapIndex::evictionScore(10, 100, 1000));
+    QVERIFY(Okular::AllocatedPixmapIndex::evictionScore(2, 100, 10) < Okular::AllocatedPixmapIndex::evictionScore(10, 100, 10));
+}
+
+void AllocatedPixmapsTest::testRemoveObserver()
+{
+    PinningObserver view, thumbnails;
+    Okular::AllocatedPixmapIndex index;
+    index.insert(new AllocatedPixmap(&view, 1, 1));
+    index.insert(new AllocatedPixmap(&view, 2, 1));
+    index.insert(new AllocatedPixmap(&thumbnails, 1, 1));
+
+    index.removeObserver(&view);
+    QCOMPARE(index.count(), 1);
+    QVERIFY(!index.value(&view, 1));
+    QVERIFY(index.value(&thumbnails, 1));
+}
+
+void AllocatedPixmapsTest::testSharedData()
+{
+    PinningObserver view, thumbnails, presentation;
+    Okular::AllocatedPixmapIndex index;
+    AllocatedPixmap *rendered = new AllocatedPixmap(&view, 1, 100);
+    index.insert(rendered);
+    index.insert(new AllocatedPixmap(&thumbnails, 1, 0, 0, rendered));
+    index.insert(new AllocatedPixmap(&presentation, 1, 0, 0, rendered));
+
+    // the data outlives the rendered pixmap, one of the others is charged for it
+    AllocatedPixmap *p = index.take(&view, 1);
+    QCOMPARE(p->memory, 0ULL);
+    delete p;
+    QCOMPARE(index.value(&thumbnails, 1)->memory + index.value(&presentation, 1)->memory, 100ULL);
+
+    // and the last one of them
+    index.removeObserver(index.value(&thumbnails, 1)->memory ? &thumbnails : &presentation);
+    QCOMPARE(index.count(), 1);
+    AllocatedPixmap *last = index.value(&thumbnails, 1) ? index.value(&thumbnails, 1) : index.value(&presentation, 1);
+    QCOMPARE(last->memory, 100ULL);
+    QVERIFY(!last->source);
+}
+
+QTEST_GUILESS_MAIN(AllocatedPixmapsTest)
+#include "allocatedpixmapstest.moc"
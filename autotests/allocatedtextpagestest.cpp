@@ -0,0 +1,79 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/allocatedtextpages_p.h"
+
+class AllocatedTextPagesTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testInsertAndRemove();
+    void testEvictFarAndUnused();
+    void testEvictKeep();
+};
+
+void AllocatedTextPagesTest::testInsertAndRemove()
+{
+    Okular::AllocatedTextPages pages;
+    pages.insert(1, 100);
+    pages.insert(2, 200);
+    QCOMPARE(pages.count(), 2);
+    QCOMPARE(pages.totalBytes(), 300ULL);
+
+    // replacing an entry counts the new size only
+    pages.insert(1, 50);
+    QCOMPARE(pages.count(), 2);
+    QCOMPARE(pages.totalBytes(), 250ULL);
+
+    QVERIFY(pages.remove(2));
+    QVERIFY(!pages.remove(2));
+    QCOMPARE(pages.totalBytes(), 50ULL);
+    QVERIFY(pages.contains(1));
+
+    pages.clear();
+    QCOMPARE(pages.count(), 0);
+    QCOMPARE(pages.totalBytes(), 0ULL);
+}
+
+void AllocatedTextPagesTest::testEvictFarAndUnused()
+{
+    Okular::AllocatedTextPages pages;
+    // the farthest ones are the oldest
+    for (int page = 9; page >= 0; --page)
+        pages.insert(page, 100);
+
+    // nothing to do under the limit
+    QVERIFY(pages.toEvict(1000, 0, {}).isEmpty());
+
+    // the farthest and oldest first
+    QCOMPARE(pages.toEvict(800, 0, {}), QVector<int>({9, 8}));
+
+    // the page in use stays even if far
+    pages.touch(9);
+    QCOMPARE(pages.toEvict(900, 0, {}), QVector<int>({8}));
+
+    // the real sizes count, not the pages
+    Okular::AllocatedTextPages sized;
+    sized.insert(2, 1000);
+    sized.insert(1, 100);
+    QCOMPARE(sized.toEvict(500, 0, {}), QVector<int>({2}));
+}
+
+void AllocatedTextPagesTest::testEvictKeep()
+{
+    Okular::AllocatedTextPages pages;
+    pages.insert(1, 100);
+    pages.insert(2, 100);
+
+    QCOMPARE(pages.toEvict(100, 0, {2}), QVector<int>({1}));
+    QCOMPARE(pages.toEvict(0, 0, {1, 2}), QVector<int>());
+}
+
+QTEST_GUILESS_MAIN(AllocatedTextPagesTest)
+#include "allocatedtextpagestest.moc"
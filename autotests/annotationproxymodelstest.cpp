@@ -0,0 +1,155 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../part/annotationmodel.h"
+#include "../part/annotationproxymodels.h"
+
+#include <QAbstractItemModelTester>
+#include <QRandomGenerator>
+#include <QStandardItemModel>
+
+#include <algorithm>
+
+// the chain of proxies of the reviews panel
+struct ProxyChain {
+    ProxyChain(QAbstractItemModel *model, bool groupByPage, bool groupByAuthor, bool currentPageOnly, int currentPage)
+    {
+        filter.setSourceModel(model);
+        group.setSourceModel(&filter);
+        author.setSourceModel(&group);
+        filter.groupByCurrentPage(currentPageOnly);
+        filter.setCurrentPage(currentPage);
+        group.groupByPage(groupByPage);
+        author.groupByAuthor(groupByAuthor);
+    }
+
+    PageFilterProxyModel filter;
+    PageGroupProxyModel group;
+    AuthorGroupProxyModel author;
+};
+
+class AnnotationProxyModelsTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testIncrementalMatchesRebuild_data();
+    void testIncrementalMatchesRebuild();
+
+private:
+    static QString dump(const QAbstractItemModel *model, const QModelIndex &parent = QModelIndex());
+    static QStandardItem *annotationItem(int page, const QString &author, int id);
+};
+
+QString AnnotationProxyModelsTest::dump(const QAbstractItemModel *model, const QModelIndex &parent)
+{
+    QStringList children;
+    bool authors = false;
+    for (int row = 0; row < model->rowCount(parent); ++row) {
+        const QModelIndex index = model->index(row, 0, parent);
+        // only the author items have no page
+        authors = authors || !index.data(AnnotationModel::PageRole).isValid();
+        children.append(index.data().toString() + dump(model, index));
+    }
+
+    // a new author is added after the others, a rebuild orders them by their first annotation
+    if (authors)
+        std::sort(children.begin(), children.end());
+
+    return children.isEmpty() ? QString() : QLatin1Char('(') + children.join(QLatin1Char(' ')) + QLatin1Char(')');
+}
+
+QStandardItem *AnnotationProxyModelsTest::annotationItem(int page, const QString &author, int id)
+{
+    QStandardItem *item = new QStandardItem(QStringLiteral("annotation%1").arg(id));
+    item->setData(page, AnnotationModel::PageRole);
+    item->setData(author, AnnotationModel::AuthorRole);
+    return item;
+}
+
+void AnnotationProxyModelsTest::testIncrementalMatchesRebuild_data()
+{
+    QTest::addColumn<bool>("groupByPage");
+    QTest::addColumn<bool>("groupByAuthor");
+    QTest::addColumn<bool>("currentPageOnly");
+
+    for (int i = 0; i < 8; ++i) {
+        const bool groupByPage = i & 1;
+        const bool groupByAuthor = i & 2;
+        const bool currentPageOnly = i & 4;
+        QTest::addRow("page %d author %d current %d", groupByPage, groupByAuthor, currentPageOnly) << groupByPage << groupByAuthor << currentPageOnly;
+    }
+}
+
+void AnnotationProxyModelsTest::testIncrementalMatchesRebuild()
+{
+    QFETCH(bool, groupByPage);
+    QFETCH(bool, groupByAuthor);
+    QFETCH(bool, currentPageOnly);
+
+    static const int pageCount = 6;
+    const QStringList authors = {QStringLiteral("alice"), QStringLiteral("bob"), QStringLiteral("carol")};
+
+    // like AnnotationModel: the pages with annotations in page order, their annotations under them
+    QStandardItemModel model;
+    QRandomGenerator random(11);
+    int currentPage = 0;
+    int nextId = 0;
+
+    ProxyChain chain(&model, groupByPage, groupByAuthor, currentPageOnly, currentPage);
+    QAbstractItemModelTester filterTester(&chain.filter, QAbstractItemModelTester::FailureReportingMode::QtTest);
+    QAbstractItemModelTester groupTester(&chain.group, QAbstractItemModelTester::FailureReportingMode::QtTest);
+    QAbstractItemModelTester authorTester(&chain.author, QAbstractItemModelTester::FailureReportingMode::QtTest);
+
+    for (int step = 0; step < 300; ++step) {
+        const int page = random.bounded(pageCount);
+        int row = 0;
+        while (row < model.rowCount() && model.item(row)->data(AnnotationModel::PageRole).toInt() < page)
+            ++row;
+        QStandardItem *pageItem = row < model.rowCount() && model.item(row)->data(AnnotationModel::PageRole).toInt() == page ? model.item(row) : nullptr;
+
+        switch (random.bounded(5)) {
+        case 0:
+        case 1:
+            // add an annotation, and its page if it is the first one
+            if (!pageItem) {
+                pageItem = new QStandardItem(QStringLiteral("page%1").arg(page));
+                pageItem->setData(page, AnnotationModel::PageRole);
+                pageItem->appendRow(annotationItem(page, authors.at(random.bounded(authors.count())), nextId++));
+                model.insertRow(row, pageItem);
+            } else {
+                pageItem->appendRow(annotationItem(page, authors.at(random.bounded(authors.count())), nextId++));
+            }
+            break;
+        case 2:
+            // remove an annotation, and its page if it is the last one
+            if (pageItem) {
+                if (pageItem->rowCount() == 1)
+                    model.removeRow(row);
+                else
+                    pageItem->removeRow(random.bounded(pageItem->rowCount()));
+            }
+            break;
+        case 3:
+            // change the author of an annotation
+            if (pageItem)
+                pageItem->child(random.bounded(pageItem->rowCount()))->setData(authors.at(random.bounded(authors.count())), AnnotationModel::AuthorRole);
+            break;
+        case 4:
+            currentPage = random.bounded(pageCount);
+            chain.filter.setCurrentPage(currentPage);
+            break;
+        }
+
+        ProxyChain rebuilt(&model, groupByPage, groupByAuthor, currentPageOnly, currentPage);
+        QCOMPARE(dump(&chain.author), dump(&rebuilt.author));
+    }
+}
+
+QTEST_MAIN(AnnotationProxyModelsTest)
+#include "annotationproxymodelstest.moc"
@@ -0,0 +1,211 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QMimeDatabase>
+#include <QTest>
+
+#include "../core/annotations.h"
+#include "../core/document.h"
+#include "../part/annotationmodel.h"
+#include "../part/annotationsearchindex.h"
+#include "../settings_core.h"
+
+class AnnotationSearchIndexTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+    void testWords();
+    void testCaseSensitivity();
+    void testRegularExpression();
+    void testEmptyPattern();
+    void testAddAnnotation();
+    void testEditAnnotation();
+    void testRemoveAnnotation();
+
+private:
+    Okular::Annotation *addAnnotation(const QString &author, const QString &contents);
+    QModelIndex indexOf(const Okular::Annotation *annotation) const;
+    bool matches(const Okular::Annotation *annotation, const QString &pattern, Qt::CaseSensitivity caseSensitivity = Qt::CaseInsensitive, bool regularExpression = false) const;
+    // the annotations of the model that match @p pattern, case insensitive
+    int matchCount(const QString &pattern) const;
+
+    Okular::Document *m_document;
+    AnnotationModel *m_model;
+    AnnotationSearchIndex *m_index;
+    Okular::Annotation *m_fruits;
+    Okular::Annotation *m_colors;
+};
+
+void AnnotationSearchIndexTest::initTestCase()
+{
+    Okular::SettingsCore::instance(QStringLiteral("annotationsearchindextest"));
+    m_document = new Okular::Document(nullptr);
+}
+
+void AnnotationSearchIndexTest::init()
+{
+    const QString testFile = QStringLiteral(KDESRCDIR "data/file1.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile(testFile);
+    QCOMPARE(m_document->openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess);
+
+    m_model = new AnnotationModel(m_document);
+    m_index = new AnnotationSearchIndex(m_model);
+
+    m_fruits = addAnnotation(QStringLiteral("Alice"), QStringLiteral("Apples and bananas"));
+    m_colors = addAnnotation(QStringLiteral("Bob"), QStringLiteral("Red, green and blue"));
+}
+
+void AnnotationSearchIndexTest::cleanup()
+{
+    delete m_index;
+    delete m_model;
+    m_document->closeDocument();
+}
+
+void AnnotationSearchIndexTest::testWords()
+{
+    QVERIFY(matches(m_fruits, QStringLiteral("bananas")));
+    QVERIFY(!matches(m_colors, QStringLiteral("bananas")));
+
+    // the author is searched too
+    QVERIFY(matches(m_colors, QStringLiteral("bob")));
+    QVERIFY(!matches(m_fruits, QStringLiteral("bob")));
+
+    // inside words and across them
+    QVERIFY(matches(m_fruits, QStringLiteral("anana")));
+    QVERIFY(matches(m_fruits, QStringLiteral("les and ban")));
+    QVERIFY(matches(m_colors, QStringLiteral("red, gr")));
+    QVERIFY(!matches(m_colors, QStringLiteral("red green")));
+
+    // all the words of the pattern must be in the same annotation
+    QVERIFY(matches(m_fruits, QStringLiteral("and")));
+    QVERIFY(matches(m_colors, QStringLiteral("and")));
+    QVERIFY(!matches(m_fruits, QStringLiteral("apples and blue")));
+    QVERIFY(!matches(m_colors, QStringLiteral("apples and blue")));
+}
+
+void AnnotationSearchIndexTest::testCaseSensitivity()
+{
+    QVERIFY(matches(m_fruits, QStringLiteral("APPLES")));
+    QVERIFY(!matches(m_fruits, QStringLiteral("APPLES"), Qt::CaseSensitive));
+    QVERIFY(matches(m_fruits, QStringLiteral("Apples"), Qt::CaseSensitive));
+    QVERIFY(!matches(m_fruits, QStringLiteral("apples"), Qt::CaseSensitive));
+}
+
+void AnnotationSearchIndexTest::testRegularExpression()
+{
+    QVERIFY(matches(m_fruits, QStringLiteral("app.*ban"), Qt::CaseInsensitive, true));
+    QVERIFY(!matches(m_colors, QStringLiteral("app.*ban"), Qt::CaseInsensitive, true));
+    QVERIFY(!matches(m_fruits, QStringLiteral("app.*ban"), Qt::CaseSensitive, true));
+
+    QVERIFY(matches(m_colors, QStringLiteral("\\bgre+n\\b"), Qt::CaseInsensitive, true));
+    QVERIFY(!matches(m_fruits, QStringLiteral("\\bgre+n\\b"), Qt::CaseInsensitive, true));
+
+    // not a regular expression => matched literally
+    QVERIFY(!matches(m_fruits, QStringLiteral("app.*ban")));
+}
+
+void AnnotationSearchIndexTest::testEmptyPattern()
+{
+    QVERIFY(matches(m_fruits, QString()));
+    QVERIFY(matches(m_colors, QString()));
+    QVERIFY(matches(m_colors, QString(), Qt::CaseSensitive, true));
+}
+
+void AnnotationSearchIndexTest::testAddAnnotation()
+{
+    // a search is cached, the new annotation must still be found
+    QVERIFY(!matches(m_fruits, QStringLiteral("cherries")));
+
+    Okular::Annotation *cherries = addAnnotation(QStringLiteral("Carol"), QStringLiteral("Cherries"));
+    QVERIFY(matches(cherries, QStringLiteral("cherries")));
+    QVERIFY(!matches(m_fruits, QStringLiteral("cherries")));
+}
+
+void AnnotationSearchIndexTest::testEditAnnotation()
+{
+    QVERIFY(matches(m_colors, QStringLiteral("blue")));
+
+    const QString oldContents = m_colors->contents();
+    const QString newContents = QStringLiteral("Cyan and magenta");
+    m_document->editPageAnnotationContents(0, m_colors, newContents, newContents.length(), oldContents.length(), oldContents.length());
+
+    QVERIFY(!matches(m_colors, QStringLiteral("blue")));
+    QVERIFY(matches(m_colors, QStringLiteral("magenta")));
+    QVERIFY(matches(m_colors, QStringLiteral("cyan and"), Qt::CaseInsensitive, true));
+    QVERIFY(!matches(m_fruits, QStringLiteral("magenta")));
+}
+
+void AnnotationSearchIndexTest::testRemoveAnnotation()
+{
+    QCOMPARE(matchCount(QStringLiteral("and")), 2);
+
+    m_document->removePageAnnotation(0, m_colors);
+    m_colors = nullptr;
+    QCOMPARE(matchCount(QStringLiteral("and")), 1);
+    QVERIFY(matches(m_fruits, QStringLiteral("and")));
+    QCOMPARE(matchCount(QStringLiteral("red")), 0);
+
+    // the last annotation of the page takes its branch with it
+    m_document->removePageAnnotation(0, m_fruits);
+    m_fruits = nullptr;
+    QCOMPARE(m_model->rowCount(), 0);
+
+    Okular::Annotation *cherries = addAnnotation(QStringLiteral("Carol"), QStringLiteral("Cherries"));
+    QCOMPARE(matchCount(QStringLiteral("and")), 0);
+    QCOMPARE(matchCount(QString()), 1);
+    QVERIFY(matches(cherries, QString()));
+}
+
+Okular::Annotation *AnnotationSearchIndexTest::addAnnotation(const QString &author, const QString &contents)
+{
+    Okular::Annotation *annotation = new Okular::TextAnnotation();
+    annotation->setBoundingRectangle(Okular::NormalizedRect(0.1, 0.1, 0.15, 0.15));
+    annotation->setAuthor(author);
+    annotation->setContents(contents);
+    m_document->addPageAnnotation(0, annotation);
+    return annotation;
+}
+
+QModelIndex AnnotationSearchIndexTest::indexOf(const Okular::Annotation *annotation) const
+{
+    for (int branch = 0; branch < m_model->rowCount(); ++branch) {
+        const QModelIndex parent = m_model->index(branch, 0);
+        for (int row = 0; row < m_model->rowCount(parent); ++row) {
+            const QModelIndex index = m_model->index(row, 0, parent);
+            if (m_model->annotationForIndex(index) == annotation)
+                return index;
+        }
+    }
+    return QModelIndex();
+}
+
+bool AnnotationSearchIndexTest::matches(const Okular::Annotation *annotation, const QString &pattern, Qt::CaseSensitivity caseSensitivity, bool regularExpression) const
+{
+    const QModelIndex index = indexOf(annotation);
+    return index.isValid() && m_index->matches(index, pattern, caseSensitivity, regularExpression);
+}
+
+int AnnotationSearchIndexTest::matchCount(const QString &pattern) const
+{
+    int count = 0;
+    for (int branch = 0; branch < m_model->rowCount(); ++branch) {
+        const QModelIndex parent = m_model->index(branch, 0);
+        for (int row = 0; row < m_model->rowCount(parent); ++row) {
+            if (m_index->matches(m_model->index(row, 0, parent), pattern, Qt::CaseInsensitive, false))
+                ++count;
+        }
+    }
+    return count;
+}
+
+QTEST_MAIN(AnnotationSearchIndexTest)
+#include "annotationsearchindextest.moc"
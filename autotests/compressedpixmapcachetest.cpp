@@ -0,0 +1,96 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/compressedpixmapcache_p.h"
+#include "../core/observer.h"
+
+#include <QPainter>
+#include <QPixmap>
+
+class CompressedPixmapCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testRoundTrip();
+    void testMismatch();
+    void testDisabled();
+    void testRemove();
+};
+
+static QPixmap pagePixmap(int width, int height)
+{
+    QImage image(width, height, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter p(&image);
+    p.fillRect(10, 10, width / 2, height / 3, Qt::black);
+    p.end();
+    return QPixmap::fromImage(image);
+}
+
+void CompressedPixmapCacheTest::testRoundTrip()
+{
+    Okular::DocumentObserver observer;
+    Okular::CompressedPixmapCache cache;
+    cache.setMaxBytes(16 * 1024 * 1024);
+
+    const QPixmap pixmap = pagePixmap(600, 800);
+    QVERIFY(cache.insert(&observer, 3, Okular::Rotation0, pixmap));
+    QCOMPARE(cache.count(), 1);
+    // a mostly white page compresses well
+    QVERIFY(cache.totalBytes() < 600 * 800 * 4 / 10);
+
+    QPixmap *restored = cache.take(&observer, 3, 600, 800, Okular::Rotation0);
+    QVERIFY(restored);
+    QCOMPARE(restored->toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied), pixmap.toImage().convertToFormat(QImage::Format_ARGB32_Premultiplied));
+    delete restored;
+    QCOMPARE(cache.count(), 0);
+}
+
+void CompressedPixmapCacheTest::testMismatch()
+{
+    Okular::DocumentObserver observer;
+    Okular::CompressedPixmapCache cache;
+    cache.setMaxBytes(16 * 1024 * 1024);
+
+    cache.insert(&observer, 0, Okular::Rotation0, pagePixmap(100, 200));
+    QVERIFY(!cache.take(&observer, 0, 200, 400, Okular::Rotation0));
+    // the entry is gone even if it was the wrong size
+    QCOMPARE(cache.count(), 0);
+
+    cache.insert(&observer, 0, Okular::Rotation0, pagePixmap(100, 200));
+    QVERIFY(!cache.take(&observer, 0, 100, 200, Okular::Rotation90));
+}
+
+void CompressedPixmapCacheTest::testDisabled()
+{
+    Okular::DocumentObserver observer;
+    Okular::CompressedPixmapCache cache;
+    QVERIFY(!cache.isEnabled());
+    QVERIFY(!cache.insert(&observer, 0, Okular::Rotation0, pagePixmap(100, 100)));
+    QCOMPARE(cache.count(), 0);
+}
+
+void CompressedPixmapCacheTest::testRemove()
+{
+    Okular::DocumentObserver view, thumbnails;
+    Okular::CompressedPixmapCache cache;
+    cache.setMaxBytes(16 * 1024 * 1024);
+
+    cache.insert(&view, 0, Okular::Rotation0, pagePixmap(100, 100));
+    cache.insert(&view, 1, Okular::Rotation0, pagePixmap(100, 100));
+    cache.insert(&thumbnails, 1, Okular::Rotation0, pagePixmap(50, 50));
+
+    cache.removePage(1);
+    QCOMPARE(cache.count(), 1);
+    cache.removeObserver(&view);
+    QCOMPARE(cache.count(), 0);
+}
+
+QTEST_MAIN(CompressedPixmapCacheTest)
+#include "compressedpixmapcachetest.moc"
@@ -0,0 +1,149 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/documentinfofile_p.h"
+
+#include <QFileInfo>
+#include <QTemporaryDir>
+
+class DocumentInfoFileTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testWriteRead();
+    void testAppend();
+    void testTruncated();
+    void testXml();
+};
+
+void DocumentInfoFileTest::testWriteRead()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("info"));
+
+    Okular::DocumentInfoFile file;
+    QVERIFY(!file.open(fileName));
+    file.setRecord(Okular::DocumentInfoFile::RotationRecord, QString(), "1");
+    file.setRecord(Okular::DocumentInfoFile::PageBoundingBoxRecord, QStringLiteral("0"), "box 0");
+    file.setRecord(Okular::DocumentInfoFile::PageBoundingBoxRecord, QStringLiteral("7"), "box 7");
+    file.setRecord(Okular::DocumentInfoFile::ViewRecord, QStringLiteral("PageView"), QByteArray());
+    QVERIFY(file.commit());
+
+    QVERIFY(file.open(fileName));
+    QCOMPARE(file.record(Okular::DocumentInfoFile::RotationRecord), QByteArray("1"));
+    QCOMPARE(file.record(Okular::DocumentInfoFile::PageBoundingBoxRecord, QStringLiteral("7")), QByteArray("box 7"));
+    QVERIFY(file.record(Okular::DocumentInfoFile::PageBoundingBoxRecord, QStringLiteral("1")).isNull());
+    // set empty is not removed
+    QVERIFY(!file.record(Okular::DocumentInfoFile::ViewRecord, QStringLiteral("PageView")).isNull());
+    QStringList keys = file.keys(Okular::DocumentInfoFile::PageBoundingBoxRecord);
+    keys.sort();
+    QCOMPARE(keys, QStringList({QStringLiteral("0"), QStringLiteral("7")}));
+
+    file.removeRecord(Okular::DocumentInfoFile::PageBoundingBoxRecord, QStringLiteral("0"));
+    file.setRecord(Okular::DocumentInfoFile::RotationRecord, QString(), "2");
+    QVERIFY(file.commit());
+
+    QVERIFY(file.open(fileName));
+    QCOMPARE(file.record(Okular::DocumentInfoFile::RotationRecord), QByteArray("2"));
+    QVERIFY(file.record(Okular::DocumentInfoFile::PageBoundingBoxRecord, QStringLiteral("0")).isNull());
+    QCOMPARE(file.keys(Okular::DocumentInfoFile::PageBoundingBoxRecord), QStringList {QStringLiteral("7")});
+}
+
+void DocumentInfoFileTest::testAppend()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("info"));
+
+    Okular::DocumentInfoFile file;
+    file.open(fileName);
+    for (int i = 0; i < 1000; ++i)
+        file.setRecord(Okular::DocumentInfoFile::PageBoundingBoxRecord, QString::number(i), QByteArray(32, 'a'));
+    QVERIFY(file.commit());
+    const qint64 size = QFileInfo(fileName).size();
+
+    // the same records again write nothing
+    QVERIFY(file.open(fileName));
+    for (int i = 0; i < 1000; ++i)
+        file.setRecord(Okular::DocumentInfoFile::PageBoundingBoxRecord, QString::number(i), QByteArray(32, 'a'));
+    QVERIFY(file.commit());
+    QCOMPARE(QFileInfo(fileName).size(), size);
+
+    // a changed one is appended
+    QVERIFY(file.open(fileName));
+    file.setRecord(Okular::DocumentInfoFile::PageBoundingBoxRecord, QStringLiteral("5"), QByteArray(32, 'b'));
+    QVERIFY(file.commit());
+    const qint64 appendedSize = QFileInfo(fileName).size();
+    QVERIFY(appendedSize > size);
+    QVERIFY(appendedSize < size + 100);
+
+    QVERIFY(file.open(fileName));
+    QCOMPARE(file.record(Okular::DocumentInfoFile::PageBoundingBoxRecord, QStringLiteral("5")), QByteArray(32, 'b'));
+    QCOMPARE(file.record(Okular::DocumentInfoFile::PageBoundingBoxRecord, QStringLiteral("6")), QByteArray(32, 'a'));
+    file.close();
+
+    // once most of it doesn't count, it is written again
+    for (int round = 0; round < 4; ++round) {
+        QVERIFY(file.open(fileName));
+        for (int i = 0; i < 1000; ++i)
+            file.setRecord(Okular::DocumentInfoFile::PageBoundingBoxRecord, QString::number(i), QByteArray(32, 'c' + round));
+        QVERIFY(file.commit());
+    }
+    QVERIFY(QFileInfo(fileName).size() < 3 * size);
+    QVERIFY(file.open(fileName));
+    QCOMPARE(file.record(Okular::DocumentInfoFile::PageBoundingBoxRecord, QStringLiteral("999")), QByteArray(32, 'f'));
+    QCOMPARE(file.keys(Okular::DocumentInfoFile::PageBoundingBoxRecord).count(), 1000);
+}
+
+void DocumentInfoFileTest::testTruncated()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("info"));
+
+    Okular::DocumentInfoFile file;
+    file.open(fileName);
+    file.setRecord(Okular::DocumentInfoFile::RotationRecord, QString(), "1");
+    QVERIFY(file.commit());
+    QVERIFY(file.open(fileName));
+    file.setRecord(Okular::DocumentInfoFile::HistoryRecord, QString(), QByteArray(100, 'h'));
+    QVERIFY(file.commit());
+
+    // the end of the last record didn't make it
+    QVERIFY(QFile::resize(fileName, QFileInfo(fileName).size() - 10));
+    QVERIFY(file.open(fileName));
+    QCOMPARE(file.record(Okular::DocumentInfoFile::RotationRecord), QByteArray("1"));
+    QVERIFY(file.record(Okular::DocumentInfoFile::HistoryRecord).isNull());
+
+    // and what comes after it is still read
+    file.setRecord(Okular::DocumentInfoFile::HistoryRecord, QString(), "again");
+    QVERIFY(file.commit());
+    QVERIFY(file.open(fileName));
+    QCOMPARE(file.record(Okular::DocumentInfoFile::HistoryRecord), QByteArray("again"));
+}
+
+void DocumentInfoFileTest::testXml()
+{
+    QTemporaryDir dir;
+    const QString fileName = dir.filePath(QStringLiteral("info.xml"));
+    QFile xml(fileName);
+    QVERIFY(xml.open(QIODevice::WriteOnly));
+    xml.write("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n<!DOCTYPE documentInfo>\n<documentInfo/>\n");
+    xml.close();
+
+    Okular::DocumentInfoFile file;
+    QVERIFY(!file.open(fileName));
+    QCOMPARE(file.keys(Okular::DocumentInfoFile::ViewRecord), QStringList());
+    file.setRecord(Okular::DocumentInfoFile::RotationRecord, QString(), "3");
+    QVERIFY(file.commit());
+
+    QVERIFY(file.open(fileName));
+    QCOMPARE(file.record(Okular::DocumentInfoFile::RotationRecord), QByteArray("3"));
+}
+
+QTEST_MAIN(DocumentInfoFileTest)
+#include "documentinfofiletest.moc"
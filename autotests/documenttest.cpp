@@ -8,6 +8,7 @@
 */
 
 #include <QMimeDatabase>
+#include <QSignalSpy>
 #include <QTemporaryFile>
 #include <QTest>
 
@@ -29,6 +30,9 @@ class DocumentTest : public QObject
 private slots:
     void testCloseDuringRotationJob();
     void testDocdataMigration();
+    void testMemoryUsage();
+    void testAsynchronousTextPage();
+    void testCoalescedPixmapRequests();
 };
 
 // Test that we don't crash if the document is closed while a RotationJob
@@ -126,5 +130,86 @@ void DocumentTest::testDocdataMigration()
     delete m_document;
 }
 
+void DocumentTest::testMemoryUsage()
+{
+    Okular::SettingsCore::instance(QStringLiteral("documenttest"));
+    Okular::Document document(nullptr);
+    const QString testFile = QStringLiteral(KDESRCDIR "data/file1.pdf");
+    QMimeDatabase db;
+    QCOMPARE(document.openDocument(testFile, QUrl(), db.mimeTypeForFile(testFile)), Okular::Document::OpenSuccess);
+
+    QCOMPARE(document.memoryUsage().value(QStringLiteral("Text pages")), qulonglong(0));
+    document.requestTextPage(0);
+    QTRY_VERIFY(document.page(0)->hasTextPage());
+    QVERIFY(document.memoryUsage().value(QStringLiteral("Text pages")) > 0);
+
+    // what the other components report is kept until they take it back
+    document.setMemoryUsage(QStringLiteral("Test widgets"), 1000);
+    QCOMPARE(document.memoryUsage().value(QStringLiteral("Test widgets")), qulonglong(1000));
+    document.setMemoryUsage(QStringLiteral("Test widgets"), 0);
+    QVERIFY(!document.memoryUsage().contains(QStringLiteral("Test widgets")));
+
+    document.closeDocument();
+}
+
+void DocumentTest::testAsynchronousTextPage()
+{
+    Okular::SettingsCore::instance(QStringLiteral("documenttest"));
+    Okular::Document document(nullptr);
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    QCOMPARE(document.openDocument(testFile, QUrl(), db.mimeTypeForFile(testFile)), Okular::Document::OpenSuccess);
+    QSignalSpy spy(&document, &Okular::Document::textPageReady);
+    // the pages around get their text too
+    auto readyCount = [&spy] {
+        int count = 0;
+        for (const QList<QVariant> &arguments : qAsConst(spy))
+            count += arguments.first().toInt() == 0;
+        return count;
+    };
+
+    // the text page comes later, from another thread
+    document.requestTextPage(0, Okular::Document::VisibleTextPagePriority);
+    QTRY_VERIFY(document.page(0)->hasTextPage());
+    QCOMPARE(readyCount(), 1);
+
+    // a page with a text page is not requested again: if it was, it would
+    // be before the request of another page with a lower priority is done
+    document.requestTextPage(0, Okular::Document::VisibleTextPagePriority);
+    document.requestTextPage(1, Okular::Document::BackgroundTextPagePriority);
+    QTRY_VERIFY(document.page(1)->hasTextPage());
+    QCOMPARE(readyCount(), 1);
+
+    document.closeDocument();
+}
+
+// Test that two observers asking for the same pixmap get it from one render
+void DocumentTest::testCoalescedPixmapRequests()
+{
+    Okular::SettingsCore::instance(QStringLiteral("documenttest"));
+    Okular::Document document(nullptr);
+    const QString testFile = QStringLiteral(KDESRCDIR "data/file1.pdf");
+    QMimeDatabase db;
+    QCOMPARE(document.openDocument(testFile, QUrl(), db.mimeTypeForFile(testFile)), Okular::Document::OpenSuccess);
+
+    Okular::DocumentObserver first;
+    Okular::DocumentObserver second;
+    document.addObserver(&first);
+    document.addObserver(&second);
+
+    // the second comes while the render for the first is running
+    document.requestPixmaps(QLinkedList<Okular::PixmapRequest *>() << new Okular::PixmapRequest(&first, 0, 100, 100, 1, 1, Okular::PixmapRequest::Asynchronous));
+    document.requestPixmaps(QLinkedList<Okular::PixmapRequest *>() << new Okular::PixmapRequest(&second, 0, 100, 100, 1, 1, Okular::PixmapRequest::Asynchronous));
+    QTRY_VERIFY(document.page(0)->hasPixmap(&first, 100, 100) && document.page(0)->hasPixmap(&second, 100, 100));
+
+    const QHash<Okular::DocumentObserver *, Okular::RenderStatistics> statistics = document.observerRenderStatistics();
+    QCOMPARE(statistics.value(&second).coalescedRequests(), 1);
+    QCOMPARE(statistics.value(&second).generatorRequests(), 0);
+
+    document.removeObserver(&first);
+    document.removeObserver(&second);
+    document.closeDocument();
+}
+
 QTEST_MAIN(DocumentTest)
 #include "documenttest.moc"
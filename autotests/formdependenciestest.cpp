@@ -0,0 +1,81 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/formdependencies_p.h"
+
+class FormDependenciesTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testReadFieldNames_data();
+    void testReadFieldNames();
+    void testReads();
+};
+
+void FormDependenciesTest::testReadFieldNames_data()
+{
+    QTest::addColumn<QString>("script");
+    QTest::addColumn<QStringList>("names");
+    QTest::addColumn<bool>("readsAll");
+
+    QTest::newRow("simple calculate") << QStringLiteral("AFSimple_Calculate(\"SUM\", new Array (\"Price\", 'Tax'));") << QStringList {QStringLiteral("SUM"), QStringLiteral("Price"), QStringLiteral("Tax")} << false;
+    QTest::newRow("getField") << QStringLiteral("event.value = this.getField( \"a.b\" ).value * getField('c').value;") << QStringList {QStringLiteral("a.b"), QStringLiteral("c")} << false;
+    QTest::newRow("escaped quote") << QStringLiteral("var f = getField(\"say \\\"hi\\\"\");") << QStringList {QStringLiteral("say \"hi\"")} << false;
+    QTest::newRow("built name") << QStringLiteral("for (var i = 0; i < 3; ++i) s += getField(\"row\" + i).value;") << QStringList {QStringLiteral("row")} << true;
+    QTest::newRow("variable") << QStringLiteral("var n = \"a\"; event.value = getField(n).value;") << QStringList {QStringLiteral("a")} << true;
+    QTest::newRow("all fields") << QStringLiteral("for (var i = 0; i < this.numFields; ++i) this.getNthFieldName(i);") << QStringList() << true;
+    QTest::newRow("no fields") << QStringLiteral("event.value = 42;") << QStringList() << false;
+    QTest::newRow("document function") << QStringLiteral("event.value = computeTotal(\"a\");") << QStringList {QStringLiteral("a")} << true;
+    QTest::newRow("own function") << QStringLiteral("function twice(v) { return 2 * v; } event.value = twice(getField(\"a\").value);") << QStringList {QStringLiteral("a")} << false;
+    QTest::newRow("methods") << QStringLiteral("event.value = Math.round(this.getField(\"a\").value) + util.printf(\"%d\", 1);") << QStringList {QStringLiteral("a"), QStringLiteral("%d")} << false;
+}
+
+void FormDependenciesTest::testReadFieldNames()
+{
+    QFETCH(QString, script);
+    QFETCH(QStringList, names);
+    QFETCH(bool, readsAll);
+
+    bool foundReadsAll = false;
+    const QSet<QString> found = Okular::FormDependencies::readFieldNames(script, &foundReadsAll);
+    QStringList foundNames = found.values();
+    foundNames.sort();
+    names.sort();
+    QCOMPARE(foundNames, names);
+    QCOMPARE(foundReadsAll, readsAll);
+}
+
+void FormDependenciesTest::testReads()
+{
+    Okular::FormDependencies dependencies;
+    dependencies.addCalculation(1, QStringLiteral("AFSimple_Calculate(\"SUM\", new Array (\"Price\", \"Tax\"));"));
+    dependencies.addCalculation(2, QStringLiteral("event.value = getField(\"Total\").value * 2;"));
+    dependencies.addCalculation(3, QStringLiteral("event.value = getField(\"row\" + 1).value;"));
+    dependencies.addOpaqueCalculation(4);
+
+    QVERIFY(dependencies.reads(1, {QStringLiteral("Price")}));
+    QVERIFY(dependencies.reads(1, {QStringLiteral("Name"), QStringLiteral("Tax")}));
+    QVERIFY(!dependencies.reads(1, {QStringLiteral("Name")}));
+    QVERIFY(!dependencies.reads(1, {QStringLiteral("Price2")}));
+    // the widgets of a field are its children
+    QVERIFY(dependencies.reads(2, {QStringLiteral("Total.0")}));
+    QVERIFY(!dependencies.reads(2, {QStringLiteral("Totals.0")}));
+    QVERIFY(!dependencies.reads(2, {QStringLiteral("Price")}));
+    QVERIFY(dependencies.reads(3, {QStringLiteral("Anything")}));
+    QVERIFY(dependencies.reads(4, {QStringLiteral("Anything")}));
+    // not calculated at all
+    QVERIFY(!dependencies.reads(5, {QStringLiteral("Price")}));
+
+    dependencies.clear();
+    QVERIFY(!dependencies.reads(1, {QStringLiteral("Price")}));
+    QVERIFY(!dependencies.reads(4, {QStringLiteral("Anything")}));
+}
+
+QTEST_MAIN(FormDependenciesTest)
+#include "formdependenciestest.moc"
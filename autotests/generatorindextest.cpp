@@ -0,0 +1,84 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/generatorindex_p.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+class GeneratorIndexTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testIndexFile();
+    void testBrokenIndexFile();
+};
+
+void GeneratorIndexTest::testIndexFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString pluginFolder = dir.filePath(QStringLiteral("plugins"));
+    QVERIFY(QDir().mkpath(pluginFolder));
+    const QString indexFileName = dir.filePath(QStringLiteral("cache/index.json"));
+
+    {
+        const Okular::GeneratorIndex index(pluginFolder, indexFileName);
+        QVERIFY(!index.isFromIndexFile());
+        QVERIFY(index.plugins().isEmpty());
+        QVERIFY(QFile::exists(indexFileName));
+    }
+
+    {
+        const Okular::GeneratorIndex index(pluginFolder, indexFileName);
+        QVERIFY(index.isFromIndexFile());
+        QVERIFY(index.plugins().isEmpty());
+        QVERIFY(index.mimeTypes().isEmpty());
+    }
+
+    // something new in the folder looks for the plugins again, even if the
+    // time of the folder did not change
+    QFile file(pluginFolder + QStringLiteral("/notaplugin.txt"));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(60), QFileDevice::FileModificationTime));
+    file.close();
+    {
+        const Okular::GeneratorIndex index(pluginFolder, indexFileName);
+        QVERIFY(!index.isFromIndexFile());
+        QVERIFY(index.plugins().isEmpty());
+    }
+    {
+        const Okular::GeneratorIndex index(pluginFolder, indexFileName);
+        QVERIFY(index.isFromIndexFile());
+    }
+}
+
+void GeneratorIndexTest::testBrokenIndexFile()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString pluginFolder = dir.filePath(QStringLiteral("plugins"));
+    QVERIFY(QDir().mkpath(pluginFolder));
+    const QString indexFileName = dir.filePath(QStringLiteral("index.json"));
+    QFile file(indexFileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("{ \"version\": 1, \"folders\": [");
+    file.close();
+
+    const Okular::GeneratorIndex index(pluginFolder, indexFileName);
+    QVERIFY(!index.isFromIndexFile());
+
+    const Okular::GeneratorIndex again(pluginFolder, indexFileName);
+    QVERIFY(again.isFromIndexFile());
+}
+
+QTEST_MAIN(GeneratorIndexTest)
+#include "generatorindextest.moc"
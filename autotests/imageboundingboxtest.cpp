@@ -0,0 +1,72 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/utils.h"
+#include "../settings_core.h"
+
+#include <QImage>
+#include <QPainter>
+
+class ImageBoundingBoxTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void testBoundingBox();
+    void testBlank();
+    void testSampled();
+};
+
+void ImageBoundingBoxTest::initTestCase()
+{
+    Okular::SettingsCore::instance(QStringLiteral("imageboundingboxtest"));
+}
+
+static QImage page(const QRect &content)
+{
+    QImage image(400, 600, QImage::Format_ARGB32);
+    image.fill(Qt::white);
+    QPainter painter(&image);
+    painter.fillRect(content, Qt::black);
+    return image;
+}
+
+void ImageBoundingBoxTest::testBoundingBox()
+{
+    const QImage image = page(QRect(40, 60, 200, 300));
+    QCOMPARE(Okular::Utils::imageBoundingBox(&image), Okular::NormalizedRect(QRect(40, 60, 200, 300), 400, 600));
+
+    // other formats are read as they are
+    const QImage rgb888 = image.convertToFormat(QImage::Format_RGB888);
+    QCOMPARE(Okular::Utils::imageBoundingBox(&rgb888), Okular::NormalizedRect(QRect(40, 60, 200, 300), 400, 600));
+}
+
+void ImageBoundingBoxTest::testBlank()
+{
+    const QImage image = page(QRect());
+    QCOMPARE(Okular::Utils::imageBoundingBox(&image), Okular::NormalizedRect(0, 0, 0, 0));
+    QCOMPARE(Okular::Utils::imageBoundingBox(&image, 1000), Okular::NormalizedRect(0, 0, 0, 0));
+}
+
+void ImageBoundingBoxTest::testSampled()
+{
+    const QImage image = page(QRect(41, 63, 203, 305));
+    const QRect exact(41, 63, 203, 305);
+
+    // small enough, nothing is skipped
+    QCOMPARE(Okular::Utils::imageBoundingBox(&image, image.width() * image.height()), Okular::NormalizedRect(exact, 400, 600));
+
+    // the box covers the content, and no more than the skipped pixels around it
+    const QRect sampled = Okular::Utils::imageBoundingBox(&image, 10000).geometry(400, 600);
+    QVERIFY(sampled.contains(exact));
+    QVERIFY(exact.adjusted(-10, -10, 10, 10).contains(sampled));
+}
+
+QTEST_MAIN(ImageBoundingBoxTest)
+#include "imageboundingboxtest.moc"
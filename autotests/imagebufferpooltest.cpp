@@ -0,0 +1,156 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/generator.h"
+#include "../core/imagebufferpool_p.h"
+#include "../core/utils_p.h"
+
+#include <QPixmap>
+
+class ImageBufferPoolTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testBuckets();
+    void testRecycle();
+    void testMaximumIdleBytes();
+    void testTrim();
+    void testImagesOutliveThePool();
+    void testPixmapFromRender_data();
+    void testPixmapFromRender();
+};
+
+void ImageBufferPoolTest::testBuckets()
+{
+    const qulonglong smallest = Okular::ImageBufferPool::bucketBytes(1);
+    QCOMPARE(Okular::ImageBufferPool::bucketBytes(smallest), smallest);
+
+    // never smaller than asked, and at most an eighth bigger
+    for (qulonglong bytes : {smallest + 1, qulonglong(1000 * 1000), qulonglong(1920 * 1080 * 4), qulonglong(2481 * 3508 * 4)}) {
+        const qulonglong bucket = Okular::ImageBufferPool::bucketBytes(bytes);
+        QVERIFY(bucket >= bytes);
+        QVERIFY(bucket <= bytes + bytes / 8);
+        QCOMPARE(Okular::ImageBufferPool::bucketBytes(bucket), bucket);
+    }
+
+    // a few pixels more or less still fall in the same bucket
+    QCOMPARE(Okular::ImageBufferPool::bucketBytes(800 * 1131 * 4), Okular::ImageBufferPool::bucketBytes(800 * 1130 * 4));
+}
+
+void ImageBufferPoolTest::testRecycle()
+{
+    Okular::ImageBufferPool pool;
+    const uchar *bits = nullptr;
+    {
+        QImage image = pool.image(QSize(800, 1130));
+        QVERIFY(!image.isNull());
+        QCOMPARE(image.size(), QSize(800, 1130));
+        QCOMPARE(image.format(), QImage::Format_ARGB32_Premultiplied);
+        image.fill(Qt::white);
+        bits = image.constBits();
+
+        // copies share the buffer, it comes back once they are all gone
+        const QImage copy = image;
+        image = QImage();
+        QCOMPARE(pool.idleCount(), 0);
+    }
+    QCOMPARE(pool.idleCount(), 1);
+    QCOMPARE(pool.idleBytes(), Okular::ImageBufferPool::bucketBytes(800 * 1130 * 4));
+
+    // about the same size gets the same buffer
+    const QImage image = pool.image(QSize(800, 1131));
+    QCOMPARE(image.constBits(), bits);
+    QCOMPARE(pool.idleCount(), 0);
+
+    // another size does not
+    const QImage other = pool.image(QSize(400, 565));
+    QVERIFY(other.constBits() != bits);
+}
+
+void ImageBufferPoolTest::testMaximumIdleBytes()
+{
+    Okular::ImageBufferPool pool;
+    const qulonglong bucket = Okular::ImageBufferPool::bucketBytes(500 * 500 * 4);
+    pool.setMaximumIdleBytes(bucket * 2);
+
+    QVector<QImage> images;
+    for (int i = 0; i < 3; ++i)
+        images << pool.image(QSize(500, 500));
+    images.clear();
+    QCOMPARE(pool.idleCount(), 2);
+    QCOMPARE(pool.idleBytes(), bucket * 2);
+
+    pool.setMaximumIdleBytes(bucket);
+    QCOMPARE(pool.idleCount(), 1);
+}
+
+void ImageBufferPoolTest::testTrim()
+{
+    Okular::ImageBufferPool pool;
+    {
+        const QImage small = pool.image(QSize(300, 300));
+        const QImage big = pool.image(QSize(1000, 1000));
+    }
+    QCOMPARE(pool.idleCount(), 2);
+
+    // the biggest goes first
+    QCOMPARE(pool.trim(1), Okular::ImageBufferPool::bucketBytes(1000 * 1000 * 4));
+    QCOMPARE(pool.idleBytes(), Okular::ImageBufferPool::bucketBytes(300 * 300 * 4));
+
+    pool.clear();
+    QCOMPARE(pool.idleCount(), 0);
+    QCOMPARE(pool.idleBytes(), qulonglong(0));
+    QCOMPARE(pool.trim(1), qulonglong(0));
+}
+
+void ImageBufferPoolTest::testImagesOutliveThePool()
+{
+    QImage image;
+    {
+        Okular::ImageBufferPool pool;
+        image = pool.image(QSize(640, 480));
+    }
+    // still usable, and freed without a pool to go back to
+    image.fill(Qt::black);
+    QCOMPARE(image.pixel(10, 10), qRgb(0, 0, 0));
+    image = QImage();
+}
+
+void ImageBufferPoolTest::testPixmapFromRender_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("adoptedFormat");
+
+    QTest::newRow("native") << int(Okular::PixmapRequest::imageFormat()) << int(Okular::PixmapRequest::imageFormat());
+    QTest::newRow("rgb32") << int(QImage::Format_RGB32) << int(QImage::Format_RGB32);
+    QTest::newRow("argb32") << int(QImage::Format_ARGB32) << int(Okular::PixmapRequest::imageFormat());
+    QTest::newRow("rgb888") << int(QImage::Format_RGB888) << int(Okular::PixmapRequest::imageFormat());
+}
+
+void ImageBufferPoolTest::testPixmapFromRender()
+{
+    QFETCH(int, format);
+    QFETCH(int, adoptedFormat);
+
+    QImage image(120, 80, QImage::Format(format));
+    image.fill(Qt::white);
+    const uchar *bits = image.constBits();
+
+    QPixmap *pixmap = Okular::pixmapFromRender(&image);
+    QCOMPARE(pixmap->size(), QSize(120, 80));
+    QCOMPARE(int(image.format()), adoptedFormat);
+    // the formats that are adopted keep their buffer
+    if (format == adoptedFormat)
+        QCOMPARE(image.constBits(), bits);
+    QCOMPARE(pixmap->toImage().pixel(60, 40), qRgb(255, 255, 255));
+    delete pixmap;
+}
+
+QTEST_MAIN(ImageBufferPoolTest)
+#include "imagebufferpooltest.moc"
@@ -0,0 +1,245 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/annotations.h"
+#include "../core/area.h"
+#include "../core/objectrectgrid_p.h"
+#include "../core/page.h"
+
+#include <QRandomGenerator>
+
+#include <limits>
+
+static const double pageWidth = 600;
+static const double pageHeight = 800;
+// see Page::objectRect()
+static const double distanceConsideredEqual = 25;
+
+class ObjectRectGridTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testMatchesList();
+    void testSetObjectRectsAgain();
+    void testAnnotationsMatchList();
+    void testAnnotationsChangedInPlace();
+    void testEmpty();
+
+private:
+    static QLinkedList<Okular::ObjectRect *> randomRects(QRandomGenerator &random, int count, Okular::ObjectRect::ObjectType type);
+};
+
+QLinkedList<Okular::ObjectRect *> ObjectRectGridTest::randomRects(QRandomGenerator &random, int count, Okular::ObjectRect::ObjectType type)
+{
+    QLinkedList<Okular::ObjectRect *> rects;
+    for (int i = 0; i < count; ++i) {
+        // mostly small, like links to pages in an index, a few big ones and some overlapping the border
+        const double left = random.bounded(1.1) - 0.05;
+        const double top = random.bounded(1.1) - 0.05;
+        const double size = i % 50 == 0 ? random.bounded(0.5) : random.bounded(0.03);
+        rects.append(new Okular::ObjectRect(left, top, left + size, top + size / 3, false, type, nullptr));
+    }
+    return rects;
+}
+
+void ObjectRectGridTest::testMatchesList()
+{
+    QRandomGenerator random(42);
+    Okular::Page page(0, pageWidth, pageHeight, Okular::Rotation0);
+    QLinkedList<Okular::ObjectRect *> rects = randomRects(random, 3000, Okular::ObjectRect::Action);
+    rects += randomRects(random, 20, Okular::ObjectRect::Image);
+    page.setObjectRects(rects);
+
+    for (int i = 0; i < 500; ++i) {
+        const double x = random.bounded(1.2) - 0.1;
+        const double y = random.bounded(1.2) - 0.1;
+
+        for (const Okular::ObjectRect::ObjectType type : {Okular::ObjectRect::Action, Okular::ObjectRect::Image}) {
+            // what going through the list gives
+            const Okular::ObjectRect *last = nullptr;
+            QLinkedList<const Okular::ObjectRect *> all;
+            const Okular::ObjectRect *nearest = nullptr;
+            double minDistance = std::numeric_limits<double>::max();
+            for (const Okular::ObjectRect *rect : qAsConst(rects)) {
+                if (rect->objectType() != type)
+                    continue;
+                const double d = rect->distanceSqr(x, y, pageWidth, pageHeight);
+                if (d < distanceConsideredEqual) {
+                    last = rect;
+                    all.prepend(rect);
+                }
+                if (d < minDistance) {
+                    nearest = rect;
+                    minDistance = d;
+                }
+            }
+
+            QCOMPARE(page.objectRect(type, x, y, pageWidth, pageHeight), last);
+            QCOMPARE(page.objectRects(type, x, y, pageWidth, pageHeight), all);
+            double distance;
+            QCOMPARE(page.nearestObjectRect(type, x, y, pageWidth, pageHeight, &distance), nearest);
+            QCOMPARE(distance, minDistance);
+        }
+    }
+}
+
+void ObjectRectGridTest::testSetObjectRectsAgain()
+{
+    Okular::Page page(0, pageWidth, pageHeight, Okular::Rotation0);
+    page.setObjectRects({new Okular::ObjectRect(0.1, 0.1, 0.2, 0.2, false, Okular::ObjectRect::Action, nullptr)});
+    QVERIFY(page.objectRect(Okular::ObjectRect::Action, 0.15, 0.15, pageWidth, pageHeight));
+
+    // the old rects are gone from the grid too
+    Okular::ObjectRect *rect = new Okular::ObjectRect(0.5, 0.5, 0.6, 0.6, false, Okular::ObjectRect::Action, nullptr);
+    page.setObjectRects({rect});
+    QVERIFY(!page.objectRect(Okular::ObjectRect::Action, 0.15, 0.15, pageWidth, pageHeight));
+    QCOMPARE(page.objectRect(Okular::ObjectRect::Action, 0.55, 0.55, pageWidth, pageHeight), rect);
+
+    page.deleteRects();
+    QVERIFY(!page.objectRect(Okular::ObjectRect::Action, 0.55, 0.55, pageWidth, pageHeight));
+}
+
+void ObjectRectGridTest::testAnnotationsMatchList()
+{
+    QRandomGenerator random(7);
+    Okular::Page page(0, pageWidth, pageHeight, Okular::Rotation0);
+    for (int i = 0; i < 1000; ++i) {
+        const double left = random.bounded(1.0);
+        const double top = random.bounded(1.0);
+        const double size = random.bounded(0.05);
+
+        // strokes are hit around their points, as far as the pen goes
+        Okular::Annotation *annotation;
+        if (i % 2) {
+            Okular::InkAnnotation *ink = new Okular::InkAnnotation;
+            ink->setInkPaths({{Okular::NormalizedPoint(left, top), Okular::NormalizedPoint(left + size, top + size)}});
+            annotation = ink;
+        } else {
+            annotation = new Okular::GeomAnnotation;
+        }
+        annotation->setBoundingRectangle(Okular::NormalizedRect(left, top, left + size, top + size));
+        annotation->style().setWidth(1 + random.bounded(20.0));
+        page.addAnnotation(annotation);
+
+        // the grid takes the next ones in place
+        if (i == 500)
+            QVERIFY(!page.objectRect(Okular::ObjectRect::OAnnotation, -1, -1, pageWidth, pageHeight));
+    }
+
+    for (int i = 0; i < 500; ++i) {
+        const double x = random.bounded(1.2) - 0.1;
+        const double y = random.bounded(1.2) - 0.1;
+
+        const Okular::Annotation *last = nullptr;
+        const Okular::Annotation *nearest = nullptr;
+        double minDistance = std::numeric_limits<double>::max();
+        for (Okular::Annotation *annotation : page.annotations()) {
+            const double d = Okular::AnnotationObjectRect(annotation).distanceSqr(x, y, pageWidth, pageHeight);
+            if (d < distanceConsideredEqual)
+                last = annotation;
+            if (d < minDistance) {
+                nearest = annotation;
+                minDistance = d;
+            }
+        }
+
+        const Okular::ObjectRect *rect = page.objectRect(Okular::ObjectRect::OAnnotation, x, y, pageWidth, pageHeight);
+        QCOMPARE(rect ? static_cast<const Okular::AnnotationObjectRect *>(rect)->annotation() : nullptr, last);
+        double distance;
+        rect = page.nearestObjectRect(Okular::ObjectRect::OAnnotation, x, y, pageWidth, pageHeight, &distance);
+        QCOMPARE(rect ? static_cast<const Okular::AnnotationObjectRect *>(rect)->annotation() : nullptr, nearest);
+        QCOMPARE(distance, minDistance);
+    }
+}
+
+void ObjectRectGridTest::testAnnotationsChangedInPlace()
+{
+    QRandomGenerator random(11);
+    const QSizeF pageSize(pageWidth, pageHeight);
+    QLinkedList<Okular::Annotation *> annotations;
+    QLinkedList<Okular::ObjectRect *> rects;
+    const auto addAnnotation = [&] {
+        const double left = random.bounded(1.0);
+        const double top = random.bounded(1.0);
+        const double size = random.bounded(0.05);
+        Okular::Annotation *annotation = new Okular::GeomAnnotation;
+        annotation->setBoundingRectangle(Okular::NormalizedRect(left, top, left + size, top + size));
+        annotation->style().setWidth(1 + random.bounded(20.0));
+        annotations.append(annotation);
+        rects.append(new Okular::AnnotationObjectRect(annotation));
+        return rects.last();
+    };
+
+    for (int i = 0; i < 200; ++i)
+        addAnnotation();
+    Okular::ObjectRectGrid grid;
+    grid.build(rects, Okular::ObjectRect::OAnnotation, pageSize);
+
+    // enough new ones for the cells to be laid out again
+    for (int i = 0; i < 1000; ++i)
+        grid.add(addAnnotation(), pageSize);
+
+    // every 7th goes away, every 5th moves
+    int n = 0;
+    for (auto it = rects.begin(); it != rects.end(); ++n) {
+        Okular::AnnotationObjectRect *rect = static_cast<Okular::AnnotationObjectRect *>(*it);
+        if (n % 7 == 0) {
+            grid.remove(rect);
+            annotations.removeOne(rect->annotation());
+            delete rect->annotation();
+            delete rect;
+            it = rects.erase(it);
+            continue;
+        }
+        if (n % 5 == 0) {
+            rect->annotation()->translate(Okular::NormalizedPoint(random.bounded(0.4) - 0.2, random.bounded(0.4) - 0.2));
+            grid.update(rect, pageSize);
+        }
+        ++it;
+    }
+
+    for (int i = 0; i < 500; ++i) {
+        const double x = random.bounded(1.2) - 0.1;
+        const double y = random.bounded(1.2) - 0.1;
+
+        const Okular::ObjectRect *last = nullptr;
+        const Okular::ObjectRect *nearest = nullptr;
+        double minDistance = std::numeric_limits<double>::max();
+        for (const Okular::ObjectRect *rect : qAsConst(rects)) {
+            const double d = rect->distanceSqr(x, y, pageWidth, pageHeight);
+            if (d < distanceConsideredEqual)
+                last = rect;
+            if (d < minDistance) {
+                nearest = rect;
+                minDistance = d;
+            }
+        }
+
+        QCOMPARE(grid.last(x, y, pageWidth, pageHeight, distanceConsideredEqual), last);
+        double distance;
+        QCOMPARE(grid.nearest(x, y, pageWidth, pageHeight, &distance), nearest);
+        QCOMPARE(distance, minDistance);
+    }
+
+    qDeleteAll(rects);
+    qDeleteAll(annotations);
+}
+
+void ObjectRectGridTest::testEmpty()
+{
+    Okular::Page page(0, pageWidth, pageHeight, Okular::Rotation0);
+    QVERIFY(!page.objectRect(Okular::ObjectRect::Image, 0.5, 0.5, pageWidth, pageHeight));
+    QVERIFY(page.objectRects(Okular::ObjectRect::Image, 0.5, 0.5, pageWidth, pageHeight).isEmpty());
+    double distance = 0;
+    QVERIFY(!page.nearestObjectRect(Okular::ObjectRect::Image, 0.5, 0.5, pageWidth, pageHeight, &distance));
+    QCOMPARE(distance, std::numeric_limits<double>::max());
+}
+
+QTEST_MAIN(ObjectRectGridTest)
+#include "objectrectgridtest.moc"
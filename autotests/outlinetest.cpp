@@ -0,0 +1,116 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/document.h"
+#include "../core/outline.h"
+
+class OutlineTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testLinks();
+    void testFromSynopsis();
+    void testStaleItems();
+};
+
+void OutlineTest::testLinks()
+{
+    Okular::Outline outline;
+    QVERIFY(outline.isEmpty());
+    QCOMPARE(outline.firstChild(-1), -1);
+
+    const int first = outline.appendItem(-1, QStringLiteral("First"));
+    const int child = outline.appendItem(first, QStringLiteral("Child"));
+    const int second = outline.appendItem(-1, QStringLiteral("Second"));
+    const int otherChild = outline.appendItem(first, QStringLiteral("Other child"));
+
+    QCOMPARE(outline.count(), 4);
+    QCOMPARE(outline.childCount(-1), 2);
+    QCOMPARE(outline.firstChild(-1), first);
+    QCOMPARE(outline.nextSibling(first), second);
+    QCOMPARE(outline.nextSibling(second), -1);
+    QCOMPARE(outline.childCount(first), 2);
+    QCOMPARE(outline.firstChild(first), child);
+    QCOMPARE(outline.nextSibling(child), otherChild);
+    QCOMPARE(outline.parent(otherChild), first);
+    QCOMPARE(outline.parent(second), -1);
+    QCOMPARE(outline.childCount(second), 0);
+    QCOMPARE(outline.title(otherChild), QStringLiteral("Other child"));
+
+    outline.clear();
+    QVERIFY(outline.isEmpty());
+    QCOMPARE(outline.childCount(-1), 0);
+}
+
+void OutlineTest::testFromSynopsis()
+{
+    Okular::DocumentSynopsis synopsis;
+    QDomElement chapter = synopsis.createElement(QStringLiteral("Chapter"));
+    chapter.setAttribute(QStringLiteral("Viewport"), Okular::DocumentViewport(4).toString());
+    chapter.setAttribute(QStringLiteral("Open"), QStringLiteral("true"));
+    synopsis.appendChild(chapter);
+    QDomElement section = synopsis.createElement(QStringLiteral("Section"));
+    section.setAttribute(QStringLiteral("ViewportName"), QStringLiteral("sec.1"));
+    section.setAttribute(QStringLiteral("ExternalFileName"), QStringLiteral("other.pdf"));
+    chapter.appendChild(section);
+    QDomElement link = synopsis.createElement(QStringLiteral("Link"));
+    link.setAttribute(QStringLiteral("URL"), QStringLiteral("https://okular.kde.org"));
+    link.setAttribute(QStringLiteral("ExternalFileName"), QStringLiteral("other.pdf"));
+    synopsis.appendChild(link);
+
+    const Okular::Outline outline(synopsis);
+    QCOMPARE(outline.count(), 3);
+
+    const int c = outline.firstChild(-1);
+    QCOMPARE(outline.title(c), QStringLiteral("Chapter"));
+    QCOMPARE(outline.viewport(c).pageNumber, 4);
+    QVERIFY(outline.viewportName(c).isEmpty());
+    QVERIFY(outline.isOpen(c));
+
+    const int s = outline.firstChild(c);
+    QCOMPARE(outline.title(s), QStringLiteral("Section"));
+    QVERIFY(!outline.viewport(s).isValid());
+    QCOMPARE(outline.viewportName(s), QStringLiteral("sec.1"));
+    QCOMPARE(outline.externalFileName(s), QStringLiteral("other.pdf"));
+    QVERIFY(!outline.isOpen(s));
+
+    const int l = outline.nextSibling(c);
+    QCOMPARE(outline.title(l), QStringLiteral("Link"));
+    QCOMPARE(outline.url(l), QStringLiteral("https://okular.kde.org"));
+    QCOMPARE(outline.externalFileName(l), QStringLiteral("other.pdf"));
+    QCOMPARE(outline.nextSibling(l), -1);
+}
+
+void OutlineTest::testStaleItems()
+{
+    Okular::Outline outline;
+    outline.appendItem(-1, QStringLiteral("Only"));
+
+    // numbers of items that are not there, e.g. kept from before a reload
+    for (int item : {-2, 1, 100}) {
+        QCOMPARE(outline.firstChild(item), -1);
+        QCOMPARE(outline.nextSibling(item), -1);
+        QCOMPARE(outline.childCount(item), 0);
+        QVERIFY(outline.title(item).isEmpty());
+        QVERIFY(!outline.viewport(item).isValid());
+        QVERIFY(!outline.isOpen(item));
+    }
+
+    // and setting them does nothing
+    outline.setUrl(100, QStringLiteral("https://okular.kde.org"));
+    QCOMPARE(outline.count(), 1);
+
+    // a missing parent makes a top level item
+    const int orphan = outline.appendItem(7, QStringLiteral("Orphan"));
+    QCOMPARE(outline.parent(orphan), -1);
+    QCOMPARE(outline.childCount(-1), 2);
+}
+
+QTEST_MAIN(OutlineTest)
+#include "outlinetest.moc"
@@ -0,0 +1,159 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/generator.h"
+#include "../core/observer.h"
+#include "../core/pixmaprequestqueue_p.h"
+
+class PixmapRequestQueueTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testOrder();
+    void testInvalidateObserver();
+    void testInvalidatePage();
+    void testCompact();
+    void testRemoveSearchPreloads();
+};
+
+static Okular::PixmapRequest *newRequest(Okular::DocumentObserver *observer, int page, int priority)
+{
+    return new Okular::PixmapRequest(observer, page, 100, 100, 1, priority, Okular::PixmapRequest::Asynchronous);
+}
+
+void PixmapRequestQueueTest::testOrder()
+{
+    Okular::DocumentObserver observer;
+    Okular::PixmapRequestQueue queue;
+    queue.push(newRequest(&observer, 1, 2));
+    queue.push(newRequest(&observer, 2, 1));
+    queue.push(newRequest(&observer, 3, 2));
+    queue.push(newRequest(&observer, 4, 0));
+    queue.push(newRequest(&observer, 5, 0));
+
+    // lowest priority value first, newest first for priority zero, oldest first otherwise
+    const QList<int> expectedPages = {5, 4, 2, 1, 3};
+    for (int page : expectedPages) {
+        Okular::PixmapRequest *r = queue.top();
+        QVERIFY(r);
+        QCOMPARE(r->pageNumber(), page);
+        queue.pop();
+        delete r;
+    }
+    QVERIFY(!queue.top());
+    QVERIFY(queue.isEmpty());
+}
+
+void PixmapRequestQueueTest::testInvalidateObserver()
+{
+    Okular::DocumentObserver view, thumbnails;
+    Okular::PixmapRequestQueue queue;
+    queue.push(newRequest(&view, 1, 1));
+    queue.push(newRequest(&thumbnails, 2, 2));
+    queue.push(newRequest(&view, 3, 3));
+
+    queue.invalidate(&view);
+    Okular::PixmapRequest *newer = newRequest(&view, 4, 4);
+    queue.push(newer);
+
+    Okular::PixmapRequest *r = queue.top();
+    QCOMPARE(r->observer(), &thumbnails);
+    queue.pop();
+    delete r;
+    QVector<Okular::PixmapRequest *> stale = queue.takeStale();
+    QCOMPARE(stale.count(), 1);
+    QCOMPARE(stale.first()->pageNumber(), 1);
+    qDeleteAll(stale);
+
+    r = queue.top();
+    QCOMPARE(r, newer);
+    queue.pop();
+    delete r;
+
+    stale = queue.takeStale();
+    QCOMPARE(stale.count(), 1);
+    QCOMPARE(stale.first()->pageNumber(), 3);
+    qDeleteAll(stale);
+    QVERIFY(queue.isEmpty());
+}
+
+void PixmapRequestQueueTest::testInvalidatePage()
+{
+    Okular::DocumentObserver view, thumbnails;
+    Okular::PixmapRequestQueue queue;
+    queue.push(newRequest(&view, 1, 1));
+    queue.push(newRequest(&thumbnails, 1, 2));
+    queue.push(newRequest(&view, 2, 3));
+
+    queue.invalidate(&view, 1);
+    queue.push(newRequest(&view, 1, 4));
+
+    QList<int> priorities;
+    while (Okular::PixmapRequest *r = queue.top()) {
+        priorities << r->priority();
+        queue.pop();
+        delete r;
+    }
+    QCOMPARE(priorities, QList<int>({2, 3, 4}));
+
+    const QVector<Okular::PixmapRequest *> stale = queue.takeStale();
+    QCOMPARE(stale.count(), 1);
+    QCOMPARE(stale.first()->priority(), 1);
+    qDeleteAll(stale);
+}
+
+void PixmapRequestQueueTest::testCompact()
+{
+    Okular::DocumentObserver view, thumbnails;
+    Okular::PixmapRequestQueue queue;
+    for (int i = 0; i < 10; ++i)
+        queue.push(newRequest(&view, i, i + 1));
+    queue.push(newRequest(&thumbnails, 0, 20));
+    queue.invalidate(&view);
+
+    QCOMPARE(queue.count(), 11);
+    queue.compact();
+    QCOMPARE(queue.count(), 1);
+    QCOMPARE(queue.top()->observer(), &thumbnails);
+
+    QVector<Okular::PixmapRequest *> all = queue.takeAll();
+    QCOMPARE(all.count(), 11);
+    QVERIFY(queue.isEmpty());
+    qDeleteAll(all);
+}
+
+void PixmapRequestQueueTest::testRemoveSearchPreloads()
+{
+    Okular::DocumentObserver view, thumbnails;
+    Okular::PixmapRequestQueue queue;
+    const Okular::PixmapRequest::PixmapRequestFeatures searchPreload = Okular::PixmapRequest::Asynchronous | Okular::PixmapRequest::Preload | Okular::PixmapRequest::SearchPreload;
+    queue.push(new Okular::PixmapRequest(&view, 1, 100, 100, 1, 4, searchPreload));
+    queue.push(new Okular::PixmapRequest(&thumbnails, 1, 100, 100, 1, 5, searchPreload));
+    queue.push(new Okular::PixmapRequest(&view, 2, 100, 100, 1, 6, searchPreload));
+    queue.push(new Okular::PixmapRequest(&view, 1, 100, 100, 1, 7, Okular::PixmapRequest::Asynchronous | Okular::PixmapRequest::Preload));
+    queue.push(newRequest(&view, 1, 1));
+
+    // only the search preloads of the pages go, of any observer
+    queue.removeSearchPreloads({1});
+    const QVector<Okular::PixmapRequest *> stale = queue.takeStale();
+    QCOMPARE(stale.count(), 2);
+    qDeleteAll(stale);
+
+    QList<int> priorities;
+    while (Okular::PixmapRequest *r = queue.top()) {
+        priorities << r->priority();
+        queue.pop();
+        delete r;
+    }
+    QCOMPARE(priorities, QList<int>({1, 6, 7}));
+    QVERIFY(queue.takeStale().isEmpty());
+}
+
+QTEST_GUILESS_MAIN(PixmapRequestQueueTest)
+#include "pixmaprequestqueuetest.moc"
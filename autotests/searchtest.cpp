@@ -10,6 +10,8 @@
 #include <QSignalSpy>
 #include <QTest>
 
+#include <algorithm>
+
 #include "../core/document.h"
 #include "../core/page.h"
 #include "../core/textpage.h"
@@ -41,10 +43,15 @@ private slots:
     void initTestCase();
     void testNextAndPrevious();
     void test311232();
+    void testTypingNarrowsWholeDocumentSearch();
     void test323262();
     void test323263();
     void test430243();
     void testDottedI();
+    void testCaseInsensitiveAcrossEntities();
+    void testCaseInsensitiveOutOfBmp();
+    void testBulkAppend();
+    void testNormalizedAppend();
     void testHyphenAtEndOfLineWithoutYOverlap();
     void testHyphenWithYOverlap();
     void testHyphenAtEndOfPage();
@@ -183,6 +190,52 @@ void SearchTest::test311232()
     QCOMPARE(receiver.m_status, Okular::Document::NoMatchFound);
 }
 
+void SearchTest::testTypingNarrowsWholeDocumentSearch()
+{
+    Okular::Document d(nullptr);
+    QSignalSpy finishedSpy(&d, &Okular::Document::searchFinished);
+    QSignalSpy matchesSpy(&d, &Okular::Document::searchMatchesFound);
+
+    const QString testFile = QStringLiteral(KDESRCDIR "data/simple-multipage.pdf");
+    QMimeDatabase db;
+    const QMimeType mime = db.mimeTypeForFile(testFile);
+    QCOMPARE(d.openDocument(testFile, QUrl(), mime), Okular::Document::OpenSuccess);
+
+    const int searchId = 0;
+    const auto matchedPages = [&](const QString &text) {
+        finishedSpy.clear();
+        matchesSpy.clear();
+        d.searchText(searchId, text, true, Qt::CaseSensitive, Okular::Document::AllDocument, false, QColor(Qt::yellow));
+        if (finishedSpy.isEmpty())
+            finishedSpy.wait();
+        QList<int> pages;
+        for (const QList<QVariant> &arguments : qAsConst(matchesSpy))
+            pages.append(arguments.at(1).toInt());
+        std::sort(pages.begin(), pages.end());
+        return pages;
+    };
+
+    // "Page 1" is on the first page and the ones from the tenth to the nineteenth
+    const QList<int> firstMatches = matchedPages(QStringLiteral("Page 1"));
+    QCOMPARE(firstMatches, QList<int>({0, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18}));
+    // typing more only looks at those: the pages searched get their text page again
+    for (int i = 0; i < d.pages(); ++i)
+        const_cast<Okular::Page *>(d.page(i))->setTextPage(nullptr);
+    QCOMPARE(matchedPages(QStringLiteral("Page 12")), QList<int>({11}));
+    int searchedPages = 0;
+    for (int i = 0; i < d.pages(); ++i) {
+        if (d.page(i)->hasTextPage()) {
+            QVERIFY(firstMatches.contains(i));
+            ++searchedPages;
+        }
+    }
+    QVERIFY(searchedPages > 0);
+    QVERIFY(searchedPages < d.pages());
+    // something else looks at all the pages again
+    QCOMPARE(matchedPages(QStringLiteral("Page 2")), QList<int>({1, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28}));
+    QCOMPARE(matchedPages(QStringLiteral("Page 4")), QList<int>({3, 39}));
+}
+
 void SearchTest::test323262()
 {
     QVector<QString> text;
@@ -270,6 +323,128 @@ void SearchTest::testDottedI()
     delete page;
 }
 
+void SearchTest::testCaseInsensitiveAcrossEntities()
+{
+    // the whole page is searched as a single string when there are no hyphens
+    QVector<QString> text;
+    text << QStringLiteral("HeL") << QStringLiteral("lo") << QStringLiteral(" ") << QStringLiteral("WORLD") << QStringLiteral(" ") << QStringLiteral("hello");
+
+    QVector<Okular::NormalizedRect> rect;
+    for (int i = 0; i < text.size(); i++) {
+        rect << Okular::NormalizedRect(0.1 * i, 0.0, 0.1 * (i + 1), 0.1);
+    }
+
+    CREATE_PAGE;
+
+    // "HeLlo" and "hello"
+    Okular::RegularAreaRect *result = tp->findText(0, QStringLiteral("hello"), Okular::FromTop, Qt::CaseInsensitive, nullptr);
+    QVERIFY(result);
+    QVERIFY(result->first().left < 0.05);
+    result = tp->findText(0, QStringLiteral("hello"), Okular::NextResult, Qt::CaseInsensitive, result);
+    QVERIFY(result);
+    QVERIFY(result->first().left > 0.45);
+    delete result;
+    QVERIFY(!tp->findText(0, QStringLiteral("hello"), Okular::NextResult, Qt::CaseInsensitive, nullptr));
+
+    // from the middle of "lo" to the middle of "WORLD"
+    result = tp->findText(0, QStringLiteral("O w"), Okular::FromBottom, Qt::CaseInsensitive, nullptr);
+    QVERIFY(result);
+    delete result;
+    QVERIFY(!tp->findText(0, QStringLiteral("O w"), Okular::FromTop, Qt::CaseSensitive, nullptr));
+
+    delete page;
+}
+
+void SearchTest::testCaseInsensitiveOutOfBmp()
+{
+    // DESERET CAPITAL LETTER LONG I and its small letter, two UTF-16 units each
+    const QString capital = QString::fromUcs4(U"\U00010400");
+    const QString small = QString::fromUcs4(U"\U00010428");
+    QVector<QString> text;
+    text << QStringLiteral("a") << capital << QStringLiteral("b") << QStringLiteral(" ") << small;
+
+    QVector<Okular::NormalizedRect> rect;
+    for (int i = 0; i < text.size(); i++) {
+        rect << Okular::NormalizedRect(0.1 * i, 0.0, 0.1 * (i + 1), 0.1);
+    }
+
+    CREATE_PAGE;
+
+    Okular::RegularAreaRect *result = tp->findText(0, QLatin1Char('a') + small + QLatin1Char('b'), Okular::FromTop, Qt::CaseInsensitive, nullptr);
+    QVERIFY(result);
+    delete result;
+    QVERIFY(!tp->findText(0, QLatin1Char('a') + small + QLatin1Char('b'), Okular::FromTop, Qt::CaseSensitive, nullptr));
+
+    // the last entity
+    result = tp->findText(0, capital, Okular::FromBottom, Qt::CaseInsensitive, nullptr);
+    QVERIFY(result);
+    QVERIFY(result->first().left > 0.35);
+    delete result;
+
+    delete page;
+}
+
+void SearchTest::testBulkAppend()
+{
+    // plain text, a ligature normalized to two letters, a combining ring
+    // joined to the letter before it, and an empty entity that is skipped
+    QVector<QString> text;
+    text << QStringLiteral("Hello") << QStringLiteral(" ") << QStringLiteral("\uFB01ne") << QStringLiteral(" ") << QStringLiteral("A") << QStringLiteral("\u030A") << QString() << QStringLiteral("ngstr\u00F6m");
+
+    QVector<Okular::NormalizedRect> rect;
+    QVector<int> lengths;
+    QString chars;
+    for (int i = 0; i < text.size(); i++) {
+        rect << Okular::NormalizedRect(0.1 * i, 0.0, 0.1 * (i + 1), 0.1);
+        lengths << text[i].length();
+        chars += text[i];
+    }
+
+    CREATE_PAGE;
+
+    // the same text in one call, and after words that are there already
+    Okular::TextPage *bulk = new Okular::TextPage;
+    bulk->append(chars, lengths, rect);
+    Okular::Page *bulkPage = new Okular::Page(1, 100, 100, Okular::Rotation0);
+    bulkPage->setTextPage(bulk);
+    QCOMPARE(bulk->text(), tp->text());
+
+    Okular::TextPage *mixed = new Okular::TextPage;
+    mixed->append(text[0], new Okular::NormalizedRect(rect[0]));
+    mixed->append(chars.mid(text[0].length()), lengths.mid(1), rect.mid(1));
+    Okular::Page *mixedPage = new Okular::Page(1, 100, 100, Okular::Rotation0);
+    mixedPage->setTextPage(mixed);
+    QCOMPARE(mixed->text(), tp->text());
+
+    Okular::RegularAreaRect *result = bulk->findText(0, QStringLiteral("\u00C5ngstr\u00F6m"), Okular::FromTop, Qt::CaseSensitive, nullptr);
+    QVERIFY(result);
+    delete result;
+
+    delete mixedPage;
+    delete bulkPage;
+    delete page;
+}
+
+void SearchTest::testNormalizedAppend()
+{
+    // Latin-1 letters are kept, a compatibility character of Latin-1 is
+    // normalized, and a combining acute joins the letter before it
+    QVector<QString> text;
+    text << QStringLiteral("caf\u00E9") << QStringLiteral(" ") << QStringLiteral("\u00BD") << QStringLiteral(" ") << QStringLiteral("e") << QStringLiteral("\u0301");
+
+    QVector<Okular::NormalizedRect> rect;
+    for (int i = 0; i < text.size(); i++)
+        rect << Okular::NormalizedRect(0.1 * i, 0.0, 0.1 * (i + 1), 0.1);
+
+    CREATE_PAGE;
+
+    Okular::RegularAreaRect *result = tp->findText(0, QStringLiteral("caf\u00E9 1\u20442 \u00E9"), Okular::FromTop, Qt::CaseSensitive, nullptr);
+    QVERIFY(result);
+    delete result;
+
+    delete page;
+}
+
 void SearchTest::testHyphenAtEndOfLineWithoutYOverlap()
 {
     QVector<QString> text;
@@ -0,0 +1,209 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/action.h"
+#include "../core/area.h"
+#include "../core/page.h"
+#include "../core/textpage.h"
+#include "../core/textpagediskcache_p.h"
+
+#include <QTemporaryDir>
+
+class TextPageDiskCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testStoreLoad();
+    void testOtherDocument();
+    void testOrientation();
+    void testRemove();
+    void testUrls();
+};
+
+// the text page stays owned by the page
+static Okular::Page *createPage(int number, Okular::TextPage **textPage, Okular::Rotation rotation = Okular::Rotation0)
+{
+    Okular::TextPage *tp = new Okular::TextPage();
+    tp->append(QStringLiteral("Hi"), new Okular::NormalizedRect(0.1, 0.1, 0.2, 0.2));
+    tp->append(QStringLiteral(" "), new Okular::NormalizedRect(0.2, 0.1, 0.25, 0.2));
+    tp->append(QStringLiteral("everybody"), new Okular::NormalizedRect(0.25, 0.1, 0.6, 0.2));
+
+    Okular::Page *page = new Okular::Page(number, 100, 100, rotation);
+    page->setTextPage(tp);
+    *textPage = tp;
+    return page;
+}
+
+void TextPageDiskCacheTest::testStoreLoad()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath(QStringLiteral("test.textpages"));
+    const QDateTime modified = QDateTime::fromSecsSinceEpoch(1600000000);
+    Okular::TextPage *textPage;
+    QScopedPointer<Okular::Page> page(createPage(1, &textPage));
+
+    {
+        Okular::TextPageDiskCache cache;
+        cache.setDocument(fileName, QStringLiteral("okular_poppler"), modified, 3);
+        QVERIFY(cache.isActive());
+        QVERIFY(!cache.load(page.data()));
+        cache.store(page.data(), textPage);
+    }
+
+    Okular::TextPageDiskCache cache;
+    cache.setDocument(fileName, QStringLiteral("okular_poppler"), modified, 3);
+    QScopedPointer<Okular::Page> otherPage(new Okular::Page(0, 100, 100, Okular::Rotation0));
+    QVERIFY(!cache.load(otherPage.data()));
+
+    QScopedPointer<Okular::Page> loadedPage(new Okular::Page(1, 100, 100, Okular::Rotation0));
+    Okular::TextPage *loaded = cache.load(loadedPage.data());
+    QVERIFY(loaded);
+    loadedPage->setTextPage(loaded);
+    QCOMPARE(loadedPage->text(), page->text());
+
+    const Okular::TextEntity::List words = loadedPage->words(nullptr, Okular::TextPage::AnyPixelTextAreaInclusionBehaviour);
+    const Okular::TextEntity::List expectedWords = page->words(nullptr, Okular::TextPage::AnyPixelTextAreaInclusionBehaviour);
+    QCOMPARE(words.count(), expectedWords.count());
+    for (int i = 0; i < words.count(); ++i) {
+        QCOMPARE(words.at(i)->text(), expectedWords.at(i)->text());
+        QCOMPARE(*words.at(i)->area(), *expectedWords.at(i)->area());
+    }
+    qDeleteAll(words);
+    qDeleteAll(expectedWords);
+}
+
+void TextPageDiskCacheTest::testOtherDocument()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath(QStringLiteral("test.textpages"));
+    const QDateTime modified = QDateTime::fromSecsSinceEpoch(1600000000);
+    Okular::TextPage *textPage;
+    QScopedPointer<Okular::Page> page(createPage(0, &textPage));
+
+    Okular::TextPageDiskCache cache;
+    cache.setDocument(fileName, QStringLiteral("okular_poppler"), modified, 2);
+    cache.store(page.data(), textPage);
+    QScopedPointer<Okular::TextPage> loaded(cache.load(page.data()));
+    QVERIFY(loaded);
+
+    // the text may be different for another generator, version or page count of the file
+    cache.setDocument(fileName, QStringLiteral("okular_djvu"), modified, 2);
+    QVERIFY(!cache.load(page.data()));
+    cache.store(page.data(), textPage);
+    cache.setDocument(fileName, QStringLiteral("okular_djvu"), modified.addSecs(1), 2);
+    QVERIFY(!cache.load(page.data()));
+    cache.store(page.data(), textPage);
+    cache.setDocument(fileName, QStringLiteral("okular_djvu"), modified.addSecs(1), 3);
+    QVERIFY(!cache.load(page.data()));
+}
+
+void TextPageDiskCacheTest::testOrientation()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDateTime modified = QDateTime::fromSecsSinceEpoch(1600000000);
+    Okular::TextPage *textPage;
+    QScopedPointer<Okular::Page> page(createPage(0, &textPage));
+    Okular::TextPage *rotatedTextPage;
+    QScopedPointer<Okular::Page> rotatedPage(createPage(0, &rotatedTextPage, Okular::Rotation90));
+
+    Okular::TextPageDiskCache cache;
+    cache.setDocument(dir.filePath(QStringLiteral("test.textpages")), QStringLiteral("okular_poppler"), modified, 1);
+    cache.store(page.data(), textPage);
+
+    // the layout depends on the orientation
+    QVERIFY(!cache.load(rotatedPage.data()));
+    cache.store(rotatedPage.data(), rotatedTextPage);
+    QScopedPointer<Okular::TextPage> loaded(cache.load(rotatedPage.data()));
+    QVERIFY(loaded);
+    QCOMPARE(loaded->text(), rotatedTextPage->text());
+}
+
+void TextPageDiskCacheTest::testRemove()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath(QStringLiteral("test.textpages"));
+    const QDateTime modified = QDateTime::fromSecsSinceEpoch(1600000000);
+    Okular::TextPage *textPage;
+    QScopedPointer<Okular::Page> page(createPage(0, &textPage));
+    Okular::TextPage *otherTextPage;
+    QScopedPointer<Okular::Page> otherPage(createPage(1, &otherTextPage));
+
+    {
+        Okular::TextPageDiskCache cache;
+        cache.setDocument(fileName, QStringLiteral("okular_txt"), modified, 2);
+        cache.store(page.data(), textPage);
+        cache.store(otherPage.data(), otherTextPage);
+
+        // laid out again, the file is the same
+        cache.remove(0);
+        QVERIFY(!cache.load(page.data()));
+        QScopedPointer<Okular::TextPage> loaded(cache.load(otherPage.data()));
+        QVERIFY(loaded);
+    }
+
+    // also for the next time
+    Okular::TextPageDiskCache cache;
+    cache.setDocument(fileName, QStringLiteral("okular_txt"), modified, 2);
+    QVERIFY(!cache.load(page.data()));
+    QScopedPointer<Okular::TextPage> loaded(cache.load(otherPage.data()));
+    QVERIFY(loaded);
+}
+
+static QString linkAt(const Okular::Page *page, double x, double y)
+{
+    const Okular::ObjectRect *rect = page->objectRect(Okular::ObjectRect::Action, x, y, 1.0, 1.0);
+    const Okular::Action *action = rect ? static_cast<const Okular::Action *>(rect->object()) : nullptr;
+    if (!action || action->actionType() != Okular::Action::Browse)
+        return QString();
+    return static_cast<const Okular::BrowseAction *>(action)->url().toString();
+}
+
+void TextPageDiskCacheTest::testUrls()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDateTime modified = QDateTime::fromSecsSinceEpoch(1600000000);
+
+    Okular::TextPage *textPage = new Okular::TextPage();
+    textPage->append(QStringLiteral("See"), new Okular::NormalizedRect(0.1, 0.1, 0.2, 0.2));
+    textPage->append(QStringLiteral(" "), new Okular::NormalizedRect(0.2, 0.1, 0.25, 0.2));
+    textPage->append(QStringLiteral("www.kde.org."), new Okular::NormalizedRect(0.25, 0.1, 0.85, 0.2));
+    QScopedPointer<Okular::Page> page(new Okular::Page(0, 100, 100, Okular::Rotation0));
+    page->setTextPage(textPage);
+
+    // the text around it is not a link, the full stop is not part of it
+    QCOMPARE(linkAt(page.data(), 0.5, 0.15), QStringLiteral("http://www.kde.org"));
+    QCOMPARE(linkAt(page.data(), 0.15, 0.15), QString());
+    QCOMPARE(linkAt(page.data(), 0.5, 0.5), QString());
+
+    // the links stay when the text page goes
+    page->setTextPage(nullptr);
+    QCOMPARE(linkAt(page.data(), 0.5, 0.15), QStringLiteral("http://www.kde.org"));
+
+    // and come with the cached text page, without looking for them again
+    Okular::TextPageDiskCache cache;
+    cache.setDocument(dir.filePath(QStringLiteral("test.textpages")), QStringLiteral("okular_djvu"), modified, 1);
+    textPage = new Okular::TextPage();
+    textPage->append(QStringLiteral("https://kde.org/"), new Okular::NormalizedRect(0.1, 0.5, 0.5, 0.6));
+    page->setTextPage(textPage);
+    cache.store(page.data(), textPage);
+
+    QScopedPointer<Okular::Page> loadedPage(new Okular::Page(0, 100, 100, Okular::Rotation0));
+    Okular::TextPage *loaded = cache.load(loadedPage.data());
+    QVERIFY(loaded);
+    loadedPage->setTextPage(loaded);
+    QCOMPARE(linkAt(loadedPage.data(), 0.3, 0.55), QStringLiteral("https://kde.org/"));
+}
+
+QTEST_MAIN(TextPageDiskCacheTest)
+#include "textpagediskcachetest.moc"
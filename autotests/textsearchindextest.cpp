@@ -0,0 +1,131 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/textsearchindex_p.h"
+
+#include <QTemporaryDir>
+
+class TextSearchIndexTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testWords();
+    void testCandidates();
+    void testUnindexedPages();
+    void testSetPageCount();
+    void testSaveLoad();
+};
+
+static QBitArray bits(const QString &pattern)
+{
+    QBitArray result(pattern.length());
+    for (int i = 0; i < pattern.length(); ++i)
+        result.setBit(i, pattern.at(i) == QLatin1Char('1'));
+    return result;
+}
+
+void TextSearchIndexTest::testWords()
+{
+    QCOMPARE(Okular::TextSearchIndex::words(QStringLiteral("Hello, World!")), QStringList({QStringLiteral("hello"), QStringLiteral("world")}));
+    // the halves of hyphenated words stay together
+    QCOMPARE(Okular::TextSearchIndex::words(QStringLiteral("a hyphen-\nated word")), QStringList({QStringLiteral("a"), QStringLiteral("hyphenated"), QStringLiteral("word")}));
+    QCOMPARE(Okular::TextSearchIndex::words(QStringLiteral("well-known -- 42")), QStringList({QStringLiteral("wellknown"), QStringLiteral("42")}));
+    QVERIFY(Okular::TextSearchIndex::words(QStringLiteral(" ... ")).isEmpty());
+}
+
+void TextSearchIndexTest::testCandidates()
+{
+    Okular::TextSearchIndex index;
+    index.reset(3);
+    index.addPage(0, QStringLiteral("The quick brown fox"));
+    index.addPage(1, QStringLiteral("jumps over the lazy dog"));
+    index.addPage(2, QStringLiteral("a hyphen-\nated line"));
+
+    QCOMPARE(index.candidatePages(QStringLiteral("fox")), bits(QStringLiteral("100")));
+    QCOMPARE(index.candidatePages(QStringLiteral("THE")), bits(QStringLiteral("110")));
+    // parts of words match, like in the text search
+    QCOMPARE(index.candidatePages(QStringLiteral("ump")), bits(QStringLiteral("010")));
+    QCOMPARE(index.candidatePages(QStringLiteral("lazy dog")), bits(QStringLiteral("010")));
+    QCOMPARE(index.candidatePages(QStringLiteral("lazy fox")), bits(QStringLiteral("000")));
+    QCOMPARE(index.candidatePages(QStringLiteral("hyphenated")), bits(QStringLiteral("001")));
+    QCOMPARE(index.candidatePages(QStringLiteral("hyphen-")), bits(QStringLiteral("001")));
+    // nothing to look for, everything may match
+    QCOMPARE(index.candidatePages(QStringLiteral("?")), bits(QStringLiteral("111")));
+}
+
+void TextSearchIndexTest::testUnindexedPages()
+{
+    Okular::TextSearchIndex index;
+    index.reset(3);
+    index.addPage(1, QStringLiteral("some text"));
+    QVERIFY(index.isIndexed(1));
+    QVERIFY(!index.isIndexed(0));
+
+    QCOMPARE(index.candidatePages(QStringLiteral("text")), bits(QStringLiteral("111")));
+    QCOMPARE(index.candidatePages(QStringLiteral("other")), bits(QStringLiteral("101")));
+
+    // pages are only indexed once
+    index.addPage(1, QStringLiteral("other"));
+    QCOMPARE(index.candidatePages(QStringLiteral("other")), bits(QStringLiteral("101")));
+}
+
+void TextSearchIndexTest::testSetPageCount()
+{
+    Okular::TextSearchIndex index;
+    index.reset(2);
+    index.addPage(0, QStringLiteral("some text"));
+
+    // appended pages are not indexed, they may match
+    index.setPageCount(3);
+    QCOMPARE(index.pageCount(), 3);
+    QVERIFY(index.isIndexed(0));
+    QVERIFY(!index.isIndexed(2));
+    QCOMPARE(index.candidatePages(QStringLiteral("text")), bits(QStringLiteral("111")));
+    QCOMPARE(index.candidatePages(QStringLiteral("other")), bits(QStringLiteral("011")));
+
+    // pages are never dropped
+    index.setPageCount(1);
+    QCOMPARE(index.pageCount(), 3);
+}
+
+void TextSearchIndexTest::testSaveLoad()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = dir.filePath(QStringLiteral("test.textindex"));
+    const QDateTime modified = QDateTime::fromSecsSinceEpoch(1600000000);
+
+    Okular::TextSearchIndex index;
+    index.reset(2);
+    QVERIFY(!index.isModified());
+    index.addPage(0, QStringLiteral("first page"));
+    QVERIFY(index.isModified());
+    QVERIFY(index.save(fileName, QStringLiteral("okular_poppler"), modified));
+    QVERIFY(!index.isModified());
+
+    Okular::TextSearchIndex loaded;
+    loaded.reset(2);
+    QVERIFY(loaded.load(fileName, QStringLiteral("okular_poppler"), modified));
+    QVERIFY(loaded.isIndexed(0));
+    QVERIFY(!loaded.isIndexed(1));
+    QCOMPARE(loaded.candidatePages(QStringLiteral("first")), bits(QStringLiteral("11")));
+    QCOMPARE(loaded.candidatePages(QStringLiteral("second")), bits(QStringLiteral("01")));
+
+    // the text may be different for another generator, version or page count of the file
+    Okular::TextSearchIndex other;
+    other.reset(2);
+    QVERIFY(!other.load(fileName, QStringLiteral("okular_ghostview"), modified));
+    QVERIFY(!other.load(fileName, QStringLiteral("okular_poppler"), modified.addSecs(1)));
+    other.reset(3);
+    QVERIFY(!other.load(fileName, QStringLiteral("okular_poppler"), modified));
+    QVERIFY(!other.isIndexed(0));
+}
+
+QTEST_MAIN(TextSearchIndexTest)
+#include "textsearchindextest.moc"
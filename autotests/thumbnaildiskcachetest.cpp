@@ -0,0 +1,125 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/thumbnaildiskcache_p.h"
+
+#include <QTemporaryDir>
+
+class ThumbnailDiskCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testWidthBucket();
+    void testStoreLoad();
+    void testOtherDocument();
+    void testDirtyPage();
+};
+
+static QImage createImage(int width, int height)
+{
+    QImage image(width, height, QImage::Format_ARGB32);
+    image.fill(Qt::red);
+    return image;
+}
+
+void ThumbnailDiskCacheTest::testWidthBucket()
+{
+    const int step = Okular::ThumbnailDiskCache::widthBucketStep();
+    QCOMPARE(Okular::ThumbnailDiskCache::widthBucket(1), step);
+    QCOMPARE(Okular::ThumbnailDiskCache::widthBucket(step), step);
+    QCOMPARE(Okular::ThumbnailDiskCache::widthBucket(step + 1), 2 * step);
+}
+
+void ThumbnailDiskCacheTest::testStoreLoad()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString dirName = dir.filePath(QStringLiteral("test.thumbnails"));
+    const QDateTime modified = QDateTime::fromSecsSinceEpoch(1600000000);
+
+    {
+        Okular::ThumbnailDiskCache cache;
+        cache.setDocument(dirName, QStringLiteral("okular_poppler"), modified);
+        QVERIFY(cache.isActive());
+        QVERIFY(!cache.contains(2, 150));
+        cache.store(2, createImage(150, 200));
+        QVERIFY(cache.contains(2, 150));
+    }
+
+    Okular::ThumbnailDiskCache cache;
+    cache.setDocument(dirName, QStringLiteral("okular_poppler"), modified);
+    QVERIFY(cache.contains(2, 150));
+    // any width of the bucket
+    QVERIFY(cache.contains(2, 140));
+    QVERIFY(!cache.contains(2, 300));
+    QVERIFY(!cache.contains(1, 150));
+
+    QImage loaded;
+    bool done = false;
+    QObject context;
+    cache.load(2, QSize(140, 187), &context, [&loaded, &done](const QImage &image) {
+        loaded = image;
+        done = true;
+    });
+    QTRY_VERIFY(done);
+    QCOMPARE(loaded.size(), QSize(140, 187));
+}
+
+void ThumbnailDiskCacheTest::testOtherDocument()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString dirName = dir.filePath(QStringLiteral("test.thumbnails"));
+    const QDateTime modified = QDateTime::fromSecsSinceEpoch(1600000000);
+
+    {
+        Okular::ThumbnailDiskCache cache;
+        cache.setDocument(dirName, QStringLiteral("okular_poppler"), modified);
+        cache.store(0, createImage(100, 100));
+    }
+
+    // the document changed since
+    Okular::ThumbnailDiskCache cache;
+    cache.setDocument(dirName, QStringLiteral("okular_poppler"), modified.addSecs(1));
+    QVERIFY(cache.isActive());
+    QVERIFY(!cache.contains(0, 100));
+    cache.close();
+
+    cache.setDocument(dirName, QStringLiteral("okular_poppler"), modified);
+    QVERIFY(!cache.contains(0, 100));
+}
+
+void ThumbnailDiskCacheTest::testDirtyPage()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString dirName = dir.filePath(QStringLiteral("test.thumbnails"));
+    const QDateTime modified = QDateTime::fromSecsSinceEpoch(1600000000);
+
+    {
+        Okular::ThumbnailDiskCache cache;
+        cache.setDocument(dirName, QStringLiteral("okular_poppler"), modified);
+        cache.store(0, createImage(100, 100));
+        cache.store(1, createImage(100, 100));
+        cache.markPageDirty(0);
+        QVERIFY(!cache.contains(0, 100));
+        // not until the next time
+        cache.store(0, createImage(100, 100));
+        QVERIFY(!cache.contains(0, 100));
+        QVERIFY(cache.contains(1, 100));
+    }
+
+    Okular::ThumbnailDiskCache cache;
+    cache.setDocument(dirName, QStringLiteral("okular_poppler"), modified);
+    QVERIFY(!cache.contains(0, 100));
+    QVERIFY(cache.contains(1, 100));
+}
+
+QTEST_MAIN(ThumbnailDiskCacheTest)
+#include "thumbnaildiskcachetest.moc"
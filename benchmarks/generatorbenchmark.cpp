@@ -0,0 +1,235 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QMimeDatabase>
+
+#include "../core/document.h"
+#include "../core/generator.h"
+#include "../core/observer.h"
+#include "../core/page.h"
+#include "../core/renderstatistics.h"
+#include "../settings_core.h"
+
+// the same document for long enough to get steady numbers
+static const int kPasses = 3;
+// how long a pass may take before it counts as hung, in msec
+static const int kPassTimeout = 120000;
+
+class RenderObserver : public Okular::DocumentObserver
+{
+public:
+    void notifyPageChanged(int page, int flags) override
+    {
+        Q_UNUSED(page)
+        if (flags & Okular::DocumentObserver::Pixmap)
+            ++renderedPages;
+    }
+
+    int renderedPages = 0;
+};
+
+/**
+ * Opens the reference documents of each format and measures how fast they
+ * render and give their text. Run with -csv or -o file,xml for results a
+ * script can read; time to first page is in msec, the rates are pages per
+ * second (reported as frames), the peak memory is in bytes.
+ */
+class GeneratorBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void timeToFirstPage_data();
+    void timeToFirstPage();
+    void renderPages_data();
+    void renderPages();
+    void textExtraction_data();
+    void textExtraction();
+    void peakResidentMemory();
+
+private:
+    static QStringList benchmarkFiles();
+    static void addFileColumn();
+    static bool openDocument(Okular::Document *document, const QString &fileName);
+    static void renderPass(Okular::Document *document, RenderObserver *observer, double zoom, bool tiled);
+};
+
+void GeneratorBenchmark::initTestCase()
+{
+    Okular::SettingsCore::instance(QStringLiteral("okular_benchmarks"));
+    // every pass has to go to the generator
+    Okular::SettingsCore::setCompressedPixmapCacheSize(0);
+    Okular::SettingsCore::setEnablePixmapDiskCache(false);
+    Okular::SettingsCore::setEnableTextPageDiskCache(false);
+    Okular::SettingsCore::setEnableThumbnailDiskCache(false);
+    Okular::SettingsCore::setMemoryLevel(Okular::SettingsCore::EnumMemoryLevel::Greedy);
+}
+
+QStringList GeneratorBenchmark::benchmarkFiles()
+{
+    QStringList files = {QStringLiteral(KDESRCDIR "data/file1.pdf"), QStringLiteral(KDESRCDIR "data/simple-multipage.pdf"), QStringLiteral(KDESRCDIR "data/contents.epub")};
+    // the formats without a reference document here, like DjVu or XPS
+    const QString extraFiles = qEnvironmentVariable("OKULAR_BENCHMARK_FILES");
+    if (!extraFiles.isEmpty())
+        files += extraFiles.split(QDir::listSeparator(), QString::SkipEmptyParts);
+    return files;
+}
+
+void GeneratorBenchmark::addFileColumn()
+{
+    QTest::addColumn<QString>("fileName");
+
+    const QStringList files = benchmarkFiles();
+    for (const QString &file : files)
+        QTest::newRow(QFileInfo(file).fileName().toUtf8().constData()) << file;
+}
+
+bool GeneratorBenchmark::openDocument(Okular::Document *document, const QString &fileName)
+{
+    QMimeDatabase db;
+    return document->openDocument(fileName, QUrl(), db.mimeTypeForFile(fileName)) == Okular::Document::OpenSuccess;
+}
+
+void GeneratorBenchmark::renderPass(Okular::Document *document, RenderObserver *observer, double zoom, bool tiled)
+{
+    // drop the pixmaps of the previous pass
+    document->removeObserver(observer);
+    document->addObserver(observer);
+    observer->renderedPages = 0;
+
+    QLinkedList<Okular::PixmapRequest *> requests;
+    for (uint i = 0; i < document->pages(); ++i) {
+        const Okular::Page *page = document->page(i);
+        Okular::PixmapRequest *request = new Okular::PixmapRequest(observer, i, page->width() * zoom, page->height() * zoom, 1, 1, Okular::PixmapRequest::NoFeature);
+        // a viewport on the top left of the page, what makes the document use tiles
+        if (tiled)
+            request->setNormalizedRect(Okular::NormalizedRect(0, 0, 0.5, 0.5));
+        requests << request;
+    }
+    document->requestPixmaps(requests);
+    QTRY_COMPARE_WITH_TIMEOUT(observer->renderedPages, int(document->pages()), kPassTimeout);
+}
+
+void GeneratorBenchmark::timeToFirstPage_data()
+{
+    addFileColumn();
+}
+
+void GeneratorBenchmark::timeToFirstPage()
+{
+    QFETCH(QString, fileName);
+
+    Okular::Document document(nullptr);
+    RenderObserver observer;
+    document.addObserver(&observer);
+    if (!openDocument(&document, fileName))
+        QSKIP("No generator for this document");
+
+    const Okular::Page *page = document.page(0);
+    document.requestPixmaps({new Okular::PixmapRequest(&observer, 0, page->width(), page->height(), 1, 1, Okular::PixmapRequest::NoFeature)});
+    QTRY_COMPARE_WITH_TIMEOUT(observer.renderedPages, 1, kPassTimeout);
+
+    // measured by the document, from the start of opening it
+    QTest::setBenchmarkResult(document.renderStatistics().firstPixmapTime(), QTest::WalltimeMilliseconds);
+    document.removeObserver(&observer);
+}
+
+void GeneratorBenchmark::renderPages_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<double>("zoom");
+    QTest::addColumn<bool>("tiled");
+
+    const QStringList files = benchmarkFiles();
+    for (const QString &file : files) {
+        const QByteArray name = QFileInfo(file).fileName().toUtf8();
+        QTest::newRow((name + " 50%").constData()) << file << 0.5 << false;
+        QTest::newRow((name + " 100%").constData()) << file << 1.0 << false;
+        QTest::newRow((name + " 200%").constData()) << file << 2.0 << false;
+        QTest::newRow((name + " 400% tiled").constData()) << file << 4.0 << true;
+    }
+}
+
+void GeneratorBenchmark::renderPages()
+{
+    QFETCH(QString, fileName);
+    QFETCH(double, zoom);
+    QFETCH(bool, tiled);
+
+    Okular::Document document(nullptr);
+    RenderObserver observer;
+    document.addObserver(&observer);
+    if (!openDocument(&document, fileName))
+        QSKIP("No generator for this document");
+
+    // the first pass warms up the fonts and the caches of the generator
+    renderPass(&document, &observer, zoom, tiled);
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int pass = 0; pass < kPasses; ++pass)
+        renderPass(&document, &observer, zoom, tiled);
+    const qint64 elapsed = qMax(timer.elapsed(), qint64(1));
+
+    // a page is a frame
+    QTest::setBenchmarkResult(kPasses * document.pages() * 1000.0 / elapsed, QTest::FramesPerSecond);
+    document.removeObserver(&observer);
+}
+
+void GeneratorBenchmark::textExtraction_data()
+{
+    addFileColumn();
+}
+
+void GeneratorBenchmark::textExtraction()
+{
+    QFETCH(QString, fileName);
+
+    Okular::Document document(nullptr);
+    if (!openDocument(&document, fileName))
+        QSKIP("No generator for this document");
+    if (!document.supportsSearching())
+        QSKIP("The generator has no text");
+
+    QElapsedTimer timer;
+    timer.start();
+    for (uint i = 0; i < document.pages(); ++i) {
+        document.requestTextPage(i);
+        QTRY_VERIFY_WITH_TIMEOUT(document.page(i)->hasTextPage(), kPassTimeout);
+    }
+    const qint64 elapsed = qMax(timer.elapsed(), qint64(1));
+
+    QTest::setBenchmarkResult(document.pages() * 1000.0 / elapsed, QTest::FramesPerSecond);
+}
+
+void GeneratorBenchmark::peakResidentMemory()
+{
+    // the peak of the whole run, so it goes last
+#ifdef Q_OS_LINUX
+    QFile status(QStringLiteral("/proc/self/status"));
+    QVERIFY(status.open(QIODevice::ReadOnly));
+    for (QByteArray line = status.readLine(); !line.isEmpty(); line = status.readLine()) {
+        if (line.startsWith("VmHWM:")) {
+            const qint64 kiloBytes = line.mid(6).trimmed().split(' ').value(0).toLongLong();
+            QTest::setBenchmarkResult(kiloBytes * 1024, QTest::BytesAllocated);
+            return;
+        }
+    }
+    QFAIL("No VmHWM in /proc/self/status");
+#else
+    QSKIP("Only measured on Linux");
+#endif
+}
+
+QTEST_MAIN(GeneratorBenchmark)
+#include "generatorbenchmark.moc"
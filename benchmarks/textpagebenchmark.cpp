@@ -0,0 +1,179 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "../core/area.h"
+#include "../core/misc.h"
+#include "../core/page.h"
+#include "../core/textpage.h"
+
+#include <memory>
+
+// what the words of the synthetic pages are made of
+static const char *const kVocabulary[] = {"the", "document", "viewer", "renders", "pages", "quickly", "and", "searches", "their", "text", "with", "selection", "of", "words", "in", "columns"};
+static const int kVocabularySize = sizeof(kVocabulary) / sizeof(kVocabulary[0]);
+// only at the end of the page, so searching it goes through everything
+static const char *const kNeedle = "needle";
+
+enum Layout { SingleColumn, ThreeColumns, Rotated, Hyphenated };
+Q_DECLARE_METATYPE(Layout)
+
+/**
+ * Times the text hot paths on synthetic pages with many words: the layout
+ * analysis Page::setTextPage() runs, search, selection and the word under
+ * a point. Run with -csv or -o file,xml for results a script can read.
+ */
+class TextPageBenchmark : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void layout_data();
+    void layout();
+    void findText_data();
+    void findText();
+    void textArea_data();
+    void textArea();
+    void wordAt_data();
+    void wordAt();
+
+private:
+    static void addRows();
+    static Okular::TextPage *createTextPage(Layout layout, int wordCount);
+};
+
+void TextPageBenchmark::addRows()
+{
+    QTest::addColumn<Layout>("layout");
+    QTest::addColumn<int>("wordCount");
+
+    for (int wordCount : {10000, 100000}) {
+        const QByteArray count = QByteArray::number(wordCount);
+        QTest::newRow(("single column " + count).constData()) << SingleColumn << wordCount;
+        QTest::newRow(("three columns " + count).constData()) << ThreeColumns << wordCount;
+        QTest::newRow(("rotated " + count).constData()) << Rotated << wordCount;
+        QTest::newRow(("hyphenated " + count).constData()) << Hyphenated << wordCount;
+    }
+}
+
+Okular::TextPage *TextPageBenchmark::createTextPage(Layout layout, int wordCount)
+{
+    const int columns = layout == ThreeColumns ? 3 : 1;
+    const int wordsPerLine = 12;
+    const int lines = (wordCount + wordsPerLine - 1) / wordsPerLine;
+    const int linesPerColumn = (lines + columns - 1) / columns;
+    const double columnWidth = 1.0 / columns;
+    const double lineHeight = 1.0 / linesPerColumn;
+    const double wordWidth = columnWidth * 0.9 / wordsPerLine;
+
+    Okular::TextPage *textPage = new Okular::TextPage();
+    // the same pages every run
+    quint32 random = 1;
+    for (int i = 0; i < wordCount; ++i) {
+        const int line = i / wordsPerLine;
+        const int column = line / linesPerColumn;
+        const int lineInColumn = line % linesPerColumn;
+        const int wordInLine = i % wordsPerLine;
+        const bool lastInLine = wordInLine == wordsPerLine - 1 || i == wordCount - 1;
+
+        random = random * 1103515245 + 12345;
+        QString text = i == wordCount - 1 ? QString::fromLatin1(kNeedle) : QString::fromLatin1(kVocabulary[(random >> 16) % kVocabularySize]);
+        if (layout == Hyphenated && lastInLine && i != wordCount - 1)
+            text += QLatin1Char('-');
+        text += lastInLine ? QLatin1Char('\n') : QLatin1Char(' ');
+
+        // the lines of rotated text go left to right, the words top to bottom
+        const double across = column * columnWidth + wordInLine * wordWidth * 1.1;
+        const double along = lineInColumn * lineHeight;
+        Okular::NormalizedRect *area = layout == Rotated ? new Okular::NormalizedRect(along, across, along + lineHeight * 0.8, across + wordWidth) : new Okular::NormalizedRect(across, along, across + wordWidth, along + lineHeight * 0.8);
+        textPage->append(text, area);
+    }
+    return textPage;
+}
+
+void TextPageBenchmark::layout_data()
+{
+    addRows();
+}
+
+void TextPageBenchmark::layout()
+{
+    QFETCH(Layout, layout);
+    QFETCH(int, wordCount);
+
+    QBENCHMARK {
+        Okular::Page page(0, 1000, 1000, Okular::Rotation0);
+        // where the words are put in reading order
+        page.setTextPage(createTextPage(layout, wordCount));
+    }
+}
+
+void TextPageBenchmark::findText_data()
+{
+    addRows();
+}
+
+void TextPageBenchmark::findText()
+{
+    QFETCH(Layout, layout);
+    QFETCH(int, wordCount);
+
+    Okular::Page page(0, 1000, 1000, Okular::Rotation0);
+    page.setTextPage(createTextPage(layout, wordCount));
+    const QString needle = QString::fromLatin1(kNeedle);
+
+    QBENCHMARK {
+        std::unique_ptr<Okular::RegularAreaRect> result(page.findText(0, needle, Okular::FromTop, Qt::CaseInsensitive));
+        QVERIFY(result);
+    }
+}
+
+void TextPageBenchmark::textArea_data()
+{
+    addRows();
+}
+
+void TextPageBenchmark::textArea()
+{
+    QFETCH(Layout, layout);
+    QFETCH(int, wordCount);
+
+    Okular::Page page(0, 1000, 1000, Okular::Rotation0);
+    page.setTextPage(createTextPage(layout, wordCount));
+    // most of the page, the usual drag from one corner to the other
+    Okular::TextSelection selection(Okular::NormalizedPoint(0.05, 0.05), Okular::NormalizedPoint(0.95, 0.95));
+
+    QBENCHMARK {
+        std::unique_ptr<Okular::RegularAreaRect> area(page.textArea(&selection));
+        QVERIFY(area);
+    }
+}
+
+void TextPageBenchmark::wordAt_data()
+{
+    addRows();
+}
+
+void TextPageBenchmark::wordAt()
+{
+    QFETCH(Layout, layout);
+    QFETCH(int, wordCount);
+
+    Okular::Page page(0, 1000, 1000, Okular::Rotation0);
+    page.setTextPage(createTextPage(layout, wordCount));
+
+    QBENCHMARK {
+        // a hundred points all over the page, like a double click may be anywhere
+        for (int i = 0; i < 100; ++i) {
+            QString word;
+            std::unique_ptr<Okular::RegularAreaRect> area(page.wordAt(Okular::NormalizedPoint((i % 10) / 10.0 + 0.03, (i / 10) / 10.0 + 0.03), &word));
+        }
+    }
+}
+
+QTEST_MAIN(TextPageBenchmark)
+#include "textpagebenchmark.moc"
@@ -0,0 +1,219 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "allocatedpixmaps_p.h"
+
+#include "observer.h"
+
+using namespace Okular;
+
+// how many of the pixmaps farthest from the viewport leastValuableFrom() weighs against each other
+static const int kEvictionCandidates = 8;
+// added to the render times, so that the pixmaps rendered instantly still count their distance and size
+static const qint64 kEvictionBaseRenderTime = 20; // in msec
+
+AllocatedPixmapIndex::AllocatedPixmapIndex()
+    : m_count(0)
+{
+}
+
+AllocatedPixmapIndex::~AllocatedPixmapIndex()
+{
+    clear();
+}
+
+void AllocatedPixmapIndex::insert(AllocatedPixmap *pixmap)
+{
+    QMap<int, AllocatedPixmap *> &pages = m_pixmaps[pixmap->observer];
+    QMap<int, AllocatedPixmap *>::iterator it = pages.find(pixmap->page);
+    if (it != pages.end()) {
+        if (*it != pixmap) {
+            releaseSharedData(*it);
+            delete *it;
+        }
+        *it = pixmap;
+    } else {
+        pages.insert(pixmap->page, pixmap);
+        ++m_count;
+    }
+}
+
+AllocatedPixmap *AllocatedPixmapIndex::take(DocumentObserver *observer, int page)
+{
+    QHash<DocumentObserver *, QMap<int, AllocatedPixmap *>>::iterator oIt = m_pixmaps.find(observer);
+    if (oIt == m_pixmaps.end())
+        return nullptr;
+
+    AllocatedPixmap *p = oIt->take(page);
+    if (!p)
+        return nullptr;
+
+    --m_count;
+    if (oIt->isEmpty())
+        m_pixmaps.erase(oIt);
+    releaseSharedData(p);
+    return p;
+}
+
+AllocatedPixmap *AllocatedPixmapIndex::value(DocumentObserver *observer, int page) const
+{
+    return m_pixmaps.value(observer).value(page, nullptr);
+}
+
+AllocatedPixmap *AllocatedPixmapIndex::farthestFrom(int viewportPage, bool unloadableOnly, DocumentObserver *observer) const
+{
+    if (observer) {
+        QHash<DocumentObserver *, QMap<int, AllocatedPixmap *>>::const_iterator oIt = m_pixmaps.constFind(observer);
+        return oIt != m_pixmaps.constEnd() ? farthestFrom(*oIt, viewportPage, unloadableOnly) : nullptr;
+    }
+
+    AllocatedPixmap *farthest = nullptr;
+    int maxDistance = -1;
+    for (const QMap<int, AllocatedPixmap *> &pages : m_pixmaps) {
+        AllocatedPixmap *p = farthestFrom(pages, viewportPage, unloadableOnly);
+        if (p && qAbs(p->page - viewportPage) > maxDistance) {
+            maxDistance = qAbs(p->page - viewportPage);
+            farthest = p;
+        }
+    }
+    return farthest;
+}
+
+AllocatedPixmap *AllocatedPixmapIndex::farthestFrom(const QMap<int, AllocatedPixmap *> &pages, int viewportPage, bool unloadableOnly) const
+{
+    if (pages.isEmpty())
+        return nullptr;
+
+    // Walk inwards from both ends, always looking at the farthest of the two;
+    // pixmaps that can't be unloaded are usually the ones around the
+    // viewport, so this stops after very few steps
+    QMap<int, AllocatedPixmap *>::const_iterator lo = pages.constBegin();
+    QMap<int, AllocatedPixmap *>::const_iterator hi = pages.constEnd();
+    --hi;
+    while (true) {
+        const bool takeLow = qAbs(lo.key() - viewportPage) >= qAbs(hi.key() - viewportPage);
+        AllocatedPixmap *p = takeLow ? *lo : *hi;
+        if (!unloadableOnly || p->observer->canUnloadPixmap(p->page))
+            return p;
+
+        if (lo == hi)
+            return nullptr;
+
+        if (takeLow)
+            ++lo;
+        else
+            --hi;
+    }
+}
+
+AllocatedPixmap *AllocatedPixmapIndex::leastValuableFrom(int viewportPage, bool unloadableOnly, DocumentObserver *observer) const
+{
+    if (observer) {
+        QHash<DocumentObserver *, QMap<int, AllocatedPixmap *>>::const_iterator oIt = m_pixmaps.constFind(observer);
+        return oIt != m_pixmaps.constEnd() ? leastValuableFrom(*oIt, viewportPage, unloadableOnly) : nullptr;
+    }
+
+    AllocatedPixmap *selected = nullptr;
+    double maxScore = -1;
+    for (const QMap<int, AllocatedPixmap *> &pages : m_pixmaps) {
+        AllocatedPixmap *p = leastValuableFrom(pages, viewportPage, unloadableOnly);
+        if (!p)
+            continue;
+
+        const double score = evictionScore(qAbs(p->page - viewportPage), p->memory, p->renderTime);
+        if (score > maxScore) {
+            maxScore = score;
+            selected = p;
+        }
+    }
+    return selected;
+}
+
+AllocatedPixmap *AllocatedPixmapIndex::leastValuableFrom(const QMap<int, AllocatedPixmap *> &pages, int viewportPage, bool unloadableOnly) const
+{
+    if (pages.isEmpty())
+        return nullptr;
+
+    // the same walk as farthestFrom(), for a few candidates
+    AllocatedPixmap *selected = nullptr;
+    double maxScore = -1;
+    int candidates = 0;
+    QMap<int, AllocatedPixmap *>::const_iterator lo = pages.constBegin();
+    QMap<int, AllocatedPixmap *>::const_iterator hi = pages.constEnd();
+    --hi;
+    while (candidates < kEvictionCandidates) {
+        const bool takeLow = qAbs(lo.key() - viewportPage) >= qAbs(hi.key() - viewportPage);
+        AllocatedPixmap *p = takeLow ? *lo : *hi;
+        if (!unloadableOnly || p->observer->canUnloadPixmap(p->page)) {
+            ++candidates;
+            const double score = evictionScore(qAbs(p->page - viewportPage), p->memory, p->renderTime);
+            if (score > maxScore) {
+                maxScore = score;
+                selected = p;
+            }
+        }
+
+        if (lo == hi)
+            break;
+
+        if (takeLow)
+            ++lo;
+        else
+            --hi;
+    }
+    return selected;
+}
+
+double AllocatedPixmapIndex::evictionScore(int distance, qulonglong memory, qint64 renderTime)
+{
+    return double(distance + 1) * memory / (qMax<qint64>(0, renderTime) + kEvictionBaseRenderTime);
+}
+
+void AllocatedPixmapIndex::removeObserver(DocumentObserver *observer)
+{
+    const QMap<int, AllocatedPixmap *> pages = m_pixmaps.take(observer);
+    m_count -= pages.count();
+    for (AllocatedPixmap *p : pages)
+        releaseSharedData(p);
+    qDeleteAll(pages);
+}
+
+void AllocatedPixmapIndex::releaseSharedData(AllocatedPixmap *pixmap)
+{
+    AllocatedPixmap *heir = nullptr;
+    for (const QMap<int, AllocatedPixmap *> &pages : qAsConst(m_pixmaps)) {
+        AllocatedPixmap *p = pages.value(pixmap->page, nullptr);
+        if (!p || p->source != pixmap)
+            continue;
+
+        if (!heir) {
+            heir = p;
+            heir->memory = pixmap->memory;
+            heir->source = nullptr;
+            pixmap->memory = 0;
+        } else {
+            p->source = heir;
+        }
+    }
+}
+
+void AllocatedPixmapIndex::clear()
+{
+    for (const QMap<int, AllocatedPixmap *> &pages : qAsConst(m_pixmaps))
+        qDeleteAll(pages);
+    m_pixmaps.clear();
+    m_count = 0;
+}
+
+bool AllocatedPixmapIndex::isEmpty() const
+{
+    return m_count == 0;
+}
+
+int AllocatedPixmapIndex::count() const
+{
+    return m_count;
+}
@@ -0,0 +1,147 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_ALLOCATEDPIXMAPS_P_H_
+#define _OKULAR_ALLOCATEDPIXMAPS_P_H_
+
+#include <QHash>
+#include <QMap>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+class DocumentObserver;
+}
+
+struct AllocatedPixmap {
+    // owner of the page
+    Okular::DocumentObserver *observer;
+    int page;
+    qulonglong memory;
+    // how long rendering it again would take, in msec
+    qint64 renderTime;
+    // the pixmap of another observer whose data this one shares, which is
+    // charged for it, or nullptr
+    AllocatedPixmap *source;
+    // public constructor: initialize data
+    AllocatedPixmap(Okular::DocumentObserver *o, int p, qulonglong m, qint64 t = 0, AllocatedPixmap *s = nullptr)
+        : observer(o)
+        , page(p)
+        , memory(m)
+        , renderTime(t)
+        , source(s)
+    {
+    }
+};
+
+namespace Okular
+{
+/**
+ * Index of the pixmaps allocated by the document for its observers.
+ *
+ * There is at most one AllocatedPixmap for each observer and page. They are
+ * kept sorted by page number for each observer, so the one farthest from
+ * the viewport is always at one of the two ends and it can be found without
+ * walking all of them. This also means nothing needs to be updated when the
+ * viewport moves.
+ *
+ * The index owns the AllocatedPixmap it contains.
+ */
+class OKULARCORE_EXPORT AllocatedPixmapIndex
+{
+public:
+    AllocatedPixmapIndex();
+    ~AllocatedPixmapIndex();
+
+    /**
+     * Adds @p pixmap to the index, replacing (and deleting) an existing
+     * entry for the same observer and page.
+     */
+    void insert(AllocatedPixmap *pixmap);
+
+    /**
+     * Removes the entry for @p observer and @p page and returns it, or
+     * returns nullptr if there is none.
+     *
+     * If the pixmaps of other observers share its data, its memory is
+     * charged to one of them instead, so the returned entry has none left.
+     */
+    AllocatedPixmap *take(DocumentObserver *observer, int page);
+
+    /**
+     * Returns the entry for @p observer and @p page, or nullptr.
+     */
+    AllocatedPixmap *value(DocumentObserver *observer, int page) const;
+
+    /**
+     * Returns the pixmap whose page is farthest from @p viewportPage, or
+     * nullptr if there is none.
+     *
+     * If @p unloadableOnly is set only pixmaps whose observer agrees they
+     * can be unloaded are considered, if @p observer is set only the pixmaps
+     * of that observer are considered.
+     *
+     * The pixmap is not removed from the index, see take().
+     */
+    AllocatedPixmap *farthestFrom(int viewportPage, bool unloadableOnly, DocumentObserver *observer = nullptr /* any */) const;
+
+    /**
+     * Returns the pixmap that is the best to evict for @p viewportPage, or
+     * nullptr if there is none: among the few farthest from it, the one with
+     * the highest evictionScore(), so a pixmap that was slow to render is
+     * kept over a cheap one about as far.
+     *
+     * @p unloadableOnly and @p observer are like for farthestFrom().
+     */
+    AllocatedPixmap *leastValuableFrom(int viewportPage, bool unloadableOnly, DocumentObserver *observer = nullptr /* any */) const;
+
+    /**
+     * How much evicting a pixmap of @p memory bytes whose page is @p distance
+     * pages away from the viewport and takes @p renderTime msec to render
+     * is worth: the farther, the bigger and the cheaper, the higher.
+     */
+    static double evictionScore(int distance, qulonglong memory, qint64 renderTime);
+
+    /**
+     * Deletes all the pixmaps of @p observer.
+     */
+    void removeObserver(DocumentObserver *observer);
+
+    /**
+     * Deletes all the pixmaps.
+     */
+    void clear();
+
+    bool isEmpty() const;
+    int count() const;
+
+    /**
+     * Calls @p func for every pixmap in the index.
+     */
+    template<typename F> void forEach(F func) const
+    {
+        for (const QMap<int, AllocatedPixmap *> &pages : m_pixmaps) {
+            for (AllocatedPixmap *p : pages)
+                func(p);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(AllocatedPixmapIndex)
+
+    AllocatedPixmap *farthestFrom(const QMap<int, AllocatedPixmap *> &pages, int viewportPage, bool unloadableOnly) const;
+    AllocatedPixmap *leastValuableFrom(const QMap<int, AllocatedPixmap *> &pages, int viewportPage, bool unloadableOnly) const;
+    // moves the memory of pixmap to the first of the pixmaps sharing its data
+    void releaseSharedData(AllocatedPixmap *pixmap);
+
+    QHash<DocumentObserver *, QMap<int, AllocatedPixmap *>> m_pixmaps;
+    int m_count;
+};
+
+}
+
+#endif
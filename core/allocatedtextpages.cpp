@@ -0,0 +1,100 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "allocatedtextpages_p.h"
+
+#include <algorithm>
+
+using namespace Okular;
+
+AllocatedTextPages::AllocatedTextPages()
+    : m_uses(0)
+    , m_totalBytes(0)
+{
+}
+
+void AllocatedTextPages::insert(int page, qulonglong bytes)
+{
+    remove(page);
+    m_entries.insert(page, {bytes, ++m_uses});
+    m_totalBytes += bytes;
+}
+
+bool AllocatedTextPages::remove(int page)
+{
+    const auto it = m_entries.find(page);
+    if (it == m_entries.end())
+        return false;
+
+    m_totalBytes -= it->bytes;
+    m_entries.erase(it);
+    return true;
+}
+
+void AllocatedTextPages::touch(int page)
+{
+    const auto it = m_entries.find(page);
+    if (it != m_entries.end())
+        it->lastUse = ++m_uses;
+}
+
+bool AllocatedTextPages::contains(int page) const
+{
+    return m_entries.contains(page);
+}
+
+QVector<int> AllocatedTextPages::pages() const
+{
+    return m_entries.keys().toVector();
+}
+
+void AllocatedTextPages::clear()
+{
+    m_entries.clear();
+    m_totalBytes = 0;
+}
+
+int AllocatedTextPages::count() const
+{
+    return m_entries.count();
+}
+
+qulonglong AllocatedTextPages::totalBytes() const
+{
+    return m_totalBytes;
+}
+
+QVector<int> AllocatedTextPages::toEvict(qulonglong maxBytes, int viewportPage, const QSet<int> &keep) const
+{
+    if (m_totalBytes <= maxBytes)
+        return {};
+
+    // the distance times the uses since the last one, so that a page next to
+    // the viewport goes once it is long unused, and a far one soon after
+    struct Candidate {
+        int page;
+        double score;
+        qulonglong bytes;
+    };
+    QVector<Candidate> candidates;
+    candidates.reserve(m_entries.count());
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        if (!keep.contains(it.key()))
+            candidates.append({it.key(), double(qAbs(it.key() - viewportPage) + 1) * (m_uses - it->lastUse + 1), it->bytes});
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) { return a.score > b.score; });
+
+    QVector<int> pages;
+    qulonglong bytes = m_totalBytes;
+    for (const Candidate &candidate : qAsConst(candidates)) {
+        if (bytes <= maxBytes)
+            break;
+
+        pages.append(candidate.page);
+        bytes -= candidate.bytes;
+    }
+    return pages;
+}
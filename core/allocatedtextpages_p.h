@@ -0,0 +1,79 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_ALLOCATEDTEXTPAGES_P_H_
+#define _OKULAR_ALLOCATEDTEXTPAGES_P_H_
+
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * The text pages the document holds, with their size and when they were
+ * last used, to pick the ones to evict.
+ *
+ * A use is counted when a text page is added and when touch() is called,
+ * e.g. when the user selects text on it; the pages not used for the longest
+ * time and the farthest from the viewport go first.
+ */
+class OKULARCORE_EXPORT AllocatedTextPages
+{
+public:
+    AllocatedTextPages();
+
+    /**
+     * Adds the text page of @p page, of @p bytes, as just used. It replaces
+     * the entry for the same page.
+     */
+    void insert(int page, qulonglong bytes);
+
+    /**
+     * Removes the entry for @p page, returns whether there was one.
+     */
+    bool remove(int page);
+
+    /**
+     * Counts a use of the text page of @p page, if there is one.
+     */
+    void touch(int page);
+
+    bool contains(int page) const;
+
+    QVector<int> pages() const;
+
+    void clear();
+
+    int count() const;
+
+    qulonglong totalBytes() const;
+
+    /**
+     * Returns the pages whose text pages are to be evicted so that the rest
+     * fit in @p maxBytes, the first to go first. The pages in @p keep are
+     * never among them.
+     *
+     * They are not removed, see remove().
+     */
+    QVector<int> toEvict(qulonglong maxBytes, int viewportPage, const QSet<int> &keep) const;
+
+private:
+    struct Entry {
+        qulonglong bytes;
+        quint64 lastUse;
+    };
+
+    QHash<int, Entry> m_entries;
+    quint64 m_uses;
+    qulonglong m_totalBytes;
+};
+
+}
+
+#endif
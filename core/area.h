@@ -727,17 +727,19 @@ template<class NormalizedShape, class Shape> void RegularArea<NormalizedShape, S
 #ifdef DEBUG_REGULARAREA
     int prev_end = this->count();
 #endif
-    int end = this->count() - 1, x = 0;
-    for (int i = 0; i < end; ++i) {
-        if (givePtr((*this)[x])->intersects(deref((*this)[i + 1]))) {
-            deref((*this)[x]) |= deref((*this)[i + 1]);
-            this->removeAt(i + 1);
-            --end;
-            --i;
-        } else {
-            x = i + 1;
+    // one pass, each shape is merged into the last kept one or moved right
+    // after it, and what is left at the end is dropped at once
+    const int count = this->count();
+    int x = 0;
+    for (int i = 1; i < count; ++i) {
+        if (givePtr((*this)[x])->intersects(deref((*this)[i]))) {
+            deref((*this)[x]) |= deref((*this)[i]);
+        } else if (++x != i) {
+            (*this)[x] = (*this)[i];
         }
     }
+    if (count > 0)
+        this->erase(this->begin() + x + 1, this->end());
 #ifdef DEBUG_REGULARAREA
     qCDebug(OkularCoreDebug) << "from" << prev_end << "to" << this->count();
 #endif
@@ -14,9 +14,11 @@
 #include <QFileInfo>
 #include <QGuiApplication>
 #include <QHash>
+#include <QPair>
 #include <QSet>
 #include <QStandardPaths>
 #include <QUrl>
+#include <QVector>
 
 // local includes
 #include "document_p.h"
@@ -80,12 +82,17 @@ static inline bool documentViewportFuzzyCompare(const DocumentViewport &vp1, con
     return true;
 }
 
-static inline bool bookmarkLessThan(const KBookmark &b1, const KBookmark &b2)
+// an entry of BookmarkManager::Private::sortedBookmarks
+typedef QPair<DocumentViewport, KBookmark> IndexedBookmark;
+
+static inline bool indexedBookmarkLessThan(const IndexedBookmark &b1, const IndexedBookmark &b2)
 {
-    DocumentViewport vp1(b1.url().fragment(QUrl::FullyDecoded));
-    DocumentViewport vp2(b2.url().fragment(QUrl::FullyDecoded));
+    return b1.first < b2.first;
+}
 
-    return vp1 < vp2;
+static inline bool indexedBookmarkPageLessThan(const IndexedBookmark &b, int page)
+{
+    return b.first.pageNumber < page;
 }
 
 static inline bool okularBookmarkActionLessThan(QAction *a1, QAction *a2)
@@ -133,12 +140,26 @@ public:
 
     QHash<QUrl, QString>::iterator bookmarkFind(const QUrl &url, bool doCreate, KBookmarkGroup *result = nullptr);
 
+    /**
+     * Parses the viewports of the bookmarks of url again into sortedBookmarks,
+     * after they changed.
+     */
+    void indexBookmarks();
+
+    /**
+     * The bookmarks of url in sortedBookmarks that are on @p page.
+     */
+    QPair<QVector<IndexedBookmark>::const_iterator, QVector<IndexedBookmark>::const_iterator> pageBookmarks(int page) const;
+
     // slots
     void _o_changed(const QString &groupAddress, const QString &caller);
 
     BookmarkManager *q;
     QUrl url;
     QHash<int, int> urlBookmarks;
+    // the bookmarks of url with a valid viewport, sorted by it, so the
+    // lookups do not parse the urls of all of them each time
+    QVector<IndexedBookmark> sortedBookmarks;
     DocumentPrivate *document;
     QString file;
     KBookmarkManager *manager;
@@ -288,28 +309,18 @@ KBookmark::List BookmarkManager::bookmarks() const
 
 KBookmark::List BookmarkManager::bookmarks(int page) const
 {
-    const KBookmark::List bmarks = bookmarks();
     KBookmark::List ret;
-    for (const KBookmark &bm : bmarks) {
-        DocumentViewport vp(bm.url().fragment(QUrl::FullyDecoded));
-        if (vp.isValid() && vp.pageNumber == page) {
-            ret.append(bm);
-        }
-    }
+    const auto range = d->pageBookmarks(page);
+    for (auto it = range.first; it != range.second; ++it)
+        ret.append(it->second);
 
     return ret;
 }
 
 KBookmark BookmarkManager::bookmark(int page) const
 {
-    const KBookmark::List bmarks = bookmarks();
-    for (const KBookmark &bm : bmarks) {
-        DocumentViewport vp(bm.url().fragment(QUrl::FullyDecoded));
-        if (vp.isValid() && vp.pageNumber == page) {
-            return bm;
-        }
-    }
-    return KBookmark();
+    const auto range = d->pageBookmarks(page);
+    return range.first != range.second ? range.first->second : KBookmark();
 }
 
 KBookmark BookmarkManager::bookmark(const DocumentViewport &viewport) const
@@ -317,19 +328,10 @@ KBookmark BookmarkManager::bookmark(const DocumentViewport &viewport) const
     if (!viewport.isValid() || !isBookmarked(viewport.pageNumber))
         return KBookmark();
 
-    KBookmarkGroup thebg;
-    QHash<QUrl, QString>::iterator it = d->bookmarkFind(d->url, false, &thebg);
-    if (it == d->knownFiles.end())
-        return KBookmark();
-
-    for (KBookmark bm = thebg.first(); !bm.isNull(); bm = thebg.next(bm)) {
-        if (bm.isSeparator() || bm.isGroup())
-            continue;
-
-        DocumentViewport vp(bm.url().fragment(QUrl::FullyDecoded));
-        if (documentViewportFuzzyCompare(vp, viewport)) {
-            return bm;
-        }
+    const auto range = d->pageBookmarks(viewport.pageNumber);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (documentViewportFuzzyCompare(it->first, viewport))
+            return it->second;
     }
 
     return KBookmark();
@@ -383,6 +385,33 @@ QHash<QUrl, QString>::iterator BookmarkManager::Private::bookmarkFind(const QUrl
     return it;
 }
 
+void BookmarkManager::Private::indexBookmarks()
+{
+    sortedBookmarks.clear();
+    KBookmarkGroup thebg;
+    QHash<QUrl, QString>::iterator it = bookmarkFind(url, false, &thebg);
+    if (it == knownFiles.end())
+        return;
+
+    for (KBookmark bm = thebg.first(); !bm.isNull(); bm = thebg.next(bm)) {
+        if (bm.isSeparator() || bm.isGroup())
+            continue;
+
+        const DocumentViewport vp(bm.url().fragment(QUrl::FullyDecoded));
+        if (vp.isValid())
+            sortedBookmarks.append(qMakePair(vp, bm));
+    }
+    // the ones with the same viewport stay in the order of the file
+    std::stable_sort(sortedBookmarks.begin(), sortedBookmarks.end(), indexedBookmarkLessThan);
+}
+
+QPair<QVector<IndexedBookmark>::const_iterator, QVector<IndexedBookmark>::const_iterator> BookmarkManager::Private::pageBookmarks(int page) const
+{
+    const auto begin = std::lower_bound(sortedBookmarks.constBegin(), sortedBookmarks.constEnd(), page, indexedBookmarkPageLessThan);
+    const auto end = std::lower_bound(begin, sortedBookmarks.constEnd(), page + 1, indexedBookmarkPageLessThan);
+    return qMakePair(begin, end);
+}
+
 void BookmarkManager::addBookmark(int page)
 {
     if (page >= 0 && page < (int)d->document->m_pagesVector.count()) {
@@ -445,6 +474,8 @@ bool BookmarkManager::addBookmark(const QUrl &documentUrl, const Okular::Documen
     QUrl newurl = referurl;
     newurl.setFragment(vp.toString(), QUrl::DecodedMode);
     thebg.addBookmark(newtitle, newurl, QString());
+    if (referurl == d->url)
+        d->indexBookmarks();
     if (referurl == d->document->m_url) {
         d->urlBookmarks[vp.pageNumber]++;
         foreachObserver(notifyPageChanged(vp.pageNumber, DocumentObserver::Bookmark));
@@ -524,6 +555,8 @@ int BookmarkManager::removeBookmark(const QUrl &documentUrl, const KBookmark &bm
         return -1;
 
     thebg.deleteBookmark(bm);
+    if (referurl == d->url)
+        d->indexBookmarks();
 
     if (referurl == d->document->m_url) {
         d->urlBookmarks[vp.pageNumber]--;
@@ -560,6 +593,9 @@ void BookmarkManager::removeBookmarks(const QUrl &documentUrl, const KBookmark::
         }
     }
 
+    if (deletedAny && referurl == d->url)
+        d->indexBookmarks();
+
     if (referurl == d->document->m_url) {
         for (int i = 0; i < qMax(oldUrlBookmarks.size(), d->urlBookmarks.size()); i++) {
             bool oldContains = oldUrlBookmarks.contains(i) && oldUrlBookmarks[i] > 0;
@@ -602,20 +638,9 @@ void BookmarkManager::setUrl(const QUrl &url)
 {
     d->url = mostCanonicalUrl(url);
     d->urlBookmarks.clear();
-    KBookmarkGroup thebg;
-    QHash<QUrl, QString>::iterator it = d->bookmarkFind(d->url, false, &thebg);
-    if (it != d->knownFiles.end()) {
-        for (KBookmark bm = thebg.first(); !bm.isNull(); bm = thebg.next(bm)) {
-            if (bm.isSeparator() || bm.isGroup())
-                continue;
-
-            DocumentViewport vp(bm.url().fragment(QUrl::FullyDecoded));
-            if (!vp.isValid())
-                continue;
-
-            d->urlBookmarks[vp.pageNumber]++;
-        }
-    }
+    d->indexBookmarks();
+    for (const IndexedBookmark &bm : qAsConst(d->sortedBookmarks))
+        d->urlBookmarks[bm.first.pageNumber]++;
 }
 
 bool BookmarkManager::setPageBookmark(int page)
@@ -641,6 +666,7 @@ bool BookmarkManager::setPageBookmark(int page)
         QUrl newurl = d->url;
         newurl.setFragment(vp.toString(), QUrl::DecodedMode);
         thebg.addBookmark(QLatin1String("#") + QString::number(vp.pageNumber + 1), newurl, QString());
+        d->indexBookmarks();
         added = true;
         d->manager->emitChanged(thebg);
     }
@@ -654,20 +680,15 @@ bool BookmarkManager::removePageBookmark(int page)
     if (it == d->knownFiles.end())
         return false;
 
-    bool found = false;
-    for (KBookmark bm = thebg.first(); !found && !bm.isNull(); bm = thebg.next(bm)) {
-        if (bm.isSeparator() || bm.isGroup())
-            continue;
+    const KBookmark bm = bookmark(page);
+    if (bm.isNull())
+        return false;
 
-        DocumentViewport vp(bm.url().fragment(QUrl::FullyDecoded));
-        if (vp.isValid() && vp.pageNumber == page) {
-            found = true;
-            thebg.deleteBookmark(bm);
-            d->urlBookmarks[page]--;
-            d->manager->emitChanged(thebg);
-        }
-    }
-    return found;
+    thebg.deleteBookmark(bm);
+    d->indexBookmarks();
+    d->urlBookmarks[page]--;
+    d->manager->emitChanged(thebg);
+    return true;
 }
 
 bool BookmarkManager::isBookmarked(int page) const
@@ -684,37 +705,16 @@ bool BookmarkManager::isBookmarked(const DocumentViewport &viewport) const
 
 KBookmark BookmarkManager::nextBookmark(const DocumentViewport &viewport) const
 {
-    KBookmark::List bmarks = bookmarks();
-    std::sort(bmarks.begin(), bmarks.end(), bookmarkLessThan);
-
-    KBookmark bookmark;
-    for (const KBookmark &bm : qAsConst(bmarks)) {
-        DocumentViewport vp(bm.url().fragment(QUrl::FullyDecoded));
-        if (viewport < vp) {
-            bookmark = bm;
-            break;
-        }
-    }
-
-    return bookmark;
+    // the first one after viewport
+    const auto it = std::upper_bound(d->sortedBookmarks.constBegin(), d->sortedBookmarks.constEnd(), qMakePair(viewport, KBookmark()), indexedBookmarkLessThan);
+    return it != d->sortedBookmarks.constEnd() ? it->second : KBookmark();
 }
 
 KBookmark BookmarkManager::previousBookmark(const DocumentViewport &viewport) const
 {
-    KBookmark::List bmarks = bookmarks();
-    std::sort(bmarks.begin(), bmarks.end(), bookmarkLessThan);
-
-    KBookmark bookmark;
-    for (KBookmark::List::const_iterator it = bmarks.constEnd(); it != bmarks.constBegin(); --it) {
-        KBookmark bm = *(it - 1);
-        DocumentViewport vp(bm.url().fragment(QUrl::FullyDecoded));
-        if (vp < viewport) {
-            bookmark = bm;
-            break;
-        }
-    }
-
-    return bookmark;
+    // the last one before viewport
+    const auto it = std::lower_bound(d->sortedBookmarks.constBegin(), d->sortedBookmarks.constEnd(), qMakePair(viewport, KBookmark()), indexedBookmarkLessThan);
+    return it != d->sortedBookmarks.constBegin() ? (it - 1)->second : KBookmark();
 }
 
 #undef foreachObserver
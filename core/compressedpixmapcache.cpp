@@ -0,0 +1,111 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "compressedpixmapcache_p.h"
+
+#include <QPixmap>
+
+#include <climits>
+#include <cstring>
+
+using namespace Okular;
+
+// fastest zlib level, rendered pages are mostly runs of the same color so it
+// still compresses them a lot
+static const int kCompressionLevel = 1;
+
+static int costOf(const QByteArray &data)
+{
+    return qMax(1, data.size() / 1024);
+}
+
+CompressedPixmapCache::CompressedPixmapCache()
+{
+    m_entries.setMaxCost(0);
+}
+
+void CompressedPixmapCache::setMaxBytes(qulonglong maxBytes)
+{
+    m_entries.setMaxCost(int(qMin<qulonglong>(maxBytes / 1024, INT_MAX)));
+}
+
+bool CompressedPixmapCache::isEnabled() const
+{
+    return m_entries.maxCost() > 0;
+}
+
+bool CompressedPixmapCache::insert(DocumentObserver *observer, int page, Rotation rotation, const QPixmap &pixmap)
+{
+    const Key key(observer, page);
+    m_entries.remove(key);
+    if (!isEnabled() || pixmap.isNull())
+        return false;
+
+    const QImage image = pixmap.toImage();
+    Entry *entry = new Entry;
+    entry->data = qCompress(image.constBits(), int(image.sizeInBytes()), kCompressionLevel);
+    entry->size = image.size();
+    entry->bytesPerLine = image.bytesPerLine();
+    entry->format = image.format();
+    entry->devicePixelRatio = image.devicePixelRatio();
+    entry->rotation = rotation;
+
+    // QCache deletes the entry if it is too big by itself
+    return m_entries.insert(key, entry, costOf(entry->data));
+}
+
+QPixmap *CompressedPixmapCache::take(DocumentObserver *observer, int page, int width, int height, Rotation rotation)
+{
+    Entry *entry = m_entries.take(Key(observer, page));
+    if (!entry)
+        return nullptr;
+
+    QPixmap *pixmap = nullptr;
+    if (entry->size == QSize(width, height) && entry->rotation == rotation) {
+        const QByteArray bits = qUncompress(entry->data);
+        QImage image(entry->size, entry->format);
+        if (!image.isNull() && image.bytesPerLine() == entry->bytesPerLine && bits.size() == image.sizeInBytes()) {
+            memcpy(image.bits(), bits.constData(), bits.size());
+            image.setDevicePixelRatio(entry->devicePixelRatio);
+            pixmap = new QPixmap(QPixmap::fromImage(std::move(image)));
+        }
+    }
+    delete entry;
+    return pixmap;
+}
+
+void CompressedPixmapCache::removePage(int page)
+{
+    const QList<Key> keys = m_entries.keys();
+    for (const Key &key : keys) {
+        if (key.second == page)
+            m_entries.remove(key);
+    }
+}
+
+void CompressedPixmapCache::removeObserver(DocumentObserver *observer)
+{
+    const QList<Key> keys = m_entries.keys();
+    for (const Key &key : keys) {
+        if (key.first == observer)
+            m_entries.remove(key);
+    }
+}
+
+void CompressedPixmapCache::clear()
+{
+    m_entries.clear();
+}
+
+int CompressedPixmapCache::count() const
+{
+    return m_entries.count();
+}
+
+qulonglong CompressedPixmapCache::totalBytes() const
+{
+    return qulonglong(m_entries.totalCost()) * 1024;
+}
@@ -0,0 +1,97 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_COMPRESSEDPIXMAPCACHE_P_H_
+#define _OKULAR_COMPRESSEDPIXMAPCACHE_P_H_
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QPair>
+
+#include "global.h"
+#include "okularcore_export.h"
+
+class QPixmap;
+
+namespace Okular
+{
+class DocumentObserver;
+
+/**
+ * Second tier of the pixmap cache.
+ *
+ * When the document needs to free memory, the pixmaps it evicts are kept
+ * here compressed instead of being thrown away, so going back to a page
+ * costs a decompression instead of a whole new render by the generator.
+ *
+ * There is at most one entry for each observer and page, the least recently
+ * used ones are dropped when the compressed data goes over the budget.
+ */
+class OKULARCORE_EXPORT CompressedPixmapCache
+{
+public:
+    CompressedPixmapCache();
+
+    /**
+     * Sets the budget for the compressed data, 0 disables the cache.
+     */
+    void setMaxBytes(qulonglong maxBytes);
+
+    bool isEnabled() const;
+
+    /**
+     * Compresses @p pixmap, shown by @p observer for @p page with the given
+     * @p rotation, and keeps it. Returns whether it fit in the budget.
+     */
+    bool insert(DocumentObserver *observer, int page, Rotation rotation, const QPixmap &pixmap);
+
+    /**
+     * Removes the entry of @p observer for @p page and, if it has the
+     * given size and @p rotation, returns the decompressed pixmap.
+     * Returns nullptr otherwise.
+     */
+    QPixmap *take(DocumentObserver *observer, int page, int width, int height, Rotation rotation);
+
+    /**
+     * Forgets the entries of all the observers for @p page.
+     */
+    void removePage(int page);
+
+    /**
+     * Forgets the entries of @p observer.
+     */
+    void removeObserver(DocumentObserver *observer);
+
+    void clear();
+
+    int count() const;
+
+    /**
+     * The size of all the compressed data, in bytes (rounded to KiB).
+     */
+    qulonglong totalBytes() const;
+
+private:
+    Q_DISABLE_COPY(CompressedPixmapCache)
+
+    struct Entry {
+        QByteArray data;
+        QSize size;
+        int bytesPerLine;
+        QImage::Format format;
+        qreal devicePixelRatio;
+        Rotation rotation;
+    };
+    typedef QPair<DocumentObserver *, int> Key;
+
+    // costs are in KiB, so big budgets fit in an int
+    QCache<Key, Entry> m_entries;
+};
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "diskcache_p.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "debug_p.h"
+
+using namespace Okular;
+
+DiskCache::DiskCache(const QString &name, qint64 maxBytes)
+    : m_directory(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/okular/") + name)
+    , m_maxBytes(maxBytes)
+{
+}
+
+QString DiskCache::directory() const
+{
+    return m_directory;
+}
+
+QByteArray DiskCache::fileKey(const QString &fileName)
+{
+    const QFileInfo fi(fileName);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(fi.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(fi.size()));
+    hash.addData(QByteArray::number(fi.lastModified().toMSecsSinceEpoch()));
+    return hash.result().toHex();
+}
+
+QString DiskCache::fileName(const QByteArray &key) const
+{
+    return m_directory + QLatin1Char('/') + QString::fromLatin1(key);
+}
+
+QByteArray DiskCache::read(const QByteArray &key) const
+{
+    QFile file(fileName(key));
+    if (!file.open(QIODevice::ReadWrite))
+        return QByteArray();
+
+    // the ones read last go last when pruning
+    file.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+    return file.readAll();
+}
+
+bool DiskCache::write(const QByteArray &key, const QByteArray &data) const
+{
+    if (!QDir().mkpath(m_directory))
+        return false;
+
+    QSaveFile file(fileName(key));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !file.commit()) {
+        qCDebug(OkularCoreDebug) << "Could not write the cache entry" << fileName(key);
+        return false;
+    }
+
+    prune();
+    return true;
+}
+
+bool DiskCache::moveIn(const QString &sourceFileName, const QByteArray &key) const
+{
+    const QString target = fileName(key);
+    // somebody else may have made it by now, then it is the same
+    QFile::remove(target);
+    if (!QDir().mkpath(m_directory) || !QFile::rename(sourceFileName, target)) {
+        QFile::remove(sourceFileName);
+        return false;
+    }
+
+    prune();
+    return true;
+}
+
+void DiskCache::prune() const
+{
+    QFileInfoList entries = QDir(m_directory).entryInfoList(QDir::Files, QDir::Time);
+    qint64 bytes = 0;
+    for (const QFileInfo &entry : qAsConst(entries))
+        bytes += entry.size();
+
+    // newest first
+    while (bytes > m_maxBytes && !entries.isEmpty()) {
+        const QFileInfo oldest = entries.takeLast();
+        if (QFile::remove(oldest.absoluteFilePath()))
+            bytes -= oldest.size();
+    }
+}
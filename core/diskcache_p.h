@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_DISKCACHE_P_H_
+#define _OKULAR_DISKCACHE_P_H_
+
+#include <QByteArray>
+#include <QString>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * Small files kept about the documents from one time they are open to the
+ * next, like the page information the generators would otherwise read
+ * again, in a folder of their own of the cache of Okular.
+ *
+ * The entries are named by a key, usually fileKey() of the document, and
+ * written with QSaveFile so a reader never sees half of one. Once the
+ * folder has more than its limit the entries used the longest ago go.
+ *
+ * All the methods can be called from any thread.
+ */
+class OKULARCORE_EXPORT DiskCache
+{
+public:
+    /**
+     * The cache in the folder @p name of the cache of Okular, that keeps
+     * up to @p maxBytes of entries.
+     */
+    explicit DiskCache(const QString &name, qint64 maxBytes = 32 * 1024 * 1024);
+
+    QString directory() const;
+
+    /**
+     * A key for the file @p fileName as it is now: it changes with its
+     * path, size and modification time.
+     */
+    static QByteArray fileKey(const QString &fileName);
+
+    /**
+     * Where the entry of @p key is, whether it exists or not.
+     */
+    QString fileName(const QByteArray &key) const;
+
+    /**
+     * The contents of the entry of @p key, empty if there is none.
+     */
+    QByteArray read(const QByteArray &key) const;
+
+    /**
+     * Replaces the entry of @p key with @p data, and returns whether it could.
+     */
+    bool write(const QByteArray &key, const QByteArray &data) const;
+
+    /**
+     * Makes the file @p sourceFileName the entry of @p key, removing it if
+     * it can't, and returns whether it could.
+     */
+    bool moveIn(const QString &sourceFileName, const QByteArray &key) const;
+
+private:
+    void prune() const;
+
+    QString m_directory;
+    qint64 m_maxBytes;
+};
+
+}
+
+#endif
@@ -12,6 +12,7 @@
 #include "document_p.h"
 #include "documentcommands_p.h"
 
+#include <algorithm>
 #include <limits.h>
 #include <memory>
 #ifdef Q_OS_WIN
@@ -28,8 +29,10 @@
 
 // qt/kde/system includes
 #include <QApplication>
+#include <QDataStream>
 #include <QDesktopServices>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QLabel>
@@ -61,6 +64,7 @@
 #include <KShell>
 #include <Kdelibs4Migration>
 #include <kzip.h>
+#include <threadweaver/queueing.h>
 
 // local includes
 #include "action.h"
@@ -72,16 +76,21 @@
 #include "chooseenginedialog_p.h"
 #include "debug_p.h"
 #include "form.h"
+#include "functiontask_p.h"
 #include "generator_p.h"
+#include "generatorindex_p.h"
+#include "imagebufferpool_p.h"
 #include "interfaces/configinterface.h"
 #include "interfaces/guiinterface.h"
 #include "interfaces/printinterface.h"
 #include "interfaces/saveinterface.h"
 #include "misc.h"
 #include "observer.h"
+#include "outline.h"
 #include "page.h"
 #include "page_p.h"
 #include "pagecontroller_p.h"
+#include "requesttrace_p.h"
 #include "script/event_p.h"
 #include "scripter.h"
 #include "settings_core.h"
@@ -103,20 +112,6 @@
 
 using namespace Okular;
 
-struct AllocatedPixmap {
-    // owner of the page
-    DocumentObserver *observer;
-    int page;
-    qulonglong memory;
-    // public constructor: initialize data
-    AllocatedPixmap(DocumentObserver *o, int p, qulonglong m)
-        : observer(o)
-        , page(p)
-        , memory(m)
-    {
-    }
-};
-
 struct ArchiveData {
     ArchiveData()
     {
@@ -139,8 +134,31 @@ struct RunningSearch {
     Qt::CaseSensitivity cachedCaseSensitivity;
     bool cachedViewportMove : 1;
     bool isCurrentlySearching : 1;
+    // set by Document::cancelSearch(int), until the next search
+    bool cancelled : 1;
     QColor cachedColor;
     int pagesDone;
+    // pages that may match, the others are skipped by whole document searches
+    QBitArray candidatePages;
+    // the words of a whole document search, the whole text for AllDocument
+    QStringList searchWords;
+    // given to every new search, tells apart the results of older ones
+    int generation;
+    // set to stop the search thread, while it runs
+    QSharedPointer<QAtomicInt> abortSearch;
+    // the last whole document search that went through all its pages, and the
+    // pages it matched: a search for more than it can only match among them,
+    // or among the pages the document got since
+    QStringList completedWords;
+    Document::SearchType completedType;
+    Qt::CaseSensitivity completedCaseSensitivity;
+    QSet<int> completedPages;
+    int completedPageCount;
+    // the pages after the last match of a NextMatch or PreviousMatch search,
+    // in its direction, that the text search index says may match, and the
+    // first match on them when they have their text
+    QVector<int> upcomingMatchPages;
+    QVector<NormalizedRect> upcomingMatchRects;
 };
 
 #define foreachObserver(cmd)                                                                                                                                                                                                                   \
@@ -165,6 +183,58 @@ struct RunningSearch {
 // how often to run slotTimedMemoryCheck
 const int kMemCheckTime = 2000; // in msec
 
+// how much smaller than the real one the previews of progressive requests are
+const int kPreviewScale = 4;
+// ... and the smallest preview worth doing
+const int kPreviewMinimumSize = 64; // in pixels
+
+// at most how many requests go to a generator supporting BatchedRendering at once
+const int kMaxPixmapRequestBatch = 32;
+// ... and how big they can be
+const long kMaxBatchedPixmapArea = 400L * 400L; // in pixels
+
+// at most how many threads extract the text of the pages
+const int kMaxTextPageThreads = 2;
+
+// what the text page of a page is guessed to take before any is known
+const qulonglong kTextPageBytesGuess = 16 * 1024;
+
+// how many pages ahead of a search the text is extracted
+const int kSearchTextPageLookahead = 4;
+
+// at most how many pages with matches ahead of a search the views preload
+const int kSearchUpcomingMatchPages = 2;
+
+// how many pages a background render finds the bounding boxes of at a time
+const int kBoundingBoxBatchSize = 8;
+
+// how much an embedded thumbnail can be scaled up to stand in for a render
+const double kMaxEmbeddedThumbnailUpscale = 2.0;
+
+// how much the small copies of the pages kept for when they have no pixmap
+// can take, apart from the pixmaps
+const qulonglong kPagePreviewsMemory = 48 * 1024 * 1024; // in bytes
+
+// how long the main thread spends at a time filling in the page data left
+// out by generators with LazyPageData
+const int kPageDataSliceTime = 10; // in msec
+// ... and how long it waits while the generator is busy
+const int kPageDataRetryTime = 100; // in msec
+
+// how long the main thread waits between two slices of the pages of
+// generators with IncrementalPages, so that it stays responsive
+const int kMorePagesInterval = 20; // in msec
+
+// how long no drafts must be asked for before the pages that got one are
+// rendered again at full quality
+const int kDraftRefineDelay = 300; // in msec
+
+// added to the priority of the pages shown when the document opens where it
+// was left, so they come before all the others (even the synchronous ones)
+// in the order of their observers, and how long the rest waits for them at most
+const int kWarmStartPriority = -16;
+const int kWarmStartTimeout = 1000; // in msec
+
 /***** Document ******/
 
 QString DocumentPrivate::pagesSizeString() const
@@ -253,32 +323,38 @@ qulonglong DocumentPrivate::calculateMemoryToFree()
     // [MEM] choose memory parameters based on configuration profile
     qulonglong clipValue = 0;
     qulonglong memoryToFree = 0;
+    // the buffers of the evicted pixmaps wait for the next renders, they are memory too,
+    // like the pages the generator keeps for itself
+    // the budget is for all the documents of the process
+    qulonglong allocatedMemory = ImageBufferPool::instance()->idleBytes();
+    for (const DocumentPrivate *document : qAsConst(allDocuments()))
+        allocatedMemory += document->cachedMemory();
 
     switch (SettingsCore::memoryLevel()) {
     case SettingsCore::EnumMemoryLevel::Low:
-        memoryToFree = m_allocatedPixmapsTotalMemory;
+        memoryToFree = allocatedMemory;
         break;
 
     case SettingsCore::EnumMemoryLevel::Normal: {
         qulonglong thirdTotalMemory = getTotalMemory() / 3;
         qulonglong freeMemory = getFreeMemory();
-        if (m_allocatedPixmapsTotalMemory > thirdTotalMemory)
-            memoryToFree = m_allocatedPixmapsTotalMemory - thirdTotalMemory;
-        if (m_allocatedPixmapsTotalMemory > freeMemory)
-            clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
+        if (allocatedMemory > thirdTotalMemory)
+            memoryToFree = allocatedMemory - thirdTotalMemory;
+        if (allocatedMemory > freeMemory)
+            clipValue = (allocatedMemory - freeMemory) / 2;
     } break;
 
     case SettingsCore::EnumMemoryLevel::Aggressive: {
         qulonglong freeMemory = getFreeMemory();
-        if (m_allocatedPixmapsTotalMemory > freeMemory)
-            clipValue = (m_allocatedPixmapsTotalMemory - freeMemory) / 2;
+        if (allocatedMemory > freeMemory)
+            clipValue = (allocatedMemory - freeMemory) / 2;
     } break;
     case SettingsCore::EnumMemoryLevel::Greedy: {
         qulonglong freeSwap;
         qulonglong freeMemory = getFreeMemory(&freeSwap);
         const qulonglong memoryLimit = qMin(qMax(freeMemory, getTotalMemory() / 2), freeMemory + freeSwap);
-        if (m_allocatedPixmapsTotalMemory > memoryLimit)
-            clipValue = (m_allocatedPixmapsTotalMemory - memoryLimit) / 2;
+        if (allocatedMemory > memoryLimit)
+            clipValue = (allocatedMemory - memoryLimit) / 2;
     } break;
     }
 
@@ -288,16 +364,90 @@ qulonglong DocumentPrivate::calculateMemoryToFree()
     return memoryToFree;
 }
 
+qulonglong DocumentPrivate::pixmapMemoryLimit()
+{
+    // the amount of pixmaps from which calculateMemoryToFree() starts asking for memory back
+    switch (SettingsCore::memoryLevel()) {
+    case SettingsCore::EnumMemoryLevel::Low:
+        return 0;
+
+    case SettingsCore::EnumMemoryLevel::Normal:
+        return qMin(getTotalMemory() / 3, getFreeMemory());
+
+    case SettingsCore::EnumMemoryLevel::Aggressive:
+        return getFreeMemory();
+
+    case SettingsCore::EnumMemoryLevel::Greedy: {
+        qulonglong freeSwap;
+        qulonglong freeMemory = getFreeMemory(&freeSwap);
+        return qMin(qMax(freeMemory, getTotalMemory() / 2), freeMemory + freeSwap);
+    }
+    }
+    return 0;
+}
+
 void DocumentPrivate::cleanupPixmapMemory()
 {
     cleanupPixmapMemory(calculateMemoryToFree());
 }
 
+QVector<DocumentPrivate *> &DocumentPrivate::allDocuments()
+{
+    static QVector<DocumentPrivate *> documents;
+    return documents;
+}
+
+qulonglong DocumentPrivate::cachedMemory() const
+{
+    return m_allocatedPixmapsTotalMemory + (m_generator ? m_generator->cachedMemory() : 0);
+}
+
 void DocumentPrivate::cleanupPixmapMemory(qulonglong memoryToFree)
 {
     if (memoryToFree < 1)
         return;
 
+    // the idle render buffers go first, nobody sees them go
+    const qulonglong trimmed = ImageBufferPool::instance()->trim(memoryToFree);
+    memoryToFree = trimmed < memoryToFree ? memoryToFree - trimmed : 0;
+    if (memoryToFree == 0)
+        return;
+
+    // then the documents in the background tabs, then this one, then the
+    // other ones on screen
+    QVector<DocumentPrivate *> documents;
+    for (DocumentPrivate *document : qAsConst(allDocuments())) {
+        if (document != this && !document->m_active)
+            documents.append(document);
+    }
+    documents.append(this);
+    for (DocumentPrivate *document : qAsConst(allDocuments())) {
+        if (document != this && document->m_active)
+            documents.append(document);
+    }
+
+    for (DocumentPrivate *document : qAsConst(documents)) {
+        const qulonglong freed = document->freeDocumentMemory(memoryToFree);
+        memoryToFree = freed < memoryToFree ? memoryToFree - freed : 0;
+        if (memoryToFree == 0)
+            return;
+    }
+}
+
+qulonglong DocumentPrivate::freeDocumentMemory(qulonglong memoryToFree)
+{
+    const qulonglong memoryBefore = cachedMemory();
+
+    // nobody looks at the text of a background document, it is extracted again when needed
+    if (!m_active)
+        releaseTextPages();
+
+    // the pages the generator keeps go first, the pixmaps have them already
+    if (m_generator) {
+        const qulonglong freed = m_generator->freeCachedMemory(memoryToFree);
+        memoryToFree = freed < memoryToFree ? memoryToFree - freed : 0;
+    }
+
     const int currentViewportPage = (*m_viewportIterator).pageNumber;
 
     // Create a QMap of visible rects, indexed by page number
@@ -324,55 +474,85 @@ void DocumentPrivate::cleanupPixmapMemory(qulonglong memoryToFree)
         else
             memoryToFree -= p->memory;
         pagesFreed++;
+        ++observerStatistics(p->observer)->evictedPixmaps;
+        // keep it compressed, in case the user comes back to it
+        demotePixmap(p->observer, p->page);
         // delete pixmap
         m_pagesVector.at(p->page)->deletePixmap(p->observer);
         // delete allocation descriptor
         delete p;
     }
 
-    // If we're still on low memory, try to free individual tiles
+    // If we're still on low memory, try to free individual tiles.
+    // Rank the tiles of all pages together, so the coldest ones go first
+    // wherever they are, instead of emptying one page before the next.
+    if (memoryToFree > 0)
+        cleanupTilesMemory(memoryToFree, visibleRects, currentViewportPage);
 
-    // Store pages that weren't completely removed
-
-    QLinkedList<AllocatedPixmap *> pixmapsToKeep;
-    while (memoryToFree > 0) {
-        int clean_hits = 0;
-        for (DocumentObserver *observer : qAsConst(m_observers)) {
-            AllocatedPixmap *p = searchLowestPriorityPixmap(false, true, observer);
-            if (!p) // No pixmap to remove
-                continue;
-
-            clean_hits++;
-
-            TilesManager *tilesManager = m_pagesVector.at(p->page)->d->tilesManager(observer);
-            if (tilesManager && tilesManager->totalMemory() > 0) {
-                qulonglong memoryDiff = p->memory;
-                NormalizedRect visibleRect;
-                if (visibleRects.contains(p->page))
-                    visibleRect = visibleRects[p->page]->rect;
+    // p--rintf("freeMemory A:[%d -%d = %d] \n", m_allocatedPixmaps.count() + pagesFreed, pagesFreed, m_allocatedPixmaps.count() );
+    const qulonglong memoryAfter = cachedMemory();
+    return memoryAfter < memoryBefore ? memoryBefore - memoryAfter : 0;
+}
 
-                // Free non visible tiles
-                tilesManager->cleanupPixmapMemory(memoryToFree, visibleRect, currentViewportPage);
+void DocumentPrivate::releaseTextPages()
+{
+    const QVector<int> pages = m_allocatedTextPages.pages();
+    for (int pageNumber : pages)
+        m_pagesVector.at(pageNumber)->setTextPage(nullptr); // deletes the textpage
+    m_allocatedTextPages.clear();
+}
 
-                p->memory = tilesManager->totalMemory();
-                memoryDiff -= p->memory;
-                memoryToFree = (memoryDiff < memoryToFree) ? (memoryToFree - memoryDiff) : 0;
-                m_allocatedPixmapsTotalMemory -= memoryDiff;
+void DocumentPrivate::cleanupTilesMemory(qulonglong memoryToFree, const QMap<int, VisiblePageRect *> &visibleRects, int currentViewportPage)
+{
+    struct RankedTile {
+        AllocatedPixmap *allocatedPixmap;
+        TilesManager *tilesManager;
+        TileNode *tile;
+        double distance;
+    };
+    QVector<RankedTile> rankedTiles;
+    m_allocatedPixmaps.forEach([&](AllocatedPixmap *p) {
+        TilesManager *tilesManager = m_pagesVector.at(p->page)->d->tilesManager(p->observer);
+        if (!tilesManager || tilesManager->totalMemory() == 0)
+            return;
 
-                if (p->memory > 0)
-                    pixmapsToKeep.append(p);
-                else
-                    delete p;
-            } else
-                pixmapsToKeep.append(p);
+        const VisiblePageRect *visibleRect = visibleRects.value(p->page);
+        QList<TileNode *> tiles;
+        tilesManager->evictableTiles(tiles, visibleRect ? visibleRect->rect : NormalizedRect(), currentViewportPage);
+        for (TileNode *tile : qAsConst(tiles)) {
+            // the distance of the tiles of hidden pages is within their page
+            // (0 to 1), put them after the visible pages (0 to 2) and the
+            // farther the page the earlier they go
+            const double distance = visibleRect ? tile->distance : 2 + qAbs(p->page - currentViewportPage) + tile->distance;
+            rankedTiles.append({p, tilesManager, tile, distance});
         }
-
-        if (clean_hits == 0)
+    });
+
+    // dirty tiles first, then the farthest ones, then the least recently used
+    std::sort(rankedTiles.begin(), rankedTiles.end(), [](const RankedTile &a, const RankedTile &b) {
+        if (a.tile->dirty != b.tile->dirty)
+            return a.tile->dirty;
+        if (a.distance != b.distance)
+            return a.distance > b.distance;
+        return a.tile->lastUsed < b.tile->lastUsed;
+    });
+
+    QVector<AllocatedPixmap *> emptiedPixmaps;
+    for (const RankedTile &rankedTile : qAsConst(rankedTiles)) {
+        if (memoryToFree == 0)
             break;
+
+        const qulonglong bytes = qMin(rankedTile.tilesManager->evictTile(rankedTile.tile), rankedTile.allocatedPixmap->memory);
+        rankedTile.allocatedPixmap->memory -= bytes;
+        m_allocatedPixmapsTotalMemory -= bytes;
+        memoryToFree = (bytes < memoryToFree) ? (memoryToFree - bytes) : 0;
+
+        if (rankedTile.allocatedPixmap->memory == 0)
+            emptiedPixmaps << rankedTile.allocatedPixmap;
     }
 
-    m_allocatedPixmaps += pixmapsToKeep;
-    // p--rintf("freeMemory A:[%d -%d = %d] \n", m_allocatedPixmaps.count() + pagesFreed, pagesFreed, m_allocatedPixmaps.count() );
+    for (AllocatedPixmap *p : qAsConst(emptiedPixmaps))
+        delete m_allocatedPixmaps.take(p->observer, p->page);
 }
 
 /* Returns the next pixmap to evict from cache, or NULL if no suitable pixmap
@@ -382,33 +562,17 @@ void DocumentPrivate::cleanupPixmapMemory(qulonglong memoryToFree)
  */
 AllocatedPixmap *DocumentPrivate::searchLowestPriorityPixmap(bool unloadableOnly, bool thenRemoveIt, DocumentObserver *observer)
 {
-    QLinkedList<AllocatedPixmap *>::iterator pIt = m_allocatedPixmaps.begin();
-    QLinkedList<AllocatedPixmap *>::iterator pEnd = m_allocatedPixmaps.end();
-    QLinkedList<AllocatedPixmap *>::iterator farthestPixmap = pEnd;
     const int currentViewportPage = (*m_viewportIterator).pageNumber;
 
-    /* Find the pixmap that is farthest from the current viewport */
-    int maxDistance = -1;
-    while (pIt != pEnd) {
-        const AllocatedPixmap *p = *pIt;
-        // Filter by observer
-        if (observer == nullptr || p->observer == observer) {
-            const int distance = qAbs(p->page - currentViewportPage);
-            if (maxDistance < distance && (!unloadableOnly || p->observer->canUnloadPixmap(p->page))) {
-                maxDistance = distance;
-                farthestPixmap = pIt;
-            }
-        }
-        ++pIt;
-    }
+    /* Find the pixmap that is far from the current viewport and the least expensive to render again */
+    AllocatedPixmap *selectedPixmap = m_allocatedPixmaps.leastValuableFrom(currentViewportPage, unloadableOnly, observer);
 
     /* No pixmap to remove */
-    if (farthestPixmap == pEnd)
+    if (!selectedPixmap)
         return nullptr;
 
-    AllocatedPixmap *selectedPixmap = *farthestPixmap;
     if (thenRemoveIt)
-        m_allocatedPixmaps.erase(farthestPixmap);
+        m_allocatedPixmaps.take(selectedPixmap->observer, selectedPixmap->page);
     return selectedPixmap;
 }
 
@@ -429,8 +593,14 @@ qulonglong DocumentPrivate::getTotalMemory()
         QString entry = readStream.readLine();
         if (entry.isNull())
             break;
-        if (entry.startsWith(QLatin1String("MemTotal:")))
-            return (cachedValue = (Q_UINT64_C(1024) * entry.section(QLatin1Char(' '), -2, -2).toULongLong()));
+        if (entry.startsWith(QLatin1String("MemTotal:"))) {
+            cachedValue = Q_UINT64_C(1024) * entry.section(QLatin1Char(' '), -2, -2).toULongLong();
+            // inside a container the cgroup limit is what we really have
+            const qulonglong cgroupLimit = CGroupMemory::limit();
+            if (cgroupLimit && cgroupLimit < cachedValue)
+                cachedValue = cgroupLimit;
+            return cachedValue;
+        }
     }
 #elif defined(Q_OS_FREEBSD)
     qulonglong physmem;
@@ -509,9 +679,14 @@ qulonglong DocumentPrivate::getFreeMemory(qulonglong *freeSwap)
 
     lastUpdate = QTime::currentTime();
 
+    cachedValue = Q_UINT64_C(1024) * memoryFree;
+    qulonglong cgroupAvailable;
+    if (CGroupMemory::available(&cgroupAvailable) && cgroupAvailable < cachedValue)
+        cachedValue = cgroupAvailable;
+
     if (freeSwap)
         *freeSwap = (cachedFreeSwap = (Q_UINT64_C(1024) * values[3]));
-    return (cachedValue = (Q_UINT64_C(1024) * memoryFree));
+    return cachedValue;
 #elif defined(Q_OS_FREEBSD)
     qulonglong cache, inact, free, psize;
     size_t cachelen, inactlen, freelen, psizelen;
@@ -557,6 +732,11 @@ bool DocumentPrivate::loadDocumentInfo(LoadDocumentInfoFlags loadWhat)
 
 bool DocumentPrivate::loadDocumentInfo(QFile &infoFile, LoadDocumentInfoFlags loadWhat)
 {
+    // the binary format has no page info, only the XML files of previous versions do
+    DocumentInfoFile binaryFile;
+    if (binaryFile.open(infoFile.fileName()))
+        return (loadWhat & LoadGeneralInfo) && loadDocumentInfo(binaryFile);
+
     if (!infoFile.exists() || !infoFile.open(QIODevice::ReadOnly))
         return false;
 
@@ -593,8 +773,18 @@ bool DocumentPrivate::loadDocumentInfo(QFile &infoFile, LoadDocumentInfoFlags lo
 
                     // pass the domElement to the right page, to read config data from
                     if (ok && pageNumber >= 0 && pageNumber < (int)m_pagesVector.count()) {
-                        if (m_pagesVector[pageNumber]->d->restoreLocalContents(pageElement))
+                        if (m_pagesVector[pageNumber]->d->restoreLocalContents(pageElement)) {
                             loadedAnything = true;
+                            // the copies the generator renders with don't have the restored annotations and forms
+                            if (m_generator)
+                                m_generator->pageModified(pageNumber);
+                        }
+                    } else if (ok && pageNumber >= 0 && m_generator && m_generator->hasFeature(Generator::IncrementalPages)) {
+                        // a page the generator gives later, see restoreUnloadedPagesInfo()
+                        if (m_unloadedPagesInfo.isNull())
+                            m_unloadedPagesInfo.appendChild(m_unloadedPagesInfo.createElement(QStringLiteral("pageList")));
+                        m_unloadedPagesInfo.documentElement().appendChild(m_unloadedPagesInfo.importNode(pageElement, true));
+                        loadedAnything = true;
                     }
                 }
                 pageNode = pageNode.nextSibling();
@@ -633,6 +823,50 @@ bool DocumentPrivate::loadDocumentInfo(QFile &infoFile, LoadDocumentInfoFlags lo
                         setRotationInternal(newrotation, false);
                         loadedAnything = true;
                     }
+                } else if (infoElement.tagName() == QLatin1String("boundingBoxes")) {
+                    // only if they were computed for the same file, with the same rotation (that is saved before them)
+                    const QString modified = QString::number(QFileInfo(m_docFileName).lastModified().toMSecsSinceEpoch());
+                    if (infoElement.attribute(QStringLiteral("rotation")).toInt() == (int)m_rotation && infoElement.attribute(QStringLiteral("modified")) == modified) {
+                        QDomNode pageNode = infoNode.firstChild();
+                        while (pageNode.isElement()) {
+                            const QDomElement pageElement = pageNode.toElement();
+                            pageNode = pageNode.nextSibling();
+
+                            bool ok;
+                            const int pageNumber = pageElement.attribute(QStringLiteral("number")).toInt(&ok);
+                            if (!ok || pageNumber < 0 || pageNumber >= m_pagesVector.count())
+                                continue;
+                            const NormalizedRect bbox(pageElement.attribute(QStringLiteral("left")).toDouble(),
+                                                      pageElement.attribute(QStringLiteral("top")).toDouble(),
+                                                      pageElement.attribute(QStringLiteral("right")).toDouble(),
+                                                      pageElement.attribute(QStringLiteral("bottom")).toDouble());
+                            m_pagesVector[pageNumber]->setBoundingBox(bbox);
+                            m_pagesVector[pageNumber]->d->m_isBoundingBoxApproximate = pageElement.attribute(QStringLiteral("approximate")).toInt() == 1;
+                            loadedAnything = true;
+                        }
+                    }
+                } else if (infoElement.tagName() == QLatin1String("fonts")) {
+                    // only if they were read from the same file, by the same generator
+                    const QString modified = QString::number(QFileInfo(m_docFileName).lastModified().toMSecsSinceEpoch());
+                    if (infoElement.attribute(QStringLiteral("generator")) == m_generatorName && infoElement.attribute(QStringLiteral("modified")) == modified) {
+                        m_fontsCache.clear();
+                        QDomNode fontNode = infoNode.firstChild();
+                        while (fontNode.isElement()) {
+                            const QDomElement fontElement = fontNode.toElement();
+                            fontNode = fontNode.nextSibling();
+
+                            FontInfo font;
+                            font.setName(fontElement.attribute(QStringLiteral("name")));
+                            font.setSubstituteName(fontElement.attribute(QStringLiteral("substituteName")));
+                            font.setType((FontInfo::FontType)fontElement.attribute(QStringLiteral("type")).toInt());
+                            font.setEmbedType((FontInfo::EmbedType)fontElement.attribute(QStringLiteral("embedType")).toInt());
+                            font.setFile(fontElement.attribute(QStringLiteral("file")));
+                            font.setCanBeExtracted(fontElement.attribute(QStringLiteral("canBeExtracted")).toInt());
+                            m_fontsCache.append(font);
+                        }
+                        m_fontsCached = true;
+                        loadedAnything = true;
+                    }
                 } else if (infoElement.tagName() == QLatin1String("views")) {
                     QDomNode viewNode = infoNode.firstChild();
                     while (viewNode.isElement()) {
@@ -660,6 +894,166 @@ bool DocumentPrivate::loadDocumentInfo(QFile &infoFile, LoadDocumentInfoFlags lo
     return loadedAnything;
 }
 
+bool DocumentPrivate::loadDocumentInfo(const DocumentInfoFile &file)
+{
+    bool loadedAnything = false;
+
+    // the rotation first, the bounding boxes are for one
+    QByteArray data = file.record(DocumentInfoFile::RotationRecord);
+    if (!data.isNull()) {
+        QDataStream stream(data);
+        stream.setVersion(DocumentInfoFile::streamVersion());
+        qint32 rotation = 0;
+        stream >> rotation;
+        if (stream.status() == QDataStream::Ok && rotation % 4 != 0) {
+            setRotationInternal(rotation % 4, false);
+            loadedAnything = true;
+        }
+    }
+
+    // only if they were computed for the same file, with the same rotation
+    const QString modified = QString::number(QFileInfo(m_docFileName).lastModified().toMSecsSinceEpoch());
+    data = file.record(DocumentInfoFile::BoundingBoxesRecord);
+    if (!data.isNull()) {
+        QDataStream stream(data);
+        stream.setVersion(DocumentInfoFile::streamVersion());
+        qint32 rotation = 0;
+        QString boxesModified;
+        stream >> rotation >> boxesModified;
+        if (stream.status() == QDataStream::Ok && rotation == (int)m_rotation && boxesModified == modified) {
+            const QStringList keys = file.keys(DocumentInfoFile::PageBoundingBoxRecord);
+            for (const QString &key : keys) {
+                bool ok;
+                const int pageNumber = key.toInt(&ok);
+                if (!ok || pageNumber < 0 || pageNumber >= m_pagesVector.count())
+                    continue;
+                QDataStream pageStream(file.record(DocumentInfoFile::PageBoundingBoxRecord, key));
+                pageStream.setVersion(DocumentInfoFile::streamVersion());
+                NormalizedRect bbox;
+                pageStream >> bbox.left >> bbox.top >> bbox.right >> bbox.bottom;
+                if (pageStream.status() != QDataStream::Ok)
+                    continue;
+                bool approximate = false;
+                if (!pageStream.atEnd())
+                    pageStream >> approximate;
+                m_pagesVector[pageNumber]->setBoundingBox(bbox);
+                m_pagesVector[pageNumber]->d->m_isBoundingBoxApproximate = approximate && pageStream.status() == QDataStream::Ok;
+                loadedAnything = true;
+            }
+        }
+    }
+
+    // only if they were read from the same file, by the same generator
+    data = file.record(DocumentInfoFile::FontsRecord);
+    if (!data.isNull()) {
+        QDataStream stream(data);
+        stream.setVersion(DocumentInfoFile::streamVersion());
+        QString generatorName, fontsModified;
+        qint32 count = 0;
+        stream >> generatorName >> fontsModified >> count;
+        if (stream.status() == QDataStream::Ok && generatorName == m_generatorName && fontsModified == modified) {
+            FontInfo::List fonts;
+            for (int i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+                QString name, substituteName, fileName;
+                qint32 type = 0, embedType = 0;
+                bool canBeExtracted = false;
+                stream >> name >> substituteName >> type >> embedType >> fileName >> canBeExtracted;
+
+                FontInfo font;
+                font.setName(name);
+                font.setSubstituteName(substituteName);
+                font.setType((FontInfo::FontType)type);
+                font.setEmbedType((FontInfo::EmbedType)embedType);
+                font.setFile(fileName);
+                font.setCanBeExtracted(canBeExtracted);
+                fonts.append(font);
+            }
+            if (stream.status() == QDataStream::Ok) {
+                m_fontsCache = fonts;
+                m_fontsCached = true;
+                loadedAnything = true;
+            }
+        }
+    }
+
+    data = file.record(DocumentInfoFile::HistoryRecord);
+    if (!data.isNull()) {
+        QDataStream stream(data);
+        stream.setVersion(DocumentInfoFile::streamVersion());
+        QStringList viewports;
+        stream >> viewports;
+        if (stream.status() == QDataStream::Ok && !viewports.isEmpty()) {
+            m_viewportHistory.clear();
+            for (const QString &viewport : qAsConst(viewports))
+                m_viewportIterator = m_viewportHistory.insert(m_viewportHistory.end(), DocumentViewport(viewport));
+            loadedAnything = true;
+        }
+    }
+
+    for (View *view : qAsConst(m_views)) {
+        data = file.record(DocumentInfoFile::ViewRecord, view->name());
+        if (!data.isNull()) {
+            loadViewsInfo(view, data);
+            loadedAnything = true;
+        }
+    }
+
+    return loadedAnything;
+}
+
+void DocumentPrivate::loadViewsInfo(View *view, const QByteArray &data)
+{
+    QDataStream stream(data);
+    stream.setVersion(DocumentInfoFile::streamVersion());
+    QMap<qint32, QVariant> capabilities;
+    stream >> capabilities;
+    if (stream.status() != QDataStream::Ok)
+        return;
+
+    for (QMap<qint32, QVariant>::const_iterator it = capabilities.constBegin(); it != capabilities.constEnd(); ++it) {
+        const View::ViewCapability capability = (View::ViewCapability)it.key();
+        if (capability == View::Zoom && it->toDouble() == 0)
+            continue;
+        if (view->supportsCapability(capability) && (view->capabilityFlags(capability) & (View::CapabilityRead | View::CapabilitySerializable)))
+            view->setCapability(capability, *it);
+    }
+}
+
+QByteArray DocumentPrivate::saveViewsInfo(View *view) const
+{
+    const auto serializable = [view](View::ViewCapability capability) {
+        return view->supportsCapability(capability) && (view->capabilityFlags(capability) & (View::CapabilityRead | View::CapabilitySerializable));
+    };
+
+    // what the XML format has
+    QMap<qint32, QVariant> capabilities;
+    if (serializable(View::Zoom) && serializable(View::ZoomModality)) {
+        bool ok = true;
+        const double zoom = view->capability(View::Zoom).toDouble(&ok);
+        if (ok && zoom != 0)
+            capabilities.insert(View::Zoom, zoom);
+        const int mode = view->capability(View::ZoomModality).toInt(&ok);
+        if (ok)
+            capabilities.insert(View::ZoomModality, mode);
+    }
+    if (serializable(View::Continuous))
+        capabilities.insert(View::Continuous, view->capability(View::Continuous).toBool());
+    if (serializable(View::ViewModeModality)) {
+        bool ok = true;
+        const int mode = view->capability(View::ViewModeModality).toInt(&ok);
+        if (ok)
+            capabilities.insert(View::ViewModeModality, mode);
+    }
+    if (serializable(View::TrimMargins))
+        capabilities.insert(View::TrimMargins, view->capability(View::TrimMargins).toBool());
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setVersion(DocumentInfoFile::streamVersion());
+    stream << capabilities;
+    return data;
+}
+
 void DocumentPrivate::loadViewsInfo(View *view, const QDomElement &e)
 {
     QDomNode viewNode = e.firstChild();
@@ -877,6 +1271,16 @@ Document::OpenResult DocumentPrivate::openDocumentInternal(const KPluginMetaData
     QMetaObject::Connection errorToOpenErrorConnection = QObject::connect(m_generator, &Generator::error, m_parent, [this](const QString &message) { m_openError = message; });
     QObject::connect(m_generator, &Generator::warning, m_parent, &Document::warning);
     QObject::connect(m_generator, &Generator::notice, m_parent, &Document::notice);
+    QObject::connect(m_generator, &Generator::pixmapGenerationReady, m_parent, [this] { generatorPixmapGenerationReady(); });
+    QObject::connect(m_generator, &Generator::signatureInfoChanged, m_parent, [this](int page) {
+        if (page >= 0 && page < m_pagesVector.count())
+            foreachObserverD(notifyPageChanged(page, DocumentObserver::SignatureInfo));
+    });
+    QObject::connect(m_generator, &Generator::pageDataReady, m_parent, [this](int page) { loadPageData(m_pagesVector.value(page)); });
+    QObject::connect(m_generator, &Generator::pageContentsChanged, m_parent, [this](int page) {
+        if (page >= 0 && page < m_pagesVector.count())
+            pageContentsChanged(page);
+    });
 
     QApplication::setOverrideCursor(Qt::WaitCursor);
 
@@ -1000,11 +1404,13 @@ void DocumentPrivate::performAddPageAnnotation(int page, Annotation *annotation)
         proxy->notifyAddition(annotation, page);
 
     // notify observers about the change
+    annotationAdded(page, annotation);
     notifyAnnotationChanges(page);
 
     if (annotation->flags() & Annotation::ExternallyDrawn) {
-        // Redraw everything, including ExternallyDrawn annotations
-        refreshPixmaps(page);
+        // Redraw where the annotation is, it was never rendered anywhere else
+        m_annotationRenderedRects.insert(annotation, annotation->boundingRectangle());
+        refreshAnnotationPixmaps(page, annotation->boundingRectangle());
     }
 }
 
@@ -1023,6 +1429,7 @@ void DocumentPrivate::performRemovePageAnnotation(int page, Annotation *annotati
         isExternallyDrawn = true;
     else
         isExternallyDrawn = false;
+    const NormalizedRect area = isExternallyDrawn ? annotationRefreshArea(annotation, true) : NormalizedRect();
 
     // try to remove the annotation
     if (m_parent->canRemovePageAnnotation(annotation)) {
@@ -1030,14 +1437,15 @@ void DocumentPrivate::performRemovePageAnnotation(int page, Annotation *annotati
         if (proxy && proxy->supports(AnnotationProxy::Removal))
             proxy->notifyRemoval(annotation, page);
 
+        annotationRemoved(page, annotation);
         kp->removeAnnotation(annotation); // Also destroys the object
 
         // in case of success, notify observers about the change
         notifyAnnotationChanges(page);
 
         if (isExternallyDrawn) {
-            // Redraw everything, including ExternallyDrawn annotations
-            refreshPixmaps(page);
+            // Redraw where the annotation was
+            refreshAnnotationPixmaps(page, area);
         }
     }
 }
@@ -1057,7 +1465,11 @@ void DocumentPrivate::performModifyPageAnnotation(int page, Annotation *annotati
         proxy->notifyModification(annotation, page, appearanceChanged);
     }
 
+    // it may have moved
+    kp->d->annotationMoved(annotation);
+
     // notify observers about the change
+    annotationModified(page, annotation);
     notifyAnnotationChanges(page);
     if (appearanceChanged && (annotation->flags() & Annotation::ExternallyDrawn)) {
         /* When an annotation is being moved, the generator will not render it.
@@ -1071,10 +1483,27 @@ void DocumentPrivate::performModifyPageAnnotation(int page, Annotation *annotati
             m_annotationBeingModified = false;
         }
 
-        // Redraw everything, including ExternallyDrawn annotations
+        // Redraw where the annotation was and where it is now
         qCDebug(OkularCoreDebug) << "Refreshing Pixmaps";
-        refreshPixmaps(page);
+        refreshAnnotationPixmaps(page, annotationRefreshArea(annotation));
+    }
+}
+
+NormalizedRect DocumentPrivate::annotationRefreshArea(const Annotation *annotation, bool forget)
+{
+    // the annotation is, or was, drawn where it was last rendered and where
+    // it is now; if we never saw it rendered, refresh the whole page
+    const NormalizedRect rect = annotation->boundingRectangle();
+    QHash<const Annotation *, NormalizedRect>::iterator it = m_annotationRenderedRects.find(annotation);
+    const NormalizedRect area = it != m_annotationRenderedRects.end() ? rect | *it : NormalizedRect();
+
+    if (forget) {
+        if (it != m_annotationRenderedRects.end())
+            m_annotationRenderedRects.erase(it);
+    } else {
+        m_annotationRenderedRects.insert(annotation, rect);
     }
+    return area;
 }
 
 void DocumentPrivate::performSetAnnotationContents(const QString &newContents, Annotation *annot, int pageNumber)
@@ -1109,60 +1538,111 @@ void DocumentPrivate::performSetAnnotationContents(const QString &newContents, A
     performModifyPageAnnotation(pageNumber, annot, appearanceChanged);
 }
 
-void DocumentPrivate::recalculateForms()
+void DocumentPrivate::buildFormIndex()
 {
+    m_formFieldsById.clear();
+    m_formFieldsByName.clear();
+    m_formFieldPages.clear();
+    m_formDependencies.clear();
+
+    for (const Page *p : qAsConst(m_pagesVector)) {
+        for (FormField *form : p->formFields()) {
+            m_formFieldsById[form->id()].append(form);
+            // the widgets of a field share its name, the first one stands for it
+            if (!m_formFieldsByName.contains(form->fullyQualifiedName()))
+                m_formFieldsByName.insert(form->fullyQualifiedName(), form);
+            m_formFieldPages.insert(form, p->number());
+        }
+    }
+
     const QVariant fco = m_parent->metaData(QStringLiteral("FormCalculateOrder"));
-    const QVector<int> formCalculateOrder = fco.value<QVector<int>>();
-    foreach (int formId, formCalculateOrder) {
-        for (uint pageIdx = 0; pageIdx < m_parent->pages(); pageIdx++) {
-            const Page *p = m_parent->page(pageIdx);
-            if (p) {
-                bool pageNeedsRefresh = false;
-                foreach (FormField *form, p->formFields()) {
-                    if (form->id() == formId) {
-                        Action *action = form->additionalAction(FormField::CalculateField);
-                        if (action) {
-                            FormFieldText *fft = dynamic_cast<FormFieldText *>(form);
-                            std::shared_ptr<Event> event;
-                            QString oldVal;
-                            if (fft) {
-                                // Prepare text calculate event
-                                event = Event::createFormCalculateEvent(fft, m_pagesVector[pageIdx]);
-                                if (!m_scripter)
-                                    m_scripter = new Scripter(this);
-                                m_scripter->setEvent(event.get());
-                                // The value maybe changed in javascript so save it first.
-                                oldVal = fft->text();
-                            }
+    m_formCalculateOrder = fco.value<QVector<int>>();
+    for (int formId : qAsConst(m_formCalculateOrder)) {
+        for (const FormField *form : m_formFieldsById.value(formId)) {
+            const Action *action = form->additionalAction(FormField::CalculateField);
+            if (action && action->actionType() == Action::Script)
+                m_formDependencies.addCalculation(formId, static_cast<const ScriptAction *>(action)->script());
+            else if (action)
+                m_formDependencies.addOpaqueCalculation(formId);
+        }
+    }
 
-                            m_parent->processAction(action);
-                            if (event && fft) {
-                                // Update text field from calculate
-                                m_scripter->setEvent(nullptr);
-                                const QString newVal = event->value().toString();
-                                if (newVal != oldVal) {
-                                    fft->setText(newVal);
-                                    fft->setAppearanceText(newVal);
-                                    if (const Okular::Action *action = fft->additionalAction(Okular::FormField::FormatField)) {
-                                        // The format action handles the refresh.
-                                        m_parent->processFormatAction(action, fft);
-                                    } else {
-                                        emit m_parent->refreshFormWidget(fft);
-                                        pageNeedsRefresh = true;
-                                    }
-                                }
-                            }
-                        } else {
-                            qWarning() << "Form that is part of calculate order doesn't have a calculate action";
-                        }
+    m_formIndexValid = true;
+}
+
+void DocumentPrivate::invalidateFormIndex()
+{
+    m_formIndexValid = false;
+    m_formFieldsById.clear();
+    m_formFieldsByName.clear();
+    m_formFieldPages.clear();
+    m_formCalculateOrder.clear();
+    m_formDependencies.clear();
+}
+
+void DocumentPrivate::recalculateForms(const QSet<QString> &changedFields)
+{
+    if (!m_formIndexValid)
+        buildFormIndex();
+
+    // calculations run in order, each that reads a changed field can change
+    // its own for the ones after it
+    QSet<QString> changed = changedFields;
+    QSet<int> pagesToRefresh;
+    for (int formId : qAsConst(m_formCalculateOrder)) {
+        if (!m_formDependencies.reads(formId, changed))
+            continue;
+
+        const QVector<FormField *> forms = m_formFieldsById.value(formId);
+        for (FormField *form : forms) {
+            Action *action = form->additionalAction(FormField::CalculateField);
+            if (!action) {
+                qWarning() << "Form that is part of calculate order doesn't have a calculate action";
+                continue;
+            }
+
+            const int pageIdx = m_formFieldPages.value(form, -1);
+            FormFieldText *fft = dynamic_cast<FormFieldText *>(form);
+            std::shared_ptr<Event> event;
+            QString oldVal;
+            if (fft) {
+                // Prepare text calculate event
+                event = Event::createFormCalculateEvent(fft, m_pagesVector.value(pageIdx));
+                if (!m_scripter)
+                    m_scripter = new Scripter(this);
+                m_scripter->setEvent(event.get());
+                // The value maybe changed in javascript so save it first.
+                oldVal = fft->text();
+            } else {
+                // no telling what it changed
+                changed.insert(form->fullyQualifiedName());
+            }
+
+            m_parent->processAction(action);
+            if (event && fft) {
+                // Update text field from calculate
+                m_scripter->setEvent(nullptr);
+                const QString newVal = event->value().toString();
+                if (newVal != oldVal) {
+                    changed.insert(fft->fullyQualifiedName());
+                    fft->setText(newVal);
+                    fft->setAppearanceText(newVal);
+                    if (const Okular::Action *action = fft->additionalAction(Okular::FormField::FormatField)) {
+                        // The format action handles the refresh.
+                        m_parent->processFormatAction(action, fft);
+                    } else {
+                        emit m_parent->refreshFormWidget(fft);
+                        pagesToRefresh.insert(pageIdx);
                     }
                 }
-                if (pageNeedsRefresh) {
-                    refreshPixmaps(p->number());
-                }
             }
         }
     }
+
+    for (int pageIdx : qAsConst(pagesToRefresh)) {
+        if (pageIdx >= 0 && pageIdx < m_pagesVector.count())
+            refreshPixmaps(pageIdx);
+    }
 }
 
 void DocumentPrivate::saveDocumentInfo() const
@@ -1170,6 +1650,100 @@ void DocumentPrivate::saveDocumentInfo() const
     if (m_xmlFileName.isEmpty())
         return;
 
+    // the annotations and forms previous versions left there are only in the XML format
+    if (m_docdataMigrationNeeded)
+        saveDocumentInfoXml();
+    else
+        saveDocumentInfoBinary();
+}
+
+void DocumentPrivate::saveDocumentInfoBinary() const
+{
+    DocumentInfoFile file;
+    file.open(m_xmlFileName);
+    qCDebug(OkularCoreDebug) << "About to save document info to" << m_xmlFileName;
+
+    if (m_rotation != Rotation0) {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(DocumentInfoFile::streamVersion());
+        stream << qint32(m_rotation);
+        file.setRecord(DocumentInfoFile::RotationRecord, QString(), data);
+    } else {
+        file.removeRecord(DocumentInfoFile::RotationRecord);
+    }
+
+    // the bounding boxes, so that they are not computed again when reopening; one
+    // record for each page, only the ones that changed are written
+    const QString modified = QString::number(QFileInfo(m_docFileName).lastModified().toMSecsSinceEpoch());
+    {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(DocumentInfoFile::streamVersion());
+        stream << qint32(m_rotation) << modified;
+        file.setRecord(DocumentInfoFile::BoundingBoxesRecord, QString(), data);
+    }
+    for (const Page *page : qAsConst(m_pagesVector)) {
+        const QString key = QString::number(page->number());
+        if (!page->isBoundingBoxKnown()) {
+            file.removeRecord(DocumentInfoFile::PageBoundingBoxRecord, key);
+            continue;
+        }
+        const NormalizedRect &bbox = page->boundingBox();
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(DocumentInfoFile::streamVersion());
+        // the approximate flag was added after the box, older records are exact
+        stream << bbox.left << bbox.top << bbox.right << bbox.bottom << bool(page->d->m_isBoundingBoxApproximate);
+        file.setRecord(DocumentInfoFile::PageBoundingBoxRecord, key, data);
+    }
+    const QStringList pageKeys = file.keys(DocumentInfoFile::PageBoundingBoxRecord);
+    for (const QString &key : pageKeys) {
+        if (key.toInt() >= m_pagesVector.count())
+            file.removeRecord(DocumentInfoFile::PageBoundingBoxRecord, key);
+    }
+
+    // the fonts, so that the pages are not read again for them when reopening;
+    // the ones of a previous time stay if they were not asked for
+    if (m_fontsCached) {
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(DocumentInfoFile::streamVersion());
+        stream << m_generatorName << modified << qint32(m_fontsCache.count());
+        for (const FontInfo &font : qAsConst(m_fontsCache))
+            stream << font.name() << font.substituteName() << qint32(font.type()) << qint32(font.embedType()) << font.file() << font.canBeExtracted();
+        file.setRecord(DocumentInfoFile::FontsRecord, QString(), data);
+    }
+
+    // the history up to OKULAR_HISTORY_SAVEDSTEPS viewports, the current one last
+    const auto currentViewportIterator = QLinkedList<DocumentViewport>::const_iterator(m_viewportIterator);
+    QLinkedList<DocumentViewport>::const_iterator backIterator = currentViewportIterator;
+    if (backIterator != m_viewportHistory.constEnd()) {
+        int backSteps = OKULAR_HISTORY_SAVEDSTEPS;
+        while (backSteps-- && backIterator != m_viewportHistory.constBegin())
+            --backIterator;
+
+        QStringList viewports;
+        QLinkedList<DocumentViewport>::const_iterator endIt = currentViewportIterator;
+        ++endIt;
+        for (; backIterator != endIt; ++backIterator)
+            viewports.append((*backIterator).toString());
+
+        QByteArray data;
+        QDataStream stream(&data, QIODevice::WriteOnly);
+        stream.setVersion(DocumentInfoFile::streamVersion());
+        stream << viewports;
+        file.setRecord(DocumentInfoFile::HistoryRecord, QString(), data);
+    }
+
+    for (View *view : qAsConst(m_views))
+        file.setRecord(DocumentInfoFile::ViewRecord, view->name(), saveViewsInfo(view));
+
+    file.commit();
+}
+
+void DocumentPrivate::saveDocumentInfoXml() const
+{
     QFile infoFile(m_xmlFileName);
     qCDebug(OkularCoreDebug) << "About to save document info to" << m_xmlFileName;
     if (!infoFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
@@ -1200,6 +1774,11 @@ void DocumentPrivate::saveDocumentInfo() const
         QVector<Page *>::const_iterator pIt = m_pagesVector.constBegin(), pEnd = m_pagesVector.constEnd();
         for (; pIt != pEnd; ++pIt)
             (*pIt)->d->saveLocalContents(pageList, doc, saveWhat);
+        // and the pages the generator did not give yet, as they were read
+        if (!m_unloadedPagesInfo.isNull()) {
+            for (QDomNode pageNode = m_unloadedPagesInfo.documentElement().firstChild(); pageNode.isElement(); pageNode = pageNode.nextSibling())
+                pageList.appendChild(doc.importNode(pageNode, true));
+        }
     }
 
     // 2.2. Save document info (current viewport, history, ... ) to DOM
@@ -1211,6 +1790,44 @@ void DocumentPrivate::saveDocumentInfo() const
         generalInfo.appendChild(rotationNode);
         rotationNode.appendChild(doc.createTextNode(QString::number((int)m_rotation)));
     }
+    // create the bounding boxes node, so that they are not computed again when reopening
+    QDomElement boundingBoxesNode = doc.createElement(QStringLiteral("boundingBoxes"));
+    boundingBoxesNode.setAttribute(QStringLiteral("rotation"), (int)m_rotation);
+    boundingBoxesNode.setAttribute(QStringLiteral("modified"), QString::number(QFileInfo(m_docFileName).lastModified().toMSecsSinceEpoch()));
+    for (const Page *page : qAsConst(m_pagesVector)) {
+        if (!page->isBoundingBoxKnown())
+            continue;
+        const NormalizedRect &bbox = page->boundingBox();
+        QDomElement pageNode = doc.createElement(QStringLiteral("page"));
+        pageNode.setAttribute(QStringLiteral("number"), page->number());
+        pageNode.setAttribute(QStringLiteral("left"), bbox.left);
+        pageNode.setAttribute(QStringLiteral("top"), bbox.top);
+        pageNode.setAttribute(QStringLiteral("right"), bbox.right);
+        pageNode.setAttribute(QStringLiteral("bottom"), bbox.bottom);
+        // found on a small render, the first full one refines it
+        if (page->d->m_isBoundingBoxApproximate)
+            pageNode.setAttribute(QStringLiteral("approximate"), 1);
+        boundingBoxesNode.appendChild(pageNode);
+    }
+    if (boundingBoxesNode.hasChildNodes())
+        generalInfo.appendChild(boundingBoxesNode);
+    // create the fonts node, so that the pages are not read again for them when reopening
+    if (m_fontsCached) {
+        QDomElement fontsNode = doc.createElement(QStringLiteral("fonts"));
+        fontsNode.setAttribute(QStringLiteral("generator"), m_generatorName);
+        fontsNode.setAttribute(QStringLiteral("modified"), QString::number(QFileInfo(m_docFileName).lastModified().toMSecsSinceEpoch()));
+        for (const FontInfo &font : qAsConst(m_fontsCache)) {
+            QDomElement fontNode = doc.createElement(QStringLiteral("font"));
+            fontNode.setAttribute(QStringLiteral("name"), font.name());
+            fontNode.setAttribute(QStringLiteral("substituteName"), font.substituteName());
+            fontNode.setAttribute(QStringLiteral("type"), (int)font.type());
+            fontNode.setAttribute(QStringLiteral("embedType"), (int)font.embedType());
+            fontNode.setAttribute(QStringLiteral("file"), font.file());
+            fontNode.setAttribute(QStringLiteral("canBeExtracted"), font.canBeExtracted() ? 1 : 0);
+            fontsNode.appendChild(fontNode);
+        }
+        generalInfo.appendChild(fontsNode);
+    }
     // <general info><history> ... </history> save history up to OKULAR_HISTORY_SAVEDSTEPS viewports
     const auto currentViewportIterator = QLinkedList<DocumentViewport>::const_iterator(m_viewportIterator);
     QLinkedList<DocumentViewport>::const_iterator backIterator = currentViewportIterator;
@@ -1260,67 +1877,622 @@ void DocumentPrivate::slotTimedMemoryCheck()
         cleanupPixmapMemory();
 }
 
-void DocumentPrivate::sendGeneratorPixmapRequest()
+void DocumentPrivate::slotMemoryPressure()
 {
-    /* If the pixmap cache will have to be cleaned in order to make room for the
-     * next request, get the distance from the current viewport of the page
-     * whose pixmap will be removed. We will ignore preload requests for pages
-     * that are at the same distance or farther */
-    const qulonglong memoryToFree = calculateMemoryToFree();
-    const int currentViewportPage = (*m_viewportIterator).pageNumber;
-    int maxDistance = INT_MAX; // Default: No maximum
-    if (memoryToFree) {
-        AllocatedPixmap *pixmapToReplace = searchLowestPriorityPixmap(true);
-        if (pixmapToReplace)
-            maxDistance = qAbs(pixmapToReplace->page - currentViewportPage);
-    }
+    // [MEM] the system (or our cgroup) is already reclaiming memory, don't wait
+    // for the free memory numbers to catch up and give back half of the cache
+    if (m_allocatedPixmapsTotalMemory <= 1024 * 1024)
+        return;
 
-    // find a request
-    PixmapRequest *request = nullptr;
-    m_pixmapRequestsMutex.lock();
-    while (!m_pixmapRequestsStack.isEmpty() && !request) {
-        PixmapRequest *r = m_pixmapRequestsStack.last();
-        if (!r) {
-            m_pixmapRequestsStack.pop_back();
+    qCDebug(OkularCoreDebug) << "Memory pressure, freeing pixmaps now";
+    m_compressedPixmaps.clear();
+    ImageBufferPool::instance()->clear();
+    if (m_generator)
+        m_generator->freeCachedMemory(m_generator->cachedMemory());
+    cleanupPixmapMemory(qMax(calculateMemoryToFree(), m_allocatedPixmapsTotalMemory / 2));
+}
+
+void DocumentPrivate::demotePixmap(DocumentObserver *observer, int pageNumber)
+{
+    if (!m_compressedPixmaps.isEnabled())
+        return;
+
+    // only whole pages, tiles are freed and generated one by one anyway
+    const Page *page = m_pagesVector.at(pageNumber);
+    QMap<DocumentObserver *, PagePrivate::PixmapObject>::const_iterator it = page->d->m_pixmaps.constFind(observer);
+    if (it == page->d->m_pixmaps.constEnd() || it->m_isPartialPixmap || page->d->tilesManager(observer))
+        return;
+    // not worth bringing back a draft
+    if (m_draftPixmaps.contains(qMakePair(observer, pageNumber)))
+        return;
+
+    m_compressedPixmaps.insert(observer, pageNumber, it->m_rotation, *it->m_pixmap);
+}
+
+void DocumentPrivate::refineDraftPixmaps()
+{
+    QSet<int> visiblePages;
+    for (const VisiblePageRect *rect : qAsConst(m_pageRects))
+        visiblePages.insert(rect->pageNumber);
+
+    QHash<DocumentObserver *, QLinkedList<PixmapRequest *>> requests;
+    for (auto it = m_draftPixmaps.constBegin(), end = m_draftPixmaps.constEnd(); it != end; ++it) {
+        DocumentObserver *observer = it.key().first;
+        const int pageNumber = it.key().second;
+        const Page *page = m_pagesVector.value(pageNumber);
+        if (!page || !m_observers.contains(observer) || page->hasTilesManager(observer))
+            continue;
+        const QPixmap *pixmap = page->pixmap(observer);
+        if (!pixmap)
             continue;
-        }
 
-        QRect requestRect = r->isTile() ? r->normalizedRect().geometry(r->width(), r->height()) : QRect(0, 0, r->width(), r->height());
-        TilesManager *tilesManager = r->d->tilesManager();
-        const double normalizedArea = r->normalizedRect().width() * r->normalizedRect().height();
-        const QScreen *screen = nullptr;
-        if (m_widget) {
-            const QWindow *window = m_widget->window()->windowHandle();
-            if (window)
-                screen = window->screen();
+        // scrolled away since, it goes after the pages around the view
+        int priority = it.value();
+        PixmapRequest::PixmapRequestFeatures features = PixmapRequest::Asynchronous;
+        if (!visiblePages.contains(pageNumber) && m_preloadPriorities.contains(observer)) {
+            priority = qMax(priority, m_preloadPriorities.value(observer));
+            features |= PixmapRequest::Preload;
         }
-        if (!screen)
-            screen = QGuiApplication::primaryScreen();
-        const long screenSize = screen->devicePixelRatio() * screen->size().width() * screen->devicePixelRatio() * screen->size().height();
 
-        // If it's a preload but the generator is not threaded no point in trying to preload
-        if (r->preload() && !m_generator->hasFeature(Generator::Threaded)) {
-            m_pixmapRequestsStack.pop_back();
-            delete r;
-        }
-        // request only if page isn't already present and request has valid id
-        else if ((!r->d->mForce && r->page()->hasPixmap(r->observer(), r->width(), r->height(), r->normalizedRect())) || !m_observers.contains(r->observer())) {
-            m_pixmapRequestsStack.pop_back();
-            delete r;
-        } else if (!r->d->mForce && r->preload() && qAbs(r->pageNumber() - currentViewportPage) >= maxDistance) {
-            m_pixmapRequestsStack.pop_back();
-            // qCDebug(OkularCoreDebug) << "Ignoring request that doesn't fit in cache";
-            delete r;
-        }
-        // Ignore requests for pixmaps that are already being generated
-        else if (tilesManager && tilesManager->isRequesting(r->normalizedRect(), r->width(), r->height())) {
-            m_pixmapRequestsStack.pop_back();
-            delete r;
-        }
-        // If the requested area is above 4*screenSize pixels, and we're not rendering most of the page,  switch on the tile manager
-        else if (!tilesManager && m_generator->hasFeature(Generator::TiledRendering) && (long)r->width() * (long)r->height() > 4L * screenSize && normalizedArea < 0.75 && normalizedArea != 0) {
-            // if the image is too big. start using tiles
-            qCDebug(OkularCoreDebug).nospace() << "Start using tiles on page " << r->pageNumber() << " (" << r->width() << "x" << r->height() << " px);";
+        // the size of the draft, in device pixels; forced, as the caches may be holding drafts too
+        PixmapRequest *request = new PixmapRequest(observer, pageNumber, pixmap->width(), pixmap->height(), 1 /* dpr */, priority, features);
+        request->d->mForce = true;
+        requests[observer].append(request);
+    }
+    // the entries are removed as the full quality pixmaps come in
+
+    for (auto it = requests.constBegin(), end = requests.constEnd(); it != end; ++it)
+        m_parent->requestPixmaps(it.value(), Document::NoOption);
+}
+
+void DocumentPrivate::notifyPagesChanged(const QSet<int> &pages, int flags)
+{
+    if (pages.isEmpty())
+        return;
+
+    for (int page : pages)
+        m_pendingPageChanges[page] |= flags;
+
+    if (!m_pageChangesTimer) {
+        m_pageChangesTimer = new QTimer(m_parent);
+        m_pageChangesTimer->setSingleShot(true);
+        QObject::connect(m_pageChangesTimer, &QTimer::timeout, m_parent, [this] { sendPageChanges(); });
+    }
+    if (!m_pageChangesTimer->isActive())
+        m_pageChangesTimer->start(0);
+}
+
+void DocumentPrivate::sendPageChanges()
+{
+    // one notification for each set of flags
+    QMap<int, QVector<int>> pagesByFlags;
+    for (auto it = m_pendingPageChanges.constBegin(), end = m_pendingPageChanges.constEnd(); it != end; ++it) {
+        if (it.key() < m_pagesVector.count())
+            pagesByFlags[it.value()].append(it.key());
+    }
+    m_pendingPageChanges.clear();
+
+    // not it, the name foreachObserverD uses
+    for (auto changes = pagesByFlags.constBegin(); changes != pagesByFlags.constEnd(); ++changes)
+        foreachObserverD(notifyPagesChanged(changes.value(), changes.key()));
+}
+
+QVector<NormalizedRect> DocumentPrivate::tileBands(const PixmapRequest *request) const
+{
+    TilesManager *tilesManager = request->d->tilesManager();
+    if (!tilesManager || request->normalizedRect().isNull())
+        return QVector<NormalizedRect>();
+
+    // tiles of the same row make a band, ordered from the top of the page
+    QMap<double, NormalizedRect> bands;
+    const QList<Tile> tiles = tilesManager->tilesAt(request->normalizedRect(), TilesManager::TerminalTile);
+    for (const Tile &tile : tiles) {
+        if (tile.isValid() || tilesManager->isRequesting(tile.rect()))
+            continue;
+
+        QMap<double, NormalizedRect>::iterator it = bands.find(tile.rect().top);
+        if (it == bands.end())
+            bands.insert(tile.rect().top, tile.rect());
+        else
+            *it |= tile.rect();
+    }
+    return bands.values().toVector();
+}
+
+PixmapRequest *DocumentPrivate::previewRequestFor(const PixmapRequest *request) const
+{
+    if (!request->progressive() || !request->asynchronous() || request->preview() || request->isTile() || request->d->mForce)
+        return nullptr;
+
+    // only pages that would be blank otherwise
+    Page *page = request->page();
+    if (page->hasPixmap(request->observer()) || page->hasTilesManager(request->observer()))
+        return nullptr;
+
+    // small pixmaps are quick enough already
+    const int width = request->width() / kPreviewScale;
+    const int height = request->height() / kPreviewScale;
+    if (width < kPreviewMinimumSize || height < kPreviewMinimumSize)
+        return nullptr;
+
+    // width and height are already in device pixels
+    PixmapRequest *preview = new PixmapRequest(request->observer(), request->pageNumber(), width, height, 1 /* dpr */, request->priority(), PixmapRequest::Asynchronous | PixmapRequest::Preview);
+    preview->d->mPage = page;
+    preview->d->mWarmStart = request->d->mWarmStart;
+    return preview;
+}
+
+bool DocumentPrivate::restoreCompressedPixmap(PixmapRequest *request)
+{
+    if (!m_compressedPixmaps.isEnabled() || request->isTile() || request->d->mForce)
+        return false;
+
+    Page *page = request->page();
+    if (page->hasPixmap(request->observer()) || page->d->tilesManager(request->observer()))
+        return false;
+
+    QPixmap *pixmap = m_compressedPixmaps.take(request->observer(), request->pageNumber(), request->width(), request->height(), m_rotation);
+    if (!pixmap)
+        return false;
+
+    qCDebug(OkularCoreDebug).nospace() << "using compressed pixmap observer=" << request->observer() << " " << request->width() << "x" << request->height() << "@" << request->pageNumber();
+    ++observerStatistics(request->observer())->compressedCacheHits;
+    page->d->setRotatedPixmap(request->observer(), pixmap);
+    setAllocatedPixmap(request->observer(), request->pageNumber(), 4 * request->width() * request->height());
+    return true;
+}
+
+bool DocumentPrivate::sharePixmapFromOtherObserver(PixmapRequest *request)
+{
+    if (request->isTile() || request->d->mForce)
+        return false;
+
+    Page *page = request->page();
+    if (page->hasPixmap(request->observer(), request->width(), request->height()) || page->d->tilesManager(request->observer()))
+        return false;
+
+    // e.g. a thumbnail of a page the page view has rendered, scaling it down
+    // takes a few milliseconds instead of a whole render
+    const QPixmap *source = page->d->largerPixmap(request->observer(), request->width(), request->height());
+    if (!source)
+        return false;
+
+    qCDebug(OkularCoreDebug).nospace() << "scaling a " << source->width() << "x" << source->height() << " pixmap for observer=" << request->observer() << " " << request->width() << "x" << request->height() << "@" << request->pageNumber();
+    ++observerStatistics(request->observer())->sharedPixmapHits;
+    page->d->setRotatedPixmap(request->observer(), new QPixmap(source->scaled(request->width(), request->height(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation)));
+    setAllocatedPixmap(request->observer(), request->pageNumber(), 4 * request->width() * request->height());
+    return true;
+}
+
+bool DocumentPrivate::shareTilesFromOtherObservers(PixmapRequest *request)
+{
+    if (!request->isTile() || request->d->mForce || request->normalizedRect().isNull())
+        return false;
+
+    // rotated tiles are laid out in another orientation than they are stored
+    Page *page = request->page();
+    TilesManager *tilesManager = request->d->tilesManager();
+    if (!tilesManager || page->rotation() != Rotation0)
+        return false;
+
+    // e.g. the magnifier over a page the page view has zoomed in on
+    int sharedTiles = 0;
+    const QList<Tile> tiles = tilesManager->tilesAt(request->normalizedRect(), TilesManager::TerminalTile);
+    for (const Tile &tile : tiles) {
+        if (tile.isValid() || tilesManager->isRequesting(tile.rect()))
+            continue;
+
+        const QPixmap pixmap = page->d->sharedRect(request->observer(), tile.rect(), tilesManager->width(), tilesManager->height());
+        if (pixmap.isNull())
+            continue;
+
+        // registered first, the tiles manager only takes the pixmaps it asked for
+        tilesManager->setRequest(tile.rect(), tilesManager->width(), tilesManager->height());
+        tilesManager->setPixmap(&pixmap, tile.rect(), false);
+        ++sharedTiles;
+    }
+    if (sharedTiles == 0)
+        return false;
+
+    qCDebug(OkularCoreDebug).nospace() << "shared " << sharedTiles << " tiles for observer=" << request->observer() << " " << request->width() << "x" << request->height() << "@" << request->pageNumber();
+    ++observerStatistics(request->observer())->sharedPixmapHits;
+    setAllocatedPixmap(request->observer(), request->pageNumber(), tilesManager->totalMemory());
+    return true;
+}
+
+// whether a thumbnail of @p thumbnail size, as the generator gives it, can
+// stand in for a @p width x @p height render of a page of @p rotation
+static bool embeddedThumbnailFits(QSize thumbnail, Rotation rotation, int width, int height)
+{
+    if (thumbnail.isEmpty())
+        return false;
+    if ((int)rotation % 2)
+        thumbnail.transpose();
+
+    // too small, or not of this page size
+    const double ratio = width / (double)thumbnail.width();
+    return ratio <= kMaxEmbeddedThumbnailUpscale && qAbs(thumbnail.height() * ratio - height) <= qMax(2.0, 0.02 * height);
+}
+
+bool DocumentPrivate::wantsEmbeddedThumbnail(PixmapRequest *request) const
+{
+    if (!(request->d->mFeatures & PixmapRequest::EmbeddedThumbnail) || request->isTile() || request->d->mForce || !m_generator->hasFeature(Generator::EmbeddedThumbnails))
+        return false;
+
+    const Page *page = request->page();
+    if (page->hasPixmap(request->observer(), request->width(), request->height()) || page->d->tilesManager(request->observer()))
+        return false;
+
+    // the pages asked already have none, or one not good for this size
+    const auto known = m_embeddedThumbnailSizes.constFind(request->pageNumber());
+    return known == m_embeddedThumbnailSizes.constEnd() || embeddedThumbnailFits(*known, page->rotation(), request->width(), request->height());
+}
+
+bool DocumentPrivate::setEmbeddedThumbnail(DocumentObserver *observer, int pageNumber, const QSize &size, const QImage &image)
+{
+    Page *page = m_pagesVector.value(pageNumber);
+    if (!page || !embeddedThumbnailFits(image.size(), page->rotation(), size.width(), size.height()))
+        return false;
+
+    QImage thumbnail = image;
+    if (page->rotation() != Rotation0)
+        thumbnail = thumbnail.transformed(QTransform().rotate(90 * page->rotation()));
+
+    qCDebug(OkularCoreDebug).nospace() << "using the embedded " << thumbnail.width() << "x" << thumbnail.height() << " thumbnail for observer=" << observer << " " << size.width() << "x" << size.height() << "@" << pageNumber;
+    ++observerStatistics(observer)->embeddedThumbnailHits;
+    page->d->setRotatedPixmap(observer, new QPixmap(QPixmap::fromImage(thumbnail.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation))));
+    setAllocatedPixmap(observer, pageNumber, 4 * size.width() * size.height());
+    return true;
+}
+
+bool DocumentPrivate::useEmbeddedThumbnail(PixmapRequest *request)
+{
+    // the threaded generators look for it in the background, see loadEmbeddedThumbnail()
+    if (m_generator->hasFeature(Generator::Threaded) || !wantsEmbeddedThumbnail(request))
+        return false;
+
+    const QImage thumbnail = m_generator->embeddedThumbnail(request->page());
+    m_embeddedThumbnailSizes.insert(request->pageNumber(), thumbnail.size());
+    return setEmbeddedThumbnail(request->observer(), request->pageNumber(), QSize(request->width(), request->height()), thumbnail);
+}
+
+bool DocumentPrivate::loadEmbeddedThumbnail(PixmapRequest *request)
+{
+    if (!m_generator->hasFeature(Generator::Threaded) || !wantsEmbeddedThumbnail(request))
+        return false;
+
+    // the one being looked for takes care of it
+    const QPair<DocumentObserver *, int> loading(request->observer(), request->pageNumber());
+    if (m_thumbnailsLoading.contains(loading))
+        return true;
+    m_thumbnailsLoading.insert(loading);
+
+    Generator *generator = m_generator;
+    const Page *page = request->page();
+    DocumentObserver *observer = request->observer();
+    const int pageNumber = request->pageNumber();
+    const QSize size(request->width(), request->height());
+    const int priority = request->priority();
+    const int features = request->d->mFeatures;
+    const int generation = m_thumbnailLoadsGeneration;
+    m_embeddedThumbnailQueue.enqueue(ThreadWeaver::make_job([this, generator, page, observer, pageNumber, size, priority, features, generation] {
+        const QImage thumbnail = generator->embeddedThumbnail(page);
+        QMetaObject::invokeMethod(
+            m_parent,
+            [this, observer, pageNumber, size, priority, features, generation, thumbnail] {
+                if (generation != m_thumbnailLoadsGeneration)
+                    return;
+
+                m_thumbnailsLoading.remove(qMakePair(observer, pageNumber));
+                m_embeddedThumbnailSizes.insert(pageNumber, thumbnail.size());
+                const Page *page = m_pagesVector.value(pageNumber);
+                if (!page || !m_observers.contains(observer) || page->hasPixmap(observer, size.width(), size.height()))
+                    return;
+
+                if (setEmbeddedThumbnail(observer, pageNumber, size, thumbnail)) {
+                    observer->notifyPageChanged(pageNumber, DocumentObserver::Pixmap);
+                    return;
+                }
+
+                // none, or not good for this size: ask again, now it goes to the generator
+                PixmapRequest *request = new PixmapRequest(observer, pageNumber, size.width(), size.height(), 1 /* dpr */, priority, PixmapRequest::PixmapRequestFeatures(QFlag(features)));
+                m_parent->requestPixmaps({request}, Document::NoOption);
+            },
+            Qt::QueuedConnection);
+    }));
+    return true;
+}
+
+bool DocumentPrivate::loadCachedThumbnail(PixmapRequest *request)
+{
+    if (!(request->d->mFeatures & PixmapRequest::Thumbnail) || !m_thumbnailDiskCache.isActive() || request->isTile() || request->preview() || request->d->mForce)
+        return false;
+
+    Page *page = request->page();
+    if (page->hasPixmap(request->observer(), request->width(), request->height()))
+        return false;
+
+    // the cache has the thumbnails as the generator renders them, i.e. not rotated
+    const bool swapped = (int)m_rotation % 2;
+    const QSize size = swapped ? QSize(request->height(), request->width()) : QSize(request->width(), request->height());
+    if (!m_thumbnailDiskCache.contains(request->pageNumber(), size.width()))
+        return false;
+
+    // the one being read takes care of it
+    const QPair<DocumentObserver *, int> loading(request->observer(), request->pageNumber());
+    if (m_thumbnailsLoading.contains(loading))
+        return true;
+    m_thumbnailsLoading.insert(loading);
+
+    DocumentObserver *observer = request->observer();
+    const int pageNumber = request->pageNumber();
+    const QSize requestSize(request->width(), request->height());
+    const int priority = request->priority();
+    const int features = request->d->mFeatures;
+    const int generation = m_thumbnailLoadsGeneration;
+    m_thumbnailDiskCache.load(pageNumber, size, m_parent, [this, observer, pageNumber, requestSize, priority, features, generation](const QImage &image) {
+        cachedThumbnailLoaded(observer, pageNumber, requestSize, priority, features, generation, image);
+    });
+    return true;
+}
+
+void DocumentPrivate::cancelThumbnailLoads()
+{
+    ++m_thumbnailLoadsGeneration;
+    m_thumbnailsLoading.clear();
+    // the generator may be about to close the document they look into
+    m_embeddedThumbnailQueue.dequeue();
+    m_embeddedThumbnailQueue.finish();
+    m_embeddedThumbnailSizes.clear();
+}
+
+void DocumentPrivate::cachedThumbnailLoaded(DocumentObserver *observer, int pageNumber, const QSize &size, int priority, int features, int generation, const QImage &image)
+{
+    if (generation != m_thumbnailLoadsGeneration)
+        return;
+
+    m_thumbnailsLoading.remove(qMakePair(observer, pageNumber));
+    Page *page = m_pagesVector.value(pageNumber);
+    if (!page || !m_observers.contains(observer) || page->hasPixmap(observer, size.width(), size.height()))
+        return;
+
+    QImage thumbnail = image;
+    if (!thumbnail.isNull() && m_rotation != Rotation0)
+        thumbnail = thumbnail.transformed(QTransform().rotate(90 * m_rotation));
+
+    // unreadable, or the document was rotated meanwhile: ask again, it goes to the generator if need be
+    if (thumbnail.size() != size) {
+        // width and height are already in device pixels
+        PixmapRequest *request = new PixmapRequest(observer, pageNumber, size.width(), size.height(), 1 /* dpr */, priority, PixmapRequest::PixmapRequestFeatures(QFlag(features)));
+        m_parent->requestPixmaps({request}, Document::NoOption);
+        return;
+    }
+
+    qCDebug(OkularCoreDebug).nospace() << "using cached thumbnail observer=" << observer << " " << size.width() << "x" << size.height() << "@" << pageNumber;
+    ++observerStatistics(observer)->thumbnailCacheHits;
+    page->d->setRotatedPixmap(observer, new QPixmap(QPixmap::fromImage(thumbnail)));
+    setAllocatedPixmap(observer, pageNumber, 4 * size.width() * size.height());
+    observer->notifyPageChanged(pageNumber, DocumentObserver::Pixmap);
+}
+
+void DocumentPrivate::setAllocatedPixmap(DocumentObserver *observer, int pageNumber, qulonglong memoryBytes)
+{
+    AllocatedPixmap *previous = m_allocatedPixmaps.take(observer, pageNumber);
+    if (previous) {
+        m_allocatedPixmapsTotalMemory -= previous->memory;
+        delete previous;
+    }
+
+    m_allocatedPixmaps.insert(new AllocatedPixmap(observer, pageNumber, memoryBytes, estimatedRenderTime(pageNumber, memoryBytes / 4)));
+    m_allocatedPixmapsTotalMemory += memoryBytes;
+    recordFirstPixmap(observer);
+}
+
+qint64 DocumentPrivate::estimatedRenderTime(int pageNumber, qulonglong pixels) const
+{
+    // pages not rendered yet are guessed to be like the average one
+    double cost = m_pageRenderCosts.value(pageNumber, -1);
+    if (cost < 0)
+        cost = m_pageRenderCosts.isEmpty() ? 0 : m_pageRenderCostsTotal / m_pageRenderCosts.count();
+    return qRound64(cost * pixels / 1000000.0);
+}
+
+double DocumentPrivate::preloadEvictionScore(const PixmapRequest *request, int viewportPage) const
+{
+    const qulonglong pixels = renderedPixels(request);
+    return AllocatedPixmapIndex::evictionScore(qAbs(request->pageNumber() - viewportPage), 4 * pixels, estimatedRenderTime(request->pageNumber(), pixels));
+}
+
+qulonglong DocumentPrivate::renderedPixels(const PixmapRequest *request)
+{
+    const qulonglong pixels = qulonglong(request->width()) * request->height();
+    if (!request->isTile())
+        return pixels;
+
+    const NormalizedRect &rect = request->normalizedRect();
+    return qRound64(pixels * rect.width() * rect.height());
+}
+
+void DocumentPrivate::recordRenderTime(int pageNumber, qulonglong pixels, qint64 renderTime)
+{
+    if (pixels == 0)
+        return;
+
+    const double cost = renderTime * 1000000.0 / pixels;
+    m_pageRenderCostsTotal += cost - m_pageRenderCosts.value(pageNumber, 0);
+    m_pageRenderCosts.insert(pageNumber, cost);
+}
+
+RenderStatisticsPrivate *DocumentPrivate::observerStatistics(DocumentObserver *observer)
+{
+    return RenderStatisticsPrivate::get(m_renderStatistics[observer]);
+}
+
+void DocumentPrivate::recordFirstPixmap(DocumentObserver *observer)
+{
+    RenderStatisticsPrivate *statistics = observerStatistics(observer);
+    if (statistics->firstPixmapTime >= 0 || !m_openTimer.isValid())
+        return;
+
+    statistics->firstPixmapTime = m_openTimer.elapsed();
+    qCDebug(OkularCoreDebug).nospace() << "first pixmap for observer=" << observer << " " << statistics->firstPixmapTime << " ms after opening";
+}
+
+void DocumentPrivate::startWarmStart(int page)
+{
+    m_warmStartPage = page;
+    m_warmStartRequested = false;
+    if (!m_warmStartTimer) {
+        m_warmStartTimer = new QTimer(m_parent);
+        m_warmStartTimer->setSingleShot(true);
+        QObject::connect(m_warmStartTimer, &QTimer::timeout, m_parent, [this] {
+            endWarmStart();
+            if (m_generator)
+                sendGeneratorPixmapRequest();
+        });
+    }
+    m_warmStartTimer->start(kWarmStartTimeout);
+}
+
+void DocumentPrivate::endWarmStart()
+{
+    if (m_warmStartPage < 0)
+        return;
+
+    qCDebug(OkularCoreDebug).nospace() << "warm start of page " << m_warmStartPage << " done " << (m_openTimer.isValid() ? m_openTimer.elapsed() : -1) << " ms after opening";
+    m_warmStartPage = -1;
+    if (m_warmStartTimer)
+        m_warmStartTimer->stop();
+    // the preloading of the text waited too
+    startTextPageRequests();
+}
+
+bool DocumentPrivate::hasWarmStartRequests()
+{
+    // m_pixmapRequestsMutex must be held by the caller
+    for (const PixmapRequest *executingRequest : qAsConst(m_executingPixmapRequests)) {
+        if (executingRequest->d->mWarmStart)
+            return true;
+    }
+    // they come before all the others
+    const PixmapRequest *top = m_pixmapRequestsStack.top();
+    return top && top->d->mWarmStart;
+}
+
+void DocumentPrivate::setPagePreview(int pageNumber, qulonglong previousBytes, qulonglong bytes)
+{
+    m_pagePreviewsMemory -= previousBytes;
+    m_pagePreviewsFifo.removeOne(pageNumber);
+    if (!bytes)
+        return;
+
+    m_pagePreviewsMemory += bytes;
+    m_pagePreviewsFifo.append(pageNumber);
+    while (m_pagePreviewsMemory > kPagePreviewsMemory && m_pagePreviewsFifo.count() > 1) {
+        Page *page = m_pagesVector.value(m_pagePreviewsFifo.takeFirst());
+        if (page) {
+            m_pagePreviewsMemory -= qMin(m_pagePreviewsMemory, qulonglong(page->d->m_preview.width()) * page->d->m_preview.height() * 4);
+            page->d->m_preview = QPixmap();
+        }
+    }
+}
+
+void DocumentPrivate::sendGeneratorPixmapRequest()
+{
+    /* If the pixmap cache will have to be cleaned in order to make room for the
+     * next request, get the eviction score of the pixmap that will be removed.
+     * We will ignore preload requests for pixmaps that would be evicted
+     * before it: the more expensive the pages are to render, the farther
+     * ahead they are preloaded */
+    const qulonglong memoryToFree = calculateMemoryToFree();
+    const int currentViewportPage = (*m_viewportIterator).pageNumber;
+    double maxEvictionScore = -1; // Default: No maximum
+    if (memoryToFree) {
+        AllocatedPixmap *pixmapToReplace = searchLowestPriorityPixmap(true);
+        if (pixmapToReplace)
+            maxEvictionScore = AllocatedPixmapIndex::evictionScore(qAbs(pixmapToReplace->page - currentViewportPage), pixmapToReplace->memory, pixmapToReplace->renderTime);
+    }
+
+    // find a request
+    PixmapRequest *request = nullptr;
+    m_pixmapRequestsMutex.lock();
+    while (!request) {
+        PixmapRequest *r = m_pixmapRequestsStack.top();
+        if (!r)
+            break;
+
+        // the pages the document was opened at go first, the others wait
+        // for them (or for the timeout) in the queue
+        if (m_warmStartPage >= 0 && !r->d->mWarmStart && r->asynchronous()) {
+            // they were dropped, e.g. the view moved before they were rendered
+            if (m_warmStartRequested && !hasWarmStartRequests()) {
+                QMetaObject::invokeMethod(
+                    m_parent,
+                    [this] {
+                        endWarmStart();
+                        if (m_generator)
+                            sendGeneratorPixmapRequest();
+                    },
+                    Qt::QueuedConnection);
+            }
+            break;
+        }
+
+        QRect requestRect = r->isTile() ? r->normalizedRect().geometry(r->width(), r->height()) : QRect(0, 0, r->width(), r->height());
+        TilesManager *tilesManager = r->d->tilesManager();
+        const double normalizedArea = r->normalizedRect().width() * r->normalizedRect().height();
+        const QScreen *screen = nullptr;
+        if (m_widget) {
+            const QWindow *window = m_widget->window()->windowHandle();
+            if (window)
+                screen = window->screen();
+        }
+        if (!screen)
+            screen = QGuiApplication::primaryScreen();
+        const long screenSize = screen->devicePixelRatio() * screen->size().width() * screen->devicePixelRatio() * screen->size().height();
+
+        // If it's a preload but the generator is not threaded no point in trying to preload
+        if (r->preload() && !m_generator->hasFeature(Generator::Threaded)) {
+            m_pixmapRequestsStack.pop();
+            delete r;
+        }
+        // request only if page isn't already present and request has valid id
+        else if ((!r->d->mForce && r->page()->hasPixmap(r->observer(), r->width(), r->height(), r->normalizedRect())) || !m_observers.contains(r->observer())) {
+            if (m_observers.contains(r->observer()))
+                ++observerStatistics(r->observer())->pixmapCacheHits;
+            m_pixmapRequestsStack.pop();
+            delete r;
+        }
+        // a preview is useless once there is any pixmap, it could even replace a better one
+        else if (r->preview() && (r->page()->hasPixmap(r->observer()) || r->page()->hasTilesManager(r->observer()))) {
+            m_pixmapRequestsStack.pop();
+            delete r;
+        } else if (!r->d->mForce && r->preload() && maxEvictionScore >= 0 && preloadEvictionScore(r, currentViewportPage) >= maxEvictionScore) {
+            m_pixmapRequestsStack.pop();
+            // qCDebug(OkularCoreDebug) << "Ignoring request that doesn't fit in cache";
+            delete r;
+        }
+        // Ignore requests for pixmaps that are already being generated
+        else if (tilesManager && tilesManager->isRequesting(r->normalizedRect(), r->width(), r->height())) {
+            m_pixmapRequestsStack.pop();
+            delete r;
+        }
+        // Another observer is getting the same pixmap rendered, share its render
+        else if (PixmapRequest *executingRequest = coalescingPixmapRequest(r)) {
+            m_pixmapRequestsStack.pop();
+            qCDebug(OkularCoreDebug).nospace() << "waiting for the render of observer=" << executingRequest->observer() << " for observer=" << r->observer() << " " << r->width() << "x" << r->height() << "@" << r->pageNumber();
+            m_coalescedPixmapRequests[executingRequest].append(r);
+        }
+        // With parallel rendering don't render the same page twice for the same observer at the
+        // same time, wait for the running one to be done and decide then
+        // (tiles are fine, they are different parts of the page)
+        else if (m_generator->hasFeature(Generator::ParallelRendering) && !r->isTile() && isPageBeingGenerated(r->observer(), r->pageNumber())) {
+            break;
+        }
+        // If the requested area is above 4*screenSize pixels, and we're not rendering most of the page,  switch on the tile manager
+        else if (!tilesManager && m_generator->hasFeature(Generator::TiledRendering) && (long)r->width() * (long)r->height() > 4L * screenSize && normalizedArea < 0.75 && normalizedArea != 0) {
+            // if the image is too big. start using tiles
+            qCDebug(OkularCoreDebug).nospace() << "Start using tiles on page " << r->pageNumber() << " (" << r->width() << "x" << r->height() << " px);";
 
             // fill the tiles manager with the last rendered pixmap
             const QPixmap *pixmap = r->page()->_o_nearestPixmap(r->observer(), r->width(), r->height());
@@ -1328,11 +2500,12 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
                 tilesManager = new TilesManager(r->pageNumber(), pixmap->width(), pixmap->height(), r->page()->rotation());
                 tilesManager->setPixmap(pixmap, NormalizedRect(0, 0, 1, 1), true /*isPartialPixmap*/);
                 tilesManager->setSize(r->width(), r->height());
+                // so the first zoom steps are painted from it too
+                tilesManager->updatePyramid(*pixmap, NormalizedRect(0, 0, 1, 1), tilesManager->rotation());
             } else {
                 // create new tiles manager
                 tilesManager = new TilesManager(r->pageNumber(), r->width(), r->height(), r->page()->rotation());
             }
-            tilesManager->setRequest(r->normalizedRect(), r->width(), r->height());
             r->page()->deletePixmap(r->observer());
             r->page()->d->setTilesManager(r->observer(), tilesManager);
             r->setTile(true);
@@ -1360,7 +2533,7 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
                 // preload requests issued by PageView if the requested page is
                 // not visible and the user has just switched from a non-tiled
                 // zoom level to a tiled one
-                m_pixmapRequestsStack.pop_back();
+                m_pixmapRequestsStack.pop();
                 delete r;
             }
         }
@@ -1374,7 +2547,7 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
 
             request = r;
         } else if ((long)requestRect.width() * (long)requestRect.height() > 100L * screenSize && (SettingsCore::memoryLevel() != SettingsCore::EnumMemoryLevel::Greedy)) {
-            m_pixmapRequestsStack.pop_back();
+            m_pixmapRequestsStack.pop();
             if (!m_warnedOutOfMemory) {
                 qCWarning(OkularCoreDebug).nospace() << "Running out of memory on page " << r->pageNumber() << " (" << r->width() << "x" << r->height() << " px);";
                 qCWarning(OkularCoreDebug) << "this message will be reported only once.";
@@ -1386,55 +2559,311 @@ void DocumentPrivate::sendGeneratorPixmapRequest()
         }
     }
 
+    // requests made obsolete by newer ones, deleted once the mutex is released
+    const QVector<PixmapRequest *> staleRequests = m_pixmapRequestsStack.takeStale();
+
     // if no request found (or already generated), return
     if (!request) {
         m_pixmapRequestsMutex.unlock();
+        qDeleteAll(staleRequests);
         return;
     }
 
-    // [MEM] preventive memory freeing
-    qulonglong pixmapBytes = 0;
-    TilesManager *tm = request->d->tilesManager();
-    if (tm)
-        pixmapBytes = tm->totalMemory();
-    else
-        pixmapBytes = 4 * request->width() * request->height();
+    // [MEM] preventive memory freeing
+    qulonglong pixmapBytes = 0;
+    TilesManager *tm = request->d->tilesManager();
+    if (tm)
+        pixmapBytes = tm->totalMemory();
+    else
+        pixmapBytes = 4 * request->width() * request->height();
+
+    if (pixmapBytes > (1024 * 1024))
+        cleanupPixmapMemory(memoryToFree /* previously calculated value */);
+
+    // a page we rendered in a previous session doesn't need the generator at all
+    if (requestPixmapFromDiskCache(request)) {
+        m_pixmapRequestsMutex.unlock();
+        qDeleteAll(staleRequests);
+        return;
+    }
+
+    // submit the request to the generator
+    if (m_generator->canGeneratePixmap()) {
+        // generators that prefer it get the small requests that follow in one go
+        const bool batchable = m_generator->hasFeature(Generator::BatchedRendering) && isBatchablePixmapRequest(request, request);
+        Q_ASSERT(m_pixmapRequestsStack.top() == request);
+        m_pixmapRequestsStack.pop();
+        prepareGeneratorPixmapRequest(request);
+
+        QVector<PixmapRequest *> batch;
+        batch << request;
+        if (batchable) {
+            while (batch.count() < kMaxPixmapRequestBatch) {
+                PixmapRequest *r = m_pixmapRequestsStack.top();
+                // the pages of the batch are being generated now, so this also stops at the second request for one of them
+                if (!r || !isBatchablePixmapRequest(r, request) || (m_warmStartPage >= 0 && !r->d->mWarmStart) || (!r->d->mForce && r->preload() && maxEvictionScore >= 0 && preloadEvictionScore(r, currentViewportPage) >= maxEvictionScore))
+                    break;
+                if (requestPixmapFromDiskCache(r))
+                    continue;
+
+                m_pixmapRequestsStack.pop();
+                prepareGeneratorPixmapRequest(r);
+                batch << r;
+            }
+        }
+
+        const bool asynchronous = request->asynchronous();
+        m_waitingForGenerator = false;
+        // we always have to unlock _before_ the generatePixmap() because
+        // a sync generation would end with requestDone() -> deadlock, and
+        // we can not really know if the generator can do async requests
+        m_pixmapRequestsMutex.unlock();
+        qDeleteAll(staleRequests);
+        for (PixmapRequest *r : qAsConst(batch))
+            loadPageData(r->page());
+        if (batch.count() > 1)
+            m_generator->generatePixmaps(batch);
+        else
+            m_generator->generatePixmap(request);
+
+        // generators rendering in parallel can take the next request straight away
+        if (asynchronous && m_generator->hasFeature(Generator::ParallelRendering) && m_generator->canGeneratePixmap()) {
+            m_pixmapRequestsMutex.lock();
+            const bool hasPixmaps = !m_pixmapRequestsStack.isEmpty();
+            m_pixmapRequestsMutex.unlock();
+            if (hasPixmaps)
+                sendGeneratorPixmapRequest();
+        }
+    } else {
+        // the generator will tell us when it can take the request, see generatorPixmapGenerationReady()
+        m_waitingForGenerator = true;
+        m_pixmapRequestsMutex.unlock();
+        qDeleteAll(staleRequests);
+    }
+}
+
+void DocumentPrivate::prepareGeneratorPixmapRequest(PixmapRequest *request)
+{
+    // m_pixmapRequestsMutex must be held by the caller
+    QRect requestRect = !request->isTile() ? QRect(0, 0, request->width(), request->height()) : request->normalizedRect().geometry(request->width(), request->height());
+    qCDebug(OkularCoreDebug).nospace() << "sending request observer=" << request->observer() << " " << requestRect.width() << "x" << requestRect.height() << "@" << request->pageNumber() << " async == " << request->asynchronous()
+                                       << " isTile == " << request->isTile();
+
+    TilesManager *tm = request->d->tilesManager();
+    if (tm)
+        tm->setRequest(request->normalizedRect(), request->width(), request->height());
+
+    if ((int)m_rotation % 2)
+        request->d->swap();
+
+    if (m_rotation != Rotation0 && !request->normalizedRect().isNull())
+        request->setNormalizedRect(TilesManager::fromRotatedRect(request->normalizedRect(), m_rotation));
+
+    // If set elsewhere we already know we want it to be partial
+    // thumbnails and preloaded pages are small or not shown yet, they don't get any
+    const int partialUpdatesPerSecond = SettingsCore::partialUpdatesPerSecond();
+    if (partialUpdatesPerSecond == 0 || request->preload() || (request->d->mFeatures & PixmapRequest::Thumbnail)) {
+        request->setPartialUpdatesWanted(false);
+    } else {
+        if (!request->partialUpdatesWanted() && !request->preview()) {
+            request->setPartialUpdatesWanted(request->asynchronous() && !request->page()->hasPixmap(request->observer()));
+        }
+        request->setPartialUpdateInterval(1000 / partialUpdatesPerSecond);
+    }
+
+    m_executingPixmapRequests.push_back(request);
+    RequestTrace::instant("dispatch", RequestTrace::requestArgs(request));
+    RenderStatisticsPrivate *statistics = observerStatistics(request->observer());
+    ++statistics->generatorRequests;
+    if (request->d->mQueuedTimer.isValid()) {
+        const qint64 waitTime = request->d->mQueuedTimer.elapsed();
+        statistics->queueTime += waitTime;
+        qCDebug(OkularCoreDebug).nospace() << "request waited " << waitTime << " ms in the queue, average " << statistics->queueTime / statistics->generatorRequests << " ms";
+    }
+    request->d->mRenderTimer.start();
+}
+
+bool DocumentPrivate::isBatchablePixmapRequest(PixmapRequest *request, const PixmapRequest *first) const
+{
+    // m_pixmapRequestsMutex must be held by the caller
+    // only small asynchronous full pages, i.e. thumbnails and the like, that
+    // sendGeneratorPixmapRequest() would not drop anyway
+    if (request->observer() != first->observer() || !m_observers.contains(request->observer()))
+        return false;
+    if (!request->asynchronous() || (request->preload() && !m_generator->hasFeature(Generator::Threaded)))
+        return false;
+    if (request->isTile() || request->d->tilesManager() || (long)request->width() * (long)request->height() > kMaxBatchedPixmapArea)
+        return false;
+    if (!request->d->mForce && request->page()->hasPixmap(request->observer(), request->width(), request->height(), request->normalizedRect()))
+        return false;
+    if (request->preview() && request->page()->hasPixmap(request->observer()))
+        return false;
+    return !isPageBeingGenerated(request->observer(), request->pageNumber());
+}
+
+void DocumentPrivate::generatorPixmapGenerationReady()
+{
+    if (!m_waitingForGenerator)
+        return;
+
+    m_waitingForGenerator = false;
+    sendGeneratorPixmapRequest();
+}
+
+QString DocumentPrivate::pixmapDiskCacheRenderHints() const
+{
+    return QStringLiteral("%1|%2|%3|%4")
+        .arg(documentMetaData(Generator::PaperColorMetaData, true).value<QColor>().name())
+        .arg(documentMetaData(Generator::TextAntialiasMetaData, QVariant()).toBool())
+        .arg(documentMetaData(Generator::GraphicsAntialiasMetaData, QVariant()).toBool())
+        .arg(documentMetaData(Generator::TextHintingMetaData, QVariant()).toBool());
+}
+
+bool DocumentPrivate::requestPixmapFromDiskCache(PixmapRequest *request)
+{
+    // m_pixmapRequestsMutex must be held by the caller
+    if (!m_pixmapDiskCache.isActive() || request->isTile() || request->preview() || request->d->mForce)
+        return false;
+
+    // the cache has the images as the generator renders them, i.e. not rotated
+    const bool swapped = (int)m_rotation % 2;
+    const int width = swapped ? request->height() : request->width();
+    const int height = swapped ? request->width() : request->height();
+    QImage image = m_pixmapDiskCache.load(request->pageNumber(), width, height, pixmapDiskCacheRenderHints());
+    if (image.isNull())
+        return false;
+
+    qCDebug(OkularCoreDebug).nospace() << "using cached image observer=" << request->observer() << " " << width << "x" << height << "@" << request->pageNumber();
+    ++observerStatistics(request->observer())->diskCacheHits;
+    Q_ASSERT(m_pixmapRequestsStack.top() == request);
+    m_pixmapRequestsStack.pop();
+    if (swapped)
+        request->d->swap();
+
+    // having a result image also makes sure nobody tries to cancel it
+    request->page()->setPixmap(request->observer(), pixmapFromRender(&image), request->normalizedRect());
+    request->d->mResultImage = image;
+    m_executingPixmapRequests.push_back(request);
+
+    // finish it from the event loop, like a threaded generation, so a long
+    // run of cached pages doesn't recurse into sendGeneratorPixmapRequest()
+    QTimer::singleShot(0, m_parent, [this, request] {
+        if (m_generator && !m_closingLoop && PagePrivate::get(request->page())->needsBoundingBox())
+            setPageBoundingBox(request->pageNumber(), renderedPageBoundingBox(&request->d->mResultImage));
+        // it's already in the cache, don't store it again
+        request->d->mResultImage = QImage();
+        requestDone(request);
+    });
+    return true;
+}
+
+bool DocumentPrivate::isPageBeingGenerated(DocumentObserver *observer, int pageNumber) const
+{
+    // m_pixmapRequestsMutex must be held by the caller
+    for (const PixmapRequest *executingRequest : m_executingPixmapRequests) {
+        if (executingRequest->observer() == observer && executingRequest->pageNumber() == pageNumber)
+            return true;
+    }
+    // the ones waiting for the render of another observer are too
+    for (const QVector<PixmapRequest *> &coalescedRequests : m_coalescedPixmapRequests) {
+        for (const PixmapRequest *coalescedRequest : coalescedRequests) {
+            if (coalescedRequest->observer() == observer && coalescedRequest->pageNumber() == pageNumber)
+                return true;
+        }
+    }
+    return false;
+}
+
+PixmapRequest *DocumentPrivate::coalescingPixmapRequest(const PixmapRequest *request) const
+{
+    // m_pixmapRequestsMutex must be held by the caller
+    // only whole pages: the tiles managers of the observers are laid out
+    // independently, and the rotated pixmaps are made after the render
+    if (request->isTile() || request->preview() || m_rotation != Rotation0 || request->d->tilesManager())
+        return nullptr;
 
-    if (pixmapBytes > (1024 * 1024))
-        cleanupPixmapMemory(memoryToFree /* previously calculated value */);
+    for (PixmapRequest *executingRequest : m_executingPixmapRequests) {
+        if (executingRequest->observer() == request->observer() || executingRequest->pageNumber() != request->pageNumber())
+            continue;
+        if (executingRequest->width() != request->width() || executingRequest->height() != request->height() || !(executingRequest->normalizedRect() == request->normalizedRect()))
+            continue;
+        if (executingRequest->isTile() || executingRequest->preview() || executingRequest->draft() != request->draft() || executingRequest->shouldAbortRender())
+            continue;
+        if (m_observers.contains(executingRequest->observer()))
+            return executingRequest;
+    }
+    return nullptr;
+}
 
-    // submit the request to the generator
-    if (m_generator->canGeneratePixmap()) {
-        QRect requestRect = !request->isTile() ? QRect(0, 0, request->width(), request->height()) : request->normalizedRect().geometry(request->width(), request->height());
-        qCDebug(OkularCoreDebug).nospace() << "sending request observer=" << request->observer() << " " << requestRect.width() << "x" << requestRect.height() << "@" << request->pageNumber() << " async == " << request->asynchronous()
-                                           << " isTile == " << request->isTile();
-        m_pixmapRequestsStack.removeAll(request);
+void DocumentPrivate::finishCoalescedPixmapRequests(const PixmapRequest *request, const QVector<PixmapRequest *> &coalescedRequests)
+{
+    const Page *page = request->page();
+    const bool rendered = !request->shouldAbortRender() && m_observers.contains(request->observer()) && m_rotation == Rotation0 && !page->d->tilesManager(request->observer()) &&
+        page->hasPixmap(request->observer(), request->width(), request->height());
+    const QPixmap *pixmap = rendered ? page->d->m_pixmaps.value(request->observer()).m_pixmap : nullptr;
 
-        if (tm)
-            tm->setRequest(request->normalizedRect(), request->width(), request->height());
+    QVector<PixmapRequest *> requeuedRequests;
+    for (PixmapRequest *coalescedRequest : coalescedRequests) {
+        DocumentObserver *observer = coalescedRequest->observer();
+        if (!m_observers.contains(observer)) {
+            delete coalescedRequest;
+            continue;
+        }
+        // e.g. cancelled, rotated or tiled meanwhile, it has to be rendered after all
+        if (!pixmap || coalescedRequest->page()->d->tilesManager(observer)) {
+            requeuedRequests << coalescedRequest;
+            continue;
+        }
 
-        if ((int)m_rotation % 2)
-            request->d->swap();
+        // the pixmaps share their data, it stays charged to the rendered one
+        ++observerStatistics(observer)->coalescedRequests;
+        coalescedRequest->page()->d->setRotatedPixmap(observer, new QPixmap(*pixmap));
+        AllocatedPixmap *source = m_allocatedPixmaps.value(request->observer(), request->pageNumber());
+        if (source) {
+            AllocatedPixmap *previous = m_allocatedPixmaps.take(observer, coalescedRequest->pageNumber());
+            if (previous) {
+                m_allocatedPixmapsTotalMemory -= previous->memory;
+                delete previous;
+            }
+            m_allocatedPixmaps.insert(new AllocatedPixmap(observer, coalescedRequest->pageNumber(), 0, source->renderTime, source));
+            recordFirstPixmap(observer);
+        } else {
+            setAllocatedPixmap(observer, coalescedRequest->pageNumber(), 4 * coalescedRequest->width() * coalescedRequest->height());
+        }
+        if (coalescedRequest->draft())
+            m_draftPixmaps.insert(qMakePair(observer, coalescedRequest->pageNumber()), coalescedRequest->priority() - (coalescedRequest->d->mWarmStart ? kWarmStartPriority : 0));
+        else
+            m_draftPixmaps.remove(qMakePair(observer, coalescedRequest->pageNumber()));
+        observer->notifyPageChanged(coalescedRequest->pageNumber(), DocumentObserver::Pixmap);
+        delete coalescedRequest;
+    }
 
-        if (m_rotation != Rotation0 && !request->normalizedRect().isNull())
-            request->setNormalizedRect(TilesManager::fromRotatedRect(request->normalizedRect(), m_rotation));
+    if (!requeuedRequests.isEmpty()) {
+        QMutexLocker locker(&m_pixmapRequestsMutex);
+        for (PixmapRequest *requeuedRequest : qAsConst(requeuedRequests))
+            m_pixmapRequestsStack.push(requeuedRequest);
+    }
+}
 
-        // If set elsewhere we already know we want it to be partial
-        if (!request->partialUpdatesWanted()) {
-            request->setPartialUpdatesWanted(request->asynchronous() && !request->page()->hasPixmap(request->observer()));
+QVector<PixmapRequest *> DocumentPrivate::takeCoalescedPixmapRequests(DocumentObserver *observer, int pageNumber)
+{
+    // m_pixmapRequestsMutex must be held by the caller
+    QVector<PixmapRequest *> takenRequests;
+    for (auto it = m_coalescedPixmapRequests.begin(); it != m_coalescedPixmapRequests.end();) {
+        QVector<PixmapRequest *> &coalescedRequests = it.value();
+        for (int i = coalescedRequests.count() - 1; i >= 0; --i) {
+            PixmapRequest *coalescedRequest = coalescedRequests.at(i);
+            if (!observer || (coalescedRequest->observer() == observer && (pageNumber == -1 || coalescedRequest->pageNumber() == pageNumber))) {
+                takenRequests << coalescedRequest;
+                coalescedRequests.remove(i);
+            }
         }
-
-        // we always have to unlock _before_ the generatePixmap() because
-        // a sync generation would end with requestDone() -> deadlock, and
-        // we can not really know if the generator can do async requests
-        m_executingPixmapRequests.push_back(request);
-        m_pixmapRequestsMutex.unlock();
-        m_generator->generatePixmap(request);
-    } else {
-        m_pixmapRequestsMutex.unlock();
-        // pino (7/4/2006): set the polling interval from 10 to 30
-        QTimer::singleShot(30, m_parent, [this] { sendGeneratorPixmapRequest(); });
+        if (coalescedRequests.isEmpty())
+            it = m_coalescedPixmapRequests.erase(it);
+        else
+            ++it;
     }
+    return takenRequests;
 }
 
 void DocumentPrivate::rotationFinished(int page, Okular::Page *okularPage)
@@ -1492,9 +2921,12 @@ void DocumentPrivate::slotGeneratorConfigChanged()
         }
 
         // [MEM] remove allocation descriptors
-        qDeleteAll(m_allocatedPixmaps);
         m_allocatedPixmaps.clear();
         m_allocatedPixmapsTotalMemory = 0;
+        m_pixmapDiskCache.clear();
+        m_thumbnailDiskCache.clear();
+        cancelThumbnailLoads();
+        m_compressedPixmaps.clear();
 
         // send reload signals to observers
         foreachObserverD(notifyContentsCleared(DocumentObserver::Pixmap));
@@ -1505,12 +2937,18 @@ void DocumentPrivate::slotGeneratorConfigChanged()
         cleanupPixmapMemory();
 }
 
-void DocumentPrivate::refreshPixmaps(int pageNumber)
+void DocumentPrivate::refreshPixmaps(int pageNumber, const NormalizedRect &area)
 {
     Page *page = m_pagesVector.value(pageNumber, nullptr);
     if (!page)
         return;
 
+    // the page no longer looks like it does in the file
+    m_generator->pageModified(pageNumber);
+    m_pixmapDiskCache.markPageDirty(pageNumber);
+    m_thumbnailDiskCache.markPageDirty(pageNumber);
+    m_compressedPixmaps.removePage(pageNumber);
+
     QMap<DocumentObserver *, PagePrivate::PixmapObject>::ConstIterator it = page->d->m_pixmaps.constBegin(), itEnd = page->d->m_pixmaps.constEnd();
     QVector<Okular::PixmapRequest *> pixmapsToRequest;
     for (; it != itEnd; ++it) {
@@ -1533,7 +2971,11 @@ void DocumentPrivate::refreshPixmaps(int pageNumber)
 
         TilesManager *tilesManager = page->d->tilesManager(observer);
         if (tilesManager) {
-            tilesManager->markDirty();
+            // only the tiles under the changed area need to be rendered again
+            if (area.isNull())
+                tilesManager->markDirty();
+            else
+                tilesManager->markDirty(area);
 
             PixmapRequest *p = new PixmapRequest(observer, pageNumber, tilesManager->width(), tilesManager->height(), 1 /* dpr */, 1, PixmapRequest::Asynchronous);
 
@@ -1547,6 +2989,11 @@ void DocumentPrivate::refreshPixmaps(int pageNumber)
                 }
             }
 
+            if (!visibleRect.isNull() && !area.isNull()) {
+                const NormalizedRect rotatedArea = TilesManager::toRotatedRect(area, page->rotation());
+                visibleRect = rotatedArea.intersects(visibleRect) ? visibleRect & rotatedArea : NormalizedRect();
+            }
+
             if (!visibleRect.isNull()) {
                 p->setNormalizedRect(visibleRect);
                 p->setTile(true);
@@ -1561,14 +3008,56 @@ void DocumentPrivate::refreshPixmaps(int pageNumber)
     }
 }
 
+void DocumentPrivate::refreshShownPixmaps(int pageNumber)
+{
+    Page *page = m_pagesVector.value(pageNumber, nullptr);
+    if (!page)
+        return;
+
+    // rendering again the pages scrolled away is wasted if they change again
+    // before being shown, they are rendered when asked for
+    bool shown = false;
+    for (DocumentObserver *observer : qAsConst(m_observers)) {
+        if (!page->hasPixmap(observer) && !page->d->tilesManager(observer))
+            continue;
+        if (!observer->canUnloadPixmap(pageNumber)) {
+            shown = true;
+            continue;
+        }
+        AllocatedPixmap *p = m_allocatedPixmaps.take(observer, pageNumber);
+        if (p) {
+            m_allocatedPixmapsTotalMemory -= p->memory;
+            delete p;
+        }
+        page->deletePixmap(observer);
+    }
+
+    if (shown) {
+        refreshPixmaps(pageNumber);
+        return;
+    }
+    m_generator->pageModified(pageNumber);
+    m_pixmapDiskCache.markPageDirty(pageNumber);
+    m_thumbnailDiskCache.markPageDirty(pageNumber);
+    m_compressedPixmaps.removePage(pageNumber);
+}
+
 void DocumentPrivate::_o_configChanged()
 {
     // free text pages if needed
     calculateMaxTextPages();
-    while (m_allocatedTextPagesFifo.count() > m_maxAllocatedTextPages) {
-        int pageToKick = m_allocatedTextPagesFifo.takeFirst();
-        m_pagesVector.at(pageToKick)->setTextPage(nullptr); // deletes the textpage
-    }
+    evictTextPages();
+
+    updateCompressedPixmapsBudget();
+}
+
+void DocumentPrivate::updateCompressedPixmapsBudget()
+{
+    // the low profile wants the memory back, not compressed
+    if (SettingsCore::memoryLevel() == SettingsCore::EnumMemoryLevel::Low)
+        m_compressedPixmaps.setMaxBytes(0);
+    else
+        m_compressedPixmaps.setMaxBytes(qulonglong(SettingsCore::compressedPixmapCacheSize()) * 1024 * 1024);
 }
 
 void DocumentPrivate::doContinueDirectionMatchSearch(void *doContinueDirectionMatchSearchStruct)
@@ -1576,7 +3065,16 @@ void DocumentPrivate::doContinueDirectionMatchSearch(void *doContinueDirectionMa
     DoContinueDirectionMatchSearchStruct *searchStruct = static_cast<DoContinueDirectionMatchSearchStruct *>(doContinueDirectionMatchSearchStruct);
     RunningSearch *search = m_searches.value(searchStruct->searchID);
 
-    if ((m_searchCancelled && !searchStruct->match) || !search) {
+    // a newer search with the same id took over, it tells how it ends
+    if (search && search->generation != searchStruct->generation) {
+        QApplication::restoreOverrideCursor();
+        delete searchStruct->match;
+        delete searchStruct->pagesToNotify;
+        delete searchStruct;
+        return;
+    }
+
+    if (!search || ((m_searchCancelled || search->cancelled) && !searchStruct->match)) {
         // if the user cancelled but he just got a match, give him the match!
         QApplication::restoreOverrideCursor();
 
@@ -1610,8 +3108,22 @@ void DocumentPrivate::doContinueDirectionMatchSearch(void *doContinueDirectionMa
         // get page
         Page *page = m_pagesVector[searchStruct->currentPage];
         // request search page if needed
-        if (!page->hasTextPage())
+        if (!page->hasTextPage()) {
+            // wait for it from the background, with the next pages lined up
+            // behind it; it is only extracted here if that gave none
+            if (searchStruct->textPageRequested != page->number()) {
+                for (int i = kSearchTextPageLookahead; i > 0; --i) {
+                    const int nextPage = searchStruct->currentPage + (forward ? i : -i);
+                    if (nextPage >= 0 && nextPage < m_pagesVector.count())
+                        requestTextPage(nextPage, Document::SearchTextPagePriority);
+                }
+                if (requestTextPage(page->number(), Document::SearchTextPagePriority, [this, searchStruct] { doContinueDirectionMatchSearch(searchStruct); })) {
+                    searchStruct->textPageRequested = page->number();
+                    return;
+                }
+            }
             m_parent->requestTextPage(page->number());
+        }
 
         // if found a match on the current page, end the loop
         searchStruct->match = page->findText(searchStruct->searchID, search->cachedString, forward ? FromTop : FromBottom, search->cachedCaseSensitivity);
@@ -1641,6 +3153,8 @@ void DocumentPrivate::doProcessSearchMatch(RegularAreaRect *match, RunningSearch
     bool foundAMatch = false;
 
     search->isCurrentlySearching = false;
+    search->upcomingMatchPages.clear();
+    search->upcomingMatchRects.clear();
 
     // if a match has been found..
     if (match) {
@@ -1649,12 +3163,36 @@ void DocumentPrivate::doProcessSearchMatch(RegularAreaRect *match, RunningSearch
         search->continueOnPage = currentPage;
         search->continueOnMatch = *match;
         search->highlightedPages.insert(currentPage);
+        m_allocatedTextPages.touch(currentPage);
         // ..add highlight to the page..
         m_pagesVector[currentPage]->d->setHighlight(searchID, match, color);
 
         // ..queue page for notifying changes..
         pagesToNotify->insert(currentPage);
 
+        // ..look for the pages the next matches are likely on..
+        if (search->cachedType == Document::NextMatch || search->cachedType == Document::PreviousMatch) {
+            const bool forward = search->cachedType == Document::NextMatch;
+            const QBitArray candidates = m_textSearchIndex.candidatePages(search->cachedString);
+            const int pageCount = m_pagesVector.count();
+            for (int i = 1; i < pageCount && search->upcomingMatchPages.count() < kSearchUpcomingMatchPages; ++i) {
+                // the search goes on from the other end
+                const int page = (currentPage + (forward ? i : pageCount - i)) % pageCount;
+                // the pages not indexed yet are candidates, but they may well not match
+                if (!m_textSearchIndex.isIndexed(page) || page >= candidates.size() || !candidates.testBit(page))
+                    continue;
+
+                // where the views show the page once the search gets there
+                NormalizedRect matchRect;
+                if (RegularAreaRect *upcomingMatch = m_pagesVector.at(page)->findText(searchID, search->cachedString, forward ? FromTop : FromBottom, search->cachedCaseSensitivity)) {
+                    matchRect = upcomingMatch->first();
+                    delete upcomingMatch;
+                }
+                search->upcomingMatchPages.append(page);
+                search->upcomingMatchRects.append(matchRect);
+            }
+        }
+
         // Create a normalized rectangle around the search match that includes a 5% buffer on all sides.
         const Okular::NormalizedRect matchRectWithBuffer = Okular::NormalizedRect(match->first().left - 0.05, match->first().top - 0.05, match->first().right + 0.05, match->first().bottom + 0.05);
 
@@ -1672,9 +3210,7 @@ void DocumentPrivate::doProcessSearchMatch(RegularAreaRect *match, RunningSearch
     }
 
     // notify observers about highlights changes
-    foreach (int pageNumber, *pagesToNotify)
-        foreach (DocumentObserver *observer, m_observers)
-            observer->notifyPageChanged(pageNumber, DocumentObserver::Highlights);
+    notifyPagesChanged(*pagesToNotify, DocumentObserver::Highlights);
 
     if (foundAMatch)
         emit m_parent->searchFinished(searchID, Document::MatchFound);
@@ -1684,202 +3220,208 @@ void DocumentPrivate::doProcessSearchMatch(RegularAreaRect *match, RunningSearch
     delete pagesToNotify;
 }
 
-void DocumentPrivate::doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID)
+// the color of the matches of the word number @p word of a GoogleAll or GoogleAny search
+static QColor searchWordColor(const QColor &baseColor, int word, int wordCount)
+{
+    const int hueStep = (wordCount > 1) ? (60 / (wordCount - 1)) : 60;
+    int baseHue, baseSat, baseVal;
+    baseColor.getHsv(&baseHue, &baseSat, &baseVal);
+    int newHue = baseHue - word * hueStep;
+    if (newHue < 0)
+        newHue += 360;
+    return QColor::fromHsv(newHue, baseSat, baseVal);
+}
+
+// whether the pages a whole document search for @p words can match are among
+// the ones a search of the same kind for @p previousWords matched
+static bool searchNarrows(const QStringList &previousWords, const QStringList &words, Document::SearchType type, Qt::CaseSensitivity caseSensitivity)
+{
+    if (previousWords.isEmpty() || words.isEmpty())
+        return false;
+
+    const auto containsAny = [caseSensitivity](const QString &word, const QStringList &others) {
+        return std::any_of(others.constBegin(), others.constEnd(), [&](const QString &other) { return word.contains(other, caseSensitivity); });
+    };
+    if (type == Document::GoogleAny) {
+        // a page with any of the words has one of the previous ones if every word contains one
+        return std::all_of(words.constBegin(), words.constEnd(), [&](const QString &word) { return containsAny(word, previousWords); });
+    }
+
+    // a page with all the words has all the previous ones if every one of them is in a word
+    return std::all_of(previousWords.constBegin(), previousWords.constEnd(), [&](const QString &previous) {
+        return std::any_of(words.constBegin(), words.constEnd(), [&](const QString &word) { return word.contains(previous, caseSensitivity); });
+    });
+}
+
+void DocumentPrivate::startDocumentSearch(int searchID)
 {
-    QMap<Page *, QVector<RegularAreaRect *>> *pageMatches = static_cast<QMap<Page *, QVector<RegularAreaRect *>> *>(pageMatchesMap);
-    QSet<int> *pagesToNotify = static_cast<QSet<int> *>(pagesToNotifySet);
     RunningSearch *search = m_searches.value(searchID);
+    const int generation = search->generation;
 
-    if (m_searchCancelled || !search) {
-        typedef QVector<RegularAreaRect *> MatchesVector;
+    // the generator can't give the text of the pages from another thread,
+    // so look at them one by one without blocking the user interface too long
+    if (!m_generator->hasFeature(Generator::Threaded)) {
+        QTimer::singleShot(0, m_parent, [this, searchID, generation] { doContinueDocumentSearch(0, searchID, generation); });
+        return;
+    }
 
-        QApplication::restoreOverrideCursor();
+    // the search thread gets a copy of the text pages we have, they may go away meanwhile
+    QVector<QPair<Page *, TextPage *>> pages;
+    for (Page *page : qAsConst(m_pagesVector)) {
+        const int pageNumber = page->number();
+        if (pageNumber < search->candidatePages.size() && !search->candidatePages.testBit(pageNumber))
+            continue;
+        pages.append(qMakePair(page, page->d->copyTextPage()));
+    }
 
-        if (search)
-            search->isCurrentlySearching = false;
+    const QSharedPointer<QAtomicInt> aborted(new QAtomicInt(0));
+    search->abortSearch = aborted;
+    m_searchPool.setMaxThreadCount(1);
+    m_searchPool.start(new TextSearchTask(
+        m_generator,
+        &m_textPageDiskCache,
+        pages,
+        search->searchWords,
+        search->cachedType != Document::GoogleAny,
+        search->cachedCaseSensitivity,
+        aborted,
+        [this, searchID, generation](int pageNumber, TextPage *textPage, const TextSearchTask::Matches &matches) {
+            queueDocumentSearchResult({searchID, generation, pageNumber, textPage, matches, false});
+        },
+        [this, searchID, generation, aborted] { queueDocumentSearchResult({searchID, generation, -1, nullptr, TextSearchTask::Matches(), aborted->loadAcquire() != 0}); }));
+}
 
-        emit m_parent->searchFinished(searchID, Document::SearchCancelled);
-        foreach (const MatchesVector &mv, *pageMatches)
-            qDeleteAll(mv);
-        delete pageMatches;
-        delete pagesToNotify;
+void DocumentPrivate::doContinueDocumentSearch(int currentPage, int searchID, int generation)
+{
+    RunningSearch *search = m_searches.value(searchID);
+    if (m_searchCancelled || !search || search->cancelled || search->generation != generation) {
+        finishDocumentSearch(searchID, generation, true);
         return;
     }
 
-    if (currentPage < m_pagesVector.count()) {
-        // get page (from the first to the last)
-        Page *page = m_pagesVector.at(currentPage);
-        int pageNumber = page->number(); // redundant? is it == currentPage ?
+    // the text search index knows these pages can't match, don't even get their text
+    while (currentPage < search->candidatePages.size() && !search->candidatePages.testBit(currentPage))
+        ++currentPage;
 
-        // request search page if needed
-        if (!page->hasTextPage())
-            m_parent->requestTextPage(pageNumber);
-
-        // loop on a page adding highlights for all found items
-        RegularAreaRect *lastMatch = nullptr;
-        while (true) {
-            if (lastMatch)
-                lastMatch = page->findText(searchID, search->cachedString, NextResult, search->cachedCaseSensitivity, lastMatch);
-            else
-                lastMatch = page->findText(searchID, search->cachedString, FromTop, search->cachedCaseSensitivity);
+    if (currentPage >= m_pagesVector.count()) {
+        finishDocumentSearch(searchID, generation, false);
+        return;
+    }
 
-            if (!lastMatch)
-                break;
+    // request search page if needed
+    Page *page = m_pagesVector.at(currentPage);
+    if (!page->hasTextPage())
+        m_parent->requestTextPage(currentPage);
 
-            // add highlight rect to the matches map
-            (*pageMatches)[page].append(lastMatch);
-        }
-        delete lastMatch;
+    if (page->d->m_text) {
+        const TextSearchTask::Matches matches = TextSearchTask::findMatches(page->d->m_text, search->searchWords, search->cachedType != Document::GoogleAny, search->cachedCaseSensitivity);
+        if (!matches.isEmpty())
+            showSearchMatches(search, searchID, currentPage, matches);
+    }
 
-        QTimer::singleShot(0, m_parent, [this, pagesToNotifySet, pageMatches, currentPage, searchID] { doContinueAllDocumentSearch(pagesToNotifySet, pageMatches, currentPage + 1, searchID); });
-    } else {
-        // reset cursor to previous shape
-        QApplication::restoreOverrideCursor();
+    QTimer::singleShot(0, m_parent, [this, currentPage, searchID, generation] { doContinueDocumentSearch(currentPage + 1, searchID, generation); });
+}
 
-        search->isCurrentlySearching = false;
-        bool foundAMatch = pageMatches->count() != 0;
-        QMap<Page *, QVector<RegularAreaRect *>>::const_iterator it, itEnd;
-        it = pageMatches->constBegin();
-        itEnd = pageMatches->constEnd();
-        for (; it != itEnd; ++it) {
-            foreach (RegularAreaRect *match, it.value()) {
-                it.key()->d->setHighlight(searchID, match, search->cachedColor);
-                delete match;
-            }
-            search->highlightedPages.insert(it.key()->number());
-            pagesToNotify->insert(it.key()->number());
-        }
+void DocumentPrivate::queueDocumentSearchResult(const DocumentSearchResult &result)
+{
+    // called in the search thread, the results are picked all together
+    QMutexLocker locker(&m_documentSearchResultsMutex);
+    m_documentSearchResults.append(result);
+    if (m_documentSearchResults.count() == 1)
+        QMetaObject::invokeMethod(m_parent, [this] { documentSearchResultsReady(); }, Qt::QueuedConnection);
+}
 
-        foreach (DocumentObserver *observer, m_observers)
-            observer->notifySetup(m_pagesVector, 0);
+void DocumentPrivate::documentSearchResultsReady()
+{
+    m_documentSearchResultsMutex.lock();
+    const QVector<DocumentSearchResult> results = m_documentSearchResults;
+    m_documentSearchResults.clear();
+    m_documentSearchResultsMutex.unlock();
 
-        // notify observers about highlights changes
-        foreach (int pageNumber, *pagesToNotify)
-            foreach (DocumentObserver *observer, m_observers)
-                observer->notifyPageChanged(pageNumber, DocumentObserver::Highlights);
+    for (const DocumentSearchResult &result : results) {
+        if (result.pageNumber < 0) {
+            finishDocumentSearch(result.searchID, result.generation, result.cancelled);
+            continue;
+        }
 
-        if (foundAMatch)
-            emit m_parent->searchFinished(searchID, Document::MatchFound);
-        else
-            emit m_parent->searchFinished(searchID, Document::NoMatchFound);
+        // the text the search had to extract may be useful later
+        if (result.textPage)
+            adoptTextPage(result.pageNumber, result.textPage);
 
-        delete pageMatches;
-        delete pagesToNotify;
+        RunningSearch *search = m_searches.value(result.searchID);
+        if (search && search->generation == result.generation && !result.matches.isEmpty())
+            showSearchMatches(search, result.searchID, result.pageNumber, result.matches);
     }
 }
 
-void DocumentPrivate::doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList &words)
+void DocumentPrivate::showSearchMatches(RunningSearch *search, int searchID, int pageNumber, const TextSearchTask::Matches &matches)
 {
-    typedef QPair<RegularAreaRect *, QColor> MatchColor;
-    QMap<Page *, QVector<MatchColor>> *pageMatches = static_cast<QMap<Page *, QVector<MatchColor>> *>(pageMatchesMap);
-    QSet<int> *pagesToNotify = static_cast<QSet<int> *>(pagesToNotifySet);
-    RunningSearch *search = m_searches.value(searchID);
+    QVector<QColor> wordColors;
+    wordColors.reserve(search->searchWords.count());
+    for (int w = 0; w < search->searchWords.count(); ++w)
+        wordColors.append(search->cachedType == Document::AllDocument ? search->cachedColor : searchWordColor(search->cachedColor, w, search->searchWords.count()));
 
-    if (m_searchCancelled || !search) {
-        typedef QVector<MatchColor> MatchesVector;
+    // matches are found in the unrotated page
+    m_pagesVector.at(pageNumber)->d->addSearchHighlights(searchID, matches, wordColors);
+    search->highlightedPages.insert(pageNumber);
 
-        QApplication::restoreOverrideCursor();
+    notifyPagesChanged({pageNumber}, DocumentObserver::Highlights);
 
-        if (search)
-            search->isCurrentlySearching = false;
+    emit m_parent->searchMatchesFound(searchID, pageNumber, matches.count());
+}
 
-        emit m_parent->searchFinished(searchID, Document::SearchCancelled);
+void DocumentPrivate::finishDocumentSearch(int searchID, int generation, bool cancelled)
+{
+    // every whole document search set it once
+    QApplication::restoreOverrideCursor();
 
-        foreach (const MatchesVector &mv, *pageMatches) {
-            foreach (const MatchColor &mc, mv)
-                delete mc.first;
-        }
-        delete pageMatches;
-        delete pagesToNotify;
+    RunningSearch *search = m_searches.value(searchID);
+    if (!search) {
+        emit m_parent->searchFinished(searchID, Document::SearchCancelled);
         return;
     }
 
-    const int wordCount = words.count();
-    const int hueStep = (wordCount > 1) ? (60 / (wordCount - 1)) : 60;
-    int baseHue, baseSat, baseVal;
-    search->cachedColor.getHsv(&baseHue, &baseSat, &baseVal);
-
-    if (currentPage < m_pagesVector.count()) {
-        // get page (from the first to the last)
-        Page *page = m_pagesVector.at(currentPage);
-        int pageNumber = page->number(); // redundant? is it == currentPage ?
-
-        // request search page if needed
-        if (!page->hasTextPage())
-            m_parent->requestTextPage(pageNumber);
-
-        // loop on a page adding highlights for all found items
-        bool allMatched = wordCount > 0, anyMatched = false;
-        for (int w = 0; w < wordCount; w++) {
-            const QString &word = words[w];
-            int newHue = baseHue - w * hueStep;
-            if (newHue < 0)
-                newHue += 360;
-            QColor wordColor = QColor::fromHsv(newHue, baseSat, baseVal);
-            RegularAreaRect *lastMatch = nullptr;
-            // add all highlights for current word
-            bool wordMatched = false;
-            while (true) {
-                if (lastMatch)
-                    lastMatch = page->findText(searchID, word, NextResult, search->cachedCaseSensitivity, lastMatch);
-                else
-                    lastMatch = page->findText(searchID, word, FromTop, search->cachedCaseSensitivity);
-
-                if (!lastMatch)
-                    break;
-
-                // add highligh rect to the matches map
-                (*pageMatches)[page].append(MatchColor(lastMatch, wordColor));
-                wordMatched = true;
-            }
-            allMatched = allMatched && wordMatched;
-            anyMatched = anyMatched || wordMatched;
-        }
-
-        // if not all words are present in page, remove partial highlights
-        const bool matchAll = search->cachedType == Document::GoogleAll;
-        if (!allMatched && matchAll) {
-            QVector<MatchColor> &matches = (*pageMatches)[page];
-            foreach (const MatchColor &mc, matches)
-                delete mc.first;
-            pageMatches->remove(page);
-        }
+    // a newer search with the same id took over
+    if (search->generation != generation)
+        return;
 
-        QTimer::singleShot(0, m_parent, [this, pagesToNotifySet, pageMatches, currentPage, searchID, words] { doContinueGooglesDocumentSearch(pagesToNotifySet, pageMatches, currentPage + 1, searchID, words); });
-    } else {
-        // reset cursor to previous shape
-        QApplication::restoreOverrideCursor();
+    search->isCurrentlySearching = false;
+    search->abortSearch.clear();
 
-        search->isCurrentlySearching = false;
-        bool foundAMatch = pageMatches->count() != 0;
-        QMap<Page *, QVector<MatchColor>>::const_iterator it, itEnd;
-        it = pageMatches->constBegin();
-        itEnd = pageMatches->constEnd();
-        for (; it != itEnd; ++it) {
-            foreach (const MatchColor &mc, it.value()) {
-                it.key()->d->setHighlight(searchID, mc.first, mc.second);
-                delete mc.first;
-            }
-            search->highlightedPages.insert(it.key()->number());
-            pagesToNotify->insert(it.key()->number());
-        }
+    if (!cancelled) {
+        search->completedWords = search->searchWords;
+        search->completedType = search->cachedType;
+        search->completedCaseSensitivity = search->cachedCaseSensitivity;
+        search->completedPages = search->highlightedPages;
+        search->completedPageCount = m_pagesVector.count();
+    }
 
-        // send page lists to update observers (since some filter on bookmarks)
-        foreach (DocumentObserver *observer, m_observers)
-            observer->notifySetup(m_pagesVector, 0);
+    if (cancelled)
+        emit m_parent->searchFinished(searchID, Document::SearchCancelled);
+    else if (!search->highlightedPages.isEmpty())
+        emit m_parent->searchFinished(searchID, Document::MatchFound);
+    else
+        emit m_parent->searchFinished(searchID, Document::NoMatchFound);
+}
 
-        // notify observers about highlights changes
-        foreach (int pageNumber, *pagesToNotify)
-            foreach (DocumentObserver *observer, m_observers)
-                observer->notifyPageChanged(pageNumber, DocumentObserver::Highlights);
+void DocumentPrivate::cancelDocumentSearches()
+{
+    for (RunningSearch *search : qAsConst(m_searches)) {
+        if (search->abortSearch)
+            search->abortSearch->storeRelease(1);
+    }
+    m_searchPool.waitForDone();
 
-        if (foundAMatch)
-            emit m_parent->searchFinished(searchID, Document::MatchFound);
-        else
-            emit m_parent->searchFinished(searchID, Document::NoMatchFound);
+    // the searches end as cancelled, the text they extracted is lost
+    m_documentSearchResultsMutex.lock();
+    const QVector<DocumentSearchResult> results = m_documentSearchResults;
+    m_documentSearchResults.clear();
+    m_documentSearchResultsMutex.unlock();
 
-        delete pageMatches;
-        delete pagesToNotify;
+    for (const DocumentSearchResult &result : results) {
+        delete result.textPage;
+        if (result.pageNumber < 0)
+            finishDocumentSearch(result.searchID, result.generation, true);
     }
 }
 
@@ -1948,104 +3490,234 @@ bool DocumentPrivate::isNormalizedRectangleFullyVisible(const Okular::Normalized
     return rectFullyVisible;
 }
 
-struct pdfsyncpoint {
-    QString file;
-    qlonglong x;
-    qlonglong y;
-    int row;
-    int column;
-    int page;
+class SynctexScannerTask : public QRunnable
+{
+public:
+    SynctexScannerTask(const QString &docFile, QMutex *mutex, synctex_scanner_p *result, QVector<pdfsyncpoint> *points, const std::function<void()> &finished)
+        : m_docFile(docFile)
+        , m_mutex(mutex)
+        , m_result(result)
+        , m_points(points)
+        , m_finished(finished)
+    {
+    }
+
+    void run() override
+    {
+        synctex_scanner_p scanner = synctex_scanner_new_with_output_file(QFile::encodeName(m_docFile).constData(), nullptr, 1);
+        QVector<pdfsyncpoint> points;
+        if (!scanner)
+            points = DocumentPrivate::readSyncFile(m_docFile);
+        m_mutex->lock();
+        *m_result = scanner;
+        *m_points = points;
+        m_mutex->unlock();
+        m_finished();
+    }
+
+private:
+    QString m_docFile;
+    QMutex *m_mutex;
+    synctex_scanner_p *m_result;
+    QVector<pdfsyncpoint> *m_points;
+    std::function<void()> m_finished;
 };
 
-void DocumentPrivate::loadSyncFile(const QString &filePath)
+void DocumentPrivate::loadSynctexScanner(const QString &docFile)
 {
-    QFile f(filePath + QLatin1String("sync"));
-    if (!f.open(QIODevice::ReadOnly))
+    closeSynctexScanner();
+
+    m_synctexDocFile = docFile;
+    m_synctexLoading = true;
+    const int generation = ++m_synctexGeneration;
+    m_synctexPool.setMaxThreadCount(1);
+    m_synctexPool.start(new SynctexScannerTask(docFile, &m_synctexMutex, &m_synctexLoadedScanner, &m_synctexLoadedPoints, [this, generation] {
+        QMetaObject::invokeMethod(m_parent, [this, generation] { finishSynctexLoading(generation); }, Qt::QueuedConnection);
+    }));
+}
+
+void DocumentPrivate::finishSynctexLoading(int generation)
+{
+    // from a build that was waited for already, or for a file that is gone
+    if (!m_synctexLoading || generation != m_synctexGeneration)
         return;
 
-    QTextStream ts(&f);
+    m_synctexMutex.lock();
+    m_synctex_scanner = m_synctexLoadedScanner;
+    m_synctexLoadedScanner = nullptr;
+    const QVector<pdfsyncpoint> points = m_synctexLoadedPoints;
+    m_synctexLoadedPoints.clear();
+    m_synctexMutex.unlock();
+    m_synctexLoading = false;
+
+    if (!points.isEmpty())
+        addSyncPoints(points);
+}
+
+synctex_scanner_p DocumentPrivate::synctexScanner()
+{
+    if (m_synctexLoading) {
+        m_synctexPool.waitForDone();
+        finishSynctexLoading(m_synctexGeneration);
+    }
+    return m_synctex_scanner;
+}
+
+void DocumentPrivate::closeSynctexScanner()
+{
+    m_synctexPool.waitForDone();
+    m_synctexLoading = false;
+    ++m_synctexGeneration;
+
+    if (m_synctexLoadedScanner) {
+        synctex_scanner_free(m_synctexLoadedScanner);
+        m_synctexLoadedScanner = nullptr;
+    }
+    m_synctexLoadedPoints.clear();
+    if (m_synctex_scanner) {
+        synctex_scanner_free(m_synctex_scanner);
+        m_synctex_scanner = nullptr;
+    }
+}
+
+// the next token of the line from pos on, tokens are separated by spaces
+static QByteArray nextSyncToken(const char *line, int length, int *pos)
+{
+    while (*pos < length && line[*pos] == ' ')
+        ++*pos;
+    const int start = *pos;
+    while (*pos < length && line[*pos] != ' ')
+        ++*pos;
+    return QByteArray::fromRawData(line + start, *pos - start);
+}
+
+// like QString::toInt(), 0 if it is no number
+static qlonglong syncNumber(const QByteArray &token)
+{
+    const int length = token.size();
+    int i = length > 0 && (token.at(0) == '-' || token.at(0) == '+') ? 1 : 0;
+    if (i == length || length - i > 18)
+        return 0;
+    qlonglong number = 0;
+    for (; i < length; ++i) {
+        const char c = token.at(i);
+        if (c < '0' || c > '9')
+            return 0;
+        number = number * 10 + (c - '0');
+    }
+    return token.at(0) == '-' ? -number : number;
+}
+
+QVector<pdfsyncpoint> DocumentPrivate::readSyncFile(const QString &filePath)
+{
+    QFile f(filePath + QLatin1String("sync"));
+    if (!f.open(QIODevice::ReadOnly) || f.size() == 0)
+        return QVector<pdfsyncpoint>();
+
+    const qint64 size = f.size();
+    const char *data = reinterpret_cast<const char *>(f.map(0, size));
+    QByteArray contents;
+    if (!data) {
+        contents = f.readAll();
+        data = contents.constData();
+    }
+    const char *const end = data + size;
+
+    // the lines without the end of line
+    auto nextLine = [&data, end](int *length) {
+        const char *line = data;
+        const char *newline = static_cast<const char *>(memchr(data, '\n', end - data));
+        data = newline ? newline + 1 : end;
+        *length = int((newline ? newline : end) - line);
+        if (*length > 0 && line[*length - 1] == '\r')
+            --*length;
+        return line;
+    };
+
+    int length;
     // first row: core name of the pdf output
-    const QString coreName = ts.readLine();
+    const char *line = nextLine(&length);
+    const QString coreName = QString::fromLocal8Bit(line, length);
     // second row: version string, in the form 'Version %u'
-    const QString versionstr = ts.readLine();
-    // anchor the pattern with \A and \z to match the entire subject string
-    // TODO: with Qt 5.12 QRegularExpression::anchoredPattern() can be used instead
-    QRegularExpression versionre(QStringLiteral("\\AVersion \\d+\\z"), QRegularExpression::CaseInsensitiveOption);
-    QRegularExpressionMatch match = versionre.match(versionstr);
-    if (!match.hasMatch()) {
-        return;
-    }
+    line = nextLine(&length);
+    static const QRegularExpression versionre(QStringLiteral("\\AVersion \\d+\\z"), QRegularExpression::CaseInsensitiveOption);
+    if (!versionre.match(QString::fromLatin1(line, length)).hasMatch())
+        return QVector<pdfsyncpoint>();
 
-    QHash<int, pdfsyncpoint> points;
+    // indexed by the ids, which count up from the start
+    QVector<pdfsyncpoint> points;
     QStack<QString> fileStack;
     int currentpage = -1;
     const QLatin1String texStr(".tex");
-    const QChar spaceChar = QChar::fromLatin1(' ');
 
     fileStack.push(coreName + texStr);
 
-    const QSizeF dpi = m_generator->dpi();
-
-    QString line;
-    while (!ts.atEnd()) {
-        line = ts.readLine();
-        const QStringList tokens = line.split(spaceChar, QString::SkipEmptyParts);
-        const int tokenSize = tokens.count();
-        if (tokenSize < 1)
+    while (data < end) {
+        line = nextLine(&length);
+        int pos = 0;
+        const QByteArray command = nextSyncToken(line, length, &pos);
+        if (command.isEmpty())
             continue;
-        if (tokens.first() == QLatin1String("l") && tokenSize >= 3) {
-            int id = tokens.at(1).toInt();
-            QHash<int, pdfsyncpoint>::const_iterator it = points.constFind(id);
-            if (it == points.constEnd()) {
-                pdfsyncpoint pt;
-                pt.x = 0;
-                pt.y = 0;
-                pt.row = tokens.at(2).toInt();
+        const QByteArray first = nextSyncToken(line, length, &pos);
+        const QByteArray second = nextSyncToken(line, length, &pos);
+        const QByteArray third = nextSyncToken(line, length, &pos);
+
+        if (command == "l" && !second.isEmpty()) {
+            // no id can be larger than the file
+            const qlonglong id = syncNumber(first);
+            if (id < 0 || id >= size)
+                continue;
+            if (id >= points.size())
+                points.resize(int(id) + 1);
+            pdfsyncpoint &pt = points[int(id)];
+            if (pt.row == -1) {
+                pt.row = int(syncNumber(second));
                 pt.column = 0; // TODO
-                pt.page = -1;
                 pt.file = fileStack.top();
-                points[id] = pt;
             }
-        } else if (tokens.first() == QLatin1String("s") && tokenSize >= 2) {
-            currentpage = tokens.at(1).toInt() - 1;
-        } else if (tokens.first() == QLatin1String("p*") && tokenSize >= 4) {
+        } else if (command == "s" && !first.isEmpty()) {
+            currentpage = int(syncNumber(first)) - 1;
+        } else if (command == "p*" && !third.isEmpty()) {
             // TODO
             qCDebug(OkularCoreDebug) << "PdfSync: 'p*' line ignored";
-        } else if (tokens.first() == QLatin1String("p") && tokenSize >= 4) {
-            int id = tokens.at(1).toInt();
-            QHash<int, pdfsyncpoint>::iterator it = points.find(id);
-            if (it != points.end()) {
-                it->x = tokens.at(2).toInt();
-                it->y = tokens.at(3).toInt();
-                it->page = currentpage;
+        } else if (command == "p" && !third.isEmpty()) {
+            const qlonglong id = syncNumber(first);
+            if (id >= 0 && id < points.size() && points.at(int(id)).row != -1) {
+                pdfsyncpoint &pt = points[int(id)];
+                pt.x = syncNumber(second);
+                pt.y = syncNumber(third);
+                pt.page = currentpage;
             }
-        } else if (line.startsWith(QLatin1Char('(')) && tokenSize == 1) {
-            QString newfile = line;
+        } else if (line[0] == '(' && first.isEmpty()) {
             // chop the leading '('
-            newfile.remove(0, 1);
+            QString newfile = QString::fromLocal8Bit(line + 1, length - 1);
             if (!newfile.endsWith(texStr)) {
                 newfile += texStr;
             }
             fileStack.push(newfile);
-        } else if (line == QLatin1String(")")) {
+        } else if (length == 1 && line[0] == ')') {
             if (!fileStack.isEmpty()) {
                 fileStack.pop();
             } else
                 qCDebug(OkularCoreDebug) << "PdfSync: going one level down too much";
         } else
-            qCDebug(OkularCoreDebug).nospace() << "PdfSync: unknown line format: '" << line << "'";
+            qCDebug(OkularCoreDebug).nospace() << "PdfSync: unknown line format: '" << QString::fromLocal8Bit(line, length) << "'";
     }
+    return points;
+}
 
+void DocumentPrivate::addSyncPoints(const QVector<pdfsyncpoint> &points)
+{
+    const QSizeF dpi = m_generator->dpi();
     QVector<QLinkedList<Okular::SourceRefObjectRect *>> refRects(m_pagesVector.size());
-    for (const pdfsyncpoint &pt : qAsConst(points)) {
+    for (const pdfsyncpoint &pt : points) {
         // drop pdfsync points not completely valid
-        if (pt.page < 0 || pt.page >= m_pagesVector.size())
+        if (pt.row == -1 || pt.page < 0 || pt.page >= m_pagesVector.size())
             continue;
 
         // magic numbers for TeX's RSU's (Ridiculously Small Units) conversion to pixels
         Okular::NormalizedPoint p((pt.x * dpi.width()) / (72.27 * 65536.0 * m_pagesVector[pt.page]->width()), (pt.y * dpi.height()) / (72.27 * 65536.0 * m_pagesVector[pt.page]->height()));
-        QString file = pt.file;
-        Okular::SourceReference *sourceRef = new Okular::SourceReference(file, pt.row, pt.column);
+        Okular::SourceReference *sourceRef = new Okular::SourceReference(pt.file, pt.row, pt.column);
         refRects[pt.page].append(new Okular::SourceRefObjectRect(p, sourceRef));
     }
     for (int i = 0; i < refRects.size(); ++i)
@@ -2056,12 +3728,11 @@ void DocumentPrivate::loadSyncFile(const QString &filePath)
 void DocumentPrivate::clearAndWaitForRequests()
 {
     m_pixmapRequestsMutex.lock();
-    QLinkedList<PixmapRequest *>::const_iterator sIt = m_pixmapRequestsStack.constBegin();
-    QLinkedList<PixmapRequest *>::const_iterator sEnd = m_pixmapRequestsStack.constEnd();
-    for (; sIt != sEnd; ++sIt)
-        delete *sIt;
-    m_pixmapRequestsStack.clear();
+    const QVector<PixmapRequest *> queuedRequests = m_pixmapRequestsStack.takeAll();
+    const QVector<PixmapRequest *> coalescedRequests = takeCoalescedPixmapRequests(nullptr);
     m_pixmapRequestsMutex.unlock();
+    qDeleteAll(queuedRequests);
+    qDeleteAll(coalescedRequests);
 
     QEventLoop loop;
     bool startEventLoop = false;
@@ -2072,9 +3743,6 @@ void DocumentPrivate::clearAndWaitForRequests()
         if (m_generator->hasFeature(Generator::SupportsCancelling)) {
             for (PixmapRequest *executingRequest : qAsConst(m_executingPixmapRequests))
                 executingRequest->d->mShouldAbortRender = 1;
-
-            if (m_generator->d_ptr->mTextPageGenerationThread)
-                m_generator->d_ptr->mTextPageGenerationThread->abortExtraction();
         }
 
         m_pixmapRequestsMutex.unlock();
@@ -2088,16 +3756,9 @@ void DocumentPrivate::clearAndWaitForRequests()
 
 int DocumentPrivate::findFieldPageNumber(Okular::FormField *field)
 {
-    // Lookup the page of the FormField
-    int foundPage = -1;
-    for (uint pageIdx = 0, nPages = m_parent->pages(); pageIdx < nPages; pageIdx++) {
-        const Page *p = m_parent->page(pageIdx);
-        if (p && p->formFields().contains(field)) {
-            foundPage = static_cast<int>(pageIdx);
-            break;
-        }
-    }
-    return foundPage;
+    if (!m_formIndexValid)
+        buildFormIndex();
+    return m_formFieldPages.value(field, -1);
 }
 
 void DocumentPrivate::executeScriptEvent(const std::shared_ptr<Event> &event, const Okular::ScriptAction *linkscript)
@@ -2120,6 +3781,7 @@ Document::Document(QWidget *widget)
     d->m_bookmarkManager = new BookmarkManager(d);
     d->m_viewportIterator = d->m_viewportHistory.insert(d->m_viewportHistory.end(), DocumentViewport());
     d->m_undoStack = new QUndoStack(this);
+    d->m_undoStack->setUndoLimit(SettingsCore::undoLimit());
 
     connect(SettingsCore::self(), &SettingsCore::configChanged, this, [this] { d->_o_configChanged(); });
     connect(d->m_undoStack, &QUndoStack::canUndoChanged, this, &Document::canUndoChanged);
@@ -2127,12 +3789,15 @@ Document::Document(QWidget *widget)
     connect(d->m_undoStack, &QUndoStack::cleanChanged, this, &Document::undoHistoryCleanChanged);
 
     qRegisterMetaType<Okular::FontInfo>();
+
+    DocumentPrivate::allDocuments().append(d);
 }
 
 Document::~Document()
 {
     // delete generator, pages, and related stuff
     closeDocument();
+    DocumentPrivate::allDocuments().removeOne(d);
 
     QSet<View *>::const_iterator viewIt = d->m_views.constBegin(), viewEnd = d->m_views.constEnd();
     for (; viewIt != viewEnd; ++viewIt) {
@@ -2183,11 +3848,7 @@ QString DocumentPrivate::docDataFileName(const QUrl &url, qint64 document_size)
 
 QVector<KPluginMetaData> DocumentPrivate::availableGenerators()
 {
-    static QVector<KPluginMetaData> result;
-    if (result.isEmpty()) {
-        result = KPluginLoader::findPlugins(QStringLiteral("okular/generators"));
-    }
-    return result;
+    return GeneratorIndex::instance()->plugins();
 }
 
 KPluginMetaData DocumentPrivate::generatorForMimeType(const QMimeType &type, QWidget *widget, const QVector<KPluginMetaData> &triedOffers)
@@ -2195,27 +3856,26 @@ KPluginMetaData DocumentPrivate::generatorForMimeType(const QMimeType &type, QWi
     // First try to find an exact match, and then look for more general ones (e. g. the plain text one)
     // Ideally we would rank these by "closeness", but that might be overdoing it
 
-    const QVector<KPluginMetaData> available = availableGenerators();
+    const GeneratorIndex *index = GeneratorIndex::instance();
+    const QVector<KPluginMetaData> available = index->plugins();
     QVector<KPluginMetaData> offers;
     QVector<KPluginMetaData> exactMatches;
 
-    QMimeDatabase mimeDatabase;
-
-    for (const KPluginMetaData &md : available) {
-        if (triedOffers.contains(md))
-            continue;
-
-        const QStringList mimetypes = md.mimeTypes();
-        for (const QString &supported : mimetypes) {
-            QMimeType mimeType = mimeDatabase.mimeTypeForName(supported);
-            if (mimeType == type && !exactMatches.contains(md)) {
-                exactMatches << md;
-            }
+    for (int i : index->pluginsForMimeType(type.name())) {
+        if (!triedOffers.contains(available.at(i)))
+            exactMatches << available.at(i);
+    }
 
-            if (type.inherits(supported) && !offers.contains(md)) {
-                offers << md;
-            }
-        }
+    // the plugins of the mimetype and of the ones it inherits from, in the order of the plugins
+    QVector<int> inherited = index->pluginsForMimeType(type.name());
+    const QStringList ancestors = type.allAncestors();
+    for (const QString &ancestor : ancestors)
+        inherited += index->pluginsForMimeType(ancestor);
+    std::sort(inherited.begin(), inherited.end());
+    inherited.erase(std::unique(inherited.begin(), inherited.end()), inherited.end());
+    for (int i : qAsConst(inherited)) {
+        if (!triedOffers.contains(available.at(i)))
+            offers << available.at(i);
     }
 
     if (!exactMatches.isEmpty()) {
@@ -2255,6 +3915,9 @@ KPluginMetaData DocumentPrivate::generatorForMimeType(const QMimeType &type, QWi
 
 Document::OpenResult Document::openDocument(const QString &docFile, const QUrl &url, const QMimeType &_mime, const QString &password)
 {
+    // the time to the first pixmap is measured from here, see RenderStatistics::firstPixmapTime
+    d->m_openTimer.start();
+
     QMimeDatabase db;
     QMimeType mime = _mime;
     QByteArray filedata;
@@ -2374,12 +4037,12 @@ Document::OpenResult Document::openDocument(const QString &docFile, const QUrl &
 
     // no need to check for the existence of a synctex file, no parser will be
     // created if none exists
-    d->m_synctex_scanner = synctex_scanner_new_with_output_file(QFile::encodeName(docFile).constData(), nullptr, 1);
-    if (!d->m_synctex_scanner && QFile::exists(docFile + QLatin1String("sync"))) {
-        d->loadSyncFile(docFile);
-    }
+    d->loadSynctexScanner(docFile);
 
     d->m_generatorName = offer.pluginId();
+    d->updateCompressedPixmapsBudget();
+    if (SettingsCore::enablePixmapDiskCache() && !fromFileDescriptor && !d->m_archiveData)
+        d->m_pixmapDiskCache.setDocument(docFile, d->m_url, d->m_generatorName);
     d->m_pageController = new PageController();
     connect(d->m_pageController, &PageController::rotationFinished, this, [this](int p, Okular::Page *op) { d->rotationFinished(p, op); });
 
@@ -2403,16 +4066,31 @@ Document::OpenResult Document::openDocument(const QString &docFile, const QUrl &
 
     d->m_metadataLoadingCompleted = true;
     d->m_bookmarkManager->setUrl(d->m_url);
+    // both are for a number of pages, which is only known once all of them are there
+    if (!d->m_generator->hasFeature(Generator::IncrementalPages)) {
+        d->loadTextSearchIndex();
+        d->openTextPageDiskCache();
+    } else {
+        d->m_textSearchIndex.reset(d->m_pagesVector.count());
+    }
+    d->openThumbnailDiskCache();
 
-    // 3. setup observers internal lists and data
+    // 3. setup observers internal lists and data, opening where it was left
+    // puts the pages shown there before the thumbnails and the preloading
+    if ((*d->m_viewportIterator).isValid() && !d->m_pagesVector.isEmpty())
+        d->startWarmStart(qMin((*d->m_viewportIterator).pageNumber, d->m_pagesVector.count() - 1));
     foreachObserver(notifySetup(d->m_pagesVector, DocumentObserver::DocumentChanged | DocumentObserver::UrlChanged));
 
     // 4. set initial page (restoring the page saved in xml if loaded)
     DocumentViewport loadedViewport = (*d->m_viewportIterator);
     if (loadedViewport.isValid()) {
         (*d->m_viewportIterator) = DocumentViewport();
-        if (loadedViewport.pageNumber >= (int)d->m_pagesVector.size())
+        if (loadedViewport.pageNumber >= (int)d->m_pagesVector.size()) {
+            // the page may still come
+            if (d->m_generator->hasFeature(Generator::IncrementalPages))
+                d->m_morePagesViewport = loadedViewport;
             loadedViewport.pageNumber = d->m_pagesVector.size() - 1;
+        }
     } else
         loadedViewport.pageNumber = 0;
     setViewport(loadedViewport);
@@ -2431,8 +4109,22 @@ Document::OpenResult Document::openDocument(const QString &docFile, const QUrl &
     }
     d->m_memCheckTimer->start(kMemCheckTime);
 
+    // and go on with the page data and the pages the generator left out
+    d->startLoadingPageData();
+    d->startLoadingMorePages();
+
+    // and react as soon as memory gets tight
+    if (!d->m_memoryPressureMonitor) {
+        d->m_memoryPressureMonitor = new MemoryPressureMonitor(this);
+        connect(d->m_memoryPressureMonitor, &MemoryPressureMonitor::memoryPressure, this, [this] { d->slotMemoryPressure(); });
+    }
+    d->m_memoryPressureMonitor->start();
+
     const DocumentViewport nextViewport = d->nextDocumentViewport();
     if (nextViewport.isValid()) {
+        // it is shown instead of the page it was left at
+        if (d->m_warmStartPage >= 0)
+            d->m_warmStartPage = qBound(0, nextViewport.pageNumber, d->m_pagesVector.count() - 1);
         setViewport(nextViewport);
         d->m_nextDocumentViewport = DocumentViewport();
         d->m_nextDocumentDestination = QString();
@@ -2499,6 +4191,11 @@ void Document::closeDocument()
 
     // remove requests left in queue
     d->clearAndWaitForRequests();
+    d->cancelTextPageRequests();
+    d->cancelBoundingBoxes();
+    d->cancelDocumentSearches();
+    d->cancelTextExport();
+    d->cancelExport();
 
     if (d->m_fontThread) {
         disconnect(d->m_fontThread, nullptr, this, nullptr);
@@ -2513,19 +4210,36 @@ void Document::closeDocument()
     // close the current document and save document info if a document is still opened
     if (d->m_generator && d->m_pagesVector.size() > 0) {
         d->saveDocumentInfo();
+        d->saveTextSearchIndex();
+        d->m_textPageDiskCache.close();
+        d->m_thumbnailDiskCache.close();
+        d->cancelThumbnailLoads();
         d->m_generator->closeDocument();
     }
 
-    if (d->m_synctex_scanner) {
-        synctex_scanner_free(d->m_synctex_scanner);
-        d->m_synctex_scanner = nullptr;
-    }
+    d->closeSynctexScanner();
 
     // stop timers
     if (d->m_memCheckTimer)
         d->m_memCheckTimer->stop();
+    if (d->m_memoryPressureMonitor)
+        d->m_memoryPressureMonitor->stop();
     if (d->m_saveBookmarksTimer)
         d->m_saveBookmarksTimer->stop();
+    if (d->m_pageDataTimer)
+        d->m_pageDataTimer->stop();
+    if (d->m_morePagesTimer)
+        d->m_morePagesTimer->stop();
+    d->m_morePagesViewport = DocumentViewport();
+    if (d->m_draftRefineTimer)
+        d->m_draftRefineTimer->stop();
+    d->m_draftPixmaps.clear();
+    d->m_warmStartPage = -1;
+    if (d->m_warmStartTimer)
+        d->m_warmStartTimer->stop();
+    if (d->m_pageChangesTimer)
+        d->m_pageChangesTimer->stop();
+    d->m_pendingPageChanges.clear();
 
     if (d->m_generator) {
         // disconnect the generator from this document ...
@@ -2562,11 +4276,22 @@ void Document::closeDocument()
     QVector<Page *>::const_iterator pEnd = d->m_pagesVector.constEnd();
     for (; pIt != pEnd; ++pIt)
         delete *pIt;
+    // and the ones the observers did not get yet
+    for (int i = d->m_pagesVector.count(); i < d->m_morePagesVector.count(); ++i)
+        delete d->m_morePagesVector.at(i);
     d->m_pagesVector.clear();
+    d->m_morePagesVector.clear();
+    d->m_unloadedPagesInfo = QDomDocument();
+    d->invalidateFormIndex();
 
     // clear 'memory allocation' descriptors
-    qDeleteAll(d->m_allocatedPixmaps);
     d->m_allocatedPixmaps.clear();
+    d->m_compressedPixmaps.clear();
+    d->m_renderStatistics.clear();
+    d->m_pageRenderCosts.clear();
+    d->m_pageRenderCostsTotal = 0;
+    d->m_openTimer.invalidate();
+    d->m_pixmapDiskCache.close(qint64(SettingsCore::pixmapDiskCacheSize()) * 1024 * 1024);
 
     // clear 'running searches' descriptors
     QMap<int, RunningSearch *>::const_iterator rIt = d->m_searches.constBegin();
@@ -2583,22 +4308,32 @@ void Document::closeDocument()
     d->m_pageRects.clear();
     foreachObserver(notifyVisibleRectsChanged());
 
+    d->m_annotationRenderedRects.clear();
+    d->m_annotationChanges.clear();
+
     // reset internal variables
 
     d->m_viewportHistory.clear();
     d->m_viewportHistory.append(DocumentViewport());
     d->m_viewportIterator = d->m_viewportHistory.begin();
     d->m_allocatedPixmapsTotalMemory = 0;
-    d->m_allocatedTextPagesFifo.clear();
+    d->m_waitingForGenerator = false;
+    d->m_allocatedTextPages.clear();
+    d->m_pagePreviewsFifo.clear();
+    d->m_pagePreviewsMemory = 0;
+    d->m_textSearchIndex.reset(0);
     d->m_pageSize = PageSize();
     d->m_pageSizes.clear();
 
     d->m_documentInfo = DocumentInfo();
     d->m_documentInfoAskedKeys.clear();
+    d->clearSynopsisOutline();
 
     AudioPlayer::instance()->d->m_currentDocument = QUrl();
 
     d->m_undoStack->clear();
+    // the limit can only change while the stack is empty
+    d->m_undoStack->setUndoLimit(SettingsCore::undoLimit());
     d->m_docdataMigrationNeeded = false;
 
 #if HAVE_MALLOC_TRIM
@@ -2631,15 +4366,15 @@ void Document::removeObserver(DocumentObserver *pObserver)
             (*it)->deletePixmap(pObserver);
 
         // [MEM] free observer's allocation descriptors
-        QLinkedList<AllocatedPixmap *>::iterator aIt = d->m_allocatedPixmaps.begin();
-        QLinkedList<AllocatedPixmap *>::iterator aEnd = d->m_allocatedPixmaps.end();
-        while (aIt != aEnd) {
-            AllocatedPixmap *p = *aIt;
-            if (p->observer == pObserver) {
-                aIt = d->m_allocatedPixmaps.erase(aIt);
-                delete p;
-            } else
-                ++aIt;
+        d->m_allocatedPixmaps.removeObserver(pObserver);
+        d->m_compressedPixmaps.removeObserver(pObserver);
+        d->m_renderStatistics.remove(pObserver);
+        d->m_preloadPriorities.remove(pObserver);
+        for (auto it = d->m_draftPixmaps.begin(); it != d->m_draftPixmaps.end();) {
+            if (it.key().first == pObserver)
+                it = d->m_draftPixmaps.erase(it);
+            else
+                ++it;
         }
 
         for (PixmapRequest *executingRequest : qAsConst(d->m_executingPixmapRequests)) {
@@ -2647,6 +4382,10 @@ void Document::removeObserver(DocumentObserver *pObserver)
                 d->cancelRenderingBecauseOf(executingRequest, nullptr);
             }
         }
+        d->m_pixmapRequestsMutex.lock();
+        const QVector<PixmapRequest *> coalescedRequests = d->takeCoalescedPixmapRequests(pObserver);
+        d->m_pixmapRequestsMutex.unlock();
+        qDeleteAll(coalescedRequests);
 
         // remove observer entry from the set
         d->m_observers.remove(pObserver);
@@ -2670,9 +4409,12 @@ void Document::reparseConfig()
         }
 
         // [MEM] remove allocation descriptors
-        qDeleteAll(d->m_allocatedPixmaps);
         d->m_allocatedPixmaps.clear();
         d->m_allocatedPixmapsTotalMemory = 0;
+        d->m_pixmapDiskCache.clear();
+        d->m_thumbnailDiskCache.clear();
+        d->cancelThumbnailLoads();
+        d->m_compressedPixmaps.clear();
 
         // send reload signals to observers
         foreachObserver(notifyContentsCleared(DocumentObserver::Pixmap));
@@ -2755,12 +4497,40 @@ DocumentInfo Document::documentInfo(const QSet<DocumentInfo::Key> &keys) const
     }
     d->m_documentInfoAskedKeys += keys;
 
-    return result;
+    return result;
+}
+
+const DocumentSynopsis *Document::documentSynopsis() const
+{
+    return d->m_generator ? d->m_generator->generateDocumentSynopsis() : nullptr;
+}
+
+const Outline *Document::outline() const
+{
+    if (!d->m_generator)
+        return nullptr;
+
+    if (const Outline *outline = d->m_generator->generateOutline())
+        return outline->isEmpty() ? nullptr : outline;
+
+    // made from the synopsis once it is there, and refilled in place as views hold on to it
+    if (d->m_synopsisOutlineDirty) {
+        const DocumentSynopsis *synopsis = d->m_generator->generateDocumentSynopsis();
+        if (!synopsis)
+            return nullptr;
+        if (!d->m_synopsisOutline)
+            d->m_synopsisOutline.reset(new Outline);
+        d->m_synopsisOutline->fill(*synopsis);
+        d->m_synopsisOutlineDirty = false;
+    }
+    return d->m_synopsisOutline && !d->m_synopsisOutline->isEmpty() ? d->m_synopsisOutline.get() : nullptr;
 }
 
-const DocumentSynopsis *Document::documentSynopsis() const
+void DocumentPrivate::clearSynopsisOutline()
 {
-    return d->m_generator ? d->m_generator->generateDocumentSynopsis() : nullptr;
+    if (m_synopsisOutline)
+        m_synopsisOutline->clear();
+    m_synopsisOutlineDirty = true;
 }
 
 void Document::startFontReading()
@@ -2828,6 +4598,16 @@ const QVector<VisiblePageRect *> &Document::visiblePageRects() const
     return d->m_pageRects;
 }
 
+void Document::setActive(bool active)
+{
+    d->m_active = active;
+}
+
+bool Document::isActive() const
+{
+    return d->m_active;
+}
+
 void Document::setVisiblePageRects(const QVector<VisiblePageRect *> &visiblePageRects, DocumentObserver *excludeObserver)
 {
     QVector<VisiblePageRect *>::const_iterator vIt = d->m_pageRects.constBegin();
@@ -2851,6 +4631,16 @@ uint Document::pages() const
     return d->m_pagesVector.size();
 }
 
+bool Document::isLoadingPages() const
+{
+    return d->m_morePagesTimer && d->m_morePagesTimer->isActive();
+}
+
+void Document::loadAllPages()
+{
+    d->loadAllPages();
+}
+
 QUrl Document::currentDocument() const
 {
     return d->m_url;
@@ -2917,6 +4707,74 @@ bool Document::exportToText(const QString &fileName) const
     return d->m_generator->exportTo(fileName, d->m_exportToText);
 }
 
+bool Document::startTextExport(const QString &fileName)
+{
+    if (isExportingText() || !canExportToText())
+        return false;
+
+    if (!d->m_generator->hasFeature(Generator::TextExtraction) || !d->m_generator->hasFeature(Generator::Threaded)) {
+        const bool success = exportToText(fileName);
+        QTimer::singleShot(0, this, [this, fileName, success] { emit textExportFinished(fileName, success); });
+        return true;
+    }
+
+    const QSharedPointer<QAtomicInt> aborted(new QAtomicInt(0));
+    d->m_textExportAborted = aborted;
+    d->m_textExportFileName = fileName;
+    d->m_textExportPool.setMaxThreadCount(1);
+    d->m_textExportPool.start(new TextExportTask(
+        d->m_generator,
+        &d->m_textPageDiskCache,
+        d->m_pagesVector,
+        fileName,
+        aborted,
+        [this, aborted](int pagesDone) { QMetaObject::invokeMethod(this, [this, aborted, pagesDone] { d->textExportProgress(aborted, pagesDone); }, Qt::QueuedConnection); },
+        [this, aborted, fileName](bool success) { QMetaObject::invokeMethod(this, [this, aborted, fileName, success] { d->finishTextExport(aborted, fileName, success); }, Qt::QueuedConnection); }));
+    return true;
+}
+
+void Document::cancelTextExport()
+{
+    if (d->m_textExportAborted)
+        d->m_textExportAborted->storeRelease(1);
+}
+
+bool Document::isExportingText() const
+{
+    return !d->m_textExportAborted.isNull();
+}
+
+void DocumentPrivate::textExportProgress(const QSharedPointer<QAtomicInt> &aborted, int pagesDone)
+{
+    // from an export that was cancelled by closing the document
+    if (m_textExportAborted != aborted)
+        return;
+
+    emit m_parent->textExportProgress(pagesDone, m_pagesVector.count());
+}
+
+void DocumentPrivate::finishTextExport(const QSharedPointer<QAtomicInt> &aborted, const QString &fileName, bool success)
+{
+    if (m_textExportAborted != aborted)
+        return;
+
+    m_textExportAborted.clear();
+    emit m_parent->textExportFinished(fileName, success);
+}
+
+void DocumentPrivate::cancelTextExport()
+{
+    if (!m_textExportAborted)
+        return;
+
+    m_textExportAborted->storeRelease(1);
+    m_textExportPool.waitForDone();
+
+    // the notifications still queued are then ignored
+    m_textExportAborted.clear();
+    emit m_parent->textExportFinished(m_textExportFileName, false);
+}
+
 ExportFormat::List Document::exportFormats() const
 {
     if (!d->m_generator)
@@ -2931,6 +4789,71 @@ bool Document::exportTo(const QString &fileName, const ExportFormat &format) con
     return d->m_generator ? d->m_generator->exportTo(fileName, format) : false;
 }
 
+bool Document::startExport(const QString &fileName, const ExportFormat &format)
+{
+    if (!d->m_generator || format.isNull())
+        return false;
+
+    d->cacheExportFormats();
+    if (format == d->m_exportToText)
+        return startTextExport(fileName);
+
+    if (isExporting())
+        return false;
+
+    if (!d->m_generator->hasFeature(Generator::Threaded)) {
+        const bool success = exportTo(fileName, format);
+        QTimer::singleShot(0, this, [this, fileName, success] { emit exportFinished(fileName, success); });
+        return true;
+    }
+
+    const QSharedPointer<QAtomicInt> aborted(new QAtomicInt(0));
+    d->m_exportAborted = aborted;
+    d->m_exportFileName = fileName;
+    d->m_exportPool.setMaxThreadCount(1);
+    Generator *generator = d->m_generator;
+    d->m_exportPool.start(new FunctionTask([this, generator, aborted, fileName, format] {
+        ExportTask::run(generator, fileName, format, aborted, [this, aborted, fileName](bool success) {
+            QMetaObject::invokeMethod(this, [this, aborted, fileName, success] { d->finishExport(aborted, fileName, success); }, Qt::QueuedConnection);
+        });
+    }));
+    return true;
+}
+
+void Document::cancelExport()
+{
+    if (d->m_exportAborted)
+        d->m_exportAborted->storeRelease(1);
+}
+
+bool Document::isExporting() const
+{
+    return !d->m_exportAborted.isNull();
+}
+
+void DocumentPrivate::finishExport(const QSharedPointer<QAtomicInt> &aborted, const QString &fileName, bool success)
+{
+    // from an export that was cancelled by closing the document
+    if (m_exportAborted != aborted)
+        return;
+
+    m_exportAborted.clear();
+    emit m_parent->exportFinished(fileName, success);
+}
+
+void DocumentPrivate::cancelExport()
+{
+    if (!m_exportAborted)
+        return;
+
+    // the generator export can't stop midway, the document waits for it
+    m_exportAborted->storeRelease(1);
+    m_exportPool.waitForDone();
+
+    m_exportAborted.clear();
+    emit m_parent->exportFinished(m_exportFileName, false);
+}
+
 bool Document::historyAtBegin() const
 {
     return d->m_viewportIterator == d->m_viewportHistory.begin();
@@ -2945,7 +4868,7 @@ QVariant Document::metaData(const QString &key, const QVariant &option) const
 {
     // if option starts with "src:" assume that we are handling a
     // source reference
-    if (key == QLatin1String("NamedViewport") && option.toString().startsWith(QLatin1String("src:"), Qt::CaseInsensitive) && d->m_synctex_scanner) {
+    if (key == QLatin1String("NamedViewport") && option.toString().startsWith(QLatin1String("src:"), Qt::CaseInsensitive) && d->synctexScanner()) {
         const QString reference = option.toString();
 
         // The reference is of form "src:1111Filename", where "1111"
@@ -3071,12 +4994,12 @@ static bool shouldCancelRenderingBecauseOf(const PixmapRequest &executingRequest
     if (executingRequest.isTile() != otherRequest.isTile())
         return true;
 
-    // Same priority, observer, page, different tiling -> cancel
-    if (executingRequest.isTile()) {
-        const NormalizedRect bothRequestsRect = executingRequest.normalizedRect() | otherRequest.normalizedRect();
-        if (!(bothRequestsRect == executingRequest.normalizedRect()))
-            return true;
-    }
+    // Same priority, observer, page, tiles no longer wanted -> cancel
+    // The tiles of a page are rendered by several requests at the same time,
+    // see requestPixmaps(), so an executing one is still useful as long as
+    // its tiles are part of the new request
+    if (executingRequest.isTile() && !executingRequest.normalizedRect().intersects(otherRequest.normalizedRect()))
+        return true;
 
     return false;
 }
@@ -3094,7 +5017,8 @@ bool DocumentPrivate::cancelRenderingBecauseOf(PixmapRequest *executingRequest,
     TilesManager *tm = executingRequest->d->tilesManager();
     if (tm) {
         tm->setPixmap(nullptr, executingRequest->normalizedRect(), true /*isPartialPixmap*/);
-        tm->setRequest(NormalizedRect(), 0, 0);
+        // the rect was unrotated when the request was sent
+        tm->removeRequest(TilesManager::toRotatedRect(executingRequest->normalizedRect(), m_rotation));
     }
     PagePrivate::PixmapObject object = executingRequest->page()->d->m_pixmaps.take(executingRequest->observer());
     delete object.m_pixmap;
@@ -3104,10 +5028,6 @@ bool DocumentPrivate::cancelRenderingBecauseOf(PixmapRequest *executingRequest,
 
     executingRequest->d->mShouldAbortRender = 1;
 
-    if (m_generator->d_ptr->mTextPageGenerationThread && m_generator->d_ptr->mTextPageGenerationThread->page() == executingRequest->page()) {
-        m_generator->d_ptr->mTextPageGenerationThread->abortExtraction();
-    }
-
     return true;
 }
 
@@ -3144,17 +5064,35 @@ void Document::requestPixmaps(const QLinkedList<PixmapRequest *> &requests, Pixm
     }
     const bool removeAllPrevious = reqOptions & RemoveAllPrevious;
     d->m_pixmapRequestsMutex.lock();
-    QLinkedList<PixmapRequest *>::iterator sIt = d->m_pixmapRequestsStack.begin(), sEnd = d->m_pixmapRequestsStack.end();
-    while (sIt != sEnd) {
-        if ((*sIt)->observer() == requesterObserver && (removeAllPrevious || requestedPages.contains((*sIt)->pageNumber()))) {
-            // delete request and remove it from stack
-            delete *sIt;
-            sIt = d->m_pixmapRequestsStack.erase(sIt);
-        } else
-            ++sIt;
+    // they are only marked as stale here, and deleted when they come out of the queue
+    QVector<PixmapRequest *> supersededRequests;
+    if (removeAllPrevious) {
+        d->m_pixmapRequestsStack.invalidate(requesterObserver);
+        supersededRequests = d->takeCoalescedPixmapRequests(requesterObserver);
+    } else {
+        for (int page : qAsConst(requestedPages)) {
+            d->m_pixmapRequestsStack.invalidate(requesterObserver, page);
+            supersededRequests << d->takeCoalescedPixmapRequests(requesterObserver, page);
+        }
+    }
+    // don't let a queue that is never drained (e.g. a busy generator) grow forever
+    if (d->m_pixmapRequestsStack.count() > 256)
+        d->m_pixmapRequestsStack.compact();
+
+    // the first requests of the page the document was opened at, and of
+    // the other pages visible with it; the thumbnails and the preloads of a
+    // batch are not part of it
+    const auto isWarmStartCandidate = [](const PixmapRequest *request) { return request->asynchronous() && !request->preload() && !(request->d->mFeatures & PixmapRequest::Thumbnail); };
+    bool warmStart = false;
+    if (d->m_warmStartPage >= 0) {
+        for (const PixmapRequest *request : requests)
+            warmStart = warmStart || (isWarmStartCandidate(request) && request->pageNumber() == d->m_warmStartPage);
+        d->m_warmStartRequested = d->m_warmStartRequested || warmStart;
     }
 
     // 1.B [PREPROCESS REQUESTS] tweak some values of the requests
+    bool hasDrafts = false;
+    QSet<int> sharedTilePages;
     for (PixmapRequest *request : requests) {
         // set the 'page field' (see PixmapRequest) and check if it is valid
         qCDebug(OkularCoreDebug).nospace() << "request observer=" << request->observer() << " " << request->width() << "x" << request->height() << "@" << request->pageNumber();
@@ -3166,7 +5104,14 @@ void Document::requestPixmaps(const QLinkedList<PixmapRequest *> &requests, Pixm
 
         request->d->mPage = d->m_pagesVector.value(request->pageNumber());
 
+        if (request->preload() && !(request->d->mFeatures & PixmapRequest::SearchPreload))
+            d->m_preloadPriorities.insert(requesterObserver, request->priority());
+
         if (request->isTile()) {
+            // tiles other observers have at this resolution don't need the generator
+            if (d->shareTilesFromOtherObservers(request))
+                sharedTilePages.insert(request->pageNumber());
+
             // Change the current request rect so that only invalid tiles are
             // requested. Also make sure the rect is tile-aligned.
             NormalizedRect tilesRect;
@@ -3187,8 +5132,28 @@ void Document::requestPixmaps(const QLinkedList<PixmapRequest *> &requests, Pixm
             request->setNormalizedRect(tilesRect);
         }
 
-        if (!request->asynchronous())
+        // drafts are whole pages, tiles are rendered only a few at a time anyway
+        if (request->isTile())
+            request->d->mFeatures &= ~PixmapRequest::Draft;
+        else if (request->draft())
+            hasDrafts = true;
+
+        if (!request->asynchronous()) {
             request->d->mPriority = 0;
+        } else if (warmStart && isWarmStartCandidate(request)) {
+            request->d->mWarmStart = true;
+            request->d->mPriority += kWarmStartPriority;
+        }
+    }
+
+    // render the drafts again once they stop coming
+    if (hasDrafts) {
+        if (!d->m_draftRefineTimer) {
+            d->m_draftRefineTimer = new QTimer(this);
+            d->m_draftRefineTimer->setSingleShot(true);
+            connect(d->m_draftRefineTimer, &QTimer::timeout, this, [this] { d->refineDraftPixmaps(); });
+        }
+        d->m_draftRefineTimer->start(kDraftRefineDelay);
     }
 
     // 1.C [CANCEL REQUESTS] cancel those requests that are running and should be cancelled because of the new requests coming in
@@ -3217,22 +5182,83 @@ void Document::requestPixmaps(const QLinkedList<PixmapRequest *> &requests, Pixm
         }
     }
 
-    // 2. [ADD TO STACK] add requests to stack
+    // 1.D [SPLIT TILES] render the tiles as one request for each band of them,
+    // so every band is painted as soon as it is ready (and with generators
+    // supporting ParallelRendering they render at the same time)
+    QVector<PixmapRequest *> splitRequests;
+    QVector<PixmapRequest *> unneededRequests;
     for (PixmapRequest *request : requests) {
-        // add request to the 'stack' at the right place
-        if (!request->priority())
-            // add priority zero requests to the top of the stack
-            d->m_pixmapRequestsStack.append(request);
-        else {
-            // insert in stack sorted by priority
-            sIt = d->m_pixmapRequestsStack.begin();
-            sEnd = d->m_pixmapRequestsStack.end();
-            while (sIt != sEnd && (*sIt)->priority() > request->priority())
-                ++sIt;
-            d->m_pixmapRequestsStack.insert(sIt, request);
+        if (!request->isTile()) {
+            splitRequests << request;
+            continue;
+        }
+
+        const QVector<NormalizedRect> bands = d->tileBands(request);
+        if (bands.isEmpty()) {
+            // nothing left that is not valid or being rendered already
+            unneededRequests << request;
+            continue;
+        }
+
+        request->setNormalizedRect(bands.first());
+        splitRequests << request;
+        for (int i = 1; i < bands.count(); ++i) {
+            // width and height are already in device pixels
+            PixmapRequest *band = new PixmapRequest(request->observer(), request->pageNumber(), request->width(), request->height(), 1 /* dpr */, request->priority(), PixmapRequest::PixmapRequestFeatures(QFlag(request->d->mFeatures)));
+            band->d->mPage = request->page();
+            band->d->mForce = request->d->mForce;
+            band->setTile(true);
+            band->setNormalizedRect(bands.at(i));
+            band->setPartialUpdatesWanted(request->partialUpdatesWanted());
+            band->d->mWarmStart = request->d->mWarmStart;
+            splitRequests << band;
+        }
+    }
+
+    // 2. [ADD TO STACK] add requests to stack
+    QVector<PixmapRequest *> restoredRequests;
+    QVector<PixmapRequest *> queuedRequests;
+    for (PixmapRequest *request : qAsConst(splitRequests)) {
+        // pages we evicted but kept compressed, that another observer has
+        // bigger or that the document has a thumbnail of don't need the generator
+        if (d->restoreCompressedPixmap(request) || d->sharePixmapFromOtherObserver(request) || d->useEmbeddedThumbnail(request)) {
+            restoredRequests << request;
+            continue;
+        }
+
+        // thumbnails of an earlier time, and the ones of the document with
+        // a threaded generator, are read in the background, they are set on
+        // the page when they arrive
+        if (d->loadCachedThumbnail(request) || d->loadEmbeddedThumbnail(request)) {
+            unneededRequests << request;
+            continue;
         }
+
+        // previews go in first so all the visible pages get one before any real render
+        PixmapRequest *preview = d->previewRequestFor(request);
+        if (preview) {
+            RequestTrace::instant("enqueue", RequestTrace::requestArgs(preview));
+            preview->d->mQueuedTimer.start();
+            d->m_pixmapRequestsStack.push(preview);
+        }
+        queuedRequests << request;
     }
+    for (PixmapRequest *request : qAsConst(queuedRequests)) {
+        RequestTrace::instant("enqueue", RequestTrace::requestArgs(request));
+        request->d->mQueuedTimer.start();
+        d->m_pixmapRequestsStack.push(request);
+    }
+    const QVector<PixmapRequest *> staleRequests = d->m_pixmapRequestsStack.takeStale();
     d->m_pixmapRequestsMutex.unlock();
+    qDeleteAll(staleRequests);
+    qDeleteAll(unneededRequests);
+    qDeleteAll(supersededRequests);
+
+    for (PixmapRequest *request : qAsConst(restoredRequests))
+        requesterObserver->notifyPageChanged(request->pageNumber(), DocumentObserver::Pixmap);
+    qDeleteAll(restoredRequests);
+    for (int page : qAsConst(sharedTilePages))
+        requesterObserver->notifyPageChanged(page, DocumentObserver::Pixmap);
 
     // 3. [START FIRST GENERATION] if <NO>generator is ready, start a new generation,
     // or else (if gen is running) it will be started when the new contents will
@@ -3245,25 +5271,230 @@ void Document::requestPixmaps(const QLinkedList<PixmapRequest *> &requests, Pixm
         o->notifyContentsCleared(Okular::DocumentObserver::Pixmap);
 }
 
+RenderStatistics Document::renderStatistics() const
+{
+    RenderStatistics statistics;
+    const QHash<DocumentObserver *, RenderStatistics> observersStatistics = observerRenderStatistics();
+    for (const RenderStatistics &observerStatistics : observersStatistics)
+        statistics += observerStatistics;
+    RenderStatisticsPrivate *statisticsPrivate = RenderStatisticsPrivate::get(statistics);
+    statisticsPrivate->compressedPixmapBytes = d->m_compressedPixmaps.totalBytes();
+    statisticsPrivate->idleRenderBufferBytes = ImageBufferPool::instance()->idleBytes();
+    if (d->m_generator)
+        statisticsPrivate->userMutexStatistics = d->m_generator->d_func()->userMutexStatistics();
+    return statistics;
+}
+
+QHash<DocumentObserver *, RenderStatistics> Document::observerRenderStatistics() const
+{
+    QHash<DocumentObserver *, RenderStatistics> statistics;
+    for (DocumentObserver *observer : qAsConst(d->m_observers))
+        statistics.insert(observer, d->m_renderStatistics.value(observer));
+
+    d->m_allocatedPixmaps.forEach([&statistics](const AllocatedPixmap *p) {
+        QHash<DocumentObserver *, RenderStatistics>::iterator it = statistics.find(p->observer);
+        if (it != statistics.end()) {
+            RenderStatisticsPrivate *observerStatistics = RenderStatisticsPrivate::get(*it);
+            ++observerStatistics->allocatedPixmaps;
+            observerStatistics->allocatedPixmapBytes += p->memory;
+        }
+    });
+
+    d->m_pixmapRequestsMutex.lock();
+    for (QHash<DocumentObserver *, RenderStatistics>::iterator it = statistics.begin(); it != statistics.end(); ++it)
+        RenderStatisticsPrivate::get(*it)->queuedRequests = d->m_pixmapRequestsStack.count(it.key());
+    for (const PixmapRequest *executingRequest : qAsConst(d->m_executingPixmapRequests)) {
+        QHash<DocumentObserver *, RenderStatistics>::iterator it = statistics.find(executingRequest->observer());
+        if (it != statistics.end())
+            ++RenderStatisticsPrivate::get(*it)->executingRequests;
+    }
+    d->m_pixmapRequestsMutex.unlock();
+
+    return statistics;
+}
+
+void Document::resetRenderStatistics()
+{
+    d->m_renderStatistics.clear();
+    if (d->m_generator)
+        d->m_generator->d_func()->resetUserMutexStatistics();
+}
+
+QMap<QString, qulonglong> Document::memoryUsage() const
+{
+    QMap<QString, qulonglong> usage = d->m_reportedMemory;
+
+    qulonglong tileBytes = 0;
+    qulonglong textPageBytes = 0;
+    qulonglong annotationBytes = 0;
+    for (const Page *page : qAsConst(d->m_pagesVector)) {
+        for (const TilesManager *tilesManager : qAsConst(page->d->m_tilesManagers))
+            tileBytes += tilesManager->totalMemory();
+        textPageBytes += page->d->textPageMemory();
+        annotationBytes += page->d->annotationsMemory();
+    }
+
+    // the tiles are held like the pixmaps, and counted with them
+    usage.insert(QStringLiteral("Pixmaps"), d->m_allocatedPixmapsTotalMemory > tileBytes ? d->m_allocatedPixmapsTotalMemory - tileBytes : 0);
+    usage.insert(QStringLiteral("Tiles"), tileBytes);
+    usage.insert(QStringLiteral("Compressed pixmaps"), d->m_compressedPixmaps.totalBytes());
+    usage.insert(QStringLiteral("Text pages"), textPageBytes);
+    usage.insert(QStringLiteral("Annotations"), annotationBytes);
+    qulonglong undoBytes = 0;
+    for (int i = 0; i < d->m_undoStack->count(); ++i) {
+        if (const OkularUndoCommand *ouc = dynamic_cast<const OkularUndoCommand *>(d->m_undoStack->command(i)))
+            undoBytes += ouc->memoryUsage();
+    }
+    usage.insert(QStringLiteral("Undo history"), undoBytes);
+    usage.insert(QStringLiteral("Generator caches"), d->m_generator ? d->m_generator->cachedMemory() : 0);
+    return usage;
+}
+
+void Document::setMemoryUsage(const QString &subsystem, qulonglong bytes)
+{
+    if (bytes == 0)
+        d->m_reportedMemory.remove(subsystem);
+    else
+        d->m_reportedMemory.insert(subsystem, bytes);
+}
+
+qulonglong Document::availablePixmapMemory() const
+{
+    const qulonglong limit = d->pixmapMemoryLimit();
+    return limit > d->m_allocatedPixmapsTotalMemory ? limit - d->m_allocatedPixmapsTotalMemory : 0;
+}
+
 void Document::requestTextPage(uint pageNumber)
 {
     Page *kp = d->m_pagesVector[pageNumber];
     if (!d->m_generator || !kp)
         return;
 
+    // laid out already the last time the document was open
+    if (TextPage *cached = d->m_textPageDiskCache.load(kp)) {
+        kp->setTextPage(cached);
+        d->textGenerationDone(kp);
+        return;
+    }
+
+    if (kp->d->m_hasNoText) {
+        kp->setTextPage(new TextPage);
+        d->textGenerationDone(kp);
+        return;
+    }
+
     // Memory management for TextPages
 
     d->m_generator->generateTextPage(kp);
 }
 
+void Document::requestTextPage(uint pageNumber, TextPagePriority priority)
+{
+    Page *kp = d->m_pagesVector.value(pageNumber);
+    if (!d->m_generator || !kp || kp->hasTextPage())
+        return;
+
+    // the others are only ahead of time, not worth waiting for here
+    if (!d->requestTextPage(pageNumber, priority) && priority == SearchTextPagePriority)
+        requestTextPage(pageNumber);
+}
+
+void Document::cancelTextPageRequest(uint pageNumber)
+{
+    // a search waits for it
+    if (d->m_textPageWaiters.contains(pageNumber))
+        return;
+
+    for (int i = 0; i < d->m_textPageRequests.count(); ++i) {
+        if (d->m_textPageRequests.at(i).first == (int)pageNumber) {
+            d->m_textPageRequests.remove(i);
+            break;
+        }
+    }
+}
+
+void DocumentPrivate::annotationAdded(int page, Annotation *annotation)
+{
+    m_annotationChanges[page].added.append(annotation);
+}
+
+void DocumentPrivate::annotationRemoved(int page, Annotation *annotation)
+{
+    AnnotationChanges &changes = m_annotationChanges[page];
+    changes.modified.removeOne(annotation);
+    // added and removed before anybody was told, nothing to tell
+    if (!changes.added.removeOne(annotation))
+        changes.removed.append(annotation);
+}
+
+void DocumentPrivate::annotationModified(int page, Annotation *annotation)
+{
+    AnnotationChanges &changes = m_annotationChanges[page];
+    if (!changes.added.contains(annotation) && !changes.modified.contains(annotation))
+        changes.modified.append(annotation);
+}
+
 void DocumentPrivate::notifyAnnotationChanges(int page)
 {
-    foreachObserverD(notifyPageChanged(page, DocumentObserver::Annotations));
+    if (m_annotationBatchDepth > 0) {
+        m_annotationBatchPages.insert(page);
+        return;
+    }
+
+    if (m_generator)
+        m_generator->pageModified(page);
+
+    const auto it = m_annotationChanges.find(page);
+    if (it == m_annotationChanges.end()) {
+        foreachObserverD(notifyPageChanged(page, DocumentObserver::Annotations));
+        return;
+    }
+
+    const AnnotationChanges changes = *it;
+    m_annotationChanges.erase(it);
+    foreachObserverD(notifyAnnotationsChanged(page, changes.added, changes.removed, changes.modified));
+}
+
+void DocumentPrivate::beginAnnotationBatch()
+{
+    ++m_annotationBatchDepth;
+}
+
+void DocumentPrivate::endAnnotationBatch()
+{
+    if (--m_annotationBatchDepth > 0)
+        return;
+
+    const QSet<int> pages = m_annotationBatchPages;
+    const QHash<int, NormalizedRect> refreshes = m_annotationBatchRefreshes;
+    m_annotationBatchPages.clear();
+    m_annotationBatchRefreshes.clear();
+
+    for (int page : pages)
+        notifyAnnotationChanges(page);
+    for (QHash<int, NormalizedRect>::const_iterator it = refreshes.constBegin(); it != refreshes.constEnd(); ++it)
+        refreshPixmaps(it.key(), *it);
+}
+
+void DocumentPrivate::refreshAnnotationPixmaps(int pageNumber, const NormalizedRect &area)
+{
+    if (m_annotationBatchDepth == 0) {
+        refreshPixmaps(pageNumber, area);
+        return;
+    }
+
+    QHash<int, NormalizedRect>::iterator it = m_annotationBatchRefreshes.find(pageNumber);
+    if (it == m_annotationBatchRefreshes.end())
+        m_annotationBatchRefreshes.insert(pageNumber, area);
+    else if (!it->isNull())
+        *it = area.isNull() ? area : *it | area;
 }
 
-void DocumentPrivate::notifyFormChanges(int /*page*/)
+void DocumentPrivate::notifyFormChanges(int page, const QSet<QString> &changedFields)
 {
-    recalculateForms();
+    if (m_generator)
+        m_generator->pageModified(page);
+    recalculateForms(changedFields);
 }
 
 void Document::addPageAnnotation(int page, Annotation *annotation)
@@ -3276,6 +5507,19 @@ void Document::addPageAnnotation(int page, Annotation *annotation)
     d->m_undoStack->push(uc);
 }
 
+void Document::addPageAnnotations(int page, const QList<Annotation *> &annotations)
+{
+    // Transform the annotations' base boundary rectangles into unrotated coordinates
+    Page *p = d->m_pagesVector[page];
+    const QTransform t = p->d->rotationMatrix().inverted();
+    AnnotationBatchCommand *batch = new AnnotationBatchCommand(this->d, i18nc("add a collection of annotations to the page", "add annotations"));
+    for (Annotation *annotation : annotations) {
+        annotation->d_ptr->baseTransform(t);
+        new AddAnnotationCommand(this->d, annotation, page, batch);
+    }
+    d->m_undoStack->push(batch);
+}
+
 bool Document::canModifyPageAnnotation(const Annotation *annotation) const
 {
     if (!annotation || (annotation->flags() & Annotation::DenyWrite))
@@ -3374,12 +5618,10 @@ void Document::removePageAnnotation(int page, Annotation *annotation)
 
 void Document::removePageAnnotations(int page, const QList<Annotation *> &annotations)
 {
-    d->m_undoStack->beginMacro(i18nc("remove a collection of annotations from the page", "remove annotations"));
-    foreach (Annotation *annotation, annotations) {
-        QUndoCommand *uc = new RemoveAnnotationCommand(this->d, annotation, page);
-        d->m_undoStack->push(uc);
-    }
-    d->m_undoStack->endMacro();
+    AnnotationBatchCommand *batch = new AnnotationBatchCommand(this->d, i18nc("remove a collection of annotations from the page", "remove annotations"));
+    for (Annotation *annotation : annotations)
+        new RemoveAnnotationCommand(this->d, annotation, page, batch);
+    d->m_undoStack->push(batch);
 }
 
 bool DocumentPrivate::canAddAnnotationsNatively() const
@@ -3419,10 +5661,13 @@ void Document::setPageTextSelection(int page, RegularAreaRect *rect, const QColo
         return;
 
     // add or remove the selection basing whether rect is null or not
-    if (rect)
+    if (rect) {
         kp->d->setTextSelections(rect, color);
-    else
+        // the text the user works with is the last to go
+        d->m_allocatedTextPages.touch(page);
+    } else {
         kp->d->deleteTextSelections();
+    }
 
     // notify observers about the change
     foreachObserver(notifyPageChanged(page, DocumentObserver::TextSelection));
@@ -3493,6 +5738,10 @@ void Document::setViewportWithHistory(const DocumentViewport &viewport, Document
 
     const bool currentPageChanged = (oldPageNumber != currentViewportPage);
 
+    // observers look at the page actions of the new current page
+    if (currentPageChanged)
+        d->loadPageData(d->m_pagesVector.value(currentViewportPage));
+
     // notify change to all other (different from id) observers
     for (DocumentObserver *o : qAsConst(d->m_observers)) {
         if (o != excludeObserver)
@@ -3540,8 +5789,10 @@ void Document::setPrevViewport()
         foreachObserver(notifyViewportChanged(true));
 
         const int currentViewportPage = (*d->m_viewportIterator).pageNumber;
-        if (oldViewportPage != currentViewportPage)
+        if (oldViewportPage != currentViewportPage) {
+            d->loadPageData(d->m_pagesVector.value(currentViewportPage));
             foreachObserver(notifyCurrentPageChanged(oldViewportPage, currentViewportPage));
+        }
     }
 }
 
@@ -3558,8 +5809,10 @@ void Document::setNextViewport()
         foreachObserver(notifyViewportChanged(true));
 
         const int currentViewportPage = (*d->m_viewportIterator).pageNumber;
-        if (oldViewportPage != currentViewportPage)
+        if (oldViewportPage != currentViewportPage) {
+            d->loadPageData(d->m_pagesVector.value(currentViewportPage));
             foreachObserver(notifyCurrentPageChanged(oldViewportPage, currentViewportPage));
+        }
     }
 }
 
@@ -3588,6 +5841,10 @@ void Document::searchText(int searchID, const QString &text, bool fromStart, Qt:
     if (searchIt == d->m_searches.end()) {
         RunningSearch *search = new RunningSearch();
         search->continueOnPage = -1;
+        search->generation = 0;
+        search->completedType = type;
+        search->completedCaseSensitivity = caseSensitivity;
+        search->completedPageCount = 0;
         searchIt = d->m_searches.insert(searchID, search);
     }
     RunningSearch *s = *searchIt;
@@ -3600,6 +5857,13 @@ void Document::searchText(int searchID, const QString &text, bool fromStart, Qt:
     s->cachedViewportMove = moveViewport;
     s->cachedColor = color;
     s->isCurrentlySearching = true;
+    s->cancelled = false;
+
+    // the previous search with this id is over, whatever it found
+    if (s->abortSearch)
+        s->abortSearch->storeRelease(1);
+    s->abortSearch.clear();
+    s->generation = ++d->m_searchGeneration;
 
     // global data for search
     QSet<int> *pagesToNotify = new QSet<int>;
@@ -3615,11 +5879,47 @@ void Document::searchText(int searchID, const QString &text, bool fromStart, Qt:
     QApplication::setOverrideCursor(Qt::WaitCursor);
 
     // 1. ALLDOC - process all document marking pages
-    if (type == AllDocument) {
-        QMap<Page *, QVector<RegularAreaRect *>> *pageMatches = new QMap<Page *, QVector<RegularAreaRect *>>;
+    // 4. GOOGLE* - process all document marking pages
+    if (type == AllDocument || type == GoogleAll || type == GoogleAny) {
+        if (type == AllDocument) {
+            // search and highlight 'text' (as a solid phrase) on all pages
+            s->searchWords = QStringList(text);
+            s->candidatePages = d->m_textSearchIndex.candidatePages(text);
+        } else {
+            // search and highlight every word in 'text' on all pages
+            s->searchWords = text.split(QLatin1Char(' '), QString::SkipEmptyParts);
+
+            // pages with all the words, or with any of them
+            s->candidatePages = QBitArray(d->m_textSearchIndex.pageCount(), type == GoogleAll);
+            for (const QString &word : qAsConst(s->searchWords)) {
+                if (type == GoogleAll)
+                    s->candidatePages &= d->m_textSearchIndex.candidatePages(word);
+                else
+                    s->candidatePages |= d->m_textSearchIndex.candidatePages(word);
+            }
+        }
+
+        // typing more into the search: the pages the search so far did not
+        // match can't match this one either, the ones it did not go through can
+        if (s->completedType == type && s->completedCaseSensitivity == caseSensitivity && searchNarrows(s->completedWords, s->searchWords, type, caseSensitivity)) {
+            const auto isCandidate = [s](int pageNumber) { return pageNumber >= s->candidatePages.size() || s->candidatePages.testBit(pageNumber); };
+            QBitArray narrowed(d->m_pagesVector.count());
+            for (const int pageNumber : qAsConst(s->completedPages)) {
+                if (pageNumber < narrowed.size() && isCandidate(pageNumber))
+                    narrowed.setBit(pageNumber);
+            }
+            for (int pageNumber = s->completedPageCount; pageNumber < narrowed.size(); ++pageNumber) {
+                if (isCandidate(pageNumber))
+                    narrowed.setBit(pageNumber);
+            }
+            s->candidatePages = narrowed;
+        }
+
+        // matches are shown as they are found, so the old ones go now
+        d->notifyPagesChanged(*pagesToNotify, DocumentObserver::Highlights);
+        delete pagesToNotify;
 
-        // search and highlight 'text' (as a solid phrase) on all pages
-        QTimer::singleShot(0, this, [this, pagesToNotify, pageMatches, searchID] { d->doContinueAllDocumentSearch(pagesToNotify, pageMatches, 0, searchID); });
+        d->startDocumentSearch(searchID);
     }
     // 2. NEXTMATCH - find next matching item (or start from top)
     // 3. PREVMATCH - find previous matching item (or start from bottom)
@@ -3655,17 +5955,11 @@ void Document::searchText(int searchID, const QString &text, bool fromStart, Qt:
         searchStruct->match = match;
         searchStruct->currentPage = currentPage;
         searchStruct->searchID = searchID;
+        searchStruct->generation = s->generation;
+        searchStruct->textPageRequested = -1;
 
         QTimer::singleShot(0, this, [this, searchStruct] { d->doContinueDirectionMatchSearch(searchStruct); });
     }
-    // 4. GOOGLE* - process all document marking pages
-    else if (type == GoogleAll || type == GoogleAny) {
-        QMap<Page *, QVector<QPair<RegularAreaRect *, QColor>>> *pageMatches = new QMap<Page *, QVector<QPair<RegularAreaRect *, QColor>>>;
-        const QStringList words = text.split(QLatin1Char(' '), QString::SkipEmptyParts);
-
-        // search and highlight every word in 'text' on all pages
-        QTimer::singleShot(0, this, [this, pagesToNotify, pageMatches, searchID, words] { d->doContinueGooglesDocumentSearch(pagesToNotify, pageMatches, 0, searchID, words); });
-    }
 }
 
 void Document::continueSearch(int searchID)
@@ -3698,6 +5992,19 @@ void Document::continueSearch(int searchID, SearchType type)
         searchText(searchID, p->cachedString, false, p->cachedCaseSensitivity, type, p->cachedViewportMove, p->cachedColor);
 }
 
+QVector<int> Document::upcomingSearchMatchPages(int searchID) const
+{
+    const RunningSearch *search = d->m_searches.value(searchID);
+    return search ? search->upcomingMatchPages : QVector<int>();
+}
+
+NormalizedRect Document::upcomingSearchMatchRect(int searchID, int page) const
+{
+    const RunningSearch *search = d->m_searches.value(searchID);
+    const int index = search ? search->upcomingMatchPages.indexOf(page) : -1;
+    return index >= 0 ? search->upcomingMatchRects.at(index) : NormalizedRect();
+}
+
 void Document::resetSearch(int searchID)
 {
     // if we are closing down, don't bother doing anything
@@ -3712,15 +6019,33 @@ void Document::resetSearch(int searchID)
     // get previous parameters for search
     RunningSearch *s = *searchIt;
 
+    // the pages of the next matches the views preload are not going to be looked at
+    if (!s->upcomingMatchPages.isEmpty()) {
+        QSet<int> upcomingPages;
+        for (const int pageNumber : qAsConst(s->upcomingMatchPages))
+            upcomingPages.insert(pageNumber);
+        s->upcomingMatchPages.clear();
+        s->upcomingMatchRects.clear();
+
+        d->m_pixmapRequestsMutex.lock();
+        d->m_pixmapRequestsStack.removeSearchPreloads(upcomingPages);
+        const QVector<PixmapRequest *> staleRequests = d->m_pixmapRequestsStack.takeStale();
+        d->m_pixmapRequestsMutex.unlock();
+        qDeleteAll(staleRequests);
+    }
+
     // unhighlight pages and inform observers about that
-    for (const int pageNumber : qAsConst(s->highlightedPages)) {
+    for (const int pageNumber : qAsConst(s->highlightedPages))
         d->m_pagesVector.at(pageNumber)->d->deleteHighlights(searchID);
-        foreachObserver(notifyPageChanged(pageNumber, DocumentObserver::Highlights));
-    }
+    d->notifyPagesChanged(s->highlightedPages, DocumentObserver::Highlights);
 
     // send the setup signal too (to update views that filter on matches)
     foreachObserver(notifySetup(d->m_pagesVector, 0));
 
+    // its thread is useless now
+    if (s->abortSearch)
+        s->abortSearch->storeRelease(1);
+
     // remove search from the runningSearches list and delete it
     d->m_searches.erase(searchIt);
     delete s;
@@ -3729,6 +6054,21 @@ void Document::resetSearch(int searchID)
 void Document::cancelSearch()
 {
     d->m_searchCancelled = true;
+    for (RunningSearch *search : qAsConst(d->m_searches)) {
+        if (search->abortSearch)
+            search->abortSearch->storeRelease(1);
+    }
+}
+
+void Document::cancelSearch(int searchID)
+{
+    RunningSearch *search = d->m_searches.value(searchID);
+    if (!search || !search->isCurrentlySearching)
+        return;
+
+    search->cancelled = true;
+    if (search->abortSearch)
+        search->abortSearch->storeRelease(1);
 }
 
 void Document::undo()
@@ -3782,6 +6122,20 @@ void Document::reloadDocument() const
         d->refreshPixmaps(i);
 }
 
+void Document::refreshLayers()
+{
+    const int numOfPages = pages();
+    for (int i = currentPage(); i >= 0; i--)
+        d->refreshShownPixmaps(i);
+    for (int i = currentPage() + 1; i < numOfPages; i++)
+        d->refreshShownPixmaps(i);
+}
+
+void Document::computeBoundingBoxes()
+{
+    d->computeBoundingBoxes();
+}
+
 BookmarkManager *Document::bookmarkManager() const
 {
     return d->m_bookmarkManager;
@@ -4073,7 +6427,7 @@ void Document::processFormatAction(const Action *action, Okular::FormFieldText *
         fft->setText(formattedText);
         fft->setAppearanceText(formattedText);
         emit refreshFormWidget(fft);
-        d->refreshPixmaps(foundPage);
+        d->refreshPixmaps(foundPage, fft->rect());
         // Then we make the form have the unformatted text, to use
         // in calculations and other things.
         fft->setText(unformattedText);
@@ -4083,7 +6437,7 @@ void Document::processFormatAction(const Action *action, Okular::FormFieldText *
         // This is because the recalculateForms function delegated
         // the responsiblity for the refresh to us.
         emit refreshFormWidget(fft);
-        d->refreshPixmaps(foundPage);
+        d->refreshPixmaps(foundPage, fft->rect());
     }
 }
 
@@ -4211,7 +6565,7 @@ void Document::processSourceReference(const SourceReference *ref)
 
 const SourceReference *Document::dynamicSourceReference(int pageNr, double absX, double absY)
 {
-    if (!d->m_synctex_scanner)
+    if (!d->synctexScanner())
         return nullptr;
 
     const QSizeF dpi = d->m_generator->dpi();
@@ -4383,22 +6737,9 @@ QStringList Document::supportedMimeTypes() const
 {
     // TODO: make it a static member of DocumentPrivate?
     QStringList result = d->m_supportedMimeTypes;
-    if (result.isEmpty()) {
-        const QVector<KPluginMetaData> available = DocumentPrivate::availableGenerators();
-        for (const KPluginMetaData &md : available) {
-            result << md.mimeTypes();
-        }
-
-        // Remove duplicate mimetypes represented by different names
-        QMimeDatabase mimeDatabase;
-        QSet<QMimeType> uniqueMimetypes;
-        for (const QString &mimeName : qAsConst(result)) {
-            uniqueMimetypes.insert(mimeDatabase.mimeTypeForName(mimeName));
-        }
-        result.clear();
-        for (const QMimeType &mimeType : uniqueMimetypes) {
-            result.append(mimeType.name());
-        }
+    if (result.isEmpty()) {
+        // the canonical names, without the duplicates of different names of the same mimetype
+        result = GeneratorIndex::instance()->mimeTypes();
 
         // Add the Okular archive mimetype
         result << QStringLiteral("application/vnd.kde.okular-archive");
@@ -4432,6 +6773,13 @@ bool Document::swapBackingFile(const QString &newFileName, const QUrl &url)
     d->saveDocumentInfo();
 
     d->clearAndWaitForRequests();
+    d->cancelTextPageRequests();
+    d->cancelBoundingBoxes();
+    d->cancelDocumentSearches();
+    d->cancelTextExport();
+
+    // the generator gives all the pages of the new file, so the old one needs them too
+    d->loadAllPages();
 
     qCDebug(OkularCoreDebug) << "Swapping backing file to" << newFileName;
     QVector<Page *> newPagesVector;
@@ -4450,6 +6798,12 @@ bool Document::swapBackingFile(const QString &newFileName, const QUrl &url)
             if (newPagesVector.count() != d->m_pagesVector.count())
                 return false;
 
+            // the undo commands look for their annotations in the new pages
+            if (d->m_generator->hasFeature(Generator::LazyPageData) && d->m_undoStack->count() > 0) {
+                for (Page *newPage : qAsConst(newPagesVector))
+                    d->m_generator->loadPageData(newPage);
+            }
+
             // Update the undo stack contents
             for (int i = 0; i < d->m_undoStack->count(); ++i) {
                 // Trust me on the const_cast ^_^
@@ -4484,24 +6838,27 @@ bool Document::swapBackingFile(const QString &newFileName, const QUrl &url)
                 rectsToDelete << oldPage->m_rects;
                 oldPage->m_annotations = newPage->m_annotations;
                 oldPage->m_rects = newPage->m_rects;
+                oldPage->d->objectRectsChanged();
+                oldPage->d->annotationsChanged();
             }
             qDeleteAll(newPagesVector);
         }
+        // the form fields came with the new pages
+        d->invalidateFormIndex();
 
         d->m_url = url;
         d->m_docFileName = newFileName;
         d->updateMetadataXmlNameAndDocSize();
         d->m_bookmarkManager->setUrl(d->m_url);
+        d->openTextPageDiskCache();
+        d->openThumbnailDiskCache();
+        d->startLoadingPageData();
         d->m_documentInfo = DocumentInfo();
         d->m_documentInfoAskedKeys.clear();
+        d->clearSynopsisOutline();
 
-        if (d->m_synctex_scanner) {
-            synctex_scanner_free(d->m_synctex_scanner);
-            d->m_synctex_scanner = synctex_scanner_new_with_output_file(QFile::encodeName(newFileName).constData(), nullptr, 1);
-            if (!d->m_synctex_scanner && QFile::exists(newFileName + QLatin1String("sync"))) {
-                d->loadSyncFile(newFileName);
-            }
-        }
+        if (d->m_synctex_scanner || d->m_synctexLoading)
+            d->loadSynctexScanner(newFileName);
 
         foreachObserver(notifySetup(d->m_pagesVector, DocumentObserver::UrlChanged));
 
@@ -4535,6 +6892,99 @@ bool Document::swapBackingFileArchive(const QString &newFileName, const QUrl &ur
     return success;
 }
 
+bool Document::reloadInPlace()
+{
+    if (!d->m_generator || !d->m_generator->hasFeature(Generator::InPlaceReload) || d->m_archiveData)
+        return false;
+
+    // for the file as it was
+    d->saveDocumentInfo();
+
+    d->clearAndWaitForRequests();
+    d->cancelTextPageRequests();
+    d->cancelBoundingBoxes();
+    d->cancelDocumentSearches();
+    d->cancelTextExport();
+
+    QVector<Page *> pagesVector = d->m_pagesVector;
+    QVector<int> changedPages;
+    if (!d->m_generator->reloadDocument(d->m_docFileName, pagesVector, changedPages))
+        return false;
+
+    qCDebug(OkularCoreDebug) << "Reloaded in place," << changedPages.count() << "pages changed";
+    const int oldCount = d->m_pagesVector.count();
+    const int count = pagesVector.count();
+    const QVector<Page *> removedPages = d->m_pagesVector.mid(count);
+    for (int i = oldCount; i < count; ++i)
+        pagesVector.at(i)->d->m_doc = d;
+    d->m_pagesVector = pagesVector;
+    d->invalidateFormIndex();
+
+    for (int i = count; i < oldCount; ++i) {
+        for (DocumentObserver *observer : qAsConst(d->m_observers)) {
+            AllocatedPixmap *p = d->m_allocatedPixmaps.take(observer, i);
+            if (p) {
+                d->m_allocatedPixmapsTotalMemory -= p->memory;
+                delete p;
+            }
+        }
+        d->m_compressedPixmaps.removePage(i);
+        d->m_allocatedTextPages.remove(i);
+    }
+    QVector<VisiblePageRect *>::iterator vIt = d->m_pageRects.begin();
+    while (vIt != d->m_pageRects.end()) {
+        if ((*vIt)->pageNumber >= count) {
+            delete *vIt;
+            vIt = d->m_pageRects.erase(vIt);
+        } else {
+            ++vIt;
+        }
+    }
+
+    // what is cached for the file is for how it was
+    d->updateMetadataXmlNameAndDocSize();
+    if (d->m_pixmapDiskCache.isActive())
+        d->m_pixmapDiskCache.setDocument(d->m_docFileName, d->m_url, d->m_generatorName);
+    d->m_textSearchIndex.reset(count);
+    // the pages may have other text now
+    for (RunningSearch *search : qAsConst(d->m_searches)) {
+        search->completedWords.clear();
+        search->completedPages.clear();
+    }
+    d->openTextPageDiskCache();
+    d->openThumbnailDiskCache();
+    d->m_documentInfo = DocumentInfo();
+    d->m_documentInfoAskedKeys.clear();
+    d->clearSynopsisOutline();
+    // the file was compiled again
+    d->loadSynctexScanner(d->m_docFileName);
+
+    if (count != oldCount) {
+        foreachObserver(notifySetup(d->m_pagesVector, DocumentObserver::NewLayoutForPages));
+        if ((*d->m_viewportIterator).pageNumber >= count) {
+            DocumentViewport viewport(count - 1);
+            setViewport(viewport);
+        }
+    }
+    qDeleteAll(removedPages);
+
+    for (const int page : qAsConst(changedPages))
+        d->pageContentsChanged(page);
+
+    return true;
+}
+
+void DocumentPrivate::pageContentsChanged(int page)
+{
+    Page *p = m_pagesVector.at(page);
+    // cached for the same file, but laid out or extracted before the change
+    m_textPageDiskCache.remove(page);
+    p->setTextPage(nullptr);
+    p->d->m_hasNoText = false;
+    p->d->deleteTextSelections();
+    refreshPixmaps(page);
+}
+
 void Document::setHistoryClean(bool clean)
 {
     if (clean)
@@ -4600,6 +7050,30 @@ bool Document::saveChanges(const QString &fileName, QString *errorText)
     return saveIface->save(fileName, SaveInterface::SaveChanges, errorText);
 }
 
+bool Document::canSaveChangesInPlace() const
+{
+    if (!d->m_generator)
+        return false;
+    Q_ASSERT(!d->m_generatorName.isEmpty());
+
+    QHash<QString, GeneratorInfo>::iterator genIt = d->m_loadedGenerators.find(d->m_generatorName);
+    Q_ASSERT(genIt != d->m_loadedGenerators.end());
+    SaveInterface *saveIface = d->generatorSave(genIt.value());
+    if (!saveIface)
+        return false;
+
+    return saveIface->supportsOption(SaveInterface::SaveChanges) && saveIface->supportsOption(SaveInterface::SaveInPlace);
+}
+
+bool Document::saveChangesInPlace(const QString &fileName, QString *errorText)
+{
+    if (!canSaveChangesInPlace() || fileName.isEmpty())
+        return false;
+
+    SaveInterface *saveIface = d->generatorSave(d->m_loadedGenerators[d->m_generatorName]);
+    return saveIface->save(fileName, SaveInterface::SaveChanges | SaveInterface::SaveInPlace, errorText);
+}
+
 void Document::registerView(View *view)
 {
     if (!view)
@@ -4934,6 +7408,11 @@ void Document::refreshPixmaps(int pageNumber)
     d->refreshPixmaps(pageNumber);
 }
 
+void Document::refreshPixmaps(int pageNumber, const NormalizedRect &area)
+{
+    d->refreshPixmaps(pageNumber, area);
+}
+
 void DocumentPrivate::executeScript(const QString &function)
 {
     if (!m_scripter)
@@ -4949,7 +7428,9 @@ void DocumentPrivate::requestDone(PixmapRequest *req)
     if (!m_generator || m_closingLoop) {
         m_pixmapRequestsMutex.lock();
         m_executingPixmapRequests.removeAll(req);
+        const QVector<PixmapRequest *> coalescedRequests = m_coalescedPixmapRequests.take(req);
         m_pixmapRequestsMutex.unlock();
+        qDeleteAll(coalescedRequests);
         delete req;
         if (m_closingLoop)
             m_closingLoop->exit();
@@ -4963,19 +7444,21 @@ void DocumentPrivate::requestDone(PixmapRequest *req)
 
     if (!req->shouldAbortRender()) {
         // [MEM] 1.1 find and remove a previous entry for the same page and id
-        QLinkedList<AllocatedPixmap *>::iterator aIt = m_allocatedPixmaps.begin();
-        QLinkedList<AllocatedPixmap *>::iterator aEnd = m_allocatedPixmaps.end();
-        for (; aIt != aEnd; ++aIt)
-            if ((*aIt)->page == req->pageNumber() && (*aIt)->observer == req->observer()) {
-                AllocatedPixmap *p = *aIt;
-                m_allocatedPixmaps.erase(aIt);
-                m_allocatedPixmapsTotalMemory -= p->memory;
-                delete p;
-                break;
-            }
+        AllocatedPixmap *previous = m_allocatedPixmaps.take(req->observer(), req->pageNumber());
+        if (previous) {
+            m_allocatedPixmapsTotalMemory -= previous->memory;
+            delete previous;
+        }
 
         DocumentObserver *observer = req->observer();
         if (m_observers.contains(observer)) {
+            if (req->d->mRenderTimer.isValid()) {
+                RenderStatisticsPrivate *statistics = observerStatistics(observer);
+                ++statistics->generatedPixmaps;
+                statistics->renderTime += req->d->mRenderTimer.elapsed();
+            }
+            recordFirstPixmap(observer);
+
             // [MEM] 1.2 append memory allocation descriptor to the FIFO
             qulonglong memoryBytes = 0;
             const TilesManager *tm = req->d->tilesManager();
@@ -4984,10 +7467,26 @@ void DocumentPrivate::requestDone(PixmapRequest *req)
             else
                 memoryBytes = 4 * req->width() * req->height();
 
-            AllocatedPixmap *memoryPage = new AllocatedPixmap(req->observer(), req->pageNumber(), memoryBytes);
-            m_allocatedPixmaps.append(memoryPage);
+            // only the render itself, not the wait for a worker and the conversion;
+            // drafts and previews are quicker than what they stand in for
+            if (req->d->mImageTime >= 0 && !req->draft() && !req->preview())
+                recordRenderTime(req->pageNumber(), renderedPixels(req), req->d->mImageTime);
+
+            AllocatedPixmap *memoryPage = new AllocatedPixmap(req->observer(), req->pageNumber(), memoryBytes, estimatedRenderTime(req->pageNumber(), memoryBytes / 4));
+            m_allocatedPixmaps.insert(memoryPage);
             m_allocatedPixmapsTotalMemory += memoryBytes;
 
+            // the caches keep only what is worth showing again
+            if (!req->isTile() && !req->preview() && !req->draft()) {
+                m_pixmapDiskCache.store(req->pageNumber(), req->d->mResultImage, pixmapDiskCacheRenderHints());
+                if (req->d->mFeatures & PixmapRequest::Thumbnail)
+                    m_thumbnailDiskCache.store(req->pageNumber(), req->d->mResultImage);
+            }
+            if (!req->isTile() && req->draft())
+                m_draftPixmaps.insert(qMakePair(observer, req->pageNumber()), req->priority() - (req->d->mWarmStart ? kWarmStartPriority : 0));
+            else if (!req->preview())
+                m_draftPixmaps.remove(qMakePair(observer, req->pageNumber()));
+
             // 2. notify an observer that its pixmap changed
             observer->notifyPageChanged(req->pageNumber(), DocumentObserver::Pixmap);
         }
@@ -4997,12 +7496,22 @@ void DocumentPrivate::requestDone(PixmapRequest *req)
 #endif
     }
 
-    // 3. delete request
+    // 3. give the pixmap to the other observers that waited for it, and delete request
+    m_pixmapRequestsMutex.lock();
+    const QVector<PixmapRequest *> coalescedRequests = m_coalescedPixmapRequests.take(req);
+    m_pixmapRequestsMutex.unlock();
+    if (!coalescedRequests.isEmpty())
+        finishCoalescedPixmapRequests(req, coalescedRequests);
+
     m_pixmapRequestsMutex.lock();
     m_executingPixmapRequests.removeAll(req);
+    const bool warmStartDone = req->d->mWarmStart && !req->preview() && m_warmStartPage >= 0 && !hasWarmStartRequests();
     m_pixmapRequestsMutex.unlock();
     delete req;
 
+    if (warmStartDone)
+        endWarmStart();
+
     // 4. start a new generation if some is pending
     m_pixmapRequestsMutex.lock();
     bool hasPixmaps = !m_pixmapRequestsStack.isEmpty();
@@ -5032,42 +7541,549 @@ void DocumentPrivate::setPageBoundingBox(int page, const NormalizedRect &boundin
 
 void DocumentPrivate::calculateMaxTextPages()
 {
-    int multipliers = qMax(1, qRound(getTotalMemory() / 536870912.0)); // 512 MB
+    const qulonglong multipliers = qMax(1, qRound(getTotalMemory() / 536870912.0)); // 512 MB
     switch (SettingsCore::memoryLevel()) {
     case SettingsCore::EnumMemoryLevel::Low:
-        m_maxAllocatedTextPages = multipliers * 2;
+        m_maxAllocatedTextPagesMemory = multipliers * 256 * 1024;
         break;
 
     case SettingsCore::EnumMemoryLevel::Normal:
-        m_maxAllocatedTextPages = multipliers * 50;
+        m_maxAllocatedTextPagesMemory = multipliers * 8 * 1024 * 1024;
         break;
 
     case SettingsCore::EnumMemoryLevel::Aggressive:
-        m_maxAllocatedTextPages = multipliers * 250;
+        m_maxAllocatedTextPagesMemory = multipliers * 32 * 1024 * 1024;
         break;
 
     case SettingsCore::EnumMemoryLevel::Greedy:
-        m_maxAllocatedTextPages = multipliers * 1250;
+        m_maxAllocatedTextPagesMemory = multipliers * 128 * 1024 * 1024;
         break;
     }
 }
 
+void DocumentPrivate::addAllocatedTextPage(Page *page)
+{
+    // a preloaded text page may have been replaced by the one of a request
+    m_allocatedTextPages.insert(page->number(), page->d->textPageMemory());
+    evictTextPages(page->number());
+}
+
+void DocumentPrivate::evictTextPages(int keepPage)
+{
+    if (m_allocatedTextPages.totalBytes() <= m_maxAllocatedTextPagesMemory)
+        return;
+
+    // the pages shown stay, and the text page just added
+    QSet<int> keep;
+    for (const VisiblePageRect *rect : qAsConst(m_pageRects))
+        keep.insert(rect->pageNumber);
+    if (keepPage >= 0)
+        keep.insert(keepPage);
+
+    // a bit more than needed, so that the next pages don't evict one each
+    const qulonglong maxBytes = m_maxAllocatedTextPagesMemory / 10 * 9;
+    const QVector<int> evicted = m_allocatedTextPages.toEvict(maxBytes, (*m_viewportIterator).pageNumber, keep);
+    for (int pageNumber : evicted) {
+        m_allocatedTextPages.remove(pageNumber);
+        m_pagesVector.at(pageNumber)->setTextPage(nullptr); // deletes the textpage
+    }
+}
+
 void DocumentPrivate::textGenerationDone(Page *page)
 {
     if (!m_pageController)
         return;
 
-    // 1. If we reached the cache limit, delete the first text page from the fifo
-    if (m_allocatedTextPagesFifo.size() == m_maxAllocatedTextPages) {
-        int pageToKick = m_allocatedTextPagesFifo.takeFirst();
-        if (pageToKick != page->number()) // this should never happen but better be safe than sorry
-        {
-            m_pagesVector.at(pageToKick)->setTextPage(nullptr); // deletes the textpage
+    // 1. Account for the text page, evicting the least useful ones if needed
+    addAllocatedTextPage(page);
+
+    // 2. Index it and keep it for the next time
+    indexTextPage(page);
+    m_textPageDiskCache.store(page, page->d->m_text);
+
+    // 3. Get the text of the pages around ready too
+    startTextPageRequests();
+}
+
+bool DocumentPrivate::requestTextPage(int pageNumber, Document::TextPagePriority priority, const std::function<void()> &done)
+{
+    if (!m_generator || !m_pageController || !m_generator->hasFeature(Generator::TextExtraction) || !m_generator->hasFeature(Generator::Threaded))
+        return false;
+
+    Page *page = m_pagesVector.value(pageNumber);
+    if (!page)
+        return false;
+
+    if (page->hasTextPage()) {
+        if (done)
+            QMetaObject::invokeMethod(m_parent, done, Qt::QueuedConnection);
+        return true;
+    }
+
+    if (done)
+        m_textPageWaiters[pageNumber].append(done);
+
+    if (!m_textPagesExtracting.contains(pageNumber)) {
+        int i = 0;
+        for (; i < m_textPageRequests.count(); ++i) {
+            if (m_textPageRequests.at(i).first == pageNumber)
+                break;
+        }
+        if (i < m_textPageRequests.count()) {
+            // a request only ever goes up
+            if (m_textPageRequests.at(i).second <= priority)
+                return true;
+            m_textPageRequests.remove(i);
+        }
+
+        // ahead of the ones of the same priority, the user moved on from them
+        auto it = m_textPageRequests.begin();
+        while (it != m_textPageRequests.end() && it->second < priority)
+            ++it;
+        m_textPageRequests.insert(it, qMakePair(pageNumber, priority));
+    }
+
+    startTextPageRequests();
+    return true;
+}
+
+void DocumentPrivate::startTextPageRequests()
+{
+    if (!m_generator || !m_pageController || m_pagesVector.isEmpty() || !m_generator->hasFeature(Generator::TextExtraction) || !m_generator->hasFeature(Generator::Threaded))
+        return;
+
+    // one page per free thread, so that the ones coming next are picked
+    // according to the requests at that moment
+    m_textPagePool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, kMaxTextPageThreads));
+    while (!m_textPageRequests.isEmpty() && m_textPagesExtracting.count() < m_textPagePool.maxThreadCount()) {
+        const QPair<int, Document::TextPagePriority> request = m_textPageRequests.takeFirst();
+        const int pageNumber = request.first;
+        Page *page = m_pagesVector.value(pageNumber);
+        if (!page || page->hasTextPage()) {
+            // generated in place meanwhile
+            const QVector<std::function<void()>> waiters = m_textPageWaiters.take(pageNumber);
+            for (const std::function<void()> &waiter : waiters)
+                QMetaObject::invokeMethod(m_parent, waiter, Qt::QueuedConnection);
+            continue;
+        }
+
+        startTextPageTask(page, request.second == Document::VisibleTextPagePriority);
+    }
+
+    // the background preloading of the pages around the current one
+    if (!m_textPageRequests.isEmpty() || m_warmStartPage >= 0 || SettingsCore::memoryLevel() == SettingsCore::EnumMemoryLevel::Low)
+        return;
+
+    // preloading never kicks out the text pages already there, the pages
+    // being extracted are guessed to be like the average one
+    const qulonglong averageBytes = m_allocatedTextPages.count() > 0 ? m_allocatedTextPages.totalBytes() / m_allocatedTextPages.count() : kTextPageBytesGuess;
+    const qulonglong usedBytes = m_allocatedTextPages.totalBytes() + m_textPagesExtracting.count() * averageBytes;
+    if (usedBytes >= m_maxAllocatedTextPagesMemory)
+        return;
+    int budget = qMin<qulonglong>(m_pagesVector.count(), (m_maxAllocatedTextPagesMemory - usedBytes) / qMax<qulonglong>(1, averageBytes));
+    if (budget <= 0)
+        return;
+
+    // nearest pages first
+    const int currentPage = (*m_viewportIterator).pageNumber;
+    const int pageCount = m_pagesVector.count();
+    for (int distance = 0; distance < pageCount && budget > 0 && m_textPagesExtracting.count() < m_textPagePool.maxThreadCount(); ++distance) {
+        for (const int pageNumber : {currentPage + distance, currentPage - distance}) {
+            if (pageNumber < 0 || pageNumber >= pageCount || m_textPagesExtracting.contains(pageNumber))
+                continue;
+
+            Page *page = m_pagesVector.at(pageNumber);
+            if (page->hasTextPage())
+                continue;
+
+            if (budget <= 0 || m_textPagesExtracting.count() >= m_textPagePool.maxThreadCount())
+                break;
+
+            --budget;
+            startTextPageTask(page, false);
+        }
+    }
+}
+
+void DocumentPrivate::startTextPageTask(Page *page, bool visible)
+{
+    const int pageNumber = page->number();
+    m_textPagesExtracting.insert(pageNumber);
+    // it had no text before, there is nothing to extract
+    if (page->d->m_hasNoText) {
+        QMutexLocker locker(&m_extractedTextPagesMutex);
+        m_extractedTextPages.append(qMakePair(pageNumber, new TextPage));
+        QMetaObject::invokeMethod(m_parent, [this] { textPagesExtracted(); }, Qt::QueuedConnection);
+        return;
+    }
+    // the text of the shown pages waits only for their renders
+    const int work = visible ? GeneratorPrivate::VisibleTextWork : GeneratorPrivate::SpeculativeWork;
+    Generator *generator = m_generator;
+    m_textPagePool.start(new FunctionTask([this, generator, page, work, pageNumber] {
+        TextPageTask::run(generator, &m_textPageDiskCache, page, work, [this, pageNumber](TextPage *textPage) {
+            QMutexLocker locker(&m_extractedTextPagesMutex);
+            m_extractedTextPages.append(qMakePair(pageNumber, textPage));
+            locker.unlock();
+            QMetaObject::invokeMethod(m_parent, [this] { textPagesExtracted(); }, Qt::QueuedConnection);
+        });
+    }));
+}
+
+void DocumentPrivate::textPagesExtracted()
+{
+    m_extractedTextPagesMutex.lock();
+    const QVector<QPair<int, TextPage *>> extracted = m_extractedTextPages;
+    m_extractedTextPages.clear();
+    m_extractedTextPagesMutex.unlock();
+
+    for (const QPair<int, TextPage *> &entry : extracted) {
+        m_textPagesExtracting.remove(entry.first);
+        if (entry.second && adoptTextPage(entry.first, entry.second))
+            emit m_parent->textPageReady(entry.first);
+
+        const QVector<std::function<void()>> waiters = m_textPageWaiters.take(entry.first);
+        for (const std::function<void()> &waiter : waiters)
+            waiter();
+    }
+
+    // the threads that finished can take the next pages
+    if (!extracted.isEmpty())
+        startTextPageRequests();
+}
+
+bool DocumentPrivate::adoptTextPage(int pageNumber, TextPage *textPage)
+{
+    // a request may have been faster
+    Page *page = m_pagesVector.value(pageNumber);
+    if (!page || page->hasTextPage() || !m_pageController) {
+        delete textPage;
+        return false;
+    }
+
+    page->setTextPage(textPage);
+    // a requested page, or the budget shrunk since the page was picked
+    addAllocatedTextPage(page);
+    indexTextPage(page);
+    m_textPageDiskCache.store(page, page->d->m_text);
+    return true;
+}
+
+void DocumentPrivate::computeBoundingBoxes()
+{
+    // the renders run next to the ones of the pixmap requests
+    if (!m_generator || m_boundingBoxesComputing || m_pagesVector.isEmpty() || !m_generator->hasFeature(Generator::Threaded) || !m_generator->hasFeature(Generator::ParallelRendering))
+        return;
+
+    // nearest pages first, a batch at a time so that the layout changes once for it
+    QVector<Page *> pages;
+    const int currentPage = (*m_viewportIterator).pageNumber;
+    const int pageCount = m_pagesVector.count();
+    for (int distance = 0; distance < pageCount && pages.count() < kBoundingBoxBatchSize; ++distance) {
+        for (const int pageNumber : {currentPage + distance, currentPage - distance}) {
+            if (pageNumber < 0 || pageNumber >= pageCount || pages.count() >= kBoundingBoxBatchSize)
+                continue;
+
+            Page *page = m_pagesVector.at(pageNumber);
+            if (!page->isBoundingBoxKnown() && !m_boundingBoxFailedPages.contains(pageNumber) && !pages.contains(page))
+                pages.append(page);
+        }
+    }
+    if (pages.isEmpty())
+        return;
+
+    m_boundingBoxPool.setMaxThreadCount(1);
+    m_boundingBoxesComputing = true;
+    const int generation = m_boundingBoxGeneration;
+    Generator *generator = m_generator;
+    m_boundingBoxPool.start(new FunctionTask([this, generator, pages, generation] {
+        BoundingBoxTask::run(generator, pages, &m_boundingBoxesAborted, [this, generation](const QVector<QPair<int, NormalizedRect>> &boundingBoxes) {
+            QMetaObject::invokeMethod(m_parent, [this, generation, boundingBoxes] { boundingBoxesComputed(generation, boundingBoxes); }, Qt::QueuedConnection);
+        });
+    }));
+}
+
+void DocumentPrivate::boundingBoxesComputed(int generation, const QVector<QPair<int, NormalizedRect>> &boundingBoxes)
+{
+    // the pages are not the ones of the batch any longer
+    if (generation != m_boundingBoxGeneration)
+        return;
+
+    m_boundingBoxesComputing = false;
+    for (const QPair<int, NormalizedRect> &entry : boundingBoxes) {
+        Page *page = m_pagesVector.value(entry.first);
+        // a full render may have been faster
+        if (!page || page->isBoundingBoxKnown())
+            continue;
+
+        // the pages whose renders fail are not tried again
+        if (entry.second.isNull()) {
+            m_boundingBoxFailedPages.insert(entry.first);
+            continue;
+        }
+
+        setPageBoundingBox(entry.first, entry.second);
+        page->d->m_isBoundingBoxApproximate = true;
+    }
+
+    // until no page is left
+    computeBoundingBoxes();
+}
+
+void DocumentPrivate::cancelBoundingBoxes()
+{
+    m_boundingBoxesAborted.storeRelease(1);
+    m_boundingBoxPool.waitForDone();
+    m_boundingBoxesAborted.storeRelease(0);
+    ++m_boundingBoxGeneration;
+    m_boundingBoxesComputing = false;
+    m_boundingBoxFailedPages.clear();
+}
+
+void DocumentPrivate::cancelTextPageRequests()
+{
+    m_textPageRequests.clear();
+    // the extractions don't check for aborting, they are just one page each
+    m_textPagePool.waitForDone();
+
+    m_extractedTextPagesMutex.lock();
+    for (const QPair<int, TextPage *> &entry : qAsConst(m_extractedTextPages))
+        delete entry.second;
+    m_extractedTextPages.clear();
+    m_extractedTextPagesMutex.unlock();
+    m_textPagesExtracting.clear();
+
+    // the ones waiting go on without them, once the document is done with the change
+    for (const QVector<std::function<void()>> &waiters : qAsConst(m_textPageWaiters)) {
+        for (const std::function<void()> &waiter : waiters)
+            QMetaObject::invokeMethod(m_parent, waiter, Qt::QueuedConnection);
+    }
+    m_textPageWaiters.clear();
+}
+
+void DocumentPrivate::indexTextPage(const Page *page)
+{
+    if (page->d->m_text && !m_textSearchIndex.isIndexed(page->number()))
+        m_textSearchIndex.addPage(page->number(), page->d->m_text->text());
+}
+
+QString DocumentPrivate::docDataCompanionFileName(const QString &extension) const
+{
+    // beside the docdata file, named the same way
+    if (m_xmlFileName.isEmpty() || m_archiveData)
+        return QString();
+
+    QString fileName = m_xmlFileName;
+    if (fileName.endsWith(QLatin1String(".xml")))
+        fileName.chop(4);
+    return fileName + extension;
+}
+
+void DocumentPrivate::loadTextSearchIndex()
+{
+    m_textSearchIndex.reset(m_pagesVector.count());
+
+    const QString fileName = docDataCompanionFileName(QStringLiteral(".textindex"));
+    if (!fileName.isEmpty() && m_textSearchIndex.load(fileName, m_generatorName, QFileInfo(m_docFileName).lastModified()))
+        qCDebug(OkularCoreDebug) << "Loaded the text search index from" << fileName;
+}
+
+void DocumentPrivate::saveTextSearchIndex()
+{
+    const QString fileName = docDataCompanionFileName(QStringLiteral(".textindex"));
+    if (!fileName.isEmpty() && m_textSearchIndex.isModified())
+        m_textSearchIndex.save(fileName, m_generatorName, QFileInfo(m_docFileName).lastModified());
+}
+
+void DocumentPrivate::openTextPageDiskCache()
+{
+    m_textPageDiskCache.close();
+    if (!SettingsCore::enableTextPageDiskCache() || !m_generator->hasFeature(Generator::TextExtraction))
+        return;
+
+    const QString fileName = docDataCompanionFileName(QStringLiteral(".textpages"));
+    if (!fileName.isEmpty())
+        m_textPageDiskCache.setDocument(fileName, m_generatorName, QFileInfo(m_docFileName).lastModified(), m_pagesVector.count());
+}
+
+void DocumentPrivate::loadPageData(Page *page)
+{
+    if (!page || !m_generator || !m_generator->hasFeature(Generator::LazyPageData))
+        return;
+
+    const double width = page->width();
+    const double height = page->height();
+    const Rotation orientation = page->orientation();
+    const bool loaded = m_generator->loadPageData(page);
+    if (page->width() != width || page->height() != height || page->orientation() != orientation)
+        pageSizeChanged(page->number());
+    if (!loaded)
+        return;
+
+    // observers hear about it later, this can run while requests are being sent to the generator
+    const int pageNumber = page->number();
+    QTimer::singleShot(0, m_parent, [this, pageNumber] {
+        if (pageNumber < m_pagesVector.count())
+            foreachObserverD(notifyPageChanged(pageNumber, DocumentObserver::Annotations));
+    });
+}
+
+void DocumentPrivate::pageSizeChanged(int pageNumber)
+{
+    // the page dropped its pixmaps, they were for the old size
+    for (DocumentObserver *observer : qAsConst(m_observers)) {
+        AllocatedPixmap *p = m_allocatedPixmaps.take(observer, pageNumber);
+        if (p) {
+            m_allocatedPixmapsTotalMemory -= p->memory;
+            delete p;
         }
     }
+    m_thumbnailDiskCache.markPageDirty(pageNumber);
+    m_compressedPixmaps.removePage(pageNumber);
+
+    // the pages that change size in a row are laid out again once
+    if (m_pageLayoutPending)
+        return;
+    m_pageLayoutPending = true;
+    QTimer::singleShot(0, m_parent, [this] {
+        m_pageLayoutPending = false;
+        if (!m_pagesVector.isEmpty())
+            foreachObserverD(notifySetup(m_pagesVector, DocumentObserver::NewLayoutForPages));
+    });
+}
+
+void DocumentPrivate::startLoadingPageData()
+{
+    m_nextPageData = 0;
+    if (!m_generator->hasFeature(Generator::LazyPageData))
+        return;
+
+    if (!m_pageDataTimer) {
+        m_pageDataTimer = new QTimer(m_parent);
+        m_pageDataTimer->setSingleShot(true);
+        QObject::connect(m_pageDataTimer, &QTimer::timeout, m_parent, [this] { loadPendingPageData(); });
+    }
+    // the first pages to show go first
+    m_pageDataTimer->start(kPageDataRetryTime);
+}
+
+void DocumentPrivate::loadPendingPageData()
+{
+    if (!m_generator || !m_generator->hasFeature(Generator::LazyPageData))
+        return;
+
+    // rendering takes the generator, wait for it to be done
+    if (!m_generator->canGeneratePixmap()) {
+        m_pageDataTimer->start(kPageDataRetryTime);
+        return;
+    }
+
+    QElapsedTimer slice;
+    slice.start();
+    while (m_nextPageData < m_pagesVector.count() && slice.elapsed() < kPageDataSliceTime)
+        loadPageData(m_pagesVector.at(m_nextPageData++));
+
+    if (m_nextPageData < m_pagesVector.count())
+        m_pageDataTimer->start(0);
+}
+
+void DocumentPrivate::restoreUnloadedPagesInfo()
+{
+    if (m_unloadedPagesInfo.isNull())
+        return;
+
+    // the file may have been saved meanwhile, with them only where it was kept
+    QDomNode pageNode = m_unloadedPagesInfo.documentElement().firstChild();
+    while (pageNode.isElement()) {
+        const QDomElement pageElement = pageNode.toElement();
+        pageNode = pageNode.nextSibling();
+        const int pageNumber = pageElement.attribute(QStringLiteral("number")).toInt();
+        if (pageNumber < m_pagesVector.count() && m_pagesVector[pageNumber]->d->restoreLocalContents(pageElement))
+            m_generator->pageModified(pageNumber);
+    }
+    // the generator gave all its pages, the others are gone
+    m_unloadedPagesInfo = QDomDocument();
+}
+
+void DocumentPrivate::startLoadingMorePages()
+{
+    if (!m_generator->hasFeature(Generator::IncrementalPages))
+        return;
+
+    if (!m_morePagesTimer) {
+        m_morePagesTimer = new QTimer(m_parent);
+        m_morePagesTimer->setSingleShot(true);
+        QObject::connect(m_morePagesTimer, &QTimer::timeout, m_parent, [this] { loadMorePages(); });
+    }
+    m_morePagesTimer->start(kMorePagesInterval);
+}
+
+void DocumentPrivate::loadMorePages()
+{
+    if (!m_generator || !m_generator->hasFeature(Generator::IncrementalPages))
+        return;
+
+    // the observers get the pages of all the slices at once, laying them out
+    // again on every slice would drop what they show on the pages they have
+    if (m_morePagesVector.isEmpty())
+        m_morePagesVector = m_pagesVector;
+    if (m_generator->loadMorePages(m_morePagesVector)) {
+        m_morePagesTimer->start(kMorePagesInterval);
+        return;
+    }
+
+    // the last slice may bring the links, annotations and table of contents of all the pages
+    const int oldCount = m_pagesVector.count();
+    m_pagesVector = m_morePagesVector;
+    m_morePagesVector.clear();
+    invalidateFormIndex();
+    const int count = m_pagesVector.count();
+    for (int i = oldCount; i < count; ++i) {
+        m_pagesVector.at(i)->d->m_doc = this;
+        // the generator gives them unrotated
+        if (m_rotation != Rotation0)
+            m_pagesVector.at(i)->d->rotateAt(m_rotation);
+    }
+    m_textSearchIndex.setPageCount(count);
+    // what the user left on the new pages
+    restoreUnloadedPagesInfo();
+    // an index somebody searched with meanwhile is as good as the saved one
+    if (!m_textSearchIndex.isModified())
+        loadTextSearchIndex();
+    openTextPageDiskCache();
+
+    foreachObserverD(notifySetup(m_pagesVector, DocumentObserver::NewLayoutForPages));
+
+    // the pages that are new have no data yet either
+    if (m_generator->hasFeature(Generator::LazyPageData) && !m_pageDataTimer->isActive())
+        m_pageDataTimer->start(kPageDataRetryTime);
+
+    // back to where the document was left, unless the user went somewhere else meanwhile
+    const DocumentViewport viewport = m_morePagesViewport;
+    m_morePagesViewport = DocumentViewport();
+    if (viewport.isValid() && viewport.pageNumber < count && (*m_viewportIterator).pageNumber == oldCount - 1)
+        m_parent->setViewport(viewport);
+
+    emit m_parent->pagesLoaded();
+}
+
+void DocumentPrivate::loadAllPages()
+{
+    while (m_morePagesTimer && m_morePagesTimer->isActive()) {
+        m_morePagesTimer->stop();
+        loadMorePages();
+    }
+}
+
+void DocumentPrivate::openThumbnailDiskCache()
+{
+    m_thumbnailDiskCache.close();
+    cancelThumbnailLoads();
+    if (!SettingsCore::enableThumbnailDiskCache())
+        return;
 
-    // 2. Add the page to the fifo of generated text pages
-    m_allocatedTextPagesFifo.append(page->number());
+    const QString dirName = docDataCompanionFileName(QStringLiteral(".thumbnails"));
+    if (!dirName.isEmpty())
+        m_thumbnailDiskCache.setDocument(dirName, m_generatorName, QFileInfo(m_docFileName).lastModified());
 }
 
 void Document::setRotation(int r)
@@ -5092,6 +8108,7 @@ void DocumentPrivate::setRotationInternal(int r, bool notify)
     }
     // set the new rotation
     m_rotation = rotation;
+    m_compressedPixmaps.clear();
 
     if (notify) {
         foreachObserverD(notifySetup(m_pagesVector, DocumentObserver::NewLayoutForPages));
@@ -5117,9 +8134,12 @@ void Document::setPageSize(const PageSize &size)
     for (; pIt != pEnd; ++pIt)
         (*pIt)->d->changeSize(size);
     // clear 'memory allocation' descriptors
-    qDeleteAll(d->m_allocatedPixmaps);
     d->m_allocatedPixmaps.clear();
     d->m_allocatedPixmapsTotalMemory = 0;
+    d->m_pixmapDiskCache.clear();
+    d->m_thumbnailDiskCache.clear();
+    d->cancelThumbnailLoads();
+    d->m_compressedPixmaps.clear();
     // notify the generator that the current page size has changed
     d->m_generator->pageSizeChanged(size, d->m_pageSize);
     // set the new page size
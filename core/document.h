@@ -15,8 +15,11 @@
 #include "global.h"
 #include "okularcore_export.h"
 #include "pagesize.h"
+#include "renderstatistics.h"
 
 #include <QDomDocument>
+#include <QHash>
+#include <QMap>
 #include <QObject>
 #include <QPrinter>
 #include <QStringList>
@@ -48,6 +51,7 @@ class FormField;
 class FormFieldText;
 class FormFieldButton;
 class FormFieldChoice;
+class Outline;
 class Generator;
 class Action;
 class MovieAction;
@@ -260,6 +264,16 @@ public:
      */
     const DocumentSynopsis *documentSynopsis() const;
 
+    /**
+     * Returns the table of content of the document in the compact form of
+     * an Outline, or 0 if no table of content is available. It is the one
+     * of the generator, or else made from documentSynopsis(); it stays valid
+     * until the document is closed or reloaded.
+     *
+     * @since 21.12
+     */
+    const Outline *outline() const;
+
     /**
      * Starts the reading of the information about the fonts in the
      * document, if available.
@@ -314,6 +328,24 @@ public:
      */
     const QVector<VisiblePageRect *> &visiblePageRects() const;
 
+    /**
+     * Sets whether the document is the one the user sees, like the document
+     * of the current tab. The documents of a process share one memory
+     * budget, the inactive ones give back their pixmaps and text pages
+     * first. Documents are active by default.
+     *
+     * @since 21.12
+     */
+    void setActive(bool active);
+
+    /**
+     * Returns whether the document is the one the user sees.
+     *
+     * @see setActive()
+     * @since 21.12
+     */
+    bool isActive() const;
+
     /**
      * Returns the number of the current page.
      */
@@ -324,6 +356,23 @@ public:
      */
     uint pages() const;
 
+    /**
+     * Returns whether the generator is still giving the pages of the
+     * document in the background, pages() only counts the ones it gave
+     * before. pagesLoaded() is emitted once they are all there.
+     *
+     * @since 21.12
+     */
+    bool isLoadingPages() const;
+
+    /**
+     * Has the generator give all the pages left at once, e.g. before
+     * printing or going to a page that is not there yet.
+     *
+     * @since 21.12
+     */
+    void loadAllPages();
+
     /**
      * Returns the url of the currently opened document.
      */
@@ -369,6 +418,38 @@ public:
      */
     bool exportToText(const QString &fileName) const;
 
+    /**
+     * Exports the document as text to @p fileName like exportToText(), but
+     * in the background and page by page, so neither the user interface nor
+     * the memory used depend on the size of the document.
+     * textExportProgress() reports the pages written and
+     * textExportFinished() the end. There is one text export at a time.
+     *
+     * The text is the one of the text pages of the document, one page after
+     * the other. If the generator can't give it from another thread,
+     * exportToText() does the export before returning.
+     *
+     * Returns whether the export started.
+     *
+     * @since 21.12
+     */
+    bool startTextExport(const QString &fileName);
+
+    /**
+     * Stops the text export started with startTextExport(), the file is
+     * left as it was.
+     *
+     * @since 21.12
+     */
+    void cancelTextExport();
+
+    /**
+     * Returns whether a text export started with startTextExport() is running.
+     *
+     * @since 21.12
+     */
+    bool isExportingText() const;
+
     /**
      * Returns the list of supported export formats.
      * @see ExportFormat
@@ -380,6 +461,40 @@ public:
      */
     bool exportTo(const QString &fileName, const ExportFormat &format) const;
 
+    /**
+     * Exports the document in the given @p format to @p fileName like
+     * exportTo(), but in the background, so the user interface stays
+     * responsive; exportFinished() reports the end. The file is only
+     * replaced once the whole export is written. There is one export at a
+     * time.
+     *
+     * The export to text is startTextExport(), which reports through
+     * textExportProgress() and textExportFinished(). If the generator can't
+     * export from another thread, exportTo() does the export before
+     * returning.
+     *
+     * Returns whether the export started.
+     *
+     * @since 21.12
+     */
+    bool startExport(const QString &fileName, const ExportFormat &format);
+
+    /**
+     * Stops the export started with startExport(); the file is left as it
+     * was. The generator may not be able to stop before its export is done,
+     * exportFinished() comes then.
+     *
+     * @since 21.12
+     */
+    void cancelExport();
+
+    /**
+     * Returns whether an export started with startExport() is running.
+     *
+     * @since 21.12
+     */
+    bool isExporting() const;
+
     /**
      * Returns whether the document history is at the begin.
      */
@@ -502,16 +617,115 @@ public:
      */
     void requestPixmaps(const QLinkedList<PixmapRequest *> &requests, PixmapRequestFlags reqOptions);
 
+    /**
+     * Returns the counters of the pixmap rendering for the whole document.
+     *
+     * @since 21.12
+     */
+    RenderStatistics renderStatistics() const;
+
+    /**
+     * Returns the counters of the pixmap rendering of each observer.
+     *
+     * @since 21.12
+     */
+    QHash<DocumentObserver *, RenderStatistics> observerRenderStatistics() const;
+
+    /**
+     * Sets the counters of the pixmap rendering back to zero; the ones that
+     * are about the current state, like the queued requests or the memory
+     * used by pixmaps, are not affected.
+     *
+     * @since 21.12
+     */
+    void resetRenderStatistics();
+
+    /**
+     * Returns an estimate of the memory the document uses, in bytes, by
+     * subsystem: its pixmaps and tiles, text pages, annotations, undo
+     * history, the caches of the generator and whatever else was reported
+     * with setMemoryUsage(). The pixmap budget of the memory level applies
+     * to the pixmaps and the caches of the generator.
+     *
+     * @since 21.12
+     */
+    QMap<QString, qulonglong> memoryUsage() const;
+
+    /**
+     * Reports that @p subsystem, kept outside of the document, e.g. the form
+     * widgets of a view, uses @p bytes of memory for it. It replaces the
+     * previous report of @p subsystem; 0 bytes removes it.
+     *
+     * @since 21.12
+     */
+    void setMemoryUsage(const QString &subsystem, qulonglong bytes);
+
+    /**
+     * Returns how many more bytes of pixmaps the document can hold before it
+     * starts evicting them, according to the memory level and the free
+     * memory. Observers can use it to decide how much to preload.
+     *
+     * @since 21.12
+     */
+    qulonglong availablePixmapMemory() const;
+
     /**
      * Sends a request for text page generation for the given page @p pageNumber.
+     *
+     * The text page is generated in the calling thread, see the other
+     * requestTextPage() for one that doesn't wait for it.
      */
     void requestTextPage(uint pageNumber);
 
+    /**
+     * The priorities of the asynchronous text page requests, the first ones
+     * are served first.
+     *
+     * @since 21.12
+     */
+    enum TextPagePriority {
+        VisibleTextPagePriority,   ///< The page is shown
+        SearchTextPagePriority,    ///< A search is about to go through the page
+        BackgroundTextPagePriority ///< The text is only wanted ahead of time, e.g. for an index
+    };
+
+    /**
+     * Sends a request for the text page of the page @p pageNumber, generated
+     * in a thread of its own with @p priority; textPageReady() is emitted
+     * when the page has it. A new request for the page only raises the
+     * priority of the pending one.
+     *
+     * If the generator is not Threaded only the requests with
+     * SearchTextPagePriority generate the text page before returning, like
+     * requestTextPage(uint), the others are dropped.
+     *
+     * @since 21.12
+     */
+    void requestTextPage(uint pageNumber, TextPagePriority priority);
+
+    /**
+     * Drops the pending asynchronous text page request of the page
+     * @p pageNumber, unless a search waits for it. An extraction that
+     * started already is finished.
+     *
+     * @since 21.12
+     */
+    void cancelTextPageRequest(uint pageNumber);
+
     /**
      * Adds a new @p annotation to the given @p page.
      */
     void addPageAnnotation(int page, Annotation *annotation);
 
+    /**
+     * Adds the new @p annotations to the given @p page, as one step that can
+     * be undone. The observers hear about the page once, when all of them
+     * are added.
+     *
+     * @since 21.12
+     */
+    void addPageAnnotations(int page, const QList<Annotation *> &annotations);
+
     /**
      * Tests if the @p annotation can be modified
      *
@@ -666,6 +880,26 @@ public:
      */
     void resetSearch(int searchID);
 
+    /**
+     * Returns the pages the next matches of the NextMatch or PreviousMatch
+     * search @p searchID are likely on, nearest first in its direction, so
+     * that views can preload them. They are known after each match, with
+     * the pages changed notified with DocumentObserver::Highlights, and
+     * there are none once the search is reset.
+     *
+     * @since 21.12
+     */
+    QVector<int> upcomingSearchMatchPages(int searchID) const;
+
+    /**
+     * Returns the first match of the search @p searchID on @p page, one of the
+     * upcomingSearchMatchPages(), so that views can preload the part of the
+     * page they show for it. It is null when the page had no text yet.
+     *
+     * @since 21.12
+     */
+    NormalizedRect upcomingSearchMatchRect(int searchID, int page) const;
+
     /**
      * Returns the bookmark manager of the document.
      */
@@ -821,6 +1055,16 @@ public:
      */
     bool swapBackingFileArchive(const QString &newFileName, const QUrl &url);
 
+    /**
+     * Takes the new contents of the file of the document after it changed
+     * on disk, keeping the pages, and what was shown of them, that did not
+     * change. Only the generators with the Generator::InPlaceReload feature
+     * can, returns false if the document has to be closed and opened again.
+     *
+     * @since 21.12
+     */
+    bool reloadInPlace();
+
     /**
      * Sets the history to be clean
      *
@@ -877,6 +1121,24 @@ public:
      */
     bool saveChanges(const QString &fileName, QString *errorText);
 
+    /**
+     * Returns whether the changes to the document can be saved by appending
+     * them to the file it was loaded from, see saveChangesInPlace().
+     *
+     * @since 21.12
+     */
+    bool canSaveChangesInPlace() const;
+
+    /**
+     * Saves the changes to the document by appending them to the file it was
+     * loaded from, @p fileName, instead of writing the whole document again.
+     * On failure the file is left as it was and @p errorText may tell why,
+     * saveChanges() to another file then still works.
+     *
+     * @since 21.12
+     */
+    bool saveChangesInPlace(const QString &fileName, QString *errorText);
+
     /**
      * Register the specified @p view for the current document.
      *
@@ -1023,6 +1285,14 @@ public Q_SLOTS:
      */
     void cancelSearch();
 
+    /**
+     * Cancels the search with the given @p searchID, if it is running; it
+     * finishes with SearchCancelled.
+     *
+     * @since 21.12
+     */
+    void cancelSearch(int searchID);
+
     /**
      * Undo last edit command
      * @since 0.17 (KDE 4.11)
@@ -1073,6 +1343,27 @@ public Q_SLOTS:
      */
     void reloadDocument() const;
 
+    /**
+     * Renders the pages again after a change of the optional content, the
+     * layers in layersModel(): the ones shown now, the others when they are
+     * shown again.
+     *
+     * @since 21.12
+     */
+    void refreshLayers();
+
+    /**
+     * Finds in the background the bounding boxes of the pages that don't know
+     * theirs yet (see Page::isBoundingBoxKnown()), from small renders of the
+     * pages nearest to the current one first, so that what depends on them,
+     * like trimming the margins, does not change as the pages are shown.
+     *
+     * Only generators that are threaded and render in parallel do it.
+     *
+     * @since 21.12
+     */
+    void computeBoundingBoxes();
+
     /**
      * Returns the part of document covered by the given signature @p info.
      *
@@ -1087,6 +1378,16 @@ public Q_SLOTS:
      */
     void refreshPixmaps(int pageNumber);
 
+    /**
+     * Refresh the pixmaps for the given @p pageNumber, knowing that only
+     * @p area (in normalized, unrotated page coordinates) changed: only the
+     * tiles intersecting it are rendered again. A null @p area refreshes
+     * the whole page.
+     *
+     * @since 21.12
+     */
+    void refreshPixmaps(int pageNumber, const NormalizedRect &area);
+
 Q_SIGNALS:
     /**
      * This signal is emitted whenever the document is about to close.
@@ -1183,6 +1484,55 @@ Q_SIGNALS:
      */
     void searchFinished(int searchID, Okular::Document::SearchStatus endStatus);
 
+    /**
+     * Reports the @p count matches found on @p page by the AllDocument,
+     * GoogleAll or GoogleAny search @p searchID, while it goes on. They are
+     * already highlighted on the page.
+     *
+     * @since 21.12
+     */
+    void searchMatchesFound(int searchID, int page, int count);
+
+    /**
+     * Reports that the generator gave the last pages of the document, which
+     * was opened with only the first ones, see isLoadingPages().
+     *
+     * @since 21.12
+     */
+    void pagesLoaded();
+
+    /**
+     * Reports that the page @p pageNumber got its text page after an
+     * asynchronous request for it, see requestTextPage().
+     *
+     * @since 21.12
+     */
+    void textPageReady(int pageNumber);
+
+    /**
+     * Reports that the text export started with startTextExport() wrote
+     * @p pagesDone of the @p pageCount pages.
+     *
+     * @since 21.12
+     */
+    void textExportProgress(int pagesDone, int pageCount);
+
+    /**
+     * Reports the end of the text export to @p fileName started with
+     * startTextExport(). @p success is false if it failed or was cancelled.
+     *
+     * @since 21.12
+     */
+    void textExportFinished(const QString &fileName, bool success);
+
+    /**
+     * Reports the end of the export to @p fileName started with
+     * startExport(). @p success is false if it failed or was cancelled.
+     *
+     * @since 21.12
+     */
+    void exportFinished(const QString &fileName, bool success);
+
     /**
      * This signal is emitted whenever a source reference with the given parameters has been
      * activated.
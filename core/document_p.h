@@ -12,21 +12,43 @@
 #include "script/event_p.h"
 
 #include "synctex/synctex_parser.h"
+#include <functional>
 #include <memory>
 
 // qt/kde/system includes
 #include <KConfigDialog>
 #include <KPluginMetaData>
+#include <QAtomicInt>
+#include <QDomDocument>
+#include <QElapsedTimer>
 #include <QHash>
 #include <QLinkedList>
 #include <QMap>
 #include <QMutex>
 #include <QPointer>
+#include <QSet>
+#include <QSharedPointer>
+#include <QThreadPool>
 #include <QUrl>
+#include <threadweaver/queue.h>
 
 // local includes
+#include "allocatedpixmaps_p.h"
+#include "allocatedtextpages_p.h"
+#include "compressedpixmapcache_p.h"
+#include "documentinfofile_p.h"
 #include "fontinfo.h"
+#include "formdependencies_p.h"
 #include "generator.h"
+#include "memorypressure_p.h"
+#include "pixmapdiskcache_p.h"
+#include "pixmaprequestqueue_p.h"
+#include "renderstatistics.h"
+#include "renderstatistics_p.h"
+#include "textpage_p.h"
+#include "textpagediskcache_p.h"
+#include "textsearchindex_p.h"
+#include "thumbnaildiskcache_p.h"
 
 class QUndoStack;
 class QEventLoop;
@@ -35,18 +57,26 @@ class QTimer;
 class QTemporaryFile;
 class KPluginMetaData;
 
-struct AllocatedPixmap;
 struct ArchiveData;
 struct RunningSearch;
 
 namespace Okular
 {
+class Annotation;
+class Outline;
 class ScriptAction;
 class ConfigInterface;
 class PageController;
 class SaveInterface;
 class Scripter;
 class View;
+
+// what happened to the annotations of a page since its observers were told
+struct AnnotationChanges {
+    QVector<Annotation *> added;
+    QVector<Annotation *> removed;
+    QVector<Annotation *> modified;
+};
 }
 
 struct GeneratorInfo {
@@ -68,6 +98,16 @@ struct GeneratorInfo {
     bool saveChecked : 1;
 };
 
+// a point of a pdfsync file, the x and y are in TeX's scaled points
+struct pdfsyncpoint {
+    QString file;
+    qlonglong x = 0;
+    qlonglong y = 0;
+    int row = -1; // -1 for an id with no point
+    int column = 0;
+    int page = -1;
+};
+
 namespace Okular
 {
 class OKULARCORE_EXPORT BackendConfigDialog : public KConfigDialog
@@ -92,6 +132,21 @@ struct DoContinueDirectionMatchSearchStruct {
     RegularAreaRect *match;
     int currentPage;
     int searchID;
+    // the RunningSearch::generation it is for
+    int generation;
+    // the page whose text page was requested in the background, so it is
+    // extracted in place if that gave none
+    int textPageRequested;
+};
+
+// what the search thread found on a page, or that it finished if pageNumber is -1
+struct DocumentSearchResult {
+    int searchID;
+    int generation;
+    int pageNumber;
+    TextPage *textPage;
+    TextMatches matches;
+    bool cancelled;
 };
 
 enum LoadDocumentInfoFlag {
@@ -107,30 +162,57 @@ class DocumentPrivate
 public:
     explicit DocumentPrivate(Document *parent)
         : m_parent(parent)
+        , m_searchCancelled(false)
+        , m_searchGeneration(0)
         , m_tempFile(nullptr)
         , m_docSize(-1)
+        , m_waitingForGenerator(false)
+        , m_pageRenderCostsTotal(0)
         , m_allocatedPixmapsTotalMemory(0)
-        , m_maxAllocatedTextPages(0)
+        , m_maxAllocatedTextPagesMemory(0)
+        , m_pagePreviewsMemory(0)
+        , m_boundingBoxGeneration(0)
+        , m_boundingBoxesComputing(false)
+        , m_thumbnailLoadsGeneration(0)
         , m_warnedOutOfMemory(false)
         , m_rotation(Rotation0)
         , m_exportCached(false)
         , m_bookmarkManager(nullptr)
         , m_memCheckTimer(nullptr)
+        , m_memoryPressureMonitor(nullptr)
         , m_saveBookmarksTimer(nullptr)
+        , m_pageDataTimer(nullptr)
+        , m_nextPageData(0)
+        , m_pageLayoutPending(false)
+        , m_morePagesTimer(nullptr)
+        , m_draftRefineTimer(nullptr)
+        , m_warmStartPage(-1)
+        , m_warmStartRequested(false)
+        , m_warmStartTimer(nullptr)
+        , m_pageChangesTimer(nullptr)
+        , m_synopsisOutlineDirty(true)
         , m_generator(nullptr)
         , m_walletGenerator(nullptr)
         , m_generatorsLoaded(false)
         , m_pageController(nullptr)
         , m_closingLoop(nullptr)
         , m_scripter(nullptr)
+        , m_formIndexValid(false)
         , m_archiveData(nullptr)
         , m_fontsCached(false)
         , m_annotationEditingEnabled(true)
         , m_annotationBeingModified(false)
+        , m_annotationBatchDepth(0)
         , m_docdataMigrationNeeded(false)
         , m_synctex_scanner(nullptr)
+        , m_synctexLoadedScanner(nullptr)
+        , m_synctexGeneration(0)
+        , m_synctexLoading(false)
+        , m_active(true)
     {
         calculateMaxTextPages();
+        // one at a time, the generator renders meanwhile
+        m_embeddedThumbnailQueue.setMaximumNumberOfThreads(1);
     }
 
     // private methods
@@ -139,16 +221,63 @@ public:
     QString namePaperSize(double inchesWidth, double inchesHeight) const;
     QString localizedSize(const QSizeF size) const;
     qulonglong calculateMemoryToFree();
+    qulonglong pixmapMemoryLimit();
     void cleanupPixmapMemory();
     void cleanupPixmapMemory(qulonglong memoryToFree);
+    qulonglong freeDocumentMemory(qulonglong memoryToFree);
+    qulonglong cachedMemory() const;
+    void releaseTextPages();
+    static QVector<DocumentPrivate *> &allDocuments();
+    void cleanupTilesMemory(qulonglong memoryToFree, const QMap<int, VisiblePageRect *> &visibleRects, int currentViewportPage);
     AllocatedPixmap *searchLowestPriorityPixmap(bool unloadableOnly = false, bool thenRemoveIt = false, DocumentObserver *observer = nullptr /* any */);
+    // how long a pixmap of the page with that many pixels takes to render, in msec
+    qint64 estimatedRenderTime(int pageNumber, qulonglong pixels) const;
+    double preloadEvictionScore(const PixmapRequest *request, int viewportPage) const;
+    static qulonglong renderedPixels(const PixmapRequest *request);
+    void recordRenderTime(int pageNumber, qulonglong pixels, qint64 renderTime);
     void calculateMaxTextPages();
+    void addAllocatedTextPage(Page *page);
+    void evictTextPages(int keepPage = -1);
+    bool requestTextPage(int pageNumber, Document::TextPagePriority priority, const std::function<void()> &done = nullptr);
+    void startTextPageRequests();
+    void startTextPageTask(Page *page, bool visible);
+    void textPagesExtracted();
+    void cancelTextPageRequests();
+    bool adoptTextPage(int pageNumber, TextPage *textPage);
+    void computeBoundingBoxes();
+    void boundingBoxesComputed(int generation, const QVector<QPair<int, NormalizedRect>> &boundingBoxes);
+    void cancelBoundingBoxes();
+    void indexTextPage(const Page *page);
+    QString docDataCompanionFileName(const QString &extension) const;
+    void loadTextSearchIndex();
+    void saveTextSearchIndex();
+    void openTextPageDiskCache();
+    void openThumbnailDiskCache();
+    void loadPageData(Page *page);
+    void startLoadingPageData();
+    void loadPendingPageData();
+    void pageSizeChanged(int pageNumber);
+    // the generator found out page looks different after reloadInPlace()
+    void pageContentsChanged(int page);
+    void startLoadingMorePages();
+    void loadMorePages();
+    // gives the observers all the pages left now, instead of in slices
+    void loadAllPages();
+    void textExportProgress(const QSharedPointer<QAtomicInt> &aborted, int pagesDone);
+    void finishTextExport(const QSharedPointer<QAtomicInt> &aborted, const QString &fileName, bool success);
+    void cancelTextExport();
+    void finishExport(const QSharedPointer<QAtomicInt> &aborted, const QString &fileName, bool success);
+    void cancelExport();
     qulonglong getTotalMemory();
     qulonglong getFreeMemory(qulonglong *freeSwap = nullptr);
     bool loadDocumentInfo(LoadDocumentInfoFlags loadWhat);
     bool loadDocumentInfo(QFile &infoFile, LoadDocumentInfoFlags loadWhat);
+    void restoreUnloadedPagesInfo();
+    bool loadDocumentInfo(const DocumentInfoFile &file);
     void loadViewsInfo(View *view, const QDomElement &e);
     void saveViewsInfo(View *view, QDomElement &e) const;
+    void loadViewsInfo(View *view, const QByteArray &data);
+    QByteArray saveViewsInfo(View *view) const;
     QUrl giveAbsoluteUrl(const QString &fileName) const;
     bool openRelativeFile(const QString &fileName);
     Generator *loadGeneratorLibrary(const KPluginMetaData &service);
@@ -163,13 +292,61 @@ public:
     static ArchiveData *unpackDocumentArchive(const QString &archivePath);
     bool savePageDocumentInfo(QTemporaryFile *infoFile, int what) const;
     DocumentViewport nextDocumentViewport() const;
+    // record what to tell with the next notifyAnnotationChanges() of the page
+    void annotationAdded(int page, Annotation *annotation);
+    void annotationRemoved(int page, Annotation *annotation);
+    void annotationModified(int page, Annotation *annotation);
     void notifyAnnotationChanges(int page);
-    void notifyFormChanges(int page);
+    // the annotation changes in between are told once per page, at the end
+    void beginAnnotationBatch();
+    void endAnnotationBatch();
+    void refreshAnnotationPixmaps(int pageNumber, const NormalizedRect &area);
+    // the fields called @p changedFields on @p page changed
+    void notifyFormChanges(int page, const QSet<QString> &changedFields);
     bool canAddAnnotationsNatively() const;
     bool canModifyExternalAnnotations() const;
     bool canRemoveExternalAnnotations() const;
     OKULARCORE_EXPORT static QString docDataFileName(const QUrl &url, qint64 document_size);
     bool cancelRenderingBecauseOf(PixmapRequest *executingRequest, PixmapRequest *newRequest);
+    QString pixmapDiskCacheRenderHints() const;
+    bool requestPixmapFromDiskCache(PixmapRequest *request);
+    void demotePixmap(DocumentObserver *observer, int pageNumber);
+    void refineDraftPixmaps();
+    void notifyPagesChanged(const QSet<int> &pages, int flags);
+    void sendPageChanges();
+    void clearSynopsisOutline();
+    bool restoreCompressedPixmap(PixmapRequest *request);
+    bool sharePixmapFromOtherObserver(PixmapRequest *request);
+    bool shareTilesFromOtherObservers(PixmapRequest *request);
+    bool wantsEmbeddedThumbnail(PixmapRequest *request) const;
+    bool setEmbeddedThumbnail(DocumentObserver *observer, int pageNumber, const QSize &size, const QImage &image);
+    bool useEmbeddedThumbnail(PixmapRequest *request);
+    bool loadEmbeddedThumbnail(PixmapRequest *request);
+    bool loadCachedThumbnail(PixmapRequest *request);
+    void cancelThumbnailLoads();
+    void cachedThumbnailLoaded(DocumentObserver *observer, int pageNumber, const QSize &size, int priority, int features, int generation, const QImage &image);
+    void setAllocatedPixmap(DocumentObserver *observer, int pageNumber, qulonglong memoryBytes);
+    // the counters of m_renderStatistics of @p observer, to be updated
+    RenderStatisticsPrivate *observerStatistics(DocumentObserver *observer);
+    void recordFirstPixmap(DocumentObserver *observer);
+    // holds the thumbnails and the preloading until the pages around @p page are rendered
+    void startWarmStart(int page);
+    // lets them go, when the last warm start request is done or it took too long
+    void endWarmStart();
+    bool hasWarmStartRequests();
+    // the preview of the page went from previousBytes to bytes, frees the oldest ones over the budget
+    void setPagePreview(int pageNumber, qulonglong previousBytes, qulonglong bytes);
+    QVector<NormalizedRect> tileBands(const PixmapRequest *request) const;
+    PixmapRequest *previewRequestFor(const PixmapRequest *request) const;
+    void updateCompressedPixmapsBudget();
+    bool isPageBeingGenerated(DocumentObserver *observer, int pageNumber) const;
+    // the executing request of another observer whose pixmap would do for @p request
+    PixmapRequest *coalescingPixmapRequest(const PixmapRequest *request) const;
+    void finishCoalescedPixmapRequests(const PixmapRequest *request, const QVector<PixmapRequest *> &coalescedRequests);
+    // takes the coalesced requests of @p observer, for @p pageNumber or all of them if -1
+    QVector<PixmapRequest *> takeCoalescedPixmapRequests(DocumentObserver *observer, int pageNumber = -1);
+    void prepareGeneratorPixmapRequest(PixmapRequest *request);
+    bool isBatchablePixmapRequest(PixmapRequest *request, const PixmapRequest *first) const;
 
     // Methods that implement functionality needed by undo commands
     void performAddPageAnnotation(int page, Annotation *annotation);
@@ -177,21 +354,35 @@ public:
     void performModifyPageAnnotation(int page, Annotation *annotation, bool appearanceChanged);
     void performSetAnnotationContents(const QString &newContents, Annotation *annot, int pageNumber);
 
-    void recalculateForms();
+    void recalculateForms(const QSet<QString> &changedFields);
+    void buildFormIndex();
+    void invalidateFormIndex();
 
     // private slots
     void saveDocumentInfo() const;
+    void saveDocumentInfoBinary() const;
+    void saveDocumentInfoXml() const;
     void slotTimedMemoryCheck();
+    void slotMemoryPressure();
     void sendGeneratorPixmapRequest();
+    void generatorPixmapGenerationReady();
     void rotationFinished(int page, Okular::Page *okularPage);
     void slotFontReadingProgress(int page);
     void fontReadingGotFont(const Okular::FontInfo &font);
     void slotGeneratorConfigChanged();
-    void refreshPixmaps(int);
+    void refreshPixmaps(int pageNumber, const NormalizedRect &area = NormalizedRect());
+    // like refreshPixmaps(), but drops the pixmaps the observers don't show
+    void refreshShownPixmaps(int pageNumber);
+    NormalizedRect annotationRefreshArea(const Annotation *annotation, bool forget = false);
     void _o_configChanged();
     void doContinueDirectionMatchSearch(void *doContinueDirectionMatchSearchStruct);
-    void doContinueAllDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID);
-    void doContinueGooglesDocumentSearch(void *pagesToNotifySet, void *pageMatchesMap, int currentPage, int searchID, const QStringList &words);
+    void startDocumentSearch(int searchID);
+    void doContinueDocumentSearch(int currentPage, int searchID, int generation);
+    void queueDocumentSearchResult(const DocumentSearchResult &result);
+    void documentSearchResultsReady();
+    void showSearchMatches(RunningSearch *search, int searchID, int pageNumber, const TextMatches &matches);
+    void finishDocumentSearch(int searchID, int generation, bool cancelled);
+    void cancelDocumentSearches();
 
     void doProcessSearchMatch(RegularAreaRect *match, RunningSearch *search, QSet<int> *pagesToNotify, int currentPage, int searchID, bool moveViewport, const QColor &color);
 
@@ -227,7 +418,15 @@ public:
     bool isNormalizedRectangleFullyVisible(const Okular::NormalizedRect &rectOfInterest, int rectPage);
 
     // For sync files
-    void loadSyncFile(const QString &filePath);
+    static QVector<pdfsyncpoint> readSyncFile(const QString &filePath);
+    void addSyncPoints(const QVector<pdfsyncpoint> &points);
+    // builds the synctex scanner of docFile in the background, falls back to
+    // reading the pdfsync file there if there is none
+    void loadSynctexScanner(const QString &docFile);
+    void finishSynctexLoading(int generation);
+    // the synctex scanner, waits for the one being built
+    synctex_scanner_p synctexScanner();
+    void closeSynctexScanner();
 
     void clearAndWaitForRequests();
 
@@ -248,6 +447,12 @@ public:
     // find descriptors, mapped by ID (we handle multiple searches)
     QMap<int, RunningSearch *> m_searches;
     bool m_searchCancelled;
+    // the last RunningSearch::generation given, unique across the ids
+    int m_searchGeneration;
+    // whole document searches run there, see startDocumentSearch()
+    QThreadPool m_searchPool;
+    QMutex m_documentSearchResultsMutex;
+    QVector<DocumentSearchResult> m_documentSearchResults;
 
     // needed because for remote documents docFileName is a local file and
     // we want the remote url when the document refers to relativeNames
@@ -267,13 +472,76 @@ public:
 
     // observers / requests / allocator stuff
     QSet<DocumentObserver *> m_observers;
-    QLinkedList<PixmapRequest *> m_pixmapRequestsStack;
+    PixmapRequestQueue m_pixmapRequestsStack;
     QLinkedList<PixmapRequest *> m_executingPixmapRequests;
+    // the requests waiting for the pixmap of an executing one, by it
+    QHash<const PixmapRequest *, QVector<PixmapRequest *>> m_coalescedPixmapRequests;
     QMutex m_pixmapRequestsMutex;
-    QLinkedList<AllocatedPixmap *> m_allocatedPixmaps;
+    // there are queued requests but the generator was busy last time we tried
+    bool m_waitingForGenerator;
+    // counters of the render pipeline, the current values are filled in by Document
+    QHash<DocumentObserver *, RenderStatistics> m_renderStatistics;
+    // msec per megapixel of the last render of each page, and their sum
+    QHash<int, double> m_pageRenderCosts;
+    double m_pageRenderCostsTotal;
+    // started when opening the document, for RenderStatistics::firstPixmapTime
+    QElapsedTimer m_openTimer;
+    // the memory of the subsystems outside the document, see Document::setMemoryUsage()
+    QMap<QString, qulonglong> m_reportedMemory;
+    AllocatedPixmapIndex m_allocatedPixmaps;
     qulonglong m_allocatedPixmapsTotalMemory;
-    QList<int> m_allocatedTextPagesFifo;
-    int m_maxAllocatedTextPages;
+    PixmapDiskCache m_pixmapDiskCache;
+    CompressedPixmapCache m_compressedPixmaps;
+    AllocatedTextPages m_allocatedTextPages;
+    qulonglong m_maxAllocatedTextPagesMemory;
+    // the pages with a preview, oldest first, see Page::preview()
+    QList<int> m_pagePreviewsFifo;
+    qulonglong m_pagePreviewsMemory;
+
+    // extraction of the text of the pages in the background: the requested
+    // ones by priority, then the ones near the current page, see
+    // startTextPageRequests()
+    QThreadPool m_textPagePool;
+    // highest priority first, the newest first for the same priority
+    QVector<QPair<int, Document::TextPagePriority>> m_textPageRequests;
+    // called once the extraction of the page is done, whatever came out of it
+    QHash<int, QVector<std::function<void()>>> m_textPageWaiters;
+    QSet<int> m_textPagesExtracting;
+    QMutex m_extractedTextPagesMutex;
+    QVector<QPair<int, TextPage *>> m_extractedTextPages;
+    // the bounding boxes of the pages not rendered yet, found on small
+    // renders in the background, see computeBoundingBoxes()
+    QThreadPool m_boundingBoxPool;
+    QAtomicInt m_boundingBoxesAborted;
+    int m_boundingBoxGeneration;
+    bool m_boundingBoxesComputing;
+    // the pages whose small renders failed
+    QSet<int> m_boundingBoxFailedPages;
+    // the words of the pages whose text was extracted, lets searches skip pages
+    TextSearchIndex m_textSearchIndex;
+    // the laid out text pages, kept from one time the document is open to the next
+    TextPageDiskCache m_textPageDiskCache;
+    // the thumbnails of the pages, kept from one time the document is open to the next
+    ThumbnailDiskCache m_thumbnailDiskCache;
+    // the (observer, page) thumbnails being read from it, the loads of another
+    // generation were started for a document or rotation that is gone
+    QSet<QPair<DocumentObserver *, int>> m_thumbnailsLoading;
+    int m_thumbnailLoadsGeneration;
+    // the embedded thumbnails are looked for there with threaded generators,
+    // their loads are in m_thumbnailsLoading too
+    ThreadWeaver::Queue m_embeddedThumbnailQueue;
+    // the size of the embedded thumbnail of the pages asked already, empty
+    // for the ones without, so they aren't asked again
+    QHash<int, QSize> m_embeddedThumbnailSizes;
+
+    // the text export of startTextExport(), m_textExportAborted is null when there is none
+    QThreadPool m_textExportPool;
+    QSharedPointer<QAtomicInt> m_textExportAborted;
+    QString m_textExportFileName;
+    // the export of startExport() in the other formats, likewise
+    QThreadPool m_exportPool;
+    QSharedPointer<QAtomicInt> m_exportAborted;
+    QString m_exportFileName;
     bool m_warnedOutOfMemory;
 
     // the rotation applied to the document
@@ -294,7 +562,41 @@ public:
 
     // timers (memory checking / info saver)
     QTimer *m_memCheckTimer;
+    MemoryPressureMonitor *m_memoryPressureMonitor;
     QTimer *m_saveBookmarksTimer;
+    // fills in the page data left out by generators with LazyPageData, from m_nextPageData on
+    QTimer *m_pageDataTimer;
+    int m_nextPageData;
+    // pages changed size and the observers are yet to lay them out again
+    bool m_pageLayoutPending;
+    // asks generators with IncrementalPages for the pages they did not give yet
+    QTimer *m_morePagesTimer;
+    // the pages given so far while the generator gives more, the observers
+    // get them after the last slice
+    QVector<Page *> m_morePagesVector;
+    // the <page> elements of the document info of the pages not given yet,
+    // restored when they come and saved again meanwhile
+    QDomDocument m_unloadedPagesInfo;
+    // the page the document was left at, when it was not there yet when it was opened again
+    DocumentViewport m_morePagesViewport;
+    // the pages whose pixmap is a draft, with the priority they were asked with,
+    // rendered again at full quality when m_draftRefineTimer fires
+    QHash<QPair<DocumentObserver *, int>, int> m_draftPixmaps;
+    QTimer *m_draftRefineTimer;
+    // the priority of the last preload each observer asked for, the drafts
+    // of the pages that are not visible any longer are refined with it
+    QHash<DocumentObserver *, int> m_preloadPriorities;
+    // the page restored when the document was opened, -1 once it is shown
+    int m_warmStartPage;
+    // whether it was asked for already, after that the rest waits only while it is pending
+    bool m_warmStartRequested;
+    QTimer *m_warmStartTimer;
+    // the flags of the changes of the pages, sent together by m_pageChangesTimer
+    QMap<int, int> m_pendingPageChanges;
+    QTimer *m_pageChangesTimer;
+    // Document::outline() of the generators without one of their own
+    std::unique_ptr<Outline> m_synopsisOutline;
+    bool m_synopsisOutlineDirty;
 
     QHash<QString, GeneratorInfo> m_loadedGenerators;
     Generator *m_generator;
@@ -312,6 +614,16 @@ public:
 
     Scripter *m_scripter;
 
+    // the form fields by id and by name and their pages, and the order and
+    // dependencies of their calculations; built on first use by
+    // buildFormIndex(), until the pages or their fields change
+    bool m_formIndexValid;
+    QHash<int, QVector<FormField *>> m_formFieldsById;
+    QHash<QString, FormField *> m_formFieldsByName;
+    QHash<const FormField *, int> m_formFieldPages;
+    QVector<int> m_formCalculateOrder;
+    FormDependencies m_formDependencies;
+
     ArchiveData *m_archiveData;
     QString m_archivedFileName;
 
@@ -325,6 +637,15 @@ public:
 
     bool m_annotationEditingEnabled;
     bool m_annotationBeingModified; // is an annotation currently being moved or resized?
+    // where the generator last drew the externally drawn annotations, so
+    // that refreshing after a change can skip the rest of the page
+    QHash<const Annotation *, NormalizedRect> m_annotationRenderedRects;
+    // annotation batches being run, the pages they changed and what of them to
+    // render again, a null rect being all of it
+    int m_annotationBatchDepth;
+    QSet<int> m_annotationBatchPages;
+    QHash<int, NormalizedRect> m_annotationBatchRefreshes;
+    QHash<int, AnnotationChanges> m_annotationChanges;
     bool m_metadataLoadingCompleted;
 
     QUndoStack *m_undoStack;
@@ -338,6 +659,18 @@ public:
     bool m_docdataMigrationNeeded;
 
     synctex_scanner_p m_synctex_scanner;
+    // building the scanner parses the whole synctex file, see loadSynctexScanner()
+    QThreadPool m_synctexPool;
+    QMutex m_synctexMutex;
+    // the scanner or the pdfsync points of the last build that finished, not taken yet
+    synctex_scanner_p m_synctexLoadedScanner;
+    QVector<pdfsyncpoint> m_synctexLoadedPoints;
+    int m_synctexGeneration;
+    bool m_synctexLoading;
+    QString m_synctexDocFile;
+
+    // the documents of the process share one memory budget, see setActive()
+    bool m_active;
 
     QString m_openError;
 
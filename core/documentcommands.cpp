@@ -19,10 +19,19 @@
 
 #include <KLocalizedString>
 
+#include <QDomDocument>
+
 namespace Okular
 {
+// what a command holds besides its data, in bytes
+static const int kUndoCommandSize = 256;
+
 void moveViewportIfBoundingRectNotFullyVisible(Okular::NormalizedRect boundingRect, DocumentPrivate *docPriv, int pageNumber)
 {
+    // the annotations of a batch are all over the place, the view stays
+    if (docPriv->m_annotationBatchDepth > 0)
+        return;
+
     const Rotation pageRotation = docPriv->m_parent->page(pageNumber)->rotation();
     const QTransform rotationMatrix = Okular::buildRotationMatrix(pageRotation);
     boundingRect.transform(rotationMatrix);
@@ -53,8 +62,54 @@ Okular::NormalizedRect buildBoundingRectangleForButtons(const QList<Okular::Form
     return boundingRect;
 }
 
-AddAnnotationCommand::AddAnnotationCommand(Okular::DocumentPrivate *docPriv, Okular::Annotation *annotation, int pageNumber)
+qulonglong OkularUndoCommand::memoryUsage() const
+{
+    return kUndoCommandSize;
+}
+
+AnnotationBatchCommand::AnnotationBatchCommand(Okular::DocumentPrivate *docPriv, const QString &text)
     : m_docPriv(docPriv)
+{
+    setText(text);
+}
+
+void AnnotationBatchCommand::undo()
+{
+    m_docPriv->beginAnnotationBatch();
+    QUndoCommand::undo();
+    m_docPriv->endAnnotationBatch();
+}
+
+void AnnotationBatchCommand::redo()
+{
+    m_docPriv->beginAnnotationBatch();
+    QUndoCommand::redo();
+    m_docPriv->endAnnotationBatch();
+}
+
+bool AnnotationBatchCommand::refreshInternalPageReferences(const QVector<Okular::Page *> &newPagesVector)
+{
+    for (int i = 0; i < childCount(); ++i) {
+        OkularUndoCommand *ouc = dynamic_cast<OkularUndoCommand *>(const_cast<QUndoCommand *>(child(i)));
+        if (!ouc || !ouc->refreshInternalPageReferences(newPagesVector))
+            return false;
+    }
+    return true;
+}
+
+qulonglong AnnotationBatchCommand::memoryUsage() const
+{
+    qulonglong bytes = kUndoCommandSize;
+    for (int i = 0; i < childCount(); ++i) {
+        if (const OkularUndoCommand *ouc = dynamic_cast<const OkularUndoCommand *>(child(i)))
+            bytes += ouc->memoryUsage();
+    }
+    return bytes;
+}
+
+AddAnnotationCommand::AddAnnotationCommand(Okular::DocumentPrivate *docPriv, Okular::Annotation *annotation, int pageNumber, QUndoCommand *parent)
+    : OkularUndoCommand(parent)
+    , m_docPriv(docPriv)
     , m_annotation(annotation)
     , m_pageNumber(pageNumber)
     , m_done(false)
@@ -98,8 +153,9 @@ bool AddAnnotationCommand::refreshInternalPageReferences(const QVector<Okular::P
     return true;
 }
 
-RemoveAnnotationCommand::RemoveAnnotationCommand(Okular::DocumentPrivate *doc, Okular::Annotation *annotation, int pageNumber)
-    : m_docPriv(doc)
+RemoveAnnotationCommand::RemoveAnnotationCommand(Okular::DocumentPrivate *doc, Okular::Annotation *annotation, int pageNumber, QUndoCommand *parent)
+    : OkularUndoCommand(parent)
+    , m_docPriv(doc)
     , m_annotation(annotation)
     , m_pageNumber(pageNumber)
     , m_done(false)
@@ -147,26 +203,64 @@ ModifyAnnotationPropertiesCommand::ModifyAnnotationPropertiesCommand(DocumentPri
     : m_docPriv(docPriv)
     , m_annotation(annotation)
     , m_pageNumber(pageNumber)
-    , m_prevProperties(oldProperties)
-    , m_newProperties(newProperties)
+    , m_prevProperties(pack(oldProperties))
+    , m_newProperties(pack(newProperties))
 {
     setText(i18nc("Modify an annotation's internal properties (Color, line-width, etc.)", "modify annotation properties"));
 }
 
+QByteArray ModifyAnnotationPropertiesCommand::pack(const QDomNode &properties)
+{
+    QDomDocument doc;
+    doc.appendChild(doc.importNode(properties, true));
+    return qCompress(doc.toByteArray(-1));
+}
+
+QDomNode ModifyAnnotationPropertiesCommand::unpack(const QByteArray &properties)
+{
+    QDomDocument doc;
+    doc.setContent(qUncompress(properties));
+    return doc.documentElement();
+}
+
 void ModifyAnnotationPropertiesCommand::undo()
 {
     moveViewportIfBoundingRectNotFullyVisible(m_annotation->boundingRectangle(), m_docPriv, m_pageNumber);
-    m_annotation->setAnnotationProperties(m_prevProperties);
+    m_annotation->setAnnotationProperties(unpack(m_prevProperties));
     m_docPriv->performModifyPageAnnotation(m_pageNumber, m_annotation, true);
 }
 
 void ModifyAnnotationPropertiesCommand::redo()
 {
     moveViewportIfBoundingRectNotFullyVisible(m_annotation->boundingRectangle(), m_docPriv, m_pageNumber);
-    m_annotation->setAnnotationProperties(m_newProperties);
+    m_annotation->setAnnotationProperties(unpack(m_newProperties));
     m_docPriv->performModifyPageAnnotation(m_pageNumber, m_annotation, true);
 }
 
+int ModifyAnnotationPropertiesCommand::id() const
+{
+    return 6;
+}
+
+bool ModifyAnnotationPropertiesCommand::mergeWith(const QUndoCommand *uc)
+{
+    ModifyAnnotationPropertiesCommand *mpc = (ModifyAnnotationPropertiesCommand *)uc;
+    // every modification stays its own step, but when one starts where this
+    // one ended the two hold a single copy of the properties in between
+    if (m_annotation == mpc->m_annotation && m_newProperties == mpc->m_prevProperties)
+        mpc->m_prevProperties = m_newProperties;
+    return false;
+}
+
+qulonglong ModifyAnnotationPropertiesCommand::memoryUsage() const
+{
+    // a shared copy is counted by the command it is shared with
+    qulonglong bytes = kUndoCommandSize + m_prevProperties.capacity();
+    if (m_newProperties.isDetached())
+        bytes += m_newProperties.capacity();
+    return bytes;
+}
+
 bool ModifyAnnotationPropertiesCommand::refreshInternalPageReferences(const QVector<Okular::Page *> &newPagesVector)
 {
     // Same reason for not unconditionally updating m_annotation, the annotation pointer can be stored in an add/Remove command
@@ -355,9 +449,30 @@ bool EditTextCommand::mergeWith(const QUndoCommand *uc)
         m_newCursorPos = euc->m_newCursorPos;
         return true;
     }
+
+    // backspacing over characters typed in this same run fixes a typo, it is
+    // part of the insertion
+    if (m_newContents == euc->m_prevContents && m_newCursorPos == euc->m_prevCursorPos && m_editType == CharInsert && euc->m_editType == CharBackspace && euc->m_newCursorPos >= m_prevCursorPos) {
+        m_newContents = euc->m_newContents;
+        m_newCursorPos = euc->m_newCursorPos;
+        return true;
+    }
+
+    // not merged, but the text in between is held once
+    if (m_newContents == euc->m_prevContents)
+        euc->m_prevContents = m_newContents;
     return false;
 }
 
+qulonglong EditTextCommand::memoryUsage() const
+{
+    // a shared copy is counted by the command it is shared with
+    qulonglong bytes = kUndoCommandSize + m_prevContents.capacity() * sizeof(QChar);
+    if (m_newContents.isDetached())
+        bytes += m_newContents.capacity() * sizeof(QChar);
+    return bytes;
+}
+
 QString EditTextCommand::oldContentsLeftOfCursor()
 {
     return m_prevContents.left(m_prevCursorPos);
@@ -440,7 +555,7 @@ void EditFormTextCommand::undo()
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     m_form->setText(m_prevContents);
     emit m_docPriv->m_parent->formTextChangedByUndoRedo(m_pageNumber, m_form, m_prevContents, m_prevCursorPos, m_prevAnchorPos);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form->fullyQualifiedName()});
 }
 
 void EditFormTextCommand::redo()
@@ -448,7 +563,7 @@ void EditFormTextCommand::redo()
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     m_form->setText(m_newContents);
     emit m_docPriv->m_parent->formTextChangedByUndoRedo(m_pageNumber, m_form, m_newContents, m_newCursorPos, m_newCursorPos);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form->fullyQualifiedName()});
 }
 
 int EditFormTextCommand::id() const
@@ -489,7 +604,7 @@ void EditFormListCommand::undo()
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     m_form->setCurrentChoices(m_prevChoices);
     emit m_docPriv->m_parent->formListChangedByUndoRedo(m_pageNumber, m_form, m_prevChoices);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form->fullyQualifiedName()});
 }
 
 void EditFormListCommand::redo()
@@ -497,7 +612,7 @@ void EditFormListCommand::redo()
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     m_form->setCurrentChoices(m_newChoices);
     emit m_docPriv->m_parent->formListChangedByUndoRedo(m_pageNumber, m_form, m_newChoices);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form->fullyQualifiedName()});
 }
 
 bool EditFormListCommand::refreshInternalPageReferences(const QVector<Page *> &newPagesVector)
@@ -538,7 +653,7 @@ void EditFormComboCommand::undo()
     }
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     emit m_docPriv->m_parent->formComboChangedByUndoRedo(m_pageNumber, m_form, m_prevContents, m_prevCursorPos, m_prevAnchorPos);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form->fullyQualifiedName()});
 }
 
 void EditFormComboCommand::redo()
@@ -550,7 +665,7 @@ void EditFormComboCommand::redo()
     }
     moveViewportIfBoundingRectNotFullyVisible(m_form->rect(), m_docPriv, m_pageNumber);
     emit m_docPriv->m_parent->formComboChangedByUndoRedo(m_pageNumber, m_form, m_newContents, m_newCursorPos, m_newCursorPos);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, {m_form->fullyQualifiedName()});
 }
 
 int EditFormComboCommand::id() const
@@ -605,7 +720,7 @@ void EditFormButtonsCommand::undo()
     Okular::NormalizedRect boundingRect = buildBoundingRectangleForButtons(m_formButtons);
     moveViewportIfBoundingRectNotFullyVisible(boundingRect, m_docPriv, m_pageNumber);
     emit m_docPriv->m_parent->formButtonsChangedByUndoRedo(m_pageNumber, m_formButtons);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, formButtonNames());
 }
 
 void EditFormButtonsCommand::redo()
@@ -620,7 +735,7 @@ void EditFormButtonsCommand::redo()
     Okular::NormalizedRect boundingRect = buildBoundingRectangleForButtons(m_formButtons);
     moveViewportIfBoundingRectNotFullyVisible(boundingRect, m_docPriv, m_pageNumber);
     emit m_docPriv->m_parent->formButtonsChangedByUndoRedo(m_pageNumber, m_formButtons);
-    m_docPriv->notifyFormChanges(m_pageNumber);
+    m_docPriv->notifyFormChanges(m_pageNumber, formButtonNames());
 }
 
 bool EditFormButtonsCommand::refreshInternalPageReferences(const QVector<Okular::Page *> &newPagesVector)
@@ -644,4 +759,13 @@ void EditFormButtonsCommand::clearFormButtonStates()
     }
 }
 
+QSet<QString> EditFormButtonsCommand::formButtonNames() const
+{
+    QSet<QString> names;
+    for (const FormFieldButton *formButton : qAsConst(m_formButtons)) {
+        names.insert(formButton->fullyQualifiedName());
+    }
+    return names;
+}
+
 }
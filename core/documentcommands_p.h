@@ -10,7 +10,9 @@
 #ifndef _OKULAR_DOCUMENT_COMMANDS_P_H_
 #define _OKULAR_DOCUMENT_COMMANDS_P_H_
 
+#include <QByteArray>
 #include <QDomNode>
+#include <QSet>
 #include <QUndoCommand>
 
 #include "area.h"
@@ -28,13 +30,42 @@ class Page;
 class OkularUndoCommand : public QUndoCommand
 {
 public:
+    explicit OkularUndoCommand(QUndoCommand *parent = nullptr)
+        : QUndoCommand(parent)
+    {
+    }
+
     virtual bool refreshInternalPageReferences(const QVector<Okular::Page *> &newPagesVector) = 0;
+
+    /**
+     * Returns an approximation of the memory the command holds, in bytes.
+     */
+    virtual qulonglong memoryUsage() const;
+};
+
+/**
+ * Adds or removes many annotations as one step, its children; the generator
+ * and the observers hear about the pages once, when all are done.
+ */
+class AnnotationBatchCommand : public OkularUndoCommand
+{
+public:
+    AnnotationBatchCommand(Okular::DocumentPrivate *docPriv, const QString &text);
+
+    void undo() override;
+    void redo() override;
+
+    bool refreshInternalPageReferences(const QVector<Okular::Page *> &newPagesVector) override;
+    qulonglong memoryUsage() const override;
+
+private:
+    Okular::DocumentPrivate *m_docPriv;
 };
 
 class AddAnnotationCommand : public OkularUndoCommand
 {
 public:
-    AddAnnotationCommand(Okular::DocumentPrivate *docPriv, Okular::Annotation *annotation, int pageNumber);
+    AddAnnotationCommand(Okular::DocumentPrivate *docPriv, Okular::Annotation *annotation, int pageNumber, QUndoCommand *parent = nullptr);
 
     ~AddAnnotationCommand() override;
 
@@ -54,7 +85,7 @@ private:
 class RemoveAnnotationCommand : public OkularUndoCommand
 {
 public:
-    RemoveAnnotationCommand(Okular::DocumentPrivate *doc, Okular::Annotation *annotation, int pageNumber);
+    RemoveAnnotationCommand(Okular::DocumentPrivate *doc, Okular::Annotation *annotation, int pageNumber, QUndoCommand *parent = nullptr);
     ~RemoveAnnotationCommand() override;
     void undo() override;
     void redo() override;
@@ -75,15 +106,22 @@ public:
 
     void undo() override;
     void redo() override;
+    int id() const override;
+    bool mergeWith(const QUndoCommand *uc) override;
 
     bool refreshInternalPageReferences(const QVector<Okular::Page *> &newPagesVector) override;
+    qulonglong memoryUsage() const override;
 
 private:
+    static QByteArray pack(const QDomNode &properties);
+    static QDomNode unpack(const QByteArray &properties);
+
     Okular::DocumentPrivate *m_docPriv;
     Okular::Annotation *m_annotation;
     int m_pageNumber;
-    QDomNode m_prevProperties;
-    QDomNode m_newProperties;
+    // the properties as compressed XML, a DOM tree is many times bigger
+    QByteArray m_prevProperties;
+    QByteArray m_newProperties;
 };
 
 class TranslateAnnotationCommand : public OkularUndoCommand
@@ -138,6 +176,8 @@ public:
     int id() const override = 0;
     bool mergeWith(const QUndoCommand *uc) override;
 
+    qulonglong memoryUsage() const override;
+
 private:
     enum EditType {
         CharBackspace, ///< Edit made up of one or more single character backspace operations
@@ -245,6 +285,7 @@ public:
 
 private:
     void clearFormButtonStates();
+    QSet<QString> formButtonNames() const;
 
 private:
     Okular::DocumentPrivate *m_docPriv;
@@ -0,0 +1,244 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "documentinfofile_p.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QSaveFile>
+
+#include "debug_p.h"
+
+using namespace Okular;
+
+static const quint32 kFileMagic = 0x4f4b4444; // "OKDD"
+// bump when the records change in a way older versions can't read, old files are then dropped
+static const quint32 kFileVersion = 1;
+static const qint64 kHeaderSize = 2 * sizeof(quint32);
+// how much of the file may be records that don't count any more before it is written again
+static const qint64 kMinDeadSize = 64 * 1024;
+// how QDataStream writes a null QByteArray
+static const quint32 kRemovedSize = 0xffffffff;
+
+DocumentInfoFile::DocumentInfoFile()
+    : m_map(nullptr)
+    , m_mapSize(0)
+    , m_validSize(0)
+    , m_deadSize(0)
+    , m_binary(false)
+{
+}
+
+DocumentInfoFile::~DocumentInfoFile()
+{
+    close();
+}
+
+int DocumentInfoFile::streamVersion()
+{
+    return QDataStream::Qt_5_12;
+}
+
+bool DocumentInfoFile::open(const QString &fileName)
+{
+    close();
+    m_fileName = fileName;
+
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadOnly) || m_file.size() < kHeaderSize)
+        return false;
+
+    m_mapSize = m_file.size();
+    m_map = m_file.map(0, m_mapSize);
+    if (!m_map) {
+        qCWarning(OkularCoreDebug) << "Could not map the docdata file" << fileName;
+        close();
+        return false;
+    }
+
+    QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(m_map), m_mapSize);
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::ReadOnly);
+    QDataStream stream(&buffer);
+    stream.setVersion(streamVersion());
+
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if (magic != kFileMagic || version != kFileVersion) {
+        // an XML file, or one newer versions wrote
+        close();
+        return false;
+    }
+
+    m_binary = true;
+    m_validSize = kHeaderSize;
+    while (!stream.atEnd()) {
+        quint32 type = 0;
+        QString key;
+        quint32 size = 0;
+        stream >> type >> key >> size;
+        if (stream.status() != QDataStream::Ok)
+            break;
+
+        const qint64 dataOffset = buffer.pos();
+        if (size != kRemovedSize && dataOffset + size > m_mapSize)
+            break;
+
+        const Key k(int(type), key);
+        const QHash<Key, Location>::const_iterator old = m_index.constFind(k);
+        if (old != m_index.constEnd())
+            m_deadSize += old->recordSize;
+
+        if (size == kRemovedSize) {
+            m_index.remove(k);
+            m_deadSize += dataOffset - m_validSize;
+        } else {
+            buffer.seek(dataOffset + size);
+            m_index.insert(k, {dataOffset, int(size), int(dataOffset + size - m_validSize)});
+        }
+        m_validSize = buffer.pos();
+    }
+
+    if (m_validSize < m_mapSize)
+        qCWarning(OkularCoreDebug) << "Dropping the incomplete end of the docdata file" << fileName;
+    return true;
+}
+
+void DocumentInfoFile::close()
+{
+    if (m_map)
+        m_file.unmap(m_map);
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_file.close();
+    m_validSize = 0;
+    m_deadSize = 0;
+    m_binary = false;
+    m_index.clear();
+    m_pending.clear();
+}
+
+QByteArray DocumentInfoFile::data(const Location &location) const
+{
+    return QByteArray(reinterpret_cast<const char *>(m_map + location.dataOffset), location.dataSize);
+}
+
+QByteArray DocumentInfoFile::record(RecordType type, const QString &key) const
+{
+    const Key k(type, key);
+    const QHash<Key, QByteArray>::const_iterator pending = m_pending.constFind(k);
+    if (pending != m_pending.constEnd())
+        return *pending;
+
+    const QHash<Key, Location>::const_iterator it = m_index.constFind(k);
+    return it != m_index.constEnd() ? data(*it) : QByteArray();
+}
+
+QStringList DocumentInfoFile::keys(RecordType type) const
+{
+    QStringList result;
+    for (QHash<Key, Location>::const_iterator it = m_index.constBegin(); it != m_index.constEnd(); ++it) {
+        if (it.key().first == type && !m_pending.contains(it.key()))
+            result.append(it.key().second);
+    }
+    for (QHash<Key, QByteArray>::const_iterator it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+        if (it.key().first == type && !it->isNull())
+            result.append(it.key().second);
+    }
+    return result;
+}
+
+void DocumentInfoFile::setRecord(RecordType type, const QString &key, const QByteArray &data)
+{
+    // an empty record is still there
+    m_pending.insert(Key(type, key), data.isNull() ? QByteArray("") : data);
+}
+
+void DocumentInfoFile::removeRecord(RecordType type, const QString &key)
+{
+    m_pending.insert(Key(type, key), QByteArray());
+}
+
+QByteArray DocumentInfoFile::encodeRecord(const Key &key, const QByteArray &data)
+{
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream.setVersion(streamVersion());
+    stream << quint32(key.first) << key.second << data;
+    return record;
+}
+
+bool DocumentInfoFile::commit()
+{
+    // only what is not in the file already
+    QHash<Key, QByteArray> changes;
+    for (QHash<Key, QByteArray>::const_iterator it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+        const QHash<Key, Location>::const_iterator old = m_index.constFind(it.key());
+        if (old == m_index.constEnd() ? !it->isNull() : it->isNull() || data(*old) != *it)
+            changes.insert(it.key(), *it);
+    }
+    if (m_binary && changes.isEmpty() && m_validSize == m_mapSize) {
+        close();
+        return true;
+    }
+
+    qint64 liveSize = 0;
+    for (const Location &location : qAsConst(m_index))
+        liveSize += location.recordSize;
+    qint64 deadSize = m_deadSize;
+    QByteArray appended;
+    for (QHash<Key, QByteArray>::const_iterator it = changes.constBegin(); it != changes.constEnd(); ++it) {
+        const QHash<Key, Location>::const_iterator old = m_index.constFind(it.key());
+        if (old != m_index.constEnd()) {
+            liveSize -= old->recordSize;
+            deadSize += old->recordSize;
+        }
+        const QByteArray record = encodeRecord(it.key(), *it);
+        if (it->isNull())
+            deadSize += record.size();
+        else
+            liveSize += record.size();
+        appended += record;
+    }
+
+    if (!m_binary || deadSize > qMax(liveSize, kMinDeadSize))
+        return rewrite(changes);
+
+    const qint64 validSize = m_validSize;
+    close();
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadWrite) || !file.resize(validSize) || !file.seek(validSize) || file.write(appended) != appended.size() || !file.flush()) {
+        qCWarning(OkularCoreDebug) << "Could not write to the docdata file" << m_fileName;
+        return false;
+    }
+    return true;
+}
+
+bool DocumentInfoFile::rewrite(const QHash<Key, QByteArray> &changes)
+{
+    QByteArray content;
+    {
+        QDataStream stream(&content, QIODevice::WriteOnly);
+        stream.setVersion(streamVersion());
+        stream << kFileMagic << kFileVersion;
+    }
+    for (QHash<Key, Location>::const_iterator it = m_index.constBegin(); it != m_index.constEnd(); ++it) {
+        if (!changes.contains(it.key()))
+            content += encodeRecord(it.key(), data(*it));
+    }
+    for (QHash<Key, QByteArray>::const_iterator it = changes.constBegin(); it != changes.constEnd(); ++it) {
+        if (!it->isNull())
+            content += encodeRecord(it.key(), *it);
+    }
+    close();
+
+    QSaveFile file(m_fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(content) != content.size() || !file.commit()) {
+        qCWarning(OkularCoreDebug) << "Could not write the docdata file" << m_fileName;
+        return false;
+    }
+    return true;
+}
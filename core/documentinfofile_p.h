@@ -0,0 +1,111 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_DOCUMENTINFOFILE_P_H_
+#define _OKULAR_DOCUMENTINFOFILE_P_H_
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * The docdata file of a document in the binary format: a log of records,
+ * each a type, a key and the data of one piece of the document info.
+ *
+ * Opening the file only goes through the headers of the records, the data
+ * of a record is read from the mapped file when asked for. Committing
+ * appends the records that changed, a record of the same type and key
+ * later in the file wins over the earlier ones; the file is written again
+ * from scratch when most of it is records that don't count any more, or
+ * when it was not in the binary format, like the XML docdata files of
+ * previous versions. A record cut short by a crash is dropped with the
+ * ones after it.
+ */
+class OKULARCORE_EXPORT DocumentInfoFile
+{
+public:
+    enum RecordType {
+        RotationRecord = 1,
+        HistoryRecord,
+        ViewRecord,           // the key is the name of the view
+        FontsRecord,
+        BoundingBoxesRecord,  // what the bounding boxes of the pages were computed for
+        PageBoundingBoxRecord // the key is the number of the page
+    };
+
+    DocumentInfoFile();
+    ~DocumentInfoFile();
+
+    /**
+     * Opens @p fileName, returns whether it is a docdata file in the binary
+     * format. Records can be set even if it is not.
+     */
+    bool open(const QString &fileName);
+
+    void close();
+
+    /**
+     * The data of the record of @p type and @p key, null if there is none.
+     */
+    QByteArray record(RecordType type, const QString &key = QString()) const;
+
+    /**
+     * The keys of the records of @p type.
+     */
+    QStringList keys(RecordType type) const;
+
+    void setRecord(RecordType type, const QString &key, const QByteArray &data);
+    void removeRecord(RecordType type, const QString &key = QString());
+
+    /**
+     * Writes the records set or removed since the file was opened, and
+     * closes it. Returns whether it worked.
+     */
+    bool commit();
+
+    /**
+     * The version of QDataStream the data of the records is in.
+     */
+    static int streamVersion();
+
+private:
+    Q_DISABLE_COPY(DocumentInfoFile)
+
+    typedef QPair<int, QString> Key;
+    struct Location {
+        qint64 dataOffset;
+        int dataSize;
+        int recordSize;
+    };
+
+    static QByteArray encodeRecord(const Key &key, const QByteArray &data);
+    QByteArray data(const Location &location) const;
+    bool rewrite(const QHash<Key, QByteArray> &changes);
+
+    QString m_fileName;
+    QFile m_file;
+    uchar *m_map;
+    qint64 m_mapSize;
+    // where the last complete record ends
+    qint64 m_validSize;
+    // the bytes of the records that lost to later ones
+    qint64 m_deadSize;
+    bool m_binary;
+    QHash<Key, Location> m_index;
+    // null data removes the record
+    QHash<Key, QByteArray> m_pending;
+};
+
+}
+
+#endif
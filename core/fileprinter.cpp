@@ -11,6 +11,7 @@
 
 #include <QFile>
 #include <QFileInfo>
+#include <QIODevice>
 #include <QLabel>
 #include <QPrintEngine>
 #include <QShowEvent>
@@ -27,6 +28,58 @@
 
 using namespace Okular;
 
+// what can wait in the input of the print command before the document waits for it to read
+static const qint64 kSpoolerBufferSize = 1024 * 1024;
+
+namespace
+{
+// forwards what the document writes to the input of the print command, so
+// the printer starts with the first pages and no file is written
+class SpoolerDevice : public QIODevice
+{
+public:
+    explicit SpoolerDevice(QProcess *process)
+        : m_process(process)
+    {
+        open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+    }
+
+protected:
+    qint64 readData(char *, qint64) override
+    {
+        return -1;
+    }
+
+    qint64 writeData(const char *data, qint64 len) override
+    {
+        if (m_process->write(data, len) != len)
+            return -1;
+        while (m_process->bytesToWrite() > kSpoolerBufferSize) {
+            // false if the command exited
+            if (!m_process->waitForBytesWritten(-1))
+                return -1;
+        }
+        return len;
+    }
+
+private:
+    QProcess *m_process;
+};
+}
+
+// the print command, the CUPS version of lpr if available
+static QString printCommand()
+{
+    // Some distros name the CUPS version of lpr as lpr-cups or lpr.cups so try those first
+    // before default to lpr, or failing that to lp
+    const QStringList commands = {QStringLiteral("lpr-cups"), QStringLiteral("lpr.cups"), QStringLiteral("lpr"), QStringLiteral("lp")};
+    for (const QString &command : commands) {
+        if (!QStandardPaths::findExecutable(command).isEmpty())
+            return command;
+    }
+    return QString();
+}
+
 int FilePrinter::printFile(QPrinter &printer,
                            const QString file, // NOLINT(performance-unnecessary-value-param) clazy:exclude=function-args-by-ref TODO when BIC changes are allowed
                            QPrinter::Orientation documentOrientation,
@@ -126,19 +179,9 @@ int FilePrinter::doPrintFiles(QPrinter &printer, QStringList fileList, FileDelet
 
     } else { // Print to a printer via lpr command
 
-        // Decide what executable to use to print with, need the CUPS version of lpr if available
-        // Some distros name the CUPS version of lpr as lpr-cups or lpr.cups so try those first
-        // before default to lpr, or failing that to lp
-
-        if (!QStandardPaths::findExecutable(QStringLiteral("lpr-cups")).isEmpty()) {
-            exe = QStringLiteral("lpr-cups");
-        } else if (!QStandardPaths::findExecutable(QStringLiteral("lpr.cups")).isEmpty()) {
-            exe = QStringLiteral("lpr.cups");
-        } else if (!QStandardPaths::findExecutable(QStringLiteral("lpr")).isEmpty()) {
-            exe = QStringLiteral("lpr");
-        } else if (!QStandardPaths::findExecutable(QStringLiteral("lp")).isEmpty()) {
-            exe = QStringLiteral("lp");
-        } else {
+        // Decide what executable to use to print with
+        exe = printCommand();
+        if (exe.isEmpty()) {
             return -9;
         }
 
@@ -152,6 +195,55 @@ int FilePrinter::doPrintFiles(QPrinter &printer, QStringList fileList, FileDelet
     return ret;
 }
 
+int FilePrinter::printStream(QPrinter &printer, const std::function<bool(QIODevice *)> &writeDocument, QPrinter::Orientation documentOrientation, const QString &pageRange, ScaleMode scaleMode)
+{
+    if (printer.printerState() == QPrinter::Aborted || printer.printerState() == QPrinter::Error) {
+        return -6;
+    }
+
+    // the conversions to other formats need a file
+    if (!printer.outputFileName().isEmpty()) {
+        return -5;
+    }
+
+    const QString exe = printCommand();
+    if (exe.isEmpty()) {
+        return -9;
+    }
+
+    // with no file the commands print their input
+    FilePrinter fp;
+    const QStringList argList = fp.printArguments(printer, ApplicationDeletesFiles, ApplicationSelectsPages, cupsAvailable(), pageRange, exe, documentOrientation, scaleMode);
+    qCDebug(OkularCoreDebug) << "Executing" << exe << "with arguments" << argList << "and the document on its input";
+
+    // the same codes as KProcess::execute()
+    KProcess process;
+    process.setProgram(exe, argList);
+    process.start();
+    if (!process.waitForStarted()) {
+        return -2;
+    }
+
+    bool written;
+    {
+        SpoolerDevice device(&process);
+        written = writeDocument(&device);
+    }
+    if (!written) {
+        // the job is cancelled rather than printed half
+        process.kill();
+        process.waitForFinished(-1);
+        return -3;
+    }
+
+    process.closeWriteChannel();
+    process.waitForFinished(-1);
+    if (process.exitStatus() != QProcess::NormalExit) {
+        return -1;
+    }
+    return process.exitCode();
+}
+
 QList<int> FilePrinter::pageList(QPrinter &printer, int lastPage, const QList<int> &selectedPageList)
 {
     return pageList(printer, lastPage, 0, selectedPageList);
@@ -306,6 +398,9 @@ Generator::PrintError FilePrinter::printError(int c)
         case -2:
             pe = Generator::PrintingProcessStartPrintError;
             break;
+        case -3:
+            pe = Generator::FileConversionPrintError;
+            break;
         case -5:
             pe = Generator::PrintToFilePrintError;
             break;
@@ -15,9 +15,12 @@
 #include <QPrinter>
 #include <QString>
 
+#include <functional>
+
 #include "generator.h"
 #include "okularcore_export.h"
 
+class QIODevice;
 class QSize;
 
 namespace Okular
@@ -100,6 +103,33 @@ public:
                          PageSelectPolicy pageSelectPolicy = FilePrinter::ApplicationSelectsPages,
                          const QString &pageRange = QString());
 
+    /** Print a document as it is written, using the settings in QPrinter
+     *
+     *  Like printFile(), but @p writeDocument writes the document, e.g. a
+     *  PostScript one, to the input of the print command, so the printer
+     *  starts with the first pages and no temporary file is needed.
+     *  The application selects the pages, and printing to a file is not
+     *  supported: use printFile() when the printer has an output file name.
+     *
+     * @param printer the print settings to use
+     * @param writeDocument writes the document to the device it is given, returns whether it succeeded
+     * @param documentOrientation the orientation stored in the document itself
+     * @param pageRange page range to print if the user chooses Selection in Print Dialog
+     * @param scaleMode scale mode to use
+     *
+     * @returns Returns exit code:
+     *          -9 if lpr not found
+     *          -6 if invalid printer state
+     *          -5 if the printer has an output file name
+     *          -3 if writeDocument failed, the job is then cancelled
+     *          -2 if the KProcess could not be started
+     *          -1 if the KProcess crashed
+     *          otherwise the KProcess exit code
+     *
+     * @since 21.12
+     */
+    static int printStream(QPrinter &printer, const std::function<bool(QIODevice *)> &writeDocument, QPrinter::Orientation documentOrientation, const QString &pageRange, ScaleMode scaleMode);
+
     /** Return the list of pages selected by the user in the Print Dialog
      *
      * @param printer the print settings to use
@@ -0,0 +1,122 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "formdependencies_p.h"
+
+#include <QRegularExpression>
+
+using namespace Okular;
+
+void FormDependencies::addCalculation(int id, const QString &script)
+{
+    bool readsAll = false;
+    const QSet<QString> names = readFieldNames(script, &readsAll);
+    if (readsAll)
+        m_readsAll.insert(id);
+    else
+        m_reads[id] += names;
+}
+
+void FormDependencies::addOpaqueCalculation(int id)
+{
+    m_readsAll.insert(id);
+}
+
+void FormDependencies::clear()
+{
+    m_reads.clear();
+    m_readsAll.clear();
+}
+
+bool FormDependencies::reads(int id, const QSet<QString> &names) const
+{
+    if (m_readsAll.contains(id))
+        return true;
+
+    const QHash<int, QSet<QString>>::const_iterator it = m_reads.constFind(id);
+    if (it == m_reads.constEnd())
+        return false;
+
+    for (const QString &name : names) {
+        // getField("total") reads "total.1" too
+        for (int end = name.length(); end > 0; end = name.lastIndexOf(QLatin1Char('.'), end - 1)) {
+            if (it->contains(name.left(end)))
+                return true;
+        }
+    }
+    return false;
+}
+
+QSet<QString> FormDependencies::readFieldNames(const QString &script, bool *readsAll)
+{
+    static const QRegularExpression literal(QStringLiteral("\"((?:[^\"\\\\\\n]|\\\\.)*)\"|'((?:[^'\\\\\\n]|\\\\.)*)'"));
+    static const QRegularExpression escape(QStringLiteral("\\\\(.)"));
+    static const QRegularExpression getField(QStringLiteral("\\bgetField\\s*\\("));
+    static const QRegularExpression getFieldByLiteral(QStringLiteral("\\bgetField\\s*\\(\\s*(?:\"(?:[^\"\\\\\\n]|\\\\.)*\"|'(?:[^'\\\\\\n]|\\\\.)*')\\s*\\)"));
+    static const QRegularExpression allFields(QStringLiteral("\\b(?:getNthFieldName|numFields)\\b"));
+    static const QRegularExpression call(QStringLiteral("(?<![\\w$.])([A-Za-z_$][\\w$]*)\\s*\\("));
+    static const QRegularExpression functionDefinition(QStringLiteral("\\bfunction\\s+([A-Za-z_$][\\w$]*)"));
+    // the functions that don't read fields other than the ones they are given,
+    // and the keywords followed by a parenthesis
+    static const QSet<QString> knownFunctions = {QStringLiteral("getField"),
+                                                 QStringLiteral("AFSimple_Calculate"),
+                                                 QStringLiteral("AFNumber_Format"),
+                                                 QStringLiteral("AFNumber_Keystroke"),
+                                                 QStringLiteral("AFMakeNumber"),
+                                                 QStringLiteral("AFTime_Format"),
+                                                 QStringLiteral("AFTime_Keystroke"),
+                                                 QStringLiteral("AFSpecial_Format"),
+                                                 QStringLiteral("AFSpecial_Keystroke"),
+                                                 QStringLiteral("Array"),
+                                                 QStringLiteral("Boolean"),
+                                                 QStringLiteral("Date"),
+                                                 QStringLiteral("Number"),
+                                                 QStringLiteral("String"),
+                                                 QStringLiteral("isFinite"),
+                                                 QStringLiteral("isNaN"),
+                                                 QStringLiteral("parseFloat"),
+                                                 QStringLiteral("parseInt"),
+                                                 QStringLiteral("catch"),
+                                                 QStringLiteral("for"),
+                                                 QStringLiteral("function"),
+                                                 QStringLiteral("if"),
+                                                 QStringLiteral("return"),
+                                                 QStringLiteral("switch"),
+                                                 QStringLiteral("typeof"),
+                                                 QStringLiteral("while")};
+
+    int getFieldCalls = 0;
+    for (QRegularExpressionMatchIterator it = getField.globalMatch(script); it.hasNext(); it.next())
+        ++getFieldCalls;
+    int getFieldByLiteralCalls = 0;
+    for (QRegularExpressionMatchIterator it = getFieldByLiteral.globalMatch(script); it.hasNext(); it.next())
+        ++getFieldByLiteralCalls;
+    *readsAll = getFieldCalls != getFieldByLiteralCalls || allFields.match(script).hasMatch();
+
+    // a function of the document scripts may read any field, the ones the
+    // script defines are read with it
+    if (!*readsAll) {
+        QString code = script;
+        code.replace(literal, QStringLiteral("\"\""));
+        QSet<QString> defined;
+        for (QRegularExpressionMatchIterator it = functionDefinition.globalMatch(code); it.hasNext();)
+            defined.insert(it.next().captured(1));
+        for (QRegularExpressionMatchIterator it = call.globalMatch(code); it.hasNext() && !*readsAll;) {
+            const QString function = it.next().captured(1);
+            *readsAll = !knownFunctions.contains(function) && !defined.contains(function);
+        }
+    }
+
+    QSet<QString> names;
+    for (QRegularExpressionMatchIterator it = literal.globalMatch(script); it.hasNext();) {
+        const QRegularExpressionMatch match = it.next();
+        QString name = match.captured(match.lastCapturedIndex());
+        name.replace(escape, QStringLiteral("\\1"));
+        if (!name.isEmpty())
+            names.insert(name);
+    }
+    return names;
+}
@@ -0,0 +1,63 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_FORMDEPENDENCIES_P_H_
+#define _OKULAR_FORMDEPENDENCIES_P_H_
+
+#include <QHash>
+#include <QSet>
+#include <QString>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * Which fields the calculate scripts of the form fields read, so a change
+ * only recalculates the fields that depend on it.
+ *
+ * The scripts are not run to find out: the string literals of a script are
+ * taken as the names of the fields it reads, the way Doc.getField() and
+ * AFSimple_Calculate() are given them. That can only be too many fields. A
+ * script that asks for a field by a name it builds, goes through all of
+ * them, or calls a function of the document scripts, reads all the fields.
+ */
+class OKULARCORE_EXPORT FormDependencies
+{
+public:
+    /**
+     * Adds the calculate @p script of the field @p id.
+     */
+    void addCalculation(int id, const QString &script);
+
+    /**
+     * Adds a calculation of the field @p id that is not a script, and may
+     * read any field.
+     */
+    void addOpaqueCalculation(int id);
+
+    void clear();
+
+    /**
+     * Whether the calculation of the field @p id reads one of the fields
+     * called @p names, or one of their children.
+     */
+    bool reads(int id, const QSet<QString> &names) const;
+
+    /**
+     * The names of the fields @p script reads; @p readsAll is set when that
+     * can't be told.
+     */
+    static QSet<QString> readFieldNames(const QString &script, bool *readsAll);
+
+private:
+    QHash<int, QSet<QString>> m_reads;
+    QSet<int> m_readsAll;
+};
+
+}
+
+#endif
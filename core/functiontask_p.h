@@ -0,0 +1,40 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_FUNCTIONTASK_P_H_
+#define _OKULAR_FUNCTIONTASK_P_H_
+
+#include <QRunnable>
+
+#include <functional>
+
+namespace Okular
+{
+/**
+ * Runs a function in a QThreadPool, like QRunnable::create() of Qt 5.15.
+ *
+ * The pool deletes it once the function returned.
+ */
+class FunctionTask : public QRunnable
+{
+public:
+    explicit FunctionTask(const std::function<void()> &function)
+        : m_function(function)
+    {
+    }
+
+    void run() override
+    {
+        m_function();
+    }
+
+private:
+    std::function<void()> m_function;
+};
+
+}
+
+#endif
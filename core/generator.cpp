@@ -27,19 +27,33 @@
 #endif
 
 #include "document_p.h"
+#include "imagebufferpool_p.h"
 #include "page.h"
 #include "page_p.h"
+#include "renderstatistics_p.h"
+#include "requesttrace_p.h"
 #include "textpage.h"
 #include "utils.h"
+#include "utils_p.h"
 
 using namespace Okular;
 
+// 4 partial updates per second, like the default of the configuration
+static const int defaultPartialUpdateInterval = 250;
+
+// the longest a thread waits for more urgent work before it competes for
+// the userMutex() anyway, in ms
+static const int userMutexWorkAging = 250;
+
+// see UserMutexWorkScope
+static thread_local int currentUserMutexWork = GeneratorPrivate::VisiblePixmapWork;
+
 GeneratorPrivate::GeneratorPrivate()
     : m_document(nullptr)
-    , mPixmapGenerationThread(nullptr)
-    , mTextPageGenerationThread(nullptr)
-    , mPixmapReady(true)
-    , mTextPageReady(true)
+    , mPixmapGenerationsRunning(0)
+    , m_userMutexTraceStart(0)
+    , m_userMutexSite(Generator::OtherSite)
+    , m_userMutexWaiters()
     , m_closing(false)
     , m_closingLoop(nullptr)
     , m_dpi(72.0, 72.0)
@@ -49,56 +63,68 @@ GeneratorPrivate::GeneratorPrivate()
 
 GeneratorPrivate::~GeneratorPrivate()
 {
-    if (mPixmapGenerationThread)
-        mPixmapGenerationThread->wait();
-
-    delete mPixmapGenerationThread;
-
-    if (mTextPageGenerationThread)
-        mTextPageGenerationThread->wait();
-
-    delete mTextPageGenerationThread;
+    for (PixmapGenerationThread *thread : qAsConst(mPixmapGenerationThreads)) {
+        thread->wait();
+        delete thread;
+    }
 }
 
 PixmapGenerationThread *GeneratorPrivate::pixmapGenerationThread()
 {
-    if (mPixmapGenerationThread)
-        return mPixmapGenerationThread;
+    for (PixmapGenerationThread *thread : qAsConst(mPixmapGenerationThreads)) {
+        if (thread->isIdle())
+            return thread;
+    }
+
+    if (mPixmapGenerationThreads.count() >= maxPixmapGenerationThreads())
+        return nullptr;
 
     Q_Q(Generator);
-    mPixmapGenerationThread = new PixmapGenerationThread(q);
+    PixmapGenerationThread *thread = new PixmapGenerationThread(q);
     QObject::connect(
-        mPixmapGenerationThread, &PixmapGenerationThread::finished, q, [this] { pixmapGenerationFinished(); }, Qt::QueuedConnection);
+        thread, &PixmapGenerationThread::imageReady, q, [this, thread](int index) { pixmapGenerationFinished(thread, index); }, Qt::QueuedConnection);
+    QObject::connect(
+        thread, &PixmapGenerationThread::finished, q, [this, thread] { pixmapGenerationFinished(thread, thread->count() - 1); }, Qt::QueuedConnection);
+    mPixmapGenerationThreads.append(thread);
 
-    return mPixmapGenerationThread;
+    return thread;
 }
 
-TextPageGenerationThread *GeneratorPrivate::textPageGenerationThread()
+bool GeneratorPrivate::pageHasText(const Generator *generator, const Page *page)
 {
-    if (mTextPageGenerationThread)
-        return mTextPageGenerationThread;
+    const QVariant hasText = generator->metaData(QStringLiteral("PageHasText"), page->number());
+    return !hasText.isValid() || hasText.toBool();
+}
 
-    Q_Q(Generator);
-    mTextPageGenerationThread = new TextPageGenerationThread(q);
-    QObject::connect(
-        mTextPageGenerationThread, &TextPageGenerationThread::finished, q, [this] { textpageGenerationFinished(); }, Qt::QueuedConnection);
+int GeneratorPrivate::maxPixmapGenerationThreads() const
+{
+    Q_Q(const Generator);
+    if (!q->hasFeature(Generator::Threaded) || !q->hasFeature(Generator::ParallelRendering))
+        return 1;
 
-    return mTextPageGenerationThread;
+    // Leave one core for the GUI thread and one for the text page extraction,
+    // more workers than that only fight for the CPU and for memory bandwidth
+    return qBound(1, QThread::idealThreadCount() - 2, 8);
 }
 
-void GeneratorPrivate::pixmapGenerationFinished()
+void GeneratorPrivate::pixmapGenerationFinished(PixmapGenerationThread *thread, int index)
 {
     Q_Q(Generator);
-    PixmapRequest *request = mPixmapGenerationThread->request();
-    const QImage &img = mPixmapGenerationThread->image();
-    mPixmapGenerationThread->endGeneration();
+    PixmapRequest *request = thread->request(index);
+    RequestTrace::Scope trace("pixmapGenerationFinished", RequestTrace::requestArgs(request));
+    QImage img = thread->image(index);
+    const bool calcBoundingBox = thread->calcBoundingBox(index);
+    const NormalizedRect boundingBox = thread->boundingBox(index);
+    // the last request of a batch frees the thread
+    if (index == thread->count() - 1)
+        thread->endGeneration();
 
     QMutexLocker locker(threadsLock());
 
     if (m_closing) {
-        mPixmapReady = true;
+        --mPixmapGenerationsRunning;
         delete request;
-        if (mTextPageReady) {
+        if (mPixmapGenerationsRunning == 0) {
             locker.unlock();
             m_closingLoop->quit();
         }
@@ -106,48 +132,21 @@ void GeneratorPrivate::pixmapGenerationFinished()
     }
 
     if (!request->shouldAbortRender()) {
-        request->page()->setPixmap(request->observer(), new QPixmap(QPixmap::fromImage(img)), request->normalizedRect());
+        // the request lets go of its render meanwhile, so it can be converted in place
+        PixmapRequestPrivate *requestPrivate = PixmapRequestPrivate::get(request);
+        requestPrivate->mResultImage = QImage();
+        request->page()->setPixmap(request->observer(), pixmapFromRender(&img), request->normalizedRect());
+        requestPrivate->mResultImage = img;
         const int pageNumber = request->page()->number();
 
-        if (mPixmapGenerationThread->calcBoundingBox())
-            q->updatePageBoundingBox(pageNumber, mPixmapGenerationThread->boundingBox());
-    } else {
-        // Cancel the text page generation too if it's still running
-        if (mTextPageGenerationThread && mTextPageGenerationThread->isRunning()) {
-            mTextPageGenerationThread->abortExtraction();
-            mTextPageGenerationThread->wait();
-        }
+        if (calcBoundingBox)
+            q->updatePageBoundingBox(pageNumber, boundingBox);
     }
 
-    mPixmapReady = true;
+    --mPixmapGenerationsRunning;
     q->signalPixmapRequestDone(request);
 }
 
-void GeneratorPrivate::textpageGenerationFinished()
-{
-    Q_Q(Generator);
-    Page *page = mTextPageGenerationThread->page();
-    mTextPageGenerationThread->endGeneration();
-
-    QMutexLocker locker(threadsLock());
-    mTextPageReady = true;
-
-    if (m_closing) {
-        delete mTextPageGenerationThread->textPage();
-        if (mPixmapReady) {
-            locker.unlock();
-            m_closingLoop->quit();
-        }
-        return;
-    }
-
-    if (mTextPageGenerationThread->textPage()) {
-        TextPage *tp = mTextPageGenerationThread->textPage();
-        page->setTextPage(tp);
-        q->signalTextGenerationDone(page, tp);
-    }
-}
-
 QMutex *GeneratorPrivate::threadsLock()
 {
     return &m_threadsMutex;
@@ -217,7 +216,7 @@ bool Generator::closeDocument()
     d->m_closing = true;
 
     d->threadsLock()->lock();
-    if (!(d->mPixmapReady && d->mTextPageReady)) {
+    if (d->mPixmapGenerationsRunning != 0) {
         QEventLoop loop;
         d->m_closingLoop = &loop;
 
@@ -240,7 +239,7 @@ bool Generator::closeDocument()
 bool Generator::canGeneratePixmap() const
 {
     Q_D(const Generator);
-    return d->mPixmapReady;
+    return d->mPixmapGenerationsRunning < d->maxPixmapGenerationThreads();
 }
 
 bool Generator::canSign() const
@@ -261,62 +260,121 @@ CertificateStore *Generator::certificateStore() const
 void Generator::generatePixmap(PixmapRequest *request)
 {
     Q_D(Generator);
-    d->mPixmapReady = false;
+    ++d->mPixmapGenerationsRunning;
 
-    const bool calcBoundingBox = !request->isTile() && !request->page()->isBoundingBoxKnown();
+    // a preview is not precise enough, the real request will do it
+    const bool calcBoundingBox = !request->isTile() && !request->preview() && PagePrivate::get(request->page())->needsBoundingBox();
 
     if (request->asynchronous() && hasFeature(Threaded)) {
-        if (d->textPageGenerationThread()->isFinished() && !canGenerateTextPage()) {
-            // It can happen that the text generation has already finished but
-            // mTextPageReady is still false because textpageGenerationFinished
-            // didn't have time to run, if so queue ourselves
+        PixmapGenerationThread *pixmapThread = d->pixmapGenerationThread();
+        if (!pixmapThread) {
+            // All the workers are busy, i.e. a worker finished but
+            // pixmapGenerationFinished didn't have time to run, if so queue ourselves
+            --d->mPixmapGenerationsRunning;
             QTimer::singleShot(0, this, [this, request] { generatePixmap(request); });
             return;
         }
 
-        /**
-         * We create the text page for every page that is visible to the
-         * user, so he can use the text extraction tools without a delay.
-         */
-        if (hasFeature(TextExtraction) && !request->page()->hasTextPage() && canGenerateTextPage() && !d->m_closing) {
-            d->mTextPageReady = false;
-            d->textPageGenerationThread()->setPage(request->page());
-
-            // dummy is used as a way to make sure the lambda gets disconnected each time it is executed
-            // since not all the times the pixmap generation thread starts we want the text generation thread to also start
-            QObject *dummy = new QObject();
-            connect(d_ptr->pixmapGenerationThread(), &QThread::started, dummy, [this, dummy] {
-                delete dummy;
-                d_ptr->textPageGenerationThread()->startGeneration();
-            });
-        }
-        // pixmap generation thread must be started *after* connect(), else we may miss the start signal and get lock-ups (see bug 396137)
-        d->pixmapGenerationThread()->startGeneration(request, calcBoundingBox);
+        pixmapThread->startGeneration(request, calcBoundingBox);
 
         return;
     }
 
-    const QImage &img = image(request);
-    request->page()->setPixmap(request->observer(), new QPixmap(QPixmap::fromImage(img)), request->normalizedRect());
+    QImage img;
+    {
+        RequestTrace::Scope trace("Generator::image", RequestTrace::requestArgs(request));
+        QElapsedTimer imageTimer;
+        imageTimer.start();
+        img = image(request);
+        PixmapRequestPrivate::get(request)->mImageTime = imageTimer.elapsed();
+    }
+    request->page()->setPixmap(request->observer(), pixmapFromRender(&img), request->normalizedRect());
+    PixmapRequestPrivate::get(request)->mResultImage = img;
     const int pageNumber = request->page()->number();
 
-    d->mPixmapReady = true;
+    --d->mPixmapGenerationsRunning;
 
     signalPixmapRequestDone(request);
     if (calcBoundingBox)
-        updatePageBoundingBox(pageNumber, Utils::imageBoundingBox(&img));
+        updatePageBoundingBox(pageNumber, renderedPageBoundingBox(&img));
+}
+
+void Generator::generatePixmaps(const QVector<PixmapRequest *> &requests)
+{
+    Q_D(Generator);
+
+    // a batch only goes to a single worker if all of it can go there
+    bool threaded = requests.count() > 1 && hasFeature(Threaded);
+    for (const PixmapRequest *request : requests)
+        threaded = threaded && request->asynchronous();
+    PixmapGenerationThread *pixmapThread = threaded ? d->pixmapGenerationThread() : nullptr;
+    if (!pixmapThread) {
+        for (PixmapRequest *request : requests)
+            generatePixmap(request);
+        return;
+    }
+
+    QVector<bool> calcBoundingBox;
+    calcBoundingBox.reserve(requests.count());
+    for (const PixmapRequest *request : requests)
+        calcBoundingBox << (!request->isTile() && !request->preview() && PagePrivate::get(request->page())->needsBoundingBox());
+
+    d->mPixmapGenerationsRunning += requests.count();
+    pixmapThread->startGeneration(requests, calcBoundingBox);
+}
+
+QImage Generator::embeddedThumbnail(const Page *page) const
+{
+    Q_UNUSED(page)
+    return QImage();
+}
+
+bool Generator::loadPageData(Page *page)
+{
+    Q_UNUSED(page)
+    return false;
+}
+
+bool Generator::loadMorePages(QVector<Page *> &pagesVector)
+{
+    Q_UNUSED(pagesVector)
+    return false;
+}
+
+bool Generator::reloadDocument(const QString &fileName, QVector<Page *> &pagesVector, QVector<int> &changedPages)
+{
+    Q_UNUSED(fileName)
+    Q_UNUSED(pagesVector)
+    Q_UNUSED(changedPages)
+    return false;
+}
+
+void Generator::pageModified(int page)
+{
+    Q_UNUSED(page)
+}
+
+qulonglong Generator::cachedMemory() const
+{
+    return 0;
+}
+
+qulonglong Generator::freeCachedMemory(qulonglong bytes)
+{
+    Q_UNUSED(bytes)
+    return 0;
 }
 
 bool Generator::canGenerateTextPage() const
 {
-    Q_D(const Generator);
-    return d->mTextPageReady;
+    // the document schedules the text pages, see Document::requestTextPage()
+    return true;
 }
 
 void Generator::generateTextPage(Page *page)
 {
     TextRequest treq(page);
-    TextPage *tp = textPage(&treq);
+    TextPage *tp = GeneratorPrivate::pageHasText(this, page) ? textPage(&treq) : new TextPage;
     page->setTextPage(tp);
     signalTextGenerationDone(page, tp);
 }
@@ -344,6 +402,11 @@ const DocumentSynopsis *Generator::generateDocumentSynopsis()
     return nullptr;
 }
 
+const Outline *Generator::generateOutline()
+{
+    return nullptr;
+}
+
 FontInfo::List Generator::fontsForPage(int)
 {
     return FontInfo::List();
@@ -430,6 +493,9 @@ void Generator::signalPixmapRequestDone(PixmapRequest *request)
     else {
         delete request;
     }
+
+    if (canGeneratePixmap())
+        emit pixmapGenerationReady();
 }
 
 void Generator::signalTextGenerationDone(Page *page, TextPage *textPage)
@@ -447,7 +513,23 @@ void Generator::signalPartialPixmapRequest(PixmapRequest *request, const QImage
         return;
 
     PagePrivate *pagePrivate = PagePrivate::get(request->page());
-    pagePrivate->setPixmap(request->observer(), new QPixmap(QPixmap::fromImage(image)), request->normalizedRect(), true /* isPartialPixmap */);
+    QImage partialImage = image;
+    pagePrivate->setPixmap(request->observer(), pixmapFromRender(&partialImage), request->normalizedRect(), true /* isPartialPixmap */);
+
+    const int pageNumber = request->page()->number();
+    request->observer()->notifyPageChanged(pageNumber, Okular::DocumentObserver::Pixmap);
+}
+
+void Generator::signalPartialPixmapRequest(PixmapRequest *request, const QImage &image, const QRect &dirtyRect)
+{
+    if (request->shouldAbortRender())
+        return;
+
+    PagePrivate *pagePrivate = PagePrivate::get(request->page());
+    if (!pagePrivate->updatePartialPixmap(request->observer(), image, dirtyRect)) {
+        signalPartialPixmapRequest(request, image);
+        return;
+    }
 
     const int pageNumber = request->page()->number();
     request->observer()->notifyPageChanged(pageNumber, Okular::DocumentObserver::Pixmap);
@@ -504,6 +586,185 @@ QMutex *Generator::userMutex() const
     return &d->m_mutex;
 }
 
+// the names of the sites in RenderStatistics::userMutexStatistics
+static const char *const userMutexSiteNames[] = {"render", "text", "fonts", "annotations", "metadata", "probe", "other"};
+
+static QByteArray userMutexSiteArgs(int site)
+{
+    return QByteArrayLiteral("\"site\":\"") + userMutexSiteNames[site] + '"';
+}
+
+void Generator::lockUserMutex(UserMutexSite site) const
+{
+    Q_D(const Generator);
+    qint64 waitTime = 0;
+    // it is not taken from under more urgent work that waits for it
+    const int work = GeneratorPrivate::userMutexWork();
+    const bool contended = d->hasMoreUrgentUserMutexWaiters(work) || !d->m_mutex.tryLock();
+    if (contended) {
+        const qint64 traceStart = RequestTrace::isEnabled() ? RequestTrace::now() : 0;
+        QElapsedTimer wait;
+        wait.start();
+        d->waitForUserMutexTurn(work);
+        d->m_mutex.lock();
+        d->endUserMutexWait(work);
+        waitTime = wait.nsecsElapsed() / 1000;
+        RequestTrace::complete("userMutex wait", traceStart, waitTime, userMutexSiteArgs(site));
+    }
+
+    // ours now
+    d->m_userMutexSite = site;
+    d->m_userMutexTraceStart = RequestTrace::isEnabled() ? RequestTrace::now() : 0;
+    d->m_userMutexHoldTimer.start();
+
+    QMutexLocker locker(&d->m_userMutexStatisticsMutex);
+    LockStatisticsPrivate *statistics = LockStatisticsPrivate::get(d->m_userMutexStatistics[site]);
+    ++statistics->locks;
+    if (contended) {
+        ++statistics->contendedLocks;
+        statistics->waitTime += waitTime;
+        statistics->maxWaitTime = qMax(statistics->maxWaitTime, waitTime);
+    }
+}
+
+bool Generator::tryLockUserMutex(UserMutexSite site) const
+{
+    Q_D(const Generator);
+    if (!d->m_mutex.tryLock()) {
+        QMutexLocker locker(&d->m_userMutexStatisticsMutex);
+        ++LockStatisticsPrivate::get(d->m_userMutexStatistics[site])->failedTryLocks;
+        return false;
+    }
+
+    d->m_userMutexSite = site;
+    d->m_userMutexTraceStart = RequestTrace::isEnabled() ? RequestTrace::now() : 0;
+    d->m_userMutexHoldTimer.start();
+
+    QMutexLocker locker(&d->m_userMutexStatisticsMutex);
+    ++LockStatisticsPrivate::get(d->m_userMutexStatistics[site])->locks;
+    return true;
+}
+
+void Generator::unlockUserMutex() const
+{
+    Q_D(const Generator);
+    // read before somebody else takes it
+    const int site = d->m_userMutexSite;
+    const qint64 traceStart = d->m_userMutexTraceStart;
+    const qint64 holdTime = d->m_userMutexHoldTimer.nsecsElapsed() / 1000;
+    d->m_mutex.unlock();
+
+    RequestTrace::complete("userMutex held", traceStart, holdTime, userMutexSiteArgs(site));
+
+    QMutexLocker locker(&d->m_userMutexStatisticsMutex);
+    LockStatisticsPrivate *statistics = LockStatisticsPrivate::get(d->m_userMutexStatistics[site]);
+    statistics->holdTime += holdTime;
+    statistics->maxHoldTime = qMax(statistics->maxHoldTime, holdTime);
+}
+
+int GeneratorPrivate::userMutexWork()
+{
+    return currentUserMutexWork;
+}
+
+bool GeneratorPrivate::hasMoreUrgentUserMutexWaiters(int work) const
+{
+    if (work == VisiblePixmapWork)
+        return false;
+
+    QMutexLocker locker(&m_userMutexTurnMutex);
+    for (int w = 0; w < work; ++w) {
+        if (m_userMutexWaiters[w] > 0)
+            return true;
+    }
+    return false;
+}
+
+void GeneratorPrivate::waitForUserMutexTurn(int work) const
+{
+    QMutexLocker locker(&m_userMutexTurnMutex);
+    ++m_userMutexWaiters[work];
+
+    QElapsedTimer waited;
+    waited.start();
+    for (;;) {
+        bool moreUrgent = false;
+        for (int w = 0; w < work && !moreUrgent; ++w)
+            moreUrgent = m_userMutexWaiters[w] > 0;
+        const qint64 left = userMutexWorkAging - waited.elapsed();
+        if (!moreUrgent || left <= 0)
+            return;
+        m_userMutexTurn.wait(&m_userMutexTurnMutex, left);
+    }
+}
+
+void GeneratorPrivate::endUserMutexWait(int work) const
+{
+    QMutexLocker locker(&m_userMutexTurnMutex);
+    --m_userMutexWaiters[work];
+    // the less urgent ones may go now
+    m_userMutexTurn.wakeAll();
+}
+
+UserMutexWorkScope::UserMutexWorkScope(int work)
+    : m_previousWork(currentUserMutexWork)
+{
+    currentUserMutexWork = work;
+}
+
+UserMutexWorkScope::~UserMutexWorkScope()
+{
+    currentUserMutexWork = m_previousWork;
+}
+
+QMap<QString, LockStatistics> GeneratorPrivate::userMutexStatistics() const
+{
+    QMap<QString, LockStatistics> statistics;
+    QMutexLocker locker(&m_userMutexStatisticsMutex);
+    for (int site = 0; site <= Generator::OtherSite; ++site) {
+        if (m_userMutexStatistics[site].locks() > 0 || m_userMutexStatistics[site].failedTryLocks() > 0)
+            statistics.insert(QString::fromLatin1(userMutexSiteNames[site]), m_userMutexStatistics[site]);
+    }
+    return statistics;
+}
+
+void GeneratorPrivate::resetUserMutexStatistics()
+{
+    QMutexLocker locker(&m_userMutexStatisticsMutex);
+    for (LockStatistics &statistics : m_userMutexStatistics)
+        statistics = LockStatistics();
+}
+
+UserMutexLocker::UserMutexLocker(const Generator *generator, Generator::UserMutexSite site)
+    : m_generator(generator)
+    , m_site(site)
+    , m_locked(true)
+{
+    m_generator->lockUserMutex(m_site);
+}
+
+UserMutexLocker::~UserMutexLocker()
+{
+    if (m_locked)
+        m_generator->unlockUserMutex();
+}
+
+void UserMutexLocker::unlock()
+{
+    if (!m_locked)
+        return;
+    m_locked = false;
+    m_generator->unlockUserMutex();
+}
+
+void UserMutexLocker::relock()
+{
+    if (m_locked)
+        return;
+    m_locked = true;
+    m_generator->lockUserMutex(m_site);
+}
+
 void Generator::updatePageBoundingBox(int page, const NormalizedRect &boundingBox)
 {
     Q_D(Generator);
@@ -584,6 +845,9 @@ PixmapRequest::PixmapRequest(DocumentObserver *observer, int pageNumber, int wid
     d->mTile = false;
     d->mNormalizedRect = NormalizedRect();
     d->mPartialUpdatesWanted = false;
+    d->mWarmStart = false;
+    d->mImageTime = -1;
+    d->mPartialUpdateInterval = defaultPartialUpdateInterval;
     d->mShouldAbortRender = 0;
 }
 
@@ -627,6 +891,21 @@ bool PixmapRequest::preload() const
     return d->mFeatures & Preload;
 }
 
+bool PixmapRequest::progressive() const
+{
+    return d->mFeatures & Progressive;
+}
+
+bool PixmapRequest::preview() const
+{
+    return d->mFeatures & Preview;
+}
+
+bool PixmapRequest::draft() const
+{
+    return d->mFeatures & Draft;
+}
+
 Page *PixmapRequest::page() const
 {
     return d->mPage;
@@ -642,6 +921,17 @@ bool PixmapRequest::isTile() const
     return d->mTile;
 }
 
+QImage::Format PixmapRequest::imageFormat()
+{
+    return nativeImageFormat();
+}
+
+QImage PixmapRequest::renderTarget() const
+{
+    const QSize size = d->mTile ? d->mNormalizedRect.geometry(d->mWidth, d->mHeight).size() : QSize(d->mWidth, d->mHeight);
+    return ImageBufferPool::instance()->image(size, imageFormat());
+}
+
 void PixmapRequest::setNormalizedRect(const NormalizedRect &rect)
 {
     if (d->mNormalizedRect == rect)
@@ -665,6 +955,16 @@ bool PixmapRequest::partialUpdatesWanted() const
     return d->mPartialUpdatesWanted;
 }
 
+void PixmapRequest::setPartialUpdateInterval(int msecs)
+{
+    d->mPartialUpdateInterval = qMax(0, msecs);
+}
+
+int PixmapRequest::partialUpdateInterval() const
+{
+    return d->mPartialUpdateInterval;
+}
+
 bool PixmapRequest::shouldAbortRender() const
 {
     return d->mShouldAbortRender != 0;
@@ -803,9 +1103,13 @@ QDebug operator<<(QDebug str, const Okular::PixmapRequest &req)
     str << "- tile:" << (req.isTile() ? "true" : "false");
     str << "- rect:" << req.normalizedRect();
     str << "- preload:" << (req.preload() ? "true" : "false");
+    str << "- preview:" << (req.preview() ? "true" : "false");
+    str << "- draft:" << (req.draft() ? "true" : "false");
     str << "- partialUpdates:" << (req.partialUpdatesWanted() ? "true" : "false");
     str << "- shouldAbort:" << (req.shouldAbortRender() ? "true" : "false");
     str << "- force:" << (reqPriv->mForce ? "true" : "false");
+    if (reqPriv->mQueuedTimer.isValid())
+        str << "- queued for:" << reqPriv->mQueuedTimer.elapsed() << "ms";
     return str;
 }
 
@@ -57,6 +57,7 @@ class TextPage;
 class TextRequest;
 class TextRequestPrivate;
 class NormalizedRect;
+class Outline;
 
 /* Note: on contents generation and asynchronous queries.
  * Many observers may want to request data synchronously or asynchronously.
@@ -187,8 +188,12 @@ private:
 class OKULARCORE_EXPORT Generator : public QObject
 {
     /// @cond PRIVATE
+    friend class FontExtractionThread;
     friend class PixmapGenerationThread;
-    friend class TextPageGenerationThread;
+    friend class TextPageTask;
+    friend class BoundingBoxTask;
+    friend class TextSearchTask;
+    friend class UserMutexLocker;
     /// @endcond
 
     Q_OBJECT
@@ -209,7 +214,13 @@ public:
         PrintToFile,       ///< Whether the Generator supports export to PDF & PS through the Print Dialog
         TiledRendering,    ///< Whether the Generator can render tiles @since 0.16 (KDE 4.10)
         SwapBackingFile,   ///< Whether the Generator can hot-swap the file it's reading from @since 1.3
-        SupportsCancelling ///< Whether the Generator can cancel requests @since 1.4
+        SupportsCancelling, ///< Whether the Generator can cancel requests @since 1.4
+        ParallelRendering,  ///< Whether the Generator can run several image() calls at the same time from different threads, only honored together with @ref Threaded @since 21.12
+        BatchedRendering,   ///< Whether the Generator wants small requests (e.g. thumbnails) several at a time through generatePixmaps() @since 21.12
+        EmbeddedThumbnails, ///< Whether the Generator can give the thumbnails the document has for its pages through embeddedThumbnail() @since 21.12
+        LazyPageData,       ///< Whether the Generator leaves out part of the data of the pages when opening the document, to fill it in with loadPageData() @since 21.12
+        IncrementalPages,   ///< Whether the Generator may only give the first pages when opening the document, the others coming through loadMorePages() @since 21.12
+        InPlaceReload       ///< Whether the Generator can take the new contents of the file it has open through reloadDocument() @since 21.12
     };
 
     /**
@@ -302,6 +313,9 @@ public:
     /**
      * This method returns whether the generator is ready to
      * handle a new pixmap request.
+     *
+     * For generators with the @ref ParallelRendering feature this keeps
+     * returning true until all the render workers are busy.
      */
     virtual bool canGeneratePixmap() const;
 
@@ -317,6 +331,127 @@ public:
      */
     virtual void generatePixmap(PixmapRequest *request);
 
+    /**
+     * This method can be called to trigger the generation of all the pixmaps
+     * described by @p requests. It is only called with more than one request
+     * if the generator has the @ref BatchedRendering feature.
+     *
+     * Each request is finished on its own, as soon as its pixmap is ready,
+     * with signalPixmapRequestDone().
+     *
+     * The default implementation renders them one after the other calling
+     * image() in the same thread if the generator is @ref Threaded and all the
+     * requests are asynchronous, and calls generatePixmap() for each request
+     * otherwise. Reimplement it to share work between the pages of a batch.
+     *
+     * @since 21.12
+     */
+    virtual void generatePixmaps(const QVector<PixmapRequest *> &requests);
+
+    /**
+     * Returns the thumbnail the document has for @p page, oriented like the
+     * page is rendered without rotation, or a null image. Called for the
+     * requests with the @ref PixmapRequest::EmbeddedThumbnail feature, if the
+     * generator has the @ref EmbeddedThumbnails feature, once per page: in a
+     * thread of its own if the generator is @ref Threaded, so it must be
+     * thread safe like image(), in the main thread otherwise.
+     *
+     * The default implementation returns a null image.
+     *
+     * @since 21.12
+     */
+    virtual QImage embeddedThumbnail(const Page *page) const;
+
+    /**
+     * Fills in the data of @p page the generator left out when opening the
+     * document, like its annotations, transition or page actions, unless it
+     * did already. Called in the main thread before the page is rendered or
+     * becomes the current page, and for all the pages while the generator
+     * is idle, if the generator has the @ref LazyPageData feature.
+     *
+     * The page can also get its real size here, through Page::setSize()
+     * and Page::setOrientation(), if the generator gave it a provisional
+     * one; the document lays the pages out again then.
+     *
+     * This runs in the main thread, so it must not wait for data that is
+     * not there yet: the generator can return false and emit
+     * pageDataReady() once it is, the document calls loadPageData() for
+     * the page again then.
+     *
+     * Returns whether the page got new data. The default implementation
+     * does nothing and returns false.
+     *
+     * @since 21.12
+     */
+    virtual bool loadPageData(Page *page);
+
+    /**
+     * Appends the next pages of the document to @p pagesVector, which has
+     * the pages there are so far, if the generator has the
+     * @ref IncrementalPages feature and did not give all of them when
+     * opening the document. Called in the main thread while it is idle,
+     * one slice of a few tens of milliseconds at a time, until it returns
+     * false; the generator locks the userMutex() itself if rendering uses
+     * what it works on.
+     *
+     * Returns whether more pages are to come. The default implementation
+     * does nothing and returns false.
+     *
+     * @since 21.12
+     */
+    virtual bool loadMorePages(QVector<Page *> &pagesVector);
+
+    /**
+     * Reads again the file @p fileName the document was opened from, after
+     * it changed on disk, if the generator has the @ref InPlaceReload
+     * feature. Called in the main thread with no request pending.
+     *
+     * The pages of @p pagesVector are kept and updated, pages are appended
+     * to it or removed from its end (the document deletes those) if their
+     * number changed. The numbers of the kept pages whose contents changed
+     * are added to @p changedPages, only those are rendered again; the
+     * generator can also find out later that a kept page changed, and emit
+     * pageContentsChanged() for it.
+     *
+     * All the pages are given, even with the @ref IncrementalPages feature.
+     * Returns false if the document has to be closed and opened again
+     * instead, @p pagesVector must then be as it was. The default
+     * implementation does nothing and returns false.
+     *
+     * @since 21.12
+     */
+    virtual bool reloadDocument(const QString &fileName, QVector<Page *> &pagesVector, QVector<int> &changedPages);
+
+    /**
+     * Called in the main thread when the annotations or the form fields of
+     * the page @p page were changed, so the page no longer looks like it
+     * does in the file. The default implementation does nothing.
+     *
+     * @since 21.12
+     */
+    virtual void pageModified(int page);
+
+    /**
+     * Returns how many bytes the generator keeps in its own caches of
+     * rendered pages, so the document counts them with its pixmaps against
+     * the configured memory usage. The default implementation returns 0.
+     *
+     * Called in the main thread, it should not wait for renders to finish.
+     *
+     * @since 21.12
+     */
+    virtual qulonglong cachedMemory() const;
+
+    /**
+     * Called in the main thread when the document needs memory back: the
+     * generator should drop at least @p bytes of its caches of rendered pages,
+     * the least recently used first, and return how many bytes it freed. The
+     * default implementation frees nothing and returns 0.
+     *
+     * @since 21.12
+     */
+    virtual qulonglong freeCachedMemory(qulonglong bytes);
+
     /**
      * This method returns whether the generator is ready to
      * handle a new text page request.
@@ -346,6 +481,18 @@ public:
      */
     virtual const DocumentSynopsis *generateDocumentSynopsis();
 
+    /**
+     * Returns the 'table of content' of the document in the compact form of
+     * an Outline, or 0 if it is not available that way, in which case the
+     * document makes one from generateDocumentSynopsis().
+     *
+     * Generators with big tables of contents should build one instead of the
+     * synopsis; the outline is what the table of contents panel shows.
+     *
+     * @since 21.12
+     */
+    virtual const Outline *generateOutline();
+
     /**
      * Returns the 'list of embedded fonts' object of the specified \p page
      * of the document.
@@ -420,9 +567,31 @@ public:
         InvalidPageSizePrintError ///< @since 0.18.2 (KDE 4.12.2)
     };
 
+    /**
+     * The kinds of call sites that lock the userMutex() through
+     * lockUserMutex(), counted separately in RenderStatistics::userMutexStatistics.
+     *
+     * @since 21.12
+     */
+    enum UserMutexSite {
+        RenderSite,      ///< Rendering of pixmaps and thumbnails
+        TextSite,        ///< Text extraction
+        FontsSite,       ///< Font scanning and font data
+        AnnotationsSite, ///< Edits of the annotations of the document
+        MetaDataSite,    ///< Document information, table of contents, metadata
+        ProbeSite,       ///< Checks of whether the mutex is free, unlocked right away
+        OtherSite        ///< Anything else
+    };
+
     /**
      * This method returns the meta data of the given @p key with the given @p option
      * of the document.
+     *
+     * For the "PageHasText" key, with the page number as @p option, a generator
+     * can tell cheaply (e.g. from the fonts the page uses) whether the page can
+     * have any text, so that textPage() is not called for the pages that cannot,
+     * like scanned ones; they get an empty text page instead. It is asked right
+     * before textPage(), in the same thread, and an invalid QVariant means it may.
      */
     virtual QVariant metaData(const QString &key, const QVariant &option) const;
 
@@ -494,10 +663,52 @@ Q_SIGNALS:
      */
     void notice(const QString &message, int duration);
 
+    /**
+     * This signal is emitted when the generator is ready to handle a new
+     * pixmap request again, i.e. when canGeneratePixmap() went back to true.
+     *
+     * signalPixmapRequestDone() emits it, generators that reimplement
+     * canGeneratePixmap() and can become ready in any other way must
+     * emit it themselves.
+     *
+     * @since 21.12
+     */
+    void pixmapGenerationReady();
+
+    /**
+     * This signal should be emitted when the SignatureInfo of signature form
+     * fields of page @p page changed, e.g. when their certificates were
+     * verified in the background; the observers are notified with the
+     * DocumentObserver::SignatureInfo flag.
+     *
+     * @since 21.12
+     */
+    void signatureInfoChanged(int page);
+
+    /**
+     * This signal should be emitted when the data that loadPageData()
+     * could not fill in for page @p page without waiting is there; the
+     * document calls loadPageData() for it again.
+     *
+     * @since 21.12
+     */
+    void pageDataReady(int page);
+
+    /**
+     * This signal should be emitted when the generator finds out after
+     * reloadDocument() that the contents of the kept page @p page changed
+     * too; the document drops its pixmaps and text and renders it again.
+     *
+     * @since 21.12
+     */
+    void pageContentsChanged(int page);
+
 protected:
     /**
      * This method must be called when the pixmap request triggered by generatePixmap()
      * has been finished.
+     *
+     * It also emits pixmapGenerationReady().
      */
     void signalPixmapRequestDone(PixmapRequest *request);
 
@@ -576,6 +787,31 @@ protected:
      */
     QMutex *userMutex() const;
 
+    /**
+     * Locks the userMutex(), counting how long it waited for it, and how
+     * long it holds it until unlockUserMutex(), under @p site in
+     * Document::renderStatistics() and in the request trace.
+     *
+     * @see UserMutexLocker
+     * @since 21.12
+     */
+    void lockUserMutex(UserMutexSite site) const;
+
+    /**
+     * Locks the userMutex() like lockUserMutex() if nobody holds it, and
+     * returns whether it did.
+     *
+     * @since 21.12
+     */
+    bool tryLockUserMutex(UserMutexSite site) const;
+
+    /**
+     * Unlocks the userMutex() locked with lockUserMutex() or tryLockUserMutex().
+     *
+     * @since 21.12
+     */
+    void unlockUserMutex() const;
+
     /**
      * Set the bounding box of a page after the page has already been handed
      * to the Document. Call this instead of Page::setBoundingBox() to ensure
@@ -607,6 +843,18 @@ protected Q_SLOTS:
      */
     void signalPartialPixmapRequest(Okular::PixmapRequest *request, const QImage &image);
 
+    /**
+     * Like the other signalPartialPixmapRequest(), but only @p dirtyRect of
+     * @p image, in the pixels of the image, has changed since the last partial
+     * update of @p request. When the partial pixmap of the request is still
+     * there only that rect is painted on it, instead of converting the whole
+     * image again.
+     *
+     * Make sure you call it in a way it's executed in the main thread.
+     * @since 21.12
+     */
+    void signalPartialPixmapRequest(Okular::PixmapRequest *request, const QImage &image, const QRect &dirtyRect);
+
 protected:
     /**
      * Returns the last print error in case print() failed
@@ -628,6 +876,38 @@ private:
     Q_DISABLE_COPY(Generator)
 };
 
+/**
+ * @short Locks the userMutex() of a generator while it exists.
+ *
+ * Like a QMutexLocker, through Generator::lockUserMutex(), so the time
+ * spent on the mutex is counted under the given site.
+ *
+ * @since 21.12
+ */
+class OKULARCORE_EXPORT UserMutexLocker
+{
+public:
+    UserMutexLocker(const Generator *generator, Generator::UserMutexSite site);
+    ~UserMutexLocker();
+
+    /**
+     * Unlocks the mutex before the locker goes away.
+     */
+    void unlock();
+
+    /**
+     * Locks the mutex again after unlock().
+     */
+    void relock();
+
+private:
+    Q_DISABLE_COPY(UserMutexLocker)
+
+    const Generator *m_generator;
+    Generator::UserMutexSite m_site;
+    bool m_locked;
+};
+
 /**
  * @short Describes a pixmap type request.
  */
@@ -637,7 +917,17 @@ class OKULARCORE_EXPORT PixmapRequest
     friend class DocumentPrivate;
 
 public:
-    enum PixmapRequestFeature { NoFeature = 0, Asynchronous = 1, Preload = 2 };
+    enum PixmapRequestFeature {
+        NoFeature = 0,
+        Asynchronous = 1,
+        Preload = 2,
+        Progressive = 4, ///< If the page has no pixmap yet, render a quick low resolution preview before the requested one. @since 21.12
+        Preview = 8,     ///< The request is a low resolution preview made by the document for a Progressive one, quality can be traded for speed. @since 21.12
+        EmbeddedThumbnail = 16, ///< The pixmap can be the thumbnail the document has for the page, scaled, when it is not much smaller than the request. @since 21.12
+        Thumbnail = 32, ///< The pixmap is a thumbnail of the page, it can come from and goes to the thumbnail cache of the document. @since 21.12
+        Draft = 64, ///< Render fast at a lower quality, e.g. while scrolling; the document renders the page again at full quality once no drafts were asked for a moment. @since 21.12
+        SearchPreload = 128 ///< A Preload of a page the next matches of a search are likely on, see Document::upcomingSearchMatchPages(); the document takes it back when the search is reset. @since 21.12
+    };
     Q_DECLARE_FLAGS(PixmapRequestFeatures, PixmapRequestFeature)
 
     /**
@@ -711,6 +1001,31 @@ public:
      */
     bool preload() const;
 
+    /**
+     * Returns whether a low resolution preview should be shown while the
+     * page is generated, see PixmapRequestFeature::Progressive.
+     *
+     * @since 21.12
+     */
+    bool progressive() const;
+
+    /**
+     * Returns whether the request is for a quick low resolution preview, that
+     * will be replaced by the real pixmap soon after. Generators can lower
+     * the rendering quality (e.g. disable antialiasing) for these.
+     *
+     * @since 21.12
+     */
+    bool preview() const;
+
+    /**
+     * Returns whether the request is for a draft, see PixmapRequestFeature::Draft.
+     * Generators can lower the rendering quality like for previews.
+     *
+     * @since 21.12
+     */
+    bool draft() const;
+
     /**
      * Returns a pointer to the page where the pixmap shall be generated for.
      */
@@ -760,13 +1075,64 @@ public:
      */
     bool partialUpdatesWanted() const;
 
+    /**
+     * Sets the minimum time, in milliseconds, between two partial updates of
+     * the request. The document sets it from the configuration, generators
+     * should not report more often.
+     *
+     * @since 21.12
+     */
+    void setPartialUpdateInterval(int msecs);
+
+    /**
+     * The minimum time, in milliseconds, between two partial updates of the
+     * request.
+     *
+     * @since 21.12
+     */
+    int partialUpdateInterval() const;
+
     /**
      * Should the request be aborted if possible?
      *
+     * The document sets this when the request becomes stale, e.g. because the
+     * user zoomed again or scrolled the page away. Generators that set
+     * Generator::SupportsCancelling should check it every now and then while
+     * rendering (between tiles, strips, layout blocks...) and return as soon
+     * as possible when it is true; whatever they return is discarded.
+     *
+     * It is safe to call from the rendering thread.
+     *
      * @since 1.4
      */
     bool shouldAbortRender() const;
 
+    /**
+     * The format the pixmaps of the pages are made from as they are:
+     * images of pages rendered in it are adopted without being converted.
+     * Images in other formats still work, at the cost of a conversion of
+     * each of them, except QImage::Format_RGB32 that is adopted too.
+     *
+     * It is QImage::Format_ARGB32_Premultiplied, the format the raster
+     * paint engine and the color filters of the pages work in.
+     *
+     * @since 21.12
+     */
+    static QImage::Format imageFormat();
+
+    /**
+     * Returns an image of the size of the request, or of its tile, in
+     * imageFormat(). Its contents are undefined.
+     *
+     * Generators that paint their pages themselves should paint into it
+     * and return it from Generator::image(): it then becomes the pixmap of
+     * the page without being converted or copied. Its buffer is recycled
+     * for another render once the pixmap is gone.
+     *
+     * @since 21.12
+     */
+    QImage renderTarget() const;
+
 private:
     Q_DISABLE_COPY(PixmapRequest)
 
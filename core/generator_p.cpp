@@ -7,130 +7,371 @@
 #include "generator_p.h"
 
 #include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QTemporaryFile>
+#include <QTextStream>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 #include "fontinfo.h"
+#include "page_p.h"
+#include "requesttrace_p.h"
+#include "textpagediskcache_p.h"
 #include "utils.h"
+#include "utils_p.h"
 
 using namespace Okular;
 
 PixmapGenerationThread::PixmapGenerationThread(Generator *generator)
     : mGenerator(generator)
-    , mRequest(nullptr)
-    , mCalcBoundingBox(false)
 {
 }
 
 void PixmapGenerationThread::startGeneration(PixmapRequest *request, bool calcBoundingBox)
 {
-    mRequest = request;
+    startGeneration(QVector<PixmapRequest *>() << request, QVector<bool>() << calcBoundingBox);
+}
+
+void PixmapGenerationThread::startGeneration(const QVector<PixmapRequest *> &requests, const QVector<bool> &calcBoundingBox)
+{
+    Q_ASSERT(!requests.isEmpty() && requests.count() == calcBoundingBox.count());
+    mRequests = requests;
     mCalcBoundingBox = calcBoundingBox;
+    // allocated up front, the main thread reads the finished ones while we write the others
+    mBoundingBoxes = QVector<NormalizedRect>(requests.count());
 
     start(QThread::InheritPriority);
 }
 
 void PixmapGenerationThread::endGeneration()
 {
-    mRequest = nullptr;
+    mRequests.clear();
+    mCalcBoundingBox.clear();
+    mBoundingBoxes.clear();
+}
+
+bool PixmapGenerationThread::isIdle() const
+{
+    return mRequests.isEmpty() && !isRunning();
 }
 
-PixmapRequest *PixmapGenerationThread::request() const
+int PixmapGenerationThread::count() const
 {
-    return mRequest;
+    return mRequests.count();
 }
 
-QImage PixmapGenerationThread::image() const
+PixmapRequest *PixmapGenerationThread::request(int index) const
 {
-    return mRequest ? PixmapRequestPrivate::get(mRequest)->mResultImage : QImage();
+    return mRequests.value(index);
 }
 
-bool PixmapGenerationThread::calcBoundingBox() const
+QImage PixmapGenerationThread::image(int index) const
 {
-    return mCalcBoundingBox;
+    const PixmapRequest *request = mRequests.value(index);
+    return request ? PixmapRequestPrivate::get(request)->mResultImage : QImage();
 }
 
-NormalizedRect PixmapGenerationThread::boundingBox() const
+bool PixmapGenerationThread::calcBoundingBox(int index) const
 {
-    return mBoundingBox;
+    return mCalcBoundingBox.value(index);
+}
+
+NormalizedRect PixmapGenerationThread::boundingBox(int index) const
+{
+    return mBoundingBoxes.value(index);
 }
 
 void PixmapGenerationThread::run()
 {
-    if (mRequest) {
-        PixmapRequestPrivate::get(mRequest)->mResultImage = mGenerator->image(mRequest);
+    NormalizedRect *boundingBoxes = mBoundingBoxes.data();
+    const int count = mRequests.count();
+    for (int i = 0; i < count; ++i) {
+        PixmapRequest *request = mRequests.at(i);
+        // the request may have been cancelled while it was waiting for the thread
+        if (!request->shouldAbortRender()) {
+            UserMutexWorkScope work(request->preload() ? GeneratorPrivate::SpeculativeWork : GeneratorPrivate::VisiblePixmapWork);
+            RequestTrace::Scope trace("Generator::image", RequestTrace::requestArgs(request));
+            QElapsedTimer imageTimer;
+            imageTimer.start();
+            PixmapRequestPrivate::get(request)->mResultImage = mGenerator->image(request);
+            PixmapRequestPrivate::get(request)->mImageTime = imageTimer.elapsed();
+
+            if (mCalcBoundingBox.at(i))
+                boundingBoxes[i] = renderedPageBoundingBox(&PixmapRequestPrivate::get(request)->mResultImage);
+        }
 
-        if (mCalcBoundingBox)
-            mBoundingBox = Utils::imageBoundingBox(&PixmapRequestPrivate::get(mRequest)->mResultImage);
+        // the last one is handled when the thread finishes
+        if (i < count - 1)
+            emit imageReady(i);
     }
 }
 
-TextPageGenerationThread::TextPageGenerationThread(Generator *generator)
-    : mGenerator(generator)
-    , mTextPage(nullptr)
+void TextPageTask::run(Generator *generator, const TextPageDiskCache *cache, Page *page, int work, const std::function<void(TextPage *)> &done)
 {
-    TextRequestPrivate *treqPriv = TextRequestPrivate::get(&mTextRequest);
-    treqPriv->mPage = nullptr;
-    treqPriv->mShouldAbortExtraction = 0;
+    UserMutexWorkScope workScope(work);
+    TextRequest request(page);
+    done(laidOutTextPage(generator, cache, &request));
 }
 
-void TextPageGenerationThread::startGeneration()
+// the longest side of the renders of BoundingBoxTask, in pixels
+static const int kBoundingBoxRenderSize = 400;
+
+void BoundingBoxTask::run(Generator *generator, const QVector<Page *> &pages, const QAtomicInt *aborted, const std::function<void(const QVector<QPair<int, NormalizedRect>> &)> &done)
 {
-    if (page()) {
-        start(QThread::InheritPriority);
+    // the renders the user waits for go first
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+    UserMutexWorkScope work(GeneratorPrivate::SpeculativeWork);
+
+    QVector<QPair<int, NormalizedRect>> boundingBoxes;
+    for (Page *page : pages) {
+        if (aborted->loadAcquire())
+            break;
+
+        const double scale = kBoundingBoxRenderSize / qMax(page->width(), page->height());
+        PixmapRequest request(nullptr, page->number(), qMax(1, qRound(page->width() * scale)), qMax(1, qRound(page->height() * scale)), 1 /* dpr */, 0, PixmapRequest::Asynchronous | PixmapRequest::Draft);
+        PixmapRequestPrivate::get(&request)->mPage = page;
+
+        QImage image;
+        {
+            RequestTrace::Scope trace("Generator::image", RequestTrace::requestArgs(&request));
+            image = generator->image(&request);
+        }
+        boundingBoxes.append(qMakePair(page->number(), image.isNull() ? NormalizedRect() : renderedPageBoundingBox(&image)));
     }
+    done(boundingBoxes);
 }
 
-void TextPageGenerationThread::endGeneration()
+TextPage *TextPageTask::laidOutTextPage(Generator *generator, const TextPageDiskCache *cache, TextRequest *request)
 {
-    TextRequestPrivate *treqPriv = TextRequestPrivate::get(&mTextRequest);
-    treqPriv->mPage = nullptr;
-    treqPriv->mShouldAbortExtraction = 0;
+    // the cached one is laid out already
+    TextPage *textPage = cache->load(request->page());
+    if (!textPage) {
+        textPage = GeneratorPrivate::pageHasText(generator, request->page()) ? generator->textPage(request) : new TextPage;
+        if (textPage)
+            PagePrivate::layoutTextPage(request->page(), textPage);
+    }
+    return textPage;
 }
 
-void TextPageGenerationThread::setPage(Page *page)
+TextSearchTask::TextSearchTask(Generator *generator,
+                               const TextPageDiskCache *cache,
+                               const QVector<QPair<Page *, TextPage *>> &pages,
+                               const QStringList &words,
+                               bool allWords,
+                               Qt::CaseSensitivity caseSensitivity,
+                               const QSharedPointer<QAtomicInt> &aborted,
+                               const std::function<void(int, TextPage *, const Matches &)> &pageDone,
+                               const std::function<void()> &finished)
+    : mGenerator(generator)
+    , mCache(cache)
+    , mPages(pages)
+    , mWords(words)
+    , mAllWords(allWords)
+    , mCaseSensitivity(caseSensitivity)
+    , mAborted(aborted)
+    , mPageDone(pageDone)
+    , mFinished(finished)
 {
-    TextRequestPrivate *treqPriv = TextRequestPrivate::get(&mTextRequest);
-    treqPriv->mPage = page;
-    treqPriv->mShouldAbortExtraction = 0;
 }
 
-Page *TextPageGenerationThread::page() const
+TextSearchTask::~TextSearchTask()
 {
-    return mTextRequest.page();
+    // the copies of the pages not searched
+    for (const QPair<Page *, TextPage *> &page : qAsConst(mPages))
+        delete page.second;
 }
 
-TextPage *TextPageGenerationThread::textPage() const
+void TextSearchTask::run()
 {
-    return mTextPage;
+    UserMutexWorkScope work(GeneratorPrivate::SpeculativeWork);
+    for (int i = 0; i < mPages.count() && !mAborted->loadAcquire(); ++i) {
+        Page *page = mPages.at(i).first;
+        TextPage *textPage = mPages.at(i).second;
+        mPages[i].second = nullptr;
+
+        TextPage *extracted = nullptr;
+        if (!textPage) {
+            TextRequest request(page);
+            extracted = TextPageTask::laidOutTextPage(mGenerator, mCache, &request);
+            if (!extracted)
+                continue;
+            textPage = extracted;
+        }
+
+        const Matches matches = findMatches(textPage, mWords, mAllWords, mCaseSensitivity);
+        if (extracted || !matches.isEmpty())
+            mPageDone(page->number(), extracted, matches);
+        if (!extracted)
+            delete textPage;
+    }
+
+    mFinished();
 }
 
-void TextPageGenerationThread::abortExtraction()
+TextSearchTask::Matches TextSearchTask::findMatches(TextPage *textPage, const QStringList &words, bool allWords, Qt::CaseSensitivity caseSensitivity)
 {
-    // If extraction already finished no point in aborting
-    if (!mTextPage) {
-        TextRequestPrivate *treqPriv = TextRequestPrivate::get(&mTextRequest);
-        treqPriv->mShouldAbortExtraction = 1;
+    Matches matches;
+    bool allMatched = true;
+    for (int w = 0; w < words.count(); ++w) {
+        const int found = matches.count();
+        PagePrivate::findAllText(textPage, words.at(w), caseSensitivity, w, &matches);
+        allMatched = allMatched && matches.count() > found;
     }
+
+    // only the pages with all the words count then
+    if (allWords && !allMatched)
+        matches.clear();
+    return matches;
 }
 
-bool TextPageGenerationThread::shouldAbortExtraction() const
+// threads extracting the text of the pages for a text export
+static const int kTextExportThreads = 2;
+// how many pages they go ahead of the one being written
+static const int kTextExportBufferedPages = 8;
+
+namespace
+{
+// the text of the pages extracted for a text export, waiting to be written
+struct TextExportBuffer {
+    QMutex mutex;
+    QWaitCondition pageReady;
+    QHash<int, QString> texts;
+};
+
+class TextExportPageTask : public QRunnable
+{
+public:
+    TextExportPageTask(Generator *generator, const TextPageDiskCache *cache, Page *page, int index, TextExportBuffer *buffer)
+        : mGenerator(generator)
+        , mCache(cache)
+        , mPage(page)
+        , mIndex(index)
+        , mBuffer(buffer)
+    {
+    }
+
+    void run() override
+    {
+        UserMutexWorkScope work(GeneratorPrivate::SpeculativeWork);
+        TextRequest request(mPage);
+        TextPage *textPage = TextPageTask::laidOutTextPage(mGenerator, mCache, &request);
+        const QString text = textPage ? textPage->text() : QString();
+        delete textPage;
+
+        QMutexLocker locker(&mBuffer->mutex);
+        mBuffer->texts.insert(mIndex, text);
+        mBuffer->pageReady.wakeAll();
+    }
+
+private:
+    Generator *mGenerator;
+    const TextPageDiskCache *mCache;
+    Page *mPage;
+    int mIndex;
+    TextExportBuffer *mBuffer;
+};
+}
+
+TextExportTask::TextExportTask(Generator *generator,
+                               const TextPageDiskCache *cache,
+                               const QVector<Page *> &pages,
+                               const QString &fileName,
+                               const QSharedPointer<QAtomicInt> &aborted,
+                               const std::function<void(int)> &pageDone,
+                               const std::function<void(bool)> &finished)
+    : mGenerator(generator)
+    , mCache(cache)
+    , mPages(pages)
+    , mFileName(fileName)
+    , mAborted(aborted)
+    , mPageDone(pageDone)
+    , mFinished(finished)
 {
-    return mTextRequest.shouldAbortExtraction();
 }
 
-void TextPageGenerationThread::run()
+void TextExportTask::run()
 {
-    mTextPage = nullptr;
+    // only replaces the file once all the text is written
+    QSaveFile file(mFileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        mFinished(false);
+        return;
+    }
+
+    TextExportBuffer buffer;
+    QThreadPool extractors;
+    extractors.setMaxThreadCount(kTextExportThreads);
+    QTextStream out(&file);
+
+    int nextToExtract = 0;
+    int written = 0;
+    for (; written < mPages.count() && !mAborted->loadAcquire(); ++written) {
+        for (; nextToExtract < mPages.count() && nextToExtract - written < kTextExportBufferedPages; ++nextToExtract)
+            extractors.start(new TextExportPageTask(mGenerator, mCache, mPages.at(nextToExtract), nextToExtract, &buffer));
+
+        buffer.mutex.lock();
+        while (!buffer.texts.contains(written))
+            buffer.pageReady.wait(&buffer.mutex);
+        const QString text = buffer.texts.take(written);
+        buffer.mutex.unlock();
+
+        out << text << QLatin1Char('\n');
+        mPageDone(written + 1);
+    }
+
+    // the pages that are still being extracted use the buffer
+    extractors.waitForDone();
+
+    out.flush();
+    mFinished(written == mPages.count() && out.status() == QTextStream::Ok && file.commit());
+}
 
-    Q_ASSERT(page());
+// how much of the exported file is copied at once
+static const qint64 kExportCopyChunkSize = 1024 * 1024;
+
+void ExportTask::run(Generator *generator, const QString &fileName, const ExportFormat &format, const QSharedPointer<QAtomicInt> &aborted, const std::function<void(bool)> &finished)
+{
+    // the generators export to a file name, which is then copied with a
+    // QSaveFile: it keeps the permissions of the file and replaces it at once
+    const QFileInfo fileInfo(fileName);
+    QTemporaryFile temporaryFile(fileInfo.absoluteDir().filePath(QStringLiteral(".%1.XXXXXX").arg(fileInfo.fileName())));
+    if (!temporaryFile.open()) {
+        finished(false);
+        return;
+    }
+    temporaryFile.close();
 
-    mTextPage = mGenerator->textPage(&mTextRequest);
+    bool success;
+    {
+        UserMutexWorkScope work(GeneratorPrivate::SpeculativeWork);
+        success = generator->exportTo(temporaryFile.fileName(), format);
+    }
+    if (!success || aborted->loadAcquire() || !temporaryFile.open()) {
+        finished(false);
+        return;
+    }
 
-    if (mTextRequest.shouldAbortExtraction()) {
-        delete mTextPage;
-        mTextPage = nullptr;
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        finished(false);
+        return;
+    }
+    while (!temporaryFile.atEnd()) {
+        const QByteArray chunk = temporaryFile.read(kExportCopyChunkSize);
+        if (chunk.isEmpty() || file.write(chunk) != chunk.size() || aborted->loadAcquire()) {
+            file.cancelWriting();
+            break;
+        }
     }
+    finished(file.commit());
 }
 
+// how long the font extraction waits before checking again whether the renders are done
+static const int fontExtractionRenderWait = 50;
+
 FontExtractionThread::FontExtractionThread(Generator *generator, int pages)
     : mGenerator(generator)
     , mNumOfPages(pages)
@@ -156,7 +397,18 @@ void FontExtractionThread::stopExtraction()
 
 void FontExtractionThread::run()
 {
+    // nobody waits for the fonts, the pages come first; not when run in the
+    // thread of the document
+    if (QThread::currentThread() == this)
+        setPriority(QThread::IdlePriority);
+
     for (int i = -1; i < mNumOfPages && mGoOn; ++i) {
+        // fontsForPage() competes with the renders for the document
+        while (mGoOn && mGenerator->d_func()->mPixmapGenerationsRunning > 0)
+            msleep(fontExtractionRenderWait);
+        if (!mGoOn)
+            break;
+
         const FontInfo::List list = mGenerator->fontsForPage(i);
         for (const FontInfo &fi : list) {
             emit gotFont(fi);
@@ -12,15 +12,26 @@
 
 #include "area.h"
 
+#include <QElapsedTimer>
 #include <QImage>
 #include <QMutex>
+#include <QRunnable>
 #include <QSet>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QStringList>
 #include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <functional>
 
 class QEventLoop;
 
 #include "generator.h"
 #include "page.h"
+#include "renderstatistics.h"
+#include "textpage_p.h"
 
 namespace Okular
 {
@@ -32,7 +43,7 @@ class Page;
 class PixmapGenerationThread;
 class PixmapRequest;
 class TextPage;
-class TextPageGenerationThread;
+class TextPageDiskCache;
 class TilesManager;
 
 class GeneratorPrivate
@@ -46,13 +57,55 @@ public:
     Generator *q_ptr;
 
     PixmapGenerationThread *pixmapGenerationThread();
-    TextPageGenerationThread *textPageGenerationThread();
 
-    void pixmapGenerationFinished();
-    void textpageGenerationFinished();
+    void pixmapGenerationFinished(PixmapGenerationThread *thread, int index);
+
+    /**
+     * How many pixmap requests can be rendered at the same time:
+     * 1 unless the generator supports ParallelRendering.
+     */
+    int maxPixmapGenerationThreads() const;
+
+    /**
+     * Whether textPage() is worth calling for @p page, from the "PageHasText"
+     * metaData() of @p generator.
+     */
+    static bool pageHasText(const Generator *generator, const Page *page);
 
     QMutex *threadsLock();
 
+    QMap<QString, LockStatistics> userMutexStatistics() const;
+    void resetUserMutexStatistics();
+
+    /**
+     * The kinds of work that wait for the userMutex() in
+     * Generator::lockUserMutex(), the most urgent first.
+     */
+    enum UserMutexWork {
+        VisiblePixmapWork, ///< Renders of shown pages, and anything in the GUI thread
+        VisibleTextWork,   ///< Text of shown pages
+        SpeculativeWork,   ///< Preloading, searches, exports and the like
+        UserMutexWorkCount
+    };
+
+    /**
+     * The kind of work of the calling thread, see UserMutexWorkScope.
+     */
+    static int userMutexWork();
+
+    /**
+     * Whether more urgent work than @p work waits for the userMutex().
+     */
+    bool hasMoreUrgentUserMutexWaiters(int work) const;
+
+    /**
+     * Waits until no more urgent work than @p work waits for the
+     * userMutex(), or @p work waited long enough not to be starved; then the
+     * caller locks it and calls endUserMutexWait().
+     */
+    void waitForUserMutexTurn(int work) const;
+    void endUserMutexWait(int work) const;
+
     virtual QVariant metaData(const QString &key, const QVariant &option) const;
     virtual QImage image(PixmapRequest *);
 
@@ -60,17 +113,46 @@ public:
     // NOTE: the following should be a QSet< GeneratorFeature >,
     // but it is not to avoid #include'ing generator.h
     QSet<int> m_features;
-    PixmapGenerationThread *mPixmapGenerationThread;
-    TextPageGenerationThread *mTextPageGenerationThread;
+    // the pool of pixmap workers, grown on demand up to maxPixmapGenerationThreads()
+    QVector<PixmapGenerationThread *> mPixmapGenerationThreads;
     mutable QMutex m_mutex;
     QMutex m_threadsMutex;
-    bool mPixmapReady : 1;
-    bool mTextPageReady : 1;
+    // read by the font extraction thread to let renders go first
+    QAtomicInt mPixmapGenerationsRunning;
+    // the use of m_mutex through Generator::lockUserMutex(), by site
+    mutable QMutex m_userMutexStatisticsMutex;
+    mutable LockStatistics m_userMutexStatistics[Generator::OtherSite + 1];
+    // of the holder of m_mutex, only touched by it
+    mutable QElapsedTimer m_userMutexHoldTimer;
+    mutable qint64 m_userMutexTraceStart;
+    mutable int m_userMutexSite;
+    // the threads waiting for m_mutex through Generator::lockUserMutex(), by UserMutexWork
+    mutable QMutex m_userMutexTurnMutex;
+    mutable QWaitCondition m_userMutexTurn;
+    mutable int m_userMutexWaiters[UserMutexWorkCount];
     bool m_closing : 1;
     QEventLoop *m_closingLoop;
     QSizeF m_dpi;
 };
 
+/**
+ * Sets the GeneratorPrivate::UserMutexWork of the calling thread while it
+ * exists, for the order in which Generator::lockUserMutex() lets the
+ * threads waiting for the userMutex() go.
+ */
+class UserMutexWorkScope
+{
+public:
+    explicit UserMutexWorkScope(int work);
+    ~UserMutexWorkScope();
+
+    UserMutexWorkScope(const UserMutexWorkScope &) = delete;
+    UserMutexWorkScope &operator=(const UserMutexWorkScope &) = delete;
+
+private:
+    int m_previousWork;
+};
+
 class PixmapRequestPrivate
 {
 public:
@@ -85,13 +167,23 @@ public:
     int mHeight;
     int mPriority;
     int mFeatures;
+    // in ms
+    int mPartialUpdateInterval;
     bool mForce : 1;
     bool mTile : 1;
     bool mPartialUpdatesWanted : 1;
+    // for one of the pages shown first when the document opens where it was left
+    bool mWarmStart : 1;
     Page *mPage;
     NormalizedRect mNormalizedRect;
     QAtomicInt mShouldAbortRender;
     QImage mResultImage;
+    // started when the request enters the document queue
+    QElapsedTimer mQueuedTimer;
+    // started when the request is sent to the generator
+    QElapsedTimer mRenderTimer;
+    // how long Generator::image() took for it, in msec, -1 if it did not run
+    qint64 mImageTime;
 };
 
 class TextRequestPrivate
@@ -112,51 +204,180 @@ public:
 
     void startGeneration(PixmapRequest *request, bool calcBoundingBox);
 
+    /**
+     * Renders all the @p requests one after the other, see
+     * Generator::generatePixmaps(). imageReady() is emitted for every
+     * request but the last one, which is done when the thread finishes.
+     */
+    void startGeneration(const QVector<PixmapRequest *> &requests, const QVector<bool> &calcBoundingBox);
+
     void endGeneration();
 
-    PixmapRequest *request() const;
+    /**
+     * Whether the thread is free to take a new request.
+     */
+    bool isIdle() const;
+
+    /**
+     * The number of requests of the current generation.
+     */
+    int count() const;
+
+    PixmapRequest *request(int index = 0) const;
 
-    QImage image() const;
-    bool calcBoundingBox() const;
-    NormalizedRect boundingBox() const;
+    QImage image(int index = 0) const;
+    bool calcBoundingBox(int index = 0) const;
+    NormalizedRect boundingBox(int index = 0) const;
+
+Q_SIGNALS:
+    void imageReady(int index);
 
 protected:
     void run() override;
 
 private:
     Generator *mGenerator;
-    PixmapRequest *mRequest;
-    NormalizedRect mBoundingBox;
-    bool mCalcBoundingBox : 1;
+    QVector<PixmapRequest *> mRequests;
+    QVector<NormalizedRect> mBoundingBoxes;
+    QVector<bool> mCalcBoundingBox;
 };
 
-class TextPageGenerationThread : public QThread
+/**
+ * Text pages extracted away from the GUI thread.
+ */
+class TextPageTask
 {
-    Q_OBJECT
+public:
+    /**
+     * Extracts and lays out the text of @p page, in a thread of the document
+     * text page pool that runs it in a FunctionTask, unless @p cache has it.
+     * @p done is called in that thread with the text page, or nullptr.
+     * @p work is its GeneratorPrivate::UserMutexWork.
+     */
+    static void run(Generator *generator, const TextPageDiskCache *cache, Page *page, int work, const std::function<void(TextPage *)> &done);
+
+    /**
+     * The text page of the page of @p request laid out, from @p cache or
+     * extracted by @p generator, or nullptr. The generator must be Threaded
+     * if this is not the GUI thread.
+     */
+    static TextPage *laidOutTextPage(Generator *generator, const TextPageDiskCache *cache, TextRequest *request);
+};
 
+/**
+ * Renders pages small, in the thread of the document bounding box pool, only
+ * to find the bounding boxes they don't know yet. @p done is called in that
+ * thread with the number and the bounding box of each page rendered, null if
+ * its render failed; the pages after @p aborted is set are skipped.
+ *
+ * The pool runs it in a FunctionTask.
+ */
+class BoundingBoxTask
+{
 public:
-    explicit TextPageGenerationThread(Generator *generator);
+    static void run(Generator *generator, const QVector<Page *> &pages, const QAtomicInt *aborted, const std::function<void(const QVector<QPair<int, NormalizedRect>> &)> &done);
+};
 
-    void endGeneration();
+/**
+ * Searches pages of the document for a whole document search, in the thread
+ * of the document search pool, so the user interface stays responsive and
+ * the matches can be shown as they are found.
+ *
+ * Each page comes with a copy of its text page, see
+ * PagePrivate::copyTextPage(), or with none and it is loaded from @p cache or
+ * the generator extracts it.
+ * @p pageDone is called in that thread for the pages with matches or whose
+ * text was extracted, with the extracted text page (or nullptr) and the
+ * matches, in the coordinates of the unrotated page, each with the index of
+ * its word in @p words. With @p allWords only the pages that have all of them
+ * have matches. @p finished is called at the end, also when @p aborted.
+ */
+class TextSearchTask : public QRunnable
+{
+public:
+    typedef TextMatches Matches;
+
+    TextSearchTask(Generator *generator,
+                   const TextPageDiskCache *cache,
+                   const QVector<QPair<Page *, TextPage *>> &pages,
+                   const QStringList &words,
+                   bool allWords,
+                   Qt::CaseSensitivity caseSensitivity,
+                   const QSharedPointer<QAtomicInt> &aborted,
+                   const std::function<void(int, TextPage *, const Matches &)> &pageDone,
+                   const std::function<void()> &finished);
+    ~TextSearchTask() override;
 
-    void setPage(Page *page);
-    Page *page() const;
+    void run() override;
 
-    TextPage *textPage() const;
+    /**
+     * Finds the matches of @p words in @p textPage, like the task does for
+     * each page.
+     */
+    static Matches findMatches(TextPage *textPage, const QStringList &words, bool allWords, Qt::CaseSensitivity caseSensitivity);
 
-    void abortExtraction();
-    bool shouldAbortExtraction() const;
+private:
+    Generator *mGenerator;
+    const TextPageDiskCache *mCache;
+    QVector<QPair<Page *, TextPage *>> mPages;
+    QStringList mWords;
+    bool mAllWords;
+    Qt::CaseSensitivity mCaseSensitivity;
+    QSharedPointer<QAtomicInt> mAborted;
+    std::function<void(int, TextPage *, const Matches &)> mPageDone;
+    std::function<void()> mFinished;
+};
 
-public slots:
-    void startGeneration();
+/**
+ * Writes the text of @p pages to @p fileName, in the thread of the document
+ * text export pool, so the user interface stays responsive.
+ *
+ * The text pages are extracted and laid out by a few threads, a bounded
+ * number of pages ahead of the one being written, and freed once written,
+ * so the memory used does not depend on the size of the document.
+ * @p pageDone is called in the export thread with the number of pages
+ * written so far, @p finished at the end with whether the whole text was
+ * written; when @p aborted the file is left as it was.
+ */
+class TextExportTask : public QRunnable
+{
+public:
+    TextExportTask(Generator *generator,
+                   const TextPageDiskCache *cache,
+                   const QVector<Page *> &pages,
+                   const QString &fileName,
+                   const QSharedPointer<QAtomicInt> &aborted,
+                   const std::function<void(int)> &pageDone,
+                   const std::function<void(bool)> &finished);
 
-protected:
     void run() override;
 
 private:
     Generator *mGenerator;
-    TextPage *mTextPage;
-    TextRequest mTextRequest;
+    const TextPageDiskCache *mCache;
+    QVector<Page *> mPages;
+    QString mFileName;
+    QSharedPointer<QAtomicInt> mAborted;
+    std::function<void(int)> mPageDone;
+    std::function<void(bool)> mFinished;
+};
+
+/**
+ * Exports the document in @p format to @p fileName with Generator::exportTo(),
+ * in the thread of the document export pool, so the user interface stays
+ * responsive.
+ *
+ * The generator writes a temporary file, which is copied to @p fileName with
+ * a QSaveFile at the end, so the file keeps its permissions; when @p aborted
+ * meanwhile the file is left as it was. @p finished is called in the export thread with whether the
+ * file was written.
+ *
+ * The pool runs it in a FunctionTask.
+ */
+class ExportTask
+{
+public:
+    static void run(Generator *generator, const QString &fileName, const ExportFormat &format, const QSharedPointer<QAtomicInt> &aborted, const std::function<void(bool)> &finished);
 };
 
 class FontExtractionThread : public QThread
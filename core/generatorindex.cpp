@@ -0,0 +1,168 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "generatorindex_p.h"
+
+#include <KPluginLoader>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMimeDatabase>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "debug_p.h"
+
+using namespace Okular;
+
+// bump when what the index file keeps changes
+static const int kIndexVersion = 1;
+
+static qint64 modificationTime(const QString &path)
+{
+    return QFileInfo(path).lastModified().toMSecsSinceEpoch();
+}
+
+// the time of the folder, or of the newest of its files: the time of a folder
+// may not change on a file system whose times are coarse
+static qint64 folderModificationTime(const QString &path)
+{
+    qint64 modified = modificationTime(path);
+    const QFileInfoList entries = QDir(path).entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
+    for (const QFileInfo &entry : entries)
+        modified = qMax(modified, entry.lastModified().toMSecsSinceEpoch());
+    return modified;
+}
+
+GeneratorIndex::GeneratorIndex(const QString &pluginDirectory, const QString &indexFileName)
+    : m_pluginDirectory(pluginDirectory)
+    , m_indexFileName(indexFileName)
+    , m_fromIndexFile(false)
+{
+    const QVector<QString> folders = pluginFolders();
+    m_fromIndexFile = read(folders);
+    if (!m_fromIndexFile) {
+        m_plugins = KPluginLoader::findPlugins(m_pluginDirectory);
+        write(folders);
+    }
+    mapMimeTypes();
+}
+
+const GeneratorIndex *GeneratorIndex::instance()
+{
+    static const GeneratorIndex index(QStringLiteral("okular/generators"), QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/okular/generatorindex.json"));
+    return &index;
+}
+
+QVector<KPluginMetaData> GeneratorIndex::plugins() const
+{
+    return m_plugins;
+}
+
+QVector<int> GeneratorIndex::pluginsForMimeType(const QString &mimeName) const
+{
+    return m_mimeTypes.value(mimeName);
+}
+
+QStringList GeneratorIndex::mimeTypes() const
+{
+    return m_mimeTypes.keys();
+}
+
+bool GeneratorIndex::isFromIndexFile() const
+{
+    return m_fromIndexFile;
+}
+
+QVector<QString> GeneratorIndex::pluginFolders() const
+{
+    // where KPluginLoader::findPlugins() looks
+    if (QDir::isAbsolutePath(m_pluginDirectory))
+        return {m_pluginDirectory};
+
+    QVector<QString> folders;
+    const QStringList libraryPaths = QCoreApplication::libraryPaths();
+    for (const QString &libraryPath : libraryPaths) {
+        const QString folder = libraryPath + QLatin1Char('/') + m_pluginDirectory;
+        if (QFileInfo(folder).isDir() && !folders.contains(folder))
+            folders.append(folder);
+    }
+    return folders;
+}
+
+bool GeneratorIndex::read(const QVector<QString> &folders)
+{
+    QFile file(m_indexFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    const QJsonObject index = QJsonDocument::fromJson(file.readAll()).object();
+    if (index.value(QStringLiteral("version")).toInt() != kIndexVersion)
+        return false;
+
+    // a plugin added or removed changes the time of its folder, or adds a newer file
+    const QJsonArray indexFolders = index.value(QStringLiteral("folders")).toArray();
+    if (indexFolders.count() != folders.count())
+        return false;
+    for (int i = 0; i < folders.count(); ++i) {
+        const QJsonObject folder = indexFolders.at(i).toObject();
+        if (folder.value(QStringLiteral("path")).toString() != folders.at(i) || qint64(folder.value(QStringLiteral("modified")).toDouble()) != folderModificationTime(folders.at(i)))
+            return false;
+    }
+
+    QVector<KPluginMetaData> plugins;
+    const QJsonArray indexPlugins = index.value(QStringLiteral("plugins")).toArray();
+    for (const QJsonValue &value : indexPlugins) {
+        const QJsonObject plugin = value.toObject();
+        const QString fileName = plugin.value(QStringLiteral("file")).toString();
+        if (qint64(plugin.value(QStringLiteral("modified")).toDouble()) != modificationTime(fileName))
+            return false;
+        plugins.append(KPluginMetaData(plugin.value(QStringLiteral("metaData")).toObject(), fileName));
+    }
+
+    m_plugins = plugins;
+    return true;
+}
+
+void GeneratorIndex::write(const QVector<QString> &folders) const
+{
+    QJsonArray indexFolders;
+    for (const QString &folder : folders)
+        indexFolders.append(QJsonObject {{QStringLiteral("path"), folder}, {QStringLiteral("modified"), double(folderModificationTime(folder))}});
+
+    QJsonArray indexPlugins;
+    for (const KPluginMetaData &md : m_plugins)
+        indexPlugins.append(QJsonObject {{QStringLiteral("file"), md.fileName()}, {QStringLiteral("modified"), double(modificationTime(md.fileName()))}, {QStringLiteral("metaData"), md.rawData()}});
+
+    const QJsonObject index {{QStringLiteral("version"), kIndexVersion}, {QStringLiteral("folders"), indexFolders}, {QStringLiteral("plugins"), indexPlugins}};
+
+    QDir().mkpath(QFileInfo(m_indexFileName).absolutePath());
+    QSaveFile file(m_indexFileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(QJsonDocument(index).toJson(QJsonDocument::Compact)) < 0 || !file.commit())
+        qCWarning(OkularCoreDebug) << "Could not write the generator index" << m_indexFileName;
+}
+
+void GeneratorIndex::mapMimeTypes()
+{
+    QMimeDatabase mimeDatabase;
+    for (int i = 0; i < m_plugins.count(); ++i) {
+        const QStringList mimetypes = m_plugins.at(i).mimeTypes();
+        for (const QString &supported : mimetypes) {
+            const QMimeType mimeType = mimeDatabase.mimeTypeForName(supported);
+            if (!mimeType.isValid())
+                continue;
+
+            QVector<int> &plugins = m_mimeTypes[mimeType.name()];
+            if (!plugins.contains(i))
+                plugins.append(i);
+        }
+    }
+}
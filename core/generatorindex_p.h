@@ -0,0 +1,79 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_GENERATORINDEX_P_H_
+#define _OKULAR_GENERATORINDEX_P_H_
+
+#include <KPluginMetaData>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * The generator plugins and the mimetypes they open.
+ *
+ * Finding the plugins means going through the plugin folders and reading
+ * the metadata out of every plugin file, which is slow on network home
+ * folders and cold disks. The index keeps the metadata in a file with the
+ * modification times of the folders and of the plugins, and only looks
+ * for the plugins again when one of them changed.
+ *
+ * The mimetypes are mapped by their canonical name, so an alias a plugin
+ * declares finds it too.
+ */
+class OKULARCORE_EXPORT GeneratorIndex
+{
+public:
+    /**
+     * The index of the plugins in @p pluginDirectory, relative to the
+     * library paths, kept in @p indexFileName.
+     */
+    GeneratorIndex(const QString &pluginDirectory, const QString &indexFileName);
+
+    /**
+     * The index of the generators, shared by the whole process.
+     */
+    static const GeneratorIndex *instance();
+
+    QVector<KPluginMetaData> plugins() const;
+
+    /**
+     * The positions in plugins() of the plugins that declare @p mimeName,
+     * in order.
+     */
+    QVector<int> pluginsForMimeType(const QString &mimeName) const;
+
+    /**
+     * The canonical names of the mimetypes the plugins declare.
+     */
+    QStringList mimeTypes() const;
+
+    /**
+     * Whether the plugins were read from the index file rather than found again.
+     */
+    bool isFromIndexFile() const;
+
+private:
+    QVector<QString> pluginFolders() const;
+    bool read(const QVector<QString> &folders);
+    void write(const QVector<QString> &folders) const;
+    void mapMimeTypes();
+
+    QString m_pluginDirectory;
+    QString m_indexFileName;
+    QVector<KPluginMetaData> m_plugins;
+    QHash<QString, QVector<int>> m_mimeTypes;
+    bool m_fromIndexFile;
+};
+
+}
+
+#endif
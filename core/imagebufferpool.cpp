@@ -0,0 +1,207 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "imagebufferpool_p.h"
+
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+
+using namespace Okular;
+
+// a few full screen pages
+static const qulonglong kDefaultMaximumIdleBytes = 64 * 1024 * 1024;
+// renders smaller than this are cheap to allocate, they don't churn the heap
+static const qulonglong kMinimumBucketBytes = 64 * 1024;
+// the pixels start after the header, aligned for the SIMD loops of QPainter
+static const size_t kHeaderBytes = 64;
+
+class ImageBufferPool::Private
+{
+public:
+    // in front of the pixels of each buffer
+    struct Buffer {
+        Private *pool;
+        qulonglong bytes;
+    };
+    static_assert(sizeof(Buffer) <= kHeaderBytes, "the header of the buffers must fit before the pixels");
+
+    static uchar *pixels(Buffer *buffer)
+    {
+        return reinterpret_cast<uchar *>(buffer) + kHeaderBytes;
+    }
+
+    // the cleanup function of the images
+    static void release(void *info);
+
+    uchar *take(qulonglong bytes);
+
+    mutable QMutex mutex;
+    // the idle buffers by their size
+    QMap<qulonglong, QVector<Buffer *>> buckets;
+    qulonglong idleBytes = 0;
+    int idleCount = 0;
+    qulonglong maximumIdleBytes = kDefaultMaximumIdleBytes;
+    // the images that still have a buffer of the pool
+    int inUse = 0;
+    bool poolDeleted = false;
+};
+
+uchar *ImageBufferPool::Private::take(qulonglong bytes)
+{
+    QMutexLocker locker(&mutex);
+    QMap<qulonglong, QVector<Buffer *>>::iterator it = buckets.find(bytes);
+    Buffer *buffer = nullptr;
+    if (it != buckets.end()) {
+        buffer = it->takeLast();
+        if (it->isEmpty())
+            buckets.erase(it);
+        idleBytes -= bytes;
+        --idleCount;
+    } else {
+        buffer = static_cast<Buffer *>(std::malloc(kHeaderBytes + bytes));
+        if (!buffer)
+            return nullptr;
+        buffer->pool = this;
+        buffer->bytes = bytes;
+    }
+    ++inUse;
+    return pixels(buffer);
+}
+
+void ImageBufferPool::Private::release(void *info)
+{
+    Buffer *buffer = static_cast<Buffer *>(info);
+    Private *d = buffer->pool;
+
+    QMutexLocker locker(&d->mutex);
+    --d->inUse;
+    if (d->poolDeleted || d->idleBytes + buffer->bytes > d->maximumIdleBytes) {
+        std::free(buffer);
+        // the last image of a deleted pool takes what is left of it along
+        if (d->poolDeleted && d->inUse == 0) {
+            locker.unlock();
+            delete d;
+        }
+        return;
+    }
+
+    d->buckets[buffer->bytes].append(buffer);
+    d->idleBytes += buffer->bytes;
+    ++d->idleCount;
+}
+
+ImageBufferPool::ImageBufferPool()
+    : d(new Private)
+{
+}
+
+ImageBufferPool::~ImageBufferPool()
+{
+    clear();
+
+    QMutexLocker locker(&d->mutex);
+    d->poolDeleted = true;
+    if (d->inUse == 0) {
+        locker.unlock();
+        delete d;
+    }
+}
+
+ImageBufferPool *ImageBufferPool::instance()
+{
+    static ImageBufferPool pool;
+    return &pool;
+}
+
+qulonglong ImageBufferPool::bucketBytes(qulonglong bytes)
+{
+    if (bytes <= kMinimumBucketBytes)
+        return kMinimumBucketBytes;
+
+    // eight buckets from a power of two to the next, so a buffer is at most
+    // an eighth bigger than the image that uses it
+    qulonglong power = kMinimumBucketBytes;
+    while (power * 2 < bytes)
+        power *= 2;
+    const qulonglong step = power / 8;
+    return (bytes + step - 1) / step * step;
+}
+
+QImage ImageBufferPool::image(const QSize &size, QImage::Format format)
+{
+    if (size.isEmpty())
+        return QImage();
+
+    const int depth = QImage::toPixelFormat(format).bitsPerPixel();
+    const qsizetype bytesPerLine = ((qsizetype(size.width()) * depth + 31) >> 5) << 2;
+    const qulonglong bytes = qulonglong(bytesPerLine) * size.height();
+    // QImage sizes the buffers with an int
+    if (bytes > qulonglong(std::numeric_limits<int>::max()))
+        return QImage(size, format);
+
+    uchar *data = d->take(bucketBytes(bytes));
+    if (!data)
+        return QImage(size, format);
+
+    return QImage(data, size.width(), size.height(), bytesPerLine, format, &Private::release, data - kHeaderBytes);
+}
+
+qulonglong ImageBufferPool::idleBytes() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->idleBytes;
+}
+
+int ImageBufferPool::idleCount() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->idleCount;
+}
+
+void ImageBufferPool::setMaximumIdleBytes(qulonglong bytes)
+{
+    QMutexLocker locker(&d->mutex);
+    d->maximumIdleBytes = bytes;
+    locker.unlock();
+
+    const qulonglong idle = idleBytes();
+    if (idle > bytes)
+        trim(idle - bytes);
+}
+
+qulonglong ImageBufferPool::maximumIdleBytes() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->maximumIdleBytes;
+}
+
+qulonglong ImageBufferPool::trim(qulonglong bytes)
+{
+    QMutexLocker locker(&d->mutex);
+    qulonglong freed = 0;
+    while (freed < bytes && !d->buckets.isEmpty()) {
+        QMap<qulonglong, QVector<Private::Buffer *>>::iterator it = std::prev(d->buckets.end());
+        Private::Buffer *buffer = it->takeLast();
+        if (it->isEmpty())
+            d->buckets.erase(it);
+        freed += buffer->bytes;
+        d->idleBytes -= buffer->bytes;
+        --d->idleCount;
+        std::free(buffer);
+    }
+    return freed;
+}
+
+void ImageBufferPool::clear()
+{
+    trim(std::numeric_limits<qulonglong>::max());
+}
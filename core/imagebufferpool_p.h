@@ -0,0 +1,86 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_IMAGEBUFFERPOOL_P_H_
+#define _OKULAR_IMAGEBUFFERPOOL_P_H_
+
+#include <QImage>
+#include <QSize>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * Recycles the pixel buffers of the renders of the pages.
+ *
+ * The images it hands out give their buffer back to the pool when the last
+ * copy of them is gone, usually when the pixmap of the page that adopted it
+ * is evicted, and the next render of about the same size gets it instead of
+ * a fresh allocation. Buffers are kept by size buckets a few percent apart,
+ * up to maximumIdleBytes() of them. The idle buffers count in the pixmap
+ * memory budget of the document, and go first when it asks for memory back.
+ *
+ * All the methods can be called from any thread.
+ */
+class OKULARCORE_EXPORT ImageBufferPool
+{
+public:
+    ImageBufferPool();
+    ~ImageBufferPool();
+
+    /**
+     * The pool of the generators and the document.
+     */
+    static ImageBufferPool *instance();
+
+    /**
+     * Returns an image of @p size and @p format whose buffer comes from the
+     * pool. Its contents are undefined.
+     */
+    QImage image(const QSize &size, QImage::Format format = QImage::Format_ARGB32_Premultiplied);
+
+    /**
+     * The size of the buffers waiting to be used again, in bytes.
+     */
+    qulonglong idleBytes() const;
+
+    int idleCount() const;
+
+    /**
+     * Buffers given back while the idle ones already take @p bytes are freed.
+     */
+    void setMaximumIdleBytes(qulonglong bytes);
+
+    qulonglong maximumIdleBytes() const;
+
+    /**
+     * Frees idle buffers, the biggest first, until @p bytes are freed or
+     * none is left. Returns how many bytes were freed.
+     */
+    qulonglong trim(qulonglong bytes);
+
+    /**
+     * Frees all the idle buffers.
+     */
+    void clear();
+
+    /**
+     * The size of the buffers kept for images of @p bytes bytes.
+     */
+    static qulonglong bucketBytes(qulonglong bytes);
+
+private:
+    Q_DISABLE_COPY(ImageBufferPool)
+
+    class Private;
+    // outlives the pool while any of its images are around
+    Private *d;
+};
+
+}
+
+#endif
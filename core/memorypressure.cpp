@@ -0,0 +1,186 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "memorypressure_p.h"
+
+#include <QFile>
+#include <QSocketNotifier>
+#include <QStringList>
+#include <QTextStream>
+
+#include "debug_p.h"
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace Okular;
+
+#if defined(Q_OS_LINUX)
+static const QString kCGroupRoot = QStringLiteral("/sys/fs/cgroup");
+
+// The cgroup v2 directory of this process, or an empty string
+static QString cgroupDirectory()
+{
+    QFile cgroupFile(QStringLiteral("/proc/self/cgroup"));
+    if (!cgroupFile.open(QIODevice::ReadOnly))
+        return QString();
+
+    // the v2 hierarchy is the one with id 0 and no controllers, "0::/path"
+    QTextStream readStream(&cgroupFile);
+    while (true) {
+        const QString entry = readStream.readLine();
+        if (entry.isNull())
+            break;
+        if (entry.startsWith(QLatin1String("0::"))) {
+            // with cgroups v1 mounted there the v2 directory does not exist
+            const QString dir = kCGroupRoot + entry.mid(3);
+            return QFile::exists(dir + QLatin1String("/cgroup.controllers")) ? dir : QString();
+        }
+    }
+    return QString();
+}
+
+static QByteArray readCGroupFile(const QString &dir, const char *name)
+{
+    QFile file(dir + QLatin1Char('/') + QLatin1String(name));
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll().trimmed();
+}
+
+// Memory in use by the cgroup which can't be reclaimed straight away
+static qulonglong workingSet(const QString &dir)
+{
+    bool ok = false;
+    const qulonglong current = readCGroupFile(dir, "memory.current").toULongLong(&ok);
+    if (!ok)
+        return 0;
+
+    const QList<QByteArray> stats = readCGroupFile(dir, "memory.stat").split('\n');
+    for (const QByteArray &stat : stats) {
+        if (stat.startsWith("inactive_file ")) {
+            const qulonglong inactiveFile = stat.mid(14).toULongLong();
+            return inactiveFile < current ? current - inactiveFile : 0;
+        }
+    }
+    return current;
+}
+
+// Walks from the cgroup of the process up to the root one, looking for the
+// tightest limit
+static bool cgroupLimits(qulonglong *limit, qulonglong *available)
+{
+    QString dir = cgroupDirectory();
+    if (dir.isEmpty())
+        return false;
+
+    bool found = false;
+    while (dir.startsWith(kCGroupRoot)) {
+        bool ok = false;
+        // "max" when there is no limit
+        const qulonglong max = readCGroupFile(dir, "memory.max").toULongLong(&ok);
+        if (ok) {
+            const qulonglong used = available ? workingSet(dir) : 0;
+            const qulonglong left = used < max ? max - used : 0;
+            if (!found || max < *limit)
+                *limit = max;
+            if (available && (!found || left < *available))
+                *available = left;
+            found = true;
+        }
+
+        if (dir == kCGroupRoot)
+            break;
+        dir = dir.left(dir.lastIndexOf(QLatin1Char('/')));
+    }
+    return found;
+}
+#endif
+
+qulonglong CGroupMemory::limit()
+{
+#if defined(Q_OS_LINUX)
+    qulonglong limit = 0;
+    if (cgroupLimits(&limit, nullptr))
+        return limit;
+#endif
+    return 0;
+}
+
+bool CGroupMemory::available(qulonglong *available)
+{
+#if defined(Q_OS_LINUX)
+    qulonglong limit = 0;
+    return cgroupLimits(&limit, available);
+#else
+    Q_UNUSED(available)
+    return false;
+#endif
+}
+
+MemoryPressureMonitor::MemoryPressureMonitor(QObject *parent)
+    : QObject(parent)
+    , m_fd(-1)
+    , m_notifier(nullptr)
+{
+}
+
+MemoryPressureMonitor::~MemoryPressureMonitor()
+{
+    stop();
+}
+
+bool MemoryPressureMonitor::start()
+{
+    if (m_notifier)
+        return true;
+
+#if defined(Q_OS_LINUX)
+    // Wake up when some task waited 150 ms for memory in a 2 s window. Windows
+    // that are a multiple of 2 s are the only ones unprivileged users can use
+    static const char trigger[] = "some 150000 2000000";
+
+    QStringList files;
+    const QString dir = cgroupDirectory();
+    if (!dir.isEmpty())
+        files << dir + QLatin1String("/memory.pressure");
+    files << QStringLiteral("/proc/pressure/memory");
+
+    for (const QString &fileName : qAsConst(files)) {
+        const int fd = ::open(QFile::encodeName(fileName).constData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        if (::write(fd, trigger, sizeof(trigger)) < 0) {
+            ::close(fd);
+            continue;
+        }
+
+        qCDebug(OkularCoreDebug) << "Watching memory pressure in" << fileName;
+        m_fd = fd;
+        // PSI triggers are reported as POLLPRI
+        m_notifier = new QSocketNotifier(m_fd, QSocketNotifier::Exception, this);
+        // activated() is overloaded since Qt 5.15, the string based connect works with all versions
+        connect(m_notifier, SIGNAL(activated(int)), this, SIGNAL(memoryPressure()));
+        return true;
+    }
+#endif
+    return false;
+}
+
+void MemoryPressureMonitor::stop()
+{
+    delete m_notifier;
+    m_notifier = nullptr;
+
+#if defined(Q_OS_LINUX)
+    if (m_fd >= 0)
+        ::close(m_fd);
+#endif
+    m_fd = -1;
+}
@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_MEMORYPRESSURE_P_H_
+#define _OKULAR_MEMORYPRESSURE_P_H_
+
+#include <QObject>
+
+class QSocketNotifier;
+
+namespace Okular
+{
+/**
+ * Memory limits of the control group (cgroup v2) the process runs in.
+ *
+ * Inside containers and sandboxes (e.g. Flatpak, systemd slices with a
+ * MemoryMax) the limit of the cgroup is what matters, the process is killed
+ * long before the system memory runs out. Limits of all the parent groups
+ * apply too, the tightest one wins.
+ */
+namespace CGroupMemory
+{
+/**
+ * Returns the memory limit of the cgroup in bytes, or 0 if there is none
+ * (or cgroups v2 are not available).
+ */
+qulonglong limit();
+
+/**
+ * Sets @p available to how many bytes can still be used before reaching the
+ * cgroup limit, not counting the page cache that can be reclaimed, and
+ * returns true; returns false if there is no limit.
+ */
+bool available(qulonglong *available);
+}
+
+/**
+ * Watches the memory pressure stall information (PSI) of the cgroup the
+ * process runs in, or of the whole system if the cgroup one is not
+ * available, and tells when tasks start waiting for memory.
+ *
+ * This is only available on Linux 4.20 or newer.
+ */
+class MemoryPressureMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryPressureMonitor(QObject *parent = nullptr);
+    ~MemoryPressureMonitor() override;
+
+    /**
+     * Starts watching, returns whether memory pressure can be watched at all.
+     */
+    bool start();
+    void stop();
+
+Q_SIGNALS:
+    /**
+     * Emitted at most once every couple of seconds while the processes of
+     * the cgroup are stalled waiting for memory.
+     */
+    void memoryPressure();
+
+private:
+    int m_fd;
+    QSocketNotifier *m_notifier;
+};
+
+}
+
+#endif
@@ -0,0 +1,247 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "objectrectgrid_p.h"
+
+#include "annotations.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace Okular;
+
+// how many rects a cell has, on average, in a page full of them
+static const int kRectsPerCell = 4;
+// more cells than that barely helps, however many rects there are
+static const int kMaxCells = 64;
+
+// where the rect can be closer to a point than the distance an object rect is
+// hit from: the pen of an annotation counts, see AnnotationPrivate::distanceSqr()
+static QRectF hitBounds(const ObjectRect *rect, const QSizeF &pageSize)
+{
+    if (rect->objectType() != ObjectRect::OAnnotation)
+        return rect->region().boundingRect();
+
+    const Annotation *annotation = static_cast<const AnnotationObjectRect *>(rect)->annotation();
+    const NormalizedRect boundary = annotation->transformedBoundingRectangle();
+    // the pen width is scaled by the width of the page, on both axes
+    const double side = qMin(pageSize.width(), pageSize.height());
+    const double margin = side > 0 ? 2 * annotation->style().width() / side : 0;
+    return QRectF(boundary.left - margin, boundary.top - margin, boundary.width() + 2 * margin, boundary.height() + 2 * margin);
+}
+
+ObjectRectGrid::ObjectRectGrid()
+    : m_columns(0)
+    , m_rows(0)
+{
+}
+
+void ObjectRectGrid::build(const QLinkedList<ObjectRect *> &rects, ObjectRect::ObjectType type, const QSizeF &pageSize)
+{
+    clear();
+
+    for (const ObjectRect *rect : rects) {
+        if (rect->objectType() == type)
+            m_rects.append(rect);
+    }
+    if (m_rects.isEmpty())
+        return;
+
+    layout(pageSize);
+}
+
+void ObjectRectGrid::add(const ObjectRect *rect, const QSizeF &pageSize)
+{
+    m_rects.append(rect);
+
+    // lay the cells out again only when they get much too crowded
+    const int columns = qBound(1, int(std::ceil(std::sqrt(double(m_rects.count()) / kRectsPerCell))), kMaxCells);
+    if (m_columns == 0 || columns > 2 * m_columns) {
+        layout(pageSize);
+        return;
+    }
+
+    m_rectCells.append(QRect());
+    place(m_rects.count() - 1, pageSize);
+}
+
+void ObjectRectGrid::remove(const ObjectRect *rect)
+{
+    const int index = m_rects.indexOf(rect);
+    if (index < 0)
+        return;
+
+    unplace(index);
+    m_rects.remove(index);
+    m_rectCells.remove(index);
+    for (QVector<int> &cell : m_cells) {
+        for (int &i : cell) {
+            if (i > index)
+                --i;
+        }
+    }
+}
+
+void ObjectRectGrid::update(const ObjectRect *rect, const QSizeF &pageSize)
+{
+    const int index = m_rects.indexOf(rect);
+    if (index < 0)
+        return;
+
+    unplace(index);
+    place(index, pageSize);
+}
+
+void ObjectRectGrid::layout(const QSizeF &pageSize)
+{
+    m_columns = m_rows = qBound(1, int(std::ceil(std::sqrt(double(m_rects.count()) / kRectsPerCell))), kMaxCells);
+    m_cells = QVector<QVector<int>>(m_columns * m_rows);
+    m_rectCells = QVector<QRect>(m_rects.count());
+    for (int i = 0; i < m_rects.count(); ++i)
+        place(i, pageSize);
+}
+
+void ObjectRectGrid::place(int index, const QSizeF &pageSize)
+{
+    const QRectF bounds = hitBounds(m_rects.at(index), pageSize);
+    const QRect cells(QPoint(column(bounds.left()), row(bounds.top())), QPoint(column(bounds.right()), row(bounds.bottom())));
+    m_rectCells[index] = cells;
+    for (int r = cells.top(); r <= cells.bottom(); ++r) {
+        for (int c = cells.left(); c <= cells.right(); ++c) {
+            // keep the cells in the order of the list
+            QVector<int> &cell = m_cells[r * m_columns + c];
+            cell.insert(std::lower_bound(cell.begin(), cell.end(), index), index);
+        }
+    }
+}
+
+void ObjectRectGrid::unplace(int index)
+{
+    const QRect cells = m_rectCells.at(index);
+    for (int r = cells.top(); r <= cells.bottom(); ++r) {
+        for (int c = cells.left(); c <= cells.right(); ++c)
+            m_cells[r * m_columns + c].removeOne(index);
+    }
+}
+
+void ObjectRectGrid::clear()
+{
+    m_rects.clear();
+    m_rectCells.clear();
+    m_cells.clear();
+    m_columns = m_rows = 0;
+}
+
+bool ObjectRectGrid::isEmpty() const
+{
+    return m_rects.isEmpty();
+}
+
+// rects and points out of the page go to the cells at its border
+int ObjectRectGrid::column(double x) const
+{
+    return qBound(0, int(std::floor(x * m_columns)), m_columns - 1);
+}
+
+int ObjectRectGrid::row(double y) const
+{
+    return qBound(0, int(std::floor(y * m_rows)), m_rows - 1);
+}
+
+QVector<int> ObjectRectGrid::candidates(double x, double y, double xScale, double yScale, double maxDistanceSqr) const
+{
+    QVector<int> result;
+    if (m_rects.isEmpty())
+        return result;
+
+    // the cells of the rects that can be that close
+    const double radius = std::sqrt(maxDistanceSqr);
+    const double dx = xScale > 0 ? radius / xScale : 1;
+    const double dy = yScale > 0 ? radius / yScale : 1;
+    const int right = column(x + dx);
+    const int bottom = row(y + dy);
+    for (int r = row(y - dy); r <= bottom; ++r) {
+        for (int c = column(x - dx); c <= right; ++c)
+            result += m_cells.at(r * m_columns + c);
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+const ObjectRect *ObjectRectGrid::last(double x, double y, double xScale, double yScale, double maxDistanceSqr) const
+{
+    const QVector<int> indexes = candidates(x, y, xScale, yScale, maxDistanceSqr);
+    for (int i = indexes.count() - 1; i >= 0; --i) {
+        const ObjectRect *rect = m_rects.at(indexes.at(i));
+        if (rect->distanceSqr(x, y, xScale, yScale) < maxDistanceSqr)
+            return rect;
+    }
+    return nullptr;
+}
+
+QLinkedList<const ObjectRect *> ObjectRectGrid::all(double x, double y, double xScale, double yScale, double maxDistanceSqr) const
+{
+    QLinkedList<const ObjectRect *> result;
+    const QVector<int> indexes = candidates(x, y, xScale, yScale, maxDistanceSqr);
+    for (int i = indexes.count() - 1; i >= 0; --i) {
+        const ObjectRect *rect = m_rects.at(indexes.at(i));
+        if (rect->distanceSqr(x, y, xScale, yScale) < maxDistanceSqr)
+            result.append(rect);
+    }
+    return result;
+}
+
+const ObjectRect *ObjectRectGrid::nearest(double x, double y, double xScale, double yScale, double *distance) const
+{
+    int best = -1;
+    double minDistance = std::numeric_limits<double>::max();
+    if (distance)
+        *distance = minDistance;
+    if (m_rects.isEmpty())
+        return nullptr;
+
+    // rings of cells around the one of the point, until no farther cell can
+    // have a closer rect
+    const int column0 = column(x);
+    const int row0 = row(y);
+    for (int ring = 0;; ++ring) {
+        const int left = column0 - ring, right = column0 + ring;
+        const int top = row0 - ring, bottom = row0 + ring;
+        for (int r = qMax(0, top); r <= qMin(m_rows - 1, bottom); ++r) {
+            for (int c = qMax(0, left); c <= qMin(m_columns - 1, right); ++c) {
+                if (r != top && r != bottom && c != left && c != right)
+                    continue;
+                for (const int i : m_cells.at(r * m_columns + c)) {
+                    const double d = m_rects.at(i)->distanceSqr(x, y, xScale, yScale);
+                    if (d < minDistance || (d == minDistance && i < best)) {
+                        best = i;
+                        minDistance = d;
+                    }
+                }
+            }
+        }
+
+        // how far the cells not looked at yet are, at least
+        double bound = std::numeric_limits<double>::max();
+        if (left > 0)
+            bound = qMin(bound, (x - double(left) / m_columns) * xScale);
+        if (right < m_columns - 1)
+            bound = qMin(bound, (double(right + 1) / m_columns - x) * xScale);
+        if (top > 0)
+            bound = qMin(bound, (y - double(top) / m_rows) * yScale);
+        if (bottom < m_rows - 1)
+            bound = qMin(bound, (double(bottom + 1) / m_rows - y) * yScale);
+        if (bound == std::numeric_limits<double>::max() || (best >= 0 && minDistance < bound * bound))
+            break;
+    }
+
+    if (distance)
+        *distance = minDistance;
+    return best >= 0 ? m_rects.at(best) : nullptr;
+}
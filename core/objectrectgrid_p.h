@@ -0,0 +1,102 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_OBJECTRECTGRID_P_H_
+#define _OKULAR_OBJECTRECTGRID_P_H_
+
+#include <QLinkedList>
+#include <QRect>
+#include <QSizeF>
+#include <QVector>
+
+#include "area.h"
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * A grid over the object rects of one type of a page, so finding the ones
+ * around a point only looks at the rects of the cells near it.
+ *
+ * The rects are put in the cells their bounding rect covers, in normalized
+ * coordinates; that is all Action and Image rects are measured by, see
+ * ObjectRect::distanceSqr(). Annotations are measured by their boundary and
+ * the pen along their lines, so they go in the cells of their boundary grown
+ * by the pen width. The grid keeps the order of the rects on the page, so the
+ * same rect wins as when going through the list. It holds pointers to the
+ * rects: build it again when they change or are transformed, or add(),
+ * remove() and update() the few that did.
+ */
+class OKULARCORE_EXPORT ObjectRectGrid
+{
+public:
+    ObjectRectGrid();
+
+    /**
+     * Indexes the rects of @p type in @p rects. @p pageSize is the size of
+     * the page the pen widths of the annotations are relative to.
+     */
+    void build(const QLinkedList<ObjectRect *> &rects, ObjectRect::ObjectType type, const QSizeF &pageSize = QSizeF());
+
+    /**
+     * Adds @p rect after the rects of the grid, like when appending it to the
+     * list.
+     */
+    void add(const ObjectRect *rect, const QSizeF &pageSize = QSizeF());
+
+    /**
+     * Removes @p rect, before it is deleted.
+     */
+    void remove(const ObjectRect *rect);
+
+    /**
+     * Puts @p rect in the cells it covers now, after it moved or changed size.
+     */
+    void update(const ObjectRect *rect, const QSizeF &pageSize = QSizeF());
+
+    void clear();
+
+    bool isEmpty() const;
+
+    /**
+     * The last rect closer than the square root of @p maxDistanceSqr to
+     * the point, like going through the list from the end.
+     */
+    const ObjectRect *last(double x, double y, double xScale, double yScale, double maxDistanceSqr) const;
+
+    /**
+     * All the rects closer than the square root of @p maxDistanceSqr to the
+     * point, from the last one in the list to the first one.
+     */
+    QLinkedList<const ObjectRect *> all(double x, double y, double xScale, double yScale, double maxDistanceSqr) const;
+
+    /**
+     * The rect closest to the point, the first one in the list if several
+     * are as close. @p distance gets the squared distance to it.
+     */
+    const ObjectRect *nearest(double x, double y, double xScale, double yScale, double *distance) const;
+
+private:
+    int column(double x) const;
+    int row(double y) const;
+    QVector<int> candidates(double x, double y, double xScale, double yScale, double maxDistanceSqr) const;
+    void layout(const QSizeF &pageSize);
+    void place(int index, const QSizeF &pageSize);
+    void unplace(int index);
+
+    // in the order of the list
+    QVector<const ObjectRect *> m_rects;
+    // the cells each rect is in, by column and row
+    QVector<QRect> m_rectCells;
+    int m_columns;
+    int m_rows;
+    // the indexes in m_rects of the rects covering each cell, row by row, in order
+    QVector<QVector<int>> m_cells;
+};
+
+}
+
+#endif
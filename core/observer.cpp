@@ -49,3 +49,17 @@ bool DocumentObserver::canUnloadPixmap(int) const
 void DocumentObserver::notifyCurrentPageChanged(int, int)
 {
 }
+
+void DocumentObserver::notifyPagesChanged(const QVector<int> &pages, int flags)
+{
+    for (int page : pages)
+        notifyPageChanged(page, flags);
+}
+
+void DocumentObserver::notifyAnnotationsChanged(int page, const QVector<Okular::Annotation *> &added, const QVector<Okular::Annotation *> &removed, const QVector<Okular::Annotation *> &modified)
+{
+    Q_UNUSED(added)
+    Q_UNUSED(removed)
+    Q_UNUSED(modified)
+    notifyPageChanged(page, DocumentObserver::Annotations);
+}
@@ -17,6 +17,7 @@
 
 namespace Okular
 {
+class Annotation;
 class Page;
 
 /**
@@ -42,13 +43,14 @@ public:
      * inform them about the type of object that has been changed.
      */
     enum ChangedFlags {
-        Pixmap = 1,        ///< Pixmaps has been changed
-        Bookmark = 2,      ///< Bookmarks has been changed
-        Highlights = 4,    ///< Highlighting information has been changed
-        TextSelection = 8, ///< Text selection has been changed
-        Annotations = 16,  ///< Annotations have been changed
-        BoundingBox = 32,  ///< Bounding boxes have been changed
-        NeedSaveAs = 64    ///< Set when "Save" is needed or annotation/form changes will be lost @since 0.15 (KDE 4.9) @deprecated
+        Pixmap = 1,         ///< Pixmaps has been changed
+        Bookmark = 2,       ///< Bookmarks has been changed
+        Highlights = 4,     ///< Highlighting information has been changed
+        TextSelection = 8,  ///< Text selection has been changed
+        Annotations = 16,   ///< Annotations have been changed
+        BoundingBox = 32,   ///< Bounding boxes have been changed
+        NeedSaveAs = 64,    ///< Set when "Save" is needed or annotation/form changes will be lost @since 0.15 (KDE 4.9) @deprecated
+        SignatureInfo = 128 ///< The information of the signature form fields has been changed, e.g. their certificates were verified @since 21.12
     };
 
     /**
@@ -115,6 +117,33 @@ public:
      */
     virtual void notifyCurrentPageChanged(int previous, int current);
 
+    /**
+     * This method is called whenever the content described by the passed
+     * @p flags has been changed on several pages at once, e.g. the highlights
+     * of a search. The changes of an event loop iteration are gathered in
+     * one notification for each set of flags, its @p pages in order.
+     *
+     * The default implementation calls notifyPageChanged() for each page.
+     *
+     * @since 21.12
+     */
+    virtual void notifyPagesChanged(const QVector<int> &pages, int flags);
+
+    /**
+     * This method is called when annotations of @p page were added, removed
+     * or modified through the document, with what changed since the last
+     * notification: @p added and @p modified are on the page, @p removed were
+     * deleted already and are only good to compare with the annotations seen
+     * before. Changes the document knows no details of are still notified
+     * with notifyPageChanged() and the Annotations flag.
+     *
+     * The default implementation calls notifyPageChanged() with the
+     * Annotations flag.
+     *
+     * @since 21.12
+     */
+    virtual void notifyAnnotationsChanged(int page, const QVector<Okular::Annotation *> &added, const QVector<Okular::Annotation *> &removed, const QVector<Okular::Annotation *> &modified);
+
 private:
     class Private;
     const Private *d;
@@ -0,0 +1,293 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "outline.h"
+
+#include <QHash>
+#include <QPair>
+#include <QStack>
+#include <QVariant>
+#include <QVector>
+
+#include "document.h"
+
+using namespace Okular;
+
+namespace
+{
+struct Node {
+    qint32 parent;
+    qint32 firstChild;
+    qint32 lastChild;
+    qint32 nextSibling;
+    qint32 childCount;
+    // in Outline::Private::strings
+    quint32 title;
+    quint32 viewportName;
+    quint32 externalFileName;
+    quint32 url;
+    // in Outline::Private::viewports, -1 for none
+    qint32 viewport;
+    bool open;
+};
+}
+
+class Outline::Private
+{
+public:
+    Private()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        nodes.clear();
+        viewports.clear();
+        strings.clear();
+        stringIds.clear();
+        // 0 is the empty string, what most of the attributes are
+        strings.append(QString());
+        rootFirstChild = -1;
+        rootLastChild = -1;
+        rootChildCount = 0;
+    }
+
+    quint32 intern(const QString &string)
+    {
+        if (string.isEmpty())
+            return 0;
+
+        const auto it = stringIds.constFind(string);
+        if (it != stringIds.constEnd())
+            return *it;
+
+        const quint32 id = strings.count();
+        strings.append(string);
+        stringIds.insert(string, id);
+        return id;
+    }
+
+    const Node *node(int item) const
+    {
+        return item >= 0 && item < nodes.count() ? &nodes.at(item) : nullptr;
+    }
+
+    Node *node(int item)
+    {
+        return item >= 0 && item < nodes.count() ? &nodes[item] : nullptr;
+    }
+
+    QString string(int item, quint32 Node::*field) const
+    {
+        const Node *n = node(item);
+        return n ? strings.at(n->*field) : QString();
+    }
+
+    QVector<Node> nodes;
+    QVector<DocumentViewport> viewports;
+    QVector<QString> strings;
+    // the keys share their data with strings
+    QHash<QString, quint32> stringIds;
+    qint32 rootFirstChild;
+    qint32 rootLastChild;
+    qint32 rootChildCount;
+};
+
+Outline::Outline()
+    : d(new Private)
+{
+}
+
+Outline::Outline(const DocumentSynopsis &synopsis)
+    : d(new Private)
+{
+    fill(synopsis);
+}
+
+Outline::~Outline()
+{
+    delete d;
+}
+
+void Outline::fill(const DocumentSynopsis &synopsis)
+{
+    d->clear();
+
+    // the same walk TOCModel did of the DOM, without recursion
+    QStack<QPair<QDomNode, int>> todo;
+    todo.push(qMakePair(synopsis.firstChild(), -1));
+    while (!todo.isEmpty()) {
+        QPair<QDomNode, int> &top = todo.top();
+        if (top.first.isNull()) {
+            todo.pop();
+            continue;
+        }
+
+        const QDomElement e = top.first.toElement();
+        top.first = top.first.nextSibling();
+
+        const int item = appendItem(top.second, e.tagName());
+        if (e.hasAttribute(QStringLiteral("Viewport")))
+            setViewport(item, DocumentViewport(e.attribute(QStringLiteral("Viewport"))));
+        else if (e.hasAttribute(QStringLiteral("ViewportName")))
+            setViewportName(item, e.attribute(QStringLiteral("ViewportName")));
+        setExternalFileName(item, e.attribute(QStringLiteral("ExternalFileName")));
+        setUrl(item, e.attribute(QStringLiteral("URL")));
+        if (e.hasAttribute(QStringLiteral("Open")))
+            setOpen(item, QVariant(e.attribute(QStringLiteral("Open"))).toBool());
+
+        if (e.hasChildNodes())
+            todo.push(qMakePair(e.firstChild(), item));
+    }
+}
+
+int Outline::appendItem(int parent, const QString &title)
+{
+    const int item = d->nodes.count();
+    d->nodes.append({parent, -1, -1, -1, 0, d->intern(title), 0, 0, 0, -1, false});
+
+    Node *parentNode = d->node(parent);
+    qint32 &firstChild = parentNode ? parentNode->firstChild : d->rootFirstChild;
+    qint32 &lastChild = parentNode ? parentNode->lastChild : d->rootLastChild;
+    qint32 &childCount = parentNode ? parentNode->childCount : d->rootChildCount;
+    if (Node *last = d->node(lastChild))
+        last->nextSibling = item;
+    else
+        firstChild = item;
+    lastChild = item;
+    ++childCount;
+
+    // an unknown parent makes a top level item
+    if (!parentNode)
+        d->nodes[item].parent = -1;
+    return item;
+}
+
+void Outline::setViewport(int item, const DocumentViewport &viewport)
+{
+    Node *n = d->node(item);
+    if (!n)
+        return;
+
+    if (n->viewport < 0) {
+        n->viewport = d->viewports.count();
+        d->viewports.append(viewport);
+    } else {
+        d->viewports[n->viewport] = viewport;
+    }
+}
+
+void Outline::setViewportName(int item, const QString &name)
+{
+    if (Node *n = d->node(item))
+        n->viewportName = d->intern(name);
+}
+
+void Outline::setExternalFileName(int item, const QString &fileName)
+{
+    if (Node *n = d->node(item))
+        n->externalFileName = d->intern(fileName);
+}
+
+void Outline::setUrl(int item, const QString &url)
+{
+    if (Node *n = d->node(item))
+        n->url = d->intern(url);
+}
+
+void Outline::setOpen(int item, bool open)
+{
+    if (Node *n = d->node(item))
+        n->open = open;
+}
+
+void Outline::clear()
+{
+    d->clear();
+}
+
+bool Outline::isEmpty() const
+{
+    return d->nodes.isEmpty();
+}
+
+int Outline::count() const
+{
+    return d->nodes.count();
+}
+
+int Outline::parent(int item) const
+{
+    const Node *n = d->node(item);
+    return n ? n->parent : -1;
+}
+
+int Outline::firstChild(int item) const
+{
+    if (item == -1)
+        return d->rootFirstChild;
+
+    const Node *n = d->node(item);
+    return n ? n->firstChild : -1;
+}
+
+int Outline::nextSibling(int item) const
+{
+    const Node *n = d->node(item);
+    return n ? n->nextSibling : -1;
+}
+
+int Outline::childCount(int item) const
+{
+    if (item == -1)
+        return d->rootChildCount;
+
+    const Node *n = d->node(item);
+    return n ? n->childCount : 0;
+}
+
+QString Outline::title(int item) const
+{
+    return d->string(item, &Node::title);
+}
+
+DocumentViewport Outline::viewport(int item) const
+{
+    const Node *n = d->node(item);
+    return n && n->viewport >= 0 ? d->viewports.at(n->viewport) : DocumentViewport();
+}
+
+QString Outline::viewportName(int item) const
+{
+    return d->string(item, &Node::viewportName);
+}
+
+QString Outline::externalFileName(int item) const
+{
+    return d->string(item, &Node::externalFileName);
+}
+
+QString Outline::url(int item) const
+{
+    return d->string(item, &Node::url);
+}
+
+bool Outline::isOpen(int item) const
+{
+    const Node *n = d->node(item);
+    return n && n->open;
+}
+
+qulonglong Outline::memoryUsage() const
+{
+    qulonglong bytes = d->nodes.capacity() * sizeof(Node) + d->viewports.capacity() * sizeof(DocumentViewport);
+    for (const QString &string : qAsConst(d->strings))
+        bytes += sizeof(QString) + string.capacity() * sizeof(QChar);
+    // the buckets of the hash, the keys are the same strings
+    bytes += d->stringIds.capacity() * (sizeof(QString) + sizeof(quint32) + 2 * sizeof(void *));
+    return bytes;
+}
@@ -0,0 +1,140 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_OUTLINE_H_
+#define _OKULAR_OUTLINE_H_
+
+#include <QString>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+class DocumentSynopsis;
+class DocumentViewport;
+
+/**
+ * @short The table of contents of a document, in a compact form.
+ *
+ * It holds the same entries as a DocumentSynopsis, for a fraction of its
+ * memory: the items are numbered from 0 in a flat array, linked to their
+ * parent, first child and next sibling by number, and the strings they share
+ * (e.g. the names of the destinations, the external files) are stored once.
+ *
+ * Items are referred to by their number; -1 is the root, the parent of the
+ * top level items. Asking about an item that is not there returns empty
+ * values, so a stale number is harmless.
+ *
+ * @see Generator::generateOutline(), Document::outline()
+ *
+ * @since 21.12
+ */
+class OKULARCORE_EXPORT Outline
+{
+public:
+    /**
+     * Creates an empty outline.
+     */
+    Outline();
+
+    /**
+     * Creates the outline of the entries of @p synopsis.
+     */
+    explicit Outline(const DocumentSynopsis &synopsis);
+
+    ~Outline();
+
+    Outline(const Outline &) = delete;
+    Outline &operator=(const Outline &) = delete;
+
+    /**
+     * Adds an item titled @p title after the last child of @p parent, and
+     * returns its number.
+     */
+    int appendItem(int parent, const QString &title);
+
+    void setViewport(int item, const DocumentViewport &viewport);
+
+    /**
+     * Sets the named destination of @p item, resolved with the
+     * "NamedViewport" metadata of the document; used if it has no viewport.
+     */
+    void setViewportName(int item, const QString &name);
+
+    void setExternalFileName(int item, const QString &fileName);
+
+    /**
+     * Sets the URL @p item opens; if set, the other destinations are not used.
+     */
+    void setUrl(int item, const QString &url);
+
+    /**
+     * Sets whether the branch of @p item is open.
+     */
+    void setOpen(int item, bool open);
+
+    /**
+     * Removes all the items.
+     */
+    void clear();
+
+    /**
+     * Replaces the items with the entries of @p synopsis.
+     */
+    void fill(const DocumentSynopsis &synopsis);
+
+    bool isEmpty() const;
+
+    /**
+     * The number of items, at all levels.
+     */
+    int count() const;
+
+    /**
+     * The parent of @p item, -1 for the top level items.
+     */
+    int parent(int item) const;
+
+    /**
+     * The first child of @p item, or -1 if it has none.
+     */
+    int firstChild(int item) const;
+
+    /**
+     * The item after @p item with the same parent, or -1 if it is the last.
+     */
+    int nextSibling(int item) const;
+
+    int childCount(int item) const;
+
+    QString title(int item) const;
+
+    /**
+     * The viewport of @p item, invalid if it has none.
+     */
+    DocumentViewport viewport(int item) const;
+
+    QString viewportName(int item) const;
+
+    QString externalFileName(int item) const;
+
+    QString url(int item) const;
+
+    bool isOpen(int item) const;
+
+    /**
+     * Returns an approximation of the memory of the outline, in bytes.
+     */
+    qulonglong memoryUsage() const;
+
+private:
+    class Private;
+    Private *const d;
+};
+
+}
+
+#endif
@@ -14,9 +14,11 @@
 #include <QDomDocument>
 #include <QDomElement>
 #include <QHash>
+#include <QPainter>
 #include <QPixmap>
 #include <QSet>
 #include <QString>
+#include <QUrl>
 #include <QUuid>
 #include <QVariant>
 
@@ -35,12 +37,14 @@
 #include "pagecontroller_p.h"
 #include "pagesize.h"
 #include "pagetransition.h"
+#include "requesttrace_p.h"
 #include "rotationjob_p.h"
 #include "textpage_p.h"
 #include "tile.h"
 #include "tilesmanager_p.h"
 #include "utils_p.h"
 
+#include <algorithm>
 #include <limits>
 
 #ifdef PAGE_PROFILE
@@ -50,6 +54,12 @@
 using namespace Okular;
 
 static const double distanceConsideredEqual = 25; // 5px
+// width of the previews of the pages, in pixels
+static const int kPreviewWidth = 256;
+// a rough size of an annotation and its private data, without its text and points
+static const int kAnnotationSize = 512;
+// a point of a line or ink annotation, in the list of the points and in the one of their transformed copies
+static const int kAnnotationPointSize = 2 * (sizeof(NormalizedPoint) + 2 * sizeof(void *));
 
 static void deleteObjectRects(QLinkedList<ObjectRect *> &rects, const QSet<ObjectRect::ObjectType> &which)
 {
@@ -64,20 +74,22 @@ static void deleteObjectRects(QLinkedList<ObjectRect *> &rects, const QSet<Objec
 
 PagePrivate::PagePrivate(Page *page, uint n, double w, double h, Rotation o)
     : m_page(page)
-    , m_number(n)
-    , m_orientation(o)
+    , m_doc(nullptr)
+    , m_text(nullptr)
+    , m_textSelections(nullptr)
     , m_width(w)
     , m_height(h)
-    , m_doc(nullptr)
     , m_boundingBox(0, 0, 1, 1)
+    , m_number(n)
+    , m_orientation(o)
     , m_rotation(Rotation0)
-    , m_text(nullptr)
-    , m_transition(nullptr)
-    , m_textSelections(nullptr)
-    , m_openingAction(nullptr)
-    , m_closingAction(nullptr)
-    , m_duration(-1)
     , m_isBoundingBoxKnown(false)
+    , m_isBoundingBoxApproximate(false)
+    , m_textUrlsAdded(false)
+    , m_hasNoText(false)
+    , m_objectRectGridsValid(false)
+    , m_annotationGridValid(false)
+    , m_extra(nullptr)
 {
     // avoid Division-By-Zero problems in the program
     if (m_width <= 0)
@@ -89,11 +101,29 @@ PagePrivate::PagePrivate(Page *page, uint n, double w, double h, Rotation o)
 
 PagePrivate::~PagePrivate()
 {
-    qDeleteAll(formfields);
-    delete m_openingAction;
-    delete m_closingAction;
     delete m_text;
-    delete m_transition;
+    delete m_extra;
+}
+
+PagePrivate::Extra::~Extra()
+{
+    qDeleteAll(formfields);
+    delete openingAction;
+    delete closingAction;
+    delete transition;
+}
+
+PagePrivate::Extra *PagePrivate::extra() const
+{
+    if (!m_extra)
+        m_extra = new Extra;
+    return m_extra;
+}
+
+const QLinkedList<FormField *> &PagePrivate::formFields() const
+{
+    static const QLinkedList<FormField *> noFormFields;
+    return m_extra ? m_extra->formfields : noFormFields;
 }
 
 PagePrivate *PagePrivate::get(Page *page)
@@ -101,30 +131,38 @@ PagePrivate *PagePrivate::get(Page *page)
     return page ? page->d : nullptr;
 }
 
+bool PagePrivate::needsBoundingBox() const
+{
+    return !m_isBoundingBoxKnown || m_isBoundingBoxApproximate;
+}
+
 void PagePrivate::imageRotationDone(RotationJob *job)
 {
+    // the job has no use for the image any more, the pixmap can take its memory
     TilesManager *tm = tilesManager(job->observer());
     if (tm) {
-        QPixmap *pixmap = new QPixmap(QPixmap::fromImage(job->image()));
-        tm->setPixmap(pixmap, job->rect(), job->isPartialUpdate());
-        delete pixmap;
+        const QPixmap pixmap = QPixmap::fromImage(job->takeImage());
+        tm->setPixmap(&pixmap, job->rect(), job->isPartialUpdate());
         return;
     }
 
     QMap<DocumentObserver *, PixmapObject>::iterator it = m_pixmaps.find(job->observer());
     if (it != m_pixmaps.end()) {
         PixmapObject &object = it.value();
-        (*object.m_pixmap) = QPixmap::fromImage(job->image());
+        (*object.m_pixmap) = QPixmap::fromImage(job->takeImage());
         object.m_rotation = job->rotation();
         object.m_isPartialPixmap = job->isPartialUpdate();
     } else {
         PixmapObject object;
-        object.m_pixmap = new QPixmap(QPixmap::fromImage(job->image()));
+        object.m_pixmap = new QPixmap(QPixmap::fromImage(job->takeImage()));
         object.m_rotation = job->rotation();
         object.m_isPartialPixmap = job->isPartialUpdate();
 
         m_pixmaps.insert(job->observer(), object);
     }
+
+    if (!job->isPartialUpdate() && job->rotation() == m_rotation)
+        updatePreview(*m_pixmaps.value(job->observer()).m_pixmap);
 }
 
 QTransform PagePrivate::rotationMatrix() const
@@ -200,6 +238,7 @@ bool Page::isBoundingBoxKnown() const
 
 void Page::setBoundingBox(const NormalizedRect &bbox)
 {
+    d->m_isBoundingBoxApproximate = false;
     if (d->m_isBoundingBoxKnown && d->m_boundingBox == bbox)
         return;
 
@@ -242,6 +281,16 @@ bool Page::hasPixmap(DocumentObserver *observer, int width, int height, const No
     return (pixmap->width() == width && pixmap->height() == height);
 }
 
+const QPixmap *Page::pixmap(DocumentObserver *observer) const
+{
+    return d->m_pixmaps.value(observer).m_pixmap;
+}
+
+QPixmap Page::preview() const
+{
+    return d->m_preview;
+}
+
 bool Page::hasTextPage() const
 {
     return d->m_text != nullptr;
@@ -279,7 +328,7 @@ bool Page::hasObjectRect(double x, double y, double xScale, double yScale) const
 bool Page::hasHighlights(int s_id) const
 {
     // simple case: have no highlights
-    if (m_highlights.isEmpty())
+    if (m_highlights.isEmpty() && d->m_searchHighlights.isEmpty())
         return false;
     // simple case: we have highlights and no id to match
     if (s_id == -1)
@@ -289,12 +338,26 @@ bool Page::hasHighlights(int s_id) const
     for (; it != end; ++it)
         if ((*it)->s_id == s_id)
             return true;
-    return false;
+    return std::any_of(d->m_searchHighlights.cbegin(), d->m_searchHighlights.cend(), [s_id](const PagePrivate::SearchHighlight &highlight) { return highlight.id == s_id; });
+}
+
+void Page::highlightAreas(const NormalizedRect &rect, QList<QPair<QColor, NormalizedRect>> *areas) const
+{
+    for (const HighlightAreaRect *highlight : qAsConst(m_highlights)) {
+        for (const NormalizedRect &area : *highlight) {
+            if (area.intersects(rect))
+                areas->append(qMakePair(highlight->color, area));
+        }
+    }
+    for (const PagePrivate::SearchHighlight &highlight : qAsConst(d->m_searchHighlights)) {
+        if (highlight.area.intersects(rect))
+            areas->append(qMakePair(highlight.color, highlight.area));
+    }
 }
 
 bool Page::hasTransition() const
 {
-    return d->m_transition != nullptr;
+    return d->m_extra && d->m_extra->transition;
 }
 
 bool Page::hasAnnotations() const
@@ -404,11 +467,17 @@ void PagePrivate::rotateAt(Rotation orientation)
     const QTransform matrix = rotationMatrix();
     for (ObjectRect *objRect : qAsConst(m_page->m_rects))
         objRect->transform(matrix);
+    objectRectsChanged();
+    annotationsChanged();
 
     const QTransform highlightRotationMatrix = Okular::buildRotationMatrix((Rotation)(((int)m_rotation - (int)oldRotation + 4) % 4));
+    if (!m_preview.isNull())
+        m_preview = m_preview.transformed(QTransform().rotate(90 * (((int)m_rotation - (int)oldRotation + 4) % 4)));
     for (HighlightAreaRect *hlar : qAsConst(m_page->m_highlights)) {
         hlar->transform(highlightRotationMatrix);
     }
+    for (SearchHighlight &highlight : m_searchHighlights)
+        highlight.area.transform(highlightRotationMatrix);
 }
 
 void PagePrivate::changeSize(const PageSize &size)
@@ -416,18 +485,145 @@ void PagePrivate::changeSize(const PageSize &size)
     if (size.isNull() || (size.width() == m_width && size.height() == m_height))
         return;
 
-    m_page->deletePixmaps();
+    m_page->setSize(size.width(), size.height());
+}
+
+void Page::setSize(double width, double height)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    if (d->m_rotation % 2)
+        qSwap(width, height);
+    if (width == d->m_width && height == d->m_height)
+        return;
+
+    deletePixmaps();
+    // it would be stretched
+    if (!d->m_preview.isNull() && d->m_doc)
+        d->m_doc->setPagePreview(d->m_number, qulonglong(d->m_preview.width()) * d->m_preview.height() * 4, 0);
+    d->m_preview = QPixmap();
     //    deleteHighlights();
     //    deleteTextSelections();
 
-    m_width = size.width();
-    m_height = size.height();
-    if (m_rotation % 2)
-        qSwap(m_width, m_height);
+    d->m_width = width;
+    d->m_height = height;
+}
+
+void Page::setOrientation(Rotation orientation)
+{
+    if (orientation == d->m_orientation)
+        return;
+
+    deletePixmaps();
+    if (!d->m_preview.isNull() && d->m_doc)
+        d->m_doc->setPagePreview(d->m_number, qulonglong(d->m_preview.width()) * d->m_preview.height() * 4, 0);
+    d->m_preview = QPixmap();
+    d->deleteTextSelections();
+
+    d->m_orientation = orientation;
+}
+
+const ObjectRectGrid *PagePrivate::objectRectGrid(ObjectRect::ObjectType type) const
+{
+    if (type == ObjectRect::OAnnotation) {
+        // most pages have none, the list is as fast then
+        if (m_page->m_annotations.isEmpty())
+            return nullptr;
+
+        Extra *e = extra();
+        if (!m_annotationGridValid) {
+            e->annotationGrid.build(m_page->m_rects, ObjectRect::OAnnotation, QSizeF(m_width, m_height));
+            m_annotationGridValid = true;
+        }
+        return &e->annotationGrid;
+    }
+
+    if (type != ObjectRect::Action && type != ObjectRect::Image)
+        return nullptr;
+
+    Extra *e = extra();
+    if (!m_objectRectGridsValid) {
+        e->actionGrid.build(m_page->m_rects, ObjectRect::Action);
+        e->imageGrid.build(m_page->m_rects, ObjectRect::Image);
+        m_objectRectGridsValid = true;
+    }
+    return type == ObjectRect::Action ? &e->actionGrid : &e->imageGrid;
+}
+
+void PagePrivate::objectRectsChanged()
+{
+    m_objectRectGridsValid = false;
+    if (m_extra) {
+        m_extra->actionGrid.clear();
+        m_extra->imageGrid.clear();
+    }
+}
+
+void PagePrivate::annotationsChanged()
+{
+    m_annotationGridValid = false;
+    if (m_extra)
+        m_extra->annotationGrid.clear();
+}
+
+void PagePrivate::annotationRectAdded(const ObjectRect *rect)
+{
+    if (m_annotationGridValid && m_extra)
+        m_extra->annotationGrid.add(rect, QSizeF(m_width, m_height));
+}
+
+void PagePrivate::annotationRectRemoved(const ObjectRect *rect)
+{
+    if (m_annotationGridValid && m_extra)
+        m_extra->annotationGrid.remove(rect);
+}
+
+void PagePrivate::annotationMoved(const Annotation *annotation)
+{
+    if (!m_annotationGridValid || !m_extra)
+        return;
+
+    for (const ObjectRect *rect : qAsConst(m_page->m_rects)) {
+        if (rect->objectType() == ObjectRect::OAnnotation && rect->object() == annotation) {
+            m_extra->annotationGrid.update(rect, QSizeF(m_width, m_height));
+            return;
+        }
+    }
+}
+
+void PagePrivate::addTextUrls()
+{
+    if (m_textUrlsAdded || !m_text || m_text->d->m_urls.isEmpty())
+        return;
+    m_textUrlsAdded = true;
+
+    const QTransform matrix = rotationMatrix();
+    QLinkedList<ObjectRect *> rects;
+    for (const TextPageUrl &url : qAsConst(m_text->d->m_urls)) {
+        // the generator knows better where its links go
+        NormalizedRect area = url.area;
+        area.transform(matrix);
+        const NormalizedPoint center = area.center();
+        if (m_page->objectRect(ObjectRect::Action, center.x, center.y, 1.0, 1.0))
+            continue;
+
+        ObjectRect *rect = new ObjectRect(url.area, false, ObjectRect::Action, new BrowseAction(QUrl(url.url)));
+        rect->transform(matrix);
+        rects.append(rect);
+    }
+
+    if (!rects.isEmpty()) {
+        m_page->m_rects << rects;
+        objectRectsChanged();
+    }
 }
 
 const ObjectRect *Page::objectRect(ObjectRect::ObjectType type, double x, double y, double xScale, double yScale) const
 {
+    if (const ObjectRectGrid *grid = d->objectRectGrid(type))
+        return grid->last(x, y, xScale, yScale, distanceConsideredEqual);
+
     // Walk list in reverse order so that annotations in the foreground are preferred
     QLinkedListIterator<ObjectRect *> it(m_rects);
     it.toBack();
@@ -442,6 +638,9 @@ const ObjectRect *Page::objectRect(ObjectRect::ObjectType type, double x, double
 
 QLinkedList<const ObjectRect *> Page::objectRects(ObjectRect::ObjectType type, double x, double y, double xScale, double yScale) const
 {
+    if (const ObjectRectGrid *grid = d->objectRectGrid(type))
+        return grid->all(x, y, xScale, yScale, distanceConsideredEqual);
+
     QLinkedList<const ObjectRect *> result;
 
     QLinkedListIterator<ObjectRect *> it(m_rects);
@@ -457,6 +656,9 @@ QLinkedList<const ObjectRect *> Page::objectRects(ObjectRect::ObjectType type, d
 
 const ObjectRect *Page::nearestObjectRect(ObjectRect::ObjectType type, double x, double y, double xScale, double yScale, double *distance) const
 {
+    if (const ObjectRectGrid *grid = d->objectRectGrid(type))
+        return grid->nearest(x, y, xScale, yScale, distance);
+
     ObjectRect *res = nullptr;
     double minDistance = std::numeric_limits<double>::max();
 
@@ -478,7 +680,7 @@ const ObjectRect *Page::nearestObjectRect(ObjectRect::ObjectType type, double x,
 
 const PageTransition *Page::transition() const
 {
-    return d->m_transition;
+    return d->m_extra ? d->m_extra->transition : nullptr;
 }
 
 QLinkedList<Annotation *> Page::annotations() const
@@ -497,12 +699,15 @@ Annotation *Page::annotation(const QString &uniqueName) const
 
 const Action *Page::pageAction(PageAction action) const
 {
+    if (!d->m_extra)
+        return nullptr;
+
     switch (action) {
     case Page::Opening:
-        return d->m_openingAction;
+        return d->m_extra->openingAction;
         break;
     case Page::Closing:
-        return d->m_closingAction;
+        return d->m_extra->closingAction;
         break;
     }
 
@@ -511,11 +716,12 @@ const Action *Page::pageAction(PageAction action) const
 
 QLinkedList<FormField *> Page::formFields() const
 {
-    return d->formfields;
+    return d->formFields();
 }
 
 void Page::setPixmap(DocumentObserver *observer, QPixmap *pixmap, const NormalizedRect &rect)
 {
+    RequestTrace::Scope trace("Page::setPixmap", RequestTrace::pageArgs(observer, d->m_number, pixmap ? pixmap->width() : 0, pixmap ? pixmap->height() : 0, !rect.isNull()));
     d->setPixmap(observer, pixmap, rect, false /*isPartialPixmap*/);
 }
 
@@ -538,6 +744,12 @@ void PagePrivate::setPixmap(DocumentObserver *observer, QPixmap *pixmap, const N
         it.value().m_pixmap = pixmap;
         it.value().m_rotation = m_rotation;
         it.value().m_isPartialPixmap = isPartialPixmap;
+        if (!isPartialPixmap)
+            updatePreview(*pixmap);
+    } else if (TilesManager *tm = tilesManager(observer)) {
+        // the tiles are rotated one by one when they are painted
+        tm->setPixmap(pixmap, TilesManager::toRotatedRect(rect, m_rotation), isPartialPixmap, Rotation0);
+        delete pixmap;
     } else {
         // it can happen that we get a setPixmap while closing and thus the page controller is gone
         if (m_doc->m_pageController) {
@@ -552,16 +764,156 @@ void PagePrivate::setPixmap(DocumentObserver *observer, QPixmap *pixmap, const N
     }
 }
 
+bool PagePrivate::updatePartialPixmap(DocumentObserver *observer, const QImage &image, const QRect &rect)
+{
+    if (m_rotation != Rotation0 || tilesManager(observer))
+        return false;
+
+    QMap<DocumentObserver *, PagePrivate::PixmapObject>::iterator it = m_pixmaps.find(observer);
+    if (it == m_pixmaps.end() || !it.value().m_isPartialPixmap || it.value().m_pixmap->size() != image.size())
+        return false;
+
+    QPainter painter(it.value().m_pixmap);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.drawImage(rect.topLeft(), image, rect);
+    return true;
+}
+
+void PagePrivate::setRotatedPixmap(DocumentObserver *observer, QPixmap *pixmap)
+{
+    QMap<DocumentObserver *, PagePrivate::PixmapObject>::iterator it = m_pixmaps.find(observer);
+    if (it != m_pixmaps.end()) {
+        delete it.value().m_pixmap;
+    } else {
+        it = m_pixmaps.insert(observer, PagePrivate::PixmapObject());
+    }
+    it.value().m_pixmap = pixmap;
+    it.value().m_rotation = m_rotation;
+    it.value().m_isPartialPixmap = false;
+    updatePreview(*pixmap);
+}
+
+void PagePrivate::updatePreview(const QPixmap &pixmap)
+{
+    // a wider one only when it gets closer to the size of the previews
+    const int width = qMin(pixmap.width(), kPreviewWidth);
+    if (!m_doc || width <= m_preview.width())
+        return;
+
+    const qulonglong previousBytes = qulonglong(m_preview.width()) * m_preview.height() * 4;
+    m_preview = pixmap.width() > kPreviewWidth ? pixmap.scaledToWidth(kPreviewWidth, Qt::SmoothTransformation) : pixmap;
+    m_preview.setDevicePixelRatio(1);
+    m_doc->setPagePreview(m_number, previousBytes, qulonglong(m_preview.width()) * m_preview.height() * 4);
+}
+
+const QPixmap *PagePrivate::largerPixmap(const DocumentObserver *observer, int width, int height) const
+{
+    const QPixmap *result = nullptr;
+    QMap<DocumentObserver *, PagePrivate::PixmapObject>::const_iterator it = m_pixmaps.constBegin(), end = m_pixmaps.constEnd();
+    for (; it != end; ++it) {
+        const PixmapObject &object = it.value();
+        if (it.key() == observer || object.m_isPartialPixmap || object.m_rotation != m_rotation)
+            continue;
+
+        const QPixmap *pixmap = object.m_pixmap;
+        if (pixmap->width() < width || pixmap->height() < height)
+            continue;
+
+        // sizes are rounded differently by each observer, allow 1% of difference
+        const qint64 a = qint64(pixmap->width()) * height;
+        const qint64 b = qint64(pixmap->height()) * width;
+        if (qAbs(a - b) * 100 > qMax(a, b))
+            continue;
+
+        if (!result || pixmap->width() < result->width())
+            result = pixmap;
+    }
+    return result;
+}
+
+QPixmap PagePrivate::sharedRect(const DocumentObserver *observer, const NormalizedRect &rect, int width, int height) const
+{
+    const QRect target = rect.geometry(width, height);
+    if (target.isEmpty())
+        return QPixmap();
+
+    if (const QPixmap *pixmap = largerPixmap(observer, width, height))
+        return pixmap->copy(rect.geometry(pixmap->width(), pixmap->height())).scaled(target.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+
+    QMap<const DocumentObserver *, TilesManager *>::const_iterator it = m_tilesManagers.constBegin(), end = m_tilesManagers.constEnd();
+    for (; it != end; ++it) {
+        TilesManager *tilesManager = it.value();
+        if (it.key() == observer || tilesManager->rotation() != m_rotation || tilesManager->width() < width || tilesManager->height() < height || !tilesManager->hasPixmap(rect))
+            continue;
+
+        QPixmap result(target.size());
+        result.fill(Qt::white);
+        QPainter painter(&result);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        const QList<Tile> tiles = tilesManager->tilesAt(rect, TilesManager::PixmapTile);
+        for (const Tile &tile : tiles) {
+            const NormalizedRect tileRect = tile.rect();
+            const QRectF where((tileRect.left - rect.left) * width, (tileRect.top - rect.top) * height, tileRect.width() * width, tileRect.height() * height);
+            painter.drawPixmap(where, *tile.pixmap(), QRectF(tile.pixmap()->rect()));
+        }
+        return result;
+    }
+
+    return QPixmap();
+}
+
 void Page::setTextPage(TextPage *textPage)
 {
     delete d->m_text;
 
     d->m_text = textPage;
     if (d->m_text) {
-        d->m_text->d->m_page = this;
         // Correct/optimize text order for search and text selection
-        d->m_text->d->correctTextOrder();
+        if (d->m_text->d->m_page != this || !d->m_text->d->m_textOrderCorrected)
+            PagePrivate::layoutTextPage(this, d->m_text);
+        d->addTextUrls();
+        d->m_hasNoText = d->m_text->d->m_words.isEmpty();
+    }
+}
+
+void PagePrivate::layoutTextPage(Page *page, TextPage *textPage)
+{
+    textPage->d->m_page = page;
+    textPage->d->correctTextOrder();
+    textPage->d->detectUrls();
+}
+
+TextPage *PagePrivate::copyTextPage() const
+{
+    if (!m_text)
+        return nullptr;
+
+    TextPage *copy = new TextPage();
+    m_text->d->copyWords(copy->d);
+    return copy;
+}
+
+void PagePrivate::findAllText(TextPage *textPage, const QString &text, Qt::CaseSensitivity caseSensitivity, int word, TextMatches *matches)
+{
+    if (textPage->d->m_words.isEmpty() || text.isEmpty() || textPage->d->findAllTextFlat(text, caseSensitivity, word, matches))
+        return;
+
+    // not set on a page any more, so the matches are not rotated
+    Page *page = textPage->d->m_page;
+    textPage->d->m_page = nullptr;
+
+    // an id that no view uses
+    const int searchID = -1;
+    RegularAreaRect *match = textPage->findText(searchID, text, FromTop, caseSensitivity);
+    while (match) {
+        textPage->d->appendSearchPointMatch(searchID, word, matches);
+        RegularAreaRect *next = textPage->findText(searchID, text, NextResult, caseSensitivity, match);
+        delete match;
+        match = next;
     }
+    delete textPage->d->m_searchPoints.take(searchID);
+
+    textPage->d->m_page = page;
 }
 
 void Page::setObjectRects(const QLinkedList<ObjectRect *> &rects)
@@ -580,6 +932,11 @@ void Page::setObjectRects(const QLinkedList<ObjectRect *> &rects)
         (*objectIt)->transform(matrix);
 
     m_rects << rects;
+    d->objectRectsChanged();
+
+    // the links found in the text went with the old rects
+    d->m_textUrlsAdded = false;
+    d->addTextUrls();
 }
 
 void PagePrivate::setHighlight(int s_id, RegularAreaRect *rect, const QColor &color)
@@ -591,6 +948,21 @@ void PagePrivate::setHighlight(int s_id, RegularAreaRect *rect, const QColor &co
     m_page->m_highlights.append(hr);
 }
 
+void PagePrivate::addSearchHighlights(int id, const TextMatches &matches, const QVector<QColor> &wordColors)
+{
+    const QTransform matrix = rotationMatrix();
+    for (int match = 0; match < matches.count(); ++match) {
+        const QColor &color = wordColors.at(matches.word(match));
+        int begin, end;
+        matches.areas(match, &begin, &end);
+        for (int i = begin; i < end; ++i) {
+            NormalizedRect area = matches.area(i);
+            area.transform(matrix);
+            m_searchHighlights.append({area, color, id});
+        }
+    }
+}
+
 void PagePrivate::setTextSelections(RegularAreaRect *r, const QColor &color)
 {
     deleteTextSelections();
@@ -613,12 +985,13 @@ void Page::setSourceReferences(const QLinkedList<SourceRefObjectRect *> &refRect
 
 void Page::setDuration(double seconds)
 {
-    d->m_duration = seconds;
+    if (d->m_extra || seconds >= 0)
+        d->extra()->duration = seconds;
 }
 
 double Page::duration() const
 {
-    return d->m_duration;
+    return d->m_extra ? d->m_extra->duration : -1;
 }
 
 void Page::setLabel(const QString &label)
@@ -658,6 +1031,7 @@ void Page::addAnnotation(Annotation *annotation)
     annotation->d_ptr->annotationTransform(matrix);
 
     m_rects.append(rect);
+    d->annotationRectAdded(rect);
 }
 
 bool Page::removeAnnotation(Annotation *annotation)
@@ -672,6 +1046,7 @@ bool Page::removeAnnotation(Annotation *annotation)
             QLinkedList<ObjectRect *>::iterator it = m_rects.begin(), end = m_rects.end();
             for (; it != end && !rectfound; ++it)
                 if (((*it)->objectType() == ObjectRect::OAnnotation) && ((*it)->object() == (*aIt))) {
+                    d->annotationRectRemoved(*it);
                     delete *it;
                     it = m_rects.erase(it);
                     rectfound = true;
@@ -688,31 +1063,43 @@ bool Page::removeAnnotation(Annotation *annotation)
 
 void Page::setTransition(PageTransition *transition)
 {
-    delete d->m_transition;
-    d->m_transition = transition;
+    if (!d->m_extra && !transition)
+        return;
+
+    delete d->extra()->transition;
+    d->m_extra->transition = transition;
 }
 
 void Page::setPageAction(PageAction action, Action *link)
 {
+    if (!d->m_extra && !link)
+        return;
+
+    PagePrivate::Extra *e = d->extra();
     switch (action) {
     case Page::Opening:
-        delete d->m_openingAction;
-        d->m_openingAction = link;
+        delete e->openingAction;
+        e->openingAction = link;
         break;
     case Page::Closing:
-        delete d->m_closingAction;
-        d->m_closingAction = link;
+        delete e->closingAction;
+        e->closingAction = link;
         break;
     }
 }
 
 void Page::setFormFields(const QLinkedList<FormField *> &fields)
 {
-    qDeleteAll(d->formfields);
-    d->formfields = fields;
-    for (FormField *ff : qAsConst(d->formfields)) {
+    if (d->m_extra || !fields.isEmpty()) {
+        PagePrivate::Extra *e = d->extra();
+        qDeleteAll(e->formfields);
+        e->formfields = fields;
+    }
+    for (FormField *ff : fields) {
         ff->d_ptr->setDefault();
     }
+    if (d->m_doc)
+        d->m_doc->invalidateFormIndex();
 }
 
 void Page::deletePixmap(DocumentObserver *observer)
@@ -747,6 +1134,8 @@ void Page::deleteRects()
     QSet<ObjectRect::ObjectType> which;
     which << ObjectRect::Action << ObjectRect::Image;
     deleteObjectRects(m_rects, which);
+    d->objectRectsChanged();
+    d->m_textUrlsAdded = false;
 }
 
 void PagePrivate::deleteHighlights(int s_id)
@@ -761,6 +1150,12 @@ void PagePrivate::deleteHighlights(int s_id)
         } else
             ++it;
     }
+
+    if (s_id == -1) {
+        m_searchHighlights.clear();
+    } else {
+        m_searchHighlights.erase(std::remove_if(m_searchHighlights.begin(), m_searchHighlights.end(), [s_id](const SearchHighlight &highlight) { return highlight.id == s_id; }), m_searchHighlights.end());
+    }
 }
 
 void PagePrivate::deleteTextSelections()
@@ -781,6 +1176,7 @@ void Page::deleteAnnotations()
     // delete all stored annotations
     qDeleteAll(m_annotations);
     m_annotations.clear();
+    d->annotationsChanged();
 }
 
 bool PagePrivate::restoreLocalContents(const QDomNode &pageNode)
@@ -800,6 +1196,7 @@ bool PagePrivate::restoreLocalContents(const QDomNode &pageNode)
             time.start();
 #endif
             // Clone annotationList as root node in restoredLocalAnnotationList
+            QDomDocument &restoredLocalAnnotationList = extra()->restoredLocalAnnotationList;
             const QDomNode clonedNode = restoredLocalAnnotationList.importNode(childElement, true);
             restoredLocalAnnotationList.appendChild(clonedNode);
 
@@ -828,14 +1225,16 @@ bool PagePrivate::restoreLocalContents(const QDomNode &pageNode)
         // parse formList child element
         else if (childElement.tagName() == QLatin1String("forms")) {
             // Clone forms as root node in restoredFormFieldList
+            QDomDocument &restoredFormFieldList = extra()->restoredFormFieldList;
             const QDomNode clonedNode = restoredFormFieldList.importNode(childElement, true);
             restoredFormFieldList.appendChild(clonedNode);
 
+            const QLinkedList<FormField *> &formfields = formFields();
             if (formfields.isEmpty())
                 continue;
 
             QHash<int, FormField *> hashedforms;
-            for (FormField *ff : qAsConst(formfields)) {
+            for (FormField *ff : formfields) {
                 hashedforms[ff->id()] = ff;
             }
 
@@ -876,7 +1275,7 @@ void PagePrivate::saveLocalContents(QDomNode &parentNode, QDomDocument &document
 
     // add annotations info if has got any
     if ((what & AnnotationPageItems) && (what & OriginalAnnotationPageItems)) {
-        const QDomElement savedDocRoot = restoredLocalAnnotationList.documentElement();
+        const QDomElement savedDocRoot = m_extra ? m_extra->restoredLocalAnnotationList.documentElement() : QDomElement();
         if (!savedDocRoot.isNull()) {
             // Import and append node in target document
             const QDomNode importedNode = document.importNode(savedDocRoot, true);
@@ -908,13 +1307,14 @@ void PagePrivate::saveLocalContents(QDomNode &parentNode, QDomDocument &document
 
     // add forms info if has got any
     if ((what & FormFieldPageItems) && (what & OriginalFormFieldPageItems)) {
-        const QDomElement savedDocRoot = restoredFormFieldList.documentElement();
+        const QDomElement savedDocRoot = m_extra ? m_extra->restoredFormFieldList.documentElement() : QDomElement();
         if (!savedDocRoot.isNull()) {
             // Import and append node in target document
             const QDomNode importedNode = document.importNode(savedDocRoot, true);
             pageElement.appendChild(importedNode);
         }
-    } else if ((what & FormFieldPageItems) && !formfields.isEmpty()) {
+    } else if ((what & FormFieldPageItems) && !formFields().isEmpty()) {
+        const QLinkedList<FormField *> &formfields = formFields();
         // create the formList
         QDomElement formListElement = document.createElement(QStringLiteral("forms"));
 
@@ -971,6 +1371,12 @@ const QPixmap *Page::_o_nearestPixmap(DocumentObserver *observer, int w, int h)
     return pixmap;
 }
 
+const QPixmap *Page::_o_nearestTilesPyramidPixmap(DocumentObserver *observer, int w, int h) const
+{
+    const TilesManager *tm = d->tilesManager(observer);
+    return tm ? tm->pyramidLevel(w, h) : nullptr;
+}
+
 bool Page::hasTilesManager(const DocumentObserver *observer) const
 {
     return d->tilesManager(observer) != nullptr;
@@ -998,6 +1404,27 @@ void PagePrivate::setTilesManager(const DocumentObserver *observer, TilesManager
     m_tilesManagers.insert(observer, tm);
 }
 
+qulonglong PagePrivate::textPageMemory() const
+{
+    return m_text ? m_text->d->memoryUsage() : 0;
+}
+
+qulonglong PagePrivate::annotationsMemory() const
+{
+    qulonglong bytes = 0;
+    for (const Annotation *annotation : qAsConst(m_page->m_annotations)) {
+        bytes += kAnnotationSize + (annotation->author().size() + annotation->contents().size() + annotation->uniqueName().size()) * sizeof(QChar);
+        if (annotation->subType() == Annotation::ALine) {
+            bytes += static_cast<const LineAnnotation *>(annotation)->linePoints().count() * kAnnotationPointSize;
+        } else if (annotation->subType() == Annotation::AInk) {
+            const QList<QLinkedList<NormalizedPoint>> paths = static_cast<const InkAnnotation *>(annotation)->inkPaths();
+            for (const QLinkedList<NormalizedPoint> &path : paths)
+                bytes += path.count() * kAnnotationPointSize;
+        }
+    }
+    return bytes;
+}
+
 void PagePrivate::adoptGeneratedContents(PagePrivate *oldPage)
 {
     rotateAt(oldPage->m_rotation);
@@ -1008,40 +1435,47 @@ void PagePrivate::adoptGeneratedContents(PagePrivate *oldPage)
     m_tilesManagers = oldPage->m_tilesManagers;
     oldPage->m_tilesManagers.clear();
 
+    m_preview = oldPage->m_preview;
+
     m_boundingBox = oldPage->m_boundingBox;
     m_isBoundingBoxKnown = oldPage->m_isBoundingBoxKnown;
+    m_isBoundingBoxApproximate = oldPage->m_isBoundingBoxApproximate;
     m_text = oldPage->m_text;
     oldPage->m_text = nullptr;
+    addTextUrls();
 
     m_textSelections = oldPage->m_textSelections;
     oldPage->m_textSelections = nullptr;
 
-    restoredLocalAnnotationList = oldPage->restoredLocalAnnotationList;
-    restoredFormFieldList = oldPage->restoredFormFieldList;
+    if (oldPage->m_extra) {
+        Extra *e = extra();
+        e->restoredLocalAnnotationList = oldPage->m_extra->restoredLocalAnnotationList;
+        e->restoredFormFieldList = oldPage->m_extra->restoredFormFieldList;
+    }
 }
 
 FormField *PagePrivate::findEquivalentForm(const Page *p, FormField *oldField)
 {
     // given how id is not very good of id (at least for pdf) we do a few passes
     // same rect, type and id
-    for (FormField *f : qAsConst(p->d->formfields)) {
+    for (FormField *f : p->d->formFields()) {
         if (f->rect() == oldField->rect() && f->type() == oldField->type() && f->id() == oldField->id())
             return f;
     }
     // same rect and type
-    for (FormField *f : qAsConst(p->d->formfields)) {
+    for (FormField *f : p->d->formFields()) {
         if (f->rect() == oldField->rect() && f->type() == oldField->type())
             return f;
     }
     // fuzzy rect, same type and id
-    for (FormField *f : qAsConst(p->d->formfields)) {
+    for (FormField *f : p->d->formFields()) {
         if (f->type() == oldField->type() && f->id() == oldField->id() && qFuzzyCompare(f->rect().left, oldField->rect().left) && qFuzzyCompare(f->rect().top, oldField->rect().top) &&
             qFuzzyCompare(f->rect().right, oldField->rect().right) && qFuzzyCompare(f->rect().bottom, oldField->rect().bottom)) {
             return f;
         }
     }
     // fuzzy rect and same type
-    for (FormField *f : qAsConst(p->d->formfields)) {
+    for (FormField *f : p->d->formFields()) {
         if (f->type() == oldField->type() && qFuzzyCompare(f->rect().left, oldField->rect().left) && qFuzzyCompare(f->rect().top, oldField->rect().top) && qFuzzyCompare(f->rect().right, oldField->rect().right) &&
             qFuzzyCompare(f->rect().bottom, oldField->rect().bottom)) {
             return f;
@@ -10,7 +10,10 @@
 #ifndef _OKULAR_PAGE_H_
 #define _OKULAR_PAGE_H_
 
+#include <QColor>
 #include <QLinkedList>
+#include <QList>
+#include <QPair>
 
 #include "area.h"
 #include "global.h"
@@ -136,6 +139,24 @@ public:
      */
     void setBoundingBox(const NormalizedRect &bbox);
 
+    /**
+     * Sets the size of the page to @p width x @p height, in the orientation
+     * the page was created with, dropping its pixmaps. For generators that
+     * only know the real size in Generator::loadPageData().
+     *
+     * @since 21.12
+     */
+    void setSize(double width, double height);
+
+    /**
+     * Sets the orientation of the page to @p orientation, dropping its
+     * pixmaps, for generators that gave it a provisional one like its size,
+     * see setSize().
+     *
+     * @since 21.12
+     */
+    void setOrientation(Rotation orientation);
+
     /**
      * Returns whether the page of size @p width x @p height has a @p pixmap
      * in the region given by @p rect for the given @p observer
@@ -143,6 +164,30 @@ public:
      */
     bool hasPixmap(DocumentObserver *observer, int width = -1, int height = -1, const NormalizedRect &rect = NormalizedRect()) const;
 
+    /**
+     * Returns the pixmap of the whole page the given @p observer has, or
+     * nullptr if it has none. The pixmaps of tiled observers are in
+     * tilesAt() instead.
+     *
+     * Views paint the page with what they have; this is for the users of
+     * the document that only want the rendered page, e.g. to save it.
+     *
+     * @since 21.12
+     */
+    const QPixmap *pixmap(DocumentObserver *observer) const;
+
+    /**
+     * Returns a small copy of the page, as it is rotated, made from the
+     * first pixmaps the page got, or a null pixmap.
+     *
+     * The previews of the pages stay when their pixmaps are freed, within a
+     * budget of their own, so that there is something to show while the page
+     * is rendered again.
+     *
+     * @since 21.12
+     */
+    QPixmap preview() const;
+
     /**
      * Returns whether the page provides a text page (@ref TextPage).
      */
@@ -160,6 +205,15 @@ public:
      */
     bool hasHighlights(int id = -1) const;
 
+    /**
+     * Appends the areas of all the highlights of the page that intersect
+     * @p rect to @p areas, each with its color, in the order they are
+     * painted in.
+     *
+     * @since 21.12
+     */
+    void highlightAreas(const NormalizedRect &rect, QList<QPair<QColor, NormalizedRect>> *areas) const;
+
     /**
      * Returns whether the page provides a transition effect.
      */
@@ -406,6 +460,7 @@ private:
     /// @endcond
 
     const QPixmap *_o_nearestPixmap(DocumentObserver *, int, int) const;
+    const QPixmap *_o_nearestTilesPyramidPixmap(DocumentObserver *, int, int) const;
 
     QLinkedList<ObjectRect *> m_rects;
     QLinkedList<HighlightAreaRect *> m_highlights;
@@ -12,17 +12,19 @@
 #define _OKULAR_PAGE_PRIVATE_H_
 
 // qt/kde includes
+#include <QColor>
 #include <QLinkedList>
 #include <QMap>
+#include <QPixmap>
 #include <QString>
 #include <QTransform>
+#include <QVector>
 #include <qdom.h>
 
 // local includes
 #include "area.h"
 #include "global.h"
-
-class QColor;
+#include "objectrectgrid_p.h"
 
 namespace Okular
 {
@@ -36,6 +38,7 @@ class Page;
 class PageSize;
 class PageTransition;
 class RotationJob;
+class TextMatches;
 class TextPage;
 class TilesManager;
 
@@ -63,6 +66,35 @@ public:
 
     static PagePrivate *get(Page *page);
 
+    /**
+     * Whether a full render of the page should find its bounding box: it is
+     * not known, or only approximately.
+     */
+    bool needsBoundingBox() const;
+
+    /**
+     * Makes the text order of @p textPage, extracted for @p page, correct
+     * for search and text selection, so that Page::setTextPage() does not
+     * need to. It is slow and does not touch the page, so it is better
+     * done in the thread that extracted the text.
+     */
+    static void layoutTextPage(Page *page, TextPage *textPage);
+
+    /**
+     * Returns a copy of the text page, not set on any page, that can be
+     * searched in another thread while the page changes, or nullptr if the
+     * page has no text page.
+     */
+    TextPage *copyTextPage() const;
+
+    /**
+     * Appends all the matches of @p text in @p textPage to @p matches, as
+     * matches of the search word @p word, in the coordinates of the
+     * unrotated page. It only touches @p textPage, so it can run in another
+     * thread for a text page that is not set on a page.
+     */
+    static void findAllText(TextPage *textPage, const QString &text, Qt::CaseSensitivity caseSensitivity, int word, TextMatches *matches);
+
     void imageRotationDone(RotationJob *job);
     QTransform rotationMatrix() const;
 
@@ -81,6 +113,40 @@ public:
      */
     void rotateAt(Rotation orientation);
 
+    /**
+     * Returns the grid of the object rects of @p type, built again if the
+     * rects changed, or nullptr if the rects of that type are not in a grid.
+     */
+    const ObjectRectGrid *objectRectGrid(ObjectRect::ObjectType type) const;
+
+    /**
+     * Drops the grids of the object rects, whenever the Action or Image
+     * ones are added, deleted or transformed.
+     */
+    void objectRectsChanged();
+
+    /**
+     * Drops the grid of the annotations, whenever they are all replaced,
+     * deleted or transformed.
+     */
+    void annotationsChanged();
+
+    /**
+     * Put in the grid of the annotations, if it is built, the @p rect of an
+     * annotation appended to the page, of one about to be removed, or of
+     * one @p annotation that was moved or modified.
+     */
+    void annotationRectAdded(const ObjectRect *rect);
+    void annotationRectRemoved(const ObjectRect *rect);
+    void annotationMoved(const Annotation *annotation);
+
+    /**
+     * Adds links for the URLs written in the text page, where the generator
+     * has none, unless they are there already. They stay when the text page
+     * is freed, until the Action rects are deleted.
+     */
+    void addTextUrls();
+
     /**
      * Changes the size of the page to the given @p size.
      *
@@ -104,6 +170,12 @@ public:
      */
     void setHighlight(int id, RegularAreaRect *rect, const QColor &color);
 
+    /**
+     * Highlights the @p matches of the search with the given @p id, found
+     * in the unrotated page, each in the color of its word in @p wordColors.
+     */
+    void addSearchHighlights(int id, const TextMatches &matches, const QVector<QColor> &wordColors);
+
     /**
      * Deletes all highlight objects for the observer with the given @p id.
      */
@@ -124,6 +196,16 @@ public:
      */
     void setTilesManager(const DocumentObserver *observer, TilesManager *tm);
 
+    /**
+     * An estimate of the memory of the text page, 0 when there is none
+     */
+    qulonglong textPageMemory() const;
+
+    /**
+     * An estimate of the memory of the annotations of the page
+     */
+    qulonglong annotationsMemory() const;
+
     /**
      * Moves contents that are generated from oldPage to this. And clears them from page
      * so it can be deleted fine.
@@ -137,6 +219,47 @@ public:
 
     void setPixmap(DocumentObserver *observer, QPixmap *pixmap, const NormalizedRect &rect, bool isPartialPixmap);
 
+    /**
+     * Paints @p rect of @p image on the partial pixmap of @p observer, when it
+     * has one of the size of @p image that is not tiled nor rotated.
+     * Returns whether it was updated.
+     */
+    bool updatePartialPixmap(DocumentObserver *observer, const QImage &image, const QRect &rect);
+
+    /**
+     * Sets the full page @p pixmap of @p observer, which is already rotated
+     * like the page is.
+     */
+    void setRotatedPixmap(DocumentObserver *observer, QPixmap *pixmap);
+
+    /**
+     * Makes the preview of the page from the full page @p pixmap, unless
+     * the current one is good enough already.
+     */
+    void updatePreview(const QPixmap &pixmap);
+
+    /**
+     * Returns the smallest full page pixmap of an observer other than
+     * @p observer that is at least @p width x @p height pixels and has the
+     * same aspect ratio, so it can be scaled down to that size.
+     */
+    const QPixmap *largerPixmap(const DocumentObserver *observer, int width, int height) const;
+
+    /**
+     * Returns @p rect of the page at @p width x @p height pixels made from
+     * the full page pixmap or the tiles of an observer other than @p observer
+     * that has all of it at that resolution or a higher one, or a null pixmap.
+     */
+    QPixmap sharedRect(const DocumentObserver *observer, const NormalizedRect &rect, int width, int height) const;
+
+    // an area of a match of addSearchHighlights(), rotated like the page
+    struct SearchHighlight {
+        NormalizedRect area;
+        QColor color;
+        int id;
+    };
+    QVector<SearchHighlight> m_searchHighlights;
+
     class PixmapObject
     {
     public:
@@ -146,27 +269,56 @@ public:
     };
     QMap<DocumentObserver *, PixmapObject> m_pixmaps;
     QMap<const DocumentObserver *, TilesManager *> m_tilesManagers;
+    QPixmap m_preview;
 
     Page *m_page;
-    int m_number;
-    Rotation m_orientation;
-    double m_width, m_height;
     DocumentPrivate *m_doc;
-    NormalizedRect m_boundingBox;
-    Rotation m_rotation;
-
     TextPage *m_text;
-    PageTransition *m_transition;
     HighlightAreaRect *m_textSelections;
-    QLinkedList<FormField *> formfields;
-    Action *m_openingAction;
-    Action *m_closingAction;
-    double m_duration;
+    double m_width, m_height;
+    NormalizedRect m_boundingBox;
     QString m_label;
+    int m_number;
+    Rotation m_orientation;
+    Rotation m_rotation;
 
     bool m_isBoundingBoxKnown : 1;
-    QDomDocument restoredLocalAnnotationList; // <annotationList>...</annotationList>
-    QDomDocument restoredFormFieldList;       // <forms>...</forms>
+    // found on a small render in the background, the first full render refines it
+    bool m_isBoundingBoxApproximate : 1;
+    bool m_textUrlsAdded : 1;
+    // a text page of it had no text, so the next ones won't either
+    bool m_hasNoText : 1;
+    mutable bool m_objectRectGridsValid : 1;
+    mutable bool m_annotationGridValid : 1;
+
+    // what only some pages have, kept out of the page so that a document of
+    // many pages costs little until they are used
+    struct Extra {
+        ~Extra();
+
+        PageTransition *transition = nullptr;
+        Action *openingAction = nullptr;
+        Action *closingAction = nullptr;
+        double duration = -1;
+        QLinkedList<FormField *> formfields;
+        ObjectRectGrid actionGrid;
+        ObjectRectGrid imageGrid;
+        ObjectRectGrid annotationGrid;
+        QDomDocument restoredLocalAnnotationList; // <annotationList>...</annotationList>
+        QDomDocument restoredFormFieldList;       // <forms>...</forms>
+    };
+
+    /**
+     * Returns the extra data of the page, creating it if it has none yet.
+     */
+    Extra *extra() const;
+
+    /**
+     * The form fields of the page, empty until some are set.
+     */
+    const QLinkedList<FormField *> &formFields() const;
+
+    mutable Extra *m_extra;
 };
 
 }
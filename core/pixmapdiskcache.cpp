@@ -0,0 +1,189 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "pixmapdiskcache_p.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QUrl>
+
+#include <threadweaver/queueing.h>
+
+#include <algorithm>
+
+#include "debug_p.h"
+
+using namespace Okular;
+
+PixmapDiskCache::PixmapDiskCache()
+{
+    // one writer is plenty, we don't want to compete with the generator for the CPU
+    m_writeQueue.setMaximumNumberOfThreads(1);
+}
+
+PixmapDiskCache::~PixmapDiskCache()
+{
+    m_writeQueue.finish();
+}
+
+QString PixmapDiskCache::cacheRoot()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/okular/pagecache");
+}
+
+void PixmapDiskCache::setDocument(const QString &localFilePath, const QUrl &url, const QString &generatorName)
+{
+    m_dirtyPages.clear();
+    m_dir.clear();
+
+    const QFileInfo fi(localFilePath);
+    if (!fi.exists())
+        return;
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(url.toString().toUtf8());
+    hash.addData(QByteArray::number(fi.size()));
+    hash.addData(QByteArray::number(fi.lastModified().toMSecsSinceEpoch()));
+    hash.addData(generatorName.toUtf8());
+
+    const QString dir = cacheRoot() + QLatin1Char('/') + QString::fromLatin1(hash.result().toHex());
+    if (!QDir().mkpath(dir)) {
+        qCWarning(OkularCoreDebug) << "Could not create the page cache folder" << dir;
+        return;
+    }
+    m_dir = dir;
+}
+
+void PixmapDiskCache::close(qint64 maxBytes)
+{
+    if (m_dir.isEmpty())
+        return;
+
+    m_dir.clear();
+    m_dirtyPages.clear();
+    m_writeQueue.enqueue(ThreadWeaver::make_job([maxBytes] { trim(maxBytes); }));
+}
+
+bool PixmapDiskCache::isActive() const
+{
+    return !m_dir.isEmpty();
+}
+
+QString PixmapDiskCache::fileName(int page, int width, int height, const QString &renderHints) const
+{
+    const QByteArray hints = QCryptographicHash::hash(renderHints.toUtf8(), QCryptographicHash::Md5).toHex().left(8);
+    return m_dir + QStringLiteral("/p%1-%2x%3-%4.png").arg(page).arg(width).arg(height).arg(QString::fromLatin1(hints));
+}
+
+QImage PixmapDiskCache::load(int page, int width, int height, const QString &renderHints) const
+{
+    if (m_dir.isEmpty() || m_dirtyPages.contains(page))
+        return QImage();
+
+    QFile file(fileName(page, width, height, renderHints));
+    if (!file.open(QIODevice::ReadOnly))
+        return QImage();
+
+    QImage image;
+    if (!image.load(&file, "PNG") || image.width() != width || image.height() != height)
+        return QImage();
+
+    // the modification time is what trim() uses to find the least recently used images
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+
+    return image;
+}
+
+void PixmapDiskCache::store(int page, const QImage &image, const QString &renderHints)
+{
+    if (m_dir.isEmpty() || image.isNull() || m_dirtyPages.contains(page))
+        return;
+
+    const QString path = fileName(page, image.width(), image.height(), renderHints);
+    m_writeQueue.enqueue(ThreadWeaver::make_job([path, image] {
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+        // favour speed over size, these files are short lived
+        if (image.save(&file, "PNG", 90))
+            file.commit();
+        else
+            file.cancelWriting();
+    }));
+}
+
+void PixmapDiskCache::markPageDirty(int page)
+{
+    if (m_dir.isEmpty() || m_dirtyPages.contains(page))
+        return;
+
+    m_dirtyPages.insert(page);
+
+    // go through the queue so a write of this page that is still pending doesn't survive
+    const QString dir = m_dir;
+    m_writeQueue.enqueue(ThreadWeaver::make_job([dir, page] {
+        QDir d(dir);
+        const QStringList files = d.entryList({QStringLiteral("p%1-*.png").arg(page)}, QDir::Files);
+        for (const QString &f : files)
+            d.remove(f);
+    }));
+}
+
+void PixmapDiskCache::clear()
+{
+    if (m_dir.isEmpty())
+        return;
+
+    const QString dir = m_dir;
+    m_writeQueue.enqueue(ThreadWeaver::make_job([dir] {
+        QDir d(dir);
+        const QStringList files = d.entryList({QStringLiteral("*.png")}, QDir::Files);
+        for (const QString &f : files)
+            d.remove(f);
+    }));
+}
+
+void PixmapDiskCache::trim(qint64 maxBytes)
+{
+    struct CacheFile {
+        QString path;
+        qint64 size;
+        QDateTime lastUsed;
+    };
+    QVector<CacheFile> files;
+    qint64 totalSize = 0;
+
+    QDirIterator it(cacheRoot(), {QStringLiteral("*.png")}, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo fi = it.fileInfo();
+        files.append({fi.filePath(), fi.size(), fi.lastModified()});
+        totalSize += fi.size();
+    }
+
+    if (totalSize <= maxBytes)
+        return;
+
+    std::sort(files.begin(), files.end(), [](const CacheFile &a, const CacheFile &b) { return a.lastUsed < b.lastUsed; });
+    for (const CacheFile &f : qAsConst(files)) {
+        if (totalSize <= maxBytes)
+            break;
+        if (QFile::remove(f.path))
+            totalSize -= f.size;
+    }
+
+    // and drop the folders of documents that don't have anything left
+    QDir root(cacheRoot());
+    const QStringList dirs = root.entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &dir : dirs)
+        root.rmdir(dir); // only succeeds if empty
+}
@@ -0,0 +1,101 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_PIXMAPDISKCACHE_P_H_
+#define _OKULAR_PIXMAPDISKCACHE_P_H_
+
+#include <QImage>
+#include <QSet>
+#include <QString>
+
+#include <threadweaver/queue.h>
+
+class QUrl;
+
+namespace Okular
+{
+/**
+ * Persistent cache of the full page images rendered by the generator.
+ *
+ * Images live under the user cache directory, in one directory per
+ * document that is named after a hash of the document url, size and
+ * modification time, so a changed file never hits stale entries. Each
+ * file is keyed by page number, pixel size and the render hints that
+ * influence what the generator produces.
+ *
+ * Images are only of full pages in the generator orientation, the document
+ * takes care of the rotation like for any other generated image. Writing
+ * happens in a background thread.
+ */
+class PixmapDiskCache
+{
+public:
+    PixmapDiskCache();
+    ~PixmapDiskCache();
+
+    /**
+     * Starts caching images for the document at @p localFilePath, shown
+     * as @p url, rendered by @p generatorName.
+     */
+    void setDocument(const QString &localFilePath, const QUrl &url, const QString &generatorName);
+
+    /**
+     * Stops caching and, once the pending writes are done, trims the whole
+     * cache to @p maxBytes in the background.
+     */
+    void close(qint64 maxBytes);
+
+    bool isActive() const;
+
+    /**
+     * Returns the cached image of @p page at the given size and @p renderHints,
+     * or a null image.
+     */
+    QImage load(int page, int width, int height, const QString &renderHints) const;
+
+    /**
+     * Saves @p image as the render of @p page with @p renderHints.
+     * Pages marked as dirty are not stored.
+     */
+    void store(int page, const QImage &image, const QString &renderHints);
+
+    /**
+     * Forgets all the images of @p page and stops caching it until the next
+     * document is set, its contents no longer depend only on the file
+     * (e.g. unsaved annotation or form changes, layer visibility).
+     */
+    void markPageDirty(int page);
+
+    /**
+     * Forgets all the images of the current document, e.g. because the
+     * generator configuration changed.
+     */
+    void clear();
+
+    /**
+     * Removes the least recently used images until the whole cache is below
+     * @p maxBytes.
+     */
+    static void trim(qint64 maxBytes);
+
+    /**
+     * The directory all the document caches live under.
+     */
+    static QString cacheRoot();
+
+private:
+    Q_DISABLE_COPY(PixmapDiskCache)
+
+    QString fileName(int page, int width, int height, const QString &renderHints) const;
+
+    QString m_dir;
+    QSet<int> m_dirtyPages;
+    ThreadWeaver::Queue m_writeQueue;
+};
+
+}
+
+#endif
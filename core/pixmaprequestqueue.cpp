@@ -0,0 +1,169 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "pixmaprequestqueue_p.h"
+
+#include "generator.h"
+#include "generator_p.h"
+
+#include <algorithm>
+
+using namespace Okular;
+
+PixmapRequestQueue::PixmapRequestQueue()
+    : m_nextSequence(1)
+{
+}
+
+bool PixmapRequestQueue::lessImportant(const Entry &a, const Entry &b)
+{
+    if (a.priority != b.priority)
+        return a.priority > b.priority;
+
+    // priority zero requests are the synchronous ones, the last one asked for is
+    // the one the user is waiting for; for the others keep the order they came in
+    if (a.priority == 0)
+        return a.sequence < b.sequence;
+    return a.sequence > b.sequence;
+}
+
+bool PixmapRequestQueue::isStale(const Entry &entry) const
+{
+    DocumentObserver *observer = entry.request->observer();
+    if (entry.sequence < m_observerEpochs.value(observer, 0))
+        return true;
+    return !m_pageEpochs.isEmpty() && entry.sequence < m_pageEpochs.value(qMakePair(observer, entry.request->pageNumber()), 0);
+}
+
+void PixmapRequestQueue::push(PixmapRequest *request)
+{
+    const Entry entry = {request, request->priority(), m_nextSequence++};
+    m_heap.append(entry);
+    std::push_heap(m_heap.begin(), m_heap.end(), lessImportant);
+}
+
+PixmapRequest *PixmapRequestQueue::top()
+{
+    while (!m_heap.isEmpty()) {
+        const Entry &entry = m_heap.constFirst();
+        if (!isStale(entry))
+            return entry.request;
+
+        m_stale.append(entry.request);
+        popEntry();
+    }
+    return nullptr;
+}
+
+void PixmapRequestQueue::pop()
+{
+    if (top())
+        popEntry();
+}
+
+void PixmapRequestQueue::popEntry()
+{
+    std::pop_heap(m_heap.begin(), m_heap.end(), lessImportant);
+    m_heap.removeLast();
+
+    // nothing left that could be stale
+    if (m_heap.isEmpty()) {
+        m_observerEpochs.clear();
+        m_pageEpochs.clear();
+    }
+}
+
+void PixmapRequestQueue::invalidate(DocumentObserver *observer)
+{
+    if (m_heap.isEmpty())
+        return;
+
+    m_observerEpochs.insert(observer, m_nextSequence);
+    // the observer epoch covers them all now
+    QHash<QPair<DocumentObserver *, int>, quint64>::iterator it = m_pageEpochs.begin();
+    while (it != m_pageEpochs.end()) {
+        if (it.key().first == observer)
+            it = m_pageEpochs.erase(it);
+        else
+            ++it;
+    }
+}
+
+void PixmapRequestQueue::invalidate(DocumentObserver *observer, int page)
+{
+    if (m_heap.isEmpty())
+        return;
+
+    m_pageEpochs.insert(qMakePair(observer, page), m_nextSequence);
+}
+
+void PixmapRequestQueue::compact()
+{
+    QVector<Entry>::iterator it = std::remove_if(m_heap.begin(), m_heap.end(), [this](const Entry &entry) {
+        if (!isStale(entry))
+            return false;
+        m_stale.append(entry.request);
+        return true;
+    });
+    if (it == m_heap.end())
+        return;
+
+    m_heap.erase(it, m_heap.end());
+    std::make_heap(m_heap.begin(), m_heap.end(), lessImportant);
+    m_observerEpochs.clear();
+    m_pageEpochs.clear();
+}
+
+void PixmapRequestQueue::removeSearchPreloads(const QSet<int> &pages)
+{
+    QVector<Entry>::iterator it = std::remove_if(m_heap.begin(), m_heap.end(), [this, &pages](const Entry &entry) {
+        if (!(PixmapRequestPrivate::get(entry.request)->mFeatures & PixmapRequest::SearchPreload) || !pages.contains(entry.request->pageNumber()))
+            return false;
+        m_stale.append(entry.request);
+        return true;
+    });
+    if (it == m_heap.end())
+        return;
+
+    // the epochs still hold for the requests left
+    m_heap.erase(it, m_heap.end());
+    std::make_heap(m_heap.begin(), m_heap.end(), lessImportant);
+}
+
+QVector<PixmapRequest *> PixmapRequestQueue::takeStale()
+{
+    QVector<PixmapRequest *> stale;
+    stale.swap(m_stale);
+    return stale;
+}
+
+QVector<PixmapRequest *> PixmapRequestQueue::takeAll()
+{
+    QVector<PixmapRequest *> requests = takeStale();
+    requests.reserve(requests.count() + m_heap.count());
+    for (const Entry &entry : qAsConst(m_heap))
+        requests.append(entry.request);
+
+    m_heap.clear();
+    m_observerEpochs.clear();
+    m_pageEpochs.clear();
+    return requests;
+}
+
+bool PixmapRequestQueue::isEmpty() const
+{
+    return m_heap.isEmpty();
+}
+
+int PixmapRequestQueue::count() const
+{
+    return m_heap.count();
+}
+
+int PixmapRequestQueue::count(DocumentObserver *observer) const
+{
+    return std::count_if(m_heap.cbegin(), m_heap.cend(), [this, observer](const Entry &entry) { return (!observer || entry.request->observer() == observer) && !isStale(entry); });
+}
@@ -0,0 +1,127 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_PIXMAPREQUESTQUEUE_P_H_
+#define _OKULAR_PIXMAPREQUESTQUEUE_P_H_
+
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QVector>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+class DocumentObserver;
+class PixmapRequest;
+
+/**
+ * The queue of the pixmap requests waiting to be sent to the generator.
+ *
+ * It is a binary heap, so adding a request and taking the most important
+ * one are O(log n). The most important request is the one with the lowest
+ * priority value; among requests with the same priority the newest wins for
+ * priority 0 (the synchronous ones) while the oldest wins for the others,
+ * like the sorted list that was used before.
+ *
+ * Requests are not removed when they become obsolete, since that means
+ * walking the whole queue; invalidate() just remembers that everything
+ * queued so far for an observer (or one of its pages) is stale. Stale
+ * requests are skipped when they reach the top and handed back with
+ * takeStale(), so they can be deleted without holding the queue lock.
+ *
+ * The queue does not own the requests.
+ */
+class OKULARCORE_EXPORT PixmapRequestQueue
+{
+public:
+    PixmapRequestQueue();
+
+    /**
+     * Adds @p request to the queue.
+     */
+    void push(PixmapRequest *request);
+
+    /**
+     * Returns the most important request that is not stale, or nullptr if
+     * there is none. The request stays in the queue, see pop().
+     */
+    PixmapRequest *top();
+
+    /**
+     * Removes the request returned by top() from the queue.
+     */
+    void pop();
+
+    /**
+     * Marks all the requests of @p observer queued so far as stale.
+     */
+    void invalidate(DocumentObserver *observer);
+
+    /**
+     * Marks all the requests of @p observer for @p page queued so far as stale.
+     */
+    void invalidate(DocumentObserver *observer, int page);
+
+    /**
+     * Moves all the stale requests out of the heap, so they don't take
+     * memory until they reach the top. This is O(n).
+     */
+    void compact();
+
+    /**
+     * Moves the PixmapRequest::SearchPreload requests of any observer for
+     * @p pages out of the heap, they are handed back with takeStale() like
+     * the stale ones. This is O(n).
+     */
+    void removeSearchPreloads(const QSet<int> &pages);
+
+    /**
+     * Returns the stale requests found since the last call and forgets them.
+     */
+    QVector<PixmapRequest *> takeStale();
+
+    /**
+     * Empties the queue and returns all the requests it had, stale or not.
+     */
+    QVector<PixmapRequest *> takeAll();
+
+    /**
+     * Whether there are no requests in the heap. Stale requests that did not
+     * reach the top yet still count.
+     */
+    bool isEmpty() const;
+    int count() const;
+
+    /**
+     * The number of requests of @p observer (or of any observer if it is
+     * nullptr) that are not stale. This is O(n).
+     */
+    int count(DocumentObserver *observer) const;
+
+private:
+    struct Entry {
+        PixmapRequest *request;
+        int priority;
+        quint64 sequence;
+    };
+
+    static bool lessImportant(const Entry &a, const Entry &b);
+    bool isStale(const Entry &entry) const;
+    void popEntry();
+
+    QVector<Entry> m_heap;
+    QVector<PixmapRequest *> m_stale;
+    quint64 m_nextSequence;
+    // requests whose sequence is below these are stale
+    QHash<DocumentObserver *, quint64> m_observerEpochs;
+    QHash<QPair<DocumentObserver *, int>, quint64> m_pageEpochs;
+};
+
+}
+
+#endif
@@ -0,0 +1,247 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "renderstatistics.h"
+#include "renderstatistics_p.h"
+
+using namespace Okular;
+
+LockStatistics::LockStatistics()
+    : d(new LockStatisticsPrivate)
+{
+}
+
+LockStatistics::LockStatistics(const LockStatistics &other)
+    : d(other.d)
+{
+}
+
+LockStatistics::~LockStatistics()
+{
+}
+
+LockStatistics &LockStatistics::operator=(const LockStatistics &other)
+{
+    if (this != &other)
+        d = other.d;
+    return *this;
+}
+
+LockStatistics &LockStatistics::operator+=(const LockStatistics &other)
+{
+    d->locks += other.d->locks;
+    d->contendedLocks += other.d->contendedLocks;
+    d->failedTryLocks += other.d->failedTryLocks;
+    d->waitTime += other.d->waitTime;
+    d->maxWaitTime = qMax(d->maxWaitTime, other.d->maxWaitTime);
+    d->holdTime += other.d->holdTime;
+    d->maxHoldTime = qMax(d->maxHoldTime, other.d->maxHoldTime);
+    return *this;
+}
+
+qint64 LockStatistics::averageWaitTime() const
+{
+    return d->locks > 0 ? d->waitTime / d->locks : 0;
+}
+
+qint64 LockStatistics::averageHoldTime() const
+{
+    return d->locks > 0 ? d->holdTime / d->locks : 0;
+}
+
+qint64 LockStatistics::locks() const
+{
+    return d->locks;
+}
+
+qint64 LockStatistics::contendedLocks() const
+{
+    return d->contendedLocks;
+}
+
+qint64 LockStatistics::failedTryLocks() const
+{
+    return d->failedTryLocks;
+}
+
+qint64 LockStatistics::waitTime() const
+{
+    return d->waitTime;
+}
+
+qint64 LockStatistics::maxWaitTime() const
+{
+    return d->maxWaitTime;
+}
+
+qint64 LockStatistics::holdTime() const
+{
+    return d->holdTime;
+}
+
+qint64 LockStatistics::maxHoldTime() const
+{
+    return d->maxHoldTime;
+}
+
+RenderStatistics::RenderStatistics()
+    : d(new RenderStatisticsPrivate)
+{
+}
+
+RenderStatistics::RenderStatistics(const RenderStatistics &other)
+    : d(other.d)
+{
+}
+
+RenderStatistics::~RenderStatistics()
+{
+}
+
+RenderStatistics &RenderStatistics::operator=(const RenderStatistics &other)
+{
+    if (this != &other)
+        d = other.d;
+    return *this;
+}
+
+RenderStatistics &RenderStatistics::operator+=(const RenderStatistics &other)
+{
+    d->queuedRequests += other.d->queuedRequests;
+    d->executingRequests += other.d->executingRequests;
+    d->generatorRequests += other.d->generatorRequests;
+    d->queueTime += other.d->queueTime;
+    d->generatedPixmaps += other.d->generatedPixmaps;
+    d->renderTime += other.d->renderTime;
+    d->pixmapCacheHits += other.d->pixmapCacheHits;
+    d->compressedCacheHits += other.d->compressedCacheHits;
+    d->diskCacheHits += other.d->diskCacheHits;
+    d->sharedPixmapHits += other.d->sharedPixmapHits;
+    d->coalescedRequests += other.d->coalescedRequests;
+    d->embeddedThumbnailHits += other.d->embeddedThumbnailHits;
+    d->thumbnailCacheHits += other.d->thumbnailCacheHits;
+    d->evictedPixmaps += other.d->evictedPixmaps;
+    d->allocatedPixmaps += other.d->allocatedPixmaps;
+    d->allocatedPixmapBytes += other.d->allocatedPixmapBytes;
+    d->compressedPixmapBytes += other.d->compressedPixmapBytes;
+    d->idleRenderBufferBytes += other.d->idleRenderBufferBytes;
+    // the first pixmap of any of them
+    if (other.d->firstPixmapTime >= 0 && (d->firstPixmapTime < 0 || other.d->firstPixmapTime < d->firstPixmapTime))
+        d->firstPixmapTime = other.d->firstPixmapTime;
+    for (auto it = other.d->userMutexStatistics.constBegin(); it != other.d->userMutexStatistics.constEnd(); ++it)
+        d->userMutexStatistics[it.key()] += it.value();
+    return *this;
+}
+
+qint64 RenderStatistics::averageQueueTime() const
+{
+    return d->generatorRequests > 0 ? d->queueTime / d->generatorRequests : 0;
+}
+
+qint64 RenderStatistics::averageRenderTime() const
+{
+    return d->generatedPixmaps > 0 ? d->renderTime / d->generatedPixmaps : 0;
+}
+
+int RenderStatistics::queuedRequests() const
+{
+    return d->queuedRequests;
+}
+
+int RenderStatistics::executingRequests() const
+{
+    return d->executingRequests;
+}
+
+qint64 RenderStatistics::generatorRequests() const
+{
+    return d->generatorRequests;
+}
+
+qint64 RenderStatistics::queueTime() const
+{
+    return d->queueTime;
+}
+
+qint64 RenderStatistics::generatedPixmaps() const
+{
+    return d->generatedPixmaps;
+}
+
+qint64 RenderStatistics::renderTime() const
+{
+    return d->renderTime;
+}
+
+qint64 RenderStatistics::pixmapCacheHits() const
+{
+    return d->pixmapCacheHits;
+}
+
+qint64 RenderStatistics::compressedCacheHits() const
+{
+    return d->compressedCacheHits;
+}
+
+qint64 RenderStatistics::diskCacheHits() const
+{
+    return d->diskCacheHits;
+}
+
+qint64 RenderStatistics::sharedPixmapHits() const
+{
+    return d->sharedPixmapHits;
+}
+
+qint64 RenderStatistics::coalescedRequests() const
+{
+    return d->coalescedRequests;
+}
+
+qint64 RenderStatistics::embeddedThumbnailHits() const
+{
+    return d->embeddedThumbnailHits;
+}
+
+qint64 RenderStatistics::thumbnailCacheHits() const
+{
+    return d->thumbnailCacheHits;
+}
+
+qint64 RenderStatistics::evictedPixmaps() const
+{
+    return d->evictedPixmaps;
+}
+
+int RenderStatistics::allocatedPixmaps() const
+{
+    return d->allocatedPixmaps;
+}
+
+qulonglong RenderStatistics::allocatedPixmapBytes() const
+{
+    return d->allocatedPixmapBytes;
+}
+
+qulonglong RenderStatistics::compressedPixmapBytes() const
+{
+    return d->compressedPixmapBytes;
+}
+
+qulonglong RenderStatistics::idleRenderBufferBytes() const
+{
+    return d->idleRenderBufferBytes;
+}
+
+qint64 RenderStatistics::firstPixmapTime() const
+{
+    return d->firstPixmapTime;
+}
+
+QMap<QString, LockStatistics> RenderStatistics::userMutexStatistics() const
+{
+    return d->userMutexStatistics;
+}
@@ -0,0 +1,183 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_RENDERSTATISTICS_H_
+#define _OKULAR_RENDERSTATISTICS_H_
+
+#include <QMap>
+#include <QSharedDataPointer>
+#include <QString>
+#include <QtGlobal>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+class LockStatisticsPrivate;
+class RenderStatisticsPrivate;
+
+/**
+ * @short Counters of the use of the mutex of a generator from one kind of
+ * call site, see Generator::lockUserMutex().
+ *
+ * Times are in microseconds.
+ *
+ * @since 21.12
+ */
+class OKULARCORE_EXPORT LockStatistics
+{
+public:
+    /**
+     * Creates statistics with all the counters at zero.
+     */
+    LockStatistics();
+
+    /**
+     * Copy constructor.
+     */
+    LockStatistics(const LockStatistics &other);
+
+    /**
+     * Destroys the statistics.
+     */
+    ~LockStatistics();
+
+    LockStatistics &operator=(const LockStatistics &other);
+
+    /**
+     * Adds the counters of @p other to these.
+     */
+    LockStatistics &operator+=(const LockStatistics &other);
+
+    /**
+     * Average time waited for the mutex, counting the locks that did not wait.
+     */
+    qint64 averageWaitTime() const;
+
+    /**
+     * Average time the mutex was held.
+     */
+    qint64 averageHoldTime() const;
+
+    /// Times the mutex was locked
+    qint64 locks() const;
+    /// Locks that had to wait for another holder
+    qint64 contendedLocks() const;
+    /// Attempts to lock without waiting that found it held
+    qint64 failedTryLocks() const;
+    /// Total time waited for the mutex
+    qint64 waitTime() const;
+    /// Longest wait for the mutex
+    qint64 maxWaitTime() const;
+    /// Total time the mutex was held
+    qint64 holdTime() const;
+    /// Longest time the mutex was held
+    qint64 maxHoldTime() const;
+
+private:
+    friend class LockStatisticsPrivate;
+    QSharedDataPointer<LockStatisticsPrivate> d;
+};
+
+/**
+ * @short Counters of the pixmap rendering of a document.
+ *
+ * They are collected since the document was opened (or since
+ * Document::resetRenderStatistics()), either for the whole document or
+ * only for the requests of a single observer, see
+ * Document::renderStatistics().
+ *
+ * Times are in milliseconds, sizes in bytes.
+ *
+ * @since 21.12
+ */
+class OKULARCORE_EXPORT RenderStatistics
+{
+public:
+    /**
+     * Creates statistics with all the counters at zero.
+     */
+    RenderStatistics();
+
+    /**
+     * Copy constructor.
+     */
+    RenderStatistics(const RenderStatistics &other);
+
+    /**
+     * Destroys the statistics.
+     */
+    ~RenderStatistics();
+
+    RenderStatistics &operator=(const RenderStatistics &other);
+
+    /**
+     * Adds the counters of @p other to these.
+     */
+    RenderStatistics &operator+=(const RenderStatistics &other);
+
+    /**
+     * Average time a request sent to the generator waited in the queue.
+     */
+    qint64 averageQueueTime() const;
+
+    /**
+     * Average time the generator took to render a pixmap.
+     */
+    qint64 averageRenderTime() const;
+
+    /// Requests waiting in the queue right now
+    int queuedRequests() const;
+    /// Requests being generated right now
+    int executingRequests() const;
+
+    /// Requests sent to the generator, i.e. that missed all the caches
+    qint64 generatorRequests() const;
+    /// Total time the requests sent to the generator waited in the queue
+    qint64 queueTime() const;
+    /// Pixmaps the generator delivered
+    qint64 generatedPixmaps() const;
+    /// Total time the generator took to deliver them
+    qint64 renderTime() const;
+
+    /// Requests dropped because the page already had the requested pixmap
+    qint64 pixmapCacheHits() const;
+    /// Requests served from the pixmaps kept compressed after eviction
+    qint64 compressedCacheHits() const;
+    /// Requests served from the on-disk cache
+    qint64 diskCacheHits() const;
+    /// Requests served by scaling down the bigger pixmap of another observer
+    qint64 sharedPixmapHits() const;
+    /// Requests served by the render of the same pixmap for another observer
+    qint64 coalescedRequests() const;
+    /// Requests served by scaling the thumbnail embedded in the document
+    qint64 embeddedThumbnailHits() const;
+    /// Requests served from the thumbnails kept on disk
+    qint64 thumbnailCacheHits() const;
+
+    /// Pixmaps freed to stay in the memory budget
+    qint64 evictedPixmaps() const;
+    /// Pixmaps currently held
+    int allocatedPixmaps() const;
+    /// Memory used by the pixmaps currently held
+    qulonglong allocatedPixmapBytes() const;
+    /// Memory used by the compressed pixmaps, only for the whole document
+    qulonglong compressedPixmapBytes() const;
+    /// Memory of the render buffers waiting to be used again, only for the whole document
+    qulonglong idleRenderBufferBytes() const;
+    /// Time from the start of opening the document to its first pixmap, -1 until there is one
+    qint64 firstPixmapTime() const;
+    /// The use of the mutex of the generator by call site (e.g. "render", "text"), only for the whole document
+    QMap<QString, LockStatistics> userMutexStatistics() const;
+
+private:
+    friend class RenderStatisticsPrivate;
+    QSharedDataPointer<RenderStatisticsPrivate> d;
+};
+
+}
+
+#endif
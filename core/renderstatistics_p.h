@@ -0,0 +1,101 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_RENDERSTATISTICS_P_H_
+#define _OKULAR_RENDERSTATISTICS_P_H_
+
+#include "renderstatistics.h"
+
+#include <QSharedData>
+
+namespace Okular
+{
+class LockStatisticsPrivate : public QSharedData
+{
+public:
+    LockStatisticsPrivate()
+        : locks(0)
+        , contendedLocks(0)
+        , failedTryLocks(0)
+        , waitTime(0)
+        , maxWaitTime(0)
+        , holdTime(0)
+        , maxHoldTime(0)
+    {
+    }
+
+    // the counters of @p statistics, to be updated
+    static LockStatisticsPrivate *get(LockStatistics &statistics)
+    {
+        return statistics.d.data();
+    }
+
+    qint64 locks;
+    qint64 contendedLocks;
+    qint64 failedTryLocks;
+    qint64 waitTime;
+    qint64 maxWaitTime;
+    qint64 holdTime;
+    qint64 maxHoldTime;
+};
+
+class RenderStatisticsPrivate : public QSharedData
+{
+public:
+    RenderStatisticsPrivate()
+        : queuedRequests(0)
+        , executingRequests(0)
+        , generatorRequests(0)
+        , queueTime(0)
+        , generatedPixmaps(0)
+        , renderTime(0)
+        , pixmapCacheHits(0)
+        , compressedCacheHits(0)
+        , diskCacheHits(0)
+        , sharedPixmapHits(0)
+        , coalescedRequests(0)
+        , embeddedThumbnailHits(0)
+        , thumbnailCacheHits(0)
+        , evictedPixmaps(0)
+        , allocatedPixmaps(0)
+        , allocatedPixmapBytes(0)
+        , compressedPixmapBytes(0)
+        , idleRenderBufferBytes(0)
+        , firstPixmapTime(-1)
+    {
+    }
+
+    // the counters of @p statistics, to be updated
+    static RenderStatisticsPrivate *get(RenderStatistics &statistics)
+    {
+        return statistics.d.data();
+    }
+
+    int queuedRequests;
+    int executingRequests;
+    qint64 generatorRequests;
+    qint64 queueTime;
+    qint64 generatedPixmaps;
+    qint64 renderTime;
+    qint64 pixmapCacheHits;
+    qint64 compressedCacheHits;
+    qint64 diskCacheHits;
+    qint64 sharedPixmapHits;
+    qint64 coalescedRequests;
+    qint64 embeddedThumbnailHits;
+    qint64 thumbnailCacheHits;
+    qint64 evictedPixmaps;
+    int allocatedPixmaps;
+    qulonglong allocatedPixmapBytes;
+    qulonglong compressedPixmapBytes;
+    qulonglong idleRenderBufferBytes;
+    qint64 firstPixmapTime;
+    QMap<QString, LockStatistics> userMutexStatistics;
+};
+
+}
+
+#endif
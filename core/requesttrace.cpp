@@ -0,0 +1,145 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "requesttrace_p.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMutex>
+#include <QThread>
+
+#include "debug_p.h"
+#include "generator.h"
+
+using namespace Okular;
+
+// the events are written when this many bytes of them are waiting, or when
+// the oldest waited for that long
+static const int traceBufferSize = 64 * 1024;
+static const qint64 traceFlushInterval = 1000000; // in microseconds
+
+namespace
+{
+struct TraceFile {
+    TraceFile()
+    {
+        const QString fileName = qEnvironmentVariable("OKULAR_TRACE");
+        if (fileName.isEmpty())
+            return;
+
+        file.setFileName(fileName);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCWarning(OkularCoreDebug) << "Could not open the trace file" << fileName;
+            return;
+        }
+        // the closing bracket is optional in the format, a trace cut short still opens
+        file.write("[\n");
+        clock.start();
+        enabled = true;
+    }
+
+    ~TraceFile()
+    {
+        flush();
+    }
+
+    // mutex must be held by the caller, but at exit
+    void flush()
+    {
+        if (buffer.isEmpty())
+            return;
+        file.write(buffer);
+        file.flush();
+        buffer.clear();
+    }
+
+    QFile file;
+    QMutex mutex;
+    QElapsedTimer clock;
+    // the events not written yet, and when the first of them was added
+    QByteArray buffer;
+    qint64 bufferStart = 0;
+    bool enabled = false;
+};
+}
+
+static TraceFile *traceFile()
+{
+    static TraceFile traceFile;
+    return &traceFile;
+}
+
+bool RequestTrace::isEnabled()
+{
+    return traceFile()->enabled;
+}
+
+QByteArray RequestTrace::requestArgs(const PixmapRequest *request)
+{
+    if (!isEnabled())
+        return QByteArray();
+
+    return pageArgs(request->observer(), request->pageNumber(), request->width(), request->height(), request->isTile());
+}
+
+QByteArray RequestTrace::pageArgs(const DocumentObserver *observer, int page, int width, int height, bool tile)
+{
+    if (!isEnabled())
+        return QByteArray();
+
+    return "\"page\":" + QByteArray::number(page) + ",\"observer\":\"0x" + QByteArray::number(quintptr(observer), 16) + "\",\"width\":" + QByteArray::number(width) + ",\"height\":" + QByteArray::number(height) + ",\"tile\":" + (tile ? "true" : "false");
+}
+
+void RequestTrace::instant(const char *name, const QByteArray &args)
+{
+    if (isEnabled())
+        write(name, 'i', now(), 0, args);
+}
+
+void RequestTrace::complete(const char *name, qint64 start, qint64 duration, const QByteArray &args)
+{
+    if (isEnabled())
+        write(name, 'X', start, duration, args);
+}
+
+qint64 RequestTrace::now()
+{
+    // in microseconds, what the format wants
+    return traceFile()->clock.nsecsElapsed() / 1000;
+}
+
+void RequestTrace::write(const char *name, char phase, qint64 start, qint64 duration, const QByteArray &args)
+{
+    QByteArray event = QByteArrayLiteral("{\"name\":\"") + name + "\",\"ph\":\"" + phase + "\",\"ts\":" + QByteArray::number(start);
+    if (phase == 'X')
+        event += ",\"dur\":" + QByteArray::number(duration);
+    else
+        event += ",\"s\":\"t\"";
+    event += ",\"pid\":" + QByteArray::number(QCoreApplication::applicationPid()) + ",\"tid\":" + QByteArray::number(quintptr(QThread::currentThreadId())) + ",\"args\":{" + args + "}},\n";
+
+    TraceFile *trace = traceFile();
+    const qint64 time = now();
+    QMutexLocker locker(&trace->mutex);
+    if (trace->buffer.isEmpty())
+        trace->bufferStart = time;
+    trace->buffer += event;
+    if (trace->buffer.size() >= traceBufferSize || time - trace->bufferStart >= traceFlushInterval)
+        trace->flush();
+}
+
+RequestTrace::Scope::Scope(const char *name, const QByteArray &args)
+    : m_name(name)
+    , m_args(args)
+    , m_start(isEnabled() ? now() : 0)
+{
+}
+
+RequestTrace::Scope::~Scope()
+{
+    if (isEnabled())
+        write(m_name, 'X', m_start, now() - m_start, m_args);
+}
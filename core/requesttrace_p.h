@@ -0,0 +1,80 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_REQUESTTRACE_P_H_
+#define _OKULAR_REQUESTTRACE_P_H_
+
+#include <QByteArray>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+class DocumentObserver;
+class PixmapRequest;
+
+/**
+ * Trace of the stages of the pixmap requests, from the scroll that asks for
+ * them to the paint that shows them, in the Chrome trace event format that
+ * chrome://tracing and Perfetto open.
+ *
+ * It is off unless the OKULAR_TRACE environment variable names the file to
+ * write to; when off, checking it is all it costs. The file is a JSON array
+ * written a few events at a time, at most a second after they happen, so it
+ * can be read even if Okular doesn't exit cleanly. Events can be added from
+ * any thread.
+ */
+class OKULARCORE_EXPORT RequestTrace
+{
+public:
+    static bool isEnabled();
+
+    /**
+     * The arguments of the events about @p request: page, observer, size and tile.
+     */
+    static QByteArray requestArgs(const PixmapRequest *request);
+
+    static QByteArray pageArgs(const DocumentObserver *observer, int page, int width, int height, bool tile);
+
+    /**
+     * Adds an event at this moment.
+     */
+    static void instant(const char *name, const QByteArray &args = QByteArray());
+
+    /**
+     * Adds an event that started at @p start, from now(), and lasted @p duration.
+     */
+    static void complete(const char *name, qint64 start, qint64 duration, const QByteArray &args = QByteArray());
+
+    /**
+     * The time of the events, in microseconds.
+     */
+    static qint64 now();
+
+    /**
+     * An event lasting from its construction to its destruction.
+     */
+    class OKULARCORE_EXPORT Scope
+    {
+    public:
+        explicit Scope(const char *name, const QByteArray &args = QByteArray());
+        ~Scope();
+
+    private:
+        Q_DISABLE_COPY(Scope)
+
+        const char *m_name;
+        QByteArray m_args;
+        qint64 m_start;
+    };
+
+private:
+    static void write(const char *name, char phase, qint64 start, qint64 duration, const QByteArray &args);
+};
+
+}
+
+#endif
@@ -103,6 +103,13 @@ QImage RotationJobInternal::image() const
     return mRotatedImage;
 }
 
+QImage RotationJobInternal::takeImage()
+{
+    QImage image;
+    image.swap(mRotatedImage);
+    return image;
+}
+
 Rotation RotationJobInternal::rotation() const
 {
     return mNewRotation;
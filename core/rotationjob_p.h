@@ -27,6 +27,7 @@ class RotationJobInternal : public ThreadWeaver::Job
 
 public:
     QImage image() const;
+    QImage takeImage();
     Rotation rotation() const;
     NormalizedRect rect() const;
 
@@ -59,6 +60,11 @@ public:
     {
         return static_cast<const RotationJobInternal *>(job())->image();
     }
+    // the image, leaving none in the job
+    QImage takeImage()
+    {
+        return static_cast<RotationJobInternal *>(job())->takeImage();
+    }
     Rotation rotation() const
     {
         return static_cast<const RotationJobInternal *>(job())->rotation();
@@ -14,6 +14,8 @@
 #include <kjs_version.h>
 
 #include <QDebug>
+#include <QHash>
+#include <QSet>
 
 #include "../debug_p.h"
 #include "../document_p.h"
@@ -37,10 +39,12 @@ using namespace Okular;
 class Okular::ExecutorKJSPrivate
 {
 public:
-    explicit ExecutorKJSPrivate(DocumentPrivate *doc)
+    explicit ExecutorKJSPrivate(DocumentPrivate *doc, const QString &builtInScript)
         : m_doc(doc)
     {
         initTypes();
+        evaluate(builtInScript);
+        evaluate(QStringLiteral("var okularEventScripts = [];"));
     }
     ~ExecutorKJSPrivate()
     {
@@ -48,10 +52,15 @@ public:
     }
 
     void initTypes();
+    KJSResult evaluate(const QString &script);
+    QString eventScriptCall(const QString &script);
 
     DocumentPrivate *m_doc;
     KJSInterpreter *m_interpreter;
     KJSGlobalObject m_docObject;
+    // the event scripts already compiled, by their text, to their index in okularEventScripts
+    QHash<QString, int> m_eventScripts;
+    QSet<QString> m_brokenEventScripts;
 };
 
 void ExecutorKJSPrivate::initTypes()
@@ -85,8 +94,42 @@ void ExecutorKJSPrivate::initTypes()
     m_docObject.setProperty(ctx, QStringLiteral("util"), JSUtil::object(ctx));
 }
 
-ExecutorKJS::ExecutorKJS(DocumentPrivate *doc)
-    : d(new ExecutorKJSPrivate(doc))
+KJSResult ExecutorKJSPrivate::evaluate(const QString &script)
+{
+#if KJS_VERSION > QT_VERSION_CHECK(5, 71, 0)
+    m_interpreter->startTimeoutCheck();
+#endif
+    KJSResult result = m_interpreter->evaluate(QStringLiteral("okular.js"), 1, script, &m_docObject);
+#if KJS_VERSION > QT_VERSION_CHECK(5, 71, 0)
+    m_interpreter->stopTimeoutCheck();
+#endif
+    return result;
+}
+
+QString ExecutorKJSPrivate::eventScriptCall(const QString &script)
+{
+    // the same keystroke and format scripts run over and over, each is
+    // parsed once as a function that is then only called
+    QHash<QString, int>::const_iterator it = m_eventScripts.constFind(script);
+    if (it == m_eventScripts.constEnd()) {
+        if (m_brokenEventScripts.contains(script))
+            return script;
+
+        const int index = m_eventScripts.count();
+        KJSContext *ctx = m_interpreter->globalContext();
+        const KJSResult result = evaluate(QStringLiteral("okularEventScripts[%1] = function() {\n%2\n};").arg(QString::number(index), script));
+        if (result.isException() || ctx->hasException()) {
+            // run as it is, so it fails the way it always did
+            m_brokenEventScripts.insert(script);
+            return script;
+        }
+        it = m_eventScripts.insert(script, index);
+    }
+    return QStringLiteral("okularEventScripts[%1].call(this);").arg(*it);
+}
+
+ExecutorKJS::ExecutorKJS(DocumentPrivate *doc, const QString &builtInScript)
+    : d(new ExecutorKJSPrivate(doc, builtInScript))
 {
 }
 
@@ -102,15 +145,12 @@ void ExecutorKJS::execute(const QString &script, Event *event)
 {
     KJSContext *ctx = d->m_interpreter->globalContext();
 
+    // the other scripts may declare what the ones after them use
+    const QString code = event ? d->eventScriptCall(script) : script;
+
     d->m_docObject.setProperty(ctx, QStringLiteral("event"), event ? JSEvent::wrapEvent(ctx, event) : KJSUndefined());
 
-#if KJS_VERSION > QT_VERSION_CHECK(5, 71, 0)
-    d->m_interpreter->startTimeoutCheck();
-#endif
-    KJSResult result = d->m_interpreter->evaluate(QStringLiteral("okular.js"), 1, script, &d->m_docObject);
-#if KJS_VERSION > QT_VERSION_CHECK(5, 71, 0)
-    d->m_interpreter->stopTimeoutCheck();
-#endif
+    KJSResult result = d->evaluate(code);
 
     if (result.isException() || ctx->hasException()) {
         qCDebug(OkularCoreDebug) << "JS exception" << result.errorMessage();
@@ -18,12 +18,19 @@ class Event;
 class ExecutorKJS
 {
 public:
-    explicit ExecutorKJS(DocumentPrivate *doc);
+    /**
+     * Sets up the objects of @p doc and runs @p builtInScript, once.
+     */
+    ExecutorKJS(DocumentPrivate *doc, const QString &builtInScript);
     ~ExecutorKJS();
 
     ExecutorKJS(const ExecutorKJS &) = delete;
     ExecutorKJS &operator=(const ExecutorKJS &) = delete;
 
+    /**
+     * Runs @p script. Scripts of an @p event run as functions parsed the
+     * first time they are seen, their variables are their own.
+     */
     void execute(const QString &script, Event *event);
 
 private:
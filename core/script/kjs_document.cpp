@@ -187,16 +187,12 @@ static KJSObject docGetField(KJSContext *context, void *object, const KJSArgumen
 
     QString cName = arguments.at(0).toString(context);
 
-    QVector<Page *>::const_iterator pIt = doc->m_pagesVector.constBegin(), pEnd = doc->m_pagesVector.constEnd();
-    for (; pIt != pEnd; ++pIt) {
-        const QLinkedList<Okular::FormField *> pageFields = (*pIt)->formFields();
-        QLinkedList<Okular::FormField *>::const_iterator ffIt = pageFields.constBegin(), ffEnd = pageFields.constEnd();
-        for (; ffIt != ffEnd; ++ffIt) {
-            if ((*ffIt)->fullyQualifiedName() == cName) {
-                return JSField::wrapField(context, *ffIt, *pIt);
-            }
-        }
-    }
+    if (!doc->m_formIndexValid)
+        doc->buildFormIndex();
+    Okular::FormField *field = doc->m_formFieldsByName.value(cName);
+    Page *page = field ? doc->m_pagesVector.value(doc->m_formFieldPages.value(field, -1)) : nullptr;
+    if (page)
+        return JSField::wrapField(context, field, page);
     return KJSUndefined();
 }
 
@@ -41,7 +41,8 @@ static void updateField(FormField *field)
     if (page) {
         Document *doc = PagePrivate::get(page)->m_doc->m_parent;
         const int pageNumber = page->number();
-        QTimer::singleShot(0, doc, [doc, pageNumber] { doc->refreshPixmaps(pageNumber); });
+        const NormalizedRect area = field->rect();
+        QTimer::singleShot(0, doc, [doc, pageNumber, area] { doc->refreshPixmaps(pageNumber, area); });
         emit doc->refreshFormWidget(field);
     } else {
         qWarning() << "Could not get page of field" << field;
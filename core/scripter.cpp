@@ -61,9 +61,9 @@ void Scripter::execute(ScriptType type, const QString &script)
     switch (type) {
     case JavaScript:
         if (!d->m_kjs) {
-            d->m_kjs.reset(new ExecutorKJS(d->m_doc));
+            d->m_kjs.reset(new ExecutorKJS(d->m_doc, builtInScript));
         }
-        d->m_kjs->execute(builtInScript + script, d->m_event);
+        d->m_kjs->execute(script, d->m_event);
     }
 #endif
 }
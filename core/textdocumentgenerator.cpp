@@ -7,27 +7,41 @@
 #include "textdocumentgenerator.h"
 #include "textdocumentgenerator_p.h"
 
+#include <QElapsedTimer>
 #include <QFile>
 #include <QFontDatabase>
 #include <QImage>
 #include <QMutex>
 #include <QPainter>
+#include <QPicture>
 #include <QPrinter>
 #include <QStack>
+#include <QTextCursor>
+#include <QTextDocumentFragment>
 #include <QTextDocumentWriter>
 #include <QTextStream>
 #include <QVector>
 
+#include <threadweaver/queueing.h>
+
 #include "action.h"
 #include "annotations.h"
 #include "document_p.h"
 #include "page.h"
 #include "textpage.h"
 
+#include <climits>
 #include <cmath>
 
 using namespace Okular;
 
+// the pages laid out when opening the document, enough for the first screen
+static const int initialPages = 10;
+// how long a slice of loadMorePages() lays out for
+static const int layoutSliceTime = 30; // in msec
+// how much the recorded pages take at most, in KiB
+static const int picturesBudget = 32 * 1024;
+
 /**
  * Generic Converter Implementation
  */
@@ -79,39 +93,84 @@ TextDocumentGenerator *TextDocumentConverter::generator() const
  */
 Okular::TextPage *TextDocumentGeneratorPrivate::createTextPage(int pageNumber) const
 {
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     Q_Q(const TextDocumentGenerator);
-#endif
 
     Okular::TextPage *textPage = new Okular::TextPage;
 
     int start, end;
 
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     q->userMutex()->lock();
-#endif
     TextDocumentUtils::calculatePositions(mDocument, pageNumber, start, end);
 
-    {
-        QTextCursor cursor(mDocument);
-        for (int i = start; i < end - 1; ++i) {
-            cursor.setPosition(i);
-            cursor.setPosition(i + 1, QTextCursor::KeepAnchor);
-
-            QString text = cursor.selectedText();
-            if (text.length() == 1) {
-                QRectF rect;
-                TextDocumentUtils::calculateBoundingRect(mDocument, i, i + 1, rect, pageNumber);
-                if (pageNumber == -1)
-                    text = QStringLiteral("\n");
-
-                textPage->append(text, new Okular::NormalizedRect(rect.left(), rect.top(), rect.right(), rect.bottom()));
+    // one walk through the lines of the blocks of the page, the characters
+    // are where the layout of their line puts them
+    const QAbstractTextDocumentLayout *layout = mDocument->documentLayout();
+    const QSizeF pageSize = mDocument->pageSize();
+    const int pageHeight = qRound(pageSize.height());
+    for (QTextBlock block = mDocument->findBlock(start); block.isValid() && block.position() < end - 1; block = block.next()) {
+        const QTextLayout *blockLayout = block.layout();
+        if (!blockLayout) {
+            qCWarning(OkularCoreDebug) << "Layout of block not found at" << block.position();
+            continue;
+        }
+
+        const QRectF blockRect = layout->blockBoundingRect(block);
+        const QString text = block.text();
+        const int first = qMax(0, start - block.position());
+        // the block ends with a paragraph separator
+        const int last = qMin(text.length() + 1, end - 1 - block.position());
+
+        // where the separator ends, at the start of the next block
+        double nextX = blockRect.x();
+        double nextBottom = blockRect.bottom();
+        const QTextBlock nextBlock = block.next();
+        if (nextBlock.isValid() && nextBlock.layout() && nextBlock.layout()->lineCount() > 0) {
+            const QRectF nextRect = layout->blockBoundingRect(nextBlock);
+            const QTextLine nextLine = nextBlock.layout()->lineAt(0);
+            nextX = nextRect.x() + nextLine.cursorToX(0);
+            nextBottom = nextRect.y() + nextLine.y() + nextLine.height();
+        }
+
+        for (int l = 0; l < blockLayout->lineCount(); ++l) {
+            const QTextLine line = blockLayout->lineAt(l);
+            const bool lastLine = l == blockLayout->lineCount() - 1;
+            const int lineEnd = line.textStart() + line.textLength();
+            const int from = qMax(first, line.textStart());
+            const int to = qMin(last, lastLine ? text.length() + 1 : lineEnd);
+
+            const double y = blockRect.y() + line.y();
+            const double top = (qRound(y) % pageHeight) / pageSize.height();
+
+            for (int i = from; i < to; ++i) {
+                const QChar c = i < text.length() ? text.at(i) : QChar(QChar::ParagraphSeparator);
+                if (c.isSurrogate())
+                    continue;
+
+                // the character ends where the next one starts, which may be on the next line
+                const double x = blockRect.x() + line.cursorToX(i);
+                double r, b;
+                if (i == text.length()) {
+                    r = nextX;
+                    b = nextBottom;
+                } else if (i + 1 == lineEnd && !lastLine) {
+                    const QTextLine nextLine = blockLayout->lineAt(l + 1);
+                    r = blockRect.x() + nextLine.cursorToX(i + 1);
+                    b = blockRect.y() + nextLine.y() + nextLine.height();
+                } else {
+                    r = blockRect.x() + line.cursorToX(i + 1);
+                    b = y + line.height();
+                }
+
+                if (x > r) { // line break, so a pseudo character on this line
+                    textPage->append(QStringLiteral("\n"), new Okular::NormalizedRect(x / pageSize.width(), top, (x + 3) / pageSize.width(), top + line.height() / pageSize.height()));
+                    continue;
+                }
+
+                textPage->append(QString(c), new Okular::NormalizedRect(x / pageSize.width(), top, r / pageSize.width(), top + (b - y) / pageSize.height()));
             }
         }
     }
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
     q->userMutex()->unlock();
-#endif
 
     return textPage;
 }
@@ -178,7 +237,6 @@ QList<TextDocumentGeneratorPrivate::LinkInfo> TextDocumentGeneratorPrivate::gene
 
             LinkInfo info;
             info.link = linkPosition.link;
-            info.ownsLink = i == 0;
             info.page = std::floor(rect.y());
             info.boundingRect = QRectF(rect.x(), rect.y() - info.page, rect.width(), rect.height());
             result.append(info);
@@ -243,6 +301,185 @@ void TextDocumentGeneratorPrivate::generateTitleInfos()
     }
 }
 
+int TextDocumentGeneratorPrivate::layOutMore(int pages, int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // blockBoundingRect() lays out the document up to the block, the pages
+    // before the one the block starts in are final
+    QAbstractTextDocumentLayout *layout = mDocument->documentLayout();
+    const qreal pageHeight = mDocument->pageSize().height();
+    int completePages = 0;
+    while (mLayoutBlock.isValid()) {
+        const QRectF rect = layout->blockBoundingRect(mLayoutBlock);
+        mLayoutBlock = mLayoutBlock.next();
+        completePages = qMax(completePages, int(std::floor(rect.top() / pageHeight)));
+        if (completePages >= pages || timer.elapsed() >= msecs)
+            break;
+    }
+
+    if (!mLayoutBlock.isValid())
+        return mDocument->pageCount();
+    return completePages;
+}
+
+void TextDocumentGeneratorPrivate::appendPages(QVector<Okular::Page *> &pagesVector, int pageCount) const
+{
+    const QSize size = mDocument->pageSize().toSize();
+    for (int i = pagesVector.count(); i < pageCount; ++i)
+        pagesVector.append(new Okular::Page(i, size.width(), size.height(), Okular::Rotation0));
+}
+
+void TextDocumentGeneratorPrivate::finishLayout(const QVector<Okular::Page *> &pagesVector)
+{
+    // all of these lay out the document as far as they go
+    mDocument->documentLayout()->removeEventFilter(&mLayoutTimerFilter);
+
+    generateTitleInfos();
+    const QList<LinkInfo> linkInfos = generateLinkInfos();
+    const QList<AnnotationInfo> annotationInfos = generateAnnotationInfos();
+
+    QVector<QLinkedList<Okular::ObjectRect *>> objects(pagesVector.count());
+    for (const LinkInfo &info : linkInfos) {
+        // in case that the converter report bogus link info data, do not assert here
+        if (info.page < 0 || info.page >= objects.count())
+            continue;
+
+        // the links stay ours, a relayout gives the pages new rects for them
+        const QRectF rect = info.boundingRect;
+        objects[info.page].append(new Okular::NonOwningObjectRect(rect.left(), rect.top(), rect.right(), rect.bottom(), false, Okular::ObjectRect::Action, info.link));
+    }
+
+    QVector<QLinkedList<Okular::Annotation *>> annots(pagesVector.count());
+    for (const AnnotationInfo &info : annotationInfos) {
+        annots[info.page].append(info.annotation);
+    }
+
+    for (int i = 0; i < pagesVector.count(); ++i) {
+        Okular::Page *page = pagesVector.at(i);
+
+        if (!objects.at(i).isEmpty()) {
+            page->setObjectRects(objects.at(i));
+        }
+        QLinkedList<Okular::Annotation *>::ConstIterator annIt = annots.at(i).begin(), annEnd = annots.at(i).end();
+        for (; annIt != annEnd; ++annIt) {
+            page->addAnnotation(*annIt);
+        }
+    }
+}
+
+void TextDocumentGeneratorPrivate::deletePositions()
+{
+    mTitlePositions.clear();
+    for (const LinkPosition &linkPos : qAsConst(mLinkPositions)) {
+        delete linkPos.link;
+    }
+    mLinkPositions.clear();
+    for (const AnnotationPosition &annPos : qAsConst(mAnnotationPositions)) {
+        delete annPos.annotation;
+    }
+    mAnnotationPositions.clear();
+}
+
+void TextDocumentGeneratorPrivate::startRelayout(const QFont &font)
+{
+    Q_Q(TextDocumentGenerator);
+    QMutexLocker locker(q->userMutex());
+    mFont = font;
+    mRelaidOut = false;
+    ++mRelayoutGeneration;
+    // the pages keep the annotations they got, the rendering lays the rest out
+    if (!mDocument || !m_document || mLayoutBlock.isValid() || !mAnnotationPositions.isEmpty())
+        return;
+
+    // the character at the reading position, in the layout with the old font
+    mRelayoutStartViewport = m_document->m_parent->viewport();
+    mRelayoutPosition = -1;
+    if (mRelayoutStartViewport.isValid() && mRelayoutStartViewport.pageNumber < mDocument->pageCount()) {
+        const QSizeF pageSize = mDocument->pageSize();
+        const double margin = mDocument->rootFrame()->frameFormat().margin();
+        const bool enabled = mRelayoutStartViewport.rePos.enabled;
+        const double x = enabled ? mRelayoutStartViewport.rePos.normalizedX * pageSize.width() : margin;
+        const double y = (mRelayoutStartViewport.pageNumber + (enabled ? mRelayoutStartViewport.rePos.normalizedY : 0)) * pageSize.height();
+        mRelayoutPosition = mDocument->documentLayout()->hitTest(QPointF(x, qMax(y, margin)), Qt::FuzzyHit);
+    }
+
+    const int generation = mRelayoutGeneration;
+    mRelayoutQueue.enqueue(ThreadWeaver::make_job([this, generation] {
+        Q_Q(TextDocumentGenerator);
+        // in slices, so that closing the document or a newer font do not
+        // wait for the whole document to be laid out
+        QTextBlock block;
+        bool first = true;
+        while (first || block.isValid()) {
+            QMutexLocker locker(q->userMutex());
+            // a newer font, the file reloaded or the document closed
+            if (generation != mRelayoutGeneration || !mDocument)
+                return;
+
+            if (first) {
+                // setting it lays out the document again as far as it is asked for
+                if (mDocument->defaultFont() != mFont)
+                    mDocument->setDefaultFont(mFont);
+                block = mDocument->begin();
+                first = false;
+            }
+            QAbstractTextDocumentLayout *layout = mDocument->documentLayout();
+            QElapsedTimer slice;
+            slice.start();
+            while (block.isValid() && slice.elapsed() < layoutSliceTime) {
+                layout->blockBoundingRect(block);
+                block = block.next();
+            }
+            if (!block.isValid()) {
+                mDocument->pageCount();
+                mRelaidOut = true;
+            }
+        }
+
+        QMetaObject::invokeMethod(
+            q, [this, generation] { finishRelayout(generation); }, Qt::QueuedConnection);
+    }));
+}
+
+void TextDocumentGeneratorPrivate::finishRelayout(int generation)
+{
+    if (generation != mRelayoutGeneration || !mRelaidOut || !m_document)
+        return;
+
+    Document *document = m_document->m_parent;
+    mRelayoutReloading = true;
+    const bool reloaded = document->reloadInPlace();
+    mRelayoutReloading = false;
+    if (!reloaded) {
+        mRelaidOut = false;
+        return;
+    }
+    if (mRelayoutViewport.isValid())
+        document->setViewport(mRelayoutViewport);
+}
+
+QVector<uint> TextDocumentGeneratorPrivate::pageFingerprints() const
+{
+    // the formatted contents from the top of each page to the top of the next one
+    const int count = mDocument->pageCount();
+    QVector<int> starts(count);
+    int end;
+    for (int i = 0; i < count; ++i)
+        calculatePositions(i, starts[i], end);
+
+    QVector<uint> result;
+    result.reserve(count);
+    QTextCursor cursor(mDocument);
+    for (int i = 0; i < count; ++i) {
+        cursor.setPosition(starts.at(i));
+        cursor.setPosition(i + 1 < count ? starts.at(i + 1) : mDocument->characterCount() - 1, QTextCursor::KeepAnchor);
+        result.append(qHash(cursor.selection().toHtml()));
+    }
+    return result;
+}
+
 void TextDocumentGeneratorPrivate::initializeGenerator()
 {
     Q_Q(TextDocumentGenerator);
@@ -256,9 +493,13 @@ void TextDocumentGeneratorPrivate::initializeGenerator()
     q->setFeature(Generator::TextExtraction);
     q->setFeature(Generator::PrintNative);
     q->setFeature(Generator::PrintToFile);
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
+    q->setFeature(Generator::IncrementalPages);
+    q->setFeature(Generator::InPlaceReload);
     q->setFeature(Generator::Threaded);
-#endif
+    q->setFeature(Generator::ParallelRendering);
+    q->setFeature(Generator::SupportsCancelling);
+
+    mPagePictures.setMaxCost(picturesBudget);
 
     QObject::connect(mConverter, &TextDocumentConverter::addAction, q, [this](Action *a, int cb, int ce) { addAction(a, cb, ce); });
     QObject::connect(mConverter, &TextDocumentConverter::addAnnotation, q, [this](Annotation *a, int cb, int ce) { addAnnotation(a, cb, ce); });
@@ -293,66 +534,155 @@ Document::OpenResult TextDocumentGenerator::loadDocumentWithPassword(const QStri
         d->mDocument = nullptr;
 
         // loading failed, cleanup all the stuff eventually gathered from the converter
-        d->mTitlePositions.clear();
-        for (const TextDocumentGeneratorPrivate::LinkPosition &linkPos : qAsConst(d->mLinkPositions)) {
-            delete linkPos.link;
-        }
-        d->mLinkPositions.clear();
-        for (const TextDocumentGeneratorPrivate::AnnotationPosition &annPos : qAsConst(d->mAnnotationPositions)) {
-            delete annPos.annotation;
-        }
-        d->mAnnotationPositions.clear();
+        d->deletePositions();
 
         return openResult;
     }
     d->mDocument = d->mConverter->document();
+    d->mDocument->setDefaultFont(d->mFont);
+    d->mPagesFont = d->mFont;
 
-    d->generateTitleInfos();
-    const QList<TextDocumentGeneratorPrivate::LinkInfo> linkInfos = d->generateLinkInfos();
-    const QList<TextDocumentGeneratorPrivate::AnnotationInfo> annotationInfos = d->generateAnnotationInfos();
+    // only the first pages, loadMorePages() goes on with the others
+    d->mDocument->documentLayout()->installEventFilter(&d->mLayoutTimerFilter);
+    d->mLayoutBlock = d->mDocument->begin();
+    d->appendPages(pagesVector, d->layOutMore(initialPages, INT_MAX));
 
-    pagesVector.resize(d->mDocument->pageCount());
+    // the positions of titles, links and annotations need the document laid out up to them
+    if (!d->mLayoutBlock.isValid())
+        d->finishLayout(pagesVector);
 
-    const QSize size = d->mDocument->pageSize().toSize();
+    return openResult;
+}
 
-    QVector<QLinkedList<Okular::ObjectRect *>> objects(d->mDocument->pageCount());
-    for (const TextDocumentGeneratorPrivate::LinkInfo &info : linkInfos) {
-        // in case that the converter report bogus link info data, do not assert here
-        if (info.page < 0 || info.page >= objects.count())
-            continue;
+bool TextDocumentGenerator::loadMorePages(QVector<Okular::Page *> &pagesVector)
+{
+    Q_D(TextDocumentGenerator);
+    if (!d->mDocument || !d->mLayoutBlock.isValid())
+        return false;
 
-        const QRectF rect = info.boundingRect;
-        if (info.ownsLink) {
-            objects[info.page].append(new Okular::ObjectRect(rect.left(), rect.top(), rect.right(), rect.bottom(), false, Okular::ObjectRect::Action, info.link));
-        } else {
-            objects[info.page].append(new Okular::NonOwningObjectRect(rect.left(), rect.top(), rect.right(), rect.bottom(), false, Okular::ObjectRect::Action, info.link));
+    // the rendering threads lay out the document too
+    QMutexLocker locker(userMutex());
+    d->appendPages(pagesVector, d->layOutMore(INT_MAX, layoutSliceTime));
+    if (d->mLayoutBlock.isValid())
+        return true;
+
+    d->finishLayout(pagesVector);
+    return false;
+}
+
+bool TextDocumentGenerator::reloadDocument(const QString &fileName, QVector<Okular::Page *> &pagesVector, QVector<int> &changedPages)
+{
+    Q_D(TextDocumentGenerator);
+    // the document has its own ideas about the annotations of the pages
+    if (!d->mDocument || d->mLayoutBlock.isValid() || !d->mAnnotationPositions.isEmpty())
+        return false;
+
+    QMutexLocker locker(userMutex());
+    if (d->mRelayoutReloading) {
+        if (!d->mRelaidOut)
+            return false;
+
+        // the same document, laid out with another font by startRelayout()
+        d->mRelaidOut = false;
+        d->mPagesFont = d->mFont;
+        QMutexLocker picturesLocker(&d->mPicturesMutex);
+        d->mPagePictures.clear();
+        picturesLocker.unlock();
+
+        const int count = d->mDocument->pageCount();
+        pagesVector.resize(qMin(pagesVector.count(), count));
+        for (Okular::Page *page : qAsConst(pagesVector)) {
+            changedPages.append(page->number());
+            page->setObjectRects(QLinkedList<Okular::ObjectRect *>());
         }
+        d->appendPages(pagesVector, count);
+        d->mDocumentSynopsis = Okular::DocumentSynopsis();
+        d->finishLayout(pagesVector);
+
+        d->mRelayoutViewport = DocumentViewport();
+        double normalizedY;
+        const int page = d->mRelayoutPosition >= 0 ? TextDocumentUtils::calculatePage(d->mDocument, d->mRelayoutPosition, normalizedY) : -1;
+        if (page >= 0 && page < count) {
+            d->mRelayoutViewport = d->mRelayoutStartViewport;
+            d->mRelayoutViewport.pageNumber = page;
+            d->mRelayoutViewport.rePos.normalizedY = normalizedY;
+            d->mRelayoutViewport.rePos.enabled = true;
+        }
+        return true;
     }
 
-    QVector<QLinkedList<Okular::Annotation *>> annots(d->mDocument->pageCount());
-    for (const TextDocumentGeneratorPrivate::AnnotationInfo &info : annotationInfos) {
-        annots[info.page].append(info.annotation);
-    }
+    // the file changed, a relayout of the old contents is of no use anymore;
+    // all the pages look different if the old one was for another font
+    ++d->mRelayoutGeneration;
+    d->mRelaidOut = false;
+    const bool fontChanged = d->mPagesFont != d->mFont;
+    const QVector<uint> oldFingerprints = d->pageFingerprints();
 
-    for (int i = 0; i < d->mDocument->pageCount(); ++i) {
-        Okular::Page *page = new Okular::Page(i, size.width(), size.height(), Okular::Rotation0);
-        pagesVector[i] = page;
+    // the pages point to the links of the old document until they get the new ones
+    const QList<TextDocumentGeneratorPrivate::LinkPosition> oldLinkPositions = d->mLinkPositions;
+    d->mTitlePositions.clear();
+    d->mLinkPositions.clear();
+    d->mDocumentInfo = Okular::DocumentInfo();
+    const Document::OpenResult openResult = d->mConverter->convertWithPassword(fileName, QString());
+    QTextDocument *newDocument = openResult == Document::OpenSuccess ? d->mConverter->document() : nullptr;
+    if (!newDocument || newDocument->pageSize() != d->mDocument->pageSize() || !d->mAnnotationPositions.isEmpty()) {
+        // closed and opened again, that takes care of the rest
+        delete newDocument;
+        d->deletePositions();
+        d->mLinkPositions = oldLinkPositions;
+        return false;
+    }
 
-        if (!objects.at(i).isEmpty()) {
-            page->setObjectRects(objects.at(i));
-        }
-        QLinkedList<Okular::Annotation *>::ConstIterator annIt = annots.at(i).begin(), annEnd = annots.at(i).end();
-        for (; annIt != annEnd; ++annIt) {
-            page->addAnnotation(*annIt);
+    QTextDocument *oldDocument = d->mDocument;
+    d->mDocument = newDocument;
+    d->mDocument->setDefaultFont(d->mFont);
+    const QVector<uint> fingerprints = d->pageFingerprints();
+    const int oldCount = pagesVector.count();
+    const int count = fingerprints.count();
+
+    QMutexLocker picturesLocker(&d->mPicturesMutex);
+    for (int i = 0; i < oldCount; ++i) {
+        if (fontChanged || i >= count || fingerprints.at(i) != oldFingerprints.value(i)) {
+            if (i < count)
+                changedPages.append(i);
+            d->mPagePictures.remove(i);
         }
     }
+    picturesLocker.unlock();
 
-    return openResult;
+    pagesVector.resize(qMin(oldCount, count));
+    for (Okular::Page *page : qAsConst(pagesVector))
+        page->setObjectRects(QLinkedList<Okular::ObjectRect *>());
+    d->appendPages(pagesVector, count);
+    d->mDocumentSynopsis = Okular::DocumentSynopsis();
+    d->finishLayout(pagesVector);
+
+    for (const TextDocumentGeneratorPrivate::LinkPosition &linkPos : oldLinkPositions)
+        delete linkPos.link;
+    delete oldDocument;
+    d->mPagesFont = d->mFont;
+    return true;
 }
 
 bool TextDocumentGenerator::doCloseDocument()
 {
     Q_D(TextDocumentGenerator);
+    // a relayout still going on stops at its next slice, without being waited for
+    userMutex()->lock();
+    ++d->mRelayoutGeneration;
+    d->mRelaidOut = false;
+    userMutex()->unlock();
+
+    // the links are ours, the annotations are the pages' once they got them
+    if (!d->mLayoutBlock.isValid())
+        d->mAnnotationPositions.clear();
+    d->deletePositions();
+    d->mLayoutBlock = QTextBlock();
+
+    d->mPicturesMutex.lock();
+    d->mPagePictures.clear();
+    d->mPicturesMutex.unlock();
+
     delete d->mDocument;
     d->mDocument = nullptr;
 
@@ -376,35 +706,44 @@ void TextDocumentGenerator::generatePixmap(Okular::PixmapRequest *request)
     Generator::generatePixmap(request);
 }
 
-QImage TextDocumentGeneratorPrivate::image(PixmapRequest *request)
+qulonglong TextDocumentGenerator::cachedMemory() const
 {
-    if (!mDocument)
-        return QImage();
-
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
-    Q_Q(TextDocumentGenerator);
-#endif
-
-    QImage image(request->width(), request->height(), QImage::Format_ARGB32);
-    image.fill(Qt::white);
+    Q_D(const TextDocumentGenerator);
+    QMutexLocker locker(&d->mPicturesMutex);
+    return qulonglong(d->mPagePictures.totalCost()) * 1024;
+}
 
-    QPainter p;
-    p.begin(&image);
+qulonglong TextDocumentGenerator::freeCachedMemory(qulonglong bytes)
+{
+    Q_D(TextDocumentGenerator);
+    QMutexLocker locker(&d->mPicturesMutex);
+    const qulonglong before = qulonglong(d->mPagePictures.totalCost()) * 1024;
+    d->mPagePictures.setMaxCost(int((bytes < before ? before - bytes : 0) / 1024));
+    d->mPagePictures.setMaxCost(picturesBudget);
+    return before - qulonglong(d->mPagePictures.totalCost()) * 1024;
+}
 
-    qreal width = request->width();
-    qreal height = request->height();
+QPicture TextDocumentGeneratorPrivate::pagePicture(int pageNumber)
+{
+    // the cached ones are never played, a QPicture can't be played in two threads at the same time
+    {
+        QMutexLocker locker(&mPicturesMutex);
+        if (const QPicture *cached = mPagePictures.object(pageNumber)) {
+            QPicture picture;
+            picture.setData(cached->data(), cached->size());
+            return picture;
+        }
+    }
 
     const QSize size = mDocument->pageSize().toSize();
+    const QRect rect(0, pageNumber * size.height(), size.width(), size.height());
 
-    p.scale(width / (qreal)size.width(), height / (qreal)size.height());
-
-    QRect rect;
-    rect = QRect(0, request->pageNumber() * size.height(), size.width(), size.height());
-    p.translate(QPoint(0, request->pageNumber() * size.height() * -1));
+    QPicture picture;
+    QPainter p;
+    p.begin(&picture);
+    p.translate(QPoint(0, -rect.top()));
     p.setClipRect(rect);
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
-    q->userMutex()->lock();
-#endif
+
     QAbstractTextDocumentLayout::PaintContext context;
     context.palette.setColor(QPalette::Text, Qt::black);
     //  FIXME Fix Qt, this doesn't work, we have horrible hacks
@@ -412,11 +751,45 @@ QImage TextDocumentGeneratorPrivate::image(PixmapRequest *request)
     //        if Qt ever gets fixed
     //     context.palette.setColor( QPalette::Link, Qt::blue );
     context.clip = rect;
-    mDocument->setDefaultFont(mFont);
+    // setting it lays out the whole document again
+    if (mDocument->defaultFont() != mFont)
+        mDocument->setDefaultFont(mFont);
     mDocument->documentLayout()->draw(&p, context);
-#ifdef OKULAR_TEXTDOCUMENT_THREADED_RENDERING
+    p.end();
+
+    QPicture *cached = new QPicture;
+    cached->setData(picture.data(), picture.size());
+    QMutexLocker locker(&mPicturesMutex);
+    mPagePictures.insert(pageNumber, cached, qMax(1, int(picture.size() / 1024)));
+
+    return picture;
+}
+
+QImage TextDocumentGeneratorPrivate::image(PixmapRequest *request)
+{
+    if (!mDocument || request->shouldAbortRender())
+        return QImage();
+
+    Q_Q(TextDocumentGenerator);
+
+    // the layout of the document is shared, only recording the page needs it
+    q->userMutex()->lock();
+    // we may have waited for the lock long enough for the request to go stale
+    if (request->shouldAbortRender()) {
+        q->userMutex()->unlock();
+        return QImage();
+    }
+    const QSize size = mDocument->pageSize().toSize();
+    const QPicture picture = pagePicture(request->pageNumber());
     q->userMutex()->unlock();
-#endif
+
+    QImage image = request->renderTarget();
+    image.fill(Qt::white);
+
+    QPainter p;
+    p.begin(&image);
+    p.scale(request->width() / (qreal)size.width(), request->height() / (qreal)size.height());
+    p.drawPicture(0, 0, picture);
     p.end();
 
     return image;
@@ -434,6 +807,7 @@ bool TextDocumentGenerator::print(QPrinter &printer)
     if (!d->mDocument)
         return false;
 
+    QMutexLocker locker(userMutex());
     d->mDocument->print(&printer);
 
     return true;
@@ -486,6 +860,8 @@ bool TextDocumentGenerator::exportTo(const QString &fileName, const Okular::Expo
     if (!d->mDocument)
         return false;
 
+    QMutexLocker locker(userMutex());
+
     if (format.mimeType().name() == QLatin1String("application/pdf")) {
         QFile file(fileName);
         if (!file.open(QIODevice::WriteOnly))
@@ -524,7 +900,13 @@ bool TextDocumentGenerator::reparseConfig()
     const QFont newFont = d->mGeneralSettings->font();
 
     if (newFont != d->mFont) {
-        d->mFont = newFont;
+        // the pages recorded with the old font are not drawn again
+        d->mPicturesMutex.lock();
+        d->mPagePictures.clear();
+        d->mPicturesMutex.unlock();
+
+        // the converted document stays, only laid out again
+        d->startRelayout(newFont);
         return true;
     }
 
@@ -557,6 +939,10 @@ void TextDocumentGenerator::setTextDocument(QTextDocument *textDocument)
 
     d->mDocument = textDocument;
 
+    d->mPicturesMutex.lock();
+    d->mPagePictures.clear();
+    d->mPicturesMutex.unlock();
+
     for (Page *p : qAsConst(d->m_document->m_pagesVector)) {
         p->setTextPage(nullptr);
     }
@@ -177,9 +177,17 @@ public:
     // [INHERITED] load a document and fill up the pagesVector
     Document::OpenResult loadDocumentWithPassword(const QString &fileName, QVector<Okular::Page *> &pagesVector, const QString &password) override;
 
+    // [INHERITED] lay out the rest of the document
+    bool loadMorePages(QVector<Okular::Page *> &pagesVector) override;
+
+    // [INHERITED] convert the changed file again, keeping the pages that look the same
+    bool reloadDocument(const QString &fileName, QVector<Okular::Page *> &pagesVector, QVector<int> &changedPages) override;
+
     // [INHERITED] perform actions on document / pages
     bool canGeneratePixmap() const override;
     void generatePixmap(Okular::PixmapRequest *request) override;
+    qulonglong cachedMemory() const override;
+    qulonglong freeCachedMemory(qulonglong bytes) override;
 
     // [INHERITED] print document using already configured QPrinter
     bool print(QPrinter &printer) override;
@@ -8,9 +8,15 @@
 #define _OKULAR_TEXTDOCUMENTGENERATOR_P_H_
 
 #include <QAbstractTextDocumentLayout>
+#include <QCache>
+#include <QEvent>
+#include <QMutex>
+#include <QPicture>
 #include <QTextBlock>
 #include <QTextDocument>
 
+#include <threadweaver/queue.h>
+
 #include "action.h"
 #include "debug_p.h"
 #include "document.h"
@@ -61,6 +67,22 @@ static void calculateBoundingRect(QTextDocument *document, int startPosition, in
     rect = QRectF(x / pageSize.width(), offset / pageSize.height(), (r - x) / pageSize.width(), (b - y) / pageSize.height());
 }
 
+// the page of the line of the character at @p position, and how far down the page the line starts
+static int calculatePage(QTextDocument *document, int position, double &normalizedY)
+{
+    const QTextBlock block = document->findBlock(position);
+    const QTextLayout *layout = block.layout();
+    if (!block.isValid() || !layout)
+        return -1;
+
+    const QTextLine line = layout->lineForTextPosition(position - block.position());
+    const double y = document->documentLayout()->blockBoundingRect(block).y() + (line.isValid() ? line.y() : 0);
+    const double pageHeight = document->pageSize().height();
+    const int page = int(y / pageHeight);
+    normalizedY = y / pageHeight - page;
+    return page;
+}
+
 static QVector<QRectF> calculateBoundingRects(QTextDocument *document, int startPosition, int endPosition)
 {
     QVector<QRectF> result;
@@ -161,6 +183,17 @@ public:
     QTextDocument *mDocument;
 };
 
+// Swallows the timer events QTextDocumentLayout lays out the rest of the
+// document with on its own, the generator does it behind the userMutex()
+class TextDocumentLayoutTimerFilter : public QObject
+{
+public:
+    bool eventFilter(QObject * /*watched*/, QEvent *event) override
+    {
+        return event->type() == QEvent::Timer;
+    }
+};
+
 class TextDocumentGeneratorPrivate : public GeneratorPrivate
 {
     friend class TextDocumentConverter;
@@ -169,12 +202,18 @@ public:
     explicit TextDocumentGeneratorPrivate(TextDocumentConverter *converter)
         : mConverter(converter)
         , mDocument(nullptr)
+        , mRelayoutGeneration(0)
+        , mRelaidOut(false)
+        , mRelayoutReloading(false)
+        , mRelayoutPosition(-1)
         , mGeneralSettings(nullptr)
     {
+        mRelayoutQueue.setMaximumNumberOfThreads(1);
     }
 
     ~TextDocumentGeneratorPrivate() override
     {
+        mRelayoutQueue.finish();
         delete mConverter;
         delete mDocument;
     }
@@ -185,7 +224,6 @@ public:
         int page;
         QRectF boundingRect;
         Action *link;
-        bool ownsLink;
     };
 
     struct AnnotationInfo {
@@ -198,6 +236,7 @@ public:
 
     /* reimp */ QVariant metaData(const QString &key, const QVariant &option) const override;
     /* reimp */ QImage image(PixmapRequest *) override;
+    QPicture pagePicture(int pageNumber);
 
     void calculateBoundingRect(int startPosition, int endPosition, QRectF &rect, int &page) const;
     void calculatePositions(int page, int &start, int &end) const;
@@ -213,6 +252,14 @@ public:
     QList<AnnotationInfo> generateAnnotationInfos() const;
     void generateTitleInfos();
 
+    int layOutMore(int pages, int msecs);
+    void appendPages(QVector<Okular::Page *> &pagesVector, int pageCount) const;
+    void finishLayout(const QVector<Okular::Page *> &pagesVector);
+    void deletePositions();
+    void startRelayout(const QFont &font);
+    void finishRelayout(int generation);
+    QVector<uint> pageFingerprints() const;
+
     TextDocumentConverter *mConverter;
 
     QTextDocument *mDocument;
@@ -240,6 +287,30 @@ public:
     };
     QList<AnnotationPosition> mAnnotationPositions;
 
+    // the next block to lay out, invalid once the whole document is
+    QTextBlock mLayoutBlock;
+    TextDocumentLayoutTimerFilter mLayoutTimerFilter;
+
+    // the pages as painted by the layout, under the userMutex(), rendering
+    // plays them back in parallel
+    mutable QMutex mPicturesMutex;
+    QCache<int, QPicture> mPagePictures;
+
+    // lays the document out again with a new font, off the main thread;
+    // the state is under the userMutex(), only the main thread changes the generation
+    ThreadWeaver::Queue mRelayoutQueue;
+    int mRelayoutGeneration;
+    // laid out with mFont, reloadDocument() gives the pages their new contents
+    bool mRelaidOut;
+    // the reload is the one of finishRelayout(), not of a changed file
+    bool mRelayoutReloading;
+    // what the pages were laid out with, mDocument may have mFont already
+    QFont mPagesFont;
+    // the character at the reading position, and where it went
+    int mRelayoutPosition;
+    DocumentViewport mRelayoutStartViewport;
+    DocumentViewport mRelayoutViewport;
+
     TextDocumentSettings *mGeneralSettings;
 
     QFont mFont;
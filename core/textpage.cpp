@@ -15,8 +15,12 @@
 #include "page.h"
 #include "page_p.h"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <new>
 
+#include <QUrl>
 #include <QVarLengthArray>
 #include <QtAlgorithms>
 
@@ -114,17 +118,21 @@ static bool doesConsumeY(const NormalizedRect &first, const NormalizedRect &seco
   Even better, if the string we need to store has at most
   MaxStaticChars characters, then we store those in place of the QChar*
   that would be used (with new[] + free[]) for the data.
+  Once the text order of a page is final, its entities are moved to one
+  contiguous array, and their longer strings to one contiguous buffer,
+  see TextPagePrivate::compactWords().
  */
 class TinyTextEntity
 {
+public:
     static const int MaxStaticChars = sizeof(void *) / sizeof(QChar);
 
-public:
     TinyTextEntity(const QString &text, const NormalizedRect &rect)
-        : area(rect)
+        : ownsText(true)
     {
         Q_ASSERT_X(!text.isEmpty(), "TinyTextEntity", "empty string");
         Q_ASSERT_X(sizeof(d) == sizeof(void *), "TinyTextEntity", "internal storage is wider than QChar*, fix it!");
+        setArea(rect);
         length = text.length();
         switch (length) {
 #if QT_POINTER_SIZE >= 8
@@ -147,9 +155,46 @@ public:
         }
     }
 
+    /**
+     * A copy of @p other whose text, if it does not fit in place, is copied to
+     * @p arenaText instead of a new allocation
+     */
+    TinyTextEntity(const TinyTextEntity &other, QChar *arenaText)
+        : left(other.left)
+        , top(other.top)
+        , right(other.right)
+        , bottom(other.bottom)
+        , length(other.length)
+        , ownsText(other.length <= MaxStaticChars)
+    {
+        if (length <= MaxStaticChars) {
+            d = other.d;
+        } else {
+            d.data = arenaText;
+            std::memcpy(d.data, other.d.data, length * sizeof(QChar));
+        }
+    }
+
+    /**
+     * An entity for the @p length characters at @p text, that are copied to
+     * @p arenaText if they do not fit in place
+     */
+    TinyTextEntity(const NormalizedRect &rect, const QChar *text, int length, QChar *arenaText)
+        : length(length)
+        , ownsText(length <= MaxStaticChars)
+    {
+        setArea(rect);
+        if (length <= MaxStaticChars) {
+            std::memcpy(d.qc, text, length * sizeof(QChar));
+        } else {
+            d.data = arenaText;
+            std::memcpy(d.data, text, length * sizeof(QChar));
+        }
+    }
+
     ~TinyTextEntity()
     {
-        if (length > MaxStaticChars) {
+        if (length > MaxStaticChars && ownsText) {
             delete[] d.data;
         }
     }
@@ -159,23 +204,45 @@ public:
         return length <= MaxStaticChars ? QString::fromRawData((const QChar *)&d.qc[0], length) : QString::fromRawData(d.data, length);
     }
 
+    /**
+     * The number of characters that are not stored in place
+     */
+    inline int outOfPlaceLength() const
+    {
+        return length <= MaxStaticChars ? 0 : length;
+    }
+
+    inline NormalizedRect area() const
+    {
+        return NormalizedRect(left, top, right, bottom);
+    }
+
     inline NormalizedRect transformedArea(const QTransform &matrix) const
     {
-        NormalizedRect transformed_area = area;
+        NormalizedRect transformed_area = area();
         transformed_area.transform(matrix);
         return transformed_area;
     }
 
-    NormalizedRect area;
-
 private:
     Q_DISABLE_COPY(TinyTextEntity)
 
+    inline void setArea(const NormalizedRect &rect)
+    {
+        left = rect.left;
+        top = rect.top;
+        right = rect.right;
+        bottom = rect.bottom;
+    }
+
+    // floats are precise enough for hit-testing and take half the space
+    float left, top, right, bottom;
     union {
         QChar *data;
         ushort qc[MaxStaticChars];
     } d;
     int length;
+    bool ownsText;
 };
 
 TextEntity::TextEntity(const QString &text, NormalizedRect *area)
@@ -207,15 +274,613 @@ NormalizedRect TextEntity::transformedArea(const QTransform &matrix) const
     return transformed_area;
 }
 
+TextEntityGrid::TextEntityGrid()
+    : m_size(0)
+{
+}
+
+void TextEntityGrid::build(const TextList &words)
+{
+    // about 8 entities per cell, a line of text spans few of them
+    m_size = qBound(1, (int)std::sqrt(words.count() / 8.0), 64);
+    m_cells = QVector<QVector<int>>(m_size * m_size);
+
+    for (int i = 0; i < words.count(); ++i) {
+        const NormalizedRect &area = words.at(i)->area();
+        const int left = column(area.left), right = column(area.right);
+        const int top = row(area.top), bottom = row(area.bottom);
+        for (int y = top; y <= bottom; ++y) {
+            for (int x = left; x <= right; ++x)
+                m_cells[y * m_size + x].append(i);
+        }
+    }
+    for (QVector<int> &cell : m_cells)
+        cell.squeeze();
+}
+
+void TextEntityGrid::clear()
+{
+    m_size = 0;
+    m_cells.clear();
+}
+
+bool TextEntityGrid::isEmpty() const
+{
+    return m_size == 0;
+}
+
+qulonglong TextEntityGrid::memoryUsage() const
+{
+    qulonglong bytes = m_cells.capacity() * sizeof(QVector<int>);
+    for (const QVector<int> &cell : m_cells)
+        bytes += cell.capacity() * sizeof(int);
+    return bytes;
+}
+
+int TextEntityGrid::column(double x) const
+{
+    return qBound(0, (int)std::floor(x * m_size), m_size - 1);
+}
+
+int TextEntityGrid::row(double y) const
+{
+    return qBound(0, (int)std::floor(y * m_size), m_size - 1);
+}
+
+const QVector<int> &TextEntityGrid::candidates(double x, double y) const
+{
+    return m_cells.at(row(y) * m_size + column(x));
+}
+
+void TextEntityGrid::appendCandidates(const NormalizedRect &rect, QVector<int> *indexes) const
+{
+    const int left = column(rect.left), right = column(rect.right);
+    const int top = row(rect.top), bottom = row(rect.bottom);
+    for (int y = top; y <= bottom; ++y) {
+        for (int x = left; x <= right; ++x)
+            *indexes += m_cells.at(y * m_size + x);
+    }
+}
+
+QVector<int> TextEntityGrid::candidates(const NormalizedRect &rect) const
+{
+    QVector<int> indexes;
+    appendCandidates(rect, &indexes);
+    std::sort(indexes.begin(), indexes.end());
+    indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+    return indexes;
+}
+
+QVector<int> TextEntityGrid::candidates(const RegularAreaRect &area) const
+{
+    QVector<int> indexes;
+    for (const NormalizedRect &rect : area)
+        appendCandidates(rect, &indexes);
+    std::sort(indexes.begin(), indexes.end());
+    indexes.erase(std::unique(indexes.begin(), indexes.end()), indexes.end());
+    return indexes;
+}
+
+int TextMatches::count() const
+{
+    return m_matches.count();
+}
+
+bool TextMatches::isEmpty() const
+{
+    return m_matches.isEmpty();
+}
+
+void TextMatches::clear()
+{
+    m_areas.clear();
+    m_matches.clear();
+}
+
+void TextMatches::beginMatch(int word)
+{
+    m_matches.append(qMakePair(m_areas.count(), word));
+}
+
+void TextMatches::appendArea(const NormalizedRect &area)
+{
+    Q_ASSERT(!m_matches.isEmpty());
+    QPair<int, int> &match = m_matches.last();
+    const int begin = m_matches.count() > 1 ? m_matches.at(m_matches.count() - 2).first : 0;
+    if (match.first > begin && m_areas.last().intersects(area))
+        m_areas.last() |= area;
+    else
+        m_areas.append(area);
+    match.first = m_areas.count();
+}
+
+int TextMatches::word(int match) const
+{
+    return m_matches.at(match).second;
+}
+
+void TextMatches::areas(int match, int *begin, int *end) const
+{
+    *begin = match > 0 ? m_matches.at(match - 1).first : 0;
+    *end = m_matches.at(match).first;
+}
+
+const NormalizedRect &TextMatches::area(int index) const
+{
+    return m_areas.at(index);
+}
+
+// hyphenated '-' must be at the end of a word, so hyphenation means
+// we have a '-' just followed by a '\n' character
+// check if the string contains a '-' character
+// if the '-' is the last entry
+static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::ConstIterator &it, const TextList::ConstIterator &textListEnd)
+{
+    const int len = str.length();
+
+    // hyphenated '-' must be at the end of a word, so hyphenation means
+    // we have a '-' just followed by a '\n' character
+    // check if the string contains a '-' character
+    // if the '-' is the last entry
+    if (str.endsWith(QLatin1Char('-'))) {
+        // validity chek of it + 1
+        if ((it + 1) != textListEnd) {
+            // 1. if the next character is '\n'
+            const QString &lookahedStr = (*(it + 1))->text();
+            if (lookahedStr.startsWith(QLatin1Char('\n'))) {
+                return len - 1;
+            }
+
+            // 2. if the next word is in a different line or not
+            const NormalizedRect &hyphenArea = (*it)->area();
+            const NormalizedRect &lookaheadArea = (*(it + 1))->area();
+
+            // lookahead to check whether both the '-' rect and next character rect overlap
+            if (!doesConsumeY(hyphenArea, lookaheadArea, 70)) {
+                return len - 1;
+            }
+        }
+    }
+    // else if it is the second last entry - for example in pdf format
+    else if (str.endsWith(QLatin1String("-\n"))) {
+        return len - 2;
+    }
+
+    return len;
+}
+
+TextPageFlatText::TextPageFlatText()
+    : m_built(false)
+    , m_usable(false)
+    , m_skipsHyphens(false)
+{
+}
+
+void TextPageFlatText::build(const TextList &words)
+{
+    clear();
+    m_built = true;
+    m_usable = true;
+
+    m_wholeOffsets.reserve(words.count() + 1);
+    for (TextList::ConstIterator it = words.constBegin(); it != words.constEnd(); ++it) {
+        const QString text = (*it)->text();
+        if (text.isEmpty())
+            m_usable = false;
+        m_wholeOffsets.append(m_wholeText.length());
+        m_wholeText += text;
+        // the hyphen can be skipped when searching, the text searched has none
+        if (stringLengthAdaptedWithHyphen(text, it, words.constEnd()) != text.length())
+            m_skipsHyphens = true;
+    }
+    m_wholeOffsets.append(m_wholeText.length());
+
+    if (!m_skipsHyphens) {
+        m_text = m_wholeText;
+        m_offsets = m_wholeOffsets;
+        return;
+    }
+
+    m_offsets.reserve(words.count() + 1);
+    for (TextList::ConstIterator it = words.constBegin(); it != words.constEnd(); ++it) {
+        m_offsets.append(m_text.length());
+        m_text += (*it)->text().leftRef(stringLengthAdaptedWithHyphen((*it)->text(), it, words.constEnd()));
+    }
+    m_offsets.append(m_text.length());
+}
+
+void TextPageFlatText::clear()
+{
+    m_text.clear();
+    m_foldedText.clear();
+    m_offsets.clear();
+    m_wholeText.clear();
+    m_wholeOffsets.clear();
+    m_built = false;
+    m_usable = false;
+    m_skipsHyphens = false;
+}
+
+bool TextPageFlatText::isBuilt() const
+{
+    return m_built;
+}
+
+bool TextPageFlatText::isUsable(const QString &query) const
+{
+    // a hyphen of the query may be one of those skipped, or not
+    return m_usable && !(m_skipsHyphens && (query.contains(QLatin1Char('-')) || query.contains(QLatin1Char('\n'))));
+}
+
+qulonglong TextPageFlatText::memoryUsage() const
+{
+    qulonglong memory = (m_wholeText.capacity() + m_foldedText.capacity()) * sizeof(QChar) + m_wholeOffsets.capacity() * sizeof(int);
+    if (m_skipsHyphens)
+        memory += m_text.capacity() * sizeof(QChar) + m_offsets.capacity() * sizeof(int);
+    return memory;
+}
+
+const QString &TextPageFlatText::text(Qt::CaseSensitivity caseSensitivity)
+{
+    if (caseSensitivity == Qt::CaseSensitive)
+        return m_text;
+
+    if (m_foldedText.isEmpty())
+        m_foldedText = foldCase(m_text);
+    return m_foldedText;
+}
+
+const QString &TextPageFlatText::wholeText() const
+{
+    return m_wholeText;
+}
+
+QString TextPageFlatText::foldCase(const QString &text)
+{
+    // one character at a time, like QString::compare() does, so the length
+    // stays: the characters out of the BMP fold to ones out of it
+    QString folded = text;
+    QChar *c = folded.data();
+    QChar *const end = c + folded.length();
+    for (; c != end; ++c) {
+        if (c->isHighSurrogate() && c + 1 != end && (c + 1)->isLowSurrogate()) {
+            const uint ucs4 = QChar::toCaseFolded(QChar::surrogateToUcs4(*c, *(c + 1)));
+            if (QChar::requiresSurrogates(ucs4)) {
+                *c = QChar(QChar::highSurrogate(ucs4));
+                *(c + 1) = QChar(QChar::lowSurrogate(ucs4));
+            }
+            ++c;
+        } else {
+            *c = c->toCaseFolded();
+        }
+    }
+    return folded;
+}
+
+int TextPageFlatText::position(int entity, int offset) const
+{
+    // the offset may be in a hyphen the text searched doesn't have
+    return qMin(m_offsets.at(entity) + offset, entity + 1 < m_offsets.count() ? m_offsets.at(entity + 1) : m_offsets.last());
+}
+
+static void flatTextEntityAt(const QVector<int> &offsets, int position, int *entity, int *offset)
+{
+    *entity = std::upper_bound(offsets.constBegin(), offsets.constEnd(), position) - offsets.constBegin() - 1;
+    *offset = position - offsets.at(*entity);
+}
+
+void TextPageFlatText::entityAt(int position, int *entity, int *offset) const
+{
+    flatTextEntityAt(m_offsets, position, entity, offset);
+}
+
+void TextPageFlatText::wholeTextEntityAt(int position, int *entity, int *offset) const
+{
+    flatTextEntityAt(m_wholeOffsets, position, entity, offset);
+}
+
+// QString::indexOf(QChar) and lastIndexOf(QChar) are vectorized, so look for
+// the first character with them and compare the rest only there
+int TextPageFlatText::indexOf(const QString &haystack, const QString &needle, int from)
+{
+    const int last = haystack.length() - needle.length();
+    const QChar first = needle.at(0);
+    const size_t restSize = (needle.length() - 1) * sizeof(QChar);
+    for (int i = haystack.indexOf(first, from); i != -1 && i <= last; i = haystack.indexOf(first, i + 1)) {
+        if (memcmp(haystack.constData() + i + 1, needle.constData() + 1, restSize) == 0)
+            return i;
+    }
+    return -1;
+}
+
+int TextPageFlatText::lastIndexOf(const QString &haystack, const QString &needle, int end)
+{
+    const int from = end - needle.length();
+    if (from < 0)
+        return -1;
+
+    const QChar first = needle.at(0);
+    const size_t restSize = (needle.length() - 1) * sizeof(QChar);
+    // a negative position counts from the end for lastIndexOf()
+    for (int i = haystack.lastIndexOf(first, from); i != -1; i = i > 0 ? haystack.lastIndexOf(first, i - 1) : -1) {
+        if (memcmp(haystack.constData() + i + 1, needle.constData() + 1, restSize) == 0)
+            return i;
+    }
+    return -1;
+}
+
 TextPagePrivate::TextPagePrivate()
     : m_page(nullptr)
+    , m_textOrderCorrected(false)
+    , m_entityArena(nullptr)
+    , m_textArena(nullptr)
+{
+}
+
+const TextEntityGrid &TextPagePrivate::grid() const
+{
+    if (m_grid.isEmpty())
+        m_grid.build(m_words);
+    return m_grid;
+}
+
+TextPageFlatText &TextPagePrivate::flatText() const
+{
+    if (!m_flatText.isBuilt())
+        m_flatText.build(m_words);
+    return m_flatText;
+}
+
+void TextPagePrivate::wordsChanged()
+{
+    m_grid.clear();
+    m_flatText.clear();
+    m_urls.clear();
+    m_textOrderCorrected = false;
+}
+
+qulonglong TextPagePrivate::memoryUsage() const
 {
+    // an entity, its text when not in place, and its slot in the list
+    qulonglong bytes = m_words.count() * (sizeof(TinyTextEntity) + sizeof(TinyTextEntity *));
+    for (const TinyTextEntity *word : m_words)
+        bytes += word->outOfPlaceLength() * sizeof(QChar);
+    for (const TextPageUrl &url : m_urls)
+        bytes += sizeof(TextPageUrl) + url.url.capacity() * sizeof(QChar);
+    return bytes + m_searchPoints.count() * sizeof(SearchPoint) + m_grid.memoryUsage() + m_flatText.memoryUsage();
 }
 
 TextPagePrivate::~TextPagePrivate()
 {
     qDeleteAll(m_searchPoints);
-    qDeleteAll(m_words);
+    deleteWords();
+}
+
+void TextPagePrivate::deleteWords()
+{
+    if (!m_entityArena) {
+        qDeleteAll(m_words);
+        return;
+    }
+
+    for (TinyTextEntity *te : qAsConst(m_words))
+        te->~TinyTextEntity();
+    ::operator delete(m_entityArena);
+    delete[] m_textArena;
+    m_entityArena = nullptr;
+    m_textArena = nullptr;
+}
+
+// Copies @p words to one array of entities and one buffer for the text they
+// cannot store in place, which are returned in @p entityArena and @p textArena
+static TextList compactCopy(const TextList &words, TinyTextEntity **entityArena, QChar **textArena)
+{
+    int textLength = 0;
+    for (const TinyTextEntity *te : words)
+        textLength += te->outOfPlaceLength();
+
+    TinyTextEntity *entities = static_cast<TinyTextEntity *>(::operator new(words.count() * sizeof(TinyTextEntity)));
+    QChar *text = textLength > 0 ? new QChar[textLength] : nullptr;
+    QChar *nextText = text;
+    TextList compacted;
+    compacted.reserve(words.count());
+    for (int i = 0; i < words.count(); ++i) {
+        const TinyTextEntity *te = words.at(i);
+        compacted.append(new (entities + i) TinyTextEntity(*te, nextText));
+        nextText += te->outOfPlaceLength();
+    }
+
+    *entityArena = entities;
+    *textArena = text;
+    return compacted;
+}
+
+void TextPagePrivate::compactWords()
+{
+    if (m_words.isEmpty())
+        return;
+
+    TinyTextEntity *entities;
+    QChar *text;
+    const TextList compacted = compactCopy(m_words, &entities, &text);
+
+    deleteWords();
+    m_words = compacted;
+    m_entityArena = entities;
+    m_textArena = text;
+    wordsChanged();
+}
+
+void TextPagePrivate::appendCompactWords(const TextList &words, TinyTextEntity *entityArena, QChar *textArena)
+{
+    if (m_words.isEmpty()) {
+        m_words = words;
+        m_entityArena = entityArena;
+        m_textArena = textArena;
+        wordsChanged();
+        return;
+    }
+
+    // all the words are in one arena, or none is
+    TinyTextEntity *allEntities;
+    QChar *allText;
+    const TextList all = compactCopy(m_words + words, &allEntities, &allText);
+    for (TinyTextEntity *te : words)
+        te->~TinyTextEntity();
+    ::operator delete(entityArena);
+    delete[] textArena;
+
+    deleteWords();
+    m_words = all;
+    m_entityArena = allEntities;
+    m_textArena = allText;
+    wordsChanged();
+}
+
+void TextPagePrivate::copyWords(TextPagePrivate *other) const
+{
+    Q_ASSERT(other->m_words.isEmpty());
+    if (m_words.isEmpty())
+        return;
+
+    other->m_words = compactCopy(m_words, &other->m_entityArena, &other->m_textArena);
+    other->m_textOrderCorrected = m_textOrderCorrected;
+    other->m_urls = m_urls;
+}
+
+// the record of saveWords(): a WordsHeader, an EntityRecord per entity and
+// per URL, then the text of all the entities and then the one of the URLs
+struct WordsHeader {
+    quint32 entityCount;
+    quint32 textLength;
+    quint32 urlCount;
+    quint32 urlTextLength;
+};
+
+struct EntityRecord {
+    float left, top, right, bottom;
+    quint32 length;
+};
+
+static EntityRecord entityRecord(const NormalizedRect &area, int length)
+{
+    return {float(area.left), float(area.top), float(area.right), float(area.bottom), quint32(length)};
+}
+
+QByteArray TextPagePrivate::saveWords() const
+{
+    WordsHeader header = {quint32(m_words.count()), 0, quint32(m_urls.count()), 0};
+    for (const TinyTextEntity *te : qAsConst(m_words))
+        header.textLength += te->text().length();
+    for (const TextPageUrl &url : qAsConst(m_urls))
+        header.urlTextLength += url.url.length();
+
+    QByteArray record(sizeof(WordsHeader) + (header.entityCount + header.urlCount) * sizeof(EntityRecord) + (header.textLength + header.urlTextLength) * sizeof(QChar), Qt::Uninitialized);
+    char *out = record.data();
+    std::memcpy(out, &header, sizeof(WordsHeader));
+    out += sizeof(WordsHeader);
+
+    char *text = out + (header.entityCount + header.urlCount) * sizeof(EntityRecord);
+    for (const TinyTextEntity *te : qAsConst(m_words)) {
+        const QString entityText = te->text();
+        const EntityRecord entity = entityRecord(te->area(), entityText.length());
+        std::memcpy(out, &entity, sizeof(EntityRecord));
+        out += sizeof(EntityRecord);
+        std::memcpy(text, entityText.constData(), entityText.length() * sizeof(QChar));
+        text += entityText.length() * sizeof(QChar);
+    }
+    for (const TextPageUrl &url : qAsConst(m_urls)) {
+        const EntityRecord entity = entityRecord(url.area, url.url.length());
+        std::memcpy(out, &entity, sizeof(EntityRecord));
+        out += sizeof(EntityRecord);
+        std::memcpy(text, url.url.constData(), url.url.length() * sizeof(QChar));
+        text += url.url.length() * sizeof(QChar);
+    }
+    return record;
+}
+
+bool TextPagePrivate::loadWords(const char *data, qint64 size)
+{
+    Q_ASSERT(m_words.isEmpty());
+    WordsHeader header;
+    if (size < qint64(sizeof(WordsHeader)))
+        return false;
+    std::memcpy(&header, data, sizeof(WordsHeader));
+    if (size != qint64(sizeof(WordsHeader)) + (qint64(header.entityCount) + header.urlCount) * qint64(sizeof(EntityRecord)) + (qint64(header.textLength) + header.urlTextLength) * qint64(sizeof(QChar)))
+        return false;
+    if (header.entityCount == 0)
+        return header.urlCount == 0;
+
+    // the entities are copied with memcpy, the record may come from a file
+    // mapped in memory at any offset
+    const char *records = data + sizeof(WordsHeader);
+    const QChar *text = reinterpret_cast<const QChar *>(records + (header.entityCount + header.urlCount) * sizeof(EntityRecord));
+
+    const char *urlRecords = records + header.entityCount * sizeof(EntityRecord);
+    const QChar *urlText = text + header.textLength;
+    qint64 urlTextLength = 0;
+    QVector<TextPageUrl> urls;
+    urls.reserve(header.urlCount);
+    for (quint32 i = 0; i < header.urlCount; ++i) {
+        EntityRecord entity;
+        std::memcpy(&entity, urlRecords + i * sizeof(EntityRecord), sizeof(EntityRecord));
+        urlTextLength += entity.length;
+        if (entity.length == 0 || urlTextLength > header.urlTextLength)
+            return false;
+        QString url(entity.length, Qt::Uninitialized);
+        std::memcpy(url.data(), urlText, entity.length * sizeof(QChar));
+        urlText += entity.length;
+        urls.append({NormalizedRect(entity.left, entity.top, entity.right, entity.bottom), url});
+    }
+    if (urlTextLength != header.urlTextLength)
+        return false;
+
+    qint64 textLength = 0, outOfPlaceLength = 0;
+    for (quint32 i = 0; i < header.entityCount; ++i) {
+        EntityRecord entity;
+        std::memcpy(&entity, records + i * sizeof(EntityRecord), sizeof(EntityRecord));
+        if (entity.length == 0)
+            return false;
+        textLength += entity.length;
+        if (entity.length > quint32(TinyTextEntity::MaxStaticChars))
+            outOfPlaceLength += entity.length;
+    }
+    if (textLength != header.textLength)
+        return false;
+
+    TinyTextEntity *entities = static_cast<TinyTextEntity *>(::operator new(header.entityCount * sizeof(TinyTextEntity)));
+    QChar *arenaText = outOfPlaceLength > 0 ? new QChar[outOfPlaceLength] : nullptr;
+    QChar *nextArenaText = arenaText;
+    const QChar *nextText = text;
+    m_words.reserve(header.entityCount);
+    for (quint32 i = 0; i < header.entityCount; ++i) {
+        EntityRecord entity;
+        std::memcpy(&entity, records + i * sizeof(EntityRecord), sizeof(EntityRecord));
+        m_words.append(new (entities + i) TinyTextEntity(NormalizedRect(entity.left, entity.top, entity.right, entity.bottom), nextText, entity.length, nextArenaText));
+        nextText += entity.length;
+        if (entity.length > quint32(TinyTextEntity::MaxStaticChars))
+            nextArenaText += entity.length;
+    }
+
+    m_entityArena = entities;
+    m_textArena = arenaText;
+    wordsChanged();
+    m_urls = urls;
+    return true;
+}
+
+void TextPagePrivate::expandWords()
+{
+    if (!m_entityArena)
+        return;
+
+    TextList words;
+    words.reserve(m_words.count());
+    for (const TinyTextEntity *te : qAsConst(m_words))
+        words.append(new TinyTextEntity(te->text(), te->area()));
+
+    deleteWords();
+    m_words = words;
 }
 
 TextPage::TextPage()
@@ -240,28 +905,131 @@ TextPage::~TextPage()
     delete d;
 }
 
+// whether @p c is the same normalized and doesn't combine with the
+// characters before it: below U+0300 there are no combining marks, and
+// the only characters NFKC changes are the compatibility ones
+static inline bool isNormalized(QChar c)
+{
+    return c.unicode() < 0xA0 || (c.unicode() < 0x300 && c.decompositionTag() <= QChar::Canonical);
+}
+
+// the same for the @p length characters at @p text
+static bool isNormalized(const QChar *text, int length)
+{
+    for (int i = 0; i < length; ++i) {
+        if (!isNormalized(text[i]))
+            return false;
+    }
+    return true;
+}
+
 void TextPage::append(const QString &text, NormalizedRect *area)
 {
     if (!text.isEmpty()) {
+        // entities are added one by one to the heap
+        d->expandWords();
+
+        // most of the text, one glyph at a time, needs no normalizing
+        if (isNormalized(text.constData(), text.length())) {
+            d->m_words.append(new TinyTextEntity(text, *area));
+            d->wordsChanged();
+            delete area;
+            return;
+        }
+
         if (!d->m_words.isEmpty()) {
             TinyTextEntity *lastEntity = d->m_words.last();
             const QString concatText = lastEntity->text() + text.normalized(QString::NormalizationForm_KC);
             if (concatText != concatText.normalized(QString::NormalizationForm_KC)) {
                 // If this happens it means that the new text + old one have combined, for example A and ◌̊  form Å
-                NormalizedRect newArea = *area | lastEntity->area;
+                NormalizedRect newArea = *area | lastEntity->area();
                 delete area;
                 delete lastEntity;
                 d->m_words.removeLast();
                 d->m_words.append(new TinyTextEntity(concatText.normalized(QString::NormalizationForm_KC), newArea));
+                d->wordsChanged();
                 return;
             }
         }
 
         d->m_words.append(new TinyTextEntity(text.normalized(QString::NormalizationForm_KC), *area));
+        d->wordsChanged();
     }
     delete area;
 }
 
+void TextPage::append(const QString &text, const QVector<int> &lengths, const QVector<NormalizedRect> &areas)
+{
+    Q_ASSERT(lengths.count() == areas.count());
+
+    // the entities to add, their text is in text or, when normalizing
+    // changed it, in normalizedTexts
+    struct NewEntity {
+        const QChar *text;
+        int length;
+        NormalizedRect area;
+    };
+    QVector<NewEntity> entities;
+    entities.reserve(areas.count());
+    QVector<QString> normalizedTexts;
+
+    const QChar *next = text.constData();
+    const QChar *end = next + text.length();
+    for (int i = 0; i < areas.count(); ++i) {
+        const int length = qMin<int>(lengths.at(i), end - next);
+        const QChar *entityText = next;
+        next += length;
+        if (length <= 0)
+            continue;
+
+        if (isNormalized(entityText, length)) {
+            entities.append({entityText, length, areas.at(i)});
+            continue;
+        }
+
+        // the entity before it is one of the words there are already
+        if (entities.isEmpty()) {
+            append(QString(entityText, length), new NormalizedRect(areas.at(i)));
+            continue;
+        }
+
+        // like append(), joined with the entity before if they make one character
+        const QString normalized = QString::fromRawData(entityText, length).normalized(QString::NormalizationForm_KC);
+        NewEntity &last = entities.last();
+        const QString concatText = QString::fromRawData(last.text, last.length) + normalized;
+        const QString concatNormalized = concatText.normalized(QString::NormalizationForm_KC);
+        if (concatText != concatNormalized) {
+            normalizedTexts.append(concatNormalized);
+            last = {normalizedTexts.last().constData(), normalizedTexts.last().length(), last.area | areas.at(i)};
+        } else {
+            normalizedTexts.append(normalized);
+            entities.append({normalizedTexts.last().constData(), normalizedTexts.last().length(), areas.at(i)});
+        }
+    }
+    if (entities.isEmpty())
+        return;
+
+    int outOfPlaceLength = 0;
+    for (const NewEntity &entity : qAsConst(entities)) {
+        if (entity.length > TinyTextEntity::MaxStaticChars)
+            outOfPlaceLength += entity.length;
+    }
+
+    TinyTextEntity *entityArena = static_cast<TinyTextEntity *>(::operator new(entities.count() * sizeof(TinyTextEntity)));
+    QChar *textArena = outOfPlaceLength > 0 ? new QChar[outOfPlaceLength] : nullptr;
+    QChar *nextArenaText = textArena;
+    TextList words;
+    words.reserve(entities.count());
+    for (int i = 0; i < entities.count(); ++i) {
+        const NewEntity &entity = entities.at(i);
+        words.append(new (entityArena + i) TinyTextEntity(entity.area, entity.text, entity.length, nextArenaText));
+        if (entity.length > TinyTextEntity::MaxStaticChars)
+            nextArenaText += entity.length;
+    }
+
+    d->appendCompactWords(words, entityArena, textArena);
+}
+
 struct WordWithCharacters {
     WordWithCharacters(TinyTextEntity *w, const TextList &c)
         : word(w)
@@ -274,9 +1042,9 @@ struct WordWithCharacters {
         return word->text();
     }
 
-    inline const NormalizedRect &area() const
+    inline NormalizedRect area() const
     {
-        return word->area;
+        return word->area();
     }
 
     TinyTextEntity *word;
@@ -447,31 +1215,35 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
     TextList::ConstIterator start = it, end = itEnd, tmpIt = it; //, tmpItEnd = itEnd;
     const MergeSide side = d->m_page ? (MergeSide)d->m_page->totalOrientation() : MergeRight;
 
-    NormalizedRect tmp;
+    const TextEntityGrid &grid = d->grid();
+
     // case 2(a)
-    for (; it != itEnd; ++it) {
-        tmp = (*it)->area;
-        if (tmp.contains(startC.x, startC.y)) {
-            start = it;
+    // the last entity containing each point wins
+    const QVector<int> &startCandidates = grid.candidates(startC.x, startC.y);
+    for (int i = startCandidates.count() - 1; i >= 0; --i) {
+        if (d->m_words.at(startCandidates.at(i))->area().contains(startC.x, startC.y)) {
+            start = tmpIt + startCandidates.at(i);
+            break;
         }
-        if (tmp.contains(endC.x, endC.y)) {
-            end = it;
+    }
+    const QVector<int> &endCandidates = grid.candidates(endC.x, endC.y);
+    for (int i = endCandidates.count() - 1; i >= 0; --i) {
+        if (d->m_words.at(endCandidates.at(i))->area().contains(endC.x, endC.y)) {
+            end = tmpIt + endCandidates.at(i);
+            break;
         }
     }
 
     // case 2(b)
     it = tmpIt;
     if (start == it && end == itEnd) {
-        for (; it != itEnd; ++it) {
-            // is there any text rectangle within the start_end rect
-            tmp = (*it)->area;
-            if (start_end.intersects(tmp))
-                break;
-        }
+        // is there any text rectangle within the start_end rect
+        const QVector<int> candidates = grid.candidates(start_end);
+        const bool hasText = std::any_of(candidates.cbegin(), candidates.cend(), [this, &start_end](int i) { return start_end.intersects(d->m_words.at(i)->area()); });
 
         // we have searched every text entities, but none is within the rectangle created by start and end
         // so, no selection should be done
-        if (it == itEnd) {
+        if (!hasText) {
             return ret;
         }
     }
@@ -486,7 +1258,7 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
         // selection type 01
         if (startC.y <= endC.y) {
             for (; it != itEnd; ++it) {
-                rect = (*it)->area;
+                rect = (*it)->area();
                 rect.isBottom(startC) ? flagV = false : flagV = true;
 
                 if (flagV && rect.isRight(startC)) {
@@ -503,7 +1275,7 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
             int count = 0;
 
             for (; it != itEnd; ++it) {
-                rect = (*it)->area;
+                rect = (*it)->area();
 
                 if (rect.isBottomOrLevel(startC) && rect.isRight(startC)) {
                     count++;
@@ -537,7 +1309,7 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
 
         if (startC.y <= endC.y) {
             for (; itEnd >= it; itEnd--) {
-                rect = (*itEnd)->area;
+                rect = (*itEnd)->area();
                 rect.isTop(endC) ? flagV = false : flagV = true;
 
                 if (flagV && rect.isLeft(endC)) {
@@ -550,7 +1322,7 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
         else {
             int distance = scaleX + scaleY + 100;
             for (; itEnd >= it; itEnd--) {
-                rect = (*itEnd)->area;
+                rect = (*itEnd)->area();
 
                 if (rect.isTopOrLevel(endC) && rect.isLeft(endC)) {
                     QRect entRect = rect.geometry(scaleX, scaleY);
@@ -594,6 +1366,7 @@ RegularAreaRect *TextPage::textArea(TextSelection *sel) const
     if (end == d->m_words.constEnd())
         end--;
 
+    // the characters of a line merge into one shape as they are appended
     for (; start <= end; start++) {
         ret->appendShape((*start)->transformedArea(matrix), side);
     }
@@ -645,6 +1418,12 @@ RegularAreaRect *TextPage::findText(int searchID, const QString &query, SearchDi
         break;
     };
     RegularAreaRect *ret = nullptr;
+
+    // most pages can be searched as a single string
+    const QString normalizedQuery = query.normalized(QString::NormalizationForm_KC);
+    if (d->flatText().isUsable(normalizedQuery))
+        return d->findTextFlat(searchID, normalizedQuery, forward, caseSensitivity, start, start_offset);
+
     const TextComparisonFunction cmpFn = caseSensitivity == Qt::CaseSensitive ? CaseSensitiveCmpFn : CaseInsensitiveCmpFn;
     if (forward) {
         ret = d->findTextInternalForward(searchID, query, cmpFn, start, start_offset, end);
@@ -654,45 +1433,6 @@ RegularAreaRect *TextPage::findText(int searchID, const QString &query, SearchDi
     return ret;
 }
 
-// hyphenated '-' must be at the end of a word, so hyphenation means
-// we have a '-' just followed by a '\n' character
-// check if the string contains a '-' character
-// if the '-' is the last entry
-static int stringLengthAdaptedWithHyphen(const QString &str, const TextList::ConstIterator &it, const TextList::ConstIterator &textListEnd)
-{
-    const int len = str.length();
-
-    // hyphenated '-' must be at the end of a word, so hyphenation means
-    // we have a '-' just followed by a '\n' character
-    // check if the string contains a '-' character
-    // if the '-' is the last entry
-    if (str.endsWith(QLatin1Char('-'))) {
-        // validity chek of it + 1
-        if ((it + 1) != textListEnd) {
-            // 1. if the next character is '\n'
-            const QString &lookahedStr = (*(it + 1))->text();
-            if (lookahedStr.startsWith(QLatin1Char('\n'))) {
-                return len - 1;
-            }
-
-            // 2. if the next word is in a different line or not
-            const NormalizedRect &hyphenArea = (*it)->area;
-            const NormalizedRect &lookaheadArea = (*(it + 1))->area;
-
-            // lookahead to check whether both the '-' rect and next character rect overlap
-            if (!doesConsumeY(hyphenArea, lookaheadArea, 70)) {
-                return len - 1;
-            }
-        }
-    }
-    // else if it is the second last entry - for example in pdf format
-    else if (str.endsWith(QLatin1String("-\n"))) {
-        return len - 2;
-    }
-
-    return len;
-}
-
 RegularAreaRect *TextPagePrivate::searchPointToArea(const SearchPoint *sp)
 {
     PagePrivate *pagePrivate = PagePrivate::get(m_page);
@@ -712,6 +1452,68 @@ RegularAreaRect *TextPagePrivate::searchPointToArea(const SearchPoint *sp)
     return ret;
 }
 
+RegularAreaRect *TextPagePrivate::findTextFlat(int searchID, const QString &query, bool forward, Qt::CaseSensitivity caseSensitivity, const TextList::ConstIterator &start, int start_offset)
+{
+    TextPageFlatText &flat = flatText();
+    const QString &text = flat.text(caseSensitivity);
+    const QString needle = caseSensitivity == Qt::CaseSensitive ? query : TextPageFlatText::foldCase(query);
+
+    const int from = flat.position(start - m_words.constBegin(), start_offset);
+    const int matchStart = forward ? TextPageFlatText::indexOf(text, needle, from) : TextPageFlatText::lastIndexOf(text, needle, from);
+    if (matchStart == -1) {
+        delete m_searchPoints.take(searchID);
+        return nullptr;
+    }
+
+    int beginEntity, beginOffset, endEntity, endOffset;
+    flat.entityAt(matchStart, &beginEntity, &beginOffset);
+    flat.entityAt(matchStart + needle.length() - 1, &endEntity, &endOffset);
+
+    // save or update the search point for the current searchID
+    QMap<int, SearchPoint *>::iterator sIt = m_searchPoints.find(searchID);
+    if (sIt == m_searchPoints.end()) {
+        sIt = m_searchPoints.insert(searchID, new SearchPoint);
+    }
+    SearchPoint *sp = *sIt;
+    sp->it_begin = m_words.constBegin() + beginEntity;
+    sp->it_end = m_words.constBegin() + endEntity;
+    sp->offset_begin = beginOffset;
+    sp->offset_end = endOffset + 1;
+    return searchPointToArea(sp);
+}
+
+bool TextPagePrivate::findAllTextFlat(const QString &query, Qt::CaseSensitivity caseSensitivity, int word, TextMatches *matches)
+{
+    TextPageFlatText &flat = flatText();
+    const QString normalizedQuery = query.normalized(QString::NormalizationForm_KC);
+    if (!flat.isUsable(normalizedQuery))
+        return false;
+
+    const QString &text = flat.text(caseSensitivity);
+    const QString needle = caseSensitivity == Qt::CaseSensitive ? normalizedQuery : TextPageFlatText::foldCase(normalizedQuery);
+    for (int matchStart = TextPageFlatText::indexOf(text, needle, 0); matchStart != -1; matchStart = TextPageFlatText::indexOf(text, needle, matchStart + needle.length())) {
+        int first, last, offset;
+        flat.entityAt(matchStart, &first, &offset);
+        flat.entityAt(matchStart + needle.length() - 1, &last, &offset);
+        appendMatch(first, last, word, matches);
+    }
+    return true;
+}
+
+void TextPagePrivate::appendSearchPointMatch(int searchID, int word, TextMatches *matches) const
+{
+    const SearchPoint *sp = m_searchPoints.value(searchID);
+    if (sp)
+        appendMatch(sp->it_begin - m_words.constBegin(), sp->it_end - m_words.constBegin(), word, matches);
+}
+
+void TextPagePrivate::appendMatch(int first, int last, int word, TextMatches *matches) const
+{
+    matches->beginMatch(word);
+    for (int i = first; i <= last; ++i)
+        matches->appendArea(m_words.at(i)->area());
+}
+
 RegularAreaRect *TextPagePrivate::findTextInternalForward(int searchID, const QString &_query, TextComparisonFunction comparer, const TextList::ConstIterator &start, int start_offset, const TextList::ConstIterator &end)
 {
     // normalize query search all unicode (including glyphs)
@@ -932,15 +1734,20 @@ QString TextPage::text(const RegularAreaRect *area, TextAreaInclusionBehaviour b
     TextList::ConstIterator it = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
     QString ret;
     if (area) {
-        for (; it != itEnd; ++it) {
+        if (d->m_words.isEmpty())
+            return ret;
+
+        const QVector<int> candidates = d->grid().candidates(*area);
+        for (int i : candidates) {
+            const TinyTextEntity *te = d->m_words.at(i);
             if (b == AnyPixelTextAreaInclusionBehaviour) {
-                if (area->intersects((*it)->area)) {
-                    ret += (*it)->text();
+                if (area->intersects(te->area())) {
+                    ret += te->text();
                 }
             } else {
-                NormalizedPoint center = (*it)->area.center();
+                NormalizedPoint center = te->area().center();
                 if (area->contains(center.x, center.y)) {
-                    ret += (*it)->text();
+                    ret += te->text();
                 }
             }
         }
@@ -972,8 +1779,9 @@ static bool compareTinyTextEntityY(const WordWithCharacters &first, const WordWi
  */
 void TextPagePrivate::setWordList(const TextList &list)
 {
-    qDeleteAll(m_words);
+    deleteWords();
     m_words = list;
+    wordsChanged();
 }
 
 /**
@@ -1023,7 +1831,7 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
     for (; it != itEnd; it++) {
         QString textString = (*it)->text();
         QString newString;
-        QRect lineArea = (*it)->area.roundedGeometry(pageWidth, pageHeight), elementArea;
+        QRect lineArea = (*it)->area().roundedGeometry(pageWidth, pageHeight), elementArea;
         TextList wordCharacters;
         tmpIt = it;
         int space = 0;
@@ -1050,7 +1858,7 @@ static WordsWithCharacters makeWordFromCharacters(const TextList &characters, in
              */
             if (it == itEnd)
                 break;
-            elementArea = (*it)->area.roundedGeometry(pageWidth, pageHeight);
+            elementArea = (*it)->area().roundedGeometry(pageWidth, pageHeight);
             if (!doesConsumeY(elementArea, lineArea, 60)) {
                 --it;
                 break;
@@ -1400,7 +2208,7 @@ static RegionTextList XYCutForBoundingBoxes(const QList<WordWithCharacters> &wor
         // for every text in the region
         for (const WordWithCharacters &wwc : list) {
             TinyTextEntity *ent = wwc.word;
-            const QRect entRect = ent->area.geometry(pageWidth, pageHeight);
+            const QRect entRect = ent->area().geometry(pageWidth, pageHeight);
 
             // calculate vertical projection profile proj_on_xaxis1
             for (int k = entRect.left(); k <= entRect.left() + entRect.width(); ++k) {
@@ -1691,6 +2499,97 @@ void TextPagePrivate::correctTextOrder()
         listOfCharacters.append(word.characters);
     }
     setWordList(listOfCharacters);
+
+    // the order is final now, store the entities in text order
+    compactWords();
+    m_textOrderCorrected = true;
+}
+
+// the length of the start of a URL at @p i of @p text, its scheme or "www."
+// with up to 3 digits, or 0 if there is none there
+static int urlPrefixLength(const QChar *text, int length, int i)
+{
+    auto matches = [text, length, i](const char *prefix) {
+        int n = 0;
+        for (; prefix[n]; ++n) {
+            if (i + n >= length || text[i + n] != QLatin1Char(prefix[n]))
+                return 0;
+        }
+        return n;
+    };
+
+    if (text[i] == QLatin1Char('h'))
+        return qMax(matches("http://"), matches("https://"));
+    if (text[i] == QLatin1Char('f'))
+        return matches("ftp://");
+    if (text[i] == QLatin1Char('w') && matches("www")) {
+        int n = 3;
+        while (n < 6 && i + n < length && text[i + n].isDigit())
+            ++n;
+        return i + n < length && text[i + n] == QLatin1Char('.') ? n + 1 : 0;
+    }
+    return 0;
+}
+
+// what ends a sentence or a bracket after a URL is not part of it
+static bool isUrlTrailingPunctuation(QChar c)
+{
+    return c == QLatin1Char('.') || c == QLatin1Char(',') || c == QLatin1Char(';') || c == QLatin1Char(':') || c == QLatin1Char('!') || c == QLatin1Char('?') || c == QLatin1Char('\'') || c == QLatin1Char('"') ||
+        c == QLatin1Char(')') || c == QLatin1Char(']') || c == QLatin1Char('>');
+}
+
+/**
+ * Calls @p found with the start and the end of each URL of @p text: what
+ * starts with a scheme or "www." at the start of a word, up to the next
+ * space. The same URLs UrlUtils::getUrl() finds in a selection, in one pass
+ * and without copying the text.
+ */
+template<typename Found> static void scanUrls(const QString &text, Found found)
+{
+    const QChar *data = text.constData();
+    const int length = text.length();
+    for (int i = 0; i < length; ++i) {
+        // "xhttp://" is not a URL
+        if (i > 0 && data[i - 1].isLetterOrNumber())
+            continue;
+
+        const int prefix = urlPrefixLength(data, length, i);
+        if (prefix == 0)
+            continue;
+
+        int end = i + prefix;
+        while (end < length && !data[end].isSpace())
+            ++end;
+        while (end > i + prefix && isUrlTrailingPunctuation(data[end - 1]))
+            --end;
+        if (end > i + prefix)
+            found(i, end);
+        i = end;
+    }
+}
+
+void TextPagePrivate::detectUrls()
+{
+    m_urls.clear();
+    if (m_words.isEmpty())
+        return;
+
+    TextPageFlatText &flat = flatText();
+    const QString &text = flat.wholeText();
+    scanUrls(text, [this, &flat, &text](int start, int end) {
+        int first, last, offset;
+        flat.wholeTextEntityAt(start, &first, &offset);
+        flat.wholeTextEntityAt(end - 1, &last, &offset);
+        NormalizedRect area = m_words.at(first)->area();
+        for (int e = first + 1; e <= last; ++e)
+            area |= m_words.at(e)->area();
+
+        QString url = text.mid(start, end - start);
+        if (url.startsWith(QLatin1Char('w')))
+            url.prepend(QLatin1String("http://"));
+        if (QUrl(url).isValid())
+            m_urls.append({area, url});
+    });
 }
 
 TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionBehaviour b) const
@@ -1700,21 +2599,26 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
 
     TextEntity::List ret;
     if (area) {
-        for (const TinyTextEntity *te : qAsConst(d->m_words)) {
+        if (d->m_words.isEmpty())
+            return ret;
+
+        const QVector<int> candidates = d->grid().candidates(*area);
+        for (int i : candidates) {
+            const TinyTextEntity *te = d->m_words.at(i);
             if (b == AnyPixelTextAreaInclusionBehaviour) {
-                if (area->intersects(te->area)) {
-                    ret.append(new TextEntity(te->text(), new Okular::NormalizedRect(te->area)));
+                if (area->intersects(te->area())) {
+                    ret.append(new TextEntity(te->text(), new Okular::NormalizedRect(te->area())));
                 }
             } else {
-                const NormalizedPoint center = te->area.center();
+                const NormalizedPoint center = te->area().center();
                 if (area->contains(center.x, center.y)) {
-                    ret.append(new TextEntity(te->text(), new Okular::NormalizedRect(te->area)));
+                    ret.append(new TextEntity(te->text(), new Okular::NormalizedRect(te->area())));
                 }
             }
         }
     } else {
         for (const TinyTextEntity *te : qAsConst(d->m_words)) {
-            ret.append(new TextEntity(te->text(), new Okular::NormalizedRect(te->area)));
+            ret.append(new TextEntity(te->text(), new Okular::NormalizedRect(te->area())));
         }
     }
     return ret;
@@ -1723,12 +2627,13 @@ TextEntity::List TextPage::words(const RegularAreaRect *area, TextAreaInclusionB
 RegularAreaRect *TextPage::wordAt(const NormalizedPoint &p, QString *word) const
 {
     TextList::ConstIterator itBegin = d->m_words.constBegin(), itEnd = d->m_words.constEnd();
-    TextList::ConstIterator it = itBegin;
     TextList::ConstIterator posIt = itEnd;
-    for (; it != itEnd; ++it) {
-        if ((*it)->area.contains(p.x, p.y)) {
-            posIt = it;
-            break;
+    if (!d->m_words.isEmpty()) {
+        for (int i : d->grid().candidates(p.x, p.y)) {
+            if (d->m_words.at(i)->area().contains(p.x, p.y)) {
+                posIt = itBegin + i;
+                break;
+            }
         }
     }
     QString text;
@@ -1768,7 +2673,7 @@ RegularAreaRect *TextPage::wordAt(const NormalizedPoint &p, QString *word) const
                 break;
             }
 
-            ret->appendShape((*posIt)->area);
+            ret->appendShape((*posIt)->area());
             text += (*posIt)->text();
             if (itText.right(1).at(0).isSpace()) {
                 if (!text.endsWith(QLatin1String("-\n"))) {
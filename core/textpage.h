@@ -9,6 +9,7 @@
 
 #include <QList>
 #include <QString>
+#include <QVector>
 
 #include "global.h"
 #include "okularcore_export.h"
@@ -107,6 +108,7 @@ class OKULARCORE_EXPORT TextPage
     /// @cond PRIVATE
     friend class Page;
     friend class PagePrivate;
+    friend class TextPageDiskCache;
     /// @endcond
 
 public:
@@ -140,6 +142,18 @@ public:
      */
     void append(const QString &text, NormalizedRect *area);
 
+    /**
+     * Appends as many new entities as there are @p areas: the i-th one has
+     * the next @p lengths[i] characters of @p text and the area @p areas[i].
+     *
+     * It is like append() for each of them, but the entities are made in
+     * one pass over @p text and stored in one block of memory, instead of
+     * a string and an allocation for each. Entities of length 0 are skipped.
+     *
+     * @since 21.12
+     */
+    void append(const QString &text, const QVector<int> &lengths, const QVector<NormalizedRect> &areas);
+
     /**
      * Returns the bounding rect of the text which matches the following criteria
      * or 0 if the search is not successful.
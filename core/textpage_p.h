@@ -8,10 +8,15 @@
 #ifndef _OKULAR_TEXTPAGE_P_H_
 #define _OKULAR_TEXTPAGE_P_H_
 
+#include <QChar>
 #include <QList>
 #include <QMap>
 #include <QPair>
+#include <QString>
 #include <QTransform>
+#include <QVector>
+
+#include "area.h"
 
 class SearchPoint;
 
@@ -29,8 +34,176 @@ class RegionText;
 namespace Okular
 {
 class PagePrivate;
+class RegularAreaRect;
 typedef QList<TinyTextEntity *> TextList;
 
+/**
+ * A uniform grid over the page, keeping for each cell the indexes in the
+ * TextList of the entities that overlap it, so that hit-testing only looks
+ * at the entities near the point or area instead of all of them.
+ *
+ * The indexes of every cell are sorted, so the candidates come in text order.
+ */
+class TextEntityGrid
+{
+public:
+    TextEntityGrid();
+
+    void build(const TextList &words);
+    void clear();
+    bool isEmpty() const;
+    qulonglong memoryUsage() const;
+
+    /**
+     * The entities whose cell is the one of the point (@p x, @p y).
+     */
+    const QVector<int> &candidates(double x, double y) const;
+
+    /**
+     * The entities overlapping the cells of @p rect, sorted and unique.
+     */
+    QVector<int> candidates(const NormalizedRect &rect) const;
+
+    /**
+     * The entities overlapping the cells of any rect of @p area, sorted and unique.
+     */
+    QVector<int> candidates(const RegularAreaRect &area) const;
+
+private:
+    int column(double x) const;
+    int row(double y) const;
+    void appendCandidates(const NormalizedRect &rect, QVector<int> *indexes) const;
+
+    int m_size;
+    QVector<QVector<int>> m_cells;
+};
+
+/**
+ * The text of all the entities of a page in one string, for the fast path
+ * of TextPage::findText(): a match is then just a substring of it.
+ *
+ * Searches may skip the hyphen of the words hyphenated at the end of a
+ * line, so the text searched doesn't have them; the whole text is kept too
+ * for the pages with some. On those pages it is not usable for the queries
+ * with a hyphen, which may be one of them or not.
+ */
+class TextPageFlatText
+{
+public:
+    TextPageFlatText();
+
+    void build(const TextList &words);
+    void clear();
+    bool isBuilt() const;
+    /**
+     * Whether @p query, normalized already, can be searched in text().
+     */
+    bool isUsable(const QString &query) const;
+    qulonglong memoryUsage() const;
+
+    /**
+     * The text searched, or for case insensitive searches its case folded
+     * copy, made the first time it is needed.
+     */
+    const QString &text(Qt::CaseSensitivity caseSensitivity);
+
+    /**
+     * The text of all the entities, with all the hyphens.
+     */
+    const QString &wholeText() const;
+
+    /**
+     * The position in the text of the character @p offset of the entity
+     * @p entity, which may be one past the last one.
+     */
+    int position(int entity, int offset) const;
+
+    /**
+     * The entity with the character at @p position, and its offset in it.
+     */
+    void entityAt(int position, int *entity, int *offset) const;
+
+    /**
+     * Likewise for the character at @p position of wholeText().
+     */
+    void wholeTextEntityAt(int position, int *entity, int *offset) const;
+
+    /**
+     * The first match of @p needle in @p haystack that starts at @p from or after.
+     */
+    static int indexOf(const QString &haystack, const QString &needle, int from);
+
+    /**
+     * The last match of @p needle in @p haystack that ends at @p end or before.
+     */
+    static int lastIndexOf(const QString &haystack, const QString &needle, int end);
+
+    /**
+     * @p text case folded the way case insensitive searches compare it.
+     */
+    static QString foldCase(const QString &text);
+
+private:
+    QString m_text;
+    QString m_foldedText;
+    // where each entity starts in m_text, and the length of m_text
+    QVector<int> m_offsets;
+    // likewise with the hyphens, shared with the above on the pages without
+    QString m_wholeText;
+    QVector<int> m_wholeOffsets;
+    bool m_built;
+    bool m_usable;
+    bool m_skipsHyphens;
+};
+
+/**
+ * The matches of a search on a page, stored flat: the areas of all of them
+ * in one array, one match after the other, and for each match where its
+ * areas end and the search word it is of. Many matches then take a few
+ * allocations in all, and are copied around as values.
+ */
+class TextMatches
+{
+public:
+    int count() const;
+    bool isEmpty() const;
+    void clear();
+
+    /**
+     * Starts a match of the search word @p word, its areas are appended next.
+     */
+    void beginMatch(int word);
+
+    /**
+     * Appends @p area to the last match, united with its last area if they
+     * intersect, like RegularAreaRect::simplify() does.
+     */
+    void appendArea(const NormalizedRect &area);
+
+    int word(int match) const;
+
+    /**
+     * The areas of @p match are the ones from @p begin to before @p end.
+     */
+    void areas(int match, int *begin, int *end) const;
+
+    const NormalizedRect &area(int index) const;
+
+private:
+    QVector<NormalizedRect> m_areas;
+    // for each match where its areas end, and its word
+    QVector<QPair<int, int>> m_matches;
+};
+
+/**
+ * A URL written in the text of a page, where its words are, in the
+ * coordinates of the unrotated page.
+ */
+struct TextPageUrl {
+    NormalizedRect area;
+    QString url;
+};
+
 /**
  * Returns whether the two strings match.
  * Satisfies the condition that if two strings match then their lengths are equal.
@@ -56,19 +229,125 @@ public:
      */
     void setWordList(const TextList &list);
 
+    /**
+     * Moves the entities of m_words to one array, in their order, and the
+     * text they cannot store in place to one buffer. Their memory is then
+     * owned by the arena, not by each entity.
+     */
+    void compactWords();
+
+    /**
+     * Moves the entities of m_words back to separate allocations, so they
+     * can be deleted one by one again.
+     */
+    void expandWords();
+
+    /**
+     * Appends @p words, made in @p entityArena and @p textArena like
+     * compactWords() does, which the page owns from then on.
+     */
+    void appendCompactWords(const TextList &words, TinyTextEntity *entityArena, QChar *textArena);
+
+    /**
+     * Copies the entities of m_words to @p other, which must have none,
+     * stored like compactWords() does.
+     */
+    void copyWords(TextPagePrivate *other) const;
+
+    /**
+     * The entities of m_words and the URLs of m_urls in the binary record
+     * loadWords() reads, for TextPageDiskCache. It is in the byte order of
+     * the machine.
+     */
+    QByteArray saveWords() const;
+
+    /**
+     * Replaces m_words, which must be empty, and m_urls with the @p size
+     * bytes of a record of saveWords() at @p data, stored like
+     * compactWords() does.
+     * Returns false, and leaves m_words empty, if the record is not valid.
+     */
+    bool loadWords(const char *data, qint64 size);
+
+    /**
+     * Deletes the entities of m_words, wherever they are stored.
+     */
+    void deleteWords();
+
     /**
      * Make necessary modifications in the TextList to make the text order correct, so
      * that textselection works fine
      */
     void correctTextOrder();
 
+    /**
+     * Finds the URLs written in the text to m_urls, in one pass over
+     * flatText(). Like correctTextOrder() it only touches the text page.
+     */
+    void detectUrls();
+
+    /**
+     * Finds @p query, normalized already, in flatText(), that must be usable.
+     * Like findTextInternalForward() or findTextInternalBackward() but for
+     * the whole page at once.
+     */
+    RegularAreaRect *findTextFlat(int searchID, const QString &query, bool forward, Qt::CaseSensitivity caseSensitivity, const TextList::ConstIterator &start, int start_offset);
+
+    /**
+     * Appends all the matches of @p query in flatText(), if it is usable,
+     * to @p matches as matches of @p word, without building an area for
+     * each. Returns false if the page cannot be searched that way.
+     */
+    bool findAllTextFlat(const QString &query, Qt::CaseSensitivity caseSensitivity, int word, TextMatches *matches);
+
+    /**
+     * Appends the match the search @p searchID is at to @p matches, as a
+     * match of @p word.
+     */
+    void appendSearchPointMatch(int searchID, int word, TextMatches *matches) const;
+
+    /**
+     * Appends the entities @p first to @p last, not rotated, to @p matches
+     * as a match of @p word.
+     */
+    void appendMatch(int first, int last, int word, TextMatches *matches) const;
+
+    /**
+     * The text of m_words in one string, built the first time it is needed
+     */
+    TextPageFlatText &flatText() const;
+
+    /**
+     * The index of m_words for hit-testing, built the first time it is needed
+     */
+    const TextEntityGrid &grid() const;
+
+    /**
+     * Forgets the index, m_words changed
+     */
+    void wordsChanged();
+
+    /**
+     * An estimate of the memory of the words and of the indexes built from them
+     */
+    qulonglong memoryUsage() const;
+
     // variables those can be accessed directly from TextPage
     TextList m_words;
     QMap<int, SearchPoint *> m_searchPoints;
+    QVector<TextPageUrl> m_urls;
     Page *m_page;
+    bool m_textOrderCorrected;
 
 private:
     RegularAreaRect *searchPointToArea(const SearchPoint *sp);
+
+    mutable TextEntityGrid m_grid;
+    mutable TextPageFlatText m_flatText;
+
+    // the storage of m_words after compactWords()
+    TinyTextEntity *m_entityArena;
+    QChar *m_textArena;
 };
 
 }
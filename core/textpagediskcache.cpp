@@ -0,0 +1,195 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "textpagediskcache_p.h"
+
+#include <QMutexLocker>
+
+#include "debug_p.h"
+#include "page.h"
+#include "textpage.h"
+#include "textpage_p.h"
+
+using namespace Okular;
+
+static const quint32 kCacheMagic = 0x4f4b5450; // "OKTP"
+// bump when the layout of the text pages or the records change, old files are then dropped
+static const quint32 kCacheVersion = 2;
+
+// identifies the document the file is for, read back in the byte order of
+// the machine so a file from another one is dropped too
+static QByteArray cacheHeader(const QString &generatorName, const QDateTime &documentModified, int pageCount)
+{
+    struct {
+        quint32 magic;
+        quint32 version;
+        qint64 modified;
+        quint32 pageCount;
+        quint32 generatorNameLength;
+    } fields = {kCacheMagic, kCacheVersion, documentModified.toMSecsSinceEpoch(), quint32(pageCount), quint32(generatorName.length())};
+
+    QByteArray header(reinterpret_cast<const char *>(&fields), sizeof(fields));
+    header.append(reinterpret_cast<const char *>(generatorName.constData()), generatorName.length() * sizeof(QChar));
+    // keep the table aligned
+    while (header.size() % 8)
+        header.append('\0');
+    return header;
+}
+
+TextPageDiskCache::TextPageDiskCache()
+    : m_map(nullptr)
+    , m_mapSize(0)
+    , m_tableOffset(0)
+{
+}
+
+TextPageDiskCache::~TextPageDiskCache()
+{
+    close();
+}
+
+void TextPageDiskCache::setDocument(const QString &fileName, const QString &generatorName, const QDateTime &documentModified, int pageCount)
+{
+    close();
+
+    QMutexLocker locker(&m_mutex);
+    m_file.setFileName(fileName);
+    if (!m_file.open(QIODevice::ReadWrite)) {
+        qCWarning(OkularCoreDebug) << "Could not open the text page cache" << fileName;
+        return;
+    }
+
+    const QByteArray header = cacheHeader(generatorName, documentModified, pageCount);
+    m_tableOffset = header.size();
+    if (readTable(header, pageCount))
+        return;
+
+    if (!writeTable(header, pageCount)) {
+        qCWarning(OkularCoreDebug) << "Could not write the text page cache" << fileName;
+        m_file.close();
+        m_entries.clear();
+    }
+}
+
+bool TextPageDiskCache::readTable(const QByteArray &header, int pageCount)
+{
+    const qint64 tableSize = qint64(pageCount) * sizeof(Entry);
+    const qint64 fileSize = m_file.size();
+    if (fileSize < m_tableOffset + tableSize || m_file.read(header.size()) != header)
+        return false;
+
+    m_entries.resize(pageCount);
+    if (m_file.read(reinterpret_cast<char *>(m_entries.data()), tableSize) != tableSize)
+        return false;
+
+    // pages whose record did not make it to the file
+    for (Entry &entry : m_entries) {
+        if (entry.offset != 0 && (entry.offset < quint64(m_tableOffset + tableSize) || entry.offset + entry.size > quint64(fileSize)))
+            entry = Entry();
+    }
+    return true;
+}
+
+bool TextPageDiskCache::writeTable(const QByteArray &header, int pageCount)
+{
+    m_entries = QVector<Entry>(pageCount, Entry());
+    const qint64 tableSize = qint64(pageCount) * sizeof(Entry);
+    return m_file.resize(0) && m_file.seek(0) && m_file.write(header) == header.size() && m_file.write(reinterpret_cast<const char *>(m_entries.constData()), tableSize) == tableSize && m_file.flush();
+}
+
+void TextPageDiskCache::close()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_map)
+        m_file.unmap(m_map);
+    m_map = nullptr;
+    m_mapSize = 0;
+    m_file.close();
+    m_entries.clear();
+}
+
+bool TextPageDiskCache::isActive() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_file.isOpen();
+}
+
+TextPage *TextPageDiskCache::load(Page *page) const
+{
+    QMutexLocker locker(&m_mutex);
+    const int number = page->number();
+    if (!m_file.isOpen() || number < 0 || number >= m_entries.count())
+        return nullptr;
+
+    const Entry entry = m_entries.at(number);
+    if (entry.offset == 0 || entry.orientation != quint32(page->totalOrientation()))
+        return nullptr;
+
+    // the file grew since it was mapped
+    const qint64 end = entry.offset + entry.size;
+    if (end > m_mapSize) {
+        if (m_map)
+            m_file.unmap(m_map);
+        m_mapSize = m_file.size();
+        m_map = m_file.map(0, m_mapSize);
+        if (!m_map) {
+            m_mapSize = 0;
+            return nullptr;
+        }
+    }
+
+    TextPage *textPage = new TextPage();
+    if (!textPage->d->loadWords(reinterpret_cast<const char *>(m_map + entry.offset), entry.size)) {
+        qCWarning(OkularCoreDebug) << "Invalid text of page" << number << "in the text page cache" << m_file.fileName();
+        delete textPage;
+        return nullptr;
+    }
+
+    // already laid out for the page, setting it on the page does not do it again
+    textPage->d->m_page = page;
+    textPage->d->m_textOrderCorrected = true;
+    return textPage;
+}
+
+void TextPageDiskCache::store(const Page *page, const TextPage *textPage)
+{
+    QMutexLocker locker(&m_mutex);
+    const int number = page->number();
+    if (!textPage || !textPage->d->m_textOrderCorrected || !m_file.isOpen() || number < 0 || number >= m_entries.count())
+        return;
+
+    const quint32 orientation = page->totalOrientation();
+    if (m_entries.at(number).offset != 0 && m_entries.at(number).orientation == orientation)
+        return;
+
+    // the record first, so a table entry never points to a partial one
+    const QByteArray record = textPage->d->saveWords();
+    const qint64 offset = (m_file.size() + 7) & ~qint64(7);
+    const Entry entry = {quint64(offset), quint32(record.size()), orientation};
+    if (!m_file.seek(offset) || m_file.write(record) != record.size() || !m_file.flush()) {
+        qCWarning(OkularCoreDebug) << "Could not write to the text page cache" << m_file.fileName();
+        return;
+    }
+    if (!m_file.seek(m_tableOffset + qint64(number) * sizeof(Entry)) || m_file.write(reinterpret_cast<const char *>(&entry), sizeof(Entry)) != sizeof(Entry) || !m_file.flush()) {
+        qCWarning(OkularCoreDebug) << "Could not write to the text page cache" << m_file.fileName();
+        return;
+    }
+
+    m_entries[number] = entry;
+}
+
+void TextPageDiskCache::remove(int pageNumber)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_file.isOpen() || pageNumber < 0 || pageNumber >= m_entries.count() || m_entries.at(pageNumber).offset == 0)
+        return;
+
+    // the record stays in the file until it is written again for another document
+    const Entry entry = Entry();
+    m_entries[pageNumber] = entry;
+    if (!m_file.seek(m_tableOffset + qint64(pageNumber) * sizeof(Entry)) || m_file.write(reinterpret_cast<const char *>(&entry), sizeof(Entry)) != sizeof(Entry) || !m_file.flush())
+        qCWarning(OkularCoreDebug) << "Could not write to the text page cache" << m_file.fileName();
+}
@@ -0,0 +1,98 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_TEXTPAGEDISKCACHE_P_H_
+#define _OKULAR_TEXTPAGEDISKCACHE_P_H_
+
+#include <QDateTime>
+#include <QFile>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+class Page;
+class TextPage;
+
+/**
+ * Persistent cache of the text pages of a document, as they are once laid
+ * out for the page, so that reopening the document, or getting back a text
+ * page that was freed, does not need the generator to extract it again.
+ *
+ * All the pages live in one file, next to the docdata file of the document:
+ * a header that identifies the document, a table with the place of each
+ * page and then the records of the pages, appended as they come. The
+ * records are the entities of the text page as they are in memory, so
+ * loading a page is a copy out of the file mapped in memory.
+ *
+ * The layout depends on the orientation of the page, a page cached with
+ * another one is a miss. Loading can happen in any thread.
+ */
+class OKULARCORE_EXPORT TextPageDiskCache
+{
+public:
+    TextPageDiskCache();
+    ~TextPageDiskCache();
+
+    /**
+     * Starts caching the text pages of a document with @p pageCount pages,
+     * modified at @p documentModified, whose text comes from
+     * @p generatorName, in @p fileName. What the file has for another
+     * document is dropped.
+     */
+    void setDocument(const QString &fileName, const QString &generatorName, const QDateTime &documentModified, int pageCount);
+
+    /**
+     * Stops caching, the file stays for the next time.
+     */
+    void close();
+
+    bool isActive() const;
+
+    /**
+     * Returns the cached text of @p page, laid out already, or nullptr.
+     */
+    TextPage *load(Page *page) const;
+
+    /**
+     * Saves @p textPage, the laid out text of @p page, unless it is cached
+     * already for the orientation of the page.
+     */
+    void store(const Page *page, const TextPage *textPage);
+
+    /**
+     * Forgets the cached text of the page @p pageNumber, whose text changed
+     * while the file of the document did not, e.g. it was laid out again.
+     */
+    void remove(int pageNumber);
+
+private:
+    Q_DISABLE_COPY(TextPageDiskCache)
+
+    // the table of the file has one per page, offset 0 means not cached
+    struct Entry {
+        quint64 offset;
+        quint32 size;
+        quint32 orientation;
+    };
+
+    bool readTable(const QByteArray &header, int pageCount);
+    bool writeTable(const QByteArray &header, int pageCount);
+
+    mutable QMutex m_mutex;
+    mutable QFile m_file;
+    mutable uchar *m_map;
+    mutable qint64 m_mapSize;
+    QVector<Entry> m_entries;
+    qint64 m_tableOffset;
+};
+
+}
+
+#endif
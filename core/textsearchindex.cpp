@@ -0,0 +1,199 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "textsearchindex_p.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QSet>
+
+#include "debug_p.h"
+
+using namespace Okular;
+
+static const quint32 kIndexMagic = 0x4f4b5449; // "OKTI"
+// bump when the way words are split changes, old files are then ignored
+static const quint32 kIndexVersion = 1;
+
+TextSearchIndex::TextSearchIndex()
+    : m_modified(false)
+{
+}
+
+void TextSearchIndex::reset(int pageCount)
+{
+    m_postings.clear();
+    m_indexedPages = QBitArray(pageCount);
+    m_modified = false;
+}
+
+int TextSearchIndex::pageCount() const
+{
+    return m_indexedPages.size();
+}
+
+void TextSearchIndex::setPageCount(int pageCount)
+{
+    if (pageCount > m_indexedPages.size())
+        m_indexedPages.resize(pageCount);
+}
+
+bool TextSearchIndex::isIndexed(int page) const
+{
+    return page >= 0 && page < m_indexedPages.size() && m_indexedPages.testBit(page);
+}
+
+void TextSearchIndex::addPage(int page, const QString &text)
+{
+    if (page < 0 || page >= m_indexedPages.size() || m_indexedPages.testBit(page))
+        return;
+
+    QSet<QString> uniqueWords;
+    const QStringList pageWords = words(text);
+    for (const QString &word : pageWords)
+        uniqueWords.insert(word);
+    for (const QString &word : qAsConst(uniqueWords))
+        m_postings[word].append(page);
+
+    m_indexedPages.setBit(page);
+    m_modified = true;
+}
+
+QBitArray TextSearchIndex::candidatePages(const QString &query) const
+{
+    QBitArray candidates = ~m_indexedPages;
+
+    const QStringList queryWords = words(query.normalized(QString::NormalizationForm_KC));
+    if (queryWords.isEmpty()) {
+        candidates.fill(true);
+        return candidates;
+    }
+
+    // the first and last words of the query may be just the end and the
+    // start of a word of the page, so look inside all of them
+    QBitArray matching = m_indexedPages;
+    for (const QString &queryWord : queryWords) {
+        QBitArray wordPages(m_indexedPages.size());
+        QHash<QString, QVector<int>>::const_iterator it = m_postings.constBegin(), itEnd = m_postings.constEnd();
+        for (; it != itEnd; ++it) {
+            if (!it.key().contains(queryWord))
+                continue;
+            for (const int page : it.value())
+                wordPages.setBit(page);
+        }
+        matching &= wordPages;
+    }
+
+    return candidates | matching;
+}
+
+bool TextSearchIndex::isModified() const
+{
+    return m_modified;
+}
+
+bool TextSearchIndex::save(const QString &fileName, const QString &generatorName, const QDateTime &documentModified)
+{
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << kIndexMagic << kIndexVersion << generatorName << documentModified << m_indexedPages;
+    out << quint32(m_postings.count());
+    QHash<QString, QVector<int>>::const_iterator it = m_postings.constBegin(), itEnd = m_postings.constEnd();
+    for (; it != itEnd; ++it)
+        out << it.key() << it.value();
+
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        qCWarning(OkularCoreDebug) << "Failed to save the text search index to" << fileName;
+        return false;
+    }
+
+    m_modified = false;
+    return true;
+}
+
+bool TextSearchIndex::load(const QString &fileName, const QString &generatorName, const QDateTime &documentModified)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic, version;
+    in >> magic >> version;
+    if (magic != kIndexMagic || version != kIndexVersion)
+        return false;
+
+    QString savedGeneratorName;
+    QDateTime savedModified;
+    QBitArray indexedPages;
+    in >> savedGeneratorName >> savedModified >> indexedPages;
+    if (in.status() != QDataStream::Ok || savedGeneratorName != generatorName || savedModified != documentModified || indexedPages.size() != m_indexedPages.size())
+        return false;
+
+    quint32 wordCount;
+    in >> wordCount;
+    QHash<QString, QVector<int>> postings;
+    for (quint32 i = 0; i < wordCount && in.status() == QDataStream::Ok; ++i) {
+        QString word;
+        QVector<int> pages;
+        in >> word >> pages;
+        for (const int page : qAsConst(pages)) {
+            if (page < 0 || page >= indexedPages.size() || !indexedPages.testBit(page)) {
+                qCWarning(OkularCoreDebug) << "Invalid text search index" << fileName;
+                return false;
+            }
+        }
+        postings.insert(word, pages);
+    }
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    m_postings = postings;
+    m_indexedPages = indexedPages;
+    m_modified = false;
+    return true;
+}
+
+QStringList TextSearchIndex::words(const QString &text)
+{
+    QStringList words;
+    QString word;
+    const int length = text.length();
+    for (int i = 0; i < length; ++i) {
+        const QChar c = text.at(i);
+        if (c.isLetterOrNumber()) {
+            word += c.toCaseFolded();
+            continue;
+        }
+
+        // searches can skip the hyphen of a word split at the end of a line,
+        // so keep the two halves together (with or without the line break)
+        if (c == QLatin1Char('-') && !word.isEmpty()) {
+            int next = i + 1;
+            while (next < length && text.at(next).isSpace())
+                ++next;
+            if (next < length && text.at(next).isLetterOrNumber()) {
+                i = next - 1;
+                continue;
+            }
+        }
+
+        if (!word.isEmpty()) {
+            words.append(word);
+            word.clear();
+        }
+    }
+    if (!word.isEmpty())
+        words.append(word);
+
+    return words;
+}
@@ -0,0 +1,101 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_TEXTSEARCHINDEX_P_H_
+#define _OKULAR_TEXTSEARCHINDEX_P_H_
+
+#include <QBitArray>
+#include <QDateTime>
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "okularcore_export.h"
+
+namespace Okular
+{
+/**
+ * Inverted index of the words of a document, to know which pages a search
+ * can skip without getting their text.
+ *
+ * Pages are added one by one as their text is extracted, so the index is
+ * usually incomplete; the pages it does not know about are always candidates.
+ *
+ * Text searches match any substring, also across words and ignoring the
+ * hyphen at the end of a line, so a page is only ruled out when one of the
+ * words of the query is not part of any word of the page. A hyphen between
+ * two words, followed or not by spaces, is dropped and joins them, which is
+ * what keeps the words hyphenated at the end of a line findable.
+ *
+ * Words are case folded, so the index is suitable for case sensitive
+ * searches too, they just rule out less pages.
+ */
+class OKULARCORE_EXPORT TextSearchIndex
+{
+public:
+    TextSearchIndex();
+
+    /**
+     * Forgets all the pages and sets the number of pages of the document.
+     */
+    void reset(int pageCount);
+
+    int pageCount() const;
+
+    /**
+     * Sets a larger number of pages, for the pages that were appended to
+     * the document. The new pages are not indexed.
+     */
+    void setPageCount(int pageCount);
+
+    bool isIndexed(int page) const;
+
+    /**
+     * Adds the words of @p text, the whole text of @p page. Does nothing if
+     * the page is already indexed.
+     */
+    void addPage(int page, const QString &text);
+
+    /**
+     * The pages that may contain @p query: those that are not indexed and
+     * those that have all the words of it.
+     */
+    QBitArray candidatePages(const QString &query) const;
+
+    /**
+     * Whether pages were added since the index was reset or loaded.
+     */
+    bool isModified() const;
+
+    /**
+     * Writes the index to @p fileName. @p generatorName and @p documentModified
+     * identify the text the generator gave, see load().
+     */
+    bool save(const QString &fileName, const QString &generatorName, const QDateTime &documentModified);
+
+    /**
+     * Replaces the index with the one in @p fileName, if it was saved for a
+     * document with the same @p generatorName, modification time and
+     * number of pages than the current one.
+     */
+    bool load(const QString &fileName, const QString &generatorName, const QDateTime &documentModified);
+
+    /**
+     * Splits @p text in the case folded words the index is made of.
+     */
+    static QStringList words(const QString &text);
+
+private:
+    // word -> pages that have it, in the order they were added
+    QHash<QString, QVector<int>> m_postings;
+    QBitArray m_indexedPages;
+    bool m_modified;
+};
+
+}
+
+#endif
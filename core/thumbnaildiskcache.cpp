@@ -0,0 +1,203 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "thumbnaildiskcache_p.h"
+
+#include <QDir>
+#include <QFile>
+#include <QMetaObject>
+#include <QRegularExpression>
+#include <QSaveFile>
+
+#include <threadweaver/queueing.h>
+
+#include "debug_p.h"
+
+using namespace Okular;
+
+// the thumbnail list grows and shrinks its thumbnails by a few pixels at a time
+static const int kWidthBucketStep = 64;
+// bump when the way thumbnails are stored changes, old ones are then dropped
+static const int kCacheVersion = 1;
+
+static QByteArray cacheStamp(const QString &generatorName, const QDateTime &documentModified)
+{
+    return QByteArray::number(kCacheVersion) + ' ' + generatorName.toUtf8() + ' ' + QByteArray::number(documentModified.toMSecsSinceEpoch());
+}
+
+// identifies the document the thumbnails of the folder are for
+static const char kStampFileName[] = "stamp";
+
+ThumbnailDiskCache::ThumbnailDiskCache()
+{
+    // thumbnails are small, one thread keeps them in order and away from the generator
+    m_queue.setMaximumNumberOfThreads(1);
+}
+
+ThumbnailDiskCache::~ThumbnailDiskCache()
+{
+    m_queue.finish();
+}
+
+int ThumbnailDiskCache::widthBucket(int width)
+{
+    return qMax(1, (width + kWidthBucketStep - 1) / kWidthBucketStep) * kWidthBucketStep;
+}
+
+int ThumbnailDiskCache::widthBucketStep()
+{
+    return kWidthBucketStep;
+}
+
+quint64 ThumbnailDiskCache::key(int page, int bucket)
+{
+    return (quint64(quint32(page)) << 32) | quint32(bucket);
+}
+
+QString ThumbnailDiskCache::fileName(int page, int bucket) const
+{
+    return m_dir + QStringLiteral("/p%1-w%2.png").arg(page).arg(bucket);
+}
+
+void ThumbnailDiskCache::setDocument(const QString &dirName, const QString &generatorName, const QDateTime &documentModified)
+{
+    close();
+
+    QDir dir(dirName);
+    if (!dir.mkpath(QStringLiteral("."))) {
+        qCWarning(OkularCoreDebug) << "Could not create the thumbnail cache folder" << dirName;
+        return;
+    }
+
+    const QByteArray stamp = cacheStamp(generatorName, documentModified);
+    QFile stampFile(dir.filePath(QLatin1String(kStampFileName)));
+    const bool sameDocument = stampFile.open(QIODevice::ReadOnly) && stampFile.readAll() == stamp;
+    stampFile.close();
+
+    const QStringList files = dir.entryList({QStringLiteral("p*-w*.png")}, QDir::Files);
+    if (!sameDocument) {
+        for (const QString &f : files)
+            dir.remove(f);
+        QSaveFile newStamp(dir.filePath(QLatin1String(kStampFileName)));
+        if (!newStamp.open(QIODevice::WriteOnly) || newStamp.write(stamp) != stamp.size() || !newStamp.commit()) {
+            qCWarning(OkularCoreDebug) << "Could not write the thumbnail cache stamp in" << dirName;
+            return;
+        }
+    } else {
+        static const QRegularExpression re(QStringLiteral("^p(\\d+)-w(\\d+)\\.png$"));
+        for (const QString &f : files) {
+            const QRegularExpressionMatch match = re.match(f);
+            if (match.hasMatch())
+                m_entries.insert(key(match.capturedRef(1).toInt(), match.capturedRef(2).toInt()));
+        }
+    }
+
+    m_dir = dir.absolutePath();
+}
+
+void ThumbnailDiskCache::close()
+{
+    m_dir.clear();
+    m_entries.clear();
+    m_dirtyPages.clear();
+}
+
+bool ThumbnailDiskCache::isActive() const
+{
+    return !m_dir.isEmpty();
+}
+
+bool ThumbnailDiskCache::contains(int page, int width) const
+{
+    return !m_dir.isEmpty() && !m_dirtyPages.contains(page) && m_entries.contains(key(page, widthBucket(width)));
+}
+
+void ThumbnailDiskCache::load(int page, const QSize &size, QObject *context, const std::function<void(const QImage &)> &done)
+{
+    const int bucket = widthBucket(size.width());
+    const QString path = fileName(page, bucket);
+    const QString dir = m_dir;
+    m_queue.enqueue(ThreadWeaver::make_job([this, path, dir, page, bucket, size, context, done] {
+        QImage image;
+        if (image.load(path, "PNG") && image.size() != size)
+            image = image.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        if (image.isNull())
+            qCDebug(OkularCoreDebug) << "Could not read the cached thumbnail" << path;
+
+        QMetaObject::invokeMethod(
+            context,
+            [this, dir, page, bucket, image, done] {
+                // still the same document, then it's gone for good
+                if (image.isNull() && dir == m_dir)
+                    m_entries.remove(key(page, bucket));
+                done(image);
+            },
+            Qt::QueuedConnection);
+    }));
+}
+
+void ThumbnailDiskCache::store(int page, const QImage &image)
+{
+    if (m_dir.isEmpty() || image.isNull() || m_dirtyPages.contains(page))
+        return;
+
+    const int bucket = widthBucket(image.width());
+    const QString path = fileName(page, bucket);
+    m_entries.insert(key(page, bucket));
+    m_queue.enqueue(ThreadWeaver::make_job([path, image] {
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+        if (image.save(&file, "PNG"))
+            file.commit();
+        else
+            file.cancelWriting();
+    }));
+}
+
+void ThumbnailDiskCache::markPageDirty(int page)
+{
+    if (m_dir.isEmpty() || m_dirtyPages.contains(page))
+        return;
+
+    m_dirtyPages.insert(page);
+    QSet<quint64>::iterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        if (int(*it >> 32) == page)
+            it = m_entries.erase(it);
+        else
+            ++it;
+    }
+
+    // go through the queue so a write of this page that is still pending doesn't survive
+    const QString dir = m_dir;
+    m_queue.enqueue(ThreadWeaver::make_job([dir, page] {
+        QDir d(dir);
+        const QStringList files = d.entryList({QStringLiteral("p%1-w*.png").arg(page)}, QDir::Files);
+        for (const QString &f : files)
+            d.remove(f);
+    }));
+}
+
+void ThumbnailDiskCache::clear()
+{
+    if (m_dir.isEmpty())
+        return;
+
+    m_entries.clear();
+    const QString dir = m_dir;
+    m_queue.enqueue(ThreadWeaver::make_job([dir] {
+        QDir d(dir);
+        const QStringList files = d.entryList({QStringLiteral("p*-w*.png")}, QDir::Files);
+        for (const QString &f : files)
+            d.remove(f);
+    }));
+}
+
+void ThumbnailDiskCache::finish()
+{
+    m_queue.finish();
+}
@@ -0,0 +1,118 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_THUMBNAILDISKCACHE_P_H_
+#define _OKULAR_THUMBNAILDISKCACHE_P_H_
+
+#include <QDateTime>
+#include <QImage>
+#include <QSet>
+#include <QSize>
+#include <QString>
+
+#include <threadweaver/queue.h>
+
+#include <functional>
+
+#include "okularcore_export.h"
+
+class QObject;
+
+namespace Okular
+{
+/**
+ * Persistent cache of the thumbnails of the pages of a document, so the
+ * thumbnail list is filled right away when the document is opened again
+ * and the generator is free for the pages of the main view.
+ *
+ * The thumbnails live in a folder next to the docdata file of the document,
+ * one file for each page and width bucket: widths are rounded up to a
+ * multiple of widthBucketStep(), so resizing the thumbnail list a little
+ * still finds them. A stamp with the generator and the modification time of
+ * the document drops them all when the file changes.
+ *
+ * Thumbnails are in the generator orientation, the document takes care of
+ * the rotation. Reading and writing happen in one background thread, in
+ * the order they are asked for.
+ */
+class OKULARCORE_EXPORT ThumbnailDiskCache
+{
+public:
+    ThumbnailDiskCache();
+    ~ThumbnailDiskCache();
+
+    /**
+     * Starts caching the thumbnails of a document modified at
+     * @p documentModified, rendered by @p generatorName, in @p dirName.
+     * What the folder has for another document is dropped.
+     */
+    void setDocument(const QString &dirName, const QString &generatorName, const QDateTime &documentModified);
+
+    /**
+     * Stops caching, the thumbnails stay for the next time.
+     */
+    void close();
+
+    bool isActive() const;
+
+    /**
+     * Whether there is a thumbnail of @p page in the bucket of @p width.
+     */
+    bool contains(int page, int width) const;
+
+    /**
+     * Reads the thumbnail of @p page in the bucket of the width of @p size
+     * in the background and calls @p done with it, scaled to @p size, in the
+     * thread of @p context. The image is null if the thumbnail could not be
+     * read, then it is no longer contained either.
+     */
+    void load(int page, const QSize &size, QObject *context, const std::function<void(const QImage &)> &done);
+
+    /**
+     * Saves @p image as the thumbnail of @p page for its width.
+     * Pages marked as dirty are not stored.
+     */
+    void store(int page, const QImage &image);
+
+    /**
+     * Forgets the thumbnails of @p page and stops caching it until the next
+     * document is set, see PixmapDiskCache::markPageDirty().
+     */
+    void markPageDirty(int page);
+
+    /**
+     * Forgets all the thumbnails of the current document.
+     */
+    void clear();
+
+    /**
+     * Waits for the pending reads and writes.
+     */
+    void finish();
+
+    /**
+     * The width thumbnails of @p width are cached for.
+     */
+    static int widthBucket(int width);
+
+    static int widthBucketStep();
+
+private:
+    Q_DISABLE_COPY(ThumbnailDiskCache)
+
+    static quint64 key(int page, int bucket);
+    QString fileName(int page, int bucket) const;
+
+    QString m_dir;
+    // key() of the thumbnails in the folder
+    QSet<quint64> m_entries;
+    QSet<int> m_dirtyPages;
+    ThreadWeaver::Queue m_queue;
+};
+
+}
+
+#endif
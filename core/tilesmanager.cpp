@@ -5,17 +5,27 @@
 
 #include "tilesmanager_p.h"
 
+#include <algorithm>
+
 #include <QList>
 #include <QPainter>
 #include <QPixmap>
+#include <QVector>
 #include <qmath.h>
 
 #include "tile.h"
 
 #define TILES_MAXSIZE 2000000
+// the coarse levels of the pyramid, all together, stay below this many pixels
+#define PYRAMID_MAXSIZE 1000000
+#define PYRAMID_LEVELS 3
+#define PYRAMID_MINSIDE 64
 
 using namespace Okular;
 
+// the clock of TileNode::lastUsed, the tiles are only used from the GUI thread
+static quint64 s_tilesUseCounter = 0;
+
 static bool rankedTilesLessThan(TileNode *t1, TileNode *t2)
 {
     // Order tiles by its dirty state and then by distance from the viewport.
@@ -32,12 +42,13 @@ public:
 
     bool hasPixmap(const NormalizedRect &rect, const TileNode &tile) const;
     void tilesAt(const NormalizedRect &rect, TileNode &tile, QList<Tile> &result, TileLeaf tileLeaf);
-    void setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, TileNode &tile, bool isPartialPixmap);
+    void setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, TileNode &tile, bool isPartialPixmap, Rotation pixmapRotation);
 
     /**
      * Mark @p tile and all its children as dirty
      */
     static void markDirty(TileNode &tile);
+    static void markDirty(TileNode &tile, const NormalizedRect &rect);
 
     /**
      * Deletes all tiles, recursively
@@ -62,6 +73,13 @@ public:
      */
     bool splitBigTiles(TileNode &tile, const NormalizedRect &rect);
 
+    /**
+     * Creates the empty (transparent) coarse levels for the current size:
+     * the biggest halving of the page that fits the budget, and halvings
+     * of it.
+     */
+    void createPyramid();
+
     // The page is split in a 4x4 grid of tiles
     TileNode tiles[16];
     int width;
@@ -70,9 +88,19 @@ public:
     qulonglong totalPixels;
     Rotation rotation;
     NormalizedRect visibleRect;
-    NormalizedRect requestRect;
-    int requestWidth;
-    int requestHeight;
+
+    // the regions being rendered, there can be several at a time
+    struct Request {
+        NormalizedRect rect;
+        int width;
+        int height;
+    };
+    QVector<Request> requests;
+
+    // coarse copies of the page at 1/2^n of its size, finest first, in
+    // the rotation of the page; they can still be painted after a zoom
+    QVector<QPixmap> pyramid;
+    qulonglong pyramidPixels;
 };
 
 TilesManager::Private::Private()
@@ -81,9 +109,7 @@ TilesManager::Private::Private()
     , pageNumber(0)
     , totalPixels(0)
     , rotation(Rotation0)
-    , requestRect(NormalizedRect())
-    , requestWidth(0)
-    , requestHeight(0)
+    , pyramidPixels(0)
 {
 }
 
@@ -154,6 +180,10 @@ void TilesManager::setRotation(Rotation rotation)
         return;
 
     d->rotation = rotation;
+
+    // unlike tiles, the levels are not rotated lazily
+    d->pyramid.clear();
+    d->pyramidPixels = 0;
 }
 
 Rotation TilesManager::rotation() const
@@ -177,11 +207,36 @@ void TilesManager::Private::markDirty(TileNode &tile)
     }
 }
 
+void TilesManager::markDirty(const NormalizedRect &rect)
+{
+    for (TileNode &tile : d->tiles) {
+        TilesManager::Private::markDirty(tile, rect);
+    }
+}
+
+void TilesManager::Private::markDirty(TileNode &tile, const NormalizedRect &rect)
+{
+    if (!tile.rect.intersects(rect))
+        return;
+
+    tile.dirty = true;
+
+    for (int i = 0; i < tile.nTiles; ++i) {
+        markDirty(tile.tiles[i], rect);
+    }
+}
+
 void TilesManager::setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, bool isPartialPixmap)
+{
+    setPixmap(pixmap, rect, isPartialPixmap, d->rotation);
+}
+
+void TilesManager::setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, bool isPartialPixmap, Rotation pixmapRotation)
 {
     const NormalizedRect rotatedRect = TilesManager::fromRotatedRect(rect, d->rotation);
-    if (!d->requestRect.isNull()) {
-        if (!(d->requestRect == rect))
+    if (!d->requests.isEmpty()) {
+        auto request = std::find_if(d->requests.begin(), d->requests.end(), [&rect](const Private::Request &r) { return r.rect == rect; });
+        if (request == d->requests.end())
             return;
 
         if (pixmap) {
@@ -194,26 +249,39 @@ void TilesManager::setPixmap(const QPixmap *pixmap, const NormalizedRect &rect,
             QSize pixmapSize = pixmap->size();
             int w = width();
             int h = height();
-            if (d->rotation % 2) {
+            if (d->rotation % 2)
                 qSwap(w, h);
+            if (pixmapRotation % 2)
                 pixmapSize.transpose();
-            }
 
-            if (rotatedRect.geometry(w, h).size() != pixmapSize)
+            if (rotatedRect.geometry(w, h).size() != pixmapSize) {
+                // a late pixmap of a previous size, nothing else will come for it
+                if (!isPartialPixmap)
+                    d->requests.erase(request);
                 return;
+            }
         }
 
-        d->requestRect = NormalizedRect();
+        // partial updates are followed by the final one
+        if (!isPartialPixmap)
+            d->requests.erase(request);
     }
 
+    if (pixmap && !isPartialPixmap)
+        updatePyramid(*pixmap, rect, pixmapRotation);
+
     for (TileNode &tile : d->tiles) {
-        d->setPixmap(pixmap, rotatedRect, tile, isPartialPixmap);
+        d->setPixmap(pixmap, rotatedRect, tile, isPartialPixmap, pixmapRotation);
     }
 }
 
-void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, TileNode &tile, bool isPartialPixmap)
+void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, TileNode &tile, bool isPartialPixmap, Rotation pixmapRotation)
 {
-    QRect pixmapRect = TilesManager::toRotatedRect(rect, rotation).geometry(width, height);
+    // the size of the page as the pixmap is rotated
+    int pixmapWidth = width, pixmapHeight = height;
+    if ((rotation - pixmapRotation) % 2)
+        qSwap(pixmapWidth, pixmapHeight);
+    QRect pixmapRect = TilesManager::toRotatedRect(rect, pixmapRotation).geometry(pixmapWidth, pixmapHeight);
 
     // Exclude tiles outside the viewport
     if (!tile.rect.intersects(rect))
@@ -225,7 +293,7 @@ void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRec
         // paint children tiles
         if (tile.nTiles > 0) {
             for (int i = 0; i < tile.nTiles; ++i)
-                setPixmap(pixmap, rect, tile.tiles[i], isPartialPixmap);
+                setPixmap(pixmap, rect, tile.tiles[i], isPartialPixmap, pixmapRotation);
 
             delete tile.pixmap;
             tile.pixmap = nullptr;
@@ -244,10 +312,12 @@ void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRec
                 totalPixels -= tile.pixmap->width() * tile.pixmap->height();
                 delete tile.pixmap;
             }
-            tile.rotation = rotation;
+            // tilesAt() rotates it when it is painted
+            tile.rotation = pixmapRotation;
             if (pixmap) {
-                const NormalizedRect rotatedRect = TilesManager::toRotatedRect(tile.rect, rotation);
-                tile.pixmap = new QPixmap(pixmap->copy(rotatedRect.geometry(width, height).translated(-pixmapRect.topLeft())));
+                const NormalizedRect rotatedRect = TilesManager::toRotatedRect(tile.rect, pixmapRotation);
+                tile.pixmap = new QPixmap(pixmap->copy(rotatedRect.geometry(pixmapWidth, pixmapHeight).translated(-pixmapRect.topLeft())));
+                tile.lastUsed = ++s_tilesUseCounter;
                 totalPixels += tile.pixmap->width() * tile.pixmap->height();
             } else {
                 tile.pixmap = nullptr;
@@ -260,7 +330,7 @@ void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRec
             }
 
             for (int i = 0; i < tile.nTiles; ++i)
-                setPixmap(pixmap, rect, tile.tiles[i], isPartialPixmap);
+                setPixmap(pixmap, rect, tile.tiles[i], isPartialPixmap, pixmapRotation);
         }
     } else {
         QRect tileRect = tile.rect.geometry(width, height);
@@ -275,7 +345,7 @@ void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRec
             }
 
             for (int i = 0; i < tile.nTiles; ++i)
-                setPixmap(pixmap, rect, tile.tiles[i], isPartialPixmap);
+                setPixmap(pixmap, rect, tile.tiles[i], isPartialPixmap, pixmapRotation);
         } else {
             // remove children tiles
             for (int i = 0; i < tile.nTiles; ++i) {
@@ -292,10 +362,12 @@ void TilesManager::Private::setPixmap(const QPixmap *pixmap, const NormalizedRec
                 totalPixels -= tile.pixmap->width() * tile.pixmap->height();
                 delete tile.pixmap;
             }
-            tile.rotation = rotation;
+            // tilesAt() rotates it when it is painted
+            tile.rotation = pixmapRotation;
             if (pixmap) {
-                const NormalizedRect rotatedRect = TilesManager::toRotatedRect(tile.rect, rotation);
-                tile.pixmap = new QPixmap(pixmap->copy(rotatedRect.geometry(width, height).translated(-pixmapRect.topLeft())));
+                const NormalizedRect rotatedRect = TilesManager::toRotatedRect(tile.rect, pixmapRotation);
+                tile.pixmap = new QPixmap(pixmap->copy(rotatedRect.geometry(pixmapWidth, pixmapHeight).translated(-pixmapRect.topLeft())));
+                tile.lastUsed = ++s_tilesUseCounter;
                 totalPixels += tile.pixmap->width() * tile.pixmap->height();
             } else {
                 tile.pixmap = nullptr;
@@ -410,6 +482,8 @@ void TilesManager::Private::tilesAt(const NormalizedRect &rect, TileNode &tile,
             tile.pixmap = rotatedPixmap;
             tile.rotation = rotation;
         }
+        if (tile.pixmap && tileLeaf == PixmapTile)
+            tile.lastUsed = ++s_tilesUseCounter;
         result.append(Tile(rotatedRect, tile.pixmap, tile.isValid()));
     } else {
         for (int i = 0; i < tile.nTiles; ++i)
@@ -419,7 +493,73 @@ void TilesManager::Private::tilesAt(const NormalizedRect &rect, TileNode &tile,
 
 qulonglong TilesManager::totalMemory() const
 {
-    return 4 * d->totalPixels;
+    return 4 * (d->totalPixels + d->pyramidPixels);
+}
+
+void TilesManager::updatePyramid(const QPixmap &pixmap, const NormalizedRect &rect, Rotation pixmapRotation)
+{
+    if (d->pyramid.isEmpty())
+        d->createPyramid();
+
+    // every level is scaled down from the previous one, halving is cheap
+    // and keeps the quality
+    const QPixmap *source = &pixmap;
+    QRect sourceRect = pixmap.rect();
+    // only the first level is painted from the pixmap
+    int angle = ((d->rotation - pixmapRotation + 4) % 4) * 90;
+    for (QPixmap &level : d->pyramid) {
+        const QRect targetRect = rect.geometry(level.width(), level.height());
+        {
+            QPainter p(&level);
+            p.setCompositionMode(QPainter::CompositionMode_Source);
+            p.setRenderHint(QPainter::SmoothPixmapTransform);
+            if (angle == 0) {
+                p.drawPixmap(targetRect, *source, sourceRect);
+            } else {
+                const QSizeF size = angle % 180 ? QSizeF(targetRect.height(), targetRect.width()) : QSizeF(targetRect.size());
+                p.setClipRect(targetRect);
+                p.translate(QRectF(targetRect).center());
+                p.rotate(angle);
+                p.drawPixmap(QRectF(QPointF(-size.width() / 2, -size.height() / 2), size), *source, sourceRect);
+            }
+        }
+        angle = 0;
+        source = &level;
+        sourceRect = targetRect;
+    }
+}
+
+const QPixmap *TilesManager::pyramidLevel(int width, int height) const
+{
+    if (d->pyramid.isEmpty())
+        return nullptr;
+
+    // the smallest one that is still big enough
+    for (int i = d->pyramid.count() - 1; i > 0; --i) {
+        const QPixmap &level = d->pyramid.at(i);
+        if (level.width() >= width && level.height() >= height)
+            return &level;
+    }
+    return &d->pyramid.constFirst();
+}
+
+void TilesManager::Private::createPyramid()
+{
+    int shift = 1;
+    while ((qulonglong)(width >> shift) * (qulonglong)(height >> shift) * 4 / 3 > PYRAMID_MAXSIZE)
+        ++shift;
+
+    for (int i = 0; i < PYRAMID_LEVELS; ++i, ++shift) {
+        const int levelWidth = width >> shift;
+        const int levelHeight = height >> shift;
+        if (levelWidth < PYRAMID_MINSIDE || levelHeight < PYRAMID_MINSIDE)
+            break;
+
+        QPixmap level(levelWidth, levelHeight);
+        level.fill(Qt::transparent);
+        pyramid.append(level);
+        pyramidPixels += levelWidth * levelHeight;
+    }
 }
 
 void TilesManager::cleanupPixmapMemory(qulonglong numberOfBytes, const NormalizedRect &visibleRect, int visiblePageNumber)
@@ -439,20 +579,44 @@ void TilesManager::cleanupPixmapMemory(qulonglong numberOfBytes, const Normalize
         if (tile->rect.intersects(visibleRect))
             continue;
 
-        qulonglong pixels = tile->pixmap->width() * tile->pixmap->height();
-        d->totalPixels -= pixels;
-        if (numberOfBytes < 4 * pixels)
+        const qulonglong bytes = evictTile(tile);
+        if (numberOfBytes < bytes)
             numberOfBytes = 0;
         else
-            numberOfBytes -= 4 * pixels;
+            numberOfBytes -= bytes;
+    }
+}
 
-        delete tile->pixmap;
-        tile->pixmap = nullptr;
+void TilesManager::evictableTiles(QList<TileNode *> &tiles, const NormalizedRect &visibleRect, int visiblePageNumber)
+{
+    QList<TileNode *> rankedTiles;
+    for (TileNode &tile : d->tiles) {
+        d->rankTiles(tile, rankedTiles, visibleRect, visiblePageNumber);
+    }
 
-        d->markParentDirty(*tile);
+    for (TileNode *tile : qAsConst(rankedTiles)) {
+        // do not evict visible pixmaps
+        if (!tile->rect.intersects(visibleRect))
+            tiles.append(tile);
     }
 }
 
+qulonglong TilesManager::evictTile(TileNode *tile)
+{
+    if (!tile->pixmap)
+        return 0;
+
+    const qulonglong pixels = tile->pixmap->width() * tile->pixmap->height();
+    d->totalPixels -= pixels;
+
+    delete tile->pixmap;
+    tile->pixmap = nullptr;
+
+    d->markParentDirty(*tile);
+
+    return 4 * pixels;
+}
+
 void TilesManager::Private::markParentDirty(const TileNode &tile)
 {
     if (!tile.parent)
@@ -499,14 +663,33 @@ void TilesManager::Private::rankTiles(TileNode &tile, QList<TileNode *> &rankedT
 
 bool TilesManager::isRequesting(const NormalizedRect &rect, int pageWidth, int pageHeight) const
 {
-    return rect == d->requestRect && pageWidth == d->requestWidth && pageHeight == d->requestHeight;
+    return std::any_of(d->requests.cbegin(), d->requests.cend(), [&](const Private::Request &r) { return r.rect == rect && r.width == pageWidth && r.height == pageHeight; });
+}
+
+bool TilesManager::isRequesting(const NormalizedRect &tileRect) const
+{
+    // requests of a previous size won't paint anything
+    return std::any_of(d->requests.cbegin(), d->requests.cend(), [this, &tileRect](const Private::Request &r) { return r.width == d->width && r.height == d->height && (r.rect & tileRect) == tileRect; });
 }
 
 void TilesManager::setRequest(const NormalizedRect &rect, int pageWidth, int pageHeight)
 {
-    d->requestRect = rect;
-    d->requestWidth = pageWidth;
-    d->requestHeight = pageHeight;
+    if (rect.isNull()) {
+        d->requests.clear();
+        return;
+    }
+
+    // a new size makes all the previous requests late
+    if (!d->requests.isEmpty() && (d->requests.constFirst().width != pageWidth || d->requests.constFirst().height != pageHeight))
+        d->requests.clear();
+
+    if (!isRequesting(rect, pageWidth, pageHeight))
+        d->requests.append({rect, pageWidth, pageHeight});
+}
+
+void TilesManager::removeRequest(const NormalizedRect &rect)
+{
+    d->requests.erase(std::remove_if(d->requests.begin(), d->requests.end(), [&rect](const Private::Request &r) { return r.rect == rect; }), d->requests.end());
 }
 
 bool TilesManager::Private::splitBigTiles(TileNode &tile, const NormalizedRect &rect)
@@ -596,6 +779,7 @@ TileNode::TileNode()
     , rotation(Rotation0)
     , dirty(true)
     , distance(-1)
+    , lastUsed(0)
     , tiles(nullptr)
     , nTiles(0)
     , parent(nullptr)
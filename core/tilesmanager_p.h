@@ -9,6 +9,8 @@
 #include "area.h"
 #include "okularcore_export.h"
 
+#include <QList>
+
 class QPixmap;
 
 namespace Okular
@@ -72,6 +74,13 @@ public:
      */
     double distance;
 
+    /**
+     * When the pixmap of the tile was last set or painted, from a counter
+     * shared by all the tiles managers so tiles from different pages can be
+     * compared. Also used by the evicting algorithm.
+     */
+    quint64 lastUsed;
+
     /**
      * Children tiles
      * When a tile is split into multiple tiles, they're added as children.
@@ -117,6 +126,12 @@ public:
      */
     void setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, bool isPartialPixmap);
 
+    /**
+     * Like the above, for a @p pixmap that is rotated by @p pixmapRotation
+     * instead of rotation(), the tiles are rotated when they are painted.
+     */
+    void setPixmap(const QPixmap *pixmap, const NormalizedRect &rect, bool isPartialPixmap, Rotation pixmapRotation);
+
     /**
      * Checks whether all tiles intersecting with @p rect are available.
      * Returns false if at least one tile needs to be repainted (the tile
@@ -140,6 +155,26 @@ public:
      */
     qulonglong totalMemory() const;
 
+    /**
+     * Paints @p pixmap, which covers @p rect of the page, into the coarse
+     * levels of the tiles pyramid.
+     *
+     * The pyramid keeps a few low resolution copies of the page (1/2, 1/4...
+     * of its size, within a small memory budget) that are not invalidated
+     * by zooming, so the areas whose tiles are not rendered yet can be
+     * painted from them immediately. Pixmaps set with setPixmap() are added
+     * to it automatically, unless they are partial. @p pixmap is rotated by
+     * @p pixmapRotation.
+     */
+    void updatePyramid(const QPixmap &pixmap, const NormalizedRect &rect, Rotation pixmapRotation);
+
+    /**
+     * Returns the smallest level of the tiles pyramid that is at least
+     * @p width x @p height pixels, or the biggest one if none is, or nullptr
+     * if the pyramid is empty. Areas that were never painted are transparent.
+     */
+    const QPixmap *pyramidLevel(int width, int height) const;
+
     /**
      * Removes at least @p numberOfBytes bytes worth of tiles (least ranked
      * tiles are removed first).
@@ -149,17 +184,44 @@ public:
      */
     void cleanupPixmapMemory(qulonglong numberOfBytes, const NormalizedRect &visibleRect, int visiblePageNumber);
 
+    /**
+     * Appends to @p tiles the tiles that have a pixmap and are not visible,
+     * with their distance to the viewport updated like cleanupPixmapMemory()
+     * does, so the caller can rank them together with the tiles of other
+     * pages and free them with evictTile().
+     */
+    void evictableTiles(QList<TileNode *> &tiles, const NormalizedRect &visibleRect, int visiblePageNumber);
+
+    /**
+     * Deletes the pixmap of @p tile, one of the tiles of this tiles manager,
+     * and returns the number of bytes freed.
+     */
+    qulonglong evictTile(TileNode *tile);
+
     /**
      * Checks whether a given region has already been requested
      */
     bool isRequesting(const NormalizedRect &rect, int pageWidth, int pageHeight) const;
 
     /**
-     * Sets a region to be requested so the tiles manager knows which
-     * pixmaps to expect and discard those not useful anymore (late pixmaps)
+     * Checks whether the tile at @p tileRect is covered by one of the
+     * regions being requested
+     */
+    bool isRequesting(const NormalizedRect &tileRect) const;
+
+    /**
+     * Adds a region to be requested so the tiles manager knows which
+     * pixmaps to expect and discard those not useful anymore (late pixmaps).
+     * Several regions of the same size can be requested at the same time,
+     * a null @p rect forgets all of them.
      */
     void setRequest(const NormalizedRect &rect, int pageWidth, int pageHeight);
 
+    /**
+     * Forgets the requested region @p rect, e.g. because its request was cancelled
+     */
+    void removeRequest(const NormalizedRect &rect);
+
     /**
      * Inform the new size of the page and mark all tiles to repaint
      */
@@ -186,6 +248,12 @@ public:
      */
     void markDirty();
 
+    /**
+     * Mark only the tiles that intersect @p rect (in the unrotated page) as
+     * dirty
+     */
+    void markDirty(const NormalizedRect &rect);
+
     /**
      * Returns a rotated NormalizedRect given a @p rotation
      */
@@ -12,12 +12,21 @@
 #include "settings_core.h"
 
 #include <QApplication>
+#include <QAtomicInt>
 #include <QIODevice>
 #include <QImage>
+#include <QMutex>
+#include <QPixmap>
 #include <QRect>
+#include <QRunnable>
 #include <QScreen>
+#include <QSemaphore>
+#include <QSharedPointer>
+#include <QThread>
+#include <QThreadPool>
 #include <QWidget>
 #include <QWindow>
+#include <QtMath>
 
 using namespace Okular;
 
@@ -66,15 +75,91 @@ inline static bool isPaperColor(QRgb argb, QRgb paperColor)
     return (argb & 0xFFFFFF) == (paperColor & 0xFFFFFF); // ignore alpha
 }
 
+// images with less pixels are not worth sharing between threads
+static const qint64 kParallelPixelPassThreshold = 2 * 1024 * 1024;
+
+// renders of pages bigger than this get their bounding box computed on a smaller copy
+static const int kRenderedPageBoundingBoxPixels = 4 * 1024 * 1024;
+
+namespace
+{
+// the bands of a forEachRowBand(), the threads take them one after the other
+struct RowBands {
+    std::function<void(int, int)> pass;
+    int height;
+    int bandHeight;
+    int bandCount;
+    QAtomicInt nextBand;
+    QSemaphore bandsDone;
+
+    void run()
+    {
+        for (int band = nextBand.fetchAndAddOrdered(1); band < bandCount; band = nextBand.fetchAndAddOrdered(1)) {
+            const int begin = band * bandHeight;
+            pass(begin, qMin(height, begin + bandHeight));
+            bandsDone.release();
+        }
+    }
+};
+
+class RowBandsTask : public QRunnable
+{
+public:
+    explicit RowBandsTask(const QSharedPointer<RowBands> &bands)
+        : mBands(bands)
+    {
+    }
+
+    void run() override
+    {
+        mBands->run();
+    }
+
+private:
+    // a task that only starts once all the bands are done finds none left,
+    // but it still needs them to be there
+    QSharedPointer<RowBands> mBands;
+};
+}
+
+void Okular::forEachRowBand(int width, int height, const std::function<void(int, int)> &pass)
+{
+    const int threads = QThread::idealThreadCount();
+    if (qint64(width) * height < kParallelPixelPassThreshold || threads < 2 || height < 2) {
+        pass(0, height);
+        return;
+    }
+
+    // a few bands per thread, so that a slower one doesn't keep the others waiting
+    QSharedPointer<RowBands> bands(new RowBands);
+    bands->pass = pass;
+    bands->height = height;
+    bands->bandHeight = qMax(1, height / (threads * 4));
+    bands->bandCount = (height + bands->bandHeight - 1) / bands->bandHeight;
+
+    // the calling thread takes bands too, so this can't get stuck when the pool is busy
+    for (int i = 1; i < threads; ++i)
+        QThreadPool::globalInstance()->start(new RowBandsTask(bands));
+    bands->run();
+    bands->bandsDone.acquire(bands->bandCount);
+}
+
 NormalizedRect Utils::imageBoundingBox(const QImage *image)
 {
     if (!image)
         return NormalizedRect();
 
+    // read the lines directly, what QImage::pixel() would give for the other formats
+    QImage converted;
+    if (image->format() != QImage::Format_RGB32 && image->format() != QImage::Format_ARGB32) {
+        converted = image->convertToFormat(QImage::Format_ARGB32);
+        image = &converted;
+    }
+
     const int width = image->width();
     const int height = image->height();
     const QRgb paperColor = SettingsCore::paperColor().rgb();
-    int left, top, bottom, right, x, y;
+    int left, top, bottom, right, x;
 
 #ifdef BBOX_DEBUG
     QTime time;
@@ -82,19 +167,23 @@ NormalizedRect Utils::imageBoundingBox(const QImage *image)
 #endif
 
     // Scan pixels for top non-white
-    for (top = 0; top < height; ++top)
+    for (top = 0; top < height; ++top) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image->constScanLine(top));
         for (x = 0; x < width; ++x)
-            if (!isPaperColor(image->pixel(x, top), paperColor))
+            if (!isPaperColor(line[x], paperColor))
                 goto got_top;
+    }
     return NormalizedRect(0, 0, 0, 0); // the image is blank
 got_top:
     left = right = x;
 
     // Scan pixels for bottom non-white
-    for (bottom = height - 1; bottom >= top; --bottom)
+    for (bottom = height - 1; bottom >= top; --bottom) {
+        const QRgb *line = reinterpret_cast<const QRgb *>(image->constScanLine(bottom));
         for (x = width - 1; x >= 0; --x)
-            if (!isPaperColor(image->pixel(x, bottom), paperColor))
+            if (!isPaperColor(line[x], paperColor))
                 goto got_bottom;
+    }
     Q_ASSERT(0); // image changed?!
 got_bottom:
     if (x < left)
@@ -102,15 +191,26 @@ got_bottom:
     if (x > right)
         right = x;
 
-    // Scan for leftmost and rightmost (we already found some bounds on these):
-    for (y = top; y <= bottom && (left > 0 || right < width - 1); ++y) {
-        for (x = 0; x < left; ++x)
-            if (!isPaperColor(image->pixel(x, y), paperColor))
-                left = x;
-        for (x = width - 1; x > right + 1; --x)
-            if (!isPaperColor(image->pixel(x, y), paperColor))
-                right = x;
-    }
+    // Scan for leftmost and rightmost (we already found some bounds on these),
+    // each band of rows on its own and then all of them together:
+    QMutex boundsMutex;
+    const int topLeft = left, topRight = right;
+    forEachRowBand(width, bottom - top + 1, [&](int begin, int end) {
+        int bandLeft = topLeft, bandRight = topRight;
+        for (int y = top + begin; y < top + end && (bandLeft > 0 || bandRight < width - 1); ++y) {
+            const QRgb *line = reinterpret_cast<const QRgb *>(image->constScanLine(y));
+            for (int x = 0; x < bandLeft; ++x)
+                if (!isPaperColor(line[x], paperColor))
+                    bandLeft = x;
+            for (int x = width - 1; x > bandRight + 1; --x)
+                if (!isPaperColor(line[x], paperColor))
+                    bandRight = x;
+        }
+
+        QMutexLocker locker(&boundsMutex);
+        left = qMin(left, bandLeft);
+        right = qMax(right, bandRight);
+    });
 
     NormalizedRect bbox(QRect(left, top, (right - left + 1), (bottom - top + 1)), image->width(), image->height());
 
@@ -121,6 +221,68 @@ got_bottom:
     return bbox;
 }
 
+NormalizedRect Utils::imageBoundingBox(const QImage *image, int maxPixels)
+{
+    if (!image)
+        return NormalizedRect();
+
+    // the copy has every step-th pixel of every step-th line
+    const int step = qCeil(qSqrt(double(image->width()) * image->height() / qMax(maxPixels, 1)));
+    if (step <= 1)
+        return imageBoundingBox(image);
+
+    QImage converted;
+    if (image->format() != QImage::Format_RGB32 && image->format() != QImage::Format_ARGB32) {
+        converted = image->convertToFormat(QImage::Format_ARGB32);
+        image = &converted;
+    }
+
+    const int width = (image->width() + step - 1) / step;
+    const int height = (image->height() + step - 1) / step;
+    QImage sampled(width, height, QImage::Format_ARGB32);
+    uchar *sampledBits = sampled.bits();
+    const int sampledBytesPerLine = sampled.bytesPerLine();
+    forEachRowBand(width, height, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const QRgb *source = reinterpret_cast<const QRgb *>(image->constScanLine(y * step));
+            QRgb *line = reinterpret_cast<QRgb *>(sampledBits + y * sampledBytesPerLine);
+            for (int x = 0; x < width; ++x)
+                line[x] = source[x * step];
+        }
+    });
+
+    const NormalizedRect sampledBox = imageBoundingBox(&sampled);
+    if (sampledBox.isNull())
+        return sampledBox; // the image is blank
+
+    // back to the pixels of the image, up to the next sampled ones around
+    const int left = qMax(0, (qRound(sampledBox.left * width) - 1) * step);
+    const int top = qMax(0, (qRound(sampledBox.top * height) - 1) * step);
+    const int right = qMin(image->width() - 1, (qRound(sampledBox.right * width) + 1) * step - 1);
+    const int bottom = qMin(image->height() - 1, (qRound(sampledBox.bottom * height) + 1) * step - 1);
+    return NormalizedRect(QRect(left, top, right - left + 1, bottom - top + 1), image->width(), image->height());
+}
+
+NormalizedRect Okular::renderedPageBoundingBox(const QImage *image)
+{
+    return Utils::imageBoundingBox(image, kRenderedPageBoundingBoxPixels);
+}
+
+QImage::Format Okular::nativeImageFormat()
+{
+    return QImage::Format_ARGB32_Premultiplied;
+}
+
+QPixmap *Okular::pixmapFromRender(QImage *image)
+{
+    // RGB32 is the same layout with an opaque alpha, QPixmap takes it as it is
+    if (image->format() != nativeImageFormat() && image->format() != QImage::Format_RGB32)
+        *image = std::move(*image).convertToFormat(nativeImageFormat());
+
+    // the temporary picks the QPixmap::fromImage() that adopts the buffer, the other one copies it
+    return new QPixmap(QPixmap::fromImage(QImage(*image)));
+}
+
 void Okular::copyQIODevice(QIODevice *from, QIODevice *to)
 {
     QByteArray buffer(65536, '\0');
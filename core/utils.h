@@ -47,6 +47,18 @@ public:
      * @since 0.7 (KDE 4.1)
      */
     static NormalizedRect imageBoundingBox(const QImage *image);
+
+    /**
+     * Like imageBoundingBox(), but for an image of more than @p maxPixels
+     * pixels it is computed on a copy with one out of every few pixels in
+     * both directions, so that it has at most @p maxPixels. That is faster
+     * for big images, the rectangle is then enlarged to the pixels that were
+     * skipped around it, though content thinner than the skipped pixels
+     * may be missed.
+     *
+     * @since 21.12
+     */
+    static NormalizedRect imageBoundingBox(const QImage *image, int maxPixels);
 };
 
 }
@@ -7,12 +7,49 @@
 #ifndef _OKULAR_UTILS_P_H_
 #define _OKULAR_UTILS_P_H_
 
+#include <functional>
+
+#include <QImage>
+
+#include "okularcore_export.h"
+
 class QIODevice;
+class QPixmap;
 
 namespace Okular
 {
+class NormalizedRect;
+
 void copyQIODevice(QIODevice *from, QIODevice *to);
 
+/**
+ * The bounding box of @p image, a rendered page, see Utils::imageBoundingBox().
+ * Big renders are looked at in a smaller copy.
+ */
+NormalizedRect renderedPageBoundingBox(const QImage *image);
+
+/**
+ * Calls @p pass for bands of the rows of an image of @p width x @p height
+ * pixels, from row @c begin to before row @c end, that together cover all
+ * of them. For big images the bands are done in parallel, in the threads of
+ * the global thread pool and the calling one, so @p pass must not touch
+ * other rows than the ones it is given. Returns once all are done.
+ */
+OKULARCORE_EXPORT void forEachRowBand(int width, int height, const std::function<void(int begin, int end)> &pass);
+
+/**
+ * The format of the pixmaps of the pages, see PixmapRequest::imageFormat().
+ */
+OKULARCORE_EXPORT QImage::Format nativeImageFormat();
+
+/**
+ * The pixmap of @p image, a render of a page. Renders in nativeImageFormat()
+ * or QImage::Format_RGB32, like PixmapRequest::renderTarget(), are adopted
+ * as they are. Other ones are converted to nativeImageFormat(), in place if
+ * nothing else shares them, and @p image is left in that format too.
+ */
+OKULARCORE_EXPORT QPixmap *pixmapFromRender(QImage *image);
+
 /**
  * Return a rotation matrix corresponding to the @p rotation enumeration.
  */
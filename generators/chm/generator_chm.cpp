@@ -7,6 +7,7 @@
 
 #include "generator_chm.h"
 
+#include <QDataStream>
 #include <QDomElement>
 #include <QEventLoop>
 #include <QMutex>
@@ -22,12 +23,70 @@
 #include <khtml_part.h>
 
 #include <core/action.h>
+#include <core/diskcache_p.h>
 #include <core/page.h>
 #include <core/textpage.h>
 #include <core/utils.h>
 
 OKULAR_EXPORT_PLUGIN(CHMGenerator, "libokularGenerator_chmlib.json")
 
+// how much the rendered pages take at most, in KiB
+static const int renderedPagesBudget = 64 * 1024;
+// how long the application has to be idle before the next topics are rendered
+static const int preloadDelay = 100; // in msec
+
+// Bumped when the format of the contents cache changes
+static const int contentsCacheVersion = 1;
+
+// the cached contents of the books, keyed by the file and its modification time
+static const Okular::DiskCache &contentsCache()
+{
+    static const Okular::DiskCache cache(QStringLiteral("chm"));
+    return cache;
+}
+
+static bool readContentsCache(const QByteArray &key, QList<EBookTocEntry> &topics, QList<QUrl> &pageList)
+{
+    const QByteArray data = contentsCache().read(key);
+    if (data.isEmpty())
+        return false;
+
+    QDataStream stream(data);
+    qint32 version;
+    quint32 count;
+    stream >> version >> count;
+    if (stream.status() != QDataStream::Ok || version != contentsCacheVersion)
+        return false;
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        EBookTocEntry e;
+        qint32 iconid;
+        qint32 indent;
+        stream >> e.name >> e.url >> iconid >> indent;
+        e.iconid = static_cast<EBookTocEntry::Icon>(iconid);
+        e.indent = indent;
+        topics.append(e);
+    }
+    stream >> pageList;
+    if (stream.status() != QDataStream::Ok) {
+        topics.clear();
+        pageList.clear();
+        return false;
+    }
+    return true;
+}
+
+static void writeContentsCache(const QByteArray &key, const QList<EBookTocEntry> &topics, const QList<QUrl> &pageList)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << qint32(contentsCacheVersion) << quint32(topics.count());
+    for (const EBookTocEntry &e : topics)
+        stream << e.name << e.url << qint32(e.iconid) << qint32(e.indent);
+    stream << pageList;
+    contentsCache().write(key, data);
+}
+
 static QString absolutePath(const QString &baseUrl, const QString &path)
 {
     QString absPath;
@@ -50,6 +109,12 @@ CHMGenerator::CHMGenerator(QObject *parent, const QVariantList &args)
     m_syncGen = nullptr;
     m_file = nullptr;
     m_request = nullptr;
+
+    m_renderedPages.setMaxCost(renderedPagesBudget);
+    m_preload.page = -1;
+    m_preloadTimer.setSingleShot(true);
+    m_preloadTimer.setInterval(preloadDelay);
+    connect(&m_preloadTimer, &QTimer::timeout, this, &CHMGenerator::preloadNext);
 }
 
 CHMGenerator::~CHMGenerator()
@@ -57,6 +122,12 @@ CHMGenerator::~CHMGenerator()
     delete m_syncGen;
 }
 
+CHMGenerator::RenderedPage::~RenderedPage()
+{
+    qDeleteAll(objectRects);
+    delete textPage;
+}
+
 bool CHMGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *> &pagesVector)
 {
     m_file = EBook::loadFile(fileName);
@@ -64,8 +135,20 @@ bool CHMGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *>
         return false;
     }
     m_fileName = fileName;
+
+    // parsing the sitemap and walking the archive take long for big books,
+    // do it only the first time they are opened
     QList<EBookTocEntry> topics;
-    m_file->getTableOfContents(topics);
+    QList<QUrl> pageList;
+    const QByteArray cacheKey = Okular::DiskCache::fileKey(fileName);
+    if (!readContentsCache(cacheKey, topics, pageList)) {
+        m_file->getTableOfContents(topics);
+        m_file->enumerateFiles(pageList);
+        const QUrl home = m_file->homeUrl();
+        if (home.path() != QLatin1String("/"))
+            pageList.prepend(home);
+        writeContentsCache(cacheKey, topics, pageList);
+    }
 
     // fill m_docSyn
     QMap<int, QDomElement> lastIndentElement;
@@ -91,11 +174,6 @@ bool CHMGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *>
     }
 
     // fill m_urlPage and m_pageUrl
-    QList<QUrl> pageList;
-    m_file->enumerateFiles(pageList);
-    const QUrl home = m_file->homeUrl();
-    if (home.path() != QLatin1String("/"))
-        pageList.prepend(home);
     m_pageUrl.resize(pageNum);
 
     for (const QUrl &qurl : qAsConst(pageList)) {
@@ -146,6 +224,10 @@ bool CHMGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *>
 
 bool CHMGenerator::doCloseDocument()
 {
+    cancelPreload();
+    m_preloads.clear();
+    m_renderedPages.clear();
+
     // delete the document information of the old document
     delete m_file;
     m_file = nullptr;
@@ -177,22 +259,66 @@ void CHMGenerator::preparePageForSyncOperation(const QString &url)
     loop.exec(QEventLoop::ExcludeUserInputEvents);
 }
 
-void CHMGenerator::slotCompleted()
+QImage CHMGenerator::paintPage(int width, int height) const
 {
-    if (!m_request)
-        return;
-
-    QImage image(m_request->width(), m_request->height(), QImage::Format_ARGB32);
+    QImage image(width, height, Okular::PixmapRequest::imageFormat());
     image.fill(Qt::white);
 
     QPainter p(&image);
-    QRect r(0, 0, m_request->width(), m_request->height());
+    QRect r(0, 0, width, height);
 
     bool moreToPaint;
     m_syncGen->paint(&p, r, 0, &moreToPaint);
 
     p.end();
 
+    return image;
+}
+
+bool CHMGenerator::renderedPageKey(int page, int width, int height, quint64 *key)
+{
+    if (width > 0xffff || height > 0xffff)
+        return false;
+
+    *key = (quint64(quint32(page)) << 32) | (quint32(width) << 16) | quint32(height);
+    return true;
+}
+
+void CHMGenerator::slotCompleted()
+{
+    if (m_preload.page != -1) {
+        const Preload preload = m_preload;
+        m_preload.page = -1;
+
+        RenderedPage *rendered = new RenderedPage;
+        rendered->image = paintPage(preload.width, preload.height);
+        // what additionalRequestData() would give the page
+        if (!m_rectsGenerated.at(preload.page)) {
+            rendered->textPage = new Okular::TextPage();
+            collectPageData(&rendered->objectRects, rendered->textPage);
+            rendered->hasPageData = true;
+        }
+
+        m_syncGen->closeUrl();
+        m_chmUrl = QString();
+
+        quint64 key;
+        if (renderedPageKey(preload.page, preload.width, preload.height, &key))
+            m_renderedPages.insert(key, rendered, qMax(1, int(rendered->image.sizeInBytes() / 1024)));
+        else
+            delete rendered;
+
+        // canGeneratePixmap() was false while preloading
+        emit pixmapGenerationReady();
+        m_preloadTimer.start();
+        return;
+    }
+
+    if (!m_request)
+        return;
+
+    QImage image = paintPage(m_request->width(), m_request->height());
+
     if (!m_textpageAddedList.at(m_request->pageNumber())) {
         additionalRequestData();
         m_textpageAddedList[m_request->pageNumber()] = true;
@@ -201,17 +327,79 @@ void CHMGenerator::slotCompleted()
     m_syncGen->closeUrl();
     m_chmUrl = QString();
 
-    userMutex()->unlock();
+    unlockUserMutex();
 
     Okular::PixmapRequest *req = m_request;
     m_request = nullptr;
 
+    quint64 key;
+    if (renderedPageKey(req->pageNumber(), req->width(), req->height(), &key)) {
+        RenderedPage *rendered = new RenderedPage;
+        rendered->image = image;
+        m_renderedPages.insert(key, rendered, qMax(1, int(image.sizeInBytes() / 1024)));
+    }
+    if (!req->preload())
+        queuePreloads(req->pageNumber(), req->width(), req->height());
+
     if (!req->page()->isBoundingBoxKnown())
         updatePageBoundingBox(req->page()->number(), Okular::Utils::imageBoundingBox(&image));
     req->page()->setPixmap(req->observer(), new QPixmap(QPixmap::fromImage(image)));
     signalPixmapRequestDone(req);
 }
 
+void CHMGenerator::queuePreloads(int page, int width, int height)
+{
+    // the next topic first, that is where reading goes
+    m_preloads.clear();
+    for (const int neighbour : {page + 1, page - 1}) {
+        if (neighbour >= 0 && neighbour < m_pageUrl.count())
+            m_preloads.append({neighbour, width, height});
+    }
+    m_preloadTimer.start();
+}
+
+void CHMGenerator::preloadNext()
+{
+    if (!m_file || m_request || m_preload.page != -1)
+        return;
+
+    // somebody else is using the html view
+    if (!tryLockUserMutex(ProbeSite)) {
+        m_preloadTimer.start();
+        return;
+    }
+    unlockUserMutex();
+
+    while (!m_preloads.isEmpty()) {
+        const Preload preload = m_preloads.takeFirst();
+        quint64 key;
+        if (!renderedPageKey(preload.page, preload.width, preload.height, &key) || m_renderedPages.contains(key))
+            continue;
+
+        const QString url = m_pageUrl.at(preload.page);
+        QString pAddress = QStringLiteral("ms-its:") + m_fileName + QStringLiteral("::") + m_file->urlToPath(QUrl(url));
+        m_chmUrl = url;
+        m_preload = preload;
+        m_syncGen->view()->resizeContents(preload.width, preload.height);
+        // finishes in slotCompleted()
+        m_syncGen->openUrl(QUrl(pAddress));
+        return;
+    }
+}
+
+void CHMGenerator::cancelPreload()
+{
+    m_preloadTimer.stop();
+    if (m_preload.page == -1)
+        return;
+
+    // to be tried again later
+    m_preloads.prepend(m_preload);
+    m_preload.page = -1;
+    m_syncGen->closeUrl();
+    m_chmUrl = QString();
+}
+
 Okular::DocumentInfo CHMGenerator::generateDocumentInfo(const QSet<Okular::DocumentInfo::Key> &keys) const
 {
     Okular::DocumentInfo docInfo;
@@ -229,9 +417,13 @@ const Okular::DocumentSynopsis *CHMGenerator::generateDocumentSynopsis()
 
 bool CHMGenerator::canGeneratePixmap() const
 {
+    // the html view is busy with a page rendered ahead
+    if (m_preload.page != -1)
+        return false;
+
     bool isLocked = true;
-    if (userMutex()->tryLock()) {
-        userMutex()->unlock();
+    if (tryLockUserMutex(ProbeSite)) {
+        unlockUserMutex();
         isLocked = false;
     }
 
@@ -243,7 +435,34 @@ void CHMGenerator::generatePixmap(Okular::PixmapRequest *request)
     int requestWidth = request->width();
     int requestHeight = request->height();
 
-    userMutex()->lock();
+    // navigating to a page rendered before or ahead doesn't need the html view
+    const int pageNumber = request->pageNumber();
+    quint64 key;
+    RenderedPage *rendered = renderedPageKey(pageNumber, requestWidth, requestHeight, &key) ? m_renderedPages.object(key) : nullptr;
+    if (rendered && (m_rectsGenerated.at(pageNumber) || rendered->hasPageData)) {
+        Okular::Page *page = request->page();
+        if (!m_rectsGenerated.at(pageNumber)) {
+            page->setObjectRects(rendered->objectRects);
+            rendered->objectRects.clear();
+            if (!page->hasTextPage())
+                page->setTextPage(rendered->textPage);
+            else
+                delete rendered->textPage;
+            rendered->textPage = nullptr;
+            m_rectsGenerated[pageNumber] = true;
+            m_textpageAddedList[pageNumber] = true;
+        }
+
+        if (!request->preload())
+            queuePreloads(pageNumber, requestWidth, requestHeight);
+        if (!page->isBoundingBoxKnown())
+            updatePageBoundingBox(pageNumber, Okular::Utils::imageBoundingBox(&rendered->image));
+        page->setPixmap(request->observer(), new QPixmap(QPixmap::fromImage(rendered->image)));
+        signalPixmapRequestDone(request);
+        return;
+    }
+
+    lockUserMutex(RenderSite);
     QString url = m_pageUrl[request->pageNumber()];
 
     QString pAddress = QStringLiteral("ms-its:") + m_fileName + QStringLiteral("::") + m_file->urlToPath(QUrl(url));
@@ -254,6 +473,19 @@ void CHMGenerator::generatePixmap(Okular::PixmapRequest *request)
     m_syncGen->openUrl(QUrl(pAddress));
 }
 
+qulonglong CHMGenerator::cachedMemory() const
+{
+    return qulonglong(m_renderedPages.totalCost()) * 1024;
+}
+
+qulonglong CHMGenerator::freeCachedMemory(qulonglong bytes)
+{
+    const qulonglong before = cachedMemory();
+    m_renderedPages.setMaxCost(int((bytes < before ? before - bytes : 0) / 1024));
+    m_renderedPages.setMaxCost(renderedPagesBudget);
+    return before - cachedMemory();
+}
+
 void CHMGenerator::recursiveExploreNodes(DOM::Node node, Okular::TextPage *tp)
 {
     if (node.nodeType() == DOM::Node::TEXT_NODE && !node.getRect().isNull()) {
@@ -308,63 +540,69 @@ void CHMGenerator::recursiveExploreNodes(DOM::Node node, Okular::TextPage *tp)
         const bool genObjectRects = !m_rectsGenerated.at(m_request->page()->number());
         const bool genTextPage = !m_request->page()->hasTextPage() && genObjectRects;
 
-        if (genObjectRects || genTextPage) {
-            DOM::HTMLDocument domDoc = m_syncGen->htmlDocument();
-            // only generate object info when generating a full page not a thumbnail
-            if (genObjectRects) {
-                QLinkedList<Okular::ObjectRect *> objRects;
-                int xScale = m_syncGen->view()->width();
-                int yScale = m_syncGen->view()->height();
-                // getting links
-                DOM::HTMLCollection coll = domDoc.links();
-                DOM::Node n;
-                QRect r;
-                if (!coll.isNull()) {
-                    int size = coll.length();
-                    for (int i = 0; i < size; i++) {
-                        n = coll.item(i);
-                        if (!n.isNull()) {
-                            QString url = n.attributes().getNamedItem("href").nodeValue().string();
-                            r = n.getRect();
-                            // there is no way for us to support javascript properly
-                            if (url.startsWith(QLatin1String("JavaScript:")), Qt::CaseInsensitive)
-                                continue;
-                            else if (url.contains(QStringLiteral(":"))) {
-                                objRects.push_back(new Okular::ObjectRect(Okular::NormalizedRect(r, xScale, yScale), false, Okular::ObjectRect::Action, new Okular::BrowseAction(QUrl(url))));
-                            } else {
-                                Okular::DocumentViewport viewport(metaData(QStringLiteral("NamedViewport"), absolutePath(m_chmUrl, url)).toString());
-                                objRects.push_back(new Okular::ObjectRect(Okular::NormalizedRect(r, xScale, yScale), false, Okular::ObjectRect::Action, new Okular::GotoAction(QString(), viewport)));
-                            }
-                        }
-                    }
-                }
+        // only generate object info when generating a full page not a thumbnail
+        if (genObjectRects) {
+            QLinkedList<Okular::ObjectRect *> objRects;
+            Okular::TextPage *tp = genTextPage ? new Okular::TextPage() : nullptr;
+            collectPageData(&objRects, tp);
+            m_request->page()->setObjectRects(objRects);
+            m_rectsGenerated[m_request->page()->number()] = true;
 
-                // getting images
-                coll = domDoc.images();
-                if (!coll.isNull()) {
-                    int size = coll.length();
-                    for (int i = 0; i < size; i++) {
-                        n = coll.item(i);
-                        if (!n.isNull()) {
-                            objRects.push_back(new Okular::ObjectRect(Okular::NormalizedRect(n.getRect(), xScale, yScale), false, Okular::ObjectRect::Image, nullptr));
-                        }
+            if (tp)
+                page->setTextPage(tp);
+        }
+    }
+
+    void CHMGenerator::collectPageData(QLinkedList<Okular::ObjectRect *> * objRects, Okular::TextPage * textPage)
+    {
+        DOM::HTMLDocument domDoc = m_syncGen->htmlDocument();
+        int xScale = m_syncGen->view()->width();
+        int yScale = m_syncGen->view()->height();
+        // getting links
+        DOM::HTMLCollection coll = domDoc.links();
+        DOM::Node n;
+        QRect r;
+        if (!coll.isNull()) {
+            int size = coll.length();
+            for (int i = 0; i < size; i++) {
+                n = coll.item(i);
+                if (!n.isNull()) {
+                    QString url = n.attributes().getNamedItem("href").nodeValue().string();
+                    r = n.getRect();
+                    // there is no way for us to support javascript properly
+                    if (url.startsWith(QLatin1String("JavaScript:")), Qt::CaseInsensitive)
+                        continue;
+                    else if (url.contains(QStringLiteral(":"))) {
+                        objRects->push_back(new Okular::ObjectRect(Okular::NormalizedRect(r, xScale, yScale), false, Okular::ObjectRect::Action, new Okular::BrowseAction(QUrl(url))));
+                    } else {
+                        Okular::DocumentViewport viewport(metaData(QStringLiteral("NamedViewport"), absolutePath(m_chmUrl, url)).toString());
+                        objRects->push_back(new Okular::ObjectRect(Okular::NormalizedRect(r, xScale, yScale), false, Okular::ObjectRect::Action, new Okular::GotoAction(QString(), viewport)));
                     }
                 }
-                m_request->page()->setObjectRects(objRects);
-                m_rectsGenerated[m_request->page()->number()] = true;
             }
+        }
 
-            if (genTextPage) {
-                Okular::TextPage *tp = new Okular::TextPage();
-                recursiveExploreNodes(domDoc, tp);
-                page->setTextPage(tp);
+        // getting images
+        coll = domDoc.images();
+        if (!coll.isNull()) {
+            int size = coll.length();
+            for (int i = 0; i < size; i++) {
+                n = coll.item(i);
+                if (!n.isNull()) {
+                    objRects->push_back(new Okular::ObjectRect(Okular::NormalizedRect(n.getRect(), xScale, yScale), false, Okular::ObjectRect::Image, nullptr));
+                }
             }
         }
+
+        if (textPage)
+            recursiveExploreNodes(domDoc, textPage);
     }
 
     Okular::TextPage *CHMGenerator::textPage(Okular::TextRequest * request)
     {
-        userMutex()->lock();
+        // the html view is needed for this page now
+        cancelPreload();
+        lockUserMutex(TextSite);
 
         const Okular::Page *page = request->page();
         m_syncGen->view()->resize(page->width(), page->height());
@@ -372,7 +610,11 @@ void CHMGenerator::recursiveExploreNodes(DOM::Node node, Okular::TextPage *tp)
         preparePageForSyncOperation(m_pageUrl[page->number()]);
         Okular::TextPage *tp = new Okular::TextPage();
         recursiveExploreNodes(m_syncGen->htmlDocument(), tp);
-        userMutex()->unlock();
+        unlockUserMutex();
+        // canGeneratePixmap() was false while we held the mutex
+        emit pixmapGenerationReady();
+        if (!m_preloads.isEmpty())
+            m_preloadTimer.start();
         return tp;
     }
 
@@ -14,11 +14,16 @@
 #include "lib/ebook_chm.h"
 
 #include <QBitArray>
+#include <QCache>
+#include <QImage>
+#include <QLinkedList>
+#include <QTimer>
 
 class KHTMLPart;
 
 namespace Okular
 {
+class ObjectRect;
 class TextPage;
 }
 
@@ -41,6 +46,8 @@ public:
 
     bool canGeneratePixmap() const override;
     void generatePixmap(Okular::PixmapRequest *request) override;
+    qulonglong cachedMemory() const override;
+    qulonglong freeCachedMemory(qulonglong bytes) override;
 
     QVariant metaData(const QString &key, const QVariant &option) const override;
 
@@ -52,6 +59,22 @@ protected:
     Okular::TextPage *textPage(Okular::TextRequest *request) override;
 
 private:
+    // a page rendered at a size, with the links and text the page gets the
+    // first time it is shown if it was rendered ahead
+    struct RenderedPage {
+        ~RenderedPage();
+        QImage image;
+        QLinkedList<Okular::ObjectRect *> objectRects;
+        Okular::TextPage *textPage = nullptr;
+        bool hasPageData = false;
+    };
+
+    static bool renderedPageKey(int page, int width, int height, quint64 *key);
+    QImage paintPage(int width, int height) const;
+    void collectPageData(QLinkedList<Okular::ObjectRect *> *objectRects, Okular::TextPage *textPage);
+    void queuePreloads(int page, int width, int height);
+    void preloadNext();
+    void cancelPreload();
     void additionalRequestData();
     void recursiveExploreNodes(DOM::Node node, Okular::TextPage *tp);
     void preparePageForSyncOperation(const QString &url);
@@ -65,6 +88,18 @@ private:
     Okular::PixmapRequest *m_request;
     QBitArray m_textpageAddedList;
     QBitArray m_rectsGenerated;
+
+    // the pages rendered so far, and the neighbours of the last one shown
+    // rendered ahead while the application is idle
+    QCache<quint64, RenderedPage> m_renderedPages;
+    struct Preload {
+        int page;
+        int width;
+        int height;
+    };
+    QVector<Preload> m_preloads;
+    QTimer m_preloadTimer;
+    Preload m_preload;
 };
 
 #endif
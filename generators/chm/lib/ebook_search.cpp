@@ -79,6 +79,14 @@ bool EBookSearch::loadIndex(QDataStream &stream)
     return m_Index->readDict(stream);
 }
 
+bool EBookSearch::loadIndex(const QString &fileName)
+{
+    delete m_Index;
+
+    m_Index = new QtAs::Index();
+    return m_Index->mapDict(fileName);
+}
+
 bool EBookSearch::generateIndex(EBook *ebookFile, QDataStream &stream)
 {
     QList<QUrl> documents;
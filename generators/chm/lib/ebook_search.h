@@ -25,6 +25,11 @@ public:
     //! The index should be previously saved with generateIndex().
     bool loadIndex(QDataStream &stream);
 
+    //! Loads the search index from the file \param fileName, which stays mapped
+    //! in memory while the index is used, so searching can start right away.
+    //! The index should be previously saved with generateIndex().
+    bool loadIndex(const QString &fileName);
+
     //! Generates the search index from the opened CHM file \param chmFile,
     //! and saves it to the data stream \param stream which should be writeable.
     //!
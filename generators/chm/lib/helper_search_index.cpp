@@ -7,12 +7,23 @@
 
 #include <QApplication>
 #include <QTextCodec>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include <core/functiontask_p.h>
 
 #include "ebook.h"
 #include "ebook_search.h"
 #include "helper_search_index.h"
 
-static const int DICT_VERSION = 4;
+static const int DICT_VERSION = 5;
+static const quint32 DICT_MAGIC = 0x4f4b4349; // "OKCI"
+// how many documents each thread tokenizes at a time while indexing
+static const int DOCUMENTS_PER_THREAD = 16;
 
 namespace QtAs
 {
@@ -44,22 +55,75 @@ struct Term {
     }
 };
 
-QDataStream &operator>>(QDataStream &s, Document &l)
+// The dictionary, in the byte order of the machine that wrote it so one
+// from another one is dropped, is:
+//  - a header of magic, version, number of documents and number of terms,
+//    as quint32;
+//  - the table of the terms sorted by their UTF-8 bytes, for each one the
+//    quint32 offset and length of its bytes and the offset of its postings;
+//  - the split and word characters and the URLs of the documents, each one
+//    as a varint length and UTF-8 bytes;
+//  - the bytes of the terms;
+//  - the postings of each term: a varint count, then for each document the
+//    varint difference from the previous document number and the varint
+//    frequency.
+// It is read as it is, from memory or mapped from the file, looking terms
+// up with a binary search.
+struct DictHeader {
+    quint32 magic;
+    quint32 version;
+    quint32 documentCount;
+    quint32 termCount;
+};
+
+struct DictTerm {
+    quint32 offset;
+    quint32 length;
+    quint32 postings;
+};
+
+static void appendVarint(QByteArray &data, quint32 value)
 {
-    s >> l.docNumber;
-    s >> l.frequency;
-    return s;
+    while (value >= 0x80) {
+        data.append(char((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    data.append(char(value));
 }
 
-QDataStream &operator<<(QDataStream &s, const Document l)
+static bool readVarint(const uchar *&p, const uchar *end, quint32 *value)
 {
-    s << (short)l.docNumber;
-    s << (short)l.frequency;
-    return s;
+    *value = 0;
+    for (int shift = 0; p < end && shift < 35; shift += 7) {
+        const uchar byte = *p++;
+        *value |= quint32(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static void appendString(QByteArray &data, const QByteArray &string)
+{
+    appendVarint(data, string.size());
+    data.append(string);
+}
+
+static bool readString(const uchar *&p, const uchar *end, QByteArray *string)
+{
+    quint32 length;
+    if (!readVarint(p, end, &length) || length > quint32(end - p))
+        return false;
+    *string = QByteArray(reinterpret_cast<const char *>(p), length);
+    p += length;
+    return true;
 }
 
 Index::Index()
     : QObject(nullptr)
+    , m_termCount(0)
+    , m_charssplit(QString::fromLatin1(SPLIT_CHARACTERS))
+    , m_charsword(QString::fromLatin1(WORD_CHARACTERS))
 {
     lastWindowClosed = false;
     connect(qApp, &QGuiApplication::lastWindowClosed, this, &Index::setLastWinClosed);
@@ -80,64 +144,82 @@ bool Index::makeIndex(const QList<QUrl> &docs, EBook *chmFile)
     if (chmFile->hasFeature(EBook::FEATURE_ENCODING))
         entityDecoder.changeEncoding(QTextCodec::codecForName(chmFile->currentEncoding().toUtf8()));
 
-    QList<QUrl>::ConstIterator it = docList.constBegin();
-    int steps = docList.count() / 100;
-
-    if (!steps)
-        steps++;
+    // the book is read here, in batches tokenized by all the threads; merging
+    // them in the order of the documents keeps the postings sorted
+    QHash<QString, QVector<Document>> terms;
+    QThreadPool pool;
+    const int batchSize = qMax(1, QThread::idealThreadCount()) * DOCUMENTS_PER_THREAD;
 
-    int prog = 0;
-
-    for (int i = 0; it != docList.constEnd(); ++it, ++i) {
+    for (int first = 0; first < docList.count(); first += batchSize) {
         if (lastWindowClosed)
             return false;
 
-        QUrl filename = *it;
-        QStringList terms;
+        const int count = qMin(batchSize, docList.count() - first);
+        QVector<QString> texts(count);
+        for (int i = 0; i < count; ++i) {
+            const QUrl &filename = docList.at(first + i);
+            if (!chmFile->getFileContentAsString(texts[i], filename) || texts.at(i).isEmpty())
+                qWarning("Search index generator: could not retrieve the document content for %s", qPrintable(filename.toString()));
+        }
 
-        if (parseDocumentToStringlist(chmFile, filename, terms)) {
-            for (QStringList::ConstIterator tit = terms.constBegin(); tit != terms.constEnd(); ++tit)
-                insertInDict(*tit, i);
+        // each task only touches its own elements
+        QVector<QHash<QString, int>> frequencies(count);
+        QString *text = texts.data();
+        QHash<QString, int> *frequency = frequencies.data();
+        for (int i = 0; i < count; ++i) {
+            if (text[i].isEmpty())
+                continue;
+            pool.start(new Okular::FunctionTask([this, text, frequency, i] {
+                frequency[i] = termFrequencies(text[i]);
+                text[i] = QString();
+            }));
         }
+        pool.waitForDone();
 
-        if (i % steps == 0) {
-            prog++;
-            prog = qMin(prog, 99);
-            emit indexingProgress(prog, tr("Processing document %1").arg((*it).path()));
+        for (int i = 0; i < count; ++i) {
+            for (QHash<QString, int>::const_iterator it = frequencies.at(i).constBegin(); it != frequencies.at(i).constEnd(); ++it)
+                terms[it.key()].append(Document(first + i, it.value()));
         }
+
+        emit indexingProgress(qMin(99, (first + count) * 100 / docList.count()), tr("Processing document %1").arg(docList.at(first + count - 1).path()));
+        qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
     }
 
+    // searched the same way as one read back
+    if (!setDict(serializeDict(terms, m_charssplit, m_charsword, docList)))
+        return false;
+
     emit indexingProgress(100, tr("Processing completed"));
     return true;
 }
 
-void Index::insertInDict(const QString &str, int docNum)
+QHash<QString, int> Index::termFrequencies(const QString &text) const
 {
-    Entry *e = nullptr;
-    if (!dict.isEmpty())
-        e = dict[str];
-
-    if (e) {
-        if (e->documents.last().docNumber != docNum)
-            e->documents.append(Document(docNum, 1));
-        else
-            e->documents.last().frequency++;
-    } else {
-        dict.insert(str, new Entry(docNum));
-    }
+    QStringList tokens;
+    tokenize(text, tokens);
+
+    QHash<QString, int> result;
+    for (const QString &token : qAsConst(tokens))
+        ++result[token];
+    return result;
 }
 
 bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl &filename, QStringList &tokenlist)
 {
-    QString parsedbuf, parseentity, text;
+    QString text;
 
     if (!chmFile->getFileContentAsString(text, filename) || text.isEmpty()) {
         qWarning("Search index generator: could not retrieve the document content for %s", qPrintable(filename.toString()));
         return false;
     }
 
-    m_charssplit = SPLIT_CHARACTERS;
-    m_charsword = WORD_CHARACTERS;
+    tokenize(text, tokenlist);
+    return true;
+}
+
+void Index::tokenize(const QString &text, QStringList &tokenlist) const
+{
+    QString parsedbuf, parseentity;
 
     tokenlist.clear();
 
@@ -155,9 +237,6 @@ bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl &filename, QStr
     for (int j = 0; j < text.length(); j++) {
         QChar ch = text[j];
 
-        if ((j % 20000) == 0)
-            qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-
         if (state == STATE_IN_HTML_TAG) {
             // We are inside HTML tag.
             // Ignore everything until we see '>' (end of HTML tag) or quote char (quote start)
@@ -264,73 +343,174 @@ bool Index::parseDocumentToStringlist(EBook *chmFile, const QUrl &filename, QStr
     // Add the last word if still here - for broken htmls.
     if (!parsedbuf.isEmpty())
         tokenlist.push_back(parsedbuf.toLower());
-
-    return true;
 }
 
-void Index::writeDict(QDataStream &stream)
+QByteArray Index::serializeDict(const QHash<QString, QVector<Document>> &terms, const QString &charsSplit, const QString &charsWord, const QList<QUrl> &documents)
 {
-    stream << DICT_VERSION;
-    stream << m_charssplit;
-    stream << m_charsword;
-
-    // Document list
-    stream << docList;
-
-    // Dictionary
-    for (QHash<QString, Entry *>::ConstIterator it = dict.constBegin(); it != dict.constEnd(); ++it) {
-        stream << it.key();
-        stream << (int)it.value()->documents.count();
-        stream << it.value()->documents;
+    QVector<QPair<QByteArray, const QVector<Document> *>> sortedTerms;
+    sortedTerms.reserve(terms.count());
+    for (QHash<QString, QVector<Document>>::const_iterator it = terms.constBegin(); it != terms.constEnd(); ++it)
+        sortedTerms.append(qMakePair(it.key().toUtf8(), &it.value()));
+    std::sort(sortedTerms.begin(), sortedTerms.end(), [](const QPair<QByteArray, const QVector<Document> *> &a, const QPair<QByteArray, const QVector<Document> *> &b) { return a.first < b.first; });
+
+    QByteArray strings;
+    appendString(strings, charsSplit.toUtf8());
+    appendString(strings, charsWord.toUtf8());
+    for (const QUrl &url : documents)
+        appendString(strings, url.toEncoded());
+
+    QByteArray termBytes;
+    QByteArray postings;
+    QVector<DictTerm> table;
+    table.reserve(sortedTerms.count());
+    for (const QPair<QByteArray, const QVector<Document> *> &term : qAsConst(sortedTerms)) {
+        table.append({quint32(termBytes.size()), quint32(term.first.size()), quint32(postings.size())});
+        termBytes.append(term.first);
+
+        appendVarint(postings, term.second->count());
+        int previous = 0;
+        for (const Document &doc : *term.second) {
+            appendVarint(postings, doc.docNumber - previous);
+            appendVarint(postings, doc.frequency);
+            previous = doc.docNumber;
+        }
     }
+
+    // the offsets in the table are from the start of the dictionary
+    const quint32 termsOffset = sizeof(DictHeader) + table.count() * sizeof(DictTerm) + strings.size();
+    const quint32 postingsOffset = termsOffset + termBytes.size();
+    for (DictTerm &term : table) {
+        term.offset += termsOffset;
+        term.postings += postingsOffset;
+    }
+
+    const DictHeader header = {DICT_MAGIC, DICT_VERSION, quint32(documents.count()), quint32(table.count())};
+    QByteArray data;
+    data.reserve(postingsOffset + postings.size());
+    data.append(reinterpret_cast<const char *>(&header), sizeof(header));
+    data.append(reinterpret_cast<const char *>(table.constData()), table.count() * sizeof(DictTerm));
+    data.append(strings);
+    data.append(termBytes);
+    data.append(postings);
+    return data;
 }
 
-bool Index::readDict(QDataStream &stream)
+bool Index::setDict(const QByteArray &data)
 {
-    dict.clear();
+    m_dict = QByteArray();
+    m_termCount = 0;
     docList.clear();
 
-    QString key;
-    int version, numOfDocs;
-
-    stream >> version;
+    DictHeader header;
+    if (data.size() < int(sizeof(header)))
+        return false;
+    memcpy(&header, data.constData(), sizeof(header));
+    const qint64 tableEnd = sizeof(header) + qint64(header.termCount) * sizeof(DictTerm);
+    if (header.magic != DICT_MAGIC || header.version != quint32(DICT_VERSION) || tableEnd > data.size())
+        return false;
 
-    if (version < 2)
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData()) + tableEnd;
+    const uchar *end = reinterpret_cast<const uchar *>(data.constData()) + data.size();
+    QByteArray string;
+    if (!readString(p, end, &string))
         return false;
+    m_charssplit = QString::fromUtf8(string);
+    if (!readString(p, end, &string))
+        return false;
+    m_charsword = QString::fromUtf8(string);
+    for (quint32 i = 0; i < header.documentCount; ++i) {
+        if (!readString(p, end, &string))
+            return false;
+        docList.append(QUrl::fromEncoded(string));
+    }
 
-    stream >> m_charssplit;
-    stream >> m_charsword;
+    m_dict = data;
+    m_termCount = header.termCount;
+    return m_termCount > 0;
+}
 
-    // Read the document list
-    stream >> docList;
+bool Index::findTerm(const QString &term, QVector<Document> *documents) const
+{
+    const QByteArray key = term.toUtf8();
+    const char *data = m_dict.constData();
+    const uchar *end = reinterpret_cast<const uchar *>(data) + m_dict.size();
+    const DictTerm *table = reinterpret_cast<const DictTerm *>(data + sizeof(DictHeader));
+
+    quint32 low = 0, high = m_termCount;
+    while (low < high) {
+        const quint32 middle = low + (high - low) / 2;
+        DictTerm entry;
+        memcpy(&entry, table + middle, sizeof(entry));
+        if (qint64(entry.offset) + entry.length > m_dict.size())
+            return false;
 
-    while (!stream.atEnd()) {
-        stream >> key;
-        stream >> numOfDocs;
+        const int compared = memcmp(data + entry.offset, key.constData(), qMin<quint32>(entry.length, key.size()));
+        if (compared < 0 || (compared == 0 && entry.length < quint32(key.size()))) {
+            low = middle + 1;
+        } else if (compared > 0 || entry.length > quint32(key.size())) {
+            high = middle;
+        } else {
+            if (entry.postings >= quint32(m_dict.size()))
+                return false;
+            const uchar *p = reinterpret_cast<const uchar *>(data) + entry.postings;
+            quint32 count;
+            if (!readVarint(p, end, &count))
+                return false;
+            documents->clear();
+            documents->reserve(qMin<quint32>(count, end - p));
+            quint32 docNumber = 0;
+            for (quint32 i = 0; i < count; ++i) {
+                quint32 delta, frequency;
+                if (!readVarint(p, end, &delta) || !readVarint(p, end, &frequency))
+                    return false;
+                docNumber += delta;
+                if (docNumber >= quint32(docList.count()))
+                    return false;
+                documents->append(Document(docNumber, frequency));
+            }
+            return true;
+        }
+    }
+    return false;
+}
 
-        QVector<Document> docs(numOfDocs);
+void Index::writeDict(QDataStream &stream)
+{
+    stream.writeRawData(m_dict.constData(), m_dict.size());
+}
 
-        stream >> docs;
-        dict.insert(key, new Entry(docs));
-    }
+bool Index::readDict(QDataStream &stream)
+{
+    m_dictFile.close();
+    return stream.device() && setDict(stream.device()->readAll());
+}
 
-    return dict.size() > 0;
+bool Index::mapDict(const QString &fileName)
+{
+    m_dict = QByteArray();
+    m_dictFile.close();
+    m_dictFile.setFileName(fileName);
+    if (!m_dictFile.open(QIODevice::ReadOnly))
+        return false;
+
+    const qint64 size = m_dictFile.size();
+    const uchar *data = size > 0 && size < INT_MAX ? m_dictFile.map(0, size) : nullptr;
+    if (!data) {
+        m_dictFile.close();
+        return false;
+    }
+    return setDict(QByteArray::fromRawData(reinterpret_cast<const char *>(data), int(size)));
 }
 
 QList<QUrl> Index::query(const QStringList &terms, const QStringList &termSeq, const QStringList &seqWords, EBook *chmFile)
 {
     QList<Term> termList;
 
-    QStringList::ConstIterator it = terms.begin();
-    for (it = terms.begin(); it != terms.end(); ++it) {
-        Entry *e = nullptr;
-
-        if (dict[*it]) {
-            e = dict[*it];
-            termList.append(Term(*it, e->documents.count(), e->documents));
-        } else {
+    for (const QString &term : terms) {
+        QVector<Document> documents;
+        if (!findTerm(term, &documents))
             return QList<QUrl>();
-        }
+        termList.append(Term(term, documents.count(), documents));
     }
 
     if (termList.isEmpty())
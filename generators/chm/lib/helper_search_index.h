@@ -8,7 +8,9 @@
 #ifndef EBOOK_SEARCH_INDEX_H
 #define EBOOK_SEARCH_INDEX_H
 
+#include <QByteArray>
 #include <QDataStream>
+#include <QFile>
 #include <QHash>
 #include <QStringList>
 #include <QUrl>
@@ -52,13 +54,10 @@ struct Document {
         return frequency < doc.frequency;
     }
 
-    qint16 docNumber;
-    qint16 frequency;
+    int docNumber;
+    int frequency;
 };
 
-QDataStream &operator>>(QDataStream &s, Document &l);
-QDataStream &operator<<(QDataStream &s, const Document l);
-
 class Index : public QObject
 {
     Q_OBJECT
@@ -67,6 +66,8 @@ public:
 
     void writeDict(QDataStream &stream);
     bool readDict(QDataStream &stream);
+    // the dictionary is used right from the file, which stays mapped
+    bool mapDict(const QString &fileName);
     bool makeIndex(const QList<QUrl> &docs, EBook *chmFile);
     QList<QUrl> query(const QStringList &, const QStringList &, const QStringList &, EBook *chmFile);
     QString getCharsSplit() const
@@ -85,18 +86,6 @@ public slots:
     void setLastWinClosed();
 
 private:
-    struct Entry {
-        explicit Entry(int d)
-        {
-            documents.append(Document(d, 1));
-        }
-        explicit Entry(const QVector<Document> &l)
-            : documents(l)
-        {
-        }
-        QVector<Document> documents;
-    };
-
     struct PosEntry {
         explicit PosEntry(int p)
         {
@@ -106,7 +95,14 @@ private:
     };
 
     bool parseDocumentToStringlist(EBook *chmFile, const QUrl &filename, QStringList &tokenlist);
-    void insertInDict(const QString &, int);
+    void tokenize(const QString &text, QStringList &tokenlist) const;
+    QHash<QString, int> termFrequencies(const QString &text) const;
+
+    // the dictionary is a sorted table of the terms with their documents,
+    // see the format in helper_search_index.cpp
+    static QByteArray serializeDict(const QHash<QString, QVector<Document>> &terms, const QString &charsSplit, const QString &charsWord, const QList<QUrl> &documents);
+    bool setDict(const QByteArray &data);
+    bool findTerm(const QString &term, QVector<Document> *documents) const;
 
     QStringList getWildcardTerms(const QString &);
     QStringList split(const QString &);
@@ -114,7 +110,10 @@ private:
     bool searchForPhrases(const QStringList &phrases, const QStringList &words, const QUrl &filename, EBook *chmFile);
 
     QList<QUrl> docList;
-    QHash<QString, Entry *> dict;
+    // the file comes first, m_dict may point into its mapped memory
+    QFile m_dictFile;
+    QByteArray m_dict;
+    quint32 m_termCount;
     QHash<QString, PosEntry *> miniDict;
     bool lastWindowClosed;
     HelperEntityDecoder entityDecoder;
@@ -7,9 +7,11 @@
 #include "document.h"
 
 #include <QBuffer>
+#include <QFile>
+#include <QFileInfo>
 #include <QImage>
 #include <QImageReader>
-#include <QScopedPointer>
+#include <QSet>
 
 #include <KLocalizedString>
 #include <KTar>
@@ -44,10 +46,57 @@ static void imagesInArchive(const QString &prefix, const KArchiveDirectory *dir,
     }
 }
 
+// Decodes the image in dev, at size (or within it with Qt::KeepAspectRatio)
+// if that is smaller and the format can decode scaled down directly, which for
+// JPEG is a lot less work and memory
+static QImage readImage(QIODevice *dev, const QSize &size, Qt::AspectRatioMode mode)
+{
+    QImageReader reader(dev);
+    reader.setAutoTransform(true);
+    if (size.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize)) {
+        // the scaled size is the one of the image as stored, before the transformation
+        QSize storedSize = size;
+        if (reader.transformation() & QImageIOHandler::TransformationRotate90)
+            storedSize.transpose();
+        const QSize fullSize = reader.size();
+        if (mode == Qt::KeepAspectRatio && fullSize.isValid())
+            storedSize = fullSize.scaled(storedSize, Qt::KeepAspectRatio);
+        if (fullSize.isValid() && storedSize.width() < fullSize.width() && storedSize.height() < fullSize.height())
+            reader.setScaledSize(storedSize);
+    }
+    return reader.read();
+}
+
+// the size of a page as stored in the image, or an invalid one if it is not an image
+static QSize imageSize(QIODevice *dev)
+{
+    QImageReader reader(dev);
+    reader.setAutoTransform(true);
+    if (!reader.canRead())
+        return QSize();
+
+    QSize size = reader.size();
+    if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
+        size.transpose();
+    }
+    if (!size.isValid()) {
+        const QImage i = reader.read();
+        if (!i.isNull())
+            size = i.size();
+    }
+    return size;
+}
+
+// documents with more entries only read the size of the first few pages when
+// opening, the others get the size of the last of them until they are read
+static const int lazySizesEntryCount = 64;
+static const int probedPages = 8;
+
 Document::Document()
     : mDirectory(nullptr)
     , mUnrar(nullptr)
     , mArchive(nullptr)
+    , mArchiveMap(nullptr)
 {
 }
 
@@ -141,6 +190,10 @@ void Document::close()
     if (!(mArchive || mUnrar || mDirectory))
         return;
 
+    if (mArchiveMap)
+        mArchiveFile.unmap(mArchiveMap);
+    mArchiveMap = nullptr;
+    mArchiveFile.close();
     delete mArchive;
     mArchive = nullptr;
     delete mDirectory;
@@ -148,6 +201,7 @@ void Document::close()
     delete mUnrar;
     mUnrar = nullptr;
     mPageMap.clear();
+    mProvisionalSizes.clear();
     mEntries.clear();
 }
 
@@ -172,82 +226,127 @@ bool Document::processArchive()
 
     imagesInArchive(QString(), mArchiveDir, &mEntries);
 
+    // the images stored uncompressed in zip archives are read right from the mapped file
+    if (dynamic_cast<KZip *>(mArchive)) {
+        mArchiveFile.setFileName(mArchive->fileName());
+        if (mArchiveFile.open(QIODevice::ReadOnly))
+            mArchiveMap = mArchiveFile.map(0, mArchiveFile.size());
+        if (!mArchiveMap)
+            mArchiveFile.close();
+    }
+
     return true;
 }
 
+QIODevice *Document::createDevice(const QString &file) const
+{
+    if (mArchive) {
+        const KArchiveFile *entry = static_cast<const KArchiveFile *>(mArchiveDir->entry(file));
+        return entry ? entry->createDevice() : nullptr;
+    } else if (mDirectory) {
+        return mDirectory->createDevice(file);
+    } else {
+        return mUnrar->createDevice(file);
+    }
+}
+
 void Document::pages(QVector<Okular::Page *> *pagesVector)
 {
     std::sort(mEntries.begin(), mEntries.end(), caseSensitiveNaturalOrderLessThen);
-    QScopedPointer<QIODevice> dev;
+
+    const bool lazySizes = mEntries.count() > lazySizesEntryCount;
+    QSet<QString> imageSuffixes;
+    if (lazySizes) {
+        const QList<QByteArray> formats = QImageReader::supportedImageFormats();
+        for (const QByteArray &format : formats)
+            imageSuffixes.insert(QString::fromLatin1(format));
+    }
 
     int count = 0;
+    QSize provisionalSize;
     pagesVector->clear();
     pagesVector->resize(mEntries.size());
-    QImageReader reader;
-    reader.setAutoTransform(true);
     for (const QString &file : qAsConst(mEntries)) {
-        if (mArchive) {
-            const KArchiveFile *entry = static_cast<const KArchiveFile *>(mArchiveDir->entry(file));
-            if (entry) {
-                dev.reset(entry->createDevice());
-            }
-        } else if (mDirectory) {
-            dev.reset(mDirectory->createDevice(file));
+        // past the first pages the name has to do to tell an image
+        QSize pageSize;
+        const bool provisional = provisionalSize.isValid() && count >= probedPages && imageSuffixes.contains(QFileInfo(file).suffix().toLower());
+        if (provisional) {
+            pageSize = provisionalSize;
         } else {
-            dev.reset(mUnrar->createDevice(file));
-        }
-
-        if (!dev.isNull()) {
-            reader.setDevice(dev.data());
-            if (reader.canRead()) {
-                QSize pageSize = reader.size();
-                if (reader.transformation() & QImageIOHandler::TransformationRotate90) {
-                    pageSize.transpose();
-                }
-                if (!pageSize.isValid()) {
-                    const QImage i = reader.read();
-                    if (!i.isNull())
-                        pageSize = i.size();
-                }
-                if (pageSize.isValid()) {
-                    pagesVector->replace(count, new Okular::Page(count, pageSize.width(), pageSize.height(), Okular::Rotation0));
-                    mPageMap.append(file);
-                    count++;
-                } else {
-                    qCDebug(OkularComicbookDebug) << "Ignoring" << file << "doesn't seem to be an image even if QImageReader::canRead returned true";
-                }
+            std::unique_ptr<QIODevice> dev(createDevice(file));
+            if (!dev)
+                continue;
+            pageSize = imageSize(dev.get());
+            if (!pageSize.isValid()) {
+                qCDebug(OkularComicbookDebug) << "Ignoring" << file << "doesn't seem to be an image";
+                continue;
             }
+            if (lazySizes)
+                provisionalSize = pageSize;
         }
+
+        pagesVector->replace(count, new Okular::Page(count, pageSize.width(), pageSize.height(), Okular::Rotation0));
+        mPageMap.append(file);
+        mProvisionalSizes.append(provisional);
+        count++;
     }
     pagesVector->resize(count);
 }
 
+bool Document::hasProvisionalSize(int page) const
+{
+    return mProvisionalSizes.value(page, false);
+}
+
+QSize Document::pageSize(int page)
+{
+    if (page < 0 || page >= mPageMap.count())
+        return QSize();
+
+    mProvisionalSizes[page] = false;
+    std::unique_ptr<QIODevice> dev(createDevice(mPageMap[page]));
+    return dev ? imageSize(dev.get()) : QSize();
+}
+
 QStringList Document::pageTitles() const
 {
     return QStringList();
 }
 
-QImage Document::pageImage(int page) const
+QImage Document::pageImage(int page, const QSize &size, Qt::AspectRatioMode mode) const
 {
     if (mArchive) {
         const KArchiveFile *entry = static_cast<const KArchiveFile *>(mArchiveDir->entry(mPageMap[page]));
         if (entry) {
+            const KZipFileEntry *zipEntry = dynamic_cast<const KZipFileEntry *>(entry);
+            if (mArchiveMap && zipEntry && zipEntry->encoding() == 0 && zipEntry->position() >= 0 && zipEntry->position() + zipEntry->size() <= mArchiveFile.size()) {
+                // stored as is, no need to copy it out of the archive
+                QBuffer b;
+                b.setData(QByteArray::fromRawData(reinterpret_cast<const char *>(mArchiveMap + zipEntry->position()), zipEntry->size()));
+                b.open(QIODevice::ReadOnly);
+                return readImage(&b, size, mode);
+            }
+
             std::unique_ptr<QIODevice> dev(entry->createDevice());
             // This could simply be
-            //     QImageReader reader(dev.get());
+            //     readImage(dev.get(), size, mode);
             // but due to https://codereview.qt-project.org/c/qt/qtbase/+/349174 and https://invent.kde.org/frameworks/karchive/-/merge_requests/14
             // it can not, so it will have to be like this at least until Qt6
             // Test with https://bugs.kde.org/attachment.cgi?id=74039 (it's a cbz with a png inside)
             QBuffer b;
             b.setData(dev->readAll());
-            QImageReader reader(&b);
-            reader.setAutoTransform(true);
-            return reader.read();
+            b.open(QIODevice::ReadOnly);
+            return readImage(&b, size, mode);
         }
     } else if (mDirectory) {
-        return QImage(mPageMap[page]);
+        QFile file(mPageMap[page]);
+        if (file.open(QIODevice::ReadOnly))
+            return readImage(&file, size, mode);
     } else {
-        return QImage::fromData(mUnrar->contentOf(mPageMap[page]));
+        // the archive was extracted once when opening it, read the page from there
+        std::unique_ptr<QIODevice> dev(mUnrar->createDevice(mPageMap[page]));
+        if (dev)
+            return readImage(dev.get(), size, mode);
     }
 
     return QImage();
@@ -7,11 +7,15 @@
 #ifndef COMICBOOK_DOCUMENT_H
 #define COMICBOOK_DOCUMENT_H
 
+#include <QFile>
+#include <QSize>
 #include <QStringList>
+#include <QVector>
 
 class KArchiveDirectory;
 class KArchive;
 class QImage;
+class QIODevice;
 class Unrar;
 class Directory;
 
@@ -31,21 +35,45 @@ public:
     bool open(const QString &fileName);
     void close();
 
+    /**
+     * Fills @p pagesVector with the images of the document. Big documents
+     * only read the size of their first pages, the others have a
+     * provisional size until pageSize() is called for them.
+     */
     void pages(QVector<Okular::Page *> *pagesVector);
+
+    bool hasProvisionalSize(int page) const;
+
+    /**
+     * Reads the size of the image of @p page, which then no longer has a
+     * provisional size. The size is invalid if it is not an image after all.
+     */
+    QSize pageSize(int page);
+
     QStringList pageTitles() const;
 
-    QImage pageImage(int page) const;
+    /**
+     * Returns the image of @p page, decoded right at @p size (or within it if
+     * @p mode is Qt::KeepAspectRatio) when that is smaller and its format
+     * can do that, otherwise at its full size.
+     */
+    QImage pageImage(int page, const QSize &size = QSize(), Qt::AspectRatioMode mode = Qt::IgnoreAspectRatio) const;
 
     QString lastErrorString() const;
 
 private:
     bool processArchive();
+    QIODevice *createDevice(const QString &file) const;
 
     QStringList mPageMap;
+    QVector<bool> mProvisionalSizes;
     Directory *mDirectory;
     Unrar *mUnrar;
     KArchive *mArchive;
     const KArchiveDirectory *mArchiveDir;
+    // the zip archive mapped in memory
+    QFile mArchiveFile;
+    uchar *mArchiveMap;
     QString mLastErrorString;
     QStringList mEntries;
 };
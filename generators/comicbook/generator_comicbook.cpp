@@ -17,6 +17,10 @@
 #include <core/page.h>
 
 #include "debug_comicbook.h"
+#include "unrar.h"
+
+// the most of a page is scaled at once when printing, in bytes
+static const int printBandBytes = 16 * 1024 * 1024;
 
 OKULAR_EXPORT_PLUGIN(ComicBookGenerator, "libokularGenerator_comicbook.json")
 
@@ -24,8 +28,13 @@ ComicBookGenerator::ComicBookGenerator(QObject *parent, const QVariantList &args
     : Generator(parent, args)
 {
     setFeature(Threaded);
+    setFeature(ParallelRendering);
     setFeature(PrintNative);
     setFeature(PrintToFile);
+    // the real size of the pages of big documents
+    setFeature(LazyPageData);
+
+    Unrar::startDetection();
 }
 
 ComicBookGenerator::~ComicBookGenerator()
@@ -57,11 +66,32 @@ QImage ComicBookGenerator::image(Okular::PixmapRequest *request)
     int width = request->width();
     int height = request->height();
 
-    QImage image = mDocument.pageImage(request->pageNumber());
+    // the archive can only be read by one thread at a time, the scaling is
+    // the expensive part and can happen in parallel
+    lockUserMutex(RenderSite);
+    QImage image = mDocument.pageImage(request->pageNumber(), QSize(width, height));
+    unlockUserMutex();
 
+    if (image.width() == width && image.height() == height)
+        return image;
     return image.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
 }
 
+bool ComicBookGenerator::loadPageData(Okular::Page *page)
+{
+    Okular::UserMutexLocker locker(this, MetaDataSite);
+    if (!mDocument.hasProvisionalSize(page->number()))
+        return false;
+
+    const QSize size = mDocument.pageSize(page->number());
+    locker.unlock();
+    if (size.isValid())
+        page->setSize(size.width(), size.height());
+    else
+        qCDebug(OkularComicbookDebug) << "Page" << page->number() << "doesn't seem to be an image";
+    return false;
+}
+
 bool ComicBookGenerator::print(QPrinter &printer)
 {
     QPainter p(&printer);
@@ -69,16 +99,30 @@ bool ComicBookGenerator::print(QPrinter &printer)
     QList<int> pageList = Okular::FilePrinter::pageList(printer, document()->pages(), document()->currentPage() + 1, document()->bookmarkedPageList());
 
     for (int i = 0; i < pageList.count(); ++i) {
-        QImage image = mDocument.pageImage(pageList[i] - 1);
-
-        if ((image.width() > printer.width()) || (image.height() > printer.height()))
-
-            image = image.scaled(printer.width(), printer.height(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        // right at the printer resolution when the format can do that
+        lockUserMutex(OtherSite);
+        const QImage image = mDocument.pageImage(pageList[i] - 1, QSize(printer.width(), printer.height()), Qt::KeepAspectRatio);
+        unlockUserMutex();
 
         if (i != 0)
             printer.newPage();
 
-        p.drawImage(0, 0, image);
+        if ((image.width() <= printer.width()) && (image.height() <= printer.height())) {
+            p.drawImage(0, 0, image);
+            continue;
+        }
+
+        // a band of rows at a time, never the whole page scaled
+        const QSize targetSize = image.size().scaled(printer.width(), printer.height(), Qt::KeepAspectRatio);
+        const int bandHeight = qMax(1, printBandBytes / 4 / image.width());
+        for (int y = 0; y < image.height(); y += bandHeight) {
+            const QRect srcRect(0, y, image.width(), qMin(bandHeight, image.height() - y));
+            // from the rows of the image, so that the bands meet
+            const int top = qint64(y) * targetSize.height() / image.height();
+            const int bottom = qint64(srcRect.bottom() + 1) * targetSize.height() / image.height();
+            if (bottom > top)
+                p.drawImage(0, top, image.copy(srcRect).scaled(targetSize.width(), bottom - top, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+        }
     }
 
     return true;
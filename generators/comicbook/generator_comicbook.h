@@ -29,6 +29,7 @@ public:
 protected:
     bool doCloseDocument() override;
     QImage image(Okular::PixmapRequest *request) override;
+    bool loadPageData(Okular::Page *page) override;
 
 private:
     ComicBook::Document mDocument;
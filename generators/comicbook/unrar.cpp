@@ -6,11 +6,18 @@
 
 #include "unrar.h"
 
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
 #include <QEventLoop>
 #include <QFile>
 #include <QFileInfo>
 #include <QGlobalStatic>
+#include <QMutex>
+#include <QSaveFile>
 #include <QTemporaryDir>
+#include <QThread>
 
 #include <QLoggingCategory>
 #if defined(WITH_KPTY)
@@ -24,27 +31,39 @@
 #include <QStandardPaths>
 #include <memory>
 
-struct UnrarHelper {
-    UnrarHelper();
-    ~UnrarHelper();
+// How long a helper has to print its version, in ms
+static const int detectionTimeout = 5000;
 
-    UnrarHelper(const UnrarHelper &) = delete;
-    UnrarHelper &operator=(const UnrarHelper &) = delete;
+// Bumped when the format of the flavour cache changes
+static const int flavourCacheVersion = 1;
 
-    UnrarFlavour *kind;
-    QString unrarPath;
-    QString lsarPath;
-};
+static QString flavourCacheFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/okular/comicbook/unrarflavour");
+}
 
-Q_GLOBAL_STATIC(UnrarHelper, helper)
+static UnrarFlavour *createFlavour(const QString &name)
+{
+    if (name == QLatin1String("unrar-nonfree"))
+        return new NonFreeUnrarFlavour();
+    if (name == QLatin1String("unrar-free"))
+        return new FreeUnrarFlavour();
+    if (name == QLatin1String("unar"))
+        return new UnarFlavour();
+    return nullptr;
+}
 
 static UnrarFlavour *detectUnrar(const QString &unrarPath, const QString &versionCommand)
 {
     UnrarFlavour *kind = nullptr;
     QProcess proc;
     proc.start(unrarPath, QStringList() << versionCommand);
-    bool ok = proc.waitForFinished(-1);
-    Q_UNUSED(ok)
+    if (!proc.waitForFinished(detectionTimeout)) {
+        qCWarning(OkularComicbookDebug) << unrarPath << versionCommand << "did not answer in time";
+        proc.kill();
+        proc.waitForFinished(detectionTimeout);
+        return nullptr;
+    }
     const QRegularExpression regex(QStringLiteral("[\r\n]"));
     const QStringList lines = QString::fromLocal8Bit(proc.readAllStandardOutput()).split(regex, QString::SkipEmptyParts);
     if (!lines.isEmpty()) {
@@ -60,8 +79,67 @@ static UnrarFlavour *detectUnrar(const QString &unrarPath, const QString &versio
     return kind;
 }
 
+// Runs the helper found to learn its flavour, away from the GUI thread
+class UnrarDetectionThread : public QThread
+{
+public:
+    UnrarFlavour *kind = nullptr;
+    QString path;
+    QDateTime lastModified;
+
+protected:
+    void run() override
+    {
+        kind = detectUnrar(path, QStringLiteral("--version"));
+        if (!kind)
+            kind = detectUnrar(path, QStringLiteral("-v"));
+        if (kind)
+            writeCache();
+    }
+
+private:
+    void writeCache() const
+    {
+        const QString fileName = flavourCacheFileName();
+        QDir().mkpath(QFileInfo(fileName).absolutePath());
+        QSaveFile file(fileName);
+        if (!file.open(QIODevice::WriteOnly))
+            return;
+
+        QDataStream stream(&file);
+        stream << qint32(flavourCacheVersion) << path << lastModified << kind->name();
+        if (!file.commit())
+            qCWarning(OkularComicbookDebug) << "Could not write the unrar flavour cache" << fileName;
+    }
+};
+
+struct UnrarHelper {
+    UnrarHelper();
+    ~UnrarHelper();
+
+    UnrarHelper(const UnrarHelper &) = delete;
+    UnrarHelper &operator=(const UnrarHelper &) = delete;
+
+    // the flavour of unrarPath, waiting for its detection if it is running;
+    // the GUI thread keeps handling its events meanwhile
+    UnrarFlavour *flavour();
+
+    bool readCache(const QString &path, const QDateTime &lastModified);
+
+    UnrarFlavour *kind;
+    QString unrarPath;
+    QString lsarPath;
+    // kept until the end, so the threads waiting on it can still read it
+    UnrarDetectionThread *detection;
+    bool detectionTaken;
+};
+
+Q_GLOBAL_STATIC(UnrarHelper, helper)
+
 UnrarHelper::UnrarHelper()
     : kind(nullptr)
+    , detection(nullptr)
+    , detectionTaken(false)
 {
     QString path = QStandardPaths::findExecutable(QStringLiteral("lsar"));
 
@@ -78,26 +156,96 @@ UnrarHelper::UnrarHelper()
     if (path.isEmpty())
         path = QStandardPaths::findExecutable(QStringLiteral("unar"));
 
-    if (!path.isEmpty())
-        kind = detectUnrar(path, QStringLiteral("--version"));
-
-    if (!kind)
-        kind = detectUnrar(path, QStringLiteral("-v"));
-
-    if (!kind) {
+    if (path.isEmpty()) {
         // no luck, print that
         qWarning() << "Neither unrar nor unarchiver were found.";
-    } else {
-        unrarPath = path;
-        qCDebug(OkularComicbookDebug) << "detected:" << path << "(" << kind->name() << ")";
+        return;
     }
+
+    unrarPath = path;
+    const QDateTime lastModified = QFileInfo(path).lastModified();
+    if (readCache(path, lastModified)) {
+        qCDebug(OkularComicbookDebug) << "cached:" << path << "(" << kind->name() << ")";
+        return;
+    }
+
+    detection = new UnrarDetectionThread;
+    detection->path = path;
+    detection->lastModified = lastModified;
+    detection->start();
 }
 
 UnrarHelper::~UnrarHelper()
 {
+    if (detection) {
+        detection->wait();
+        delete detection->kind;
+        delete detection;
+    }
     delete kind;
 }
 
+bool UnrarHelper::readCache(const QString &path, const QDateTime &lastModified)
+{
+    QFile file(flavourCacheFileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    qint32 version;
+    QString cachedPath;
+    QDateTime cachedLastModified;
+    QString name;
+    stream >> version;
+    if (stream.status() != QDataStream::Ok || version != flavourCacheVersion)
+        return false;
+
+    stream >> cachedPath >> cachedLastModified >> name;
+    if (stream.status() != QDataStream::Ok || cachedPath != path || cachedLastModified != lastModified)
+        return false;
+
+    kind = createFlavour(name);
+    return kind;
+}
+
+UnrarFlavour *UnrarHelper::flavour()
+{
+    if (!detection)
+        return kind;
+
+    // the first document may be opened while the helper has not answered yet
+    if (QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread()) {
+        QEventLoop loop;
+        QObject::connect(detection, &QThread::finished, &loop, &QEventLoop::quit);
+        if (!detection->isFinished())
+            loop.exec(QEventLoop::ExcludeUserInputEvents);
+    }
+    detection->wait();
+
+    // only the first caller after the detection takes its result
+    static QMutex mutex;
+    QMutexLocker locker(&mutex);
+    if (!detectionTaken) {
+        detectionTaken = true;
+        kind = detection->kind;
+        detection->kind = nullptr;
+
+        if (!kind) {
+            qWarning() << "Neither unrar nor unarchiver were found.";
+            unrarPath.clear();
+        } else {
+            qCDebug(OkularComicbookDebug) << "detected:" << unrarPath << "(" << kind->name() << ")";
+        }
+    }
+    return kind;
+}
+
+void Unrar::startDetection()
+{
+    // creating the helper starts the detection if the flavour is not cached
+    helper();
+}
+
 Unrar::Unrar()
     : QObject(nullptr)
     , mLoop(nullptr)
@@ -126,7 +274,7 @@ bool Unrar::open(const QString &fileName)
     mStdOutData.clear();
     mStdErrData.clear();
 
-    const int ret = startSyncProcess(helper->kind->processOpenArchiveArgs(mFileName, mTempDir->path()));
+    const int ret = startSyncProcess(helper->flavour()->processOpenArchiveArgs(mFileName, mTempDir->path()));
     bool ok = ret == 0;
 
     return ok;
@@ -140,14 +288,14 @@ QStringList Unrar::list()
     if (!isSuitableVersionAvailable())
         return QStringList();
 
-    startSyncProcess(helper->kind->processListArgs(mFileName));
+    startSyncProcess(helper->flavour()->processListArgs(mFileName));
 
     const QRegularExpression regex(QStringLiteral("[\r\n]"));
-    QStringList listFiles = helper->kind->processListing(QString::fromLocal8Bit(mStdOutData).split(regex, QString::SkipEmptyParts));
+    QStringList listFiles = helper->flavour()->processListing(QString::fromLocal8Bit(mStdOutData).split(regex, QString::SkipEmptyParts));
 
     QString subDir;
 
-    if (listFiles.last().endsWith(QLatin1Char('/')) && helper->kind->name() == QLatin1String("unar")) {
+    if (listFiles.last().endsWith(QLatin1Char('/')) && helper->flavour()->name() == QLatin1String("unar")) {
         // Subfolder detected. The unarchiver is unable to extract all files into a single folder
         subDir = listFiles.last();
         listFiles.removeLast();
@@ -191,7 +339,7 @@ QIODevice *Unrar::createDevice(const QString &fileName) const
 
 bool Unrar::isAvailable()
 {
-    return helper->kind;
+    return helper->flavour();
 }
 
 bool Unrar::isSuitableVersionAvailable()
@@ -199,7 +347,7 @@ bool Unrar::isSuitableVersionAvailable()
     if (!isAvailable())
         return false;
 
-    if (dynamic_cast<NonFreeUnrarFlavour *>(helper->kind) || dynamic_cast<UnarFlavour *>(helper->kind))
+    if (dynamic_cast<NonFreeUnrarFlavour *>(helper->flavour()) || dynamic_cast<UnarFlavour *>(helper->flavour()))
         return true;
     else
         return false;
@@ -253,7 +401,7 @@ int Unrar::startSyncProcess(const ProcessArgs &args)
 #endif
 
 #if !defined(WITH_KPTY)
-    if (helper->kind->name() == QLatin1String("unar") && args.useLsar) {
+    if (helper->flavour()->name() == QLatin1String("unar") && args.useLsar) {
         mProcess->start(helper->lsarPath, args.appArgs, QIODevice::ReadWrite | QIODevice::Unbuffered);
     } else {
         mProcess->start(helper->unrarPath, args.appArgs, QIODevice::ReadWrite | QIODevice::Unbuffered);
@@ -261,7 +409,7 @@ int Unrar::startSyncProcess(const ProcessArgs &args)
 
     ret = mProcess->waitForFinished(-1) ? 0 : 1;
 #else
-    if (helper->kind->name() == QLatin1String("unar") && args.useLsar) {
+    if (helper->flavour()->name() == QLatin1String("unar") && args.useLsar) {
         mProcess->setProgram(helper->lsarPath, args.appArgs);
     } else {
         mProcess->setProgram(helper->unrarPath, args.appArgs);
@@ -55,6 +55,12 @@ public:
      */
     QIODevice *createDevice(const QString &fileName) const;
 
+    /**
+     * Starts learning which unrar is installed, if it is not known from
+     * an earlier run, so that the first archive opened does not wait for it.
+     */
+    static void startDetection();
+
     static bool isAvailable();
     static bool isSuitableVersionAvailable();
 
@@ -20,6 +20,7 @@
 #include <QPixmap>
 #include <QPrinter>
 #include <QString>
+#include <QTimer>
 #include <QUuid>
 
 #include <KAboutData>
@@ -28,6 +29,9 @@
 #include <QDir>
 #include <QTemporaryFile>
 
+// how often the pages whose data is being decoded are looked at
+static const int pageDataPollTime = 50; // in msec
+
 static void recurseCreateTOC(QDomDocument &maindoc, const QDomNode &parent, QDomNode &parentDestination, KDjVu *djvu)
 {
     QDomNode n = parent.firstChild();
@@ -62,15 +66,24 @@ OKULAR_EXPORT_PLUGIN(DjVuGenerator, "libokularGenerator_djvu.json")
 DjVuGenerator::DjVuGenerator(QObject *parent, const QVariantList &args)
     : Okular::Generator(parent, args)
     , m_docSyn(nullptr)
+    , m_pageDataTimer(new QTimer(this))
 {
     setFeature(TextExtraction);
     setFeature(Threaded);
+    setFeature(SupportsCancelling);
+    setFeature(TiledRendering);
+    setFeature(LazyPageData);
     setFeature(PrintPostscript);
     if (Okular::FilePrinter::ps2pdfAvailable())
         setFeature(PrintToFile);
 
+    // the pages in the cache count against the memory usage of the document,
+    // which trims it with freeCachedMemory()
     m_djvu = new KDjVu();
-    m_djvu->setCacheEnabled(false);
+
+    m_pageDataTimer->setSingleShot(true);
+    m_pageDataTimer->setInterval(pageDataPollTime);
+    connect(m_pageDataTimer, &QTimer::timeout, this, &DjVuGenerator::pollPendingPageData);
 }
 
 DjVuGenerator::~DjVuGenerator()
@@ -97,16 +110,37 @@ bool DjVuGenerator::doCloseDocument()
     m_djvu->closeFile();
     userMutex()->unlock();
 
+    m_pageDataLoaded.clear();
+    m_pendingPageData.clear();
+    m_pageDataTimer->stop();
+
     delete m_docSyn;
     m_docSyn = nullptr;
 
     return true;
 }
 
+qulonglong DjVuGenerator::cachedMemory() const
+{
+    return m_djvu->cacheMemory();
+}
+
+qulonglong DjVuGenerator::freeCachedMemory(qulonglong bytes)
+{
+    return m_djvu->trimCache(bytes);
+}
+
 QImage DjVuGenerator::image(Okular::PixmapRequest *request)
 {
     userMutex()->lock();
-    QImage img = m_djvu->image(request->pageNumber(), request->width(), request->height(), request->page()->rotation());
+    const std::function<bool()> shouldAbort = [request] { return request->shouldAbortRender(); };
+    QImage img;
+    if (request->isTile()) {
+        const QRect rect = request->normalizedRect().geometry(request->width(), request->height());
+        img = m_djvu->tileImage(request->pageNumber(), request->width(), request->height(), rect, shouldAbort);
+    } else {
+        img = m_djvu->image(request->pageNumber(), request->width(), request->height(), request->page()->rotation(), shouldAbort);
+    }
     userMutex()->unlock();
     return img;
 }
@@ -197,15 +231,20 @@ Okular::TextPage *DjVuGenerator::textPage(Okular::TextRequest *request)
     if (te.isEmpty())
         te = m_djvu->textEntities(page->number(), QStringLiteral("line"));
     userMutex()->unlock();
-    QList<KDjVu::TextEntity>::ConstIterator it = te.constBegin();
-    QList<KDjVu::TextEntity>::ConstIterator itEnd = te.constEnd();
-    QList<Okular::TextEntity *> words;
+    // the text of all the entities in one buffer, given to the text page at once
+    QString text;
+    QVector<int> lengths;
+    QVector<Okular::NormalizedRect> areas;
+    lengths.reserve(te.count());
+    areas.reserve(te.count());
     const KDjVu::Page *djvupage = m_djvu->pages().at(page->number());
-    for (; it != itEnd; ++it) {
-        const KDjVu::TextEntity &cur = *it;
-        words.append(new Okular::TextEntity(cur.text(), new Okular::NormalizedRect(cur.rect(), djvupage->width(), djvupage->height())));
+    for (const KDjVu::TextEntity &cur : qAsConst(te)) {
+        text += cur.text();
+        lengths.append(cur.text().length());
+        areas.append(Okular::NormalizedRect(cur.rect(), djvupage->width(), djvupage->height()));
     }
-    Okular::TextPage *textpage = new Okular::TextPage(words);
+    Okular::TextPage *textpage = new Okular::TextPage;
+    textpage->append(text, lengths, areas);
     return textpage;
 }
 
@@ -225,40 +264,103 @@ void DjVuGenerator::loadPages(QVector<Okular::Page *> &pagesVector, int rotation
             qSwap(w, h);
         Okular::Page *page = new Okular::Page(i, w, h, (Okular::Rotation)(p->orientation() + rotation));
         pagesVector[i] = page;
+    }
 
-        QList<KDjVu::Annotation *> annots;
-        QList<KDjVu::Link *> links;
-        userMutex()->lock();
-        m_djvu->linksAndAnnotationsForPage(i, &links, &annots);
-        userMutex()->unlock();
-        if (!links.isEmpty()) {
-            QLinkedList<Okular::ObjectRect *> rects;
-            QList<KDjVu::Link *>::ConstIterator it = links.constBegin();
-            QList<KDjVu::Link *>::ConstIterator itEnd = links.constEnd();
-            for (; it != itEnd; ++it) {
-                KDjVu::Link *curlink = (*it);
-                Okular::ObjectRect *newrect = convertKDjVuLink(i, curlink);
-                if (newrect)
-                    rects.append(newrect);
-                // delete the links as soon as we process them
-                delete curlink;
-            }
-            if (rects.count() > 0)
-                page->setObjectRects(rects);
+    m_pageDataLoaded.fill(false, numofpages);
+    m_pendingPageData.clear();
+}
+
+bool DjVuGenerator::loadPageData(Okular::Page *page)
+{
+    const int number = page->number();
+    if (number < 0 || number >= m_pageDataLoaded.count() || m_pageDataLoaded.testBit(number))
+        return false;
+
+    // the page may have to be downloaded or decoded first, which ddjvu does
+    // in its own thread; pollPendingPageData() tells when it is done
+    QMutexLocker locker(userMutex());
+    if (!m_djvu->isPageDataReady(number)) {
+        m_pendingPageData.insert(number);
+        if (!m_pageDataTimer->isActive())
+            m_pageDataTimer->start();
+        return false;
+    }
+    m_pageDataLoaded.setBit(number);
+    m_pendingPageData.remove(number);
+
+    const bool provisional = m_djvu->hasProvisionalSize(number);
+    m_djvu->loadPageInfo(number);
+    const KDjVu::Page *p = m_djvu->pages().at(number);
+    const int w = p->width();
+    const int h = p->height();
+    const int orientation = p->orientation();
+
+    QList<KDjVu::Annotation *> annots;
+    QList<KDjVu::Link *> links;
+    m_djvu->linksAndAnnotationsForPage(number, &links, &annots);
+    locker.unlock();
+
+    // the provisional page had the size and the orientation of the first one
+    if (provisional) {
+        page->setOrientation((Okular::Rotation)orientation);
+        if (w != page->width() || h != page->height())
+            page->setSize(w, h);
+    }
+
+    if (!links.isEmpty()) {
+        QLinkedList<Okular::ObjectRect *> rects;
+        QList<KDjVu::Link *>::ConstIterator it = links.constBegin();
+        QList<KDjVu::Link *>::ConstIterator itEnd = links.constEnd();
+        for (; it != itEnd; ++it) {
+            KDjVu::Link *curlink = (*it);
+            Okular::ObjectRect *newrect = convertKDjVuLink(number, curlink);
+            if (newrect)
+                rects.append(newrect);
+            // delete the links as soon as we process them
+            delete curlink;
         }
-        if (!annots.isEmpty()) {
-            QList<KDjVu::Annotation *>::ConstIterator it = annots.constBegin();
-            QList<KDjVu::Annotation *>::ConstIterator itEnd = annots.constEnd();
-            for (; it != itEnd; ++it) {
-                KDjVu::Annotation *ann = (*it);
-                Okular::Annotation *newann = convertKDjVuAnnotation(w, h, ann);
-                if (newann)
-                    page->addAnnotation(newann);
-                // delete the annotations as soon as we process them
-                delete ann;
-            }
+        if (rects.count() > 0)
+            page->setObjectRects(rects);
+    }
+    if (!annots.isEmpty()) {
+        QList<KDjVu::Annotation *>::ConstIterator it = annots.constBegin();
+        QList<KDjVu::Annotation *>::ConstIterator itEnd = annots.constEnd();
+        for (; it != itEnd; ++it) {
+            KDjVu::Annotation *ann = (*it);
+            Okular::Annotation *newann = convertKDjVuAnnotation(w, h, ann);
+            if (newann)
+                page->addAnnotation(newann);
+            // delete the annotations as soon as we process them
+            delete ann;
         }
     }
+
+    return !links.isEmpty() || !annots.isEmpty();
+}
+
+void DjVuGenerator::pollPendingPageData()
+{
+    if (m_pendingPageData.isEmpty())
+        return;
+
+    // a page being rendered has the document, look again later
+    if (!userMutex()->tryLock()) {
+        m_pageDataTimer->start();
+        return;
+    }
+    QList<int> ready;
+    for (const int page : qAsConst(m_pendingPageData)) {
+        if (m_djvu->isPageDataReady(page))
+            ready << page;
+    }
+    userMutex()->unlock();
+
+    for (const int page : qAsConst(ready)) {
+        m_pendingPageData.remove(page);
+        emit pageDataReady(page);
+    }
+    if (!m_pendingPageData.isEmpty())
+        m_pageDataTimer->start();
 }
 
 Okular::ObjectRect *DjVuGenerator::convertKDjVuLink(int page, KDjVu::Link *link) const
@@ -9,6 +9,8 @@
 
 #include <core/generator.h>
 
+#include <QBitArray>
+#include <QSet>
 #include <QVector>
 
 #include "kdjvu.h"
@@ -19,6 +21,8 @@ class Annotation;
 class ObjectRect;
 }
 
+class QTimer;
+
 class DjVuGenerator : public Okular::Generator
 {
     Q_OBJECT
@@ -37,20 +41,31 @@ public:
 
     QVariant metaData(const QString &key, const QVariant &option) const override;
 
+    // memory of the rendered pages cache
+    qulonglong cachedMemory() const override;
+    qulonglong freeCachedMemory(qulonglong bytes) override;
+
 protected:
     bool doCloseDocument() override;
     // pixmap generation
     QImage image(Okular::PixmapRequest *request) override;
     Okular::TextPage *textPage(Okular::TextRequest *request) override;
+    bool loadPageData(Okular::Page *page) override;
 
 private:
     void loadPages(QVector<Okular::Page *> &pagesVector, int rotation);
+    void pollPendingPageData();
     Okular::ObjectRect *convertKDjVuLink(int page, KDjVu::Link *link) const;
     Okular::Annotation *convertKDjVuAnnotation(int w, int h, KDjVu::Annotation *ann) const;
 
     KDjVu *m_djvu;
 
     Okular::DocumentSynopsis *m_docSyn;
+    // the pages whose size, links and annotations were read
+    QBitArray m_pageDataLoaded;
+    // the pages whose data is still being decoded, and what looks at them
+    QSet<int> m_pendingPageData;
+    QTimer *m_pageDataTimer;
 };
 
 #endif
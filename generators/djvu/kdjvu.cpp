@@ -7,19 +7,28 @@
 #include "kdjvu.h"
 
 #include <QByteArray>
+#include <QCache>
+#include <QDataStream>
 #include <QDomDocument>
 #include <QFile>
 #include <QHash>
-#include <QPainter>
+#include <QMutex>
 #include <QQueue>
 #include <QString>
+#include <QThread>
+#include <QThreadPool>
 
 #include <KLocalizedString>
 #include <QDebug>
 
+#include <core/diskcache_p.h>
+#include <core/functiontask_p.h>
+
 #include <libdjvu/ddjvuapi.h>
 #include <libdjvu/miniexp.h>
 
+#include <algorithm>
+#include <limits>
 #include <stdio.h>
 
 QDebug &operator<<(QDebug &s, const ddjvu_rect_t r)
@@ -131,28 +140,78 @@ static bool find_replace_or_add_second_in_pair(miniexp_t theexp, const char *whi
     return false;
 }
 
-// ImageCacheItem
+// ImageCacheKey
+
+// the rendered pages are looked up by page, size and rotation
+struct ImageCacheKey {
+    int page;
+    int width;
+    int height;
+    int rotation;
+
+    bool operator==(const ImageCacheKey &other) const
+    {
+        return page == other.page && width == other.width && height == other.height && rotation == other.rotation;
+    }
+};
+
+static uint qHash(const ImageCacheKey &key, uint seed = 0)
+{
+    return ::qHash(key.page, seed) ^ ::qHash((key.width << 16) ^ key.height ^ (key.rotation << 30), seed);
+}
+
+// DecodedPage
 
-class ImageCacheItem
+// a ddjvu page, which keeps its decoded data while it is alive
+class DecodedPage
 {
 public:
-    ImageCacheItem(int p, int w, int h, const QImage &i)
+    explicit DecodedPage(ddjvu_page_t *p)
         : page(p)
-        , width(w)
-        , height(h)
-        , img(i)
     {
     }
 
-    int page;
-    int width;
-    int height;
-    QImage img;
+    ~DecodedPage()
+    {
+        if (page)
+            ddjvu_page_release(page);
+    }
+
+    Q_DISABLE_COPY(DecodedPage)
+
+    ddjvu_page_t *page;
 };
 
+// how many decoded pages are kept by default; scanned pages take some MiB each
+static const int defaultPageCacheSize = 16;
+// the format of the files of the page information cache
+static const int pageInfoCacheVersion = 1;
+// where the page information of the files opened before is kept
+static const Okular::DiskCache &pageInfoCache()
+{
+    static const Okular::DiskCache cache(QStringLiteral("djvu"));
+    return cache;
+}
+// how many pages after the one rendered are decoded in the background
+static const int prefetchedPages = 2;
+
+// how much memory the rendered pages can take by default, until the core asks for it back
+static const qulonglong defaultImageCacheBudget = 64 * 1024 * 1024;
+
+// the cost of the images in the image cache, in KiB so big budgets fit in an int
+static int imageCacheCost(const QImage &image)
+{
+    return qMax(1, int(image.sizeInBytes() / 1024));
+}
+
 // KdjVu::Page
 
 KDjVu::Page::Page()
+    : m_width(0)
+    , m_height(0)
+    , m_dpi(0)
+    , m_orientation(0)
+    , m_provisional(false)
 {
 }
 
@@ -425,17 +484,30 @@ public:
         , m_djvu_document(nullptr)
         , m_format(nullptr)
         , m_docBookmarks(nullptr)
+        , mImgCacheBudget(defaultImageCacheBudget)
+        , m_provisionalPages(0)
         , m_cacheEnabled(true)
     {
+        m_pages_cache.setMaxCost(defaultPageCacheSize);
+        mImgCache.setMaxCost(mImgCacheBudget / 1024);
     }
 
-    QImage generateImageTile(ddjvu_page_t *djvupage, int &res, int width, int row, int xdelta, int height, int col, int ydelta);
+    QImage generateImageTile(ddjvu_page_t *djvupage, int &res, int width, int height, const QRect &renderRect);
+    bool renderTile(ddjvu_page_t *djvupage, int width, int height, const QRect &renderRect, uchar *buffer, int bytesPerLine);
+    ddjvu_page_t *loadPage(int page);
+    void prefetchPages(int page);
+    QImage renderRegion(ddjvu_page_t *djvupage, int &res, int width, int height, const QRect &region, const std::function<bool()> &shouldAbort);
 
     void readBookmarks();
     void fillBookmarksRecurse(QDomDocument &maindoc, QDomNode &curnode, miniexp_t exp, int offset = -1);
 
     void readMetaData(int page);
 
+    bool readPageInfo(int page, KDjVu::Page *p);
+    void loadPageInfo(int page);
+    bool readPageInfoCache();
+    void writePageInfoCache();
+
     int pageWithName(const QString &name);
 
     ddjvu_context_t *m_djvu_cxt;
@@ -443,15 +515,25 @@ public:
     ddjvu_format_t *m_format;
 
     QVector<KDjVu::Page *> m_pages;
-    QVector<ddjvu_page_t *> m_pages_cache;
+    // the pages created in ddjvu, the least recently used are released first
+    QCache<int, DecodedPage> m_pages_cache;
 
-    QList<ImageCacheItem *> mImgCache;
+    // rendered pages, the least recently used are dropped first; the image
+    // cache is also trimmed from the GUI thread, hence its mutex
+    mutable QMutex mImgCacheMutex;
+    QCache<ImageCacheKey, QImage> mImgCache;
+    qulonglong mImgCacheBudget;
 
     QHash<QString, QVariant> m_metaData;
     QDomDocument *m_docBookmarks;
 
     QHash<QString, int> m_pageNamesCache;
 
+    // where the information of the pages of the document is kept between
+    // sessions, written once all the pages are known
+    QByteArray m_pageInfoCacheKey;
+    int m_provisionalPages;
+
     bool m_cacheEnabled;
 
     static unsigned int s_formatmask[4];
@@ -459,15 +541,13 @@ public:
 
 unsigned int KDjVu::Private::s_formatmask[4] = {0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000};
 
-QImage KDjVu::Private::generateImageTile(ddjvu_page_t *djvupage, int &res, int width, int row, int xdelta, int height, int col, int ydelta)
+bool KDjVu::Private::renderTile(ddjvu_page_t *djvupage, int width, int height, const QRect &renderRect, uchar *buffer, int bytesPerLine)
 {
     ddjvu_rect_t renderrect;
-    renderrect.x = row * xdelta;
-    renderrect.y = col * ydelta;
-    int realwidth = qMin(width - renderrect.x, xdelta);
-    int realheight = qMin(height - renderrect.y, ydelta);
-    renderrect.w = realwidth;
-    renderrect.h = realheight;
+    renderrect.x = renderRect.x();
+    renderrect.y = renderRect.y();
+    renderrect.w = renderRect.width();
+    renderrect.h = renderRect.height();
 #ifdef KDJVU_DEBUG
     qDebug() << "renderrect:" << renderrect;
 #endif
@@ -479,23 +559,111 @@ QImage KDjVu::Private::generateImageTile(ddjvu_page_t *djvupage, int &res, int w
 #ifdef KDJVU_DEBUG
     qDebug() << "pagerect:" << pagerect;
 #endif
-    handle_ddjvu_messages(m_djvu_cxt, false);
-    QImage res_img(realwidth, realheight, QImage::Format_RGB32);
-    // the following line workarounds a rare crash in djvulibre;
-    // it should be fixed with >= 3.5.21
-    ddjvu_page_get_width(djvupage);
-    res = ddjvu_page_render(djvupage, DDJVU_RENDER_COLOR, &pagerect, &renderrect, m_format, res_img.bytesPerLine(), (char *)res_img.bits());
+    const int res = ddjvu_page_render(djvupage, DDJVU_RENDER_COLOR, &pagerect, &renderrect, m_format, bytesPerLine, (char *)buffer);
     if (!res) {
-        res_img.fill(Qt::white);
+        for (int y = 0; y < renderRect.height(); ++y)
+            std::fill_n(reinterpret_cast<QRgb *>(buffer + y * bytesPerLine), renderRect.width(), qRgb(255, 255, 255));
     }
 #ifdef KDJVU_DEBUG
     qDebug() << "rendering result:" << res;
 #endif
+    return res;
+}
+
+QImage KDjVu::Private::generateImageTile(ddjvu_page_t *djvupage, int &res, int width, int height, const QRect &renderRect)
+{
+    handle_ddjvu_messages(m_djvu_cxt, false);
+    QImage res_img(renderRect.width(), renderRect.height(), QImage::Format_RGB32);
+    // the following line workarounds a rare crash in djvulibre;
+    // it should be fixed with >= 3.5.21
+    ddjvu_page_get_width(djvupage);
+    res = renderTile(djvupage, width, height, renderRect, res_img.bits(), res_img.bytesPerLine());
     handle_ddjvu_messages(m_djvu_cxt, false);
 
     return res_img;
 }
 
+ddjvu_page_t *KDjVu::Private::loadPage(int page)
+{
+    DecodedPage *decoded = m_pages_cache.object(page);
+    if (!decoded) {
+        decoded = new DecodedPage(ddjvu_page_create_by_pageno(m_djvu_document, page));
+        m_pages_cache.insert(page, decoded);
+    }
+
+    // wait for the page to be decoded, unless it was prefetched already; the
+    // decoding happens in the threads of ddjvu, which tell when they are done
+    while (ddjvu_page_decoding_status(decoded->page) < DDJVU_JOB_OK)
+        handle_ddjvu_messages(m_djvu_cxt, true);
+    return decoded->page;
+}
+
+void KDjVu::Private::prefetchPages(int page)
+{
+    // keep room for the page just rendered
+    const int count = qMin(prefetchedPages, m_pages_cache.maxCost() - 1);
+    for (int i = page + 1; i <= page + count && i < m_pages.count(); ++i) {
+        if (m_pages_cache.contains(i))
+            continue;
+
+        // creating the page starts decoding it in the background
+        m_pages_cache.insert(i, new DecodedPage(ddjvu_page_create_by_pageno(m_djvu_document, i)));
+    }
+    handle_ddjvu_messages(m_djvu_cxt, false);
+}
+
+QImage KDjVu::Private::renderRegion(ddjvu_page_t *djvupage, int &res, int width, int height, const QRect &region, const std::function<bool()> &shouldAbort)
+{
+    static const int xdelta = 1500;
+    static const int ydelta = 1500;
+
+    int xparts = (region.width() - 1) / xdelta + 1;
+    int yparts = (region.height() - 1) / ydelta + 1;
+
+    res = 10000;
+    if ((xparts == 1) && (yparts == 1)) {
+        // only one part -- render at once with no need to auxiliary image
+        return generateImageTile(djvupage, res, width, height, region);
+    }
+
+    // more than one part -- the page is decoded already, so the parts are
+    // rendered at the same time, each one right into its place in the image
+    QImage newimg(region.size(), QImage::Format_RGB32);
+    uchar *bits = newimg.bits();
+    const int bytesPerLine = newimg.bytesPerLine();
+    // the following line workarounds a rare crash in djvulibre;
+    // it should be fixed with >= 3.5.21
+    ddjvu_page_get_width(djvupage);
+    handle_ddjvu_messages(m_djvu_cxt, false);
+
+    QMutex resMutex;
+    QAtomicInt aborted(0);
+    QThreadPool pool;
+    pool.setMaxThreadCount(qMin(xparts * yparts, QThread::idealThreadCount()));
+    const int parts = xparts * yparts;
+    for (int i = 0; i < parts; ++i) {
+        const int row = i % xparts;
+        const int col = i / xparts;
+        const QRect renderRect = QRect(region.x() + row * xdelta, region.y() + col * ydelta, xdelta, ydelta) & region;
+        uchar *buffer = bits + (renderRect.y() - region.y()) * bytesPerLine + (renderRect.x() - region.x()) * 4;
+        pool.start(new Okular::FunctionTask([this, djvupage, width, height, renderRect, buffer, bytesPerLine, &shouldAbort, &aborted, &resMutex, &res] {
+            if (aborted.loadAcquire() || (shouldAbort && shouldAbort())) {
+                aborted.storeRelease(1);
+                return;
+            }
+            const int tmpres = renderTile(djvupage, width, height, renderRect, buffer, bytesPerLine);
+            QMutexLocker locker(&resMutex);
+            res = qMin(tmpres, res);
+        }));
+    }
+    pool.waitForDone();
+    handle_ddjvu_messages(m_djvu_cxt, false);
+
+    if (aborted.loadAcquire())
+        return QImage();
+    return newimg;
+}
+
 void KDjVu::Private::readBookmarks()
 {
     if (!m_djvu_document)
@@ -583,6 +751,84 @@ void KDjVu::Private::readMetaData(int page)
     }
 }
 
+bool KDjVu::Private::readPageInfo(int page, KDjVu::Page *p)
+{
+    ddjvu_status_t sts;
+    ddjvu_pageinfo_t info;
+    while ((sts = ddjvu_document_get_pageinfo(m_djvu_document, page, &info)) < DDJVU_JOB_OK)
+        handle_ddjvu_messages(m_djvu_cxt, true);
+    if (sts >= DDJVU_JOB_FAILED) {
+        qDebug().nospace() << "\t>>> page " << page << " failed: " << sts;
+        return false;
+    }
+
+    p->m_width = info.width;
+    p->m_height = info.height;
+    p->m_dpi = info.dpi;
+#if DDJVUAPI_VERSION >= 18
+    p->m_orientation = flipRotation(info.rotation);
+#else
+    p->m_orientation = 0;
+#endif
+    return true;
+}
+
+void KDjVu::Private::loadPageInfo(int page)
+{
+    if (page < 0 || page >= m_pages.count() || !m_pages.at(page)->m_provisional)
+        return;
+
+    KDjVu::Page *p = m_pages.at(page);
+    // a page that can not be read keeps the size it was given
+    readPageInfo(page, p);
+    p->m_provisional = false;
+    if (--m_provisionalPages == 0)
+        writePageInfoCache();
+}
+
+bool KDjVu::Private::readPageInfoCache()
+{
+    if (m_pageInfoCacheKey.isEmpty())
+        return false;
+    const QByteArray data = pageInfoCache().read(m_pageInfoCacheKey);
+    if (data.isEmpty())
+        return false;
+
+    QDataStream stream(data);
+    qint32 version, count;
+    stream >> version >> count;
+    if (version != pageInfoCacheVersion || count != m_pages.count())
+        return false;
+
+    QVector<qint32> values(count * 4);
+    for (qint32 &value : values)
+        stream >> value;
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    for (int i = 0; i < count; ++i) {
+        KDjVu::Page *p = m_pages.at(i);
+        p->m_width = values.at(i * 4);
+        p->m_height = values.at(i * 4 + 1);
+        p->m_dpi = values.at(i * 4 + 2);
+        p->m_orientation = values.at(i * 4 + 3);
+    }
+    return true;
+}
+
+void KDjVu::Private::writePageInfoCache()
+{
+    if (m_pageInfoCacheKey.isEmpty())
+        return;
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << qint32(pageInfoCacheVersion) << qint32(m_pages.count());
+    for (const KDjVu::Page *p : qAsConst(m_pages))
+        stream << qint32(p->m_width) << qint32(p->m_height) << qint32(p->m_dpi) << qint32(p->m_orientation);
+    pageInfoCache().write(m_pageInfoCacheKey, data);
+}
+
 int KDjVu::Private::pageWithName(const QString &name)
 {
     const int pageNo = m_pageNamesCache.value(name, -1);
@@ -653,7 +899,6 @@ bool KDjVu::openFile(const QString &fileName)
     d->m_pages.clear();
     d->m_pages.resize(numofpages);
     d->m_pages_cache.clear();
-    d->m_pages_cache.resize(numofpages);
 
     // get the document type
     QString doctype;
@@ -682,27 +927,29 @@ bool KDjVu::openFile(const QString &fileName)
     // get the number of components
     d->m_metaData[QStringLiteral("componentFile")] = ddjvu_document_get_filenum(d->m_djvu_document);
 
-    // read the pages
-    for (int i = 0; i < numofpages; ++i) {
-        ddjvu_status_t sts;
-        ddjvu_pageinfo_t info;
-        while ((sts = ddjvu_document_get_pageinfo(d->m_djvu_document, i, &info)) < DDJVU_JOB_OK)
-            handle_ddjvu_messages(d->m_djvu_cxt, true);
-        if (sts >= DDJVU_JOB_FAILED) {
-            qDebug().nospace() << "\t>>> page " << i << " failed: " << sts;
+    // the cached information of the pages, keyed by the file and its modification time
+    d->m_pageInfoCacheKey = Okular::DiskCache::fileKey(fileName);
+
+    // read the pages; without the cache only the first one is read now, as
+    // the others can take as long as the whole document to get to, and they
+    // are like it until loadPageInfo() reads them
+    for (int i = 0; i < numofpages; ++i)
+        d->m_pages[i] = new KDjVu::Page();
+    if (numofpages > 0 && !d->readPageInfoCache()) {
+        KDjVu::Page *first = d->m_pages.at(0);
+        if (!d->readPageInfo(0, first))
             return false;
+        for (int i = 1; i < numofpages; ++i) {
+            KDjVu::Page *p = d->m_pages.at(i);
+            p->m_width = first->m_width;
+            p->m_height = first->m_height;
+            p->m_dpi = first->m_dpi;
+            p->m_orientation = first->m_orientation;
+            p->m_provisional = true;
         }
-
-        KDjVu::Page *p = new KDjVu::Page();
-        p->m_width = info.width;
-        p->m_height = info.height;
-        p->m_dpi = info.dpi;
-#if DDJVUAPI_VERSION >= 18
-        p->m_orientation = flipRotation(info.rotation);
-#else
-        p->m_orientation = 0;
-#endif
-        d->m_pages[i] = p;
+        d->m_provisionalPages = numofpages - 1;
+        if (d->m_provisionalPages == 0)
+            d->writePageInfoCache();
     }
 
     // reading the metadata from the first page only should be enough
@@ -721,17 +968,18 @@ void KDjVu::closeFile()
     qDeleteAll(d->m_pages);
     d->m_pages.clear();
     // releasing the djvu pages
-    QVector<ddjvu_page_t *>::Iterator it = d->m_pages_cache.begin(), itEnd = d->m_pages_cache.end();
-    for (; it != itEnd; ++it)
-        ddjvu_page_release(*it);
     d->m_pages_cache.clear();
     // clearing the image cache
-    qDeleteAll(d->mImgCache);
-    d->mImgCache.clear();
+    {
+        QMutexLocker locker(&d->mImgCacheMutex);
+        d->mImgCache.clear();
+    }
     // clearing the old metadata
     d->m_metaData.clear();
     // cleaning the page names mapping
     d->m_pageNamesCache.clear();
+    d->m_pageInfoCacheKey.clear();
+    d->m_provisionalPages = 0;
     // releasing the old document
     if (d->m_djvu_document)
         ddjvu_document_release(d->m_djvu_document);
@@ -756,6 +1004,8 @@ void KDjVu::linksAndAnnotationsForPage(int pageNum, QList<KDjVu::Link *> *links,
     if ((pageNum < 0) || (pageNum >= d->m_pages.count()) || (!links && !annotations))
         return;
 
+    d->loadPageInfo(pageNum);
+
     miniexp_t annots;
     while ((annots = ddjvu_document_get_pageanno(d->m_djvu_document, pageNum)) == miniexp_dummy)
         handle_ddjvu_messages(d->m_djvu_cxt, true);
@@ -840,36 +1090,43 @@ const QVector<KDjVu::Page *> &KDjVu::pages() const
     return d->m_pages;
 }
 
-QImage KDjVu::image(int page, int width, int height, int rotation)
+bool KDjVu::hasProvisionalSize(int page) const
 {
+    return page >= 0 && page < d->m_pages.count() && d->m_pages.at(page)->m_provisional;
+}
+
+void KDjVu::loadPageInfo(int page)
+{
+    d->loadPageInfo(page);
+}
+
+bool KDjVu::isPageDataReady(int page) const
+{
+    if (page < 0 || page >= d->m_pages.count())
+        return true;
+
+    handle_ddjvu_messages(d->m_djvu_cxt, false);
+    ddjvu_pageinfo_t info;
+    if (d->m_pages.at(page)->m_provisional && ddjvu_document_get_pageinfo(d->m_djvu_document, page, &info) < DDJVU_JOB_OK)
+        return false;
+
+    const miniexp_t annots = ddjvu_document_get_pageanno(d->m_djvu_document, page);
+    if (annots == miniexp_dummy)
+        return false;
+    ddjvu_miniexp_release(d->m_djvu_document, annots);
+    return true;
+}
+
+QImage KDjVu::image(int page, int width, int height, int rotation, const std::function<bool()> &shouldAbort)
+{
+    const ImageCacheKey key = {page, width, height, rotation};
     if (d->m_cacheEnabled) {
-        bool found = false;
-        QList<ImageCacheItem *>::Iterator it = d->mImgCache.begin(), itEnd = d->mImgCache.end();
-        for (; (it != itEnd) && !found; ++it) {
-            ImageCacheItem *cur = *it;
-            if ((cur->page == page) && (rotation % 2 == 0 ? cur->width == width && cur->height == height : cur->width == height && cur->height == width))
-                found = true;
-        }
-        if (found) {
-            // taking the element and pushing to the top of the list
-            --it;
-            ImageCacheItem *cur2 = *it;
-            d->mImgCache.erase(it);
-            d->mImgCache.push_front(cur2);
-
-            return cur2->img;
-        }
+        QMutexLocker locker(&d->mImgCacheMutex);
+        if (const QImage *cached = d->mImgCache.object(key))
+            return *cached;
     }
 
-    if (!d->m_pages_cache.at(page)) {
-        ddjvu_page_t *newpage = ddjvu_page_create_by_pageno(d->m_djvu_document, page);
-        // wait for the new page to be loaded
-        ddjvu_status_t sts;
-        while ((sts = ddjvu_page_decoding_status(newpage)) < DDJVU_JOB_OK)
-            handle_ddjvu_messages(d->m_djvu_cxt, true);
-        d->m_pages_cache[page] = newpage;
-    }
-    ddjvu_page_t *djvupage = d->m_pages_cache[page];
+    ddjvu_page_t *djvupage = d->loadPage(page);
 
     /*
         if ( ddjvu_page_get_rotation( djvupage ) != flipRotation( rotation ) )
@@ -880,63 +1137,33 @@ QImage KDjVu::image(int page, int width, int height, int rotation)
         }
     */
 
-    static const int xdelta = 1500;
-    static const int ydelta = 1500;
-
-    int xparts = width / xdelta + 1;
-    int yparts = height / ydelta + 1;
-
-    QImage newimg;
-
-    int res = 10000;
-    if ((xparts == 1) && (yparts == 1)) {
-        // only one part -- render at once with no need to auxiliary image
-        newimg = d->generateImageTile(djvupage, res, width, 0, xdelta, height, 0, ydelta);
-    } else {
-        // more than one part -- need to render piece-by-piece and to compose
-        // the results
-        newimg = QImage(width, height, QImage::Format_RGB32);
-        QPainter p;
-        p.begin(&newimg);
-        int parts = xparts * yparts;
-        for (int i = 0; i < parts; ++i) {
-            const int row = i % xparts;
-            const int col = i / xparts;
-            int tmpres = 0;
-            const QImage tempp = d->generateImageTile(djvupage, tmpres, width, row, xdelta, height, col, ydelta);
-            p.drawImage(row * xdelta, col * ydelta, tempp);
-            res = qMin(tmpres, res);
-        }
-        p.end();
-    }
+    int res = 0;
+    QImage newimg = d->renderRegion(djvupage, res, width, height, QRect(0, 0, width, height), shouldAbort);
+    if (newimg.isNull())
+        return newimg;
 
     if (res && d->m_cacheEnabled) {
-        // delete all the cached pixmaps for the current page with a size that
-        // differs no more than 35% of the new pixmap size
-        int imgsize = newimg.width() * newimg.height();
-        if (imgsize > 0) {
-            for (int i = 0; i < d->mImgCache.count();) {
-                ImageCacheItem *cur = d->mImgCache.at(i);
-                if ((cur->page == page) && (abs(cur->img.width() * cur->img.height() - imgsize) < imgsize * 0.35)) {
-                    d->mImgCache.removeAt(i);
-                    delete cur;
-                } else
-                    ++i;
-            }
-        }
-
-        // the image cache has too many elements, remove the last
-        if (d->mImgCache.size() >= 10) {
-            delete d->mImgCache.last();
-            d->mImgCache.removeLast();
-        }
-        ImageCacheItem *ich = new ImageCacheItem(page, width, height, newimg);
-        d->mImgCache.push_front(ich);
+        QMutexLocker locker(&d->mImgCacheMutex);
+        d->mImgCache.insert(key, new QImage(newimg), imageCacheCost(newimg));
     }
 
+    // the next pages are likely the next ones asked for
+    d->prefetchPages(page);
+
     return newimg;
 }
 
+QImage KDjVu::tileImage(int page, int width, int height, const QRect &region, const std::function<bool()> &shouldAbort)
+{
+    const QRect renderRect = region & QRect(0, 0, width, height);
+    if (renderRect.isEmpty())
+        return QImage();
+
+    // tiles are not cached, the core keeps them
+    int res = 0;
+    return d->renderRegion(d->loadPage(page), res, width, height, renderRect, shouldAbort);
+}
+
 bool KDjVu::exportAsPostScript(const QString &fileName, const QList<int> &pageList) const
 {
     if (!d->m_djvu_document || fileName.trimmed().isEmpty() || pageList.isEmpty())
@@ -999,6 +1226,7 @@ QList<KDjVu::TextEntity> KDjVu::textEntities(int page, const QString &granularit
 
     QList<KDjVu::TextEntity> ret;
 
+    d->loadPageInfo(page);
     int height = d->m_pages.at(page)->height();
 
     QQueue<miniexp_t> queue;
@@ -1039,7 +1267,7 @@ void KDjVu::setCacheEnabled(bool enable)
 
     d->m_cacheEnabled = enable;
     if (!d->m_cacheEnabled) {
-        qDeleteAll(d->mImgCache);
+        QMutexLocker locker(&d->mImgCacheMutex);
         d->mImgCache.clear();
     }
 }
@@ -1049,6 +1277,46 @@ bool KDjVu::isCacheEnabled() const
     return d->m_cacheEnabled;
 }
 
+void KDjVu::setPageCacheSize(int pages)
+{
+    d->m_pages_cache.setMaxCost(qMax(1, pages));
+}
+
+int KDjVu::pageCacheSize() const
+{
+    return d->m_pages_cache.maxCost();
+}
+
+void KDjVu::setCacheBudget(qulonglong bytes)
+{
+    QMutexLocker locker(&d->mImgCacheMutex);
+    d->mImgCacheBudget = bytes;
+    d->mImgCache.setMaxCost(qMin<qulonglong>(bytes / 1024, std::numeric_limits<int>::max()));
+}
+
+qulonglong KDjVu::cacheBudget() const
+{
+    QMutexLocker locker(&d->mImgCacheMutex);
+    return d->mImgCacheBudget;
+}
+
+qulonglong KDjVu::cacheMemory() const
+{
+    QMutexLocker locker(&d->mImgCacheMutex);
+    return qulonglong(d->mImgCache.totalCost()) * 1024;
+}
+
+qulonglong KDjVu::trimCache(qulonglong bytes)
+{
+    QMutexLocker locker(&d->mImgCacheMutex);
+    const qulonglong before = qulonglong(d->mImgCache.totalCost()) * 1024;
+    const qulonglong keep = bytes < before ? before - bytes : 0;
+    // lowering the maximum cost drops the least recently used pages
+    d->mImgCache.setMaxCost(keep / 1024);
+    d->mImgCache.setMaxCost(qMin<qulonglong>(d->mImgCacheBudget / 1024, std::numeric_limits<int>::max()));
+    return before - qulonglong(d->mImgCache.totalCost()) * 1024;
+}
+
 int KDjVu::pageNumber(const QString &name) const
 {
     if (!d->m_djvu_document)
@@ -15,6 +15,8 @@
 #include <QVariant>
 #include <QVector>
 
+#include <functional>
+
 class QDomDocument;
 class QFile;
 
@@ -56,6 +58,7 @@ public:
         int m_height;
         int m_dpi;
         int m_orientation;
+        bool m_provisional;
     };
 
     /**
@@ -226,6 +229,23 @@ public:
      */
     const QVector<KDjVu::Page *> &pages() const;
 
+    /**
+     * Whether the size of the page \p page is a guess, as opening the file
+     * only reads the information of the first page.
+     */
+    bool hasProvisionalSize(int page) const;
+    /**
+     * Reads the size, the resolution and the orientation of the page
+     * \p page, if it has a provisional size.
+     */
+    void loadPageInfo(int page);
+    /**
+     * Whether the information, the links and the annotations of the page
+     * \p page were decoded, so reading them does not wait. It starts
+     * decoding them otherwise, and never waits itself.
+     */
+    bool isPageDataReady(int page) const;
+
     /**
      * Get the metadata for the specified \p key, or a null variant otherwise.
      */
@@ -258,8 +278,19 @@ public:
      * Check if the image for the specified \p page with the specified
      * \p width, \p height and \p rotation is already in cache, and returns
      * it. If not, a null image is returned.
+     *
+     * Big images are rendered in tiles; if \p shouldAbort is set it is
+     * checked between them and a null image is returned as soon as it
+     * returns true.
+     */
+    QImage image(int page, int width, int height, int rotation, const std::function<bool()> &shouldAbort = std::function<bool()>());
+
+    /**
+     * Renders only the \p region of the specified \p page scaled to
+     * \p width x \p height, without rendering the rest of it nor using
+     * the image cache. \p shouldAbort works like in image().
      */
-    QImage image(int page, int width, int height, int rotation);
+    QImage tileImage(int page, int width, int height, const QRect &region, const std::function<bool()> &shouldAbort = std::function<bool()>());
 
     /**
      * Export the currently open document as PostScript file \p fileName.
@@ -288,6 +319,35 @@ public:
      */
     bool isCacheEnabled() const;
 
+    /**
+     * Set how many decoded pages are kept at most, the least recently used
+     * are released first. The pages after a rendered one are decoded in the
+     * background and count too.
+     */
+    void setPageCacheSize(int pages);
+    /**
+     * \returns how many decoded pages are kept at most
+     */
+    int pageCacheSize() const;
+
+    /**
+     * Set how many bytes the rendered pages cache can take at most.
+     */
+    void setCacheBudget(qulonglong bytes);
+    /**
+     * \returns how many bytes the rendered pages cache can take at most
+     */
+    qulonglong cacheBudget() const;
+    /**
+     * \returns how many bytes the rendered pages cache takes now
+     */
+    qulonglong cacheMemory() const;
+    /**
+     * Drop at least \p bytes of rendered pages, the least recently used
+     * first, and \returns how many bytes were freed.
+     */
+    qulonglong trimCache(qulonglong bytes);
+
     /**
      * Return the page number of the page whose title is \p name.
      */
@@ -2,7 +2,47 @@
 #include <config.h>
 
 #include "TeXFont.h"
+#include "fontpool.h"
 
 TeXFont::~TeXFont()
 {
+    fontPool *pool = parent->font_pool;
+    const QList<GlyphCacheKey> keys = pool->glyphCache.keys();
+    for (const GlyphCacheKey &key : keys) {
+        if (key.font == this)
+            pool->glyphCache.remove(key);
+    }
+}
+
+void TeXFont::setDisplayResolution()
+{
+    const int oldResolution = GlyphCacheKey::quantizedResolution(glyphResolution_in_dpi);
+    const int newResolution = GlyphCacheKey::quantizedResolution(parent->displayResolution_in_dpi);
+    glyphResolution_in_dpi = parent->displayResolution_in_dpi;
+    if (oldResolution == newResolution)
+        return;
+
+    QCache<GlyphCacheKey, glyph> &cache = parent->font_pool->glyphCache;
+    for (int ch = 0; ch < TeXFontDefinition::max_num_of_chars_in_font; ch++) {
+        glyph &g = glyphtable[ch];
+        if (!g.shrunkenCharacter.isNull())
+            cache.insert(GlyphCacheKey {this, quint16(ch), oldResolution}, new glyph(g), GlyphCacheKey::cost(g));
+
+        const glyph *cached = cache.take(GlyphCacheKey {this, quint16(ch), newResolution});
+        if (cached) {
+            g.shrunkenCharacter = cached->shrunkenCharacter;
+            g.color = cached->color;
+            g.x2 = cached->x2;
+            g.y2 = cached->y2;
+            delete cached;
+        } else {
+            g.shrunkenCharacter = QImage();
+        }
+    }
+}
+
+void TeXFont::discardGlyphs()
+{
+    for (glyph &g : glyphtable)
+        g.shrunkenCharacter = QImage();
 }
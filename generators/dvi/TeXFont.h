@@ -19,6 +19,7 @@ public:
     {
         parent = _parent;
         errorMessage.clear();
+        glyphResolution_in_dpi = parent->displayResolution_in_dpi;
     }
 
     virtual ~TeXFont();
@@ -26,11 +27,14 @@ public:
     TeXFont(const TeXFont &) = delete;
     TeXFont &operator=(const TeXFont &) = delete;
 
-    void setDisplayResolution()
-    {
-        for (glyph &g : glyphtable)
-            g.shrunkenCharacter = QImage();
-    }
+    // Called when the display resolution of the parent changed. The
+    // shrunken glyphs of the old resolution are handed to the glyph
+    // cache of the font pool, and those cached for the new one, if any,
+    // are taken back.
+    void setDisplayResolution();
+
+    // Drops the shrunken glyphs, e.g. when the hinting changed.
+    void discardGlyphs();
 
     virtual glyph *getGlyph(quint16 character, bool generateCharacterPixmap = false, const QColor &color = Qt::black) = 0;
 
@@ -46,6 +50,10 @@ public:
 protected:
     glyph glyphtable[TeXFontDefinition::max_num_of_chars_in_font];
     TeXFontDefinition *parent;
+
+private:
+    // Resolution the shrunken glyphs of the glyphtable are for
+    double glyphResolution_in_dpi;
 };
 
 #endif
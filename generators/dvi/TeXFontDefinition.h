@@ -87,6 +87,12 @@ public:
         flags |= FONT_KPSE_NAME;
     }
 
+    // The checksum the DVI file gives for the font
+    quint32 getChecksum() const
+    {
+        return checksum;
+    }
+
     void mark_as_used();
     // Pointer to the pool that contains this font.
     class fontPool *font_pool;
@@ -6,7 +6,10 @@
 
 #include "dviPageInfo.h"
 
+#include <QPainter>
+
 dviPageInfo::dviPageInfo()
+    : graphicsPending(false)
 {
     sourceHyperLinkList.reserve(200);
 }
@@ -19,3 +22,11 @@ void dviPageInfo::clear()
 {
     sourceHyperLinkList.clear();
 }
+
+QImage dviPageInfo::image() const
+{
+    QImage img(width, height, QImage::Format_RGB32);
+    QPainter painter(&img);
+    picture.play(&painter);
+    return img;
+}
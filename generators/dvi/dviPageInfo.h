@@ -10,17 +10,27 @@
 #include "hyperlink.h"
 #include "pageNumber.h"
 #include "textBox.h"
+#include <QImage>
+#include <QPicture>
 #include <QPixmap>
 #include <QVector>
 
+#include <functional>
+
 class dviPageInfo
 {
 public:
-    QImage img;
+    /** What dviRenderer::drawPage() painted, recorded so that it can be
+        turned into an image without holding the renderer. */
+    QPicture picture;
     int width, height;
     double resolution;
     PageNumber pageNumber;
 
+    /** The PostScript graphics of the page were not rendered yet, the
+        picture has placeholders for them, see dviRenderer::graphicsJob(). */
+    bool graphicsPending;
+
     dviPageInfo();
 
     virtual ~dviPageInfo();
@@ -30,6 +40,10 @@ public:
 
     virtual void clear();
 
+    /** Plays the picture on an image of width x height pixels. Does not
+        need the renderer, may be called from any thread. */
+    QImage image() const;
+
     /** \brief List of source hyperlinks
      */
     QVector<Hyperlink> sourceHyperLinkList;
@@ -38,6 +52,10 @@ public:
      */
     QVector<Hyperlink> hyperLinkList;
     QVector<TextBox> textBoxList;
+
+    /** \brief If set, drawing stops as soon as it returns true
+     */
+    std::function<bool()> shouldAbort;
 };
 
 /* quick&dirty hack to cheat the dviRenderer class... */
@@ -28,6 +28,7 @@
 
 #include <QApplication>
 #include <QCheckBox>
+#include <QCryptographicHash>
 #include <QEventLoop>
 #include <QFileInfo>
 #include <QHBoxLayout>
@@ -48,6 +49,8 @@ dviRenderer::dviRenderer(bool useFontHinting)
     , source_href(nullptr)
     , HTML_href(nullptr)
     , editorCommand(QLatin1String(""))
+    , prescanCacheable(false)
+    , prescanResult(nullptr)
     , PostScriptOutPutString(nullptr)
     , PS_interface(new ghostscript_interface)
     , _postscript(true)
@@ -146,9 +149,17 @@ void dviRenderer::drawPage(RenderedDocumentPagePixmap *page)
     int pageWidth = page->width;
     int pageHeight = page->height;
 
-    QImage img(pageWidth, pageHeight, QImage::Format_RGB32);
-    foreGroundPainter = new QPainter(&img);
+    // Only recorded here, the glyphs are implicitly shared with the font
+    // pool, so the generator can paint the page while the next one is
+    // interpreted
+    QPicture picture;
+    foreGroundPainter = new QPainter(&picture);
     if (foreGroundPainter != nullptr) {
+        // a picture is as large as what is drawn on it, the PostScript
+        // background and the page color need the size of the page
+        const QRect pageRect(0, 0, pageWidth, pageHeight);
+        foreGroundPainter->setWindow(pageRect);
+        foreGroundPainter->setViewport(pageRect);
         errorMsg.clear();
         draw_page();
         delete foreGroundPainter;
@@ -156,8 +167,8 @@ void dviRenderer::drawPage(RenderedDocumentPagePixmap *page)
     } else {
         qCDebug(OkularDviDebug) << "painter creation failed.";
     }
-    page->img = img;
-    // page->setImage(img);
+    picture.setBoundingRect(QRect(0, 0, pageWidth, pageHeight));
+    page->picture = picture;
 
     // Postprocess hyperlinks
     // Without that, based on the way TeX draws certain characters like german "Umlaute",
@@ -205,6 +216,20 @@ void dviRenderer::drawPage(RenderedDocumentPagePixmap *page)
     currentlyDrawnPage = nullptr;
 }
 
+ghostscript_interface::GraphicsJob dviRenderer::graphicsJob(const RenderedDocumentPagePixmap *page)
+{
+    QMutexLocker locker(&mutex);
+    return PS_interface->graphicsJob(static_cast<quint16>(page->pageNumber) - 1, page->resolution, dviFile->getMagnification(), QSize(page->width, page->height));
+}
+
+void dviRenderer::renderGraphics(const ghostscript_interface::GraphicsJob &job)
+{
+    const QImage image = PS_interface->renderGraphics(job);
+
+    QMutexLocker locker(&mutex);
+    PS_interface->setGraphics(job, image);
+}
+
 void dviRenderer::getText(RenderedDocumentPagePixmap *page)
 {
     bool postscriptBackup = _postscript;
@@ -472,19 +497,49 @@ bool dviRenderer::setFile(const QString &fname, const QUrl &base)
     quint16 currPageSav = current_page;
     prebookmarks.clear();
 
+    // The pages which did not change since the last time are not
+    // scanned again, their results are. prescan() sets the same
+    // resolution, the context is the one it scans in.
+    if (resolutionInDPI == 0.0)
+        setResolution(100);
+    const QByteArray context = prescanContext();
+    if (context != prescanCacheContext)
+        prescanCache.clear();
+    QHash<QByteArray, PrescanResult> newPrescanCache;
+
     for (current_page = 0; current_page < dviFile->total_pages; current_page++) {
-        PostScriptOutPutString = new QString();
+        command_pointer = dviFile->dvi_Data() + dviFile->page_offset[int(current_page)];
+        end_pointer = dviFile->dvi_Data() + dviFile->page_offset[int(current_page + 1)];
+
+        const QByteArray pageKey = QCryptographicHash::hash(QByteArray::fromRawData(reinterpret_cast<const char *>(command_pointer), end_pointer - command_pointer), QCryptographicHash::Md5);
+        const auto cached = prescanCache.constFind(pageKey);
+        if (cached != prescanCache.constEnd()) {
+            prescan_replay(*cached);
+            newPrescanCache.insert(pageKey, *cached);
+            continue;
+        }
 
-        if (current_page < dviFile->total_pages) {
-            command_pointer = dviFile->dvi_Data() + dviFile->page_offset[int(current_page)];
-            end_pointer = dviFile->dvi_Data() + dviFile->page_offset[int(current_page + 1)];
-        } else
-            command_pointer = end_pointer = nullptr;
+        PostScriptOutPutString = new QString();
 
         memset((char *)&currinf.data, 0, sizeof(currinf.data));
         currinf.fonttable = &(dviFile->tn_table);
         currinf._virtual = nullptr;
+
+        PrescanResult result;
+        prescanResult = &result;
+        prescanCacheable = true;
+        const int firstSourceAnchor = sourceHyperLinkAnchors.count();
+        const int firstPrebookmark = prebookmarks.count();
+        const QString previousErrorMsg = errorMsg;
         prescan(&dviRenderer::prescan_parseSpecials);
+        prescanResult = nullptr;
+
+        if (prescanCacheable && errorMsg == previousErrorMsg) {
+            result.postScript = *PostScriptOutPutString;
+            result.sourceAnchors = sourceHyperLinkAnchors.mid(firstSourceAnchor);
+            result.prebookmarks = prebookmarks.mid(firstPrebookmark);
+            newPrescanCache.insert(pageKey, result);
+        }
 
         if (!PostScriptOutPutString->isEmpty())
             PS_interface->setPostScript(current_page, *PostScriptOutPutString);
@@ -492,6 +547,10 @@ bool dviRenderer::setFile(const QString &fname, const QUrl &base)
     }
     PostScriptOutPutString = nullptr;
 
+    // Only the pages of this version, the file is not going back
+    prescanCache = newPrescanCache;
+    prescanCacheContext = context;
+
 #ifdef PERFORMANCE_MEASUREMENT
     // qCDebug(OkularDviDebug) << "Time required for prescan phase: " << preScanTimer.restart() << "ms";
 #endif
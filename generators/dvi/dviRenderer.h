@@ -20,6 +20,7 @@
 #include "fontpool.h"
 #include "pageSize.h"
 #include "prebookmark.h"
+#include "psgs.h"
 
 #include <QExplicitlySharedDataPointer>
 #include <QHash>
@@ -36,7 +37,6 @@ class Anchor;
 class DocumentWidget;
 class dvifile;
 class dviRenderer;
-class ghostscript_interface;
 class QEventLoop;
 class QProgressDialog;
 class PreBookmark;
@@ -173,6 +173,14 @@ public Q_SLOTS:
     void embedPostScript();
 
     virtual void drawPage(RenderedDocumentPagePixmap *page);
+
+    /** What is needed to render the graphics drawPage() left out of the
+        page, see dviPageInfo::graphicsPending. */
+    ghostscript_interface::GraphicsJob graphicsJob(const RenderedDocumentPagePixmap *page);
+
+    /** Runs the job, without holding the renderer, and keeps the result
+        for the next drawPage() of the page. */
+    void renderGraphics(const ghostscript_interface::GraphicsJob &job);
     virtual void getText(RenderedDocumentPagePixmap *page);
 
     SimplePageSize sizeOfPage(const PageNumber page);
@@ -234,6 +242,36 @@ private:
     void prescan_ParsePSFileSpecial(const QString &cp);
     void prescan_ParseSourceSpecial(const QString &cp);
     void prescan_setChar(unsigned int ch);
+    void prescan_addAnchor(const QString &name, const Length &l);
+
+    /** What the prescan of a page found, kept for the next setFile() of
+        the file, e.g. after recompiling it, so that the pages whose DVI
+        code did not change are not scanned again. */
+    struct PrescanResult {
+        QString postScript;
+        QVector<QPair<QString, Length>> anchors;
+        QVector<DVI_SourceFileAnchor> sourceAnchors;
+        QVector<PreBookmark> prebookmarks;
+    };
+
+    /** Gives the current page what the prescan of the same code found. */
+    void prescan_replay(const PrescanResult &result);
+
+    /** What the results of the prescan depend on besides the code of the
+        page: the file, its fonts and the resolution. */
+    QByteArray prescanContext() const;
+
+    // Keyed by the MD5 hash of the DVI code of the page, for the pages
+    // whose specials only concern themselves
+    QHash<QByteArray, PrescanResult> prescanCache;
+    QByteArray prescanCacheContext;
+
+    // Cleared by prescan_parseSpecials() for the specials which concern
+    // other pages or the whole file, like headers or the paper size
+    bool prescanCacheable;
+
+    // Where prescan_addAnchor() records the anchors of the page, if not NULL
+    PrescanResult *prescanResult;
 
     /* */
     QVector<PreBookmark> prebookmarks;
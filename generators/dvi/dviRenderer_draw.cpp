@@ -253,7 +253,16 @@ void dviRenderer::draw_part(double current_dimconv, bool is_vfmacro)
     int last_space_index = 0;
     bool space_encountered = false;
     bool after_space = false;
+    const std::function<bool()> &shouldAbort = currentlyDrawnPage->shouldAbort;
+    quint32 commands = 0;
     for (;;) {
+        // checking every command would be too expensive
+        if (shouldAbort && (++commands % 1024) == 0 && shouldAbort()) {
+            // the frames pushed so far are not popped anymore
+            stack.clear();
+            return;
+        }
+
         space_encountered = false;
         ch = readUINT8();
         if (ch <= (unsigned char)(SETCHAR0 + 127)) {
@@ -573,6 +582,8 @@ void dviRenderer::draw_page()
     HTML_href = nullptr;
     source_href = nullptr;
     penWidth_in_mInch = 0.0;
+    // an aborted or broken page may have left frames behind
+    stack.clear();
 
     // Calling resize() here rather than clear() means that the memory
     // taken up by the vector is not freed. This is faster than
@@ -599,14 +610,19 @@ void dviRenderer::draw_page()
 #endif
 
     foreGroundPainter->fillRect(foreGroundPainter->viewport(), PS_interface->getBackgroundColor(current_page));
+    currentlyDrawnPage->graphicsPending = false;
 
     // Render the PostScript background, if there is one.
     if (_postscript) {
         PS_interface->restoreBackgroundColor(current_page);
 
-        PS_interface->graphics(current_page, resolutionInDPI, dviFile->getMagnification(), foreGroundPainter);
+        // Not rendered yet, the figures get placeholders meanwhile
+        currentlyDrawnPage->graphicsPending = !PS_interface->graphics(current_page, resolutionInDPI, dviFile->getMagnification(), foreGroundPainter);
     }
 
+    if (currentlyDrawnPage->shouldAbort && currentlyDrawnPage->shouldAbort())
+        return;
+
     // Now really write the text
     if (dviFile->page_offset.isEmpty() == true)
         return;
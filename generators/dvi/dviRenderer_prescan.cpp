@@ -30,6 +30,8 @@
 #include <QProgressBar>
 #include <QTextStream>
 
+#include <algorithm>
+
 extern QPainter foreGroundPaint;
 extern void parse_special_argument(const QString &strg, const char *argument_name, int *variable);
 
@@ -263,7 +265,7 @@ void dviRenderer::prescan_ParseHTMLAnchorSpecial(const QString &_cp)
     cp.truncate(cp.indexOf(QLatin1Char('"')));
     Length l;
     l.setLength_in_inch(currinf.data.dvi_v / (resolutionInDPI * shrinkfactor));
-    anchorList[cp] = Anchor(current_page + 1, l);
+    prescan_addAnchor(cp, l);
 }
 
 void dviRenderer::prescan_ParsePSHeaderSpecial(const QString &cp)
@@ -345,7 +347,7 @@ void dviRenderer::prescan_ParsePSSpecial(const QString &cp)
                 QString anchorName = cp.section(QLatin1Char('('), 1, 1).section(QLatin1Char(')'), 0, 0);
                 Length l;
                 l.setLength_in_inch(currinf.data.dvi_v / (resolutionInDPI * shrinkfactor));
-                anchorList[anchorName] = Anchor(current_page + 1, l);
+                prescan_addAnchor(anchorName, l);
             }
             // The PostScript code defines a bookmark
             if (cp.contains(QStringLiteral("/Dest")) && cp.contains(QStringLiteral("/Title"))) {
@@ -501,6 +503,40 @@ void dviRenderer::prescan_ParseSourceSpecial(const QString &cp)
     sourceHyperLinkAnchors.push_back(sfa);
 }
 
+void dviRenderer::prescan_addAnchor(const QString &name, const Length &l)
+{
+    anchorList[name] = Anchor(current_page + 1, l);
+    if (prescanResult != nullptr)
+        prescanResult->anchors.append(qMakePair(name, l));
+}
+
+void dviRenderer::prescan_replay(const PrescanResult &result)
+{
+    for (const QPair<QString, Length> &anchor : result.anchors)
+        anchorList[anchor.first] = Anchor(current_page + 1, anchor.second);
+    for (DVI_SourceFileAnchor sfa : result.sourceAnchors) {
+        sfa.page = current_page + 1;
+        sourceHyperLinkAnchors.push_back(sfa);
+    }
+    prebookmarks += result.prebookmarks;
+    if (!result.postScript.isEmpty())
+        PS_interface->setPostScript(current_page, result.postScript);
+}
+
+QByteArray dviRenderer::prescanContext() const
+{
+    QString context = dviFile->filename;
+    context += QStringLiteral(" %1 %2 %3").arg(resolutionInDPI).arg(shrinkfactor).arg(dviFile->getCmPerDVIunit());
+
+    QList<int> fontNumbers = dviFile->tn_table.keys();
+    std::sort(fontNumbers.begin(), fontNumbers.end());
+    for (int number : qAsConst(fontNumbers)) {
+        const TeXFontDefinition *fontp = dviFile->tn_table.value(number);
+        context += QStringLiteral("\n%1 %2 %3 %4 %5").arg(number).arg(fontp->fontname).arg(fontp->getChecksum()).arg(fontp->scaled_size_in_DVI_units).arg(fontp->enlargement);
+    }
+    return context.toUtf8();
+}
+
 void dviRenderer::prescan_parseSpecials(char *cp, quint8 *)
 {
     QString special_command = QString::fromUtf8(cp);
@@ -510,12 +546,14 @@ void dviRenderer::prescan_parseSpecials(char *cp, quint8 *)
 
     // PaperSize special
     if (qstrnicmp(cp, "papersize", 9) == 0) {
+        prescanCacheable = false;
         prescan_ParsePapersizeSpecial(special_command.mid(9));
         return;
     }
 
     // color special for background color
     if (qstrnicmp(cp, "background", 10) == 0) {
+        prescanCacheable = false;
         prescan_ParseBackgroundSpecial(special_command.mid(10));
         return;
     }
@@ -528,12 +566,14 @@ void dviRenderer::prescan_parseSpecials(char *cp, quint8 *)
 
     // Postscript Header File
     if (qstrnicmp(cp, "header=", 7) == 0) {
+        prescanCacheable = false;
         prescan_ParsePSHeaderSpecial(special_command.mid(7));
         return;
     }
 
     // Literal Postscript Header
     if (cp[0] == '!') {
+        prescanCacheable = false;
         prescan_ParsePSBangSpecial(special_command.mid(1));
         return;
     }
@@ -552,6 +592,8 @@ void dviRenderer::prescan_parseSpecials(char *cp, quint8 *)
 
     // Encapsulated Postscript File
     if (qstrnicmp(cp, "PSfile=", 7) == 0) {
+        // the file may be gone, or converted from PDF in a file of the old DVI file
+        prescanCacheable = false;
         prescan_ParsePSFileSpecial(special_command.mid(7));
         return;
     }
@@ -14,7 +14,13 @@
 #include <KLocalizedString>
 
 #include <QApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
 #include <QPainter>
+#include <QSaveFile>
+#include <QStandardPaths>
 
 #include <cmath>
 #include <math.h>
@@ -27,12 +33,38 @@
 // const char *MFModenames[]   = { "Canon CX", "LaserJet 4", "Lexmark S" };
 // const int   MFResolutions[] = { 300, 600, 1200 };
 
+// Memory for the glyphs of the zoom levels not shown, in KiB. A thesis
+// with a dozen fonts needs a few MiB per zoom level.
+static const int glyphCacheBudget = 32 * 1024;
+
+// The resolution kpsewhich looks for PK fonts at
+static const int kpsewhichResolution = 1200;
+
+// Bumped when the format of the font location cache changes
+static const int fontLocationCacheVersion = 1;
+
+static QString fontLocationCacheFileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QStringLiteral("/okular/dvi/fontlocations");
+}
+
+static QString fontLocationKey(const TeXFontDefinition *fontp)
+{
+    return fontp->fontname + QLatin1Char(' ') + QString::number(fontp->getChecksum()) + QLatin1Char(' ') + QString::number(kpsewhichResolution);
+}
+
+int GlyphCacheKey::cost(const glyph &g)
+{
+    return 1 + int(g.shrunkenCharacter.sizeInBytes() / 1024);
+}
+
 #ifdef PERFORMANCE_MEASUREMENT
 QTime fontPoolTimer;
 bool fontPoolTimerFlag;
 #endif
 
 fontPool::fontPool(bool useFontHinting)
+    : glyphCache(glyphCacheBudget)
 {
 #ifdef DEBUG_FONTPOOL
     qCDebug(OkularDviDebug) << "fontPool::fontPool() called";
@@ -44,6 +76,8 @@ fontPool::fontPool(bool useFontHinting)
     useFontHints = useFontHinting;
     CMperDVIunit = 0;
     extraSearchPath.clear();
+    fontLocationCacheRead = false;
+    fontLocationCacheChanged = false;
 
 #ifdef HAVE_FREETYPE
     // Initialize the Freetype Library
@@ -104,11 +138,13 @@ void fontPool::setParameters(bool _useFontHints)
 {
     // Check if glyphs need to be cleared
     if (_useFontHints != useFontHints) {
-        double displayResolution = displayResolution_in_dpi;
+        // the cached ones were rendered with the other hinting too
+        glyphCache.clear();
         QList<TeXFontDefinition *>::iterator it_fontp = fontList.begin();
         for (; it_fontp != fontList.end(); ++it_fontp) {
             TeXFontDefinition *fontp = *it_fontp;
-            fontp->setDisplayResolution(displayResolution * fontp->enlargement);
+            if (fontp->font != nullptr)
+                fontp->font->discardGlyphs();
         }
     }
 
@@ -173,14 +209,16 @@ bool fontPool::areFontsLocated()
 void fontPool::locateFonts()
 {
     kpsewhichOutput.clear();
+    readFontLocationCache();
 
     // First, we try and find those fonts which exist on disk
-    // already. If virtual fonts are found, they will add new fonts to
-    // the list of fonts whose font files need to be located, so that we
-    // repeat the lookup.
+    // already, the cache knows most of them. If virtual fonts are
+    // found, they will add new fonts to the list of fonts whose font
+    // files need to be located, so that we repeat the lookup.
     bool vffound;
     do {
         vffound = false;
+        locateCachedFonts(&vffound);
         locateFonts(false, false, &vffound);
     } while (vffound);
 
@@ -195,6 +233,8 @@ void fontPool::locateFonts()
     if (!areFontsLocated())
         locateFonts(false, true);
 
+    writeFontLocationCache();
+
     // If still not all fonts are found, we give up. We mark all fonts
     // as 'located', so that we won't look for them any more, and
     // present an error message to the user.
@@ -221,7 +261,7 @@ void fontPool::locateFonts(bool makePK, bool locateTFMonly, bool *virtualFontsFo
     // Now generate the command line for the kpsewhich
     // program. Unfortunately, this can be rather long and involved...
     QStringList kpsewhich_args;
-    kpsewhich_args << QStringLiteral("--dpi") << QStringLiteral("1200") << QStringLiteral("--mode") << QStringLiteral("lexmarks");
+    kpsewhich_args << QStringLiteral("--dpi") << QString::number(kpsewhichResolution) << QStringLiteral("--mode") << QStringLiteral("lexmarks");
 
     // Disable automatic pk-font generation.
     kpsewhich_args << QString::fromLocal8Bit(makePK ? "--mktex" : "--no-mktex") << QStringLiteral("pk");
@@ -244,7 +284,7 @@ void fontPool::locateFonts(bool makePK, bool locateTFMonly, bool *virtualFontsFo
                         kpsewhich_args << QStringLiteral("%1").arg(filename);
                 }
 #endif
-                kpsewhich_args << QStringLiteral("%1.vf").arg(fontp->fontname) << QStringLiteral("%1.1200pk").arg(fontp->fontname);
+                kpsewhich_args << QStringLiteral("%1.vf").arg(fontp->fontname) << QStringLiteral("%1.%2pk").arg(fontp->fontname).arg(kpsewhichResolution);
             }
         }
     }
@@ -324,6 +364,9 @@ void fontPool::locateFonts(bool makePK, bool locateTFMonly, bool *virtualFontsFo
                 QString fname = matchingFiles.first();
                 fontp->fontNameReceiver(fname);
                 fontp->flags |= TeXFontDefinition::FONT_KPSE_NAME;
+                // the TFM files are a last resort, the real font may be there next time
+                if (!locateTFMonly)
+                    cacheFontLocation(fontp);
                 if (fname.endsWith(QLatin1String(".vf"))) {
                     if (virtualFontsFound != nullptr)
                         *virtualFontsFound = true;
@@ -339,6 +382,104 @@ void fontPool::locateFonts(bool makePK, bool locateTFMonly, bool *virtualFontsFo
     delete kpsewhich_;
 }
 
+void fontPool::locateCachedFonts(bool *virtualFontsFound)
+{
+    QList<TeXFontDefinition *>::iterator it_fontp = fontList.begin();
+    for (; it_fontp != fontList.end(); ++it_fontp) {
+        TeXFontDefinition *fontp = *it_fontp;
+        if (fontp->isLocated() || !fontp->filename.isEmpty())
+            continue;
+
+        const QString key = fontLocationKey(fontp);
+        const auto cached = fontLocationCache.constFind(key);
+        if (cached == fontLocationCache.constEnd())
+            continue;
+
+        // the TeX tree changed since, kpsewhich looks again
+        const QFileInfo info(cached->fileName);
+        if (!info.exists() || info.lastModified().toMSecsSinceEpoch() != cached->lastModified) {
+            fontLocationCache.remove(key);
+            fontLocationCacheChanged = true;
+            continue;
+        }
+
+#ifdef DEBUG_FONTPOOL
+        qCDebug(OkularDviDebug) << "Associated " << fontp->fontname << " to cached " << cached->fileName;
+#endif
+        const QString fname = cached->fileName;
+        fontp->fontNameReceiver(fname);
+        fontp->flags |= TeXFontDefinition::FONT_KPSE_NAME;
+        if (fname.endsWith(QLatin1String(".vf"))) {
+            if (virtualFontsFound != nullptr)
+                *virtualFontsFound = true;
+            // As in locateFonts(bool, bool, bool *), the virtual font
+            // may have inserted other fonts into the fontList.
+            it_fontp = fontList.begin();
+            continue;
+        }
+    }
+}
+
+void fontPool::cacheFontLocation(const TeXFontDefinition *fontp)
+{
+    // a file name relative to the DVI file's directory is only good for that one
+    const QFileInfo info(fontp->filename);
+    if (!info.isAbsolute() || !info.exists())
+        return;
+
+    FontLocation location;
+    location.fileName = fontp->filename;
+    location.lastModified = info.lastModified().toMSecsSinceEpoch();
+    fontLocationCache.insert(fontLocationKey(fontp), location);
+    fontLocationCacheChanged = true;
+}
+
+void fontPool::readFontLocationCache()
+{
+    if (fontLocationCacheRead)
+        return;
+    fontLocationCacheRead = true;
+
+    QFile file(fontLocationCacheFileName());
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream stream(&file);
+    qint32 version;
+    quint32 count;
+    stream >> version >> count;
+    if (stream.status() != QDataStream::Ok || version != fontLocationCacheVersion)
+        return;
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString key;
+        FontLocation location;
+        stream >> key >> location.fileName >> location.lastModified;
+        if (stream.status() == QDataStream::Ok)
+            fontLocationCache.insert(key, location);
+    }
+}
+
+void fontPool::writeFontLocationCache()
+{
+    if (!fontLocationCacheChanged)
+        return;
+    fontLocationCacheChanged = false;
+
+    const QString fileName = fontLocationCacheFileName();
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream stream(&file);
+    stream << qint32(fontLocationCacheVersion) << quint32(fontLocationCache.count());
+    for (auto it = fontLocationCache.constBegin(); it != fontLocationCache.constEnd(); ++it)
+        stream << it.key() << it->fileName << it->lastModified;
+    if (!file.commit())
+        qCWarning(OkularDviDebug) << "Could not write the font location cache" << fileName;
+}
+
 void fontPool::setCMperDVIunit(double _CMperDVI)
 {
 #ifdef DEBUG_FONTPOOL
@@ -350,10 +491,14 @@ void fontPool::setCMperDVIunit(double _CMperDVI)
 
     CMperDVIunit = _CMperDVI;
 
+    // the size of the glyphs changes, at all resolutions
+    glyphCache.clear();
     QList<TeXFontDefinition *>::iterator it_fontp = fontList.begin();
     for (; it_fontp != fontList.end(); ++it_fontp) {
         TeXFontDefinition *fontp = *it_fontp;
         fontp->setDisplayResolution(displayResolution_in_dpi * fontp->enlargement);
+        if (fontp->font != nullptr)
+            fontp->font->discardGlyphs();
     }
 }
 
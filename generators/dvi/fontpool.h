@@ -11,6 +11,8 @@
 #include "fontEncodingPool.h"
 #include "fontMap.h"
 
+#include <QCache>
+#include <QHash>
 #include <QList>
 #include <QObject>
 #include <QProcess>
@@ -20,6 +22,37 @@
 #include FT_FREETYPE_H
 #endif
 
+class TeXFont;
+class glyph;
+
+/** Identifies a shrunken glyph of a font at a display resolution in the
+    glyph cache of the font pool. */
+struct GlyphCacheKey {
+    const TeXFont *font;
+    quint16 character;
+    int resolution;
+
+    // Resolutions closer than that share their glyphs, the difference
+    // is not visible
+    static int quantizedResolution(double resolution_in_dpi)
+    {
+        return qRound(resolution_in_dpi);
+    }
+
+    // In KiB, the unit of the budget of the glyph cache
+    static int cost(const glyph &g);
+};
+
+inline bool operator==(const GlyphCacheKey &a, const GlyphCacheKey &b)
+{
+    return a.font == b.font && a.character == b.character && a.resolution == b.resolution;
+}
+
+inline uint qHash(const GlyphCacheKey &key, uint seed = 0)
+{
+    return qHash(key.font, seed) ^ qHash((uint(key.resolution) << 16) | key.character, seed);
+}
+
 /**
  *  A list of fonts and a compilation of utility functions
  *
@@ -92,6 +125,12 @@ public:
     // This is the list which actually holds pointers to the fonts
     QList<TeXFontDefinition *> fontList;
 
+    /** Shrunken glyphs of all the fonts at the display resolutions they
+        are not shown at right now, so that going back to a zoom level
+        does not rasterize them again. The fonts keep the glyphs of the
+        current resolution themselves, see TeXFont::setDisplayResolution(). */
+    QCache<GlyphCacheKey, glyph> glyphCache;
+
     // This method marks all fonts in the fontpool as "not in use". The
     // fonts are, however, not removed from memory until the method
     // release_fonts is called. The method is called when the dvi-file
@@ -183,6 +222,31 @@ private:
     // virtual font is found, the variable remains untouched.
     void locateFonts(bool makePK, bool locateTFMonly, bool *virtualFontsFound = nullptr);
 
+    /** Members used for the cache of font locations */
+
+    // Gives the fonts not located yet the files the cache knows for
+    // them, if still there unchanged. Sets the bool pointed at by
+    // virtualFontsFound like locateFonts(bool, bool, bool *).
+    void locateCachedFonts(bool *virtualFontsFound);
+
+    // Remembers the file kpsewhich found for the font
+    void cacheFontLocation(const TeXFontDefinition *fontp);
+
+    void readFontLocationCache();
+    void writeFontLocationCache();
+
+    struct FontLocation {
+        QString fileName;
+        qint64 lastModified; // in msecs since the epoch
+    };
+
+    // The files kpsewhich found, shared by all the DVI files and kept on
+    // disk, so that it is only run for fonts not seen before. Keyed by
+    // font name, checksum and resolution, see fontLocationKey()
+    QHash<QString, FontLocation> fontLocationCache;
+    bool fontLocationCacheRead;
+    bool fontLocationCacheChanged;
+
     // This QString is used internally by the mf_output_receiver()
     // method.  This string is set to QString() in locateFonts(bool,
     // bool, bool *). Values are set and read by the
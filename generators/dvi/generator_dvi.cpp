@@ -46,6 +46,8 @@ DviGenerator::DviGenerator(QObject *parent, const QVariantList &args)
     , m_dviRenderer(nullptr)
 {
     setFeature(Threaded);
+    setFeature(ParallelRendering);
+    setFeature(SupportsCancelling);
     setFeature(TextExtraction);
     setFeature(FontInfo);
     setFeature(PrintPostscript);
@@ -181,6 +183,7 @@ QImage DviGenerator::image(Okular::PixmapRequest *request)
     pageInfo->height = request->height();
 
     pageInfo->pageNumber = request->pageNumber() + 1;
+    pageInfo->shouldAbort = [request] { return request->shouldAbortRender(); };
 
     //  pageInfo->resolution = m_resolution;
 
@@ -201,11 +204,7 @@ QImage DviGenerator::image(Okular::PixmapRequest *request)
 
         m_dviRenderer->drawPage(pageInfo);
 
-        if (!pageInfo->img.isNull()) {
-            qCDebug(OkularDviDebug) << "Image OK";
-
-            ret = pageInfo->img;
-
+        if (!pageInfo->picture.isNull() && !request->shouldAbortRender()) {
             if (!m_linkGenerated[request->pageNumber()]) {
                 request->page()->setObjectRects(generateDviLinks(pageInfo));
                 m_linkGenerated[request->pageNumber()] = true;
@@ -213,8 +212,32 @@ QImage DviGenerator::image(Okular::PixmapRequest *request)
         }
     }
 
+    // ghostscript is slow, show the page with placeholders for the
+    // figures first and let the other pages render meanwhile
+    if (m_dviRenderer && pageInfo->graphicsPending && !request->shouldAbortRender()) {
+        const ghostscript_interface::GraphicsJob job = m_dviRenderer->graphicsJob(pageInfo);
+        lock.unlock();
+
+        // the document and its observers are only touched in the main thread
+        // clang-format off
+        if (request->partialUpdatesWanted())
+            QMetaObject::invokeMethod(this, "signalPartialPixmapRequest", Qt::QueuedConnection, Q_ARG(Okular::PixmapRequest*, request), Q_ARG(QImage, pageInfo->image()));
+        // clang-format on
+        m_dviRenderer->renderGraphics(job);
+
+        lock.relock();
+        if (m_dviRenderer && !request->shouldAbortRender())
+            m_dviRenderer->drawPage(pageInfo);
+    }
+
     lock.unlock();
 
+    // the next page can be interpreted meanwhile
+    if (!pageInfo->picture.isNull() && !request->shouldAbortRender()) {
+        qCDebug(OkularDviDebug) << "Image OK";
+        ret = pageInfo->image();
+    }
+
     delete pageInfo;
 
     return ret;
@@ -254,19 +277,23 @@ Okular::TextPage *DviGenerator::textPage(Okular::TextRequest *request)
 
 Okular::TextPage *DviGenerator::extractTextFromPage(dviPageInfo *pageInfo)
 {
-    QList<Okular::TextEntity *> textOfThePage;
-
-    QVector<TextBox>::ConstIterator it = pageInfo->textBoxList.constBegin();
-    QVector<TextBox>::ConstIterator itEnd = pageInfo->textBoxList.constEnd();
+    // the text of all the boxes in one buffer, given to the text page at once
+    QString text;
+    QVector<int> lengths;
+    QVector<Okular::NormalizedRect> areas;
+    lengths.reserve(pageInfo->textBoxList.count());
+    areas.reserve(pageInfo->textBoxList.count());
 
     int pageWidth = pageInfo->width, pageHeight = pageInfo->height;
 
-    for (; it != itEnd; ++it) {
-        TextBox curTB = *it;
-        textOfThePage.push_back(new Okular::TextEntity(curTB.text, new Okular::NormalizedRect(curTB.box, pageWidth, pageHeight)));
+    for (const TextBox &curTB : qAsConst(pageInfo->textBoxList)) {
+        text += curTB.text;
+        lengths.append(curTB.text.length());
+        areas.append(Okular::NormalizedRect(curTB.box, pageWidth, pageHeight));
     }
 
-    Okular::TextPage *ktp = new Okular::TextPage(textOfThePage);
+    Okular::TextPage *ktp = new Okular::TextPage;
+    ktp->append(text, lengths, areas);
 
     return ktp;
 }
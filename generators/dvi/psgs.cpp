@@ -22,6 +22,7 @@
 
 #include <QDir>
 #include <QLoggingCategory>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QPixmap>
 #include <QTextStream>
@@ -46,7 +47,11 @@ pageInfo::~pageInfo()
 
 // ======================================================
 
+// Memory for the rendered graphics of the pages, in KiB
+static const int graphicsCacheBudget = 64 * 1024;
+
 ghostscript_interface::ghostscript_interface()
+    : graphicsCache(graphicsCacheBudget)
 {
     PostScriptHeaderString = new QString();
 
@@ -54,7 +59,6 @@ ghostscript_interface::ghostscript_interface()
     knownDevices.append(QStringLiteral("jpeg"));
     knownDevices.append(QStringLiteral("pnn"));
     knownDevices.append(QStringLiteral("pnnraw"));
-    gsDevice = knownDevices.begin();
 }
 
 ghostscript_interface::~ghostscript_interface()
@@ -144,29 +148,15 @@ void ghostscript_interface::clear()
     // Deletes all items, removes temporary files, etc.
     qDeleteAll(pageList);
     pageList.clear();
+    graphicsCache.clear();
 }
 
-void ghostscript_interface::gs_generate_graphics_file(const quint16 page, const QString &filename, long magnification)
+QString ghostscript_interface::pagePostScript(const quint16 page, long magnification) const
 {
-#ifdef DEBUG_PSGS
-    qCDebug(OkularDviDebug) << "ghostscript_interface::gs_generate_graphics_file( " << page << ", " << filename << " )";
-#endif
-
-    if (knownDevices.isEmpty()) {
-        qCCritical(OkularDviDebug) << "No known devices found" << endl;
-        return;
-    }
-
     pageInfo *info = pageList.value(page);
 
-    // Generate a PNG-file
-    // Step 1: Write the PostScriptString to a File
-    QTemporaryFile PSfile(QDir::tempPath() + QLatin1String("/okular_XXXXXX.ps"));
-    PSfile.setAutoRemove(false);
-    PSfile.open();
-    const QString PSfileName = PSfile.fileName();
-
-    QTextStream os(&PSfile);
+    QString postScript;
+    QTextStream os(&postScript);
     os << "%!PS-Adobe-2.0\n"
        << "%%Creator: kdvi\n"
        << "%%Title: KDVI temporary PostScript\n"
@@ -208,7 +198,28 @@ void ghostscript_interface::gs_generate_graphics_file(const quint16 page, const
 
     os << "end\n"
        << "showpage \n";
+    os.flush();
+
+    return postScript;
+}
 
+bool ghostscript_interface::gs_generate_graphics_file(const GraphicsJob &job, const QString &filename, const QString &device, bool *unknownDevice) const
+{
+#ifdef DEBUG_PSGS
+    qCDebug(OkularDviDebug) << "ghostscript_interface::gs_generate_graphics_file( " << job.key << ", " << filename << " )";
+#endif
+
+    *unknownDevice = false;
+
+    // Generate a PNG-file
+    // Step 1: Write the PostScriptString to a File
+    QTemporaryFile PSfile(QDir::tempPath() + QLatin1String("/okular_XXXXXX.ps"));
+    PSfile.setAutoRemove(false);
+    PSfile.open();
+    const QString PSfileName = PSfile.fileName();
+    QTextStream os(&PSfile);
+    os << job.postScript;
+    os.flush();
     PSfile.close();
 
     // Step 2: Call GS with the File
@@ -218,12 +229,12 @@ void ghostscript_interface::gs_generate_graphics_file(const quint16 page, const
     QStringList argus;
     argus << QStringLiteral("gs");
     argus << QStringLiteral("-dSAFER") << QStringLiteral("-dPARANOIDSAFER") << QStringLiteral("-dDELAYSAFER") << QStringLiteral("-dNOPAUSE") << QStringLiteral("-dBATCH");
-    argus << QStringLiteral("-sDEVICE=%1").arg(*gsDevice);
+    argus << QStringLiteral("-sDEVICE=%1").arg(device);
     argus << QStringLiteral("-sOutputFile=%1").arg(filename);
-    argus << QStringLiteral("-sExtraIncludePath=%1").arg(includePath);
-    argus << QStringLiteral("-g%1x%2").arg(pixel_page_w).arg(pixel_page_h); // page size in pixels
-    argus << QStringLiteral("-r%1").arg(resolution);                        // resolution in dpi
-    argus << QStringLiteral("-dTextAlphaBits=4 -dGraphicsAlphaBits=2");     // Antialiasing
+    argus << QStringLiteral("-sExtraIncludePath=%1").arg(job.includePath);
+    argus << QStringLiteral("-g%1x%2").arg(job.size.width()).arg(job.size.height()); // page size in pixels
+    argus << QStringLiteral("-r%1").arg(job.resolution);                             // resolution in dpi
+    argus << QStringLiteral("-dTextAlphaBits=4 -dGraphicsAlphaBits=2");              // Antialiasing
     argus << QStringLiteral("-c") << QStringLiteral("<< /PermitFileReading [ ExtraIncludePath ] /PermitFileWriting [] /PermitFileControl [] >> setuserparams .locksafe");
     argus << QStringLiteral("-f") << PSfileName;
 
@@ -247,36 +258,104 @@ void ghostscript_interface::gs_generate_graphics_file(const quint16 page, const
         qCCritical(OkularDviDebug) << "GS did not produce output." << endl;
 
         // No. Check is the reason is that the device is not compiled into
-        // ghostscript. If so, try again with another device.
+        // ghostscript.
         QString GSoutput;
         proc.setReadChannel(QProcess::StandardOutput);
         while (proc.canReadLine()) {
             GSoutput = QString::fromLocal8Bit(proc.readLine());
             if (GSoutput.contains(QStringLiteral("Unknown device"))) {
-                qCDebug(OkularDviDebug) << QString::fromLatin1(
-                                               "The version of ghostview installed on this computer does not support "
-                                               "the '%1' ghostview device driver.")
-                                               .arg(*gsDevice)
-                                        << endl;
-                knownDevices.erase(gsDevice);
-                gsDevice = knownDevices.begin();
-                if (knownDevices.isEmpty())
-                    // TODO: show a requestor of some sort.
-                    emit error(i18n("The version of Ghostview that is installed on this computer does not contain "
-                                    "any of the Ghostview device drivers that are known to Okular. PostScript "
-                                    "support has therefore been turned off in Okular."),
-                               -1);
-                else {
-                    qCDebug(OkularDviDebug) << QStringLiteral("Okular will now try to use the '%1' device driver.").arg(*gsDevice);
-                    gs_generate_graphics_file(page, filename, magnification);
-                }
-                return;
+                *unknownDevice = true;
+                break;
+            }
+        }
+        return false;
+    }
+    return true;
+}
+
+ghostscript_interface::GraphicsJob ghostscript_interface::graphicsJob(const quint16 page, double dpi, long magnification, const QSize &size)
+{
+    GraphicsJob job;
+    pageInfo *info = pageList.value(page);
+
+    // No PostScript? Then there is nothing to draw.
+    if ((info == nullptr) || (info->PostScriptString->isEmpty()))
+        return job;
+
+    resolution = dpi;
+    pixel_page_w = size.width();
+    pixel_page_h = size.height();
+
+    job.postScript = pagePostScript(page, magnification);
+    job.key = QStringLiteral("%1 %2 %3x%4 %5").arg(page).arg(dpi).arg(size.width()).arg(size.height()).arg(qHash(job.postScript));
+    job.includePath = includePath;
+    job.resolution = dpi;
+    job.size = size;
+    return job;
+}
+
+QImage ghostscript_interface::renderGraphics(const GraphicsJob &job)
+{
+    if (job.key.isEmpty())
+        return QImage();
+
+    QTemporaryFile gfxFile;
+    gfxFile.open();
+    const QString gfxFileName = gfxFile.fileName();
+    // We are want the filename, not the file.
+    gfxFile.close();
+
+    for (;;) {
+        QString device;
+        {
+            QMutexLocker locker(&devicesMutex);
+            if (knownDevices.isEmpty()) {
+                qCCritical(OkularDviDebug) << "No known devices found" << endl;
+                return QImage();
             }
+            device = knownDevices.first();
+        }
+
+        bool unknownDevice;
+        if (gs_generate_graphics_file(job, gfxFileName, device, &unknownDevice))
+            return QImage(gfxFileName);
+        if (!unknownDevice)
+            return QImage();
+
+        // If the device is not compiled into ghostscript, try again with
+        // another one.
+        qCDebug(OkularDviDebug) << QString::fromLatin1(
+                                       "The version of ghostview installed on this computer does not support "
+                                       "the '%1' ghostview device driver.")
+                                       .arg(device)
+                                << endl;
+        QMutexLocker locker(&devicesMutex);
+        // another page found out already
+        if (!knownDevices.removeOne(device))
+            continue;
+        if (knownDevices.isEmpty()) {
+            // TODO: show a requestor of some sort.
+            emit error(i18n("The version of Ghostview that is installed on this computer does not contain "
+                            "any of the Ghostview device drivers that are known to Okular. PostScript "
+                            "support has therefore been turned off in Okular."),
+                       -1);
+            return QImage();
         }
+        qCDebug(OkularDviDebug) << QStringLiteral("Okular will now try to use the '%1' device driver.").arg(knownDevices.first());
     }
 }
 
-void ghostscript_interface::graphics(const quint16 page, double dpi, long magnification, QPainter *paint)
+void ghostscript_interface::setGraphics(const GraphicsJob &job, const QImage &image)
+{
+    if (job.key.isEmpty())
+        return;
+
+    // a failed rendering is kept too, so that it is not retried for every
+    // redraw of the page
+    graphicsCache.insert(job.key, new QImage(image), 1 + int(image.sizeInBytes() / 1024));
+}
+
+bool ghostscript_interface::graphics(const quint16 page, double dpi, long magnification, QPainter *paint)
 {
 #ifdef DEBUG_PSGS
     qCDebug(OkularDviDebug) << "ghostscript_interface::graphics( " << page << ", " << dpi << ", ... ) called.";
@@ -284,35 +363,25 @@ void ghostscript_interface::graphics(const quint16 page, double dpi, long magnif
 
     if (paint == nullptr) {
         qCCritical(OkularDviDebug) << "ghostscript_interface::graphics(PageNumber page, double dpi, long magnification, QPainter *paint) called with paint == 0" << endl;
-        return;
+        return true;
     }
 
-    resolution = dpi;
-
-    pixel_page_w = paint->viewport().width();
-    pixel_page_h = paint->viewport().height();
-
-    pageInfo *info = pageList.value(page);
+    const GraphicsJob job = graphicsJob(page, dpi, magnification, paint->viewport().size());
 
     // No PostScript? Then return immediately.
-    if ((info == nullptr) || (info->PostScriptString->isEmpty())) {
+    if (job.key.isEmpty()) {
 #ifdef DEBUG_PSGS
         qCDebug(OkularDviDebug) << "No PostScript found. Not drawing anything.";
 #endif
-        return;
+        return true;
     }
 
-    QTemporaryFile gfxFile;
-    gfxFile.open();
-    const QString gfxFileName = gfxFile.fileName();
-    // We are want the filename, not the file.
-    gfxFile.close();
-
-    gs_generate_graphics_file(page, gfxFileName, magnification);
+    const QImage *image = graphicsCache.object(job.key);
+    if (image == nullptr)
+        return false;
 
-    QImage MemoryCopy(gfxFileName);
-    paint->drawImage(0, 0, MemoryCopy);
-    return;
+    paint->drawImage(0, 0, *image);
+    return true;
 }
 
 QString ghostscript_interface::locateEPSfile(const QString &filename, const QUrl &base)
@@ -11,10 +11,14 @@
 #define _PSGS_H_
 
 #include <QApplication>
+#include <QCache>
 #include <QColor>
 #include <QEvent>
 #include <QHash>
+#include <QImage>
+#include <QMutex>
 #include <QObject>
+#include <QSize>
 
 class QUrl;
 class PageNumber;
@@ -60,9 +64,35 @@ public:
     // With option permanent = true.
     void restoreBackgroundColor(const quint16 page);
 
-    // Draws the graphics of the page into the painter, if possible. If
-    // the page does not contain any graphics, nothing happens
-    void graphics(const quint16 page, double dpi, long magnification, QPainter *paint);
+    // What ghostscript needs to render the graphics of a page. The key
+    // is empty if the page has no graphics.
+    struct GraphicsJob {
+        QString key;
+        QString postScript;
+        QString includePath;
+        double resolution = 0;
+        QSize size;
+    };
+
+    // Draws the graphics of the page into the painter, if they were
+    // rendered already, at the size of the viewport of the painter.
+    // Returns false if they were not, the page then needs a
+    // graphicsJob() to be run by renderGraphics(). If the page does not
+    // contain any graphics, nothing happens and true is returned.
+    bool graphics(const quint16 page, double dpi, long magnification, QPainter *paint);
+
+    // Collects what is needed to render the graphics of the page at the
+    // given size in pixels.
+    GraphicsJob graphicsJob(const quint16 page, double dpi, long magnification, const QSize &size);
+
+    // Runs ghostscript for the job and returns the graphics, or a null
+    // image if that failed. Blocks until ghostscript is done, but needs
+    // nothing but the job: it may be called from any thread, without
+    // holding the renderer, and for several pages at the same time.
+    QImage renderGraphics(const GraphicsJob &job);
+
+    // Keeps the result of renderGraphics() for graphics().
+    void setGraphics(const GraphicsJob &job, const QImage &image);
 
     // Returns the background color for a certain page. If no color was
     // set, Qt::white is returned.
@@ -80,27 +110,28 @@ public:
     static QString locateEPSfile(const QString &filename, const QUrl &base);
 
 private:
-    void gs_generate_graphics_file(const quint16 page, const QString &filename, long magnification);
+    QString pagePostScript(const quint16 page, long magnification) const;
+    bool gs_generate_graphics_file(const GraphicsJob &job, const QString &filename, const QString &device, bool *unknownDevice) const;
     QHash<quint16, pageInfo *> pageList;
 
+    // Rendered graphics by GraphicsJob::key, failed renderings are null
+    QCache<QString, QImage> graphicsCache;
+
     double resolution; // in dots per inch
     int pixel_page_w;  // in pixels
     int pixel_page_h;  // in pixels
 
     QString includePath;
 
-    // Output device that ghostscript is supposed tp use. Default is
-    // "png256". If that does not work, gs_generate_graphics_file will
-    // automatically try other known device drivers. If no known output
-    // device can be found, something is badly wrong. In that case,
-    // "gsDevice" is set to an empty string, and
-    // gs_generate_graphics_file will return immediately.
-    QList<QString>::iterator gsDevice;
-
     // A list of known devices, set by the constructor. This includes
-    // "png256", "pnm". If a device is found to not work, its name is
-    // removed from the list, and another device name is tried.
+    // "png256", "pnm". The first one is the output device that
+    // ghostscript is supposed to use. If a device is found to not work,
+    // its name is removed from the list, and renderGraphics() tries the
+    // next one. If the list gets empty, something is badly wrong and
+    // renderGraphics() returns immediately.
     QStringList knownDevices;
+    // renderGraphics() runs in the render threads
+    QMutex devicesMutex;
 
 Q_SIGNALS:
     /** Passed through to the top-level kpart. */
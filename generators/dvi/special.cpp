@@ -381,7 +381,7 @@ void dviRenderer::epsf_special(const QString &cp)
         return;
     }
 
-    if (!_postscript || !QFile::exists(EPSfilename)) {
+    if (!_postscript || currentlyDrawnPage->graphicsPending || !QFile::exists(EPSfilename)) {
         // Don't show PostScript, just draw the bounding box. For this,
         // calculate the size of the bounding box in Pixels.
         double bbox_width = urx - llx;
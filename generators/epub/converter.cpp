@@ -131,6 +131,24 @@ void Converter::_insert_local_links(const QString &key, const QPair<int, int> va
     }
 }
 
+// the blocks after it start on a new page, without laying out the document
+// to find out where the current one ends
+void Converter::_startNewPage(QTextCursor *cursor)
+{
+    QTextBlockFormat pageBreak;
+    pageBreak.setPageBreakPolicy(QTextFormat::PageBreak_AlwaysAfter);
+    cursor->insertBlock(pageBreak);
+    cursor->insertBlock(QTextBlockFormat());
+}
+
+Okular::DocumentViewport Converter::sectionViewport(const QString &name)
+{
+    const QTextBlock block = mSectionMap.value(name);
+    if (!mTextDocument || !block.isValid())
+        return Okular::DocumentViewport();
+    return calculateViewport(mTextDocument, block);
+}
+
 static QPoint calculateXYPosition(QTextDocument *document, int startPosition)
 {
     const QTextBlock startBlock = document->findBlock(startPosition);
@@ -229,16 +247,17 @@ QTextDocument *Converter::convert(const QString &fileName)
                         QString lnk = images.at(i).toElement().attribute(QStringLiteral("xlink:href"));
                         int ht = images.at(i).toElement().attribute(QStringLiteral("height")).toInt();
                         int wd = images.at(i).toElement().attribute(QStringLiteral("width")).toInt();
-                        QImage img = mTextDocument->loadResource(QTextDocument::ImageResource, QUrl(lnk)).value<QImage>();
-                        if (ht == 0)
-                            ht = img.height();
-                        if (wd == 0)
-                            wd = img.width();
+                        if (ht == 0 || wd == 0) {
+                            const QSize size = mTextDocument->imageSize(QUrl(lnk));
+                            if (ht == 0)
+                                ht = size.height();
+                            if (wd == 0)
+                                wd = size.width();
+                        }
                         if (ht > maxHeight)
                             ht = maxHeight;
                         if (wd > maxWidth)
                             wd = maxWidth;
-                        mTextDocument->addResource(QTextDocument::ImageResource, QUrl(lnk), img);
                         QDomDocument newDoc;
                         newDoc.setContent(QStringLiteral("<img src=\"%1\" height=\"%2\" width=\"%3\" />").arg(lnk).arg(ht).arg(wd));
                         imgNodes.append(newDoc.documentElement());
@@ -249,6 +268,21 @@ QTextDocument *Converter::convert(const QString &fileName)
                 }
             }
 
+            // images with their size known are laid out without loading
+            // them, they are decoded when their page is painted
+            QDomNodeList imgs = dom.elementsByTagName(QStringLiteral("img"));
+            for (int i = 0; i < imgs.length(); ++i) {
+                QDomElement img = imgs.at(i).toElement();
+                mTextDocument->addImage(QUrl(img.attribute(QStringLiteral("src"))));
+                if (img.hasAttribute(QStringLiteral("width")) || img.hasAttribute(QStringLiteral("height")))
+                    continue;
+                const QSize size = mTextDocument->imageSize(QUrl(img.attribute(QStringLiteral("src"))));
+                if (size.isValid()) {
+                    img.setAttribute(QStringLiteral("width"), size.width());
+                    img.setAttribute(QStringLiteral("height"), size.height());
+                }
+            }
+
             // handle embedded videos
             QDomNodeList videoTags = dom.elementsByTagName(QStringLiteral("video"));
             while (!videoTags.isEmpty()) {
@@ -340,14 +374,9 @@ QTextDocument *Converter::convert(const QString &fileName)
 
         _handle_anchors(before, link);
 
-        const int page = mTextDocument->pageCount();
-
         // it will clear the previous format
         // useful when the last line had a bullet
-        _cursor->insertBlock(QTextBlockFormat());
-
-        while (mTextDocument->pageCount() == page)
-            _cursor->insertText(QStringLiteral("\n"));
+        _startNewPage(_cursor);
 
     } while (epub_it_get_next(it));
 
@@ -395,9 +424,7 @@ QTextDocument *Converter::convert(const QString &fileName)
                         }
 
                         // Start new file in a new page
-                        int page = mTextDocument->pageCount();
-                        while (mTextDocument->pageCount() == page)
-                            _cursor->insertText(QStringLiteral("\n"));
+                        _startNewPage(_cursor);
                     }
 
                     free(data);
@@ -430,9 +457,8 @@ QTextDocument *Converter::convert(const QString &fileName)
 
         for (int i = 0; i < hit.value().size(); ++i) {
             if (block.isValid()) { // be sure we actually got a block
-                Okular::DocumentViewport viewport = calculateViewport(mTextDocument, block);
-
-                Okular::GotoAction *action = new Okular::GotoAction(QString(), viewport);
+                // resolved when followed, see sectionViewport(), the document is not laid out yet
+                Okular::GotoAction *action = new Okular::GotoAction(QString(), hit.key());
 
                 emit addAction(action, hit.value()[i].first, hit.value()[i].second);
             } else {
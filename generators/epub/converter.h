@@ -25,7 +25,11 @@ public:
 
     QTextDocument *convert(const QString &fileName) override;
 
+    // where the local links to @p name go
+    Okular::DocumentViewport sectionViewport(const QString &name);
+
 private:
+    void _startNewPage(QTextCursor *cursor);
     void _emitData(Okular::DocumentInfo::Key key, enum epub_metadata type);
     void _handle_anchors(const QTextBlock &start, const QString &name);
     void _insert_local_links(const QString &key, const QPair<int, int> value);
@@ -5,11 +5,11 @@
 */
 
 #include "epubdocument.h"
+#include <QBuffer>
 #include <QDir>
+#include <QImageReader>
 #include <QTemporaryFile>
 
-#include <QRegularExpression>
-
 Q_LOGGING_CATEGORY(OkularEpuDebug, "org.kde.okular.generators.epu", QtWarningMsg)
 using namespace Epub;
 
@@ -60,32 +60,154 @@ int EpubDocument::maxContentWidth() const
     return pageSize().width() - (2 * padding);
 }
 
-QString EpubDocument::checkCSS(const QString &c)
-{
-    QString css = c;
-    // remove paragraph line-heights
-    css.remove(QRegularExpression(QStringLiteral("line-height\\s*:\\s*[\\w\\.]*;")));
-
-    // HACK transform em and rem notation to px, because QTextDocument doesn't support
-    // em and rem.
-    const QStringList cssArray = css.split(QRegularExpression(QStringLiteral("\\s+")));
-    QStringList cssArrayReplaced;
-    std::size_t cssArrayCount = cssArray.count();
-    std::size_t i = 0;
-    const QRegularExpression re(QStringLiteral("(([0-9]+)(\\.[0-9]+)?)r?em(.*)"));
-    while (i < cssArrayCount) {
-        auto item = cssArray[i];
-        QRegularExpressionMatch match = re.match(item);
-        if (match.hasMatch()) {
-            double em = match.captured(1).toDouble();
-            double px = em * mFont.pointSize();
-            cssArrayReplaced.append(QStringLiteral("%1px%2").arg(px).arg(match.captured(4)));
-        } else {
-            cssArrayReplaced.append(item);
+QSize EpubDocument::fittingSize(const QSize &size) const
+{
+    // the way loadResource() scales the images down
+    QSize result = size;
+    const int maxHeight = maxContentHeight();
+    const int maxWidth = maxContentWidth();
+    if (result.height() > maxHeight)
+        result = QSize(qMax(1, qRound(qreal(result.width()) * maxHeight / result.height())), maxHeight);
+    if (result.width() > maxWidth)
+        result = QSize(maxWidth, qMax(1, qRound(qreal(result.height()) * maxWidth / result.width())));
+    return result;
+}
+
+// the size the image will have once loaded, from the header of the image
+// only so it can be laid out without decoding it
+QSize EpubDocument::imageSize(const QUrl &name)
+{
+    const QString fileInPath = mCurrentSubDocument.resolved(name).path();
+
+    char *data = nullptr;
+    const int size = epub_get_data(mEpub, fileInPath.toUtf8().constData(), &data);
+    if (!data)
+        return QSize();
+
+    QByteArray bytes = QByteArray::fromRawData(data, size);
+    QBuffer buffer(&bytes);
+    QImageReader reader(&buffer);
+    const QSize imageSize = reader.size();
+    free(data);
+
+    return imageSize.isValid() ? fittingSize(imageSize) : QSize();
+}
+
+// remembers the current chapter as the one of the image @p name, which is
+// only loaded when its page is painted; like the resources, the first image
+// of a name is the one kept
+void EpubDocument::addImage(const QUrl &name)
+{
+    if (!mImageChapters.contains(name))
+        mImageChapters.insert(name, mCurrentSubDocument);
+}
+
+static bool isWordChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_');
+}
+
+static bool isNameChar(QChar c)
+{
+    return isWordChar(c) || c == QLatin1Char('-');
+}
+
+// whether the character at @p i of @p css goes on with a name, e.g. the 1 of "h1"
+// but not the one of "-1", where the '-' is a sign
+static bool continuesName(const QString &css, int i)
+{
+    if (i == 0)
+        return false;
+    const QChar previous = css.at(i - 1);
+    if (previous == QLatin1Char('-'))
+        return i >= 2 && isNameChar(css.at(i - 2));
+    return isNameChar(previous) || previous == QLatin1Char('.');
+}
+
+// the end of the "line-height: <word>;" declaration at @p i, or -1 if there is none
+static int lineHeightEnd(const QString &css, int i)
+{
+    static const QLatin1String lineHeight("line-height");
+    if (!css.midRef(i, lineHeight.size()).startsWith(lineHeight))
+        return -1;
+
+    const int n = css.size();
+    i += lineHeight.size();
+    while (i < n && css.at(i).isSpace())
+        ++i;
+    if (i >= n || css.at(i) != QLatin1Char(':'))
+        return -1;
+    ++i;
+    while (i < n && css.at(i).isSpace())
+        ++i;
+    while (i < n && (isWordChar(css.at(i)) || css.at(i) == QLatin1Char('.')))
+        ++i;
+    return i < n && css.at(i) == QLatin1Char(';') ? i + 1 : -1;
+}
+
+QString EpubDocument::checkCSS(const QString &css)
+{
+    // one pass that removes the paragraph line-heights, collapses the runs of
+    // white space and, as a HACK because QTextDocument doesn't support em and
+    // rem, turns them into px
+    QString result;
+    result.reserve(css.size());
+    const int n = css.size();
+    bool space = false;
+    int i = 0;
+    while (i < n) {
+        const QChar c = css.at(i);
+        if (c.isSpace()) {
+            space = true;
+            ++i;
+            continue;
         }
-        i++;
+
+        if (c == QLatin1Char('l')) {
+            const int end = lineHeightEnd(css, i);
+            if (end != -1) {
+                i = end;
+                continue;
+            }
+        }
+
+        if (space) {
+            result += QLatin1Char(' ');
+            space = false;
+        }
+
+        // a number, not a part of a name, followed by a em or rem unit
+        const bool startsNumber = c.isDigit() || (c == QLatin1Char('.') && i + 1 < n && css.at(i + 1).isDigit());
+        if (startsNumber && !continuesName(css, i)) {
+            int end = i;
+            while (end < n && css.at(end).isDigit())
+                ++end;
+            if (end + 1 < n && css.at(end) == QLatin1Char('.') && css.at(end + 1).isDigit()) {
+                for (++end; end < n && css.at(end).isDigit();)
+                    ++end;
+            }
+
+            int unitEnd = end;
+            if (unitEnd < n && css.at(unitEnd) == QLatin1Char('r'))
+                ++unitEnd;
+            if (css.midRef(unitEnd, 2) == QLatin1String("em") && (unitEnd + 2 >= n || !isNameChar(css.at(unitEnd + 2)))) {
+                const double em = css.midRef(i, end - i).toDouble();
+                result += QString::number(em * mFont.pointSize()) + QLatin1String("px");
+                i = unitEnd + 2;
+            } else {
+                result += css.midRef(i, end - i);
+                i = end;
+            }
+            continue;
+        }
+
+        result += c;
+        ++i;
     }
-    return cssArrayReplaced.join(QStringLiteral(" "));
+    if (space)
+        result += QLatin1Char(' ');
+
+    return result;
 }
 
 QVariant EpubDocument::loadResource(int type, const QUrl &name)
@@ -93,7 +215,19 @@ QVariant EpubDocument::loadResource(int type, const QUrl &name)
     int size;
     char *data;
 
-    QString fileInPath = mCurrentSubDocument.resolved(name).path();
+    // the images are loaded after the chapters, relative to their own
+    const auto imageChapter = type == QTextDocument::ImageResource ? mImageChapters.constFind(name) : mImageChapters.constEnd();
+    QString fileInPath = (imageChapter != mImageChapters.constEnd() ? *imageChapter : mCurrentSubDocument).resolved(name).path();
+
+    // the chapters share their stylesheets, get and rewrite each only once
+    const QPair<QString, int> styleSheetKey(fileInPath, mFont.pointSize());
+    if (type == QTextDocument::StyleSheetResource) {
+        const auto it = mStyleSheets.constFind(styleSheetKey);
+        if (it != mStyleSheets.constEnd()) {
+            addResource(type, name, *it);
+            return *it;
+        }
+    }
 
     // Get the data from the epub file
     size = epub_get_data(mEpub, fileInPath.toUtf8().constData(), &data);
@@ -114,8 +248,9 @@ QVariant EpubDocument::loadResource(int type, const QUrl &name)
             break;
         }
         case QTextDocument::StyleSheetResource: {
-            QString css = QString::fromUtf8(data);
-            resource.setValue(checkCSS(css));
+            const QString css = checkCSS(QString::fromUtf8(data));
+            mStyleSheets.insert(styleSheetKey, css);
+            resource.setValue(css);
             break;
         }
         case EpubDocument::MovieResource: {
@@ -7,8 +7,10 @@
 #ifndef EPUB_DOCUMENT_H
 #define EPUB_DOCUMENT_H
 
+#include <QHash>
 #include <QImage>
 #include <QLoggingCategory>
+#include <QPair>
 #include <QTextDocument>
 #include <QUrl>
 #include <QVariant>
@@ -28,6 +30,8 @@ public:
     void setCurrentSubDocument(const QString &doc);
     int maxContentHeight() const;
     int maxContentWidth() const;
+    QSize imageSize(const QUrl &name);
+    void addImage(const QUrl &name);
     enum Multimedia { MovieResource = QTextDocument::UserResource, AudioResource };
 
 protected:
@@ -35,12 +39,17 @@ protected:
 
 private:
     QString checkCSS(const QString &css);
+    QSize fittingSize(const QSize &size) const;
 
     struct epub *mEpub;
     QUrl mCurrentSubDocument;
 
     int padding;
     QFont mFont;
+    // the stylesheets checkCSS() rewrote, by their path in the file and font size
+    QHash<QPair<QString, int>, QString> mStyleSheets;
+    // the chapter of the images, they are loaded once all the chapters are in
+    QHash<QUrl, QUrl> mImageChapters;
 
     friend class Converter;
 };
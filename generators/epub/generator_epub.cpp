@@ -12,6 +12,8 @@
 #include <KConfigDialog>
 #include <KLocalizedString>
 
+#include <QMutexLocker>
+
 OKULAR_EXPORT_PLUGIN(EPubGenerator, "libokularGenerator_epub.json")
 
 EPubGenerator::EPubGenerator(QObject *parent, const QVariantList &args)
@@ -30,4 +32,18 @@ void EPubGenerator::addPages(KConfigDialog *dlg)
     dlg->addPage(widget, generalSettings(), i18n("EPub"), QStringLiteral("application-epub+zip"), i18n("EPub Backend Configuration"));
 }
 
+QVariant EPubGenerator::metaData(const QString &key, const QVariant &option) const
+{
+    if (key == QLatin1String("NamedViewport") && !option.toString().isEmpty()) {
+        // the layout is shared with the rendering threads
+        QMutexLocker locker(userMutex());
+        const Okular::DocumentViewport viewport = static_cast<Epub::Converter *>(const_cast<EPubGenerator *>(this)->converter())->sectionViewport(option.toString());
+        if (viewport.isValid())
+            return viewport.toString();
+        return QVariant();
+    }
+
+    return Okular::TextDocumentGenerator::metaData(key, option);
+}
+
 #include "generator_epub.moc"
@@ -18,6 +18,8 @@ public:
 
     // [INHERITED] reparse configuration
     void addPages(KConfigDialog *dlg) override;
+
+    QVariant metaData(const QString &key, const QVariant &option) const override;
 };
 
 #endif
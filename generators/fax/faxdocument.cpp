@@ -6,6 +6,7 @@
 #include "faxdocument.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <QFile>
 
@@ -51,13 +52,17 @@ static void normalize(pagenode *pn, int revbits, int swapbytes, size_t length)
 static bool new_image(pagenode *pn, int width, int height)
 {
     pn->image = QImage(width, height, QImage::Format_MonoLSB);
+    if (pn->image.isNull())
+        return false;
+
     pn->image.setColor(0, qRgb(255, 255, 255));
     pn->image.setColor(1, qRgb(0, 0, 0));
+    pn->image.fill(0);
     pn->bytes_per_line = pn->image.bytesPerLine();
     pn->dpi = FAX_DPI_FINE;
-    pn->imageData = new uchar[width * height];
+    pn->imageData = pn->image.bits();
 
-    return !pn->image.isNull();
+    return true;
 }
 
 /* get compressed data into memory */
@@ -86,14 +91,11 @@ static unsigned char *getstrip(pagenode *pn, int strip)
     } else
         return nullptr;
 
-    /* round size to full boundary plus t32bits */
-    roundup = (pn->length + 7) & ~3;
+    /* round size to full boundary plus 2 t32bits, the expanders read up
+       to a word of 32 bits past the end */
+    roundup = (pn->length + 11) & ~3;
 
     data = new uchar[roundup];
-    /* clear the last 2 t32bits, to force the expander to terminate
-       even if the file ends in the middle of a fax line  */
-    *(reinterpret_cast<t32bits *>(data + roundup / 4 - 2)) = 0;
-    *(reinterpret_cast<t32bits *>(data + roundup / 4 - 1)) = 0;
 
     /* we expect to get it in one gulp... */
     if (!file.seek(offset) || (size_t)file.read((char *)data, pn->length) != pn->length) {
@@ -102,6 +104,10 @@ static unsigned char *getstrip(pagenode *pn, int strip)
     }
     file.close();
 
+    /* clear what is past the end, to force the expander to terminate
+       even if the file ends in the middle of a fax line  */
+    memset(data + pn->length, 0, roundup - pn->length);
+
     pn->data = reinterpret_cast<t16bits *>(data);
 
     if (pn->strips == nullptr && memcmp(data, FAXMAGIC, sizeof(FAXMAGIC) - 1) == 0) {
@@ -130,78 +136,48 @@ static unsigned char *getstrip(pagenode *pn, int strip)
     return data;
 }
 
-static void draw_line(pixnum *run, int lineNum, pagenode *pn)
+/* sets the n pixels of line from x on to black, in MonoLSB order */
+static void fill_black(uchar *line, int x, int n)
 {
-    t32bits *p, *p1; /* p - current line, p1 - low-res duplicate */
-    pixnum *r;       /* pointer to run-lengths */
-    t32bits pix;     /* current pixel value */
-    t32bits acc;     /* pixel accumulator */
-    int nacc;        /* number of valid bits in acc */
-    int tot;         /* total pixels in line */
-    int n;
+    const int first = x >> 3;
+    const int last = (x + n - 1) >> 3;
+    const uchar firstMask = 0xff << (x & 7);
+    const uchar lastMask = 0xff >> (7 - ((x + n - 1) & 7));
+    if (first == last) {
+        line[first] |= firstMask & lastMask;
+        return;
+    }
+    line[first] |= firstMask;
+    memset(line + first + 1, 0xff, last - first - 1);
+    line[last] |= lastMask;
+}
 
+static void draw_line(pixnum *run, int lineNum, pagenode *pn)
+{
     lineNum += pn->stripnum * pn->rowsperstrip;
     if (lineNum >= pn->size.height())
         return;
 
-    p = reinterpret_cast<t32bits *>(pn->imageData + lineNum * (2 - pn->vres) * pn->bytes_per_line);
-    p1 = reinterpret_cast<t32bits *>(pn->vres ? nullptr : p + pn->bytes_per_line / sizeof(*p));
-
-    r = run;
-    acc = 0;
-    nacc = 0;
-    pix = pn->inverse ? ~0 : 0;
-    tot = 0;
-    while (tot < pn->size.width()) {
-        n = *r++;
-        tot += n;
+    /* low resolution lines are drawn twice */
+    const int rows = 2 - pn->vres;
+    uchar *line = pn->imageData + lineNum * rows * pn->bytes_per_line;
+
+    const int width = pn->size.width();
+    bool black = pn->inverse;
+    int x = 0;
+    while (x < width) {
+        const int n = *run++;
         /* Watch out for buffer overruns, e.g. when n == 65535.  */
-        if (tot > pn->size.width())
+        if (x + n > width)
             break;
-        if (pix)
-            acc |= (~(t32bits)0 >> nacc);
-        else if (nacc)
-            acc &= (~(t32bits)0 << (32 - nacc));
-        else
-            acc = 0;
-        if (nacc + n < 32) {
-            nacc += n;
-            pix = ~pix;
-            continue;
-        }
-        *p++ = acc;
-        if (p1)
-            *p1++ = acc;
-        n -= 32 - nacc;
-        while (n >= 32) {
-            n -= 32;
-            *p++ = pix;
-            if (p1)
-                *p1++ = pix;
-        }
-        acc = pix;
-        nacc = n;
-        pix = ~pix;
+        if (black && n)
+            fill_black(line, x, n);
+        x += n;
+        black = !black;
     }
-    if (nacc) {
-        *p++ = acc;
-        if (p1)
-            *p1++ = acc;
-    }
-}
-
-static bool get_image(pagenode *pn)
-{
-    unsigned char *data = getstrip(pn, 0);
-    if (!data)
-        return false;
-
-    if (!new_image(pn, pn->size.width(), (pn->vres ? 1 : 2) * pn->size.height()))
-        return false;
-
-    (*pn->expander)(pn, draw_line);
 
-    return true;
+    if (rows == 2)
+        memcpy(line + pn->bytes_per_line, line, pn->bytes_per_line);
 }
 
 class FaxDocument::Private
@@ -209,6 +185,7 @@ class FaxDocument::Private
 public:
     explicit Private(FaxDocument *parent)
         : mParent(parent)
+        , mDecoded(false)
     {
         mPageNode.size = QSize(1728, 0);
     }
@@ -216,6 +193,7 @@ public:
     FaxDocument *mParent;
     pagenode mPageNode;
     FaxDocument::DocumentType mType;
+    bool mDecoded;
 };
 
 FaxDocument::FaxDocument(const QString &fileName, DocumentType type)
@@ -241,7 +219,6 @@ FaxDocument::FaxDocument(const QString &fileName, DocumentType type)
 FaxDocument::~FaxDocument()
 {
     delete[] d->mPageNode.dataOrig;
-    delete[] d->mPageNode.imageData;
     delete d;
 }
 
@@ -249,43 +226,35 @@ bool FaxDocument::load()
 {
     fax_init_tables();
 
-    bool ok = get_image(&(d->mPageNode));
-    if (!ok)
-        return false;
+    // only reads the data and counts the lines, image() expands them
+    return getstrip(&(d->mPageNode), 0) != nullptr;
+}
 
-    // byte-swapping the image
-    int height = d->mPageNode.size.height();
-    int bytes_per_line = d->mPageNode.size.width() / 8;
-
-    QByteArray bytes(height * bytes_per_line, 0);
-    for (int y = height - 1; y >= 0; --y) {
-        quint32 offset = y * bytes_per_line;
-        quint32 *source = reinterpret_cast<quint32 *>(d->mPageNode.imageData + offset);
-        quint32 *dest = reinterpret_cast<quint32 *>(bytes.data() + offset);
-        for (int x = (bytes_per_line / 4) - 1; x >= 0; --x) {
-            quint32 dv = 0, sv = *source;
-            for (int bit = 32; bit > 0; --bit) {
-                dv <<= 1;
-                dv |= sv & 1;
-                sv >>= 1;
-            }
-            *dest = dv;
-            ++dest;
-            ++source;
-        }
-    }
+QSize FaxDocument::size() const
+{
+    return QSize(d->mPageNode.size.width(), int(d->mPageNode.size.height() * 1.5));
+}
 
-    // convert it into a QImage
-    QImage img((uchar *)bytes.data(), d->mPageNode.size.width(), d->mPageNode.size.height(), QImage::Format_MonoLSB);
-    img.setColor(0, qRgb(255, 255, 255));
-    img.setColor(1, qRgb(0, 0, 0));
+QImage FaxDocument::image()
+{
+    if (d->mDecoded)
+        return d->mPageNode.image;
+    d->mDecoded = true;
 
-    d->mPageNode.image = img.copy().scaled(img.width(), img.height() * 1.5);
+    pagenode *pn = &(d->mPageNode);
+    if (!pn->data || !new_image(pn, pn->size.width(), (pn->vres ? 1 : 2) * pn->size.height()))
+        return QImage();
 
-    return true;
-}
+    (*pn->expander)(pn, draw_line);
 
-QImage FaxDocument::image() const
-{
-    return d->mPageNode.image;
+    // the expanded lines are in the image already, the compressed data is no longer needed
+    delete[] pn->dataOrig;
+    pn->dataOrig = nullptr;
+    pn->data = nullptr;
+    pn->imageData = nullptr;
+
+    const QImage img = pn->image.copy(0, 0, pn->size.width(), pn->size.height());
+    pn->image = img.scaled(img.width(), img.height() * 1.5);
+
+    return pn->image;
 }
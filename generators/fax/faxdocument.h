@@ -40,16 +40,21 @@ public:
     FaxDocument &operator=(const FaxDocument &) = delete;
 
     /**
-     * Loads the document.
+     * Loads the document, without expanding it yet.
      *
      * @return @c true if the document can be loaded successfully, @c false otherwise.
      */
     bool load();
 
     /**
-     * Returns the document as an image.
+     * Returns the size of the image of the document, known once it is loaded.
      */
-    QImage image() const;
+    QSize size() const;
+
+    /**
+     * Returns the document as an image, expanding it the first time.
+     */
+    QImage image();
 
 private:
     class Private;
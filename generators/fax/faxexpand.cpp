@@ -21,12 +21,14 @@ pagenode::pagenode()
 {
 }
 
-/* Note that NeedBits() only works for n <= 16 */
+/* Note that NeedBits() only works for n <= 16; it reads a word of 32 bits
+   at a time into the 64 bits of BitAcc, which has then at most 47 bits */
 #define NeedBits(n)                                                                                                                                                                                                                            \
     do {                                                                                                                                                                                                                                       \
         if (BitsAvail < (n)) {                                                                                                                                                                                                                 \
-            BitAcc |= *sp++ << BitsAvail;                                                                                                                                                                                                      \
-            BitsAvail += 16;                                                                                                                                                                                                                   \
+            BitAcc |= (bitacc)(sp[0] | ((t32bits)sp[1] << 16)) << BitsAvail;                                                                                                                                                                   \
+            sp += 2;                                                                                                                                                                                                                           \
+            BitsAvail += 32;                                                                                                                                                                                                                   \
         }                                                                                                                                                                                                                                      \
     } while (0)
 #define GetBits(n) (BitAcc & ((1 << (n)) - 1))
@@ -43,7 +45,7 @@ pagenode::pagenode()
         int t;                                                                                                                                                                                                                                 \
         NeedBits(wid);                                                                                                                                                                                                                         \
         TabEnt = tab + GetBits(wid);                                                                                                                                                                                                           \
-        printf("%08lX/%d: %s%5d\t", BitAcc, BitsAvail, StateNames[TabEnt->State], TabEnt->Param);                                                                                                                                              \
+        printf("%016llX/%d: %s%5d\t", (unsigned long long)BitAcc, BitsAvail, StateNames[TabEnt->State], TabEnt->Param);                                                                                                                        \
         for (t = 0; t < TabEnt->Width; t++)                                                                                                                                                                                                    \
             DEBUG_SHOW;                                                                                                                                                                                                                        \
         putchar('\n');                                                                                                                                                                                                                         \
@@ -98,7 +100,8 @@ const char *StateNames[] = {
             printf("%4d %d\n", a0, *pa);                                                                                                                                                                                                       \
     } while (0)
 
-#define EndOfData(pn) (sp >= pn->data + pn->length / sizeof(*pn->data))
+/* the words still in BitAcc are not read yet */
+#define EndOfData(pn) (sp - BitsAvail / 16 >= pn->data + pn->length / sizeof(*pn->data))
 
 /* This macro handles coding errors in G3 data.
    We redefine it below for the G4 case */
@@ -343,7 +346,7 @@ void MHexpand(pagenode *pn, drawfunc df)
 {
     int a0;         /* reference element */
     int lastx;      /* copy line width to register */
-    t32bits BitAcc; /* bit accumulator */
+    bitacc BitAcc;  /* bit accumulator */
     int BitsAvail;  /* # valid bits in BitAcc */
     int RunLength;  /* Length of current run */
     t16bits *sp;    /* pointer into compressed data */
@@ -360,7 +363,7 @@ void MHexpand(pagenode *pn, drawfunc df)
     runs = (pixnum *)malloc(lastx * sizeof(pixnum));
     for (LineNum = 0; LineNum < pn->rowsperstrip;) {
 #ifdef DEBUG_FAX
-        printf("\nBitAcc=%08lX, BitsAvail = %d\n", BitAcc, BitsAvail);
+        printf("\nBitAcc=%016llX, BitsAvail = %d\n", (unsigned long long)BitAcc, BitsAvail);
         printf("-------------------- %d\n", LineNum);
         fflush(stdout);
 #endif
@@ -395,7 +398,7 @@ void g31expand(pagenode *pn, drawfunc df)
 {
     int a0;         /* reference element */
     int lastx;      /* copy line width to register */
-    t32bits BitAcc; /* bit accumulator */
+    bitacc BitAcc;  /* bit accumulator */
     int BitsAvail;  /* # valid bits in BitAcc */
     int RunLength;  /* Length of current run */
     t16bits *sp;    /* pointer into compressed data */
@@ -413,7 +416,7 @@ void g31expand(pagenode *pn, drawfunc df)
     EOLcnt = 0;
     for (LineNum = 0; LineNum < pn->rowsperstrip;) {
 #ifdef DEBUG_FAX
-        fprintf(stderr, "\nBitAcc=%08lX, BitsAvail = %d\n", BitAcc, BitsAvail);
+        fprintf(stderr, "\nBitAcc=%016llX, BitsAvail = %d\n", (unsigned long long)BitAcc, BitsAvail);
         fprintf(stderr, "-------------------- %d\n", LineNum);
         fflush(stderr);
 #endif
@@ -482,7 +485,7 @@ void g32expand(pagenode *pn, drawfunc df)
     pixnum *run0, *run1;          /* run length arrays */
     pixnum *thisrun, *pa, *pb;    /* pointers into runs */
     t16bits *sp;                  /* pointer into compressed data */
-    t32bits BitAcc;               /* bit accumulator */
+    bitacc BitAcc;                /* bit accumulator */
     int BitsAvail;                /* # valid bits in BitAcc */
     int EOLcnt;                   /* number of consecutive EOLs */
     int refline = 0;              /* 1D encoded reference line */
@@ -500,7 +503,7 @@ void g32expand(pagenode *pn, drawfunc df)
     EOLcnt = 0;
     for (LineNum = 0; LineNum < pn->rowsperstrip;) {
 #ifdef DEBUG_FAX
-        printf("\nBitAcc=%08lX, BitsAvail = %d\n", BitAcc, BitsAvail);
+        printf("\nBitAcc=%016llX, BitsAvail = %d\n", (unsigned long long)BitAcc, BitsAvail);
         printf("-------------------- %d\n", LineNum);
         fflush(stdout);
 #endif
@@ -599,7 +602,7 @@ void g4expand(pagenode *pn, drawfunc df)
     pixnum *run0, *run1;          /* run length arrays */
     pixnum *thisrun, *pa, *pb;    /* pointers into runs */
     t16bits *sp;                  /* pointer into compressed data */
-    t32bits BitAcc;               /* bit accumulator */
+    bitacc BitAcc;                /* bit accumulator */
     int BitsAvail;                /* # valid bits in BitAcc */
     int LineNum;                  /* line number */
     int EOLcnt;
@@ -616,7 +619,7 @@ void g4expand(pagenode *pn, drawfunc df)
 
     for (LineNum = 0; LineNum < pn->rowsperstrip;) {
 #ifdef DEBUG_FAX
-        printf("\nBitAcc=%08lX, BitsAvail = %d\n", BitAcc, BitsAvail);
+        printf("\nBitAcc=%016llX, BitsAvail = %d\n", (unsigned long long)BitAcc, BitsAvail);
         printf("-------------------- %d\n", LineNum);
         fflush(stdout);
 #endif
@@ -21,6 +21,8 @@
 #define t32bits quint32
 #define t16bits quint16
 
+typedef quint64 bitacc;
+
 typedef t16bits pixnum;
 
 class pagenode;
@@ -5,6 +5,7 @@
 
 #include "generator_fax.h"
 
+#include <QMutex>
 #include <QPainter>
 #include <QPrinter>
 
@@ -18,6 +19,7 @@ OKULAR_EXPORT_PLUGIN(FaxGenerator, "libokularGenerator_fax.json")
 
 FaxGenerator::FaxGenerator(QObject *parent, const QVariantList &args)
     : Generator(parent, args)
+    , m_document(nullptr)
 {
     setFeature(Threaded);
     setFeature(PrintNative);
@@ -26,6 +28,7 @@ FaxGenerator::FaxGenerator(QObject *parent, const QVariantList &args)
 
 FaxGenerator::~FaxGenerator()
 {
+    delete m_document;
 }
 
 bool FaxGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *> &pagesVector)
@@ -35,18 +38,19 @@ bool FaxGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *>
     else
         m_type = FaxDocument::G4;
 
-    FaxDocument faxDocument(fileName, m_type);
+    m_document = new FaxDocument(fileName, m_type);
 
-    if (!faxDocument.load()) {
+    if (!m_document->load()) {
+        delete m_document;
+        m_document = nullptr;
         emit error(i18n("Unable to load document"), -1);
         return false;
     }
 
-    m_img = faxDocument.image();
-
     pagesVector.resize(1);
 
-    Okular::Page *page = new Okular::Page(0, m_img.width(), m_img.height(), Okular::Rotation0);
+    const QSize size = m_document->size();
+    Okular::Page *page = new Okular::Page(0, size.width(), size.height(), Okular::Rotation0);
     pagesVector[0] = page;
 
     return true;
@@ -55,10 +59,20 @@ bool FaxGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *>
 bool FaxGenerator::doCloseDocument()
 {
     m_img = QImage();
+    delete m_document;
+    m_document = nullptr;
 
     return true;
 }
 
+QImage FaxGenerator::pageImage()
+{
+    QMutexLocker locker(userMutex());
+    if (m_img.isNull() && m_document)
+        m_img = m_document->image();
+    return m_img;
+}
+
 QImage FaxGenerator::image(Okular::PixmapRequest *request)
 {
     // perform a smooth scaled generation
@@ -67,7 +81,7 @@ QImage FaxGenerator::image(Okular::PixmapRequest *request)
     if (request->page()->rotation() % 2 == 1)
         qSwap(width, height);
 
-    return m_img.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    return pageImage().scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
 }
 
 Okular::DocumentInfo FaxGenerator::generateDocumentInfo(const QSet<Okular::DocumentInfo::Key> &keys) const
@@ -86,7 +100,7 @@ bool FaxGenerator::print(QPrinter &printer)
 {
     QPainter p(&printer);
 
-    QImage image(m_img);
+    QImage image = pageImage();
 
     if ((image.width() > printer.width()) || (image.height() > printer.height()))
 
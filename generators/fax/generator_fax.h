@@ -32,6 +32,10 @@ protected:
     QImage image(Okular::PixmapRequest *request) override;
 
 private:
+    // expands the document the first time it is needed
+    QImage pageImage();
+
+    FaxDocument *m_document;
     QImage m_img;
     FaxDocument::DocumentType m_type;
 };
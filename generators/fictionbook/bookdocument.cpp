@@ -0,0 +1,91 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "bookdocument.h"
+
+#include <QBuffer>
+#include <QImageReader>
+#include <QMutexLocker>
+#include <QUrl>
+
+using namespace FictionBook;
+
+// how much of the decoded images are kept at most, in KiB
+static const int imagesBudget = 32 * 1024;
+// how much of the base64 text is enough for the header of most images
+static const int headerProbeSize = 16 * 1024;
+
+static QSize headerSize(const QByteArray &bytes)
+{
+    QByteArray data = bytes;
+    QBuffer buffer(&data);
+    QImageReader reader(&buffer);
+    return reader.size();
+}
+
+BookDocument::BookDocument()
+{
+    mImages.setMaxCost(imagesBudget);
+}
+
+BookDocument::~BookDocument()
+{
+}
+
+void BookDocument::addBinary(const QString &id, const QByteArray &data)
+{
+    mBinaries.insert(QUrl(id).toString(), data);
+}
+
+QSize BookDocument::imageSize(const QString &id) const
+{
+    const QByteArray data = mBinaries.value(QUrl(id).toString());
+    if (data.isEmpty())
+        return QSize();
+
+    // some headers are further in, behind the metadata of the image
+    const QSize size = headerSize(QByteArray::fromBase64(QByteArray::fromRawData(data.constData(), qMin(data.size(), headerProbeSize))));
+    if (size.isValid() || data.size() <= headerProbeSize)
+        return size;
+
+    return headerSize(QByteArray::fromBase64(data));
+}
+
+QVariant BookDocument::loadResource(int type, const QUrl &name)
+{
+    const QString id = name.toString();
+    if (type != QTextDocument::ImageResource || !mBinaries.contains(id))
+        return QTextDocument::loadResource(type, name);
+
+    {
+        QMutexLocker locker(&mImagesMutex);
+        if (const QImage *image = mImages.object(id))
+            return *image;
+    }
+
+    // not through QTextDocument::loadResource(), it would keep the image for good
+    const QImage image = QImage::fromData(QByteArray::fromBase64(mBinaries.value(id)));
+    if (!image.isNull()) {
+        QMutexLocker locker(&mImagesMutex);
+        mImages.insert(id, new QImage(image), qMax(1, int(image.sizeInBytes() / 1024)));
+    }
+    return image;
+}
+
+qulonglong BookDocument::cachedMemory() const
+{
+    QMutexLocker locker(&mImagesMutex);
+    return qulonglong(mImages.totalCost()) * 1024;
+}
+
+qulonglong BookDocument::freeCachedMemory(qulonglong bytes)
+{
+    QMutexLocker locker(&mImagesMutex);
+    const qulonglong before = qulonglong(mImages.totalCost()) * 1024;
+    mImages.setMaxCost(int((bytes < before ? before - bytes : 0) / 1024));
+    mImages.setMaxCost(imagesBudget);
+    return before - qulonglong(mImages.totalCost()) * 1024;
+}
@@ -0,0 +1,61 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef FICTIONBOOK_BOOKDOCUMENT_H
+#define FICTIONBOOK_BOOKDOCUMENT_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QSize>
+#include <QTextDocument>
+
+namespace FictionBook
+{
+/**
+ * The text document of a book, with its <binary> images.
+ *
+ * The images are kept as the base64 text of the file and decoded when a page
+ * showing them is painted; the decoded ones are cached and can be dropped
+ * with freeCachedMemory(), they are decoded again the next time.
+ */
+class BookDocument : public QTextDocument
+{
+    Q_OBJECT
+
+public:
+    BookDocument();
+    ~BookDocument() override;
+
+    /**
+     * Adds the image @p id, encoded in base64 in @p data.
+     */
+    void addBinary(const QString &id, const QByteArray &data);
+
+    /**
+     * The size of the image @p id, from its header only.
+     */
+    QSize imageSize(const QString &id) const;
+
+    qulonglong cachedMemory() const;
+    qulonglong freeCachedMemory(qulonglong bytes);
+
+protected:
+    QVariant loadResource(int type, const QUrl &name) override;
+
+private:
+    QHash<QString, QByteArray> mBinaries;
+
+    // the pages may be painted in several threads
+    mutable QMutex mImagesMutex;
+    QCache<QString, QImage> mImages;
+};
+
+}
+
+#endif
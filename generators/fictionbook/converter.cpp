@@ -21,6 +21,7 @@
 #include <core/action.h>
 #include <core/document.h>
 
+#include "bookdocument.h"
 #include "document.h"
 
 using namespace FictionBook;
@@ -62,6 +63,11 @@ Converter::~Converter()
     delete mDocumentInfo;
 }
 
+BookDocument *Converter::document() const
+{
+    return mTextDocument;
+}
+
 QTextDocument *Converter::convert(const QString &fileName)
 {
     Document fbDocument(fileName);
@@ -70,7 +76,7 @@ QTextDocument *Converter::convert(const QString &fileName)
         return nullptr;
     }
 
-    mTextDocument = new QTextDocument;
+    mTextDocument = new BookDocument;
     mCursor = new QTextCursor(mTextDocument);
     mSectionCounter = 0;
     mLocalLinks.clear();
@@ -102,6 +108,7 @@ QTextDocument *Converter::convert(const QString &fileName)
 
     /**
      * First we read all images, so we can calculate the size later.
+     * They are only decoded once painted.
      */
     QDomElement element = documentElement.firstChildElement();
     while (!element.isNull()) {
@@ -624,10 +631,7 @@ bool Converter::convertBinary(const QDomElement &element)
     const QString id = element.attribute(QStringLiteral("id"));
 
     const QDomText textNode = element.firstChild().toText();
-    QByteArray data = textNode.data().toLatin1();
-    data = QByteArray::fromBase64(data);
-
-    mTextDocument->addResource(QTextDocument::ImageResource, QUrl(id), QImage::fromData(data));
+    mTextDocument->addBinary(id, textNode.data().toLatin1());
 
     return true;
 }
@@ -654,15 +658,15 @@ bool Converter::convertImage(const QDomElement &element)
     if (href.startsWith(QLatin1Char('#')))
         href = href.mid(1);
 
-    const QImage img = qvariant_cast<QImage>(mTextDocument->resource(QTextDocument::ImageResource, QUrl(href)));
+    const QSize size = mTextDocument->imageSize(href);
 
     QTextImageFormat format;
     format.setName(href);
 
-    if (img.width() > 560)
+    if (size.width() > 560)
         format.setWidth(560);
 
-    format.setHeight(img.height());
+    format.setHeight(qMax(0, size.height()));
 
     mCursor->insertImage(format);
 
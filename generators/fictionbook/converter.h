@@ -7,6 +7,8 @@
 #ifndef FICTIONBOOK_CONVERTER_H
 #define FICTIONBOOK_CONVERTER_H
 
+#include <QPointer>
+
 #include <core/textdocumentgenerator.h>
 
 class QDomElement;
@@ -16,6 +18,8 @@ class QTextTable;
 
 namespace FictionBook
 {
+class BookDocument;
+
 class Converter : public Okular::TextDocumentConverter
 {
     Q_OBJECT
@@ -26,6 +30,11 @@ public:
 
     QTextDocument *convert(const QString &fileName) override;
 
+    /**
+     * The document of the last conversion, while the generator has it.
+     */
+    BookDocument *document() const;
+
 private:
     bool convertBody(const QDomElement &element);
     bool convertDescription(const QDomElement &element);
@@ -62,7 +71,7 @@ private:
     bool convertTextNode(const QDomElement &element, QString &data);
     bool convertAnnotation(const QDomElement &element, QString &data);
 
-    QTextDocument *mTextDocument;
+    QPointer<BookDocument> mTextDocument;
     QTextCursor *mCursor;
 
     class TitleInfo;
@@ -6,6 +6,7 @@
 
 #include "generator_fb.h"
 
+#include "bookdocument.h"
 #include "converter.h"
 
 #include <KAboutData>
@@ -15,7 +16,13 @@
 OKULAR_EXPORT_PLUGIN(FictionBookGenerator, "libokularGenerator_fb.json")
 
 FictionBookGenerator::FictionBookGenerator(QObject *parent, const QVariantList &args)
-    : Okular::TextDocumentGenerator(new FictionBook::Converter, QStringLiteral("okular_fictionbook_generator_settings"), parent, args)
+    : FictionBookGenerator(new FictionBook::Converter, parent, args)
+{
+}
+
+FictionBookGenerator::FictionBookGenerator(FictionBook::Converter *converter, QObject *parent, const QVariantList &args)
+    : Okular::TextDocumentGenerator(converter, QStringLiteral("okular_fictionbook_generator_settings"), parent, args)
+    , mConverter(converter)
 {
 }
 
@@ -25,4 +32,20 @@ void FictionBookGenerator::addPages(KConfigDialog *dlg)
 
     dlg->addPage(widget, generalSettings(), i18n("FictionBook"), QStringLiteral("okular-fb2"), i18n("FictionBook Backend Configuration"));
 }
+qulonglong FictionBookGenerator::cachedMemory() const
+{
+    const FictionBook::BookDocument *document = mConverter->document();
+    return Okular::TextDocumentGenerator::cachedMemory() + (document ? document->cachedMemory() : 0);
+}
+
+qulonglong FictionBookGenerator::freeCachedMemory(qulonglong bytes)
+{
+    // the decoded images first, the pictures of the pages use them
+    FictionBook::BookDocument *document = mConverter->document();
+    qulonglong freed = document ? document->freeCachedMemory(bytes) : 0;
+    if (freed < bytes)
+        freed += Okular::TextDocumentGenerator::freeCachedMemory(bytes - freed);
+    return freed;
+}
+
 #include "generator_fb.moc"
@@ -9,6 +9,11 @@
 
 #include <core/textdocumentgenerator.h>
 
+namespace FictionBook
+{
+class Converter;
+}
+
 class FictionBookGenerator : public Okular::TextDocumentGenerator
 {
     Q_OBJECT
@@ -19,6 +24,14 @@ public:
 
     // [INHERITED] reparse configuration
     void addPages(KConfigDialog *dlg) override;
+
+    qulonglong cachedMemory() const override;
+    qulonglong freeCachedMemory(qulonglong bytes) override;
+
+private:
+    FictionBookGenerator(FictionBook::Converter *converter, QObject *parent, const QVariantList &args);
+
+    FictionBook::Converter *mConverter;
 };
 
 #endif
@@ -29,10 +29,22 @@
 
 #include <core/page.h>
 
+// bigger images are not kept decoded when the format can decode parts of them
+#define KIMGIO_MAX_DECODED_PIXELS 50000000
+
+// the most the image is decoded and scaled at once when printing, in bytes
+static const int printBandBytes = 16 * 1024 * 1024;
+
+// the longest side of the decode that checks an image can be decoded at all
+static const int validationSize = 64;
+
 OKULAR_EXPORT_PLUGIN(KIMGIOGenerator, "libokularGenerator_kimgio.json")
 
 KIMGIOGenerator::KIMGIOGenerator(QObject *parent, const QVariantList &args)
     : Generator(parent, args)
+    , m_orientation(KExiv2Iface::KExiv2::ORIENTATION_UNSPECIFIED)
+    , m_decodeRegions(false)
+    , m_decodeFailed(false)
 {
     setFeature(ReadRawData);
     setFeature(Threaded);
@@ -69,27 +81,53 @@ bool KIMGIOGenerator::loadDocumentInternal(const QByteArray &fileData, const QSt
 
     QImageReader reader(&buffer, QImageReader::imageFormat(&buffer));
     reader.setAutoDetectImageFormat(true);
-    if (!reader.read(&m_img)) {
-        if (!m_img.isNull()) {
-            emit warning(i18n("This document appears malformed. Here is a best approximation of the document's intended appearance."), -1);
-        } else {
-            emit error(i18n("Unable to load document: %1", reader.errorString()), -1);
-            return false;
-        }
-    }
+
     QMimeDatabase db;
     auto mime = db.mimeTypeForFileNameAndData(fileName, fileData);
     docInfo.set(Okular::DocumentInfo::MimeType, mime.name());
 
-    // Apply transformations dictated by Exif metadata
     KExiv2Iface::KExiv2 exifMetadata;
-    if (exifMetadata.loadFromData(fileData)) {
-        exifMetadata.rotateExifQImage(m_img, exifMetadata.getImageOrientation());
+    const bool hasExif = exifMetadata.loadFromData(fileData);
+    const KExiv2Iface::KExiv2::ImageOrientation orientation = hasExif ? exifMetadata.getImageOrientation() : KExiv2Iface::KExiv2::ORIENTATION_UNSPECIFIED;
+
+    // the size is in the header, the image is decoded when it is needed;
+    // huge images whose format can decode just a part of them, or at a
+    // lower resolution, are decoded for every request instead of being
+    // kept in memory
+    const QSize size = reader.size();
+    const bool canDecodeRegions = reader.supportsOption(QImageIOHandler::ClipRect) && reader.supportsOption(QImageIOHandler::ScaledSize);
+    const bool isUpright = orientation == KExiv2Iface::KExiv2::ORIENTATION_UNSPECIFIED || orientation == KExiv2Iface::KExiv2::ORIENTATION_NORMAL;
+    m_data = fileData;
+    m_format = reader.format();
+    m_orientation = orientation;
+    if (size.isValid() && reader.canRead()) {
+        // a header can be fine with the data after it broken, the formats
+        // that can decode at a lower resolution check that cheaply now, the
+        // others when they are rendered
+        if (reader.supportsOption(QImageIOHandler::ScaledSize)) {
+            reader.setScaledSize(size.scaled(validationSize, validationSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1)));
+            QImage thumbnail;
+            if (!reader.read(&thumbnail) && thumbnail.isNull()) {
+                emit error(i18n("Unable to load document: %1", reader.errorString()), -1);
+                doCloseDocument();
+                return false;
+            }
+        }
+        m_decodeRegions = canDecodeRegions && isUpright && (qint64)size.width() * size.height() > KIMGIO_MAX_DECODED_PIXELS;
+        // the orientations from ORIENTATION_ROT_90_HFLIP on turn the image a quarter
+        m_size = orientation >= KExiv2Iface::KExiv2::ORIENTATION_ROT_90_HFLIP ? size.transposed() : size;
+    } else {
+        // no size without decoding it, which reports the error
+        if (decodedImage().isNull()) {
+            doCloseDocument();
+            return false;
+        }
+        m_size = m_img.size();
     }
 
     pagesVector.resize(1);
 
-    Okular::Page *page = new Okular::Page(0, m_img.width(), m_img.height(), Okular::Rotation0);
+    Okular::Page *page = new Okular::Page(0, m_size.width(), m_size.height(), Okular::Rotation0);
     pagesVector[0] = page;
 
     return true;
@@ -105,23 +143,90 @@ KIMGIOGenerator::SwapBackingFileResult KIMGIOGenerator::swapBackingFile(QString
 bool KIMGIOGenerator::doCloseDocument()
 {
     m_img = QImage();
+    m_data.clear();
+    m_format.clear();
+    m_orientation = KExiv2Iface::KExiv2::ORIENTATION_UNSPECIFIED;
+    m_decodeRegions = false;
+    m_decodeFailed = false;
+    m_decodedKiB.storeRelease(0);
+    m_size = QSize();
 
     return true;
 }
 
+qulonglong KIMGIOGenerator::cachedMemory() const
+{
+    return qulonglong(m_decodedKiB.loadAcquire()) * 1024;
+}
+
+qulonglong KIMGIOGenerator::freeCachedMemory(qulonglong /*bytes*/)
+{
+    // not waiting for a decoding, that one is needed
+    if (!tryLockUserMutex(OtherSite))
+        return 0;
+
+    const qulonglong freed = cachedMemory();
+    m_img = QImage();
+    m_decodedKiB.storeRelease(0);
+    unlockUserMutex();
+    return freed;
+}
+
+QImage KIMGIOGenerator::decodedImage()
+{
+    if (!m_img.isNull() || m_data.isEmpty() || m_decodeFailed)
+        return m_img;
+
+    QBuffer buffer;
+    buffer.setData(m_data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QImageReader reader(&buffer, m_format);
+    reader.setAutoDetectImageFormat(true);
+    if (!reader.read(&m_img)) {
+        // reported once, the pages stay empty instead of decoding it again
+        if (m_img.isNull()) {
+            m_decodeFailed = true;
+            emit error(i18n("Unable to load document: %1", reader.errorString()), -1);
+            return m_img;
+        }
+        emit warning(i18n("This document appears malformed. Here is a best approximation of the document's intended appearance."), -1);
+    }
+
+    // Apply transformations dictated by Exif metadata
+    if (m_orientation != KExiv2Iface::KExiv2::ORIENTATION_UNSPECIFIED) {
+        KExiv2Iface::KExiv2 exifMetadata;
+        exifMetadata.rotateExifQImage(m_img, static_cast<KExiv2Iface::KExiv2::ImageOrientation>(m_orientation));
+    }
+    m_decodedKiB.storeRelease(int(m_img.sizeInBytes() / 1024));
+
+    return m_img;
+}
+
 QImage KIMGIOGenerator::image(Okular::PixmapRequest *request)
 {
+    // a shallow copy, freeCachedMemory() may drop m_img meanwhile
+    QImage img;
+    if (!m_decodeRegions) {
+        lockUserMutex(RenderSite);
+        img = decodedImage();
+        unlockUserMutex();
+    }
+
     // perform a smooth scaled generation
     if (request->isTile()) {
-        const QRect srcRect = request->normalizedRect().geometry(m_img.width(), m_img.height());
+        const QRect srcRect = request->normalizedRect().geometry(m_size.width(), m_size.height());
         const QRect destRect = request->normalizedRect().geometry(request->width(), request->height());
 
+        if (m_decodeRegions)
+            return decodeRegion(srcRect, destRect.size());
+
         QImage destImg(destRect.size(), QImage::Format_RGB32);
         destImg.fill(Qt::white);
 
         QPainter p(&destImg);
         p.setRenderHint(QPainter::SmoothPixmapTransform);
-        p.drawImage(destImg.rect(), m_img, srcRect);
+        p.drawImage(destImg.rect(), img, srcRect);
 
         return destImg;
     } else {
@@ -130,21 +235,62 @@ QImage KIMGIOGenerator::image(Okular::PixmapRequest *request)
         if (request->page()->rotation() % 2 == 1)
             qSwap(width, height);
 
-        return m_img.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        if (m_decodeRegions)
+            return decodeRegion(QRect(QPoint(0, 0), m_size), QSize(width, height));
+
+        return img.scaled(width, height, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
     }
 }
 
-bool KIMGIOGenerator::print(QPrinter &printer)
+QImage KIMGIOGenerator::decodeRegion(const QRect &clipRect, const QSize &scaledSize) const
 {
-    QPainter p(&printer);
+    QBuffer buffer;
+    buffer.setData(m_data);
+    buffer.open(QIODevice::ReadOnly);
 
-    QImage image(m_img);
+    // the clip rect is applied before scaling
+    QImageReader reader(&buffer, m_format);
+    reader.setClipRect(clipRect);
+    reader.setScaledSize(scaledSize);
+    return reader.read();
+}
 
-    if ((image.width() > printer.width()) || (image.height() > printer.height()))
+bool KIMGIOGenerator::print(QPrinter &printer)
+{
+    QPainter p(&printer);
 
-        image = image.scaled(printer.width(), printer.height(), Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    QImage image;
+    if (!m_decodeRegions) {
+        lockUserMutex(OtherSite);
+        image = decodedImage();
+        unlockUserMutex();
+    }
 
-    p.drawImage(0, 0, image);
+    QSize targetSize = m_size;
+    if ((m_size.width() > printer.width()) || (m_size.height() > printer.height()))
+        targetSize = m_size.scaled(printer.width(), printer.height(), Qt::KeepAspectRatio);
+    if (m_size.isEmpty() || targetSize.isEmpty())
+        return true;
+
+    // a band of rows at a time, scaled to the pixels it takes on the printer,
+    // so the image is never scaled (or decoded) whole at printer resolution
+    const int bandHeight = qMax(1, printBandBytes / 4 / qMax(m_size.width(), targetSize.width()));
+    for (int y = 0; y < m_size.height(); y += bandHeight) {
+        const QRect srcRect(0, y, m_size.width(), qMin(bandHeight, m_size.height() - y));
+        // from the rows of the image, so that the bands meet
+        const int top = qint64(y) * targetSize.height() / m_size.height();
+        const int bottom = qint64(srcRect.bottom() + 1) * targetSize.height() / m_size.height();
+        if (bottom == top)
+            continue;
+
+        const QSize bandSize(targetSize.width(), bottom - top);
+        if (m_decodeRegions)
+            p.drawImage(0, top, decodeRegion(srcRect, bandSize));
+        else if (bandSize == srcRect.size())
+            p.drawImage(QPoint(0, top), image, srcRect);
+        else
+            p.drawImage(0, top, image.copy(srcRect).scaled(bandSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+    }
 
     return true;
 }
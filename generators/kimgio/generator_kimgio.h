@@ -13,6 +13,7 @@
 #include <core/document.h>
 #include <core/generator.h>
 
+#include <QAtomicInt>
 #include <QImage>
 
 class KIMGIOGenerator : public Okular::Generator
@@ -35,15 +36,34 @@ public:
     // [INHERITED] document information
     Okular::DocumentInfo generateDocumentInfo(const QSet<Okular::DocumentInfo::Key> &keys) const override;
 
+    // [INHERITED] the decoded image, decoded again when needed
+    qulonglong cachedMemory() const override;
+    qulonglong freeCachedMemory(qulonglong bytes) override;
+
 protected:
     bool doCloseDocument() override;
     QImage image(Okular::PixmapRequest *request) override;
 
 private:
     bool loadDocumentInternal(const QByteArray &fileData, const QString &fileName, QVector<Okular::Page *> &pagesVector);
+    QImage decodeRegion(const QRect &clipRect, const QSize &scaledSize) const;
+    QImage decodedImage();
 
 private:
+    // decoded on the first request, under the userMutex()
     QImage m_img;
+    // the encoded image, m_img is decoded from it
+    QByteArray m_data;
+    QByteArray m_format;
+    // a KExiv2::ImageOrientation, applied to m_img
+    int m_orientation;
+    // too big to keep m_img, every request decodes its part of m_data
+    bool m_decodeRegions;
+    // m_data could not be decoded, only checked once its header was read
+    bool m_decodeFailed;
+    // the size of m_img, in KiB
+    QAtomicInt m_decodedKiB;
+    QSize m_size;
     Okular::DocumentInfo docInfo;
 };
 
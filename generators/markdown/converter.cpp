@@ -57,6 +57,9 @@ Converter::~Converter()
 
 QTextDocument *Converter::convert(const QString &fileName)
 {
+    // converting again after the file changed
+    if (m_markdownFile)
+        fclose(m_markdownFile);
     m_markdownFile = fopen(fileName.toLocal8Bit(), "rb");
     if (!m_markdownFile) {
         emit error(i18n("Failed to open the document"), -1);
@@ -8,11 +8,15 @@
 #include <QColor>
 #include <QDebug>
 #include <QFile>
+#include <QMap>
 #include <QPalette> // Because of the HACK
-#include <QRegExp>
+#include <QRegularExpression>
+#include <QVector>
 #include <qmobipocket/mobipocket.h>
 #include <qmobipocket/qfilestream.h>
 
+#include <climits>
+
 using namespace Mobi;
 
 MobiDocument::MobiDocument(const QString &fileName)
@@ -65,10 +69,11 @@ QVariant MobiDocument::loadResource(int type, const QUrl &name)
     return resource;
 }
 
-// starting from 'pos', find position in the string that is not inside a tag
-int outsideTag(const QString &data, int pos)
+// starting from 'pos', find position in the string that is not inside a tag,
+// looking back no further than 'from'
+static int outsideTag(const QString &data, int pos, int from)
 {
-    for (int i = pos - 1; i >= 0; i--) {
+    for (int i = pos - 1; i >= from; i--) {
         if (data[i] == QLatin1Char('>'))
             return pos;
         if (data[i] == QLatin1Char('<'))
@@ -77,44 +82,121 @@ int outsideTag(const QString &data, int pos)
     return pos;
 }
 
-QString MobiDocument::fixMobiMarkup(const QString &data)
+// the record of the image of the <img> tag from 'start' to 'end', null if it has none
+static QStringRef imageRecord(const QString &data, int start, int end)
 {
-    QString ret = data;
-    QMap<int, QString> anchorPositions;
-    static QRegExp anchors(QStringLiteral("<a(?: href=\"[^\"]*\"){0,1}[\\s]+filepos=['\"]{0,1}([\\d]+)[\"']{0,1}"), Qt::CaseInsensitive);
-    int pos = 0;
+    static const QLatin1String recindex("recindex=\"");
+    const int attribute = data.midRef(start, end - start).indexOf(recindex, 0, Qt::CaseInsensitive);
+    if (attribute == -1)
+        return QStringRef();
+
+    const int first = start + attribute + recindex.size();
+    int last = first;
+    while (last < end && data[last].isDigit())
+        ++last;
+    if (data[last] != QLatin1Char('"'))
+        return QStringRef();
+    return data.midRef(first, last - first);
+}
 
+QString MobiDocument::fixMobiMarkup(const QString &data)
+{
     // find all link destinations
-    while ((pos = anchors.indexIn(data, pos)) != -1) {
-        int filepos = anchors.cap(1).toUInt();
+    static const QRegularExpression anchors(QStringLiteral("<a(?: href=\"[^\"]*\"){0,1}[\\s]+filepos=['\"]{0,1}([\\d]+)[\"']{0,1}"), QRegularExpression::CaseInsensitiveOption);
+    struct Link {
+        int start;
+        int length;
+        QString target;
+    };
+    QVector<Link> links;
+    QMap<uint, QString> anchorPositions;
+    QRegularExpressionMatchIterator matches = anchors.globalMatch(data);
+    while (matches.hasNext()) {
+        const QRegularExpressionMatch match = matches.next();
+        links.append({match.capturedStart(), match.capturedLength(), match.captured(1)});
+        const uint filepos = match.capturedRef(1).toUInt();
         if (filepos)
-            anchorPositions[filepos] = anchors.cap(1);
-        pos += anchors.matchedLength();
+            anchorPositions[filepos] = match.captured(1);
     }
 
-    // put HTML anchors in all link destinations
-    int offset = 0;
-    QMapIterator<int, QString> it(anchorPositions);
-    while (it.hasNext()) {
-        it.next();
+    // HTML anchors go in all link destinations, outside of the tag they are
+    // in; the anchor before one ends where looking for the tag can stop
+    struct Anchor {
+        int position;
+        QString name;
+    };
+    QVector<Anchor> targets;
+    targets.reserve(anchorPositions.count());
+    int previous = 0;
+    for (QMap<uint, QString>::const_iterator it = anchorPositions.constBegin(); it != anchorPositions.constEnd(); ++it) {
         // link pointing outside the document, ignore
-        if ((it.key() + offset) >= ret.size())
-            continue;
-        int fixedpos = outsideTag(ret, it.key() + offset);
-        ret.insert(fixedpos, QStringLiteral("<a name=\"") + it.value() + QStringLiteral("\">&nbsp;</a>"));
-        // inserting anchor shifts all offsets after the anchor
-        offset += 21 + it.value().size();
+        if (it.key() >= uint(data.size()))
+            break;
+        previous = outsideTag(data, it.key(), previous);
+        targets.append({previous, it.value()});
     }
 
-    // replace links referencing filepos with normal internal links
-    ret.replace(anchors, QStringLiteral("<a href=\"#\\1\""));
-    // Mobipocket uses strange variang of IMG tags: <img recindex="3232"> where recindex is number of
-    // record containing image
-    static QRegExp imgs(QStringLiteral("<img.*recindex=\"([\\d]*)\".*>"), Qt::CaseInsensitive);
+    // one pass writing the text with the anchors, links referencing filepos
+    // turned into normal internal links, and images and page breaks fixed
+    QString ret;
+    ret.reserve(data.size() + targets.count() * 32);
+    int nextTarget = 0;
+    int nextLink = 0;
+    int pos = 0;
+    const auto appendAnchors = [&](int upTo) {
+        for (; nextTarget < targets.count() && targets.at(nextTarget).position <= upTo; ++nextTarget)
+            ret += QLatin1String("<a name=\"") + targets.at(nextTarget).name + QLatin1String("\">&nbsp;</a>");
+    };
+    while (pos < data.size()) {
+        int tag = data.indexOf(QLatin1Char('<'), pos);
+        if (tag == -1)
+            tag = data.size();
+
+        // the text up to the tag, with the anchors that go in it
+        while (nextTarget < targets.count() && targets.at(nextTarget).position < tag) {
+            const int at = qMax(pos, targets.at(nextTarget).position);
+            ret.append(data.midRef(pos, at - pos));
+            pos = at;
+            appendAnchors(at);
+        }
+        ret.append(data.midRef(pos, tag - pos));
+        pos = tag;
+        if (pos == data.size())
+            break;
+        appendAnchors(pos);
+
+        while (nextLink < links.count() && links.at(nextLink).start < pos)
+            ++nextLink;
+        if (nextLink < links.count() && links.at(nextLink).start == pos) {
+            ret += QLatin1String("<a href=\"#") + links.at(nextLink).target + QLatin1Char('"');
+            pos += links.at(nextLink).length;
+            ++nextLink;
+            continue;
+        }
+
+        // Mobipocket uses strange variang of IMG tags: <img recindex="3232"> where recindex is number of
+        // record containing image
+        if (data.midRef(pos, 4).compare(QLatin1String("<img"), Qt::CaseInsensitive) == 0) {
+            const int end = data.indexOf(QLatin1Char('>'), pos);
+            const QStringRef record = end == -1 ? QStringRef() : imageRecord(data, pos, end);
+            if (!record.isNull()) {
+                ret += QLatin1String("<img src=\"pdbrec:/") + record + QLatin1String("\">");
+                pos = end + 1;
+                continue;
+            }
+        }
 
-    imgs.setMinimal(true);
-    ret.replace(imgs, QStringLiteral("<img src=\"pdbrec:/\\1\">"));
-    ret.replace(QStringLiteral("<mbp:pagebreak/>"), QStringLiteral("<p style=\"page-break-after:always\"></p>"));
+        static const QLatin1String pageBreak("<mbp:pagebreak/>");
+        if (data.midRef(pos, pageBreak.size()) == pageBreak) {
+            ret += QLatin1String("<p style=\"page-break-after:always\"></p>");
+            pos += pageBreak.size();
+            continue;
+        }
+
+        ret += QLatin1Char('<');
+        ++pos;
+    }
+    appendAnchors(INT_MAX);
 
     return ret;
 }
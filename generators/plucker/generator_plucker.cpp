@@ -19,6 +19,9 @@
 
 OKULAR_EXPORT_PLUGIN(PluckerGenerator, "libokularGenerator_plucker.json")
 
+// how many transcribed pages are kept at most
+static const int cachedPages = 8;
+
 static void calculateBoundingRect(QTextDocument *document, int startPosition, int endPosition, QRectF &rect)
 {
     const QTextBlock startBlock = document->findBlock(startPosition);
@@ -46,24 +49,29 @@ static void calculateBoundingRect(QTextDocument *document, int startPosition, in
 
 PluckerGenerator::PluckerGenerator(QObject *parent, const QVariantList &args)
     : Generator(parent, args)
+    , mUnpluck(nullptr)
 {
+    mPages.setMaxCost(cachedPages);
 }
 
 PluckerGenerator::~PluckerGenerator()
 {
+    delete mUnpluck;
 }
 
 bool PluckerGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *> &pagesVector)
 {
-    QUnpluck unpluck;
+    mUnpluck = new QUnpluck;
 
-    if (!unpluck.open(fileName))
+    if (!mUnpluck->open(fileName)) {
+        delete mUnpluck;
+        mUnpluck = nullptr;
         return false;
+    }
 
-    mPages = unpluck.pages();
-    mLinks = unpluck.links();
+    mLinks = mUnpluck->links();
 
-    const QMap<QString, QString> infos = unpluck.infos();
+    const QMap<QString, QString> infos = mUnpluck->infos();
     QMapIterator<QString, QString> it(infos);
     while (it.hasNext()) {
         it.next();
@@ -79,10 +87,10 @@ bool PluckerGenerator::loadDocument(const QString &fileName, QVector<Okular::Pag
         }
     }
 
-    pagesVector.resize(mPages.count());
+    pagesVector.resize(mUnpluck->pageCount());
 
-    for (int i = 0; i < mPages.count(); ++i) {
-        QSizeF size = mPages[i]->size();
+    for (int i = 0; i < mUnpluck->pageCount(); ++i) {
+        const QSizeF size = mUnpluck->pageSize(i);
         Okular::Page *page = new Okular::Page(i, size.width(), size.height(), Okular::Rotation0);
         pagesVector[i] = page;
     }
@@ -95,8 +103,9 @@ bool PluckerGenerator::doCloseDocument()
     mLinkAdded.clear();
     mLinks.clear();
 
-    qDeleteAll(mPages);
     mPages.clear();
+    delete mUnpluck;
+    mUnpluck = nullptr;
 
     // do not use clear() for the following, otherwise its type is changed
     mDocumentInfo = Okular::DocumentInfo();
@@ -109,9 +118,22 @@ Okular::DocumentInfo PluckerGenerator::generateDocumentInfo(const QSet<Okular::D
     return mDocumentInfo;
 }
 
+QTextDocument *PluckerGenerator::pageDocument(int page)
+{
+    if (QTextDocument *document = mPages.object(page))
+        return document;
+
+    QTextDocument *document = mUnpluck->page(page);
+    if (document)
+        mPages.insert(page, document);
+    return document;
+}
+
 QImage PluckerGenerator::image(Okular::PixmapRequest *request)
 {
-    const QSizeF size = mPages[request->pageNumber()]->size();
+    // the size the page was measured with, even if the page can't be transcribed again
+    const QSizeF size = mUnpluck->pageSize(request->pageNumber());
+    QTextDocument *document = pageDocument(request->pageNumber());
 
     QImage image(request->width(), request->height(), QImage::Format_ARGB32_Premultiplied);
     image.fill(Qt::white);
@@ -123,15 +145,14 @@ QImage PluckerGenerator::image(Okular::PixmapRequest *request)
     qreal height = request->height();
 
     p.scale(width / (qreal)size.width(), height / (qreal)size.height());
-    mPages[request->pageNumber()]->drawContents(&p);
+    if (document)
+        document->drawContents(&p);
     p.end();
 
-    if (!mLinkAdded.contains(request->pageNumber())) {
+    if (document && !mLinkAdded.contains(request->pageNumber())) {
         QLinkedList<Okular::ObjectRect *> objects;
         for (int i = 0; i < mLinks.count(); ++i) {
             if (mLinks[i].page == request->pageNumber()) {
-                QTextDocument *document = mPages[request->pageNumber()];
-
                 QRectF rect;
                 calculateBoundingRect(document, mLinks[i].start, mLinks[i].end, rect);
 
@@ -165,8 +186,9 @@ bool PluckerGenerator::exportTo(const QString &fileName, const Okular::ExportFor
             return false;
 
         QTextStream out(&file);
-        for (int i = 0; i < mPages.count(); ++i) {
-            out << mPages[i]->toPlainText();
+        for (int i = 0; i < mUnpluck->pageCount(); ++i) {
+            if (QTextDocument *document = pageDocument(i))
+                out << document->toPlainText();
         }
 
         return true;
@@ -178,8 +200,8 @@ bool PluckerGenerator::exportTo(const QString &fileName, const Okular::ExportFor
 bool PluckerGenerator::print(QPrinter &)
 {
     /*
-        for ( int i = 0; i < mPages.count(); ++i )
-          mPages[ i ]->print( &printer );
+        for ( int i = 0; i < mUnpluck->pageCount(); ++i )
+          pageDocument( i )->print( &printer );
     */
     return true;
 }
@@ -10,6 +10,7 @@
 #include <core/document.h>
 #include <core/generator.h>
 
+#include <QCache>
 #include <QTextBlock>
 
 #include "qunpluck.h"
@@ -45,7 +46,11 @@ protected:
     bool doCloseDocument() override;
 
 private:
-    QList<QTextDocument *> mPages;
+    QTextDocument *pageDocument(int page);
+
+    QUnpluck *mUnpluck;
+    // the pages shown last, transcribed again from the document when needed
+    QCache<int, QTextDocument> mPages;
     QSet<int> mLinkAdded;
     Link::List mLinks;
     Okular::DocumentInfo mDocumentInfo;
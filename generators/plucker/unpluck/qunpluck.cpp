@@ -60,6 +60,11 @@ static void LinkRecords
 }
 */
 
+// how much of the decompressed records are kept at most, in bytes
+static const int recordsBudget = 4 * 1024 * 1024;
+// how much of the decoded images are kept at most, in KiB
+static const int imagesBudget = 16 * 1024;
+
 class Context
 {
 public:
@@ -67,7 +72,7 @@ public:
     QTextDocument *document;
     QTextCursor *cursor;
     QStack<QTextCharFormat> stack;
-    QList<int> images;
+    QList<QPair<QString, QTextBlock>> targets;
 
     QString linkUrl;
     int linkStart;
@@ -82,42 +87,57 @@ public:
     bool done;
 };
 
-static Okular::DocumentViewport calculateViewport(QTextDocument *document, const QTextBlock &block)
+// the images are laid out with their size from the records, and only
+// decoded when the page is painted
+class PageDocument : public QTextDocument
 {
-    if (!block.isValid())
-        return Okular::DocumentViewport();
+public:
+    explicit PageDocument(QUnpluck *unpluck)
+        : mUnpluck(unpluck)
+    {
+    }
 
-    const QRectF rect = document->documentLayout()->blockBoundingRect(block);
-    const QSizeF size = document->size();
+protected:
+    QVariant loadResource(int type, const QUrl &name) override
+    {
+        const QString fileName = name.toString();
+        if (type == QTextDocument::ImageResource && fileName.endsWith(QLatin1String(".jpg")))
+            return mUnpluck->ImageRecord(fileName.leftRef(fileName.length() - 4).toInt());
 
-    int page = qRound(rect.y()) / qRound(size.height());
+        return QTextDocument::loadResource(type, name);
+    }
 
-    Okular::DocumentViewport viewport(page);
-    viewport.rePos.normalizedX = (double)rect.x() / (double)size.width();
-    viewport.rePos.normalizedY = (double)rect.y() / (double)size.height();
-    viewport.rePos.enabled = true;
-    viewport.rePos.pos = Okular::DocumentViewport::Center;
+private:
+    QUnpluck *mUnpluck;
+};
+
+static QPointF blockPosition(QTextDocument *document, const QTextBlock &block)
+{
+    const QRectF rect = document->documentLayout()->blockBoundingRect(block);
+    const QSizeF size = document->size();
 
-    return viewport;
+    return QPointF(rect.x() / size.width(), rect.y() / size.height());
 }
 
 QUnpluck::QUnpluck()
     : mDocument(nullptr)
+    , mIndexing(false)
 {
+    mImages.setMaxCost(imagesBudget);
 }
 
 QUnpluck::~QUnpluck()
 {
-    mLinks.clear();
-    mNamedTargets.clear();
-    mPages.clear();
+    if (mDocument)
+        plkr_CloseDoc(mDocument);
 }
 
 bool QUnpluck::open(const QString &fileName)
 {
     mLinks.clear();
     mNamedTargets.clear();
-    mPages.clear();
+    mPageRecords.clear();
+    mPageSizes.clear();
 
     mDocument = plkr_OpenDBFile(QFile::encodeName(fileName).data());
     if (!mDocument) {
@@ -132,6 +152,7 @@ bool QUnpluck::open(const QString &fileName)
     mInfo.insert(QStringLiteral("author"), QString::fromLocal8Bit(plkr_GetAuthor(mDocument)));
     mInfo.insert(QStringLiteral("time"), QDateTime::fromSecsSinceEpoch(plkr_GetPublicationTime(mDocument)).toString());
 
+    mIndexing = true;
     AddRecord(plkr_GetHomeRecordID(mDocument));
 
     int number = GetNextRecordNumber();
@@ -149,35 +170,19 @@ bool QUnpluck::open(const QString &fileName)
         /*status = */ TranscribeRecord(number);
         number = GetNextRecordNumber();
     }
+    mIndexing = false;
 
     for (int i = 0; i < mRecords.count(); ++i)
         delete mRecords[i];
 
     mRecords.clear();
 
-    plkr_CloseDoc(mDocument);
-
     /**
      * Calculate hash map
      */
     QHash<int, int> pageHash;
-    for (int i = 0; i < mContext.count(); ++i)
-        pageHash.insert(mContext[i]->recordId, i);
-
-    /**
-     * Convert ids
-     */
-    for (int i = 0; i < mContext.count(); ++i) {
-        Context *context = mContext[i];
-        for (int j = 0; j < context->images.count(); ++j) {
-            int imgNumber = context->images[j];
-            context->document->addResource(QTextDocument::ImageResource, QUrl(QStringLiteral("%1.jpg").arg(imgNumber)), mImages[imgNumber]);
-        }
-
-        mPages.append(context->document);
-    }
-    qDeleteAll(mContext);
-    mContext.clear();
+    for (int i = 0; i < mPageRecords.count(); ++i)
+        pageHash.insert(mPageRecords[i], i);
 
     // convert record_id into page
     for (int i = 0; i < mLinks.count(); ++i) {
@@ -191,21 +196,39 @@ bool QUnpluck::open(const QString &fileName)
             viewport.rePos.pos = Okular::DocumentViewport::TopLeft;
             mLinks[i].link = new Okular::GotoAction(QString(), viewport);
         } else if (mLinks[i].url.startsWith(QLatin1String("para:"))) {
-            QPair<int, QTextBlock> data = mNamedTargets[mLinks[i].url];
-
-            QTextDocument *document = mPages[mLinks[i].page];
-
-            Okular::DocumentViewport viewport = calculateViewport(document, data.second);
+            const QMap<QString, QPair<int, QPointF>>::const_iterator target = mNamedTargets.constFind(mLinks[i].url);
+
+            Okular::DocumentViewport viewport;
+            if (target != mNamedTargets.constEnd() && pageHash.contains(target->first)) {
+                viewport.pageNumber = pageHash[target->first];
+                viewport.rePos.normalizedX = target->second.x();
+                viewport.rePos.normalizedY = target->second.y();
+                viewport.rePos.enabled = true;
+                viewport.rePos.pos = Okular::DocumentViewport::Center;
+            }
 
             mLinks[i].link = new Okular::GotoAction(QString(), viewport);
         } else {
             mLinks[i].link = new Okular::BrowseAction(QUrl(mLinks[i].url));
         }
     }
+    mNamedTargets.clear();
 
     return true;
 }
 
+QTextDocument *QUnpluck::page(int page)
+{
+    if (!mDocument || page < 0 || page >= mPageRecords.count())
+        return nullptr;
+
+    bool status;
+    QTextDocument *document = TranscribePage(mPageRecords[page], &status);
+    plkr_TrimRecordCache(mDocument, recordsBudget);
+
+    return document;
+}
+
 int QUnpluck::GetNextRecordNumber()
 {
     int index = 0;
@@ -233,6 +256,9 @@ int QUnpluck::GetPageID(int index)
 
 void QUnpluck::AddRecord(int index)
 {
+    if (!mIndexing)
+        return;
+
     for (int pos = 0; pos < mRecords.count(); ++pos) {
         if (mRecords[pos]->index == index) {
             return;
@@ -249,6 +275,9 @@ void QUnpluck::AddRecord(int index)
 
 void QUnpluck::MarkRecordDone(int index)
 {
+    if (!mIndexing)
+        return;
+
     for (int pos = 0; pos < mRecords.count(); ++pos) {
         if (mRecords[pos]->index == index) {
             mRecords[pos]->done = true;
@@ -262,6 +291,9 @@ void QUnpluck::MarkRecordDone(int index)
 
 void QUnpluck::SetPageID(int index, int page_id)
 {
+    if (!mIndexing)
+        return;
+
     for (int pos = 0; pos < mRecords.count(); ++pos) {
         if (mRecords[pos]->index == index) {
             mRecords[pos]->page_id = page_id;
@@ -310,6 +342,93 @@ QImage QUnpluck::TranscribeImageRecord(unsigned char *bytes)
     return image;
 }
 
+void QUnpluck::InsertImage(Context *context, int index)
+{
+    QTextImageFormat format;
+    format.merge(context->cursor->charFormat());
+    format.setName(QStringLiteral("%1.jpg").arg(index));
+    const QSize size = ImageRecordSize(index);
+    if (size.isValid()) {
+        format.setWidth(size.width());
+        format.setHeight(size.height());
+    }
+
+    const QTextCharFormat charFormat = context->cursor->charFormat();
+    context->cursor->insertImage(format);
+    context->cursor->setCharFormat(charFormat);
+    AddRecord(index);
+}
+
+// the size of the image, from the headers of its records
+QSize QUnpluck::ImageRecordSize(int index)
+{
+    plkr_DataRecordType type;
+    int data_len;
+
+    unsigned char *data = plkr_GetRecordBytes(mDocument, index, &data_len, &type);
+    if (!data || data_len < 12)
+        return QSize();
+
+    if (type == PLKR_DRTYPE_IMAGE_COMPRESSED || type == PLKR_DRTYPE_IMAGE)
+        return QSize(READ_BIGENDIAN_SHORT(&data[8]), READ_BIGENDIAN_SHORT(&data[10]));
+
+    if (type != PLKR_DRTYPE_MULTIIMAGE)
+        return QSize();
+
+    // the cells of the first row are as wide as the image, the ones of the
+    // first column as high
+    const int cols = READ_BIGENDIAN_SHORT(&data[8]);
+    const int rows = READ_BIGENDIAN_SHORT(&data[10]);
+    if (data_len < 12 + 2 * cols * rows)
+        return QSize();
+
+    QVector<int> cells(cols * rows);
+    for (int i = 0; i < cells.count(); ++i)
+        cells[i] = READ_BIGENDIAN_SHORT(&data[12 + 2 * i]);
+
+    int width = 0;
+    int height = 0;
+    for (int i = 0; i < cells.count(); ++i) {
+        if (i >= cols && i % cols != 0)
+            continue;
+
+        unsigned char *cell = plkr_GetRecordBytes(mDocument, cells[i], &data_len, &type);
+        if (!cell || data_len < 12)
+            return QSize();
+        if (i < cols)
+            width += READ_BIGENDIAN_SHORT(&cell[8]);
+        if (i % cols == 0)
+            height += READ_BIGENDIAN_SHORT(&cell[10]);
+    }
+
+    return QSize(width, height);
+}
+
+QImage QUnpluck::ImageRecord(int index)
+{
+    if (const QImage *cached = mImages.object(index))
+        return *cached;
+
+    plkr_DataRecordType type;
+    int data_len;
+
+    QImage image;
+    unsigned char *data = plkr_GetRecordBytes(mDocument, index, &data_len, &type);
+    if (!data)
+        return image;
+
+    if (type == PLKR_DRTYPE_IMAGE_COMPRESSED || type == PLKR_DRTYPE_IMAGE)
+        image = TranscribeImageRecord(data);
+    else if (type == PLKR_DRTYPE_MULTIIMAGE)
+        TranscribeMultiImageRecord(mDocument, image, data);
+    // the records are trimmed by page(), a page may be transcribed right now
+
+    if (!image.isNull())
+        mImages.insert(index, new QImage(image), qMax(1, int(image.sizeInBytes() / 1024)));
+
+    return image;
+}
+
 void QUnpluck::DoStyle(Context *context, int style, bool start)
 {
     if (start) {
@@ -547,13 +666,8 @@ bool QUnpluck::TranscribeTableRecord(plkr_Document *doc, Context *context, unsig
                              align_names[align], colspan, rowspan );
 //                                     border_color);
 */
-                    if ((record_id = READ_BIGENDIAN_SHORT(&ptr[3]))) {
-                        QTextCharFormat format = context->cursor->charFormat();
-                        context->cursor->insertImage(QStringLiteral("%1.jpg").arg(record_id));
-                        context->cursor->setCharFormat(format);
-                        context->images.append(record_id);
-                        AddRecord(record_id);
-                    }
+                    if ((record_id = READ_BIGENDIAN_SHORT(&ptr[3])))
+                        InsertImage(context, record_id);
                     DoStyle(context, style, true);
                     text_len = READ_BIGENDIAN_SHORT(&ptr[7]);
                     ptr += fclen;
@@ -674,7 +788,8 @@ bool QUnpluck::TranscribeTextRecord(plkr_Document *doc, int id, Context *context
         context->cursor->insertBlock(blockFormat);
         context->cursor->setCharFormat(format);
 
-        mNamedTargets.insert(QStringLiteral("para:%1-%2").arg(record_index).arg(para_index), QPair<int, QTextBlock>(GetPageID(record_index), context->cursor->block()));
+        if (mIndexing)
+            context->targets.append(qMakePair(QStringLiteral("para:%1-%2").arg(record_index).arg(para_index), context->cursor->block()));
 
         current_link = false;
 
@@ -719,7 +834,7 @@ bool QUnpluck::TranscribeTextRecord(plkr_Document *doc, int id, Context *context
                             if (!context->stack.isEmpty())
                                 context->cursor->setCharFormat(context->stack.pop());
 
-                            if (!context->linkUrl.isEmpty()) {
+                            if (mIndexing && !context->linkUrl.isEmpty()) {
                                 Link link;
                                 link.url = context->linkUrl;
                                 link.start = context->linkStart;
@@ -910,11 +1025,7 @@ bool QUnpluck::TranscribeTextRecord(plkr_Document *doc, int id, Context *context
                     //                         (ptr[0] << 16) + (ptr[1] << 8) + ptr[2];
 
                 } else if (fctype == PLKR_TFC_IMAGE || fctype == PLKR_TFC_IMAGE2) {
-                    QTextCharFormat format = context->cursor->charFormat();
-                    context->cursor->insertImage(QStringLiteral("%1.jpg").arg((ptr[0] << 8) + ptr[1]));
-                    context->images.append((ptr[0] << 8) + ptr[1]);
-                    context->cursor->setCharFormat(format);
-                    AddRecord((ptr[0] << 8) + ptr[1]);
+                    InsertImage(context, (ptr[0] << 8) + ptr[1]);
 
                 } else if (fctype == PLKR_TFC_TABLE) {
                     int record_id, datalen;
@@ -976,6 +1087,44 @@ bool QUnpluck::TranscribeTextRecord(plkr_Document *doc, int id, Context *context
     return true;
 }
 
+QTextDocument *QUnpluck::TranscribePage(int index, bool *status)
+{
+    plkr_DataRecordType type;
+    int data_len;
+
+    unsigned char *data = plkr_GetRecordBytes(mDocument, index, &data_len, &type);
+    if (!data || !(type == PLKR_DRTYPE_TEXT_COMPRESSED || type == PLKR_DRTYPE_TEXT)) {
+        *status = false;
+        return nullptr;
+    }
+
+    QTextDocument *document = new PageDocument(this);
+
+    QTextFrameFormat format(document->rootFrame()->frameFormat());
+    format.setMargin(20);
+    document->rootFrame()->setFrameFormat(format);
+
+    Context context;
+    context.recordId = index;
+    context.document = document;
+    context.cursor = new QTextCursor(document);
+
+    QTextCharFormat charFormat;
+    charFormat.setFontPointSize(10);
+    charFormat.setFontFamily(QStringLiteral("Helvetica"));
+    context.cursor->setCharFormat(charFormat);
+
+    *status = TranscribeTextRecord(mDocument, index, &context, data, type);
+    document->setTextWidth(600);
+
+    delete context.cursor;
+
+    for (const QPair<QString, QTextBlock> &target : qAsConst(context.targets))
+        mNamedTargets.insert(target.first, qMakePair(index, blockPosition(document, target.second)));
+
+    return document;
+}
+
 bool QUnpluck::TranscribeRecord(int index)
 {
     plkr_DataRecordType type;
@@ -989,41 +1138,19 @@ bool QUnpluck::TranscribeRecord(int index)
     }
 
     if (type == PLKR_DRTYPE_TEXT_COMPRESSED || type == PLKR_DRTYPE_TEXT) {
-        QTextDocument *document = new QTextDocument;
-
-        QTextFrameFormat format(document->rootFrame()->frameFormat());
-        format.setMargin(20);
-        document->rootFrame()->setFrameFormat(format);
-
-        Context *context = new Context;
-        context->recordId = index;
-        context->document = document;
-        context->cursor = new QTextCursor(document);
-
-        QTextCharFormat charFormat;
-        charFormat.setFontPointSize(10);
-        charFormat.setFontFamily(QStringLiteral("Helvetica"));
-        context->cursor->setCharFormat(charFormat);
-
-        status = TranscribeTextRecord(mDocument, index, context, data, type);
-        document->setTextWidth(600);
-
-        delete context->cursor;
-        mContext.append(context);
-    } else if (type == PLKR_DRTYPE_IMAGE_COMPRESSED || type == PLKR_DRTYPE_IMAGE) {
-        QImage image = TranscribeImageRecord(data);
-        mImages.insert(index, image);
-    } else if (type == PLKR_DRTYPE_MULTIIMAGE) {
-        QImage image;
-        if (TranscribeMultiImageRecord(mDocument, image, data))
-            mImages.insert(index, image);
-    } else {
+        // only measured, page() does it again when it is shown
+        QTextDocument *document = TranscribePage(index, &status);
+        mPageRecords.append(index);
+        mPageSizes.append(document->size());
+        delete document;
+    } else if (type != PLKR_DRTYPE_IMAGE_COMPRESSED && type != PLKR_DRTYPE_IMAGE && type != PLKR_DRTYPE_MULTIIMAGE) {
         status = false;
     }
 
     // plkr_GetHomeRecordID (doc)))
 
     MarkRecordDone(index);
+    plkr_TrimRecordCache(mDocument, recordsBudget);
 
     return status;
 }
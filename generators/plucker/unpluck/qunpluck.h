@@ -9,10 +9,14 @@
 #ifndef QUNPLUCK_H
 #define QUNPLUCK_H
 
+#include <QCache>
 #include <QImage>
 #include <QList>
 #include <QMap>
+#include <QPointF>
+#include <QSizeF>
 #include <QTextBlock>
+#include <QVector>
 
 #include "unpluck.h"
 
@@ -42,6 +46,15 @@ public:
     int end;
 };
 
+/**
+ * Reads a Plucker document.
+ *
+ * Opening it goes through all its records once, to know the pages, their
+ * size and their links, without keeping them. The pages are transcribed
+ * again by page() when they are needed, their images are only decoded once
+ * painted. The document stays open for that, with at most recordsBudget
+ * bytes of decompressed records.
+ */
 class QUnpluck
 {
 public:
@@ -53,10 +66,19 @@ public:
 
     bool open(const QString &fileName);
 
-    QList<QTextDocument *> pages() const
+    int pageCount() const
     {
-        return mPages;
+        return mPageRecords.count();
     }
+    QSizeF pageSize(int page) const
+    {
+        return mPageSizes.at(page);
+    }
+    /**
+     * Transcribes @p page into a new document, owned by the caller.
+     */
+    QTextDocument *page(int page);
+
     Link::List links() const
     {
         return mLinks;
@@ -67,6 +89,8 @@ public:
     }
 
 private:
+    friend class PageDocument;
+
     int GetNextRecordNumber();
     int GetPageID(int index);
     void AddRecord(int index);
@@ -74,7 +98,11 @@ private:
     void SetPageID(int index, int page_id);
     QString MailtoURLFromBytes(unsigned char *record_data);
     void DoStyle(Context *context, int style, bool start);
+    void InsertImage(Context *context, int index);
+    QTextDocument *TranscribePage(int index, bool *status);
     bool TranscribeRecord(int index);
+    QSize ImageRecordSize(int index);
+    QImage ImageRecord(int index);
     QImage TranscribeImageRecord(unsigned char *bytes);
     bool TranscribeTableRecord(plkr_Document *doc, Context *context, unsigned char *bytes);
     bool TranscribeTextRecord(plkr_Document *doc, int id, Context *context, unsigned char *bytes, plkr_DataRecordType type);
@@ -82,11 +110,15 @@ private:
 
     plkr_Document *mDocument;
     QList<RecordNode *> mRecords;
-
-    QList<Context *> mContext;
-    QList<QTextDocument *> mPages;
-    QMap<QString, QPair<int, QTextBlock>> mNamedTargets;
-    QMap<int, QImage> mImages;
+    // while open() goes through the records, the pages transcribed later
+    // don't add records, links or targets again
+    bool mIndexing;
+
+    QVector<int> mPageRecords;
+    QVector<QSizeF> mPageSizes;
+    // the page record of the paragraphs, and where they are on it
+    QMap<QString, QPair<int, QPointF>> mNamedTargets;
+    QCache<int, QImage> mImages;
     QMap<QString, QString> mInfo;
     QString mErrorString;
     Link::List mLinks;
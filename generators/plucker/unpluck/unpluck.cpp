@@ -334,6 +334,7 @@ static int ParseCategories(plkr_Document *newdoc, plkr_DBHandle handle)
         /* keep the record data, since the list of char * ptrs will point into it */
         record->cache = buf;
         record->cached_size = bufsize;
+        record->pinned = TRUE;
         categories = nullptr;
         for (ptr = buf + 8; (ptr - buf) < bufsize;) {
             newc = (struct _plkr_CategoryName *)malloc(sizeof(struct _plkr_CategoryName));
@@ -469,6 +470,7 @@ static int ParseURLs(plkr_Document *newdoc, plkr_DBHandle handle)
         }
         record->cache = buf;
         record->cached_size = bufsize;
+        record->pinned = TRUE;
         buf = nullptr;
         for (ptr = record->cache + 8; (ptr - record->cache) < record->cached_size; ptr += (strlen((char *)ptr) + 1)) {
 #ifdef DEBUGURLS
@@ -835,12 +837,47 @@ unsigned char *plkr_GetRecordBytes(plkr_Document *doc, int record_index, int *si
         if (!record->cache) {
             record->cache = buf;
             record->cached_size = *size;
+            doc->cache_size += *size;
         }
+        record->last_use = ++doc->use_clock;
         *type = record->type;
         return buf;
     }
 }
 
+static int CompareLastUse(const void *a, const void *b)
+{
+    const plkr_DataRecord *ra = *(const plkr_DataRecord *const *)a;
+    const plkr_DataRecord *rb = *(const plkr_DataRecord *const *)b;
+    return (ra->last_use > rb->last_use) - (ra->last_use < rb->last_use);
+}
+
+void plkr_TrimRecordCache(plkr_Document *doc, int max_size)
+{
+    plkr_DataRecord **cached;
+    int ncached = 0;
+    int i;
+
+    if (doc->cache_size <= max_size)
+        return;
+
+    cached = (plkr_DataRecord **)malloc(doc->nrecords * sizeof(plkr_DataRecord *));
+    for (i = 0; i < doc->nrecords; i++) {
+        if (doc->records[i].cache != nullptr && !doc->records[i].pinned)
+            cached[ncached++] = &doc->records[i];
+    }
+    qsort(cached, ncached, sizeof(plkr_DataRecord *), CompareLastUse);
+
+    /* down to half of it, so the next records don't trim again right away */
+    for (i = 0; i < ncached && doc->cache_size > max_size / 2; i++) {
+        doc->cache_size -= cached[i]->cached_size;
+        free(cached[i]->cache);
+        cached[i]->cache = nullptr;
+        cached[i]->cached_size = 0;
+    }
+    free(cached);
+}
+
 int plkr_GetHomeRecordID(plkr_Document *doc)
 {
     return doc->home_record_uid;
@@ -146,7 +146,8 @@ int plkr_GetUidForIndex(plkr_Document *, int /* record_index */
 
    Retrieve a static pointer to a buffer containing the uncompressed
    data of the specified record.  This causes the buffer to be cached
-   by the implementation; do not free() the returned pointer!  The
+   by the implementation; do not free() the returned pointer!  It stays
+   valid until the next call to plkr_TrimRecordCache.  The
    size of the buffer is returned through the "size" parameter; the
    type of the record is returned through the "type" parameter.
    May return NULL if the "record_index" value is out-of-range.
@@ -154,6 +155,15 @@ int plkr_GetUidForIndex(plkr_Document *, int /* record_index */
 unsigned char *plkr_GetRecordBytes(plkr_Document *, int /* record_index */, int * /* output: size */, plkr_DataRecordType * /* output: type */
 );
 
+/* plkr_TrimRecordCache
+
+   Free the cached buffers of the records least recently retrieved with
+   plkr_GetRecordBytes, when they take more than "max_size" bytes.  The
+   pointers it returned before may no longer be valid afterwards.
+*/
+void plkr_TrimRecordCache(plkr_Document *, int /* max_size */
+);
+
 /* plkr_GetRecordURL
 
    Retrieve a static pointer to the URL string for the specified record.
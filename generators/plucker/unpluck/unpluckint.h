@@ -64,6 +64,8 @@ struct plkr_DataRecord_s {
     int nparagraphs;
     plkr_DataRecordType type;
     unsigned char *cache; /* cache of uncompressed full record */
+    int pinned;           /* cache is pointed into by the document, never trimmed */
+    unsigned int last_use; /* when the cache was last handed out, for trimming */
     int charset_mibenum;
 };
 
@@ -90,6 +92,8 @@ struct plkr_Document_s {
     int default_charset_mibenum;
     int owner_id_required; /* 1 for yes, 0 for no */
     unsigned char owner_id_key[40];
+    int cache_size;          /* bytes in the caches which can be trimmed */
+    unsigned int use_clock;  /* counts the records handed out */
 };
 
 /***********************************************************************/
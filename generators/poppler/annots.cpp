@@ -53,9 +53,9 @@ static int maskExportedFlags(int flags)
 }
 
 // BEGIN PopplerAnnotationProxy implementation
-PopplerAnnotationProxy::PopplerAnnotationProxy(Poppler::Document *doc, QMutex *userMutex, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash)
+PopplerAnnotationProxy::PopplerAnnotationProxy(Poppler::Document *doc, const Okular::Generator *pdfGenerator, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash)
     : ppl_doc(doc)
-    , mutex(userMutex)
+    , generator(pdfGenerator)
     , annotationsOnOpenHash(annotsOnOpenHash)
 {
 }
@@ -429,7 +429,7 @@ static Poppler::Annotation *createPopplerAnnotationFromOkularAnnotation(const Ok
 }
 void PopplerAnnotationProxy::notifyAddition(Okular::Annotation *okl_ann, int page)
 {
-    QMutexLocker ml(mutex);
+    Okular::UserMutexLocker ml(generator, Okular::Generator::AnnotationsSite);
 
     // Create poppler annotation
     Poppler::Annotation *ppl_ann = nullptr;
@@ -486,7 +486,7 @@ void PopplerAnnotationProxy::notifyModification(const Okular::Annotation *okl_an
     if (!ppl_ann) // Ignore non-native annotations
         return;
 
-    QMutexLocker ml(mutex);
+    Okular::UserMutexLocker ml(generator, Okular::Generator::AnnotationsSite);
 
     if (okl_ann->flags() & (Okular::Annotation::BeingMoved | Okular::Annotation::BeingResized)) {
         // Okular ui already renders the annotation on its own
@@ -558,7 +558,7 @@ void PopplerAnnotationProxy::notifyRemoval(Okular::Annotation *okl_ann, int page
     if (!ppl_ann) // Ignore non-native annotations
         return;
 
-    QMutexLocker ml(mutex);
+    Okular::UserMutexLocker ml(generator, Okular::Generator::AnnotationsSite);
 
     Poppler::Page *ppl_page = ppl_doc->page(page);
     annotationsOnOpenHash->remove(okl_ann);
@@ -13,17 +13,20 @@
 #include <poppler-annotation.h>
 #include <poppler-qt5.h>
 
-#include <QMutex>
-
 #include "config-okular-poppler.h"
 #include "core/annotations.h"
 
+namespace Okular
+{
+class Generator;
+}
+
 extern Okular::Annotation *createAnnotationFromPopplerAnnotation(Poppler::Annotation *popplerAnnotation, const Poppler::Page &popplerPage, bool *doDelete);
 
 class PopplerAnnotationProxy : public Okular::AnnotationProxy
 {
 public:
-    PopplerAnnotationProxy(Poppler::Document *doc, QMutex *userMutex, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash);
+    PopplerAnnotationProxy(Poppler::Document *doc, const Okular::Generator *pdfGenerator, QHash<Okular::Annotation *, Poppler::Annotation *> *annotsOnOpenHash);
     ~PopplerAnnotationProxy() override;
 
     bool supports(Capability capability) const override;
@@ -33,7 +36,8 @@ public:
 
 private:
     Poppler::Document *ppl_doc;
-    QMutex *mutex;
+    // whose user mutex guards ppl_doc
+    const Okular::Generator *generator;
     QHash<Okular::Annotation *, Poppler::Annotation *> *annotationsOnOpenHash;
 };
 
@@ -0,0 +1,183 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "documentpool.h"
+
+#include <QFileInfo>
+#include <QMutexLocker>
+
+#include "debug_pdf.h"
+
+// one for each pixmap generation thread of the core, the text and the fonts
+static const int maxPoolDocuments = 8;
+
+// the hints the generator sets, see PDFGenerator::setDocumentRenderHints()
+static const Poppler::Document::RenderHint poolRenderHints[] = {
+    Poppler::Document::Antialiasing,
+    Poppler::Document::TextAntialiasing,
+    Poppler::Document::TextHinting,
+    Poppler::Document::ThinLineSolid,
+    Poppler::Document::ThinLineShape,
+};
+
+PopplerDocumentPool::PopplerDocumentPool()
+    : m_pageCount(0)
+    , m_opening(0)
+    , m_usable(false)
+    , m_generation(0)
+{
+}
+
+PopplerDocumentPool::~PopplerDocumentPool()
+{
+    clear();
+}
+
+void PopplerDocumentPool::setSource(const QString &fileName, const QByteArray &data, const QByteArray &password, int pageCount)
+{
+    clear();
+
+    QMutexLocker locker(&m_mutex);
+    m_fileName = fileName;
+    m_fileModified = fileName.isEmpty() ? QDateTime() : QFileInfo(fileName).lastModified();
+    m_data = data;
+    m_password = password;
+    m_pageCount = pageCount;
+    m_modifiedPages.fill(false, pageCount);
+    m_usable = true;
+}
+
+void PopplerDocumentPool::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    deleteFreeDocuments();
+    // the ones in use are deleted when they come back
+    m_documents.clear();
+    m_fileName.clear();
+    m_data.clear();
+    m_password.clear();
+    m_modifiedPages.clear();
+    m_usable = false;
+    ++m_generation;
+}
+
+void PopplerDocumentPool::setRenderSettings(Poppler::Document::RenderHints renderHints, const QColor &paperColor)
+{
+    QMutexLocker locker(&m_mutex);
+    m_renderHints = renderHints;
+    m_paperColor = paperColor;
+}
+
+Poppler::Document *PopplerDocumentPool::acquire(int page)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_usable || page < 0 || page >= m_modifiedPages.count() || m_modifiedPages.testBit(page))
+        return nullptr;
+
+    Poppler::Document *document = nullptr;
+    if (!m_freeDocuments.isEmpty()) {
+        document = m_freeDocuments.takeLast();
+    } else {
+        if (m_documents.count() + m_opening >= maxPoolDocuments)
+            return nullptr;
+
+        // opening reads the whole cross reference table, don't keep the others waiting
+        const QString fileName = m_fileName;
+        const QByteArray data = m_data;
+        const QByteArray password = m_password;
+        const int generation = m_generation;
+        ++m_opening;
+        locker.unlock();
+        document = open(fileName, data, password);
+        locker.relock();
+        --m_opening;
+
+        if (generation != m_generation) {
+            delete document;
+            return nullptr;
+        }
+        if (!document || document->numPages() != m_pageCount || (!m_fileName.isEmpty() && QFileInfo(m_fileName).lastModified() != m_fileModified)) {
+            // the file is not what the generator opened anymore, stick to its document
+            qCDebug(OkularPdfDebug) << "Could not open a copy of the document, rendering in one thread";
+            delete document;
+            m_usable = false;
+            deleteFreeDocuments();
+            return nullptr;
+        }
+        m_documents.append(document);
+    }
+
+    for (const Poppler::Document::RenderHint hint : poolRenderHints)
+        document->setRenderHint(hint, m_renderHints.testFlag(hint));
+    if (document->paperColor() != m_paperColor)
+        document->setPaperColor(m_paperColor);
+    return document;
+}
+
+void PopplerDocumentPool::release(Poppler::Document *document)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_usable || !m_documents.contains(document)) {
+        m_documents.removeOne(document);
+        delete document;
+        return;
+    }
+
+    m_freeDocuments.append(document);
+}
+
+PopplerDocumentPool::Source PopplerDocumentPool::source() const
+{
+    QMutexLocker locker(&m_mutex);
+    return Source {m_fileName, m_fileModified, m_data, m_password, m_pageCount};
+}
+
+Poppler::Document *PopplerDocumentPool::openDetached(const Source &source)
+{
+    if (source.fileName.isEmpty() && source.data.isEmpty())
+        return nullptr;
+
+    Poppler::Document *document = open(source.fileName, source.data, source.password);
+    if (document && (document->numPages() != source.pageCount || (!source.fileName.isEmpty() && QFileInfo(source.fileName).lastModified() != source.fileModified))) {
+        delete document;
+        return nullptr;
+    }
+    return document;
+}
+
+void PopplerDocumentPool::pageModified(int page)
+{
+    QMutexLocker locker(&m_mutex);
+    if (page >= 0 && page < m_modifiedPages.count())
+        m_modifiedPages.setBit(page);
+}
+
+void PopplerDocumentPool::allPagesModified()
+{
+    QMutexLocker locker(&m_mutex);
+    m_usable = false;
+    deleteFreeDocuments();
+}
+
+Poppler::Document *PopplerDocumentPool::open(const QString &fileName, const QByteArray &data, const QByteArray &password)
+{
+    Poppler::Document *document = fileName.isEmpty() ? Poppler::Document::loadFromData(data, nullptr, nullptr) : Poppler::Document::load(fileName, nullptr, nullptr);
+    if (document && document->isLocked())
+        document->unlock(password, password);
+    if (document && document->isLocked()) {
+        delete document;
+        return nullptr;
+    }
+    return document;
+}
+
+void PopplerDocumentPool::deleteFreeDocuments()
+{
+    for (Poppler::Document *document : qAsConst(m_freeDocuments))
+        m_documents.removeOne(document);
+    qDeleteAll(m_freeDocuments);
+    m_freeDocuments.clear();
+}
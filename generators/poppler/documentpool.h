@@ -0,0 +1,121 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_GENERATOR_PDF_DOCUMENTPOOL_H_
+#define _OKULAR_GENERATOR_PDF_DOCUMENTPOOL_H_
+
+#include <poppler-qt5.h>
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QColor>
+#include <QDateTime>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+/**
+ * Copies of the document the generator opened, opened again from the same
+ * file or data, for the work that only reads the document: rendering, text
+ * extraction and font scanning go through them at the same time instead of
+ * waiting for each other on the one document behind the user mutex.
+ *
+ * The copies only know the document as it is in the file. Once the
+ * annotations or the forms of a page are changed in the document of the
+ * generator, that page is no longer handed a copy, and once the visibility
+ * of the layers changes no page is. The copies are opened as they are
+ * needed, all the methods can be called from any thread.
+ */
+class PopplerDocumentPool
+{
+public:
+    PopplerDocumentPool();
+    ~PopplerDocumentPool();
+
+    /**
+     * Opens the copies from @p fileName, or from @p data if the file name is
+     * empty, unlocked with @p password. @p pageCount is the number of pages
+     * of the document of the generator.
+     */
+    void setSource(const QString &fileName, const QByteArray &data, const QByteArray &password, int pageCount);
+
+    /**
+     * Deletes the copies, none is handed out until the next source is set.
+     */
+    void clear();
+
+    /**
+     * The render hints and paper color of the document of the generator,
+     * the copies get them when they are acquired.
+     */
+    void setRenderSettings(Poppler::Document::RenderHints renderHints, const QColor &paperColor);
+
+    /**
+     * Returns a copy that nobody else uses to work on @p page, or nullptr if
+     * the page has to be read from the document of the generator.
+     */
+    Poppler::Document *acquire(int page);
+
+    /**
+     * Gives back a copy returned by acquire().
+     */
+    void release(Poppler::Document *document);
+
+    /**
+     * What the copies are opened from.
+     */
+    struct Source {
+        QString fileName;
+        QDateTime fileModified;
+        QByteArray data;
+        QByteArray password;
+        int pageCount;
+    };
+    Source source() const;
+
+    /**
+     * Opens a copy from @p source that no pool keeps, for the work that may
+     * go on after the document of the generator is closed. The caller
+     * deletes it. Returns nullptr if the file changed since.
+     */
+    static Poppler::Document *openDetached(const Source &source);
+
+    /**
+     * @p page was changed in the document of the generator.
+     */
+    void pageModified(int page);
+
+    /**
+     * All the pages look different in the document of the generator.
+     */
+    void allPagesModified();
+
+private:
+    Q_DISABLE_COPY(PopplerDocumentPool)
+
+    static Poppler::Document *open(const QString &fileName, const QByteArray &data, const QByteArray &password);
+    void deleteFreeDocuments();
+
+    mutable QMutex m_mutex;
+    QString m_fileName;
+    QDateTime m_fileModified;
+    QByteArray m_data;
+    QByteArray m_password;
+    int m_pageCount;
+    Poppler::Document::RenderHints m_renderHints;
+    QColor m_paperColor;
+    // the copies that are open, in use or not
+    QVector<Poppler::Document *> m_documents;
+    QVector<Poppler::Document *> m_freeDocuments;
+    // copies being opened, they count for the limit already
+    int m_opening;
+    QBitArray m_modifiedPages;
+    bool m_usable;
+    // bumped by every source, copies of an older one are deleted when they come back
+    int m_generation;
+};
+
+#endif
@@ -393,7 +393,16 @@ PopplerFormFieldSignature::PopplerFormFieldSignature(std::unique_ptr<Poppler::Fo
 {
     m_rect = Okular::NormalizedRect::fromQRectF(m_field->rect());
     m_id = m_field->id();
-    m_info = new PopplerSignatureInfo(m_field->validate(Poppler::FormFieldSignature::ValidateVerifyCertificate));
+
+    const Poppler::SignatureValidationInfo info = m_field->validate(Poppler::FormFieldSignature::ValidateOptions(0));
+    m_cacheKey = PopplerSignatureCache::key(info);
+    m_info = new PopplerSignatureInfo(info);
+    // the digest was just checked against the bytes of this file, a cached
+    // verification may be of another file with the same signature
+    Poppler::SignatureValidationInfo verifiedInfo = info;
+    m_certificateVerified = PopplerSignatureCache::find(m_cacheKey, &verifiedInfo);
+    if (m_certificateVerified)
+        m_info->setCertificateInfo(verifiedInfo);
     SET_ACTIONS
 }
 
@@ -455,3 +464,19 @@ const Okular::SignatureInfo &PopplerFormFieldSignature::signatureInfo() const
 {
     return *m_info;
 }
+
+bool PopplerFormFieldSignature::certificateVerified() const
+{
+    return m_certificateVerified;
+}
+
+QByteArray PopplerFormFieldSignature::cacheKey() const
+{
+    return m_cacheKey;
+}
+
+void PopplerFormFieldSignature::setVerifiedInfo(const Poppler::SignatureValidationInfo &info)
+{
+    m_info->setInfo(info);
+    m_certificateVerified = true;
+}
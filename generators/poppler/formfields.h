@@ -121,6 +121,8 @@ private:
     int m_id;
 };
 
+class PopplerSignatureInfo;
+
 class PopplerFormFieldSignature : public Okular::FormFieldSignature
 {
 public:
@@ -140,9 +142,17 @@ public:
     SignatureType signatureType() const override;
     const Okular::SignatureInfo &signatureInfo() const override;
 
+    // the info is first the one of a validation without the certificate, the
+    // generator verifies it in the background unless it was seen already
+    bool certificateVerified() const;
+    QByteArray cacheKey() const;
+    void setVerifiedInfo(const Poppler::SignatureValidationInfo &info);
+
 private:
     std::unique_ptr<Poppler::FormFieldSignature> m_field;
-    Okular::SignatureInfo *m_info;
+    PopplerSignatureInfo *m_info;
+    QByteArray m_cacheKey;
+    bool m_certificateVerified;
     Okular::NormalizedRect m_rect;
     int m_id;
 };
@@ -20,17 +20,23 @@
 #include <QComboBox>
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QFileInfo>
 #include <QImage>
 #include <QLayout>
 #include <QMutex>
 #include <QPainter>
 #include <QPrinter>
+#include <QSet>
 #include <QStack>
 #include <QTemporaryFile>
 #include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
 #include <QTimeZone>
-#include <QTimer>
+#include <QTransform>
+#include <QWaitCondition>
 
 #include <KAboutData>
 #include <KConfigDialog>
@@ -40,6 +46,7 @@
 #include <core/action.h>
 #include <core/annotations.h>
 #include <core/fileprinter.h>
+#include <core/functiontask_p.h>
 #include <core/movie.h>
 #include <core/page.h>
 #include <core/pagetransition.h>
@@ -63,6 +70,7 @@
 #include "pdfsignatureutils.h"
 #include "popplerembeddedfile.h"
 
+#include <cstring>
 #include <functional>
 
 Q_DECLARE_METATYPE(Poppler::Annotation *)
@@ -75,6 +83,58 @@ Q_DECLARE_METATYPE(const Poppler::LinkOCGState *)
 
 static const int defaultPageWidth = 595;
 static const int defaultPageHeight = 842;
+// documents with more pages get the annotations, transition and actions of
+// the pages after opening, through loadPageData()
+static const int lazyPageDataMinimumPages = 500;
+// how long opening creates pages for, the others come through loadMorePages()
+static const int openPagesTime = 100; // in msec
+// how long a slice of loadMorePages() creates pages for
+static const int morePagesSliceTime = 30; // in msec
+// the resolution the pages are rendered at to see whether they changed when reloading
+static const int fingerprintDpi = 36;
+// how many signatures have their certificates verified at once
+static const int maxSignatureVerifiers = 2;
+
+namespace
+{
+// the certificate checks of all the generators, the pool is left to the end of
+// the process so that nothing waits for the checks that go to the network
+QThreadPool *signatureVerifiers()
+{
+    static QThreadPool *pool = [] {
+        QThreadPool *verifiers = new QThreadPool;
+        verifiers->setMaxThreadCount(maxSignatureVerifiers);
+        return verifiers;
+    }();
+    return pool;
+}
+
+// the fingerprints of the pages of all the generators, one at a time, see pageFingerprint()
+QThreadPool *pageFingerprinters()
+{
+    static QThreadPool *pool = [] {
+        QThreadPool *fingerprinters = new QThreadPool;
+        fingerprinters->setMaxThreadCount(1);
+        return fingerprinters;
+    }();
+    return pool;
+}
+}
+
+struct BackgroundTaskTarget {
+    explicit BackgroundTaskTarget(PDFGenerator *generator)
+        : generator(generator)
+        , generation(0)
+    {
+    }
+
+    // held by the tasks that use the generator, so it is not deleted meanwhile
+    QMutex mutex;
+    // nullptr once the generator is gone
+    PDFGenerator *generator;
+    // the verifications of a document, the ones of the documents before have older generations
+    int generation;
+};
 
 class PDFOptionsPage : public Okular::PrintOptionsWidget
 {
@@ -518,6 +578,23 @@ static QLinkedList<Okular::ObjectRect *> generateLinks(const QList<Poppler::Link
     return links;
 }
 
+// the annotations that are Okular::Annotations, the links are object rects
+static QSet<Poppler::Annotation::SubType> okularAnnotationSubTypes()
+{
+    QSet<Poppler::Annotation::SubType> subtypes;
+    subtypes << Poppler::Annotation::AFileAttachment << Poppler::Annotation::ASound << Poppler::Annotation::AMovie << Poppler::Annotation::AWidget << Poppler::Annotation::AScreen << Poppler::Annotation::AText << Poppler::Annotation::ALine
+             << Poppler::Annotation::AGeom << Poppler::Annotation::AHighlight << Poppler::Annotation::AInk << Poppler::Annotation::AStamp << Poppler::Annotation::ACaret;
+    return subtypes;
+}
+
+// what the page looks like, never 0
+static uint pageFingerprint(Poppler::Page *page)
+{
+    const QImage image = page->renderToImage(fingerprintDpi, fingerprintDpi);
+    const uint fingerprint = qHashBits(image.constBits(), size_t(image.sizeInBytes()), uint(image.width()));
+    return fingerprint ? fingerprint : 1;
+}
+
 /** NOTES on threading:
  * internal: thread race prevention is done via the 'docLock' mutex. the
  *           mutex is needed only because we have the asynchronous thread; else
@@ -546,10 +623,15 @@ PDFGenerator::PDFGenerator(QObject *parent, const QVariantList &args)
     , pdfdoc(nullptr)
     , docSynopsisDirty(true)
     , xrefReconstructed(false)
+    , docOutlineDirty(true)
     , docEmbeddedFilesDirty(true)
     , nextFontPage(0)
+    , nextPage(0)
+    , nextVerifiedPage(0)
     , annotProxy(nullptr)
     , certStore(nullptr)
+    , backgroundTarget(new BackgroundTaskTarget(this))
+    , fingerprintGeneration(0)
 {
     setFeature(Threaded);
     setFeature(TextExtraction);
@@ -564,7 +646,12 @@ PDFGenerator::PDFGenerator(QObject *parent, const QVariantList &args)
     setFeature(ReadRawData);
     setFeature(TiledRendering);
     setFeature(SwapBackingFile);
+    setFeature(InPlaceReload);
     setFeature(SupportsCancelling);
+    setFeature(BatchedRendering);
+    setFeature(EmbeddedThumbnails);
+    // image() renders with the copies of documentPool while the pages are as in the file
+    setFeature(ParallelRendering);
 
     // You only need to do it once not for each of the documents but it is cheap enough
     // so doing it all the time won't hurt either
@@ -578,6 +665,12 @@ PDFGenerator::PDFGenerator(QObject *parent, const QVariantList &args)
 
 PDFGenerator::~PDFGenerator()
 {
+    // the verifications still running drop their results, a fingerprint
+    // being taken is waited for
+    backgroundTarget->mutex.lock();
+    backgroundTarget->generator = nullptr;
+    backgroundTarget->mutex.unlock();
+
     delete pdfOptionsPage;
     delete certStore;
 }
@@ -593,6 +686,8 @@ Okular::Document::OpenResult PDFGenerator::loadDocumentWithPassword(const QStrin
 #endif
     // create PDFDoc for the given file
     pdfdoc = Poppler::Document::load(filePath, nullptr, nullptr);
+    documentFileName = filePath;
+    documentData.clear();
     return init(pagesVector, password);
 }
 
@@ -606,6 +701,8 @@ Okular::Document::OpenResult PDFGenerator::loadDocumentFromDataWithPassword(cons
 #endif
     // create PDFDoc for the given file
     pdfdoc = Poppler::Document::loadFromData(fileData, nullptr, nullptr);
+    documentFileName.clear();
+    documentData = fileData;
     return init(pagesVector, password);
 }
 
@@ -641,18 +738,37 @@ Okular::Document::OpenResult PDFGenerator::init(QVector<Okular::Page *> &pagesVe
         pdfdoc = nullptr;
         return Okular::Document::OpenError;
     }
-    pagesVector.resize(pageCount);
+    pagesVector.clear();
     rectsGenerated.fill(false, pageCount);
+    fingerprintMutex.lock();
+    ++fingerprintGeneration;
+    pageFingerprints.fill(0, pageCount);
+    fingerprintsAsked.fill(false, pageCount);
+    fingerprintMutex.unlock();
 
     annotationsOnOpenHash.clear();
 
-    loadPages(pagesVector, 0, false);
+    // the forms stay, the document looks at all of them when opening
+    const bool lazyPageData = pageCount >= lazyPageDataMinimumPages;
+    setFeature(LazyPageData, lazyPageData);
+    pageDataLoaded.fill(!lazyPageData, pageCount);
+    nextPage = 0;
+    nextVerifiedPage = 0;
+    formFieldNames.clear();
+    // the first pages are shown while the others are created
+    setFeature(IncrementalPages, loadPages(pagesVector, openPagesTime));
 
     // update the configuration
     reparseConfig();
 
     // create annotation proxy
-    annotProxy = new PopplerAnnotationProxy(pdfdoc, userMutex(), &annotationsOnOpenHash);
+    annotProxy = new PopplerAnnotationProxy(pdfdoc, this, &annotationsOnOpenHash);
+
+    documentPool.setSource(documentFileName, documentData, password.toLatin1(), pageCount);
+    documentPool.setRenderSettings(pdfdoc->renderHints(), pdfdoc->paperColor());
+    // the copies don't know about the layers shown
+    if (pdfdoc->hasOptionalContent())
+        connect(pdfdoc->optionalContentModel(), &QAbstractItemModel::dataChanged, this, [this] { documentPool.allPagesModified(); });
 
     // the file has been loaded correctly
     return Okular::Document::OpenSuccess;
@@ -666,6 +782,8 @@ PDFGenerator::SwapBackingFileResult PDFGenerator::swapBackingFile(QString const
     auto openResult = loadDocumentWithPassword(newFileName, newPagesVector, QString());
     if (openResult != Okular::Document::OpenSuccess)
         return SwapBackingFileError;
+    // the document had all the pages of the old file
+    loadPages(newPagesVector, -1);
 
     // Recreate links if needed since they are done on image() and image() is not called when swapping the file
     // since the page is already rendered
@@ -673,6 +791,8 @@ PDFGenerator::SwapBackingFileResult PDFGenerator::swapBackingFile(QString const
         for (int i = 0; i < oldRectsGenerated.count(); ++i) {
             if (oldRectsGenerated[i]) {
                 Okular::Page *page = newPagesVector[i];
+                // media links point to the annotations of the page
+                loadPageData(page);
                 Poppler::Page *pp = pdfdoc->page(i);
                 if (pp) {
                     page->setObjectRects(generateLinks(pp->links()));
@@ -687,32 +807,207 @@ PDFGenerator::SwapBackingFileResult PDFGenerator::swapBackingFile(QString const
     return SwapBackingFileReloadInternalData;
 }
 
+bool PDFGenerator::reloadDocument(const QString &fileName, QVector<Okular::Page *> &pagesVector, QVector<int> &changedPages)
+{
+    // the pages point to the annotations and form fields of pdfdoc, those
+    // are taken care of by opening the document again
+    if (!pdfdoc || documentFileName.isEmpty() || nextPage < pdfdoc->numPages() || !annotationsOnOpenHash.isEmpty() || pdfdoc->hasOptionalContent())
+        return false;
+    for (const Okular::Page *page : qAsConst(pagesVector)) {
+        if (!page->annotations().isEmpty() || !page->formFields().isEmpty())
+            return false;
+    }
+
+    std::unique_ptr<Poppler::Document> newdoc(Poppler::Document::load(fileName, nullptr, nullptr));
+    if (!newdoc || newdoc->isLocked() || newdoc->numPages() <= 0 || newdoc->hasOptionalContent())
+        return false;
+#ifdef HAVE_POPPLER_RECONSTRUCTION_CALLBACK
+    // opening it again tells the user
+    if (newdoc->xrefWasReconstructed())
+        return false;
+#endif
+#if POPPLER_VERSION_MACRO >= QT_VERSION_CHECK(0, 89, 0)
+    const QVector<Poppler::FormFieldSignature *> signatures = newdoc->signatures();
+    qDeleteAll(signatures);
+    if (!signatures.isEmpty())
+        return false;
+#endif
+
+    // rendered like pdfdoc, for the fingerprints to compare
+    const Poppler::Document::RenderHints renderHints = pdfdoc->renderHints();
+    // the hints are in the low bits
+    for (int bit = 0; bit < 16; ++bit) {
+        const Poppler::Document::RenderHint hint = Poppler::Document::RenderHint(1 << bit);
+        newdoc->setRenderHint(hint, renderHints.testFlag(hint));
+    }
+    newdoc->setPaperColor(pdfdoc->paperColor());
+
+    fingerprintMutex.lock();
+    const QVector<uint> oldFingerprints = pageFingerprints;
+    fingerprintMutex.unlock();
+
+    const QSet<Poppler::Annotation::SubType> annotationSubTypes = okularAnnotationSubTypes();
+    const int oldCount = pagesVector.count();
+    const int count = newdoc->numPages();
+    const int keptCount = qMin(oldCount, count);
+    // the pages rendered before are compared in the background, see fingerprintPage()
+    QVector<int> comparedPages;
+    for (int i = 0; i < count; ++i) {
+        std::unique_ptr<Poppler::Page> p(newdoc->page(i));
+        if (!p)
+            return false;
+
+        const QList<Poppler::Annotation *> annotations = p->annotations(annotationSubTypes);
+        const QList<Poppler::FormField *> formFields = p->formFields();
+        const bool hasAnnotationsOrForms = !annotations.isEmpty() || !formFields.isEmpty();
+        qDeleteAll(annotations);
+        qDeleteAll(formFields);
+        if (hasAnnotationsOrForms)
+            return false;
+        if (i >= keptCount)
+            continue;
+
+        // the kept pages need the same size
+        const Okular::Page *page = pagesVector.at(i);
+        const QSizeF pSize = p->pageSizeF();
+        double w = page->width(), h = page->height();
+        if (page->rotation() % 2 == 1)
+            qSwap(w, h);
+        if (!qFuzzyCompare(w, pSize.width() / 72.0 * dpi().width()) || !qFuzzyCompare(h, pSize.height() / 72.0 * dpi().height()))
+            return false;
+
+        // the pages never rendered have nothing to keep
+        if (oldFingerprints.value(i))
+            comparedPages.append(i);
+        else
+            changedPages.append(i);
+    }
+
+    Okular::UserMutexLocker locker(this, OtherSite);
+    documentPool.clear();
+    delete annotProxy;
+    delete pdfdoc;
+    pdfdoc = newdoc.release();
+    annotProxy = new PopplerAnnotationProxy(pdfdoc, this, &annotationsOnOpenHash);
+    documentFileName = fileName;
+    documentPool.setSource(documentFileName, QByteArray(), QByteArray(), count);
+    documentPool.setRenderSettings(pdfdoc->renderHints(), pdfdoc->paperColor());
+    xrefReconstructed = false;
+#ifdef HAVE_POPPLER_RECONSTRUCTION_CALLBACK
+    std::function<void()> cb = std::bind(&PDFGenerator::xrefReconstructionHandler, this);
+    pdfdoc->setXRefReconstructedCallback(cb);
+#endif
+    docSynopsisDirty = true;
+    docSyn.clear();
+    docOutlineDirty = true;
+    docOutline.clear();
+    docEmbeddedFilesDirty = true;
+    qDeleteAll(docEmbeddedFiles);
+    docEmbeddedFiles.clear();
+    nextFontPage = 0;
+    fingerprintMutex.lock();
+    ++fingerprintGeneration;
+    pageFingerprints.fill(0, count);
+    fingerprintsAsked.fill(false, count);
+    fingerprintMutex.unlock();
+
+    // the links, labels and actions of the kept pages may have changed all the same
+    pagesVector.resize(keptCount);
+    for (Okular::Page *page : qAsConst(pagesVector)) {
+        const int i = page->number();
+        std::unique_ptr<Poppler::Page> p(pdfdoc->page(i));
+        page->setLabel(p->label());
+        page->setDuration(p->duration());
+        if (pageDataLoaded.testBit(i)) {
+            page->setTransition(nullptr);
+            page->setPageAction(Okular::Page::Opening, nullptr);
+            page->setPageAction(Okular::Page::Closing, nullptr);
+            addPageData(p.get(), page);
+        }
+        // the changed pages get them when rendered
+        if (rectsGenerated.testBit(i) && !changedPages.contains(i)) {
+            page->setObjectRects(generateLinks(p->links()));
+            resolveMediaLinkReferences(page);
+        } else {
+            page->setObjectRects(QLinkedList<Okular::ObjectRect *>());
+            rectsGenerated.clearBit(i);
+        }
+    }
+
+    rectsGenerated.resize(count);
+    pageDataLoaded.resize(count);
+    pageDataLoaded.fill(!hasFeature(LazyPageData), keptCount, count);
+    nextPage = keptCount;
+    nextVerifiedPage = keptCount;
+    loadPages(pagesVector, -1);
+
+    for (const int i : qAsConst(comparedPages))
+        fingerprintPage(i, oldFingerprints.at(i));
+    return true;
+}
+
 bool PDFGenerator::doCloseDocument()
 {
+    // the verifications left are of form fields about to go, the ones not
+    // started yet see that and the running ones drop their results
+    backgroundTarget->mutex.lock();
+    ++backgroundTarget->generation;
+    backgroundTarget->mutex.unlock();
+
     // remove internal objects
-    userMutex()->lock();
+    documentPool.clear();
+    lockUserMutex(OtherSite);
     delete annotProxy;
     annotProxy = nullptr;
     delete pdfdoc;
     pdfdoc = nullptr;
-    userMutex()->unlock();
+    unlockUserMutex();
+    documentFileName.clear();
+    documentData.clear();
     docSynopsisDirty = true;
     docSyn.clear();
+    docOutlineDirty = true;
+    docOutline.clear();
     docEmbeddedFilesDirty = true;
     qDeleteAll(docEmbeddedFiles);
     docEmbeddedFiles.clear();
     nextFontPage = 0;
     rectsGenerated.clear();
+    pageDataLoaded.clear();
+    fingerprintMutex.lock();
+    ++fingerprintGeneration;
+    pageFingerprints.clear();
+    fingerprintsAsked.clear();
+    fingerprintMutex.unlock();
+    nextPage = 0;
+    nextVerifiedPage = 0;
+    formFieldNames.clear();
 
     return true;
 }
 
-void PDFGenerator::loadPages(QVector<Okular::Page *> &pagesVector, int rotation, bool clear)
+bool PDFGenerator::loadMorePages(QVector<Okular::Page *> &pagesVector)
+{
+    // rendering uses pdfdoc meanwhile
+    Okular::UserMutexLocker locker(this, MetaDataSite);
+    if (!pdfdoc)
+        return false;
+
+    return loadPages(pagesVector, morePagesSliceTime);
+}
+
+bool PDFGenerator::loadPages(QVector<Okular::Page *> &pagesVector, int sliceTime)
 {
     // TODO XPDF 3.01 check
-    const int count = pagesVector.count();
+    const int count = pdfdoc->numPages();
+    const bool lazyPageData = hasFeature(LazyPageData);
+    // at least one page each time
+    const int first = nextPage;
+    QElapsedTimer slice;
+    slice.start();
     double w = 0, h = 0;
-    for (int i = 0; i < count; i++) {
+    for (; nextPage < count && (sliceTime < 0 || nextPage == first || slice.elapsed() < sliceTime); ++nextPage) {
+        const int i = nextPage;
         // get xpdf page
         Poppler::Page *p = pdfdoc->page(i);
         Okular::Page *page;
@@ -735,21 +1030,10 @@ void PDFGenerator::loadPages(QVector<Okular::Page *> &pagesVector, int rotation,
                 orientation = Okular::Rotation0;
                 break;
             }
-            if (rotation % 2 == 1)
-                qSwap(w, h);
             // init a Okular::page, add transition and annotation information
             page = new Okular::Page(i, w, h, orientation);
-            addTransition(p, page);
-            if (true) // TODO real check
-                addAnnotations(p, page);
-            Poppler::Link *tmplink = p->action(Poppler::Page::Opening);
-            if (tmplink) {
-                page->setPageAction(Okular::Page::Opening, createLinkFromPopplerLink(tmplink));
-            }
-            tmplink = p->action(Poppler::Page::Closing);
-            if (tmplink) {
-                page->setPageAction(Okular::Page::Closing, createLinkFromPopplerLink(tmplink));
-            }
+            if (!lazyPageData)
+                addPageData(p, page);
             page->setDuration(p->duration());
             page->setLabel(p->label());
 
@@ -760,62 +1044,65 @@ void PDFGenerator::loadPages(QVector<Okular::Page *> &pagesVector, int rotation,
 #else
             okularFormFields = getFormFields(p);
 #endif
+            for (const Okular::FormField *f : qAsConst(okularFormFields))
+                formFieldNames.insert(f->fullyQualifiedName());
             if (!okularFormFields.isEmpty())
                 page->setFormFields(okularFormFields);
                 //        qWarning(PDFDebug).nospace() << page->width() << "x" << page->height();
 
 #ifdef PDFGENERATOR_DEBUG
-            qCDebug(OkularPdfDebug) << "load page" << i << "with rotation" << rotation << "and orientation" << orientation;
+            qCDebug(OkularPdfDebug) << "load page" << i << "with orientation" << orientation;
 #endif
             delete p;
-
-            if (clear && pagesVector[i])
-                delete pagesVector[i];
         } else {
             page = new Okular::Page(i, defaultPageWidth, defaultPageHeight, Okular::Rotation0);
         }
-        // set the Okular::page at the right position in document's pages vector
-        pagesVector[i] = page;
+        pagesVector.append(page);
     }
 
+    // the results are looked up in the pages of the document, so only verify
+    // the ones it has: the first ones, or all of them after the last slice
+    if (first == 0 || nextPage == count) {
+        for (; nextVerifiedPage < nextPage; ++nextVerifiedPage) {
+            const QLinkedList<Okular::FormField *> formFields = pagesVector.at(nextVerifiedPage)->formFields();
+            if (!formFields.isEmpty())
+                verifySignatures(nextVerifiedPage, formFields);
+        }
+    }
+    if (nextPage < count)
+        return true;
+
     // Once we've added the signatures to all pages except page 0, we add all the missing signatures there
     // we do that because there's signatures that don't belong to any page, but okular needs a page<->signature mapping
-    if (count > 0) {
+    if (count > 0 && first < count) {
 #if POPPLER_VERSION_MACRO >= QT_VERSION_CHECK(0, 89, 0)
         const QVector<Poppler::FormFieldSignature *> allSignatures = pdfdoc->signatures();
         std::unique_ptr<Poppler::Page> page0(pdfdoc->page(0));
         QLinkedList<Okular::FormField *> page0FormFields = getFormFields(page0.get());
+        for (const Okular::FormField *f : qAsConst(page0FormFields))
+            formFieldNames.insert(f->fullyQualifiedName());
 
         for (Poppler::FormFieldSignature *s : allSignatures) {
-            bool createSignature = true;
+            // See if the signature is in one of the pages
             const QString fullyQualifiedName = s->fullyQualifiedName();
-            auto compareSignatureByFullyQualifiedName = [&fullyQualifiedName](const Okular::FormField *off) { return off->fullyQualifiedName() == fullyQualifiedName; };
-
-            // See if the signature is in one of the already loaded page (i.e. 1 to end)
-            for (Okular::Page *p : qAsConst(pagesVector)) {
-                const QLinkedList<Okular::FormField *> pageFormFields = p->formFields();
-                if (std::find_if(pageFormFields.begin(), pageFormFields.end(), compareSignatureByFullyQualifiedName) != pageFormFields.end()) {
-                    delete s;
-                    createSignature = false;
-                    break;
-                }
-            }
-            // See if the signature is in page 0
-            if (createSignature && std::find_if(page0FormFields.constBegin(), page0FormFields.constEnd(), compareSignatureByFullyQualifiedName) != page0FormFields.constEnd()) {
+            if (formFieldNames.contains(fullyQualifiedName)) {
                 delete s;
-                createSignature = false;
+                continue;
             }
             // Otherwise it's a page-less signature, add it to page 0
-            if (createSignature) {
-                Okular::FormField *of = new PopplerFormFieldSignature(std::unique_ptr<Poppler::FormFieldSignature>(s));
-                page0FormFields.append(of);
-            }
+            Okular::FormField *of = new PopplerFormFieldSignature(std::unique_ptr<Poppler::FormFieldSignature>(s));
+            page0FormFields.append(of);
+            formFieldNames.insert(fullyQualifiedName);
         }
 
-        if (!page0FormFields.isEmpty())
+        if (!page0FormFields.isEmpty()) {
             pagesVector[0]->setFormFields(page0FormFields);
+            verifySignatures(0, page0FormFields);
+        }
 #endif
     }
+    formFieldNames.clear();
+    return false;
 }
 
 Okular::DocumentInfo PDFGenerator::generateDocumentInfo(const QSet<Okular::DocumentInfo::Key> &keys) const
@@ -823,7 +1110,7 @@ Okular::DocumentInfo PDFGenerator::generateDocumentInfo(const QSet<Okular::Docum
     Okular::DocumentInfo docInfo;
     docInfo.set(Okular::DocumentInfo::MimeType, QStringLiteral("application/pdf"));
 
-    userMutex()->lock();
+    lockUserMutex(MetaDataSite);
 
     if (pdfdoc) {
         // compile internal structure reading properties from PDFDoc
@@ -853,7 +1140,7 @@ Okular::DocumentInfo PDFGenerator::generateDocumentInfo(const QSet<Okular::Docum
 
         docInfo.set(Okular::DocumentInfo::Pages, QString::number(pdfdoc->numPages()));
     }
-    userMutex()->unlock();
+    unlockUserMutex();
 
     return docInfo;
 }
@@ -866,9 +1153,9 @@ const Okular::DocumentSynopsis *PDFGenerator::generateDocumentSynopsis()
     if (!pdfdoc)
         return nullptr;
 
-    userMutex()->lock();
+    lockUserMutex(MetaDataSite);
     const QVector<Poppler::OutlineItem> outline = pdfdoc->outline();
-    userMutex()->unlock();
+    unlockUserMutex();
 
     if (outline.isEmpty())
         return nullptr;
@@ -879,6 +1166,27 @@ const Okular::DocumentSynopsis *PDFGenerator::generateDocumentSynopsis()
     return &docSyn;
 }
 
+const Okular::Outline *PDFGenerator::generateOutline()
+{
+    if (!docOutlineDirty)
+        return &docOutline;
+
+    if (!pdfdoc)
+        return nullptr;
+
+    lockUserMutex(MetaDataSite);
+    const QVector<Poppler::OutlineItem> outline = pdfdoc->outline();
+    unlockUserMutex();
+
+    if (outline.isEmpty())
+        return nullptr;
+
+    addOutlineChildren(outline, -1);
+
+    docOutlineDirty = false;
+    return &docOutline;
+}
+
 static Okular::FontInfo::FontType convertPopplerFontInfoTypeToOkularFontInfoType(Poppler::FontInfo::Type type)
 {
     switch (type) {
@@ -942,14 +1250,14 @@ Okular::FontInfo::List PDFGenerator::fontsForPage(int page)
         return list;
 
     QList<Poppler::FontInfo> fonts;
-    userMutex()->lock();
+    Poppler::Document *doc = acquireDocument(page, FontsSite);
 
-    Poppler::FontIterator *it = pdfdoc->newFontIterator(page);
+    Poppler::FontIterator *it = doc->newFontIterator(page);
     if (it->hasNext()) {
         fonts = it->next();
     }
     delete it;
-    userMutex()->unlock();
+    releaseDocument(doc);
 
     for (const Poppler::FontInfo &font : qAsConst(fonts)) {
         Okular::FontInfo of;
@@ -975,12 +1283,12 @@ Okular::FontInfo::List PDFGenerator::fontsForPage(int page)
 const QList<Okular::EmbeddedFile *> *PDFGenerator::embeddedFiles() const
 {
     if (docEmbeddedFilesDirty) {
-        userMutex()->lock();
+        lockUserMutex(MetaDataSite);
         const QList<Poppler::EmbeddedFile *> &popplerFiles = pdfdoc->embeddedFiles();
         for (Poppler::EmbeddedFile *pef : popplerFiles) {
             docEmbeddedFiles.append(new PDFEmbeddedFile(pef));
         }
-        userMutex()->unlock();
+        unlockUserMutex();
 
         docEmbeddedFilesDirty = false;
     }
@@ -997,6 +1305,7 @@ void PDFGenerator::opaqueAction(const Okular::BackendOpaqueAction *action)
 {
     const Poppler::LinkOCGState *popplerLink = action->nativeId().value<const Poppler::LinkOCGState *>();
     pdfdoc->optionalContentModel()->applyLink(const_cast<Poppler::LinkOCGState *>(popplerLink));
+    documentPool.allPagesModified();
 }
 
 bool PDFGenerator::isAllowed(Okular::Permission permission) const
@@ -1023,20 +1332,22 @@ bool PDFGenerator::isAllowed(Okular::Permission permission) const
     return b;
 }
 
+// Don't report partial updates for the first 500 ms
+static const int partialUpdateInitialDelay = 500;
+
 struct RenderImagePayload {
     RenderImagePayload(PDFGenerator *g, Okular::PixmapRequest *r)
         : generator(g)
         , request(r)
     {
-        // Don't report partial updates for the first 500 ms
-        timer.setInterval(500);
-        timer.setSingleShot(true);
         timer.start();
     }
 
     PDFGenerator *generator;
     Okular::PixmapRequest *request;
-    QTimer timer;
+    // since the start of the render, then since the last partial update
+    QElapsedTimer timer;
+    QImage lastImage;
 };
 Q_DECLARE_METATYPE(RenderImagePayload *)
 
@@ -1044,21 +1355,44 @@ static bool shouldDoPartialUpdateCallback(const QVariant &vPayload)
 {
     auto payload = vPayload.value<RenderImagePayload *>();
 
-    // Since the timer lives in a thread without an event loop we need to stop it ourselves
-    // when the remaining time has reached 0
-    if (payload->timer.isActive() && payload->timer.remainingTime() == 0) {
-        payload->timer.stop();
-    }
+    // poppler copies the whole bitmap for each update, ask for it only when it is going to be shown
+    const int interval = payload->lastImage.isNull() ? partialUpdateInitialDelay : payload->request->partialUpdateInterval();
+    return payload->timer.hasExpired(interval);
+}
 
-    return !payload->timer.isActive();
+// the rows of image that are not like in previous, which has the same size and format
+static QRect dirtyRows(const QImage &image, const QImage &previous)
+{
+    const int bytes = image.bytesPerLine();
+    int top = 0;
+    while (top < image.height() && memcmp(image.constScanLine(top), previous.constScanLine(top), bytes) == 0)
+        ++top;
+    if (top == image.height())
+        return QRect();
+
+    int bottom = image.height() - 1;
+    while (bottom > top && memcmp(image.constScanLine(bottom), previous.constScanLine(bottom), bytes) == 0)
+        --bottom;
+    return QRect(0, top, image.width(), bottom - top + 1);
 }
 
 static void partialUpdateCallback(const QImage &image, const QVariant &vPayload)
 {
     auto payload = vPayload.value<RenderImagePayload *>();
+
+    QRect dirtyRect = image.rect();
+    if (!payload->lastImage.isNull() && payload->lastImage.size() == image.size() && payload->lastImage.format() == image.format()) {
+        dirtyRect = dirtyRows(image, payload->lastImage);
+        // nothing new was drawn, wait for the next one
+        if (dirtyRect.isEmpty())
+            return;
+    }
+    payload->lastImage = image;
+    payload->timer.start();
+
     // clang-format off
     // Otherwise the Okular::PixmapRequest* gets turned into Okular::PixmapRequest * that is not normalized and is slightly slower
-    QMetaObject::invokeMethod(payload->generator, "signalPartialPixmapRequest", Qt::QueuedConnection, Q_ARG(Okular::PixmapRequest*, payload->request), Q_ARG(QImage, image));
+    QMetaObject::invokeMethod(payload->generator, "signalPartialPixmapRequest", Qt::QueuedConnection, Q_ARG(Okular::PixmapRequest*, payload->request), Q_ARG(QImage, image), Q_ARG(QRect, dirtyRect));
     // clang-format on
 }
 
@@ -1068,6 +1402,22 @@ static bool shouldAbortRenderCallback(const QVariant &vPayload)
     return payload->request->shouldAbortRender();
 }
 
+QImage PDFGenerator::embeddedThumbnail(const Okular::Page *page) const
+{
+    QImage thumbnail;
+    {
+        Okular::UserMutexLocker ml(this, RenderSite);
+        std::unique_ptr<Poppler::Page> p(pdfdoc->page(page->number()));
+        if (p)
+            thumbnail = p->thumbnail();
+    }
+
+    // the /Thumb of a page is not rotated like its renders are
+    if (!thumbnail.isNull() && page->orientation() != Okular::Rotation0)
+        thumbnail = thumbnail.transformed(QTransform().rotate(90 * page->orientation()));
+    return thumbnail;
+}
+
 QImage PDFGenerator::image(Okular::PixmapRequest *request)
 {
     // debug requests to this (xpdf) generator
@@ -1087,17 +1437,25 @@ QImage PDFGenerator::image(Okular::PixmapRequest *request)
     // generate links rects only the first time
     bool genObjectRects = !rectsGenerated.at(page->number());
 
-    // 0. LOCK [waits for the thread end]
-    userMutex()->lock();
+    // 0. LOCK [waits for the thread end], unless a copy of the document is free
+    Poppler::Document *doc = acquireDocument(page->number(), RenderSite);
 
     if (request->shouldAbortRender()) {
-        userMutex()->unlock();
+        releaseDocument(doc);
         return QImage();
     }
 
     // 1. Set OutputDev parameters and Generate contents
     // note: thread safety is set on 'false' for the GUI (this) thread
-    Poppler::Page *p = pdfdoc->page(page->number());
+    Poppler::Page *p = doc->page(page->number());
+
+    // previews and drafts are replaced soon after, speed matters more than looks
+    const Poppler::Document::RenderHints renderHints = doc->renderHints();
+    const bool fast = request->preview() || request->draft();
+    if (fast) {
+        doc->setRenderHint(Poppler::Document::Antialiasing, false);
+        doc->setRenderHint(Poppler::Document::TextAntialiasing, false);
+    }
 
     // 2. Take data from outputdev and attach it to the Page
     QImage img;
@@ -1122,25 +1480,49 @@ QImage PDFGenerator::image(Okular::PixmapRequest *request)
             }
         }
     } else {
-        img = QImage(request->width(), request->height(), QImage::Format_Mono);
+        img = QImage(request->width(), request->height(), Okular::PixmapRequest::imageFormat());
         img.fill(Qt::white);
     }
 
+    if (fast) {
+        doc->setRenderHint(Poppler::Document::Antialiasing, renderHints & Poppler::Document::Antialiasing);
+        doc->setRenderHint(Poppler::Document::TextAntialiasing, renderHints & Poppler::Document::TextAntialiasing);
+    }
+
     if (p && genObjectRects) {
-        // TODO previously we extracted Image type rects too, but that needed porting to poppler
-        // and as we are not doing anything with Image type rects i did not port it, have a look at
-        // dead gp_outputdev.cpp on image extraction
-        page->setObjectRects(generateLinks(p->links()));
-        rectsGenerated[request->page()->number()] = true;
+        // the media links have to point to the annotations of pdfdoc
+        Poppler::Page *linksPage = p;
+        if (doc != pdfdoc) {
+            lockUserMutex(RenderSite);
+            linksPage = pdfdoc->page(page->number());
+        }
+
+        // another copy may have done it meanwhile
+        if (linksPage && !rectsGenerated.at(page->number())) {
+            // TODO previously we extracted Image type rects too, but that needed porting to poppler
+            // and as we are not doing anything with Image type rects i did not port it, have a look at
+            // dead gp_outputdev.cpp on image extraction
+            page->setObjectRects(generateLinks(linksPage->links()));
+            rectsGenerated[request->page()->number()] = true;
 
-        resolveMediaLinkReferences(page);
+            resolveMediaLinkReferences(page);
+        }
+
+        if (doc != pdfdoc) {
+            delete linksPage;
+            unlockUserMutex();
+        }
     }
 
-    // 3. UNLOCK [re-enables shared access]
-    userMutex()->unlock();
+    // to see whether the page changed when reloading
+    if (p && !request->preview())
+        fingerprintPage(page->number(), 0);
 
     delete p;
 
+    // 3. UNLOCK [re-enables shared access]
+    releaseDocument(doc);
+
     return img;
 }
 
@@ -1231,8 +1613,8 @@ Okular::TextPage *PDFGenerator::textPage(Okular::TextRequest *request)
     // build a TextList...
     QList<Poppler::TextBox *> textList;
     double pageWidth, pageHeight;
-    userMutex()->lock();
-    Poppler::Page *pp = pdfdoc->page(page->number());
+    Poppler::Document *doc = acquireDocument(page->number(), TextSite);
+    Poppler::Page *pp = doc->page(page->number());
     if (pp) {
         TextExtractionPayload payload(request);
         textList = pp->textList(Poppler::Page::Rotate0, shouldAbortTextExtractionCallback, QVariant::fromValue(&payload));
@@ -1244,7 +1626,7 @@ Okular::TextPage *PDFGenerator::textPage(Okular::TextRequest *request)
         pageHeight = defaultPageHeight;
     }
     delete pp;
-    userMutex()->unlock();
+    releaseDocument(doc);
 
     if (textList.isEmpty() && request->shouldAbortExtraction())
         return nullptr;
@@ -1254,10 +1636,50 @@ Okular::TextPage *PDFGenerator::textPage(Okular::TextRequest *request)
     return tp;
 }
 
+bool PDFGenerator::pageHasFonts(int page)
+{
+    // text is drawn with the fonts of the resources of the page (or of its
+    // forms), a scanned page without OCR has none; looking them up doesn't
+    // parse the content stream
+    Poppler::Document *doc = acquireDocument(page, TextSite);
+    std::unique_ptr<Poppler::FontIterator> it(doc->newFontIterator(page));
+    const bool hasFonts = it->hasNext() && !it->next().isEmpty();
+    releaseDocument(doc);
+    return hasFonts;
+}
+
 void PDFGenerator::requestFontData(const Okular::FontInfo &font, QByteArray *data)
 {
-    Poppler::FontInfo fi = font.nativeId().value<Poppler::FontInfo>();
-    *data = pdfdoc->fontData(fi);
+    Okular::UserMutexLocker ml(this, FontsSite);
+    if (font.nativeId().isValid()) {
+        *data = pdfdoc->fontData(font.nativeId().value<Poppler::FontInfo>());
+        return;
+    }
+
+    // the font list was restored from the docdata, look the font up in the document again
+    std::unique_ptr<Poppler::FontIterator> it(pdfdoc->newFontIterator());
+    while (it->hasNext()) {
+        const QList<Poppler::FontInfo> fonts = it->next();
+        for (const Poppler::FontInfo &fi : fonts) {
+            if (fi.name() == font.name() && fi.file() == font.file() && embedTypeForPopplerFontInfo(fi) == font.embedType()) {
+                *data = pdfdoc->fontData(fi);
+                return;
+            }
+        }
+    }
+}
+
+// the pages of a rasterized print job rendered ahead of the printer, about 35 MB each for A4
+static const int printRasterBufferedPages = 4;
+
+namespace
+{
+// the rasterized pages of a print job and their size in points, waiting to be printed
+struct PrintRasterBuffer {
+    QMutex mutex;
+    QWaitCondition pageReady;
+    QHash<int, QPair<QImage, QSizeF>> pages;
+};
 }
 
 #define DUMMY_QPRINTER_COPY
@@ -1291,16 +1713,47 @@ bool PDFGenerator::print(QPrinter &printer)
         QPainter painter;
         painter.begin(&printer);
 
+#ifdef Q_OS_WIN
+        const double dpiX = printer.physicalDpiX();
+        const double dpiY = printer.physicalDpiY();
+#else
+        // UNIX: Same resolution as the postscript rasterizer; see discussion at https://git.reviewboard.kde.org/r/130218/
+        const double dpiX = 300;
+        const double dpiY = 300;
+#endif
+
+        PrintRasterBuffer buffer;
+        QThreadPool rasterizers;
+        rasterizers.setMaxThreadCount(qBound(1, QThread::idealThreadCount() - 1, printRasterBufferedPages));
+
         QList<int> pageList = Okular::FilePrinter::pageList(printer, pdfdoc->numPages(), document()->currentPage() + 1, document()->bookmarkedPageList());
+        int nextToRender = 0;
         for (int i = 0; i < pageList.count(); ++i) {
+            // the next pages are rendered while this one goes to the printer
+            for (; nextToRender < pageList.count() && nextToRender - i < printRasterBufferedPages; ++nextToRender) {
+                const int index = nextToRender;
+                const int page = pageList.at(index) - 1;
+                rasterizers.start(new Okular::FunctionTask([this, &buffer, index, page, dpiX, dpiY, printAnnots] {
+                    QSizeF pageSize;
+                    const QImage img = rasterizePage(page, dpiX, dpiY, printAnnots, &pageSize);
+
+                    QMutexLocker locker(&buffer.mutex);
+                    buffer.pages.insert(index, qMakePair(img, pageSize));
+                    buffer.pageReady.wakeAll();
+                }));
+            }
+
+            buffer.mutex.lock();
+            while (!buffer.pages.contains(i))
+                buffer.pageReady.wait(&buffer.mutex);
+            const QPair<QImage, QSizeF> rasterized = buffer.pages.take(i);
+            buffer.mutex.unlock();
+
             if (i != 0)
                 printer.newPage();
 
-            const int page = pageList.at(i) - 1;
-            userMutex()->lock();
-            std::unique_ptr<Poppler::Page> pp(pdfdoc->page(page));
-            if (pp) {
-                QSizeF pageSize = pp->pageSizeF();      // Unit is 'points' (i.e., 1/72th of an inch)
+            if (!rasterized.first.isNull()) {
+                QSizeF pageSize = rasterized.second;    // Unit is 'points' (i.e., 1/72th of an inch)
                 QRect painterWindow = painter.window(); // Unit is 'QPrinter::DevicePixel'
 
                 // Default: no scaling at all, but we need to go from DevicePixel units to 'points'
@@ -1316,15 +1769,8 @@ bool PDFGenerator::print(QPrinter &printer)
                     scaling = std::min(horizontalScaling, verticalScaling);
                 }
 
-#ifdef Q_OS_WIN
-                QImage img = pp->renderToImage(printer.physicalDpiX(), printer.physicalDpiY());
-#else
-                // UNIX: Same resolution as the postscript rasterizer; see discussion at https://git.reviewboard.kde.org/r/130218/
-                QImage img = pp->renderToImage(300, 300);
-#endif
-                painter.drawImage(QRectF(QPointF(0, 0), scaling * pp->pageSizeF()), img);
+                painter.drawImage(QRectF(QPointF(0, 0), scaling * pageSize), rasterized.first);
             }
-            userMutex()->unlock();
         }
         painter.end();
         return true;
@@ -1349,51 +1795,65 @@ bool PDFGenerator::print(QPrinter &printer)
         return false;
     }
 
-    // Create the tempfile to send to FilePrinter, which will manage the deletion
-    QTemporaryFile tf(QDir::tempPath() + QLatin1String("/okular_XXXXXX.ps"));
-    if (!tf.open()) {
-        lastPrintError = TemporaryFileOpenPrintError;
-        return false;
-    }
-    QString tempfilename = tf.fileName();
-
     // Generate the list of pages to be printed as selected in the print dialog
     QList<int> pageList = Okular::FilePrinter::pageList(printer, pdfdoc->numPages(), document()->currentPage() + 1, document()->bookmarkedPageList());
 
     // TODO rotation
 
-    tf.setAutoRemove(false);
-
     QString pstitle = metaData(QStringLiteral("Title"), QVariant()).toString();
     if (pstitle.trimmed().isEmpty()) {
         pstitle = document()->currentDocument().fileName();
     }
 
-    Poppler::PSConverter *psConverter = pdfdoc->psConverter();
+    auto convert = [&](QIODevice *device) {
+        Poppler::PSConverter *psConverter = pdfdoc->psConverter();
 
-    psConverter->setOutputDevice(&tf);
+        psConverter->setOutputDevice(device);
 
-    psConverter->setPageList(pageList);
-    psConverter->setPaperWidth(width);
-    psConverter->setPaperHeight(height);
-    psConverter->setRightMargin(0);
-    psConverter->setBottomMargin(0);
-    psConverter->setLeftMargin(0);
-    psConverter->setTopMargin(0);
-    psConverter->setStrictMargins(false);
-    psConverter->setForceRasterize(forceRasterize);
-    psConverter->setTitle(pstitle);
+        psConverter->setPageList(pageList);
+        psConverter->setPaperWidth(width);
+        psConverter->setPaperHeight(height);
+        psConverter->setRightMargin(0);
+        psConverter->setBottomMargin(0);
+        psConverter->setLeftMargin(0);
+        psConverter->setTopMargin(0);
+        psConverter->setStrictMargins(false);
+        psConverter->setForceRasterize(forceRasterize);
+        psConverter->setTitle(pstitle);
 
-    if (!printAnnots)
-        psConverter->setPSOptions(psConverter->psOptions() | Poppler::PSConverter::HideAnnotations);
+        if (!printAnnots)
+            psConverter->setPSOptions(psConverter->psOptions() | Poppler::PSConverter::HideAnnotations);
 
-    userMutex()->lock();
-    if (psConverter->convert()) {
-        userMutex()->unlock();
+        lockUserMutex(OtherSite);
+        const bool converted = psConverter->convert();
+        unlockUserMutex();
         delete psConverter;
-        tf.close();
+        return converted;
+    };
+
+    const Okular::FilePrinter::ScaleMode filePrinterScaleMode = (scaleMode == PDFOptionsPage::None) ? Okular::FilePrinter::ScaleMode::NoScaling : Okular::FilePrinter::ScaleMode::FitToPrintArea;
+
+    // to a printer the PostScript goes straight to the print command, page by page
+    if (printer.outputFileName().isEmpty()) {
+        int ret = Okular::FilePrinter::printStream(printer, convert, document()->orientation(), document()->bookmarkedPageRange(), filePrinterScaleMode);
+
+        lastPrintError = Okular::FilePrinter::printError(ret);
+
+        return (lastPrintError == NoPrintError);
+    }
 
-        const Okular::FilePrinter::ScaleMode filePrinterScaleMode = (scaleMode == PDFOptionsPage::None) ? Okular::FilePrinter::ScaleMode::NoScaling : Okular::FilePrinter::ScaleMode::FitToPrintArea;
+    // Create the tempfile to send to FilePrinter, which will manage the deletion
+    QTemporaryFile tf(QDir::tempPath() + QLatin1String("/okular_XXXXXX.ps"));
+    if (!tf.open()) {
+        lastPrintError = TemporaryFileOpenPrintError;
+        return false;
+    }
+    QString tempfilename = tf.fileName();
+
+    tf.setAutoRemove(false);
+
+    if (convert(&tf)) {
+        tf.close();
 
         int ret =
             Okular::FilePrinter::printFile(printer, tempfilename, document()->orientation(), Okular::FilePrinter::SystemDeletesFiles, Okular::FilePrinter::ApplicationSelectsPages, document()->bookmarkedPageRange(), filePrinterScaleMode);
@@ -1403,8 +1863,6 @@ bool PDFGenerator::print(QPrinter &printer)
         return (lastPrintError == NoPrintError);
     } else {
         lastPrintError = FileConversionPrintError;
-        delete psConverter;
-        userMutex()->unlock();
     }
 
     tf.close();
@@ -1415,7 +1873,7 @@ bool PDFGenerator::print(QPrinter &printer)
 QVariant PDFGenerator::metaData(const QString &key, const QVariant &option) const
 {
     if (key == QLatin1String("StartFullScreen")) {
-        QMutexLocker ml(userMutex());
+        Okular::UserMutexLocker ml(this, MetaDataSite);
         // asking for the 'start in fullscreen mode' (pdf property)
         if (pdfdoc->pageMode() == Poppler::Document::FullScreen)
             return true;
@@ -1425,9 +1883,9 @@ QVariant PDFGenerator::metaData(const QString &key, const QVariant &option) cons
 
         // asking for the page related to a 'named link destination'. the
         // option is the link name. @see addSynopsisChildren.
-        userMutex()->lock();
+        lockUserMutex(MetaDataSite);
         Poppler::LinkDestination *ld = pdfdoc->linkDestination(optionString);
-        userMutex()->unlock();
+        unlockUserMutex();
         if (ld) {
             fillViewportFromLinkDestination(viewport, *ld);
         }
@@ -1435,22 +1893,22 @@ QVariant PDFGenerator::metaData(const QString &key, const QVariant &option) cons
         if (viewport.pageNumber >= 0)
             return viewport.toString();
     } else if (key == QLatin1String("DocumentTitle")) {
-        userMutex()->lock();
+        lockUserMutex(MetaDataSite);
         QString title = pdfdoc->info(QStringLiteral("Title"));
-        userMutex()->unlock();
+        unlockUserMutex();
         return title;
     } else if (key == QLatin1String("OpenTOC")) {
-        QMutexLocker ml(userMutex());
+        Okular::UserMutexLocker ml(this, MetaDataSite);
         if (pdfdoc->pageMode() == Poppler::Document::UseOutlines)
             return true;
     } else if (key == QLatin1String("DocumentScripts") && option.toString() == QLatin1String("JavaScript")) {
-        QMutexLocker ml(userMutex());
+        Okular::UserMutexLocker ml(this, MetaDataSite);
         return pdfdoc->scripts();
     } else if (key == QLatin1String("HasUnsupportedXfaForm")) {
-        QMutexLocker ml(userMutex());
+        Okular::UserMutexLocker ml(this, MetaDataSite);
         return pdfdoc->formType() == Poppler::Document::XfaForm;
     } else if (key == QLatin1String("FormCalculateOrder")) {
-        QMutexLocker ml(userMutex());
+        Okular::UserMutexLocker ml(this, MetaDataSite);
         return QVariant::fromValue<QVector<int>>(pdfdoc->formCalculateOrder());
     } else if (key == QLatin1String("GeneratorExtraDescription")) {
         if (Poppler::Version::string() == QStringLiteral(POPPLER_VERSION)) {
@@ -1460,6 +1918,8 @@ QVariant PDFGenerator::metaData(const QString &key, const QVariant &option) cons
         }
     } else if (key == QLatin1String("ShowStampsWarning")) {
         return QStringLiteral("yes");
+    } else if (key == QLatin1String("PageHasText")) {
+        return const_cast<PDFGenerator *>(this)->pageHasFonts(option.toInt());
     }
     return QVariant();
 }
@@ -1476,13 +1936,17 @@ bool PDFGenerator::reparseConfig()
     // to the outputDevice. it's the 'heaviest' case, other effect are just recoloring
     // over the page rendered on 'standard' white background.
     if (color != pdfdoc->paperColor()) {
-        userMutex()->lock();
+        lockUserMutex(RenderSite);
         pdfdoc->setPaperColor(color);
-        userMutex()->unlock();
+        unlockUserMutex();
         somethingchanged = true;
     }
     bool aaChanged = setDocumentRenderHints();
     somethingchanged = somethingchanged || aaChanged;
+    if (somethingchanged) {
+        Okular::UserMutexLocker ml(this, RenderSite);
+        documentPool.setRenderSettings(pdfdoc->renderHints(), pdfdoc->paperColor());
+    }
     return somethingchanged;
 }
 
@@ -1544,15 +2008,16 @@ bool PDFGenerator::exportTo(const QString &fileName, const Okular::ExportFormat
             return false;
 
         QTextStream ts(&f);
-        int num = document()->pages();
+        // the document may not have all the pages yet
+        int num = pdfdoc->numPages();
         for (int i = 0; i < num; ++i) {
             QString text;
-            userMutex()->lock();
+            lockUserMutex(TextSite);
             Poppler::Page *pp = pdfdoc->page(i);
             if (pp) {
                 text = pp->text(QRect()).normalized(QString::NormalizationForm_KC);
             }
-            userMutex()->unlock();
+            unlockUserMutex();
             ts << text;
             delete pp;
         }
@@ -1566,44 +2031,50 @@ bool PDFGenerator::exportTo(const QString &fileName, const Okular::ExportFormat
 
 // END Generator inherited functions
 
-inline void append(Okular::TextPage *ktp, const QString &s, double l, double b, double r, double t)
-{
-    //    qWarning(PDFDebug).nospace() << "text: " << s << " at (" << l << "," << t << ")x(" << r <<","<<b<<")";
-    ktp->append(s, new Okular::NormalizedRect(l, t, r, b));
-}
-
 Okular::TextPage *PDFGenerator::abstractTextPage(const QList<Poppler::TextBox *> &text, double height, double width, int rot)
 {
     Q_UNUSED(rot);
     Okular::TextPage *ktp = new Okular::TextPage;
-    Poppler::TextBox *next;
 #ifdef PDFGENERATOR_DEBUG
     qCDebug(OkularPdfDebug) << "getting text page in generator pdf - rotation:" << rot;
 #endif
-    QString s;
-    bool addChar;
+    // all the characters of the page in one buffer, given to the text page at once
+    QString chars;
+    QVector<int> lengths;
+    QVector<Okular::NormalizedRect> areas;
+    int count = 0;
+    for (const Poppler::TextBox *word : text)
+        count += word->text().length() + 1;
+    chars.reserve(count + text.count());
+    lengths.reserve(count);
+    areas.reserve(count);
+
     for (const Poppler::TextBox *word : text) {
-        const int qstringCharCount = word->text().length();
-        next = word->nextWord();
+        const QString wordText = word->text();
+        const int qstringCharCount = wordText.length();
+        const Poppler::TextBox *next = word->nextWord();
         int textBoxChar = 0;
         for (int j = 0; j < qstringCharCount; j++) {
-            const QChar c = word->text().at(j);
+            const QChar c = wordText.at(j);
+            // a surrogate pair is one character, a lone high surrogate none
             if (c.isHighSurrogate()) {
-                s = c;
-                addChar = false;
-            } else if (c.isLowSurrogate()) {
-                s += c;
-                addChar = true;
+                if (j + 1 == qstringCharCount || !wordText.at(j + 1).isLowSurrogate())
+                    continue;
+                chars += c;
+                chars += wordText.at(++j);
+                lengths.append(2);
             } else {
-                s = c;
-                addChar = true;
+                chars += c;
+                lengths.append(1);
             }
-
-            if (addChar) {
-                QRectF charBBox = word->charBoundingBox(textBoxChar);
-                append(ktp, (j == qstringCharCount - 1 && !next) ? (s + QLatin1Char('\n')) : s, charBBox.left() / width, charBBox.bottom() / height, charBBox.right() / width, charBBox.top() / height);
-                textBoxChar++;
+            if (j == qstringCharCount - 1 && !next) {
+                chars += QLatin1Char('\n');
+                ++lengths.last();
             }
+
+            const QRectF charBBox = word->charBoundingBox(textBoxChar);
+            areas.append(Okular::NormalizedRect(charBBox.left() / width, charBBox.top() / height, charBBox.right() / width, charBBox.bottom() / height));
+            textBoxChar++;
         }
 
         if (word->hasSpaceAfter() && next) {
@@ -1611,11 +2082,14 @@ Okular::TextPage *PDFGenerator::abstractTextPage(const QList<Poppler::TextBox *>
             // probably won't work and we will need to do comparisons
             // between wordBBox and nextWordBBox to see if they are
             // vertically or horizontally aligned
-            QRectF wordBBox = word->boundingBox();
-            QRectF nextWordBBox = next->boundingBox();
-            append(ktp, QStringLiteral(" "), wordBBox.right() / width, wordBBox.bottom() / height, nextWordBBox.left() / width, wordBBox.top() / height);
+            const QRectF wordBBox = word->boundingBox();
+            const QRectF nextWordBBox = next->boundingBox();
+            chars += QLatin1Char(' ');
+            lengths.append(1);
+            areas.append(Okular::NormalizedRect(wordBBox.right() / width, wordBBox.top() / height, nextWordBBox.left() / width, wordBBox.bottom() / height));
         }
     }
+    ktp->append(chars, lengths, areas);
     return ktp;
 }
 
@@ -1645,13 +2119,34 @@ void PDFGenerator::addSynopsisChildren(const QVector<Poppler::OutlineItem> &outl
     }
 }
 
-void PDFGenerator::addAnnotations(Poppler::Page *popplerPage, Okular::Page *page)
+void PDFGenerator::addOutlineChildren(const QVector<Poppler::OutlineItem> &outlineItems, int parent)
 {
-    QSet<Poppler::Annotation::SubType> subtypes;
-    subtypes << Poppler::Annotation::AFileAttachment << Poppler::Annotation::ASound << Poppler::Annotation::AMovie << Poppler::Annotation::AWidget << Poppler::Annotation::AScreen << Poppler::Annotation::AText << Poppler::Annotation::ALine
-             << Poppler::Annotation::AGeom << Poppler::Annotation::AHighlight << Poppler::Annotation::AInk << Poppler::Annotation::AStamp << Poppler::Annotation::ACaret;
+    for (const Poppler::OutlineItem &outlineItem : outlineItems) {
+        const int item = docOutline.appendItem(parent, outlineItem.name());
+
+        docOutline.setExternalFileName(item, outlineItem.externalFileName());
+        const QSharedPointer<const Poppler::LinkDestination> outlineDestination = outlineItem.destination();
+        if (outlineDestination) {
+            const QString destinationName = outlineDestination->destinationName();
+            if (!destinationName.isEmpty()) {
+                docOutline.setViewportName(item, destinationName);
+            } else {
+                Okular::DocumentViewport vp;
+                fillViewportFromLinkDestination(vp, *outlineDestination);
+                docOutline.setViewport(item, vp);
+            }
+        }
+        docOutline.setOpen(item, outlineItem.isOpen());
+        docOutline.setUrl(item, outlineItem.uri());
+
+        if (outlineItem.hasChildren())
+            addOutlineChildren(outlineItem.children(), item);
+    }
+}
 
-    const QList<Poppler::Annotation *> popplerAnnotations = popplerPage->annotations(subtypes);
+void PDFGenerator::addAnnotations(Poppler::Page *popplerPage, Okular::Page *page)
+{
+    const QList<Poppler::Annotation *> popplerAnnotations = popplerPage->annotations(okularAnnotationSubTypes());
 
     for (Poppler::Annotation *a : popplerAnnotations) {
         bool doDelete = true;
@@ -1700,8 +2195,82 @@ void PDFGenerator::addAnnotations(Poppler::Page *popplerPage, Okular::Page *page
     }
 }
 
+void PDFGenerator::addPageData(Poppler::Page *pdfPage, Okular::Page *page)
+{
+    addTransition(pdfPage, page);
+    if (true) // TODO real check
+        addAnnotations(pdfPage, page);
+    Poppler::Link *tmplink = pdfPage->action(Poppler::Page::Opening);
+    if (tmplink) {
+        page->setPageAction(Okular::Page::Opening, createLinkFromPopplerLink(tmplink));
+    }
+    tmplink = pdfPage->action(Poppler::Page::Closing);
+    if (tmplink) {
+        page->setPageAction(Okular::Page::Closing, createLinkFromPopplerLink(tmplink));
+    }
+}
+
+bool PDFGenerator::loadPageData(Okular::Page *page)
+{
+    const int number = page->number();
+    if (number < 0 || number >= pageDataLoaded.count() || pageDataLoaded.testBit(number))
+        return false;
+    pageDataLoaded.setBit(number);
+
+    Okular::UserMutexLocker locker(this, MetaDataSite);
+    std::unique_ptr<Poppler::Page> p(pdfdoc->page(number));
+    if (!p)
+        return false;
+
+    addPageData(p.get(), page);
+    return true;
+}
+
+QImage PDFGenerator::rasterizePage(int page, double dpiX, double dpiY, bool printAnnots, QSizeF *pageSize)
+{
+    QImage img;
+    Poppler::Document *doc = acquireDocument(page, RenderSite);
+    if (doc != pdfdoc)
+        doc->setRenderHint(Poppler::Document::HideAnnotations, !printAnnots);
+
+    std::unique_ptr<Poppler::Page> pp(doc->page(page));
+    if (pp) {
+        *pageSize = pp->pageSizeF();
+        img = pp->renderToImage(dpiX, dpiY);
+    }
+
+    // the copy renders for the screen next
+    if (doc != pdfdoc)
+        doc->setRenderHint(Poppler::Document::HideAnnotations, false);
+    releaseDocument(doc);
+    return img;
+}
+
+void PDFGenerator::pageModified(int page)
+{
+    documentPool.pageModified(page);
+}
+
+Poppler::Document *PDFGenerator::acquireDocument(int page, UserMutexSite site)
+{
+    Poppler::Document *doc = documentPool.acquire(page);
+    if (doc)
+        return doc;
+
+    lockUserMutex(site);
+    return pdfdoc;
+}
+
+void PDFGenerator::releaseDocument(Poppler::Document *document)
+{
+    if (document == pdfdoc)
+        unlockUserMutex();
+    else
+        documentPool.release(document);
+}
+
 void PDFGenerator::addTransition(Poppler::Page *pdfPage, Okular::Page *page)
-// called on opening when MUTEX is not used
+// called on opening when MUTEX is not used, or by loadPageData() with it
 {
     Poppler::PageTransition *pdfTransition = pdfPage->transition();
     if (!pdfTransition || pdfTransition->type() == Poppler::PageTransition::Replace)
@@ -1811,6 +2380,143 @@ QLinkedList<Okular::FormField *> PDFGenerator::getFormFields(Poppler::Page *popp
     return okularFormFields;
 }
 
+// the certificate check of the signature field named name, in doc
+static std::unique_ptr<Poppler::SignatureValidationInfo> verifySignature(Poppler::Document *doc, int page, const QString &name)
+{
+    std::unique_ptr<Poppler::SignatureValidationInfo> info;
+#if POPPLER_VERSION_MACRO >= QT_VERSION_CHECK(0, 89, 0)
+    // also the ones that are on no page
+    Q_UNUSED(page)
+    const QVector<Poppler::FormFieldSignature *> signatures = doc->signatures();
+    for (const Poppler::FormFieldSignature *s : signatures) {
+        if (!info && s->fullyQualifiedName() == name)
+            info.reset(new Poppler::SignatureValidationInfo(s->validate(Poppler::FormFieldSignature::ValidateVerifyCertificate)));
+    }
+    qDeleteAll(signatures);
+#else
+    std::unique_ptr<Poppler::Page> p(doc->page(page));
+    const QList<Poppler::FormField *> formFields = p ? p->formFields() : QList<Poppler::FormField *>();
+    for (const Poppler::FormField *f : formFields) {
+        if (!info && f->type() == Poppler::FormField::FormSignature && f->fullyQualifiedName() == name)
+            info.reset(new Poppler::SignatureValidationInfo(static_cast<const Poppler::FormFieldSignature *>(f)->validate(Poppler::FormFieldSignature::ValidateVerifyCertificate)));
+    }
+    qDeleteAll(formFields);
+#endif
+    return info;
+}
+
+void PDFGenerator::verifySignatures(int page, const QLinkedList<Okular::FormField *> &formFields)
+{
+    for (const Okular::FormField *f : formFields) {
+        if (f->type() != Okular::FormField::FormSignature)
+            continue;
+
+        const PopplerFormFieldSignature *signature = static_cast<const PopplerFormFieldSignature *>(f);
+        if (signature->certificateVerified())
+            continue;
+
+        // the certificate checks may go to the network, they are done with a
+        // copy of their own while the views show the signatures, and the
+        // document can be closed meanwhile
+        const QString name = signature->fullyQualifiedName();
+        const QByteArray cacheKey = signature->cacheKey();
+        const std::shared_ptr<BackgroundTaskTarget> target = backgroundTarget;
+        const int generation = target->generation;
+        const PopplerDocumentPool::Source source = documentPool.source();
+        signatureVerifiers()->start(new Okular::FunctionTask([page, name, cacheKey, target, generation, source] {
+            target->mutex.lock();
+            const bool wanted = target->generator && target->generation == generation;
+            target->mutex.unlock();
+            if (!wanted)
+                return;
+
+            const std::unique_ptr<Poppler::Document> doc(PopplerDocumentPool::openDetached(source));
+            const std::unique_ptr<Poppler::SignatureValidationInfo> info = doc ? verifySignature(doc.get(), page, name) : nullptr;
+            if (!info)
+                return;
+
+            PopplerSignatureCache::insert(cacheKey, *info);
+            const Poppler::SignatureValidationInfo verifiedInfo = *info;
+            QMutexLocker locker(&target->mutex);
+            if (!target->generator)
+                return;
+            PDFGenerator *generator = target->generator;
+            QMetaObject::invokeMethod(
+                generator, [generator, page, name, generation, verifiedInfo] { generator->signatureVerified(page, name, generation, verifiedInfo); }, Qt::QueuedConnection);
+        }));
+    }
+}
+
+void PDFGenerator::fingerprintPage(int page, uint previous)
+{
+    QMutexLocker locker(&fingerprintMutex);
+    if (page >= pageFingerprints.count() || pageFingerprints.at(page) || fingerprintsAsked.testBit(page))
+        return;
+    fingerprintsAsked.setBit(page);
+    const int generation = fingerprintGeneration;
+    locker.unlock();
+
+    // rendered at a low resolution while nothing else runs, with a copy of
+    // the document when there is one
+    const std::shared_ptr<BackgroundTaskTarget> target = backgroundTarget;
+    pageFingerprinters()->start(new Okular::FunctionTask([target, page, generation, previous] {
+        QThread::currentThread()->setPriority(QThread::IdlePriority);
+        QMutexLocker targetLocker(&target->mutex);
+        if (target->generator)
+            target->generator->takeFingerprint(page, generation, previous);
+    }));
+}
+
+void PDFGenerator::takeFingerprint(int page, int generation, uint previous)
+{
+    fingerprintMutex.lock();
+    const bool wanted = generation == fingerprintGeneration;
+    fingerprintMutex.unlock();
+    if (!wanted)
+        return;
+
+    Poppler::Document *doc = acquireDocument(page, OtherSite);
+    std::unique_ptr<Poppler::Page> p(doc ? doc->page(page) : nullptr);
+    const uint fingerprint = p ? pageFingerprint(p.get()) : 0;
+    p.reset();
+    releaseDocument(doc);
+
+    QMutexLocker locker(&fingerprintMutex);
+    if (!fingerprint || generation != fingerprintGeneration)
+        return;
+    pageFingerprints[page] = fingerprint;
+
+    // the page was kept by reloadDocument(), but looks different now
+    if (previous && fingerprint != previous) {
+        QMetaObject::invokeMethod(
+            this,
+            [this, page, generation] {
+                fingerprintMutex.lock();
+                const bool current = generation == fingerprintGeneration;
+                fingerprintMutex.unlock();
+                if (current)
+                    emit pageContentsChanged(page);
+            },
+            Qt::QueuedConnection);
+    }
+}
+
+void PDFGenerator::signatureVerified(int page, const QString &name, int generation, const Poppler::SignatureValidationInfo &info)
+{
+    // the form fields it was for are gone
+    if (generation != backgroundTarget->generation || !document() || page >= int(document()->pages()))
+        return;
+
+    const QLinkedList<Okular::FormField *> formFields = document()->page(page)->formFields();
+    for (Okular::FormField *f : formFields) {
+        if (f->type() == Okular::FormField::FormSignature && f->fullyQualifiedName() == name) {
+            static_cast<PopplerFormFieldSignature *>(f)->setVerifiedInfo(info);
+            emit signatureInfoChanged(page);
+            return;
+        }
+    }
+}
+
 PDFGenerator::PrintError PDFGenerator::printError() const
 {
     return lastPrintError;
@@ -1824,12 +2530,88 @@ Okular::PrintOptionsWidget *PDFGenerator::printConfigurationWidget() const
     return pdfOptionsPage;
 }
 
+// Receives what poppler saves, which starts with the bytes of the original file
+// when the changes are written as an incremental update. Those are checked
+// against the file instead of written, what comes after them is kept to be
+// appended to it. A full rewrite doesn't match and fails the save.
+class IncrementalUpdateDevice : public QIODevice
+{
+public:
+    explicit IncrementalUpdateDevice(const QString &originalFileName)
+        : m_original(originalFileName)
+    {
+    }
+
+    bool open(OpenMode mode) override
+    {
+        m_originalSize = QFileInfo(m_original.fileName()).size();
+        return m_original.open(QIODevice::ReadOnly) && QIODevice::open(mode);
+    }
+
+    bool isValid() const
+    {
+        return m_valid && pos() >= m_originalSize;
+    }
+
+    const QByteArray &update() const
+    {
+        return m_update;
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        Q_UNUSED(data)
+        Q_UNUSED(maxSize)
+        return -1;
+    }
+
+    qint64 writeData(const char *data, qint64 size) override
+    {
+        if (!m_valid)
+            return -1;
+
+        const qint64 offset = pos();
+        qint64 done = 0;
+        while (offset + done < m_originalSize && done < size) {
+            const qint64 chunk = qMin(size - done, m_originalSize - offset - done);
+            m_buffer.resize(chunk);
+            if (!m_original.seek(offset + done) || m_original.read(m_buffer.data(), chunk) != chunk || memcmp(m_buffer.constData(), data + done, chunk) != 0) {
+                m_valid = false;
+                return -1;
+            }
+            done += chunk;
+        }
+        if (done == size)
+            return size;
+
+        if (offset + done != m_originalSize + m_update.size()) {
+            // poppler wrote somewhere else than at the end
+            m_valid = false;
+            return -1;
+        }
+        m_update.append(data + done, size - done);
+        return size;
+    }
+
+private:
+    QFile m_original;
+    qint64 m_originalSize = 0;
+    QByteArray m_buffer;
+    QByteArray m_update;
+    bool m_valid = true;
+};
+
 bool PDFGenerator::supportsOption(SaveOption option) const
 {
     switch (option) {
     case SaveChanges: {
         return true;
     }
+    case SaveInPlace: {
+        // nothing to append to for documents loaded from memory
+        return !documentFileName.isEmpty();
+    }
     default:;
     }
     return false;
@@ -1838,13 +2620,16 @@ bool PDFGenerator::supportsOption(SaveOption option) const
 bool PDFGenerator::save(const QString &fileName, SaveOptions options, QString *errorText)
 {
     Q_UNUSED(errorText);
+    if (options & SaveInPlace)
+        return saveInPlace(fileName);
+
     Poppler::PDFConverter *pdfConv = pdfdoc->pdfConverter();
 
     pdfConv->setOutputFileName(fileName);
     if (options & SaveChanges)
         pdfConv->setPDFOptions(pdfConv->pdfOptions() | Poppler::PDFConverter::WithChanges);
 
-    QMutexLocker locker(userMutex());
+    Okular::UserMutexLocker locker(this, AnnotationsSite);
 
     QHashIterator<Okular::Annotation *, Poppler::Annotation *> it(annotationsOnOpenHash);
     while (it.hasNext()) {
@@ -1876,6 +2661,52 @@ bool PDFGenerator::save(const QString &fileName, SaveOptions options, QString *e
     return success;
 }
 
+bool PDFGenerator::saveInPlace(const QString &fileName)
+{
+    if (documentFileName.isEmpty() || QFileInfo(fileName).canonicalFilePath() != QFileInfo(documentFileName).canonicalFilePath())
+        return false;
+
+    IncrementalUpdateDevice device(documentFileName);
+    if (!device.open(QIODevice::WriteOnly))
+        return false;
+
+    std::unique_ptr<Poppler::PDFConverter> pdfConv(pdfdoc->pdfConverter());
+    pdfConv->setOutputDevice(&device);
+    pdfConv->setPDFOptions(pdfConv->pdfOptions() | Poppler::PDFConverter::WithChanges);
+
+    {
+        Okular::UserMutexLocker locker(this, AnnotationsSite);
+
+        QHashIterator<Okular::Annotation *, Poppler::Annotation *> it(annotationsOnOpenHash);
+        while (it.hasNext()) {
+            it.next();
+
+            if (it.value()->uniqueName().isEmpty()) {
+                it.value()->setUniqueName(it.key()->uniqueName());
+            }
+        }
+
+        if (!pdfConv->convert() || !device.isValid()) {
+            qCDebug(OkularPdfDebug) << "The changes can't be appended to" << fileName;
+            return false;
+        }
+    }
+
+    if (device.update().isEmpty())
+        return true;
+
+    QFile file(fileName);
+    const qint64 originalSize = file.size();
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append))
+        return false;
+    if (file.write(device.update()) != device.update().size() || !file.flush()) {
+        // leave the file as it was
+        file.resize(originalSize);
+        return false;
+    }
+    return true;
+}
+
 Okular::AnnotationProxy *PDFGenerator::annotationProxy() const
 {
     return annotProxy;
@@ -16,18 +16,26 @@
 
 #include <poppler-qt5.h>
 
+#include <memory>
+
 #include <QBitArray>
+#include <QMutex>
 #include <QPointer>
+#include <QSet>
 
 #include <core/document.h>
 #include <core/generator.h>
+#include <core/outline.h>
 #include <core/printoptionswidget.h>
 #include <interfaces/configinterface.h>
 #include <interfaces/printinterface.h>
 #include <interfaces/saveinterface.h>
 
+#include "documentpool.h"
+
 class PDFOptionsPage;
 class PopplerAnnotationProxy;
+struct BackgroundTaskTarget;
 
 /**
  * @short A generator that builds contents from a PDF document.
@@ -56,10 +64,15 @@ public:
     // [INHERITED] load a document and fill up the pagesVector
     Okular::Document::OpenResult loadDocumentWithPassword(const QString &filePath, QVector<Okular::Page *> &pagesVector, const QString &password) override;
     Okular::Document::OpenResult loadDocumentFromDataWithPassword(const QByteArray &fileData, QVector<Okular::Page *> &pagesVector, const QString &password) override;
-    void loadPages(QVector<Okular::Page *> &pagesVector, int rotation = -1, bool clear = false);
+    // appends the next pages for about sliceTime msec, at least one, or all of them
+    // if sliceTime is negative; returns whether more pages are to come
+    bool loadPages(QVector<Okular::Page *> &pagesVector, int sliceTime);
+    bool loadMorePages(QVector<Okular::Page *> &pagesVector) override;
+    bool reloadDocument(const QString &fileName, QVector<Okular::Page *> &pagesVector, QVector<int> &changedPages) override;
     // [INHERITED] document information
     Okular::DocumentInfo generateDocumentInfo(const QSet<Okular::DocumentInfo::Key> &keys) const override;
     const Okular::DocumentSynopsis *generateDocumentSynopsis() override;
+    const Okular::Outline *generateOutline() override;
     Okular::FontInfo::List fontsForPage(int page) override;
     const QList<Okular::EmbeddedFile *> *embeddedFiles() const override;
     PageSizeMetric pagesSizeMetric() const override
@@ -74,6 +87,9 @@ public:
 
     // [INHERITED] perform actions on document / pages
     QImage image(Okular::PixmapRequest *request) override;
+    QImage embeddedThumbnail(const Okular::Page *page) const override;
+    bool loadPageData(Okular::Page *page) override;
+    void pageModified(int page) override;
 
     // [INHERITED] print page using an already configured kprinter
     bool print(QPrinter &printer) override;
@@ -116,12 +132,23 @@ private:
 
     // create the document synopsis hierarchy
     void addSynopsisChildren(const QVector<Poppler::OutlineItem> &outlineItems, QDomNode *parentDestination);
+    // the same, in the compact outline
+    void addOutlineChildren(const QVector<Poppler::OutlineItem> &outlineItems, int parent);
     // fetch annotations from the pdf file and add they to the page
     void addAnnotations(Poppler::Page *popplerPage, Okular::Page *page);
     // fetch the transition information and add it to the page
     void addTransition(Poppler::Page *pdfPage, Okular::Page *page);
+    // the annotations, transition and page actions of the page
+    void addPageData(Poppler::Page *pdfPage, Okular::Page *page);
     // fetch the poppler page form fields
     QLinkedList<Okular::FormField *> getFormFields(Poppler::Page *popplerPage);
+    // verify the certificates of the signatures of formFields in the background
+    void verifySignatures(int page, const QLinkedList<Okular::FormField *> &formFields);
+    void signatureVerified(int page, const QString &name, int generation, const Poppler::SignatureValidationInfo &info);
+    // take the fingerprint of page in the background, unless it has one; if
+    // it is not previous, the page changed since the reload
+    void fingerprintPage(int page, uint previous);
+    void takeFingerprint(int page, int generation, uint previous);
 
     Okular::TextPage *abstractTextPage(const QList<Poppler::TextBox *> &text, double height, double width, int rot);
 
@@ -130,8 +157,21 @@ private:
 
     bool setDocumentRenderHints();
 
+    // a copy of the document for the read only work on page, or else pdfdoc with the user mutex locked
+    Poppler::Document *acquireDocument(int page, UserMutexSite site);
+    // whether the page uses any font, i.e. whether it can have text
+    bool pageHasFonts(int page);
+    void releaseDocument(Poppler::Document *document);
+    // renders page for a rasterized print job, in any thread
+    QImage rasterizePage(int page, double dpiX, double dpiY, bool printAnnots, QSizeF *pageSize);
+    bool saveInPlace(const QString &fileName);
+
     // poppler dependent stuff
     Poppler::Document *pdfdoc;
+    // where pdfdoc was loaded from, for the copies of documentPool
+    QString documentFileName;
+    QByteArray documentData;
+    PopplerDocumentPool documentPool;
 
     void xrefReconstructionHandler();
 
@@ -139,16 +179,41 @@ private:
     bool docSynopsisDirty;
     bool xrefReconstructed;
     Okular::DocumentSynopsis docSyn;
+    bool docOutlineDirty;
+    Okular::Outline docOutline;
     mutable bool docEmbeddedFilesDirty;
     mutable QList<Okular::EmbeddedFile *> docEmbeddedFiles;
     int nextFontPage;
+    // the first page loadPages() did not create yet
+    int nextPage;
+    // the first page whose signatures are not being verified yet, the
+    // document gets the pages of loadMorePages() at once after the last slice
+    int nextVerifiedPage;
+    // the fully qualified names of the form fields of the pages created so far,
+    // to see which signatures have a page below
+    QSet<QString> formFieldNames;
     PopplerAnnotationProxy *annotProxy;
     mutable Okular::CertificateStore *certStore;
+
+    // where the verifications and the fingerprints in the background post
+    // their results; closing the document only bumps its generation, it
+    // waits at most for the one fingerprint being taken
+    std::shared_ptr<BackgroundTaskTarget> backgroundTarget;
+
     // the hash below only contains annotations that were present on the file at open time
     // this is enough for what we use it for
     QHash<Okular::Annotation *, Poppler::Annotation *> annotationsOnOpenHash;
 
     QBitArray rectsGenerated;
+    // the pages that have their annotations, transition and actions, see loadPageData()
+    QBitArray pageDataLoaded;
+    // what the pages looked like when they were first rendered, 0 for the
+    // ones not rendered yet, see pageFingerprint(); taken in the background,
+    // under fingerprintMutex, bumping the generation drops the ones being taken
+    QMutex fingerprintMutex;
+    QVector<uint> pageFingerprints;
+    QBitArray fingerprintsAsked;
+    int fingerprintGeneration;
 
     QPointer<PDFOptionsPage> pdfOptionsPage;
 
@@ -7,8 +7,12 @@
 #include "pdfsignatureutils.h"
 
 #include <KLocalizedString>
+#include <QCache>
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QDebug>
 #include <QInputDialog>
+#include <QMutex>
 
 PopplerCertificateInfo::PopplerCertificateInfo(const Poppler::CertificateInfo &info)
     : m_info(info)
@@ -124,6 +128,11 @@ QByteArray PopplerCertificateInfo::certificateData() const
     return m_info.certificateData();
 }
 
+void PopplerCertificateInfo::setInfo(const Poppler::CertificateInfo &info)
+{
+    m_info = info;
+}
+
 bool PopplerCertificateInfo::checkPassword(const QString &password) const
 {
 #ifdef HAVE_POPPLER_SIGNING
@@ -136,6 +145,7 @@ bool PopplerCertificateInfo::checkPassword(const QString &password) const
 
 PopplerSignatureInfo::PopplerSignatureInfo(const Poppler::SignatureValidationInfo &info)
     : m_info(info)
+    , m_certificateValidationInfo(info)
 {
     m_certfiticateInfo = new PopplerCertificateInfo(m_info.certificateInfo());
 }
@@ -169,7 +179,7 @@ PopplerSignatureInfo::SignatureStatus PopplerSignatureInfo::signatureStatus() co
 
 PopplerSignatureInfo::CertificateStatus PopplerSignatureInfo::certificateStatus() const
 {
-    switch (m_info.certificateStatus()) {
+    switch (m_certificateValidationInfo.certificateStatus()) {
     case Poppler::SignatureValidationInfo::CertificateTrusted:
         return CertificateTrusted;
     case Poppler::SignatureValidationInfo::CertificateUntrustedIssuer:
@@ -256,6 +266,50 @@ const Okular::CertificateInfo &PopplerSignatureInfo::certificateInfo() const
     return *m_certfiticateInfo;
 }
 
+void PopplerSignatureInfo::setInfo(const Poppler::SignatureValidationInfo &info)
+{
+    m_info = info;
+    m_certificateValidationInfo = info;
+    m_certfiticateInfo->setInfo(m_info.certificateInfo());
+}
+
+void PopplerSignatureInfo::setCertificateInfo(const Poppler::SignatureValidationInfo &info)
+{
+    m_certificateValidationInfo = info;
+    m_certfiticateInfo->setInfo(info.certificateInfo());
+}
+
+// the verified signatures of about as many documents as one works with in a session
+static const int kSignatureCacheSize = 1000;
+
+static QMutex signatureCacheMutex;
+static QCache<QByteArray, Poppler::SignatureValidationInfo> signatureCache(kSignatureCacheSize);
+
+QByteArray PopplerSignatureCache::key(const Poppler::SignatureValidationInfo &info)
+{
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+    stream << info.signedRangeBounds();
+    return QCryptographicHash::hash(info.signature(), QCryptographicHash::Sha256) + key;
+}
+
+bool PopplerSignatureCache::find(const QByteArray &key, Poppler::SignatureValidationInfo *info)
+{
+    QMutexLocker locker(&signatureCacheMutex);
+    const Poppler::SignatureValidationInfo *cached = signatureCache.object(key);
+    if (!cached)
+        return false;
+
+    *info = *cached;
+    return true;
+}
+
+void PopplerSignatureCache::insert(const QByteArray &key, const Poppler::SignatureValidationInfo &info)
+{
+    QMutexLocker locker(&signatureCacheMutex);
+    signatureCache.insert(key, new Poppler::SignatureValidationInfo(info));
+}
+
 #ifdef HAVE_POPPLER_SIGNING
 PopplerCertificateStore::~PopplerCertificateStore() = default;
 
@@ -35,6 +35,8 @@ public:
     QByteArray certificateData() const override;
     bool checkPassword(const QString &password) const override;
 
+    void setInfo(const Poppler::CertificateInfo &info);
+
 private:
     Poppler::CertificateInfo m_info;
 };
@@ -58,11 +60,30 @@ public:
     bool signsTotalDocument() const override;
     const Okular::CertificateInfo &certificateInfo() const override;
 
+    // in place, the views may hold on to this and the certificate info
+    void setInfo(const Poppler::SignatureValidationInfo &info);
+    // only the certificate status and info of @p info, the signature status
+    // stays the one of the signed bytes of this document
+    void setCertificateInfo(const Poppler::SignatureValidationInfo &info);
+
 private:
     Poppler::SignatureValidationInfo m_info;
-    Okular::CertificateInfo *m_certfiticateInfo;
+    // where the certificate status comes from, m_info or a verification of the same signature
+    Poppler::SignatureValidationInfo m_certificateValidationInfo;
+    PopplerCertificateInfo *m_certfiticateInfo;
 };
 
+// the signatures whose certificates were verified, by their contents and
+// their byte range; kept for the documents opened again, verifying can take
+// the network for revocation checks. The signed bytes are not part of the
+// key, only the certificate status of what is found is to be trusted
+namespace PopplerSignatureCache
+{
+QByteArray key(const Poppler::SignatureValidationInfo &info);
+bool find(const QByteArray &key, Poppler::SignatureValidationInfo *info);
+void insert(const QByteArray &key, const Poppler::SignatureValidationInfo &info);
+}
+
 #ifdef HAVE_POPPLER_SIGNING
 
 class PopplerCertificateStore : public Okular::CertificateStore
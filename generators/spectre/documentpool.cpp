@@ -0,0 +1,124 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "documentpool.h"
+
+#include <QAtomicInt>
+#include <QFile>
+#include <QMutexLocker>
+
+#include "spectre_debug.h"
+
+// one for each pixmap generation thread of the core
+static const int maxPoolCopies = 8;
+
+// cleared once ghostscript fails to run next to another instance
+static QAtomicInt multipleInstances = 1;
+
+GSDocumentPool::GSDocumentPool()
+    : m_pageCount(0)
+    , m_usable(false)
+{
+}
+
+GSDocumentPool::~GSDocumentPool()
+{
+    clear();
+}
+
+void GSDocumentPool::setSource(const QString &fileName, int pageCount)
+{
+    clear();
+
+    QMutexLocker locker(&m_mutex);
+    m_fileName = fileName;
+    m_pageCount = pageCount;
+    m_usable = true;
+}
+
+void GSDocumentPool::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    deleteFreeCopies();
+    // the ones in use are deleted when they come back
+    m_copies.clear();
+    m_fileName.clear();
+    m_usable = false;
+}
+
+GSDocumentPool::Copy *GSDocumentPool::acquire()
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_usable || !multipleInstances.loadAcquire())
+        return nullptr;
+
+    if (!m_freeCopies.isEmpty())
+        return m_freeCopies.takeLast();
+
+    if (m_copies.count() >= maxPoolCopies)
+        return nullptr;
+
+    // reading the document comments is quick, no need to let the others in
+    Copy *copy = new Copy;
+    copy->document = spectre_document_new();
+    spectre_document_load(copy->document, QFile::encodeName(m_fileName).constData());
+    copy->renderContext = spectre_render_context_new();
+    if (spectre_document_status(copy->document) != SPECTRE_STATUS_SUCCESS || int(spectre_document_get_n_pages(copy->document)) != m_pageCount) {
+        // the file is not what the generator opened anymore, stick to its document
+        qCDebug(OkularSpectreDebug) << "Could not open a copy of the document, rendering in one thread";
+        free(copy);
+        m_usable = false;
+        deleteFreeCopies();
+        return nullptr;
+    }
+    m_copies.append(copy);
+    return copy;
+}
+
+void GSDocumentPool::release(Copy *copy)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_usable || !m_copies.contains(copy)) {
+        m_copies.removeOne(copy);
+        free(copy);
+        return;
+    }
+
+    m_freeCopies.append(copy);
+}
+
+void GSDocumentPool::renderingFailed(Copy *copy)
+{
+    QMutexLocker locker(&m_mutex);
+    if (multipleInstances.fetchAndStoreRelease(0))
+        qCDebug(OkularSpectreDebug) << "Could not render with a copy of the document, rendering in one thread";
+    m_usable = false;
+    deleteFreeCopies();
+    m_copies.removeOne(copy);
+    free(copy);
+}
+
+QMutex *GSDocumentPool::singleInstanceMutex()
+{
+    static QMutex mutex;
+    return &mutex;
+}
+
+void GSDocumentPool::free(Copy *copy)
+{
+    spectre_render_context_free(copy->renderContext);
+    spectre_document_free(copy->document);
+    delete copy;
+}
+
+void GSDocumentPool::deleteFreeCopies()
+{
+    for (Copy *copy : qAsConst(m_freeCopies)) {
+        m_copies.removeOne(copy);
+        free(copy);
+    }
+    m_freeCopies.clear();
+}
@@ -0,0 +1,87 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _OKULAR_GENERATOR_GHOSTVIEW_DOCUMENTPOOL_H_
+#define _OKULAR_GENERATOR_GHOSTVIEW_DOCUMENTPOOL_H_
+
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+#include <libspectre/spectre.h>
+
+/**
+ * Copies of the document the generator opened, each with its own render
+ * context, so that the pixmap generation threads of the core render pages
+ * at the same time, each with a ghostscript instance of its own, instead of
+ * waiting for each other on the document of the generator.
+ *
+ * The copies are opened as they are needed, all the methods can be called
+ * from any thread.
+ */
+class GSDocumentPool
+{
+public:
+    struct Copy {
+        SpectreDocument *document;
+        SpectreRenderContext *renderContext;
+    };
+
+    GSDocumentPool();
+    ~GSDocumentPool();
+
+    /**
+     * Opens the copies from @p fileName, the file of the document of the
+     * generator, which has @p pageCount pages.
+     */
+    void setSource(const QString &fileName, int pageCount);
+
+    /**
+     * Deletes the copies, none is handed out until the next source is set.
+     */
+    void clear();
+
+    /**
+     * Returns a copy that nobody else uses, or nullptr if the document of
+     * the generator has to be used.
+     */
+    Copy *acquire();
+
+    /**
+     * Gives back a copy returned by acquire().
+     */
+    void release(Copy *copy);
+
+    /**
+     * Rendering with @p copy failed, ghostscript may not be able to run
+     * more than one instance: no pool of the process hands out copies
+     * anymore.
+     */
+    void renderingFailed(Copy *copy);
+
+    /**
+     * To be locked around rendering with the document of the generator,
+     * the documents of all the generators of the process then render one
+     * at a time in case ghostscript can only run one instance.
+     */
+    static QMutex *singleInstanceMutex();
+
+private:
+    Q_DISABLE_COPY(GSDocumentPool)
+
+    static void free(Copy *copy);
+    void deleteFreeCopies();
+
+    mutable QMutex m_mutex;
+    QString m_fileName;
+    int m_pageCount;
+    // the copies that are open, in use or not
+    QVector<Copy *> m_copies;
+    QVector<Copy *> m_freeCopies;
+    bool m_usable;
+};
+
+#endif
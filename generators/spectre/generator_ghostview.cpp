@@ -9,6 +9,7 @@
 #include <math.h>
 
 #include <QFile>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QPixmap>
 #include <QPrinter>
@@ -31,7 +32,6 @@
 #include "gssettings.h"
 #include "ui_gssettingswidget.h"
 
-#include "rendererthread.h"
 #include "spectre_debug.h"
 
 OKULAR_EXPORT_PLUGIN(GSGenerator, "libokularGenerator_ghostview.json")
@@ -39,15 +39,13 @@ OKULAR_EXPORT_PLUGIN(GSGenerator, "libokularGenerator_ghostview.json")
 GSGenerator::GSGenerator(QObject *parent, const QVariantList &args)
     : Okular::Generator(parent, args)
     , m_internalDocument(nullptr)
-    , m_request(nullptr)
+    , m_renderContext(nullptr)
 {
+    setFeature(Threaded);
+    setFeature(ParallelRendering);
+    setFeature(SupportsCancelling);
     setFeature(PrintPostscript);
     setFeature(PrintToFile);
-
-    GSRendererThread *renderer = GSRendererThread::getCreateRenderer();
-    if (!renderer->isRunning())
-        renderer->start();
-    connect(renderer, &GSRendererThread::imageDone, this, &GSGenerator::slotImageGenerated, Qt::QueuedConnection);
 }
 
 GSGenerator::~GSGenerator()
@@ -145,34 +143,22 @@ bool GSGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *>
     }
     pagesVector.resize(spectre_document_get_n_pages(m_internalDocument));
     qCDebug(OkularSpectreDebug) << "Page count:" << pagesVector.count();
+    m_renderContext = spectre_render_context_new();
+    m_documentPool.setSource(fileName, pagesVector.count());
     return loadPages(pagesVector);
 }
 
 bool GSGenerator::doCloseDocument()
 {
+    m_documentPool.clear();
+    spectre_render_context_free(m_renderContext);
+    m_renderContext = nullptr;
     spectre_document_free(m_internalDocument);
     m_internalDocument = nullptr;
 
     return true;
 }
 
-void GSGenerator::slotImageGenerated(QImage *img, Okular::PixmapRequest *request)
-{
-    // This can happen as GSInterpreterCMD is a singleton and on creation signals all the slots
-    // of all the generators attached to it
-    if (request != m_request)
-        return;
-
-    if (!request->page()->isBoundingBoxKnown())
-        updatePageBoundingBox(request->page()->number(), Okular::Utils::imageBoundingBox(img));
-
-    m_request = nullptr;
-    QPixmap *pix = new QPixmap(QPixmap::fromImage(*img));
-    delete img;
-    request->page()->setPixmap(request->observer(), pix);
-    signalPixmapRequestDone(request);
-}
-
 bool GSGenerator::loadPages(QVector<Okular::Page *> &pagesVector)
 {
     for (uint i = 0; i < spectre_document_get_n_pages(m_internalDocument); i++) {
@@ -194,40 +180,108 @@ bool GSGenerator::loadPages(QVector<Okular::Page *> &pagesVector)
     return pagesVector.count() > 0;
 }
 
-void GSGenerator::generatePixmap(Okular::PixmapRequest *req)
+QImage GSGenerator::image(Okular::PixmapRequest *request)
 {
-    qCDebug(OkularSpectreDebug) << "receiving" << *req;
-
-    SpectrePage *page = spectre_document_get_page(m_internalDocument, req->pageNumber());
-
-    GSRendererThread *renderer = GSRendererThread::getCreateRenderer();
-
-    GSRendererThreadRequest gsreq(this);
-    gsreq.spectrePage = page;
-    gsreq.platformFonts = GSSettings::platformFonts();
-    int graphicsAA = 1;
-    int textAA = 1;
-    if (cache_AAgfx)
-        graphicsAA = 4;
-    if (cache_AAtext)
-        textAA = 4;
-    gsreq.textAAbits = textAA;
-    gsreq.graphicsAAbits = graphicsAA;
-
-    gsreq.orientation = req->page()->orientation();
-    if (req->page()->rotation() == Okular::Rotation90 || req->page()->rotation() == Okular::Rotation270) {
-        gsreq.magnify = qMax((double)req->height() / req->page()->width(), (double)req->width() / req->page()->height());
-    } else {
-        gsreq.magnify = qMax((double)req->width() / req->page()->width(), (double)req->height() / req->page()->height());
+    qCDebug(OkularSpectreDebug) << "receiving" << *request;
+
+    if (request->shouldAbortRender())
+        return QImage();
+
+    GSDocumentPool::Copy *copy = m_documentPool.acquire();
+    if (copy) {
+        const QImage image = renderPage(request, copy->document, copy->renderContext);
+        if (!image.isNull() || request->shouldAbortRender()) {
+            m_documentPool.release(copy);
+            return image;
+        }
+        m_documentPool.renderingFailed(copy);
     }
-    gsreq.request = req;
-    m_request = req;
-    renderer->addRequest(gsreq);
+
+    QMutexLocker locker(userMutex());
+    QMutexLocker instanceLocker(GSDocumentPool::singleInstanceMutex());
+    return renderPage(request, m_internalDocument, m_renderContext);
 }
 
-bool GSGenerator::canGeneratePixmap() const
+QImage GSGenerator::renderPage(Okular::PixmapRequest *request, SpectreDocument *document, SpectreRenderContext *renderContext) const
 {
-    return !m_request;
+    SpectrePage *page = spectre_document_get_page(document, request->pageNumber());
+    if (!page)
+        return QImage();
+
+    double magnify;
+    const int orientation = request->page()->orientation();
+    if (request->page()->rotation() == Okular::Rotation90 || request->page()->rotation() == Okular::Rotation270) {
+        magnify = qMax((double)request->height() / request->page()->width(), (double)request->width() / request->page()->height());
+    } else {
+        magnify = qMax((double)request->width() / request->page()->width(), (double)request->height() / request->page()->height());
+    }
+
+    spectre_render_context_set_scale(renderContext, magnify, magnify);
+    spectre_render_context_set_use_platform_fonts(renderContext, GSSettings::platformFonts());
+    spectre_render_context_set_antialias_bits(renderContext, cache_AAgfx ? 4 : 1, cache_AAtext ? 4 : 1);
+    // Do not use spectre_render_context_set_rotation makes some files not render correctly, e.g. bug210499.ps
+    // so we basically do the rendering without any rotation and then rotate to the orientation as needed
+    // spectre_render_context_set_rotation(renderContext, orientation);
+
+    unsigned char *data = nullptr;
+    int row_length = 0;
+    int wantedWidth = request->width();
+    int wantedHeight = request->height();
+
+    if (orientation % 2)
+        qSwap(wantedWidth, wantedHeight);
+
+    spectre_page_render(page, renderContext, &data, &row_length);
+    spectre_page_free(page);
+    if (!data)
+        return QImage();
+
+    // Qt needs the missing alpha of QImage::Format_RGB32 to be 0xff
+    if (data[3] != 0xff) {
+        for (int i = 3; i < row_length * wantedHeight; i += 4)
+            data[i] = 0xff;
+    }
+
+    QImage img;
+    if (row_length == wantedWidth * 4) {
+        img = QImage(data, wantedWidth, wantedHeight, QImage::Format_RGB32);
+    } else {
+        // In case this ends up beign very slow we can try with some memmove
+        QImage aux(data, row_length / 4, wantedHeight, QImage::Format_RGB32);
+        img = QImage(aux.copy(0, 0, wantedWidth, wantedHeight));
+    }
+
+    switch (orientation) {
+    case Okular::Rotation90: {
+        QTransform m;
+        m.rotate(90);
+        img = img.transformed(m);
+        break;
+    }
+
+    case Okular::Rotation180: {
+        QTransform m;
+        m.rotate(180);
+        img = img.transformed(m);
+        break;
+    }
+    case Okular::Rotation270: {
+        QTransform m;
+        m.rotate(270);
+        img = img.transformed(m);
+    }
+    }
+
+    QImage image = img.copy();
+    free(data);
+
+    if (image.width() != request->width() || image.height() != request->height()) {
+        qCWarning(OkularSpectreDebug).nospace() << "Generated image does not match wanted size: "
+                                                << "[" << image.width() << "x" << image.height() << "] vs requested "
+                                                << "[" << request->width() << "x" << request->height() << "]";
+        image = image.scaled(wantedWidth, wantedHeight);
+    }
+    return image;
 }
 
 Okular::DocumentInfo GSGenerator::generateDocumentInfo(const QSet<Okular::DocumentInfo::Key> &keys) const
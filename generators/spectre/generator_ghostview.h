@@ -12,6 +12,8 @@
 
 #include <libspectre/spectre.h>
 
+#include "documentpool.h"
+
 class GSGenerator : public Okular::Generator, public Okular::ConfigInterface
 {
     Q_OBJECT
@@ -34,10 +36,6 @@ public:
         return nullptr;
     }
 
-    // page contents generation
-    bool canGeneratePixmap() const override;
-    void generatePixmap(Okular::PixmapRequest *request) override;
-
     QVariant metaData(const QString &key, const QVariant &option) const override;
 
     // print document using already configured kprinter
@@ -51,20 +49,22 @@ public:
     GSGenerator(QObject *parent, const QVariantList &args);
     ~GSGenerator() override;
 
-public Q_SLOTS:
-    void slotImageGenerated(QImage *img, Okular::PixmapRequest *request);
-
 protected:
     bool doCloseDocument() override;
+    QImage image(Okular::PixmapRequest *request) override;
 
 private:
     bool loadPages(QVector<Okular::Page *> &pagesVector);
     Okular::Rotation orientation(SpectreOrientation orientation) const;
 
+    // renders the page of request with document and context, in any thread
+    QImage renderPage(Okular::PixmapRequest *request, SpectreDocument *document, SpectreRenderContext *renderContext) const;
+
     // backendish stuff
     SpectreDocument *m_internalDocument;
-
-    Okular::PixmapRequest *m_request;
+    // used with m_internalDocument, behind the user mutex
+    SpectreRenderContext *m_renderContext;
+    GSDocumentPool m_documentPool;
 
     bool cache_AAtext;
     bool cache_AAgfx;
@@ -7,6 +7,7 @@
 #include "generator_tiff.h"
 
 #include <QBuffer>
+#include <QDataStream>
 #include <QDateTime>
 #include <QFile>
 #include <QFileInfo>
@@ -14,11 +15,13 @@
 #include <QList>
 #include <QPainter>
 #include <QPrinter>
+#include <QVector>
 
 #include <KAboutData>
 #include <KLocalizedString>
 #include <QDebug>
 
+#include <core/diskcache_p.h>
 #include <core/document.h>
 #include <core/fileprinter.h>
 #include <core/page.h>
@@ -27,8 +30,25 @@
 #include <tiff.h>
 #include <tiffio.h>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #define TiffDebug 4714
 
+// the format of the files of the directory cache
+static const qint32 directoryCacheVersion = 1;
+
+// where the directories of the files opened before are kept
+static const Okular::DiskCache &directoryCache()
+{
+    static const Okular::DiskCache cache(QStringLiteral("tiff"));
+    return cache;
+}
+
+// the most a page decodes at once when printing, in bytes
+static const int printBandBytes = 16 * 1024 * 1024;
+
 tsize_t okular_tiffReadProc(thandle_t handle, tdata_t buf, tsize_t size)
 {
     QIODevice *device = static_cast<QIODevice *>(handle);
@@ -86,14 +106,97 @@ public:
     Private()
         : tiff(nullptr)
         , dev(nullptr)
+        , currentPage(-1)
+    {
+    }
+
+    // what the requests need of the directory of a page, read once when
+    // loading, or from the cache of the file
+    struct Directory {
+        toff_t offset;
+        uint32_t width;
+        uint32_t height;
+        uint32_t orientation;
+        // 0 if the directory has no resolution
+        float xResolution;
+        float yResolution;
+        uint32_t resolutionUnit;
+    };
+
+    bool readDirectoryCache();
+    void writeDirectoryCache() const;
+
+    /**
+     * Makes the directory of @p page the current one, going straight to it
+     * instead of through the directories before it.
+     */
+    const Directory *selectPage(int page)
     {
+        if (page < 0 || page >= directories.count())
+            return nullptr;
+
+        if (page != currentPage) {
+            if (!TIFFSetSubDirectory(tiff, directories.at(page).offset)) {
+                currentPage = -1;
+                return nullptr;
+            }
+            currentPage = page;
+        }
+        return &directories.at(page);
     }
 
     TIFF *tiff;
     QByteArray data;
     QIODevice *dev;
+    QVector<Directory> directories;
+    int currentPage;
+    // empty for the documents opened from data
+    QByteArray directoryCacheKey;
 };
 
+bool TIFFGenerator::Private::readDirectoryCache()
+{
+    if (directoryCacheKey.isEmpty())
+        return false;
+    const QByteArray data = directoryCache().read(directoryCacheKey);
+    if (data.isEmpty())
+        return false;
+
+    QDataStream stream(data);
+    qint32 version, count;
+    stream >> version >> count;
+    if (stream.status() != QDataStream::Ok || version != directoryCacheVersion || count < 0)
+        return false;
+
+    QVector<Directory> cached;
+    cached.reserve(qMin(count, 65536));
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        quint64 offset;
+        Directory dir;
+        stream >> offset >> dir.width >> dir.height >> dir.orientation >> dir.xResolution >> dir.yResolution >> dir.resolutionUnit;
+        dir.offset = offset;
+        cached.append(dir);
+    }
+    if (stream.status() != QDataStream::Ok)
+        return false;
+
+    directories = cached;
+    return true;
+}
+
+void TIFFGenerator::Private::writeDirectoryCache() const
+{
+    if (directoryCacheKey.isEmpty())
+        return;
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream << directoryCacheVersion << qint32(directories.count());
+    for (const Directory &dir : directories)
+        stream << quint64(dir.offset) << dir.width << dir.height << dir.orientation << dir.xResolution << dir.yResolution << dir.resolutionUnit;
+    directoryCache().write(directoryCacheKey, data);
+}
+
 static QDateTime convertTIFFDateTime(const char *tiffdate)
 {
     if (!tiffdate)
@@ -102,11 +205,9 @@ static QDateTime convertTIFFDateTime(const char *tiffdate)
     return QDateTime::fromString(QString::fromLatin1(tiffdate), QStringLiteral("yyyy:MM:dd HH:mm:ss"));
 }
 
-static void adaptSizeToResolution(TIFF *tiff, ttag_t whichres, double dpi, uint32_t *size)
+static void adaptSizeToResolution(float resvalue, uint32_t resunit, double dpi, uint32_t *size)
 {
-    float resvalue = 1.0;
-    uint16_t resunit = 0;
-    if (!TIFFGetField(tiff, whichres, &resvalue) || !TIFFGetFieldDefaulted(tiff, TIFFTAG_RESOLUTIONUNIT, &resunit))
+    if (resvalue <= 0)
         return;
 
     float newsize = *size / resvalue;
@@ -122,13 +223,8 @@ static void adaptSizeToResolution(TIFF *tiff, ttag_t whichres, double dpi, uint3
     }
 }
 
-static Okular::Rotation readTiffRotation(TIFF *tiff)
+static Okular::Rotation tiffRotation(uint32_t tiffOrientation)
 {
-    uint32_t tiffOrientation = 0;
-
-    if (!TIFFGetField(tiff, TIFFTAG_ORIENTATION, &tiffOrientation))
-        return Okular::Rotation0;
-
     Okular::Rotation ret = Okular::Rotation0;
     switch (tiffOrientation) {
     case ORIENTATION_TOPLEFT:
@@ -152,6 +248,204 @@ static Okular::Rotation readTiffRotation(TIFF *tiff)
     return ret;
 }
 
+// an image read by ReadRGBA* is ABGR, we need ARGB, so swap red and blue
+static void swapRedBlue(uint32_t *data, int count)
+{
+    int i = 0;
+#ifdef __SSE2__
+    const __m128i greenAlpha = _mm_set1_epi32(0xFF00FF00);
+    const __m128i lowByte = _mm_set1_epi32(0x000000FF);
+    for (; i + 4 <= count; i += 4) {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        const __m128i red = _mm_and_si128(_mm_srli_epi32(pixels, 16), lowByte);
+        const __m128i blue = _mm_slli_epi32(_mm_and_si128(pixels, lowByte), 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(data + i), _mm_or_si128(_mm_and_si128(pixels, greenAlpha), _mm_or_si128(red, blue)));
+    }
+#endif
+    for (; i < count; ++i) {
+        uint32_t red = (data[i] & 0x00FF0000) >> 16;
+        uint32_t blue = (data[i] & 0x000000FF) << 16;
+        data[i] = (data[i] & 0xFF00FF00) + red + blue;
+    }
+}
+
+static void swapRedBlue(QImage *image)
+{
+    if (image->bytesPerLine() == image->width() * 4) {
+        swapRedBlue(reinterpret_cast<uint32_t *>(image->bits()), image->width() * image->height());
+        return;
+    }
+    for (int y = 0; y < image->height(); ++y)
+        swapRedBlue(reinterpret_cast<uint32_t *>(image->scanLine(y)), image->width());
+}
+
+/**
+ * Decodes the current directory, a TOPLEFT oriented image of @p width x
+ * @p height pixels in strips, one strip at a time, averaging the pixels of
+ * each strip into @p image as it goes, so the whole page is never in
+ * memory. @p image is no bigger than the page. Returns false if it fails
+ * or @p request is aborted.
+ */
+static bool readTiffScaled(TIFF *tiff, uint32_t width, uint32_t height, QImage *image, Okular::PixmapRequest *request)
+{
+    uint32_t rowsPerStrip = height;
+    TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &rowsPerStrip);
+    rowsPerStrip = qMin(rowsPerStrip, height);
+    if (rowsPerStrip == 0)
+        return false;
+
+    const int destWidth = image->width();
+    const int destHeight = image->height();
+    // the column of the image each column of the page goes to, and how many go there
+    QVector<int> destColumns(width);
+    QVector<quint32> columnWeights(destWidth, 0);
+    for (uint32_t x = 0; x < width; ++x) {
+        destColumns[x] = quint64(x) * destWidth / width;
+        ++columnWeights[destColumns[x]];
+    }
+
+    QVector<uint32_t> raster(width * rowsPerStrip);
+    // red, green and blue of the row of the image being filled
+    QVector<quint64> sums(destWidth * 3, 0);
+    int destRow = 0;
+    quint32 rowWeight = 0;
+    auto flushRow = [&] {
+        QRgb *line = reinterpret_cast<QRgb *>(image->scanLine(destRow));
+        for (int x = 0; x < destWidth; ++x) {
+            const quint64 weight = quint64(columnWeights[x]) * rowWeight;
+            quint64 *sum = sums.data() + x * 3;
+            line[x] = qRgb(sum[0] / weight, sum[1] / weight, sum[2] / weight);
+            sum[0] = sum[1] = sum[2] = 0;
+        }
+        rowWeight = 0;
+    };
+
+    for (uint32_t y = 0; y < height; y += rowsPerStrip) {
+        if (request->shouldAbortRender())
+            return false;
+
+        if (!TIFFReadRGBAStrip(tiff, y, raster.data()))
+            return false;
+
+        // a strip is bottom-up, with only the rows it read
+        const uint32_t rows = qMin(rowsPerStrip, height - y);
+        for (uint32_t r = 0; r < rows; ++r) {
+            const int row = quint64(y + r) * destHeight / height;
+            if (row != destRow) {
+                flushRow();
+                destRow = row;
+            }
+
+            // ABGR
+            const uint32_t *pixels = raster.constData() + (rows - 1 - r) * width;
+            for (uint32_t x = 0; x < width; ++x) {
+                quint64 *sum = sums.data() + destColumns[x] * 3;
+                sum[0] += pixels[x] & 0xFF;
+                sum[1] += (pixels[x] >> 8) & 0xFF;
+                sum[2] += (pixels[x] >> 16) & 0xFF;
+            }
+            ++rowWeight;
+        }
+    }
+    flushRow();
+
+    return true;
+}
+
+/**
+ * Gets the geometry of the blocks, tiles or strips, libtiff decodes at once
+ * from the current directory, an image of @p width x @p height pixels.
+ */
+static bool tiffBlockSize(TIFF *tiff, uint32_t width, uint32_t height, uint32_t *blockWidth, uint32_t *blockHeight)
+{
+    *blockWidth = width;
+    *blockHeight = height;
+    if (TIFFIsTiled(tiff)) {
+        if (!TIFFGetField(tiff, TIFFTAG_TILEWIDTH, blockWidth) || !TIFFGetField(tiff, TIFFTAG_TILELENGTH, blockHeight))
+            return false;
+    } else {
+        TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, blockHeight);
+        *blockHeight = qMin(*blockHeight, height);
+    }
+    return *blockWidth != 0 && *blockHeight != 0;
+}
+
+/**
+ * Tells how the ReadRGBA* functions of libtiff flip the rasters of a
+ * directory of @p orientation, as they make them bottom-left.
+ */
+static void tiffRasterFlips(uint32_t orientation, bool *horizontally, bool *vertically)
+{
+    switch (orientation) {
+    case ORIENTATION_TOPLEFT:
+    case ORIENTATION_LEFTTOP:
+        *horizontally = false;
+        *vertically = true;
+        break;
+    case ORIENTATION_TOPRIGHT:
+    case ORIENTATION_RIGHTTOP:
+        *horizontally = true;
+        *vertically = true;
+        break;
+    case ORIENTATION_BOTRIGHT:
+    case ORIENTATION_RIGHTBOT:
+        *horizontally = true;
+        *vertically = false;
+        break;
+    default:
+        *horizontally = false;
+        *vertically = false;
+        break;
+    }
+}
+
+/**
+ * Decodes only the tiles (or strips) of the current directory that intersect
+ * @p rect, an image of @p width x @p height pixels of @p orientation, and
+ * copies them into @p image, in the order the pixels are stored in, like
+ * TIFFReadRGBAImageOriented() with that same orientation. Returns false if
+ * it fails or @p request, if any, is aborted.
+ */
+static bool readTiffRegion(TIFF *tiff, uint32_t width, uint32_t height, uint32_t orientation, const QRect &rect, QImage *image, Okular::PixmapRequest *request)
+{
+    uint32_t blockWidth;
+    uint32_t blockHeight;
+    if (!tiffBlockSize(tiff, width, height, &blockWidth, &blockHeight))
+        return false;
+    const bool tiled = TIFFIsTiled(tiff);
+    bool flippedHorizontally;
+    bool flippedVertically;
+    tiffRasterFlips(orientation, &flippedHorizontally, &flippedVertically);
+
+    *image = QImage(rect.size(), QImage::Format_RGB32);
+    QVector<uint32_t> raster(blockWidth * blockHeight);
+    QPainter p(image);
+    const uint32_t firstX = rect.left() / blockWidth * blockWidth;
+    const uint32_t firstY = rect.top() / blockHeight * blockHeight;
+    for (uint32_t y = firstY; y < height && y <= (uint32_t)rect.bottom(); y += blockHeight) {
+        for (uint32_t x = firstX; x < width && x <= (uint32_t)rect.right(); x += blockWidth) {
+            if (request && request->shouldAbortRender())
+                return false;
+
+            const int ok = tiled ? TIFFReadRGBATile(tiff, x, y, raster.data()) : TIFFReadRGBAStrip(tiff, y, raster.data());
+            if (!ok)
+                return false;
+
+            // the valid rows are at the end of a tile, while a strip has
+            // only the rows it read; they are flipped back as stored
+            const int rows = qMin(blockHeight, height - y);
+            const int columns = qMin(blockWidth, width - x);
+            const uint32_t *firstRow = raster.constData() + (tiled ? (blockHeight - rows) * blockWidth : 0);
+            const QImage block = QImage(reinterpret_cast<const uchar *>(firstRow), columns, rows, blockWidth * 4, QImage::Format_RGB32).mirrored(flippedHorizontally, flippedVertically);
+            p.drawImage(QPoint(x, y) - rect.topLeft(), block);
+        }
+    }
+    p.end();
+
+    swapRedBlue(image);
+    return true;
+}
+
 OKULAR_EXPORT_PLUGIN(TIFFGenerator, "libokularGenerator_tiff.json")
 
 TIFFGenerator::TIFFGenerator(QObject *parent, const QVariantList &args)
@@ -159,6 +453,8 @@ TIFFGenerator::TIFFGenerator(QObject *parent, const QVariantList &args)
     , d(new Private)
 {
     setFeature(Threaded);
+    setFeature(SupportsCancelling);
+    setFeature(TiledRendering);
     setFeature(PrintNative);
     setFeature(PrintToFile);
     setFeature(ReadRawData);
@@ -179,7 +475,11 @@ bool TIFFGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *
     QFile *qfile = new QFile(fileName);
     qfile->open(QIODevice::ReadOnly);
     d->dev = qfile;
-    d->data = QFile::encodeName(QFileInfo(*qfile).fileName());
+    const QFileInfo fi(*qfile);
+    d->data = QFile::encodeName(fi.fileName());
+
+    // the directories of the file, keyed by it and its modification time
+    d->directoryCacheKey = Okular::DiskCache::fileKey(fileName);
     return loadTiff(pagesVector, d->data.constData());
 }
 
@@ -216,8 +516,10 @@ bool TIFFGenerator::doCloseDocument()
         delete d->dev;
         d->dev = nullptr;
         d->data.clear();
-        m_pageMapping.clear();
+        d->directories.clear();
+        d->currentPage = -1;
     }
+    d->directoryCacheKey.clear();
 
     return true;
 }
@@ -227,42 +529,67 @@ QImage TIFFGenerator::image(Okular::PixmapRequest *request)
     bool generated = false;
     QImage img;
 
-    if (TIFFSetDirectory(d->tiff, mapPage(request->page()->number()))) {
-        int rotation = request->page()->rotation();
-        uint32_t width = 1;
-        uint32_t height = 1;
-        uint32_t orientation = 0;
-        TIFFGetField(d->tiff, TIFFTAG_IMAGEWIDTH, &width);
-        TIFFGetField(d->tiff, TIFFTAG_IMAGELENGTH, &height);
+    // libtiff decodes the whole page at once, so check between the steps
+    if (request->shouldAbortRender())
+        return QImage();
 
-        if (!TIFFGetField(d->tiff, TIFFTAG_ORIENTATION, &orientation))
-            orientation = ORIENTATION_TOPLEFT;
+    if (const Private::Directory *dir = d->selectPage(request->page()->number())) {
+        int rotation = request->page()->rotation();
+        const uint32_t width = dir->width;
+        const uint32_t height = dir->height;
+        const uint32_t orientation = dir->orientation;
+
+        int reqwidth = request->width();
+        int reqheight = request->height();
+        if (request->isTile()) {
+            // the tiles and the strips of the file can be decoded separately,
+            // whatever the orientation, as the page rotation shows it
+            const QRect srcRect = request->normalizedRect().geometry(width, height);
+            const QRect destRect = request->normalizedRect().geometry(reqwidth, reqheight);
+            QImage region;
+            if (readTiffRegion(d->tiff, width, height, orientation, srcRect, &region, request))
+                return region.scaled(destRect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            if (request->shouldAbortRender())
+                return QImage();
+        } else {
+            if (rotation % 2 == 1)
+                qSwap(reqwidth, reqheight);
+            // smaller than the page, like thumbnails, decode it a strip at a time
+            if (orientation == ORIENTATION_TOPLEFT && !TIFFIsTiled(d->tiff) && (uint32_t)reqwidth <= width && (uint32_t)reqheight <= height) {
+                QImage scaled(reqwidth, reqheight, QImage::Format_RGB32);
+                if (readTiffScaled(d->tiff, width, height, &scaled, request))
+                    return scaled;
+                if (request->shouldAbortRender())
+                    return QImage();
+            }
+        }
 
         QImage image(width, height, QImage::Format_RGB32);
         uint32_t *data = reinterpret_cast<uint32_t *>(image.bits());
 
         // read data
         if (TIFFReadRGBAImageOriented(d->tiff, width, height, data, orientation) != 0) {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32_t size = width * height;
-            for (uint32_t i = 0; i < size; ++i) {
-                uint32_t red = (data[i] & 0x00FF0000) >> 16;
-                uint32_t blue = (data[i] & 0x000000FF) << 16;
-                data[i] = (data[i] & 0xFF00FF00) + red + blue;
+            if (request->shouldAbortRender())
+                return QImage();
+
+            swapRedBlue(&image);
+
+            if (request->isTile()) {
+                // the tiles could not be read, take the tile from the whole page
+                const QRect srcRect = request->normalizedRect().geometry(width, height);
+                const QRect destRect = request->normalizedRect().geometry(reqwidth, reqheight);
+                img = image.copy(srcRect).scaled(destRect.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+            } else {
+                img = image.scaled(reqwidth, reqheight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
             }
 
-            int reqwidth = request->width();
-            int reqheight = request->height();
-            if (rotation % 2 == 1)
-                qSwap(reqwidth, reqheight);
-            img = image.scaled(reqwidth, reqheight, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
-
             generated = true;
         }
     }
 
     if (!generated) {
-        img = QImage(request->width(), request->height(), QImage::Format_RGB32);
+        const QSize size = request->isTile() ? request->normalizedRect().geometry(request->width(), request->height()).size() : QSize(request->width(), request->height());
+        img = QImage(size, QImage::Format_RGB32);
         img.fill(qRgb(255, 255, 255));
     }
 
@@ -316,92 +643,127 @@ void TIFFGenerator::loadPages(QVector<Okular::Page *> &pagesVector)
     if (!d->tiff)
         return;
 
-    tdir_t dirs = TIFFNumberOfDirectories(d->tiff);
-    pagesVector.resize(dirs);
-    tdir_t realdirs = 0;
-
-    uint32_t width = 0;
-    uint32_t height = 0;
+    if (!d->readDirectoryCache()) {
+        // one walk down the chain of directories, TIFFSetDirectory() would
+        // start again from the first one for each of them
+        d->directories.clear();
+        do {
+            Private::Directory dir;
+            if (TIFFGetField(d->tiff, TIFFTAG_IMAGEWIDTH, &dir.width) != 1 || TIFFGetField(d->tiff, TIFFTAG_IMAGELENGTH, &dir.height) != 1)
+                continue;
+
+            uint16_t orientation = ORIENTATION_TOPLEFT;
+            TIFFGetField(d->tiff, TIFFTAG_ORIENTATION, &orientation);
+            uint16_t resolutionUnit = RESUNIT_NONE;
+            TIFFGetFieldDefaulted(d->tiff, TIFFTAG_RESOLUTIONUNIT, &resolutionUnit);
+            dir.offset = TIFFCurrentDirOffset(d->tiff);
+            dir.orientation = orientation;
+            dir.resolutionUnit = resolutionUnit;
+            if (!TIFFGetField(d->tiff, TIFFTAG_XRESOLUTION, &dir.xResolution))
+                dir.xResolution = 0;
+            if (!TIFFGetField(d->tiff, TIFFTAG_YRESOLUTION, &dir.yResolution))
+                dir.yResolution = 0;
+            d->directories.append(dir);
+        } while (TIFFReadDirectory(d->tiff));
+
+        // only worth it for the files with a few pages to walk
+        if (d->directories.count() > 1)
+            d->writeDirectoryCache();
+    }
 
+    pagesVector.resize(d->directories.count());
     const QSizeF dpi = Okular::Utils::realDpi(nullptr);
-    for (tdir_t i = 0; i < dirs; ++i) {
-        if (!TIFFSetDirectory(d->tiff, i))
-            continue;
-
-        if (TIFFGetField(d->tiff, TIFFTAG_IMAGEWIDTH, &width) != 1 || TIFFGetField(d->tiff, TIFFTAG_IMAGELENGTH, &height) != 1)
-            continue;
-
-        adaptSizeToResolution(d->tiff, TIFFTAG_XRESOLUTION, dpi.width(), &width);
-        adaptSizeToResolution(d->tiff, TIFFTAG_YRESOLUTION, dpi.height(), &height);
+    for (int i = 0; i < d->directories.count(); ++i) {
+        const Private::Directory &dir = d->directories.at(i);
+        uint32_t width = dir.width;
+        uint32_t height = dir.height;
+        adaptSizeToResolution(dir.xResolution, dir.resolutionUnit, dpi.width(), &width);
+        adaptSizeToResolution(dir.yResolution, dir.resolutionUnit, dpi.height(), &height);
+
+        pagesVector[i] = new Okular::Page(i, width, height, tiffRotation(dir.orientation));
+    }
 
-        Okular::Page *page = new Okular::Page(realdirs, width, height, readTiffRotation(d->tiff));
-        pagesVector[realdirs] = page;
+    // the walk left the last directory current
+    d->currentPage = -1;
+}
 
-        m_pageMapping[realdirs] = i;
+/**
+ * Prints the current directory, a TOPLEFT oriented image of @p width x
+ * @p height pixels, into @p target of @p p a band of strips (or tiles) at a
+ * time, each scaled to the pixels it takes on the printer, so the page is
+ * never in memory at either resolution. Returns false if it cannot be read
+ * that way.
+ */
+static bool printTiffBands(TIFF *tiff, uint32_t width, uint32_t height, const QRect &target, QPainter *p)
+{
+    uint32_t blockWidth;
+    uint32_t blockHeight;
+    if (!tiffBlockSize(tiff, width, height, &blockWidth, &blockHeight))
+        return false;
 
-        ++realdirs;
+    // whole blocks, or they would be decoded once for each band they are in
+    const uint32_t bandHeight = qMax<uint32_t>(1, printBandBytes / 4 / width / blockHeight) * blockHeight;
+    for (uint32_t y = 0; y < height; y += bandHeight) {
+        const uint32_t rows = qMin(bandHeight, height - y);
+        QImage band;
+        if (!readTiffRegion(tiff, width, height, ORIENTATION_TOPLEFT, QRect(0, y, width, rows), &band, nullptr))
+            return false;
+
+        // from the rows of the page, so that the bands meet
+        const int top = target.top() + quint64(y) * target.height() / height;
+        const int bottom = target.top() + quint64(y + rows) * target.height() / height;
+        if (bottom == top)
+            continue;
+        if (band.size() != QSize(target.width(), bottom - top))
+            band = band.scaled(target.width(), bottom - top, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        p->drawImage(target.left(), top, band);
     }
-
-    pagesVector.resize(realdirs);
+    return true;
 }
 
 bool TIFFGenerator::print(QPrinter &printer)
 {
-    uint32_t width = 0;
-    uint32_t height = 0;
-
     QPainter p(&printer);
 
     QList<int> pageList = Okular::FilePrinter::pageList(printer, document()->pages(), document()->currentPage() + 1, document()->bookmarkedPageList());
 
     for (int i = 0; i < pageList.count(); ++i) {
-        if (!TIFFSetDirectory(d->tiff, mapPage(pageList[i] - 1)))
+        const Private::Directory *dir = d->selectPage(pageList[i] - 1);
+        if (!dir)
             continue;
 
-        if (TIFFGetField(d->tiff, TIFFTAG_IMAGEWIDTH, &width) != 1 || TIFFGetField(d->tiff, TIFFTAG_IMAGELENGTH, &height) != 1)
+        const uint32_t width = dir->width;
+        const uint32_t height = dir->height;
+
+        if (i != 0)
+            printer.newPage();
+
+        const QSize targetSize = printer.pageRect().size();
+        // draw small images at 100% (don't scale up), fit the others to the page
+        QRect target(0, 0, width, height);
+        if ((uint32_t)targetSize.width() <= width || (uint32_t)targetSize.height() <= height)
+            target.setSize(targetSize);
+
+        if (dir->orientation == ORIENTATION_TOPLEFT && printTiffBands(d->tiff, width, height, target, &p))
             continue;
 
+        // unusual orientations, decode the whole page
         QImage image(width, height, QImage::Format_RGB32);
         uint32_t *data = reinterpret_cast<uint32_t *>(image.bits());
 
         // read data
-        if (TIFFReadRGBAImageOriented(d->tiff, width, height, data, ORIENTATION_TOPLEFT) != 0) {
-            // an image read by ReadRGBAImage is ABGR, we need ARGB, so swap red and blue
-            uint32_t size = width * height;
-            for (uint32_t j = 0; j < size; ++j) {
-                uint32_t red = (data[j] & 0x00FF0000) >> 16;
-                uint32_t blue = (data[j] & 0x000000FF) << 16;
-                data[j] = (data[j] & 0xFF00FF00) + red + blue;
-            }
-        }
-
-        if (i != 0)
-            printer.newPage();
+        if (TIFFReadRGBAImageOriented(d->tiff, width, height, data, ORIENTATION_TOPLEFT) != 0)
+            swapRedBlue(&image);
 
-        QSize targetSize = printer.pageRect().size();
-
-        if ((image.width() < targetSize.width()) && (image.height() < targetSize.height())) {
-            // draw small images at 100% (don't scale up)
+        if (target.size() == image.size())
             p.drawImage(0, 0, image);
-        } else {
-            // fit to page
-            p.drawImage(0, 0, image.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
-        }
+        else
+            p.drawImage(0, 0, image.scaled(target.size(), Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
     }
 
     return true;
 }
 
-int TIFFGenerator::mapPage(int page) const
-{
-    QHash<int, int>::const_iterator it = m_pageMapping.find(page);
-    if (it == m_pageMapping.end()) {
-        qCWarning(OkularTiffDebug) << "Requesting unmapped page" << page << ":" << m_pageMapping;
-        return -1;
-    }
-    return it.value();
-}
-
 Q_LOGGING_CATEGORY(OkularTiffDebug, "org.kde.okular.generators.tiff", QtWarningMsg)
 
 #include "generator_tiff.moc"
@@ -9,7 +9,6 @@
 
 #include <core/generator.h>
 
-#include <QHash>
 #include <QLoggingCategory>
 
 class TIFFGenerator : public Okular::Generator
@@ -37,9 +36,6 @@ private:
 
     bool loadTiff(QVector<Okular::Page *> &pagesVector, const char *name);
     void loadPages(QVector<Okular::Page *> &pagesVector);
-    int mapPage(int page) const;
-
-    QHash<int, int> m_pageMapping;
 };
 
 Q_DECLARE_LOGGING_CATEGORY(OkularTiffDebug)
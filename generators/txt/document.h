@@ -19,6 +19,9 @@ public:
     explicit Document(const QString &fileName);
     ~Document() override;
 
+    // the encoding of the text @p array starts with, empty if it isn't known
+    static QByteArray detectEncoding(const QByteArray &array);
+
 private:
     QString toUnicode(const QByteArray &array);
 };
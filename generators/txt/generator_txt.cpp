@@ -6,16 +6,40 @@
 
 #include "generator_txt.h"
 #include "converter.h"
+#include "largedocument.h"
 
 #include <KAboutData>
 #include <KConfigDialog>
 #include <KLocalizedString>
 
+#include <QFileInfo>
+#include <QImage>
+#include <QPainter>
+
+#include <core/page.h>
+#include <core/textpage.h>
+
+#include <climits>
+
 OKULAR_EXPORT_PLUGIN(TxtGenerator, "libokularGenerator_txt.json")
 
+// files from this size on are not loaded in a QTextDocument, it would
+// need several times their size and minutes to lay them out
+static const qint64 largeFileSize = 32 * 1024 * 1024;
+// the pages indexed when opening the file, enough for the first screen
+static const int initialPages = 10;
+// how long a slice of loadMorePages() indexes for
+static const int indexSliceTime = 30; // in msec
+
 TxtGenerator::TxtGenerator(QObject *parent, const QVariantList &args)
     : Okular::TextDocumentGenerator(new Txt::Converter, QStringLiteral("okular_txt_generator_settings"), parent, args)
+    , m_largeDocument(nullptr)
+{
+}
+
+TxtGenerator::~TxtGenerator()
 {
+    delete m_largeDocument;
 }
 
 void TxtGenerator::addPages(KConfigDialog *dlg)
@@ -25,4 +49,85 @@ void TxtGenerator::addPages(KConfigDialog *dlg)
     dlg->addPage(widget, generalSettings(), i18n("Txt"), QStringLiteral("text-plain"), i18n("Txt Backend Configuration"));
 }
 
+Okular::Document::OpenResult TxtGenerator::loadDocumentWithPassword(const QString &fileName, QVector<Okular::Page *> &pagesVector, const QString &password)
+{
+    if (QFileInfo(fileName).size() >= largeFileSize) {
+        Txt::LargeDocument *document = new Txt::LargeDocument(fileName, generalSettings()->font());
+        if (document->isValid()) {
+            m_largeDocument = document;
+            m_largeDocument->index(initialPages, INT_MAX);
+            appendPages(pagesVector);
+            return Okular::Document::OpenSuccess;
+        }
+        // then the usual way, as good as it goes
+        delete document;
+    }
+
+    return Okular::TextDocumentGenerator::loadDocumentWithPassword(fileName, pagesVector, password);
+}
+
+bool TxtGenerator::loadMorePages(QVector<Okular::Page *> &pagesVector)
+{
+    if (!m_largeDocument)
+        return Okular::TextDocumentGenerator::loadMorePages(pagesVector);
+
+    const bool more = m_largeDocument->index(INT_MAX, indexSliceTime);
+    appendPages(pagesVector);
+    return more;
+}
+
+bool TxtGenerator::reloadDocument(const QString &fileName, QVector<Okular::Page *> &pagesVector, QVector<int> &changedPages)
+{
+    // the whole file again, and a file that grew too large is paginated by lines
+    if (m_largeDocument || QFileInfo(fileName).size() >= largeFileSize)
+        return false;
+
+    return Okular::TextDocumentGenerator::reloadDocument(fileName, pagesVector, changedPages);
+}
+
+void TxtGenerator::appendPages(QVector<Okular::Page *> &pagesVector) const
+{
+    const QSizeF size = m_largeDocument->pageSize();
+    for (int i = pagesVector.count(); i < m_largeDocument->pageCount(); ++i)
+        pagesVector.append(new Okular::Page(i, size.width(), size.height(), Okular::Rotation0));
+}
+
+QImage TxtGenerator::image(Okular::PixmapRequest *request)
+{
+    if (!m_largeDocument)
+        return Okular::TextDocumentGenerator::image(request);
+
+    if (request->shouldAbortRender())
+        return QImage();
+
+    // only the lines of the page are read, any number of pages at the same time
+    QImage image = request->renderTarget();
+    image.fill(Qt::white);
+
+    const QSizeF size = m_largeDocument->pageSize();
+    QPainter p;
+    p.begin(&image);
+    p.scale(request->width() / size.width(), request->height() / size.height());
+    m_largeDocument->paintPage(&p, request->pageNumber());
+    p.end();
+
+    return image;
+}
+
+Okular::TextPage *TxtGenerator::textPage(Okular::TextRequest *request)
+{
+    if (!m_largeDocument)
+        return Okular::TextDocumentGenerator::textPage(request);
+
+    return m_largeDocument->textPage(request->page()->number());
+}
+
+bool TxtGenerator::doCloseDocument()
+{
+    delete m_largeDocument;
+    m_largeDocument = nullptr;
+
+    return Okular::TextDocumentGenerator::doCloseDocument();
+}
+
 #include "generator_txt.moc"
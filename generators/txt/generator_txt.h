@@ -9,6 +9,11 @@
 
 #include <core/textdocumentgenerator.h>
 
+namespace Txt
+{
+class LargeDocument;
+}
+
 class TxtGenerator : public Okular::TextDocumentGenerator
 {
     Q_OBJECT
@@ -16,11 +21,24 @@ class TxtGenerator : public Okular::TextDocumentGenerator
 
 public:
     TxtGenerator(QObject *parent, const QVariantList &args);
-    ~TxtGenerator() override
-    {
-    }
+    ~TxtGenerator() override;
 
     void addPages(KConfigDialog *dlg) override;
+
+    // files too large for a QTextDocument are paginated by lines
+    Okular::Document::OpenResult loadDocumentWithPassword(const QString &fileName, QVector<Okular::Page *> &pagesVector, const QString &password) override;
+    bool loadMorePages(QVector<Okular::Page *> &pagesVector) override;
+    bool reloadDocument(const QString &fileName, QVector<Okular::Page *> &pagesVector, QVector<int> &changedPages) override;
+    QImage image(Okular::PixmapRequest *request) override;
+
+protected:
+    bool doCloseDocument() override;
+    Okular::TextPage *textPage(Okular::TextRequest *request) override;
+
+private:
+    void appendPages(QVector<Okular::Page *> &pagesVector) const;
+
+    Txt::LargeDocument *m_largeDocument;
 };
 
 #endif
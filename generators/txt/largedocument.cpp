@@ -0,0 +1,270 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "largedocument.h"
+
+#include <QElapsedTimer>
+#include <QFontDatabase>
+#include <QFontInfo>
+#include <QFontMetricsF>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QTextCodec>
+
+#include <core/area.h>
+#include <core/textpage.h>
+
+#include <cstring>
+
+#include "debug_txt.h"
+#include "document.h"
+
+using namespace Txt;
+
+// the same page as the one of the QTextDocument of smaller files
+static const double pageWidth = 600;
+static const double pageHeight = 800;
+static const double pageMargin = 20;
+// how much of the start of the file the encoding is guessed from
+static const int encodingProbeSize = 1024 * 1024;
+static const int tabWidth = 8;
+// longer lines are split in segments, so that a page of them doesn't decode
+// the whole line
+static const qint64 maxSegmentSize = 64 * 1024;
+// how far back the end of a segment looks for a character boundary
+static const qint64 segmentBoundaryLookBehind = 4096;
+
+static QString expandTabs(const QString &text)
+{
+    if (!text.contains(QLatin1Char('\t')))
+        return text;
+
+    QString result;
+    result.reserve(text.length() + tabWidth);
+    for (const QChar c : text) {
+        if (c == QLatin1Char('\t'))
+            result += QString(tabWidth - result.length() % tabWidth, QLatin1Char(' '));
+        else
+            result += c;
+    }
+    return result;
+}
+
+LargeDocument::LargeDocument(const QString &fileName, const QFont &font)
+    : m_file(fileName)
+    , m_data(nullptr)
+    , m_size(0)
+    , m_codec(nullptr)
+    , m_indexOffset(0)
+    , m_lastPageRows(0)
+{
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qCDebug(OkularTxtDebug) << "Can't open file" << m_file.fileName();
+        return;
+    }
+
+    m_size = m_file.size();
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        qCDebug(OkularTxtDebug) << "Can't map file" << m_file.fileName();
+        return;
+    }
+
+    const QByteArray encoding = Document::detectEncoding(QByteArray::fromRawData(reinterpret_cast<const char *>(m_data), int(qMin<qint64>(m_size, encodingProbeSize))));
+    m_codec = QTextCodec::codecForName(encoding.isEmpty() ? QByteArray("UTF-8") : encoding);
+    // lines are found by their '\n' byte, which UTF-16 and the like don't have
+    if (m_codec && m_codec->fromUnicode(QStringLiteral("\n")) != "\n") {
+        qCDebug(OkularTxtDebug) << "Can't index lines in the" << m_codec->name() << "encoding";
+        m_codec = nullptr;
+    }
+
+    // rows wrap at a number of characters, that needs them all to be as wide;
+    // in pixels, so it measures the same on all the devices pages are painted on
+    m_font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    const QFontInfo fontInfo(font);
+    m_font.setPixelSize(fontInfo.pixelSize() > 0 ? fontInfo.pixelSize() : 13);
+    const QFontMetricsF metrics(m_font);
+    m_charWidth = metrics.horizontalAdvance(QLatin1Char('M'));
+    m_lineSpacing = metrics.lineSpacing();
+    m_ascent = metrics.ascent();
+    m_columns = qMax(1, int((pageWidth - 2 * pageMargin) / m_charWidth));
+    m_rows = qMax(1, int((pageHeight - 2 * pageMargin) / m_lineSpacing));
+
+    m_pageStarts.append({0, 0});
+}
+
+LargeDocument::~LargeDocument()
+{
+    if (m_data)
+        m_file.unmap(const_cast<uchar *>(m_data));
+}
+
+bool LargeDocument::isValid() const
+{
+    return m_data && m_codec;
+}
+
+QSizeF LargeDocument::pageSize() const
+{
+    return QSizeF(pageWidth, pageHeight);
+}
+
+qint64 LargeDocument::segmentEnd(qint64 offset, qint64 *next) const
+{
+    const qint64 length = qMin(m_size - offset, maxSegmentSize + 1);
+    const void *newLine = memchr(m_data + offset, '\n', length);
+    if (newLine) {
+        const qint64 end = static_cast<const uchar *>(newLine) - m_data;
+        *next = end + 1;
+        return end;
+    }
+    if (offset + length == m_size) {
+        *next = m_size;
+        return m_size;
+    }
+
+    // a segment of ASCII without tabs is rows of whole characters, the others
+    // may wrap a short row where they are split
+    qint64 end = offset + qMax<qint64>(1, maxSegmentSize / m_columns) * m_columns;
+    for (qint64 i = offset; i < end; ++i) {
+        if (m_data[i] >= 0x80 || m_data[i] == '\t' || m_data[i] == '\r') {
+            // bytes below 0x40 are never part of a multibyte character in the
+            // encodings lines can be indexed in
+            for (qint64 j = end; j > end - segmentBoundaryLookBehind; --j) {
+                if (m_data[j - 1] < 0x40 && m_data[j - 1] != '\r') {
+                    end = j;
+                    break;
+                }
+            }
+            break;
+        }
+    }
+    *next = end;
+    return end;
+}
+
+QString LargeDocument::line(qint64 offset, qint64 end) const
+{
+    if (end > offset && m_data[end - 1] == '\r')
+        --end;
+    return expandTabs(m_codec->toUnicode(reinterpret_cast<const char *>(m_data + offset), int(end - offset)));
+}
+
+int LargeDocument::rowCount(qint64 offset, qint64 end) const
+{
+    // most lines of huge files are ASCII, no need to decode them to count
+    qint64 columns = end - offset;
+    for (qint64 i = offset; i < end; ++i) {
+        if (m_data[i] >= 0x80 || m_data[i] == '\t' || m_data[i] == '\r') {
+            columns = line(offset, end).length();
+            break;
+        }
+    }
+    return qMax<qint64>(1, (columns + m_columns - 1) / m_columns);
+}
+
+bool LargeDocument::index(int pages, int msecs)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QVector<PageStart> newStarts;
+    int completePages = 0;
+    for (int lines = 1; m_indexOffset < m_size; ++lines) {
+        qint64 next = 0;
+        const qint64 end = segmentEnd(m_indexOffset, &next);
+        const int rows = rowCount(m_indexOffset, end);
+        for (int row = 0; row < rows;) {
+            if (m_lastPageRows == m_rows) {
+                newStarts.append({m_indexOffset, row});
+                m_lastPageRows = 0;
+                ++completePages;
+            }
+            const int taken = qMin(rows - row, m_rows - m_lastPageRows);
+            m_lastPageRows += taken;
+            row += taken;
+        }
+        m_indexOffset = next;
+
+        // checking the time only from time to time, lines are short
+        if (completePages >= pages || (lines % 1024 == 0 && timer.elapsed() >= msecs))
+            break;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_pageStarts += newStarts;
+    return m_indexOffset < m_size;
+}
+
+int LargeDocument::pageCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    // the last page may still get rows
+    return m_indexOffset < m_size ? m_pageStarts.count() - 1 : m_pageStarts.count();
+}
+
+QStringList LargeDocument::pageRows(int page, QVector<bool> *lineEnds) const
+{
+    PageStart start;
+    {
+        QMutexLocker locker(&m_mutex);
+        if (page < 0 || page >= m_pageStarts.count())
+            return QStringList();
+        start = m_pageStarts.at(page);
+    }
+
+    // all the pages but the last one are full
+    QStringList rows;
+    qint64 offset = start.offset;
+    int skip = start.row;
+    while (offset < m_size && rows.count() < m_rows) {
+        qint64 next = 0;
+        const qint64 end = segmentEnd(offset, &next);
+        // the line goes on in the next segment
+        const bool split = next == end && end < m_size;
+        const QString text = line(offset, end);
+        for (int column = skip * m_columns; rows.count() < m_rows && (column < text.length() || column == 0); column += m_columns) {
+            rows.append(text.mid(column, m_columns));
+            lineEnds->append(!split && column + m_columns >= text.length());
+        }
+        skip = 0;
+        offset = next;
+    }
+    return rows;
+}
+
+void LargeDocument::paintPage(QPainter *painter, int page) const
+{
+    QVector<bool> lineEnds;
+    const QStringList rows = pageRows(page, &lineEnds);
+
+    painter->setFont(m_font);
+    painter->setPen(Qt::black);
+    for (int i = 0; i < rows.count(); ++i)
+        painter->drawText(QPointF(pageMargin, pageMargin + i * m_lineSpacing + m_ascent), rows.at(i));
+}
+
+Okular::TextPage *LargeDocument::textPage(int page) const
+{
+    QVector<bool> lineEnds;
+    const QStringList rows = pageRows(page, &lineEnds);
+
+    Okular::TextPage *textPage = new Okular::TextPage;
+    for (int i = 0; i < rows.count(); ++i) {
+        const QString &row = rows.at(i);
+        const double top = (pageMargin + i * m_lineSpacing) / pageHeight;
+        const double bottom = (pageMargin + (i + 1) * m_lineSpacing) / pageHeight;
+        for (int column = 0; column < row.length(); ++column) {
+            const double left = (pageMargin + column * m_charWidth) / pageWidth;
+            textPage->append(row.at(column), new Okular::NormalizedRect(left, top, left + m_charWidth / pageWidth, bottom));
+        }
+        if (lineEnds.at(i)) {
+            const double left = (pageMargin + row.length() * m_charWidth) / pageWidth;
+            textPage->append(QStringLiteral("\n"), new Okular::NormalizedRect(left, top, left + 3 / pageWidth, bottom));
+        }
+    }
+    return textPage;
+}
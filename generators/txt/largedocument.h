@@ -0,0 +1,102 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef _TXT_LARGEDOCUMENT_H_
+#define _TXT_LARGEDOCUMENT_H_
+
+#include <QFile>
+#include <QFont>
+#include <QMutex>
+#include <QSizeF>
+#include <QStringList>
+#include <QVector>
+
+class QPainter;
+class QTextCodec;
+
+namespace Okular
+{
+class TextPage;
+}
+
+namespace Txt
+{
+/**
+ * A plain text file too large for a QTextDocument.
+ *
+ * The file stays mapped in memory, only an index of where each page starts
+ * is kept: pages are a fixed number of rows of a fixed width font, lines
+ * longer than a row are wrapped. Very long lines are indexed in segments of
+ * a bounded size, as if they were several lines. The index is built in slices with index(),
+ * the pages it has are final. Painting and extracting a page only decodes
+ * the lines of that page, and can happen in any thread.
+ */
+class LargeDocument
+{
+public:
+    LargeDocument(const QString &fileName, const QFont &font);
+    ~LargeDocument();
+
+    /**
+     * Whether the file could be mapped and is in an encoding whose lines
+     * end with a '\n' byte.
+     */
+    bool isValid() const;
+
+    QSizeF pageSize() const;
+
+    /**
+     * Indexes the file until @p pages pages are complete or @p msecs went
+     * by, returns whether there is more to index.
+     */
+    bool index(int pages, int msecs);
+
+    /**
+     * The pages indexed so far.
+     */
+    int pageCount() const;
+
+    void paintPage(QPainter *painter, int page) const;
+    Okular::TextPage *textPage(int page) const;
+
+private:
+    Q_DISABLE_COPY(LargeDocument)
+
+    // where a page starts: the offset of its first segment, and how many rows
+    // of that line are on the pages before
+    struct PageStart {
+        qint64 offset;
+        int row;
+    };
+
+    // the end of the line or segment at @p offset, and where the next one starts
+    qint64 segmentEnd(qint64 offset, qint64 *next) const;
+    QString line(qint64 offset, qint64 end) const;
+    int rowCount(qint64 offset, qint64 end) const;
+    QStringList pageRows(int page, QVector<bool> *lineEnds) const;
+
+    QFile m_file;
+    const uchar *m_data;
+    qint64 m_size;
+    QTextCodec *m_codec;
+
+    QFont m_font;
+    double m_charWidth;
+    double m_lineSpacing;
+    double m_ascent;
+    int m_columns;
+    int m_rows;
+
+    mutable QMutex m_mutex;
+    QVector<PageStart> m_pageStarts;
+    // the next line to index, and the rows the last page has
+    qint64 m_indexOffset;
+    int m_lastPageRows;
+};
+
+}
+
+#endif
@@ -18,6 +18,9 @@
 #include <QPrinter>
 #include <QUrl>
 
+#include <algorithm>
+#include <memory>
+
 #include <core/area.h>
 #include <core/document.h>
 #include <core/fileprinter.h>
@@ -678,10 +681,172 @@ static QString unicodeString(const QString &raw)
     return ret;
 }
 
+// the display lists of the pages seen last are kept up to this many KiB
+static const int displayListsBudget = 64 * 1024;
+// and the images they were drawn with, for the logos and backgrounds most pages repeat
+static const int imagesBudget = 32 * 1024;
+// replaying checks whether to abort every this many commands
+static const int replayAbortCheckInterval = 64;
+
+XpsDisplayList::XpsDisplayList()
+    : m_opacity(1.0)
+    , m_memory(0)
+{
+}
+
+void XpsDisplayList::save()
+{
+    m_savedOpacities.push(m_opacity);
+    m_commands.append({Save, 0});
+}
+
+void XpsDisplayList::restore()
+{
+    if (!m_savedOpacities.isEmpty())
+        m_opacity = m_savedOpacities.pop();
+    m_commands.append({Restore, 0});
+}
+
+qreal XpsDisplayList::opacity() const
+{
+    return m_opacity;
+}
+
+void XpsDisplayList::setOpacity(qreal opacity)
+{
+    m_opacity = opacity;
+    m_commands.append({SetOpacity, m_opacities.count()});
+    m_opacities.append(opacity);
+}
+
+void XpsDisplayList::transform(const QTransform &matrix)
+{
+    m_commands.append({Transform, m_transforms.count()});
+    m_transforms.append(matrix);
+}
+
+void XpsDisplayList::setClipPath(const QPainterPath &path)
+{
+    m_commands.append({SetClipPath, m_paths.count()});
+    m_paths.append(path);
+    m_memory += path.elementCount() * sizeof(QPainterPath::Element);
+}
+
+void XpsDisplayList::setLayoutDirection(Qt::LayoutDirection direction)
+{
+    m_commands.append({SetLayoutDirection, int(direction)});
+}
+
+void XpsDisplayList::setFont(const QFont &font)
+{
+    // glyphs of the same run of text mostly share it
+    if (m_fonts.isEmpty() || !(m_fonts.constLast() == font))
+        m_fonts.append(font);
+    m_commands.append({SetFont, m_fonts.count() - 1});
+}
+
+void XpsDisplayList::setBrush(const QBrush &brush)
+{
+    // the images of the brushes are shared with the cache of XpsFile, which counts them
+    if (m_brushes.isEmpty() || !(m_brushes.constLast() == brush))
+        m_brushes.append(brush);
+    m_commands.append({SetBrush, m_brushes.count() - 1});
+}
+
+void XpsDisplayList::setPen(const QPen &pen)
+{
+    if (m_pens.isEmpty() || !(m_pens.constLast() == pen))
+        m_pens.append(pen);
+    m_commands.append({SetPen, m_pens.count() - 1});
+}
+
+void XpsDisplayList::drawPath(const QPainterPath &path)
+{
+    m_commands.append({DrawPath, m_paths.count()});
+    m_paths.append(path);
+    m_memory += path.elementCount() * sizeof(QPainterPath::Element);
+}
+
+void XpsDisplayList::drawGlyphRun(const QString &text, const QVector<QPointF> &positions)
+{
+    m_commands.append({DrawGlyphRun, m_glyphRuns.count()});
+    m_glyphRuns.append({text, positions});
+    m_memory += text.size() * sizeof(QChar) + positions.size() * sizeof(QPointF);
+}
+
+bool XpsDisplayList::replay(QPainter *painter, const std::function<bool()> &shouldAbort) const
+{
+    int savedStates = 0;
+    for (int i = 0; i < m_commands.count(); ++i) {
+        if (shouldAbort && i % replayAbortCheckInterval == 0 && shouldAbort()) {
+            while (savedStates-- > 0)
+                painter->restore();
+            return false;
+        }
+
+        const Command &command = m_commands.at(i);
+        switch (command.type) {
+        case Save:
+            painter->save();
+            ++savedStates;
+            break;
+        case Restore:
+            // a broken page may restore more than it saved
+            if (savedStates > 0) {
+                painter->restore();
+                --savedStates;
+            }
+            break;
+        case SetOpacity:
+            painter->setOpacity(m_opacities.at(command.index));
+            break;
+        case Transform:
+            painter->setWorldTransform(m_transforms.at(command.index), true);
+            break;
+        case SetClipPath:
+            painter->setClipPath(m_paths.at(command.index));
+            break;
+        case SetLayoutDirection:
+            painter->setLayoutDirection(Qt::LayoutDirection(command.index));
+            break;
+        case SetFont:
+            painter->setFont(m_fonts.at(command.index));
+            break;
+        case SetBrush:
+            painter->setBrush(m_brushes.at(command.index));
+            break;
+        case SetPen:
+            painter->setPen(m_pens.at(command.index));
+            break;
+        case DrawPath:
+            painter->drawPath(m_paths.at(command.index));
+            break;
+        case DrawGlyphRun: {
+            const GlyphRun &run = m_glyphRuns.at(command.index);
+            for (int c = 0; c < run.text.size(); ++c)
+                painter->drawText(run.positions.at(c), QString(run.text.at(c)));
+            break;
+        }
+        }
+    }
+
+    while (savedStates-- > 0)
+        painter->restore();
+    return true;
+}
+
+qulonglong XpsDisplayList::memory() const
+{
+    return m_memory + m_commands.size() * sizeof(Command) + m_transforms.size() * sizeof(QTransform) + m_fonts.size() * sizeof(QFont) + m_pens.size() * sizeof(QPen);
+}
+
 XpsHandler::XpsHandler(XpsPage *page)
     : m_page(page)
+    , m_list(nullptr)
+    , m_metricsDevice(1, 1, QImage::Format_ARGB32_Premultiplied)
 {
-    m_painter = nullptr;
+    m_metricsDevice.setDotsPerMeterX(2835);
+    m_metricsDevice.setDotsPerMeterY(2835);
 }
 
 XpsHandler::~XpsHandler()
@@ -704,6 +869,9 @@ bool XpsHandler::startElement(const QString &nameSpace, const QString &localName
     Q_UNUSED(nameSpace)
     Q_UNUSED(qname)
 
+    if (m_shouldAbort && m_shouldAbort())
+        return false;
+
     XpsRenderNode node;
     node.name = localName;
     node.attributes = atts;
@@ -738,7 +906,7 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
 
     QString att;
 
-    m_painter->save();
+    m_list->save();
 
     // Get font (doesn't work well because qt doesn't allow to load font from file)
     // This works despite the fact that font size isn't specified in points as required by qt. It's because I set point size to be equal to drawing unit.
@@ -746,7 +914,7 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
     // qCWarning(OkularXpsDebug) << "Font Rendering EmSize:" << fontSize;
     // a value of 0.0 means the text is not visible (see XPS specs, chapter 12, "Glyphs")
     if (fontSize < 0.1) {
-        m_painter->restore();
+        m_list->restore();
         return;
     }
     const QString absoluteFileName = absolutePath(entryPath(m_page->fileName()), node.attributes.value(QStringLiteral("FontUri")));
@@ -762,7 +930,7 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
             font.setBold(true);
         }
     }
-    m_painter->setFont(font);
+    m_list->setFont(font);
 
     // Origin
     QPointF origin(node.attributes.value(QStringLiteral("OriginX")).toDouble(), node.attributes.value(QStringLiteral("OriginY")).toDouble());
@@ -777,18 +945,18 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
         } else {
             // no "Fill" attribute and no "Glyphs.Fill" child, so show nothing
             // (see XPS specs, 5.10)
-            m_painter->restore();
+            m_list->restore();
             return;
         }
     } else {
         brush = parseRscRefColorForBrush(att);
         if (brush.style() > Qt::NoBrush && brush.style() < Qt::LinearGradientPattern && brush.color().alpha() == 0) {
-            m_painter->restore();
+            m_list->restore();
             return;
         }
     }
-    m_painter->setBrush(brush);
-    m_painter->setPen(QPen(brush, 0));
+    m_list->setBrush(brush);
+    m_list->setPen(QPen(brush, 0));
 
     // Opacity
     att = node.attributes.value(QStringLiteral("Opacity"));
@@ -796,9 +964,9 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
         bool ok = true;
         double value = att.toDouble(&ok);
         if (ok && value >= 0.1) {
-            m_painter->setOpacity(value);
+            m_list->setOpacity(value);
         } else {
-            m_painter->restore();
+            m_list->restore();
             return;
         }
     }
@@ -806,7 +974,7 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
     // RenderTransform
     att = node.attributes.value(QStringLiteral("RenderTransform"));
     if (!att.isEmpty()) {
-        m_painter->setWorldTransform(parseRscRefMatrix(att), true);
+        m_list->transform(parseRscRefMatrix(att));
     }
 
     // Clip
@@ -814,17 +982,17 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
     if (!att.isEmpty()) {
         QPainterPath clipPath = parseRscRefPath(att);
         if (!clipPath.isEmpty()) {
-            m_painter->setClipPath(clipPath);
+            m_list->setClipPath(clipPath);
         }
     }
 
     // BiDiLevel - default Left-to-Right
-    m_painter->setLayoutDirection(Qt::LeftToRight);
+    m_list->setLayoutDirection(Qt::LeftToRight);
     att = node.attributes.value(QStringLiteral("BiDiLevel"));
     if (!att.isEmpty()) {
         if ((att.toInt() % 2) == 1) {
             // odd BiDiLevel, so Right-to-Left
-            m_painter->setLayoutDirection(Qt::RightToLeft);
+            m_list->setLayoutDirection(Qt::RightToLeft);
         }
     }
 
@@ -859,10 +1027,12 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
     // UnicodeString
     QString stringToDraw(unicodeString(node.attributes.value(QStringLiteral("UnicodeString"))));
     QPointF originAdvance(0, 0);
-    QFontMetrics metrics = m_painter->fontMetrics();
+    QFontMetrics metrics(font, &m_metricsDevice);
+    QVector<QPointF> positions;
+    positions.reserve(stringToDraw.size());
     for (int i = 0; i < stringToDraw.size(); ++i) {
         QChar thisChar = stringToDraw.at(i);
-        m_painter->drawText(origin + originAdvance, QString(thisChar));
+        positions.append(origin + originAdvance);
         const qreal advanceWidth = advanceWidths.value(i, qreal(-1.0));
         if (advanceWidth > 0.0) {
             originAdvance.rx() += advanceWidth;
@@ -870,11 +1040,12 @@ void XpsHandler::processGlyph(XpsRenderNode &node)
             originAdvance.rx() += metrics.horizontalAdvance(thisChar);
         }
     }
+    m_list->drawGlyphRun(stringToDraw, positions);
     // qCWarning(OkularXpsDebug) << "Glyphs: " << atts.value("Fill") << ", " << atts.value("FontUri");
     // qCWarning(OkularXpsDebug) << "    Origin: " << atts.value("OriginX") << "," << atts.value("OriginY");
     // qCWarning(OkularXpsDebug) << "    Unicode: " << atts.value("UnicodeString");
 
-    m_painter->restore();
+    m_list->restore();
 }
 
 void XpsHandler::processFill(XpsRenderNode &node)
@@ -941,7 +1112,7 @@ void XpsHandler::processPath(XpsRenderNode &node)
     // TODO Ignored attributes: Clip, OpacityMask, StrokeEndLineCap, StorkeStartLineCap, Name, FixedPage.NavigateURI, xml:lang, x:key, AutomationProperties.Name, AutomationProperties.HelpText, SnapsToDevicePixels
     // TODO Ignored child elements: RenderTransform, Clip, OpacityMask
     // Handled separately: RenderTransform
-    m_painter->save();
+    m_list->save();
 
     QString att;
     QVariant data;
@@ -957,7 +1128,7 @@ void XpsHandler::processPath(XpsRenderNode &node)
     }
     if (!pathdata) {
         // nothing to draw
-        m_painter->restore();
+        m_list->restore();
         return;
     }
 
@@ -972,7 +1143,7 @@ void XpsHandler::processPath(XpsRenderNode &node)
             brush = data.value<QBrush>();
         }
     }
-    m_painter->setBrush(brush);
+    m_list->setBrush(brush);
 
     // Stroke (pen)
     att = node.attributes.value(QStringLiteral("Stroke"));
@@ -1051,31 +1222,31 @@ void XpsHandler::processPath(XpsRenderNode &node)
             pen.setMiterLimit(limit / 2);
         }
     }
-    m_painter->setPen(pen);
+    m_list->setPen(pen);
 
     // Opacity
     att = node.attributes.value(QStringLiteral("Opacity"));
     if (!att.isEmpty()) {
-        m_painter->setOpacity(att.toDouble());
+        m_list->setOpacity(att.toDouble());
     }
 
     // RenderTransform
     att = node.attributes.value(QStringLiteral("RenderTransform"));
     if (!att.isEmpty()) {
-        m_painter->setWorldTransform(parseRscRefMatrix(att), true);
+        m_list->transform(parseRscRefMatrix(att));
     }
     if (!pathdata->transform.isIdentity()) {
-        m_painter->setWorldTransform(pathdata->transform, true);
+        m_list->transform(pathdata->transform);
     }
 
     for (const XpsPathFigure *figure : qAsConst(pathdata->paths)) {
-        m_painter->setBrush(figure->isFilled ? brush : QBrush());
-        m_painter->drawPath(figure->path);
+        m_list->setBrush(figure->isFilled ? brush : QBrush());
+        m_list->drawPath(figure->path);
     }
 
     delete pathdata;
 
-    m_painter->restore();
+    m_list->restore();
 }
 
 void XpsHandler::processPathData(XpsRenderNode &node)
@@ -1216,20 +1387,20 @@ void XpsHandler::processPathFigure(XpsRenderNode &node)
 void XpsHandler::processStartElement(XpsRenderNode &node)
 {
     if (node.name == QLatin1String("Canvas")) {
-        m_painter->save();
+        m_list->save();
         QString att = node.attributes.value(QStringLiteral("RenderTransform"));
         if (!att.isEmpty()) {
-            m_painter->setWorldTransform(parseRscRefMatrix(att), true);
+            m_list->transform(parseRscRefMatrix(att));
         }
         att = node.attributes.value(QStringLiteral("Opacity"));
         if (!att.isEmpty()) {
             double value = att.toDouble();
             if (value > 0.0 && value <= 1.0) {
-                m_painter->setOpacity(m_painter->opacity() * value);
+                m_list->setOpacity(m_list->opacity() * value);
             } else {
                 // setting manually to 0 is necessary to "disable"
                 // all the stuff inside
-                m_painter->setOpacity(0.0);
+                m_list->setOpacity(0.0);
             }
         }
     }
@@ -1247,10 +1418,10 @@ void XpsHandler::processEndElement(XpsRenderNode &node)
     } else if ((node.name == QLatin1String("Canvas.RenderTransform")) || (node.name == QLatin1String("Glyphs.RenderTransform")) || (node.name == QLatin1String("Path.RenderTransform"))) {
         QVariant data = node.getRequiredChildData(QStringLiteral("MatrixTransform"));
         if (data.canConvert<QTransform>()) {
-            m_painter->setWorldTransform(data.value<QTransform>(), true);
+            m_list->transform(data.value<QTransform>());
         }
     } else if (node.name == QLatin1String("Canvas")) {
-        m_painter->restore();
+        m_list->restore();
     } else if ((node.name == QLatin1String("Path.Fill")) || (node.name == QLatin1String("Glyphs.Fill"))) {
         processFill(node);
     } else if (node.name == QLatin1String("Path.Stroke")) {
@@ -1327,66 +1498,89 @@ void XpsHandler::processEndElement(XpsRenderNode &node)
     }
 }
 
-XpsPage::XpsPage(XpsFile *file, const QString &fileName)
+XpsPage::XpsPage(XpsFile *file, const QString &fileName, const QSizeF &provisionalSize)
     : m_file(file)
     , m_fileName(fileName)
-    , m_pageIsRendered(false)
+    , m_pageSize(provisionalSize)
+    , m_hasProvisionalSize(true)
 {
-    m_pageImage = nullptr;
-
     // qCWarning(OkularXpsDebug) << "page file name: " << fileName;
+}
 
-    const KZipFileEntry *pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry(fileName));
-
+// the size of the FixedPage element at the start of the page part in
+// @p entry, only decompressing the part up to it
+static QSizeF readFixedPageSize(const KArchiveEntry *entry)
+{
     QXmlStreamReader xml;
-    xml.addData(readFileOrDirectoryParts(pageFile));
-    while (!xml.atEnd()) {
+    std::unique_ptr<QIODevice> device;
+    QStringList pieces;
+    if (entry->isDirectory()) {
+        // interleaved parts, the pieces come in the order of their names
+        const KArchiveDirectory *dir = static_cast<const KArchiveDirectory *>(entry);
+        pieces = dir->entries();
+        std::sort(pieces.begin(), pieces.end());
+    } else {
+        device.reset(static_cast<const KZipFileEntry *>(entry)->createDevice());
+        if (!device)
+            return QSizeF();
+        xml.setDevice(device.get());
+    }
+
+    while (true) {
         xml.readNext();
         if (xml.isStartElement() && (xml.name() == QStringLiteral("FixedPage"))) {
-            QXmlStreamAttributes attributes = xml.attributes();
-            m_pageSize.setWidth(attributes.value(QStringLiteral("Width")).toString().toDouble());
-            m_pageSize.setHeight(attributes.value(QStringLiteral("Height")).toString().toDouble());
-            break;
+            const QXmlStreamAttributes attributes = xml.attributes();
+            return QSizeF(attributes.value(QStringLiteral("Width")).toString().toDouble(), attributes.value(QStringLiteral("Height")).toString().toDouble());
         }
+        if (xml.error() == QXmlStreamReader::PrematureEndOfDocumentError && !pieces.isEmpty()) {
+            const KArchiveEntry *piece = static_cast<const KArchiveDirectory *>(entry)->entry(pieces.takeFirst());
+            if (piece->isFile())
+                xml.addData(static_cast<const KZipFileEntry *>(piece)->data());
+            continue;
+        }
+        if (xml.atEnd())
+            break;
     }
     if (xml.error()) {
         qCWarning(OkularXpsDebug) << "Could not parse XPS page:" << xml.errorString();
     }
+    return QSizeF();
 }
 
-XpsPage::~XpsPage()
+bool XpsPage::loadSize()
 {
-    delete m_pageImage;
+    if (!m_hasProvisionalSize)
+        return false;
+    m_hasProvisionalSize = false;
+
+    const KArchiveEntry *pageFile = m_file->xpsArchive()->directory()->entry(m_fileName);
+    const QSizeF size = pageFile ? readFixedPageSize(pageFile) : QSizeF();
+    if (size.isEmpty() || size == m_pageSize)
+        return false;
+    m_pageSize = size;
+    return true;
 }
 
-bool XpsPage::renderToImage(QImage *p)
+void XpsPage::setProvisionalSize(const QSizeF &size)
 {
-    if ((m_pageImage == nullptr) || (m_pageImage->size() != p->size())) {
-        delete m_pageImage;
-        m_pageImage = new QImage(p->size(), QImage::Format_ARGB32);
-        // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
-        m_pageImage->setDotsPerMeterX(2835);
-        m_pageImage->setDotsPerMeterY(2835);
-
-        m_pageIsRendered = false;
-    }
-    if (!m_pageIsRendered) {
-        m_pageImage->fill(qRgba(255, 255, 255, 255));
-        QPainter painter(m_pageImage);
-        renderToPainter(&painter);
-        m_pageIsRendered = true;
-    }
-
-    *p = *m_pageImage;
+    if (m_hasProvisionalSize)
+        m_pageSize = size;
+}
 
-    return true;
+XpsPage::~XpsPage()
+{
 }
 
-bool XpsPage::renderToPainter(QPainter *painter)
+QSharedPointer<const XpsDisplayList> XpsPage::displayList(const std::function<bool()> &shouldAbort)
 {
+    QSharedPointer<const XpsDisplayList> cached = m_file->cachedDisplayList(m_fileName);
+    if (cached)
+        return cached;
+
+    QSharedPointer<XpsDisplayList> displayList(new XpsDisplayList());
     XpsHandler handler(this);
-    handler.m_painter = painter;
-    handler.m_painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()));
+    handler.m_list = displayList.data();
+    handler.m_shouldAbort = shouldAbort;
     QXmlSimpleReader parser;
     parser.setContentHandler(&handler);
     parser.setErrorHandler(&handler);
@@ -1397,7 +1591,25 @@ bool XpsPage::renderToPainter(QPainter *painter)
     bool ok = parser.parse(source);
     qCWarning(OkularXpsDebug) << "Parse result: " << ok;
 
-    return true;
+    // a half parsed page is no use to anybody
+    if (shouldAbort && shouldAbort())
+        return QSharedPointer<const XpsDisplayList>();
+
+    m_file->cacheDisplayList(m_fileName, displayList);
+    return displayList;
+}
+
+bool XpsPage::renderToPainter(QPainter *painter, const std::function<bool()> &shouldAbort)
+{
+    const QSharedPointer<const XpsDisplayList> list = displayList(shouldAbort);
+    if (!list)
+        return false;
+
+    painter->save();
+    painter->setWorldTransform(QTransform().scale((qreal)painter->device()->width() / size().width(), (qreal)painter->device()->height() / size().height()), true);
+    const bool done = list->replay(painter, shouldAbort);
+    painter->restore();
+    return done;
 }
 
 QSizeF XpsPage::size() const
@@ -1409,6 +1621,17 @@ QFont XpsFile::getFontByName(const QString &absoluteFileName, float size)
 {
     // qCWarning(OkularXpsDebug) << "trying to get font: " << fileName << ", size: " << size;
 
+    const QPair<QString, int> key(absoluteFileName, qRound(size));
+    QHash<QPair<QString, int>, QFont>::const_iterator it = m_fonts.constFind(key);
+    if (it != m_fonts.constEnd())
+        return *it;
+    const QFont font = resolveFont(absoluteFileName, key.second);
+    m_fonts.insert(key, font);
+    return font;
+}
+
+QFont XpsFile::resolveFont(const QString &absoluteFileName, int size)
+{
     int index = m_fontCache.value(absoluteFileName, -1);
     if (index == -1) {
         index = loadFontByName(absoluteFileName);
@@ -1431,7 +1654,7 @@ QFont XpsFile::getFontByName(const QString &absoluteFileName, float size)
         return QFont();
     }
     const QString fontStyle = fontStyles[0];
-    return m_fontDatabase.font(fontFamily, fontStyle, qRound(size));
+    return m_fontDatabase.font(fontFamily, fontStyle, size);
 }
 
 int XpsFile::loadFontByName(const QString &absoluteFileName)
@@ -1480,6 +1703,58 @@ KZip *XpsFile::xpsArchive()
     return m_xpsArchive;
 }
 
+QSharedPointer<const XpsDisplayList> XpsFile::cachedDisplayList(const QString &fileName) const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    const QSharedPointer<const XpsDisplayList> *displayList = m_displayLists.object(fileName);
+    return displayList ? *displayList : QSharedPointer<const XpsDisplayList>();
+}
+
+void XpsFile::cacheDisplayList(const QString &fileName, const QSharedPointer<const XpsDisplayList> &displayList)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    m_displayLists.insert(fileName, new QSharedPointer<const XpsDisplayList>(displayList), qMax(1, int(displayList->memory() / 1024)));
+}
+
+QImage XpsFile::cachedImage(const QString &absoluteFileName) const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    const QImage *image = m_images.object(absoluteFileName);
+    return image ? *image : QImage();
+}
+
+void XpsFile::cacheImage(const QString &absoluteFileName, const QImage &image)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    m_images.insert(absoluteFileName, new QImage(image), qMax(1, int(image.sizeInBytes() / 1024)));
+}
+
+// the images are counted once, by the image cache: the display lists share them
+qulonglong XpsFile::cacheMemory() const
+{
+    QMutexLocker locker(&m_cacheMutex);
+    return (qulonglong(m_displayLists.totalCost()) + m_images.totalCost()) * 1024;
+}
+
+qulonglong XpsFile::trimCaches(qulonglong bytes)
+{
+    QMutexLocker locker(&m_cacheMutex);
+    const qulonglong before = (qulonglong(m_displayLists.totalCost()) + m_images.totalCost()) * 1024;
+    // the images first, those still drawn are kept alive by their display lists;
+    // the pages seen last go last, and the ones being drawn are kept alive by their renders
+    const qulonglong imagesBytes = qulonglong(m_images.totalCost()) * 1024;
+    m_images.setMaxCost(int((bytes < imagesBytes ? imagesBytes - bytes : 0) / 1024));
+    m_images.setMaxCost(imagesBudget);
+    const qulonglong freed = before - (qulonglong(m_displayLists.totalCost()) + m_images.totalCost()) * 1024;
+    if (freed < bytes) {
+        const qulonglong displayListsBytes = qulonglong(m_displayLists.totalCost()) * 1024;
+        const qulonglong left = bytes - freed;
+        m_displayLists.setMaxCost(int((left < displayListsBytes ? displayListsBytes - left : 0) / 1024));
+        m_displayLists.setMaxCost(displayListsBudget);
+    }
+    return before - (qulonglong(m_displayLists.totalCost()) + m_images.totalCost()) * 1024;
+}
+
 QImage XpsPage::loadImageFromFile(const QString &fileName)
 {
     // qCWarning(OkularXpsDebug) << "image file name: " << fileName;
@@ -1491,6 +1766,10 @@ QImage XpsPage::loadImageFromFile(const QString &fileName)
     }
 
     QString absoluteFileName = absolutePath(entryPath(m_fileName), fileName);
+    const QImage cached = m_file->cachedImage(absoluteFileName);
+    if (!cached.isNull())
+        return cached;
+
     const KZipFileEntry *imageFile = loadFile(m_file->xpsArchive(), absoluteFileName, Qt::CaseInsensitive);
     if (!imageFile) {
         // image not found
@@ -1524,6 +1803,8 @@ QImage XpsPage::loadImageFromFile(const QString &fileName)
     reader.setDevice(&buffer);
     reader.read(&image);
 
+    if (!image.isNull())
+        m_file->cacheImage(absoluteFileName, image);
     return image;
 }
 
@@ -1532,6 +1813,10 @@ Okular::TextPage *XpsPage::textPage()
     // qCWarning(OkularXpsDebug) << "Parsing XpsPage, text extraction";
 
     Okular::TextPage *textPage = new Okular::TextPage();
+    // the characters of all the glyphs in one buffer, given to the text page at once
+    QString chars;
+    QVector<int> lengths;
+    QVector<Okular::NormalizedRect> areas;
 
     const KZipFileEntry *pageFile = static_cast<const KZipFileEntry *>(m_file->xpsArchive()->directory()->entry(m_fileName));
     QXmlStreamReader xml;
@@ -1596,10 +1881,11 @@ Okular::TextPage *XpsPage::textPage()
                 for (int i = 0; i < text.length(); i++) {
                     const int width = metrics.horizontalAdvance(text, i + 1);
 
-                    Okular::NormalizedRect *rect =
-                        new Okular::NormalizedRect((origin.x() + lastWidth) / m_pageSize.width(), (origin.y() - metrics.height()) / m_pageSize.height(), (origin.x() + width) / m_pageSize.width(), origin.y() / m_pageSize.height());
-                    rect->transform(matrix);
-                    textPage->append(text.mid(i, 1), rect);
+                    Okular::NormalizedRect rect((origin.x() + lastWidth) / m_pageSize.width(), (origin.y() - metrics.height()) / m_pageSize.height(), (origin.x() + width) / m_pageSize.width(), origin.y() / m_pageSize.height());
+                    rect.transform(matrix);
+                    chars += text.at(i);
+                    lengths.append(1);
+                    areas.append(rect);
 
                     lastWidth = width;
                 }
@@ -1619,6 +1905,7 @@ Okular::TextPage *XpsPage::textPage()
     if (xml.error()) {
         qCWarning(OkularXpsDebug) << "Error parsing XpsPage text: " << xml.errorString();
     }
+    textPage->append(chars, lengths, areas);
     return textPage;
 }
 
@@ -1714,9 +2001,13 @@ XpsDocument::XpsDocument(XpsFile *file, const QString &fileName)
         docXml.readNext();
         if (docXml.isStartElement()) {
             if (docXml.name() == QStringLiteral("PageContent")) {
-                QString pagePath = docXml.attributes().value(QStringLiteral("Source")).toString();
+                const QXmlStreamAttributes attributes = docXml.attributes();
+                QString pagePath = attributes.value(QStringLiteral("Source")).toString();
                 qCWarning(OkularXpsDebug) << "Page Path: " << pagePath;
-                XpsPage *page = new XpsPage(file, absolutePath(documentFilePath, pagePath));
+                // the pages are only read when they are needed, this is what
+                // the document says their size is, if it does
+                const QSizeF provisionalSize(attributes.value(QStringLiteral("Width")).toString().toDouble(), attributes.value(QStringLiteral("Height")).toString().toDouble());
+                XpsPage *page = new XpsPage(file, absolutePath(documentFilePath, pagePath), provisionalSize);
                 m_pages.append(page);
             } else if (docXml.name() == QStringLiteral("PageContent.LinkTargets")) {
                 // do nothing - wait for the real LinkTarget elements
@@ -1797,6 +2088,8 @@ XpsPage *XpsDocument::page(int pageNum) const
 }
 
 XpsFile::XpsFile()
+    : m_displayLists(displayListsBudget)
+    , m_images(imagesBudget)
 {
 }
 
@@ -1950,6 +2243,11 @@ Okular::DocumentInfo XpsFile::generateDocumentInfo() const
 
 bool XpsFile::closeDocument()
 {
+    m_cacheMutex.lock();
+    m_displayLists.clear();
+    m_images.clear();
+    m_cacheMutex.unlock();
+    m_fonts.clear();
     qDeleteAll(m_documents);
     m_documents.clear();
 
@@ -1986,6 +2284,12 @@ XpsGenerator::XpsGenerator(QObject *parent, const QVariantList &args)
     setFeature(PrintNative);
     setFeature(PrintToFile);
     setFeature(Threaded);
+    // pages and tiles are drawn from the display lists outside of the user mutex
+    setFeature(ParallelRendering);
+    setFeature(TiledRendering);
+    setFeature(SupportsCancelling);
+    // the sizes of the pages are read when they are needed
+    setFeature(LazyPageData);
     userMutex();
 }
 
@@ -2002,10 +2306,22 @@ bool XpsGenerator::loadDocument(const QString &fileName, QVector<Okular::Page *>
 
     int pagesVectorOffset = 0;
 
+    // only the pages the FixedDocument has no size for are read, and then
+    // only one: the others are guessed to be like the page before them
+    // until loadPageData() reads their real size
+    QSizeF lastSize;
     for (int docNum = 0; docNum < m_xpsFile->numDocuments(); ++docNum) {
         XpsDocument *doc = m_xpsFile->document(docNum);
         for (int pageNum = 0; pageNum < doc->numPages(); ++pageNum) {
-            QSizeF pageSize = doc->page(pageNum)->size();
+            XpsPage *page = doc->page(pageNum);
+            if (page->size().isEmpty()) {
+                if (lastSize.isEmpty())
+                    page->loadSize();
+                else
+                    page->setProvisionalSize(lastSize);
+            }
+            const QSizeF pageSize = page->size();
+            lastSize = pageSize;
             pagesVector[pagesVectorOffset] = new Okular::Page(pagesVectorOffset, pageSize.width(), pageSize.height(), Okular::Rotation0);
             ++pagesVectorOffset;
         }
@@ -2025,11 +2341,35 @@ bool XpsGenerator::doCloseDocument()
 
 QImage XpsGenerator::image(Okular::PixmapRequest *request)
 {
-    QMutexLocker lock(userMutex());
-    QSize size((int)request->width(), (int)request->height());
-    QImage image(size, QImage::Format_RGB32);
-    XpsPage *pageToRender = m_xpsFile->page(request->page()->number());
-    pageToRender->renderToImage(&image);
+    const std::function<bool()> shouldAbort = [request] { return request->shouldAbortRender(); };
+    QSharedPointer<const XpsDisplayList> displayList;
+    QSizeF pageSize;
+    {
+        // parsing reads the archive and loads the fonts, one page at a time
+        QMutexLocker lock(userMutex());
+        XpsPage *pageToRender = m_xpsFile->page(request->page()->number());
+        pageToRender->loadSize();
+        displayList = pageToRender->displayList(shouldAbort);
+        pageSize = pageToRender->size();
+    }
+    if (!displayList)
+        return QImage();
+
+    QRect rect(0, 0, request->width(), request->height());
+    if (request->isTile())
+        rect = request->normalizedRect().geometry(request->width(), request->height());
+
+    QImage image(rect.size(), QImage::Format_ARGB32_Premultiplied);
+    // Set one point = one drawing unit. Useful for fonts, because xps specifies font size using drawing units, not points as usual
+    image.setDotsPerMeterX(2835);
+    image.setDotsPerMeterY(2835);
+    image.fill(qRgba(255, 255, 255, 255));
+
+    QPainter painter(&image);
+    painter.translate(-rect.topLeft());
+    painter.scale(request->width() / pageSize.width(), request->height() / pageSize.height());
+    if (!displayList->replay(&painter, shouldAbort))
+        return QImage();
     return image;
 }
 
@@ -2037,9 +2377,29 @@ Okular::TextPage *XpsGenerator::textPage(Okular::TextRequest *request)
 {
     QMutexLocker lock(userMutex());
     XpsPage *xpsPage = m_xpsFile->page(request->page()->number());
+    // the text is laid out in the real size of the page
+    xpsPage->loadSize();
     return xpsPage->textPage();
 }
 
+bool XpsGenerator::loadPageData(Okular::Page *page)
+{
+    // the archive can only be read by one thread at a time
+    QMutexLocker locker(userMutex());
+    XpsPage *xpsPage = m_xpsFile->page(page->number());
+    if (!xpsPage)
+        return false;
+
+    // rendering or the text may have read the real size already, the page
+    // still has the provisional one then
+    xpsPage->loadSize();
+    const QSizeF size = xpsPage->size();
+    locker.unlock();
+    if (size.width() != page->width() || size.height() != page->height())
+        page->setSize(size.width(), size.height());
+    return false;
+}
+
 Okular::DocumentInfo XpsGenerator::generateDocumentInfo(const QSet<Okular::DocumentInfo::Key> &keys) const
 {
     Q_UNUSED(keys);
@@ -2095,6 +2455,16 @@ bool XpsGenerator::exportTo(const QString &fileName, const Okular::ExportFormat
     return false;
 }
 
+qulonglong XpsGenerator::cachedMemory() const
+{
+    return m_xpsFile ? m_xpsFile->cacheMemory() : 0;
+}
+
+qulonglong XpsGenerator::freeCachedMemory(qulonglong bytes)
+{
+    return m_xpsFile ? m_xpsFile->trimCaches(bytes) : 0;
+}
+
 bool XpsGenerator::print(QPrinter &printer)
 {
     QList<int> pageList = Okular::FilePrinter::pageList(printer, document()->pages(), document()->currentPage() + 1, document()->bookmarkedPageList());
@@ -2106,7 +2476,10 @@ bool XpsGenerator::print(QPrinter &printer)
             printer.newPage();
 
         const int page = pageList.at(i) - 1;
+        // like image(), the background threads read the archive too
+        QMutexLocker lock(userMutex());
         XpsPage *pageToRender = m_xpsFile->page(page);
+        pageToRender->loadSize();
         pageToRender->renderToPainter(&painter);
     }
 
@@ -10,11 +10,18 @@
 #include <core/generator.h>
 #include <core/textpage.h>
 
+#include <QCache>
 #include <QColor>
 #include <QDomDocument>
+#include <QFont>
 #include <QFontDatabase>
+#include <QHash>
 #include <QImage>
 #include <QLoggingCategory>
+#include <QMutex>
+#include <QPainterPath>
+#include <QPen>
+#include <QSharedPointer>
 #include <QStack>
 #include <QVariant>
 #include <QXmlDefaultHandler>
@@ -22,6 +29,8 @@
 
 #include <kzip.h>
 
+#include <functional>
+
 typedef enum { abtCommand, abtNumber, abtComma, abtEOF } AbbPathTokenType;
 
 class AbbPathToken
@@ -97,6 +106,78 @@ struct XpsPathGeometry {
     XpsMatrixTransform transform;
 };
 
+/**
+    The drawing of a page, parsed once from its FixedPage and then replayed
+    for every size and tile the page is rendered at. It is recorded in page
+    units with the QPainter calls of the same name; replaying only reads it,
+    so it can happen in several threads at once.
+*/
+class XpsDisplayList
+{
+public:
+    XpsDisplayList();
+
+    void save();
+    void restore();
+    qreal opacity() const;
+    void setOpacity(qreal opacity);
+    /**
+       Combines @p matrix with the current transformation.
+    */
+    void transform(const QTransform &matrix);
+    void setClipPath(const QPainterPath &path);
+    void setLayoutDirection(Qt::LayoutDirection direction);
+    void setFont(const QFont &font);
+    void setBrush(const QBrush &brush);
+    void setPen(const QPen &pen);
+    void drawPath(const QPainterPath &path);
+    /**
+       Draws each character of @p text at its point in @p positions.
+    */
+    void drawGlyphRun(const QString &text, const QVector<QPointF> &positions);
+
+    /**
+       Draws the page into @p painter, already set up for page units. If
+       @p shouldAbort is set it is checked every now and then and drawing
+       stops, returning false, as soon as it returns true.
+    */
+    bool replay(QPainter *painter, const std::function<bool()> &shouldAbort = std::function<bool()>()) const;
+
+    /**
+       About how many bytes the display list takes, apart from the images
+       of its brushes.
+    */
+    qulonglong memory() const;
+
+private:
+    enum CommandType { Save, Restore, SetOpacity, Transform, SetClipPath, SetLayoutDirection, SetFont, SetBrush, SetPen, DrawPath, DrawGlyphRun };
+
+    // index is into the vector of the data of the type, or the value itself
+    struct Command {
+        CommandType type;
+        int index;
+    };
+
+    struct GlyphRun {
+        QString text;
+        QVector<QPointF> positions;
+    };
+
+    QVector<Command> m_commands;
+    QVector<qreal> m_opacities;
+    QVector<QTransform> m_transforms;
+    QVector<QPainterPath> m_paths;
+    QVector<QFont> m_fonts;
+    QVector<QBrush> m_brushes;
+    QVector<QPen> m_pens;
+    QVector<GlyphRun> m_glyphRuns;
+
+    // the opacity while recording, for the elements that multiply it
+    qreal m_opacity;
+    QStack<qreal> m_savedOpacities;
+    qulonglong m_memory;
+};
+
 class XpsPage;
 class XpsFile;
 
@@ -126,9 +207,13 @@ protected:
     void processPathGeometry(XpsRenderNode &node);
     void processPathFigure(XpsRenderNode &node);
 
-    QPainter *m_painter;
+    XpsDisplayList *m_list;
 
-    QImage m_image;
+    // parsing stops as soon as this returns true
+    std::function<bool()> m_shouldAbort;
+
+    // the glyphs are laid out for one point = one drawing unit
+    QImage m_metricsDevice;
 
     QStack<XpsRenderNode> m_nodes;
 
@@ -138,15 +223,36 @@ protected:
 class XpsPage
 {
 public:
-    XpsPage(XpsFile *file, const QString &fileName);
+    /**
+       A page whose size is not read from its part until loadSize() is
+       called; until then it is \p provisionalSize, e.g. the size the
+       FixedDocument gives for it.
+    */
+    XpsPage(XpsFile *file, const QString &fileName, const QSizeF &provisionalSize);
     ~XpsPage();
 
     XpsPage(const XpsPage &) = delete;
     XpsPage &operator=(const XpsPage &) = delete;
 
     QSizeF size() const;
-    bool renderToImage(QImage *p);
-    bool renderToPainter(QPainter *painter);
+    /**
+       Reads the size of the page from the start of its part, which is not
+       decompressed any further, unless it did already. Returns whether the
+       size changed.
+    */
+    bool loadSize();
+    void setProvisionalSize(const QSizeF &size);
+    /**
+       The display list of the page, parsed if the file does not have it
+       cached. If \p shouldAbort is set it is checked between the elements
+       of the page and parsing stops, returning null, as soon as it returns
+       true.
+    */
+    QSharedPointer<const XpsDisplayList> displayList(const std::function<bool()> &shouldAbort = std::function<bool()>());
+    /**
+       Renders the page into \p painter, scaled to its whole device.
+    */
+    bool renderToPainter(QPainter *painter, const std::function<bool()> &shouldAbort = std::function<bool()>());
     Okular::TextPage *textPage();
 
     QImage loadImageFromFile(const QString &filename);
@@ -160,15 +266,13 @@ private:
     const QString m_fileName;
 
     QSizeF m_pageSize;
+    bool m_hasProvisionalSize;
 
     QString m_thumbnailFileName;
     bool m_thumbnailMightBeAvailable;
     QImage m_thumbnail;
     bool m_thumbnailIsLoaded;
 
-    QImage *m_pageImage;
-    bool m_pageIsRendered;
-
     friend class XpsHandler;
     friend class XpsTextExtractionHandler;
 };
@@ -275,7 +379,33 @@ public:
 
     KZip *xpsArchive();
 
+    /**
+       The display list of the page in \p fileName if it is cached, null
+       otherwise.
+    */
+    QSharedPointer<const XpsDisplayList> cachedDisplayList(const QString &fileName) const;
+    void cacheDisplayList(const QString &fileName, const QSharedPointer<const XpsDisplayList> &displayList);
+
+    /**
+       The decoded image in \p absoluteFileName if it is cached, a null
+       image otherwise.
+    */
+    QImage cachedImage(const QString &absoluteFileName) const;
+    void cacheImage(const QString &absoluteFileName, const QImage &image);
+
+    /**
+       The bytes the cached display lists and images take.
+    */
+    qulonglong cacheMemory() const;
+
+    /**
+       Drops cached display lists and images for at least \p bytes,
+       returns the bytes freed.
+    */
+    qulonglong trimCaches(qulonglong bytes);
+
 private:
+    QFont resolveFont(const QString &absoluteFileName, int size);
     int loadFontByName(const QString &absoluteFileName);
 
     QList<XpsDocument *> m_documents;
@@ -294,6 +424,14 @@ private:
 
     QMap<QString, int> m_fontCache;
     QFontDatabase m_fontDatabase;
+    // the fonts as resolved by getFontByName(), by file and size
+    QHash<QPair<QString, int>, QFont> m_fonts;
+
+    // by file name of the page and of the image, the cost is in KiB; the
+    // document asks for their memory from the main thread
+    QCache<QString, QSharedPointer<const XpsDisplayList>> m_displayLists;
+    QCache<QString, QImage> m_images;
+    mutable QMutex m_cacheMutex;
 };
 
 class XpsGenerator : public Okular::Generator
@@ -314,10 +452,14 @@ public:
 
     bool print(QPrinter &printer) override;
 
+    qulonglong cachedMemory() const override;
+    qulonglong freeCachedMemory(qulonglong bytes) override;
+
 protected:
     bool doCloseDocument() override;
     QImage image(Okular::PixmapRequest *request) override;
     Okular::TextPage *textPage(Okular::TextRequest *request) override;
+    bool loadPageData(Okular::Page *page) override;
 
 private:
     XpsFile *m_xpsFile;
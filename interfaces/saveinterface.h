@@ -41,7 +41,8 @@ public:
      */
     enum SaveOption {
         NoOption = 0,
-        SaveChanges = 1 ///< The possibility to save with the current changes to the document.
+        SaveChanges = 1, ///< The possibility to save with the current changes to the document.
+        SaveInPlace = 2  ///< The possibility to save the changes by appending them to the file the document was loaded from, without rewriting it. Always used together with SaveChanges. @since 21.12
     };
     Q_DECLARE_FLAGS(SaveOptions, SaveOption)
 
@@ -68,6 +69,10 @@ public:
 
     /**
      * Save to the specified @p fileName with the specified @p options.
+     *
+     * With SaveInPlace @p fileName is the file the document was loaded from.
+     * When the changes can't be appended to it, the file must be left as it
+     * was and false returned, so the caller can save the usual way.
      */
     virtual bool save(const QString &fileName, SaveOptions options, QString *errorText) = 0;
 
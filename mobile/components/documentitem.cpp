@@ -61,7 +61,9 @@ void DocumentItem::setUrl(const QUrl &url)
     m_document->openDocument(path, realUrl, db.mimeTypeForUrl(realUrl));
 
     m_tocModel->clear();
-    m_tocModel->fill(m_document->documentSynopsis());
+    m_tocModel->fill(m_document->outline());
+    // the QML views of it don't fetch the items of the branches as they open them
+    m_tocModel->fetchAll();
     m_tocModel->setCurrentViewport(m_document->viewport());
 
     m_matchingPages.clear();
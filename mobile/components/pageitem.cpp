@@ -23,6 +23,9 @@
 
 #define REDRAW_TIMEOUT 250
 
+// the longest side of a texture even the small GPUs of phones take
+static const int maxTextureSize = 4096;
+
 PageItem::PageItem(QQuickItem *parent)
     : QQuickItem(parent)
     , Okular::View(QStringLiteral("PageView"))
@@ -30,6 +33,7 @@ PageItem::PageItem(QQuickItem *parent)
     , m_smooth(false)
     , m_bookmarked(false)
     , m_isThumbnail(false)
+    , m_hasContent(false)
 {
     setFlag(QQuickItem::ItemHasContents, true);
 
@@ -40,6 +44,11 @@ PageItem::PageItem(QQuickItem *parent)
     m_redrawTimer->setSingleShot(true);
     connect(m_redrawTimer, &QTimer::timeout, this, &PageItem::requestPixmap);
     connect(this, &QQuickItem::windowChanged, m_redrawTimer, [this]() { m_redrawTimer->start(); });
+    // a page swiped in was only preloaded so far
+    connect(this, &QQuickItem::visibleChanged, m_redrawTimer, [this]() {
+        if (isVisible())
+            m_redrawTimer->start();
+    });
 }
 
 PageItem::~PageItem()
@@ -130,6 +139,8 @@ void PageItem::refreshPage()
     } else {
         m_page = nullptr;
     }
+    // it may be the page of another document
+    PagePainter::invalidateOverlays(m_page);
 
     emit implicitWidthChanged();
     emit implicitHeightChanged();
@@ -289,11 +300,19 @@ void PageItem::geometryChanged(const QRectF &newGeometry, const QRectF &oldGeome
 
 QSGNode *PageItem::updatePaintNode(QSGNode *node, QQuickItem::UpdatePaintNodeData * /*data*/)
 {
-    if (!window() || m_buffer.isNull()) {
+    if (!window() || !m_hasContent) {
         delete node;
         return nullptr;
     }
     QSGSimpleTextureNode *n = static_cast<QSGSimpleTextureNode *>(node);
+    if (m_buffer.isNull()) {
+        // the texture is up to date, unless the scene graph dropped it
+        if (!n)
+            QMetaObject::invokeMethod(m_redrawTimer, [this]() { m_redrawTimer->start(); }, Qt::QueuedConnection);
+        else
+            n->setRect(boundingRect());
+        return n;
+    }
     if (!n) {
         n = new QSGSimpleTextureNode();
         n->setOwnsTexture(true);
@@ -301,23 +320,37 @@ QSGNode *PageItem::updatePaintNode(QSGNode *node, QQuickItem::UpdatePaintNodeDat
 
     n->setTexture(window()->createTextureFromImage(m_buffer));
     n->setRect(boundingRect());
+    // the texture has the pixels now, no need to keep a second copy of them
+    m_buffer = QImage();
     return n;
 }
 
+qreal PageItem::renderRatio() const
+{
+    // the device pixel ratio, as long as the texture fits the GPU
+    const qreal longestSide = qMax(width(), height());
+    const qreal dpr = window()->devicePixelRatio();
+    return longestSide * dpr > maxTextureSize ? maxTextureSize / longestSide : dpr;
+}
+
 void PageItem::requestPixmap()
 {
     if (!m_documentItem || !m_page || !window() || width() <= 0 || height() < 0) {
-        if (!m_buffer.isNull()) {
+        if (m_hasContent) {
             m_buffer = QImage();
+            m_hasContent = false;
             update();
         }
         return;
     }
 
     Observer *observer = m_isThumbnail ? m_documentItem.data()->thumbnailObserver() : m_documentItem.data()->pageviewObserver();
-    const int priority = m_isThumbnail ? THUMBNAILS_PRIO : PAGEVIEW_PRIO;
+    // the pages next to the current one are hidden until they are swiped in
+    const bool preload = !isVisible();
+    const int priority = m_isThumbnail ? (preload ? THUMBNAILS_PRELOAD_PRIO : THUMBNAILS_PRIO) : (preload ? PAGEVIEW_PRELOAD_PRIO : PAGEVIEW_PRIO);
+    const Okular::PixmapRequest::PixmapRequestFeatures features = preload ? Okular::PixmapRequest::Asynchronous | Okular::PixmapRequest::Preload : Okular::PixmapRequest::Asynchronous;
 
-    const qreal dpr = window()->devicePixelRatio();
+    const qreal ratio = renderRatio();
 
     // Here we want to request the pixmap for the page, but it may happen that the page
     // already has the pixmap, thus requestPixmaps would not trigger pageHasChanged
@@ -327,7 +360,7 @@ void PageItem::requestPixmap()
     // Ideally we would do one or the other but for now this is good enough
     paint();
     {
-        auto request = new Okular::PixmapRequest(observer, m_viewPort.pageNumber, width() * dpr, height() * dpr, priority, Okular::PixmapRequest::Asynchronous);
+        auto request = new Okular::PixmapRequest(observer, m_viewPort.pageNumber, width() * ratio, height() * ratio, priority, features);
         request->setNormalizedRect(Okular::NormalizedRect(0, 0, 1, 1));
         const Okular::Document::PixmapRequestFlag prf = Okular::Document::NoOption;
         m_documentItem.data()->document()->requestPixmaps({request}, prf);
@@ -339,16 +372,18 @@ void PageItem::paint()
     Observer *observer = m_isThumbnail ? m_documentItem.data()->thumbnailObserver() : m_documentItem.data()->pageviewObserver();
     const int flags = PagePainter::Accessibility | PagePainter::Highlights | PagePainter::Annotations;
 
-    const qreal dpr = window()->devicePixelRatio();
-    const QRect limits(QPoint(0, 0), QSize(width() * dpr, height() * dpr));
-    QPixmap pix(limits.size());
-    pix.setDevicePixelRatio(dpr);
-    QPainter p(&pix);
+    // straight into an image, it is what the texture is made from
+    const qreal ratio = renderRatio();
+    const QRect limits(QPoint(0, 0), QSize(width() * ratio, height() * ratio));
+    QImage image(limits.size(), QImage::Format_ARGB32_Premultiplied);
+    image.setDevicePixelRatio(ratio);
+    QPainter p(&image);
     p.setRenderHint(QPainter::Antialiasing, m_smooth);
     PagePainter::paintPageOnPainter(&p, m_page, observer, flags, width(), height(), limits);
     p.end();
 
-    m_buffer = pix.toImage();
+    m_buffer = image;
+    m_hasContent = true;
 
     update();
 }
@@ -357,6 +392,9 @@ void PageItem::paint()
 void PageItem::pageHasChanged(int page, int flags)
 {
     if (m_viewPort.pageNumber == page) {
+        if (flags & (Okular::DocumentObserver::Highlights | Okular::DocumentObserver::TextSelection | Okular::DocumentObserver::Annotations))
+            PagePainter::invalidateOverlays(m_page);
+
         if (flags == Okular::DocumentObserver::BoundingBox) {
             // skip bounding box updates
             // kDebug() << "32" << m_page->boundingBox();
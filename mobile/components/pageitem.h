@@ -149,6 +149,7 @@ private Q_SLOTS:
 private:
     void paint();
     void refreshPage();
+    qreal renderRatio() const;
 
     const Okular::Page *m_page;
     bool m_smooth;
@@ -158,7 +159,9 @@ private:
     QTimer *m_redrawTimer;
     QPointer<QQuickItem> m_flickable;
     Okular::DocumentViewport m_viewPort;
+    // what was painted and is not a texture yet, dropped once it is
     QImage m_buffer;
+    bool m_hasContent;
 };
 
 #endif
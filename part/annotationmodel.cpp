@@ -12,6 +12,10 @@
 #include <QLinkedList>
 #include <QList>
 #include <QPointer>
+#include <QSet>
+#include <QStringList>
+
+#include <algorithm>
 
 #include <KLocalizedString>
 #include <QIcon>
@@ -38,18 +42,9 @@ struct AnnItem {
     int page;
 };
 
-static QLinkedList<Okular::Annotation *> filterOutWidgetAnnotations(const QLinkedList<Okular::Annotation *> &annotations)
+static bool isShown(const Okular::Annotation *annotation)
 {
-    QLinkedList<Okular::Annotation *> result;
-
-    for (Okular::Annotation *annotation : annotations) {
-        if (annotation->subType() == Okular::Annotation::AWidget)
-            continue;
-
-        result.append(annotation);
-    }
-
-    return result;
+    return annotation->subType() != Okular::Annotation::AWidget;
 }
 
 class AnnotationModelPrivate : public Okular::DocumentObserver
@@ -60,13 +55,20 @@ public:
 
     void notifySetup(const QVector<Okular::Page *> &pages, int setupFlags) override;
     void notifyPageChanged(int page, int flags) override;
+    void notifyAnnotationsChanged(int page, const QVector<Okular::Annotation *> &added, const QVector<Okular::Annotation *> &removed, const QVector<Okular::Annotation *> &modified) override;
 
     QModelIndex indexForItem(AnnItem *item) const;
     void rebuildTree(const QVector<Okular::Page *> &pages);
+    // the branch of page, if any; index is where it is or would be among the branches
     AnnItem *findItem(int page, int *index) const;
+    AnnItem *annotationItem(int page, Okular::Annotation *annotation) const;
+    void removeItems(int page, const QSet<Okular::Annotation *> &annotations);
+    void appendItems(int page, const QVector<Okular::Annotation *> &annotations);
 
     AnnotationModel *q;
     AnnItem *root;
+    // the items of the annotations, to find them with no walk of their branch
+    QHash<Okular::Annotation *, AnnItem *> annotationItems;
     QPointer<Okular::Document> document;
 };
 
@@ -111,16 +113,18 @@ AnnotationModelPrivate::~AnnotationModelPrivate()
     delete root;
 }
 
-static void updateAnnotationPointer(AnnItem *item, const QVector<Okular::Page *> &pages)
+static void updateAnnotationPointer(AnnItem *item, const QVector<Okular::Page *> &pages, QHash<Okular::Annotation *, AnnItem *> &annotationItems)
 {
     if (item->annotation) {
         item->annotation = pages[item->page]->annotation(item->annotation->uniqueName());
-        if (!item->annotation)
+        if (item->annotation)
+            annotationItems.insert(item->annotation, item);
+        else
             qWarning() << "Lost annotation on document save, something went wrong";
     }
 
     for (AnnItem *child : qAsConst(item->children)) {
-        updateAnnotationPointer(child, pages);
+        updateAnnotationPointer(child, pages, annotationItems);
     }
 }
 
@@ -132,7 +136,8 @@ void AnnotationModelPrivate::notifySetup(const QVector<Okular::Page *> &pages, i
             // need to update all the Annotation* otherwise
             // they still point to the old document ones, luckily the old ones are still
             // around so we can look for the new ones using unique ids, etc
-            updateAnnotationPointer(root, pages);
+            annotationItems.clear();
+            updateAnnotationPointer(root, pages, annotationItems);
         }
         return;
     }
@@ -140,6 +145,7 @@ void AnnotationModelPrivate::notifySetup(const QVector<Okular::Page *> &pages, i
     q->beginResetModel();
     qDeleteAll(root->children);
     root->children.clear();
+    annotationItems.clear();
 
     rebuildTree(pages);
     q->endResetModel();
@@ -151,89 +157,63 @@ void AnnotationModelPrivate::notifyPageChanged(int page, int flags)
     if (!(flags & Okular::DocumentObserver::Annotations))
         return;
 
-    const QLinkedList<Okular::Annotation *> annots = filterOutWidgetAnnotations(document->page(page)->annotations());
-    int annItemIndex = -1;
-    AnnItem *annItem = findItem(page, &annItemIndex);
-    // case 1: the page has no more annotations
-    //         => remove the branch, if any
-    if (annots.isEmpty()) {
-        if (annItem) {
-            q->beginRemoveRows(indexForItem(root), annItemIndex, annItemIndex);
-            delete root->children.at(annItemIndex);
-            root->children.removeAt(annItemIndex);
-            q->endRemoveRows();
-        }
-        return;
-    }
-    // case 2: no existing branch
-    //         => add a new branch, and add the annotations for the page
-    if (!annItem) {
-        int i = 0;
-        while (i < root->children.count() && root->children.at(i)->page < page)
-            ++i;
+    // the document does not say what changed, compare with what the page has
+    QSet<Okular::Annotation *> annots;
+    QVector<Okular::Annotation *> added;
+    const QLinkedList<Okular::Annotation *> &pageAnnotations = document->page(page)->annotations();
+    for (Okular::Annotation *annotation : pageAnnotations) {
+        if (!isShown(annotation))
+            continue;
 
-        AnnItem *annItem = new AnnItem();
-        annItem->page = page;
-        annItem->parent = root;
-        q->beginInsertRows(indexForItem(root), i, i);
-        annItem->parent->children.insert(i, annItem);
-        q->endInsertRows();
-        QLinkedList<Okular::Annotation *>::ConstIterator it = annots.begin(), itEnd = annots.end();
-        int newid = 0;
-        for (; it != itEnd; ++it, ++newid) {
-            q->beginInsertRows(indexForItem(annItem), newid, newid);
-            new AnnItem(annItem, *it);
-            q->endInsertRows();
-        }
-        return;
+        annots.insert(annotation);
+        if (!annotationItem(page, annotation))
+            added.append(annotation);
     }
-    // case 3: existing branch, less annotations than items
-    //         => lookup and remove the annotations
-    if (annItem->children.count() > annots.count()) {
-        for (int i = annItem->children.count(); i > 0; --i) {
-            Okular::Annotation *ref = annItem->children.at(i - 1)->annotation;
-            bool found = false;
-            QLinkedList<Okular::Annotation *>::ConstIterator it = annots.begin(), itEnd = annots.end();
-            for (; !found && it != itEnd; ++it) {
-                if ((*it) == ref)
-                    found = true;
-            }
-            if (!found) {
-                q->beginRemoveRows(indexForItem(annItem), i - 1, i - 1);
-                delete annItem->children.at(i - 1);
-                annItem->children.removeAt(i - 1);
-                q->endRemoveRows();
-            }
+
+    QSet<Okular::Annotation *> removed;
+    if (AnnItem *annItem = findItem(page, nullptr)) {
+        for (const AnnItem *child : qAsConst(annItem->children)) {
+            if (!annots.contains(child->annotation))
+                removed.insert(child->annotation);
         }
-        return;
     }
-    // case 4: existing branch, less items than annotations
-    //         => lookup and add annotations if not in the branch
-    if (annots.count() > annItem->children.count()) {
-        QLinkedList<Okular::Annotation *>::ConstIterator it = annots.begin(), itEnd = annots.end();
-        for (; it != itEnd; ++it) {
-            Okular::Annotation *ref = *it;
-            bool found = false;
-            int count = annItem->children.count();
-            for (int i = 0; !found && i < count; ++i) {
-                if (ref == annItem->children.at(i)->annotation)
-                    found = true;
-            }
-            if (!found) {
-                q->beginInsertRows(indexForItem(annItem), count, count);
-                new AnnItem(annItem, ref);
-                q->endInsertRows();
-            }
-        }
-        return;
+
+    removeItems(page, removed);
+
+    // the data of any of the annotations kept may have changed
+    AnnItem *annItem = findItem(page, nullptr);
+    if (annItem && !annItem->children.isEmpty()) {
+        const QModelIndex parent = indexForItem(annItem);
+        emit q->dataChanged(q->index(0, 0, parent), q->index(annItem->children.count() - 1, 0, parent));
     }
-    // case 5: the data of some annotation changed
-    // TODO: what do we do in this case?
-    // FIXME: for now, update ALL the annotations for that page
-    for (int i = 0; i < annItem->children.count(); ++i) {
-        QModelIndex index = indexForItem(annItem->children.at(i));
+
+    appendItems(page, added);
+}
+
+void AnnotationModelPrivate::notifyAnnotationsChanged(int page, const QVector<Okular::Annotation *> &added, const QVector<Okular::Annotation *> &removed, const QVector<Okular::Annotation *> &modified)
+{
+    // removed first, a new annotation may have the address of a deleted one
+    QSet<Okular::Annotation *> removedSet;
+    removedSet.reserve(removed.count());
+    for (Okular::Annotation *annotation : removed)
+        removedSet.insert(annotation);
+    removeItems(page, removedSet);
+
+    for (Okular::Annotation *annotation : modified) {
+        AnnItem *item = annotationItem(page, annotation);
+        if (!item)
+            continue;
+
+        const QModelIndex index = indexForItem(item);
         emit q->dataChanged(index, index);
     }
+
+    QVector<Okular::Annotation *> shown;
+    for (Okular::Annotation *annotation : added) {
+        if (isShown(annotation) && !annotationItem(page, annotation))
+            shown.append(annotation);
+    }
+    appendItems(page, shown);
 }
 
 QModelIndex AnnotationModelPrivate::indexForItem(AnnItem *item) const
@@ -253,14 +233,15 @@ void AnnotationModelPrivate::rebuildTree(const QVector<Okular::Page *> &pages)
 
     emit q->layoutAboutToBeChanged();
     for (int i = 0; i < pages.count(); ++i) {
-        const QLinkedList<Okular::Annotation *> annots = filterOutWidgetAnnotations(pages.at(i)->annotations());
-        if (annots.isEmpty())
-            continue;
-
-        AnnItem *annItem = new AnnItem(root, i);
-        QLinkedList<Okular::Annotation *>::ConstIterator it = annots.begin(), itEnd = annots.end();
-        for (; it != itEnd; ++it) {
-            new AnnItem(annItem, *it);
+        AnnItem *annItem = nullptr;
+        const QLinkedList<Okular::Annotation *> &annots = pages.at(i)->annotations();
+        for (Okular::Annotation *annotation : annots) {
+            if (!isShown(annotation))
+                continue;
+
+            if (!annItem)
+                annItem = new AnnItem(root, i);
+            annotationItems.insert(annotation, new AnnItem(annItem, annotation));
         }
     }
     emit q->layoutChanged();
@@ -268,17 +249,92 @@ void AnnotationModelPrivate::rebuildTree(const QVector<Okular::Page *> &pages)
 
 AnnItem *AnnotationModelPrivate::findItem(int page, int *index) const
 {
-    for (int i = 0; i < root->children.count(); ++i) {
-        AnnItem *tmp = root->children.at(i);
-        if (tmp->page == page) {
-            if (index)
-                *index = i;
-            return tmp;
+    // the branches are in page order
+    const auto it = std::lower_bound(root->children.constBegin(), root->children.constEnd(), page, [](const AnnItem *item, int page) { return item->page < page; });
+    if (index)
+        *index = it - root->children.constBegin();
+    return it != root->children.constEnd() && (*it)->page == page ? *it : nullptr;
+}
+
+AnnItem *AnnotationModelPrivate::annotationItem(int page, Okular::Annotation *annotation) const
+{
+    // the address of an annotation deleted unnoticed may be in use on another page
+    AnnItem *item = annotationItems.value(annotation);
+    return item && item->page == page ? item : nullptr;
+}
+
+void AnnotationModelPrivate::removeItems(int page, const QSet<Okular::Annotation *> &annotations)
+{
+    int annItemIndex = -1;
+    AnnItem *annItem = findItem(page, &annItemIndex);
+    if (!annItem || annotations.isEmpty())
+        return;
+
+    QList<AnnItem *> &children = annItem->children;
+    int removedCount = 0;
+    for (const AnnItem *child : qAsConst(children)) {
+        if (annotations.contains(child->annotation))
+            ++removedCount;
+    }
+    // the page has no more annotations => remove the branch
+    if (removedCount == children.count()) {
+        for (const AnnItem *child : qAsConst(children)) {
+            if (annotationItems.value(child->annotation) == child)
+                annotationItems.remove(child->annotation);
         }
+        q->beginRemoveRows(QModelIndex(), annItemIndex, annItemIndex);
+        delete root->children.takeAt(annItemIndex);
+        q->endRemoveRows();
+        return;
+    }
+
+    // else the runs of removed items, from the last one
+    const QModelIndex parent = indexForItem(annItem);
+    for (int last = children.count() - 1; last >= 0 && removedCount > 0; --last) {
+        if (!annotations.contains(children.at(last)->annotation))
+            continue;
+
+        int first = last;
+        while (first > 0 && annotations.contains(children.at(first - 1)->annotation))
+            --first;
+
+        q->beginRemoveRows(parent, first, last);
+        for (int i = first; i <= last; ++i) {
+            AnnItem *child = children.at(i);
+            if (annotationItems.value(child->annotation) == child)
+                annotationItems.remove(child->annotation);
+            delete child;
+        }
+        children.erase(children.begin() + first, children.begin() + last + 1);
+        q->endRemoveRows();
+
+        removedCount -= last - first + 1;
+        last = first;
     }
-    if (index)
-        *index = -1;
-    return nullptr;
+}
+
+void AnnotationModelPrivate::appendItems(int page, const QVector<Okular::Annotation *> &annotations)
+{
+    if (annotations.isEmpty())
+        return;
+
+    // no existing branch => add a new one
+    int annItemIndex = -1;
+    AnnItem *annItem = findItem(page, &annItemIndex);
+    if (!annItem) {
+        annItem = new AnnItem();
+        annItem->page = page;
+        annItem->parent = root;
+        q->beginInsertRows(QModelIndex(), annItemIndex, annItemIndex);
+        root->children.insert(annItemIndex, annItem);
+        q->endInsertRows();
+    }
+
+    const int first = annItem->children.count();
+    q->beginInsertRows(indexForItem(annItem), first, first + annotations.count() - 1);
+    for (Okular::Annotation *annotation : annotations)
+        annotationItems.insert(annotation, new AnnItem(annItem, annotation));
+    q->endInsertRows();
 }
 
 AnnotationModel::AnnotationModel(Okular::Document *document, QObject *parent)
@@ -336,6 +392,14 @@ QVariant AnnotationModel::data(const QModelIndex &index, int role) const
     case PageRole:
         return item->page;
         break;
+    case SearchTextRole: {
+        QStringList texts = {GuiUtils::captionForAnnotation(item->annotation), item->annotation->author(), item->annotation->contents()};
+        for (const Okular::Annotation::Revision &revision : qAsConst(item->annotation->revisions())) {
+            if (const Okular::Annotation *reply = revision.annotation())
+                texts << reply->author() << reply->contents();
+        }
+        return texts.join(QLatin1Char('\n'));
+    }
     }
     return QVariant();
 }
@@ -22,7 +22,12 @@ class AnnotationModel : public QAbstractItemModel
     Q_OBJECT
 
 public:
-    enum { AuthorRole = Qt::UserRole + 1000, PageRole };
+    enum {
+        AuthorRole = Qt::UserRole + 1000,
+        PageRole,
+        // the caption, author and contents of an annotation and of its replies
+        SearchTextRole
+    };
 
     explicit AnnotationModel(Okular::Document *document, QObject *parent = nullptr);
     ~AnnotationModel() override;
@@ -6,19 +6,17 @@
 
 #include "annotationproxymodels.h"
 
+#include <QHash>
 #include <QItemSelection>
 #include <QList>
 
 #include <QIcon>
 
+#include <algorithm>
+
 #include "annotationmodel.h"
 #include "debug_ui.h"
 
-static quint32 mixIndex(int row, int column)
-{
-    return (row << 4) | column;
-}
-
 PageFilterProxyModel::PageFilterProxyModel(QObject *parent)
     : QSortFilterProxyModel(parent)
     , mGroupByCurrentPage(false)
@@ -53,7 +51,8 @@ void PageFilterProxyModel::setCurrentPage(int page)
 
 bool PageFilterProxyModel::filterAcceptsRow(int row, const QModelIndex &sourceParent) const
 {
-    if (!mGroupByCurrentPage)
+    // the annotations are on the page of their parent, already accepted
+    if (!mGroupByCurrentPage || sourceParent.isValid())
         return true;
 
     const QModelIndex pageIndex = sourceModel()->index(row, 0, sourceParent);
@@ -65,7 +64,13 @@ bool PageFilterProxyModel::filterAcceptsRow(int row, const QModelIndex &sourcePa
 PageGroupProxyModel::PageGroupProxyModel(QObject *parent)
     : QAbstractProxyModel(parent)
     , mGroupByPage(false)
+    , mOffsets(1, 0)
+{
+}
+
+PageGroupProxyModel::~PageGroupProxyModel()
 {
+    qDeleteAll(mPages);
 }
 
 int PageGroupProxyModel::columnCount(const QModelIndex &parentIndex) const
@@ -97,14 +102,14 @@ int PageGroupProxyModel::rowCount(const QModelIndex &parentIndex) const
             if (parentIndex.parent().isValid())
                 return 0;
             else {
-                return mTreeIndexes[parentIndex.row()].second.count(); // second-level
+                return sourceModel()->rowCount(mapToSource(parentIndex)); // second-level
             }
         } else {
-            return mTreeIndexes.count(); // top-level
+            return mPages.count(); // top-level
         }
     } else {
         if (!parentIndex.isValid()) // top-level
-            return mIndexes.count();
+            return mOffsets.last();
         else
             return 0;
     }
@@ -117,19 +122,21 @@ QModelIndex PageGroupProxyModel::index(int row, int column, const QModelIndex &p
 
     if (mGroupByPage) {
         if (parentIndex.isValid()) {
-            if (parentIndex.row() >= 0 && parentIndex.row() < mTreeIndexes.count() && row < mTreeIndexes[parentIndex.row()].second.count())
-                return createIndex(row, column, qint32(parentIndex.row() + 1));
-            else
-                return QModelIndex();
+            if (!parentIndex.internalPointer() && parentIndex.row() < mPages.count()) {
+                QPersistentModelIndex *page = mPages.at(parentIndex.row());
+                if (row < sourceModel()->rowCount(*page))
+                    return createIndex(row, column, page);
+            }
+            return QModelIndex();
         } else {
-            if (row < mTreeIndexes.count())
+            if (row < mPages.count())
                 return createIndex(row, column);
             else
                 return QModelIndex();
         }
     } else {
-        if (row < mIndexes.count())
-            return createIndex(row, column, mixIndex(parentIndex.row(), parentIndex.column()));
+        if (!parentIndex.isValid() && row < mOffsets.last())
+            return createIndex(row, column);
         else
             return QModelIndex();
     }
@@ -138,10 +145,11 @@ QModelIndex PageGroupProxyModel::index(int row, int column, const QModelIndex &p
 QModelIndex PageGroupProxyModel::parent(const QModelIndex &idx) const
 {
     if (mGroupByPage) {
-        if (idx.internalId() == 0) // top-level
+        const QPersistentModelIndex *page = static_cast<const QPersistentModelIndex *>(idx.internalPointer());
+        if (!page) // top-level
             return QModelIndex();
         else
-            return index(idx.internalId() - 1, idx.column());
+            return index(page->row(), idx.column());
     } else {
         // We have only top-level items
         return QModelIndex();
@@ -150,19 +158,22 @@ QModelIndex PageGroupProxyModel::parent(const QModelIndex &idx) const
 
 QModelIndex PageGroupProxyModel::mapFromSource(const QModelIndex &sourceIndex) const
 {
+    if (!sourceIndex.isValid())
+        return QModelIndex();
+
+    const QModelIndex sourceParent = sourceIndex.parent();
     if (mGroupByPage) {
-        if (sourceIndex.parent().isValid()) {
-            return index(sourceIndex.row(), sourceIndex.column(), sourceIndex.parent());
+        if (sourceParent.isValid()) {
+            return index(sourceIndex.row(), sourceIndex.column(), index(sourceParent.row(), 0));
         } else {
             return index(sourceIndex.row(), sourceIndex.column());
         }
     } else {
-        for (int i = 0; i < mIndexes.count(); ++i) {
-            if (mIndexes[i] == sourceIndex)
-                return index(i, 0);
-        }
+        // only the annotations are in the list
+        if (!sourceParent.isValid() || sourceParent.parent().isValid() || sourceParent.row() + 1 >= mOffsets.count())
+            return QModelIndex();
 
-        return QModelIndex();
+        return index(mOffsets.at(sourceParent.row()) + sourceIndex.row(), 0);
     }
 }
 
@@ -172,22 +183,22 @@ QModelIndex PageGroupProxyModel::mapToSource(const QModelIndex &proxyIndex) cons
         return QModelIndex();
 
     if (mGroupByPage) {
-        if (proxyIndex.internalId() == 0) {
-            if (proxyIndex.row() >= mTreeIndexes.count() || proxyIndex.row() < 0)
+        const QPersistentModelIndex *page = static_cast<const QPersistentModelIndex *>(proxyIndex.internalPointer());
+        if (!page) {
+            if (proxyIndex.row() >= mPages.count() || proxyIndex.row() < 0)
                 return QModelIndex();
 
-            return mTreeIndexes[proxyIndex.row()].first;
+            return *mPages.at(proxyIndex.row());
         } else {
-            if (qint32(proxyIndex.internalId()) - 1 >= mTreeIndexes.count() || proxyIndex.row() >= mTreeIndexes[proxyIndex.internalId() - 1].second.count())
-                return QModelIndex();
-
-            return mTreeIndexes[proxyIndex.internalId() - 1].second[proxyIndex.row()];
+            return sourceModel()->index(proxyIndex.row(), 0, *page);
         }
     } else {
-        if (proxyIndex.column() > 0 || proxyIndex.row() >= mIndexes.count())
+        if (proxyIndex.column() > 0 || proxyIndex.row() >= mOffsets.last())
             return QModelIndex();
         else {
-            return mIndexes[proxyIndex.row()];
+            // the last page whose annotations start at or before the row
+            const int page = std::upper_bound(mOffsets.constBegin(), mOffsets.constEnd(), proxyIndex.row()) - mOffsets.constBegin() - 1;
+            return sourceModel()->index(proxyIndex.row() - mOffsets.at(page), 0, sourceModel()->index(page, 0));
         }
     }
 }
@@ -197,8 +208,10 @@ void PageGroupProxyModel::setSourceModel(QAbstractItemModel *model)
     if (sourceModel()) {
         disconnect(sourceModel(), &QAbstractItemModel::layoutChanged, this, &PageGroupProxyModel::rebuildIndexes);
         disconnect(sourceModel(), &QAbstractItemModel::modelReset, this, &PageGroupProxyModel::rebuildIndexes);
-        disconnect(sourceModel(), &QAbstractItemModel::rowsInserted, this, &PageGroupProxyModel::rebuildIndexes);
-        disconnect(sourceModel(), &QAbstractItemModel::rowsRemoved, this, &PageGroupProxyModel::rebuildIndexes);
+        disconnect(sourceModel(), &QAbstractItemModel::rowsAboutToBeInserted, this, &PageGroupProxyModel::sourceRowsAboutToBeInserted);
+        disconnect(sourceModel(), &QAbstractItemModel::rowsInserted, this, &PageGroupProxyModel::sourceRowsInserted);
+        disconnect(sourceModel(), &QAbstractItemModel::rowsAboutToBeRemoved, this, &PageGroupProxyModel::sourceRowsAboutToBeRemoved);
+        disconnect(sourceModel(), &QAbstractItemModel::rowsRemoved, this, &PageGroupProxyModel::sourceRowsRemoved);
         disconnect(sourceModel(), &QAbstractItemModel::dataChanged, this, &PageGroupProxyModel::sourceDataChanged);
     }
 
@@ -206,8 +219,10 @@ void PageGroupProxyModel::setSourceModel(QAbstractItemModel *model)
 
     connect(sourceModel(), &QAbstractItemModel::layoutChanged, this, &PageGroupProxyModel::rebuildIndexes);
     connect(sourceModel(), &QAbstractItemModel::modelReset, this, &PageGroupProxyModel::rebuildIndexes);
-    connect(sourceModel(), &QAbstractItemModel::rowsInserted, this, &PageGroupProxyModel::rebuildIndexes);
-    connect(sourceModel(), &QAbstractItemModel::rowsRemoved, this, &PageGroupProxyModel::rebuildIndexes);
+    connect(sourceModel(), &QAbstractItemModel::rowsAboutToBeInserted, this, &PageGroupProxyModel::sourceRowsAboutToBeInserted);
+    connect(sourceModel(), &QAbstractItemModel::rowsInserted, this, &PageGroupProxyModel::sourceRowsInserted);
+    connect(sourceModel(), &QAbstractItemModel::rowsAboutToBeRemoved, this, &PageGroupProxyModel::sourceRowsAboutToBeRemoved);
+    connect(sourceModel(), &QAbstractItemModel::rowsRemoved, this, &PageGroupProxyModel::sourceRowsRemoved);
     connect(sourceModel(), &QAbstractItemModel::dataChanged, this, &PageGroupProxyModel::sourceDataChanged);
 
     rebuildIndexes();
@@ -217,36 +232,141 @@ void PageGroupProxyModel::rebuildIndexes()
 {
     beginResetModel();
 
-    if (mGroupByPage) {
-        mTreeIndexes.clear();
+    // the annotations of the old pages point to them until the reset is over
+    const QList<QPersistentModelIndex *> oldPages = mPages;
+    mPages.clear();
+    mOffsets = QVector<int>(1, 0);
 
+    if (mGroupByPage) {
+        for (int row = 0; row < sourceModel()->rowCount(); ++row) {
+            mPages.append(new QPersistentModelIndex(sourceModel()->index(row, 0)));
+        }
+    } else {
         for (int row = 0; row < sourceModel()->rowCount(); ++row) {
             const QModelIndex pageIndex = sourceModel()->index(row, 0);
+            mOffsets.append(mOffsets.last() + sourceModel()->rowCount(pageIndex));
+        }
+    }
+
+    endResetModel();
+
+    qDeleteAll(oldPages);
+}
 
-            QList<QModelIndex> itemIndexes;
-            for (int subRow = 0; subRow < sourceModel()->rowCount(pageIndex); ++subRow) {
-                itemIndexes.append(sourceModel()->index(subRow, 0, pageIndex));
+void PageGroupProxyModel::listRows(const QModelIndex &sourceParent, int first, int last, int *start, int *end) const
+{
+    *start = *end = 0;
+    if (!sourceParent.isValid()) {
+        // whole pages
+        if (last + 1 < mOffsets.count()) {
+            *start = mOffsets.at(first);
+            *end = mOffsets.at(last + 1);
+        }
+    } else if (!sourceParent.parent().isValid() && sourceParent.row() + 1 < mOffsets.count()) {
+        // annotations of a page
+        *start = mOffsets.at(sourceParent.row()) + first;
+        *end = mOffsets.at(sourceParent.row()) + last + 1;
+    }
+}
+
+void PageGroupProxyModel::sourceRowsAboutToBeInserted(const QModelIndex &parentIndex, int first, int last)
+{
+    if (mGroupByPage)
+        beginInsertRows(mapFromSource(parentIndex), first, last);
+}
+
+void PageGroupProxyModel::sourceRowsInserted(const QModelIndex &parentIndex, int first, int last)
+{
+    if (mGroupByPage) {
+        if (!parentIndex.isValid()) {
+            for (int row = first; row <= last; ++row) {
+                mPages.insert(row, new QPersistentModelIndex(sourceModel()->index(row, 0)));
             }
+        }
+        endInsertRows();
+        return;
+    }
 
-            mTreeIndexes.append(QPair<QModelIndex, QList<QModelIndex>>(pageIndex, itemIndexes));
+    if (!parentIndex.isValid()) {
+        // new pages, the list gets all their annotations
+        const int start = mOffsets.value(first, mOffsets.last());
+        QVector<int> offsets;
+        offsets.reserve(last - first + 1);
+        int end = start;
+        for (int row = first; row <= last; ++row) {
+            end += sourceModel()->rowCount(sourceModel()->index(row, 0));
+            offsets.append(end);
         }
-    } else {
-        mIndexes.clear();
 
-        for (int row = 0; row < sourceModel()->rowCount(); ++row) {
-            const QModelIndex pageIndex = sourceModel()->index(row, 0);
-            for (int subRow = 0; subRow < sourceModel()->rowCount(pageIndex); ++subRow) {
-                mIndexes.append(sourceModel()->index(subRow, 0, pageIndex));
+        if (end > start)
+            beginInsertRows(QModelIndex(), start, end - 1);
+        for (int i = 0; i < offsets.count(); ++i)
+            mOffsets.insert(first + 1 + i, offsets.at(i));
+        for (int i = last + 2; i < mOffsets.count(); ++i)
+            mOffsets[i] += end - start;
+        if (end > start)
+            endInsertRows();
+    } else if (!parentIndex.parent().isValid() && parentIndex.row() + 1 < mOffsets.count()) {
+        // new annotations of a page
+        const int start = mOffsets.at(parentIndex.row()) + first;
+        beginInsertRows(QModelIndex(), start, start + last - first);
+        for (int i = parentIndex.row() + 1; i < mOffsets.count(); ++i)
+            mOffsets[i] += last - first + 1;
+        endInsertRows();
+    }
+}
+
+void PageGroupProxyModel::sourceRowsAboutToBeRemoved(const QModelIndex &parentIndex, int first, int last)
+{
+    if (mGroupByPage) {
+        beginRemoveRows(mapFromSource(parentIndex), first, last);
+        return;
+    }
+
+    int start, end;
+    listRows(parentIndex, first, last, &start, &end);
+    if (end > start)
+        beginRemoveRows(QModelIndex(), start, end - 1);
+}
+
+void PageGroupProxyModel::sourceRowsRemoved(const QModelIndex &parentIndex, int first, int last)
+{
+    if (mGroupByPage) {
+        QList<QPersistentModelIndex *> removedPages;
+        if (!parentIndex.isValid()) {
+            for (int row = last; row >= first; --row) {
+                removedPages.append(mPages.takeAt(row));
             }
         }
+        endRemoveRows();
+        qDeleteAll(removedPages);
+        return;
     }
 
-    endResetModel();
+    // the offsets are still the ones the removal began with
+    int start, end;
+    listRows(parentIndex, first, last, &start, &end);
+    int from = mOffsets.count();
+    if (!parentIndex.isValid()) {
+        if (last + 1 < mOffsets.count()) {
+            mOffsets.remove(first + 1, last - first + 1);
+            from = first + 1;
+        }
+    } else if (!parentIndex.parent().isValid()) {
+        from = parentIndex.row() + 1;
+    }
+    for (int i = from; i < mOffsets.count(); ++i)
+        mOffsets[i] -= end - start;
+    if (end > start)
+        endRemoveRows();
 }
 
 void PageGroupProxyModel::sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
 {
-    emit dataChanged(mapFromSource(topLeft), mapFromSource(bottomRight), roles);
+    const QModelIndex proxyTopLeft = mapFromSource(topLeft);
+    const QModelIndex proxyBottomRight = mapFromSource(bottomRight);
+    if (proxyTopLeft.isValid() && proxyBottomRight.isValid())
+        emit dataChanged(proxyTopLeft, proxyBottomRight, roles);
 }
 
 void PageGroupProxyModel::groupByPage(bool value)
@@ -283,6 +403,14 @@ public:
     {
         mChilds.append(child);
     }
+    void insertChild(int row, AuthorGroupItem *child)
+    {
+        mChilds.insert(row, child);
+    }
+    AuthorGroupItem *takeChild(int row)
+    {
+        return mChilds.takeAt(row);
+    }
     AuthorGroupItem *parent() const
     {
         return mParent;
@@ -308,20 +436,30 @@ public:
             mChilds[i]->dump(level + 2);
     }
 
-    const AuthorGroupItem *findIndex(const QModelIndex &index) const
+    AuthorGroupItem *findAuthor(const QString &author) const
     {
-        if (index == mIndex)
-            return this;
-
-        for (int i = 0; i < mChilds.count(); ++i) {
-            const AuthorGroupItem *item = mChilds[i]->findIndex(index);
-            if (item)
-                return item;
+        for (AuthorGroupItem *child : mChilds) {
+            if (child->mType == Author && child->mAuthor == author)
+                return child;
         }
 
         return nullptr;
     }
 
+    /**
+     * The row where @p child goes: its source index is after the ones of
+     * the children before it, the authors go last.
+     */
+    int insertionRow(const AuthorGroupItem *child) const
+    {
+        if (!child->mIndex.isValid())
+            return mChilds.count();
+
+        const int sourceRow = child->mIndex.row();
+        const auto it = std::lower_bound(mChilds.constBegin(), mChilds.constEnd(), sourceRow, [](const AuthorGroupItem *item, int row) { return item->mIndex.isValid() && item->mIndex.row() < row; });
+        return it - mChilds.constBegin();
+    }
+
     int row() const
     {
         return (mParent ? mParent->mChilds.indexOf(const_cast<AuthorGroupItem *>(this)) : 0);
@@ -335,6 +473,10 @@ public:
     {
         return mIndex;
     }
+    const QPersistentModelIndex &persistentIndex() const
+    {
+        return mIndex;
+    }
 
     void setAuthor(const QString &author)
     {
@@ -348,7 +490,8 @@ public:
 private:
     AuthorGroupItem *mParent;
     Type mType;
-    QModelIndex mIndex;
+    // follows the source through its inserts and removes
+    QPersistentModelIndex mIndex;
     QList<AuthorGroupItem *> mChilds;
     QString mAuthor;
 };
@@ -367,11 +510,99 @@ public:
         delete mRoot;
     }
 
+    AuthorGroupItem *createItem(AuthorGroupItem *parent, AuthorGroupItem::Type type, const QModelIndex &index = QModelIndex());
+    QModelIndex indexForItem(AuthorGroupItem *item) const;
+    void insertItem(AuthorGroupItem *parent, AuthorGroupItem *item, bool notify);
+    void addSourceIndex(AuthorGroupItem *parent, const QModelIndex &index, bool notify);
+    void removeItem(AuthorGroupItem *item);
+    void forgetItem(const AuthorGroupItem *item);
+
     AuthorGroupProxyModel *mParent;
     AuthorGroupItem *mRoot;
     bool mGroupByAuthor;
+    // the items of the source indexes, pages and annotations
+    QHash<QPersistentModelIndex, AuthorGroupItem *> mItems;
 };
 
+AuthorGroupItem *AuthorGroupProxyModel::Private::createItem(AuthorGroupItem *parent, AuthorGroupItem::Type type, const QModelIndex &index)
+{
+    AuthorGroupItem *item = new AuthorGroupItem(parent, type, index);
+    if (index.isValid())
+        mItems.insert(item->persistentIndex(), item);
+    return item;
+}
+
+QModelIndex AuthorGroupProxyModel::Private::indexForItem(AuthorGroupItem *item) const
+{
+    if (item == mRoot)
+        return QModelIndex();
+
+    return mParent->createIndex(item->row(), 0, item);
+}
+
+void AuthorGroupProxyModel::Private::insertItem(AuthorGroupItem *parent, AuthorGroupItem *item, bool notify)
+{
+    const int row = parent->insertionRow(item);
+    if (notify)
+        mParent->beginInsertRows(indexForItem(parent), row, row);
+    parent->insertChild(row, item);
+    if (notify)
+        mParent->endInsertRows();
+}
+
+void AuthorGroupProxyModel::Private::addSourceIndex(AuthorGroupItem *parent, const QModelIndex &index, bool notify)
+{
+    QAbstractItemModel *model = mParent->sourceModel();
+    const QString author = model->data(index, AnnotationModel::AuthorRole).toString();
+    if (parent == mRoot && author.isEmpty()) {
+        // We have the pages as top-level, so we use them as top-level, with the
+        // annotations under them, grouped by author if asked so
+        AuthorGroupItem *pageItem = createItem(mRoot, AuthorGroupItem::Page, index);
+        for (int subRow = 0; subRow < model->rowCount(index); ++subRow) {
+            addSourceIndex(pageItem, model->index(subRow, 0, index), false);
+        }
+        insertItem(mRoot, pageItem, notify);
+    } else if (mGroupByAuthor) {
+        // We have the annotations as top-level or under a page, so introduce
+        // the authors there and put the annotations under them
+        AuthorGroupItem *authorItem = parent->findAuthor(author);
+        if (!authorItem) {
+            authorItem = createItem(parent, AuthorGroupItem::Author);
+            authorItem->setAuthor(author);
+            authorItem->appendChild(createItem(authorItem, AuthorGroupItem::Annotation, index));
+            insertItem(parent, authorItem, notify);
+        } else {
+            insertItem(authorItem, createItem(authorItem, AuthorGroupItem::Annotation, index), notify);
+        }
+    } else {
+        insertItem(parent, createItem(parent, AuthorGroupItem::Annotation, index), notify);
+    }
+}
+
+void AuthorGroupProxyModel::Private::removeItem(AuthorGroupItem *item)
+{
+    AuthorGroupItem *parent = item->parent();
+    const int row = item->row();
+    mParent->beginRemoveRows(indexForItem(parent), row, row);
+    parent->takeChild(row);
+    mParent->endRemoveRows();
+    forgetItem(item);
+    delete item;
+
+    // no annotations left by the author
+    if (parent->type() == AuthorGroupItem::Author && parent->childCount() == 0)
+        removeItem(parent);
+}
+
+void AuthorGroupProxyModel::Private::forgetItem(const AuthorGroupItem *item)
+{
+    if (item->index().isValid())
+        mItems.remove(item->persistentIndex());
+
+    for (int i = 0; i < item->childCount(); ++i)
+        forgetItem(item->child(i));
+}
+
 AuthorGroupProxyModel::AuthorGroupProxyModel(QObject *parent)
     : QAbstractProxyModel(parent)
     , d(new Private(this))
@@ -436,11 +667,11 @@ QModelIndex AuthorGroupProxyModel::mapFromSource(const QModelIndex &sourceIndex)
     if (!sourceIndex.isValid())
         return QModelIndex();
 
-    const AuthorGroupItem *item = d->mRoot->findIndex(sourceIndex);
+    AuthorGroupItem *item = d->mItems.value(sourceIndex);
     if (!item)
         return QModelIndex();
 
-    return createIndex(item->row(), 0, const_cast<AuthorGroupItem *>(item));
+    return createIndex(item->row(), 0, item);
 }
 
 QModelIndex AuthorGroupProxyModel::mapToSource(const QModelIndex &proxyIndex) const
@@ -458,8 +689,8 @@ void AuthorGroupProxyModel::setSourceModel(QAbstractItemModel *model)
     if (sourceModel()) {
         disconnect(sourceModel(), &QAbstractItemModel::layoutChanged, this, &AuthorGroupProxyModel::rebuildIndexes);
         disconnect(sourceModel(), &QAbstractItemModel::modelReset, this, &AuthorGroupProxyModel::rebuildIndexes);
-        disconnect(sourceModel(), &QAbstractItemModel::rowsInserted, this, &AuthorGroupProxyModel::rebuildIndexes);
-        disconnect(sourceModel(), &QAbstractItemModel::rowsRemoved, this, &AuthorGroupProxyModel::rebuildIndexes);
+        disconnect(sourceModel(), &QAbstractItemModel::rowsInserted, this, &AuthorGroupProxyModel::sourceRowsInserted);
+        disconnect(sourceModel(), &QAbstractItemModel::rowsAboutToBeRemoved, this, &AuthorGroupProxyModel::sourceRowsAboutToBeRemoved);
         disconnect(sourceModel(), &QAbstractItemModel::dataChanged, this, &AuthorGroupProxyModel::sourceDataChanged);
     }
 
@@ -467,8 +698,8 @@ void AuthorGroupProxyModel::setSourceModel(QAbstractItemModel *model)
 
     connect(sourceModel(), &QAbstractItemModel::layoutChanged, this, &AuthorGroupProxyModel::rebuildIndexes);
     connect(sourceModel(), &QAbstractItemModel::modelReset, this, &AuthorGroupProxyModel::rebuildIndexes);
-    connect(sourceModel(), &QAbstractItemModel::rowsInserted, this, &AuthorGroupProxyModel::rebuildIndexes);
-    connect(sourceModel(), &QAbstractItemModel::rowsRemoved, this, &AuthorGroupProxyModel::rebuildIndexes);
+    connect(sourceModel(), &QAbstractItemModel::rowsInserted, this, &AuthorGroupProxyModel::sourceRowsInserted);
+    connect(sourceModel(), &QAbstractItemModel::rowsAboutToBeRemoved, this, &AuthorGroupProxyModel::sourceRowsAboutToBeRemoved);
     connect(sourceModel(), &QAbstractItemModel::dataChanged, this, &AuthorGroupProxyModel::sourceDataChanged);
 
     rebuildIndexes();
@@ -549,89 +780,60 @@ void AuthorGroupProxyModel::rebuildIndexes()
 {
     beginResetModel();
     delete d->mRoot;
+    d->mItems.clear();
     d->mRoot = new AuthorGroupItem(nullptr);
 
-    if (d->mGroupByAuthor) {
-        QMap<QString, AuthorGroupItem *> authorMap;
-
-        for (int row = 0; row < sourceModel()->rowCount(); ++row) {
-            const QModelIndex idx = sourceModel()->index(row, 0);
-            const QString author = sourceModel()->data(idx, AnnotationModel::AuthorRole).toString();
-            if (!author.isEmpty()) {
-                // We have the annotations as top-level, so introduce authors as new
-                // top-levels and append the annotations
-                AuthorGroupItem *authorItem = authorMap.value(author, nullptr);
-                if (!authorItem) {
-                    authorItem = new AuthorGroupItem(d->mRoot, AuthorGroupItem::Author);
-                    authorItem->setAuthor(author);
-
-                    // Add item to tree
-                    d->mRoot->appendChild(authorItem);
-
-                    // Insert to lookup list
-                    authorMap.insert(author, authorItem);
-                }
-
-                AuthorGroupItem *item = new AuthorGroupItem(authorItem, AuthorGroupItem::Annotation, idx);
-                authorItem->appendChild(item);
-            } else {
-                // We have the pages as top-level, so we use them as top-level, append the
-                // authors for all annotations of the page, and then the annotations themself
-                AuthorGroupItem *pageItem = new AuthorGroupItem(d->mRoot, AuthorGroupItem::Page, idx);
-                d->mRoot->appendChild(pageItem);
-
-                // First collect all authors...
-                QMap<QString, AuthorGroupItem *> pageAuthorMap;
-                for (int subRow = 0; subRow < sourceModel()->rowCount(idx); ++subRow) {
-                    const QModelIndex annIdx = sourceModel()->index(subRow, 0, idx);
-                    const QString author = sourceModel()->data(annIdx, AnnotationModel::AuthorRole).toString();
-
-                    AuthorGroupItem *authorItem = pageAuthorMap.value(author, nullptr);
-                    if (!authorItem) {
-                        authorItem = new AuthorGroupItem(pageItem, AuthorGroupItem::Author);
-                        authorItem->setAuthor(author);
-
-                        // Add item to tree
-                        pageItem->appendChild(authorItem);
-
-                        // Insert to lookup list
-                        pageAuthorMap.insert(author, authorItem);
-                    }
-
-                    AuthorGroupItem *item = new AuthorGroupItem(authorItem, AuthorGroupItem::Annotation, annIdx);
-                    authorItem->appendChild(item);
-                }
-            }
-        }
-    } else {
-        for (int row = 0; row < sourceModel()->rowCount(); ++row) {
-            const QModelIndex idx = sourceModel()->index(row, 0);
-            const QString author = sourceModel()->data(idx, AnnotationModel::AuthorRole).toString();
-            if (!author.isEmpty()) {
-                // We have the annotations as top-level items
-                AuthorGroupItem *item = new AuthorGroupItem(d->mRoot, AuthorGroupItem::Annotation, idx);
-                d->mRoot->appendChild(item);
-            } else {
-                // We have the pages as top-level items
-                AuthorGroupItem *pageItem = new AuthorGroupItem(d->mRoot, AuthorGroupItem::Page, idx);
-                d->mRoot->appendChild(pageItem);
-
-                // Append all annotations as second-level
-                for (int subRow = 0; subRow < sourceModel()->rowCount(idx); ++subRow) {
-                    const QModelIndex subIdx = sourceModel()->index(subRow, 0, idx);
-                    AuthorGroupItem *item = new AuthorGroupItem(pageItem, AuthorGroupItem::Annotation, subIdx);
-                    pageItem->appendChild(item);
-                }
-            }
-        }
+    for (int row = 0; row < sourceModel()->rowCount(); ++row) {
+        d->addSourceIndex(d->mRoot, sourceModel()->index(row, 0), false);
     }
 
     endResetModel();
 }
 
+void AuthorGroupProxyModel::sourceRowsInserted(const QModelIndex &parentIndex, int first, int last)
+{
+    // the root is a page item too, the annotations have no children
+    AuthorGroupItem *parentItem = parentIndex.isValid() ? d->mItems.value(parentIndex) : d->mRoot;
+    if (!parentItem || parentItem->type() != AuthorGroupItem::Page)
+        return;
+
+    for (int row = first; row <= last; ++row) {
+        d->addSourceIndex(parentItem, sourceModel()->index(row, 0, parentIndex), true);
+    }
+}
+
+void AuthorGroupProxyModel::sourceRowsAboutToBeRemoved(const QModelIndex &parentIndex, int first, int last)
+{
+    // gone before the source removes them, their groups with them if empty
+    for (int row = last; row >= first; --row) {
+        if (AuthorGroupItem *item = d->mItems.value(sourceModel()->index(row, 0, parentIndex)))
+            d->removeItem(item);
+    }
+}
+
 void AuthorGroupProxyModel::sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
 {
-    emit dataChanged(mapFromSource(topLeft), mapFromSource(bottomRight), roles);
+    const QModelIndex sourceParent = topLeft.parent();
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const QModelIndex sourceIndex = sourceModel()->index(row, 0, sourceParent);
+        AuthorGroupItem *item = d->mItems.value(sourceIndex);
+        if (!item)
+            continue;
+
+        // a new author moves the annotation to the group of that author
+        AuthorGroupItem *authorItem = item->parent();
+        if (authorItem->type() == AuthorGroupItem::Author && (roles.isEmpty() || roles.contains(AnnotationModel::AuthorRole))) {
+            if (authorItem->author() != sourceModel()->data(sourceIndex, AnnotationModel::AuthorRole).toString()) {
+                AuthorGroupItem *groupParent = authorItem->parent();
+                d->removeItem(item);
+                d->addSourceIndex(groupParent, sourceIndex, true);
+                continue;
+            }
+        }
+
+        const QModelIndex proxyIndex = createIndex(item->row(), 0, item);
+        emit dataChanged(proxyIndex, proxyIndex, roles);
+    }
 }
 
 #include "moc_annotationproxymodels.cpp"
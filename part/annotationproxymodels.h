@@ -7,8 +7,9 @@
 #ifndef ANNOTATIONPROXYMODEL_H
 #define ANNOTATIONPROXYMODEL_H
 
-#include <QPair>
+#include <QPersistentModelIndex>
 #include <QSortFilterProxyModel>
+#include <QVector>
 
 /**
  * A proxy model, which filters out all pages except the
@@ -63,6 +64,7 @@ public:
      * @param parent The parent object.
      */
     explicit PageGroupProxyModel(QObject *parent = nullptr);
+    ~PageGroupProxyModel() override;
 
     int columnCount(const QModelIndex &parentIndex) const override;
     int rowCount(const QModelIndex &parentIndex) const override;
@@ -85,11 +87,25 @@ public Q_SLOTS:
 private Q_SLOTS:
     void rebuildIndexes();
     void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+    void sourceRowsAboutToBeInserted(const QModelIndex &parentIndex, int first, int last);
+    void sourceRowsInserted(const QModelIndex &parentIndex, int first, int last);
+    void sourceRowsAboutToBeRemoved(const QModelIndex &parentIndex, int first, int last);
+    void sourceRowsRemoved(const QModelIndex &parentIndex, int first, int last);
 
 private:
+    /**
+     * The rows of the list the annotations of the source rows @p first to
+     * @p last of @p sourceParent take, from @p start to before @p end.
+     */
+    void listRows(const QModelIndex &sourceParent, int first, int last, int *start, int *end) const;
+
     bool mGroupByPage;
-    QList<QModelIndex> mIndexes;
-    QList<QPair<QModelIndex, QList<QModelIndex>>> mTreeIndexes;
+    // grouped by page: the pages of the source, the internal pointer of the
+    // indexes of their annotations
+    QList<QPersistentModelIndex *> mPages;
+    // as list: the number of annotations before each page of the source, and
+    // the total after the last one
+    QVector<int> mOffsets;
 };
 
 /**
@@ -135,6 +151,8 @@ public Q_SLOTS:
 private Q_SLOTS:
     void rebuildIndexes();
     void sourceDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+    void sourceRowsInserted(const QModelIndex &parentIndex, int first, int last);
+    void sourceRowsAboutToBeRemoved(const QModelIndex &parentIndex, int first, int last);
 
 private:
     class Private;
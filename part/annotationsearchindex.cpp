@@ -0,0 +1,159 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "annotationsearchindex.h"
+
+#include <QRegularExpression>
+#include <QStringList>
+
+#include "annotationmodel.h"
+#include "core/textsearchindex_p.h"
+
+AnnotationSearchIndex::AnnotationSearchIndex(AnnotationModel *model, QObject *parent)
+    : QObject(parent)
+    , m_model(model)
+    , m_matchesValid(false)
+    , m_caseSensitivity(Qt::CaseInsensitive)
+    , m_regularExpression(false)
+{
+    connect(model, &QAbstractItemModel::rowsInserted, this, &AnnotationSearchIndex::addItems);
+    connect(model, &QAbstractItemModel::rowsAboutToBeRemoved, this, &AnnotationSearchIndex::removeItems);
+    connect(model, &QAbstractItemModel::dataChanged, this, &AnnotationSearchIndex::updateItems);
+    connect(model, &QAbstractItemModel::modelReset, this, &AnnotationSearchIndex::rebuild);
+
+    rebuild();
+}
+
+AnnotationSearchIndex::~AnnotationSearchIndex()
+{
+}
+
+bool AnnotationSearchIndex::matches(const QModelIndex &index, const QString &pattern, Qt::CaseSensitivity caseSensitivity, bool regularExpression) const
+{
+    if (pattern.isEmpty())
+        return true;
+
+    if (!m_matchesValid || pattern != m_pattern || caseSensitivity != m_caseSensitivity || regularExpression != m_regularExpression) {
+        m_pattern = pattern;
+        m_caseSensitivity = caseSensitivity;
+        m_regularExpression = regularExpression;
+        m_matches.clear();
+
+        if (regularExpression) {
+            const QRegularExpression re(pattern, caseSensitivity == Qt::CaseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+            for (auto it = m_texts.constBegin(); it != m_texts.constEnd(); ++it) {
+                if (it.value().contains(re))
+                    m_matches.insert(it.key());
+            }
+        } else {
+            // the first and last words of the pattern may be just the end and
+            // the start of a word of the text, so look inside all of them
+            const QStringList patternWords = Okular::TextSearchIndex::words(pattern);
+            QSet<quintptr> candidates;
+            bool first = true;
+            for (const QString &patternWord : patternWords) {
+                QSet<quintptr> wordItems;
+                for (auto it = m_postings.constBegin(); it != m_postings.constEnd(); ++it) {
+                    if (it.key().contains(patternWord))
+                        wordItems.unite(it.value());
+                }
+                if (first)
+                    candidates = wordItems;
+                else
+                    candidates.intersect(wordItems);
+                first = false;
+                if (candidates.isEmpty())
+                    break;
+            }
+            // only punctuation, no words to rule anything out
+            if (patternWords.isEmpty()) {
+                for (auto it = m_texts.constBegin(); it != m_texts.constEnd(); ++it)
+                    candidates.insert(it.key());
+            }
+
+            for (const quintptr item : qAsConst(candidates)) {
+                if (m_texts.value(item).contains(pattern, caseSensitivity))
+                    m_matches.insert(item);
+            }
+        }
+        m_matchesValid = true;
+    }
+
+    return m_matches.contains(index.internalId());
+}
+
+void AnnotationSearchIndex::addItems(const QModelIndex &parent, int first, int last)
+{
+    for (int row = first; row <= last; ++row) {
+        const QModelIndex index = m_model->index(row, 0, parent);
+        if (m_model->isAnnotation(index))
+            addItem(index.internalId(), index.data(AnnotationModel::SearchTextRole).toString());
+        // a page branch may come with its annotations
+        if (m_model->rowCount(index) > 0)
+            addItems(index, 0, m_model->rowCount(index) - 1);
+    }
+}
+
+void AnnotationSearchIndex::removeItems(const QModelIndex &parent, int first, int last)
+{
+    for (int row = first; row <= last; ++row) {
+        const QModelIndex index = m_model->index(row, 0, parent);
+        removeItem(index.internalId());
+        if (m_model->rowCount(index) > 0)
+            removeItems(index, 0, m_model->rowCount(index) - 1);
+    }
+}
+
+void AnnotationSearchIndex::updateItems(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    const QModelIndex parent = topLeft.parent();
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const QModelIndex index = m_model->index(row, 0, parent);
+        if (!m_model->isAnnotation(index))
+            continue;
+
+        removeItem(index.internalId());
+        addItem(index.internalId(), index.data(AnnotationModel::SearchTextRole).toString());
+    }
+}
+
+void AnnotationSearchIndex::rebuild()
+{
+    m_texts.clear();
+    m_postings.clear();
+    m_matchesValid = false;
+
+    if (m_model->rowCount() > 0)
+        addItems(QModelIndex(), 0, m_model->rowCount() - 1);
+}
+
+void AnnotationSearchIndex::addItem(quintptr item, const QString &text)
+{
+    m_texts.insert(item, text);
+    const QStringList words = Okular::TextSearchIndex::words(text);
+    for (const QString &word : words)
+        m_postings[word].insert(item);
+    m_matchesValid = false;
+}
+
+void AnnotationSearchIndex::removeItem(quintptr item)
+{
+    const auto it = m_texts.find(item);
+    if (it == m_texts.end())
+        return;
+
+    const QStringList words = Okular::TextSearchIndex::words(it.value());
+    for (const QString &word : words) {
+        auto posting = m_postings.find(word);
+        if (posting == m_postings.end())
+            continue;
+        posting->remove(item);
+        if (posting->isEmpty())
+            m_postings.erase(posting);
+    }
+    m_texts.erase(it);
+    m_matchesValid = false;
+}
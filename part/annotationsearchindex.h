@@ -0,0 +1,69 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#ifndef ANNOTATIONSEARCHINDEX_H
+#define ANNOTATIONSEARCHINDEX_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+
+class AnnotationModel;
+class QModelIndex;
+
+/**
+ * Inverted index of the words of the annotations of an AnnotationModel: their
+ * caption, author, contents and the author and contents of their replies, as
+ * given by AnnotationModel::SearchTextRole.
+ *
+ * It follows the changes of the model, so it must be connected to it before
+ * the views and proxies that search with it, see Reviews.
+ *
+ * Like the text search of the document (see Okular::TextSearchIndex) the
+ * words rule out the annotations that cannot match a search, the others are
+ * matched against their whole text. Regular expressions cannot use the
+ * words, they are matched against the text of all the annotations.
+ */
+class AnnotationSearchIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AnnotationSearchIndex(AnnotationModel *model, QObject *parent = nullptr);
+    ~AnnotationSearchIndex() override;
+
+    /**
+     * Whether the annotation of @p index, an index of the model, has
+     * @p pattern in its text. The annotations that match the last pattern are
+     * kept, so asking about all the rows of a search is cheap.
+     */
+    bool matches(const QModelIndex &index, const QString &pattern, Qt::CaseSensitivity caseSensitivity, bool regularExpression) const;
+
+private:
+    void addItems(const QModelIndex &parent, int first, int last);
+    void removeItems(const QModelIndex &parent, int first, int last);
+    void updateItems(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void rebuild();
+
+    void addItem(quintptr item, const QString &text);
+    void removeItem(quintptr item);
+
+    AnnotationModel *m_model;
+    // the items of the model, by internal id, and their text
+    QHash<quintptr, QString> m_texts;
+    // word -> the items that have it
+    QHash<QString, QSet<quintptr>> m_postings;
+
+    // the result of the last search
+    mutable bool m_matchesValid;
+    mutable QString m_pattern;
+    mutable Qt::CaseSensitivity m_caseSensitivity;
+    mutable bool m_regularExpression;
+    mutable QSet<quintptr> m_matches;
+};
+
+#endif
@@ -11,6 +11,7 @@
 #include <QCursor>
 #include <QEvent>
 #include <QMouseEvent>
+#include <QtMath>
 
 // local includes
 #include "core/annotations.h"
@@ -92,6 +93,7 @@ SmoothPath::SmoothPath(const QLinkedList<Okular::NormalizedPoint> &points, const
 SmoothPathEngine::SmoothPathEngine(const QDomElement &engineElement)
     : AnnotatorEngine(engineElement)
     , compositionMode(QPainter::CompositionMode_SourceOver)
+    , livePoints(0)
 {
     // parse engine specific attributes
     if (engineElement.attribute(QStringLiteral("compositionMode"), QStringLiteral("sourceOver")) == QLatin1String("clear"))
@@ -111,6 +113,7 @@ QRect SmoothPathEngine::event(EventType type, Button button, Modifiers /*modifie
         totalRect.left = totalRect.right = lastPoint.x;
         totalRect.top = totalRect.bottom = lastPoint.y;
         points.append(lastPoint);
+        livePoints = 0;
     }
     // add a point to the path
     else if (type == Move && points.count() > 0) {
@@ -153,11 +156,53 @@ void SmoothPathEngine::paint(QPainter *painter, double xScale, double yScale, co
     const double penWidth = m_annotElement.attribute(QStringLiteral("width"), QStringLiteral("1")).toInt();
     const qreal opacity = m_annotElement.attribute(QStringLiteral("opacity"), QStringLiteral("1.0")).toDouble();
 
-    // use engine's color for painting
-    const SmoothPath path(points, QPen(m_engineColor, penWidth), opacity, compositionMode);
+    // past this a layer costs more memory than repainting the path costs time
+    static const qint64 maxLiveLayerPixels = 4096 * 4096;
+    const qreal dpr = painter->device()->devicePixelRatioF();
+    const QSize layerSize(qCeil(xScale * dpr), qCeil(yScale * dpr));
+    if (points.count() < 2 || (qint64)layerSize.width() * layerSize.height() > maxLiveLayerPixels) {
+        // use engine's color for painting
+        const SmoothPath path(points, QPen(m_engineColor, penWidth), opacity, compositionMode);
+
+        // draw the path
+        path.paint(painter, xScale, yScale);
+        return;
+    }
+
+    if (liveLayer.size() != layerSize) {
+        liveLayer = QImage(layerSize, QImage::Format_ARGB32_Premultiplied);
+        liveLayer.setDevicePixelRatio(dpr);
+        livePoints = 0;
+    }
+    if (livePoints == 0)
+        liveLayer.fill(Qt::transparent);
+
+    // add the segments after the last point in the layer, the layer is opaque
+    // and gets the opacity as a whole, so they do not darken where they meet
+    if (livePoints < points.count()) {
+        QLinkedList<Okular::NormalizedPoint>::const_iterator pIt = livePoints ? liveLast : points.constBegin(), pEnd = points.constEnd();
+        QPainterPath path;
+        path.moveTo(QPointF(pIt->x * xScale, pIt->y * yScale));
+        for (++pIt; pIt != pEnd; ++pIt) {
+            path.lineTo(QPointF(pIt->x * xScale, pIt->y * yScale));
+        }
+
+        QPainter layerPainter(&liveLayer);
+        layerPainter.setRenderHints(painter->renderHints());
+        layerPainter.setPen(QPen(m_engineColor, penWidth, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+        layerPainter.drawPath(path);
+
+        livePoints = points.count();
+        liveLast = --points.constEnd();
+    }
 
-    // draw the path
-    path.paint(painter, xScale, yScale);
+    // the dirty rect of each move is little more than the newest segment, so
+    // with the clip of the paint event this only blends that piece
+    painter->save();
+    painter->setCompositionMode(compositionMode == QPainter::CompositionMode_Clear ? QPainter::CompositionMode_DestinationOut : compositionMode);
+    painter->setOpacity(opacity);
+    painter->drawImage(QRectF(0, 0, layerSize.width() / dpr, layerSize.height() / dpr), liveLayer);
+    painter->restore();
 }
 
 void SmoothPath::paint(QPainter *painter, double xScale, double yScale) const
@@ -7,6 +7,7 @@
 #ifndef _OKULAR_ANNOTATIONTOOLS_H_
 #define _OKULAR_ANNOTATIONTOOLS_H_
 
+#include <QImage>
 #include <QLinkedList>
 #include <QPainter>
 #include <QPen>
@@ -116,6 +117,10 @@ private:
     Okular::NormalizedRect totalRect;
     Okular::NormalizedPoint lastPoint;
     QPainter::CompositionMode compositionMode;
+    // the path painted so far, so that each paint only adds the new segments
+    QImage liveLayer;
+    int livePoints;
+    QLinkedList<Okular::NormalizedPoint>::const_iterator liveLast;
 };
 
 #endif
@@ -188,6 +188,8 @@ AnnotWindow::AnnotWindow(QWidget *parent, Okular::Annotation *annot, Okular::Doc
     , m_annot(annot)
     , m_document(document)
     , m_page(page)
+    , m_latexFontSize(0)
+    , m_renderingLatex(false)
 {
     setAutoFillBackground(true);
     setFrameStyle(Panel | Raised);
@@ -226,6 +228,11 @@ AnnotWindow::AnnotWindow(QWidget *parent, Okular::Annotation *annot, Okular::Doc
     lowerlay->addWidget(sb);
 
     m_latexRenderer = new GuiUtils::LatexRenderer();
+    connect(m_latexRenderer, &GuiUtils::LatexRenderer::formulasRendered, this, [this] {
+        if (m_renderingLatex)
+            showRenderedLatex();
+    });
+    connect(m_latexRenderer, &GuiUtils::LatexRenderer::renderingFailed, this, &AnnotWindow::slotLatexRenderingFailed);
     // The emit below is not wrong even if emitting signals from the constructor it's usually wrong
     // in this case the signal it's connected to inside MovableTitle constructor a few lines above
     emit containsLatex(GuiUtils::LatexRenderer::mightContainLatex(m_annot->contents())); // clazy:exclude=incorrect-emit
@@ -364,39 +371,13 @@ void AnnotWindow::renderLatex(bool render)
         disconnect(textEdit, &KTextEdit::textChanged, this, &AnnotWindow::slotsaveWindowText);
         disconnect(textEdit, &KTextEdit::cursorPositionChanged, this, &AnnotWindow::slotsaveWindowText);
         textEdit->setAcceptRichText(true);
-        QString contents = m_annot->contents();
-        contents = Qt::convertFromPlainText(contents);
-        QColor fontColor = textEdit->textColor();
-        int fontSize = textEdit->fontPointSize();
-        QString latexOutput;
-        GuiUtils::LatexRenderer::Error errorCode = m_latexRenderer->renderLatexInHtml(contents, fontColor, fontSize, Okular::Utils::realDpi(nullptr).width(), latexOutput);
-        switch (errorCode) {
-        case GuiUtils::LatexRenderer::LatexNotFound:
-            KMessageBox::sorry(this, i18n("Cannot find latex executable."), i18n("LaTeX rendering failed"));
-            m_title->uncheckLatexButton();
-            renderLatex(false);
-            break;
-        case GuiUtils::LatexRenderer::DvipngNotFound:
-            KMessageBox::sorry(this, i18n("Cannot find dvipng executable."), i18n("LaTeX rendering failed"));
-            m_title->uncheckLatexButton();
-            renderLatex(false);
-            break;
-        case GuiUtils::LatexRenderer::LatexFailed:
-            KMessageBox::detailedSorry(this, i18n("A problem occurred during the execution of the 'latex' command."), latexOutput, i18n("LaTeX rendering failed"));
-            m_title->uncheckLatexButton();
-            renderLatex(false);
-            break;
-        case GuiUtils::LatexRenderer::DvipngFailed:
-            KMessageBox::sorry(this, i18n("A problem occurred during the execution of the 'dvipng' command."), i18n("LaTeX rendering failed"));
-            m_title->uncheckLatexButton();
-            renderLatex(false);
-            break;
-        case GuiUtils::LatexRenderer::NoError:
-        default:
-            textEdit->setHtml(contents);
-            break;
-        }
+        // the ones of the plain text, the rendered formulas are cached with them
+        m_latexColor = textEdit->textColor();
+        m_latexFontSize = textEdit->fontPointSize();
+        m_renderingLatex = true;
+        showRenderedLatex();
     } else {
+        m_renderingLatex = false;
         textEdit->setAcceptRichText(false);
         textEdit->setPlainText(m_annot->contents());
         connect(textEdit, &KTextEdit::textChanged, this, &AnnotWindow::slotsaveWindowText);
@@ -405,6 +386,46 @@ void AnnotWindow::renderLatex(bool render)
     }
 }
 
+void AnnotWindow::showRenderedLatex()
+{
+    // the formulas not rendered yet show as their source, formulasRendered() tells when they are
+    QString contents = Qt::convertFromPlainText(m_annot->contents());
+    const GuiUtils::LatexRenderer::Error errorCode = m_latexRenderer->renderLatexInHtml(contents, m_latexColor, m_latexFontSize, Okular::Utils::realDpi(nullptr).width());
+    if (errorCode != GuiUtils::LatexRenderer::NoError) {
+        slotLatexRenderingFailed(errorCode, QString());
+        return;
+    }
+
+    textEdit->setHtml(contents);
+}
+
+void AnnotWindow::slotLatexRenderingFailed(GuiUtils::LatexRenderer::Error error, const QString &latexOutput)
+{
+    // told once, the other formulas may fail as well
+    if (!m_renderingLatex)
+        return;
+
+    switch (error) {
+    case GuiUtils::LatexRenderer::LatexNotFound:
+        KMessageBox::sorry(this, i18n("Cannot find latex executable."), i18n("LaTeX rendering failed"));
+        break;
+    case GuiUtils::LatexRenderer::DvipngNotFound:
+        KMessageBox::sorry(this, i18n("Cannot find dvipng executable."), i18n("LaTeX rendering failed"));
+        break;
+    case GuiUtils::LatexRenderer::LatexFailed:
+        KMessageBox::detailedSorry(this, i18n("A problem occurred during the execution of the 'latex' command."), latexOutput, i18n("LaTeX rendering failed"));
+        break;
+    case GuiUtils::LatexRenderer::DvipngFailed:
+        KMessageBox::sorry(this, i18n("A problem occurred during the execution of the 'dvipng' command."), i18n("LaTeX rendering failed"));
+        break;
+    case GuiUtils::LatexRenderer::NoError:
+    default:
+        return;
+    }
+    m_title->uncheckLatexButton();
+    renderLatex(false);
+}
+
 void AnnotWindow::slotHandleContentsChangedByUndoRedo(Okular::Annotation *annot, const QString &contents, int cursorPos, int anchorPos)
 {
     if (annot != m_annot) {
@@ -14,17 +14,14 @@
 #include <QColor>
 #include <QFrame>
 
+#include "latexrenderer.h"
+
 namespace Okular
 {
 class Annotation;
 class Document;
 }
 
-namespace GuiUtils
-{
-class LatexRenderer;
-}
-
 class KTextEdit;
 class MovableTitle;
 class QMenu;
@@ -53,6 +50,12 @@ private:
     int m_page;
     int m_prevCursorPos;
     int m_prevAnchorPos;
+    // how the formulas are rendered while renderLatex() is on
+    QColor m_latexColor;
+    int m_latexFontSize;
+    bool m_renderingLatex;
+
+    void showRenderedLatex();
 
 public Q_SLOTS:
     void renderLatex(bool render);
@@ -66,6 +69,7 @@ private Q_SLOTS:
     void slotOptionBtn();
     void slotsaveWindowText();
     void slotHandleContentsChangedByUndoRedo(Okular::Annotation *annot, const QString &contents, int cursorPos, int anchorPos);
+    void slotLatexRenderingFailed(GuiUtils::LatexRenderer::Error error, const QString &latexOutput);
 
 Q_SIGNALS:
     void containsLatex(bool);
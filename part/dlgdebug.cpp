@@ -7,7 +7,15 @@
 #include "dlgdebug.h"
 
 #include <QCheckBox>
+#include <QGroupBox>
+#include <QHeaderView>
 #include <QLayout>
+#include <QPushButton>
+#include <QTimer>
+#include <QTreeWidget>
+
+#include "core/document.h"
+#include "core/observer.h"
 
 #define DEBUG_SIMPLE_BOOL(cfgname, layout)                                                                                                                                                                                                     \
     {                                                                                                                                                                                                                                          \
@@ -16,15 +24,134 @@
         layout->addWidget(foo);                                                                                                                                                                                                                \
     }
 
-DlgDebug::DlgDebug(QWidget *parent)
+DlgDebug::DlgDebug(QWidget *parent, Okular::Document *document)
     : QWidget(parent)
+    , m_document(document)
+    , m_renderStatistics(nullptr)
+    , m_memoryUsage(nullptr)
 {
     QVBoxLayout *lay = new QVBoxLayout(this);
     lay->setContentsMargins(0, 0, 0, 0);
 
     DEBUG_SIMPLE_BOOL("DebugDrawBoundaries", lay);
     DEBUG_SIMPLE_BOOL("DebugDrawAnnotationRect", lay);
+    DEBUG_SIMPLE_BOOL("DebugFrameTimes", lay);
+    DEBUG_SIMPLE_BOOL("DebugLogFrameTimes", lay);
     DEBUG_SIMPLE_BOOL("TocPageColumn", lay);
 
-    lay->addItem(new QSpacerItem(5, 5, QSizePolicy::Fixed, QSizePolicy::MinimumExpanding));
+    if (!m_document) {
+        lay->addItem(new QSpacerItem(5, 5, QSizePolicy::Fixed, QSizePolicy::MinimumExpanding));
+        return;
+    }
+
+    QGroupBox *statisticsBox = new QGroupBox(QStringLiteral("Render statistics"), this);
+    QVBoxLayout *statisticsLayout = new QVBoxLayout(statisticsBox);
+    m_renderStatistics = new QTreeWidget(statisticsBox);
+    m_renderStatistics->setRootIsDecorated(false);
+    m_renderStatistics->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    statisticsLayout->addWidget(m_renderStatistics);
+    QPushButton *reset = new QPushButton(QStringLiteral("Reset"), statisticsBox);
+    connect(reset, &QPushButton::clicked, this, [this] {
+        if (m_document)
+            m_document->resetRenderStatistics();
+        updateRenderStatistics();
+    });
+    statisticsLayout->addWidget(reset, 0, Qt::AlignRight);
+    lay->addWidget(statisticsBox, 1);
+
+    QGroupBox *memoryBox = new QGroupBox(QStringLiteral("Memory usage"), this);
+    QVBoxLayout *memoryLayout = new QVBoxLayout(memoryBox);
+    m_memoryUsage = new QTreeWidget(memoryBox);
+    m_memoryUsage->setRootIsDecorated(false);
+    m_memoryUsage->setHeaderLabels({QStringLiteral("Subsystem"), QStringLiteral("Memory")});
+    m_memoryUsage->header()->setSectionResizeMode(QHeaderView::ResizeToContents);
+    memoryLayout->addWidget(m_memoryUsage);
+    lay->addWidget(memoryBox, 1);
+
+    QTimer *timer = new QTimer(this);
+    connect(timer, &QTimer::timeout, this, &DlgDebug::updateRenderStatistics);
+    connect(timer, &QTimer::timeout, this, &DlgDebug::updateMemoryUsage);
+    timer->start(1000);
+    updateRenderStatistics();
+    updateMemoryUsage();
+}
+
+void DlgDebug::updateRenderStatistics()
+{
+    if (!m_document)
+        return;
+
+    QList<Okular::RenderStatistics> columns;
+    QStringList headers = {QStringLiteral("Counter"), QStringLiteral("Document")};
+    columns << m_document->renderStatistics();
+    const QHash<Okular::DocumentObserver *, Okular::RenderStatistics> observerStatistics = m_document->observerRenderStatistics();
+    for (auto it = observerStatistics.constBegin(); it != observerStatistics.constEnd(); ++it) {
+        const QObject *object = dynamic_cast<const QObject *>(it.key());
+        headers << (object ? QString::fromLatin1(object->metaObject()->className()) : QStringLiteral("0x%1").arg(quintptr(it.key()), 0, 16));
+        columns << it.value();
+    }
+
+    typedef QString (*CounterText)(const Okular::RenderStatistics &);
+    static const QList<QPair<QString, CounterText>> counters = {
+        {QStringLiteral("Queued requests"), [](const Okular::RenderStatistics &s) { return QString::number(s.queuedRequests()); }},
+        {QStringLiteral("Executing requests"), [](const Okular::RenderStatistics &s) { return QString::number(s.executingRequests()); }},
+        {QStringLiteral("Sent to the generator"), [](const Okular::RenderStatistics &s) { return QString::number(s.generatorRequests()); }},
+        {QStringLiteral("Average time in queue"), [](const Okular::RenderStatistics &s) { return QStringLiteral("%1 ms").arg(s.averageQueueTime()); }},
+        {QStringLiteral("Generated pixmaps"), [](const Okular::RenderStatistics &s) { return QString::number(s.generatedPixmaps()); }},
+        {QStringLiteral("Average render time"), [](const Okular::RenderStatistics &s) { return QStringLiteral("%1 ms").arg(s.averageRenderTime()); }},
+        {QStringLiteral("Pixmap cache hits"), [](const Okular::RenderStatistics &s) { return QString::number(s.pixmapCacheHits()); }},
+        {QStringLiteral("Compressed cache hits"), [](const Okular::RenderStatistics &s) { return QString::number(s.compressedCacheHits()); }},
+        {QStringLiteral("Disk cache hits"), [](const Okular::RenderStatistics &s) { return QString::number(s.diskCacheHits()); }},
+        {QStringLiteral("Scaled from other views"), [](const Okular::RenderStatistics &s) { return QString::number(s.sharedPixmapHits()); }},
+        {QStringLiteral("Rendered for other views"), [](const Okular::RenderStatistics &s) { return QString::number(s.coalescedRequests()); }},
+        {QStringLiteral("Embedded thumbnails"), [](const Okular::RenderStatistics &s) { return QString::number(s.embeddedThumbnailHits()); }},
+        {QStringLiteral("Thumbnail cache hits"), [](const Okular::RenderStatistics &s) { return QString::number(s.thumbnailCacheHits()); }},
+        {QStringLiteral("Evicted pixmaps"), [](const Okular::RenderStatistics &s) { return QString::number(s.evictedPixmaps()); }},
+        {QStringLiteral("Allocated pixmaps"), [](const Okular::RenderStatistics &s) { return QString::number(s.allocatedPixmaps()); }},
+        {QStringLiteral("Allocated memory"), [](const Okular::RenderStatistics &s) { return QStringLiteral("%1 KiB").arg(s.allocatedPixmapBytes() / 1024); }},
+        {QStringLiteral("Compressed memory"), [](const Okular::RenderStatistics &s) { return QStringLiteral("%1 KiB").arg(s.compressedPixmapBytes() / 1024); }},
+        {QStringLiteral("Idle render buffers"), [](const Okular::RenderStatistics &s) { return QStringLiteral("%1 KiB").arg(s.idleRenderBufferBytes() / 1024); }},
+        {QStringLiteral("First pixmap after"), [](const Okular::RenderStatistics &s) { return s.firstPixmapTime() < 0 ? QStringLiteral("-") : QStringLiteral("%1 ms").arg(s.firstPixmapTime()); }},
+    };
+
+    m_renderStatistics->clear();
+    m_renderStatistics->setHeaderLabels(headers);
+    for (const QPair<QString, CounterText> &counter : counters) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(m_renderStatistics);
+        item->setText(0, counter.first);
+        for (int i = 0; i < columns.count(); ++i) {
+            item->setText(i + 1, counter.second(columns.at(i)));
+            item->setTextAlignment(i + 1, Qt::AlignRight);
+        }
+    }
+
+    // only the document has them
+    const QMap<QString, Okular::LockStatistics> locks = columns.first().userMutexStatistics();
+    for (auto it = locks.constBegin(); it != locks.constEnd(); ++it) {
+        const Okular::LockStatistics &l = it.value();
+        const QString text = QStringLiteral("%1 locks, %2 waited, %3 us avg wait (max %4), %5 us avg hold (max %6)").arg(l.locks()).arg(l.contendedLocks()).arg(l.averageWaitTime()).arg(l.maxWaitTime()).arg(l.averageHoldTime()).arg(l.maxHoldTime());
+        QTreeWidgetItem *item = new QTreeWidgetItem(m_renderStatistics, {QStringLiteral("Generator mutex (%1)").arg(it.key()), text});
+        item->setTextAlignment(1, Qt::AlignRight);
+    }
+}
+
+void DlgDebug::updateMemoryUsage()
+{
+    if (!m_document)
+        return;
+
+    const QMap<QString, qulonglong> usage = m_document->memoryUsage();
+    qulonglong total = 0;
+    m_memoryUsage->clear();
+    for (auto it = usage.constBegin(); it != usage.constEnd(); ++it) {
+        QTreeWidgetItem *item = new QTreeWidgetItem(m_memoryUsage, {it.key(), QStringLiteral("%1 KiB").arg(it.value() / 1024)});
+        item->setTextAlignment(1, Qt::AlignRight);
+        total += it.value();
+    }
+    QTreeWidgetItem *item = new QTreeWidgetItem(m_memoryUsage, {QStringLiteral("Total"), QStringLiteral("%1 KiB").arg(total / 1024)});
+    item->setTextAlignment(1, Qt::AlignRight);
+    QFont font = item->font(0);
+    font.setBold(true);
+    item->setFont(0, font);
+    item->setFont(1, font);
 }
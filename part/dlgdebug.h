@@ -7,14 +7,30 @@
 #ifndef _DLGDEBUG_H
 #define _DLGDEBUG_H
 
+#include <QPointer>
 #include <qwidget.h>
 
+class QTreeWidget;
+
+namespace Okular
+{
+class Document;
+}
+
 class DlgDebug : public QWidget
 {
     Q_OBJECT
 
 public:
-    explicit DlgDebug(QWidget *parent = nullptr);
+    explicit DlgDebug(QWidget *parent = nullptr, Okular::Document *document = nullptr);
+
+private:
+    void updateRenderStatistics();
+    void updateMemoryUsage();
+
+    QPointer<Okular::Document> m_document;
+    QTreeWidget *m_renderStatistics;
+    QTreeWidget *m_memoryUsage;
 };
 
 #endif
@@ -12,6 +12,7 @@
 #include <QComboBox>
 #include <QFormLayout>
 #include <QLabel>
+#include <QSpinBox>
 
 #include "settings_core.h"
 
@@ -28,6 +29,14 @@ DlgPerformance::DlgPerformance(QWidget *parent)
     layout->addRow(i18nc("@label Config dialog, performance page", "CPU usage:"), useTransparencyEffects);
     // END Checkbox: transparency effects
 
+    // BEGIN Checkbox: GPU compositing
+    QCheckBox *useGpuCompositing = new QCheckBox(this);
+    useGpuCompositing->setText(i18nc("@option:check Config dialog, performance page", "Draw the pages with the graphics card"));
+    useGpuCompositing->setToolTip(i18nc("@info:tooltip Config dialog, performance page", "Scrolling and zooming reuse the pages already sent to the graphics card. Applies to the documents opened from now on."));
+    useGpuCompositing->setObjectName(QStringLiteral("kcfg_EnableGpuCompositing"));
+    layout->addRow(QString(), useGpuCompositing);
+    // END Checkbox: GPU compositing
+
     layout->addRow(new QLabel(this));
 
     // BEGIN Radio buttons: memory usage
@@ -47,6 +56,56 @@ DlgPerformance::DlgPerformance(QWidget *parent)
     connect(m_memoryLevel, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &DlgPerformance::slotMemoryLevelSelected);
     // END Radio buttons: memory usage
 
+    // BEGIN Spinbox: compressed pages
+    QSpinBox *compressedPixmapCacheSize = new QSpinBox(this);
+    compressedPixmapCacheSize->setRange(0, 4096);
+    compressedPixmapCacheSize->setSingleStep(16);
+    compressedPixmapCacheSize->setSuffix(i18nc("Mebibyte, used as a suffix", " MiB"));
+    compressedPixmapCacheSize->setSpecialValueText(i18nc("@item:inlistbox Config dialog, performance page, compressed page cache size", "Disabled"));
+    compressedPixmapCacheSize->setToolTip(i18nc("@info:tooltip Config dialog, performance page", "Pages removed from memory are kept compressed, so going back to them does not need to render them again. Not used with the low memory usage."));
+    compressedPixmapCacheSize->setObjectName(QStringLiteral("kcfg_CompressedPixmapCacheSize"));
+    layout->addRow(i18nc("@label:spinbox Config dialog, performance page", "Compressed pages:"), compressedPixmapCacheSize);
+    // END Spinbox: compressed pages
+
+    // BEGIN Checkbox: disk cache
+    QCheckBox *usePixmapDiskCache = new QCheckBox(this);
+    usePixmapDiskCache->setText(i18nc("@option:check Config dialog, performance page", "Keep rendered pages on disk"));
+    usePixmapDiskCache->setToolTip(i18nc("@info:tooltip Config dialog, performance page", "Reopening a document shows the pages seen last time without rendering them again."));
+    usePixmapDiskCache->setObjectName(QStringLiteral("kcfg_EnablePixmapDiskCache"));
+    layout->addRow(QString(), usePixmapDiskCache);
+
+    QSpinBox *pixmapDiskCacheSize = new QSpinBox(this);
+    pixmapDiskCacheSize->setRange(16, 16384);
+    pixmapDiskCacheSize->setSingleStep(64);
+    pixmapDiskCacheSize->setSuffix(i18nc("Mebibyte, used as a suffix", " MiB"));
+    pixmapDiskCacheSize->setObjectName(QStringLiteral("kcfg_PixmapDiskCacheSize"));
+    pixmapDiskCacheSize->setEnabled(false);
+    connect(usePixmapDiskCache, &QCheckBox::toggled, pixmapDiskCacheSize, &QSpinBox::setEnabled);
+    layout->addRow(i18nc("@label:spinbox Config dialog, performance page", "Disk cache size:"), pixmapDiskCacheSize);
+
+    QCheckBox *useTextPageDiskCache = new QCheckBox(this);
+    useTextPageDiskCache->setText(i18nc("@option:check Config dialog, performance page", "Keep the text of pages on disk"));
+    useTextPageDiskCache->setToolTip(i18nc("@info:tooltip Config dialog, performance page", "Reopening a document searches and selects its text without extracting it again."));
+    useTextPageDiskCache->setObjectName(QStringLiteral("kcfg_EnableTextPageDiskCache"));
+    layout->addRow(QString(), useTextPageDiskCache);
+
+    QCheckBox *useThumbnailDiskCache = new QCheckBox(this);
+    useThumbnailDiskCache->setText(i18nc("@option:check Config dialog, performance page", "Keep the thumbnails of pages on disk"));
+    useThumbnailDiskCache->setToolTip(i18nc("@info:tooltip Config dialog, performance page", "Reopening a document shows its thumbnails without rendering them again."));
+    useThumbnailDiskCache->setObjectName(QStringLiteral("kcfg_EnableThumbnailDiskCache"));
+    layout->addRow(QString(), useThumbnailDiskCache);
+    // END Checkbox: disk cache
+
+    // BEGIN Spinbox: partial updates
+    QSpinBox *partialUpdatesPerSecond = new QSpinBox(this);
+    partialUpdatesPerSecond->setRange(0, 30);
+    partialUpdatesPerSecond->setSuffix(i18nc("Partial updates per second, used as a suffix", " per second"));
+    partialUpdatesPerSecond->setSpecialValueText(i18nc("@item:inlistbox Config dialog, performance page, partial updates", "Disabled"));
+    partialUpdatesPerSecond->setToolTip(i18nc("@info:tooltip Config dialog, performance page", "Pages that take long to render are shown while they are drawn, at most this many times per second."));
+    partialUpdatesPerSecond->setObjectName(QStringLiteral("kcfg_PartialUpdatesPerSecond"));
+    layout->addRow(i18nc("@label:spinbox Config dialog, performance page", "Show pages being rendered:"), partialUpdatesPerSecond);
+    // END Spinbox: partial updates
+
     layout->addRow(new QLabel(this));
 
     // BEGIN Checkboxes: rendering options
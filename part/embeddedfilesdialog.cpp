@@ -169,7 +169,10 @@ void EmbeddedFilesDialog::viewFile(Okular::EmbeddedFile *ef)
     // save in temporary directory with a unique name resembling the attachment name,
     // using QTemporaryFile's XXXXXX placeholder
     QTemporaryFile *tmpFile = new QTemporaryFile(QDir::tempPath() + '/' + fileInfo.baseName() + ".XXXXXX" + (fileInfo.completeSuffix().isEmpty() ? QLatin1String("") : QString('.' + fileInfo.completeSuffix())));
-    GuiUtils::writeEmbeddedFile(ef, this, *tmpFile);
+    if (!GuiUtils::writeEmbeddedFile(ef, this, *tmpFile)) {
+        delete tmpFile;
+        return;
+    }
 
     // set readonly to prevent the viewer application from modifying it
     tmpFile->setPermissions(QFile::ReadOwner);
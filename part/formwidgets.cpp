@@ -22,6 +22,7 @@
 #include <QKeyEvent>
 #include <QMenu>
 #include <QPainter>
+#include <QSignalBlocker>
 #include <QUrl>
 
 // local includes
@@ -34,9 +35,9 @@ FormWidgetsController::FormWidgetsController(Okular::Document *doc)
     , m_doc(doc)
 {
     // emit changed signal when a form has changed
-    connect(this, &FormWidgetsController::formTextChangedByUndoRedo, this, &FormWidgetsController::changed);
-    connect(this, &FormWidgetsController::formListChangedByUndoRedo, this, &FormWidgetsController::changed);
-    connect(this, &FormWidgetsController::formComboChangedByUndoRedo, this, &FormWidgetsController::changed);
+    connect(this, &FormWidgetsController::formTextChangedByUndoRedo, this, [this](int pageNumber, Okular::FormFieldText *form) { emit changed(pageNumber, form->rect()); });
+    connect(this, &FormWidgetsController::formListChangedByUndoRedo, this, [this](int pageNumber, Okular::FormFieldChoice *form) { emit changed(pageNumber, form->rect()); });
+    connect(this, &FormWidgetsController::formComboChangedByUndoRedo, this, [this](int pageNumber, Okular::FormFieldChoice *form) { emit changed(pageNumber, form->rect()); });
 
     // connect form modification signals to and from document
     connect(this, &FormWidgetsController::formTextChangedByWidget, doc, &Okular::Document::editFormText);
@@ -135,6 +136,21 @@ void FormWidgetsController::registerRadioButton(FormWidgetIface *fwButton, Okula
     m_radios.append(newdata);
 }
 
+void FormWidgetsController::unregisterRadioButton(FormWidgetIface *fwButton)
+{
+    QAbstractButton *button = dynamic_cast<QAbstractButton *>(fwButton);
+    if (!button)
+        return;
+
+    // the button leaves its group when deleted
+    const int id = fwButton->formField()->id();
+    if (m_buttons.value(id) == button)
+        m_buttons.remove(id);
+    // a reused button joins the group of its new field
+    if (QButtonGroup *group = button->group())
+        group->removeButton(button);
+}
+
 void FormWidgetsController::dropRadioButtons()
 {
     QList<RadioData>::iterator it = m_radios.begin(), itEnd = m_radios.end();
@@ -202,9 +218,14 @@ void FormWidgetsController::slotButtonClicked(QAbstractButton *button)
 
 void FormWidgetsController::slotFormButtonsChangedByUndoRedo(int pageNumber, const QList<Okular::FormFieldButton *> &formButtons)
 {
+    Okular::NormalizedRect area;
     for (const Okular::FormFieldButton *formButton : formButtons) {
+        area = area.isNull() ? formButton->rect() : area | formButton->rect();
         int id = formButton->id();
-        QAbstractButton *button = m_buttons[id];
+        QAbstractButton *button = m_buttons.value(id);
+        // no widget for the pages far from the view, it gets the state when created
+        if (!button)
+            continue;
         CheckBoxEdit *check = qobject_cast<CheckBoxEdit *>(button);
         if (check) {
             emit refreshFormWidget(check->formField());
@@ -219,7 +240,7 @@ void FormWidgetsController::slotFormButtonsChangedByUndoRedo(int pageNumber, con
         button->group()->setExclusive(wasExclusive);
         button->setFocus();
     }
-    emit changed(pageNumber);
+    emit changed(pageNumber, area);
 }
 
 FormWidgetIface *FormWidgetFactory::createWidget(Okular::FormField *ff, QWidget *parent)
@@ -285,6 +306,69 @@ FormWidgetIface *FormWidgetFactory::createWidget(Okular::FormField *ff, QWidget
     return widget;
 }
 
+// per kind, the line edits of big forms are a few hundred per page at most
+static const int maxPooledWidgets = 256;
+
+FormWidgetPool::~FormWidgetPool()
+{
+    clear();
+}
+
+int FormWidgetPool::kind(Okular::FormField *ff)
+{
+    if (ff->type() == Okular::FormField::FormText && static_cast<Okular::FormFieldText *>(ff)->textType() == Okular::FormFieldText::Normal)
+        return 0;
+    if (ff->type() == Okular::FormField::FormButton && static_cast<Okular::FormFieldButton *>(ff)->buttonType() == Okular::FormFieldButton::CheckBox)
+        return 1;
+    return -1;
+}
+
+FormWidgetIface *FormWidgetPool::take(Okular::FormField *ff)
+{
+    auto it = m_widgets.find(kind(ff));
+    if (it == m_widgets.end() || it->isEmpty())
+        return nullptr;
+
+    FormWidgetIface *widget = it->takeLast();
+    if (!widget->reuse(ff)) {
+        delete widget;
+        return nullptr;
+    }
+    if (!FormWidgetsController::shouldFormWidgetBeShown(ff))
+        widget->setVisibility(false);
+    return widget;
+}
+
+void FormWidgetPool::release(FormWidgetIface *w)
+{
+    const int k = kind(w->formField());
+    if (k < 0 || m_widgets.value(k).count() >= maxPooledWidgets) {
+        delete w;
+        return;
+    }
+
+    // nor refreshed with the old field until reused
+    w->setVisibility(false);
+    w->setPageItem(nullptr);
+    w->setFormField(nullptr);
+    m_widgets[k].append(w);
+}
+
+void FormWidgetPool::clear()
+{
+    for (const QVector<FormWidgetIface *> &widgets : qAsConst(m_widgets))
+        qDeleteAll(widgets);
+    m_widgets.clear();
+}
+
+int FormWidgetPool::count() const
+{
+    int count = 0;
+    for (const QVector<FormWidgetIface *> &widgets : m_widgets)
+        count += widgets.count();
+    return count;
+}
+
 FormWidgetIface::FormWidgetIface(QWidget *w, Okular::FormField *ff)
     : m_controller(nullptr)
     , m_ff(ff)
@@ -353,6 +437,12 @@ void FormWidgetIface::setFormWidgetsController(FormWidgetsController *controller
     QObject::connect(m_controller, &FormWidgetsController::refreshFormWidget, obj, [this](Okular::FormField *form) { slotRefresh(form); });
 }
 
+bool FormWidgetIface::reuse(Okular::FormField *field)
+{
+    Q_UNUSED(field);
+    return false;
+}
+
 void FormWidgetIface::slotRefresh(Okular::FormField *form)
 {
     if (m_ff != form) {
@@ -395,6 +485,17 @@ void CheckBoxEdit::setFormWidgetsController(FormWidgetsController *controller)
     setChecked(form->state());
 }
 
+bool CheckBoxEdit::reuse(Okular::FormField *field)
+{
+    Okular::FormFieldButton *button = static_cast<Okular::FormFieldButton *>(field);
+    setFormField(button);
+    setText(button->caption());
+    setVisible(button->isVisible());
+    m_controller->registerRadioButton(this, button);
+    setChecked(button->state());
+    return true;
+}
+
 void CheckBoxEdit::doActivateAction()
 {
     Okular::FormFieldButton *form = static_cast<Okular::FormFieldButton *>(m_ff);
@@ -464,6 +565,27 @@ void FormLineEdit::setFormWidgetsController(FormWidgetsController *controller)
     connect(m_controller, &FormWidgetsController::formTextChangedByUndoRedo, this, &FormLineEdit::slotHandleTextChangedByUndoRedo);
 }
 
+bool FormLineEdit::reuse(Okular::FormField *field)
+{
+    Okular::FormFieldText *text = static_cast<Okular::FormFieldText *>(field);
+    setFormField(text);
+
+    // setting the text moves the cursor, that is not an edit of the new field
+    const QSignalBlocker blocker(this);
+    const int maxlen = text->maximumLength();
+    setMaxLength(maxlen >= 0 ? maxlen : 32767);
+    setAlignment(text->textAlignment());
+    setEchoMode(text->isPassword() ? QLineEdit::Password : QLineEdit::Normal);
+    setText(text->text());
+
+    m_prevCursorPos = cursorPosition();
+    m_prevAnchorPos = cursorPosition();
+    m_editing = false;
+
+    setVisible(text->isVisible());
+    return true;
+}
+
 bool FormLineEdit::event(QEvent *e)
 {
     if (e->type() == QEvent::KeyPress) {
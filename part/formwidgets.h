@@ -17,10 +17,12 @@
 #include <KUrlRequester>
 #include <QCheckBox>
 #include <QComboBox>
+#include <QHash>
 #include <QLineEdit>
 #include <QListWidget>
 #include <QPushButton>
 #include <QRadioButton>
+#include <QVector>
 
 class ComboEdit;
 class QMenu;
@@ -63,6 +65,8 @@ public:
     void processScriptAction(Okular::Action *a, Okular::FormField *field, Okular::Annotation::AdditionalActionType type);
 
     void registerRadioButton(FormWidgetIface *fwButton, Okular::FormFieldButton *formButton);
+    // to be called before deleting or reusing a registered button, its group keeps the others
+    void unregisterRadioButton(FormWidgetIface *fwButton);
     void dropRadioButtons();
     bool canUndo();
     bool canRedo();
@@ -70,7 +74,7 @@ public:
     static bool shouldFormWidgetBeShown(Okular::FormField *form);
 
 Q_SIGNALS:
-    void changed(int pageNumber);
+    void changed(int pageNumber, const Okular::NormalizedRect &area);
     void requestUndo();
     void requestRedo();
     void canUndoChanged(bool undoAvailable);
@@ -124,6 +128,35 @@ public:
     static FormWidgetIface *createWidget(Okular::FormField *ff, QWidget *parent = nullptr);
 };
 
+/**
+ * The widgets of the fields of the pages scrolled away, kept hidden by kind to
+ * be given to fields of the same kind instead of creating new ones.
+ *
+ * Only the line edits and the check boxes, most of the fields of big forms,
+ * are kept; the other widgets are deleted.
+ */
+class FormWidgetPool
+{
+public:
+    FormWidgetPool() = default;
+    ~FormWidgetPool();
+
+    FormWidgetPool(const FormWidgetPool &) = delete;
+    FormWidgetPool &operator=(const FormWidgetPool &) = delete;
+
+    // a widget of the kind of ff showing it, or nullptr if there is none
+    FormWidgetIface *take(Okular::FormField *ff);
+    // hides w and keeps it, or deletes it
+    void release(FormWidgetIface *w);
+    void clear();
+    int count() const;
+
+private:
+    static int kind(Okular::FormField *ff);
+
+    QHash<int, QVector<FormWidgetIface *>> m_widgets;
+};
+
 class FormWidgetIface
 {
 public:
@@ -146,6 +179,10 @@ public:
 
     virtual void setFormWidgetsController(FormWidgetsController *controller);
 
+    // shows field instead of the one of the widget, which must be of the same
+    // kind and have a controller; false if the widget can't be reused
+    virtual bool reuse(Okular::FormField *field);
+
 protected:
     virtual void slotRefresh(Okular::FormField *form);
 
@@ -185,6 +222,7 @@ public:
 
     // reimplemented from FormWidgetIface
     void setFormWidgetsController(FormWidgetsController *controller) override;
+    bool reuse(Okular::FormField *field) override;
 
     void doActivateAction();
 
@@ -212,6 +250,7 @@ class FormLineEdit : public QLineEdit, public FormWidgetIface
 public:
     explicit FormLineEdit(Okular::FormFieldText *text, QWidget *parent = nullptr);
     void setFormWidgetsController(FormWidgetsController *controller) override;
+    bool reuse(Okular::FormField *field) override;
     bool event(QEvent *e) override;
     void contextMenuEvent(QContextMenuEvent *event) override;
 
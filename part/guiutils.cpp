@@ -196,14 +196,20 @@ void saveEmbeddedFile(Okular::EmbeddedFile *ef, QWidget *parent)
     writeEmbeddedFile(ef, parent, targetFile);
 }
 
-void writeEmbeddedFile(Okular::EmbeddedFile *ef, QWidget *parent, QFile &target)
+bool writeEmbeddedFile(Okular::EmbeddedFile *ef, QWidget *parent, QFile &target)
 {
     if (!target.open(QIODevice::WriteOnly)) {
         KMessageBox::error(parent, i18n("Could not open \"%1\" for writing. File was not saved.", target.fileName()));
-        return;
+        return false;
     }
-    target.write(ef->data());
+    const QByteArray contents = ef->data();
+    const bool written = target.write(contents) == contents.size();
     target.close();
+    if (!written) {
+        target.remove();
+        KMessageBox::error(parent, i18n("Could not write \"%1\". File was not saved.", target.fileName()));
+    }
+    return written;
 }
 
 Okular::Movie *renditionMovieFromScreenAnnotation(const Okular::ScreenAnnotation *annotation)
@@ -47,7 +47,7 @@ QString prettyToolTip(const Okular::Annotation *annotation);
 QPixmap loadStamp(const QString &nameOrPath, int size, bool keepAspectRatio = true);
 
 void saveEmbeddedFile(Okular::EmbeddedFile *ef, QWidget *parent);
-void writeEmbeddedFile(Okular::EmbeddedFile *ef, QWidget *parent, QFile &targetFile);
+bool writeEmbeddedFile(Okular::EmbeddedFile *ef, QWidget *parent, QFile &targetFile);
 
 /**
  * Returns the movie object that is referenced by a rendition action of the passed screen @p annotation
@@ -14,30 +14,86 @@
 #include <KProcess>
 
 #include <QColor>
+#include <QCoreApplication>
+#include <QCryptographicHash>
 #include <QDir>
 #include <QFileInfo>
-#include <QImage>
+#include <QHash>
+#include <QImageReader>
+#include <QPointer>
 #include <QRegularExpression>
+#include <QSharedPointer>
+#include <QSize>
 #include <QStandardPaths>
 #include <QTemporaryFile>
 #include <QTextStream>
+#include <QThreadPool>
 
+#include "core/diskcache_p.h"
+#include "core/functiontask_p.h"
 #include "debug_ui.h"
 
 namespace GuiUtils
 {
+namespace
+{
+// a formula in the cache, its image is in the cache directory
+struct RenderedFormula {
+    QString fileName;
+    QSize size;
+};
+
+// the formulas seen rendered in this process, by formulaKey()
+QHash<QByteArray, RenderedFormula> renderedFormulas;
+}
+
+// the images of the formulas rendered before
+static const Okular::DiskCache &formulaCache()
+{
+    static const Okular::DiskCache cache(QStringLiteral("latex"));
+    return cache;
+}
+
+// what the image depends on, the document latex is given is in handleLatex()
+static QByteArray formulaKey(const QString &latexFormula, const QColor &textColor, int fontSize, int resolution)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(latexFormula.toUtf8());
+    hash.addData(textColor.name(QColor::HexArgb).toLatin1());
+    hash.addData(QByteArray::number(fontSize) + '/' + QByteArray::number(resolution));
+    return hash.result().toHex();
+}
+
+static QString formulaFileName(const QByteArray &key)
+{
+    return formulaCache().fileName(key + ".png");
+}
+
+// the rendered formula of key, looked for on disk if it was not seen before
+static const RenderedFormula *findFormula(const QByteArray &key)
+{
+    // the cache may have pruned it meanwhile
+    QHash<QByteArray, RenderedFormula>::const_iterator it = renderedFormulas.constFind(key);
+    if (it != renderedFormulas.constEnd() && QFile::exists(it->fileName))
+        return &*it;
+
+    const QString fileName = formulaFileName(key);
+    const QSize size = QImageReader(fileName).size();
+    if (!size.isValid())
+        return nullptr;
+
+    return &*renderedFormulas.insert(key, {fileName, size});
+}
+
 LatexRenderer::LatexRenderer()
 {
 }
 
 LatexRenderer::~LatexRenderer()
 {
-    for (const QString &file : qAsConst(m_fileList)) {
-        QFile::remove(file);
-    }
 }
 
-LatexRenderer::Error LatexRenderer::renderLatexInHtml(QString &html, const QColor &textColor, int fontSize, int resolution, QString &latexOutput)
+LatexRenderer::Error LatexRenderer::renderLatexInHtml(QString &html, const QColor &textColor, int fontSize, int resolution)
 {
     if (!html.contains(QStringLiteral("$$")))
         return NoError;
@@ -46,7 +102,8 @@ LatexRenderer::Error LatexRenderer::renderLatexInHtml(QString &html, const QColo
     QRegularExpression rg(QStringLiteral("\\$\\$.+?\\$\\$"));
     QRegularExpressionMatchIterator it = rg.globalMatch(html);
 
-    QMap<QString, QString> replaceMap;
+    QMap<QString, RenderedFormula> replaceMap;
+    QMap<QByteArray, QString> toRender;
     while (it.hasNext()) {
         QRegularExpressionMatch match = it.next();
         const QString matchedString = match.captured(0);
@@ -68,33 +125,79 @@ LatexRenderer::Error LatexRenderer::renderLatexInHtml(QString &html, const QColo
         formul.replace(QLatin1String("&apos;"), QLatin1String("\'"));
         formul.replace(QLatin1String("<br>"), QLatin1String(" "));
 
-        QString fileName;
-        Error returnCode = handleLatex(fileName, formul, textColor, fontSize, resolution, latexOutput);
-        if (returnCode != NoError) {
-            return returnCode;
+        const QByteArray key = formulaKey(formul, textColor, fontSize, resolution);
+        if (const RenderedFormula *formula = findFormula(key))
+            replaceMap[matchedString] = *formula;
+        else if (!m_pending.contains(key))
+            toRender.insert(key, formul);
+    }
+
+    if (!toRender.isEmpty()) {
+        // what can be told right away
+        if (QStandardPaths::findExecutable(QStringLiteral("latex")).isEmpty()) {
+            qCDebug(OkularUiDebug) << "Could not find latex!";
+            return LatexNotFound;
+        }
+        if (QStandardPaths::findExecutable(QStringLiteral("dvipng")).isEmpty()) {
+            qCDebug(OkularUiDebug) << "Could not find dvipng!";
+            return DvipngNotFound;
         }
 
-        replaceMap[matchedString] = fileName;
+        for (QMap<QByteArray, QString>::ConstIterator it = toRender.constBegin(); it != toRender.constEnd(); ++it) {
+            const QByteArray key = it.key();
+            const QString formula = *it;
+            m_pending.insert(key);
+            // back in the main thread the renderer may be gone, the pointer is only looked at there
+            const QSharedPointer<QPointer<LatexRenderer>> renderer(new QPointer<LatexRenderer>(this));
+            QThreadPool::globalInstance()->start(new Okular::FunctionTask([renderer, key, formula, textColor, fontSize, resolution] {
+                QString fileName;
+                QString latexOutput;
+                const Error error = handleLatex(fileName, formula, textColor, fontSize, resolution, latexOutput);
+                if (error == NoError) {
+                    formulaCache().moveIn(fileName, key + ".png");
+                    fileName = formulaFileName(key);
+                }
+                QMetaObject::invokeMethod(
+                    qApp,
+                    [renderer, key, error, fileName, latexOutput] {
+                        if (*renderer)
+                            (*renderer)->formulaRendered(key, error, fileName, latexOutput);
+                    },
+                    Qt::QueuedConnection);
+            }));
+        }
     }
 
     if (replaceMap.isEmpty()) // we haven't found any LaTeX strings
         return NoError;
 
-    int imagePxWidth, imagePxHeight;
-    for (QMap<QString, QString>::ConstIterator it = replaceMap.constBegin(); it != replaceMap.constEnd(); ++it) {
-        QImage theImage(*it);
-        if (theImage.isNull())
-            continue;
-        imagePxWidth = theImage.width();
-        imagePxHeight = theImage.height();
+    for (QMap<QString, RenderedFormula>::ConstIterator it = replaceMap.constBegin(); it != replaceMap.constEnd(); ++it) {
         QString escapedLATEX = it.key().toHtmlEscaped().replace(QLatin1Char('"'), QLatin1String("&quot;")); // we need  the escape quotes because that string will be in a title="" argument, but not the \n
         html.replace(it.key(),
-                     QStringLiteral(" <img width=\"") + QString::number(imagePxWidth) + QStringLiteral("\" height=\"") + QString::number(imagePxHeight) + QStringLiteral("\" align=\"middle\" src=\"") + (*it) + QStringLiteral("\"  alt=\"") +
-                         escapedLATEX + QStringLiteral("\" title=\"") + escapedLATEX + QStringLiteral("\"  /> "));
+                     QStringLiteral(" <img width=\"") + QString::number(it->size.width()) + QStringLiteral("\" height=\"") + QString::number(it->size.height()) + QStringLiteral("\" align=\"middle\" src=\"") + it->fileName +
+                         QStringLiteral("\"  alt=\"") + escapedLATEX + QStringLiteral("\" title=\"") + escapedLATEX + QStringLiteral("\"  /> "));
     }
     return NoError;
 }
 
+void LatexRenderer::formulaRendered(const QByteArray &key, Error error, const QString &fileName, const QString &latexOutput)
+{
+    m_pending.remove(key);
+    if (error != NoError) {
+        emit renderingFailed(error, latexOutput);
+        return;
+    }
+
+    const QSize size = QImageReader(fileName).size();
+    if (!size.isValid()) {
+        emit renderingFailed(DvipngFailed, QString());
+        return;
+    }
+
+    renderedFormulas.insert(key, {fileName, size});
+    emit formulasRendered();
+}
+
 bool LatexRenderer::mightContainLatex(const QString &text)
 {
     if (!text.contains(QStringLiteral("$$")))
@@ -180,7 +283,6 @@ LatexRenderer::Error LatexRenderer::handleLatex(QString &fileName, const QString
     }
 
     fileName = tempFileNameNS + QStringLiteral(".png");
-    m_fileList << fileName;
     return NoError;
 }
 
@@ -194,3 +296,5 @@ bool LatexRenderer::securityCheck(const QString &latexFormula)
 }
 
 }
+
+#include "moc_latexrenderer.cpp"
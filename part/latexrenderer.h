@@ -10,32 +10,44 @@
 #ifndef LATEXRENDERER_H
 #define LATEXRENDERER_H
 
-#include <QStringList>
+#include <QObject>
+#include <QSet>
 
 class QString;
 class QColor;
 
 namespace GuiUtils
 {
-class LatexRenderer
+class LatexRenderer : public QObject
 {
+    Q_OBJECT
+
 public:
     enum Error { NoError, LatexNotFound, DvipngNotFound, LatexFailed, DvipngFailed };
 
     LatexRenderer();
-    ~LatexRenderer();
+    ~LatexRenderer() override;
 
     LatexRenderer(const LatexRenderer &) = delete;
     LatexRenderer &operator=(const LatexRenderer &) = delete;
 
-    Error renderLatexInHtml(QString &html, const QColor &textColor, int fontSize, int resolution, QString &latexOutput);
+    // replaces the formulas of html that were rendered before with their
+    // images, the others are rendered in the background and stay as they are
+    // until formulasRendered() asks to call this again
+    Error renderLatexInHtml(QString &html, const QColor &textColor, int fontSize, int resolution);
     static bool mightContainLatex(const QString &text);
 
+Q_SIGNALS:
+    void formulasRendered();
+    void renderingFailed(GuiUtils::LatexRenderer::Error error, const QString &latexOutput);
+
 private:
-    Error handleLatex(QString &fileName, const QString &latexFormula, const QColor &textColor, int fontSize, int resolution, QString &latexOutput);
+    static Error handleLatex(QString &fileName, const QString &latexFormula, const QColor &textColor, int fontSize, int resolution, QString &latexOutput);
     static bool securityCheck(const QString &latexFormula);
+    void formulaRendered(const QByteArray &key, Error error, const QString &fileName, const QString &latexOutput);
 
-    QStringList m_fileList;
+    // the formulas being rendered, by their cache key
+    QSet<QByteArray> m_pending;
 };
 
 }
@@ -63,7 +63,7 @@ void Layers::notifySetup(const QVector<Okular::Page *> & /*pages*/, int /*setupF
         m_treeView->setModel(layersModel);
         m_searchLine->setTreeView(m_treeView);
         emit hasLayers(true);
-        connect(layersModel, &QAbstractItemModel::dataChanged, m_document, &Okular::Document::reloadDocument);
+        connect(layersModel, &QAbstractItemModel::dataChanged, m_document, &Okular::Document::refreshLayers);
         connect(layersModel, &QAbstractItemModel::dataChanged, m_pageView, &PageView::reloadForms);
     } else {
         emit hasLayers(false);
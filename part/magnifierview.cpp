@@ -106,12 +106,16 @@ void MagnifierView::move(int x, int y)
 
 void MagnifierView::requestPixmap()
 {
+    if (!m_page) {
+        return;
+    }
+
     const int full_width = m_page->width() * SCALE;
     const int full_height = m_page->height() * SCALE;
 
     Okular::NormalizedRect nrect = normalizedView();
 
-    if (m_page && !m_page->hasPixmap(this, full_width, full_height, nrect)) {
+    if (!m_page->hasPixmap(this, full_width, full_height, nrect)) {
         QLinkedList<Okular::PixmapRequest *> requestedPixmaps;
 
         Okular::PixmapRequest *p = new Okular::PixmapRequest(this, m_current, full_width, full_height, devicePixelRatioF(), PAGEVIEW_PRIO, Okular::PixmapRequest::Asynchronous);
@@ -120,8 +124,10 @@ void MagnifierView::requestPixmap()
             p->setTile(true);
         }
 
-        // request a little bit bigger rectangle then currently viewed, but not the full scale page
-        const double rect_width = (nrect.right - nrect.left) * 0.5, rect_height = (nrect.bottom - nrect.top) * 0.5;
+        // request a little bit bigger rectangle then currently viewed, but not the full scale page;
+        // the document renders only the tiles of it that are missing, and takes the ones the page
+        // view has at this zoom or a higher one from it
+        const double rect_width = (nrect.right - nrect.left) * 0.25, rect_height = (nrect.bottom - nrect.top) * 0.25;
 
         const double top = qMax(nrect.top - rect_height, 0.0);
         const double bottom = qMin(nrect.bottom + rect_height, 1.0);
@@ -131,7 +137,8 @@ void MagnifierView::requestPixmap()
         p->setNormalizedRect(Okular::NormalizedRect(left, top, right, bottom));
         requestedPixmaps.push_back(p);
 
-        m_document->requestPixmaps(requestedPixmaps);
+        // what is left of the previous position is not wanted anymore
+        m_document->requestPixmaps(requestedPixmaps, Okular::Document::RemoveAllPrevious);
     }
 }
 
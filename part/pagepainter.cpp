@@ -9,12 +9,15 @@
 // qt / kde includes
 #include <KIconLoader>
 #include <QApplication>
+#include <QCache>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QIcon>
 #include <QPainter>
 #include <QPalette>
 #include <QPixmap>
 #include <QRect>
+#include <QScopedPointer>
 #include <QTransform>
 #include <QVarLengthArray>
 
@@ -27,6 +30,7 @@
 #include "core/page_p.h"
 #include "core/tile.h"
 #include "core/utils.h"
+#include "core/utils_p.h"
 #include "debug_ui.h"
 #include "guiutils.h"
 #include "settings.h"
@@ -36,6 +40,56 @@ Q_GLOBAL_STATIC_WITH_ARGS(QPixmap, busyPixmap, (QIcon::fromTheme(QLatin1String("
 
 #define TEXTANNOTATION_ICONSIZE 24
 
+// how much of the pixmaps with the color filter applied is kept, in KiB
+static const int kFilteredPixmapCacheSize = 128 * 1024;
+
+// the pixmaps with the color filter applied, by the QPixmap::cacheKey() of the
+// original ones, so a new pixmap of the page never hits the old one
+typedef QCache<qint64, QPixmap> FilteredPixmapCache;
+Q_GLOBAL_STATIC_WITH_ARGS(FilteredPixmapCache, filteredPixmaps, (kFilteredPixmapCacheSize))
+// the settings the pixmaps in filteredPixmaps have been filtered with
+Q_GLOBAL_STATIC(QString, filteredPixmapsSettings)
+
+// how much of the highlights and annotations drawn for the pages is kept, in KiB
+static const int kOverlayCacheSize = 64 * 1024;
+// pages bigger than this, in device pixels, get their highlights and annotations drawn on each paint
+static const qint64 kOverlayMaxPixels = 8 * 1024 * 1024;
+
+namespace
+{
+// the buffered highlights and annotations of a cropped page, drawn once on
+// transparent layers; a new layer starts each time the composition mode
+// changes, so compositing them in order gives what drawing them directly
+// on the page pixmap does
+struct Overlay {
+    QVector<QPair<QPainter::CompositionMode, QImage>> layers;
+};
+
+struct OverlayKey {
+    const Okular::Page *page;
+    const Okular::DocumentObserver *observer;
+    int flags;
+    QRect scaledCrop;
+    QSize scaledSize;
+    qreal dpr;
+
+    bool operator==(const OverlayKey &other) const
+    {
+        return page == other.page && observer == other.observer && flags == other.flags && scaledCrop == other.scaledCrop && scaledSize == other.scaledSize && dpr == other.dpr;
+    }
+};
+
+uint qHash(const OverlayKey &key, uint seed = 0)
+{
+    return ::qHash(key.page, seed) ^ ::qHash(key.observer, seed) ^ uint(key.scaledSize.width());
+}
+}
+
+typedef QCache<OverlayKey, Overlay> OverlayCache;
+Q_GLOBAL_STATIC_WITH_ARGS(OverlayCache, overlays, (kOverlayCacheSize))
+
+Q_GLOBAL_STATIC(PagePainter::FrameStatistics, frameStatistics)
+
 inline QPen buildPen(const Okular::Annotation *ann, double width, const QColor &color)
 {
     QColor c = color;
@@ -95,48 +149,81 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
         default:;
         }
     }
+
+    // the color filter of the accessibility settings is applied to the pixmaps
+    // once and kept, see filteredPixmap(), painting them again is then a plain blit
+    const bool bufferAccessibility = (flags & Accessibility) && Okular::SettingsCore::changeColors() && (Okular::SettingsCore::renderMode() != Okular::SettingsCore::EnumRenderMode::Paper);
+    auto colorFiltered = [bufferAccessibility](const QPixmap &source) { return bufferAccessibility ? filteredPixmap(source) : source; };
+    if (bufferAccessibility)
+        backgroundColor = filteredColor(paperColor);
     destPainter->fillRect(limits, backgroundColor);
 
+    const bool countFrameStatistics = Okular::Settings::debugFrameTimes() || Okular::Settings::debugLogFrameTimes();
+    QElapsedTimer scalingTimer;
+
     const bool hasTilesManager = page->hasTilesManager(observer);
     QPixmap pixmap;
+    // the small copy of the page that stands in for a missing or unusable pixmap
+    bool isPreview = false;
 
     if (!hasTilesManager) {
         /** 1 - RETRIEVE THE 'PAGE+ID' PIXMAP OR A SIMILAR 'PAGE' ONE **/
         const QPixmap *p = page->_o_nearestPixmap(observer, dScaledWidth, dScaledHeight);
 
         if (p != nullptr) {
-            pixmap = *p;
+            pixmap = colorFiltered(*p);
             pixmap.setDevicePixelRatio(dpr);
         }
 
-        /** 1B - IF NO PIXMAP, DRAW EMPTY PAGE **/
+        /** 1B - IF NO PIXMAP, DRAW THE PREVIEW OR AN EMPTY PAGE **/
         double pixmapRescaleRatio = !pixmap.isNull() ? dScaledWidth / (double)pixmap.width() : -1;
         long pixmapPixels = !pixmap.isNull() ? (long)pixmap.width() * (long)pixmap.height() : 0;
         if (pixmap.isNull() || pixmapRescaleRatio > 20.0 || pixmapRescaleRatio < 0.25 || (dScaledWidth > pixmap.width() && pixmapPixels > 60000000L)) {
-            // draw something on the blank page: the okular icon or a cross (as a fallback)
-            if (!busyPixmap()->isNull()) {
-                busyPixmap->setDevicePixelRatio(dpr);
-                destPainter->drawPixmap(QPoint(10, 10), *busyPixmap());
-            } else {
-                destPainter->setPen(Qt::gray);
-                destPainter->drawLine(0, 0, croppedWidth - 1, croppedHeight - 1);
-                destPainter->drawLine(0, croppedHeight - 1, croppedWidth - 1, 0);
+            pixmap = page->preview();
+            if (countFrameStatistics)
+                ++frameStatistics->pagesWithoutPixmap;
+            if (pixmap.isNull()) {
+                // draw something on the blank page: the okular icon or a cross (as a fallback)
+                if (!busyPixmap()->isNull()) {
+                    busyPixmap->setDevicePixelRatio(dpr);
+                    destPainter->drawPixmap(QPoint(10, 10), *busyPixmap());
+                } else {
+                    destPainter->setPen(Qt::gray);
+                    destPainter->drawLine(0, 0, croppedWidth - 1, croppedHeight - 1);
+                    destPainter->drawLine(0, croppedHeight - 1, croppedWidth - 1, 0);
+                }
+                return;
             }
-            return;
+            pixmap = colorFiltered(pixmap);
+            isPreview = true;
+        } else if (countFrameStatistics && pixmap.width() != dScaledWidth) {
+            ++frameStatistics->pagesWithoutPixmap;
         }
+    } else if (countFrameStatistics && !page->hasPixmap(observer, scaledWidth, scaledHeight, Okular::NormalizedRect(limits.translated(scaledCrop.topLeft()), scaledWidth, scaledHeight))) {
+        ++frameStatistics->pagesWithoutPixmap;
     }
 
     /** 2 - FIND OUT WHAT TO PAINT (Flags + Configuration + Presence) **/
-    bool canDrawHighlights = (flags & Highlights) && !page->m_highlights.isEmpty();
+    bool canDrawHighlights = (flags & Highlights) && page->hasHighlights();
     bool canDrawTextSelection = (flags & TextSelection) && page->textSelection();
     bool canDrawAnnotations = (flags & Annotations) && !page->m_annotations.isEmpty();
     bool enhanceLinks = (flags & EnhanceLinks) && Okular::Settings::highlightLinks();
     bool enhanceImages = (flags & EnhanceImages) && Okular::Settings::highlightImages();
 
+    // the buffered highlights and annotations are drawn for the whole cropped
+    // page and kept, painting it again then composites them in one blit; the
+    // text selection changes at each mouse move, it is drawn in the limits only
+    const OverlayKey overlayKey = {page, observer, flags & (Highlights | Annotations), scaledCrop, QSize(scaledWidth, scaledHeight), dpr};
+    const bool cacheOverlay = (canDrawHighlights || canDrawAnnotations) && (qint64)dScaledCrop.width() * dScaledCrop.height() <= kOverlayMaxPixels;
+    Overlay *overlay = cacheOverlay ? overlays->object(overlayKey) : nullptr;
+    QScopedPointer<Overlay> uncachedOverlay;
+    const QRect bufferedLimits = cacheOverlay ? QRect(0, 0, croppedWidth, croppedHeight) : limits;
+
     // vectors containing objects to draw
     // make this a qcolor, rect map, since we don't need
     // to know s_id here! we are only drawing this right?
     QList<QPair<QColor, Okular::NormalizedRect>> *bufferedHighlights = nullptr;
+    QList<QPair<QColor, Okular::NormalizedRect>> *selectionHighlights = nullptr;
     QList<Okular::Annotation *> *bufferedAnnotations = nullptr;
     QList<Okular::Annotation *> *unbufferedAnnotations = nullptr;
     Okular::Annotation *boundingRectOnlyAnn = nullptr; // Paint the bounding rect of this annotation
@@ -145,38 +232,30 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
         // precalc normalized 'limits rect' for intersection
         double nXMin = ((double)limits.left() / scaledWidth) + crop.left, nXMax = ((double)limits.right() / scaledWidth) + crop.left, nYMin = ((double)limits.top() / scaledHeight) + crop.top,
                nYMax = ((double)limits.bottom() / scaledHeight) + crop.top;
+        // and the one the buffered objects are looked for in
+        double bXMin = ((double)bufferedLimits.left() / scaledWidth) + crop.left, bXMax = ((double)bufferedLimits.right() / scaledWidth) + crop.left, bYMin = ((double)bufferedLimits.top() / scaledHeight) + crop.top,
+               bYMax = ((double)bufferedLimits.bottom() / scaledHeight) + crop.top;
         // append all highlights inside limits to their list
-        if (canDrawHighlights) {
+        if (canDrawHighlights && !overlay) {
             if (!bufferedHighlights)
                 bufferedHighlights = new QList<QPair<QColor, Okular::NormalizedRect>>();
             /*            else
                         {*/
 
-            Okular::NormalizedRect *limitRect = new Okular::NormalizedRect(nXMin, nYMin, nXMax, nYMax);
-            QLinkedList<Okular::HighlightAreaRect *>::const_iterator h2It = page->m_highlights.constBegin(), hEnd = page->m_highlights.constEnd();
-            Okular::HighlightAreaRect::const_iterator hIt;
-            for (; h2It != hEnd; ++h2It)
-                for (hIt = (*h2It)->constBegin(); hIt != (*h2It)->constEnd(); ++hIt) {
-                    if ((*hIt).intersects(limitRect))
-                        bufferedHighlights->append(qMakePair((*h2It)->color, *hIt));
-                }
-            delete limitRect;
+            page->highlightAreas(Okular::NormalizedRect(bXMin, bYMin, bXMax, bYMax), bufferedHighlights);
             //}
         }
         if (canDrawTextSelection) {
-            if (!bufferedHighlights)
-                bufferedHighlights = new QList<QPair<QColor, Okular::NormalizedRect>>();
-            /*            else
-                        {*/
-            Okular::NormalizedRect *limitRect = new Okular::NormalizedRect(nXMin, nYMin, nXMax, nYMax);
+            const Okular::NormalizedRect limitRect(nXMin, nYMin, nXMax, nYMax);
             const Okular::RegularAreaRect *textSelection = page->textSelection();
             Okular::HighlightAreaRect::const_iterator hIt = textSelection->constBegin(), hEnd = textSelection->constEnd();
             for (; hIt != hEnd; ++hIt) {
-                if ((*hIt).intersects(limitRect))
-                    bufferedHighlights->append(qMakePair(page->textSelectionColor(), *hIt));
+                if ((*hIt).intersects(limitRect)) {
+                    if (!selectionHighlights)
+                        selectionHighlights = new QList<QPair<QColor, Okular::NormalizedRect>>();
+                    selectionHighlights->append(qMakePair(page->textSelectionColor(), *hIt));
+                }
             }
-            delete limitRect;
-            //}
         }
         // append annotations inside limits to the un/buffered list
         if (canDrawAnnotations) {
@@ -197,6 +276,16 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
                     continue;
                 }
 
+                Okular::Annotation::SubType type = ann->subType();
+                if (type == Okular::Annotation::ALine || type == Okular::Annotation::AHighlight || type == Okular::Annotation::AInk /*|| (type == Annotation::AGeom && ann->style().opacity() < 0.99)*/) {
+                    if (!overlay && ann->transformedBoundingRectangle().intersects(bXMin, bYMin, bXMax, bYMax)) {
+                        if (!bufferedAnnotations)
+                            bufferedAnnotations = new QList<Okular::Annotation *>();
+                        bufferedAnnotations->append(ann);
+                    }
+                    continue;
+                }
+
                 bool intersects = ann->transformedBoundingRectangle().intersects(nXMin, nYMin, nXMax, nYMax);
                 if (ann->subType() == Okular::Annotation::AText) {
                     Okular::TextAnnotation *ta = static_cast<Okular::TextAnnotation *>(ann);
@@ -209,25 +298,47 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
                     }
                 }
                 if (intersects) {
-                    Okular::Annotation::SubType type = ann->subType();
-                    if (type == Okular::Annotation::ALine || type == Okular::Annotation::AHighlight || type == Okular::Annotation::AInk /*|| (type == Annotation::AGeom && ann->style().opacity() < 0.99)*/) {
-                        if (!bufferedAnnotations)
-                            bufferedAnnotations = new QList<Okular::Annotation *>();
-                        bufferedAnnotations->append(ann);
-                    } else {
-                        if (!unbufferedAnnotations)
-                            unbufferedAnnotations = new QList<Okular::Annotation *>();
-                        unbufferedAnnotations->append(ann);
-                    }
+                    if (!unbufferedAnnotations)
+                        unbufferedAnnotations = new QList<Okular::Annotation *>();
+                    unbufferedAnnotations->append(ann);
                 }
             }
         }
         // end of intersections checking
     }
 
+    /** 2B - DRAW THE BUFFERED OBJECTS OF THE WHOLE PAGE IF THEY ARE NOT KEPT YET **/
+    if (cacheOverlay && !overlay) {
+        overlay = new Overlay;
+        const QSize layerSize = QRectF(0, 0, croppedWidth * dpr, croppedHeight * dpr).toAlignedRect().size();
+        auto layer = [overlay, layerSize, dpr](RasterOperation op) -> QImage & {
+            const QPainter::CompositionMode mode = op == Multiply ? QPainter::CompositionMode_Multiply : QPainter::CompositionMode_SourceOver;
+            if (overlay->layers.isEmpty() || overlay->layers.last().first != mode) {
+                QImage image(layerSize, QImage::Format_ARGB32_Premultiplied);
+                image.setDevicePixelRatio(dpr);
+                image.fill(Qt::transparent);
+                overlay->layers.append(qMakePair(mode, image));
+            }
+            return overlay->layers.last().second;
+        };
+        drawBufferedObjects(layer, page, scaledWidth, scaledHeight, scaledCrop, crop, bufferedLimits, bufferedHighlights, bufferedAnnotations);
+
+        qint64 cost = 0;
+        for (const auto &l : qAsConst(overlay->layers))
+            cost += l.second.sizeInBytes() / 1024;
+        if (cost < kOverlayCacheSize)
+            overlays->insert(overlayKey, overlay, cost);
+        else
+            uncachedOverlay.reset(overlay);
+
+        delete bufferedHighlights;
+        bufferedHighlights = nullptr;
+        delete bufferedAnnotations;
+        bufferedAnnotations = nullptr;
+    }
+
     /** 3 - ENABLE BACKBUFFERING IF DIRECT IMAGE MANIPULATION IS NEEDED **/
-    bool bufferAccessibility = (flags & Accessibility) && Okular::SettingsCore::changeColors() && (Okular::SettingsCore::renderMode() != Okular::SettingsCore::EnumRenderMode::Paper);
-    bool useBackBuffer = bufferAccessibility || bufferedHighlights || bufferedAnnotations || viewPortPoint;
+    bool useBackBuffer = bufferedHighlights || bufferedAnnotations || selectionHighlights || (overlay && !overlay->layers.isEmpty()) || viewPortPoint;
     QPixmap *backPixmap = nullptr;
     QPainter *mixedPainter = nullptr;
     QRect limitsInPixmap = limits.translated(scaledCrop.topLeft());
@@ -236,8 +347,18 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
     // limits within full (scaled but uncropped) pixmap
 
     /** 4A -- REGULAR FLOW. PAINT PIXMAP NORMAL OR RESCALED USING GIVEN QPAINTER **/
+    if (countFrameStatistics)
+        scalingTimer.start();
     if (!useBackBuffer) {
         if (hasTilesManager) {
+            // what the tiles don't cover yet comes from the coarse copy of the page
+            const QPixmap *coarsePixmap = page->_o_nearestTilesPyramidPixmap(observer, dScaledWidth, dScaledHeight);
+            const QPixmap coarse = coarsePixmap ? *coarsePixmap : page->preview();
+            if (!coarse.isNull()) {
+                const QTransform transform(coarse.width() / (double)dScaledWidth, 0, 0, coarse.height() / (double)dScaledHeight, 0, 0);
+                destPainter->drawPixmap(QRectF(limits), colorFiltered(coarse), transform.mapRect(QRectF(dLimitsInPixmap)));
+            }
+
             const Okular::NormalizedRect normalizedLimits(limitsInPixmap, scaledWidth, scaledHeight);
             const QList<Okular::Tile> tiles = page->tilesAt(observer, normalizedLimits);
             QList<Okular::Tile>::const_iterator tIt = tiles.constBegin(), tEnd = tiles.constEnd();
@@ -249,23 +370,33 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
                 QRectF dLimitsInTile = dLimits & dTileRect;
 
                 if (!limitsInTile.isEmpty()) {
-                    QPixmap *tilePixmap = tile.pixmap();
-                    tilePixmap->setDevicePixelRatio(dpr);
+                    tile.pixmap()->setDevicePixelRatio(dpr);
+                    const QPixmap tilePixmap = colorFiltered(*tile.pixmap());
 
-                    if (tilePixmap->width() == dTileRect.width() && tilePixmap->height() == dTileRect.height()) {
-                        destPainter->drawPixmap(limitsInTile.topLeft(), *tilePixmap, dLimitsInTile.translated(-dTileRect.topLeft()));
+                    if (tilePixmap.width() == dTileRect.width() && tilePixmap.height() == dTileRect.height()) {
+                        destPainter->drawPixmap(limitsInTile.topLeft(), tilePixmap, dLimitsInTile.translated(-dTileRect.topLeft()));
                     } else {
-                        destPainter->drawPixmap(tileRect, *tilePixmap);
+                        destPainter->drawPixmap(tileRect, tilePixmap);
                     }
                 }
                 tIt++;
             }
+        } else if (isPreview) {
+            // only the part in the limits, the whole page may be huge at that size
+            const QTransform transform(pixmap.width() / (double)dScaledWidth, 0, 0, pixmap.height() / (double)dScaledHeight, 0, 0);
+            destPainter->save();
+            destPainter->setRenderHint(QPainter::SmoothPixmapTransform);
+            destPainter->drawPixmap(QRectF(limits), pixmap, transform.mapRect(QRectF(dLimitsInPixmap)));
+            destPainter->restore();
         } else {
             QPixmap scaledCroppedPixmap = pixmap.scaled(dScaledWidth, dScaledHeight).copy(dLimitsInPixmap);
             scaledCroppedPixmap.setDevicePixelRatio(dpr);
             destPainter->drawPixmap(limits.topLeft(), scaledCroppedPixmap, QRectF(0, 0, dLimits.width(), dLimits.height()));
         }
 
+        if (countFrameStatistics)
+            frameStatistics->scalingNsecs += scalingTimer.nsecsElapsed();
+
         // 4A.2. active painter is the one passed to this method
         mixedPainter = destPainter;
     }
@@ -274,10 +405,17 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
         // the image over which we are going to draw
         QImage backImage = QImage(dLimits.width(), dLimits.height(), QImage::Format_ARGB32_Premultiplied);
         backImage.setDevicePixelRatio(dpr);
-        backImage.fill(paperColor);
+        backImage.fill(bufferAccessibility ? backgroundColor : paperColor);
         QPainter p(&backImage);
 
         if (hasTilesManager) {
+            const QPixmap *coarsePixmap = page->_o_nearestTilesPyramidPixmap(observer, dScaledWidth, dScaledHeight);
+            const QPixmap coarse = coarsePixmap ? *coarsePixmap : page->preview();
+            if (!coarse.isNull()) {
+                const QTransform transform(coarse.width() / (double)dScaledWidth, 0, 0, coarse.height() / (double)dScaledHeight, 0, 0);
+                p.drawPixmap(QRectF(0, 0, limits.width(), limits.height()), colorFiltered(coarse), transform.mapRect(QRectF(dLimitsInPixmap)));
+            }
+
             const Okular::NormalizedRect normalizedLimits(limitsInPixmap, scaledWidth, scaledHeight);
             const QList<Okular::Tile> tiles = page->tilesAt(observer, normalizedLimits);
             QList<Okular::Tile>::const_iterator tIt = tiles.constBegin(), tEnd = tiles.constEnd();
@@ -289,20 +427,24 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
                 QRect dLimitsInTile = dLimits & dTileRect;
 
                 if (!limitsInTile.isEmpty()) {
-                    QPixmap *tilePixmap = tile.pixmap();
-                    tilePixmap->setDevicePixelRatio(dpr);
+                    tile.pixmap()->setDevicePixelRatio(dpr);
+                    const QPixmap tilePixmap = colorFiltered(*tile.pixmap());
 
-                    if (tilePixmap->width() == dTileRect.width() && tilePixmap->height() == dTileRect.height()) {
-                        p.drawPixmap(limitsInTile.translated(-limits.topLeft()).topLeft(), *tilePixmap, dLimitsInTile.translated(-dTileRect.topLeft()));
+                    if (tilePixmap.width() == dTileRect.width() && tilePixmap.height() == dTileRect.height()) {
+                        p.drawPixmap(limitsInTile.translated(-limits.topLeft()).topLeft(), tilePixmap, dLimitsInTile.translated(-dTileRect.topLeft()));
                     } else {
-                        double xScale = tilePixmap->width() / (double)dTileRect.width();
-                        double yScale = tilePixmap->height() / (double)dTileRect.height();
+                        double xScale = tilePixmap.width() / (double)dTileRect.width();
+                        double yScale = tilePixmap.height() / (double)dTileRect.height();
                         QTransform transform(xScale, 0, 0, yScale, 0, 0);
-                        p.drawPixmap(limitsInTile.translated(-limits.topLeft()), *tilePixmap, transform.mapRect(dLimitsInTile).translated(-transform.mapRect(dTileRect).topLeft()));
+                        p.drawPixmap(limitsInTile.translated(-limits.topLeft()), tilePixmap, transform.mapRect(dLimitsInTile).translated(-transform.mapRect(dTileRect).topLeft()));
                     }
                 }
                 ++tIt;
             }
+        } else if (isPreview) {
+            const QTransform transform(pixmap.width() / (double)dScaledWidth, 0, 0, pixmap.height() / (double)dScaledHeight, 0, 0);
+            p.setRenderHint(QPainter::SmoothPixmapTransform);
+            p.drawPixmap(QRectF(0, 0, limits.width(), limits.height()), pixmap, transform.mapRect(QRectF(dLimitsInPixmap)));
         } else {
             // 4B.1. draw the page pixmap: normal or scaled
             QPixmap scaledCroppedPixmap = pixmap.scaled(dScaledWidth, dScaledHeight).copy(dLimitsInPixmap);
@@ -311,171 +453,30 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
         }
 
         p.end();
+        if (countFrameStatistics)
+            frameStatistics->scalingNsecs += scalingTimer.nsecsElapsed();
 
-        // 4B.2. modify pixmap following accessibility settings
-        if (bufferAccessibility) {
-            switch (Okular::SettingsCore::renderMode()) {
-            case Okular::SettingsCore::EnumRenderMode::Inverted:
-                // Invert image pixels using QImage internal function
-                backImage.invertPixels(QImage::InvertRgb);
-                break;
-            case Okular::SettingsCore::EnumRenderMode::Recolor:
-                recolor(&backImage, Okular::Settings::recolorForeground(), Okular::Settings::recolorBackground());
-                break;
-            case Okular::SettingsCore::EnumRenderMode::BlackWhite:
-                blackWhite(&backImage, Okular::Settings::bWContrast(), Okular::Settings::bWThreshold());
-                break;
-            case Okular::SettingsCore::EnumRenderMode::InvertLightness:
-                invertLightness(&backImage);
-                break;
-            case Okular::SettingsCore::EnumRenderMode::InvertLuma:
-                invertLuma(&backImage, 0.2126, 0.7152, 0.0722); // sRGB / Rec. 709 luma coefficients
-                break;
-            case Okular::SettingsCore::EnumRenderMode::InvertLumaSymmetric:
-                invertLuma(&backImage, 0.3333, 0.3334, 0.3333); // Symmetric coefficients, to keep colors saturated.
-                break;
-            case Okular::SettingsCore::EnumRenderMode::HueShiftPositive:
-                hueShiftPositive(&backImage);
-                break;
-            case Okular::SettingsCore::EnumRenderMode::HueShiftNegative:
-                hueShiftNegative(&backImage);
-                break;
-            }
-        }
+        // 4B.2. the pixmaps have the accessibility settings applied already
 
-        // 4B.3. highlight rects in page
-        if (bufferedHighlights) {
-            // draw highlights that are inside the 'limits' paint region
-            for (const auto &highlight : qAsConst(*bufferedHighlights)) {
-                const Okular::NormalizedRect &r = highlight.second;
-                // find out the rect to highlight on pixmap
-                QRect highlightRect = r.geometry(scaledWidth, scaledHeight).translated(-scaledCrop.topLeft()).intersected(limits);
-                highlightRect.translate(-limits.left(), -limits.top());
-
-                const QColor highlightColor = highlight.first;
-                QPainter painter(&backImage);
-                painter.setCompositionMode(QPainter::CompositionMode_Multiply);
-                painter.fillRect(highlightRect, highlightColor);
-
-                auto frameColor = highlightColor.darker(150);
-                const QRect frameRect = r.geometry(scaledWidth, scaledHeight).translated(-scaledCrop.topLeft()).translated(-limits.left(), -limits.top());
-                painter.setPen(frameColor);
-                painter.drawRect(frameRect);
+        // 4B.3. highlight rects in page and 4B.4. annotations [COMPOSITED ONES]
+        if (overlay) {
+            QPainter painter(&backImage);
+            for (const auto &layer : qAsConst(overlay->layers)) {
+                painter.setCompositionMode(layer.first);
+                painter.drawImage(QPointF(0, 0), layer.second, dLimits);
             }
-        }
-
-        // 4B.4. paint annotations [COMPOSITED ONES]
-        if (bufferedAnnotations) {
+        } else if (bufferedHighlights || bufferedAnnotations) {
             // Albert: This is quite "heavy" but all the backImage that reach here are QImage::Format_ARGB32_Premultiplied
             // and have to be so that the QPainter::CompositionMode_Multiply works
             // we could also put a
             // backImage = backImage.convertToFormat(QImage::Format_ARGB32_Premultiplied)
             // that would be almost a noop, but we'll leave the assert for now
             Q_ASSERT(backImage.format() == QImage::Format_ARGB32_Premultiplied);
-            // precalc constants for normalizing [0,1] page coordinates into normalized [0,1] limit rect coordinates
-            double pageScale = (double)croppedWidth / page->width();
-            double xOffset = (double)limits.left() / (double)scaledWidth + crop.left, xScale = (double)scaledWidth / (double)limits.width(), yOffset = (double)limits.top() / (double)scaledHeight + crop.top,
-                   yScale = (double)scaledHeight / (double)limits.height();
-
-            // paint all buffered annotations in the page
-            QList<Okular::Annotation *>::const_iterator aIt = bufferedAnnotations->constBegin(), aEnd = bufferedAnnotations->constEnd();
-            for (; aIt != aEnd; ++aIt) {
-                Okular::Annotation *a = *aIt;
-                Okular::Annotation::SubType type = a->subType();
-                QColor acolor = a->style().color();
-                if (!acolor.isValid())
-                    acolor = Qt::yellow;
-                acolor.setAlphaF(a->style().opacity());
-
-                // draw LineAnnotation MISSING: caption, dash pattern, endings for multipoint lines
-                if (type == Okular::Annotation::ALine) {
-                    LineAnnotPainter linepainter {(Okular::LineAnnotation *)a, {page->width(), page->height()}, pageScale, {xScale, 0., 0., yScale, -xOffset * xScale, -yOffset * yScale}};
-                    linepainter.draw(backImage);
-                }
-                // draw HighlightAnnotation MISSING: under/strike width, feather, capping
-                else if (type == Okular::Annotation::AHighlight) {
-                    // get the annotation
-                    Okular::HighlightAnnotation *ha = (Okular::HighlightAnnotation *)a;
-                    Okular::HighlightAnnotation::HighlightType type = ha->highlightType();
-
-                    // draw each quad of the annotation
-                    int quads = ha->highlightQuads().size();
-                    for (int q = 0; q < quads; q++) {
-                        NormalizedPath path;
-                        const Okular::HighlightAnnotation::Quad &quad = ha->highlightQuads()[q];
-                        // normalize page point to image
-                        for (int i = 0; i < 4; i++) {
-                            Okular::NormalizedPoint point;
-                            point.x = (quad.transformedPoint(i).x - xOffset) * xScale;
-                            point.y = (quad.transformedPoint(i).y - yOffset) * yScale;
-                            path.append(point);
-                        }
-                        // draw the normalized path into image
-                        switch (type) {
-                        // highlight the whole rect
-                        case Okular::HighlightAnnotation::Highlight:
-                            drawShapeOnImage(backImage, path, true, Qt::NoPen, acolor, pageScale, Multiply);
-                            break;
-                        // highlight the bottom part of the rect
-                        case Okular::HighlightAnnotation::Squiggly:
-                            path[3].x = (path[0].x + path[3].x) / 2.0;
-                            path[3].y = (path[0].y + path[3].y) / 2.0;
-                            path[2].x = (path[1].x + path[2].x) / 2.0;
-                            path[2].y = (path[1].y + path[2].y) / 2.0;
-                            drawShapeOnImage(backImage, path, true, Qt::NoPen, acolor, pageScale, Multiply);
-                            break;
-                        // make a line at 3/4 of the height
-                        case Okular::HighlightAnnotation::Underline:
-                            path[0].x = (3 * path[0].x + path[3].x) / 4.0;
-                            path[0].y = (3 * path[0].y + path[3].y) / 4.0;
-                            path[1].x = (3 * path[1].x + path[2].x) / 4.0;
-                            path[1].y = (3 * path[1].y + path[2].y) / 4.0;
-                            path.pop_back();
-                            path.pop_back();
-                            drawShapeOnImage(backImage, path, false, QPen(acolor, 2), QBrush(), pageScale);
-                            break;
-                        // make a line at 1/2 of the height
-                        case Okular::HighlightAnnotation::StrikeOut:
-                            path[0].x = (path[0].x + path[3].x) / 2.0;
-                            path[0].y = (path[0].y + path[3].y) / 2.0;
-                            path[1].x = (path[1].x + path[2].x) / 2.0;
-                            path[1].y = (path[1].y + path[2].y) / 2.0;
-                            path.pop_back();
-                            path.pop_back();
-                            drawShapeOnImage(backImage, path, false, QPen(acolor, 2), QBrush(), pageScale);
-                            break;
-                        }
-                    }
-                }
-                // draw InkAnnotation MISSING:invar width, PENTRACER
-                else if (type == Okular::Annotation::AInk) {
-                    // get the annotation
-                    Okular::InkAnnotation *ia = (Okular::InkAnnotation *)a;
-
-                    // draw each ink path
-                    const QList<QLinkedList<Okular::NormalizedPoint>> transformedInkPaths = ia->transformedInkPaths();
-
-                    const QPen inkPen = buildPen(a, a->style().width(), acolor);
-
-                    int paths = transformedInkPaths.size();
-                    for (int p = 0; p < paths; p++) {
-                        NormalizedPath path;
-                        const QLinkedList<Okular::NormalizedPoint> &inkPath = transformedInkPaths[p];
-
-                        // normalize page point to image
-                        QLinkedList<Okular::NormalizedPoint>::const_iterator pIt = inkPath.constBegin(), pEnd = inkPath.constEnd();
-                        for (; pIt != pEnd; ++pIt) {
-                            const Okular::NormalizedPoint &inkPoint = *pIt;
-                            Okular::NormalizedPoint point;
-                            point.x = (inkPoint.x - xOffset) * xScale;
-                            point.y = (inkPoint.y - yOffset) * yScale;
-                            path.append(point);
-                        }
-                        // draw the normalized path into image
-                        drawShapeOnImage(backImage, path, false, inkPen, QBrush(), pageScale);
-                    }
-                }
-            } // end current annotation drawing
+            drawBufferedObjects([&backImage](RasterOperation) -> QImage & { return backImage; }, page, scaledWidth, scaledHeight, scaledCrop, crop, limits, bufferedHighlights, bufferedAnnotations);
+        }
+        if (selectionHighlights) {
+            Q_ASSERT(backImage.format() == QImage::Format_ARGB32_Premultiplied);
+            drawBufferedObjects([&backImage](RasterOperation) -> QImage & { return backImage; }, page, scaledWidth, scaledHeight, scaledCrop, crop, limits, selectionHighlights, nullptr);
         }
         if (viewPortPoint) {
             QPainter painter(&backImage);
@@ -686,9 +687,245 @@ void PagePainter::paintCroppedPageOnPainter(QPainter *destPainter,
     // delete object containers
     delete bufferedHighlights;
     delete bufferedAnnotations;
+    delete selectionHighlights;
     delete unbufferedAnnotations;
 }
 
+void PagePainter::drawBufferedObjects(const BufferedTarget &target,
+                                      const Okular::Page *page,
+                                      int scaledWidth,
+                                      int scaledHeight,
+                                      const QRect &scaledCrop,
+                                      const Okular::NormalizedRect &crop,
+                                      const QRect &limits,
+                                      const QList<QPair<QColor, Okular::NormalizedRect>> *highlights,
+                                      const QList<Okular::Annotation *> *annotations)
+{
+    if (highlights) {
+        // draw highlights that are inside the 'limits' paint region
+        for (const auto &highlight : qAsConst(*highlights)) {
+            const Okular::NormalizedRect &r = highlight.second;
+            // find out the rect to highlight on pixmap
+            QRect highlightRect = r.geometry(scaledWidth, scaledHeight).translated(-scaledCrop.topLeft()).intersected(limits);
+            highlightRect.translate(-limits.left(), -limits.top());
+
+            const QColor highlightColor = highlight.first;
+            QPainter painter(&target(Multiply));
+            painter.setCompositionMode(QPainter::CompositionMode_Multiply);
+            painter.fillRect(highlightRect, highlightColor);
+
+            auto frameColor = highlightColor.darker(150);
+            const QRect frameRect = r.geometry(scaledWidth, scaledHeight).translated(-scaledCrop.topLeft()).translated(-limits.left(), -limits.top());
+            painter.setPen(frameColor);
+            painter.drawRect(frameRect);
+        }
+    }
+
+    if (annotations) {
+        // precalc constants for normalizing [0,1] page coordinates into normalized [0,1] limit rect coordinates
+        double pageScale = (double)scaledCrop.width() / page->width();
+        double xOffset = (double)limits.left() / (double)scaledWidth + crop.left, xScale = (double)scaledWidth / (double)limits.width(), yOffset = (double)limits.top() / (double)scaledHeight + crop.top,
+               yScale = (double)scaledHeight / (double)limits.height();
+
+        // paint all buffered annotations in the page
+        QList<Okular::Annotation *>::const_iterator aIt = annotations->constBegin(), aEnd = annotations->constEnd();
+        for (; aIt != aEnd; ++aIt) {
+            Okular::Annotation *a = *aIt;
+            Okular::Annotation::SubType type = a->subType();
+            QColor acolor = a->style().color();
+            if (!acolor.isValid())
+                acolor = Qt::yellow;
+            acolor.setAlphaF(a->style().opacity());
+
+            // draw LineAnnotation MISSING: caption, dash pattern, endings for multipoint lines
+            if (type == Okular::Annotation::ALine) {
+                LineAnnotPainter linepainter {(Okular::LineAnnotation *)a, {page->width(), page->height()}, pageScale, {xScale, 0., 0., yScale, -xOffset * xScale, -yOffset * yScale}};
+                linepainter.draw(target(Normal));
+            }
+            // draw HighlightAnnotation MISSING: under/strike width, feather, capping
+            else if (type == Okular::Annotation::AHighlight) {
+                // get the annotation
+                Okular::HighlightAnnotation *ha = (Okular::HighlightAnnotation *)a;
+                Okular::HighlightAnnotation::HighlightType type = ha->highlightType();
+
+                // draw each quad of the annotation
+                int quads = ha->highlightQuads().size();
+                for (int q = 0; q < quads; q++) {
+                    NormalizedPath path;
+                    const Okular::HighlightAnnotation::Quad &quad = ha->highlightQuads()[q];
+                    // normalize page point to image
+                    for (int i = 0; i < 4; i++) {
+                        Okular::NormalizedPoint point;
+                        point.x = (quad.transformedPoint(i).x - xOffset) * xScale;
+                        point.y = (quad.transformedPoint(i).y - yOffset) * yScale;
+                        path.append(point);
+                    }
+                    // draw the normalized path into image
+                    switch (type) {
+                    // highlight the whole rect
+                    case Okular::HighlightAnnotation::Highlight:
+                        drawShapeOnImage(target(Multiply), path, true, Qt::NoPen, acolor, pageScale, Multiply);
+                        break;
+                    // highlight the bottom part of the rect
+                    case Okular::HighlightAnnotation::Squiggly:
+                        path[3].x = (path[0].x + path[3].x) / 2.0;
+                        path[3].y = (path[0].y + path[3].y) / 2.0;
+                        path[2].x = (path[1].x + path[2].x) / 2.0;
+                        path[2].y = (path[1].y + path[2].y) / 2.0;
+                        drawShapeOnImage(target(Multiply), path, true, Qt::NoPen, acolor, pageScale, Multiply);
+                        break;
+                    // make a line at 3/4 of the height
+                    case Okular::HighlightAnnotation::Underline:
+                        path[0].x = (3 * path[0].x + path[3].x) / 4.0;
+                        path[0].y = (3 * path[0].y + path[3].y) / 4.0;
+                        path[1].x = (3 * path[1].x + path[2].x) / 4.0;
+                        path[1].y = (3 * path[1].y + path[2].y) / 4.0;
+                        path.pop_back();
+                        path.pop_back();
+                        drawShapeOnImage(target(Normal), path, false, QPen(acolor, 2), QBrush(), pageScale);
+                        break;
+                    // make a line at 1/2 of the height
+                    case Okular::HighlightAnnotation::StrikeOut:
+                        path[0].x = (path[0].x + path[3].x) / 2.0;
+                        path[0].y = (path[0].y + path[3].y) / 2.0;
+                        path[1].x = (path[1].x + path[2].x) / 2.0;
+                        path[1].y = (path[1].y + path[2].y) / 2.0;
+                        path.pop_back();
+                        path.pop_back();
+                        drawShapeOnImage(target(Normal), path, false, QPen(acolor, 2), QBrush(), pageScale);
+                        break;
+                    }
+                }
+            }
+            // draw InkAnnotation MISSING:invar width, PENTRACER
+            else if (type == Okular::Annotation::AInk) {
+                // get the annotation
+                Okular::InkAnnotation *ia = (Okular::InkAnnotation *)a;
+
+                // draw each ink path
+                const QList<QLinkedList<Okular::NormalizedPoint>> transformedInkPaths = ia->transformedInkPaths();
+
+                const QPen inkPen = buildPen(a, a->style().width(), acolor);
+
+                int paths = transformedInkPaths.size();
+                for (int p = 0; p < paths; p++) {
+                    NormalizedPath path;
+                    const QLinkedList<Okular::NormalizedPoint> &inkPath = transformedInkPaths[p];
+
+                    // normalize page point to image
+                    QLinkedList<Okular::NormalizedPoint>::const_iterator pIt = inkPath.constBegin(), pEnd = inkPath.constEnd();
+                    for (; pIt != pEnd; ++pIt) {
+                        const Okular::NormalizedPoint &inkPoint = *pIt;
+                        Okular::NormalizedPoint point;
+                        point.x = (inkPoint.x - xOffset) * xScale;
+                        point.y = (inkPoint.y - yOffset) * yScale;
+                        path.append(point);
+                    }
+                    // draw the normalized path into image
+                    drawShapeOnImage(target(Normal), path, false, inkPen, QBrush(), pageScale);
+                }
+            }
+        } // end current annotation drawing
+    }
+}
+
+void PagePainter::invalidateOverlays(const Okular::Page *page)
+{
+    const QList<OverlayKey> keys = overlays->keys();
+    for (const OverlayKey &key : keys) {
+        if (key.page == page)
+            overlays->remove(key);
+    }
+}
+
+void PagePainter::clearOverlays()
+{
+    overlays->clear();
+}
+
+PagePainter::FrameStatistics PagePainter::takeFrameStatistics()
+{
+    const FrameStatistics statistics = *frameStatistics;
+    *frameStatistics = FrameStatistics();
+    return statistics;
+}
+
+QString PagePainter::colorFilterSettings()
+{
+    return QStringLiteral("%1 %2 %3 %4 %5")
+        .arg(Okular::SettingsCore::renderMode())
+        .arg(Okular::Settings::recolorForeground().name(), Okular::Settings::recolorBackground().name())
+        .arg(Okular::Settings::bWContrast())
+        .arg(Okular::Settings::bWThreshold());
+}
+
+void PagePainter::applyColorFilter(QImage *image)
+{
+    switch (Okular::SettingsCore::renderMode()) {
+    case Okular::SettingsCore::EnumRenderMode::Inverted:
+        // Invert image pixels using QImage internal function
+        image->invertPixels(QImage::InvertRgb);
+        break;
+    case Okular::SettingsCore::EnumRenderMode::Recolor:
+        recolor(image, Okular::Settings::recolorForeground(), Okular::Settings::recolorBackground());
+        break;
+    case Okular::SettingsCore::EnumRenderMode::BlackWhite:
+        blackWhite(image, Okular::Settings::bWContrast(), Okular::Settings::bWThreshold());
+        break;
+    case Okular::SettingsCore::EnumRenderMode::InvertLightness:
+        invertLightness(image);
+        break;
+    case Okular::SettingsCore::EnumRenderMode::InvertLuma:
+        invertLuma(image, 0.2126, 0.7152, 0.0722); // sRGB / Rec. 709 luma coefficients
+        break;
+    case Okular::SettingsCore::EnumRenderMode::InvertLumaSymmetric:
+        invertLuma(image, 0.3333, 0.3334, 0.3333); // Symmetric coefficients, to keep colors saturated.
+        break;
+    case Okular::SettingsCore::EnumRenderMode::HueShiftPositive:
+        hueShiftPositive(image);
+        break;
+    case Okular::SettingsCore::EnumRenderMode::HueShiftNegative:
+        hueShiftNegative(image);
+        break;
+    }
+}
+
+QPixmap PagePainter::filteredPixmap(const QPixmap &pixmap)
+{
+    const QString settings = colorFilterSettings();
+    if (*filteredPixmapsSettings() != settings) {
+        filteredPixmaps()->clear();
+        *filteredPixmapsSettings() = settings;
+    }
+
+    const qint64 key = pixmap.cacheKey();
+    if (const QPixmap *filtered = filteredPixmaps()->object(key))
+        return *filtered;
+
+    // over the white paper, like the page is painted
+    QImage image(pixmap.width(), pixmap.height(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::white);
+    QPainter p(&image);
+    p.drawPixmap(QRectF(image.rect()), pixmap, QRectF(pixmap.rect()));
+    p.end();
+    applyColorFilter(&image);
+
+    QPixmap *filtered = new QPixmap(QPixmap::fromImage(image));
+    filtered->setDevicePixelRatio(pixmap.devicePixelRatio());
+    const QPixmap result = *filtered;
+    // too big pixmaps are not kept, QCache deletes them right away
+    filteredPixmaps()->insert(key, filtered, qMax<qint64>(1, image.sizeInBytes() / 1024));
+    return result;
+}
+
+QColor PagePainter::filteredColor(const QColor &color)
+{
+    QImage image(1, 1, QImage::Format_ARGB32_Premultiplied);
+    image.fill(color);
+    applyColorFilter(&image);
+    return image.pixelColor(0, 0);
+}
+
 void PagePainter::recolor(QImage *image, const QColor &foreground, const QColor &background)
 {
     if (image->format() != QImage::Format_ARGB32_Premultiplied) {
@@ -706,19 +943,21 @@ void PagePainter::recolor(QImage *image, const QColor &foreground, const QColor
     const int foreground_green = foreground.green();
     const int foreground_blue = foreground.blue();
 
-    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    const int pixels = image->width() * image->height();
-
-    for (int i = 0; i < pixels; ++i) {
-        const int lightness = qGray(data[i]);
-
+    // the new color only depends on the lightness, compute the 256 of them once
+    QRgb colors[256];
+    for (int lightness = 0; lightness < 256; ++lightness) {
         const float r = scaleRed * lightness + foreground_red;
         const float g = scaleGreen * lightness + foreground_green;
         const float b = scaleBlue * lightness + foreground_blue;
-
-        const unsigned a = qAlpha(data[i]);
-        data[i] = qRgba(r, g, b, a);
+        colors[lightness] = qRgba(r, g, b, 0);
     }
+
+    QRgb *data = reinterpret_cast<QRgb *>(image->bits());
+    const int width = image->width();
+    Okular::forEachRowBand(width, image->height(), [&](int begin, int end) {
+        for (int i = begin * width; i < end * width; ++i)
+            data[i] = colors[qGray(data[i])] | (data[i] & 0xff000000);
+    });
 }
 
 void PagePainter::blackWhite(QImage *image, int contrast, int threshold)
@@ -727,10 +966,11 @@ void PagePainter::blackWhite(QImage *image, int contrast, int threshold)
     int con = contrast;
     int thr = 255 - threshold;
 
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
+    // the new gray only depends on the old one, compute the 256 of them once
+    QRgb grays[256];
+    for (int gray = 0; gray < 256; ++gray) {
         // Piecewise linear function of val, through (0, 0), (thr, 128), (255, 255)
-        int val = qGray(data[i]);
+        int val = gray;
         if (val > thr)
             val = 128 + (127 * (val - thr)) / (255 - thr);
         else if (val < thr)
@@ -742,9 +982,14 @@ void PagePainter::blackWhite(QImage *image, int contrast, int threshold)
             val = qBound(0, val, 255);
         }
 
-        const unsigned a = qAlpha(data[i]);
-        data[i] = qRgba(val, val, val, a);
+        grays[gray] = qRgba(val, val, val, 0);
     }
+
+    const int width = image->width();
+    Okular::forEachRowBand(width, image->height(), [&](int begin, int end) {
+        for (int i = begin * width; i < end * width; ++i)
+            data[i] = grays[qGray(data[i])] | (data[i] & 0xff000000);
+    });
 }
 
 void PagePainter::invertLightness(QImage *image)
@@ -757,40 +1002,30 @@ void PagePainter::invertLightness(QImage *image)
     Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
 
     QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        // Invert lightness of the pixel using the cylindric HSL color model.
-        // Algorithm is based on https://en.wikipedia.org/wiki/HSL_and_HSV#HSL_to_RGB (2019-03-17).
-        // Important simplifications are that inverting lightness does not change chroma and hue.
-        // This means the sector (of the chroma/hue plane) is not changed,
-        // so we can use a linear calculation after determining the sector using qMin() and qMax().
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
-
-        // Get only the needed HSL components. These are chroma C and the common component m.
-        // Get common component m
-        uchar m = qMin(R, qMin(G, B));
-        // Remove m from color components
-        R -= m;
-        G -= m;
-        B -= m;
-        // Get chroma C
-        uchar C = qMax(R, qMax(G, B));
-
-        // Get common component m' after inverting lightness L.
-        // Hint: Lightness L = m + C / 2; L' = 255 - L = 255 - (m + C / 2) => m' = 255 - C - m
-        uchar m_ = 255 - C - m;
-
-        // Add m' to color compontents
-        R += m_;
-        G += m_;
-        B += m_;
-
-        // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(R, G, B, A);
-    }
+    const int width = image->width();
+    Okular::forEachRowBand(width, image->height(), [&](int begin, int end) {
+        for (int i = begin * width; i < end * width; ++i) {
+            // Invert lightness of the pixel using the cylindric HSL color model.
+            // Algorithm is based on https://en.wikipedia.org/wiki/HSL_and_HSV#HSL_to_RGB (2019-03-17).
+            // Important simplifications are that inverting lightness does not change chroma and hue.
+            // This means the sector (of the chroma/hue plane) is not changed,
+            // so we can use a linear calculation after determining the sector using qMin() and qMax().
+            const int R = qRed(data[i]);
+            const int G = qGreen(data[i]);
+            const int B = qBlue(data[i]);
+
+            // Get only the needed HSL components: the common component m and chroma C = max - m.
+            // Lightness L = m + C / 2; L' = 255 - L = 255 - (m + C / 2) => m' = 255 - C - m,
+            // so each component c - m + m' becomes c + 255 - max - m.
+            // Branchless and in integers, so the compiler can do several pixels at once.
+            const int m = qMin(R, qMin(G, B));
+            const int max = qMax(R, qMax(G, B));
+            const int shift = 255 - max - m;
+
+            // Save new color
+            data[i] = (data[i] & 0xff000000) | ((R + shift) << 16) | ((G + shift) << 8) | (B + shift);
+        }
+    });
 }
 
 void PagePainter::invertLuma(QImage *image, float Y_R, float Y_G, float Y_B)
@@ -803,18 +1038,29 @@ void PagePainter::invertLuma(QImage *image, float Y_R, float Y_G, float Y_B)
     Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
 
     QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
-
-        invertLumaPixel(R, G, B, Y_R, Y_G, Y_B);
+    const int width = image->width();
+    Okular::forEachRowBand(width, image->height(), [&](int begin, int end) {
+        // pages are mostly runs of the same color, the background above all, so
+        // only compute a color again when it changes
+        QRgb lastColor = 0;
+        QRgb lastInverted = qRgba(255, 255, 255, 0);
+        for (int i = begin * width; i < end * width; ++i) {
+            const QRgb color = data[i] & 0x00ffffff;
+            if (color != lastColor) {
+                uchar R = qRed(color);
+                uchar G = qGreen(color);
+                uchar B = qBlue(color);
+
+                invertLumaPixel(R, G, B, Y_R, Y_G, Y_B);
+
+                lastColor = color;
+                lastInverted = qRgba(R, G, B, 0);
+            }
 
-        // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(R, G, B, A);
-    }
+            // Save new color
+            data[i] = lastInverted | (data[i] & 0xff000000);
+        }
+    });
 }
 
 void PagePainter::invertLumaPixel(uchar &R, uchar &G, uchar &B, float Y_R, float Y_G, float Y_B)
@@ -911,16 +1157,14 @@ void PagePainter::hueShiftPositive(QImage *image)
     Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
 
     QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
-
-        // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(B, R, G, A);
-    }
+    const int width = image->width();
+    Okular::forEachRowBand(width, image->height(), [&](int begin, int end) {
+        for (int i = begin * width; i < end * width; ++i) {
+            // Save new color: red from blue, green from red, blue from green,
+            // moving the bits so the compiler can do several pixels at once
+            data[i] = (data[i] & 0xff000000) | ((data[i] & 0x000000ff) << 16) | ((data[i] >> 8) & 0x0000ffff);
+        }
+    });
 }
 
 void PagePainter::hueShiftNegative(QImage *image)
@@ -933,16 +1177,13 @@ void PagePainter::hueShiftNegative(QImage *image)
     Q_ASSERT(image->format() == QImage::Format_ARGB32_Premultiplied);
 
     QRgb *data = reinterpret_cast<QRgb *>(image->bits());
-    int pixels = image->width() * image->height();
-    for (int i = 0; i < pixels; ++i) {
-        uchar R = qRed(data[i]);
-        uchar G = qGreen(data[i]);
-        uchar B = qBlue(data[i]);
-
-        // Save new color
-        const unsigned A = qAlpha(data[i]);
-        data[i] = qRgba(G, B, R, A);
-    }
+    const int width = image->width();
+    Okular::forEachRowBand(width, image->height(), [&](int begin, int end) {
+        for (int i = begin * width; i < end * width; ++i) {
+            // Save new color: red from green, green from blue, blue from red
+            data[i] = (data[i] & 0xff000000) | ((data[i] << 8) & 0x00ffff00) | ((data[i] >> 16) & 0x000000ff);
+        }
+    });
 }
 
 void PagePainter::drawShapeOnImage(QImage &image, const NormalizedPath &normPath, bool closeShape, const QPen &pen, const QBrush &brush, double penWidthMultiplier, RasterOperation op
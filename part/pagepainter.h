@@ -11,6 +11,8 @@
 #include <QImage>
 #include <QPen>
 
+#include <functional>
+
 #include "core/annotations.h"
 #include "core/area.h" // for NormalizedPoint
 
@@ -68,8 +70,53 @@ public:
                                           const Okular::NormalizedRect &crop,
                                           Okular::NormalizedPoint *viewPortPoint);
 
+    /**
+     * Drops the highlights and annotations of @p page kept for painting it
+     * again, see paintCroppedPageOnPainter(). To be called when an observer
+     * is notified that they changed.
+     */
+    static void invalidateOverlays(const Okular::Page *page);
+
+    /**
+     * Drops the highlights and annotations kept for all the pages.
+     */
+    static void clearOverlays();
+
+    /**
+     * What went into painting the pages since the statistics were last
+     * taken, for the frame times of the page view. Only counted while
+     * DebugFrameTimes or DebugLogFrameTimes is on.
+     */
+    struct FrameStatistics {
+        qint64 scalingNsecs = 0;    // drawing the pixmaps of the pages at the painted size
+        int pagesWithoutPixmap = 0; // painted from a preview or a pixmap of another size, or with nothing
+    };
+
+    /**
+     * Returns the statistics gathered so far and starts over.
+     */
+    static FrameStatistics takeFrameStatistics();
+
 private:
     // BEGIN Change Colors feature
+    /**
+     * The settings the color filter depends on, in a string.
+     */
+    static QString colorFilterSettings();
+    /**
+     * Applies the color filter of the current render mode to @p image.
+     */
+    static void applyColorFilter(QImage *image);
+    /**
+     * @p pixmap over white paper with the color filter applied. The result
+     * is kept for as long as the settings don't change, so that painting
+     * the same pixmap again doesn't filter it again.
+     */
+    static QPixmap filteredPixmap(const QPixmap &pixmap);
+    /**
+     * @p color with the color filter applied.
+     */
+    static QColor filteredColor(const QColor &color);
     /**
      * Collapse color space (from white to black) to a line from @p foreground to @p background.
      */
@@ -122,6 +169,25 @@ private:
      */
     static void drawEllipseOnImage(QImage &image, const NormalizedPath &rect, const QPen &pen, const QBrush &brush, double penWidthMultiplier, RasterOperation op = Normal);
 
+    /**
+     * Where drawBufferedObjects() draws what uses @p op.
+     */
+    typedef std::function<QImage &(RasterOperation op)> BufferedTarget;
+
+    /**
+     * Draw the buffered @p highlights and @p annotations of @p page that intersect @p limits on the images of @p target,
+     * which start at the top left corner of @p limits.
+     */
+    static void drawBufferedObjects(const BufferedTarget &target,
+                                    const Okular::Page *page,
+                                    int scaledWidth,
+                                    int scaledHeight,
+                                    const QRect &scaledCrop,
+                                    const Okular::NormalizedRect &crop,
+                                    const QRect &limits,
+                                    const QList<QPair<QColor, Okular::NormalizedRect>> *highlights,
+                                    const QList<Okular::Annotation *> *annotations);
+
     friend class LineAnnotPainter;
 };
 
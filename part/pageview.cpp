@@ -35,6 +35,9 @@
 #include <QMenu>
 #include <QMimeData>
 #include <QMimeDatabase>
+#ifndef QT_NO_OPENGL
+#include <QOpenGLWidget>
+#endif
 #include <QPainter>
 #include <QScrollBar>
 #include <QScroller>
@@ -42,6 +45,7 @@
 #include <QSet>
 #include <QTimer>
 #include <QToolTip>
+#include <QTransform>
 
 #include <KActionCollection>
 #include <KActionMenu>
@@ -61,6 +65,7 @@
 #include <kwidgetsaddons_version.h>
 
 // system includes
+#include <algorithm>
 #include <array>
 #include <math.h>
 #include <stdlib.h>
@@ -93,6 +98,7 @@
 #include "core/movie.h"
 #include "core/page.h"
 #include "core/page_p.h"
+#include "core/requesttrace_p.h"
 #include "core/sourcereference.h"
 #include "core/tile.h"
 #include "magnifierview.h"
@@ -111,6 +117,23 @@ static const int searchTextPreviewLength = 21;
 // When following a link, only a preview of this length will be used to set the text of the action.
 static const int linkTextPreviewLength = 30;
 
+// the scroll speed is forgotten after this long without scrolling, in msec
+static const int kScrollVelocityTimeout = 300;
+// below this speed (pixels per second) preload both ways like when standing still
+static const int kMinPrefetchVelocity = 200;
+// above this speed (pixels per second) the pages are rendered as drafts, refined when the scrolling stops
+static const int kMinDraftVelocity = 1500;
+// how far ahead to preload when scrolling, in seconds of scrolling at the current speed
+static const double kPrefetchLookahead = 1.0;
+// how many of the last frames the frame time statistics are about
+static const int kFrameTimesCount = 120;
+// how often the frame times overlay is brought up to date when nothing else is painted, in msec
+static const int kFrameTimesHudRefresh = 500;
+// the Ctrl+wheel zoom is laid out and rendered after this long without notches, in msec
+static const int kWheelZoomCommitDelay = 250;
+// a rough size of a form widget and its private data, for Okular::Document::memoryUsage()
+static const int kFormWidgetSize = 2048;
+
 static inline double normClamp(double value, double def)
 {
     return (value < 0.0 || value > 1.0) ? def : value;
@@ -142,12 +165,23 @@ public:
     OkularTTS *tts();
 #endif
     QString selectedText() const;
+    // the visible items whose cropped geometry intersects rect, in order
+    QVector<PageViewItem *> itemsIntersecting(const QRect &rect) const;
+    // what the text selection of item covers, in content area coordinates
+    QRegion textSelectionRegion(const PageViewItem *item) const;
 
     // the document, pageviewItems and the 'visible cache'
     PageView *q;
     Okular::Document *document;
     QVector<PageViewItem *> items;
+    // the pages of the next search matches asked last, see slotRequestVisiblePixmaps()
+    QVector<int> searchPreloadPages;
     QLinkedList<PageViewItem *> visibleItems;
+    // the pages whose text was asked for because they are shown
+    QSet<int> textPageRequests;
+    QSet<PageViewItem *> itemsWithWidgets;
+    // the form widgets of the items that lost theirs
+    FormWidgetPool formWidgetPool;
     MagnifierView *magnifierView;
 
     // view layout (columns in Settings), zoom and mouse
@@ -163,6 +197,13 @@ public:
     QColor mouseSelectionColor;
     bool mouseTextSelecting;
     QSet<int> pagesWithTextSelection;
+    // the text selection of each visible page as last repainted, and the
+    // geometry of its item then, so a new one repaints only what changed
+    struct TextSelectionRegion {
+        QRect itemGeometry;
+        QRegion region;
+    };
+    QHash<int, TextSelectionRegion> textSelectionRegions;
     bool mouseOnRect;
     int mouseMode;
     MouseAnnotation *mouseAnnotation;
@@ -192,8 +233,20 @@ public:
     PageViewAnnotator *annotator;
     // text annotation dialogs list
     QSet<AnnotWindow *> m_annowindows;
+    // the grid of the last layout: the top of each row and the bottom of the
+    // last one, so that the rows at some height are found by bisection
+    QVector<int> layoutRowTops;
+    int layoutColumns;
+    int layoutFirstColumn; // the columns left empty before the first page
+    int layoutOnlyRow;     // the row that is shown when not continuous, or -1
     // other stuff
     QTimer *delayResizeEventTimer;
+    // a zoom gesture scales the pixmaps already there around the anchor (in
+    // viewport coordinates) and is only laid out and rendered when it ends
+    double gestureZoomScale;
+    float gestureZoomStart;
+    QPointF gestureZoomAnchor;
+    QTimer *wheelZoomTimer;
     bool dirtyLayout;
     bool blockViewport;             // prevents changes to viewport
     bool blockPixmapsRequest;       // prevent pixmap requests
@@ -204,7 +257,8 @@ public:
     OkularTTS *m_tts;
 #endif
     QTimer *refreshTimer;
-    QSet<int> refreshPages;
+    // the changed area of each page, null for the whole page
+    QHash<int, Okular::NormalizedRect> refreshPages;
 
     // bbox state for Trim to Selection mode
     Okular::NormalizedRect trimBoundingBox;
@@ -266,6 +320,28 @@ public:
     const Okular::ObjectRect *mouseOverLinkObject;
 
     QScroller *scroller;
+
+    // vertical scrolling speed in pixels per second, positive towards the end of the document
+    double scrollVelocity;
+    QElapsedTimer scrollVelocityTimer;
+
+    // the split of the time of the last frames, see DebugFrameTimes
+    struct FrameTime {
+        qint64 total;
+        qint64 painter; // painting the pages, but scaling their pixmaps
+        qint64 scaling;
+        qint64 overlays; // selections, annotator, and the rest
+        int pagesWithoutPixmap;
+    };
+    QVector<FrameTime> frameTimes; // a ring, the oldest at nextFrameTime when full
+    int nextFrameTime;
+    bool frameTimesHudUpdatePending;
+    // where the frame times are shown, in viewport coordinates
+    QRect frameTimesHudRect() const;
+    void addFrameTime(const FrameTime &frameTime);
+    void drawFrameTimesHud(QPainter *painter) const;
+    // tells the document how much the widgets of the items take
+    void reportWidgetMemory();
 };
 
 PageViewPrivate::PageViewPrivate(PageView *qq)
@@ -347,9 +423,14 @@ PageView::PageView(QWidget *parent, Okular::Document *document)
     d->scrollIncrement = 0;
     d->autoScrollTimer = nullptr;
     d->annotator = nullptr;
+    d->layoutColumns = 1;
+    d->layoutFirstColumn = 0;
+    d->layoutOnlyRow = -1;
     d->dirtyLayout = false;
     d->blockViewport = false;
     d->blockPixmapsRequest = false;
+    d->gestureZoomScale = 1.0;
+    d->gestureZoomStart = 1.0;
     d->messageWindow = new PageViewMessage(this);
     d->m_formsVisible = false;
     d->formsWidgetController = nullptr;
@@ -422,12 +503,29 @@ PageView::PageView(QWidget *parent, Okular::Document *document)
     d->delayResizeEventTimer->setObjectName(QStringLiteral("delayResizeEventTimer"));
     connect(d->delayResizeEventTimer, &QTimer::timeout, this, &PageView::delayedResizeEvent);
 
+    d->wheelZoomTimer = new QTimer(this);
+    d->wheelZoomTimer->setSingleShot(true);
+    d->wheelZoomTimer->setObjectName(QStringLiteral("wheelZoomTimer"));
+    connect(d->wheelZoomTimer, &QTimer::timeout, this, &PageView::finishGestureZoom);
+
     setFrameStyle(QFrame::NoFrame);
 
     setAttribute(Qt::WA_StaticContents);
 
     setObjectName(QStringLiteral("okular::pageView"));
 
+#ifndef QT_NO_OPENGL
+    // paint on an OpenGL surface: the page pixmaps become textures, uploaded
+    // once and kept for as long as the pixmaps live, so scrolling and
+    // zooming only compose them again on the GPU
+    if (Okular::Settings::enableGpuCompositing()) {
+        QOpenGLWidget *glViewport = new QOpenGLWidget(this);
+        // keep what was painted, the paint events only cover what changed
+        glViewport->setUpdateBehavior(QOpenGLWidget::PartialUpdate);
+        setViewport(glViewport);
+    }
+#endif
+
     // viewport setup: setup focus, and track mouse
     viewport()->setFocusProxy(this);
     viewport()->setFocusPolicy(Qt::StrongFocus);
@@ -437,6 +535,9 @@ PageView::PageView(QWidget *parent, Okular::Document *document)
     viewport()->setAutoFillBackground(false);
 
     d->scroller = QScroller::scroller(viewport());
+    d->scrollVelocity = 0;
+    d->nextFrameTime = 0;
+    d->frameTimesHudUpdatePending = false;
 
     QScrollerProperties prop;
     prop.setScrollMetric(QScrollerProperties::DecelerationFactor, 0.3);
@@ -525,6 +626,7 @@ PageView::~PageView()
 
     // delete all widgets
     qDeleteAll(d->items);
+    d->formWidgetPool.clear();
     delete d->formsWidgetController;
     d->document->removeObserver(this);
     delete d;
@@ -1031,6 +1133,125 @@ QString PageViewPrivate::selectedText() const
     return text;
 }
 
+QVector<PageViewItem *> PageViewPrivate::itemsIntersecting(const QRect &rect) const
+{
+    QVector<PageViewItem *> result;
+    auto addIfIntersecting = [&result, &rect](PageViewItem *item) {
+        if (item->isVisible() && item->croppedGeometry().intersects(rect))
+            result.append(item);
+    };
+
+    // the layout is not there yet, or is for other items
+    const int rowCount = layoutRowTops.count() - 1;
+    if (dirtyLayout || rowCount < 1 || (rowCount - 1) * layoutColumns - layoutFirstColumn >= items.count() || rowCount * layoutColumns - layoutFirstColumn < items.count()) {
+        for (PageViewItem *item : qAsConst(items))
+            addIfIntersecting(item);
+        return result;
+    }
+
+    int firstRow, lastRow;
+    if (layoutOnlyRow >= 0) {
+        firstRow = lastRow = layoutOnlyRow;
+    } else {
+        // the first row ending below the top of rect, and the last one starting above its bottom
+        firstRow = std::upper_bound(layoutRowTops.constBegin() + 1, layoutRowTops.constEnd(), rect.top()) - (layoutRowTops.constBegin() + 1);
+        lastRow = qMin(rowCount, int(std::upper_bound(layoutRowTops.constBegin(), layoutRowTops.constEnd(), rect.bottom()) - layoutRowTops.constBegin())) - 1;
+    }
+
+    const int firstItem = qMax(0, firstRow * layoutColumns - layoutFirstColumn);
+    const int lastItem = qMin(items.count(), (lastRow + 1) * layoutColumns - layoutFirstColumn);
+    for (int i = firstItem; i < lastItem; ++i)
+        addIfIntersecting(items[i]);
+    return result;
+}
+
+QRegion PageViewPrivate::textSelectionRegion(const PageViewItem *item) const
+{
+    QRegion region;
+    const Okular::RegularAreaRect *selection = item->page()->textSelection();
+    if (!selection)
+        return region;
+
+    const QRect &geometry = item->uncroppedGeometry();
+    for (const Okular::NormalizedRect &r : *selection) {
+        // with the frame PagePainter draws around it
+        region += r.geometry(geometry.width(), geometry.height()).translated(geometry.topLeft()).adjusted(-1, -1, 1, 1);
+    }
+    return region & item->croppedGeometry();
+}
+
+QRect PageViewPrivate::frameTimesHudRect() const
+{
+    const QFontMetrics fm = q->fontMetrics();
+    return QRect(8, 8, fm.horizontalAdvance(QStringLiteral("Last 120 frames: p50 0000.0 ms, p90 0000.0 ms, p99 0000.0 ms")) + 16, 4 * fm.lineSpacing() + 16);
+}
+
+void PageViewPrivate::reportWidgetMemory()
+{
+    int widgets = 0;
+    for (PageViewItem *item : qAsConst(itemsWithWidgets))
+        widgets += item->formWidgets().count() + item->videoWidgets().count();
+    widgets += formWidgetPool.count();
+    document->setMemoryUsage(QStringLiteral("Form and video widgets"), qulonglong(widgets) * kFormWidgetSize);
+}
+
+void PageViewPrivate::addFrameTime(const FrameTime &frameTime)
+{
+    if (frameTimes.count() < kFrameTimesCount)
+        frameTimes.append(frameTime);
+    else
+        frameTimes[nextFrameTime] = frameTime;
+    nextFrameTime = (nextFrameTime + 1) % kFrameTimesCount;
+
+    if (Okular::Settings::debugLogFrameTimes())
+        qCDebug(OkularUiDebug).nospace() << "frame " << frameTime.total / 1000 << "us: painter " << frameTime.painter / 1000 << "us, scaling " << frameTime.scaling / 1000 << "us, overlays " << frameTime.overlays / 1000 << "us, "
+                                         << frameTime.pagesWithoutPixmap << " pages without pixmap";
+
+    // the overlay is only in the frames that paint over it
+    if (Okular::Settings::debugFrameTimes() && !frameTimesHudUpdatePending) {
+        frameTimesHudUpdatePending = true;
+        QTimer::singleShot(kFrameTimesHudRefresh, q, [this] {
+            frameTimesHudUpdatePending = false;
+            q->viewport()->update(frameTimesHudRect());
+        });
+    }
+}
+
+void PageViewPrivate::drawFrameTimesHud(QPainter *painter) const
+{
+    if (frameTimes.isEmpty())
+        return;
+
+    QVector<qint64> totals;
+    totals.reserve(frameTimes.count());
+    FrameTime sum = {0, 0, 0, 0, 0};
+    for (const FrameTime &frameTime : frameTimes) {
+        totals.append(frameTime.total);
+        sum.painter += frameTime.painter;
+        sum.scaling += frameTime.scaling;
+        sum.overlays += frameTime.overlays;
+        sum.pagesWithoutPixmap += frameTime.pagesWithoutPixmap;
+    }
+    std::sort(totals.begin(), totals.end());
+    auto percentile = [&totals](int p) { return totals.at((totals.count() - 1) * p / 100) / 1000000.0; };
+    auto average = [this](qint64 nsecs) { return nsecs / 1000000.0 / frameTimes.count(); };
+    const FrameTime &last = frameTimes.at((nextFrameTime + frameTimes.count() - 1) % frameTimes.count());
+
+    const QStringList lines = {
+        QStringLiteral("Last %1 frames: p50 %2 ms, p90 %3 ms, p99 %4 ms").arg(frameTimes.count()).arg(percentile(50), 0, 'f', 1).arg(percentile(90), 0, 'f', 1).arg(percentile(99), 0, 'f', 1),
+        QStringLiteral("Painter %1 ms, scaling %2 ms, overlays %3 ms").arg(average(sum.painter), 0, 'f', 1).arg(average(sum.scaling), 0, 'f', 1).arg(average(sum.overlays), 0, 'f', 1),
+        QStringLiteral("Pages without pixmap: %1 in the last frame, %2 in all").arg(last.pagesWithoutPixmap).arg(sum.pagesWithoutPixmap),
+        QStringLiteral("Last frame %1 ms").arg(last.total / 1000000.0, 0, 'f', 1),
+    };
+
+    const QRect rect = frameTimesHudRect();
+    painter->save();
+    painter->fillRect(rect, QColor(0, 0, 0, 180));
+    painter->setPen(Qt::white);
+    painter->drawText(rect.adjusted(8, 8, -8, -8), Qt::AlignLeft | Qt::AlignTop, lines.join(QLatin1Char('\n')));
+    painter->restore();
+}
+
 QMimeData *PageView::getTableContents() const
 {
     QString selText;
@@ -1158,12 +1379,82 @@ void PageView::createAnnotationsVideoWidgets(PageViewItem *item, const QLinkedLi
     }
 }
 
+void PageView::createItemWidgets(PageViewItem *item)
+{
+    if (d->itemsWithWidgets.contains(item))
+        return;
+    d->itemsWithWidgets.insert(item);
+
+    const bool allowfillforms = d->document->isAllowed(Okular::AllowFillForms);
+    QWidget *previousWidget = nullptr;
+    const QVector<Okular::FormField *> &pageFields = item->formFieldsInReadingOrder();
+    for (Okular::FormField *ff : pageFields) {
+        FormWidgetIface *w = d->formWidgetPool.take(ff);
+        if (!w) {
+            w = FormWidgetFactory::createWidget(ff, viewport());
+            if (!w)
+                continue;
+            w->setFormWidgetsController(d->formWidgetsController());
+        }
+        w->setPageItem(item);
+        w->setVisibility(false);
+        w->setCanBeFilled(allowfillforms);
+        item->formWidgets().insert(w);
+
+        // the reused widgets are anywhere in the focus chain
+        QWidget *widget = dynamic_cast<QWidget *>(w);
+        if (previousWidget)
+            QWidget::setTabOrder(previousWidget, widget);
+        previousWidget = widget;
+    }
+
+    createAnnotationsVideoWidgets(item, item->page()->annotations());
+
+    // size and place them like the ones of the other items
+    item->setWHZC(item->croppedWidth(), item->croppedHeight(), item->zoomFactor(), item->crop());
+    const QPoint viewportOffset(horizontalScrollBar()->value(), verticalScrollBar()->value());
+    const QSet<FormWidgetIface *> formWidgetsList = item->formWidgets();
+    for (FormWidgetIface *fwi : formWidgetsList) {
+        Okular::NormalizedRect r = fwi->rect();
+        fwi->moveTo(qRound(item->uncroppedGeometry().left() + item->uncroppedWidth() * r.left) + 1 - viewportOffset.x(), qRound(item->uncroppedGeometry().top() + item->uncroppedHeight() * r.top) + 1 - viewportOffset.y());
+    }
+    const QHash<Okular::Movie *, VideoWidget *> videoWidgets = item->videoWidgets();
+    for (VideoWidget *vw : videoWidgets) {
+        const Okular::NormalizedRect r = vw->normGeometry();
+        vw->move(qRound(item->uncroppedGeometry().left() + item->uncroppedWidth() * r.left) + 1 - viewportOffset.x(), qRound(item->uncroppedGeometry().top() + item->uncroppedHeight() * r.top) + 1 - viewportOffset.y());
+    }
+    item->setFormWidgetsVisible(d->m_formsVisible);
+    d->reportWidgetMemory();
+}
+
+void PageView::deleteItemWidgets(PageViewItem *item)
+{
+    if (!d->itemsWithWidgets.remove(item))
+        return;
+
+    // the values are in the form fields, the widgets get them back when created again
+    const QSet<FormWidgetIface *> formWidgetsList = item->formWidgets();
+    for (FormWidgetIface *fwi : formWidgetsList) {
+        if (d->formsWidgetController)
+            d->formsWidgetController->unregisterRadioButton(fwi);
+        d->formWidgetPool.release(fwi);
+    }
+    item->formWidgets().clear();
+    qDeleteAll(item->videoWidgets());
+    item->videoWidgets().clear();
+    d->reportWidgetMemory();
+}
+
 // BEGIN DocumentObserver inherited methods
 void PageView::notifySetup(const QVector<Okular::Page *> &pageSet, int setupFlags)
 {
     bool documentChanged = setupFlags & Okular::DocumentObserver::DocumentChanged;
     const bool allowfillforms = d->document->isAllowed(Okular::AllowFillForms);
 
+    // the pages may be new ones, or have a new size or rotation
+    PagePainter::clearOverlays();
+    d->textSelectionRegions.clear();
+
     // reuse current pages if nothing new
     if ((pageSet.count() == d->items.count()) && !documentChanged && !(setupFlags & Okular::DocumentObserver::NewLayoutForPages)) {
         int count = pageSet.count();
@@ -1195,6 +1486,9 @@ void PageView::notifySetup(const QVector<Okular::Page *> &pageSet, int setupFlag
                 const QRect viewportRect(horizontalScrollBar()->value(), verticalScrollBar()->value(), viewport()->width(), viewport()->height());
                 for (int i = 0; i < count; i++) {
                     PageViewItem *item = d->items[i];
+                    item->resetFormFieldsOrder();
+                    if (!d->itemsWithWidgets.contains(item))
+                        continue;
                     const QSet<FormWidgetIface *> fws = item->formWidgets();
                     for (FormWidgetIface *w : fws) {
                         Okular::FormField *f = Okular::PagePrivate::findEquivalentForm(d->document->page(i), w->formField());
@@ -1236,34 +1530,25 @@ void PageView::notifySetup(const QVector<Okular::Page *> &pageSet, int setupFlag
     qDeleteAll(d->items);
     d->items.clear();
     d->visibleItems.clear();
+    d->itemsWithWidgets.clear();
+    d->reportWidgetMemory();
     d->pagesWithTextSelection.clear();
     toggleFormWidgets(false);
     if (d->formsWidgetController)
         d->formsWidgetController->dropRadioButtons();
+    d->formWidgetPool.clear();
 
     bool haspages = !pageSet.isEmpty();
     bool hasformwidgets = false;
-    // create children widgets
+    // create the items, their widgets come when they get near the viewport
+    d->items.reserve(pageSet.count());
     for (const Okular::Page *page : pageSet) {
         PageViewItem *item = new PageViewItem(page);
         d->items.push_back(item);
 #ifdef PAGEVIEW_DEBUG
         qCDebug(OkularUiDebug).nospace() << "cropped geom for " << d->items.last()->pageNumber() << " is " << d->items.last()->croppedGeometry();
 #endif
-        const QLinkedList<Okular::FormField *> pageFields = page->formFields();
-        for (Okular::FormField *ff : pageFields) {
-            FormWidgetIface *w = FormWidgetFactory::createWidget(ff, viewport());
-            if (w) {
-                w->setPageItem(item);
-                w->setFormWidgetsController(d->formWidgetsController());
-                w->setVisibility(false);
-                w->setCanBeFilled(allowfillforms);
-                item->formWidgets().insert(w);
-                hasformwidgets = true;
-            }
-        }
-
-        createAnnotationsVideoWidgets(item, page->annotations());
+        hasformwidgets = hasformwidgets || !page->formFields().isEmpty();
     }
 
     // invalidate layout so relayout/repaint will happen on next viewport change
@@ -1273,6 +1558,10 @@ void PageView::notifySetup(const QVector<Okular::Page *> &pageSet, int setupFlag
         // has not been done and we don't want that to happen
         d->dirtyLayout = true;
         QMetaObject::invokeMethod(this, "slotRelayoutPages", Qt::QueuedConnection);
+
+        // the trimmed layout needs the bounding boxes of the pages not shown yet
+        if (Okular::Settings::trimMargins())
+            d->document->computeBoundingBoxes();
     } else {
         // update the mouse cursor when closing because we may have close through a link and
         // want the cursor to come back to the normal cursor
@@ -1480,6 +1769,37 @@ void PageView::notifyPageChanged(int pageNumber, int changedFlags)
     if (changedFlags & DocumentObserver::Bookmark)
         return;
 
+    if (changedFlags & (DocumentObserver::Highlights | DocumentObserver::Annotations))
+        PagePainter::invalidateOverlays(d->document->page(pageNumber));
+
+    // a new text selection repaints only where it differs from the previous one
+    if (changedFlags == DocumentObserver::TextSelection) {
+        for (const PageViewItem *visibleItem : qAsConst(d->visibleItems)) {
+            if (visibleItem->pageNumber() != pageNumber || !visibleItem->isVisible())
+                continue;
+
+            const QRegion region = d->textSelectionRegion(visibleItem);
+            const auto previous = d->textSelectionRegions.constFind(pageNumber);
+            QRegion dirty;
+            if (previous == d->textSelectionRegions.constEnd())
+                dirty = region;
+            else if (previous->itemGeometry == visibleItem->uncroppedGeometry())
+                dirty = region.xored(previous->region);
+            else
+                dirty = visibleItem->croppedGeometry().adjusted(-1, -1, 3, 3);
+
+            if (region.isEmpty())
+                d->textSelectionRegions.remove(pageNumber);
+            else
+                d->textSelectionRegions.insert(pageNumber, {visibleItem->uncroppedGeometry(), region});
+            viewport()->update(dirty.translated(-contentAreaPosition()));
+            return;
+        }
+        // not visible, it is repainted whole when it is
+        d->textSelectionRegions.remove(pageNumber);
+        return;
+    }
+
     if (changedFlags & DocumentObserver::Annotations) {
         const QLinkedList<Okular::Annotation *> annots = d->document->page(pageNumber)->annotations();
         const QLinkedList<Okular::Annotation *>::ConstIterator annItEnd = annots.end();
@@ -1506,10 +1826,12 @@ void PageView::notifyPageChanged(int pageNumber, int changedFlags)
 #ifdef PAGEVIEW_DEBUG
         qCDebug(OkularUiDebug) << "BoundingBox change on page" << pageNumber;
 #endif
-        slotRelayoutPages();
-        slotRequestVisiblePixmaps(); // TODO: slotRelayoutPages() may have done this already!
-        // Repaint the whole widget since layout may have changed
-        viewport()->update();
+        // the bounding boxes found in the background come several at once,
+        // they share one relayout
+        if (!d->dirtyLayout) {
+            d->dirtyLayout = true;
+            QMetaObject::invokeMethod(this, "slotRelayoutPages", Qt::QueuedConnection);
+        }
         return;
     }
 
@@ -1534,8 +1856,52 @@ void PageView::notifyPageChanged(int pageNumber, int changedFlags)
         }
 }
 
+void PageView::notifyPagesChanged(const QVector<int> &pages, int changedFlags)
+{
+    // annotations and bounding boxes need the work of each page
+    if (changedFlags & (DocumentObserver::Annotations | DocumentObserver::BoundingBox)) {
+        Okular::DocumentObserver::notifyPagesChanged(pages, changedFlags);
+        return;
+    }
+    if (changedFlags & DocumentObserver::Bookmark)
+        return;
+
+    if (changedFlags & DocumentObserver::Highlights) {
+        for (int pageNumber : pages)
+            PagePainter::invalidateOverlays(d->document->page(pageNumber));
+
+        // preload the pages of the next matches, or stop preloading them
+        if (d->document->upcomingSearchMatchPages(PART_SEARCH_ID) != d->searchPreloadPages)
+            QMetaObject::invokeMethod(this, "slotRequestVisiblePixmaps", Qt::QueuedConnection);
+    }
+    if (changedFlags & DocumentObserver::TextSelection) {
+        for (int pageNumber : pages)
+            d->textSelectionRegions.remove(pageNumber);
+    }
+
+    // one pass over the visible items, the pages are in order
+    bool updated = false;
+    for (const PageViewItem *visibleItem : qAsConst(d->visibleItems)) {
+        if (!visibleItem->isVisible() || !std::binary_search(pages.constBegin(), pages.constEnd(), visibleItem->pageNumber()))
+            continue;
+
+        QRect expandedRect = visibleItem->croppedGeometry();
+        expandedRect.translate(-contentAreaPosition());
+        expandedRect.adjust(-1, -1, 3, 3);
+        viewport()->update(expandedRect);
+        updated = true;
+    }
+
+    // if we were "zoom-dragging" do not overwrite the "zoom-drag" cursor
+    if (updated && cursor().shape() != Qt::SizeVerCursor)
+        updateCursor();
+}
+
 void PageView::notifyContentsCleared(int changedFlags)
 {
+    if (changedFlags & (DocumentObserver::Highlights | DocumentObserver::Annotations))
+        PagePainter::clearOverlays();
+
     // if pixmaps were cleared, re-ask them
     if (changedFlags & DocumentObserver::Pixmap)
         QMetaObject::invokeMethod(this, "slotRequestVisiblePixmaps", Qt::QueuedConnection);
@@ -1590,6 +1956,7 @@ void PageView::notifyCurrentPageChanged(int previous, int current)
     if (current != -1) {
         PageViewItem *item = d->items.at(current);
         if (item) {
+            createItemWidgets(item);
             const QHash<Okular::Movie *, VideoWidget *> videoWidgetsList = item->videoWidgets();
             for (VideoWidget *videoWidget : videoWidgetsList)
                 videoWidget->pageEntered();
@@ -1742,6 +2109,7 @@ bool PageView::gestureEvent(QGestureEvent *event)
         static qreal vanillaZoom = d->zoomFactor;
 
         if (pinch->state() == Qt::GestureStarted) {
+            finishGestureZoom();
             vanillaZoom = d->zoomFactor;
         }
 
@@ -1749,12 +2117,8 @@ bool PageView::gestureEvent(QGestureEvent *event)
 
         // Zoom
         if (pinch->changeFlags() & QPinchGesture::ScaleFactorChanged) {
-            d->zoomFactor = vanillaZoom * pinch->totalScaleFactor();
-
-            d->blockPixmapsRequest = true;
-            updateZoom(ZoomRefreshCurrent);
-            d->blockPixmapsRequest = false;
-            viewport()->update();
+            const QPointF anchor = viewport()->mapFromGlobal(pinch->centerPoint().toPoint());
+            setGestureZoom(vanillaZoom, vanillaZoom * pinch->totalScaleFactor(), anchor);
         }
 
         // Count the number of 90-degree rotations we did since the start of the pinch gesture.
@@ -1765,6 +2129,11 @@ bool PageView::gestureEvent(QGestureEvent *event)
             // Rotation angle relative to the accumulated page rotations triggered by the current pinch
             // We actually turn at 80 degrees rather than at 90 degrees.  That's less strain on the hands.
             const qreal relativeAngle = pinch->rotationAngle() - rotations * 90;
+            if (qAbs(relativeAngle) > 80) {
+                // the rotation lays the pages out again
+                finishGestureZoom();
+                vanillaZoom = d->zoomFactor / pinch->totalScaleFactor();
+            }
             if (relativeAngle > 80) {
                 slotRotateClockwise();
                 rotations++;
@@ -1775,7 +2144,8 @@ bool PageView::gestureEvent(QGestureEvent *event)
             }
         }
 
-        if (pinch->state() == Qt::GestureFinished) {
+        if (pinch->state() == Qt::GestureFinished || pinch->state() == Qt::GestureCanceled) {
+            finishGestureZoom();
             rotations = 0;
         }
 
@@ -1787,6 +2157,7 @@ bool PageView::gestureEvent(QGestureEvent *event)
 
 void PageView::paintEvent(QPaintEvent *pe)
 {
+    Okular::RequestTrace::Scope trace("PageView::paintEvent", Okular::RequestTrace::pageArgs(nullptr, -1, pe->rect().width(), pe->rect().height(), false));
     const QPoint areaPos = contentAreaPosition();
     // create the rect into contents from the clipped screen rect
     QRect viewportRect = viewport()->rect();
@@ -1799,12 +2170,33 @@ void PageView::paintEvent(QPaintEvent *pe)
     qCDebug(OkularUiDebug) << "paintevent" << contentsRect;
 #endif
 
+    // the frames that just bring the frame times overlay up to date don't count
+    const bool recordFrameTime = (Okular::Settings::debugFrameTimes() || Okular::Settings::debugLogFrameTimes()) && !d->frameTimesHudRect().contains(pe->rect());
+    QElapsedTimer frameTimer;
+    frameTimer.start();
+    qint64 documentTime = 0;
+    if (recordFrameTime)
+        PagePainter::takeFrameStatistics();
+
     // create the screen painter. a pixel painted at contentsX,contentsY
     // appears to the top-left corner of the scrollview.
     QPainter screenPainter(viewport());
     // translate to simulate the scrolled content widget
     screenPainter.translate(-areaPos);
 
+    // during a zoom gesture the pixmaps we have are stretched, the layout has to wait for its end
+    if (d->gestureZoomScale != 1.0) {
+        const QPointF anchor = contentAreaPoint(d->gestureZoomAnchor);
+        QTransform transform;
+        transform.translate(anchor.x(), anchor.y());
+        transform.scale(d->gestureZoomScale, d->gestureZoomScale);
+        transform.translate(-anchor.x(), -anchor.y());
+        screenPainter.setTransform(transform, true);
+        screenPainter.setRenderHint(QPainter::SmoothPixmapTransform);
+        drawDocumentOnPainter(transform.inverted().mapRect(viewportRect), &screenPainter);
+        return;
+    }
+
     // selectionRect is the normalized mouse selection rect
     QRect selectionRect = d->mouseSelectionRect;
     if (!selectionRect.isNull())
@@ -1854,7 +2246,9 @@ void PageView::paintEvent(QPaintEvent *pe)
             pixmapPainter.translate(-contentsRect.left(), -contentsRect.top());
 
             // 1) Layer 0: paint items and clear bg on unpainted rects
+            const qint64 documentStart = frameTimer.nsecsElapsed();
             drawDocumentOnPainter(contentsRect, &pixmapPainter);
+            documentTime += frameTimer.nsecsElapsed() - documentStart;
             // 2a) Layer 1a: paint (blend) transparent selection (rectangle)
             if (!selectionRect.isNull() && selectionRect.intersects(contentsRect) && !selectionRectInternal.contains(contentsRect)) {
                 QRect blendRect = selectionRectInternal.intersected(contentsRect);
@@ -1936,7 +2330,9 @@ void PageView::paintEvent(QPaintEvent *pe)
             screenPainter.drawPixmap(contentsRect.left(), contentsRect.top(), doubleBuffer);
         } else {
             // 1) Layer 0: paint items and clear bg on unpainted rects
+            const qint64 documentStart = frameTimer.nsecsElapsed();
             drawDocumentOnPainter(contentsRect, &screenPainter);
+            documentTime += frameTimer.nsecsElapsed() - documentStart;
             // 2a) Layer 1a: paint opaque selection (rectangle)
             if (!selectionRect.isNull() && selectionRect.intersects(contentsRect) && !selectionRectInternal.contains(contentsRect)) {
                 screenPainter.setPen(palette().color(QPalette::Active, QPalette::Highlight).darker(110));
@@ -1967,6 +2363,18 @@ void PageView::paintEvent(QPaintEvent *pe)
             }
         }
     }
+
+    if (Okular::Settings::debugFrameTimes() || Okular::Settings::debugLogFrameTimes()) {
+        if (recordFrameTime) {
+            const qint64 total = frameTimer.nsecsElapsed();
+            const PagePainter::FrameStatistics statistics = PagePainter::takeFrameStatistics();
+            d->addFrameTime({total, documentTime - statistics.scalingNsecs, statistics.scalingNsecs, total - documentTime, statistics.pagesWithoutPixmap});
+        }
+        if (Okular::Settings::debugFrameTimes()) {
+            screenPainter.resetTransform();
+            d->drawFrameTimesHud(&screenPainter);
+        }
+    }
 }
 
 void PageView::drawTableDividers(QPainter *screenPainter)
@@ -2755,9 +3163,8 @@ void PageView::mouseReleaseEvent(QMouseEvent *e)
         if (d->document->supportsSearching()) {
             // grab text in selection by extracting it from all intersected pages
             const Okular::Page *okularPage = nullptr;
-            for (const PageViewItem *item : qAsConst(d->items)) {
-                if (!item->isVisible())
-                    continue;
+            const QVector<PageViewItem *> selectedItems = d->itemsIntersecting(selectionRect);
+            for (const PageViewItem *item : selectedItems) {
 
                 const QRect &itemRect = item->croppedGeometry();
                 if (selectionRect.intersects(itemRect)) {
@@ -2898,9 +3305,8 @@ void PageView::mouseReleaseEvent(QMouseEvent *e)
             // break up the selection into page-relative pieces
             d->tableSelectionParts.clear();
             const Okular::Page *okularPage = nullptr;
-            for (PageViewItem *item : qAsConst(d->items)) {
-                if (!item->isVisible())
-                    continue;
+            const QVector<PageViewItem *> selectedItems = d->itemsIntersecting(selectionRect);
+            for (PageViewItem *item : selectedItems) {
 
                 const QRect &itemRect = item->croppedGeometry();
                 if (selectionRect.intersects(itemRect)) {
@@ -3185,12 +3591,18 @@ void PageView::wheelEvent(QWheelEvent *e)
     e->accept();
     if ((e->modifiers() & Qt::ControlModifier) == Qt::ControlModifier) {
         d->controlWheelAccumulatedDelta += delta;
-        if (d->controlWheelAccumulatedDelta <= -QWheelEvent::DefaultDeltasPerStep) {
-            slotZoomOut();
-            d->controlWheelAccumulatedDelta = 0;
-        } else if (d->controlWheelAccumulatedDelta >= QWheelEvent::DefaultDeltasPerStep) {
-            slotZoomIn();
+        const int notches = d->controlWheelAccumulatedDelta / QWheelEvent::DefaultDeltasPerStep;
+        if (notches != 0) {
             d->controlWheelAccumulatedDelta = 0;
+#if QT_VERSION < QT_VERSION_CHECK(5, 15, 0)
+            const QPointF anchor = e->posF();
+#else
+            const QPointF anchor = e->position();
+#endif
+            // each notch goes to the next zoom preset, like the keyboard
+            const float start = d->gestureZoomScale != 1.0 ? d->gestureZoomStart : d->zoomFactor;
+            setGestureZoom(start, zoomPresetAfter(start * d->gestureZoomScale, notches), anchor);
+            d->wheelZoomTimer->start(kWheelZoomCommitDelay);
         }
     } else {
         d->controlWheelAccumulatedDelta = 0;
@@ -3281,8 +3693,28 @@ bool PageView::viewportEvent(QEvent *e)
 
 void PageView::scrollContentsBy(int dx, int dy)
 {
+    // track how fast we are moving, to preload ahead of it
+    if (dy != 0) {
+        const qint64 elapsed = d->scrollVelocityTimer.isValid() ? d->scrollVelocityTimer.restart() : -1;
+        if (elapsed < 0 || elapsed > kScrollVelocityTimeout) {
+            // starting to scroll, nothing to measure yet
+            d->scrollVelocity = 0;
+            if (elapsed < 0)
+                d->scrollVelocityTimer.start();
+        } else {
+            // contents move the other way than the viewport; smooth out the jumps of wheel scrolling
+            const double velocity = -dy * 1000.0 / qMax<qint64>(elapsed, 1);
+            d->scrollVelocity = 0.7 * d->scrollVelocity + 0.3 * velocity;
+        }
+    }
+
     const QRect r = viewport()->rect();
     viewport()->scroll(dx, dy, r);
+    // the frame times overlay stays in place
+    if (Okular::Settings::debugFrameTimes()) {
+        viewport()->update(d->frameTimesHudRect());
+        viewport()->update(d->frameTimesHudRect().translated(dx, dy));
+    }
     // HACK manually repaint the damaged regions, as it seems some updates are missed
     // thus leaving artifacts around
     QRegion rgn(r);
@@ -3301,10 +3733,9 @@ QList<Okular::RegularAreaRect *> PageView::textSelections(const QPoint start, co
     QList<Okular::RegularAreaRect *> ret;
     QSet<int> affectedItemsSet;
     QRect selectionRect = QRect(start, end).normalized();
-    for (const PageViewItem *item : qAsConst(d->items)) {
-        if (item->isVisible() && selectionRect.intersects(item->croppedGeometry()))
-            affectedItemsSet.insert(item->pageNumber());
-    }
+    const QVector<PageViewItem *> selectedItems = d->itemsIntersecting(selectionRect);
+    for (const PageViewItem *item : selectedItems)
+        affectedItemsSet.insert(item->pageNumber());
 #ifdef PAGEVIEW_DEBUG
     qCDebug(OkularUiDebug) << ">>>> item selected by mouse:" << affectedItemsSet.count();
 #endif
@@ -3375,11 +3806,9 @@ void PageView::drawDocumentOnPainter(const QRect contentsRect, QPainter *p)
     QRegion remainingArea(contentsRect);
 
     // This loop draws the actual pages
-    // iterate over all items painting the ones intersecting contentsRect
-    for (const PageViewItem *item : qAsConst(d->items)) {
-        // check if a piece of the page intersects the contents rect
-        if (!item->isVisible() || !item->croppedGeometry().intersects(contentsRect))
-            continue;
+    // iterate over the items intersecting contentsRect painting them
+    const QVector<PageViewItem *> paintedItems = d->itemsIntersecting(contentsRect);
+    for (const PageViewItem *item : paintedItems) {
 
         // get item and item's outline geometries
         QRect itemGeometry = item->croppedGeometry();
@@ -3420,11 +3849,9 @@ void PageView::drawDocumentOnPainter(const QRect contentsRect, QPainter *p)
     // width of the shadow in device pixels
     static const int shadowWidth = 2 * dpr;
 
-    // iterate over all items painting a black outline and a simple bottom/right gradient
-    for (const PageViewItem *item : qAsConst(d->items)) {
-        // check if a piece of the page intersects the contents rect
-        if (!item->isVisible() || !item->croppedGeometry().intersects(checkRect))
-            continue;
+    // iterate over the items intersecting the contents rect painting a black outline and a simple bottom/right gradient
+    const QVector<PageViewItem *> outlinedItems = d->itemsIntersecting(checkRect);
+    for (const PageViewItem *item : outlinedItems) {
 
         // get item and item's outline geometries
         QRect itemGeometry = item->croppedGeometry();
@@ -3790,6 +4217,14 @@ double PageView::zoomFactorFitMode(ZoomMode mode)
 
 void PageView::updateZoom(ZoomMode newZoomMode)
 {
+    // the keyboard and the menus go from the zoom laid out, the notches of
+    // the wheel not laid out yet are dropped
+    if (newZoomMode != ZoomRefreshCurrent && d->gestureZoomScale != 1.0) {
+        d->wheelZoomTimer->stop();
+        d->gestureZoomScale = 1.0;
+        viewport()->update();
+    }
+
     if (newZoomMode == ZoomFixed) {
         if (d->aZoom->currentItem() == 0)
             newZoomMode = ZoomFitWidth;
@@ -3811,31 +4246,13 @@ void PageView::updateZoom(ZoomMode newZoomMode)
     } break;
     case ZoomIn:
     case ZoomOut: {
-        const float zoomFactorFitWidth = zoomFactorFitMode(ZoomFitWidth);
-        const float zoomFactorFitPage = zoomFactorFitMode(ZoomFitPage);
-
-        QVector<float> zoomValue(kZoomValues.size());
-
-        std::copy(kZoomValues.begin(), kZoomValues.end(), zoomValue.begin());
-        zoomValue.append(zoomFactorFitWidth);
-        zoomValue.append(zoomFactorFitPage);
-        std::sort(zoomValue.begin(), zoomValue.end());
-
-        QVector<float>::iterator i;
-        if (newZoomMode == ZoomOut) {
-            if (newFactor <= zoomValue.first())
-                return;
-            i = std::lower_bound(zoomValue.begin(), zoomValue.end(), newFactor) - 1;
-        } else {
-            if (newFactor >= zoomValue.last())
-                return;
-            i = std::upper_bound(zoomValue.begin(), zoomValue.end(), newFactor);
-        }
-        const float tmpFactor = *i;
-        if (tmpFactor == zoomFactorFitWidth) {
+        const float tmpFactor = zoomPresetAfter(newFactor, newZoomMode == ZoomIn ? 1 : -1);
+        if (tmpFactor == newFactor)
+            return;
+        if (tmpFactor == zoomFactorFitMode(ZoomFitWidth)) {
             newZoomMode = ZoomFitWidth;
             checkedZoomAction = d->aZoomFitWidth;
-        } else if (tmpFactor == zoomFactorFitPage) {
+        } else if (tmpFactor == zoomFactorFitMode(ZoomFitPage)) {
             newZoomMode = ZoomFitPage;
             checkedZoomAction = d->aZoomFitPage;
         } else {
@@ -3894,6 +4311,73 @@ void PageView::updateZoom(ZoomMode newZoomMode)
     d->aZoomActual->setEnabled(d->zoomFactor != 1.0);
 }
 
+float PageView::zoomPresetAfter(float factor, int steps)
+{
+    QVector<float> zoomValue(kZoomValues.size());
+
+    std::copy(kZoomValues.begin(), kZoomValues.end(), zoomValue.begin());
+    zoomValue.append(zoomFactorFitMode(ZoomFitWidth));
+    zoomValue.append(zoomFactorFitMode(ZoomFitPage));
+    std::sort(zoomValue.begin(), zoomValue.end());
+
+    for (; steps < 0 && factor > zoomValue.first(); ++steps)
+        factor = *(std::lower_bound(zoomValue.begin(), zoomValue.end(), factor) - 1);
+    for (; steps > 0 && factor < zoomValue.last(); --steps)
+        factor = *std::upper_bound(zoomValue.begin(), zoomValue.end(), factor);
+    return factor;
+}
+
+void PageView::setGestureZoom(float startFactor, float newFactor, const QPointF anchor)
+{
+    const float upperZoomLimit = d->document->supportsTiles() ? 100.0 : 4.0;
+    newFactor = qBound<float>(0.1, newFactor, upperZoomLimit);
+
+    d->gestureZoomStart = startFactor;
+    d->gestureZoomScale = newFactor / startFactor;
+    d->gestureZoomAnchor = anchor;
+    viewport()->update();
+}
+
+void PageView::finishGestureZoom()
+{
+    d->wheelZoomTimer->stop();
+    if (d->gestureZoomScale == 1.0)
+        return;
+
+    // the scaling leaves the anchor where it was: remember where it is in the
+    // page under it, to put it back under the anchor after the layout
+    const QPointF anchor = d->gestureZoomAnchor;
+    const QPointF contentsAnchor = contentAreaPoint(anchor);
+    const PageViewItem *item = pickItemOnPoint(contentsAnchor.x(), contentsAnchor.y());
+    double nX = 0, nY = 0;
+    if (item) {
+        const QRect geometry = item->uncroppedGeometry();
+        nX = (contentsAnchor.x() - geometry.left()) / geometry.width();
+        nY = (contentsAnchor.y() - geometry.top()) / geometry.height();
+    }
+
+    d->zoomFactor = d->gestureZoomStart * d->gestureZoomScale;
+    d->gestureZoomScale = 1.0;
+
+    // lay the pages out once, and render them once they are in place; the
+    // wheel may have stopped at one of the fit zooms
+    const bool prevState = d->blockPixmapsRequest;
+    d->blockPixmapsRequest = true;
+    if (d->zoomFactor == zoomFactorFitMode(ZoomFitWidth))
+        updateZoom(ZoomFitWidth);
+    else if (d->zoomFactor == zoomFactorFitMode(ZoomFitPage))
+        updateZoom(ZoomFitPage);
+    else
+        updateZoom(ZoomRefreshCurrent);
+    if (item) {
+        const QRect geometry = item->uncroppedGeometry();
+        scrollTo(qRound(geometry.left() + nX * geometry.width() - anchor.x()), qRound(geometry.top() + nY * geometry.height() - anchor.y()));
+    }
+    d->blockPixmapsRequest = prevState;
+    slotRequestVisiblePixmaps();
+    viewport()->update();
+}
+
 void PageView::updateZoomText()
 {
     // use current page zoom as zoomFactor if in ZoomFit/* mode
@@ -4390,6 +4874,13 @@ void PageView::slotRelayoutPages()
         for (int i = 0; i < cIdx; ++i)
             insertX += colWidth[i];
     }
+    d->layoutRowTops.resize(nRows + 1);
+    d->layoutRowTops[0] = insertY;
+    for (int i = 0; i < nRows; i++)
+        d->layoutRowTops[i + 1] = d->layoutRowTops[i] + (continuousView ? rowHeight[i] : 0);
+    d->layoutColumns = nCols;
+    d->layoutFirstColumn = centerFirstPage ? nCols - 1 : 0;
+    d->layoutOnlyRow = continuousView ? -1 : pageRowIdx;
     for (PageViewItem *item : qAsConst(d->items)) {
         int cWidth = colWidth[cIdx], rHeight = rowHeight[rIdx];
         if (continuousView || rIdx == pageRowIdx) {
@@ -4511,12 +5002,43 @@ static void slotRequestPreloadPixmap(PageView *pageView, const PageViewItem *i,
     }
 }
 
+// Preloads the page of an upcoming search match; of a tiled page, only the
+// part of the size of the viewport around @p matchRect, or at the top of the
+// page when the match is not known yet
+static void requestSearchPreloadPixmap(PageView *pageView, const PageViewItem *i, const Okular::NormalizedRect &matchRect, const QSize &viewportSize, QLinkedList<Okular::PixmapRequest *> *requestedPixmaps)
+{
+    if (i->uncroppedWidth() <= 0 || i->uncroppedHeight() <= 0)
+        return;
+
+    Okular::NormalizedRect preRenderRegion;
+    const bool pageHasTilesManager = i->page()->hasTilesManager(pageView);
+    if (pageHasTilesManager) {
+        const double width = qMin(1.0, (double)viewportSize.width() / i->uncroppedWidth());
+        const double height = qMin(1.0, (double)viewportSize.height() / i->uncroppedHeight());
+        const Okular::NormalizedPoint center = matchRect.isNull() ? Okular::NormalizedPoint(0.5, height / 2) : matchRect.center();
+        const double left = qBound(0.0, center.x - width / 2, 1.0 - width);
+        const double top = qBound(0.0, center.y - height / 2, 1.0 - height);
+        preRenderRegion = Okular::NormalizedRect(left, top, left + width, top + height);
+    }
+
+    if (i->page()->hasPixmap(pageView, i->uncroppedWidth(), i->uncroppedHeight(), preRenderRegion))
+        return;
+
+    Okular::PixmapRequest *p = new Okular::PixmapRequest(
+        pageView, i->pageNumber(), i->uncroppedWidth(), i->uncroppedHeight(), pageView->devicePixelRatioF(), PAGEVIEW_SEARCH_PRELOAD_PRIO, Okular::PixmapRequest::Asynchronous | Okular::PixmapRequest::Preload | Okular::PixmapRequest::SearchPreload);
+    requestedPixmaps->push_back(p);
+    p->setNormalizedRect(preRenderRegion);
+    p->setTile(pageHasTilesManager);
+}
+
 void PageView::slotRequestVisiblePixmaps(int newValue)
 {
     // if requests are blocked (because raised by an unwanted event), exit
     if (d->blockPixmapsRequest)
         return;
 
+    Okular::RequestTrace::Scope trace("PageView::slotRequestVisiblePixmaps");
+
     // precalc view limits for intersecting with page coords inside the loop
     const bool isEvent = newValue != -1 && !d->blockViewport;
     const QRect viewportRect(horizontalScrollBar()->value(), verticalScrollBar()->value(), viewport()->width(), viewport()->height());
@@ -4530,11 +5052,28 @@ void PageView::slotRequestVisiblePixmaps(int newValue)
     // Margin (in pixels) around the viewport to preload
     const int pixelsToExpand = 512;
 
-    // iterate over all items
+    // the items get their widgets within a viewport of the visible area, and
+    // lose them farther than a few, so that scrolling back and forth keeps them
+    const QRect widgetsRect = viewportRect.adjusted(-viewportRect.width(), -viewportRect.height(), viewportRect.width(), viewportRect.height());
+    const QRect keepWidgetsRect = viewportRect.adjusted(-4 * viewportRect.width(), -4 * viewportRect.height(), 4 * viewportRect.width(), 4 * viewportRect.height());
+    // but not the form being edited
+    const FormWidgetIface *focusedFormWidget = nullptr;
+    for (QWidget *w = QApplication::focusWidget(); w && w != viewport() && !focusedFormWidget; w = w->parentWidget())
+        focusedFormWidget = dynamic_cast<const FormWidgetIface *>(w);
+    const QSet<PageViewItem *> itemsWithWidgets = d->itemsWithWidgets;
+    for (PageViewItem *i : itemsWithWidgets) {
+        if ((!i->isVisible() || !keepWidgetsRect.intersects(i->croppedGeometry())) && (!focusedFormWidget || focusedFormWidget->pageItem() != i))
+            deleteItemWidgets(i);
+    }
+    const QVector<PageViewItem *> nearItems = d->itemsIntersecting(widgetsRect);
+    for (PageViewItem *i : nearItems)
+        createItemWidgets(i);
+
+    // move the widgets of the items that have them
     d->visibleItems.clear();
     QLinkedList<Okular::PixmapRequest *> requestedPixmaps;
     QVector<Okular::VisiblePageRect *> visibleRects;
-    for (PageViewItem *i : qAsConst(d->items)) {
+    for (PageViewItem *i : qAsConst(d->itemsWithWidgets)) {
         const QSet<FormWidgetIface *> formWidgetsList = i->formWidgets();
         for (FormWidgetIface *fwi : formWidgetsList) {
             Okular::NormalizedRect r = fwi->rect();
@@ -4550,18 +5089,19 @@ void PageView::slotRequestVisiblePixmaps(int newValue)
                 vw->pageLeft();
             }
         }
+    }
 
-        if (!i->isVisible())
-            continue;
+    // the pages flying by are not looked at closely
+    const bool scrollingFast = d->scrollVelocityTimer.isValid() && d->scrollVelocityTimer.elapsed() <= kScrollVelocityTimeout && qAbs(d->scrollVelocity) >= kMinDraftVelocity;
+
+    // iterate over the items intersecting the viewport
+    const QVector<PageViewItem *> intersectingItems = d->itemsIntersecting(viewportRect);
+    for (PageViewItem *i : intersectingItems) {
 #ifdef PAGEVIEW_DEBUG
         qWarning() << "checking page" << i->pageNumber();
         qWarning().nospace() << "viewportRect is " << viewportRect << ", page item is " << i->croppedGeometry() << " intersect : " << viewportRect.intersects(i->croppedGeometry());
 #endif
-        // if the item doesn't intersect the viewport, skip it
         QRect intersectionRect = viewportRect.intersected(i->croppedGeometry());
-        if (intersectionRect.isEmpty()) {
-            continue;
-        }
 
         // add the item to the 'visible list'
         d->visibleItems.push_back(i);
@@ -4586,7 +5126,10 @@ void PageView::slotRequestVisiblePixmaps(int newValue)
 #ifdef PAGEVIEW_DEBUG
             qWarning() << "rerequesting visible pixmaps for page" << i->pageNumber() << "!";
 #endif
-            Okular::PixmapRequest *p = new Okular::PixmapRequest(this, i->pageNumber(), i->uncroppedWidth(), i->uncroppedHeight(), devicePixelRatioF(), PAGEVIEW_PRIO, Okular::PixmapRequest::Asynchronous);
+            Okular::PixmapRequest::PixmapRequestFeatures features = Okular::PixmapRequest::Asynchronous | Okular::PixmapRequest::Progressive;
+            if (scrollingFast && !i->page()->hasTilesManager(this))
+                features |= Okular::PixmapRequest::Draft;
+            Okular::PixmapRequest *p = new Okular::PixmapRequest(this, i->pageNumber(), i->uncroppedWidth(), i->uncroppedHeight(), devicePixelRatioF(), PAGEVIEW_PRIO, features);
             requestedPixmaps.push_back(p);
 
             if (i->page()->hasTilesManager(this)) {
@@ -4617,29 +5160,77 @@ void PageView::slotRequestVisiblePixmaps(int newValue)
         }
     }
 
+    // the text of the pages shown comes before the one of the pages around,
+    // the pages that are not shown anymore (or fly by) don't wait for theirs
+    QSet<int> textPageRequests;
+    if (!scrollingFast) {
+        for (const PageViewItem *i : qAsConst(d->visibleItems)) {
+            if (!i->page()->hasTextPage()) {
+                d->document->requestTextPage(i->pageNumber(), Okular::Document::VisibleTextPagePriority);
+                textPageRequests.insert(i->pageNumber());
+            }
+        }
+    }
+    for (const int page : qAsConst(d->textPageRequests)) {
+        if (!textPageRequests.contains(page))
+            d->document->cancelTextPageRequest(page);
+    }
+    d->textPageRequests = textPageRequests;
+
     // if preloading is enabled, add the pages before and after in preloading
     if (!d->visibleItems.isEmpty() && Okular::SettingsCore::memoryLevel() != Okular::SettingsCore::EnumMemoryLevel::Low) {
         // as the requests are done in the order as they appear in the list,
         // request first the next page and then the previous
 
-        int pagesToPreload = viewColumns();
+        int pagesToPreloadAfter = viewColumns();
+        int pagesToPreloadBefore = viewColumns();
+        int pixelsToExpandAfter = pixelsToExpand;
+        int pixelsToExpandBefore = pixelsToExpand;
 
+        const bool stillScrolling = d->scrollVelocityTimer.isValid() && d->scrollVelocityTimer.elapsed() <= kScrollVelocityTimeout;
         // if the greedy option is set, preload all pages
-        if (Okular::SettingsCore::memoryLevel() == Okular::SettingsCore::EnumMemoryLevel::Greedy)
-            pagesToPreload = d->items.count();
+        if (Okular::SettingsCore::memoryLevel() == Okular::SettingsCore::EnumMemoryLevel::Greedy) {
+            pagesToPreloadAfter = d->items.count();
+            pagesToPreloadBefore = d->items.count();
+        } else if (stillScrolling && qAbs(d->scrollVelocity) >= kMinPrefetchVelocity) {
+            // when scrolling fast preload what is going to come into view in the next
+            // moments and nothing behind, the requests for those are dropped by
+            // requestPixmaps() as they are not asked again
+            const PageViewItem *item = d->visibleItems.first();
+            const int lookaheadPixels = qAbs(d->scrollVelocity) * kPrefetchLookahead;
+            int pagesAhead = viewColumns() * (1 + lookaheadPixels / qMax(1, item->croppedHeight()));
+
+            // but not more than what fits in memory without evicting the visible pages
+            const qreal dpr = devicePixelRatioF();
+            const qulonglong pageBytes = qMax<qulonglong>(1, 4 * qulonglong(item->uncroppedWidth() * dpr) * qulonglong(item->uncroppedHeight() * dpr));
+            const qulonglong pagesThatFit = d->document->availablePixmapMemory() / pageBytes;
+            pagesAhead = qMax(viewColumns(), (int)qMin<qulonglong>(pagesAhead, pagesThatFit));
+
+            if (d->scrollVelocity > 0) {
+                pagesToPreloadAfter = pagesAhead;
+                pagesToPreloadBefore = 0;
+                pixelsToExpandAfter = qMax(pixelsToExpand, lookaheadPixels);
+                pixelsToExpandBefore = 0;
+            } else {
+                pagesToPreloadBefore = pagesAhead;
+                pagesToPreloadAfter = 0;
+                pixelsToExpandBefore = qMax(pixelsToExpand, lookaheadPixels);
+                pixelsToExpandAfter = 0;
+            }
+        }
 
-        const QRect expandedViewportRect = viewportRect.adjusted(0, -pixelsToExpand, 0, pixelsToExpand);
+        const QRect expandedViewportRect = viewportRect.adjusted(0, -pixelsToExpandBefore, 0, pixelsToExpandAfter);
 
-        for (int j = 1; j <= pagesToPreload; j++) {
+        for (int j = 1; j <= qMax(pagesToPreloadAfter, pagesToPreloadBefore); j++) {
             // add the page after the 'visible series' in preload
             const int tailRequest = d->visibleItems.last()->pageNumber() + j;
-            if (tailRequest < (int)d->items.count()) {
+            if (j <= pagesToPreloadAfter && tailRequest < (int)d->items.count()) {
                 slotRequestPreloadPixmap(this, d->items[tailRequest], expandedViewportRect, &requestedPixmaps);
             }
 
             // add the page before the 'visible series' in preload
             const int headRequest = d->visibleItems.first()->pageNumber() - j;
-            if (headRequest >= 0) {
+            if (j <= pagesToPreloadBefore && headRequest >= 0) {
                 slotRequestPreloadPixmap(this, d->items[headRequest], expandedViewportRect, &requestedPixmaps);
             }
 
@@ -4647,6 +5238,18 @@ void PageView::slotRequestVisiblePixmaps(int newValue)
             if (headRequest < 0 && tailRequest >= (int)d->items.count())
                 break;
         }
+
+        // then the pages of the next matches of the search, so that going to
+        // them shows them at once; the document cancels them when it is reset
+        d->searchPreloadPages = d->document->upcomingSearchMatchPages(PART_SEARCH_ID);
+        const int firstPreloaded = d->visibleItems.first()->pageNumber() - pagesToPreloadBefore;
+        const int lastPreloaded = d->visibleItems.last()->pageNumber() + pagesToPreloadAfter;
+        for (const int page : qAsConst(d->searchPreloadPages)) {
+            if ((page < firstPreloaded || page > lastPreloaded) && page < d->items.count())
+                requestSearchPreloadPixmap(this, d->items[page], d->document->upcomingSearchMatchRect(PART_SEARCH_ID, page), viewport()->size(), &requestedPixmaps);
+        }
+    } else {
+        d->searchPreloadPages.clear();
     }
 
     // send requests to the document
@@ -4999,6 +5602,8 @@ void PageView::slotTrimMarginsToggled(bool on)
         if (d->document->pages() > 0) {
             slotRelayoutPages();
             slotRequestVisiblePixmaps(); // TODO: slotRelayoutPages() may have done this already!
+            if (on)
+                d->document->computeBoundingBoxes();
         }
     }
 }
@@ -5044,14 +5649,18 @@ void PageView::slotToggleForms()
     toggleFormWidgets(!d->m_formsVisible);
 }
 
-void PageView::slotFormChanged(int pageNumber)
+void PageView::slotFormChanged(int pageNumber, const Okular::NormalizedRect &area)
 {
     if (!d->refreshTimer) {
         d->refreshTimer = new QTimer(this);
         d->refreshTimer->setSingleShot(true);
         connect(d->refreshTimer, &QTimer::timeout, this, &PageView::slotRefreshPage);
     }
-    d->refreshPages << pageNumber;
+    QHash<int, Okular::NormalizedRect>::iterator it = d->refreshPages.find(pageNumber);
+    if (it == d->refreshPages.end())
+        d->refreshPages.insert(pageNumber, area);
+    else if (!it->isNull())
+        *it = area.isNull() ? area : *it | area;
     int delay = 0;
     if (d->m_formsVisible) {
         delay = 1000;
@@ -5061,8 +5670,11 @@ void PageView::slotFormChanged(int pageNumber)
 
 void PageView::slotRefreshPage()
 {
-    for (int req : qAsConst(d->refreshPages)) {
-        QTimer::singleShot(0, this, [this, req] { d->document->refreshPixmaps(req); });
+    QHash<int, Okular::NormalizedRect>::const_iterator it = d->refreshPages.constBegin(), itEnd = d->refreshPages.constEnd();
+    for (; it != itEnd; ++it) {
+        const int req = it.key();
+        const Okular::NormalizedRect area = it.value();
+        QTimer::singleShot(0, this, [this, req, area] { d->document->refreshPixmaps(req, area); });
     }
     d->refreshPages.clear();
 }
@@ -5137,6 +5749,7 @@ void PageView::slotProcessMovieAction(const Okular::MovieAction *action)
     if (!item)
         return;
 
+    createItemWidgets(item);
     VideoWidget *vw = item->videoWidgets().value(movie);
     if (!vw)
         return;
@@ -5172,6 +5785,7 @@ void PageView::slotProcessRenditionAction(const Okular::RenditionAction *action)
     if (!item)
         return;
 
+    createItemWidgets(item);
     VideoWidget *vw = item->videoWidgets().value(movie);
     if (!vw)
         return;
@@ -5239,6 +5853,9 @@ void PageView::highlightSignatureFormWidget(const Okular::FormFieldSignature *fo
 {
     QVector<PageViewItem *>::const_iterator dIt = d->items.constBegin(), dEnd = d->items.constEnd();
     for (; dIt != dEnd; ++dIt) {
+        if (!(*dIt)->page()->formFields().contains(const_cast<Okular::FormFieldSignature *>(form)))
+            continue;
+        createItemWidgets(*dIt);
         const QSet<FormWidgetIface *> fwi = (*dIt)->formWidgets();
         for (FormWidgetIface *fw : fwi) {
             if (fw->formField() == form) {
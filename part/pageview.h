@@ -80,6 +80,7 @@ public:
     void notifySetup(const QVector<Okular::Page *> &pages, int setupFlags) override;
     void notifyViewportChanged(bool smoothMove) override;
     void notifyPageChanged(int pageNumber, int changedFlags) override;
+    void notifyPagesChanged(const QVector<int> &pages, int changedFlags) override;
     void notifyContentsCleared(int changedFlags) override;
     void notifyZoom(int factor) override;
     bool canUnloadPixmap(int pageNum) const override;
@@ -125,7 +126,7 @@ public Q_SLOTS:
     void slotSelectPage();
 
     void slotAction(Okular::Action *action);
-    void slotFormChanged(int pageNumber);
+    void slotFormChanged(int pageNumber, const Okular::NormalizedRect &area);
 
     void externalKeyPressEvent(QKeyEvent *e);
 
@@ -180,6 +181,10 @@ private:
     double zoomFactorFitMode(ZoomMode mode);
     // update internal zoom values and end in a slotRelayoutPages();
     void updateZoom(ZoomMode newZoomMode);
+    // the zoom preset steps after factor, before it if steps is negative
+    float zoomPresetAfter(float factor, int steps);
+    // scale the pages from startFactor to newFactor around anchor, without laying them out
+    void setGestureZoom(float startFactor, float newFactor, const QPointF anchor);
     // update the text on the label using global zoom value or current page's one
     void updateZoomText();
     // update view mode (single, facing...)
@@ -215,6 +220,9 @@ private:
     bool mouseReleaseOverLink(const Okular::ObjectRect *rect) const;
 
     void createAnnotationsVideoWidgets(PageViewItem *item, const QLinkedList<Okular::Annotation *> &annotations);
+    // the form and video widgets only exist for the items near the viewport
+    void createItemWidgets(PageViewItem *item);
+    void deleteItemWidgets(PageViewItem *item);
 
     // Update speed of animated smooth scroll transitions
     void updateSmoothScrollAnimationSpeed();
@@ -236,6 +244,8 @@ private Q_SLOTS:
     void slotRelayoutPages();
     // activated by the resize event delay timer
     void delayedResizeEvent();
+    // lay out and render the zoom of the gesture, activated when it ends
+    void finishGestureZoom();
     // activated either directly or via the contentsMoving(int,int) signal
     void slotRequestVisiblePixmaps(int newValue = -1);
     // activated by the autoscroll timer (Shift+Up/Down keys)
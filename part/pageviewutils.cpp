@@ -14,6 +14,10 @@
 #include <QMenu>
 #include <QPainter>
 #include <QTimer>
+#include <QtMath>
+
+#include <algorithm>
+#include <iterator>
 
 // local includes
 #include "core/form.h"
@@ -32,6 +36,7 @@ PageViewItem::PageViewItem(const Okular::Page *page)
     , m_visible(true)
     , m_formsVisible(false)
     , m_crop(0., 0., 1., 1.)
+    , m_formFieldsOrderDirty(true)
 {
 }
 
@@ -116,6 +121,29 @@ QHash<Okular::Movie *, VideoWidget *> &PageViewItem::videoWidgets()
     return m_videoWidgets;
 }
 
+const QVector<Okular::FormField *> &PageViewItem::formFieldsInReadingOrder()
+{
+    if (m_formFieldsOrderDirty) {
+        const QLinkedList<Okular::FormField *> fields = m_page->formFields();
+        m_formFieldsOrder.clear();
+        m_formFieldsOrder.reserve(fields.count());
+        std::copy(fields.begin(), fields.end(), std::back_inserter(m_formFieldsOrder));
+        // fields whose tops are within a hundredth of the page are in the same row
+        std::stable_sort(m_formFieldsOrder.begin(), m_formFieldsOrder.end(), [](const Okular::FormField *a, const Okular::FormField *b) {
+            const int rowA = qFloor(a->rect().top * 100), rowB = qFloor(b->rect().top * 100);
+            return rowA < rowB || (rowA == rowB && a->rect().left < b->rect().left);
+        });
+        m_formFieldsOrderDirty = false;
+    }
+    return m_formFieldsOrder;
+}
+
+void PageViewItem::resetFormFieldsOrder()
+{
+    m_formFieldsOrder.clear();
+    m_formFieldsOrderDirty = true;
+}
+
 void PageViewItem::setWHZC(int w, int h, double z, const Okular::NormalizedRect &c)
 {
     m_croppedGeometry.setWidth(w);
@@ -13,6 +13,7 @@
 #include <QHash>
 #include <QPixmap>
 #include <QRect>
+#include <QVector>
 #include <qwidget.h>
 
 #include "core/area.h"
@@ -49,6 +50,11 @@ public:
     bool isVisible() const;
     QSet<FormWidgetIface *> &formWidgets();
     QHash<Okular::Movie *, VideoWidget *> &videoWidgets();
+    // the form fields of the page by rows from the top, and from the left in
+    // a row: the order of their widgets in the focus chain
+    const QVector<Okular::FormField *> &formFieldsInReadingOrder();
+    // to be called when the form fields of the page are replaced
+    void resetFormFieldsOrder();
 
     /* The page is cropped as follows: */
     const Okular::NormalizedRect &crop() const;
@@ -89,6 +95,8 @@ private:
     Okular::NormalizedRect m_crop;
     QSet<FormWidgetIface *> m_formWidgets;
     QHash<Okular::Movie *, VideoWidget *> m_videoWidgets;
+    QVector<Okular::FormField *> m_formFieldsOrder;
+    bool m_formFieldsOrderDirty;
 };
 
 /**
@@ -36,6 +36,7 @@
 #include <QPrintDialog>
 #include <QPrintPreviewDialog>
 #include <QPrinter>
+#include <QProgressDialog>
 #include <QScrollBar>
 #include <QSlider>
 #include <QSpinBox>
@@ -281,6 +282,7 @@ namespace Okular
 Part::Part(QWidget *parentWidget, QObject *parent, const QVariantList &args)
     : KParts::ReadWritePart(parent)
     , m_tempfile(nullptr)
+    , m_tempfileSourceSize(-1)
     , m_documentOpenWithPassword(false)
     , m_swapInsteadOfOpening(false)
     , m_tocEnabled(false)
@@ -351,6 +353,11 @@ Part::Part(QWidget *parentWidget, QObject *parent, const QVariantList &args)
     connect(m_document, &Document::openUrl, this, &Part::openUrlFromDocument);
     connect(m_document->bookmarkManager(), &BookmarkManager::openUrl, this, &Part::openUrlFromBookmarks);
     connect(m_document, &Document::close, this, &Part::close);
+    // openFile() only saw the first pages
+    connect(m_document, &Document::pagesLoaded, this, [this] {
+        updateFormsAndSignatureMessages();
+        updateViewActions();
+    });
     connect(m_document, &Document::undoHistoryCleanChanged, this, [this](bool clean) {
         setModified(!clean);
         setWindowTitleFromDocument();
@@ -391,12 +398,24 @@ Part::Part(QWidget *parentWidget, QObject *parent, const QVariantList &args)
     m_sidebar->setCurrentItem(thumbsBox);
 
     // [left toolbox: Reviews] | []
-    m_reviewsWidget = new Reviews(nullptr, m_document);
-    m_sidebar->addItem(m_reviewsWidget, QIcon::fromTheme(QStringLiteral("draw-freehand")), i18n("Annotations"));
+    // created when first shown, like the bookmarks below, nothing needs them to show the document
+    m_sidebar->addItem(new DeferredSidebarItem([this] {
+                           m_reviewsWidget = new Reviews(nullptr, m_document);
+                           connect(m_reviewsWidget.data(), &Reviews::openAnnotationWindow, m_pageView.data(), &PageView::openAnnotationWindow);
+                           m_document->addObserver(m_reviewsWidget);
+                           return m_reviewsWidget.data();
+                       }),
+                       QIcon::fromTheme(QStringLiteral("draw-freehand")),
+                       i18n("Annotations"));
 
     // [left toolbox: Bookmarks] | []
-    m_bookmarkList = new BookmarkList(m_document, nullptr);
-    m_sidebar->addItem(m_bookmarkList, QIcon::fromTheme(QStringLiteral("bookmarks")), i18n("Bookmarks"));
+    m_sidebar->addItem(new DeferredSidebarItem([this] {
+                           m_bookmarkList = new BookmarkList(m_document, nullptr);
+                           m_document->addObserver(m_bookmarkList);
+                           return m_bookmarkList.data();
+                       }),
+                       QIcon::fromTheme(QStringLiteral("bookmarks")),
+                       i18n("Bookmarks"));
 
     // [left toolbox optional item: Signature Panel] | []
     m_signaturePanel = new SignaturePanel(m_document, nullptr);
@@ -508,8 +527,6 @@ Part::Part(QWidget *parentWidget, QObject *parent, const QVariantList &args)
         Q_EMIT urlsDropped({u});
     });
 
-    connect(m_reviewsWidget.data(), &Reviews::openAnnotationWindow, m_pageView.data(), &PageView::openAnnotationWindow);
-
     // add document observers
     m_document->addObserver(this);
     m_document->addObserver(m_thumbnailList);
@@ -520,9 +537,7 @@ Part::Part(QWidget *parentWidget, QObject *parent, const QVariantList &args)
 #ifdef OKULAR_ENABLE_MINIBAR
     m_document->addObserver(m_progressWidget);
 #endif
-    m_document->addObserver(m_reviewsWidget);
     m_document->addObserver(m_pageSizeLabel);
-    m_document->addObserver(m_bookmarkList);
     m_document->addObserver(m_signaturePanel);
 
     connect(m_document->bookmarkManager(), &BookmarkManager::saved, this, &Part::slotRebuildBookmarkMenu);
@@ -1154,6 +1169,7 @@ void Part::slotJobStarted(KIO::Job *job)
         job->addMetaData(QStringLiteral("accept"), supportedMimeTypes.join(QStringLiteral(", ")) + QStringLiteral(", */*;q=0.5"));
 
         connect(job, &KJob::result, this, &Part::slotJobFinished);
+        connect(job, &KJob::percent, this, &Part::slotJobPercent);
     }
 }
 
@@ -1164,6 +1180,13 @@ void Part::slotJobFinished(KJob *job)
     }
 }
 
+void Part::slotJobPercent(KJob *job, unsigned long percent)
+{
+    Q_UNUSED(job)
+    // generators need the whole file, tell how long until the document can be shown
+    m_pageView->displayMessage(i18nc("%1 is a file name, %2 a percentage", "Downloading %1: %2%", realUrl().fileName(), percent));
+}
+
 void Part::loadCancelled(const QString &reason)
 {
     emit setWindowCaption(QString());
@@ -1251,6 +1274,8 @@ void Part::notifyPageChanged(int page, int flags)
 
 void Part::goToPage(uint page)
 {
+    if (page > m_document->pages() && m_document->isLoadingPages())
+        m_document->loadAllPages();
     if (page <= m_document->pages())
         m_document->setViewportPage(page - 1);
 }
@@ -1535,62 +1560,10 @@ bool Part::openFile()
     m_topMessage->setVisible(hasEmbeddedFiles && Okular::Settings::showEmbeddedContentMessages());
     m_migrationMessage->setVisible(m_document->isDocdataMigrationNeeded());
 
-    // Warn the user that XFA forms are not supported yet (NOTE: poppler generator only)
-    if (ok && Okular::Settings::showEmbeddedContentMessages() && m_document->metaData(QStringLiteral("HasUnsupportedXfaForm")).toBool() == true) {
-        m_formsMessage->setText(i18n("This document has XFA forms, which are currently <b>unsupported</b>."));
-        m_formsMessage->setIcon(QIcon::fromTheme(QStringLiteral("dialog-warning")));
-        m_formsMessage->setMessageType(KMessageWidget::Warning);
-        m_formsMessage->setVisible(true);
-    }
-    // m_pageView->toggleFormsAction() may be null on dummy mode
-    else if (ok && Okular::Settings::showEmbeddedContentMessages() && m_pageView->toggleFormsAction() && m_pageView->toggleFormsAction()->isEnabled()) {
-        m_formsMessage->setText(i18n("This document has forms. Click on the button to interact with them, or use View -> Show Forms."));
-        m_formsMessage->setMessageType(KMessageWidget::Information);
-        m_formsMessage->setVisible(true);
-    } else {
+    if (ok)
+        updateFormsAndSignatureMessages();
+    else
         m_formsMessage->setVisible(false);
-    }
-
-    if (ok) {
-        const uint numPages = m_document->pages();
-        bool isDigitallySigned = false;
-        for (uint i = 0; i < numPages; i++) {
-            const QLinkedList<Okular::FormField *> formFields = m_document->page(i)->formFields();
-            for (const Okular::FormField *f : formFields) {
-                if (f->type() == Okular::FormField::FormSignature)
-                    isDigitallySigned = true;
-            }
-        }
-
-        if (isDigitallySigned && Okular::Settings::showEmbeddedContentMessages()) {
-            if (m_embedMode == PrintPreviewMode) {
-                m_signatureMessage->setText(i18n("All editing and interactive features for this document are disabled. Please save a copy and reopen to edit this document."));
-            } else {
-                const QVector<const Okular::FormFieldSignature *> signatureFormFields = SignatureGuiUtils::getSignatureFormFields(m_document, true, 0);
-                bool allSignaturesValid = true;
-                for (const Okular::FormFieldSignature *signature : signatureFormFields) {
-                    const Okular::SignatureInfo &info = signature->signatureInfo();
-                    if (info.signatureStatus() != SignatureInfo::SignatureValid) {
-                        allSignaturesValid = false;
-                    }
-                }
-
-                if (allSignaturesValid) {
-                    if (signatureFormFields.last()->signatureInfo().signsTotalDocument()) {
-                        m_signatureMessage->setMessageType(KMessageWidget::Information);
-                        m_signatureMessage->setText(i18n("This document is digitally signed."));
-                    } else {
-                        m_signatureMessage->setMessageType(KMessageWidget::Warning);
-                        m_signatureMessage->setText(i18n("This document is digitally signed. There have been changes since last signed."));
-                    }
-                } else {
-                    m_signatureMessage->setMessageType(KMessageWidget::Warning);
-                    m_signatureMessage->setText(i18n("This document is digitally signed. Some of the signatures could not be validated properly."));
-                }
-            }
-            m_signatureMessage->setVisible(true);
-        }
-    }
 
     if (m_showPresentation)
         m_showPresentation->setEnabled(ok);
@@ -1874,8 +1847,11 @@ bool Part::closeUrl(bool promptToSave)
     m_document->closeDocument();
     m_fileLastModified = QDateTime();
     updateViewActions();
-    delete m_tempfile;
-    m_tempfile = nullptr;
+    // reloading may open the same compressed file again
+    if (!m_isReloading) {
+        delete m_tempfile;
+        m_tempfile = nullptr;
+    }
     if (widget()) {
         m_searchWidget->clearText();
         m_migrationMessage->setVisible(false);
@@ -1905,6 +1881,9 @@ void Part::guiActivateEvent(KParts::GUIActivateEvent *event)
 
     setWindowTitleFromDocument();
 
+    // the documents of the other tabs give their memory back first
+    m_document->setActive(event->activated());
+
     if (event->activated()) {
         m_pageView->setupActionsPostGUIActivated();
     }
@@ -1984,6 +1963,17 @@ bool Part::slotAttemptReload(bool oneShot, const QUrl &newUrl)
     }
     QScopedValueRollback<bool> rollback(m_isReloading, true);
 
+    // the generator may take the new contents without closing the document,
+    // then only the pages that changed are rendered again; a compressed file
+    // has to be decompressed again first
+    if (newUrl.isEmpty() && !m_tempfile && m_viewportDirty.pageNumber == -1 && m_document->reloadInPlace()) {
+        m_fileWasRemoved = false;
+        m_toc->prepareForReload();
+        m_toc->notifySetup(QVector<Okular::Page *>(), Okular::DocumentObserver::DocumentChanged);
+        m_toc->finishReload();
+        return true;
+    }
+
     bool tocReloadPrepared = false;
 
     // do the following the first time the file is reloaded
@@ -2276,6 +2266,7 @@ protected:
 
 void Part::slotGoToPage()
 {
+    m_document->loadAllPages();
     GotoPageDialog pageDialog(m_pageView, m_document->currentPage() + 1, m_document->pages());
     if (pageDialog.exec() == QDialog::Accepted)
         m_document->setViewportPage(pageDialog.getPage() - 1, nullptr, true);
@@ -2304,6 +2295,7 @@ void Part::slotGotoFirst()
 void Part::slotGotoLast()
 {
     if (m_document->isOpened()) {
+        m_document->loadAllPages();
         DocumentViewport endPage(m_document->pages() - 1);
         endPage.rePos.enabled = true;
         endPage.rePos.normalizedX = 0;
@@ -2504,6 +2496,21 @@ static QUrl resolveSymlinksIfFileExists(const QUrl &saveUrl)
     }
 }
 
+// Moves the temporary file written for saveUrl over it, when it was created
+// next to it, instead of copying it; the temporary file is only readable by
+// the user, so it takes the permissions of the file it replaces. A new file
+// is copied, so it gets the default permissions
+static KIO::Job *moveTemporaryFile(const QString &fileName, const QUrl &saveUrl)
+{
+    if (saveUrl.isLocalFile() && QFileInfo(fileName).absolutePath() == QFileInfo(saveUrl.toLocalFile()).absolutePath()) {
+        const QFileInfo saveInfo(saveUrl.toLocalFile());
+        if (saveInfo.exists() && QFile::setPermissions(fileName, saveInfo.permissions()))
+            return KIO::file_move(QUrl::fromLocalFile(fileName), saveUrl, -1, KIO::Overwrite | KIO::HideProgressInfo);
+    }
+
+    return KIO::file_copy(QUrl::fromLocalFile(fileName), saveUrl, -1, KIO::Overwrite);
+}
+
 bool Part::saveAs(const QUrl &saveUrl, SaveAsFlags flags)
 {
     // TODO When we get different saving backends we need to query the backend
@@ -2533,18 +2540,25 @@ bool Part::saveAs(const QUrl &saveUrl, SaveAsFlags flags)
 
     bool setModifiedAfterSave = false;
 
+    // Figure out the real save url, for symlinks we don't want to copy over the symlink but over the target file
+    const QUrl realSaveUrl = resolveSymlinksIfFileExists(saveUrl);
+
+    // Local files are written next to their destination and then moved over
+    // it, like QSaveFile does, so they are not written twice
     QTemporaryFile tf;
+    if (realSaveUrl.isLocalFile()) {
+        tf.setFileTemplate(realSaveUrl.toLocalFile() + QLatin1String(".XXXXXX"));
+        if (!tf.open())
+            tf.setFileTemplate(QDir::tempPath() + QLatin1String("/okular_XXXXXX"));
+    }
     QString fileName;
-    if (!tf.open()) {
+    if (!tf.isOpen() && !tf.open()) {
         KMessageBox::information(widget(), i18n("Could not open the temporary file for saving."));
         return false;
     }
     fileName = tf.fileName();
     tf.close();
 
-    // Figure out the real save url, for symlinks we don't want to copy over the symlink but over the target file
-    const QUrl realSaveUrl = resolveSymlinksIfFileExists(saveUrl);
-
     // Due to the way we write we can overwrite readonly files so check if it's one and just bail out early
     if (realSaveUrl.isLocalFile()) {
         const QFileInfo fi(realSaveUrl.toLocalFile());
@@ -2576,7 +2590,7 @@ bool Part::saveAs(const QUrl &saveUrl, SaveAsFlags flags)
             return false;
         }
 
-        copyJob = KIO::file_copy(QUrl::fromLocalFile(fileName), realSaveUrl, -1, KIO::Overwrite);
+        copyJob = moveTemporaryFile(fileName, realSaveUrl);
     } else {
         bool wontSaveForms, wontSaveAnnotations;
         checkNativeSaveDataLoss(&wontSaveForms, &wontSaveAnnotations);
@@ -2636,16 +2650,30 @@ bool Part::saveAs(const QUrl &saveUrl, SaveAsFlags flags)
             // If the generator supports saving changes, save them
 
             QString errorText;
-            if (!m_document->saveChanges(fileName, &errorText)) {
+
+            // Saving over the open file, appending the changes to it is enough
+            bool savedInPlace = false;
+            if (!isDocumentArchive && realSaveUrl.isLocalFile() && url().isLocalFile() && realSaveUrl.toLocalFile() == QFileInfo(localFilePath()).canonicalFilePath() && m_document->canSaveChangesInPlace()) {
+                unsetFileToWatch();
+                savedInPlace = m_document->saveChangesInPlace(realSaveUrl.toLocalFile(), &errorText);
+            }
+
+            if (savedInPlace) {
+                copyJob = KIO::setModificationTime(realSaveUrl, QDateTime::currentDateTime());
+            } else if (!m_document->saveChanges(fileName, &errorText)) {
                 if (errorText.isEmpty())
                     KMessageBox::information(widget(), i18n("File could not be saved in '%1'. Try to save it to another location.", fileName));
                 else
                     KMessageBox::information(widget(), i18n("File could not be saved in '%1'. %2", fileName, errorText));
 
+                // Restore watcher
+                if (url().isLocalFile())
+                    setFileToWatch(localFilePath());
+
                 return false;
+            } else {
+                copyJob = moveTemporaryFile(fileName, realSaveUrl);
             }
-
-            copyJob = KIO::file_copy(QUrl::fromLocalFile(fileName), realSaveUrl, -1, KIO::Overwrite);
         } else {
             // If the generators doesn't support saving changes, we will
             // just copy the original file.
@@ -2661,7 +2689,7 @@ bool Part::saveAs(const QUrl &saveUrl, SaveAsFlags flags)
                     return false;
                 }
 
-                copyJob = KIO::file_copy(QUrl::fromLocalFile(fileName), realSaveUrl, -1, KIO::Overwrite);
+                copyJob = moveTemporaryFile(fileName, realSaveUrl);
             } else {
                 // Otherwise just copy the open file.
                 // make use of the already downloaded (in case of remote URLs) file,
@@ -2810,7 +2838,7 @@ void Part::checkNativeSaveDataLoss(bool *out_wontSaveForms, bool *out_wontSaveAn
 void Part::slotPreferences()
 {
     // Create dialog
-    PreferencesDialog *dialog = new PreferencesDialog(m_pageView, Okular::Settings::self(), m_embedMode);
+    PreferencesDialog *dialog = new PreferencesDialog(m_pageView, Okular::Settings::self(), m_embedMode, m_document);
     dialog->setAttribute(Qt::WA_DeleteOnClose);
 
     // Show it
@@ -2831,7 +2859,7 @@ void Part::slotSetChangeColors(bool active)
 void Part::slotAccessibilityPreferences()
 {
     // Create dialog
-    PreferencesDialog *dialog = new PreferencesDialog(m_pageView, Okular::Settings::self(), m_embedMode);
+    PreferencesDialog *dialog = new PreferencesDialog(m_pageView, Okular::Settings::self(), m_embedMode, m_document);
     dialog->setAttribute(Qt::WA_DeleteOnClose);
 
     // Show it
@@ -2842,7 +2870,7 @@ void Part::slotAccessibilityPreferences()
 void Part::slotAnnotationPreferences()
 {
     // Create dialog
-    PreferencesDialog *dialog = new PreferencesDialog(m_pageView, Okular::Settings::self(), m_embedMode);
+    PreferencesDialog *dialog = new PreferencesDialog(m_pageView, Okular::Settings::self(), m_embedMode, m_document);
     dialog->setAttribute(Qt::WA_DeleteOnClose);
 
     // Show it
@@ -2873,7 +2901,8 @@ void Part::slotNewConfig()
         m_thumbnailList->updateWidgets();
 
     // update Reviews settings
-    m_reviewsWidget->reparseConfig();
+    if (m_reviewsWidget)
+        m_reviewsWidget->reparseConfig();
 
     setWindowTitleFromDocument();
 
@@ -2890,6 +2919,9 @@ void Part::slotPrintPreview()
     if (m_document->pages() == 0)
         return;
 
+    // all of them are printed
+    m_document->loadAllPages();
+
     QPrinter printer;
     QString tempFilePattern;
 
@@ -3131,20 +3163,58 @@ void Part::slotExportAs(QAction *act)
     QString fileName = QFileDialog::getSaveFileName(widget(), QString(), QString(), filter);
 
     if (!fileName.isEmpty()) {
-        bool saved = false;
         switch (id) {
         case 0:
-            saved = m_document->exportToText(fileName);
-            break;
+            exportToTextInBackground(fileName);
+            return;
         default:
-            saved = m_document->exportTo(fileName, m_exportFormats.at(id - 1));
-            break;
+            exportInBackground(fileName, m_exportFormats.at(id - 1));
+            return;
         }
-        if (!saved)
-            KMessageBox::information(widget(), i18n("File could not be saved in '%1'. Try to save it to another location.", fileName));
     }
 }
 
+void Part::exportInBackground(const QString &fileName, const Okular::ExportFormat &format)
+{
+    if (!m_document->startExport(fileName, format)) {
+        KMessageBox::information(widget(), i18n("File could not be saved in '%1'. Try to save it to another location.", fileName));
+        return;
+    }
+    // the generators do not tell how far they are
+    QProgressDialog *progress = new QProgressDialog(i18n("Exporting the document..."), i18n("Cancel"), 0, 0, widget());
+    progress->setWindowTitle(i18n("Export As"));
+    connect(progress, &QProgressDialog::canceled, m_document, &Okular::Document::cancelExport);
+    connect(m_document, &Okular::Document::exportFinished, progress, [this, progress](const QString &exportedFileName, bool success) {
+        const bool cancelled = progress->wasCanceled();
+        progress->deleteLater();
+        if (!success && !cancelled)
+            KMessageBox::information(widget(), i18n("File could not be saved in '%1'. Try to save it to another location.", exportedFileName));
+    });
+}
+
+void Part::exportToTextInBackground(const QString &fileName)
+{
+    if (!m_document->startTextExport(fileName)) {
+        KMessageBox::information(widget(), i18n("File could not be saved in '%1'. Try to save it to another location.", fileName));
+        return;
+    }
+
+    // the document can still be read meanwhile
+    QProgressDialog *progress = new QProgressDialog(i18n("Exporting the text of the document..."), i18n("Cancel"), 0, m_document->pages(), widget());
+    progress->setWindowTitle(i18n("Export As"));
+    connect(m_document, &Okular::Document::textExportProgress, progress, [progress](int pagesDone, int pageCount) {
+        progress->setMaximum(pageCount);
+        progress->setValue(pagesDone);
+    });
+    connect(progress, &QProgressDialog::canceled, m_document, &Okular::Document::cancelTextExport);
+    connect(m_document, &Okular::Document::textExportFinished, progress, [this, progress](const QString &exportedFileName, bool success) {
+        const bool cancelled = progress->wasCanceled();
+        progress->deleteLater();
+        if (!success && !cancelled)
+            KMessageBox::information(widget(), i18n("File could not be saved in '%1'. Try to save it to another location.", exportedFileName));
+    });
+}
+
 void Part::slotReload()
 {
     // stop the dirty handler timer, otherwise we may conflict with the
@@ -3159,6 +3229,9 @@ void Part::slotPrint()
     if (m_document->pages() == 0)
         return;
 
+    // for the print range
+    m_document->loadAllPages();
+
 #ifdef Q_OS_WIN
     QPrinter printer(QPrinter::HighResolution);
 #else
@@ -3348,7 +3421,17 @@ void Part::unsetDummyMode()
 
 bool Part::handleCompressed(QString &destpath, const QString &path, KFilterDev::CompressionType compressionType)
 {
-    m_tempfile = nullptr;
+    const QFileInfo sourceInfo(path);
+    if (m_tempfile) {
+        // the file is as it was when it was decompressed last time
+        if (path == m_tempfileSource && sourceInfo.lastModified() == m_tempfileSourceModified && sourceInfo.size() == m_tempfileSourceSize) {
+            destpath = m_tempfile->fileName();
+            return true;
+        }
+        delete m_tempfile;
+        m_tempfile = nullptr;
+    }
+    m_tempfileSource.clear();
 
     // we are working with a compressed file, decompressing
     // temporary file for decompressing
@@ -3405,6 +3488,9 @@ bool Part::handleCompressed(QString &destpath, const QString &path, KFilterDev::
         return false;
     }
     m_tempfile = newtempfile;
+    m_tempfileSource = path;
+    m_tempfileSourceModified = sourceInfo.lastModified();
+    m_tempfileSourceSize = sourceInfo.size();
     destpath = m_tempfile->fileName();
     return true;
 }
@@ -3479,6 +3565,64 @@ bool Part::eventFilter(QObject *watched, QEvent *event)
     return KParts::ReadWritePart::eventFilter(watched, event);
 }
 
+void Part::updateFormsAndSignatureMessages()
+{
+    // Warn the user that XFA forms are not supported yet (NOTE: poppler generator only)
+    if (Okular::Settings::showEmbeddedContentMessages() && m_document->metaData(QStringLiteral("HasUnsupportedXfaForm")).toBool() == true) {
+        m_formsMessage->setText(i18n("This document has XFA forms, which are currently <b>unsupported</b>."));
+        m_formsMessage->setIcon(QIcon::fromTheme(QStringLiteral("dialog-warning")));
+        m_formsMessage->setMessageType(KMessageWidget::Warning);
+        m_formsMessage->setVisible(true);
+    }
+    // m_pageView->toggleFormsAction() may be null on dummy mode
+    else if (Okular::Settings::showEmbeddedContentMessages() && m_pageView->toggleFormsAction() && m_pageView->toggleFormsAction()->isEnabled()) {
+        m_formsMessage->setText(i18n("This document has forms. Click on the button to interact with them, or use View -> Show Forms."));
+        m_formsMessage->setMessageType(KMessageWidget::Information);
+        m_formsMessage->setVisible(true);
+    } else {
+        m_formsMessage->setVisible(false);
+    }
+
+    const uint numPages = m_document->pages();
+    bool isDigitallySigned = false;
+    for (uint i = 0; i < numPages; i++) {
+        const QLinkedList<Okular::FormField *> formFields = m_document->page(i)->formFields();
+        for (const Okular::FormField *f : formFields) {
+            if (f->type() == Okular::FormField::FormSignature)
+                isDigitallySigned = true;
+        }
+    }
+
+    if (isDigitallySigned && Okular::Settings::showEmbeddedContentMessages()) {
+        if (m_embedMode == PrintPreviewMode) {
+            m_signatureMessage->setText(i18n("All editing and interactive features for this document are disabled. Please save a copy and reopen to edit this document."));
+        } else {
+            const QVector<const Okular::FormFieldSignature *> signatureFormFields = SignatureGuiUtils::getSignatureFormFields(m_document, true, 0);
+            bool allSignaturesValid = true;
+            for (const Okular::FormFieldSignature *signature : signatureFormFields) {
+                const Okular::SignatureInfo &info = signature->signatureInfo();
+                if (info.signatureStatus() != SignatureInfo::SignatureValid) {
+                    allSignaturesValid = false;
+                }
+            }
+
+            if (allSignaturesValid) {
+                if (signatureFormFields.last()->signatureInfo().signsTotalDocument()) {
+                    m_signatureMessage->setMessageType(KMessageWidget::Information);
+                    m_signatureMessage->setText(i18n("This document is digitally signed."));
+                } else {
+                    m_signatureMessage->setMessageType(KMessageWidget::Warning);
+                    m_signatureMessage->setText(i18n("This document is digitally signed. There have been changes since last signed."));
+                }
+            } else {
+                m_signatureMessage->setMessageType(KMessageWidget::Warning);
+                m_signatureMessage->setText(i18n("This document is digitally signed. Some of the signatures could not be validated properly."));
+            }
+        }
+        m_signatureMessage->setVisible(true);
+    }
+}
+
 void Part::updateAboutBackendAction()
 {
     const KPluginMetaData data = m_document->generatorInfo();
@@ -229,6 +229,7 @@ protected Q_SLOTS:
     void slotHideFindBar();
     void slotJobStarted(KIO::Job *job);
     void slotJobFinished(KJob *job);
+    void slotJobPercent(KJob *job, unsigned long percent);
     void loadCancelled(const QString &reason);
     void setWindowTitleFromDocument();
     // can be connected to widget elements
@@ -267,9 +268,13 @@ private:
 
     void setupPrint(QPrinter &printer);
     bool doPrint(QPrinter &printer);
+    void exportToTextInBackground(const QString &fileName);
+    void exportInBackground(const QString &fileName, const Okular::ExportFormat &format);
     bool handleCompressed(QString &destpath, const QString &path, KCompressionDevice::CompressionType compressionType);
     void rebuildBookmarkMenu(bool unplugActions = true);
     void updateAboutBackendAction();
+    // about the forms and signatures of all the pages the document has so far
+    void updateFormsAndSignatureMessages();
     void unsetDummyMode();
     void slotRenameBookmark(const DocumentViewport &viewport);
     void slotRemoveBookmark(const DocumentViewport &viewport);
@@ -305,6 +310,11 @@ private:
     static int numberOfParts;
 
     QTemporaryFile *m_tempfile;
+    // the compressed file m_tempfile has the contents of, it is kept on
+    // reloading and used again if that file did not change
+    QString m_tempfileSource;
+    QDateTime m_tempfileSourceModified;
+    qint64 m_tempfileSourceSize;
 
     // the document
     Okular::Document *m_document;
@@ -18,7 +18,7 @@
 #include "dlgperformance.h"
 #include "dlgpresentation.h"
 
-PreferencesDialog::PreferencesDialog(QWidget *parent, KConfigSkeleton *skeleton, Okular::EmbedMode embedMode)
+PreferencesDialog::PreferencesDialog(QWidget *parent, KConfigSkeleton *skeleton, Okular::EmbedMode embedMode, Okular::Document *document)
     : KConfigDialog(parent, QStringLiteral("preferences"), skeleton)
 {
     setWindowModality(Qt::ApplicationModal);
@@ -33,7 +33,9 @@ PreferencesDialog::PreferencesDialog(QWidget *parent, KConfigSkeleton *skeleton,
     m_editor = nullptr;
     m_signatures = nullptr;
 #ifdef OKULAR_DEBUG_CONFIGPAGE
-    m_debug = new DlgDebug(this);
+    m_debug = new DlgDebug(this, document);
+#else
+    Q_UNUSED(document)
 #endif
 
     addPage(m_general, i18n("General"), QStringLiteral("okular"), i18n("General Options"));
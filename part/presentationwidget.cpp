@@ -101,10 +101,36 @@ struct PresentationFrame {
         }
     }
 
+    // makes drawingLayer of size (in device pixels) with all the drawings, if it is not
+    void updateDrawingLayer(const QSize &size)
+    {
+        if (drawingLayer.size() == size)
+            return;
+
+        drawingLayer = QPixmap(size);
+        drawingLayer.fill(Qt::transparent);
+        for (const SmoothPath &drawing : qAsConst(drawings))
+            paintDrawing(drawing);
+    }
+
+    // rasterizes one more drawing onto drawingLayer, if there is one
+    void paintDrawing(const SmoothPath &drawing)
+    {
+        if (drawingLayer.isNull())
+            return;
+
+        QPainter painter(&drawingLayer);
+        painter.setRenderHints(QPainter::Antialiasing);
+        drawing.paint(&painter, drawingLayer.width(), drawingLayer.height());
+    }
+
     const Okular::Page *page;
     QRect geometry;
     QHash<Okular::Movie *, VideoWidget *> videoWidgets;
     QLinkedList<SmoothPath> drawings;
+    // the drawings so far, so painting does not draw them all again; only
+    // the frame shown has one
+    QPixmap drawingLayer;
 };
 
 // a custom QToolBar that basically does not propagate the event if the widget
@@ -140,6 +166,8 @@ PresentationWidget::PresentationWidget(QWidget *parent, Okular::Document *doc, D
     , m_drawingEngine(nullptr)
     , m_screenInhibitCookie(0)
     , m_sleepInhibitFd(-1)
+    , m_preparedPage(-1)
+    , m_pageToPrepare(-1)
     , m_parentWidget(parent)
     , m_document(doc)
     , m_frameIndex(-1)
@@ -153,6 +181,7 @@ PresentationWidget::PresentationWidget(QWidget *parent, Okular::Document *doc, D
     , m_inBlackScreenMode(false)
     , m_showSummaryView(Okular::Settings::slidesShowSummary())
     , m_advanceSlides(Okular::SettingsCore::slidesAdvance())
+    , m_advanceWhenReady(-1)
     , m_goToPreviousPageOnRelease(false)
     , m_goToNextPageOnRelease(false)
 {
@@ -252,7 +281,7 @@ PresentationWidget::PresentationWidget(QWidget *parent, Okular::Document *doc, D
     connect(m_overlayHideTimer, &QTimer::timeout, this, &PresentationWidget::slotHideOverlay);
     m_nextPageTimer = new QTimer(this);
     m_nextPageTimer->setSingleShot(true);
-    connect(m_nextPageTimer, &QTimer::timeout, this, &PresentationWidget::slotNextPage);
+    connect(m_nextPageTimer, &QTimer::timeout, this, &PresentationWidget::slotAutoAdvance);
     setPlayPauseIcon();
 
     connect(m_document, &Okular::Document::processMovieAction, this, &PresentationWidget::slotProcessMovieAction);
@@ -385,14 +414,31 @@ void PresentationWidget::notifyPageChanged(int pageNumber, int changedFlags)
     if (m_blockNotifications)
         return;
 
+    // the frame painted ahead is out of date
+    if ((changedFlags & (DocumentObserver::Pixmap | DocumentObserver::Annotations | DocumentObserver::Highlights)) && pageNumber == m_preparedPage) {
+        m_preparedPage = -1;
+        m_preparedPagePixmap = QPixmap();
+    }
+
     // check if it's the last requested pixmap. if so update the widget.
     if ((changedFlags & (DocumentObserver::Pixmap | DocumentObserver::Annotations | DocumentObserver::Highlights)) && pageNumber == m_frameIndex)
         generatePage(changedFlags & (DocumentObserver::Annotations | DocumentObserver::Highlights));
+
+    // the slide the timer advances to can be painted ahead now
+    if ((changedFlags & DocumentObserver::Pixmap) && pageNumber == m_pageToPrepare && hasFramePixmap(pageNumber))
+        schedulePagePreparation();
+
+    // the slide the timed advance was waiting for
+    if ((changedFlags & DocumentObserver::Pixmap) && pageNumber == m_advanceWhenReady && hasFramePixmap(pageNumber))
+        slotNextPage();
 }
 
 void PresentationWidget::notifyCurrentPageChanged(int previousPage, int currentPage)
 {
     if (previousPage != -1) {
+        // the layer of its drawings is made again if the page is shown again
+        m_frames[previousPage]->drawingLayer = QPixmap();
+
         // stop video playback
         for (VideoWidget *vw : qAsConst(m_frames[previousPage]->videoWidgets)) {
             vw->stop();
@@ -421,6 +467,8 @@ void PresentationWidget::notifyCurrentPageChanged(int previousPage, int currentP
         }
     }
 
+    m_advanceWhenReady = -1;
+
     if (currentPage != -1) {
         m_frameIndex = currentPage;
 
@@ -803,6 +851,17 @@ void PresentationWidget::paintEvent(QPaintEvent *pe)
         return;
     }
 
+    // the fade is composited while painting, only for the parts to update
+    const bool fading = m_transitionTimer->isActive() && m_currentTransition.type() == Okular::PageTransition::Fade && m_previousPagePixmap.size() == m_lastRenderedPixmap.size();
+    auto drawPagePixmap = [this, fading](QPainter &p, const QPoint &pos, const QRect &source) {
+        if (fading) {
+            p.drawPixmap(pos, m_previousPagePixmap, source);
+            p.setOpacity(m_currentPixmapOpacity);
+        }
+        p.drawPixmap(pos, m_lastRenderedPixmap, source);
+        p.setOpacity(1.0);
+    };
+
     // blit the pixmap to the screen
     QPainter painter(this);
     for (const QRect &r : pe->region()) {
@@ -817,7 +876,7 @@ void PresentationWidget::paintEvent(QPaintEvent *pe)
             QPainter pixPainter(&backPixmap);
 
             // first draw the background on the backbuffer
-            pixPainter.drawPixmap(QPoint(0, 0), m_lastRenderedPixmap, dR);
+            drawPagePixmap(pixPainter, QPoint(0, 0), dR);
 
             // then blend the overlay (a piece of) over the background
             QRect ovr = m_overlayGeometry.intersected(r);
@@ -831,36 +890,34 @@ void PresentationWidget::paintEvent(QPaintEvent *pe)
         } else
 #endif
             // copy the rendered pixmap to the screen
-            painter.drawPixmap(r.topLeft(), m_lastRenderedPixmap, dR);
+            drawPagePixmap(painter, r.topLeft(), dR);
     }
 
     // paint drawings
-    if (m_frameIndex != -1) {
-        painter.save();
-
-        const QRect &geom = m_frames[m_frameIndex]->geometry;
-
+    PresentationFrame *frame = m_frameIndex != -1 ? m_frames[m_frameIndex] : nullptr;
+    const bool drawing = m_drawingEngine && m_drawingRect.intersects(pe->rect());
+    if (frame && (!frame->drawings.isEmpty() || drawing)) {
+        const QRect &geom = frame->geometry;
         const QSize pmSize(geom.width() * dpr, geom.height() * dpr);
-        QPixmap pm(pmSize);
-        pm.fill(Qt::transparent);
-        QPainter pmPainter(&pm);
-
-        pm.setDevicePixelRatio(dpr);
-        pmPainter.setRenderHints(QPainter::Antialiasing);
-
-        // Paint old paths
-        for (const SmoothPath &drawing : qAsConst(m_frames[m_frameIndex]->drawings)) {
-            drawing.paint(&pmPainter, pmSize.width(), pmSize.height());
-        }
-
-        // Paint the path that is currently being drawn by the user
-        if (m_drawingEngine && m_drawingRect.intersects(pe->rect()))
+        frame->updateDrawingLayer(pmSize);
+
+        // only the piece of the layer in the dirty rect, in its device pixels
+        const QRect dirty = pe->rect().intersected(geom).translated(-geom.topLeft());
+        const QRect layerRect = QRectF(dirty.x() * dpr, dirty.y() * dpr, dirty.width() * dpr, dirty.height() * dpr).toAlignedRect().intersected(frame->drawingLayer.rect());
+        const QRectF target(QPointF(geom.topLeft()) + QPointF(layerRect.topLeft()) / dpr, QSizeF(layerRect.size()) / dpr);
+
+        if (drawing) {
+            // the path being drawn goes over a copy of the piece, as it may erase
+            QPixmap pm = frame->drawingLayer.copy(layerRect);
+            QPainter pmPainter(&pm);
+            pmPainter.setRenderHints(QPainter::Antialiasing);
+            pmPainter.translate(-layerRect.topLeft());
             m_drawingEngine->paint(&pmPainter, pmSize.width(), pmSize.height(), m_drawingRect.intersected(pe->rect()));
-
-        painter.setRenderHints(QPainter::Antialiasing);
-        painter.drawPixmap(geom.topLeft(), pm);
-
-        painter.restore();
+            pmPainter.end();
+            painter.drawPixmap(target, pm, pm.rect());
+        } else if (!layerRect.isEmpty()) {
+            painter.drawPixmap(target, frame->drawingLayer, layerRect);
+        }
     }
     painter.end();
 }
@@ -903,6 +960,9 @@ void PresentationWidget::resizeEvent(QResizeEvent *re)
         m_transitionTimer->stop();
     }
 
+    m_preparedPage = -1;
+    m_preparedPagePixmap = QPixmap();
+
     generatePage(true /* no transitions */);
     // END Content area
 }
@@ -1025,16 +1085,23 @@ void PresentationWidget::generatePage(bool disableTransition)
         m_previousPagePixmap = m_lastRenderedPixmap;
     }
 
-    // opens the painter over the pixmap
-    QPainter pixmapPainter;
-    pixmapPainter.begin(&m_lastRenderedPixmap);
-    // generate welcome page
-    if (m_frameIndex == -1)
-        generateIntroPage(pixmapPainter);
-    // generate a normal pixmap with extended margin filling
-    if (m_frameIndex >= 0 && m_frameIndex < (int)m_document->pages())
-        generateContentsPage(m_frameIndex, pixmapPainter);
-    pixmapPainter.end();
+    if (m_frameIndex != -1 && m_frameIndex == m_preparedPage && m_preparedPagePixmap.size() == m_lastRenderedPixmap.size() && m_preparedPagePixmap.devicePixelRatio() == m_lastRenderedPixmap.devicePixelRatio()) {
+        // painted while the previous slide was shown
+        m_lastRenderedPixmap = m_preparedPagePixmap;
+        m_preparedPage = -1;
+        m_preparedPagePixmap = QPixmap();
+    } else {
+        // opens the painter over the pixmap
+        QPainter pixmapPainter;
+        pixmapPainter.begin(&m_lastRenderedPixmap);
+        // generate welcome page
+        if (m_frameIndex == -1)
+            generateIntroPage(pixmapPainter);
+        // generate a normal pixmap with extended margin filling
+        if (m_frameIndex >= 0 && m_frameIndex < (int)m_document->pages())
+            generateContentsPage(m_frameIndex, pixmapPainter);
+        pixmapPainter.end();
+    }
 
     // generate the top-right corner overlay
 #ifdef ENABLE_PROGRESS_OVERLAY
@@ -1307,17 +1374,20 @@ QRect PresentationWidget::routeMouseDrawingEvent(QMouseEvent *e)
     }
 
     if (m_drawingEngine->creationCompleted()) {
-        // add drawing to current page
-        m_frames[m_frameIndex]->drawings << m_drawingEngine->endSmoothPath();
+        // add drawing to current page, and to the layer of its drawings
+        const SmoothPath drawing = m_drawingEngine->endSmoothPath();
+        m_frames[m_frameIndex]->drawings << drawing;
+        m_frames[m_frameIndex]->paintDrawing(drawing);
+
+        // schedule repaint of what the drawing covers, its pen included
+        const int penWidth = m_currentDrawingToolElement.attribute(QStringLiteral("width"), QStringLiteral("2")).toInt();
+        update((m_drawingRect | ret.translated(geom.topLeft())).adjusted(-penWidth, -penWidth, penWidth, penWidth));
 
         // remove the actual drawer and create a new one just after
         // that - that gives continuous drawing
         delete m_drawingEngine;
         m_drawingRect = QRect();
         m_drawingEngine = new SmoothPathEngine(m_currentDrawingToolElement);
-
-        // schedule repaint
-        update();
     }
 
     return ret;
@@ -1336,6 +1406,16 @@ void PresentationWidget::startAutoChangeTimer()
             secs = pageDuration;
 
         m_nextPageTimer->start((int)(secs * 1000));
+
+        // so the next slide is there, and painted, when the time comes
+        const int nextIndex = m_frameIndex + 1 < m_frames.count() ? m_frameIndex + 1 : (Okular::Settings::slidesLoop() ? 0 : -1);
+        m_pageToPrepare = m_frameIndex >= 0 && nextIndex != m_frameIndex ? nextIndex : -1;
+        if (m_pageToPrepare >= 0) {
+            if (hasFramePixmap(nextIndex))
+                schedulePagePreparation();
+            else
+                requestFramePixmap(nextIndex, PRESENTATION_PRELOAD_PRIO);
+        }
     }
     setPlayPauseIcon();
 }
@@ -1407,6 +1487,29 @@ void PresentationWidget::requestPixmaps()
     m_document->requestPixmaps(requests);
 }
 
+bool PresentationWidget::hasFramePixmap(int index) const
+{
+    const PresentationFrame *frame = m_frames[index];
+    return frame->page->hasPixmap(this, ceil(frame->geometry.width() * devicePixelRatioF()), ceil(frame->geometry.height() * devicePixelRatioF()));
+}
+
+void PresentationWidget::requestFramePixmap(int index, int priority)
+{
+    const PresentationFrame *frame = m_frames[index];
+    QLinkedList<Okular::PixmapRequest *> requests;
+    requests.push_back(new Okular::PixmapRequest(this, index, frame->geometry.width(), frame->geometry.height(), devicePixelRatioF(), priority, Okular::PixmapRequest::Asynchronous));
+    m_document->requestPixmaps(requests, Okular::Document::NoOption);
+}
+
+void PresentationWidget::schedulePagePreparation()
+{
+    // painting a slide takes a while at high resolutions, not during the transition
+    int delay = 0;
+    if (m_transitionTimer->isActive())
+        delay = qMax(0, m_transitionDuration - (int)m_transitionClock.elapsed());
+    QTimer::singleShot(delay, this, &PresentationWidget::slotPreparePage);
+}
+
 void PresentationWidget::slotNextPage()
 {
     int nextIndex = m_frameIndex + 1;
@@ -1435,6 +1538,23 @@ void PresentationWidget::slotNextPage()
     setFocus();
 }
 
+void PresentationWidget::slotAutoAdvance()
+{
+    int nextIndex = m_frameIndex + 1;
+    if (nextIndex == m_frames.count() && Okular::Settings::slidesLoop())
+        nextIndex = 0;
+
+    // advance once the next slide is rendered, so it doesn't lose part of
+    // its time on screen to the generator
+    if (m_frameIndex >= 0 && nextIndex < m_frames.count() && !hasFramePixmap(nextIndex)) {
+        m_advanceWhenReady = nextIndex;
+        requestFramePixmap(nextIndex, PRESENTATION_PRIO);
+        return;
+    }
+
+    slotNextPage();
+}
+
 void PresentationWidget::slotPrevPage()
 {
     if (m_frameIndex > 0) {
@@ -1475,19 +1595,13 @@ void PresentationWidget::slotHideOverlay()
 
 void PresentationWidget::slotTransitionStep()
 {
+    // how far the transition should be, a step that comes late catches up
+    // instead of making the whole transition last longer
+    const double progress = m_transitionDuration > 0 ? qMin(1.0, m_transitionClock.elapsed() / (double)m_transitionDuration) : 1.0;
+
     switch (m_currentTransition.type()) {
     case Okular::PageTransition::Fade: {
-        QPainter pixmapPainter;
-        m_currentPixmapOpacity += 1.0 / m_transitionSteps;
-        m_lastRenderedPixmap = QPixmap(m_lastRenderedPixmap.size());
-        m_lastRenderedPixmap.setDevicePixelRatio(devicePixelRatioF());
-        m_lastRenderedPixmap.fill(Qt::transparent);
-        pixmapPainter.begin(&m_lastRenderedPixmap);
-        pixmapPainter.setCompositionMode(QPainter::CompositionMode_Source);
-        pixmapPainter.setOpacity(1 - m_currentPixmapOpacity);
-        pixmapPainter.drawPixmap(0, 0, m_previousPagePixmap);
-        pixmapPainter.setOpacity(m_currentPixmapOpacity);
-        pixmapPainter.drawPixmap(0, 0, m_currentPagePixmap);
+        m_currentPixmapOpacity = progress;
         update();
         if (m_currentPixmapOpacity >= 1)
             return;
@@ -1500,7 +1614,8 @@ void PresentationWidget::slotTransitionStep()
             return;
         }
 
-        for (int i = 0; i < m_transitionMul && !m_transitionRects.empty(); i++) {
+        const int due = (int)ceil(progress * m_transitionRectsCount) - (m_transitionRectsCount - m_transitionRects.count());
+        for (int i = 0; (i < m_transitionMul || i < due) && !m_transitionRects.empty(); i++) {
             update(m_transitionRects.first());
             m_transitionRects.pop_front();
         }
@@ -1509,6 +1624,21 @@ void PresentationWidget::slotTransitionStep()
     m_transitionTimer->start(m_transitionDelay);
 }
 
+void PresentationWidget::slotPreparePage()
+{
+    const int index = m_pageToPrepare;
+    if (index < 0 || index >= m_frames.count() || index == m_preparedPage || index == m_frameIndex || !m_nextPageTimer->isActive() || m_lastRenderedPixmap.isNull() || !hasFramePixmap(index))
+        return;
+
+    // the target frame of the transition to the next slide
+    m_preparedPagePixmap = QPixmap(m_lastRenderedPixmap.size());
+    m_preparedPagePixmap.setDevicePixelRatio(m_lastRenderedPixmap.devicePixelRatio());
+    QPainter pixmapPainter(&m_preparedPagePixmap);
+    generateContentsPage(index, pixmapPainter);
+    pixmapPainter.end();
+    m_preparedPage = index;
+}
+
 void PresentationWidget::slotDelayedEvents()
 {
     setScreen(defaultScreen());
@@ -1565,8 +1695,10 @@ void PresentationWidget::slotAddDrawingToolActions()
 
 void PresentationWidget::clearDrawings()
 {
-    if (m_frameIndex != -1)
+    if (m_frameIndex != -1) {
         m_frames[m_frameIndex]->drawings.clear();
+        m_frames[m_frameIndex]->drawingLayer = QPixmap();
+    }
     update();
 }
 
@@ -2127,20 +2259,10 @@ void PresentationWidget::initTransition(const Okular::PageTransition *transition
 
     case Okular::PageTransition::Fade: {
         enum { FADE_TRANSITION_FPS = 20 };
-        const int steps = totalTime * FADE_TRANSITION_FPS;
-        m_transitionSteps = steps;
-        QPainter pixmapPainter;
-        m_currentPixmapOpacity = (double)1 / steps;
+        const int steps = qMax(1, (int)(totalTime * FADE_TRANSITION_FPS));
+        // paintEvent() blends the previous page with this one
+        m_currentPixmapOpacity = 0;
         m_transitionDelay = (int)(totalTime * 1000) / steps;
-        m_lastRenderedPixmap = QPixmap(m_lastRenderedPixmap.size());
-        m_lastRenderedPixmap.fill(Qt::transparent);
-        pixmapPainter.begin(&m_lastRenderedPixmap);
-        pixmapPainter.setCompositionMode(QPainter::CompositionMode_Source);
-        pixmapPainter.setOpacity(1 - m_currentPixmapOpacity);
-        pixmapPainter.drawPixmap(0, 0, m_previousPagePixmap);
-        pixmapPainter.setOpacity(m_currentPixmapOpacity);
-        pixmapPainter.drawPixmap(0, 0, m_currentPagePixmap);
-        pixmapPainter.end();
         update();
     } break;
     // implement missing transitions (a binary raster engine needed here)
@@ -2158,6 +2280,9 @@ void PresentationWidget::initTransition(const Okular::PageTransition *transition
     }
 
     // send the first start to the timer
+    m_transitionDuration = (int)(totalTime * 1000);
+    m_transitionRectsCount = m_transitionRects.count();
+    m_transitionClock.start();
     m_transitionTimer->start(0);
 }
 
@@ -2236,6 +2361,7 @@ void PresentationWidget::slotTogglePlayPause()
     } else {
         m_nextPageTimer->stop();
         m_advanceSlides = false;
+        m_advanceWhenReady = -1;
         setPlayPauseIcon();
     }
 }
@@ -11,6 +11,7 @@
 #include "core/observer.h"
 #include "core/pagetransition.h"
 #include <QDomElement>
+#include <QElapsedTimer>
 #include <QList>
 #include <QPixmap>
 #include <QStringList>
@@ -100,6 +101,11 @@ private:
     /** @returns Configure -> Presentation -> Preferred screen */
     QScreen *defaultScreen() const;
     void requestPixmaps();
+    // whether the pixmap of the frame at index is there at its size
+    bool hasFramePixmap(int index) const;
+    void requestFramePixmap(int index, int priority);
+    // paints the frame the timed advance goes to once the current transition is over
+    void schedulePagePreparation();
     /** @param newScreen must be valid. */
     void setScreen(const QScreen *newScreen);
     void inhibitPowerManagement();
@@ -128,12 +134,20 @@ private:
     QTimer *m_nextPageTimer;
     int m_transitionDelay;
     int m_transitionMul;
-    int m_transitionSteps;
+    // the steps follow this clock, over m_transitionDuration milliseconds
+    QElapsedTimer m_transitionClock;
+    int m_transitionDuration;
+    int m_transitionRectsCount;
     QList<QRect> m_transitionRects;
     Okular::PageTransition m_currentTransition;
     QPixmap m_currentPagePixmap;
     QPixmap m_previousPagePixmap;
     double m_currentPixmapOpacity;
+    // the frame painted ahead for the timed advance, and its index (-1 if none)
+    QPixmap m_preparedPagePixmap;
+    int m_preparedPage;
+    // the frame to paint ahead when its pixmap comes, -1 if none
+    int m_pageToPrepare;
 
     // misc stuff
     QWidget *m_parentWidget;
@@ -152,6 +166,8 @@ private:
     bool m_inBlackScreenMode;
     bool m_showSummaryView;
     bool m_advanceSlides;
+    // the frame the timed advance waits the pixmap of, -1 if none
+    int m_advanceWhenReady;
     bool m_goToPreviousPageOnRelease;
     bool m_goToNextPageOnRelease;
 
@@ -171,11 +187,13 @@ private:
 
 private Q_SLOTS:
     void slotNextPage();
+    void slotAutoAdvance();
     void slotPrevPage();
     void slotFirstPage();
     void slotLastPage();
     void slotHideOverlay();
     void slotTransitionStep();
+    void slotPreparePage();
     void slotDelayedEvents();
     void slotPageChanged();
     void clearDrawings();
@@ -129,6 +129,11 @@ bool SearchLineEdit::isSearchRunning() const
 
 void SearchLineEdit::restartSearch()
 {
+    // what it is looking for is not wanted anymore, don't wait for the next
+    // search to stop it
+    if (m_id != -1 && m_searchRunning)
+        m_document->cancelSearch(m_id);
+
     m_inputDelayTimer->stop();
     m_inputDelayTimer->start(700);
     m_changed = true;
@@ -140,8 +145,7 @@ void SearchLineEdit::stopSearch()
         return;
 
     m_inputDelayTimer->stop();
-    // ### this should just cancel the search with id m_id, not all of them
-    m_document->cancelSearch();
+    m_document->cancelSearch(m_id);
     // flagging as "changed" so the search will be reset at the next one
     m_changed = true;
 }
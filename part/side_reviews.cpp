@@ -7,6 +7,7 @@
 #include "side_reviews.h"
 
 // qt/kde includes
+#include <QAbstractProxyModel>
 #include <QHeaderView>
 #include <QLayout>
 #include <QPaintEvent>
@@ -28,12 +29,44 @@
 #include "annotationmodel.h"
 #include "annotationpopup.h"
 #include "annotationproxymodels.h"
+#include "annotationsearchindex.h"
 #include "core/annotations.h"
 #include "core/document.h"
 #include "core/page.h"
 #include "ktreeviewsearchline.h"
 #include "settings.h"
 
+// matches the annotations with the index of their text
+class ReviewsSearchLine : public KTreeViewSearchLine
+{
+    Q_OBJECT
+
+public:
+    ReviewsSearchLine(QWidget *parent, QTreeView *treeView, AnnotationModel *model, AnnotationSearchIndex *index)
+        : KTreeViewSearchLine(parent, treeView)
+        , m_model(model)
+        , m_index(index)
+    {
+    }
+
+protected:
+    bool itemMatches(const QModelIndex &parentIndex, int row, const QString &pattern) const override
+    {
+        QModelIndex index = treeView()->model()->index(row, 0, parentIndex);
+        while (const QAbstractProxyModel *proxy = qobject_cast<const QAbstractProxyModel *>(index.model()))
+            index = proxy->mapToSource(index);
+
+        // the page and author branches match by their name
+        if (index.model() != m_model || !m_model->isAnnotation(index))
+            return KTreeViewSearchLine::itemMatches(parentIndex, row, pattern);
+        return m_index->matches(index, pattern, caseSensitivity(), regularExpression());
+    }
+
+private:
+    AnnotationModel *m_model;
+    AnnotationSearchIndex *m_index;
+};
+
 class TreeView : public QTreeView
 {
     Q_OBJECT
@@ -108,6 +141,8 @@ Reviews::Reviews(QWidget *parent, Okular::Document *document)
     toolBar->setSizePolicy(sp);
 
     m_model = new AnnotationModel(m_document, m_view);
+    // before the proxies, so it is up to date when they tell the search line
+    m_searchIndex = new AnnotationSearchIndex(m_model, m_view);
 
     m_filterProxy = new PageFilterProxyModel(m_view);
     m_groupProxy = new PageGroupProxyModel(m_view);
@@ -119,7 +154,7 @@ Reviews::Reviews(QWidget *parent, Okular::Document *document)
 
     m_view->setModel(m_authorProxy);
 
-    m_searchLine = new KTreeViewSearchLine(this, m_view);
+    m_searchLine = new ReviewsSearchLine(this, m_view, m_model, m_searchIndex);
     m_searchLine->setPlaceholderText(i18n("Search..."));
     m_searchLine->setCaseSensitivity(Okular::Settings::self()->reviewsSearchCaseSensitive() ? Qt::CaseSensitive : Qt::CaseInsensitive);
     m_searchLine->setRegularExpression(Okular::Settings::self()->reviewsSearchRegularExpression());
@@ -22,6 +22,7 @@ class Document;
 }
 
 class AnnotationModel;
+class AnnotationSearchIndex;
 class AuthorGroupProxyModel;
 class PageFilterProxyModel;
 class PageGroupProxyModel;
@@ -67,6 +68,7 @@ private:
     // internal storage
     Okular::Document *m_document;
     AnnotationModel *m_model;
+    AnnotationSearchIndex *m_searchIndex;
     AuthorGroupProxyModel *m_authorProxy;
     PageFilterProxyModel *m_filterProxy;
     PageGroupProxyModel *m_groupProxy;
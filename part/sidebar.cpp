@@ -187,3 +187,26 @@ void Sidebar::dropEvent(QDropEvent *event)
     const QList<QUrl> list = KUrlMimeData::urlsFromMimeData(event->mimeData());
     emit urlsDropped(list);
 }
+
+DeferredSidebarItem::DeferredSidebarItem(const std::function<QWidget *()> &createWidget, QWidget *parent)
+    : QWidget(parent)
+    , m_createWidget(createWidget)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+}
+
+QWidget *DeferredSidebarItem::widget() const
+{
+    return m_widget;
+}
+
+void DeferredSidebarItem::showEvent(QShowEvent *event)
+{
+    if (m_createWidget) {
+        m_widget = m_createWidget();
+        m_createWidget = nullptr;
+        layout()->addWidget(m_widget);
+    }
+    QWidget::showEvent(event);
+}
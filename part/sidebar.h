@@ -8,8 +8,11 @@
 #define _SIDEBAR_H_
 
 #include "okularpart_export.h"
+#include <qpointer.h>
 #include <qwidget.h>
 
+#include <functional>
+
 class QIcon;
 class QListWidgetItem;
 
@@ -51,4 +54,27 @@ private:
     Private *d;
 };
 
+/**
+ * A sidebar item whose widget is only created when it is shown the first
+ * time, so the panels nobody opens cost nothing at startup.
+ */
+class OKULARPART_EXPORT DeferredSidebarItem : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit DeferredSidebarItem(const std::function<QWidget *()> &createWidget, QWidget *parent = nullptr);
+
+    /**
+     * The widget of the item, nullptr until it was shown.
+     */
+    QWidget *widget() const;
+
+protected:
+    void showEvent(QShowEvent *event) override;
+
+private:
+    std::function<QWidget *()> m_createWidget;
+    QPointer<QWidget> m_widget;
+};
+
 #endif
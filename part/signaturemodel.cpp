@@ -67,6 +67,7 @@ public:
     ~SignatureModelPrivate() override;
 
     void notifySetup(const QVector<Okular::Page *> &pages, int setupFlags) override;
+    void notifyPageChanged(int page, int flags) override;
 
     QModelIndex indexForItem(SignatureItem *item) const;
 
@@ -151,6 +152,30 @@ void SignatureModelPrivate::notifySetup(const QVector<Okular::Page *> &pages, in
     q->endResetModel();
 }
 
+void SignatureModelPrivate::notifyPageChanged(int page, int flags)
+{
+    // the certificates of the signatures of the page were verified after the form fields were made
+    if (!(flags & Okular::DocumentObserver::SignatureInfo))
+        return;
+
+    for (SignatureItem *parentItem : qAsConst(root->children)) {
+        if (parentItem->page != page)
+            continue;
+
+        for (SignatureItem *child : qAsConst(parentItem->children)) {
+            if (child->type != SignatureItem::ValidityStatus)
+                continue;
+
+            child->displayString = SignatureGuiUtils::getReadableSignatureStatus(parentItem->form->signatureInfo().signatureStatus());
+            const QModelIndex index = indexForItem(child);
+            emit q->dataChanged(index, index);
+        }
+        // the icon
+        const QModelIndex index = indexForItem(parentItem);
+        emit q->dataChanged(index, index);
+    }
+}
+
 QModelIndex SignatureModelPrivate::indexForItem(SignatureItem *item) const
 {
     if (item->parent) {
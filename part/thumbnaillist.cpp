@@ -35,7 +35,9 @@
 #include "priorities.h"
 #include "settings.h"
 
-class ThumbnailWidget;
+#include <algorithm>
+
+class ThumbnailListPrivate;
 
 ThumbnailsBox::ThumbnailsBox(QWidget *parent)
     : QWidget(parent)
@@ -55,61 +57,11 @@ QSize ThumbnailsBox::sizeHint() const
     return QSize();
 }
 
-class ThumbnailListPrivate : public QWidget
-{
-    Q_OBJECT
-public:
-    ThumbnailListPrivate(ThumbnailList *qq, Okular::Document *document);
-    ~ThumbnailListPrivate() override;
-
-    enum ChangePageDirection { Null, Left, Right, Up, Down };
-
-    ThumbnailList *q;
-    Okular::Document *m_document;
-    ThumbnailWidget *m_selected;
-    QTimer *m_delayTimer;
-    QPixmap *m_bookmarkOverlay;
-    QVector<ThumbnailWidget *> m_thumbnails;
-    QList<ThumbnailWidget *> m_visibleThumbnails;
-    int m_vectorIndex;
-    // Grabbing variables
-    QPoint m_mouseGrabPos;
-    ThumbnailWidget *m_mouseGrabItem;
-    int m_pageCurrentlyGrabbed;
-
-    // resize thumbnails to fit the width
-    void viewportResizeEvent(QResizeEvent *);
-    // called by ThumbnailWidgets to get the overlay bookmark pixmap
-    const QPixmap *getBookmarkOverlay() const;
-    // called by ThumbnailWidgets to send (forward) the mouse move signals
-    ChangePageDirection forwardTrack(const QPoint, const QSize);
-
-    ThumbnailWidget *itemFor(const QPoint p) const;
-    void delayedRequestVisiblePixmaps(int delayMs = 0);
-
-    // SLOTS:
-    // make requests for generating pixmaps for visible thumbnails
-    void slotRequestVisiblePixmaps();
-    // delay timeout: resize overlays and requests pixmaps
-    void slotDelayTimeout();
-    ThumbnailWidget *getPageByNumber(int page) const;
-    int getNewPageOffset(int n, ThumbnailListPrivate::ChangePageDirection dir) const;
-    ThumbnailWidget *getThumbnailbyOffset(int current, int offset) const;
-
-protected:
-    void mousePressEvent(QMouseEvent *e) override;
-    void mouseReleaseEvent(QMouseEvent *e) override;
-    void mouseMoveEvent(QMouseEvent *e) override;
-    void wheelEvent(QWheelEvent *e) override;
-    void contextMenuEvent(QContextMenuEvent *e) override;
-    void paintEvent(QPaintEvent *e) override;
-};
-
 // ThumbnailWidget represents a single thumbnail in the ThumbnailList
 class ThumbnailWidget
 {
 public:
-    ThumbnailWidget(ThumbnailListPrivate *parent, const Okular::Page *page);
+    ThumbnailWidget(ThumbnailListPrivate *parent, const Okular::Page *page, int labelHeight);
 
     // set internal parameters to fit the page in the given width
     void resizeFitWidth(int width);
@@ -172,14 +124,8 @@ public:
     {
         m_rect.setTopLeft(QPoint(x, y));
     }
-    void update()
-    {
-        m_parent->update(m_rect);
-    }
-    void update(const QRect rect)
-    {
-        m_parent->update(rect.translated(m_rect.topLeft()));
-    }
+    void update();
+    void update(const QRect rect);
 
 private:
     // the margin around the widget
@@ -194,6 +140,65 @@ private:
     QRect m_rect;
 };
 
+class ThumbnailListPrivate : public QWidget
+{
+    Q_OBJECT
+public:
+    ThumbnailListPrivate(ThumbnailList *qq, Okular::Document *document);
+    ~ThumbnailListPrivate() override;
+
+    enum ChangePageDirection { Null, Left, Right, Up, Down };
+
+    ThumbnailList *q;
+    Okular::Document *m_document;
+    ThumbnailWidget *m_selected;
+    QTimer *m_delayTimer;
+    QPixmap *m_bookmarkOverlay;
+    QVector<Okular::Page *> m_pages;
+    // by value, laid out from the top in the order of the pages: one
+    // allocation for all of them, found by binary search
+    QVector<ThumbnailWidget> m_thumbnails;
+    QList<ThumbnailWidget *> m_visibleThumbnails;
+    // the ones with a visible rect set, to clear it
+    QVector<ThumbnailWidget *> m_visibleRectThumbnails;
+    int m_vectorIndex;
+    // Grabbing variables
+    QPoint m_mouseGrabPos;
+    ThumbnailWidget *m_mouseGrabItem;
+    int m_pageCurrentlyGrabbed;
+
+    // resize thumbnails to fit the width
+    void viewportResizeEvent(QResizeEvent *);
+    // called by ThumbnailWidgets to get the overlay bookmark pixmap
+    const QPixmap *getBookmarkOverlay() const;
+    // called by ThumbnailWidgets to send (forward) the mouse move signals
+    ChangePageDirection forwardTrack(const QPoint, const QSize);
+
+    ThumbnailWidget *itemFor(const QPoint p);
+    // the index of the first thumbnail not above y
+    int indexAt(int y) const;
+    // the index of the thumbnail of page, or -1
+    int indexOfPage(int page) const;
+    void delayedRequestVisiblePixmaps(int delayMs = 0);
+
+    // SLOTS:
+    // make requests for generating pixmaps for visible thumbnails
+    void slotRequestVisiblePixmaps();
+    // delay timeout: resize overlays and requests pixmaps
+    void slotDelayTimeout();
+    ThumbnailWidget *getPageByNumber(int page);
+    int getNewPageOffset(int n, ThumbnailListPrivate::ChangePageDirection dir) const;
+    const ThumbnailWidget *getThumbnailbyOffset(int current, int offset) const;
+
+protected:
+    void mousePressEvent(QMouseEvent *e) override;
+    void mouseReleaseEvent(QMouseEvent *e) override;
+    void mouseMoveEvent(QMouseEvent *e) override;
+    void wheelEvent(QWheelEvent *e) override;
+    void contextMenuEvent(QContextMenuEvent *e) override;
+    void paintEvent(QPaintEvent *e) override;
+};
+
 ThumbnailListPrivate::ThumbnailListPrivate(ThumbnailList *qq, Okular::Document *document)
     : QWidget()
     , q(qq)
@@ -207,41 +212,48 @@ ThumbnailListPrivate::ThumbnailListPrivate(ThumbnailList *qq, Okular::Document *
     m_mouseGrabItem = nullptr;
 }
 
-ThumbnailWidget *ThumbnailListPrivate::getPageByNumber(int page) const
+ThumbnailWidget *ThumbnailListPrivate::getPageByNumber(int page)
 {
-    QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-    for (; tIt != tEnd; ++tIt) {
-        if ((*tIt)->pageNumber() == page)
-            return (*tIt);
-    }
-    return nullptr;
+    const int index = indexOfPage(page);
+    return index != -1 ? &m_thumbnails[index] : nullptr;
+}
+
+int ThumbnailListPrivate::indexAt(int y) const
+{
+    const auto it = std::lower_bound(m_thumbnails.constBegin(), m_thumbnails.constEnd(), y, [](const ThumbnailWidget &t, int y) { return t.rect().bottom() < y; });
+    return it - m_thumbnails.constBegin();
+}
+
+int ThumbnailListPrivate::indexOfPage(int page) const
+{
+    const auto it = std::lower_bound(m_thumbnails.constBegin(), m_thumbnails.constEnd(), page, [](const ThumbnailWidget &t, int page) { return t.pageNumber() < page; });
+    return it != m_thumbnails.constEnd() && it->pageNumber() == page ? it - m_thumbnails.constBegin() : -1;
 }
 
 ThumbnailListPrivate::~ThumbnailListPrivate()
 {
 }
 
-ThumbnailWidget *ThumbnailListPrivate::itemFor(const QPoint p) const
+ThumbnailWidget *ThumbnailListPrivate::itemFor(const QPoint p)
 {
-    QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-    for (; tIt != tEnd; ++tIt) {
-        if ((*tIt)->rect().contains(p))
-            return (*tIt);
-    }
+    const int index = indexAt(p.y());
+    if (index < m_thumbnails.count() && m_thumbnails.at(index).rect().contains(p))
+        return &m_thumbnails[index];
     return nullptr;
 }
 
 void ThumbnailListPrivate::paintEvent(QPaintEvent *e)
 {
     QPainter painter(this);
-    QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-    for (; tIt != tEnd; ++tIt) {
-        QRect rect = e->rect().intersected((*tIt)->rect());
+    // only the thumbnails in the rect
+    for (int i = indexAt(e->rect().top()); i < m_thumbnails.count() && m_thumbnails.at(i).pos().y() <= e->rect().bottom(); ++i) {
+        ThumbnailWidget &t = m_thumbnails[i];
+        QRect rect = e->rect().intersected(t.rect());
         if (!rect.isNull()) {
-            rect.translate(-(*tIt)->pos());
+            rect.translate(-t.pos());
             painter.save();
-            painter.translate((*tIt)->pos());
-            (*tIt)->paint(painter, rect);
+            painter.translate(t.pos());
+            t.paint(painter, rect);
             painter.restore();
         }
     }
@@ -270,6 +282,11 @@ ThumbnailList::ThumbnailList(QWidget *parent, Okular::Document *document)
     widget()->setBackgroundRole(QPalette::Base);
 
     connect(verticalScrollBar(), &QScrollBar::valueChanged, d, &ThumbnailListPrivate::slotRequestVisiblePixmaps);
+    // only the pages with matches of the search widget are shown, see notifySetup()
+    connect(document, &Okular::Document::searchFinished, this, [this](int searchID) {
+        if (searchID == SW_SEARCH_ID)
+            notifySetup(d->m_pages, 0);
+    });
 }
 
 ThumbnailList::~ThumbnailList()
@@ -290,13 +307,12 @@ void ThumbnailList::notifySetup(const QVector<Okular::Page *> &pages, int setupF
         prevPage = d->m_document->viewport().pageNumber;
 
     // delete all the Thumbnails
-    QVector<ThumbnailWidget *>::const_iterator tIt = d->m_thumbnails.constBegin(), tEnd = d->m_thumbnails.constEnd();
-    for (; tIt != tEnd; ++tIt)
-        delete *tIt;
     d->m_thumbnails.clear();
     d->m_visibleThumbnails.clear();
+    d->m_visibleRectThumbnails.clear();
     d->m_selected = nullptr;
     d->m_mouseGrabItem = nullptr;
+    d->m_pages = pages;
 
     if (pages.count() < 1) {
         widget()->resize(0, 0);
@@ -316,31 +332,39 @@ void ThumbnailList::notifySetup(const QVector<Okular::Page *> &pages, int setupF
 
     // generate Thumbnails for the given set of pages
     const int width = viewport()->width();
+    const int spacing = this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
+    const int labelHeight = QFontMetrics(d->font()).height();
     int height = 0;
     int centerHeight = 0;
+    int selected = -1;
+    d->m_thumbnails.reserve(skipCheck ? pages.count() : 0);
     for (pIt = pages.constBegin(); pIt != pEnd; ++pIt)
         // if ( skipCheck || (*pIt)->attributes() & flags )
         if (skipCheck || (*pIt)->hasHighlights(SW_SEARCH_ID)) {
-            ThumbnailWidget *t = new ThumbnailWidget(d, *pIt);
-            t->move(0, height);
-            // add to the internal queue
-            d->m_thumbnails.push_back(t);
+            ThumbnailWidget t(d, *pIt, labelHeight);
+            t.move(0, height);
             // update total height (asking widget its own height)
-            t->resizeFitWidth(width);
+            t.resizeFitWidth(width);
             // restoring the previous selected page, if any
             if ((*pIt)->number() < prevPage) {
-                centerHeight = height + t->height() + this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical) / 2;
+                centerHeight = height + t.height() + spacing / 2;
             }
             if ((*pIt)->number() == prevPage) {
-                d->m_selected = t;
-                d->m_selected->setSelected(true);
-                centerHeight = height + t->height() / 2;
+                selected = d->m_thumbnails.count();
+                centerHeight = height + t.height() / 2;
             }
-            height += t->height() + this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
+            height += t.height() + spacing;
+            // add to the internal queue
+            d->m_thumbnails.append(t);
         }
+    // the vector does not grow anymore, so the pointers stay valid
+    if (selected != -1) {
+        d->m_selected = &d->m_thumbnails[selected];
+        d->m_selected->setSelected(true);
+    }
 
     // update scrollview's contents size (sets scrollbars limits)
-    height -= this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
+    height -= spacing;
     widget()->resize(width, height);
 
     // enable scrollbar when there's something to scroll
@@ -365,19 +389,17 @@ void ThumbnailList::notifyCurrentPageChanged(int previousPage, int currentPage)
     d->m_selected = nullptr;
 
     // select the page with viewport and ensure it's centered in the view
-    d->m_vectorIndex = 0;
-    QVector<ThumbnailWidget *>::const_iterator tIt = d->m_thumbnails.constBegin(), tEnd = d->m_thumbnails.constEnd();
-    for (; tIt != tEnd; ++tIt) {
-        if ((*tIt)->pageNumber() == currentPage) {
-            d->m_selected = *tIt;
-            d->m_selected->setSelected(true);
-            if (Okular::Settings::syncThumbnailsViewport()) {
-                int yOffset = qMax(viewport()->height() / 4, d->m_selected->height() / 2);
-                ensureVisible(0, d->m_selected->pos().y() + d->m_selected->height() / 2, 0, yOffset);
-            }
-            break;
-        }
-        d->m_vectorIndex++;
+    const int index = d->indexOfPage(currentPage);
+    if (index == -1) {
+        d->m_vectorIndex = d->m_thumbnails.count();
+        return;
+    }
+    d->m_vectorIndex = index;
+    d->m_selected = &d->m_thumbnails[index];
+    d->m_selected->setSelected(true);
+    if (Okular::Settings::syncThumbnailsViewport()) {
+        int yOffset = qMax(viewport()->height() / 4, d->m_selected->height() / 2);
+        ensureVisible(0, d->m_selected->pos().y() + d->m_selected->height() / 2, 0, yOffset);
     }
 }
 
@@ -397,6 +419,19 @@ void ThumbnailList::notifyPageChanged(int pageNumber, int changedFlags)
         }
 }
 
+void ThumbnailList::notifyPagesChanged(const QVector<int> &pages, int changedFlags)
+{
+    static const int interestingFlags = DocumentObserver::Pixmap | DocumentObserver::Bookmark | DocumentObserver::Highlights | DocumentObserver::Annotations;
+    if (!(changedFlags & interestingFlags))
+        return;
+
+    // one pass over the visible items, the pages are in order
+    for (ThumbnailWidget *thumbnail : qAsConst(d->m_visibleThumbnails)) {
+        if (std::binary_search(pages.constBegin(), pages.constEnd(), thumbnail->pageNumber()))
+            thumbnail->update();
+    }
+}
+
 void ThumbnailList::notifyContentsCleared(int changedFlags)
 {
     // if pixmaps were cleared, re-ask them
@@ -406,23 +441,21 @@ void ThumbnailList::notifyContentsCleared(int changedFlags)
 
 void ThumbnailList::notifyVisibleRectsChanged()
 {
-    bool found = false;
     const QVector<Okular::VisiblePageRect *> &visibleRects = d->m_document->visiblePageRects();
-    QVector<ThumbnailWidget *>::const_iterator tIt = d->m_thumbnails.constBegin(), tEnd = d->m_thumbnails.constEnd();
-    QVector<Okular::VisiblePageRect *>::const_iterator vEnd = visibleRects.end();
-    for (; tIt != tEnd; ++tIt) {
-        found = false;
-        QVector<Okular::VisiblePageRect *>::const_iterator vIt = visibleRects.begin();
-        for (; (vIt != vEnd) && !found; ++vIt) {
-            if ((*tIt)->pageNumber() == (*vIt)->pageNumber) {
-                (*tIt)->setVisibleRect((*vIt)->rect);
-                found = true;
-            }
-        }
-        if (!found) {
-            (*tIt)->setVisibleRect(Okular::NormalizedRect());
+    QVector<ThumbnailWidget *> visibleRectThumbnails;
+    for (const Okular::VisiblePageRect *vr : visibleRects) {
+        ThumbnailWidget *t = d->getPageByNumber(vr->pageNumber);
+        if (t && !visibleRectThumbnails.contains(t)) {
+            t->setVisibleRect(vr->rect);
+            visibleRectThumbnails.append(t);
         }
     }
+    // the ones no longer visible
+    for (ThumbnailWidget *t : qAsConst(d->m_visibleRectThumbnails)) {
+        if (!visibleRectThumbnails.contains(t))
+            t->setVisibleRect(Okular::NormalizedRect());
+    }
+    d->m_visibleRectThumbnails = visibleRectThumbnails;
 }
 
 bool ThumbnailList::canUnloadPixmap(int pageNumber) const
@@ -472,23 +505,15 @@ int ThumbnailListPrivate::getNewPageOffset(int n, ThumbnailListPrivate::ChangePa
     return 0;
 }
 
-ThumbnailWidget *ThumbnailListPrivate::getThumbnailbyOffset(int current, int offset) const
+const ThumbnailWidget *ThumbnailListPrivate::getThumbnailbyOffset(int current, int offset) const
 {
-    QVector<ThumbnailWidget *>::const_iterator it = m_thumbnails.begin();
-    QVector<ThumbnailWidget *>::const_iterator itE = m_thumbnails.end();
-    int idx = 0;
-    while (it != itE) {
-        if ((*it)->pageNumber() == current)
-            break;
-        ++idx;
-        ++it;
-    }
-    if (it == itE)
+    int idx = indexOfPage(current);
+    if (idx == -1)
         return nullptr;
     idx += offset;
     if (idx < 0 || idx >= m_thumbnails.size())
         return nullptr;
-    return m_thumbnails[idx];
+    return &m_thumbnails.at(idx);
 }
 
 ThumbnailListPrivate::ChangePageDirection ThumbnailListPrivate::forwardTrack(const QPoint point, const QSize r)
@@ -539,20 +564,20 @@ void ThumbnailList::keyPressEvent(QKeyEvent *keyEvent)
         if (!d->m_selected)
             nextPage = 0;
         else if (d->m_vectorIndex > 0)
-            nextPage = d->m_thumbnails[d->m_vectorIndex - 1]->pageNumber();
+            nextPage = d->m_thumbnails.at(d->m_vectorIndex - 1).pageNumber();
     } else if (keyEvent->key() == Qt::Key_Down) {
         if (!d->m_selected)
             nextPage = 0;
         else if (d->m_vectorIndex < (int)d->m_thumbnails.count() - 1)
-            nextPage = d->m_thumbnails[d->m_vectorIndex + 1]->pageNumber();
+            nextPage = d->m_thumbnails.at(d->m_vectorIndex + 1).pageNumber();
     } else if (keyEvent->key() == Qt::Key_PageUp)
         verticalScrollBar()->triggerAction(QScrollBar::SliderPageStepSub);
     else if (keyEvent->key() == Qt::Key_PageDown)
         verticalScrollBar()->triggerAction(QScrollBar::SliderPageStepAdd);
     else if (keyEvent->key() == Qt::Key_Home)
-        nextPage = d->m_thumbnails[0]->pageNumber();
+        nextPage = d->m_thumbnails.first().pageNumber();
     else if (keyEvent->key() == Qt::Key_End)
-        nextPage = d->m_thumbnails[d->m_thumbnails.count() - 1]->pageNumber();
+        nextPage = d->m_thumbnails.last().pageNumber();
 
     if (nextPage == -1) {
         keyEvent->ignore();
@@ -591,17 +616,16 @@ void ThumbnailListPrivate::viewportResizeEvent(QResizeEvent *e)
 
         // resize and reposition items
         const int newWidth = q->viewport()->width();
+        const int spacing = this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
         int newHeight = 0;
-        QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
-        for (; tIt != tEnd; ++tIt) {
-            ThumbnailWidget *t = *tIt;
-            t->move(0, newHeight);
-            t->resizeFitWidth(newWidth);
-            newHeight += t->height() + this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
+        for (ThumbnailWidget &t : m_thumbnails) {
+            t.move(0, newHeight);
+            t.resizeFitWidth(newWidth);
+            newHeight += t.height() + spacing;
         }
 
         // update scrollview's contents size (sets scrollbars limits)
-        newHeight -= this->style()->layoutSpacing(QSizePolicy::Frame, QSizePolicy::Frame, Qt::Vertical);
+        newHeight -= spacing;
         const int oldHeight = q->widget()->height();
         const int oldYCenter = q->verticalScrollBar()->value() + q->viewport()->height() / 2;
         q->widget()->resize(newWidth, newHeight);
@@ -635,10 +659,9 @@ void ThumbnailListPrivate::slotRequestVisiblePixmaps()
     // scroll from the top to the last visible thumbnail
     m_visibleThumbnails.clear();
     QLinkedList<Okular::PixmapRequest *> requestedPixmaps;
-    QVector<ThumbnailWidget *>::const_iterator tIt = m_thumbnails.constBegin(), tEnd = m_thumbnails.constEnd();
     const QRect viewportRect = q->viewport()->rect().translated(q->horizontalScrollBar()->value(), q->verticalScrollBar()->value());
-    for (; tIt != tEnd; ++tIt) {
-        ThumbnailWidget *t = *tIt;
+    for (int i = indexAt(viewportRect.top()); i < m_thumbnails.count() && m_thumbnails.at(i).pos().y() <= viewportRect.bottom(); ++i) {
+        ThumbnailWidget *t = &m_thumbnails[i];
         const QRect thumbRect = t->rect();
         if (!thumbRect.intersects(viewportRect))
             continue;
@@ -646,7 +669,8 @@ void ThumbnailListPrivate::slotRequestVisiblePixmaps()
         m_visibleThumbnails.push_back(t);
         // if pixmap not present add it to requests
         if (!t->page()->hasPixmap(q, t->pixmapWidth(), t->pixmapHeight())) {
-            Okular::PixmapRequest *p = new Okular::PixmapRequest(q, t->pageNumber(), t->pixmapWidth(), t->pixmapHeight(), devicePixelRatioF(), THUMBNAILS_PRIO, Okular::PixmapRequest::Asynchronous);
+            // the thumbnails the document has, when big enough, save rendering the page
+            Okular::PixmapRequest *p = new Okular::PixmapRequest(q, t->pageNumber(), t->pixmapWidth(), t->pixmapHeight(), devicePixelRatioF(), THUMBNAILS_PRIO, Okular::PixmapRequest::Asynchronous | Okular::PixmapRequest::EmbeddedThumbnail | Okular::PixmapRequest::Thumbnail);
             requestedPixmaps.push_back(p);
         }
     }
@@ -683,15 +707,25 @@ void ThumbnailListPrivate::delayedRequestVisiblePixmaps(int delayMs)
 
 /** ThumbnailWidget implementation **/
 
-ThumbnailWidget::ThumbnailWidget(ThumbnailListPrivate *parent, const Okular::Page *page)
+ThumbnailWidget::ThumbnailWidget(ThumbnailListPrivate *parent, const Okular::Page *page, int labelHeight)
     : m_parent(parent)
     , m_page(page)
     , m_selected(false)
     , m_pixmapWidth(10)
     , m_pixmapHeight(10)
+    , m_labelHeight(labelHeight)
 {
     m_labelNumber = m_page->number() + 1;
-    m_labelHeight = QFontMetrics(m_parent->font()).height();
+}
+
+void ThumbnailWidget::update()
+{
+    m_parent->update(m_rect);
+}
+
+void ThumbnailWidget::update(const QRect rect)
+{
+    m_parent->update(rect.translated(m_rect.topLeft()));
 }
 
 void ThumbnailWidget::resizeFitWidth(int width)
@@ -37,6 +37,8 @@ public:
     void notifyCurrentPageChanged(int previous, int current) override;
     // inherited: redraw thumbnail ( inherited as DocumentObserver )
     void notifyPageChanged(int pageNumber, int changedFlags) override;
+    // inherited: redraw the thumbnails of several pages at once
+    void notifyPagesChanged(const QVector<int> &pages, int changedFlags) override;
     // inherited: request all visible pixmap (due to a global change or so..)
     void notifyContentsCleared(int changedFlags) override;
     // inherited: the visible areas of the page have changed
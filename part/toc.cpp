@@ -48,6 +48,11 @@ TOC::TOC(QWidget *parent, Okular::Document *document)
     m_treeView = new QTreeView(this);
     mainlay->addWidget(m_treeView);
     m_model = new TOCModel(document, m_treeView);
+    // the items are made as they are expanded, a search looks at all of them
+    connect(m_searchLine, &QLineEdit::textChanged, this, [this](const QString &text) {
+        if (!text.isEmpty())
+            m_model->fetchAll();
+    });
     m_treeView->setModel(m_model);
     m_treeView->setSortingEnabled(false);
     m_treeView->setRootIsDecorated(true);
@@ -67,15 +72,24 @@ TOC::~TOC()
 
 void TOC::notifySetup(const QVector<Okular::Page *> & /*pages*/, int setupFlags)
 {
-    if (!(setupFlags & Okular::DocumentObserver::DocumentChanged))
+    if (!(setupFlags & Okular::DocumentObserver::DocumentChanged)) {
+        // generators that give the pages bit by bit may only have the table of contents at the end
+        if ((setupFlags & Okular::DocumentObserver::NewLayoutForPages) && m_model->isEmpty()) {
+            const Okular::Outline *outline = m_document->outline();
+            if (outline) {
+                m_model->fill(outline);
+                emit hasTOC(!m_model->isEmpty());
+            }
+        }
         return;
+    }
 
     // clear contents
     m_model->clear();
 
-    // request synopsis description (is a dom tree)
-    const Okular::DocumentSynopsis *syn = m_document->documentSynopsis();
-    if (!syn) {
+    // request the table of contents
+    const Okular::Outline *outline = m_document->outline();
+    if (!outline) {
         if (m_document->isOpened()) {
             // Make sure we clear the reload old model data
             m_model->setOldModelData(nullptr, QVector<QModelIndex>());
@@ -84,7 +98,7 @@ void TOC::notifySetup(const QVector<Okular::Page *> & /*pages*/, int setupFlags)
         return;
     }
 
-    m_model->fill(syn);
+    m_model->fill(outline);
     emit hasTOC(!m_model->isEmpty());
 }
 
@@ -193,6 +207,8 @@ void TOC::expandRecursively()
     while (!worklist.isEmpty()) {
         QModelIndex index = worklist.takeLast();
         m_treeView->expand(index);
+        if (m_model->canFetchMore(index))
+            m_model->fetchMore(index);
         for (int i = 0; i < m_model->rowCount(index); i++) {
             worklist += m_model->index(i, 0, index);
         }
@@ -216,6 +232,7 @@ void TOC::collapseRecursively()
 
 void TOC::expandAll()
 {
+    m_model->fetchAll();
     m_treeView->expandAll();
 }
 
@@ -9,28 +9,38 @@
 #include <QApplication>
 #include <QList>
 #include <QTreeView>
-#include <qdom.h>
 
 #include <QFont>
 
 #include "core/document.h"
+#include "core/outline.h"
 #include "core/page.h"
 
 Q_DECLARE_METATYPE(QModelIndex)
 
 struct TOCItem {
     TOCItem();
-    TOCItem(TOCItem *parent, const QDomElement &e);
+    TOCItem(TOCItem *parent, int node);
     ~TOCItem();
 
     TOCItem(const TOCItem &) = delete;
     TOCItem &operator=(const TOCItem &) = delete;
 
+    const Okular::DocumentViewport &resolvedViewport();
+
     QString text;
     Okular::DocumentViewport viewport;
+    // the named destination of viewport, looked up when it is first needed
+    QString viewportName;
     QString extFileName;
     QString url;
     bool highlight : 1;
+    // whether the items of the children of node were made, see TOCModelPrivate::fetchChildren()
+    bool fetched : 1;
+    // in TOCModelPrivate::outline, -1 for the root
+    int node;
+    // kept, an old model compares with the new one after the outline changed
+    int childCount;
     TOCItem *parent;
     QList<TOCItem *> children;
     TOCModelPrivate *model;
@@ -42,14 +52,17 @@ public:
     explicit TOCModelPrivate(TOCModel *qq);
     ~TOCModelPrivate();
 
-    void addChildren(const QDomNode &parentNode, TOCItem *parentItem);
+    void addChildren(TOCItem *parentItem);
+    void fetchChildren(TOCItem *item);
+    void expandItemsToOpen();
     QModelIndex indexForItem(TOCItem *item) const;
-    void findViewport(const Okular::DocumentViewport &viewport, TOCItem *item, QList<TOCItem *> &list) const;
+    void findViewport(const Okular::DocumentViewport &viewport, TOCItem *item, QList<TOCItem *> &list);
 
     TOCModel *q;
     TOCItem *root;
     bool dirty : 1;
     Okular::Document *document;
+    const Okular::Outline *outline;
     QList<TOCItem *> itemsToOpen;
     QList<TOCItem *> currentPage;
     TOCModel *m_oldModel;
@@ -58,33 +71,34 @@ public:
 
 TOCItem::TOCItem()
     : highlight(false)
+    , fetched(false)
+    , node(-1)
+    , childCount(0)
     , parent(nullptr)
     , model(nullptr)
 {
 }
 
-TOCItem::TOCItem(TOCItem *_parent, const QDomElement &e)
+TOCItem::TOCItem(TOCItem *_parent, int _node)
     : highlight(false)
+    , fetched(false)
+    , node(_node)
     , parent(_parent)
 {
     parent->children.append(this);
     model = parent->model;
-    text = e.tagName();
-
-    // viewport loading
-    if (e.hasAttribute(QStringLiteral("Viewport"))) {
-        // if the node has a viewport, set it
-        viewport = Okular::DocumentViewport(e.attribute(QStringLiteral("Viewport")));
-    } else if (e.hasAttribute(QStringLiteral("ViewportName"))) {
-        // if the node references a viewport, get the reference and set it
-        const QString &page = e.attribute(QStringLiteral("ViewportName"));
-        QString viewport_string = model->document->metaData(QStringLiteral("NamedViewport"), page).toString();
-        if (!viewport_string.isEmpty())
-            viewport = Okular::DocumentViewport(viewport_string);
-    }
 
-    extFileName = e.attribute(QStringLiteral("ExternalFileName"));
-    url = e.attribute(QStringLiteral("URL"));
+    const Okular::Outline *outline = model->outline;
+    text = outline->title(node);
+    childCount = outline->childCount(node);
+
+    // if the node has a viewport, set it, if it references one, keep the reference for later
+    viewport = outline->viewport(node);
+    if (!viewport.isValid())
+        viewportName = outline->viewportName(node);
+
+    extFileName = outline->externalFileName(node);
+    url = outline->url(node);
 }
 
 TOCItem::~TOCItem()
@@ -92,10 +106,24 @@ TOCItem::~TOCItem()
     qDeleteAll(children);
 }
 
+const Okular::DocumentViewport &TOCItem::resolvedViewport()
+{
+    // the generator looks up named destinations, e.g. poppler under its lock,
+    // there is no need to do it for the items never shown nor followed
+    if (!viewportName.isEmpty()) {
+        const QString viewport_string = model->document->metaData(QStringLiteral("NamedViewport"), viewportName).toString();
+        if (!viewport_string.isEmpty())
+            viewport = Okular::DocumentViewport(viewport_string);
+        viewportName.clear();
+    }
+    return viewport;
+}
+
 TOCModelPrivate::TOCModelPrivate(TOCModel *qq)
     : q(qq)
     , root(new TOCItem)
     , dirty(false)
+    , outline(nullptr)
     , m_oldModel(nullptr)
 {
     root->model = this;
@@ -107,31 +135,53 @@ TOCModelPrivate::~TOCModelPrivate()
     delete m_oldModel;
 }
 
-void TOCModelPrivate::addChildren(const QDomNode &parentNode, TOCItem *parentItem)
+void TOCModelPrivate::addChildren(TOCItem *parentItem)
 {
-    TOCItem *currentItem = nullptr;
-    QDomNode n = parentNode.firstChild();
-    while (!n.isNull()) {
-        // convert the node to an element (sure it is)
-        QDomElement e = n.toElement();
+    parentItem->fetched = true;
 
+    for (int n = outline->firstChild(parentItem->node); n != -1; n = outline->nextSibling(n)) {
         // insert the entry as top level (listview parented) or 2nd+ level
-        currentItem = new TOCItem(parentItem, e);
-
-        // descend recursively and advance to the next node
-        if (e.hasChildNodes())
-            addChildren(n, currentItem);
+        TOCItem *currentItem = new TOCItem(parentItem, n);
 
-        // open/keep close the item
-        bool isOpen = false;
-        if (e.hasAttribute(QStringLiteral("Open")))
-            isOpen = QVariant(e.attribute(QStringLiteral("Open"))).toBool();
-        if (isOpen)
+        // the children of the open items are shown right away, the other
+        // ones are made when their parent is first expanded
+        if (outline->isOpen(n)) {
+            addChildren(currentItem);
             itemsToOpen.append(currentItem);
+        }
+    }
 
-        n = n.nextSibling();
+    if (parentItem == root)
         emit q->countChanged();
+}
+
+void TOCModelPrivate::fetchChildren(TOCItem *item)
+{
+    if (item->fetched || !outline)
+        return;
+
+    if (item->childCount == 0) {
+        item->fetched = true;
+        return;
+    }
+
+    q->beginInsertRows(indexForItem(item), 0, item->childCount - 1);
+    addChildren(item);
+    q->endInsertRows();
+    expandItemsToOpen();
+}
+
+void TOCModelPrivate::expandItemsToOpen()
+{
+    for (TOCItem *item : qAsConst(itemsToOpen)) {
+        const QModelIndex index = indexForItem(item);
+        if (!index.isValid())
+            continue;
+
+        // TODO misusing parent() here, fix
+        QMetaObject::invokeMethod(q->QObject::parent(), "expand", Qt::QueuedConnection, Q_ARG(QModelIndex, index));
     }
+    itemsToOpen.clear();
 }
 
 QModelIndex TOCModelPrivate::indexForItem(TOCItem *item) const
@@ -144,20 +194,23 @@ QModelIndex TOCModelPrivate::indexForItem(TOCItem *item) const
     return QModelIndex();
 }
 
-void TOCModelPrivate::findViewport(const Okular::DocumentViewport &viewport, TOCItem *item, QList<TOCItem *> &list) const
+void TOCModelPrivate::findViewport(const Okular::DocumentViewport &viewport, TOCItem *item, QList<TOCItem *> &list)
 {
     TOCItem *todo = item;
 
     while (todo) {
-        const TOCItem *current = todo;
+        TOCItem *current = todo;
         todo = nullptr;
         TOCItem *pos = nullptr;
 
-        for (TOCItem *child : current->children) {
-            if (child->viewport.isValid()) {
-                if (child->viewport.pageNumber <= viewport.pageNumber) {
+        // only the children along the way to the current section are made
+        fetchChildren(current);
+        for (TOCItem *child : qAsConst(current->children)) {
+            const Okular::DocumentViewport &childViewport = child->resolvedViewport();
+            if (childViewport.isValid()) {
+                if (childViewport.pageNumber <= viewport.pageNumber) {
                     pos = child;
-                    if (child->viewport.pageNumber == viewport.pageNumber) {
+                    if (childViewport.pageNumber == viewport.pageNumber) {
                         break;
                     }
                 } else {
@@ -241,11 +294,11 @@ QVariant TOCModel::data(const QModelIndex &index, int role) const
     case HighlightRole:
         return item->highlight;
     case PageItemDelegate::PageRole:
-        if (item->viewport.isValid())
+        if (item->resolvedViewport().isValid())
             return item->viewport.pageNumber + 1;
         break;
     case PageItemDelegate::PageLabelRole:
-        if (item->viewport.isValid() && item->viewport.pageNumber < int(d->document->pages()))
+        if (item->resolvedViewport().isValid() && item->viewport.pageNumber < int(d->document->pages()))
             return d->document->page(item->viewport.pageNumber)->label();
         break;
     }
@@ -258,7 +311,24 @@ bool TOCModel::hasChildren(const QModelIndex &parent) const
         return true;
 
     TOCItem *item = static_cast<TOCItem *>(parent.internalPointer());
-    return !item->children.isEmpty();
+    return item->fetched ? !item->children.isEmpty() : item->childCount > 0;
+}
+
+bool TOCModel::canFetchMore(const QModelIndex &parent) const
+{
+    if (!parent.isValid())
+        return false;
+
+    TOCItem *item = static_cast<TOCItem *>(parent.internalPointer());
+    return !item->fetched && item->childCount > 0;
+}
+
+void TOCModel::fetchMore(const QModelIndex &parent)
+{
+    if (!parent.isValid())
+        return;
+
+    d->fetchChildren(static_cast<TOCItem *>(parent.internalPointer()));
 }
 
 QVariant TOCModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -303,21 +373,25 @@ static QModelIndex indexForIndex(const QModelIndex &oldModelIndex, QAbstractItem
 {
     QModelIndex newModelIndex;
     if (oldModelIndex.parent().isValid()) {
-        newModelIndex = newModel->index(oldModelIndex.row(), oldModelIndex.column(), indexForIndex(oldModelIndex.parent(), newModel));
+        const QModelIndex newParent = indexForIndex(oldModelIndex.parent(), newModel);
+        if (newModel->canFetchMore(newParent))
+            newModel->fetchMore(newParent);
+        newModelIndex = newModel->index(oldModelIndex.row(), oldModelIndex.column(), newParent);
     } else {
         newModelIndex = newModel->index(oldModelIndex.row(), oldModelIndex.column());
     }
     return newModelIndex;
 }
 
-void TOCModel::fill(const Okular::DocumentSynopsis *toc)
+void TOCModel::fill(const Okular::Outline *outline)
 {
-    if (!toc)
+    if (!outline)
         return;
 
     clear();
     emit layoutAboutToBeChanged();
-    d->addChildren(*toc, d->root);
+    d->outline = outline;
+    d->addChildren(d->root);
     d->dirty = true;
     emit layoutChanged();
     if (equals(d->m_oldModel)) {
@@ -330,14 +404,7 @@ void TOCModel::fill(const Okular::DocumentSynopsis *toc)
             QMetaObject::invokeMethod(QObject::parent(), "expand", Qt::QueuedConnection, Q_ARG(QModelIndex, index));
         }
     } else {
-        for (TOCItem *item : qAsConst(d->itemsToOpen)) {
-            const QModelIndex index = d->indexForItem(item);
-            if (!index.isValid())
-                continue;
-
-            // TODO misusing parent() here, fix
-            QMetaObject::invokeMethod(QObject::parent(), "expand", Qt::QueuedConnection, Q_ARG(QModelIndex, index));
-        }
+        d->expandItemsToOpen();
     }
     d->itemsToOpen.clear();
     delete d->m_oldModel;
@@ -353,7 +420,9 @@ void TOCModel::clear()
     beginResetModel();
     qDeleteAll(d->root->children);
     d->root->children.clear();
+    d->root->fetched = false;
     d->currentPage.clear();
+    d->outline = nullptr;
     endResetModel();
     d->dirty = false;
 }
@@ -385,6 +454,17 @@ void TOCModel::setCurrentViewport(const Okular::DocumentViewport &viewport)
     }
 }
 
+void TOCModel::fetchAll()
+{
+    QList<TOCItem *> worklist = {d->root};
+    while (!worklist.isEmpty()) {
+        TOCItem *item = worklist.takeLast();
+        if (item != d->root)
+            d->fetchChildren(item);
+        worklist += item->children;
+    }
+}
+
 bool TOCModel::isEmpty() const
 {
     return d->root->children.isEmpty();
@@ -433,7 +513,7 @@ Okular::DocumentViewport TOCModel::viewportForIndex(const QModelIndex &index) co
         return Okular::DocumentViewport();
 
     TOCItem *item = static_cast<TOCItem *>(index.internalPointer());
-    return item->viewport;
+    return item->resolvedViewport();
 }
 
 QString TOCModel::urlForIndex(const QModelIndex &index) const
@@ -447,6 +527,12 @@ QString TOCModel::urlForIndex(const QModelIndex &index) const
 
 bool TOCModel::checkequality(const TOCModel *model, const QModelIndex &parentA, const QModelIndex &parentB) const
 {
+    // only as deep as the other model went, making the items of this one on the way
+    if (model->canFetchMore(parentB))
+        return true;
+    if (parentA.isValid())
+        d->fetchChildren(static_cast<TOCItem *>(parentA.internalPointer()));
+
     if (rowCount(parentA) != model->rowCount(parentB))
         return false;
     for (int i = 0; i < rowCount(parentA); i++) {
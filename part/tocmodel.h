@@ -14,7 +14,7 @@
 namespace Okular
 {
 class Document;
-class DocumentSynopsis;
+class Outline;
 class DocumentViewport;
 }
 
@@ -39,14 +39,18 @@ public:
     int columnCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
     bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
+    bool canFetchMore(const QModelIndex &parent) const override;
+    void fetchMore(const QModelIndex &parent) override;
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
     QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const override;
     QModelIndex parent(const QModelIndex &index) const override;
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
 
-    void fill(const Okular::DocumentSynopsis *toc);
+    void fill(const Okular::Outline *outline);
     void clear();
     void setCurrentViewport(const Okular::DocumentViewport &viewport);
+    // makes the items not expanded yet too, e.g. to search them
+    void fetchAll();
 
     bool isEmpty() const;
     bool equals(const TOCModel *model) const;
@@ -0,0 +1,552 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMimeDatabase>
+#include <QPainter>
+#include <QPixmap>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+
+#include "core/document.h"
+#include "core/functiontask_p.h"
+#include "core/generator.h"
+#include "core/observer.h"
+#include "core/page.h"
+#include "core/tile.h"
+#include "core/utils.h"
+#include "settings_core.h"
+
+#include <memory>
+#include <vector>
+
+// pages a worker has requested at a time, so its generator always has the next one queued
+static const int kPagesInFlight = 4;
+// how often the pages are checked against --timeout, in msec
+static const int kTimeoutCheckInterval = 100;
+// the document may drop a request, e.g. when short of memory, and never tell:
+// the pages are asked again after this long without a pixmap, in msec ...
+static const int kStallInterval = 5000;
+// ... and given up on after that many times
+static const int kMaxRetries = 12;
+
+struct RenderOptions {
+    double dpi = 150;
+    int width = 0; // in pixels, instead of dpi
+    QString format; // png, raw or none
+    QString outputDirectory;
+    bool text = false;
+    int bands = 1;
+    int timeout = 0; // in msec, 0 for none
+};
+
+/**
+ * Writes a rendered page, from the thread pool so the encoding doesn't keep
+ * the main thread from sending the next requests.
+ */
+static void saveImage(const QImage &image, const QString &fileName, const QString &format)
+{
+    bool saved;
+    if (format == QLatin1String("raw")) {
+        const QImage argb = image.convertToFormat(QImage::Format_ARGB32);
+        QFile file(fileName);
+        saved = file.open(QIODevice::WriteOnly) && file.write(reinterpret_cast<const char *>(argb.constBits()), argb.sizeInBytes()) == argb.sizeInBytes();
+    } else {
+        saved = image.save(fileName, "PNG");
+    }
+    if (!saved)
+        qWarning() << "Could not write" << fileName;
+}
+
+/**
+ * Renders its share of the pages with its own document, through the pixmap
+ * requests of the document like a view does, so it measures the same
+ * scheduling, tiling and cancellation. Each document renders in its own
+ * generator thread.
+ */
+class RenderWorker : public QObject, public Okular::DocumentObserver
+{
+    Q_OBJECT
+
+public:
+    explicit RenderWorker(const RenderOptions &options);
+    ~RenderWorker() override;
+
+    bool open(const QString &fileName);
+    int pageCount() const;
+    void start(const QVector<int> &pages);
+
+    void notifyPageChanged(int page, int flags) override;
+
+    int renderedPages;
+    int cancelledPages;
+    int droppedPages;
+    int textPages;
+    qint64 renderedPixels;
+
+Q_SIGNALS:
+    void finished();
+
+private:
+    struct PageJob {
+        int page;
+        int width;
+        int height;
+        QImage image;
+        // what is still to be rendered, the whole page is a null rect
+        QVector<Okular::NormalizedRect> bands;
+        QElapsedTimer timer;
+        int retries;
+    };
+
+    PageJob createJob(int pageNumber) const;
+    Okular::PixmapRequest *createRequest(const PageJob &job, const Okular::NormalizedRect &band);
+    void scheduleRequests();
+    void requestPages(bool cancelling);
+    void collectPixmaps(PageJob *job);
+    void finishPage(int index);
+    void extractText(int pageNumber);
+    void checkTimeouts();
+    void retryStalledPages();
+    QString outputFileName(int pageNumber) const;
+
+    Okular::Document m_document;
+    RenderOptions m_options;
+    QString m_baseName;
+    QVector<int> m_pages;
+    int m_nextPage;
+    QVector<PageJob> m_jobs;
+    QTimer m_timeoutTimer;
+    QTimer m_stallTimer;
+    bool m_requestScheduled;
+};
+
+RenderWorker::RenderWorker(const RenderOptions &options)
+    : renderedPages(0)
+    , cancelledPages(0)
+    , droppedPages(0)
+    , textPages(0)
+    , renderedPixels(0)
+    , m_document(nullptr)
+    , m_options(options)
+    , m_nextPage(0)
+    , m_requestScheduled(false)
+{
+    m_timeoutTimer.setInterval(kTimeoutCheckInterval);
+    connect(&m_timeoutTimer, &QTimer::timeout, this, &RenderWorker::checkTimeouts);
+    m_stallTimer.setSingleShot(true);
+    m_stallTimer.setInterval(kStallInterval);
+    connect(&m_stallTimer, &QTimer::timeout, this, &RenderWorker::retryStalledPages);
+}
+
+RenderWorker::~RenderWorker()
+{
+    m_document.removeObserver(this);
+}
+
+bool RenderWorker::open(const QString &fileName)
+{
+    QMimeDatabase db;
+    m_baseName = QFileInfo(fileName).completeBaseName();
+    m_document.addObserver(this);
+    if (m_document.openDocument(fileName, QUrl(), db.mimeTypeForFile(fileName)) != Okular::Document::OpenSuccess)
+        return false;
+
+    // the count of a document still being paginated is of the pages so far
+    if (m_document.isLoadingPages())
+        m_document.loadAllPages();
+    return true;
+}
+
+int RenderWorker::pageCount() const
+{
+    return m_document.pages();
+}
+
+void RenderWorker::start(const QVector<int> &pages)
+{
+    m_pages = pages;
+    m_nextPage = 0;
+    if (m_options.timeout > 0)
+        m_timeoutTimer.start();
+    requestPages(false);
+}
+
+RenderWorker::PageJob RenderWorker::createJob(int pageNumber) const
+{
+    const Okular::Page *page = m_document.page(pageNumber);
+    PageJob job;
+    job.page = pageNumber;
+    if (m_options.width > 0) {
+        job.width = m_options.width;
+        job.height = qRound(m_options.width * page->ratio());
+    } else {
+        // the size of the page is the one it has on the screen at 100%
+        const QSizeF screenDpi = Okular::Utils::realDpi(nullptr);
+        job.width = qRound(page->width() * m_options.dpi / screenDpi.width());
+        job.height = qRound(page->height() * m_options.dpi / screenDpi.height());
+    }
+    if (m_options.bands > 1) {
+        for (int i = 0; i < m_options.bands; ++i)
+            job.bands << Okular::NormalizedRect(0, double(i) / m_options.bands, 1, double(i + 1) / m_options.bands);
+    } else {
+        job.bands << Okular::NormalizedRect();
+    }
+    job.timer.start();
+    job.retries = 0;
+    return job;
+}
+
+Okular::PixmapRequest *RenderWorker::createRequest(const PageJob &job, const Okular::NormalizedRect &band)
+{
+    Okular::PixmapRequest *request = new Okular::PixmapRequest(this, job.page, job.width, job.height, 1, 1, Okular::PixmapRequest::Asynchronous);
+    // less than the whole of a large page, what makes the document use tiles
+    if (!band.isNull())
+        request->setNormalizedRect(band);
+    return request;
+}
+
+void RenderWorker::scheduleRequests()
+{
+    // not from inside the notifications of the document
+    if (m_requestScheduled)
+        return;
+
+    m_requestScheduled = true;
+    QTimer::singleShot(0, this, [this] { requestPages(false); });
+}
+
+void RenderWorker::requestPages(bool cancelling)
+{
+    m_requestScheduled = false;
+
+    QLinkedList<Okular::PixmapRequest *> requests;
+    // the pages left are asked again, the document cancels the ones that are not
+    if (cancelling) {
+        for (const PageJob &job : qAsConst(m_jobs)) {
+            for (const Okular::NormalizedRect &band : job.bands)
+                requests << createRequest(job, band);
+        }
+    }
+    while (m_jobs.count() < kPagesInFlight && m_nextPage < m_pages.count()) {
+        m_jobs.append(createJob(m_pages.at(m_nextPage++)));
+        for (const Okular::NormalizedRect &band : qAsConst(m_jobs.last().bands))
+            requests << createRequest(m_jobs.last(), band);
+    }
+
+    if (!requests.isEmpty()) {
+        m_document.requestPixmaps(requests, cancelling ? Okular::Document::RemoveAllPrevious : Okular::Document::NoOption);
+        m_stallTimer.start();
+    } else if (m_jobs.isEmpty()) {
+        m_timeoutTimer.stop();
+        m_stallTimer.stop();
+        emit finished();
+    }
+}
+
+void RenderWorker::notifyPageChanged(int page, int flags)
+{
+    if (!(flags & Okular::DocumentObserver::Pixmap))
+        return;
+
+    for (int i = 0; i < m_jobs.count(); ++i) {
+        if (m_jobs.at(i).page == page) {
+            m_stallTimer.start();
+            collectPixmaps(&m_jobs[i]);
+            if (m_jobs.at(i).bands.isEmpty())
+                finishPage(i);
+            return;
+        }
+    }
+}
+
+void RenderWorker::collectPixmaps(PageJob *job)
+{
+    const Okular::Page *page = m_document.page(job->page);
+    const bool keepImage = m_options.format != QLatin1String("none");
+
+    // without tiles the document renders the whole page, whatever the band
+    if (!page->hasTilesManager(this)) {
+        if (page->hasPixmap(this, job->width, job->height)) {
+            if (keepImage)
+                job->image = page->pixmap(this)->toImage();
+            job->bands.clear();
+        }
+        return;
+    }
+
+    if (keepImage && job->image.isNull()) {
+        job->image = QImage(job->width, job->height, QImage::Format_ARGB32_Premultiplied);
+        job->image.fill(Qt::white);
+    }
+    // the tiles are taken band by band, the document may evict them later
+    QPainter painter;
+    if (keepImage)
+        painter.begin(&job->image);
+    for (auto it = job->bands.begin(); it != job->bands.end();) {
+        if (!page->hasPixmap(this, job->width, job->height, *it)) {
+            ++it;
+            continue;
+        }
+        if (keepImage) {
+            const QList<Okular::Tile> tiles = page->tilesAt(this, *it);
+            for (const Okular::Tile &tile : tiles)
+                painter.drawPixmap(tile.rect().geometry(job->width, job->height), *tile.pixmap());
+        }
+        it = job->bands.erase(it);
+    }
+}
+
+void RenderWorker::finishPage(int index)
+{
+    const PageJob job = m_jobs.takeAt(index);
+    ++renderedPages;
+    renderedPixels += qint64(job.width) * job.height;
+
+    QString fileName;
+    if (m_options.format == QLatin1String("png"))
+        fileName = outputFileName(job.page) + QStringLiteral(".png");
+    else if (m_options.format == QLatin1String("raw"))
+        fileName = outputFileName(job.page) + QStringLiteral("-%1x%2.raw").arg(job.width).arg(job.height);
+    if (!fileName.isEmpty()) {
+        const QImage image = job.image;
+        const QString format = m_options.format;
+        QThreadPool::globalInstance()->start(new Okular::FunctionTask([image, fileName, format] { saveImage(image, fileName, format); }));
+    }
+
+    if (m_options.text)
+        extractText(job.page);
+
+    scheduleRequests();
+}
+
+void RenderWorker::extractText(int pageNumber)
+{
+    m_document.requestTextPage(pageNumber);
+    const Okular::Page *page = m_document.page(pageNumber);
+    if (!page->hasTextPage()) {
+        qWarning() << "No text for page" << pageNumber + 1;
+        return;
+    }
+
+    ++textPages;
+    QFile file(outputFileName(pageNumber) + QStringLiteral(".txt"));
+    if (!file.open(QIODevice::WriteOnly) || file.write(page->text().toUtf8()) < 0)
+        qWarning() << "Could not write" << file.fileName();
+}
+
+void RenderWorker::checkTimeouts()
+{
+    bool cancelled = false;
+    for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+        if (it->timer.hasExpired(m_options.timeout)) {
+            qWarning() << "Cancelled page" << it->page + 1 << "after" << m_options.timeout << "ms";
+            ++cancelledPages;
+            it = m_jobs.erase(it);
+            cancelled = true;
+        } else {
+            ++it;
+        }
+    }
+    if (cancelled)
+        requestPages(true);
+}
+
+void RenderWorker::retryStalledPages()
+{
+    // a notification may have been missed, the pixmaps are there then
+    for (int i = m_jobs.count() - 1; i >= 0; --i) {
+        collectPixmaps(&m_jobs[i]);
+        if (m_jobs.at(i).bands.isEmpty())
+            finishPage(i);
+    }
+
+    for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+        if (++it->retries > kMaxRetries) {
+            qWarning() << "Gave up on page" << it->page + 1 << "which the document did not render";
+            ++droppedPages;
+            it = m_jobs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // the pages left are asked again, the document keeps the ones it is rendering
+    requestPages(true);
+}
+
+QString RenderWorker::outputFileName(int pageNumber) const
+{
+    return QStringLiteral("%1/%2-%3").arg(m_options.outputDirectory, m_baseName).arg(pageNumber + 1, 4, 10, QLatin1Char('0'));
+}
+
+// the pages of ranges like 1-10,15,20- counted from 0, or none if one is not valid
+static QVector<int> parsePages(const QString &ranges, int pageCount)
+{
+    QVector<int> pages;
+    if (ranges.isEmpty()) {
+        for (int i = 0; i < pageCount; ++i)
+            pages << i;
+        return pages;
+    }
+
+    const QStringList parts = ranges.split(QLatin1Char(','), QString::SkipEmptyParts);
+    for (const QString &part : parts) {
+        const int dash = part.indexOf(QLatin1Char('-'));
+        bool firstOk = true;
+        bool lastOk = true;
+        const int first = (dash < 0 ? part : part.left(dash)).toInt(&firstOk);
+        int last = first;
+        if (dash >= 0)
+            last = dash == part.length() - 1 ? pageCount : part.mid(dash + 1).toInt(&lastOk);
+        if (!firstOk || !lastOk || first < 1 || last > pageCount || first > last)
+            return QVector<int>();
+
+        for (int page = first; page <= last; ++page)
+            pages << page - 1;
+    }
+    return pages;
+}
+
+int main(int argc, char *argv[])
+{
+    // it never shows a window
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("okular_render"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Renders the pages of a document with the Okular generators and reports how fast it went."));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("file"), QStringLiteral("The document to render"));
+    const QCommandLineOption pagesOption(QStringList() << QStringLiteral("p") << QStringLiteral("pages"), QStringLiteral("The pages to render, like 1-10,15,20-; all of them by default"), QStringLiteral("ranges"));
+    const QCommandLineOption dpiOption(QStringLiteral("dpi"), QStringLiteral("The resolution to render at, 150 by default"), QStringLiteral("dpi"), QStringLiteral("150"));
+    const QCommandLineOption widthOption(QStringLiteral("width"), QStringLiteral("The width of the rendered pages, instead of a resolution"), QStringLiteral("pixels"));
+    const QCommandLineOption formatOption(QStringList() << QStringLiteral("f") << QStringLiteral("format"),
+                                          QStringLiteral("png, raw (the ARGB32 pixels row after row, the size is in the file name) or none to only render; png by default"),
+                                          QStringLiteral("format"),
+                                          QStringLiteral("png"));
+    const QCommandLineOption outputOption(QStringList() << QStringLiteral("o") << QStringLiteral("output"), QStringLiteral("The folder to write to, the current one by default"), QStringLiteral("folder"), QStringLiteral("."));
+    const QCommandLineOption textOption(QStringLiteral("text"), QStringLiteral("Extract the text of the pages too"));
+    const QCommandLineOption jobsOption(QStringList() << QStringLiteral("j") << QStringLiteral("jobs"), QStringLiteral("How many documents render at the same time, each in its own thread; one per core by default"), QStringLiteral("count"));
+    const QCommandLineOption bandsOption(QStringLiteral("bands"), QStringLiteral("Request each page in this many bands, which the document renders as tiles on large pages"), QStringLiteral("count"), QStringLiteral("1"));
+    const QCommandLineOption timeoutOption(QStringLiteral("timeout"), QStringLiteral("Cancel the pages not rendered after this long"), QStringLiteral("msec"), QStringLiteral("0"));
+    parser.addOptions({pagesOption, dpiOption, widthOption, formatOption, outputOption, textOption, jobsOption, bandsOption, timeoutOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    if (parser.positionalArguments().count() != 1)
+        parser.showHelp(1);
+
+    RenderOptions options;
+    options.dpi = parser.value(dpiOption).toDouble();
+    options.width = parser.value(widthOption).toInt();
+    options.format = parser.value(formatOption);
+    options.outputDirectory = parser.value(outputOption);
+    options.text = parser.isSet(textOption);
+    options.bands = qMax(1, parser.value(bandsOption).toInt());
+    options.timeout = qMax(0, parser.value(timeoutOption).toInt());
+    if (options.format != QLatin1String("png") && options.format != QLatin1String("raw") && options.format != QLatin1String("none")) {
+        err << "Unknown format " << options.format << "\n";
+        return 1;
+    }
+    if (options.dpi <= 0 && options.width <= 0) {
+        err << "No resolution or width to render at\n";
+        return 1;
+    }
+    if ((options.format != QLatin1String("none") || options.text) && !QDir().mkpath(options.outputDirectory)) {
+        err << "Could not create " << options.outputDirectory << "\n";
+        return 1;
+    }
+
+    Okular::SettingsCore::instance(QStringLiteral("okular_render"));
+    // every page has to go to the generator
+    Okular::SettingsCore::setCompressedPixmapCacheSize(0);
+    Okular::SettingsCore::setEnablePixmapDiskCache(false);
+    Okular::SettingsCore::setEnableTextPageDiskCache(false);
+    Okular::SettingsCore::setEnableThumbnailDiskCache(false);
+
+    const QString fileName = parser.positionalArguments().constFirst();
+    QElapsedTimer openTimer;
+    openTimer.start();
+    std::vector<std::unique_ptr<RenderWorker>> workers;
+    workers.emplace_back(new RenderWorker(options));
+    if (!workers.front()->open(fileName)) {
+        err << "Could not open " << fileName << "\n";
+        return 1;
+    }
+
+    const QVector<int> pages = parsePages(parser.value(pagesOption), workers.front()->pageCount());
+    if (pages.isEmpty()) {
+        err << "No pages to render\n";
+        return 1;
+    }
+    const int jobs = qBound(1, parser.isSet(jobsOption) ? parser.value(jobsOption).toInt() : QThread::idealThreadCount(), pages.count());
+    while (int(workers.size()) < jobs) {
+        workers.emplace_back(new RenderWorker(options));
+        if (!workers.back()->open(fileName)) {
+            err << "Could not open " << fileName << " again\n";
+            return 1;
+        }
+    }
+    const qint64 openTime = openTimer.elapsed();
+
+    // the pages are dealt to the workers one by one
+    int running = jobs;
+    QElapsedTimer renderTimer;
+    renderTimer.start();
+    for (int i = 0; i < jobs; ++i) {
+        QVector<int> workerPages;
+        for (int page = i; page < pages.count(); page += jobs)
+            workerPages << pages.at(page);
+        QObject::connect(workers[i].get(), &RenderWorker::finished, &app, [&running, &app] {
+            if (--running == 0)
+                app.quit();
+        });
+        workers[i]->start(workerPages);
+    }
+    app.exec();
+    QThreadPool::globalInstance()->waitForDone();
+    const double seconds = qMax(renderTimer.elapsed(), qint64(1)) / 1000.0;
+
+    int renderedPages = 0;
+    int cancelledPages = 0;
+    int droppedPages = 0;
+    int textPages = 0;
+    qint64 renderedPixels = 0;
+    for (const std::unique_ptr<RenderWorker> &worker : workers) {
+        renderedPages += worker->renderedPages;
+        cancelledPages += worker->cancelledPages;
+        droppedPages += worker->droppedPages;
+        textPages += worker->textPages;
+        renderedPixels += worker->renderedPixels;
+    }
+
+    QTextStream out(stdout);
+    out << "Opened " << jobs << " documents in " << openTime << " ms\n";
+    out << "Rendered " << renderedPages << " pages (" << renderedPixels / 1000000.0 << " megapixels) in " << seconds << " s: " << renderedPages / seconds << " pages/s, " << renderedPixels / 1000000.0 / seconds << " megapixels/s\n";
+    if (options.text)
+        out << "Extracted the text of " << textPages << " pages\n";
+    if (cancelledPages > 0)
+        out << "Cancelled " << cancelledPages << " pages\n";
+    if (droppedPages > 0)
+        out << "Gave up on " << droppedPages << " pages the document did not render\n";
+    out.flush();
+
+    return cancelledPages > 0 || droppedPages > 0 ? 2 : 0;
+}
+
+#include "okularrender.moc"
@@ -0,0 +1,461 @@
+/*
+    SPDX-FileCopyrightText: 2026 agent <agent@local>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QDBusConnection>
+#include <QDBusError>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QMimeDatabase>
+#include <QPixmap>
+#include <QPointer>
+#include <QTextStream>
+#include <QThread>
+#include <QThreadPool>
+#include <QTimer>
+
+#include "core/document.h"
+#include "core/functiontask_p.h"
+#include "core/generator.h"
+#include "core/observer.h"
+#include "core/page.h"
+#include "settings_core.h"
+
+#include <algorithm>
+
+// documents kept open for the next jobs, the least recently used idle one is closed first
+static const int kMaxOpenDocuments = 8;
+// how long a job can run; the document may drop a request, e.g. when short of memory,
+// and never tell
+static const int kJobTimeout = 60000; // in msec
+
+/**
+ * A job of a client, waiting in the queue of the service or running on a document.
+ */
+struct ServiceJob {
+    enum Type { Render, Thumbnail, Text };
+
+    uint id;
+    Type type;
+    QString fileName;
+    int page;
+    int width;
+    int height;
+    int priority;
+    QString outputFile;
+};
+
+/**
+ * A document kept open by the service; it runs one job at a time, and is
+ * inactive between them so the shared pixmap budget takes from it first.
+ */
+class ServiceDocument : public QObject, public Okular::DocumentObserver
+{
+    Q_OBJECT
+
+public:
+    ServiceDocument();
+    ~ServiceDocument() override;
+
+    bool open(const QString &fileName);
+    bool isOutdated() const;
+    bool isBusy() const;
+    void run(const ServiceJob &job);
+    // the job being run, 0 if none
+    uint runningJob() const;
+    void cancel();
+
+    void notifyPageChanged(int page, int flags) override;
+
+    qint64 lastUsed;
+
+Q_SIGNALS:
+    void finished(uint job, bool success, const QString &error);
+
+private:
+    bool takePixmap();
+    void finish(bool success, const QString &error = QString());
+
+    Okular::Document m_document;
+    QString m_fileName;
+    QDateTime m_modified;
+    bool m_busy;
+    // the pixmap of the job is being written
+    bool m_saving;
+    ServiceJob m_job;
+    QTimer m_timeout;
+};
+
+ServiceDocument::ServiceDocument()
+    : lastUsed(0)
+    , m_document(nullptr)
+    , m_busy(false)
+    , m_saving(false)
+{
+    m_timeout.setSingleShot(true);
+    m_timeout.setInterval(kJobTimeout);
+    connect(&m_timeout, &QTimer::timeout, this, [this] { finish(false, QStringLiteral("Timed out")); });
+}
+
+ServiceDocument::~ServiceDocument()
+{
+    m_document.removeObserver(this);
+}
+
+bool ServiceDocument::open(const QString &fileName)
+{
+    QMimeDatabase db;
+    m_fileName = fileName;
+    m_modified = QFileInfo(fileName).lastModified();
+    m_document.addObserver(this);
+    if (m_document.openDocument(fileName, QUrl(), db.mimeTypeForFile(fileName)) != Okular::Document::OpenSuccess)
+        return false;
+
+    m_document.setActive(false);
+    return true;
+}
+
+bool ServiceDocument::isOutdated() const
+{
+    return QFileInfo(m_fileName).lastModified() != m_modified;
+}
+
+bool ServiceDocument::isBusy() const
+{
+    return m_busy;
+}
+
+uint ServiceDocument::runningJob() const
+{
+    return m_busy ? m_job.id : 0;
+}
+
+void ServiceDocument::cancel()
+{
+    // a pixmap or a save that comes later is for no job
+    finish(false, QStringLiteral("Cancelled"));
+}
+
+void ServiceDocument::run(const ServiceJob &job)
+{
+    m_job = job;
+    m_busy = true;
+    m_saving = false;
+    m_document.setActive(true);
+    m_timeout.start();
+
+    // the count of a document still being paginated is of the pages so far
+    if (m_document.isLoadingPages())
+        m_document.loadAllPages();
+    if (job.page < 0 || job.page >= int(m_document.pages())) {
+        finish(false, QStringLiteral("No page %1").arg(job.page));
+        return;
+    }
+
+    const Okular::Page *page = m_document.page(job.page);
+    if (job.type == ServiceJob::Text) {
+        m_document.requestTextPage(job.page);
+        QFile file(job.outputFile);
+        if (!page->hasTextPage())
+            finish(false, QStringLiteral("No text"));
+        else if (!file.open(QIODevice::WriteOnly) || file.write(page->text().toUtf8()) < 0)
+            finish(false, QStringLiteral("Could not write %1").arg(job.outputFile));
+        else
+            finish(true);
+        return;
+    }
+
+    if (job.type == ServiceJob::Thumbnail) {
+        // in a square of the size
+        if (page->ratio() > 1) {
+            m_job.width = qMax(1, qRound(job.width / page->ratio()));
+        } else {
+            m_job.height = qMax(1, qRound(job.width * page->ratio()));
+        }
+    } else if (m_job.height <= 0) {
+        // the missing side follows the page
+        m_job.height = qMax(1, qRound(m_job.width * page->ratio()));
+    }
+
+    // a warm document may have it already, the request would then be dropped
+    if (takePixmap())
+        return;
+
+    Okular::PixmapRequest::PixmapRequestFeatures features = Okular::PixmapRequest::Asynchronous;
+    if (job.type == ServiceJob::Thumbnail)
+        features |= Okular::PixmapRequest::Thumbnail | Okular::PixmapRequest::EmbeddedThumbnail;
+    m_document.requestPixmaps({new Okular::PixmapRequest(this, m_job.page, m_job.width, m_job.height, 1, 1, features)}, Okular::Document::NoOption);
+}
+
+void ServiceDocument::notifyPageChanged(int page, int flags)
+{
+    if (m_busy && !m_saving && m_job.type != ServiceJob::Text && page == m_job.page && (flags & Okular::DocumentObserver::Pixmap))
+        takePixmap();
+}
+
+bool ServiceDocument::takePixmap()
+{
+    const Okular::Page *page = m_document.page(m_job.page);
+    if (!page->hasPixmap(this, m_job.width, m_job.height))
+        return false;
+
+    const QImage image = page->pixmap(this)->toImage();
+    const QString outputFile = m_job.outputFile;
+    const uint id = m_job.id;
+    // the job may be cancelled or time out meanwhile, and the document closed then
+    const QPointer<ServiceDocument> document(this);
+    m_saving = true;
+    // written from the thread pool, the main thread is told whether it could
+    QThreadPool::globalInstance()->start(new Okular::FunctionTask([image, document, id, outputFile] {
+        const bool saved = image.save(outputFile, "PNG");
+        QMetaObject::invokeMethod(
+            qApp,
+            [document, id, outputFile, saved] {
+                if (document && document->runningJob() == id)
+                    document->finish(saved, saved ? QString() : QStringLiteral("Could not write %1").arg(outputFile));
+            },
+            Qt::QueuedConnection);
+    }));
+    // done for the document, the save finishes the job
+    m_document.setActive(false);
+    return true;
+}
+
+void ServiceDocument::finish(bool success, const QString &error)
+{
+    if (!m_busy)
+        return;
+
+    m_timeout.stop();
+    m_busy = false;
+    m_saving = false;
+    m_document.setActive(false);
+    emit finished(m_job.id, success, error);
+}
+
+/**
+ * Renders pages, thumbnails and text of documents for clients on the session
+ * bus, as org.kde.okular.RenderService on /RenderService.
+ *
+ * The jobs wait in one queue ordered by priority, lower first like the ones
+ * of Okular::PixmapRequest, and run on the documents kept open from the
+ * previous jobs, a few at a time. They all share the memory budget of the
+ * process. The results are written to a file given with the job, and
+ * finished() tells when.
+ */
+class RenderService : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.okular.RenderService")
+
+public:
+    explicit RenderService(int maxRunningJobs);
+    ~RenderService() override;
+
+public Q_SLOTS:
+    /**
+     * Renders @p page, counted from 0, as a PNG of @p width pixels, and
+     * @p height or as high as the page is if it is 0.
+     */
+    Q_SCRIPTABLE uint render(const QString &fileName, int page, int width, int height, int priority, const QString &outputFile);
+
+    /**
+     * A PNG of @p page at most @p size pixels wide and high, from the
+     * thumbnail cache or the thumbnail of the document when there is one.
+     */
+    Q_SCRIPTABLE uint thumbnail(const QString &fileName, int page, int size, int priority, const QString &outputFile);
+
+    /**
+     * Writes the text of @p page as UTF-8.
+     */
+    Q_SCRIPTABLE uint text(const QString &fileName, int page, int priority, const QString &outputFile);
+
+    /**
+     * Removes @p job from the queue, or stops waiting for it if it is
+     * running; finished() reports it as cancelled.
+     */
+    Q_SCRIPTABLE bool cancel(uint job);
+
+    Q_SCRIPTABLE int queuedJobs() const;
+
+Q_SIGNALS:
+    Q_SCRIPTABLE void finished(uint job, bool success, const QString &error);
+
+private:
+    uint enqueue(ServiceJob job);
+    void schedule();
+    ServiceDocument *document(const QString &fileName);
+    void jobFinished(uint job, bool success, const QString &error);
+
+    QVector<ServiceJob> m_queue;
+    QHash<QString, ServiceDocument *> m_documents;
+    uint m_nextJob;
+    int m_runningJobs;
+    int m_maxRunningJobs;
+    qint64 m_useCounter;
+};
+
+RenderService::RenderService(int maxRunningJobs)
+    : m_nextJob(1)
+    , m_runningJobs(0)
+    , m_maxRunningJobs(maxRunningJobs)
+    , m_useCounter(0)
+{
+}
+
+RenderService::~RenderService()
+{
+    qDeleteAll(m_documents);
+}
+
+uint RenderService::render(const QString &fileName, int page, int width, int height, int priority, const QString &outputFile)
+{
+    return enqueue({0, ServiceJob::Render, fileName, page, width, height, priority, outputFile});
+}
+
+uint RenderService::thumbnail(const QString &fileName, int page, int size, int priority, const QString &outputFile)
+{
+    return enqueue({0, ServiceJob::Thumbnail, fileName, page, size, size, priority, outputFile});
+}
+
+uint RenderService::text(const QString &fileName, int page, int priority, const QString &outputFile)
+{
+    return enqueue({0, ServiceJob::Text, fileName, page, 0, 0, priority, outputFile});
+}
+
+bool RenderService::cancel(uint job)
+{
+    for (int i = 0; i < m_queue.count(); ++i) {
+        if (m_queue.at(i).id == job) {
+            m_queue.removeAt(i);
+            emit finished(job, false, QStringLiteral("Cancelled"));
+            return true;
+        }
+    }
+    // its document finishes it, which frees its slot
+    for (ServiceDocument *serviceDocument : qAsConst(m_documents)) {
+        if (serviceDocument->runningJob() == job) {
+            serviceDocument->cancel();
+            return true;
+        }
+    }
+    return false;
+}
+
+int RenderService::queuedJobs() const
+{
+    return m_queue.count();
+}
+
+uint RenderService::enqueue(ServiceJob job)
+{
+    job.id = m_nextJob++;
+    job.fileName = QFileInfo(job.fileName).canonicalFilePath();
+    if (job.type != ServiceJob::Text && job.width <= 0) {
+        const uint id = job.id;
+        QMetaObject::invokeMethod(this, [this, id] { emit finished(id, false, QStringLiteral("No size")); }, Qt::QueuedConnection);
+        return id;
+    }
+
+    // after the ones of the same priority, it is a queue
+    auto it = std::upper_bound(m_queue.begin(), m_queue.end(), job, [](const ServiceJob &a, const ServiceJob &b) { return a.priority < b.priority; });
+    m_queue.insert(it, job);
+    // the client gets the id before any signal about it
+    QMetaObject::invokeMethod(this, &RenderService::schedule, Qt::QueuedConnection);
+    return job.id;
+}
+
+void RenderService::schedule()
+{
+    for (int i = 0; i < m_queue.count() && m_runningJobs < m_maxRunningJobs;) {
+        const ServiceJob job = m_queue.at(i);
+        ServiceDocument *serviceDocument = m_documents.value(job.fileName);
+        // its document is busy with another job, the next one may not be
+        if (serviceDocument && serviceDocument->isBusy()) {
+            ++i;
+            continue;
+        }
+
+        m_queue.removeAt(i);
+        serviceDocument = document(job.fileName);
+        if (!serviceDocument) {
+            emit finished(job.id, false, QStringLiteral("Could not open %1").arg(job.fileName));
+            continue;
+        }
+
+        ++m_runningJobs;
+        serviceDocument->lastUsed = ++m_useCounter;
+        serviceDocument->run(job);
+    }
+}
+
+ServiceDocument *RenderService::document(const QString &fileName)
+{
+    ServiceDocument *serviceDocument = m_documents.value(fileName);
+    if (serviceDocument && !serviceDocument->isOutdated())
+        return serviceDocument;
+
+    delete m_documents.take(fileName);
+    if (m_documents.count() >= kMaxOpenDocuments) {
+        ServiceDocument *leastUsed = nullptr;
+        for (ServiceDocument *candidate : qAsConst(m_documents)) {
+            if (!candidate->isBusy() && (!leastUsed || candidate->lastUsed < leastUsed->lastUsed))
+                leastUsed = candidate;
+        }
+        if (leastUsed)
+            delete m_documents.take(m_documents.key(leastUsed));
+    }
+
+    serviceDocument = new ServiceDocument();
+    if (fileName.isEmpty() || !serviceDocument->open(fileName)) {
+        delete serviceDocument;
+        return nullptr;
+    }
+    connect(serviceDocument, &ServiceDocument::finished, this, &RenderService::jobFinished);
+    m_documents.insert(fileName, serviceDocument);
+    return serviceDocument;
+}
+
+void RenderService::jobFinished(uint job, bool success, const QString &error)
+{
+    --m_runningJobs;
+    emit finished(job, success, error);
+    // not from inside the document that finished
+    QMetaObject::invokeMethod(this, &RenderService::schedule, Qt::QueuedConnection);
+}
+
+int main(int argc, char *argv[])
+{
+    // it never shows a window
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("okular_renderservice"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Renders pages, thumbnails and text of documents for the clients of org.kde.okular.RenderService on the session bus."));
+    parser.addHelpOption();
+    const QCommandLineOption jobsOption(QStringList() << QStringLiteral("j") << QStringLiteral("jobs"), QStringLiteral("How many jobs run at the same time, on different documents; one per core by default"), QStringLiteral("count"));
+    parser.addOption(jobsOption);
+    parser.process(app);
+
+    Okular::SettingsCore::instance(QStringLiteral("okular_renderservice"));
+
+    RenderService service(qMax(1, parser.isSet(jobsOption) ? parser.value(jobsOption).toInt() : QThread::idealThreadCount()));
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.registerService(QStringLiteral("org.kde.okular.RenderService")) || !bus.registerObject(QStringLiteral("/RenderService"), &service, QDBusConnection::ExportScriptableSlots | QDBusConnection::ExportScriptableSignals)) {
+        QTextStream(stderr) << "Could not register on the session bus: " << bus.lastError().message() << "\n";
+        return 1;
+    }
+
+    return app.exec();
+}
+
+#include "okularrenderservice.moc"